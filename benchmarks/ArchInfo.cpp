@@ -0,0 +1,82 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/ArchInfo.h"
+#include "PAF/PAF.h"
+
+#include "benchmark/benchmark.h"
+
+#include <cstdint>
+#include <vector>
+
+using PAF::ReferenceInstruction;
+
+using std::vector;
+
+namespace {
+
+// Get a set of Thumb instructions, with a few distinct encodings repeated
+// the way they would be in a trace.
+vector<ReferenceInstruction> getInstructions() {
+    vector<ReferenceInstruction> Instrs;
+    Time t = 0;
+    for (unsigned imm = 0; imm < 64; imm++) {
+        Instrs.emplace_back(t++, IE_EXECUTED, 0x1000, THUMB, 16,
+                            0x2100 | (imm & 0xff), "MOVS r1,#imm",
+                            vector<PAF::MemoryAccess>(),
+                            vector<PAF::RegisterAccess>());
+        Instrs.emplace_back(t++, IE_EXECUTED, 0x1002, THUMB, 16, 0x4408,
+                            "ADD r0,r1", vector<PAF::MemoryAccess>(),
+                            vector<PAF::RegisterAccess>());
+        Instrs.emplace_back(t++, IE_EXECUTED, 0x1004, THUMB, 16, 0x6808,
+                            "LDR r0,[r1,#0]", vector<PAF::MemoryAccess>(),
+                            vector<PAF::RegisterAccess>());
+        Instrs.emplace_back(t++, IE_EXECUTED, 0x1006, THUMB, 16, 0x6008,
+                            "STR r0,[r1,#0]", vector<PAF::MemoryAccess>(),
+                            vector<PAF::RegisterAccess>());
+        Instrs.emplace_back(t++, IE_EXECUTED, 0x1008, THUMB, 32, 0xf8db0800,
+                            "LDR.W r0,[r11,#0]", vector<PAF::MemoryAccess>(),
+                            vector<PAF::RegisterAccess>());
+    }
+    return Instrs;
+}
+
+void BM_V7MGetInstrInfo(benchmark::State &state) {
+    const vector<ReferenceInstruction> Instrs = getInstructions();
+    const PAF::V7MInfo CPU;
+    for (auto _ : state)
+        for (const ReferenceInstruction &I : Instrs)
+            benchmark::DoNotOptimize(CPU.getInstrInfo(I));
+    state.SetItemsProcessed(state.iterations() * Instrs.size());
+}
+BENCHMARK(BM_V7MGetInstrInfo);
+
+void BM_InstrInfoCacheGet(benchmark::State &state) {
+    const vector<ReferenceInstruction> Instrs = getInstructions();
+    const PAF::V7MInfo CPU;
+    PAF::InstrInfoCache Cache(CPU);
+    for (auto _ : state)
+        for (const ReferenceInstruction &I : Instrs)
+            benchmark::DoNotOptimize(&Cache.get(I));
+    state.SetItemsProcessed(state.iterations() * Instrs.size());
+}
+BENCHMARK(BM_InstrInfoCacheGet);
+
+} // namespace
@@ -0,0 +1,84 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/Expr.h"
+#include "PAF/SCA/ExprParser.h"
+#include "PAF/SCA/NPArray.h"
+#include "paf-bench.h"
+
+#include "benchmark/benchmark.h"
+
+#include <cstdint>
+#include <memory>
+
+using PAF::Bench::syntheticTraces;
+using PAF::SCA::NPArray;
+
+using std::unique_ptr;
+
+namespace {
+
+// Evaluate an AES first round intermediate value on each row of the inputs,
+// as paf-np-expand does.
+void BM_ExprEval(benchmark::State &state) {
+    const size_t rows = state.range(0);
+    const NPArray<uint32_t> in = syntheticTraces<uint32_t>(rows, 16, 1);
+    const NPArray<uint32_t> key = syntheticTraces<uint32_t>(rows, 16, 2);
+
+    PAF::SCA::Expr::Context<uint32_t> context;
+    context.addVariable("in", in.cbegin());
+    context.addVariable("key", key.cbegin());
+    unique_ptr<PAF::SCA::Expr::Expr> E(
+        PAF::SCA::Expr::Parser<uint32_t>(
+            context, "AES_SBOX(TRUNC8(XOR($in[0],$key[0])))")
+            .parse());
+    if (!E) {
+        state.SkipWithError("Can not parse the expression");
+        return;
+    }
+
+    for (auto _ : state) {
+        context.reset();
+        uint64_t sum = 0;
+        for (size_t r = 0; r < rows; r++) {
+            sum += E->eval().getValue();
+            context.incr();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_ExprEval)->Arg(1000)->Arg(100000);
+
+// Parse an expression.
+void BM_ExprParse(benchmark::State &state) {
+    PAF::SCA::Expr::Context<uint32_t> context;
+    for (auto _ : state) {
+        unique_ptr<PAF::SCA::Expr::Expr> E(
+            PAF::SCA::Expr::Parser<uint32_t>(
+                context, "AES_SBOX(TRUNC8(XOR(LSR(305419896_u32,8_u32),"
+                         "AND(NOT(4660_u32),OR(22136_u32,1_u32)))))")
+                .parse());
+        benchmark::DoNotOptimize(E);
+    }
+}
+BENCHMARK(BM_ExprParse);
+
+} // namespace
@@ -0,0 +1,90 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/Intervals.h"
+#include "paf-bench.h"
+
+#include "benchmark/benchmark.h"
+
+#include <cstdint>
+#include <vector>
+
+using PAF::Bench::Random;
+
+using TInterval = PAF::Interval<uint64_t>;
+using TIntervals = PAF::Intervals<uint64_t>;
+
+namespace {
+
+// Get n intervals of up to 16 elements, randomly placed in a range wide
+// enough for most of them not to overlap.
+std::vector<TInterval> randomIntervals(size_t n) {
+    Random R;
+    std::vector<TInterval> intervals;
+    intervals.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        const uint64_t b = R() % (64 * n);
+        intervals.emplace_back(b, b + 1 + R() % 16);
+    }
+    return intervals;
+}
+
+void BM_IntervalsInsert(benchmark::State &state) {
+    const std::vector<TInterval> intervals = randomIntervals(state.range(0));
+
+    for (auto _ : state) {
+        TIntervals I;
+        for (const auto &i : intervals)
+            I.insert(i);
+        benchmark::DoNotOptimize(I);
+    }
+    state.SetItemsProcessed(state.iterations() * intervals.size());
+}
+BENCHMARK(BM_IntervalsInsert)->Arg(1000)->Arg(100000);
+
+void BM_IntervalsInsertAll(benchmark::State &state) {
+    const std::vector<TInterval> intervals = randomIntervals(state.range(0));
+
+    for (auto _ : state) {
+        TIntervals I;
+        I.insertAll(intervals.begin(), intervals.end());
+        benchmark::DoNotOptimize(I);
+    }
+    state.SetItemsProcessed(state.iterations() * intervals.size());
+}
+BENCHMARK(BM_IntervalsInsertAll)->Arg(1000)->Arg(100000);
+
+// Look intervals up in the result of a bulk insertion.
+void BM_IntervalsContains(benchmark::State &state) {
+    const std::vector<TInterval> intervals = randomIntervals(state.range(0));
+    TIntervals I;
+    I.insertAll(intervals.begin(), intervals.end());
+
+    for (auto _ : state) {
+        size_t found = 0;
+        for (const auto &i : intervals)
+            found += I.contains(i);
+        benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(state.iterations() * intervals.size());
+}
+BENCHMARK(BM_IntervalsContains)->Arg(1000)->Arg(100000);
+
+} // namespace
@@ -0,0 +1,86 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/NPArray.h"
+#include "paf-bench.h"
+
+#include "benchmark/benchmark.h"
+
+#include <cstdint>
+
+using PAF::Bench::syntheticTraces;
+using PAF::Bench::TemporaryFile;
+using PAF::SCA::NPArray;
+
+namespace {
+
+// Load a rows x cols matrix of doubles from a file.
+void BM_NPArrayLoad(benchmark::State &state) {
+    const size_t rows = state.range(0);
+    const size_t cols = state.range(1);
+    const TemporaryFile TF("paf-bench-NPArray.XXXXXX");
+    if (!syntheticTraces<double>(rows, cols).save(TF.getFilename())) {
+        state.SkipWithError("Can not save the NPArray");
+        return;
+    }
+
+    for (auto _ : state) {
+        NPArray<double> A(TF.getFilename());
+        benchmark::DoNotOptimize(A);
+    }
+    state.SetBytesProcessed(state.iterations() * rows * cols *
+                            sizeof(double));
+}
+BENCHMARK(BM_NPArrayLoad)->Args({1000, 1000})->Args({100, 100000});
+
+// Load a rows x cols matrix of int16_t from a file, converting it to double.
+void BM_NPArrayLoadAs(benchmark::State &state) {
+    const size_t rows = state.range(0);
+    const size_t cols = state.range(1);
+    const TemporaryFile TF("paf-bench-NPArray.XXXXXX");
+    if (!syntheticTraces<int16_t>(rows, cols).save(TF.getFilename())) {
+        state.SkipWithError("Can not save the NPArray");
+        return;
+    }
+
+    for (auto _ : state) {
+        NPArray<double> A = NPArray<double>::readAs(TF.getFilename());
+        benchmark::DoNotOptimize(A);
+    }
+    state.SetBytesProcessed(state.iterations() * rows * cols *
+                            sizeof(int16_t));
+}
+BENCHMARK(BM_NPArrayLoadAs)->Args({1000, 1000})->Args({100, 100000});
+
+// Convert an in-memory rows x cols matrix of doubles to floats.
+void BM_NPArrayConvert(benchmark::State &state) {
+    const size_t rows = state.range(0);
+    const size_t cols = state.range(1);
+    const NPArray<double> A = syntheticTraces<double>(rows, cols);
+
+    for (auto _ : state) {
+        NPArray<float> B = PAF::SCA::convert<float>(A);
+        benchmark::DoNotOptimize(B);
+    }
+    state.SetItemsProcessed(state.iterations() * rows * cols);
+}
+BENCHMARK(BM_NPArrayConvert)->Args({1000, 1000})->Args({100, 100000});
+
+} // namespace
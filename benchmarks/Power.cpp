@@ -0,0 +1,160 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/ArchInfo.h"
+#include "PAF/PAF.h"
+#include "PAF/SCA/Dumper.h"
+#include "PAF/SCA/Noise.h"
+#include "PAF/SCA/Power.h"
+#include "paf-bench.h"
+
+#include "benchmark/benchmark.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using PAF::MemoryAccess;
+using PAF::ReferenceInstruction;
+using PAF::RegisterAccess;
+using PAF::SCA::BufferedInstrDumper;
+using PAF::SCA::BufferedMemoryAccessesDumper;
+using PAF::SCA::BufferedRegBankDumper;
+using PAF::SCA::NoiseSource;
+using PAF::SCA::PowerAnalysisConfig;
+using PAF::SCA::PowerDumper;
+using PAF::SCA::PowerSamples;
+using PAF::SCA::PowerTrace;
+using PAF::SCA::PowerTraceConfig;
+using PAF::SCA::TimingInfo;
+
+using std::make_unique;
+using std::vector;
+
+namespace {
+
+class NullTimingInfo : public TimingInfo {
+  public:
+    void save(std::ostream &os) const override {}
+};
+
+// A PowerDumper which only counts the samples it gets.
+class CountingPowerDumper : public PowerDumper {
+  public:
+    void dump(double total, double pc, double instr, double oreg, double ireg,
+              double addr, double data,
+              const PAF::ReferenceInstruction *I) override {
+        samples += 1;
+    }
+    void dumpSamples(const PowerSamples &S) override { samples += S.size(); }
+
+    size_t samples = 0;
+};
+
+// An Oracle with all registers and memory locations being 0.
+class ZeroOracle : public PowerTrace::Oracle {
+  public:
+    ZeroOracle(const PAF::ArchInfo &CPU) : numRegisters(CPU.numRegisters()) {}
+    [[nodiscard]] vector<uint64_t> getRegBankState(Time t) const override {
+        return vector<uint64_t>(numRegisters, 0);
+    }
+
+  private:
+    const size_t numRegisters;
+};
+
+// Get a trace of n instructions, looping over a small sequence of
+// instructions with register and memory accesses.
+PowerTrace syntheticPowerTrace(const PowerTraceConfig &PTC,
+                               const PAF::ArchInfo &CPU, size_t n) {
+    PAF::Bench::Random R;
+    PowerTrace PT(PTC, CPU);
+    for (size_t i = 0; i < n; i++) {
+        const Time t = i + 1;
+        const uint32_t v = uint32_t(R());
+        switch (i % 4) {
+        case 0:
+            PT.add(ReferenceInstruction(
+                t, IE_EXECUTED, 0x1000, THUMB, 16, 0x2105, "MOVS r1,#5", {},
+                {RegisterAccess("r1", v & 0xff, RegisterAccess::Type::WRITE),
+                 RegisterAccess("cpsr", 0x21000000,
+                                RegisterAccess::Type::WRITE)}));
+            break;
+        case 1:
+            PT.add(ReferenceInstruction(
+                t, IE_EXECUTED, 0x1002, THUMB, 16, 0x460a, "MOV r2,r1", {},
+                {RegisterAccess("r1", v, RegisterAccess::Type::READ),
+                 RegisterAccess("r2", v, RegisterAccess::Type::WRITE)}));
+            break;
+        case 2:
+            PT.add(ReferenceInstruction(
+                t, IE_EXECUTED, 0x1004, THUMB, 16, 0x6008, "STR r0,[r1,#0]",
+                {MemoryAccess(4, 0x21000 + (v & 0xffc), v,
+                              MemoryAccess::Type::WRITE)},
+                {RegisterAccess("r0", v, RegisterAccess::Type::READ),
+                 RegisterAccess("r1", 0x21000, RegisterAccess::Type::READ)}));
+            break;
+        case 3:
+            PT.add(ReferenceInstruction(
+                t, IE_EXECUTED, 0x1006, THUMB, 16, 0x6808, "LDR r0,[r1,#0]",
+                {MemoryAccess(4, 0x21000 + (v & 0xffc), v,
+                              MemoryAccess::Type::READ)},
+                {RegisterAccess("r1", 0x21000, RegisterAccess::Type::READ),
+                 RegisterAccess("r0", v, RegisterAccess::Type::WRITE)}));
+            break;
+        }
+    }
+    return PT;
+}
+
+void BM_PowerModel(benchmark::State &state,
+                   PowerAnalysisConfig::PowerModel model) {
+    const size_t n = state.range(0);
+    const PAF::V7MInfo CPU;
+    const PowerTraceConfig PTC;
+    PowerTrace PT = syntheticPowerTrace(PTC, CPU, n);
+    ZeroOracle oracle(CPU);
+    NullTimingInfo TI;
+    BufferedRegBankDumper RBD(false);
+    BufferedMemoryAccessesDumper MAD(false);
+    BufferedInstrDumper ID(false);
+
+    size_t samples = 0;
+    for (auto _ : state) {
+        vector<PowerAnalysisConfig> PAConfigs;
+        PAConfigs.emplace_back(model, make_unique<CountingPowerDumper>(),
+                               NoiseSource::ZERO, 0.0);
+        PT.analyze(PAConfigs, oracle, TI, RBD, MAD, ID);
+        samples +=
+            static_cast<CountingPowerDumper &>(PAConfigs[0].getDumper())
+                .samples;
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    state.counters["samples"] = benchmark::Counter(
+        double(samples), benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_CAPTURE(BM_PowerModel, HammingWeight,
+                  PowerAnalysisConfig::HAMMING_WEIGHT)
+    ->Arg(100000);
+BENCHMARK_CAPTURE(BM_PowerModel, HammingDistance,
+                  PowerAnalysisConfig::HAMMING_DISTANCE)
+    ->Arg(100000);
+
+} // namespace
@@ -0,0 +1,114 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/SCA.h"
+#include "paf-bench.h"
+
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+using PAF::Bench::syntheticTraces;
+using PAF::SCA::Classification;
+using PAF::SCA::NPArray;
+
+using std::vector;
+
+namespace {
+
+// The traces shapes: number of traces x number of samples.
+void shapes(benchmark::internal::Benchmark *B) {
+    B->Args({1000, 1000})->Args({10000, 1000})->Args({1000, 10000});
+}
+
+vector<Classification> alternateGroups(size_t n) {
+    vector<Classification> classifier(n);
+    for (size_t i = 0; i < n; i++)
+        classifier[i] = i % 2 ? Classification::GROUP_1 : Classification::GROUP_0;
+    return classifier;
+}
+
+void BM_TTest(benchmark::State &state) {
+    const size_t rows = state.range(0);
+    const size_t cols = state.range(1);
+    const NPArray<double> traces = syntheticTraces<double>(rows, cols);
+    const vector<Classification> classifier = alternateGroups(rows);
+
+    for (auto _ : state) {
+        NPArray<double> t = PAF::SCA::t_test(0, cols, traces, classifier);
+        benchmark::DoNotOptimize(t);
+    }
+    state.SetItemsProcessed(state.iterations() * rows * cols);
+}
+BENCHMARK(BM_TTest)->Apply(shapes);
+
+// The t-test on int16_t traces, as acquired by most oscilloscopes.
+void BM_TTestInt16(benchmark::State &state) {
+    const size_t rows = state.range(0);
+    const size_t cols = state.range(1);
+    const NPArray<int16_t> traces = syntheticTraces<int16_t>(rows, cols);
+    const vector<Classification> classifier = alternateGroups(rows);
+
+    for (auto _ : state) {
+        NPArray<double> t = PAF::SCA::t_test(0, cols, traces, classifier);
+        benchmark::DoNotOptimize(t);
+    }
+    state.SetItemsProcessed(state.iterations() * rows * cols);
+}
+BENCHMARK(BM_TTestInt16)->Apply(shapes);
+
+void BM_PerfectTTest(benchmark::State &state) {
+    const size_t rows = state.range(0);
+    const size_t cols = state.range(1);
+    const NPArray<double> group0 = syntheticTraces<double>(rows / 2, cols, 1);
+    const NPArray<double> group1 = syntheticTraces<double>(rows / 2, cols, 2);
+
+    for (auto _ : state) {
+        NPArray<double> t =
+            PAF::SCA::perfect_t_test(0, cols, group0, group1, nullptr);
+        benchmark::DoNotOptimize(t);
+    }
+    state.SetItemsProcessed(state.iterations() * rows * cols);
+}
+BENCHMARK(BM_PerfectTTest)->Apply(shapes);
+
+// The correlation with 1 (single hypothesis) and 256 (a key byte guess)
+// intermediate values per trace.
+void BM_Correl(benchmark::State &state) {
+    const size_t rows = state.range(0);
+    const size_t cols = state.range(1);
+    const size_t hypotheses = state.range(2);
+    const NPArray<double> traces = syntheticTraces<double>(rows, cols);
+    const NPArray<double> ival = syntheticTraces<double>(hypotheses, rows, 3);
+
+    for (auto _ : state) {
+        NPArray<double> c = PAF::SCA::correl(0, cols, traces, ival);
+        benchmark::DoNotOptimize(c);
+    }
+    state.SetItemsProcessed(state.iterations() * rows * cols * hypotheses);
+}
+BENCHMARK(BM_Correl)
+    ->Args({1000, 1000, 1})
+    ->Args({10000, 1000, 1})
+    ->Args({1000, 10000, 1})
+    ->Args({1000, 1000, 256});
+
+} // namespace
@@ -0,0 +1,92 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/WAN/Synthetic.h"
+#include "PAF/WAN/VCDWaveFile.h"
+#include "PAF/WAN/Waveform.h"
+#include "paf-bench.h"
+
+#ifdef HAS_GTKWAVE_FST
+#include "PAF/WAN/FSTWaveFile.h"
+#endif
+
+#include "benchmark/benchmark.h"
+
+#include <fstream>
+
+using PAF::Bench::TemporaryFile;
+using PAF::WAN::syntheticWaveform;
+using PAF::WAN::VCDWaveFile;
+using PAF::WAN::Waveform;
+
+namespace {
+
+// Write to file filename a synthetic VCD waveform, with about a quarter of
+// the signals changing at each time step.
+void writeSyntheticVCD(const std::string &filename, size_t numSignals,
+                       size_t numTimes) {
+    VCDWaveFile(filename).write(syntheticWaveform(numSignals, numTimes, 0.25));
+}
+
+size_t fileSize(const std::string &filename) {
+    std::ifstream is(filename, std::ifstream::binary | std::ifstream::ate);
+    return is ? size_t(is.tellg()) : 0;
+}
+
+// The waveforms shapes: number of signals x number of time steps.
+void shapes(benchmark::internal::Benchmark *B) {
+    B->Args({100, 10000})->Args({2000, 500});
+}
+
+void BM_VCDRead(benchmark::State &state) {
+    const TemporaryFile VCD("paf-bench-WaveFile.vcd.XXXXXX");
+    writeSyntheticVCD(VCD.getFilename(), state.range(0), state.range(1));
+
+    for (auto _ : state) {
+        Waveform W = VCDWaveFile(VCD.getFilename()).read();
+        benchmark::DoNotOptimize(W);
+    }
+    state.SetBytesProcessed(state.iterations() * fileSize(VCD.getFilename()));
+}
+BENCHMARK(BM_VCDRead)->Apply(shapes)->Unit(benchmark::kMillisecond);
+
+#ifdef HAS_GTKWAVE_FST
+void BM_FSTRead(benchmark::State &state) {
+    const TemporaryFile VCD("paf-bench-WaveFile.vcd.XXXXXX");
+    writeSyntheticVCD(VCD.getFilename(), state.range(0), state.range(1));
+    const TemporaryFile FST("paf-bench-WaveFile.fst.XXXXXX");
+    if (!PAF::WAN::FSTWaveFile(FST.getFilename(), /* write: */ true)
+             .write(VCDWaveFile(VCD.getFilename()).read())) {
+        state.SkipWithError("Can not write the FST file");
+        return;
+    }
+
+    for (auto _ : state) {
+        Waveform W = PAF::WAN::FSTWaveFile(FST.getFilename(), false).read();
+        benchmark::DoNotOptimize(W);
+    }
+    // Report the rate in terms of the VCD size, so that it can be compared
+    // with BM_VCDRead's.
+    state.SetBytesProcessed(state.iterations() * fileSize(VCD.getFilename()));
+}
+BENCHMARK(BM_FSTRead)->Apply(shapes)->Unit(benchmark::kMillisecond);
+#endif
+
+} // namespace
@@ -0,0 +1,14 @@
+#include "libtarmac/reporter.hh"
+
+#include "benchmark/benchmark.h"
+
+std::unique_ptr<Reporter> reporter = make_cli_reporter();
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
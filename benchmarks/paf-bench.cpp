@@ -0,0 +1,54 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "paf-bench.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+using std::string;
+
+namespace PAF::Bench {
+
+TemporaryFile::TemporaryFile(const char *tpl) {
+    const char *tmpdir = std::getenv("TMPDIR");
+    string tmpTplStr = string(tmpdir != nullptr ? tmpdir : "/tmp") + "/" + tpl;
+    std::unique_ptr<char[]> tmpTpl(new char[tmpTplStr.size() + 1]);
+    std::memcpy(tmpTpl.get(), tmpTplStr.c_str(), tmpTplStr.size() + 1);
+    // mkstemp creates and opens the file: close it right away, keeping its
+    // name so that it can be reopened later.
+    const int fd = mkstemp(tmpTpl.get());
+    if (fd != -1) {
+        close(fd);
+        filename = tmpTpl.get();
+    }
+}
+
+TemporaryFile::~TemporaryFile() {
+    if (!filename.empty())
+        std::remove(filename.c_str());
+}
+
+} // namespace PAF::Bench
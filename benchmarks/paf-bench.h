@@ -0,0 +1,79 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/SCA/NPArray.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace PAF::Bench {
+
+/// The TemporaryFile class provides a unique temporary filename, matching
+/// template \p tpl, for the lifetime of the object. The file is removed on
+/// destruction.
+class TemporaryFile {
+  public:
+    TemporaryFile(const char *tpl);
+    TemporaryFile(const TemporaryFile &) = delete;
+    TemporaryFile &operator=(const TemporaryFile &) = delete;
+    ~TemporaryFile();
+
+    /// Get this temporary file's name.
+    [[nodiscard]] const std::string &getFilename() const { return filename; }
+
+  private:
+    std::string filename;
+};
+
+/// A deterministic pseudo-random number generator, so that the benchmarks
+/// process the same data from one run to the next.
+class Random {
+  public:
+    Random(uint64_t seed = 0x5eed) : state(seed) {}
+
+    uint64_t operator()() {
+        // SplitMix64.
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+  private:
+    uint64_t state;
+};
+
+/// Get a \p rows x \p cols synthetic traces matrix, with values in [0,
+/// 1024).
+template <class Ty>
+SCA::NPArray<Ty> syntheticTraces(size_t rows, size_t cols,
+                                 uint64_t seed = 0x5eed) {
+    Random R(seed);
+    SCA::NPArray<Ty> traces(rows, cols);
+    for (size_t r = 0; r < rows; r++)
+        for (size_t c = 0; c < cols; c++)
+            traces(r, c) = Ty(R() % 1024);
+    return traces;
+}
+
+} // namespace PAF::Bench
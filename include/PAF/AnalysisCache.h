@@ -0,0 +1,113 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/PAF.h"
+
+#include "libtarmac/index.hh"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace PAF {
+
+/// The AnalysisCache class persists the results of the MTAnalyzer trace
+/// analyses (function instances, call sites, label ranges, ...) in a sidecar
+/// file, so that the tools run later on the same trace do not have to scan
+/// the trace again.
+///
+/// The cache file is tied to the trace and image it was computed from by a
+/// key: should any of them change, the cache file content is discarded.
+class AnalysisCache {
+  public:
+    /// The cached result of an analysis.
+    struct Entry {
+        /// The execution ranges.
+        std::vector<ExecutionRange> ranges;
+        /// The labels associated to the ranges, for the analyses which
+        /// produce them.
+        std::vector<std::pair<uint64_t, std::string>> labels;
+    };
+
+    /// Construct an AnalysisCache, backed by file \p filename and valid for
+    /// \p key. The file content is loaded if it exists and has been saved
+    /// with the same \p key.
+    AnalysisCache(const std::string &filename, uint64_t key);
+
+    /// Construct an AnalysisCache for \p trace and the image in \p
+    /// image_filename, backed by a sidecar file next to the trace index.
+    AnalysisCache(const TracePair &trace, const std::string &image_filename);
+
+    AnalysisCache(const AnalysisCache &) = delete;
+    AnalysisCache &operator=(const AnalysisCache &) = delete;
+
+    /// Destruct this AnalysisCache, saving it if it has been modified.
+    ~AnalysisCache();
+
+    /// Is this AnalysisCache in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Get the name of the file backing this cache.
+    [[nodiscard]] const std::string &getFilename() const noexcept {
+        return filename;
+    }
+
+    /// Get the number of cached results.
+    [[nodiscard]] size_t size() const noexcept { return entries.size(); }
+
+    /// Get the cached result for \p query, or nullptr if it is not cached.
+    [[nodiscard]] const Entry *lookup(const std::string &query) const;
+
+    /// Cache result \p E for \p query.
+    void insert(const std::string &query, Entry E);
+
+    /// Save this cache to its file, if it has been modified. Returns false
+    /// in case of error.
+    bool save();
+
+    /// Get the name of the sidecar cache file for \p trace.
+    static std::string getCacheFilename(const TracePair &trace);
+
+    /// Compute the key for the trace in \p tarmac_filename and the image in
+    /// \p image_filename. The image content is hashed entirely, but only the
+    /// size, modification time, head and tail of the (usually huge) trace
+    /// are.
+    static uint64_t getKey(const std::string &tarmac_filename,
+                           const std::string &image_filename);
+
+  private:
+    std::string filename;
+    uint64_t key;
+    std::map<std::string, Entry> entries;
+    const char *errstr = nullptr;
+    bool modified = false;
+
+    /// Load the cache content from our file.
+    void load();
+};
+
+} // namespace PAF
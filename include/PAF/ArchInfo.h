@@ -27,6 +27,7 @@
 #include <cassert>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -212,14 +213,25 @@ class ArchInfo {
     /// How many registers does this processor have ?
     [[nodiscard]] virtual unsigned numRegisters() const = 0;
 
+    /// Get the size in bytes of this processor's registers.
+    [[nodiscard]] virtual unsigned registerSize() const = 0;
+
     /// Get this register name.
     [[nodiscard]] virtual const char *registerName(unsigned reg) const = 0;
     /// Get this register id.
     [[nodiscard]] virtual unsigned registerId(std::string name) const = 0;
+    /// Get the id of the register named \p name in this processor's register
+    /// bank, or RegisterAccess::UNKNOWN_ID if it is not part of it. Contrary
+    /// to registerId, this is not an error.
+    [[nodiscard]] virtual unsigned
+    findRegisterId(const std::string &name) const = 0;
 
     /// Is register named reg a status register for this CPU ?
     [[nodiscard]] virtual bool
     isStatusRegister(const std::string &reg) const = 0;
+    /// Is register \p reg (an id in the register bank) a status register for
+    /// this CPU ?
+    [[nodiscard]] virtual bool isStatusRegister(unsigned reg) const = 0;
 
     /// Get the InstrAttributes for instruction I.
     [[nodiscard]] virtual InstrInfo
@@ -245,6 +257,12 @@ class V7MInfo : public ArchInfo {
 
     /// Is register named reg a status register for this CPU ?
     [[nodiscard]] bool isStatusRegister(const std::string &reg) const override;
+    /// Is register \p reg (an id in the register bank) a status register for
+    /// this CPU ?
+    [[nodiscard]] bool isStatusRegister(unsigned reg) const override {
+        return reg == unsigned(Register::CPSR) ||
+               reg == unsigned(Register::PSR);
+    }
 
     /// ARMv7-M available registers.
     enum class Register {
@@ -274,10 +292,17 @@ class V7MInfo : public ArchInfo {
         return unsigned(Register::NUM_REGISTERS);
     }
 
+    /// Get the size in bytes of this architecture's registers.
+    [[nodiscard]] unsigned registerSize() const override { return 4; }
+
     /// Get this register name.
     [[nodiscard]] const char *registerName(unsigned reg) const override;
     /// Get this register id.
     [[nodiscard]] unsigned registerId(std::string name) const override;
+    /// Get the id of the register named \p name, or
+    /// RegisterAccess::UNKNOWN_ID if it is not part of the register bank.
+    [[nodiscard]] unsigned
+    findRegisterId(const std::string &name) const override;
 
     /// Get this register name.
     static const char *name(Register reg);
@@ -317,16 +342,25 @@ class V8AInfo : public ArchInfo {
 
     /// Is register named reg a status register for this CPU ?
     [[nodiscard]] bool isStatusRegister(const std::string &reg) const override;
+    /// Is register \p reg (an id in the register bank) a status register for
+    /// this CPU ?
+    [[nodiscard]] bool isStatusRegister(unsigned reg) const override;
 
     /// ARMv8-A available registers.
     enum class Register { NUM_REGISTERS = 0 };
 
     /// How many registers does this architecture have ?
     [[nodiscard]] unsigned numRegisters() const override;
+    /// Get the size in bytes of this architecture's registers.
+    [[nodiscard]] unsigned registerSize() const override { return 8; }
     /// Get this register name.
     [[nodiscard]] const char *registerName(unsigned reg) const override;
     /// Get this register id.
     [[nodiscard]] unsigned registerId(std::string name) const override;
+    /// Get the id of the register named \p name, or
+    /// RegisterAccess::UNKNOWN_ID if it is not part of the register bank.
+    [[nodiscard]] unsigned
+    findRegisterId(const std::string &name) const override;
     /// Get this register name.
     static const char *name(Register reg);
 
@@ -349,6 +383,49 @@ class V8AInfo : public ArchInfo {
     }
 };
 
+/// The InstrInfoCache class caches the InstrInfo decoded by an ArchInfo.
+///
+/// The decoded attributes only depend on the instruction set, width and
+/// encoding of an instruction, and traces are dominated by a small static
+/// instruction footprint, so that most instructions only need a lookup. The
+/// cache is an open addressing hash table, and is not thread safe: each
+/// thread is expected to use its own cache.
+class InstrInfoCache {
+  public:
+    /// Construct an InstrInfoCache for \p CPU, with an initial room for \p
+    /// capacity instructions (rounded up to a power of 2).
+    InstrInfoCache(const ArchInfo &CPU, size_t capacity = 1024);
+
+    /// Get the InstrInfo for instruction \p I, decoding it if this is the
+    /// first time this instruction is seen. The reference remains valid until
+    /// the next call to get or clear.
+    const InstrInfo &get(const ReferenceInstruction &I);
+
+    /// Get the number of instructions in the cache.
+    [[nodiscard]] size_t size() const { return count; }
+
+    /// Remove all instructions from the cache.
+    void clear();
+
+    /// Get the ArchInfo used for decoding the instructions.
+    [[nodiscard]] const ArchInfo &getArchInfo() const { return cpu; }
+
+  private:
+    // The InstrInfo is only constructed when the slot gets used.
+    struct Slot {
+        uint64_t key{0};
+        std::optional<InstrInfo> info;
+    };
+    std::vector<Slot> slots;
+    size_t count{0};
+    const ArchInfo &cpu;
+
+    // Get the slot where key is, or should be, stored.
+    size_t find(uint64_t key) const;
+    // Double the number of slots.
+    void grow();
+};
+
 std::unique_ptr<ArchInfo> getCPU(const IndexReader &index);
 
 } // namespace PAF
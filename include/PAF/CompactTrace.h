@@ -0,0 +1,427 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/PAF.h"
+#include "PAF/utils/Stats.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace PAF {
+
+/// The SmallVector class is a minimal vector of trivially copyable elements,
+/// with inline storage for up to N elements: no memory allocation is
+/// performed as long as it holds at most N elements.
+template <class Ty, size_t N> class SmallVector {
+    static_assert(std::is_trivially_copyable<Ty>::value &&
+                      std::is_trivially_destructible<Ty>::value,
+                  "SmallVector elements must be trivially copyable");
+    static_assert(N > 0, "SmallVector needs some inline storage");
+
+  public:
+    /// Construct an empty SmallVector.
+    SmallVector() noexcept {}
+    /// Copy constructor.
+    SmallVector(const SmallVector &Other) { assign(Other); }
+    /// Move constructor.
+    SmallVector(SmallVector &&Other) noexcept { steal(Other); }
+    /// Destructor.
+    ~SmallVector() { release(); }
+
+    /// Copy assignment.
+    SmallVector &operator=(const SmallVector &Other) {
+        if (this != &Other) {
+            count = 0;
+            assign(Other);
+        }
+        return *this;
+    }
+    /// Move assignment.
+    SmallVector &operator=(SmallVector &&Other) noexcept {
+        if (this != &Other) {
+            release();
+            steal(Other);
+        }
+        return *this;
+    }
+
+    /// Get the number of elements in this SmallVector.
+    [[nodiscard]] size_t size() const noexcept { return count; }
+    /// Is this SmallVector empty ?
+    [[nodiscard]] bool empty() const noexcept { return count == 0; }
+    /// Get the number of elements this SmallVector can hold without
+    /// allocating memory.
+    [[nodiscard]] size_t capacity() const noexcept { return cap; }
+    /// Are the elements stored inline (i.e. not on the heap) ?
+    [[nodiscard]] bool isInline() const noexcept { return cap == N; }
+    /// Get the memory allocated on the heap for the elements, in bytes.
+    [[nodiscard]] size_t heapBytes() const noexcept {
+        return isInline() ? 0 : cap * sizeof(Ty);
+    }
+
+    /// Get a pointer to the elements.
+    [[nodiscard]] Ty *data() noexcept {
+        return isInline() ? reinterpret_cast<Ty *>(storage.local)
+                          : storage.heap;
+    }
+    /// Get a pointer to the elements.
+    [[nodiscard]] const Ty *data() const noexcept {
+        return isInline() ? reinterpret_cast<const Ty *>(storage.local)
+                          : storage.heap;
+    }
+
+    /// Iterator to the first element.
+    [[nodiscard]] Ty *begin() noexcept { return data(); }
+    /// Iterator past the last element.
+    [[nodiscard]] Ty *end() noexcept { return data() + count; }
+    /// Iterator to the first element.
+    [[nodiscard]] const Ty *begin() const noexcept { return data(); }
+    /// Iterator past the last element.
+    [[nodiscard]] const Ty *end() const noexcept { return data() + count; }
+
+    /// Get the i-th element.
+    Ty &operator[](size_t i) noexcept { return data()[i]; }
+    /// Get the i-th element.
+    const Ty &operator[](size_t i) const noexcept { return data()[i]; }
+
+    /// Remove all elements (the storage is kept).
+    void clear() noexcept { count = 0; }
+
+    /// Reserve storage for at least \p n elements.
+    void reserve(size_t n) {
+        if (n <= cap)
+            return;
+        Ty *p = static_cast<Ty *>(std::malloc(n * sizeof(Ty)));
+        if (p == nullptr)
+            throw std::bad_alloc();
+        if (count)
+            std::memcpy(static_cast<void *>(p), data(), count * sizeof(Ty));
+        release();
+        storage.heap = p;
+        cap = n;
+    }
+
+    /// Append \p elt.
+    void push_back(const Ty &elt) {
+        if (count == cap)
+            grow(elt);
+        else
+            new (data() + count) Ty(elt);
+        count += 1;
+    }
+
+    /// Insert \p elt before \p pos and return an iterator to it.
+    Ty *insert(const Ty *pos, const Ty &elt) {
+        const size_t i = pos - begin();
+        push_back(elt);
+        Ty *p = data();
+        if (i + 1 < count) {
+            std::memmove(static_cast<void *>(p + i + 1), p + i,
+                         (count - i - 1) * sizeof(Ty));
+            p[i] = elt;
+        }
+        return p + i;
+    }
+
+  private:
+    union Storage {
+        Storage() noexcept {}
+        Ty *heap;
+        alignas(Ty) unsigned char local[N * sizeof(Ty)];
+    } storage;
+    uint32_t count = 0;
+    uint32_t cap = N;
+
+    // Grow the storage, appending elt which may well be one of our elements.
+    void grow(const Ty &elt) {
+        const Ty copy(elt);
+        reserve(2 * cap);
+        new (data() + count) Ty(copy);
+    }
+
+    void assign(const SmallVector &Other) {
+        reserve(Other.count);
+        if (Other.count)
+            std::memcpy(static_cast<void *>(data()), Other.data(),
+                        Other.count * sizeof(Ty));
+        count = Other.count;
+    }
+
+    void steal(SmallVector &Other) noexcept {
+        std::memcpy(static_cast<void *>(&storage), &Other.storage,
+                    sizeof(storage));
+        count = Other.count;
+        cap = Other.cap;
+        Other.count = 0;
+        Other.cap = N;
+    }
+
+    void release() noexcept {
+        if (!isInline())
+            std::free(storage.heap);
+        cap = N;
+    }
+};
+
+/// SmallVector equality.
+template <class Ty, size_t N>
+bool operator==(const SmallVector<Ty, N> &LHS, const SmallVector<Ty, N> &RHS) {
+    if (LHS.size() != RHS.size())
+        return false;
+    for (size_t i = 0; i < LHS.size(); i++)
+        if (!(LHS[i] == RHS[i]))
+            return false;
+    return true;
+}
+
+/// SmallVector inequality.
+template <class Ty, size_t N>
+bool operator!=(const SmallVector<Ty, N> &LHS, const SmallVector<Ty, N> &RHS) {
+    return !(LHS == RHS);
+}
+
+/// The StringTable class interns strings, so that identical strings are
+/// stored only once and can be referred to by a small identifier.
+class StringTable {
+  public:
+    /// Construct an empty StringTable.
+    StringTable() = default;
+    StringTable(const StringTable &) = delete;
+    StringTable &operator=(const StringTable &) = delete;
+    /// Move constructor.
+    StringTable(StringTable &&) = default;
+    /// Move assignment.
+    StringTable &operator=(StringTable &&) = default;
+
+    /// Get the identifier of string \p s, adding it to the table if needed.
+    uint32_t intern(std::string_view s);
+
+    /// Get the string with identifier \p id.
+    const std::string &operator[](uint32_t id) const { return strings[id]; }
+
+    /// Get the number of strings in the table.
+    [[nodiscard]] size_t size() const { return strings.size(); }
+
+    /// Remove all strings from the table.
+    void clear() {
+        ids.clear();
+        strings.clear();
+    }
+
+    /// Get an estimate of the memory used by this StringTable, in bytes.
+    [[nodiscard]] size_t memoryUsage() const {
+        size_t size = sizeof(*this) + ids.bucket_count() * sizeof(void *) +
+                      ids.size() * (sizeof(*ids.begin()) + sizeof(void *));
+        for (const std::string &s : strings)
+            size += sizeof(s) + s.capacity();
+        return size;
+    }
+
+  private:
+    // The strings are held in a deque so that the views used as keys remain
+    // valid when more strings are added.
+    std::deque<std::string> strings;
+    std::unordered_map<std::string_view, uint32_t> ids;
+};
+
+/// The CompactMemoryAccess class is the compact representation of a
+/// MemoryAccess used in a CompactTrace.
+struct CompactMemoryAccess {
+    Addr addr;           ///< The access address.
+    uint64_t value;      ///< The value read or written.
+    uint8_t size;        ///< The access size in bytes.
+    Access::Type access; ///< The access direction.
+
+    /// Construct a CompactMemoryAccess from MemoryAccess \p M.
+    CompactMemoryAccess(const MemoryAccess &M)
+        : addr(M.addr), value(M.value), size(uint8_t(M.size)),
+          access(M.access) {}
+
+    /// Get the MemoryAccess this CompactMemoryAccess represents.
+    [[nodiscard]] MemoryAccess get() const {
+        return {size, addr, value, access};
+    }
+
+    /// Equality operator, which (like MemoryAccess's) does not consider the
+    /// access value.
+    bool operator==(const CompactMemoryAccess &RHS) const {
+        return addr == RHS.addr && size == RHS.size && access == RHS.access;
+    }
+};
+
+/// The CompactRegisterAccess class is the compact representation of a
+/// RegisterAccess used in a CompactTrace: the register is represented by its
+/// identifier in the trace's register names table.
+struct CompactRegisterAccess {
+    uint64_t value;      ///< The value read or written.
+    uint16_t reg;        ///< The register identifier.
+    Access::Type access; ///< The access direction.
+
+    /// Construct a CompactRegisterAccess for register \p reg from
+    /// RegisterAccess \p R.
+    CompactRegisterAccess(uint16_t reg, const RegisterAccess &R)
+        : value(R.value), reg(reg), access(R.access) {}
+
+    /// Equality operator, which (like RegisterAccess's) does not consider the
+    /// access value.
+    bool operator==(const CompactRegisterAccess &RHS) const {
+        return reg == RHS.reg && access == RHS.access;
+    }
+};
+
+/// The CompactInstruction class is the compact representation of a
+/// ReferenceInstruction used in a CompactTrace. The disassembly is held in
+/// the trace's string table, and the first few memory and register accesses
+/// are stored inline, so that most instructions do not need any memory
+/// allocation.
+struct CompactInstruction {
+    /// The number of memory accesses stored inline.
+    static constexpr size_t INLINE_MEMORY_ACCESSES = 1;
+    /// The number of register accesses stored inline.
+    static constexpr size_t INLINE_REGISTER_ACCESSES = 2;
+
+    /// The time at which the instruction was executed.
+    Time time;
+    /// The program counter for this instruction.
+    Addr pc;
+    /// This instruction's encoding.
+    uint32_t instruction;
+    /// This instruction's disassembly identifier in the trace string table.
+    uint32_t disassembly;
+    /// This instruction's width.
+    uint8_t width;
+    /// This instruction's execution effect (an InstructionEffect).
+    uint8_t effect;
+    /// This instruction's instruction set (an ISet).
+    uint8_t iset;
+    /// Memory accesses performed by this instruction, sorted as in
+    /// ReferenceInstruction.
+    SmallVector<CompactMemoryAccess, INLINE_MEMORY_ACCESSES> memAccess;
+    /// Register accesses performed by this instruction, sorted as in
+    /// ReferenceInstruction.
+    SmallVector<CompactRegisterAccess, INLINE_REGISTER_ACCESSES> regAccess;
+
+    /// Was this instruction executed ?
+    [[nodiscard]] bool executed() const {
+        return InstructionEffect(effect) == IE_EXECUTED;
+    }
+
+    /// Compare this instruction's static values (pc, opcode, ...) with
+    /// ReferenceInstruction \p I's, like ReferenceInstruction::operator==.
+    [[nodiscard]] bool sameStatic(const ReferenceInstruction &I) const {
+        return pc == I.pc && ISet(iset) == I.iset && width == I.width &&
+               instruction == I.instruction;
+    }
+};
+
+/// The CompactTrace class holds a sequence of instructions in a compact
+/// form, for the tools which need to keep whole traces in memory. The
+/// instructions disassembly and register names are interned, and are thus
+/// stored only once per trace.
+class CompactTrace {
+  public:
+    /// Construct an empty CompactTrace.
+    CompactTrace() = default;
+    CompactTrace(const CompactTrace &) = delete;
+    CompactTrace &operator=(const CompactTrace &) = delete;
+    /// Move constructor.
+    CompactTrace(CompactTrace &&) = default;
+    /// Move assignment.
+    CompactTrace &operator=(CompactTrace &&) = default;
+
+    /// Append instruction \p I to this trace.
+    void add(const ReferenceInstruction &I);
+
+    /// Append instruction \p I to this trace. This allows using a
+    /// CompactTrace as the continuation of a FromTraceBuilder.
+    void operator()(const ReferenceInstruction &I) { add(I); }
+
+    /// Get the number of instructions in this trace.
+    [[nodiscard]] size_t size() const { return instructions.size(); }
+    /// Is this trace empty ?
+    [[nodiscard]] bool empty() const { return instructions.empty(); }
+
+    /// Get the i-th instruction in its compact form.
+    const CompactInstruction &operator[](size_t i) const {
+        return instructions[i];
+    }
+
+    /// Iterator to the first instruction.
+    [[nodiscard]] auto begin() const { return instructions.begin(); }
+    /// Iterator past the last instruction.
+    [[nodiscard]] auto end() const { return instructions.end(); }
+
+    /// Get the i-th instruction as a ReferenceInstruction.
+    [[nodiscard]] ReferenceInstruction get(size_t i) const;
+
+    /// Get instruction \p I's disassembly.
+    [[nodiscard]] const std::string &
+    disassembly(const CompactInstruction &I) const {
+        return disassemblies[I.disassembly];
+    }
+
+    /// Get the name of the register accessed by \p R.
+    [[nodiscard]] const std::string &
+    registerName(const CompactRegisterAccess &R) const {
+        return registers[R.reg];
+    }
+
+    /// Reserve storage for \p n instructions.
+    void reserve(size_t n) { instructions.reserve(n); }
+
+    /// Remove all instructions from this trace.
+    void clear() {
+        instructions.clear();
+        disassemblies.clear();
+        registers.clear();
+    }
+
+    /// Get the memory used by this trace, in bytes, including the storage
+    /// reserved for growth.
+    [[nodiscard]] size_t memoryUsage() const {
+        size_t size = sizeof(instructions) +
+                      instructions.capacity() * sizeof(CompactInstruction);
+        for (const CompactInstruction &I : instructions)
+            size += I.memAccess.heapBytes() + I.regAccess.heapBytes();
+        return size + disassemblies.memoryUsage() + registers.memoryUsage();
+    }
+
+  private:
+    /// The instructions, whose storage is accounted to the PAF subsystem in
+    /// the Stats.
+    std::vector<CompactInstruction,
+                TrackingAllocator<CompactInstruction, Stats::MEM_PAF>>
+        instructions;
+    StringTable disassemblies;
+    StringTable registers;
+};
+
+} // namespace PAF
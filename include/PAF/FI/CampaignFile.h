@@ -0,0 +1,132 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/FI/Fault.h"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace PAF::FI {
+
+/// The BinaryCampaignReader class reads the campaign files saved in the
+/// binary format by InjectionCampaign::dumpBinary.
+///
+/// The binary format is meant for the very large campaigns: the faults are
+/// stored as fixed size records, so that any subset of them, for example a
+/// shard, can be read without parsing the whole file. All values are little
+/// endian. The file is made of:
+///  - a 64 bytes header: the "PAF-FIC" magic string (8 bytes, NUL
+///    terminated), the format version (u32), the fault model (u32: 0 for
+///    unknown, 1 for InstructionSkip, 2 for CorruptRegDef), the number of
+///    faults (u64), the offset and size of the metadata (u64 each), the
+///    offset of the string table (u64), the offset of the fault records
+///    (u64) and the offset of the fault keys (u64, 0 if the faults are not
+///    keyed);
+///  - the metadata: the campaign description (image, reference trace,
+///    injection ranges, oracle, ...) in the same YAML format as the text
+///    campaign files, without the faults;
+///  - the string table: the number of strings (u32), followed by each
+///    string length (u32) and characters;
+///  - the shard cuts table: the number of cuts (u64) followed by the indices
+///    (u64) of the faults starting a new injection range;
+///  - the fault records, 64 bytes each: the Id, time, address, weight and
+///    breakpoint address (u64 each), the instruction, breakpoint count,
+///    disassembly string index and model specific value (u32 each: the
+///    faulted instruction for InstructionSkip, the faulted register string
+///    index for CorruptRegDef), the instruction width (u16), the flags (u8:
+///    bit 0 if there is a breakpoint, bit 1 if the instruction was
+///    executed), the effect (u8: a FaultModelBase::Effect, i.e. 0 if the
+///    fault has not been classified) and, for CorruptRegDef, the corruption
+///    pattern (u8: a CorruptRegDef::Pattern), register width, number of
+///    random bits and variant (u8 each). These last 4 bytes are 0 for the
+///    other fault models;
+///  - the fault keys, if any: one u64 per fault record, in the same order.
+///
+/// The fault families are expanded: each of their variants has its own
+/// record.
+class BinaryCampaignReader {
+  public:
+    /// The magic string at the start of the binary campaign files.
+    static constexpr char MAGIC[8] = "PAF-FIC";
+    /// The current version of the format.
+    static constexpr uint32_t VERSION = 1;
+    /// The header size.
+    static constexpr size_t HEADER_SIZE = 64;
+    /// The size of a fault record.
+    static constexpr size_t RECORD_SIZE = 64;
+
+    /// Open binary campaign file \p filename.
+    explicit BinaryCampaignReader(const std::string &filename);
+
+    /// Is this BinaryCampaignReader in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Does file \p filename look like a binary campaign file ?
+    static bool isBinaryCampaign(const std::string &filename);
+
+    /// Get the fault model name, as used in the text files.
+    [[nodiscard]] const char *getFaultModelName() const;
+
+    /// Get the campaign metadata, in YAML format.
+    [[nodiscard]] const std::string &getMetadata() const noexcept {
+        return metadata;
+    }
+
+    /// Get the number of faults in the campaign.
+    [[nodiscard]] size_t size() const noexcept { return numFaults; }
+
+    /// Split the faults into \p K shards, balanced according to \p By, exactly
+    /// as InjectionCampaign::getShards would.
+    [[nodiscard]] std::vector<InjectionCampaign::Shard>
+    getShards(unsigned K, InjectionCampaign::ShardBy By =
+                              InjectionCampaign::ShardBy::FAULT_ID) const;
+
+    /// Read the faults of shard \p S, appending them to \p faults. Returns
+    /// false in case of error.
+    bool read(const InjectionCampaign::Shard &S,
+              std::vector<std::unique_ptr<FaultModelBase>> &faults);
+
+    /// Read fault \p i, or return nullptr in case of error.
+    std::unique_ptr<FaultModelBase> read(size_t i);
+
+  private:
+    std::ifstream file;
+    std::string metadata;
+    std::vector<std::string> strings;
+    std::vector<size_t> cuts;
+    uint64_t numFaults = 0;
+    uint64_t recordsOffset = 0;
+    uint64_t keysOffset = 0;
+    uint32_t faultModel = 0;
+    const char *errstr = nullptr;
+
+    /// Decode the fault record in \p buf.
+    std::unique_ptr<FaultModelBase> decode(const unsigned char *buf);
+};
+
+} // namespace PAF::FI
@@ -22,6 +22,7 @@
 
 #include "Oracle.h"
 
+#include <algorithm>
 #include <cctype>
 #include <memory>
 #include <ostream>
@@ -62,6 +63,17 @@ struct BreakPoint {
 /// The FaultModelBase class is a base class for all other fault models.
 class FaultModelBase {
   public:
+    /// The effect of a fault, once it has been classified. The values are
+    /// the ones stored in the binary campaign files.
+    enum class Effect : uint8_t {
+        NONE,     ///< The fault has not been classified yet.
+        SUCCESS,  ///< The fault had the effect the attacker was looking for.
+        CRASH,    ///< The program crashed.
+        NOEFFECT, ///< The fault had no effect on the program.
+        CAUGHT,   ///< The fault was detected by the program.
+        UNDECIDED ///< The fault effect could not be decided.
+    };
+
     /// Construct a FaultModelBase.
     FaultModelBase(unsigned long Time, uint64_t Address, uint32_t Instruction,
                    unsigned Width, const std::string &Disassembly)
@@ -71,17 +83,38 @@ class FaultModelBase {
     FaultModelBase(const FaultModelBase &F)
         : disassembly(F.disassembly), id(F.id), time(F.time),
           address(F.address), instruction(F.instruction), width(F.width),
-          bpInfo(nullptr) {
+          weight(F.weight), key(F.key), effect(F.effect), bpInfo(nullptr) {
         if (F.hasBreakpoint())
             bpInfo = std::make_unique<BreakPoint>(*F.bpInfo);
     }
     virtual ~FaultModelBase();
 
+    /// The faults are allocated with the tracking allocation functions, so
+    /// that the memory used by a campaign is accounted to the FI subsystem
+    /// in the Stats.
+    static void *operator new(size_t size);
+    /// Release a fault allocated with the tracking allocation function.
+    static void operator delete(void *p, size_t size) noexcept;
+
     /// Get the fault model name used for this fault.
     [[nodiscard]] virtual const char *getFaultModelName() const = 0;
 
     /// Set this fault's Id.
     void setId(unsigned long i) { id = i; }
+    /// Get this fault's Id.
+    [[nodiscard]] unsigned long getId() const { return id; }
+    /// Get the time at which to inject this fault.
+    [[nodiscard]] unsigned long getTime() const { return time; }
+    /// Get the address of the faulted instruction.
+    [[nodiscard]] uint64_t getAddress() const { return address; }
+    /// Get the original instruction opcode.
+    [[nodiscard]] uint32_t getInstruction() const { return instruction; }
+    /// Get the faulted instruction width.
+    [[nodiscard]] unsigned getWidth() const { return width; }
+    /// Get the original instruction disassembly.
+    [[nodiscard]] const std::string &getDisassembly() const {
+        return disassembly;
+    }
 
     /// Set this fault's BreakPoint.
     void setBreakpoint(uint64_t Addr, unsigned Cnt) {
@@ -89,9 +122,46 @@ class FaultModelBase {
     }
     /// Does this fault have its BreakPoint information set ?
     [[nodiscard]] bool hasBreakpoint() const { return bpInfo != nullptr; }
+    /// Get this fault's BreakPoint, or nullptr if it is not set.
+    [[nodiscard]] const BreakPoint *getBreakpoint() const {
+        return bpInfo.get();
+    }
 
-    /// Dump this fault to os.
-    virtual void dump(std::ostream &os) const;
+    /// Set the number of faults this fault stands for, when it is the
+    /// representative of a class of equivalent faults.
+    void setWeight(unsigned long w) { weight = w; }
+    /// Get the number of faults this fault stands for.
+    [[nodiscard]] unsigned long getWeight() const { return weight; }
+
+    /// Set this fault's effect.
+    void setEffect(Effect e) { effect = e; }
+    /// Get this fault's effect, or Effect::NONE if it has not been
+    /// classified.
+    [[nodiscard]] Effect getEffect() const { return effect; }
+    /// Get the name of effect \p e, as used in the campaign files, or
+    /// nullptr for Effect::NONE.
+    [[nodiscard]] static const char *getEffectName(Effect e);
+    /// Get the effect named \p name in the campaign files, or Effect::NONE
+    /// if there is no such effect.
+    [[nodiscard]] static Effect getEffect(const std::string &name);
+
+    /// Set this fault's key, which identifies it across rebuilds of the
+    /// program, in order to reuse the results of a previous campaign. A key
+    /// of 0 means this fault is not keyed.
+    void setKey(uint64_t k) { key = k; }
+    /// Get the key of variant \p v of this fault, or 0 if it is not keyed.
+    [[nodiscard]] uint64_t getKey(unsigned v = 0) const;
+
+    /// Get the number of faults this fault stands for. A fault family, e.g.
+    /// all the single bit flips of a register, is held as a single fault and
+    /// only expanded into its variants when the campaign is saved. The
+    /// variants get consecutive Ids, starting at this fault's Id.
+    [[nodiscard]] virtual unsigned getNumVariants() const { return 1; }
+
+    /// Dump this fault (its first variant) to os.
+    virtual void dump(std::ostream &os) const { dump(os, 0); }
+    /// Dump variant \p v of this fault to os.
+    virtual void dump(std::ostream &os, unsigned v) const;
 
   protected:
     std::string disassembly; ///< The original instruction, disassembled.
@@ -100,6 +170,9 @@ class FaultModelBase {
     uint64_t address;        ///< The address of the instruction.
     uint32_t instruction;    ///< The original instruction opcode.
     unsigned width;          ///< The instruction width.
+    unsigned long weight{1}; ///< The number of faults this one stands for.
+    uint64_t key{0};         ///< This fault's key, if any.
+    Effect effect{Effect::NONE};        ///< This fault's effect.
     std::unique_ptr<BreakPoint> bpInfo; ///< Breakpoint information.
 };
 
@@ -120,8 +193,14 @@ class InstructionSkip : public FaultModelBase {
         return "InstructionSkip";
     }
 
-    /// Dump this fault to os.
-    void dump(std::ostream &os) const override;
+    /// Get the faulted instruction.
+    [[nodiscard]] uint32_t getFaultedInstr() const { return faultedInstr; }
+    /// Was the original instruction executed ?
+    [[nodiscard]] bool isExecuted() const { return executed; }
+
+    using FaultModelBase::dump;
+    /// Dump variant \p v of this fault to os.
+    void dump(std::ostream &os, unsigned v) const override;
 
   private:
     uint32_t faultedInstr; ///< The faulted instruction.
@@ -131,8 +210,29 @@ class InstructionSkip : public FaultModelBase {
 /// The CorruptRegDef class is a fault model where an instruction's output
 /// register is overwritten by a value (0 , -1 or random, depending on the
 /// precise fault model)
+///
+/// A CorruptRegDef can also stand for a family of faults, where each variant
+/// corrupts the register with a specific pattern: the faulted value is
+/// <tt>(value & andMask) ^ xorMask</tt>.
 class CorruptRegDef : public FaultModelBase {
   public:
+    /// The register corruption patterns.
+    enum class Pattern : uint8_t {
+        /// A single fault, with the value chosen when running the campaign.
+        VALUE,
+        /// Each variant flips one bit of the register.
+        BIT_FLIP,
+        /// Each variant sets one byte of the register to 0xFF.
+        BYTE_SET,
+        /// Each variant resets one byte of the register.
+        BYTE_RESET,
+        /// Each variant flips a number of distinct, randomly chosen, bits.
+        RANDOM_BITS
+    };
+
+    /// The maximum number of variants in a fault family.
+    static constexpr unsigned MAX_VARIANTS = 256;
+
     /// Construct a CorruptRegDef.
     CorruptRegDef(unsigned long Time, uint64_t Address, uint32_t Instruction,
                   unsigned Width, const std::string &Disassembly,
@@ -149,11 +249,56 @@ class CorruptRegDef : public FaultModelBase {
         return "CorruptRegDef";
     }
 
-    /// Dump this fault to os.
-    void dump(std::ostream &os) const override;
+    /// Get the faulted register name.
+    [[nodiscard]] const std::string &getFaultedReg() const {
+        return faultedReg;
+    }
+
+    /// Make this fault the family of corruptions of a \p RegWidth bits
+    /// register with pattern \p P. With Pattern::RANDOM_BITS, the family has
+    /// \p Count variants (at most MAX_VARIANTS), each flipping \p NumBits
+    /// bits. The random patterns only depend on the fault time and the
+    /// variant, so that they can be regenerated from a campaign file.
+    CorruptRegDef &setPattern(Pattern P, unsigned RegWidth,
+                              unsigned NumBits = 1, unsigned Count = 1);
+    /// Restrict this fault family to its variant \p v.
+    CorruptRegDef &setVariant(unsigned v) {
+        firstVariant += v;
+        numVariants = 1;
+        return *this;
+    }
+
+    /// Get the corruption pattern.
+    [[nodiscard]] Pattern getPattern() const { return pattern; }
+    /// Get the width in bits of the faulted register.
+    [[nodiscard]] unsigned getRegWidth() const { return regWidth; }
+    /// Get the number of bits flipped by the Pattern::RANDOM_BITS variants.
+    [[nodiscard]] unsigned getNumBits() const { return numBits; }
+    /// Get the index of variant \p v in the complete family.
+    [[nodiscard]] unsigned getVariant(unsigned v) const {
+        return firstVariant + v;
+    }
+    /// Get the number of faults this fault stands for.
+    [[nodiscard]] unsigned getNumVariants() const override {
+        return numVariants;
+    }
+    /// Get the masks variant \p v applies to the register.
+    void getMasks(unsigned v, uint64_t &andMask, uint64_t &xorMask) const;
+
+    /// Get the name of pattern \p P, as used in the campaign files.
+    [[nodiscard]] static const char *getPatternName(Pattern P);
+
+    using FaultModelBase::dump;
+    /// Dump variant \p v of this fault to os.
+    void dump(std::ostream &os, unsigned v) const override;
 
   private:
-    std::string faultedReg; ///< The faulted register
+    std::string faultedReg;          ///< The faulted register
+    Pattern pattern{Pattern::VALUE}; ///< The corruption pattern.
+    unsigned regWidth{0};            ///< The faulted register width.
+    unsigned numBits{0};             ///< The number of random bits flipped.
+    unsigned firstVariant{0};        ///< The first variant of the family.
+    unsigned numVariants{1};         ///< The number of variants.
 };
 
 /// The InjectionRangeInfo class describes the range under fault injection.
@@ -166,6 +311,21 @@ class InjectionRangeInfo {
         : name(Name), startTime(StartTime), endTime(EndTime),
           startAddress(StartAddress & ~1UL), endAddress(EndAddress & ~1UL) {}
 
+    /// Does this injection range contain time \p t ?
+    [[nodiscard]] bool contains(unsigned long t) const {
+        return startTime <= t && t <= endTime;
+    }
+    /// Get this injection range name.
+    [[nodiscard]] const std::string &getName() const { return name; }
+    /// Get the cycle at which this injection range starts.
+    [[nodiscard]] unsigned long getStartTime() const { return startTime; }
+    /// Get the cycle at which this injection range ends.
+    [[nodiscard]] unsigned long getEndTime() const { return endTime; }
+    /// Get the address at which this injection range starts.
+    [[nodiscard]] uint64_t getStartAddress() const { return startAddress; }
+    /// Get the address at which this injection range ends.
+    [[nodiscard]] uint64_t getEndAddress() const { return endAddress; }
+
     /// Dump this FunctionInfo to os.
     void dump(std::ostream &os) const;
 
@@ -189,6 +349,41 @@ class InjectionRangeInfo {
 /// them.
 class InjectionCampaign {
   public:
+    /// The output formats.
+    enum class Format {
+        /// A human readable YAML file.
+        YAML,
+        /// A compact binary file, see BinaryCampaignReader.
+        BINARY
+    };
+
+    /// A shard is a contiguous subset of the faults of a campaign, with Ids
+    /// in [begin, end). The fault families are expanded, i.e. a shard may
+    /// only contain some of the variants of a family.
+    struct Shard {
+        size_t begin; ///< The Id of the first fault in this shard.
+        size_t end;   ///< One past the Id of the last fault in this shard.
+        /// Get the number of faults in this shard.
+        [[nodiscard]] size_t size() const { return end - begin; }
+        /// Is this shard empty ?
+        [[nodiscard]] bool empty() const { return begin == end; }
+        /// Equality comparison.
+        bool operator==(const Shard &Other) const {
+            return begin == Other.begin && end == Other.end;
+        }
+        /// Inequality comparison.
+        bool operator!=(const Shard &Other) const { return !(*this == Other); }
+    };
+
+    /// How the faults are split into shards.
+    enum class ShardBy {
+        /// Balance the number of faults in each shard.
+        FAULT_ID,
+        /// Balance the number of faults in each shard, but never split the
+        /// faults of an injection range over several shards.
+        INJECTION_RANGE
+    };
+
     /// Construct an InjectionCampaign.
     InjectionCampaign(const std::string &Image,
                       const std::string &ReferenceTrace,
@@ -207,28 +402,76 @@ class InjectionCampaign {
         return *this;
     }
 
-    /// Add a Fault to this InjectionCampaign.
+    /// Add a Fault, or a fault family, to this InjectionCampaign.
     InjectionCampaign &addFault(FaultModelBase *F) {
         faults.push_back(std::unique_ptr<FaultModelBase>(F));
-        faults.back()->setId(faults.size() - 1);
+        faults.back()->setId(numFaults);
+        numFaults += F->getNumVariants();
         return *this;
     }
 
     /// Add an Oracle to this InjectionCampaign.
     void addOracle(Oracle &&O) { theOracle = std::move(O); }
 
+    /// Get the number of faults in this InjectionCampaign, with the fault
+    /// families expanded.
+    [[nodiscard]] size_t size() const { return numFaults; }
+    /// Get the fault, or the fault family, with Id i.
+    [[nodiscard]] const FaultModelBase &getFault(size_t i) const {
+        return *faults[find(i)];
+    }
+    /// Get the shard with all faults.
+    [[nodiscard]] Shard all() const { return {0, numFaults}; }
+
+    /// Get the index of the injection range fault i belongs to, or -1 if
+    /// it is in none of them.
+    [[nodiscard]] size_t getInjectionRange(size_t i) const;
+
+    /// Get the indices of the faults starting a new injection range, i.e.
+    /// the places where a shard can be cut when sharding by injection range.
+    [[nodiscard]] std::vector<size_t> getInjectionRangeCuts() const;
+
+    /// Split the faults into \p K shards, balanced according to \p By. Some
+    /// shards may be empty, for example when there are less injection
+    /// ranges than shards.
+    [[nodiscard]] std::vector<Shard>
+    getShards(unsigned K, ShardBy By = ShardBy::FAULT_ID) const;
+
+    /// Split \p numFaults faults into \p K shards, only cutting at the
+    /// fault indices listed in \p cuts (in increasing order), or anywhere if
+    /// \p cuts is nullptr.
+    [[nodiscard]] static std::vector<Shard>
+    getShards(size_t numFaults, unsigned K,
+              const std::vector<size_t> *cuts = nullptr);
+
     /// Dump all faults to os.
-    void dumpCampaign(std::ostream &os) const;
+    void dumpCampaign(std::ostream &os) const { dumpCampaign(os, all()); }
+    /// Dump the faults of shard S to os.
+    void dumpCampaign(std::ostream &os, const Shard &S) const;
     /// Dump the fault model to os.
     void dumpFaultModel(std::ostream &os) const;
     /// Dump the complete campaign to file FileName.
-    void dumpToFile(const std::string &FileName) const;
+    void dumpToFile(const std::string &FileName) const {
+        dumpToFile(FileName, Format::YAML, all());
+    }
+    /// Dump the campaign, restricted to the faults of shard S, in format F
+    /// to file FileName. Returns false in case of error.
+    bool dumpToFile(const std::string &FileName, Format F,
+                    const Shard &S) const;
     /// Dump the complete campaign to os.
-    void dump(std::ostream &os) const;
+    void dump(std::ostream &os) const { dump(os, all()); }
+    /// Dump the campaign, restricted to the faults of shard S, to os.
+    void dump(std::ostream &os, const Shard &S) const;
+    /// Dump everything but the faults of this campaign to os.
+    void dumpHeader(std::ostream &os) const;
+    /// Dump the campaign, restricted to the faults of shard S, in the
+    /// binary format to os.
+    void dumpBinary(std::ostream &os, const Shard &S) const;
 
   private:
     std::vector<std::unique_ptr<FaultModelBase>>
         faults;                       ///< The faults to inject.
+    size_t numFaults{0};              ///< The number of expanded faults.
     const std::string image;          ///< The ELF image filename.
     const std::string referenceTrace; ///< The reference tarmac file.
     std::vector<InjectionRangeInfo>
@@ -237,6 +480,25 @@ class InjectionCampaign {
     uint64_t programEntryAddress;     ///< The program entry address.
     uint64_t programEndAddress;       ///< The PC at maximum trace time.
     Oracle theOracle; ///< The oracles to run to classify faults.
+
+    /// Get the index in faults of the fault with Id i.
+    [[nodiscard]] size_t find(size_t i) const;
+
+    /// Call fn(F, v) for each variant v of each fault F in shard S, in Id
+    /// order.
+    template <class Fn> void forEachFault(const Shard &S, Fn fn) const {
+        if (S.begin >= S.end)
+            return;
+        for (size_t i = find(S.begin);
+             i < faults.size() && faults[i]->getId() < S.end; i++) {
+            const FaultModelBase &F = *faults[i];
+            const size_t first = F.getId();
+            const size_t e =
+                std::min<size_t>(F.getNumVariants(), S.end - first);
+            for (size_t v = S.begin > first ? S.begin - first : 0; v < e; v++)
+                fn(F, unsigned(v));
+        }
+    }
 };
 
 } // namespace PAF::FI
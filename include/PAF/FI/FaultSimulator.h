@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/ArchInfo.h"
+#include "PAF/FI/Fault.h"
+#include "PAF/PAF.h"
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace PAF::FI {
+
+/// The FaultSimulator class classifies faults by replaying, on a shadow
+/// state, the reference instructions which follow their injection point.
+///
+/// The faulted state is tracked as its difference to the reference state,
+/// i.e. as the registers which have a different value in the faulted
+/// execution. An instruction which does not read any of these registers
+/// behaves exactly as in the reference execution, and its outputs replace
+/// the faulted values. Otherwise, the instruction is emulated on the faulted
+/// values, which is only supported for the 16-bit Thumb data processing
+/// instructions and conditional branches. A fault has no effect once its
+/// difference to the reference state vanishes.
+///
+/// Everything else (memory accesses with a faulted address or value,
+/// control flow divergences, instructions which can not be emulated, a
+/// difference surviving more than the window instructions) hands the fault
+/// over to the real model: it is left unclassified.
+///
+/// Only the Arm v7-M architecture is supported.
+class FaultSimulator {
+  public:
+    /// The default number of instructions a fault is simulated for.
+    static constexpr unsigned DEFAULT_WINDOW = 64;
+
+    /// Construct a FaultSimulator for \p CPU, which simulates each fault for
+    /// at most \p Window instructions.
+    FaultSimulator(const ArchInfo &CPU, unsigned Window = DEFAULT_WINDOW);
+
+    /// Can faults be simulated on \p CPU ?
+    static bool isSupported(const ArchInfo &CPU);
+
+    /// Forget the reference state. The faults being simulated are handed
+    /// over to the model.
+    void reset();
+
+    /// Set the reference value of register \p r (an id in the register bank
+    /// of the CPU) before the next instruction to be replayed.
+    void setRegister(unsigned r, uint64_t value);
+
+    /// Start simulating fault \p F, which replaces reference instruction \p I
+    /// with a NOP. This must be called before I is replayed.
+    void skip(FaultModelBase &F, const ReferenceInstruction &I);
+
+    /// Start simulating fault \p F, which overwrites register \p r with \p
+    /// value once reference instruction \p I has been executed. This must be
+    /// called before I is replayed.
+    void corrupt(FaultModelBase &F, const ReferenceInstruction &I, unsigned r,
+                 uint64_t value = 0);
+
+    /// Replay reference instruction \p I.
+    void step(const ReferenceInstruction &I);
+
+    /// Hand all faults still being simulated over to the model.
+    void flush();
+
+    /// Get the number of faults classified so far.
+    [[nodiscard]] size_t getNumClassified() const { return numClassified; }
+
+    /// Get the number of faults handed over to the model so far.
+    [[nodiscard]] size_t getNumHandedOver() const { return numHandedOver; }
+
+  private:
+    // A fault being simulated, with the registers where the faulted state
+    // differs from the reference one.
+    struct Simulation {
+        FaultModelBase *fault;
+        std::map<unsigned, uint32_t> diff;
+        unsigned remaining;
+    };
+
+    const ArchInfo &cpu;
+    InstrInfoCache instrInfos;
+    const unsigned window;
+    // The reference register values, if known.
+    std::vector<uint32_t> regs;
+    std::vector<bool> known;
+    // The number of instructions left in the current IT block.
+    unsigned itRemaining{0};
+    std::vector<Simulation> active;
+    std::vector<Simulation> starting;
+    size_t numClassified{0};
+    size_t numHandedOver{0};
+
+    // Start simulation S, or classify it right away if there is no
+    // difference.
+    void start(Simulation &&S);
+    // Get the id of the register accessed by Reg, with the status
+    // registers merged.
+    [[nodiscard]] unsigned registerId(const RegisterAccess &Reg) const;
+    // Get the registers instruction I reads.
+    void getInputs(const ReferenceInstruction &I,
+                   std::vector<unsigned> &inputs);
+    // Replay instruction I, which reads some registers of S's difference, on
+    // S. Returns false if I can not be emulated.
+    bool emulate(Simulation &S, const ReferenceInstruction &I) const;
+    // Get register r's value in simulation S.
+    bool get(const Simulation &S, unsigned r, uint32_t &value) const;
+};
+
+} // namespace PAF::FI
@@ -0,0 +1,227 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/FI/CampaignFile.h"
+#include "PAF/FI/Fault.h"
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace PAF::FI {
+
+/// The CampaignResultsReader class streams the results of the faults of a
+/// campaign file, which can be in the binary format or in the YAML format as
+/// saved by the PAF tools (faulter, run-model.py, campaign.py), i.e. with
+/// one fault per line. Only the fields needed to aggregate the results are
+/// decoded, and the faults are read one at a time, so that arbitrarily large
+/// campaigns can be processed.
+class CampaignResultsReader {
+  public:
+    /// A fault's result.
+    struct Result {
+        /// The fault Id.
+        uint64_t id;
+        /// The time the fault was injected at.
+        unsigned long time;
+        /// The faulted instruction address.
+        uint64_t address;
+        /// The number of faults this one stands for.
+        unsigned long weight;
+        /// The fault key, or 0.
+        uint64_t key;
+        /// The fault effect.
+        FaultModelBase::Effect effect;
+    };
+
+    /// Open campaign file \p filename.
+    explicit CampaignResultsReader(const std::string &filename);
+
+    /// Is this CampaignResultsReader in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Get the campaign injection ranges.
+    [[nodiscard]] const std::vector<InjectionRangeInfo> &
+    getInjectionRanges() const noexcept {
+        return ranges;
+    }
+
+    /// Read the next fault result into \p R. Returns false at the end of the
+    /// campaign, or in case of error.
+    bool next(Result &R);
+
+  private:
+    std::unique_ptr<BinaryCampaignReader> binary;
+    std::vector<std::unique_ptr<FaultModelBase>> faults;
+    size_t nextRecord = 0;
+    size_t nextFault = 0;
+    std::ifstream text;
+    std::vector<InjectionRangeInfo> ranges;
+    const char *errstr = nullptr;
+
+    /// Parse the injection ranges from the campaign metadata in \p is, up to
+    /// the start of the faults.
+    void parseMetadata(std::istream &is);
+};
+
+/// The CampaignResults class holds the effects of the keyed faults of a
+/// campaign which has been run, so that an incremental campaign can reuse
+/// them for the faults whose context did not change.
+class CampaignResults {
+  public:
+    /// Load the results of campaign file \p filename.
+    explicit CampaignResults(const std::string &filename);
+
+    /// Is this CampaignResults in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Get the number of fault results available.
+    [[nodiscard]] size_t size() const noexcept { return effects.size(); }
+
+    /// Get the effect of the fault with key \p key, or Effect::NONE if it is
+    /// not known.
+    [[nodiscard]] FaultModelBase::Effect lookup(uint64_t key) const {
+        const auto it = effects.find(key);
+        return it == effects.end() ? FaultModelBase::Effect::NONE : it->second;
+    }
+
+  private:
+    std::unordered_map<uint64_t, FaultModelBase::Effect> effects;
+    const char *errstr = nullptr;
+
+    /// Record that the fault with key \p key had effect \p e.
+    void add(uint64_t key, FaultModelBase::Effect e);
+};
+
+/// The ResultsIndex class aggregates the fault results of one or more
+/// campaigns (e.g. the shards of a campaign) by fault Id, by faulted
+/// instruction address, by injection range and by effect. Its size only
+/// depends on the number of faulted instructions and ranges, plus a byte
+/// per fault for the Id index.
+class ResultsIndex {
+  public:
+    /// The number of effects, i.e. the number of FaultModelBase::Effect.
+    static constexpr size_t NUM_EFFECTS =
+        size_t(FaultModelBase::Effect::UNDECIDED) + 1;
+
+    /// The number of faults with each effect, weighted by the number of
+    /// faults each one stands for. Effect::NONE counts the faults which
+    /// have not been run.
+    struct Counts {
+        std::array<uint64_t, NUM_EFFECTS> byEffect{};
+
+        /// Add \p weight faults with effect \p e.
+        void add(FaultModelBase::Effect e, uint64_t weight) {
+            byEffect[size_t(e)] += weight;
+        }
+        /// Get the number of faults with effect \p e.
+        [[nodiscard]] uint64_t get(FaultModelBase::Effect e) const {
+            return byEffect[size_t(e)];
+        }
+        /// Get the total number of faults.
+        [[nodiscard]] uint64_t total() const;
+    };
+
+    /// Read all fault results from campaign file \p filename. Returns false
+    /// in case of error, with the error message in \p error.
+    bool add(const std::string &filename, std::string &error);
+
+    /// The range of the faults which are outside of all injection ranges.
+    static constexpr size_t NO_RANGE = size_t(-1);
+
+    /// Add fault result \p R, from injection range \p range (an index in
+    /// getInjectionRanges(), or NO_RANGE).
+    void add(const CampaignResultsReader::Result &R, size_t range);
+
+    /// Get the injection ranges, from all campaigns added.
+    [[nodiscard]] const std::vector<InjectionRangeInfo> &
+    getInjectionRanges() const noexcept {
+        return ranges;
+    }
+
+    /// Get the counts over all faults.
+    [[nodiscard]] const Counts &getTotal() const noexcept { return total; }
+
+    /// Get the number of fault results.
+    [[nodiscard]] uint64_t size() const noexcept { return numResults; }
+
+    /// Get the effect of the fault with Id \p id, or Effect::NONE if it is
+    /// not known.
+    [[nodiscard]] FaultModelBase::Effect getEffect(uint64_t id) const {
+        return id < byId.size() && byId[id] != ABSENT
+                   ? FaultModelBase::Effect(byId[id])
+                   : FaultModelBase::Effect::NONE;
+    }
+
+    /// Get the Ids of the faults with effect \p e, in increasing order.
+    [[nodiscard]] std::vector<uint64_t>
+    getIds(FaultModelBase::Effect e) const;
+
+    /// Get the counts per faulted instruction address.
+    [[nodiscard]] const std::map<uint64_t, Counts> &byAddress() const noexcept {
+        return addresses;
+    }
+
+    /// Get the counts per injection range, indexed as getInjectionRanges().
+    [[nodiscard]] const std::vector<Counts> &byRange() const noexcept {
+        return rangeCounts;
+    }
+
+    /// Get the counts of the faults outside of all injection ranges.
+    [[nodiscard]] const Counts &getOutside() const noexcept { return outside; }
+
+    /// Get the counts per injection range (or NO_RANGE) and faulted
+    /// instruction address.
+    [[nodiscard]] const std::map<std::pair<size_t, uint64_t>, Counts> &
+    byRangeAndAddress() const noexcept {
+        return rangeAddresses;
+    }
+
+    /// Get the counts per function, i.e. per injection range name, without
+    /// its invocation ("@N") and range (" - range N") suffixes.
+    [[nodiscard]] std::map<std::string, Counts> byFunction() const;
+
+  private:
+    std::vector<InjectionRangeInfo> ranges;
+    Counts total;
+    uint64_t numResults = 0;
+    // The effect of each fault, by Id, or ABSENT.
+    static constexpr uint8_t ABSENT = 0xFF;
+    std::vector<uint8_t> byId;
+    std::map<uint64_t, Counts> addresses;
+    std::vector<Counts> rangeCounts;
+    Counts outside;
+    std::map<std::pair<size_t, uint64_t>, Counts> rangeAddresses;
+};
+
+} // namespace PAF::FI
@@ -28,7 +28,8 @@
 #include <initializer_list>
 #include <iostream>
 #include <iterator>
-#include <list>
+#include <set>
+#include <vector>
 
 namespace PAF {
 
@@ -153,21 +154,30 @@ bool intersect(const Interval<Ty> &I1, const Interval<Ty> &I2) {
 /// The Intervals class is a union of Interval elements.
 ///
 /// It performs all the necessary tasks when an Interval is inserted, like
-// merging it with an existing Interval.
+// merging it with an existing Interval. The disjoint Interval elements are
+// kept in a balanced tree ordered by their begin, so that insertions and
+// queries are O(log n).
 template <typename Ty> class Intervals {
+    /// Order Interval elements by their begin. As the elements held are
+    /// disjoint, this is a strict ordering of them.
+    struct ByBegin {
+        bool operator()(const Interval<Ty> &lhs,
+                        const Interval<Ty> &rhs) const {
+            return lhs.begin() < rhs.begin();
+        }
+    };
+    using Container = std::set<Interval<Ty>, ByBegin>;
+
   public:
     /// Construct an empty interval list.
     Intervals() : content() {}
     /// Construct an Intervals initialized with a single Interval.
-    Intervals(const Interval<Ty> &I) : content() { content.push_back(I); }
+    Intervals(const Interval<Ty> &I) : content() { content.insert(I); }
     /// Construct an Intervals initialized with a single Interval.
-    Intervals(const Ty &B, const Ty &E) : content() {
-        content.emplace_back(B, E);
-    }
+    Intervals(const Ty &B, const Ty &E) : content() { content.emplace(B, E); }
     /// Construct an Intervals initialized from a list of Interval.
     Intervals(std::initializer_list<Interval<Ty>> il) : content() {
-        for (const auto &i : il)
-            insert(i);
+        insertAll(il.begin(), il.end());
     }
 
     /// Copy construct from another Intervals.
@@ -196,15 +206,16 @@ template <typename Ty> class Intervals {
     /// Do we have Interval elements at all ?
     [[nodiscard]] bool empty() const { return content.empty(); }
 
-    /// Iterator on the Interval elements in this Intervals.
-    using iterator = typename std::list<Interval<Ty>>::iterator;
+    /// Iterator on the Interval elements in this Intervals. The elements can
+    /// not be modified in place, as this would break the ordering.
+    using iterator = typename Container::iterator;
     /// Get an iterator to the first Interval of this Intervals.
     [[nodiscard]] iterator begin() { return content.begin(); }
     /// Get a past-the-end iterator to this object's Interval.
     [[nodiscard]] iterator end() { return content.end(); }
 
     /// Iterator (const version) on the Interval elements in this Intervals.
-    using const_iterator = typename std::list<Interval<Ty>>::const_iterator;
+    using const_iterator = typename Container::const_iterator;
     /// Get an iterator to the first Interval of this Intervals.
     [[nodiscard]] const_iterator begin() const { return content.begin(); }
     /// Get a past-the-end iterator to this object's Interval.
@@ -215,39 +226,19 @@ template <typename Ty> class Intervals {
     /// \note
     /// This keeps the list of interval sorted AND merges overlapping intervals
     void insert(const Interval<Ty> &e) {
-        if (content.empty()) {
-            content.push_back(e);
-            return;
+        Interval<Ty> merged(e);
+
+        // Only the Interval starting right before e may overlap it from the
+        // left, the others are overlapping it from the right, consecutively.
+        auto p = content.lower_bound(e);
+        if (p != content.begin() && std::prev(p)->intersect(merged))
+            p = std::prev(p);
+        while (p != content.end() && p->intersect(merged)) {
+            merged.merge(*p);
+            p = content.erase(p);
         }
 
-        auto p = std::upper_bound(
-            content.begin(), content.end(), e,
-            [](const Interval<Ty> &lhs, const Interval<Ty> &rhs) {
-                return lhs.begin() <= rhs.begin();
-            });
-
-        p = content.insert(p, e);
-
-        // Merge on the right as needed.
-        auto n = std::next(p);
-        while (n != content.end()) {
-            if (p->intersect(*n)) {
-                p->merge(*n);
-                content.erase(n);
-                n = std::next(p);
-            } else
-                break;
-        }
-
-        // Merge on the left as needed.
-        while (p != content.begin()) {
-            n = std::prev(p);
-            if (p->intersect(*n)) {
-                p->merge(*n);
-                content.erase(n);
-            } else
-                break;
-        }
+        content.insert(p, merged);
     }
     /// Insert Interval(B, E) into Intervals.
     ///
@@ -255,27 +246,53 @@ template <typename Ty> class Intervals {
     /// This keeps the list of interval sorted AND merges overlapping intervals
     void insert(const Ty &B, const Ty &E) { insert(Interval<Ty>(B, E)); }
 
+    /// Insert all Interval elements in [\p first, \p last(, which need
+    /// neither be sorted nor disjoint. This sorts and merges them all at
+    /// once, which is faster than inserting them one by one.
+    template <class InputIt> void insertAll(InputIt first, InputIt last) {
+        std::vector<Interval<Ty>> all(content.begin(), content.end());
+        const size_t numExisting = all.size();
+        all.insert(all.end(), first, last);
+        if (all.size() == numExisting)
+            return;
+        std::stable_sort(all.begin(), all.end(), ByBegin());
+
+        content.clear();
+        auto it = all.begin();
+        Interval<Ty> merged(*it);
+        for (++it; it != all.end(); ++it)
+            if (merged.intersect(*it))
+                merged.merge(*it);
+            else {
+                content.insert(content.end(), merged);
+                merged = *it;
+            }
+        content.insert(content.end(), merged);
+    }
+
     /// Clear all intervals.
     void clear() { content.clear(); }
 
     /// Returns true iff there exist an Interval in this Intervals that contains I.
     [[nodiscard]] bool contains(const Interval<Ty> &I) const {
-        for (const auto &e : content) {
-            // Intervals are sorted in ascending order, so skip all those that
-            // obviously can not intersect.
-            if (e.end() < I.begin())
-                continue;
-            if (e.begin() > I.end())
-                return false;
-            // There is some overlap, check if e contains I.
-            if (e.contains(I))
-                return true;
-        }
-        return false;
+        // Only the last Interval starting at or before I can contain it.
+        auto p = content.upper_bound(I);
+        if (p == content.begin())
+            return false;
+        return std::prev(p)->contains(I);
+    }
+
+    /// Returns true iff there exist an Interval in this Intervals that
+    /// intersects I.
+    [[nodiscard]] bool intersect(const Interval<Ty> &I) const {
+        auto p = content.upper_bound(I);
+        if (p != content.end() && p->intersect(I))
+            return true;
+        return p != content.begin() && std::prev(p)->intersect(I);
     }
 
   private:
-    std::list<Interval<Ty>> content;
+    Container content;
 };
 
 } // namespace PAF
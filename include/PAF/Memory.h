@@ -24,6 +24,13 @@
 
 #include "libtarmac/misc.hh"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 namespace PAF {
 
 /// The AccessedMemory class holds the information about all memory locations
@@ -60,4 +67,181 @@ class AccessedMemory {
     PAF::Intervals<Addr> intervals;
 };
 
+/// The ShadowMemory class tracks a state, one bit per byte, for a sparse
+/// address space, for example which memory locations have been initialized.
+///
+/// The bits are held in fixed size pages, which are allocated on the first
+/// mark of one of their bytes, so that marking and checking a memory access
+/// are constant time operations.
+///
+/// \note The last page looked up is cached, so a ShadowMemory can not be
+/// used concurrently, even for checking.
+class ShadowMemory {
+  public:
+    /// The log2 of the number of bytes tracked by a page.
+    static constexpr unsigned PAGE_BITS = 12;
+    /// The number of bytes tracked by a page.
+    static constexpr Addr PAGE_SIZE = Addr(1) << PAGE_BITS;
+
+    ShadowMemory() = default;
+    ShadowMemory(const ShadowMemory &) = delete;
+    ShadowMemory &operator=(const ShadowMemory &) = delete;
+
+    /// Mark the \p size bytes starting at \p address.
+    void mark(Addr address, size_t size) {
+        forEachChunk(address, size,
+                     [this](Addr pageNum, size_t begin, size_t end) {
+                         Page &P = getOrCreatePage(pageNum);
+                         forEachWord(begin, end, [&P](size_t w, WordTy mask) {
+                             P.words[w] |= mask;
+                             return true;
+                         });
+                         return true;
+                     });
+    }
+
+    /// Are all the \p size bytes starting at \p address marked ?
+    [[nodiscard]] bool isMarked(Addr address, size_t size) const {
+        return forEachChunk(
+            address, size, [this](Addr pageNum, size_t begin, size_t end) {
+                const Page *P = getPage(pageNum);
+                if (P == nullptr)
+                    return false;
+                return forEachWord(begin, end, [P](size_t w, WordTy mask) {
+                    return (P->words[w] & mask) == mask;
+                });
+            });
+    }
+
+    /// Unmark all bytes.
+    void reset() {
+        pages.clear();
+        lastPage = nullptr;
+    }
+
+    /// Get the number of pages allocated.
+    [[nodiscard]] size_t getNumPages() const { return pages.size(); }
+
+    /// Is any byte marked ?
+    [[nodiscard]] bool empty() const { return pages.empty(); }
+
+    /// Invoke \p f(begin, end) on each maximal [begin, end) range of marked
+    /// bytes, in increasing address order.
+    template <class FnTy> void forEachInterval(FnTy &&f) const {
+        std::vector<Addr> pageNums;
+        pageNums.reserve(pages.size());
+        for (const auto &p : pages)
+            pageNums.push_back(p.first);
+        std::sort(pageNums.begin(), pageNums.end());
+
+        bool inRange = false;
+        Addr begin = 0;
+        Addr next = 0; // The address following the last marked byte.
+        for (const Addr pageNum : pageNums) {
+            const Page &P = *pages.find(pageNum)->second;
+            const Addr pageAddr = pageNum << PAGE_BITS;
+            if (inRange && next != pageAddr) {
+                f(begin, next);
+                inRange = false;
+            }
+            for (size_t i = 0; i < PAGE_SIZE; i++) {
+                const WordTy word = P.words[i / WORD_BITS];
+                // Skip the words which are either empty or full.
+                if (i % WORD_BITS == 0 &&
+                    (word == 0 || word == ~WordTy(0))) {
+                    if (word != 0 && !inRange) {
+                        begin = pageAddr + i;
+                        inRange = true;
+                    } else if (word == 0 && inRange) {
+                        f(begin, pageAddr + i);
+                        inRange = false;
+                    }
+                    i += WORD_BITS - 1;
+                    continue;
+                }
+                const bool marked = (word >> (i % WORD_BITS)) & 1;
+                if (marked && !inRange) {
+                    begin = pageAddr + i;
+                    inRange = true;
+                } else if (!marked && inRange) {
+                    f(begin, pageAddr + i);
+                    inRange = false;
+                }
+            }
+            next = pageAddr + PAGE_SIZE;
+        }
+        if (inRange)
+            f(begin, next);
+    }
+
+  private:
+    using WordTy = uint64_t;
+    static constexpr size_t WORD_BITS = sizeof(WordTy) * 8;
+    static constexpr size_t WORDS_PER_PAGE = PAGE_SIZE / WORD_BITS;
+
+    struct Page {
+        WordTy words[WORDS_PER_PAGE] = {};
+    };
+
+    std::unordered_map<Addr, std::unique_ptr<Page>> pages;
+    // The last page looked up, if any.
+    mutable Addr lastPageNum = 0;
+    mutable Page *lastPage = nullptr;
+
+    [[nodiscard]] Page *getPage(Addr pageNum) const {
+        if (lastPage != nullptr && lastPageNum == pageNum)
+            return lastPage;
+        const auto it = pages.find(pageNum);
+        if (it == pages.end())
+            return nullptr;
+        lastPageNum = pageNum;
+        lastPage = it->second.get();
+        return lastPage;
+    }
+
+    Page &getOrCreatePage(Addr pageNum) {
+        if (Page *P = getPage(pageNum))
+            return *P;
+        auto &P = pages[pageNum];
+        P = std::make_unique<Page>();
+        lastPageNum = pageNum;
+        lastPage = P.get();
+        return *lastPage;
+    }
+
+    // Split the [address, address + size) range in per page chunks, invoking
+    // f(pageNum, begin, end) on each chunk, with [begin, end) the chunk range
+    // in the page, as long as f returns true. Returns false if f did.
+    template <class FnTy>
+    static bool forEachChunk(Addr address, size_t size, FnTy &&f) {
+        while (size != 0) {
+            const size_t begin = address & (PAGE_SIZE - 1);
+            const size_t n = std::min<size_t>(size, PAGE_SIZE - begin);
+            if (!f(address >> PAGE_BITS, begin, begin + n))
+                return false;
+            address += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    // Invoke f(word, mask) on each word covering the non empty [begin, end)
+    // bit range of a page, with mask selecting the range bits in that word,
+    // as long as f returns true. Returns false if f did.
+    template <class FnTy>
+    static bool forEachWord(size_t begin, size_t end, FnTy &&f) {
+        const size_t first = begin / WORD_BITS;
+        const size_t last = (end - 1) / WORD_BITS;
+        for (size_t w = first; w <= last; w++) {
+            const size_t lo = w == first ? begin % WORD_BITS : 0;
+            const size_t hi = w == last ? (end - 1) % WORD_BITS : WORD_BITS - 1;
+            const WordTy mask =
+                (~WordTy(0) >> (WORD_BITS - 1 - hi)) & (~WordTy(0) << lo);
+            if (!f(w, mask))
+                return false;
+        }
+        return true;
+    }
+};
+
 } // namespace PAF
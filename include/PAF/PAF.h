@@ -20,6 +20,10 @@
 
 #pragma once
 
+#include "PAF/utils/Parallel.h"
+#include "PAF/utils/SPSCRing.h"
+#include "PAF/utils/Stats.h"
+
 #include "libtarmac/calltree.hh"
 #include "libtarmac/index.hh"
 #include "libtarmac/parser.hh"
@@ -27,15 +31,22 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
 namespace PAF {
 
+class AnalysisCache;
+class ArchInfo;
+
 // Trim spaces and comments from input; accepts string or C-string.
 std::string trimSpacesAndComment(std::string_view str);
 
@@ -195,20 +206,27 @@ struct MemoryAccess : public Access {
 /// A register access can be a read or write of a specific value from / to a
 /// register.
 struct RegisterAccess : public Access {
+    /// The identifier used for the registers which are not (yet) known in the
+    /// register bank of the CPU.
+    static constexpr unsigned UNKNOWN_ID = -1U;
+
+    /// The register identifier in the CPU register bank (see
+    /// ArchInfo::findRegisterId), or UNKNOWN_ID.
+    unsigned id{UNKNOWN_ID};
     std::string name; ///< Name of the register that was accessed.
 
     /// Uninitialized RegisterAccess constructor.
     RegisterAccess() {}
-    /// Construct a RegisterAccess from a register name, a value and a
-    /// direction.
+    /// Construct a RegisterAccess from a register name, a value, a direction
+    /// and optionally the register identifier.
     RegisterAccess(const std::string &name, unsigned long long value,
-                   Access::Type direction)
-        : Access(value, direction), name(name) {}
+                   Access::Type direction, unsigned id = UNKNOWN_ID)
+        : Access(value, direction), id(id), name(name) {}
     /// Copy constructor.
     RegisterAccess(const RegisterAccess &) = default;
     /// Move constructor.
     RegisterAccess(RegisterAccess &&Other) noexcept
-        : Access(Other), name(std::move(Other.name)) {}
+        : Access(Other), id(Other.id), name(std::move(Other.name)) {}
 
     /// Constructor for a Tarmac Parser.
     RegisterAccess(const RegisterEvent &ev)
@@ -222,6 +240,7 @@ struct RegisterAccess : public Access {
     /// Move assignment operator.
     RegisterAccess &operator=(RegisterAccess &&Other) noexcept {
         Access::operator=(Other);
+        id = Other.id;
         name = std::move(Other.name);
         return *this;
     }
@@ -339,6 +358,35 @@ struct ReferenceInstruction {
         return *this;
     }
 
+    /// Reset this instruction to the one described by \p ev, without any
+    /// memory or register access. The storage of this instruction (e.g. the
+    /// capacity of its access vectors) is reused.
+    ReferenceInstruction &reset(const InstructionEvent &ev) {
+        disassembly.assign(trimSpacesAndComment(ev.disassembly));
+        memAccess.clear();
+        regAccess.clear();
+        time = ev.time;
+        pc = ev.pc;
+        effect = ev.effect;
+        iset = ev.iset;
+        width = ev.width;
+        instruction = ev.instruction;
+        return *this;
+    }
+
+    /// Reset this instruction to an empty one, reusing its storage.
+    void clear() {
+        disassembly.clear();
+        memAccess.clear();
+        regAccess.clear();
+        time = 0;
+        pc = 0;
+        effect = IE_EXECUTED;
+        iset = ARM;
+        width = 0;
+        instruction = 0;
+    }
+
     /// Compare 2 instructions for equality. This only takes into account the
     /// static values of this instructions (pc, opcode, ...) and not the runtime
     /// values (register values, memory addresses).
@@ -373,6 +421,16 @@ struct ReferenceInstruction {
     /// Was this instruction executed ?
     [[nodiscard]] bool executed() const { return effect == IE_EXECUTED; }
 
+    /// Get the memory used by this instruction, in bytes.
+    [[nodiscard]] size_t memoryUsage() const {
+        size_t size = sizeof(*this) + disassembly.capacity() +
+                      memAccess.capacity() * sizeof(MemoryAccess) +
+                      regAccess.capacity() * sizeof(RegisterAccess);
+        for (const RegisterAccess &R : regAccess)
+            size += R.name.capacity();
+        return size;
+    }
+
     /// Dump this instruction in a human readable form to OS.
     void dump(std::ostream &OS) const;
 };
@@ -405,22 +463,38 @@ class EmptyHandler {
 /// to build ReferenceInstruction from a Tarmac trace.
 class ReferenceInstructionBuilder {
   public:
+    /// Resolve the identifiers of the registers accessed in \p CPU's register
+    /// bank, once, when they are parsed. No identifiers are resolved if \p
+    /// CPU is nullptr.
+    void setArchInfo(const ArchInfo *CPU) { archInfo = CPU; }
+
     /// Handler for instruction events.
     void event(ReferenceInstruction &Instr, const InstructionEvent &ev) {
-        Instr = PAF::ReferenceInstruction(ev);
+        Instr.reset(ev);
     }
     /// Handler for memory events.
     void event(ReferenceInstruction &Instr, const MemoryEvent &ev) {
         Instr.add(PAF::MemoryAccess(ev));
     }
     /// Handler for register events.
-    void event(ReferenceInstruction &Instr, const RegisterEvent &ev) {
-        Instr.add(PAF::RegisterAccess(ev));
-    }
+    void event(ReferenceInstruction &Instr, const RegisterEvent &ev);
     /// Handler for instruction events.
     void event(ReferenceInstruction &Instr, const TextOnlyEvent &ev) {}
+
+  private:
+    const ArchInfo *archInfo = nullptr;
 };
 
+/// Reset instruction \p I before it is reused for the next instruction of a
+/// trace.
+template <typename InstructionTy> void recycle(InstructionTy &I) {
+    I = InstructionTy();
+}
+
+/// Reset ReferenceInstruction \p I before it is reused for the next
+/// instruction of a trace, keeping its storage.
+inline void recycle(ReferenceInstruction &I) { I.clear(); }
+
 /// The FromTraceBuilder class is used to build a trace from an on-disk tarmac
 /// trace file and its index file. This is what most normal applications will be
 /// using.
@@ -428,15 +502,27 @@ template <typename InstructionTy, typename EventHandlerTy = EmptyHandler,
           typename ContTy = EmptyCont>
 class FromTraceBuilder : public ParseReceiver, public EventHandlerTy {
   public:
+    /// The pipeline depth the tools use, see setPipelineDepth.
+    static constexpr size_t PIPELINE_DEPTH = 1024;
+
     /// Constructor.
     FromTraceBuilder(const IndexNavigator &IN)
-        : ParseReceiver(), idxNav(IN), curInstr() {}
+        : ParseReceiver(), idxNav(IN), instr(), curInstr(&instr) {}
+
+    /// Pipeline the replay: the trace is read and parsed by a separate
+    /// thread, which hands over the instructions to the continuation, on the
+    /// thread calling build, through a ring of \p depth recycled
+    /// instructions. The parsing thus overlaps with the continuation, which
+    /// must not use this builder's IndexNavigator (e.g. to look up register
+    /// values) as it is then used by the parsing thread. A \p depth of 0
+    /// (the default) disables pipelining, which is also not used when the
+    /// hardware only supports a single thread.
+    void setPipelineDepth(size_t depth) { pipelineDepth = depth; }
 
     /// Apply the builder on the ER execution range, with its start / end points
     /// optionally shifted by offsets.
     void build(const ExecutionRange &ER, ContTy &Cont, int StartOffset = 0,
                int EndOffset = 0) {
-        TarmacLineParser TLP(idxNav.index.isBigEndian(), *this);
         SeqOrderPayload SOP;
 
         // Find the end time, adjusted with the offset if any.
@@ -479,53 +565,185 @@ class FromTraceBuilder : public ParseReceiver, public EventHandlerTy {
             } while (StartOffset < 0);
         }
 
-        std::vector<std::string> Lines;
-        while (SOP.mod_time <= EndTime) {
-            Lines = idxNav.index.get_trace_lines(SOP);
-            curInstr = InstructionTy();
-            for (const std::string &line : Lines) {
-                try {
-                    TLP.parse(line);
-                } catch (TarmacParseError err) {
-                    reporter->errx(EXIT_FAILURE, "Parse error");
-                }
-            }
+        Stats::add(Stats::INDEX_LOOKUPS, 2);
 
-            Cont(curInstr);
-
-            if (!idxNav.get_next_node(SOP, &SOP))
-                break;
-        }
+        const uint64_t NumInstructions =
+            pipelineDepth != 0 && hardwareNumThreads() > 1
+                ? replayPipelined(SOP, EndTime, Cont)
+                : replay(SOP, EndTime, Cont);
+        Stats::add(Stats::INSTRUCTIONS_REPLAYED, NumInstructions);
     }
 
     /// Handler for instruction events generated by the Tarmac parser.
     void got_event(InstructionEvent &ev) override {
-        EventHandlerTy::event(curInstr, ev);
+        EventHandlerTy::event(*curInstr, ev);
     }
 
     /// Handler for register events generated by the Tarmac parser.
     void got_event(RegisterEvent &ev) override {
-        EventHandlerTy::event(curInstr, ev);
+        EventHandlerTy::event(*curInstr, ev);
     }
 
     /// Handler for memory events generated by the Tarmac parser.
     void got_event(MemoryEvent &ev) override {
-        EventHandlerTy::event(curInstr, ev);
+        EventHandlerTy::event(*curInstr, ev);
     }
 
     /// Handler for TextOnly events generated by the Tarmac parser.
     void got_event(TextOnlyEvent &ev) override {
-        EventHandlerTy::event(curInstr, ev);
+        EventHandlerTy::event(*curInstr, ev);
     }
 
   private:
     const IndexNavigator &idxNav;
-    InstructionTy curInstr;
+    InstructionTy instr;
+    // The instruction the parser events are delivered to.
+    InstructionTy *curInstr;
+    size_t pipelineDepth = 0;
+
+    // Parse the trace lines of node SOP into I.
+    void parse(TarmacLineParser &TLP, std::vector<std::string> &Lines,
+               const SeqOrderPayload &SOP, InstructionTy &I) {
+        Lines = idxNav.index.get_trace_lines(SOP);
+        recycle(I);
+        curInstr = &I;
+        for (const std::string &line : Lines) {
+            try {
+                TLP.parse(line);
+            } catch (TarmacParseError err) {
+                reporter->errx(EXIT_FAILURE, "Parse error");
+            }
+        }
+    }
+
+    // Replay the instructions from SOP up to EndTime into Cont, returning
+    // the number of instructions replayed.
+    uint64_t replay(SeqOrderPayload SOP, uint64_t EndTime, ContTy &Cont) {
+        TarmacLineParser TLP(idxNav.index.isBigEndian(), *this);
+        std::vector<std::string> Lines;
+        uint64_t NumInstructions = 0;
+        while (SOP.mod_time <= EndTime) {
+            parse(TLP, Lines, SOP, instr);
+            Cont(instr);
+            NumInstructions += 1;
+
+            if (!idxNav.get_next_node(SOP, &SOP))
+                break;
+        }
+        return NumInstructions;
+    }
+
+    // Same as replay, but with the instructions parsed by a separate thread.
+    // If Cont throws, the parsing thread is stopped before the exception is
+    // forwarded.
+    uint64_t replayPipelined(SeqOrderPayload SOP, uint64_t EndTime,
+                             ContTy &Cont) {
+        SPSCRing<InstructionTy> Ring(pipelineDepth);
+        std::thread Parser([&]() {
+            TarmacLineParser TLP(idxNav.index.isBigEndian(), *this);
+            std::vector<std::string> Lines;
+            while (SOP.mod_time <= EndTime) {
+                InstructionTy *I = Ring.acquire();
+                if (I == nullptr)
+                    break;
+                parse(TLP, Lines, SOP, *I);
+                Ring.publish();
+
+                if (!idxNav.get_next_node(SOP, &SOP))
+                    break;
+            }
+            Ring.close();
+        });
+
+        uint64_t NumInstructions = 0;
+        try {
+            while (InstructionTy *I = Ring.front()) {
+                Cont(*I);
+                Ring.release();
+                NumInstructions += 1;
+            }
+        } catch (...) {
+            Ring.cancel();
+            Parser.join();
+            throw;
+        }
+        Parser.join();
+        curInstr = &instr;
+        return NumInstructions;
+    }
 };
 
-/// The FromStreamBuilder class is used to build a trace from an in-memory
-/// stream, corresponding to a sequence of tarmac trace lines. This is mostly
-/// used for testing.
+/// The ParallelTraceBuilder class replays independent execution ranges
+/// concurrently, each of them with a FromTraceBuilder. The ranges are
+/// distributed dynamically on the threads, and the ranges replayed by a
+/// thread are replayed in order.
+///
+/// An IndexNavigator can not be shared between threads, so each thread gets
+/// its own from the navigator factory.
+template <typename InstructionTy, typename EventHandlerTy = EmptyHandler,
+          typename ContTy = EmptyCont>
+class ParallelTraceBuilder {
+  public:
+    /// The factory creating the IndexNavigator used by a thread.
+    using NavigatorFactory = std::function<std::unique_ptr<IndexNavigator>()>;
+    /// The factory returning the continuation for the i-th execution range.
+    using ContFactory = std::function<ContTy &(size_t)>;
+
+    /// Construct a ParallelTraceBuilder, which will use up to \p numThreads
+    /// threads (0 meaning defaultNumThreads()), getting their IndexNavigator
+    /// from \p makeNavigator.
+    ParallelTraceBuilder(NavigatorFactory makeNavigator,
+                         unsigned numThreads = 0)
+        : makeNavigator(std::move(makeNavigator)),
+          numThreads(numThreads != 0 ? numThreads : defaultNumThreads()) {}
+
+    /// Replay each of the execution ranges in \p ERS into the continuation
+    /// \p getCont returns for it. The continuations are used concurrently,
+    /// so they must not share any state. The calling thread takes part in the
+    /// replay, and build returns once all ranges have been replayed.
+    /// Exceptions thrown by the continuations are forwarded to the calling
+    /// thread.
+    void build(const std::vector<ExecutionRange> &ERS,
+               const ContFactory &getCont) const {
+        // The ranges are replayed on the shared ThreadPool. The navigators
+        // are recycled from one range to the next, so that at most one is
+        // created per thread.
+        std::mutex mtx;
+        std::vector<std::unique_ptr<IndexNavigator>> navigators;
+        parallelFor(
+            0, ERS.size(), 1,
+            [&](size_t b, size_t e) {
+                std::unique_ptr<IndexNavigator> IN;
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if (!navigators.empty()) {
+                        IN = std::move(navigators.back());
+                        navigators.pop_back();
+                    }
+                }
+                if (!IN)
+                    IN = makeNavigator();
+                FromTraceBuilder<InstructionTy, EventHandlerTy, ContTy> FTB(
+                    *IN);
+                for (size_t i = b; i < e; i++)
+                    FTB.build(ERS[i], getCont(i));
+                std::lock_guard<std::mutex> lock(mtx);
+                navigators.emplace_back(std::move(IN));
+            },
+            numThreads);
+    }
+
+  private:
+    NavigatorFactory makeNavigator;
+    const unsigned numThreads;
+};
+
+/// The FromStreamBuilder class is used to build a trace from a stream of
+/// tarmac trace lines, e.g. a pipe fed by a model plugin as the model runs,
+/// so that no intermediate trace file nor index is needed for one-shot
+/// analyses. Each instruction is passed to the continuation as soon as it is
+/// complete, i.e. when the next instruction starts or at the end of the
+/// stream.
 template <typename InstructionTy, typename EventHandlerTy = EmptyHandler,
           typename ContTy = EmptyCont>
 class FromStreamBuilder : public ParseReceiver, public EventHandlerTy {
@@ -538,6 +756,9 @@ class FromStreamBuilder : public ParseReceiver, public EventHandlerTy {
         TarmacLineParser TLP(isBigEndian, *this);
         std::string line;
 
+        cont = &Cont;
+        numInstructions = 0;
+        pending = false;
         while (std::getline(is, line)) {
             // Allow blank lines or comments in the input
             if (line.size() == 0 || line[0] == '#')
@@ -548,12 +769,23 @@ class FromStreamBuilder : public ParseReceiver, public EventHandlerTy {
                 reporter->errx(EXIT_FAILURE, "Parse error");
             }
         }
-        Cont(curInstr);
+        // The last instruction is complete. A stream without any instruction
+        // still gets its events delivered.
+        if (pending)
+            emit();
+        else if (numInstructions == 0)
+            Cont(curInstr);
+        cont = nullptr;
+        Stats::add(Stats::INSTRUCTIONS_REPLAYED, numInstructions);
     }
 
     /// Handler for instruction events generated by the Tarmac parser.
     void got_event(InstructionEvent &ev) override {
+        // A new instruction starts: the current one is complete.
+        if (pending)
+            emit();
         EventHandlerTy::event(curInstr, ev);
+        pending = true;
     }
 
     /// Handler for register events generated by the Tarmac parser.
@@ -574,6 +806,17 @@ class FromStreamBuilder : public ParseReceiver, public EventHandlerTy {
   private:
     std::istream &is;
     InstructionTy curInstr;
+    ContTy *cont = nullptr;
+    /// Has the current instruction not been passed to the continuation yet ?
+    bool pending = false;
+    /// The number of instructions passed to the continuation.
+    uint64_t numInstructions = 0;
+
+    void emit() {
+        (*cont)(curInstr);
+        curInstr = InstructionTy();
+        numInstructions += 1;
+    }
 };
 
 /// MTAnalyzer is a base class for all Tarmac analysis classes.
@@ -628,13 +871,42 @@ class MTAnalyzer {
     /// Get the value of register reg at time t.
     uint64_t getRegisterValueAtTime(const std::string &reg, Time t) const;
 
+    /// Get the values of registers \p regs at time \p t, with a single
+    /// index lookup.
+    std::vector<uint64_t>
+    getRegisterValuesAtTime(const std::vector<std::string> &regs,
+                            Time t) const;
+
+    /// Get the values of register \p reg at each of the times \p ts.
+    std::vector<uint64_t>
+    getRegisterValueAtTimes(const std::string &reg,
+                            const std::vector<Time> &ts) const;
+
     /// Get memory content at time t.
     std::vector<uint8_t> getMemoryValueAtTime(uint64_t address,
                                               size_t num_bytes, Time t) const;
 
+    /// Get the memory content of each of the (address, size) \p ranges at
+    /// time \p t, with a single index lookup.
+    std::vector<std::vector<uint8_t>> getMemoryValuesAtTime(
+        const std::vector<std::pair<uint64_t, size_t>> &ranges, Time t) const;
+
     /// Get the instruction which was processed at time t.
     bool getInstructionAtTime(ReferenceInstruction &I, Time t) const;
 
+    /// Get in \p S the site of the instruction \p offset instructions after
+    /// (or before if \p offset is negative) the instruction at time \p t.
+    /// This only navigates the index, without parsing the trace. The move
+    /// stops at the trace limits, in which case false is returned.
+    bool getSiteAtOffset(TarmacSite &S, Time t, int offset) const;
+
+    /// Get in \p sites the site of the instruction \p offset instructions
+    /// after (or before if \p offset is negative) each of the instructions
+    /// at times \p ts. Returns the number of moves which stopped at the trace
+    /// limits.
+    size_t getSitesAtOffset(std::vector<TarmacSite> &sites,
+                            const std::vector<Time> &ts, int offset) const;
+
     /// Get this Index CallTree and cache it for future uses as it is not
     /// invalidated.
     const CallTree &getCallTree() const {
@@ -643,6 +915,12 @@ class MTAnalyzer {
         return *callTree;
     }
 
+    /// Use \p cache to persist the results of the trace analyses
+    /// (getInstances, getCallSitesTo, getLabelPairs, getWLabels and
+    /// getBetweenFunctionMarkers) across runs. \p cache must outlive this
+    /// MTAnalyzer, or be reset to nullptr to stop caching.
+    void setAnalysisCache(AnalysisCache *cache) { analysisCache = cache; }
+
     /// Returns true if the underlying trace is big-endian.
     [[nodiscard]]
     bool isBigEndian() const {
@@ -655,6 +933,27 @@ class MTAnalyzer {
   private:
     mutable std::unique_ptr<CallTree> callTree;
     unsigned verbosityLevel;
+    AnalysisCache *analysisCache = nullptr;
+
+    /// Get \p query's result from the analysis cache into \p ranges (and
+    /// \p labels if not nullptr). Returns false if it is not cached.
+    bool lookupCache(
+        const std::string &query, std::vector<PAF::ExecutionRange> &ranges,
+        std::vector<std::pair<uint64_t, std::string>> *labels = nullptr) const;
+    /// Record \p query's result in the analysis cache, if any.
+    void updateCache(const std::string &query,
+                     const std::vector<PAF::ExecutionRange> &ranges,
+                     const std::vector<std::pair<uint64_t, std::string>>
+                         *labels = nullptr) const;
+
+    /// The number of recently visited index nodes to remember.
+    static constexpr size_t RECENT_NODES = 4;
+    /// The recently visited index nodes, most recent first. The point in
+    /// time queries are usually made several times at the same time.
+    mutable std::vector<std::pair<Time, SeqOrderPayload>> recentNodes;
+
+    /// Get the index node at time \p t, remembering it for the next queries.
+    SeqOrderPayload nodeAtTime(Time t) const;
 };
 
 } // namespace PAF
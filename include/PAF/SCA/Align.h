@@ -0,0 +1,94 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/SCA/NPArray.h"
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace PAF::SCA {
+
+/// The Aligner class aligns jittered traces on a reference pattern. The shift
+/// of each trace is the one which maximizes the (Pearson) correlation of the
+/// pattern with the trace samples, looked for in a window around the pattern
+/// position. The correlations for all shifts are computed at once with an
+/// FFT based cross-correlation, two traces at a time.
+class Aligner {
+  public:
+    /// Construct an Aligner for traces of \p num_samples samples, on the \p
+    /// length samples of the pattern at \p pattern, which sits at sample \p
+    /// position of the aligned traces. Shifts of up to \p max_shift samples,
+    /// in either direction, are considered, as long as the pattern remains
+    /// inside the traces.
+    Aligner(const double *pattern, size_t length, size_t position,
+            size_t max_shift, size_t num_samples);
+
+    /// Get the length of the reference pattern.
+    [[nodiscard]] size_t length() const noexcept { return patternLength; }
+
+    /// Get the number of samples of the traces.
+    [[nodiscard]] size_t samples() const noexcept { return numSamples; }
+
+    /// Get the shift of the trace at \p trace, i.e. the pattern is found at
+    /// sample position + shift of this trace.
+    [[nodiscard]] std::ptrdiff_t shift(const double *trace) const;
+
+    /// Get the shifts of the traces in rows [\p begin, \p end( of \p traces
+    /// into \p shifts.
+    void shifts(std::vector<std::ptrdiff_t> &shifts,
+                const NPArray<double> &traces, size_t begin,
+                size_t end) const;
+
+    /// Shift in place the \p n samples at \p row by \p shift samples, so
+    /// that row[i] becomes row[i + shift]. The samples shifted in from
+    /// outside of the row replicate the first or last sample.
+    static void align(double *row, size_t n, std::ptrdiff_t shift);
+
+  private:
+    const size_t patternLength;
+    const size_t numSamples;
+    size_t segmentBegin; ///< Where the searched segment starts in a trace.
+    size_t numShifts;    ///< The number of shifts in the search window.
+    size_t leftShifts;   ///< The number of negative shifts.
+    /// The conjugate of the reference pattern spectrum.
+    std::vector<std::complex<double>> reference;
+    std::vector<std::complex<double>> twiddles;
+    std::vector<size_t> reversed;
+
+    /// Compute in place the FFT (or inverse FFT, not scaled) of \p x.
+    void fft(std::complex<double> *x, bool inverse) const;
+
+    /// Find the shifts of the traces at \p trace0 and \p trace1 (which may be
+    /// nullptr), using the \p buf and \p corr scratch buffers.
+    void findShifts(std::ptrdiff_t &shift0, std::ptrdiff_t &shift1,
+                    const double *trace0, const double *trace1,
+                    std::vector<std::complex<double>> &buf,
+                    std::vector<std::complex<double>> &corr) const;
+
+    /// Get the best shift, from the correlations \p corr of the \p segment
+    /// samples with the pattern.
+    std::ptrdiff_t bestShift(const double *segment,
+                             const std::vector<double> &corr) const;
+};
+
+} // namespace PAF::SCA
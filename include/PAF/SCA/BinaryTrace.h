@@ -0,0 +1,332 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/PAF.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace PAF::SCA {
+
+/// The kind of side information held by a binary trace file.
+enum class BinaryTraceContent : uint8_t {
+    TIMING,          ///< Timing information (see TimingInfo).
+    INSTRUCTIONS,    ///< Instructions traces (see InstrDumper).
+    MEMORY_ACCESSES, ///< Memory accesses traces (see MemoryAccessesDumper).
+    REGISTER_BANK,   ///< Register bank traces (see RegBankDumper).
+};
+
+/// BinaryTraceRecord is the fixed size record binary trace files are made of.
+///
+/// A binary trace file is a sequence of records, all of the same size and
+/// stored in the host endianness, so that they can be read, skipped or
+/// searched without any parsing. The file starts with a HEADER record, and
+/// the TRACE records mark the start of each trace. Strings (the instructions
+/// disassembly) are stored only once, in STRING records which are emitted
+/// right before the first record which refers to them by their identifier.
+struct BinaryTraceRecord {
+    /// The record kinds.
+    enum Kind : uint8_t {
+        /// File header: a = MAGIC, u8 = the content, u16 = VERSION.
+        HEADER,
+        /// Start of a new trace.
+        TRACE,
+        /// A chunk of string \p u32, held in \p a, \p b and \p c, of \p u16
+        /// bytes.
+        STRING,
+        /// An instruction: a = time, b = pc, c = opcode, u32 = disassembly
+        /// string, u16 = width, u8 = effect (low nibble) and iset (high
+        /// nibble).
+        INSTRUCTION,
+        /// \p u16 (at most 3) register values, held in \p a, \p b and \p c,
+        /// starting from register \p u32.
+        REGISTERS,
+        /// A load: a = address, b = value, c = pc, u8 = size, u32 = index of
+        /// the instruction in the trace.
+        LOAD,
+        /// A store, with the same fields as a LOAD.
+        STORE,
+        /// An instruction timing: a = pc, b = cycle.
+        TIMING,
+        /// Timing statistics: a = minimum, b = maximum number of cycles.
+        STATS,
+        /// \p u16 (at most 3) changed register values, held in \p a, \p b
+        /// and \p c, with their indexes packed in \p u32 (10 bits each).
+        /// The first record of each register bank state has \p u8 set.
+        REGISTERS_DELTA,
+    };
+
+    /// The magic number identifying binary trace files ("PAFTRACE").
+    static constexpr uint64_t MAGIC = 0x4543415254464150ULL;
+    /// The format version.
+    static constexpr uint16_t VERSION = 1;
+
+    uint8_t kind; ///< This record's kind.
+    uint8_t u8;   ///< A small payload field.
+    uint16_t u16; ///< A small payload field.
+    uint32_t u32; ///< A medium payload field.
+    uint64_t a;   ///< A large payload field.
+    uint64_t b;   ///< A large payload field.
+    uint64_t c;   ///< A large payload field.
+
+    /// Construct a record of kind \p kind.
+    BinaryTraceRecord(Kind kind = TRACE, uint64_t a = 0, uint64_t b = 0,
+                      uint64_t c = 0)
+        : kind(kind), u8(0), u16(0), u32(0), a(a), b(b), c(c) {}
+};
+
+static_assert(sizeof(BinaryTraceRecord) == 32,
+              "Unexpected BinaryTraceRecord size");
+
+/// The BinaryTraceWriter class writes the records of a binary trace to a
+/// stream, optionally gzip compressed.
+class BinaryTraceWriter {
+  public:
+    /// Construct a BinaryTraceWriter that will write \p content to \p os
+    /// (nothing is written if \p os is nullptr). The output will be gzip
+    /// compressed if \p compressed is set.
+    BinaryTraceWriter(std::ostream *os, BinaryTraceContent content,
+                      bool compressed);
+
+    BinaryTraceWriter(const BinaryTraceWriter &) = delete;
+    BinaryTraceWriter &operator=(const BinaryTraceWriter &) = delete;
+
+    /// Destruct this BinaryTraceWriter, completing the output along the way.
+    ~BinaryTraceWriter();
+
+    /// Is this BinaryTraceWriter in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Prepare state for the next trace.
+    void nextTrace() { traceStarted = false; }
+
+    /// Emit the TRACE record for the current trace if this has not been done
+    /// yet. This allows lazily starting traces, so that the file does not end
+    /// with an empty trace.
+    void startTrace() {
+        if (!traceStarted) {
+            write(BinaryTraceRecord(BinaryTraceRecord::TRACE));
+            traceStarted = true;
+        }
+    }
+
+    /// Get the identifier of string \p s, emitting it first if needed.
+    uint32_t getStringId(const std::string &s);
+
+    /// Append the records describing instruction \p I (without its memory
+    /// accesses).
+    void writeInstruction(const ReferenceInstruction &I);
+
+    /// Append the records describing the register bank state \p regs.
+    void writeRegisters(const std::vector<uint64_t> &regs);
+
+    /// Append the records describing the register bank state \p regs, as the
+    /// registers which differ from the \p previous state. All registers are
+    /// recorded if \p previous does not have the same size as \p regs.
+    void writeRegistersDelta(const std::vector<uint64_t> &previous,
+                             const std::vector<uint64_t> &regs);
+
+    /// Append the records describing the memory accesses \p MA performed by
+    /// the instruction at \p pc, which is instruction \p index in the trace.
+    void writeMemoryAccesses(Addr pc, uint32_t index,
+                             const std::vector<MemoryAccess> &MA);
+
+    /// Append record \p R.
+    void write(const BinaryTraceRecord &R) {
+        if (os == nullptr)
+            return;
+        buffer.push_back(R);
+        if (buffer.size() >= BUFFER_SIZE)
+            flush(false);
+    }
+
+    /// Flush all records and complete the output. No record can be written
+    /// after the writer has been closed.
+    bool close();
+
+  private:
+    static constexpr size_t BUFFER_SIZE = 4096;
+    struct Compressor;
+
+    std::ostream *os;
+    std::unique_ptr<Compressor> compressor;
+    std::vector<BinaryTraceRecord> buffer;
+    std::unordered_map<std::string, uint32_t> strings;
+    const char *errstr = nullptr;
+    bool traceStarted = false;
+
+    /// Write the buffered records to the stream.
+    bool flush(bool last);
+};
+
+/// BinaryTraceReader is the base class for reading binary trace files, be
+/// they compressed or not.
+class BinaryTraceReader {
+  public:
+    /// Construct a BinaryTraceReader for file \p filename, which is expected
+    /// to hold \p content.
+    BinaryTraceReader(const std::string &filename, BinaryTraceContent content);
+
+    BinaryTraceReader(const BinaryTraceReader &) = delete;
+    BinaryTraceReader &operator=(const BinaryTraceReader &) = delete;
+
+    /// Destruct this BinaryTraceReader.
+    virtual ~BinaryTraceReader();
+
+    /// Is this BinaryTraceReader in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+  protected:
+    /// Get the next (non STRING) record without consuming it. Returns false
+    /// at the end of the file or in case of error.
+    bool peek(BinaryTraceRecord &R);
+
+    /// Get and consume the next (non STRING) record. Returns false at the end
+    /// of the file or in case of error.
+    bool next(BinaryTraceRecord &R) {
+        if (!peek(R))
+            return false;
+        pos += 1;
+        return true;
+    }
+
+    /// Get string \p id.
+    [[nodiscard]] const std::string &getString(uint32_t id) const;
+
+    /// Record an error.
+    bool fail(const char *msg) {
+        if (errstr == nullptr)
+            errstr = msg;
+        return false;
+    }
+
+  private:
+    void *file; // Our gzFile.
+    std::vector<BinaryTraceRecord> buffer;
+    size_t pos = 0;
+    std::vector<std::string> strings;
+    const char *errstr = nullptr;
+
+    /// Read the next records from the file.
+    bool fill();
+};
+
+/// BinaryTimingReader reads the timing information saved by a
+/// BinaryTimingInfo.
+class BinaryTimingReader : public BinaryTraceReader {
+  public:
+    /// Construct a BinaryTimingReader, reading all timing information from
+    /// file \p filename.
+    BinaryTimingReader(const std::string &filename);
+
+    /// Get the minimum number of cycles over all traces.
+    [[nodiscard]] size_t min() const { return cmin; }
+    /// Get the maximum number of cycles over all traces.
+    [[nodiscard]] size_t max() const { return cmax; }
+
+    /// Get the number of instructions in the timing information.
+    [[nodiscard]] size_t size() const { return pcCycle.size(); }
+
+    /// Get the (pc, cycle) of instruction \p i.
+    [[nodiscard]] const std::pair<Addr, uint64_t> &
+    operator[](size_t i) const {
+        return pcCycle[i];
+    }
+
+    /// Get the index of the instruction executing at \p cycle, i.e. the last
+    /// instruction starting at, or before, \p cycle. size() is returned when
+    /// no instruction has started yet.
+    [[nodiscard]] size_t instructionAt(uint64_t cycle) const;
+
+  private:
+    std::vector<std::pair<Addr, uint64_t>> pcCycle;
+    size_t cmin = 0;
+    size_t cmax = 0;
+};
+
+/// BinaryInstrReader reads, one trace at a time, the instructions traces
+/// saved by a BinaryInstrDumper.
+class BinaryInstrReader : public BinaryTraceReader {
+  public:
+    /// Construct a BinaryInstrReader for file \p filename.
+    BinaryInstrReader(const std::string &filename)
+        : BinaryTraceReader(filename, BinaryTraceContent::INSTRUCTIONS) {}
+
+    /// Read the next trace into \p instrs, and the register bank states
+    /// into \p regBanks if not nullptr (the states are empty if they were not
+    /// dumped). Returns false when there are no more traces or in case of
+    /// error.
+    bool nextTrace(std::vector<ReferenceInstruction> &instrs,
+                   std::vector<std::vector<uint64_t>> *regBanks = nullptr);
+};
+
+/// BinaryRegBankReader reads, one trace at a time, the register bank traces
+/// saved by a BinaryRegBankDumper.
+class BinaryRegBankReader : public BinaryTraceReader {
+  public:
+    /// Construct a BinaryRegBankReader for file \p filename.
+    BinaryRegBankReader(const std::string &filename)
+        : BinaryTraceReader(filename, BinaryTraceContent::REGISTER_BANK) {}
+
+    /// Read the next trace into \p states, with one complete register bank
+    /// state per instruction. Returns false when there are no more traces or
+    /// in case of error.
+    bool nextTrace(std::vector<std::vector<uint64_t>> &states);
+};
+
+/// BinaryMemoryAccessesReader reads, one trace at a time, the memory accesses
+/// traces saved by a BinaryMemoryAccessesDumper.
+class BinaryMemoryAccessesReader : public BinaryTraceReader {
+  public:
+    /// The memory accesses performed by an instruction.
+    struct Entry {
+        /// The index of the instruction in its trace.
+        size_t index;
+        /// The instruction program counter.
+        Addr pc;
+        /// The memory accesses.
+        std::vector<MemoryAccess> accesses;
+    };
+
+    /// Construct a BinaryMemoryAccessesReader for file \p filename.
+    BinaryMemoryAccessesReader(const std::string &filename)
+        : BinaryTraceReader(filename, BinaryTraceContent::MEMORY_ACCESSES) {}
+
+    /// Read the next trace into \p entries, one per instruction performing
+    /// memory accesses. Returns false when there are no more traces or in
+    /// case of error.
+    bool nextTrace(std::vector<Entry> &entries);
+};
+
+} // namespace PAF::SCA
@@ -20,11 +20,15 @@
 
 #pragma once
 
+#include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "PAF/PAF.h"
-#include "PAF/SCA/NPAdapter.h"
+#include "PAF/SCA/BinaryTrace.h"
+#include "PAF/SCA/NPYStreamWriter.h"
 
 namespace PAF::SCA {
 
@@ -74,11 +78,13 @@ class FilenameDumper {
 /// FileStreamDumper is a base class for dumping to a stream with a filename.
 class FileStreamDumper : public FilenameDumper {
   public:
-    /// Construct a FileStreamDumper associated with file \a filename.
-    FileStreamDumper(const std::string &filename)
+    /// Construct a FileStreamDumper associated with file \a filename, opened
+    /// with \a mode.
+    FileStreamDumper(const std::string &filename,
+                     std::ios_base::openmode mode = std::ofstream::out)
         : FilenameDumper(filename), os(nullptr) {
         if (!filename.empty())
-            os = new std::ofstream(filename.c_str(), std::ofstream::out);
+            os = new std::ofstream(filename.c_str(), mode);
     }
 
     /// Construct a FileStreamDumper associated with stream \a os.
@@ -161,32 +167,112 @@ class RegBankDumper : public Dumper {
 class NPYRegBankDumper : public RegBankDumper, public FilenameDumper {
   public:
     /// Construct an NPYRegBankDumper, assuming \a num_traces will be dumped.
-    /// The trace will be dumped to \a filename when this NPYRegBankDumper will
-    /// be destroyed.
-    NPYRegBankDumper(const std::string &filename, size_t num_traces)
-        : RegBankDumper(!filename.empty()), FilenameDumper(filename),
-          npyA(num_traces) {}
+    /// The traces are written to \a filename as they are produced, and the
+    /// file is completed when this NPYRegBankDumper is destroyed. The
+    /// registers are stored as uint32_t if \a registerSize is 4 (e.g. for a
+    /// 32-bit architecture, see ArchInfo::registerSize), and as uint64_t
+    /// otherwise.
+    NPYRegBankDumper(const std::string &filename, size_t num_traces,
+                     unsigned registerSize = 8)
+        : RegBankDumper(!filename.empty()), FilenameDumper(filename) {
+        if (!enabled())
+            return;
+        if (registerSize == 4)
+            npyW32 = std::make_unique<NPYStreamWriter<uint32_t>>(filename);
+        else
+            npyW64 = std::make_unique<NPYStreamWriter<uint64_t>>(filename);
+    }
 
     /// Update state when switching to next trace.
     void nextTrace() override {
-        if (enabled())
-            npyA.next();
+        if (npyW32)
+            npyW32->next();
+        if (npyW64)
+            npyW64->next();
     }
 
     /// Dump the register bank content.
-    void dump(const std::vector<uint64_t> &regs) override { npyA.append(regs); }
+    void dump(const std::vector<uint64_t> &regs) override {
+        if (npyW32)
+            for (const auto &r : regs)
+                npyW32->append(uint32_t(r));
+        if (npyW64)
+            npyW64->append(regs);
+    }
 
     /// Destruct this NPYRegBankDumper, saving the NPY file along the way.
     ~NPYRegBankDumper() override {
-        if (enabled()) {
-          // Intentionally ignore the return value.
-          static_cast<void>(npyA.save(filename));
-        }
+        // Intentionally ignore the return values.
+        if (npyW32)
+            static_cast<void>(npyW32->close());
+        if (npyW64)
+            static_cast<void>(npyW64->close());
+    }
+
+  private:
+    /// Our numpy writer for the register bank trace, with 32-bit registers.
+    std::unique_ptr<NPYStreamWriter<uint32_t>> npyW32;
+    /// Our numpy writer for the register bank trace, with 64-bit registers.
+    std::unique_ptr<NPYStreamWriter<uint64_t>> npyW64;
+};
+
+/// BinaryRegBankDumper is used to dump a trace of the register bank content in
+/// the binary trace format, which can be read back with a
+/// BinaryRegBankReader. Only the registers which have changed since the
+/// previous state are recorded.
+class BinaryRegBankDumper : public RegBankDumper, public FileStreamDumper {
+  public:
+    /// Construct a BinaryRegBankDumper that will dump its content to file \a
+    /// filename, gzip compressed if \a compressed is set.
+    BinaryRegBankDumper(const std::string &filename, bool compressed);
+
+    /// Construct a BinaryRegBankDumper that will dump its content to stream
+    /// \a os, gzip compressed if \a compressed is set.
+    BinaryRegBankDumper(std::ostream &os, bool compressed, bool enable = true);
+
+    /// Update state when switching to next trace.
+    void nextTrace() override {
+        writer.nextTrace();
+        previous.clear();
+    }
+
+    /// Dump the register bank content.
+    void dump(const std::vector<uint64_t> &regs) override;
+
+  private:
+    BinaryTraceWriter writer;
+    /// The previous register bank state in the current trace.
+    std::vector<uint64_t> previous;
+};
+
+/// BufferedRegBankDumper records a register bank trace in memory, so that it
+/// can later be replayed to another RegBankDumper.
+class BufferedRegBankDumper : public RegBankDumper {
+  public:
+    /// Construct a BufferedRegBankDumper.
+    BufferedRegBankDumper(bool enable) : RegBankDumper(enable) {}
+
+    /// Called at the beginning of a trace.
+    void preDump() override { started = true; }
+
+    /// Dump the register bank content.
+    void dump(const std::vector<uint64_t> &regs) override {
+        states.push_back(regs);
+    }
+
+    /// Replay the recorded register bank trace to \p D.
+    void replay(RegBankDumper &D) const {
+        if (!started || !D.enabled())
+            return;
+        D.preDump();
+        for (const auto &regs : states)
+            D.dump(regs);
+        D.postDump();
     }
 
   private:
-    /// Our numpy adapter to the register bank trace.
-    NPAdapter<uint64_t> npyA;
+    std::vector<std::vector<uint64_t>> states;
+    bool started = false;
 };
 
 /// MemoryAccessesDumper is used to dump a trace of memory accesses.
@@ -202,6 +288,36 @@ class MemoryAccessesDumper : public Dumper {
     ~MemoryAccessesDumper() override = default;
 };
 
+/// BufferedMemoryAccessesDumper records a trace of memory accesses in memory,
+/// so that it can later be replayed to another MemoryAccessesDumper.
+class BufferedMemoryAccessesDumper : public MemoryAccessesDumper {
+  public:
+    /// Construct a BufferedMemoryAccessesDumper.
+    BufferedMemoryAccessesDumper(bool enable) : MemoryAccessesDumper(enable) {}
+
+    /// Called at the beginning of a trace.
+    void preDump() override { started = true; }
+
+    /// Dump those memory accesses.
+    void dump(uint64_t PC, const std::vector<MemoryAccess> &MA) override {
+        accesses.emplace_back(PC, MA);
+    }
+
+    /// Replay the recorded memory accesses trace to \p D.
+    void replay(MemoryAccessesDumper &D) const {
+        if (!started || !D.enabled())
+            return;
+        D.preDump();
+        for (const auto &a : accesses)
+            D.dump(a.first, a.second);
+        D.postDump();
+    }
+
+  private:
+    std::vector<std::pair<uint64_t, std::vector<MemoryAccess>>> accesses;
+    bool started = false;
+};
+
 /// The FileMemoryAccessesDumper class will dump a trace of memory accesses to a
 /// file.
 class FileMemoryAccessesDumper : public MemoryAccessesDumper,
@@ -238,6 +354,36 @@ class YAMLMemoryAccessesDumper : public MemoryAccessesDumper,
     void dump(uint64_t PC, const std::vector<MemoryAccess> &MA) override;
 };
 
+/// The BinaryMemoryAccessesDumper class will dump a trace of memory accesses to
+/// a file in the binary trace format, which can be read back with a
+/// BinaryMemoryAccessesReader.
+class BinaryMemoryAccessesDumper : public MemoryAccessesDumper,
+                                   public FileStreamDumper {
+  public:
+    /// Construct a BinaryMemoryAccessesDumper that will dump its content to
+    /// file \a filename, gzip compressed if \a compressed is set.
+    BinaryMemoryAccessesDumper(const std::string &filename, bool compressed);
+
+    /// Construct a BinaryMemoryAccessesDumper that will dump its content to
+    /// stream \a os, gzip compressed if \a compressed is set.
+    BinaryMemoryAccessesDumper(std::ostream &os, bool compressed,
+                               bool enable = true);
+
+    /// Update state when switching to next trace.
+    void nextTrace() override {
+        writer.nextTrace();
+        index = 0;
+    }
+
+    /// Dump memory accesses performed by instruction at pc.
+    void dump(uint64_t PC, const std::vector<MemoryAccess> &MA) override;
+
+  private:
+    BinaryTraceWriter writer;
+    /// The index of the next instruction in the current trace.
+    uint32_t index = 0;
+};
+
 /// InstrDumper is used to dump a trace of the instructions.
 class InstrDumper : public Dumper {
   public:
@@ -269,6 +415,46 @@ class InstrDumper : public Dumper {
                           const std::vector<uint64_t> *regs) = 0;
 };
 
+/// BufferedInstrDumper records a trace of instructions in memory, so that it
+/// can later be replayed to another InstrDumper.
+class BufferedInstrDumper : public InstrDumper {
+  public:
+    /// Construct a BufferedInstrDumper.
+    BufferedInstrDumper(bool enable) : InstrDumper(enable) {}
+
+    /// Called at the beginning of a trace.
+    void preDump() override { started = true; }
+
+    /// Replay the recorded instruction trace to \p D.
+    void replay(InstrDumper &D) const {
+        if (!started || !D.enabled())
+            return;
+        D.preDump();
+        for (const auto &i : instructions)
+            if (i.withRegs)
+                D.dump(i.instr, i.regs);
+            else
+                D.dump(i.instr);
+        D.postDump();
+    }
+
+  private:
+    struct Record {
+        ReferenceInstruction instr;
+        std::vector<uint64_t> regs;
+        bool withRegs;
+    };
+    std::vector<Record> instructions;
+    bool started = false;
+
+    /// Record this instruction.
+    void dumpImpl(const ReferenceInstruction &I,
+                  const std::vector<uint64_t> *regs) override {
+        instructions.push_back(
+            {I, regs ? *regs : std::vector<uint64_t>(), regs != nullptr});
+    }
+};
+
 /// The YAMLInstrDumper class will dump a trace of instructions to a
 /// file in YAML format .
 class YAMLInstrDumper : public InstrDumper, public YAMLDumper {
@@ -292,4 +478,34 @@ class YAMLInstrDumper : public InstrDumper, public YAMLDumper {
                   const std::vector<uint64_t> *regs) override;
 };
 
+/// The BinaryInstrDumper class will dump a trace of instructions to a file in
+/// the binary trace format, which can be read back with a BinaryInstrReader.
+class BinaryInstrDumper : public InstrDumper, public FileStreamDumper {
+  public:
+    /// Construct a BinaryInstrDumper that will dump its content to file \a
+    /// filename, gzip compressed if \a compressed is set.
+    BinaryInstrDumper(const std::string &filename, bool compressed,
+                      bool dumpMemAccess = false, bool dumpRegBank = false);
+
+    /// Construct a BinaryInstrDumper that will dump its content to stream \a
+    /// os, gzip compressed if \a compressed is set.
+    BinaryInstrDumper(std::ostream &os, bool compressed, bool enable = true,
+                      bool dumpMemAccess = false, bool dumpRegBank = false);
+
+    /// Update state when switching to next trace.
+    void nextTrace() override {
+        writer.nextTrace();
+        index = 0;
+    }
+
+  private:
+    BinaryTraceWriter writer;
+    /// The index of the next instruction in the current trace.
+    uint32_t index = 0;
+
+    /// Dump instruction \p I.
+    void dumpImpl(const ReferenceInstruction &I,
+                  const std::vector<uint64_t> *regs) override;
+};
+
 } // namespace PAF::SCA
@@ -27,8 +27,11 @@
 #include <cassert>
 #include <cstdint>
 #include <cstdlib>
+#include <map>
 #include <memory>
 #include <string>
+#include <tuple>
+#include <vector>
 
 namespace PAF::SCA::Expr {
 
@@ -130,6 +133,131 @@ class Value {
     ConcreteType val;
 };
 
+class Expr;
+
+/// The Program class is the compiled form of one or more Expr: a flat
+/// sequence of instructions, each one writing its result to its own register.
+/// A Program evaluates its expressions a batch of rows at a time, each
+/// instruction processing all the rows of the batch in a single loop, instead
+/// of walking the expression trees once per row.
+///
+/// The expressions added to a Program share their instructions: a subterm
+/// common to several expressions (or appearing several times in one of them)
+/// is only computed once, and the operations on constants are folded at
+/// compilation time.
+///
+/// The NPInput leaves are read directly from their NPArray column, their
+/// rows being counted from the row they referred to when the Program was
+/// compiled. The Input leaves are evaluated once per batch, so a Program must
+/// not outlive the Expr it has been compiled from.
+class Program {
+  public:
+    /// The operations supported by the Program instructions.
+    enum OpCode {
+        CONSTANT,  ///< A constant value.
+        LEAF,      ///< Evaluate a row independent leaf expression.
+        LOAD,      ///< Load a column of an NPArray.
+        NOT,       ///< Bitwise not.
+        TRUNCATE,  ///< Truncation to a smaller type.
+        AES_SBOX,  ///< AES SBox look-up.
+        AES_ISBOX, ///< AES inverted SBox look-up.
+        AND,       ///< Bitwise and.
+        OR,        ///< Bitwise or.
+        XOR,       ///< Bitwise xor.
+        LSL,       ///< Logical shift left.
+        LSR,       ///< Logical shift right.
+        ASR        ///< Arithmetic shift right.
+    };
+
+    /// The type of the functions loading to \p dst the \p n elements of a
+    /// column starting at row \p first, the column starting at \p base with
+    /// a \p stride elements distance between rows.
+    using Loader = void (*)(Value::ConcreteType *dst, const void *base,
+                            size_t stride, size_t first, size_t n);
+
+    /// Construct an empty Program.
+    Program() = default;
+
+    /// Compile expression \p expr.
+    explicit Program(const Expr &expr) { add(expr); }
+
+    /// Compile expression \p expr into this Program, reusing the
+    /// instructions already there. Returns the index of its result.
+    size_t add(const Expr &expr);
+
+    /// Get the number of expressions compiled in this Program.
+    [[nodiscard]] size_t outputs() const { return results.size(); }
+
+    /// Get the type of the compiled expression \p output.
+    [[nodiscard]] ValueType::Type getType(size_t output = 0) const {
+        return code[results[output]].ty;
+    }
+
+    /// Get the number of instructions in this Program.
+    [[nodiscard]] size_t size() const { return code.size(); }
+
+    /// Evaluate the expressions for the \p num_rows rows starting at
+    /// \p first_row, storing the results to \p out: the \p num_rows values
+    /// of the first expression, followed by the ones of the second
+    /// expression, ...
+    void eval(Value::ConcreteType *out, size_t first_row,
+              size_t num_rows) const;
+
+    /// Get the register computing \p op on registers \p lhs (and \p rhs for
+    /// binary operations), with a result of type \p ty.
+    unsigned emit(OpCode op, ValueType::Type ty, unsigned lhs,
+                  unsigned rhs = 0);
+
+    /// Get the register holding the constant \p value of type \p ty.
+    unsigned emitConstant(ValueType::Type ty, Value::ConcreteType value);
+
+    /// Get the register evaluating \p leaf.
+    unsigned emitLeaf(const Expr &leaf);
+
+    /// Get the register loading, with \p loader, the column of type \p ty
+    /// starting at \p base with a \p stride elements distance between rows.
+    unsigned emitLoad(const void *base, size_t stride, ValueType::Type ty,
+                      Loader loader);
+
+    /// Load \p n elements of type DataTy from a column, starting at row
+    /// \p first.
+    template <typename DataTy>
+    static void loadColumn(Value::ConcreteType *dst, const void *base,
+                           size_t stride, size_t first, size_t n) {
+        const DataTy *src = static_cast<const DataTy *>(base) + first * stride;
+        for (size_t i = 0; i < n; i++)
+            dst[i] = src[i * stride];
+    }
+
+  private:
+    struct Instruction {
+        OpCode op;
+        ValueType::Type ty;
+        unsigned lhs, rhs;
+        Value::ConcreteType value;
+        const void *ptr; ///< The leaf expression or the column base.
+        size_t stride;
+        Loader loader;
+    };
+
+    /// Execute \p insn on \p n rows, with operands \p lhs and \p rhs, to
+    /// \p dst.
+    static void execute(const Instruction &insn, Value::ConcreteType *dst,
+                        const Value::ConcreteType *lhs,
+                        const Value::ConcreteType *rhs, size_t first_row,
+                        size_t n);
+
+    /// Get the register for \p insn, appending it if no identical
+    /// instruction is already there.
+    unsigned insert(const Instruction &insn);
+
+    using Key = std::tuple<OpCode, ValueType::Type, unsigned, unsigned,
+                           Value::ConcreteType, const void *, size_t>;
+    std::vector<Instruction> code;
+    std::map<Key, unsigned> known;
+    std::vector<unsigned> results;
+};
+
 /// The Expr class models expressions.
 ///
 /// Expressions have a type (ValueType) and can produce a Value when they are
@@ -142,6 +270,10 @@ class Expr {
     /// Evaluate this expression's value.
     [[nodiscard]] virtual Value eval() const = 0;
 
+    /// Append the instructions computing this expression to \p prog.
+    /// Returns the register holding the result.
+    virtual unsigned compile(Program &prog) const = 0;
+
     /// Get the type of this expression.
     [[nodiscard]] virtual ValueType::Type getType() const = 0;
 
@@ -161,6 +293,11 @@ class InputBase : public Expr, public ValueType {
     [[nodiscard]] ValueType::Type getType() const override {
         return ValueType::getType();
     }
+
+    /// Append the instructions computing this expression to \p prog.
+    unsigned compile(Program &prog) const override {
+        return prog.emitLeaf(*this);
+    }
 };
 
 /// Implementation for Constant values (which are considered as Inputs).
@@ -177,6 +314,11 @@ class Constant : public InputBase {
     /// Get a string representation of this Constant.
     [[nodiscard]] std::string repr() const override;
 
+    /// Append the instructions computing this expression to \p prog.
+    unsigned compile(Program &prog) const override {
+        return prog.emitConstant(getType(), val.getValue());
+    }
+
   private:
     const Value val;
 };
@@ -274,6 +416,13 @@ template <class DataTy> class NPInput : public InputBase {
                '(' + s + ')';
     }
 
+    /// Append the instructions computing this expression to \p prog.
+    unsigned compile(Program &prog) const override {
+        return prog.emitLoad(&row.array()(row.index(), index),
+                             row.array().cols(), getType(),
+                             Program::loadColumn<DataTy>);
+    }
+
   private:
     typename NPArray<DataTy>::const_Row &row; ///< Our NPArray row.
     const std::string name;                   ///< Our name.
@@ -318,6 +467,11 @@ class Not : public UnaryOp {
     [[nodiscard]] Value eval() const override {
         return {~op->eval().getValue(), op->getType()};
     }
+
+    /// Append the instructions computing this expression to \p prog.
+    unsigned compile(Program &prog) const override {
+        return prog.emit(Program::NOT, getType(), op->compile(prog));
+    }
 };
 
 /// Truncation operations base class.
@@ -337,6 +491,11 @@ class Truncate : public UnaryOp {
     /// Evaluate this expression's value.
     [[nodiscard]] Value eval() const override { return {op->eval().getValue(), vt}; }
 
+    /// Append the instructions computing this expression to \p prog.
+    unsigned compile(Program &prog) const override {
+        return prog.emit(Program::TRUNCATE, getType(), op->compile(prog));
+    }
+
     /// Get the type of this expression.
     [[nodiscard]] ValueType::Type getType() const override {
         return vt.getType();
@@ -370,6 +529,11 @@ class AESSBox : public AESOp {
 
     /// Evaluate this expression's value.
     [[nodiscard]] Value eval() const override;
+
+    /// Append the instructions computing this expression to \p prog.
+    unsigned compile(Program &prog) const override {
+        return prog.emit(Program::AES_SBOX, getType(), op->compile(prog));
+    }
 };
 
 /// The AES Inverted SBox operator.
@@ -380,6 +544,11 @@ class AESISBox : public AESOp {
 
     /// Evaluate this expression's value.
     [[nodiscard]] Value eval() const override;
+
+    /// Append the instructions computing this expression to \p prog.
+    unsigned compile(Program &prog) const override {
+        return prog.emit(Program::AES_ISBOX, getType(), op->compile(prog));
+    }
 };
 
 /// Common base class for Binary operators.
@@ -412,6 +581,14 @@ class BinaryOp : public Expr {
     }
 
   protected:
+    /// Append the instructions computing this expression, with operation
+    /// \p op, to \p prog.
+    unsigned compileOp(Program &prog, Program::OpCode op) const {
+        const unsigned l = lhs->compile(prog);
+        const unsigned r = rhs->compile(prog);
+        return prog.emit(op, getType(), l, r);
+    }
+
     std::unique_ptr<Expr> lhs; ///< Left hand side sub-expression.
     std::unique_ptr<Expr> rhs; ///< Right hand side sub-expression.
     std::string opStr;         ///< The operator representation.
@@ -429,6 +606,11 @@ class Xor : public BinaryOp {
         return {lhs->eval().getValue() ^ rhs->eval().getValue(),
                 lhs->getType()};
     }
+
+    /// Append the instructions computing this expression to \p prog.
+    unsigned compile(Program &prog) const override {
+        return compileOp(prog, Program::XOR);
+    }
 };
 
 /// Bitwise OR operator implementation.
@@ -443,6 +625,11 @@ class Or : public BinaryOp {
         return {lhs->eval().getValue() | rhs->eval().getValue(),
                 lhs->getType()};
     }
+
+    /// Append the instructions computing this expression to \p prog.
+    unsigned compile(Program &prog) const override {
+        return compileOp(prog, Program::OR);
+    }
 };
 
 /// Logical shift left
@@ -454,6 +641,11 @@ class Lsl : public BinaryOp {
 
     /// Evaluate this expression's value.
     [[nodiscard]] Value eval() const override;
+
+    /// Append the instructions computing this expression to \p prog.
+    unsigned compile(Program &prog) const override {
+        return compileOp(prog, Program::LSL);
+    }
 };
 
 /// Arithmetic shift right
@@ -465,6 +657,11 @@ class Asr : public BinaryOp {
 
     /// Evaluate this expression's value.
     [[nodiscard]] Value eval() const override;
+
+    /// Append the instructions computing this expression to \p prog.
+    unsigned compile(Program &prog) const override {
+        return compileOp(prog, Program::ASR);
+    }
 };
 
 /// Logical shift right
@@ -476,6 +673,11 @@ class Lsr : public BinaryOp {
 
     /// Evaluate this expression's value.
     [[nodiscard]] Value eval() const override;
+
+    /// Append the instructions computing this expression to \p prog.
+    unsigned compile(Program &prog) const override {
+        return compileOp(prog, Program::LSR);
+    }
 };
 
 /// Bitwise AND operator implementation.
@@ -490,6 +692,11 @@ class And : public BinaryOp {
         return {lhs->eval().getValue() & rhs->eval().getValue(),
                 lhs->getType()};
     }
+
+    /// Append the instructions computing this expression to \p prog.
+    unsigned compile(Program &prog) const override {
+        return compileOp(prog, Program::AND);
+    }
 };
 
 } // namespace PAF::SCA::Expr
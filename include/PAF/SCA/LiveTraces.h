@@ -0,0 +1,239 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/SCA/NPArray.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace PAF::SCA {
+
+/// The live traces protocol streams rows of traces, for example from an
+/// oscilloscope during an acquisition, so that they can be analyzed while
+/// they are being acquired. All values are little endian.
+///
+/// The stream starts with a 16 bytes header:
+///  - the "PAFL" magic,
+///  - the protocol version (1), on 1 byte,
+///  - the samples element type, on 2 bytes, as in the NPY descriptors: 'f',
+///    'i' or 'u' followed by the element size in bytes, e.g. "f8" or "i2",
+///  - a reserved byte (0),
+///  - the number of samples per trace, on 4 bytes,
+///  - the number of data words per trace (e.g. the inputs), on 4 bytes.
+///
+/// It is followed by frames, each starting with its number of rows on 4
+/// bytes, followed by the rows. A row holds the trace data words (4 bytes
+/// each) followed by the trace samples. A frame with no row ends the stream.
+namespace LiveTraces {
+/// The magic string starting a live traces stream.
+constexpr char MAGIC[4] = {'P', 'A', 'F', 'L'};
+/// The protocol version.
+constexpr uint8_t VERSION = 1;
+/// The header size in bytes.
+constexpr size_t HEADER_SIZE = 16;
+} // namespace LiveTraces
+
+/// The LiveTraceReader class reads rows of traces streamed with the live
+/// traces protocol.
+class LiveTraceReader {
+  public:
+    /// Construct a LiveTraceReader reading from \p source, which is either:
+    ///  - "-" for the standard input,
+    ///  - "unix:PATH" to accept a connection on UNIX socket PATH,
+    ///  - "tcp:[HOST:]PORT" to accept a TCP connection on PORT,
+    ///  - the name of a file or of a named pipe.
+    /// This blocks until the stream header has been received.
+    explicit LiveTraceReader(const std::string &source);
+
+    LiveTraceReader(const LiveTraceReader &) = delete;
+    LiveTraceReader &operator=(const LiveTraceReader &) = delete;
+
+    /// Destruct this LiveTraceReader, closing its source.
+    ~LiveTraceReader();
+
+    /// Is this LiveTraceReader in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Has the end of the stream been reached ?
+    [[nodiscard]] bool atEnd() const noexcept { return ended; }
+
+    /// Get the samples element type descriptor, e.g. "f8".
+    [[nodiscard]] const std::string &getEltTy() const noexcept {
+        return eltTy;
+    }
+
+    /// Get the number of samples per trace.
+    [[nodiscard]] size_t getNumSamples() const noexcept { return numSamples; }
+
+    /// Get the number of data words per trace.
+    [[nodiscard]] size_t getNumData() const noexcept { return numData; }
+
+    /// Get the number of traces read so far.
+    [[nodiscard]] size_t getNumTraces() const noexcept { return numTraces; }
+
+    /// Read up to \p max_rows traces to \p traces, converting their samples
+    /// to Ty, and their data words to \p data. This blocks until \p max_rows
+    /// traces have been received, or the stream ends. Returns the number of
+    /// traces read, 0 at the end of the stream or in case of error. The
+    /// storage of \p traces and \p data is reused from one call to the next.
+    template <typename Ty>
+    size_t read(NPArray<Ty> &traces, NPArray<uint32_t> &data,
+                size_t max_rows) {
+        traces.resize(max_rows, numSamples);
+        data.resize(max_rows, numData);
+        size_t n = 0;
+        for (; n < max_rows && nextRow(); n++) {
+            if (numData != 0)
+                std::memcpy(&data(n, 0), row.data(),
+                            numData * sizeof(uint32_t));
+            if (numSamples != 0)
+                convert(&traces(n, 0), row.data() + numData * sizeof(uint32_t));
+        }
+        traces.resize(n, numSamples);
+        data.resize(n, numData);
+        return n;
+    }
+
+  private:
+    int fd = -1;
+    bool ownFd = false;
+    bool ended = false;
+    const char *errstr = nullptr;
+    std::string eltTy;
+    size_t eltSize = 0;
+    size_t numSamples = 0;
+    size_t numData = 0;
+    size_t numTraces = 0;
+    // The number of rows left in the current frame.
+    size_t frameRows = 0;
+    // The current row, as received.
+    std::vector<char> row;
+
+    /// Read exactly \p n bytes to \p buf. Returns false at the end of the
+    /// stream or in case of error.
+    bool readBytes(void *buf, size_t n);
+
+    /// Read the next row. Returns false at the end of the stream or in case
+    /// of error.
+    bool nextRow();
+
+    /// Convert the numSamples samples in \p src to \p dst.
+    template <typename Ty> void convert(Ty *dst, const char *src) const {
+        switch (eltTy[0]) {
+        case 'f':
+            if (eltSize == 4)
+                return convertFrom<float>(dst, src);
+            return convertFrom<double>(dst, src);
+        case 'i':
+            switch (eltSize) {
+            case 1:
+                return convertFrom<int8_t>(dst, src);
+            case 2:
+                return convertFrom<int16_t>(dst, src);
+            case 4:
+                return convertFrom<int32_t>(dst, src);
+            default:
+                return convertFrom<int64_t>(dst, src);
+            }
+        default:
+            switch (eltSize) {
+            case 1:
+                return convertFrom<uint8_t>(dst, src);
+            case 2:
+                return convertFrom<uint16_t>(dst, src);
+            case 4:
+                return convertFrom<uint32_t>(dst, src);
+            default:
+                return convertFrom<uint64_t>(dst, src);
+            }
+        }
+    }
+
+    template <typename FromTy, typename Ty>
+    void convertFrom(Ty *dst, const char *src) const {
+        if constexpr (std::is_same<FromTy, Ty>())
+            std::memcpy(dst, src, numSamples * sizeof(Ty));
+        else
+            for (size_t i = 0; i < numSamples; i++) {
+                FromTy v;
+                std::memcpy(&v, src + i * sizeof(FromTy), sizeof(FromTy));
+                dst[i] = Ty(v);
+            }
+    }
+};
+
+/// The LiveTraceWriter class streams rows of traces with the live traces
+/// protocol, e.g. to feed an SCA application running in live mode.
+class LiveTraceWriter {
+  public:
+    /// Construct a LiveTraceWriter streaming to \p os traces of \p
+    /// num_samples samples of type \p elt_ty (e.g. "f8"), with \p num_data
+    /// data words per trace. The stream header is written immediately.
+    LiveTraceWriter(std::ostream &os, const std::string &elt_ty,
+                    size_t num_samples, size_t num_data);
+
+    /// Write a frame with the rows of \p traces, whose elements must be of
+    /// the stream element type, and their data words from the rows of \p
+    /// data. Nothing is written if there are no rows. Returns false in case
+    /// of error.
+    template <typename Ty>
+    bool write(const NPArray<Ty> &traces, const NPArray<uint32_t> &data) {
+        if (std::string(NPArrayBase::getEltTyDescr<Ty>()) != eltTy ||
+            traces.cols() != numSamples || data.cols() != numData ||
+            traces.rows() != data.rows())
+            return false;
+        // A frame with no rows would end the stream.
+        if (traces.rows() == 0)
+            return bool(os);
+        writeU32(traces.rows());
+        for (size_t r = 0; r < traces.rows(); r++) {
+            if (numData != 0)
+                os.write(reinterpret_cast<const char *>(&data(r, 0)),
+                         numData * sizeof(uint32_t));
+            if (numSamples != 0)
+                os.write(reinterpret_cast<const char *>(&traces(r, 0)),
+                         numSamples * sizeof(Ty));
+        }
+        return bool(os);
+    }
+
+    /// Write the end of stream frame. Returns false in case of error.
+    bool close();
+
+  private:
+    std::ostream &os;
+    const std::string eltTy;
+    const size_t numSamples;
+    const size_t numData;
+
+    void writeU32(uint32_t v);
+};
+
+} // namespace PAF::SCA
@@ -0,0 +1,148 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/SCA/Expr.h"
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/Power.h"
+#include "PAF/SCA/SCA.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace PAF::SCA {
+
+/// MetricsPowerDumper is a PowerDumper specialization which does not store
+/// the power traces: each power trace is fed, as soon as it is complete, to
+/// in-process t-test and correlation accumulators, and only the resulting
+/// t-values and correlation coefficients are written, in NPY format, when the
+/// dumper is closed. Simulated leakage assessments can thus be run over any
+/// number of executions without storing their power traces.
+///
+/// Each power trace is classified (t-test) or gets its intermediate value
+/// (correlation) from an expression evaluated on the data words of the trace,
+/// e.g. its inputs, which are available to the expressions as the $in
+/// variable. As with paf-t-test, a trace is in group 0 if the Hamming weight
+/// of the expression value is below half of its width, in group 1 if it is
+/// above, and ignored otherwise. As with paf-correl, the intermediate value is
+/// the Hamming weight of the expression value.
+///
+/// The results have one row per t-test expression, followed by one row per
+/// correlation expression. All power traces must have the same number of
+/// samples, which is set by the first one unless specified: shorter power
+/// traces are padded with zeros, and longer ones are an error.
+class MetricsPowerDumper : public PowerDumper {
+  public:
+    /// Construct a MetricsPowerDumper writing to file \p filename the t-tests
+    /// of the \p t_test_exprs classifications, and the correlations with the
+    /// \p correl_exprs intermediate values, for power traces of \p
+    /// num_samples samples (0 to use the number of samples of the first
+    /// power trace). Each power trace has \p num_data data words.
+    MetricsPowerDumper(const std::string &filename,
+                       const std::vector<std::string> &t_test_exprs,
+                       const std::vector<std::string> &correl_exprs,
+                       size_t num_data, size_t num_samples = 0);
+
+    MetricsPowerDumper(const MetricsPowerDumper &) = delete;
+    MetricsPowerDumper &operator=(const MetricsPowerDumper &) = delete;
+
+    /// Destruct this MetricsPowerDumper, closing it if this was not done
+    /// already.
+    ~MetricsPowerDumper() override;
+
+    /// Is this MetricsPowerDumper in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Set the data words of the power traces to come, until the next call
+    /// to setData. They are typically set once per execution, and shared by
+    /// all the realizations of its power trace.
+    void setData(const std::vector<uint32_t> &data);
+
+    /// Called for each sample in the trace.
+    void dump(double total, double pc, double instr, double oreg, double ireg,
+              double addr, double data,
+              const PAF::ReferenceInstruction *I) override {
+        current.push_back(total);
+    }
+
+    /// Called for a batch of consecutive samples of the trace.
+    void dumpSamples(const PowerSamples &S) override {
+        current.insert(current.end(), S.total.begin(), S.total.end());
+    }
+
+    /// Terminate the current power trace, and feed it to the accumulators.
+    void nextTrace() override;
+
+    /// Get the number of power traces accumulated so far.
+    [[nodiscard]] size_t traces() const noexcept { return count; }
+
+    /// Compute the metrics from the power traces accumulated so far, with a
+    /// row per t-test expression followed by a row per correlation
+    /// expression. The t-tests need more than one power trace in each group,
+    /// and the correlations more than one power trace.
+    [[nodiscard]] NPArray<double> results();
+
+    /// Feed the pending power traces to the accumulators, and write the
+    /// metrics. Returns false in case of error.
+    bool close();
+
+  private:
+    const std::string filename;
+    const std::vector<std::string> tTestExprs;
+    const std::vector<std::string> correlExprs;
+    const size_t numData;
+    size_t numSamples;
+    const char *errstr = nullptr;
+    bool closed = false;
+
+    /// The t-test expressions followed by the correlation expressions, all
+    /// compiled to a single program evaluated on batchData.
+    std::vector<std::unique_ptr<Expr::Expr>> exprs;
+    Expr::Program program;
+
+    std::vector<TTestAccumulator<double>> ttests;
+    CorrelAccumulator<double> correls{0, 0};
+
+    /// The samples of the power trace being dumped.
+    std::vector<double> current;
+    /// The data words of the power traces being dumped.
+    std::vector<uint32_t> currentData;
+    /// The number of power traces accumulated.
+    size_t count = 0;
+
+    /// The complete power traces, and their data words, not yet fed to the
+    /// accumulators: the expressions are evaluated for a batch of traces at
+    /// a time.
+    NPArray<double> batch;
+    NPArray<uint32_t> batchData;
+    size_t batchRows = 0;
+
+    /// Feed the batched power traces to the accumulators.
+    void flush();
+};
+
+} // namespace PAF::SCA
@@ -23,6 +23,8 @@
 #include "PAF/SCA/NPArray.h"
 
 #include <algorithm>
+#include <fstream>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -72,7 +74,9 @@ template <class DataTy> class NPAdapter {
         w[currentRow].push_back(value);
     }
 
-    /// Save this into filename in the NPY format.
+    /// Save this into filename in the NPY format. The rows are written one
+    /// after the other, zero padded to the longest row length, without
+    /// building a contiguous copy of the matrix.
     [[nodiscard]] bool save(std::string_view filename) const {
         // Last trace may be empty and shall be skipped.
         size_t num_traces = w.size();
@@ -81,20 +85,24 @@ template <class DataTy> class NPAdapter {
 
         if (w[num_traces - 1].empty())
             num_traces -= 1;
-        auto matrix = std::make_unique<DataTy[]>(num_traces * maxRowLength);
-        // Flatten row vectors into contiguous matrix, with zero-padding
+
+        // The current row has not been accounted for in maxRowLength yet.
+        size_t num_columns = maxRowLength;
+        if (currentRow < num_traces)
+            num_columns = std::max(num_columns, w[currentRow].size());
+
+        std::ofstream ofs(std::string(filename), std::ofstream::binary);
+        if (!NPArray<DataTy>::saveHeader(ofs, num_traces, num_columns))
+            return false;
+        const std::vector<DataTy> zeros(num_columns, DataTy{});
         for (size_t r = 0; r < num_traces; ++r) {
             const auto &row = w[r];
-            size_t len = row.size();
-            auto dest = matrix.get() + r * maxRowLength;
-            // copy row elements
-            std::copy(row.begin(), row.begin() + len, dest);
-            // zero-fill remainder
-            if (len < maxRowLength)
-                std::fill(dest + len, dest + maxRowLength, DataTy{});
+            ofs.write(reinterpret_cast<const char *>(row.data()),
+                      row.size() * sizeof(DataTy));
+            ofs.write(reinterpret_cast<const char *>(zeros.data()),
+                      (num_columns - row.size()) * sizeof(DataTy));
         }
-        PAF::SCA::NPArray<DataTy> npy(std::move(matrix), num_traces, maxRowLength);
-        return npy.save(filename);
+        return bool(ofs);
     }
 
   private:
@@ -0,0 +1,140 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace PAF::SCA {
+
+/// NPAllocator is the interface of the memory allocators used for the NPArray
+/// storage. All the storage it provides is aligned on ALIGNMENT bytes, so
+/// that vector loads and stores on the array rows can be aligned too.
+class NPAllocator {
+  public:
+    /// The alignment, in bytes, of all the storage provided by an allocator.
+    static constexpr size_t ALIGNMENT = 64;
+
+    virtual ~NPAllocator();
+
+    /// Allocate a block of at least \p num_bytes bytes, aligned on ALIGNMENT.
+    [[nodiscard]] virtual char *allocate(size_t num_bytes) = 0;
+
+    /// Release block \p p, which was obtained from allocate(\p num_bytes).
+    virtual void deallocate(char *p, size_t num_bytes) noexcept = 0;
+
+    /// Get the default allocator, which allocates and releases each block
+    /// from the heap.
+    static NPAllocator &heap() noexcept;
+
+  protected:
+    /// Allocate \p num_bytes bytes, aligned on ALIGNMENT, from the heap.
+    static char *heapAllocate(size_t num_bytes);
+
+    /// Release block \p p obtained from heapAllocate.
+    static void heapDeallocate(char *p) noexcept;
+};
+
+/// NPPoolAllocator keeps the blocks released by the NPArrays, instead of
+/// returning them to the heap, in order to recycle them for later allocations
+/// of the same size. This is typically useful for applications processing
+/// data by chunks of the same shape, which would otherwise allocate and
+/// release the same amount of memory for each chunk.
+///
+/// An NPPoolAllocator can be used concurrently from several threads, and
+/// must outlive all the NPArrays that have been allocated with it.
+class NPPoolAllocator : public NPAllocator {
+  public:
+    /// Construct an NPPoolAllocator, which will keep at most \p max_cached
+    /// bytes of released blocks for recycling.
+    NPPoolAllocator(size_t max_cached = size_t(1) << 30)
+        : maxCachedBytes(max_cached) {}
+
+    /// Destruct this NPPoolAllocator, returning all cached blocks to the heap.
+    ~NPPoolAllocator() override;
+
+    NPPoolAllocator(const NPPoolAllocator &) = delete;
+    NPPoolAllocator &operator=(const NPPoolAllocator &) = delete;
+
+    [[nodiscard]] char *allocate(size_t num_bytes) override;
+    void deallocate(char *p, size_t num_bytes) noexcept override;
+
+    /// Get the number of bytes currently cached for recycling.
+    [[nodiscard]] size_t cachedBytes() const;
+
+    /// Return all cached blocks to the heap.
+    void release() noexcept;
+
+  private:
+    const size_t maxCachedBytes;
+    mutable std::mutex lock;
+    std::map<size_t, std::vector<char *>> cache; ///< Free blocks by size.
+    size_t numCachedBytes = 0;
+};
+
+/// NPLargePageAllocator maps the large blocks, typically the trace matrices,
+/// directly from the operating system and backs them with huge pages, which
+/// reduces the TLB pressure when walking arrays of many GB. Smaller blocks
+/// are allocated from the heap.
+///
+/// The large blocks are first-touched in parallel, in as many contiguous
+/// slices as the NPArray operations use threads, so that on NUMA systems the
+/// pages of each slice of rows are placed on the node of the thread which
+/// will likely process them. This is most effective with the workers pinned
+/// to the CPUs (see PAF_AFFINITY). There is no such placement for the
+/// operations partitioning the arrays by columns, as a page holds a part of
+/// all the columns of its rows.
+///
+/// An NPLargePageAllocator can be used concurrently from several threads.
+class NPLargePageAllocator : public NPAllocator {
+  public:
+    /// The size, in bytes, of the huge pages.
+    static constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+    /// Construct an NPLargePageAllocator, which maps the blocks of at least
+    /// \p min_bytes bytes. With \p hugetlb, the pages are first taken from
+    /// the huge pages reserved by the system administrator (hugetlbfs), and
+    /// from the transparent huge pages if there are none left. With \p
+    /// first_touch, the mapped blocks are touched in parallel.
+    explicit NPLargePageAllocator(size_t min_bytes = HUGE_PAGE_SIZE,
+                                  bool hugetlb = false,
+                                  bool first_touch = true)
+        : minBytes(min_bytes), hugeTLB(hugetlb), firstTouch(first_touch) {}
+
+    [[nodiscard]] char *allocate(size_t num_bytes) override;
+    void deallocate(char *p, size_t num_bytes) noexcept override;
+
+    /// Is a block of \p num_bytes bytes mapped by this allocator, rather
+    /// than allocated from the heap ?
+    [[nodiscard]] bool isMapped(size_t num_bytes) const noexcept {
+        return num_bytes != 0 && num_bytes >= minBytes;
+    }
+
+  private:
+    const size_t minBytes;
+    const bool hugeTLB;
+    const bool firstTouch;
+};
+
+} // namespace PAF::SCA
@@ -20,7 +20,9 @@
 
 #pragma once
 
+#include "PAF/SCA/NPAllocator.h"
 #include "PAF/SCA/NPOperators.h"
+#include "PAF/utils/Stats.h"
 
 #include <algorithm>
 #include <cassert>
@@ -28,6 +30,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <functional>
+#include <istream>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -49,6 +53,83 @@ class NPArrayBase {
         COLUMN ///< Process data along the Column axis.
     };
 
+    /// The LoadMode enumeration describes how the content of an NPY file is
+    /// made available in memory.
+    enum LoadMode {
+        READ, ///< Read the file content into a memory buffer.
+        MMAP  ///< Memory map the file content, with copy-on-write semantics.
+    };
+
+    /// The Format enumeration describes how a matrix is stored in a file.
+    enum Format {
+        NPY, ///< A plain NPY file.
+        NPZ, ///< An NPZ archive, i.e. a zip archive of NPY files (only the
+             ///< first one is used).
+        NPYZ, ///< An NPY file compressed by blocks of rows, with an index of
+              ///< the blocks so that only the blocks covering the rows of
+              ///< interest have to be decompressed.
+        NPYT  ///< A tiled NPY file: the matrix is stored by tiles of rows x
+              ///< columns, each tile holding its elements in column major
+              ///< order and being optionally compressed, with an index of the
+              ///< tiles so that only the tiles covering the region of
+              ///< interest have to be read.
+    };
+
+    /// Get the format to use for file \p filename, according to its
+    /// extension: '.npz' files are NPZ archives, '.npyz' files are NPYZ
+    /// files, '.npyt' files are NPYT files, and all other files are NPY
+    /// files.
+    [[nodiscard]] static Format fileFormat(std::string_view filename) noexcept;
+
+    /// The Window class describes a region of a matrix: the rows in [ \p
+    /// rowBegin, \p rowEnd ( and, for each of those rows, one column every \p
+    /// colStride columns in [ \p colBegin, \p colEnd (.
+    class Window {
+      public:
+        /// Construct a Window. The default Window covers a complete matrix.
+        explicit Window(size_t row_begin = 0, size_t row_end = -1,
+                        size_t col_begin = 0, size_t col_end = -1,
+                        size_t col_stride = 1)
+            : rowBegin(row_begin), rowEnd(row_end), colBegin(col_begin),
+              colEnd(col_end), colStride(col_stride) {
+            assert(col_stride > 0 && "Window column stride can not be 0");
+        }
+
+        /// Get this Window restricted to a \p num_rows x \p num_columns
+        /// matrix.
+        [[nodiscard]] Window clamp(size_t num_rows,
+                                   size_t num_columns) const noexcept {
+            const size_t re = std::min(rowEnd, num_rows);
+            const size_t ce = std::min(colEnd, num_columns);
+            return Window(std::min(rowBegin, re), re, std::min(colBegin, ce),
+                          ce, colStride);
+        }
+
+        /// Get the number of rows in this Window.
+        [[nodiscard]] size_t rows() const noexcept {
+            return rowEnd > rowBegin ? rowEnd - rowBegin : 0;
+        }
+
+        /// Get the number of columns in this Window.
+        [[nodiscard]] size_t cols() const noexcept {
+            return colEnd > colBegin
+                       ? (colEnd - colBegin + colStride - 1) / colStride
+                       : 0;
+        }
+
+        /// Get the number of consecutive columns that have to be read to
+        /// cover a row of this Window.
+        [[nodiscard]] size_t span() const noexcept {
+            return cols() == 0 ? 0 : (cols() - 1) * colStride + 1;
+        }
+
+        size_t rowBegin;  ///< The first row in the Window.
+        size_t rowEnd;    ///< The past-the-end row of the Window.
+        size_t colBegin;  ///< The first column in the Window.
+        size_t colEnd;    ///< The past-the-end column in the Window.
+        size_t colStride; ///< The distance between 2 columns in the Window.
+    };
+
     /// Get the numpy element type descriptor
     template <typename Ty> static const char *getEltTyDescr();
 
@@ -60,13 +141,22 @@ class NPArrayBase {
     /// Construct an NPArrayBase from file filename.
     ///
     /// This method will assess if the on-disk storage matches the
-    /// element type.
-    /// Construct an NPArrayBase from file filename.
+    /// element type. When \p mode is MMAP, the file content is not copied but
+    /// mapped in memory: modifications to the array are private to this
+    /// process and never written back to the file.
+    NPArrayBase(std::string_view filename, const char *expectedEltTy,
+                size_t maxNumRows = -1, LoadMode mode = READ)
+        : NPArrayBase(filename, expectedEltTy, Window(0, maxNumRows), mode) {}
+
+    /// Construct an NPArrayBase from the \p window region of file filename.
     ///
-    /// This method will assess if the on-disk storage matches the
-    /// element type.
+    /// Only the data in \p window are read from the file. Memory mapping, as
+    /// requested with \p mode, is only possible when \p window covers
+    /// complete rows of a C-order file, the data will be read otherwise. The
+    /// data from Fortran-order files are transposed when read, as NPArrayBase
+    /// always stores its elements in C-order.
     NPArrayBase(std::string_view filename, const char *expectedEltTy,
-                size_t maxNumRows = -1);
+                const Window &window, LoadMode mode = READ);
 
     /// Construct an NPArrayBase from several filenames.
     ///
@@ -82,16 +172,15 @@ class NPArrayBase {
     /// Takes ownership of data buffer.
     NPArrayBase(std::unique_ptr<char[]> &&data, size_t num_rows,
                 size_t num_columns, unsigned elt_size)
-        : data(std::move(data)), numRows(num_rows), numColumns(num_columns),
+        : data(data.release()), numRows(num_rows), numColumns(num_columns),
           eltSize(elt_size), errstr(nullptr) {}
 
     /// Construct an NPArray base from raw memory (raw pointer version) and misc
     /// other information.
     NPArrayBase(const char *buf, size_t num_rows, size_t num_columns,
                 unsigned elt_size)
-        : data(std::make_unique<char[]>(num_rows * num_columns * elt_size)),
-          numRows(num_rows), numColumns(num_columns), eltSize(elt_size),
-          errstr(nullptr) {
+        : data(allocate(num_rows * num_columns * elt_size)), numRows(num_rows),
+          numColumns(num_columns), eltSize(elt_size), errstr(nullptr) {
         if (buf)
             memcpy(data.get(), buf, num_rows * num_columns * elt_size);
     }
@@ -103,7 +192,7 @@ class NPArrayBase {
           errstr(nullptr) {
         for (const auto &row : matrix)
             numColumns = std::max(numColumns, row.size());
-        data = std::make_unique<char[]>(numRows * numColumns * eltSize);
+        data = allocate(numRows * numColumns * eltSize);
         for (size_t row = 0; row < numRows; row++)
             memcpy(data.get() + row * numColumns * eltSize, matrix[row].data(),
                    matrix[row].size() * eltSize);
@@ -113,7 +202,7 @@ class NPArrayBase {
     NPArrayBase(const NPArrayBase &Other)
         : numRows(Other.rows()), numColumns(Other.cols()),
           eltSize(Other.elementSize()), errstr(Other.error()) {
-        data = std::make_unique<char[]>(Other.size() * Other.elementSize());
+        data = allocate(Other.size() * Other.elementSize());
         memcpy(data.get(), Other.data.get(), numRows * numColumns * eltSize);
     }
 
@@ -128,15 +217,13 @@ class NPArrayBase {
         if (this == &Other)
             return *this;
 
-        bool needs_realloc = rows() != Other.rows() || cols() != Other.cols() ||
-                             elementSize() != Other.elementSize();
-        if (needs_realloc) {
-            data.reset(new char[Other.size() * Other.elementSize()]);
-            numRows = Other.numRows;
-            numColumns = Other.numColumns;
-            eltSize = Other.eltSize;
-            errstr = Other.errstr;
-        }
+        // Reuse the current storage if it is large enough.
+        if (Other.size() * Other.elementSize() > capacityBytes())
+            data = allocate(Other.size() * Other.elementSize());
+        numRows = Other.numRows;
+        numColumns = Other.numColumns;
+        eltSize = Other.eltSize;
+        errstr = Other.errstr;
 
         memcpy(data.get(), Other.data.get(), numRows * numColumns * eltSize);
 
@@ -200,7 +287,35 @@ class NPArrayBase {
         return numRows == 0 || numColumns == 0;
     }
 
-    /// Insert (uninitialized) rows at position row.
+    /// Is this NPArray content memory mapped from a file ?
+    [[nodiscard]] bool isMapped() const noexcept {
+        return data.get_deleter().isMapped();
+    }
+
+    /// Get the number of elements this NPArray can hold without having to
+    /// reallocate its storage.
+    [[nodiscard]] size_t capacity() const noexcept {
+        return eltSize == 0 ? 0 : capacityBytes() / eltSize;
+    }
+
+    /// Get the memory used by this NPArray, in bytes, including the storage
+    /// reserved for growth. The content of a memory mapped NPArray is backed
+    /// by its file, and is thus not accounted for.
+    [[nodiscard]] size_t memoryUsage() const noexcept {
+        return sizeof(*this) + (isMapped() ? 0 : capacityBytes());
+    }
+
+    /// Get the allocator used for the NPArray storage.
+    [[nodiscard]] static NPAllocator &allocator() noexcept;
+
+    /// Use \p allocator for all subsequent NPArray storage allocations, or the
+    /// heap allocator if \p allocator is nullptr. Storage already allocated is
+    /// released to the allocator it was obtained from.
+    static void setAllocator(NPAllocator *allocator) noexcept;
+
+    /// Insert (uninitialized) rows at position row. The storage grows
+    /// geometrically, so that appending rows one at a time has an amortized
+    /// constant cost.
     NPArrayBase &insertRows(size_t row, size_t rows);
 
     /// Insert an (uninitialized) row at position row.
@@ -216,14 +331,18 @@ class NPArrayBase {
     /// direction.
     NPArrayBase &extend(const NPArrayBase &other, Axis axis);
 
+    /// Transpose this matrix. This is performed tile by tile, so that both
+    /// the source and the destination have a good locality.
+    NPArrayBase &transpose();
+
     /// Make sure this NPArrayBase has enough storage to store \p new_num_row x
-    /// \p new_num_cols element. If the current storage has the exact size, no
+    /// \p new_num_cols element. If the current storage is large enough, no
     /// re-allocation occurs. In all other cases, a re-allocation will occur
     /// (and all data will be lost).
     NPArrayBase &resize(size_t new_num_rows, size_t new_num_columns) {
         const size_t new_size = new_num_rows * new_num_columns;
-        if (new_size != size())
-            data.reset(new char[new_size * elementSize()]);
+        if (new_size * elementSize() > capacityBytes())
+            data = allocate(new_size * elementSize());
         numRows = new_num_rows;
         numColumns = new_num_columns;
         return *this;
@@ -244,25 +363,140 @@ class NPArrayBase {
     [[nodiscard]] const char *error() const noexcept { return errstr; }
 
     /// Get information from the file header.
-    static bool getInformation(std::ifstream &ifs, unsigned &major,
+    ///
+    /// For NPZ, NPYZ and NPYT files, this is the information of the
+    /// compressed NPY file, and only its header is decompressed.
+    static bool getInformation(std::istream &is, unsigned &major,
                                unsigned &minor, std::string &descr,
                                bool &fortran_order, std::vector<size_t> &shape,
                                size_t &data_size,
                                const char **errstr = nullptr);
 
-    /// Get high level information from the file header.
-    static bool getInformation(std::ifstream &ifs, size_t &num_rows,
+    /// Get high level information from the file header. Files with a
+    /// non-native endianness are only accepted when \p swap is not null, in
+    /// which case \p *swap tells if the elements' bytes need to be swapped.
+    /// Likewise, Fortran-order files are only accepted when \p fortran_order
+    /// is not null, in which case \p *fortran_order tells if the file stores
+    /// the transposed matrix.
+    static bool getInformation(std::istream &is, size_t &num_rows,
                                size_t &num_columns, std::string &elt_ty,
-                               size_t &elt_size, const char **errstr = nullptr);
+                               size_t &elt_size, const char **errstr = nullptr,
+                               bool *swap = nullptr,
+                               bool *fortran_order = nullptr);
+
+    /// Save to file \p filename with descriptor \p descr, in Fortran-order
+    /// if \p fortran_order is set. The file format is selected from the \p
+    /// filename extension, see fileFormat.
+    [[nodiscard]] bool save(std::string_view filename, std::string_view descr,
+                            bool fortran_order = false) const;
+
+    /// Save to NPZ archive \p filename with descriptor \p descr, in
+    /// Fortran-order if \p fortran_order is set. The archive holds a single
+    /// deflated NPY file, named 'arr_0.npy' as with numpy.savez_compressed.
+    [[nodiscard]] bool saveNPZ(std::string_view filename,
+                               std::string_view descr,
+                               bool fortran_order = false) const;
+
+    /// Save to NPYZ file \p filename with descriptor \p descr, compressing
+    /// the rows by blocks of \p block_rows rows, or of about 1MB if \p
+    /// block_rows is 0. The blocks are compressed in parallel. NPYZ files
+    /// are always in C-order.
+    [[nodiscard]] bool saveNPYZ(std::string_view filename,
+                                std::string_view descr,
+                                size_t block_rows = 0) const;
+
+    /// Save to NPYT file \p filename with descriptor \p descr, by tiles of
+    /// \p tile_rows x \p tile_cols elements (4096 x 256 for 0 values). The
+    /// tiles are zlib compressed if \p compress is set, and if this reduces
+    /// their size. The tiles are transposed and compressed in parallel.
+    [[nodiscard]] bool saveNPYT(std::string_view filename,
+                                std::string_view descr, size_t tile_rows = 0,
+                                size_t tile_cols = 0,
+                                bool compress = true) const;
+
+    /// Save to output file stream \p os, in Fortran-order if \p
+    /// fortran_order is set.
+    [[nodiscard]] bool save(std::ofstream &os, std::string_view descr,
+                            bool fortran_order = false) const;
+
+    /// Save to output file stream \p os the header for a \p num_rows x \p
+    /// num_columns matrix with descriptor \p descr. This allows to save a
+    /// matrix in pieces: the header has to be followed by the matrix rows,
+    /// saved with saveData (or the matrix columns if \p fortran_order is
+    /// set). The header is padded so that the data start at least \p
+    /// min_data_offset bytes after the header start, which allows to later
+    /// overwrite a header with another one of the same size.
+    [[nodiscard]] static bool saveHeader(std::ostream &os,
+                                         std::string_view descr,
+                                         size_t num_rows, size_t num_columns,
+                                         bool fortran_order = false,
+                                         size_t min_data_offset = 0);
+
+    /// Save this array's data, without any header, to output file stream \p
+    /// os.
+    [[nodiscard]] bool saveData(std::ofstream &os) const;
+
+    /// Get the maximum number of threads the NPArray operations can use.
+    [[nodiscard]] static unsigned numThreads() noexcept;
+
+    /// Set the maximum number of threads the NPArray operations can use to \p
+    /// num_threads, 0 meaning as many as the hardware supports. The default
+    /// is to use a single thread.
+    static void setNumThreads(unsigned num_threads) noexcept;
+
+    /// The minimum number of elements a thread has to process for a parallel
+    /// execution to be worth it.
+    static constexpr size_t MIN_ELEMENTS_PER_THREAD = 1 << 16;
+
+    /// Call \p f(b, e) on consecutive sub-ranges [b, e( covering [begin, end(,
+    /// spreading them on up to numThreads() threads. Each index in the range
+    /// stands for \p num_elements elements, which is used to decide how many
+    /// threads are worth using. \p f must be safe to call concurrently on
+    /// disjoint sub-ranges. The sub-ranges are run by a pool of threads
+    /// shared by the whole process, which is started on first use.
+    template <class Function>
+    static void parallelFor(size_t begin, size_t end, size_t num_elements,
+                            const Function &f) {
+        assert(begin <= end && "begin must be lower or equal to end");
+        const size_t n = end - begin;
+        const size_t num_threads =
+            std::min({size_t(numThreads()), n,
+                      n * num_elements / MIN_ELEMENTS_PER_THREAD});
+        if (num_threads <= 1) {
+            f(begin, end);
+            return;
+        }
 
-    /// Save to file \p filename with descriptor \p descr.
-    [[nodiscard]] bool save(std::string_view filename,
-                            std::string_view descr) const;
+        const size_t chunk = (n + num_threads - 1) / num_threads;
+        runParallel(begin, end, chunk, std::cref(f));
+    }
 
-    /// Save to output file stream \p os.
-    [[nodiscard]] bool save(std::ofstream &os, std::string_view descr) const;
+  private:
+    /// Call \p f(b, e) on the consecutive sub-ranges of \p chunk indices
+    /// covering [begin, end(, running the first one on the calling thread and
+    /// the others on the shared thread pool, and wait for all of them.
+    static void runParallel(size_t begin, size_t end, size_t chunk,
+                            const std::function<void(size_t, size_t)> &f);
 
   protected:
+    /// Open file \p filename for reading the \p window region of its
+    /// matrix, and return a stream holding an NPY file, or nullptr in case of
+    /// error. For NPY files, this is the file itself. For NPZ, NPYZ and NPYT
+    /// files, this is an in memory NPY file, with the decompressed data. Only
+    /// the blocks of rows (resp. the tiles) covering \p window are
+    /// decompressed from NPYZ (resp. NPYT) files (in parallel), in which case
+    /// \p window is updated to designate the same region in the returned
+    /// stream. \p compressed, if not nullptr, is
+    /// set when the returned stream is not the file itself.
+    static std::unique_ptr<std::istream>
+    openStream(std::string_view filename, Window &window, bool *compressed,
+               const char **errstr);
+
+    /// Transpose the \p num_rows x \p num_columns matrix of \p elt_size
+    /// bytes elements at \p src into \p dst.
+    static void transpose(char *dst, const char *src, size_t num_rows,
+                          size_t num_columns, size_t elt_size) noexcept;
+
     /// Get a pointer to type Ty to the array (const version).
     template <class Ty>
     [[nodiscard]] const Ty *getAs(const size_t &row,
@@ -298,6 +532,27 @@ class NPArrayBase {
         return &p[idx];
     }
 
+    /// Get a pointer to type Ty to the first element of the array, without
+    /// any bound check (const version).
+    template <class Ty> [[nodiscard]] const Ty *dataAs() const noexcept {
+        return reinterpret_cast<const Ty *>(data.get());
+    }
+
+    /// Get a pointer to type Ty to the first element of the array, without
+    /// any bound check.
+    template <class Ty> Ty *dataAs() noexcept {
+        return reinterpret_cast<Ty *>(data.get());
+    }
+
+    /// Get \p v with its bytes order reversed.
+    template <typename Ty> static Ty byteSwap(Ty v) noexcept {
+        static_assert(std::is_arithmetic<Ty>(),
+                      "expecting an integral or floating point type");
+        char *p = reinterpret_cast<char *>(&v);
+        std::reverse(p, p + sizeof(Ty));
+        return v;
+    }
+
     /// Set the error string and state.
     NPArrayBase &setError(const char *s) {
         errstr = s;
@@ -312,7 +567,73 @@ class NPArrayBase {
     }
 
   private:
-    std::unique_ptr<char[]> data;
+    /// The Deleter class releases the NPArrayBase storage, whether it was
+    /// obtained from an NPAllocator, provided by the user (and allocated with
+    /// new char[]) or memory mapped from a file.
+    class Deleter {
+      public:
+        /// Construct a Deleter for a storage allocated with new char[].
+        Deleter() noexcept {}
+        /// Construct a Deleter for a file mapping of \p length bytes, where the
+        /// array data start at \p offset bytes from the mapping start.
+        Deleter(size_t offset, size_t length) noexcept
+            : mappingOffset(offset), length(length) {}
+        /// Construct a Deleter for a block of \p capacity bytes obtained from
+        /// \p allocator.
+        Deleter(NPAllocator *allocator, size_t capacity) noexcept
+            : allocator(allocator), length(capacity) {}
+
+        /// Release the storage pointed to by \p p.
+        void operator()(char *p) const noexcept;
+
+        /// Is the storage memory mapped ?
+        [[nodiscard]] bool isMapped() const noexcept {
+            return allocator == nullptr && length != 0;
+        }
+
+        /// Get the capacity in bytes of a storage obtained from an allocator,
+        /// or 0 if unknown.
+        [[nodiscard]] size_t capacity() const noexcept {
+            return allocator ? length : 0;
+        }
+
+      private:
+        NPAllocator *allocator = nullptr; ///< The storage allocator, if any.
+        size_t mappingOffset = 0; ///< Offset of the data in the mapping.
+        size_t length = 0; ///< Length of the mapping or of the allocated block.
+    };
+
+    /// The storage type used for the array elements.
+    using Storage = std::unique_ptr<char[], Deleter>;
+
+    /// Allocate a storage of \p num_bytes bytes from the current allocator.
+    static Storage allocate(size_t num_bytes) {
+        NPAllocator &a = allocator();
+        Storage s(a.allocate(num_bytes), Deleter(&a, num_bytes));
+        Stats::allocated(num_bytes, Stats::MEM_SCA);
+        return s;
+    }
+
+    /// Get the size in bytes of the storage.
+    [[nodiscard]] size_t capacityBytes() const noexcept {
+        return std::max(data.get_deleter().capacity(), size() * eltSize);
+    }
+
+    /// Get the size of the storage to allocate to hold at least \p num_bytes
+    /// bytes when growing the current storage.
+    [[nodiscard]] size_t growCapacity(size_t num_bytes) const noexcept {
+        return std::max(num_bytes, capacityBytes() + capacityBytes() / 2);
+    }
+
+    /// Get the format of the file in stream \p is, from its content.
+    static Format streamFormat(std::istream &is);
+
+    /// Get the NPY header \p header and data size \p data_size of the NPY
+    /// file compressed in NPZ, NPYZ or NPYT stream \p is.
+    static bool getCompressedHeader(std::istream &is, std::string &header,
+                                    size_t &data_size, const char **errstr);
+
+    Storage data;
     size_t numRows, numColumns; //< Number of rows and columns.
     unsigned eltSize;           //< Number of elements.
     const char *errstr;
@@ -325,154 +646,829 @@ class NPArrayBase {
                 Axis axis, const char *expectedEltTy, size_t expectedDimension);
 };
 
-/// NPArray is the user facing class to work with 1D or 2D numpy arrays.
-template <class Ty> class NPArray : public NPArrayBase {
-  public:
-    /// The array elements' type.
-    using DataTy = Ty;
-
-    static_assert(std::is_arithmetic<Ty>(),
-                  "expecting an integral or floating point type");
-
-    /// Construct an empty NPArray.
-    NPArray() : NPArrayBase(sizeof(Ty)) {}
-
-    /// Construct an NPArray from data stored in file \p filename.
-    NPArray(std::string_view filename, size_t maxNumRows = -1)
-        : NPArrayBase(std::string(filename), getEltTyDescr<Ty>(), maxNumRows) {}
-
-    /// Construct an NPArray from multiple files, concatenating the Matrices
-    /// along \p axis.
-    NPArray(const std::vector<std::string> &filenames, Axis axis)
-        : NPArrayBase() {
-        if (filenames.empty())
-            return;
+template <class Ty> class NPArray;
+template <class Ty> class NPArrayView;
 
-        // Get the NPArray attributes that we should expect.
-        size_t output_num_rows;
-        size_t output_num_cols;
-        bool first = true;
-        for (const auto &filename : filenames) {
-            std::ifstream ifs(filename, std::ifstream::binary);
-            if (!ifs) {
-                setError("Could not open file to get target matrix attributes");
-                return;
-            }
+/// NPExpressionTag is the base class of all the nodes of the lazily evaluated
+/// element-wise NPArray expressions.
+struct NPExpressionTag {};
 
-            size_t l_num_rows;
-            size_t l_num_cols;
-            std::string l_elt_ty;
-            size_t l_elt_size;
-            const char *l_errstr;
-            if (!getInformation(ifs, l_num_rows, l_num_cols, l_elt_ty,
-                                l_elt_size, &l_errstr)) {
-                setError(l_errstr);
-                return;
-            }
+/// Is \p T an NPArray expression node ?
+template <class T> constexpr bool isNPExpression() {
+    return std::is_base_of_v<NPExpressionTag, std::decay_t<T>>;
+}
 
-            if (l_elt_ty != getEltTyDescr<Ty>() || l_elt_size != sizeof(Ty)) {
-                setError("Error element type mismatch in the matrix to "
-                         "concatenate");
-                return;
-            }
+/// NPArrayOps provides the read-only operations (predicates, collectors and
+/// folds) shared by NPArray and NPArrayView. The \p Derived class must provide
+/// the rows(), cols(), empty() and at(row, col) methods.
+template <class Derived, class Ty> class NPArrayOps {
+  public:
+    /// \defgroup Predicates Predicate operations on NParrays
+    /// @{
+    /// Test if all elements in this NPArray satisfy predicate \p pred.
+    template <class predicate> bool all(predicate &&pred) const {
+        if (self().empty())
+            return false;
+        for (size_t row = 0; row < self().rows(); row++)
+            for (size_t col = 0; col < self().cols(); col++)
+                if (!pred(self().at(row, col)))
+                    return false;
+        return true;
+    }
 
-            if (first) {
-                output_num_rows = l_num_rows;
-                output_num_cols = l_num_cols;
-                first = false;
-            } else {
-                switch (axis) {
-                case NPArrayBase::COLUMN:
-                    output_num_rows += l_num_rows;
-                    if (output_num_cols != l_num_cols) {
-                        setError("Can not concatenate along the Column axis "
-                                 "matrices with different column numbers");
-                        return;
-                    }
-                    break;
-                case NPArrayBase::ROW:
-                    output_num_cols += l_num_cols;
-                    if (output_num_rows != l_num_rows) {
-                        setError(
-                            "Can not concatenate along the Row axis matrices "
-                            "with different row numbers");
-                        return;
-                    }
-                    break;
-                }
-            }
+    /// Test if all elements in row \p i or column \p i satisfy predicate
+    /// \p pred.
+    template <class predicate>
+    [[nodiscard]] bool all(const predicate &pred, NPArrayBase::Axis axis,
+                           size_t i) const {
+        switch (axis) {
+        case NPArrayBase::ROW:
+            assert(i <= self().rows() &&
+                   "index is out of bound for row access in NPArray::all");
+            for (size_t col = 0; col < self().cols(); col++)
+                if (!pred(self().at(i, col)))
+                    return false;
+            return true;
+        case NPArrayBase::COLUMN:
+            assert(i <= self().cols() &&
+                   "index is out of bound column access in NPArray::all");
+            for (size_t row = 0; row < self().rows(); row++)
+                if (!pred(self().at(row, i)))
+                    return false;
+            return true;
         }
+    }
 
-        NPArrayBase tmp(filenames, axis, getEltTyDescr<Ty>(), output_num_rows,
-                        output_num_cols, sizeof(Ty));
-
-        if (tmp.good())
-            *static_cast<NPArrayBase *>(this) = std::move(tmp);
-        else
-            setError(tmp.error());
+    /// Test if all elements in the range [ \p begin , \p end ( on \p axis
+    /// satisfy predicate \p pred.
+    template <class predicate>
+    [[nodiscard]] bool all(const predicate &pred, NPArrayBase::Axis axis,
+                           size_t begin, size_t end) const {
+        assert(begin <= end && "range's end needs to be strictly greater "
+                               "than begin in NPArray::all");
+        if (begin >= end)
+            return false;
+        switch (axis) {
+        case NPArrayBase::ROW:
+            assert(
+                begin <= self().rows() &&
+                "begin index is out of bound for row access in NPArray::all");
+            assert(end <= self().rows() &&
+                   "end index is out of bound for row access in NPArray::all");
+            for (size_t row = begin; row < end; row++)
+                for (size_t col = 0; col < self().cols(); col++)
+                    if (!pred(self().at(row, col)))
+                        return false;
+            return true;
+        case NPArrayBase::COLUMN:
+            assert(begin <= self().cols() &&
+                   "begin index is out of bound for column "
+                   "access in NPArray::all");
+            assert(
+                end <= self().cols() &&
+                "end index is out of bound for column access in NPArray::all");
+            for (size_t row = 0; row < self().rows(); row++)
+                for (size_t col = begin; col < end; col++)
+                    if (!pred(self().at(row, col)))
+                        return false;
+            return true;
+        }
     }
 
-    /// Read an NPArray from file \p filename and convert each of its elements
-    /// to \p Ty if need be. This does not affect the Matrix shape or number of
-    /// elements, only their type. The type conversion to smaller types may
-    /// truncate some information.
-    static NPArray readAs(const std::string &filename, size_t maxNumRows = -1) {
-        if (filename.empty())
-            return NPArray(0, 0);
+    /// Test if any of the elements in this NPArray satisfy predicate \p pred.
+    template <class predicate>
+    [[nodiscard]] bool any(const predicate &pred) const {
+        if (self().empty())
+            return false;
+        for (size_t row = 0; row < self().rows(); row++)
+            for (size_t col = 0; col < self().cols(); col++)
+                if (pred(self().at(row, col)))
+                    return true;
+        return false;
+    }
 
-        std::ifstream ifs(filename, std::ifstream::binary);
-        if (!ifs) {
-            NPArray res(0, 0);
-            res.setError("Could not open file to get target matrix attributes");
-            return res;
+    /// Test if any of the elements in row \p i or column \p i satisfy predicate
+    /// \p pred.
+    template <class predicate>
+    [[nodiscard]] bool any(const predicate &pred, NPArrayBase::Axis axis,
+                           size_t i) const {
+        switch (axis) {
+        case NPArrayBase::ROW:
+            assert(i <= self().rows() &&
+                   "index is out of bound for row access in NPArray::any");
+            for (size_t col = 0; col < self().cols(); col++)
+                if (pred(self().at(i, col)))
+                    return true;
+            return false;
+        case NPArrayBase::COLUMN:
+            assert(i <= self().cols() &&
+                   "index is out of bound column access in NPArray::any");
+            for (size_t row = 0; row < self().rows(); row++)
+                if (pred(self().at(row, i)))
+                    return true;
+            return false;
         }
+    }
 
-        size_t num_rows;
-        size_t num_cols;
-        std::string elt_ty;
-        size_t elt_size;
-        const char *l_errstr;
-        if (!getInformation(ifs, num_rows, num_cols, elt_ty, elt_size,
-                            &l_errstr)) {
-            NPArray res(0, 0);
-            res.setError(l_errstr);
-            return res;
+    /// Test if any of the elements in the range [ \p begin , \p end ( on \p
+    /// axis satisfy predicate \p pred.
+    template <class predicate>
+    [[nodiscard]] bool any(const predicate &pred, NPArrayBase::Axis axis,
+                           size_t begin, size_t end) const {
+        assert(begin <= end && "range's end needs to be strictly greater "
+                               "than begin in NPArray::all");
+        if (begin >= end)
+            return false;
+        switch (axis) {
+        case NPArrayBase::ROW:
+            assert(
+                begin <= self().rows() &&
+                "begin index is out of bound for row access in NPArray::any");
+            assert(end <= self().rows() &&
+                   "end index is out of bound for row access in NPArray::any");
+            for (size_t row = begin; row < end; row++)
+                for (size_t col = 0; col < self().cols(); col++)
+                    if (pred(self().at(row, col)))
+                        return true;
+            return false;
+        case NPArrayBase::COLUMN:
+            assert(begin <= self().cols() &&
+                   "begin index is out of bound for column "
+                   "access in NPArray::any");
+            assert(
+                end <= self().cols() &&
+                "end index is out of bound for column access in NPArray::any");
+            for (size_t row = 0; row < self().rows(); row++)
+                for (size_t col = begin; col < end; col++)
+                    if (pred(self().at(row, col)))
+                        return true;
+            return false;
         }
+    }
 
-        num_rows = std::min(num_rows, maxNumRows);
-        size_t num_elt = num_rows * num_cols;
-        std::unique_ptr<Ty[]> data(new Ty[num_elt]);
+    /// Test if none of the elements in this NPArray satisfy predicate \p pred.
+    template <class predicate>
+    [[nodiscard]] bool none(const predicate &pred) const {
+        if (self().empty())
+            return false;
+        for (size_t row = 0; row < self().rows(); row++)
+            for (size_t col = 0; col < self().cols(); col++)
+                if (pred(self().at(row, col)))
+                    return false;
+        return true;
+    }
 
-        switch (elt_ty[0]) {
-        case 'i':
-            switch (elt_ty[1]) {
-            case '1':
-                for (size_t i = 0; i < num_elt; i++) {
-                    int8_t tmp;
-                    ifs.read(reinterpret_cast<char *>(&tmp), elt_size);
-                    data[i] = static_cast<Ty>(tmp);
-                }
-                break;
-            case '2':
-                for (size_t i = 0; i < num_elt; i++) {
-                    int16_t tmp;
-                    ifs.read(reinterpret_cast<char *>(&tmp), elt_size);
-                    data[i] = static_cast<Ty>(tmp);
-                }
-                break;
-            case '4':
-                for (size_t i = 0; i < num_elt; i++) {
-                    int32_t tmp;
-                    ifs.read(reinterpret_cast<char *>(&tmp), elt_size);
-                    data[i] = static_cast<Ty>(tmp);
-                }
+    /// Test if none of the elements in row \p i or column \p i satisfy
+    /// predicate \p pred.
+    template <class predicate>
+    [[nodiscard]] bool none(const predicate &pred, NPArrayBase::Axis axis,
+                            size_t i) const {
+        switch (axis) {
+        case NPArrayBase::ROW:
+            assert(i <= self().rows() &&
+                   "index is out of bound for row access in NPArray::none");
+            for (size_t col = 0; col < self().cols(); col++)
+                if (pred(self().at(i, col)))
+                    return false;
+            return true;
+        case NPArrayBase::COLUMN:
+            assert(i <= self().cols() &&
+                   "index is out of bound column access in NPArray::none");
+            for (size_t row = 0; row < self().rows(); row++)
+                if (pred(self().at(row, i)))
+                    return false;
+            return true;
+        }
+    }
+
+    /// Test if none of the elements in the range [ \p begin , \p end ( on \p
+    /// axis satisfy predicate \p pred.
+    template <class predicate>
+    [[nodiscard]] bool none(const predicate &pred, NPArrayBase::Axis axis,
+                            size_t begin, size_t end) const {
+        assert(begin <= end && "range's end needs to be strictly greater "
+                               "than begin in NPArray::none");
+        if (begin >= end)
+            return false;
+        switch (axis) {
+        case NPArrayBase::ROW:
+            assert(
+                begin <= self().rows() &&
+                "begin index is out of bound for row access in NPArray::none");
+            assert(end <= self().rows() &&
+                   "end index is out of bound for row access in NPArray::none");
+            for (size_t row = begin; row < end; row++)
+                for (size_t col = 0; col < self().cols(); col++)
+                    if (pred(self().at(row, col)))
+                        return false;
+            return true;
+        case NPArrayBase::COLUMN:
+            assert(begin <= self().cols() &&
+                   "begin index is out of bound for column "
+                   "access in NPArray::none");
+            assert(
+                end <= self().cols() &&
+                "end index is out of bound for column access in NPArray::none");
+            for (size_t row = 0; row < self().rows(); row++)
+                for (size_t col = begin; col < end; col++)
+                    if (pred(self().at(row, col)))
+                        return false;
+            return true;
+        }
+    }
+
+    /// Count how many of the elements in this NPArray satisfy predicate \p
+    /// pred.
+    template <class predicate>
+    [[nodiscard]] size_t count(const predicate &pred) const {
+        size_t cnt = 0;
+        if (self().empty())
+            return cnt;
+        for (size_t row = 0; row < self().rows(); row++)
+            for (size_t col = 0; col < self().cols(); col++)
+                if (pred(self().at(row, col)))
+                    cnt += 1;
+        return cnt;
+    }
+
+    /// Count how many of the elements in row \p i or column \p i satisfy
+    /// predicate \p pred.
+    template <class predicate>
+    [[nodiscard]] size_t count(const predicate &pred, NPArrayBase::Axis axis,
+                               size_t i) const {
+        size_t cnt = 0;
+        switch (axis) {
+        case NPArrayBase::ROW:
+            assert(i <= self().rows() &&
+                   "index is out of bound for row access in NPArray::count");
+            for (size_t col = 0; col < self().cols(); col++)
+                if (pred(self().at(i, col)))
+                    cnt += 1;
+            return cnt;
+        case NPArrayBase::COLUMN:
+            assert(i <= self().cols() &&
+                   "index is out of bound column access in NPArray::count");
+            for (size_t row = 0; row < self().rows(); row++)
+                if (pred(self().at(row, i)))
+                    cnt += 1;
+            return cnt;
+        }
+    }
+
+    /// Count how many of the elements in the range [ \p begin , \p end ( on \p
+    /// axis satisfy predicate \p pred.
+    template <class predicate>
+    [[nodiscard]] size_t count(const predicate &pred, NPArrayBase::Axis axis,
+                               size_t begin, size_t end) const {
+        assert(begin <= end && "range's end needs to be strictly greater "
+                               "than begin in NPArray::count");
+        size_t cnt = 0;
+        if (begin >= end)
+            return cnt;
+        switch (axis) {
+        case NPArrayBase::ROW:
+            assert(
+                begin <= self().rows() &&
+                "begin index is out of bound for row access in NPArray::count");
+            assert(
+                end <= self().rows() &&
+                "end index is out of bound for row access in NPArray::count");
+            for (size_t row = begin; row < end; row++)
+                for (size_t col = 0; col < self().cols(); col++)
+                    if (pred(self().at(row, col)))
+                        cnt += 1;
+            return cnt;
+        case NPArrayBase::COLUMN:
+            assert(begin <= self().cols() &&
+                   "begin index is out of bound for column "
+                   "access in NPArray::count");
+            assert(end <= self().cols() &&
+                   "end index is out of bound for column "
+                   "access in NPArray::count");
+            for (size_t row = 0; row < self().rows(); row++)
+                for (size_t col = begin; col < end; col++)
+                    if (pred(self().at(row, col)))
+                        cnt += 1;
+            return cnt;
+        }
+    }
+    /// @}
+
+    /// \defgroup Collectors Collect some metric (e.g. min, max, ...), passed as
+    /// an \p NPCollector function object, optionally including the row / col
+    /// information over each element of an NPArray (or a selected range of it)
+    /// and return it. The NPCollector object must be copyable.
+    /// @{
+
+    /// Applies a \p NPCollector function object to each element of the
+    /// NPArray and returns it.
+    template <template <typename, bool> class collectorOp,
+              bool enableLocation = false>
+    [[nodiscard]] std::enable_if_t<
+        isNPCollector<Ty, collectorOp, enableLocation>() &&
+            std::is_copy_constructible<collectorOp<Ty, enableLocation>>(),
+        collectorOp<
+            Ty, enableLocation>> foreach (const collectorOp<Ty, enableLocation>
+                                              &collectOp) const {
+        collectorOp<Ty, enableLocation> op(collectOp);
+        for (size_t row = 0; row < self().rows(); row++)
+            for (size_t col = 0; col < self().cols(); col++)
+                op(self().at(row, col), row, col);
+        return op;
+    }
+
+    /// Applies a \p NPCollector function object to each element in the \p i'th
+    /// row (resp. column) as specified by \p axis in the NPArray and returns
+    /// it.
+    template <template <typename, bool> class collectorOp,
+              bool enableLocation = false>
+    [[nodiscard]] std::enable_if_t<
+        isNPCollector<Ty, collectorOp, enableLocation>() &&
+            std::is_copy_constructible<collectorOp<Ty, enableLocation>>(),
+        collectorOp<
+            Ty, enableLocation>> foreach (const collectorOp<Ty, enableLocation>
+                                              &collectOp,
+                                          NPArrayBase::Axis axis,
+                                          size_t i) const {
+        collectorOp<Ty, enableLocation> op(collectOp);
+        switch (axis) {
+        case NPArrayBase::ROW:
+            assert(i < self().rows() &&
+                   "index is out of bound for row access in NPArray::foreach");
+            for (size_t col = 0; col < self().cols(); col++)
+                op(self().at(i, col), i, col);
+            break;
+        case NPArrayBase::COLUMN:
+            assert(
+                i < self().cols() &&
+                "index is out of bound for column access in NPArray::foreach");
+            for (size_t row = 0; row < self().rows(); row++)
+                op(self().at(row, i), row, i);
+            break;
+        }
+        return op;
+    }
+
+    /// Applies a \p NPCollector function object to each element along axis \p
+    /// axis in the [ \p begin , \p end range of columns (resp. rows, as
+    /// specified by \p axis) of the NPArray and returns it.
+    template <template <typename, bool> class collectorOp,
+              bool enableLocation = false>
+    [[nodiscard]] std::enable_if_t<
+        isNPCollector<Ty, collectorOp, enableLocation>() &&
+            std::is_copy_constructible<collectorOp<Ty, enableLocation>>(),
+        collectorOp<
+            Ty, enableLocation>> foreach (const collectorOp<Ty, enableLocation>
+                                              &collectOp,
+                                          NPArrayBase::Axis axis, size_t begin,
+                                          size_t end) const {
+        assert(begin <= end && "begin index must be lower or equal to end "
+                               "index in NPArray::foreach");
+        collectorOp<Ty, enableLocation> op(collectOp);
+        switch (axis) {
+        case NPArrayBase::ROW:
+            assert(begin <= self().rows() &&
+                   "begin index is out of bound for row "
+                   "access in NPArray::foreach");
+            assert(
+                end <= self().rows() &&
+                "end index is out of bound for row access in NPArray::foreach");
+            for (size_t row = begin; row < end; row++)
+                for (size_t col = 0; col < self().cols(); col++)
+                    op(self().at(row, col), row, col);
+            break;
+        case NPArrayBase::COLUMN:
+            assert(begin <= self().cols() &&
+                   "begin index is out of bound for column "
+                   "access in NPArray::foreach");
+            assert(end <= self().cols() &&
+                   "end index is out of bound for column "
+                   "access in NPArray::foreach");
+            for (size_t row = 0; row < self().rows(); row++)
+                for (size_t col = begin; col < end; col++)
+                    op(self().at(row, col), row, col);
+            break;
+        }
+        return op;
+    }
+
+#define ADD_NP_COLLECTOR(fname, OpName)                                        \
+    /** Get the specific value in this NPArray. */                             \
+    Ty fname() const { return foreach (OpName<Ty, false>()).value(); }         \
+    /** Get the minimum value in this NPArray row \p i (resp. column, as       \
+     defined by \p axis ). */                                                  \
+    Ty fname(NPArrayBase::Axis axis, size_t i) const {                         \
+        return foreach (OpName<Ty, false>(), axis, i).value();                 \
+    }                                                                          \
+    /** Get the specific value in this NPArray in the range [ \p begin, \p end \
+     ( of rows (resp. columns, as defined by \p axis ). */                     \
+    Ty fname(NPArrayBase::Axis axis, size_t begin, size_t end) const {         \
+        return foreach (OpName<Ty, false>(), axis, begin, end).value();        \
+    }                                                                          \
+    /** Get the specific value in this NPArray. This variant returns           \
+     the location where the minimum was found. */                              \
+    Ty fname(size_t &row, size_t &col) const {                                 \
+        auto op = foreach (OpName<Ty, true>());                                \
+        row = op.row();                                                        \
+        col = op.col();                                                        \
+        return op.value();                                                     \
+    }                                                                          \
+    /** Get the specific value in this NPArray row \p i (resp. column, as      \
+     defined by \p axis ). This variant returns the location where the minimum \
+     was found. */                                                             \
+    Ty fname(size_t &row, size_t &col, NPArrayBase::Axis axis, size_t i)       \
+        const {                                                                \
+        auto op = foreach (OpName<Ty, true>(), axis, i);                       \
+        row = op.row();                                                        \
+        col = op.col();                                                        \
+        return op.value();                                                     \
+    }                                                                          \
+    /** Get the specific value in this NPArray in the range [ \p begin, \p end \
+     ( of rows (resp. columns, as defined by \p axis ). This variant returns   \
+     the location where the minimum was found. */                              \
+    Ty fname(size_t &row, size_t &col, NPArrayBase::Axis axis, size_t begin,   \
+             size_t end) const {                                               \
+        auto op = foreach (OpName<Ty, true>(), axis, begin, end);              \
+        row = op.row();                                                        \
+        col = op.col();                                                        \
+        return op.value();                                                     \
+    }
+
+    ADD_NP_COLLECTOR(min, Min);
+    ADD_NP_COLLECTOR(minAbs, MinAbs);
+    ADD_NP_COLLECTOR(max, Max);
+    ADD_NP_COLLECTOR(maxAbs, MaxAbs);
+
+#undef ADD_NP_COLLECTOR
+    /// @}
+
+    /// \defgroup FoldOperations Those operations fold a \p NPCollector function
+    /// object along an axis (or a subrange of it) and return a vector with the
+    /// result. This is performed in 2 steps, the first one being \p foldOp, the
+    /// second one begin the extraction of the data collected in the \p
+    /// NPCollector function objects with the \p extract method. Those 2 steps
+    /// are combined in the \p fold methods.
+    /// @{
+
+    /// Extracts the values from a range of \p unaryOperations.
+    template <template <typename, bool> class collectorOp,
+              bool enableLocation = false>
+    static std::enable_if_t<isNPCollector<Ty, collectorOp>(),
+                            NPArray<typename NPOperatorTraits<
+                                Ty, collectorOp, enableLocation>::valueType>>
+    extract(const std::vector<collectorOp<Ty, enableLocation>> &ops) {
+        if (ops.empty())
+            return NPArray<
+                typename NPOperatorTraits<Ty, collectorOp>::valueType>();
+
+        NPArray<typename NPOperatorTraits<Ty, collectorOp>::valueType> result(
+            1, ops.size());
+        std::transform(ops.begin(), ops.end(), result.begin().begin(),
+                       [&](const auto &op) { return op.value(); });
+        return result;
+    }
+
+    /// Applies a range of copy constructed \p collectorOp function objects to
+    /// all elements on each \p axis in the range [begin, end( and returns the
+    /// range of \p collectorOp.
+    template <template <typename, bool> class collectorOp,
+              bool enableLocation = false>
+    [[nodiscard]] std::enable_if_t<
+        isNPCollector<Ty, collectorOp, enableLocation>() &&
+            std::is_copy_constructible<collectorOp<Ty, enableLocation>>(),
+        std::vector<collectorOp<Ty, enableLocation>>>
+    foldOp(const collectorOp<Ty, enableLocation> &op, NPArrayBase::Axis axis,
+           size_t begin, size_t end) const {
+        assert(begin <= end && "begin index must be lower or equal to end "
+                               "index in NPArray::foldOp");
+        std::vector<collectorOp<Ty, enableLocation>> ops(end - begin, op);
+        // Each collector is only ever updated by a single thread, which
+        // processes its elements in the same order as a sequential execution
+        // would, so the results do not depend on the number of threads.
+        switch (axis) {
+        case NPArrayBase::ROW:
+            assert(begin <= self().rows() &&
+                   "begin index is out of bound for row "
+                   "access in NPArray::foldOp");
+            assert(
+                end <= self().rows() &&
+                "end index is out of bound for row access in NPArray::foldOp");
+            NPArrayBase::parallelFor(
+                begin, end, self().cols(), [&](size_t b, size_t e) {
+                    for (size_t row = b; row < e; row++)
+                        for (size_t col = 0; col < self().cols(); col++)
+                            ops[row - begin](self().at(row, col), row, col);
+                });
+            break;
+        case NPArrayBase::COLUMN:
+            assert(begin <= self().cols() &&
+                   "begin index is out of bound for column "
+                   "access in NPArray::foldOp");
+            assert(end <= self().cols() &&
+                   "end index is out of bound for column "
+                   "access in NPArray::foldOp");
+            // Split the columns between the threads, each of them walking all
+            // rows over its own slice of contiguous columns.
+            NPArrayBase::parallelFor(
+                begin, end, self().rows(), [&](size_t b, size_t e) {
+                    for (size_t row = 0; row < self().rows(); row++)
+                        for (size_t col = b; col < e; col++)
+                            ops[col - begin](self().at(row, col), row, col);
+                });
+            break;
+        }
+        return ops;
+    }
+
+    /// Applies a range of copy constructed \p collectorOp to all elements
+    /// on each \p axis of this NPArray and returns the range of
+    /// \p collectorOp.
+    template <template <typename, bool> class collectorOp,
+              bool enableLocation = false>
+    [[nodiscard]] std::enable_if_t<
+        isNPCollector<Ty, collectorOp>() &&
+            std::is_copy_constructible<collectorOp<Ty, enableLocation>>() &&
+            std::is_same<void, typename NPOperatorTraits<
+                                   Ty, collectorOp,
+                                   enableLocation>::applicationReturnType>(),
+        std::vector<collectorOp<Ty, enableLocation>>>
+    foldOp(const collectorOp<Ty, enableLocation> &op,
+           NPArrayBase::Axis axis) const {
+        return foldOp(op, axis, 0,
+                      axis == NPArrayBase::ROW ? self().rows() : self().cols());
+    }
+
+    /// Applies a default constructed \p collectorOp to all elements on axis
+    /// \p axis (row / column) \p i and returns its value.
+    template <template <typename, bool> class collectorOp,
+              bool enableLocation = false>
+    [[nodiscard]] std::enable_if_t<
+        isNPCollector<Ty, collectorOp, enableLocation>(),
+        typename NPOperatorTraits<Ty, collectorOp, enableLocation>::valueType>
+    fold(const collectorOp<Ty, enableLocation> &op, NPArrayBase::Axis axis,
+         size_t i) const {
+        return foreach (op, axis, i).value();
+    }
+
+    /// Applies a range of default constructed \p collectorOp to all elements
+    /// on each \p axis in the range [begin, end( and returns the range of
+    /// computed values.
+    template <template <typename, bool> class collectorOp,
+              bool enableLocation = false>
+    [[nodiscard]] std::enable_if_t<
+        isNPCollector<Ty, collectorOp, enableLocation>(),
+        NPArray<typename NPOperatorTraits<Ty, collectorOp,
+                                          enableLocation>::valueType>>
+    fold(const collectorOp<Ty, enableLocation> &op, NPArrayBase::Axis axis,
+         size_t begin, size_t end) const {
+        return extract(foldOp(op, axis, begin, end));
+    }
+
+    /// Applies a range of default constructed \p collectorOp to all elements
+    /// on each \p axis of this NPArray and returns the range of
+    /// computed values.
+    template <template <typename, bool> class collectorOp,
+              bool enableLocation = false>
+    [[nodiscard]] std::enable_if_t<
+        isNPCollector<Ty, collectorOp, enableLocation>(),
+        NPArray<typename NPOperatorTraits<Ty, collectorOp,
+                                          enableLocation>::valueType>>
+    fold(const collectorOp<Ty, enableLocation> &op,
+         NPArrayBase::Axis axis) const {
+        return extract(foldOp(op, axis));
+    }
+
+    /// Sum elements in an NPArray in row \p i or column \p i.
+    [[nodiscard]] Ty sum(NPArrayBase::Axis axis, size_t i) const {
+        return fold(Accumulate<Ty>(), axis, i);
+    }
+
+    /// Sum elements in an NPArray on a range of rows or columns.
+    [[nodiscard]] NPArray<Ty> sum(NPArrayBase::Axis axis, size_t begin,
+                                  size_t end) const {
+        return fold(Accumulate<Ty>(), axis, begin, end);
+    }
+
+    /// Sum elements in an NPArray along an \p axis --- for all rows/cols on
+    /// that axis.
+    [[nodiscard]] NPArray<Ty> sum(NPArrayBase::Axis axis) const {
+        return fold(Accumulate<Ty>(), axis);
+    }
+
+    /// Compute the mean on row \p i or column \p i.
+    [[nodiscard]] double mean(NPArrayBase::Axis axis, size_t i) const {
+        return fold(Mean<Ty>(), axis, i);
+    }
+
+    /// Compute the mean on a range of rows or on a range of columns.
+    [[nodiscard]] NPArray<double> mean(NPArrayBase::Axis axis, size_t begin,
+                                       size_t end) const;
+
+    /// Compute the mean on all rows or all columns.
+    [[nodiscard]] NPArray<double> mean(NPArrayBase::Axis axis) const;
+
+    /// Compute the mean on row \p i or column \p i. It also computes the
+    /// variance (taking \p ddof into account) and the standard deviation.
+    double meanWithVar(NPArrayBase::Axis axis, size_t i, double *var,
+                       double *stddev = nullptr, unsigned ddof = 0) const {
+        MeanWithVar<Ty> avg = foreach (MeanWithVar<Ty>(), axis, i);
+        if (var)
+            *var = avg.var(ddof);
+        if (stddev)
+            *stddev = avg.stddev();
+        return avg.value();
+    }
+
+    /// Compute the mean on a range of rows or on a range of columns, optionally
+    /// computing the variance (taking into account the \p ddof) and the
+    /// standard deviation.
+    NPArray<double> meanWithVar(NPArrayBase::Axis axis, size_t begin,
+                                size_t end, NPArray<double> *var,
+                                NPArray<double> *stddev = nullptr,
+                                unsigned ddof = 0) const;
+
+    /// Compute the mean on all rows or all columns. It optionally computes the
+    /// variance or the standard deviation.
+    NPArray<double> meanWithVar(NPArrayBase::Axis axis, NPArray<double> *var,
+                                NPArray<double> *stddev = nullptr,
+                                unsigned ddof = 0) const;
+    /// @}
+
+  private:
+    /// Get the Derived object these operations apply to.
+    [[nodiscard]] const Derived &self() const noexcept {
+        return static_cast<const Derived &>(*this);
+    }
+};
+
+/// NPArray is the user facing class to work with 1D or 2D numpy arrays.
+template <class Ty>
+class NPArray : public NPArrayBase, public NPArrayOps<NPArray<Ty>, Ty> {
+    friend class NPArrayOps<NPArray<Ty>, Ty>;
+
+  public:
+    using NPArrayOps<NPArray<Ty>, Ty>::extract;
+
+    /// The array elements' type.
+    using DataTy = Ty;
+
+    static_assert(std::is_arithmetic<Ty>(),
+                  "expecting an integral or floating point type");
+
+    /// Construct an empty NPArray.
+    NPArray() : NPArrayBase(sizeof(Ty)) {}
+
+    /// Construct an NPArray from data stored in file \p filename. At most \p
+    /// maxNumRows are loaded, and the data can be read or memory mapped
+    /// according to \p mode.
+    NPArray(std::string_view filename, size_t maxNumRows = -1,
+            LoadMode mode = READ)
+        : NPArrayBase(std::string(filename), getEltTyDescr<Ty>(), maxNumRows,
+                      mode) {}
+
+    /// Construct an NPArray from the \p window region of the data stored in
+    /// file \p filename. The data can be read or memory mapped according to
+    /// \p mode.
+    NPArray(std::string_view filename, const Window &window,
+            LoadMode mode = READ)
+        : NPArrayBase(std::string(filename), getEltTyDescr<Ty>(), window,
+                      mode) {}
+
+    /// Construct an NPArray from multiple files, concatenating the Matrices
+    /// along \p axis.
+    NPArray(const std::vector<std::string> &filenames, Axis axis)
+        : NPArrayBase() {
+        if (filenames.empty())
+            return;
+
+        // Get the NPArray attributes that we should expect.
+        size_t output_num_rows;
+        size_t output_num_cols;
+        bool first = true;
+        for (const auto &filename : filenames) {
+            std::ifstream ifs(filename, std::ifstream::binary);
+            if (!ifs) {
+                setError("Could not open file to get target matrix attributes");
+                return;
+            }
+
+            size_t l_num_rows;
+            size_t l_num_cols;
+            std::string l_elt_ty;
+            size_t l_elt_size;
+            const char *l_errstr;
+            if (!getInformation(ifs, l_num_rows, l_num_cols, l_elt_ty,
+                                l_elt_size, &l_errstr)) {
+                setError(l_errstr);
+                return;
+            }
+
+            if (l_elt_ty != getEltTyDescr<Ty>() || l_elt_size != sizeof(Ty)) {
+                setError("Error element type mismatch in the matrix to "
+                         "concatenate");
+                return;
+            }
+
+            if (first) {
+                output_num_rows = l_num_rows;
+                output_num_cols = l_num_cols;
+                first = false;
+            } else {
+                switch (axis) {
+                case NPArrayBase::COLUMN:
+                    output_num_rows += l_num_rows;
+                    if (output_num_cols != l_num_cols) {
+                        setError("Can not concatenate along the Column axis "
+                                 "matrices with different column numbers");
+                        return;
+                    }
+                    break;
+                case NPArrayBase::ROW:
+                    output_num_cols += l_num_cols;
+                    if (output_num_rows != l_num_rows) {
+                        setError(
+                            "Can not concatenate along the Row axis matrices "
+                            "with different row numbers");
+                        return;
+                    }
+                    break;
+                }
+            }
+        }
+
+        NPArrayBase tmp(filenames, axis, getEltTyDescr<Ty>(), output_num_rows,
+                        output_num_cols, sizeof(Ty));
+
+        if (tmp.good())
+            *static_cast<NPArrayBase *>(this) = std::move(tmp);
+        else
+            setError(tmp.error());
+    }
+
+    /// Read an NPArray from file \p filename and convert each of its elements
+    /// to \p Ty if need be. This does not affect the Matrix shape or number of
+    /// elements, only their type. The type conversion to smaller types may
+    /// truncate some information. Files with a non-native endianness are
+    /// supported.
+    static NPArray readAs(const std::string &filename, size_t maxNumRows = -1) {
+        return readAs(filename, Window(0, maxNumRows));
+    }
+
+    /// Read the \p window region of the NPArray in file \p filename, and
+    /// convert each of its elements to \p Ty if need be. Only the data in \p
+    /// window are read from the file.
+    static NPArray readAs(const std::string &filename, const Window &window) {
+        if (filename.empty())
+            return NPArray(0, 0);
+
+        const char *l_errstr;
+        Window lw = window;
+        std::unique_ptr<std::istream> is =
+            openStream(filename, lw, nullptr, &l_errstr);
+        if (!is) {
+            NPArray res(0, 0);
+            res.setError(l_errstr);
+            return res;
+        }
+        std::istream &ifs = *is;
+
+        size_t num_rows;
+        size_t num_cols;
+        std::string elt_ty;
+        size_t elt_size;
+        bool swap;
+        bool fortran;
+        if (!getInformation(ifs, num_rows, num_cols, elt_ty, elt_size,
+                            &l_errstr, &swap, &fortran)) {
+            NPArray res(0, 0);
+            res.setError(l_errstr);
+            return res;
+        }
+
+        const Window w = lw.clamp(num_rows, num_cols);
+        const size_t offset = ifs.tellg();
+        NPArray result(w.rows(), w.cols());
+        Ty *data = result.rowData(0);
+
+        bool ok = false;
+        switch (elt_ty[0]) {
+        case 'i':
+            switch (elt_ty[1]) {
+            case '1':
+                ok = readWindow<int8_t>(ifs, offset, data, w, num_rows,
+                                        num_cols, swap, fortran);
+                break;
+            case '2':
+                ok = readWindow<int16_t>(ifs, offset, data, w, num_rows,
+                                         num_cols, swap, fortran);
+                break;
+            case '4':
+                ok = readWindow<int32_t>(ifs, offset, data, w, num_rows,
+                                         num_cols, swap, fortran);
                 break;
             case '8':
-                for (size_t i = 0; i < num_elt; i++) {
-                    int64_t tmp;
-                    ifs.read(reinterpret_cast<char *>(&tmp), elt_size);
-                    data[i] = static_cast<Ty>(tmp);
-                }
+                ok = readWindow<int64_t>(ifs, offset, data, w, num_rows,
+                                         num_cols, swap, fortran);
                 break;
             default: {
                 NPArray res(0, 0);
@@ -485,32 +1481,20 @@ template <class Ty> class NPArray : public NPArrayBase {
         case 'u':
             switch (elt_ty[1]) {
             case '1':
-                for (size_t i = 0; i < num_elt; i++) {
-                    uint8_t tmp;
-                    ifs.read(reinterpret_cast<char *>(&tmp), elt_size);
-                    data[i] = static_cast<Ty>(tmp);
-                }
+                ok = readWindow<uint8_t>(ifs, offset, data, w, num_rows,
+                                         num_cols, swap, fortran);
                 break;
             case '2':
-                for (size_t i = 0; i < num_elt; i++) {
-                    uint16_t tmp;
-                    ifs.read(reinterpret_cast<char *>(&tmp), elt_size);
-                    data[i] = static_cast<Ty>(tmp);
-                }
+                ok = readWindow<uint16_t>(ifs, offset, data, w, num_rows,
+                                          num_cols, swap, fortran);
                 break;
             case '4':
-                for (size_t i = 0; i < num_elt; i++) {
-                    uint32_t tmp;
-                    ifs.read(reinterpret_cast<char *>(&tmp), elt_size);
-                    data[i] = static_cast<Ty>(tmp);
-                }
+                ok = readWindow<uint32_t>(ifs, offset, data, w, num_rows,
+                                          num_cols, swap, fortran);
                 break;
             case '8':
-                for (size_t i = 0; i < num_elt; i++) {
-                    uint64_t tmp;
-                    ifs.read(reinterpret_cast<char *>(&tmp), elt_size);
-                    data[i] = static_cast<Ty>(tmp);
-                }
+                ok = readWindow<uint64_t>(ifs, offset, data, w, num_rows,
+                                          num_cols, swap, fortran);
                 break;
             default: {
                 NPArray res(0, 0);
@@ -523,18 +1507,12 @@ template <class Ty> class NPArray : public NPArrayBase {
         case 'f':
             switch (elt_ty[1]) {
             case '4':
-                for (size_t i = 0; i < num_elt; i++) {
-                    float tmp;
-                    ifs.read(reinterpret_cast<char *>(&tmp), elt_size);
-                    data[i] = static_cast<Ty>(tmp);
-                }
+                ok = readWindow<float>(ifs, offset, data, w, num_rows, num_cols,
+                                       swap, fortran);
                 break;
             case '8':
-                for (size_t i = 0; i < num_elt; i++) {
-                    double tmp;
-                    ifs.read(reinterpret_cast<char *>(&tmp), elt_size);
-                    data[i] = static_cast<Ty>(tmp);
-                }
+                ok = readWindow<double>(ifs, offset, data, w, num_rows,
+                                        num_cols, swap, fortran);
                 break;
             default: {
                 NPArray res(0, 0);
@@ -551,15 +1529,19 @@ template <class Ty> class NPArray : public NPArrayBase {
         }
         }
 
-        return NPArray(std::move(data), num_rows, num_cols);
+        if (!ok) {
+            NPArray res(0, 0);
+            res.setError("Error reading data from numpy file");
+            return res;
+        }
+
+        return result;
     }
 
     /// Construct an uninitialized NPArray with \p num_rows rows and \p
     /// num_columns columns.
     NPArray(size_t num_rows, size_t num_columns)
-        : NPArrayBase(std::unique_ptr<char[]>(
-                          new char[num_rows * num_columns * sizeof(Ty)]),
-                      num_rows, num_columns, sizeof(Ty)) {}
+        : NPArrayBase(nullptr, num_rows, num_columns, sizeof(Ty)) {}
 
     /// Construct an NPArray from memory (std::unique_ptr version) with \p
     /// num_rows rows and \p num_columns columns.
@@ -587,6 +1569,29 @@ template <class Ty> class NPArray : public NPArrayBase {
     /// Construct an NPArray from a vector<vector<Ty>>.
     NPArray(const std::vector<std::vector<Ty>> &matrix) : NPArrayBase(matrix) {}
 
+    /// Construct an NPArray by evaluating the element-wise expression \p expr,
+    /// in a single pass over the elements and without any intermediate
+    /// NPArray.
+    template <class Expr,
+              std::enable_if_t<isNPExpression<Expr>() &&
+                                   std::is_same_v<typename Expr::DataTy, Ty>,
+                               bool> = true>
+    NPArray(const Expr &expr) : NPArray(expr.rows(), expr.cols()) {
+        for (size_t r = 0; r < rows(); r++) {
+            Ty *dst = rowData(r);
+            for (size_t c = 0; c < cols(); c++)
+                dst[c] = expr(r, c);
+        }
+    }
+
+    /// Construct an NPArray with a copy of the elements seen through \p view.
+    explicit NPArray(const NPArrayView<Ty> &view)
+        : NPArray(view.rows(), view.cols()) {
+        for (size_t r = 0; r < rows(); r++)
+            for (size_t c = 0; c < cols(); c++)
+                at(r, c) = view(r, c);
+    }
+
     /// Copy construct an NParray.
     NPArray(const NPArray &Other) : NPArrayBase(Other) {}
 
@@ -659,6 +1664,12 @@ template <class Ty> class NPArray : public NPArrayBase {
         return *this;
     }
 
+    /// Transpose this Matrix.
+    NPArray &transpose() {
+        this->NPArrayBase::transpose();
+        return *this;
+    }
+
     /// Get a new NPArray, generated from the rows (resp. columns, according to
     /// \p axis ) matching \p indices , in the order where the indices were
     /// supplied.
@@ -742,14 +1753,49 @@ template <class Ty> class NPArray : public NPArrayBase {
         os.flags(saved_flags);
     }
 
-    /// Save to file \p filename in NPY format.
-    [[nodiscard]] bool  save(std::string_view filename) const {
-        return this->NPArrayBase::save(filename, descr());
+    /// Save to file \p filename, in Fortran-order if \p fortran_order is
+    /// set. The file format (NPY, NPZ, NPYZ or NPYT) is selected from the \p
+    /// filename extension.
+    [[nodiscard]] bool save(std::string_view filename,
+                            bool fortran_order = false) const {
+        return this->NPArrayBase::save(filename, descr(), fortran_order);
+    }
+
+    /// Save to NPZ archive \p filename, in Fortran-order if \p
+    /// fortran_order is set.
+    [[nodiscard]] bool saveNPZ(std::string_view filename,
+                               bool fortran_order = false) const {
+        return this->NPArrayBase::saveNPZ(filename, descr(), fortran_order);
     }
 
-    /// Save to output file stream \p os in NPY format.
-    bool save(std::ofstream &os) const {
-        return this->NPArrayBase::save(os, descr());
+    /// Save to NPYZ file \p filename, compressing the rows by blocks of \p
+    /// block_rows rows (or of about 1MB if \p block_rows is 0).
+    [[nodiscard]] bool saveNPYZ(std::string_view filename,
+                                size_t block_rows = 0) const {
+        return this->NPArrayBase::saveNPYZ(filename, descr(), block_rows);
+    }
+
+    /// Save to NPYT file \p filename, by tiles of \p tile_rows x \p
+    /// tile_cols elements (4096 x 256 for 0 values), zlib compressed if \p
+    /// compress is set.
+    [[nodiscard]] bool saveNPYT(std::string_view filename, size_t tile_rows = 0,
+                                size_t tile_cols = 0,
+                                bool compress = true) const {
+        return this->NPArrayBase::saveNPYT(filename, descr(), tile_rows,
+                                           tile_cols, compress);
+    }
+
+    /// Save to output file stream \p os in NPY format, in Fortran-order if
+    /// \p fortran_order is set.
+    bool save(std::ofstream &os, bool fortran_order = false) const {
+        return this->NPArrayBase::save(os, descr(), fortran_order);
+    }
+
+    /// Save to output file stream \p os the NPY header for a \p num_rows x
+    /// \p num_columns matrix, which rows will then be saved with saveData.
+    [[nodiscard]] static bool saveHeader(std::ostream &os, size_t num_rows,
+                                         size_t num_columns) {
+        return NPArrayBase::saveHeader(os, descr(), num_rows, num_columns);
     }
 
     /// The Row class is an adapter around an NPArray to provide a view
@@ -862,456 +1908,52 @@ template <class Ty> class NPArray : public NPArrayBase {
         /// Is this row empty ?
         [[nodiscard]] bool empty() const noexcept { return nparray->empty(); }
 
-      private:
-        NPArrayTy *nparray; ///< The NPArray this row refers to.
-        size_t row;         ///< row index in the NPArray.
-        size_t initRow;     ///< The row index used at construction.
-    };
-
-    using Row = RowIterator<NPArray<Ty>>;
-    using const_Row = RowIterator<const NPArray<Ty>>;
-
-    /// Get the i'th row (default: first) from this NPArray.
-    Row begin(size_t i = 0) noexcept { return Row(*this, i); }
-
-    /// Get a past-the-end row for this NPArray.
-    Row end() noexcept { return Row(*this, rows()); }
-
-    /// Get the first row from this NPArray (const version).
-    [[nodiscard]] const_Row cbegin(size_t i = 0) const noexcept {
-        return const_Row(*this, i);
-    }
-
-    /// Get a past-the-end row for this NPArray (const version).
-    [[nodiscard]] const_Row cend() const noexcept {
-        return const_Row(*this, rows());
-    }
-
-    /// \defgroup Predicates Predicate operations on NParrays
-    /// @{
-    /// Test if all elements in this NPArray satisfy predicate \p pred.
-    template <class predicate> bool all(predicate &&pred) const {
-        if (empty())
-            return false;
-        for (size_t row = 0; row < rows(); row++)
-            for (size_t col = 0; col < cols(); col++)
-                if (!pred(at(row, col)))
-                    return false;
-        return true;
-    }
-
-    /// Test if all elements in row \p i or column \p i satisfy predicate
-    /// \p pred.
-    template <class predicate>
-    [[nodiscard]] bool all(const predicate &pred, Axis axis, size_t i) const {
-        switch (axis) {
-        case ROW:
-            assert(i <= rows() &&
-                   "index is out of bound for row access in NPArray::all");
-            for (size_t col = 0; col < cols(); col++)
-                if (!pred(at(i, col)))
-                    return false;
-            return true;
-        case COLUMN:
-            assert(i <= cols() &&
-                   "index is out of bound column access in NPArray::all");
-            for (size_t row = 0; row < rows(); row++)
-                if (!pred(at(row, i)))
-                    return false;
-            return true;
-        }
-    }
-
-    /// Test if all elements in the range [ \p begin , \p end ( on \p axis
-    /// satisfy predicate \p pred.
-    template <class predicate>
-    [[nodiscard]] bool all(const predicate &pred, Axis axis, size_t begin,
-                           size_t end) const {
-        assert(begin <= end && "range's end needs to be strictly greater "
-                               "than begin in NPArray::all");
-        if (begin >= end)
-            return false;
-        switch (axis) {
-        case ROW:
-            assert(
-                begin <= rows() &&
-                "begin index is out of bound for row access in NPArray::all");
-            assert(end <= rows() &&
-                   "end index is out of bound for row access in NPArray::all");
-            for (size_t row = begin; row < end; row++)
-                for (size_t col = 0; col < cols(); col++)
-                    if (!pred(at(row, col)))
-                        return false;
-            return true;
-        case COLUMN:
-            assert(begin <= cols() && "begin index is out of bound for column "
-                                      "access in NPArray::all");
-            assert(
-                end <= cols() &&
-                "end index is out of bound for column access in NPArray::all");
-            for (size_t row = 0; row < rows(); row++)
-                for (size_t col = begin; col < end; col++)
-                    if (!pred(at(row, col)))
-                        return false;
-            return true;
-        }
-    }
-
-    /// Test if any of the elements in this NPArray satisfy predicate \p pred.
-    template <class predicate>
-    [[nodiscard]] bool any(const predicate &pred) const {
-        if (empty())
-            return false;
-        for (size_t row = 0; row < rows(); row++)
-            for (size_t col = 0; col < cols(); col++)
-                if (pred(at(row, col)))
-                    return true;
-        return false;
-    }
-
-    /// Test if any of the elements in row \p i or column \p i satisfy predicate
-    /// \p pred.
-    template <class predicate>
-    [[nodiscard]] bool any(const predicate &pred, Axis axis, size_t i) const {
-        switch (axis) {
-        case ROW:
-            assert(i <= rows() &&
-                   "index is out of bound for row access in NPArray::any");
-            for (size_t col = 0; col < cols(); col++)
-                if (pred(at(i, col)))
-                    return true;
-            return false;
-        case COLUMN:
-            assert(i <= cols() &&
-                   "index is out of bound column access in NPArray::any");
-            for (size_t row = 0; row < rows(); row++)
-                if (pred(at(row, i)))
-                    return true;
-            return false;
-        }
-    }
-
-    /// Test if any of the elements in the range [ \p begin , \p end ( on \p
-    /// axis satisfy predicate \p pred.
-    template <class predicate>
-    [[nodiscard]] bool any(const predicate &pred, Axis axis, size_t begin,
-                           size_t end) const {
-        assert(begin <= end && "range's end needs to be strictly greater "
-                               "than begin in NPArray::all");
-        if (begin >= end)
-            return false;
-        switch (axis) {
-        case ROW:
-            assert(
-                begin <= rows() &&
-                "begin index is out of bound for row access in NPArray::any");
-            assert(end <= rows() &&
-                   "end index is out of bound for row access in NPArray::any");
-            for (size_t row = begin; row < end; row++)
-                for (size_t col = 0; col < cols(); col++)
-                    if (pred(at(row, col)))
-                        return true;
-            return false;
-        case COLUMN:
-            assert(begin <= cols() && "begin index is out of bound for column "
-                                      "access in NPArray::any");
-            assert(
-                end <= cols() &&
-                "end index is out of bound for column access in NPArray::any");
-            for (size_t row = 0; row < rows(); row++)
-                for (size_t col = begin; col < end; col++)
-                    if (pred(at(row, col)))
-                        return true;
-            return false;
-        }
-    }
-
-    /// Test if none of the elements in this NPArray satisfy predicate \p pred.
-    template <class predicate>
-    [[nodiscard]] bool none(const predicate &pred) const {
-        if (empty())
-            return false;
-        for (size_t row = 0; row < rows(); row++)
-            for (size_t col = 0; col < cols(); col++)
-                if (pred(at(row, col)))
-                    return false;
-        return true;
-    }
-
-    /// Test if none of the elements in row \p i or column \p i satisfy
-    /// predicate \p pred.
-    template <class predicate>
-    [[nodiscard]] bool none(const predicate &pred, Axis axis, size_t i) const {
-        switch (axis) {
-        case ROW:
-            assert(i <= rows() &&
-                   "index is out of bound for row access in NPArray::none");
-            for (size_t col = 0; col < cols(); col++)
-                if (pred(at(i, col)))
-                    return false;
-            return true;
-        case COLUMN:
-            assert(i <= cols() &&
-                   "index is out of bound column access in NPArray::none");
-            for (size_t row = 0; row < rows(); row++)
-                if (pred(at(row, i)))
-                    return false;
-            return true;
-        }
-    }
-
-    /// Test if none of the elements in the range [ \p begin , \p end ( on \p
-    /// axis satisfy predicate \p pred.
-    template <class predicate>
-    [[nodiscard]] bool none(const predicate &pred, Axis axis, size_t begin,
-                            size_t end) const {
-        assert(begin <= end && "range's end needs to be strictly greater "
-                               "than begin in NPArray::none");
-        if (begin >= end)
-            return false;
-        switch (axis) {
-        case ROW:
-            assert(
-                begin <= rows() &&
-                "begin index is out of bound for row access in NPArray::none");
-            assert(end <= rows() &&
-                   "end index is out of bound for row access in NPArray::none");
-            for (size_t row = begin; row < end; row++)
-                for (size_t col = 0; col < cols(); col++)
-                    if (pred(at(row, col)))
-                        return false;
-            return true;
-        case COLUMN:
-            assert(begin <= cols() && "begin index is out of bound for column "
-                                      "access in NPArray::none");
-            assert(
-                end <= cols() &&
-                "end index is out of bound for column access in NPArray::none");
-            for (size_t row = 0; row < rows(); row++)
-                for (size_t col = begin; col < end; col++)
-                    if (pred(at(row, col)))
-                        return false;
-            return true;
-        }
-    }
-
-    /// Count how many of the elements in this NPArray satisfy predicate \p
-    /// pred.
-    template <class predicate>
-    [[nodiscard]] size_t count(const predicate &pred) const {
-        size_t cnt = 0;
-        if (empty())
-            return cnt;
-        for (size_t row = 0; row < rows(); row++)
-            for (size_t col = 0; col < cols(); col++)
-                if (pred(at(row, col)))
-                    cnt += 1;
-        return cnt;
-    }
+        /// Get the NPArray this row refers to.
+        [[nodiscard]] NPArrayTy &array() const noexcept { return *nparray; }
 
-    /// Count how many of the elements in row \p i or column \p i satisfy
-    /// predicate \p pred.
-    template <class predicate>
-    [[nodiscard]] size_t count(const predicate &pred, Axis axis,
-                               size_t i) const {
-        size_t cnt = 0;
-        switch (axis) {
-        case ROW:
-            assert(i <= rows() &&
-                   "index is out of bound for row access in NPArray::count");
-            for (size_t col = 0; col < cols(); col++)
-                if (pred(at(i, col)))
-                    cnt += 1;
-            return cnt;
-        case COLUMN:
-            assert(i <= cols() &&
-                   "index is out of bound column access in NPArray::count");
-            for (size_t row = 0; row < rows(); row++)
-                if (pred(at(row, i)))
-                    cnt += 1;
-            return cnt;
-        }
-    }
+        /// Get the index of the current row in the NPArray.
+        [[nodiscard]] size_t index() const noexcept { return row; }
 
-    /// Count how many of the elements in the range [ \p begin , \p end ( on \p
-    /// axis satisfy predicate \p pred.
-    template <class predicate>
-    [[nodiscard]] size_t count(const predicate &pred, Axis axis, size_t begin,
-                               size_t end) const {
-        assert(begin <= end && "range's end needs to be strictly greater "
-                               "than begin in NPArray::count");
-        size_t cnt = 0;
-        if (begin >= end)
-            return cnt;
-        switch (axis) {
-        case ROW:
-            assert(
-                begin <= rows() &&
-                "begin index is out of bound for row access in NPArray::count");
-            assert(
-                end <= rows() &&
-                "end index is out of bound for row access in NPArray::count");
-            for (size_t row = begin; row < end; row++)
-                for (size_t col = 0; col < cols(); col++)
-                    if (pred(at(row, col)))
-                        cnt += 1;
-            return cnt;
-        case COLUMN:
-            assert(begin <= cols() && "begin index is out of bound for column "
-                                      "access in NPArray::count");
-            assert(end <= cols() && "end index is out of bound for column "
-                                    "access in NPArray::count");
-            for (size_t row = 0; row < rows(); row++)
-                for (size_t col = begin; col < end; col++)
-                    if (pred(at(row, col)))
-                        cnt += 1;
-            return cnt;
-        }
-    }
-    /// @}
+      private:
+        NPArrayTy *nparray; ///< The NPArray this row refers to.
+        size_t row;         ///< row index in the NPArray.
+        size_t initRow;     ///< The row index used at construction.
+    };
 
-    /// \defgroup Collectors Collect some metric (e.g. min, max, ...), passed as
-    /// an \p NPCollector function object, optionally including the row / col
-    /// information over each element of an NPArray (or a selected range of it)
-    /// and return it. The NPCollector object must be copyable.
-    /// @{
+    using Row = RowIterator<NPArray<Ty>>;
+    using const_Row = RowIterator<const NPArray<Ty>>;
 
-    /// Applies a \p NPCollector function object to each element of the
-    /// NPArray and returns it.
-    template <template <typename, bool> class collectorOp,
-              bool enableLocation = false>
-    [[nodiscard]] std::enable_if_t<
-        isNPCollector<Ty, collectorOp, enableLocation>() &&
-            std::is_copy_constructible<collectorOp<Ty, enableLocation>>(),
-        collectorOp<
-            Ty, enableLocation>> foreach (const collectorOp<Ty, enableLocation>
-                                              &collectOp) const {
-        collectorOp<Ty, enableLocation> op(collectOp);
-        for (size_t row = 0; row < rows(); row++)
-            for (size_t col = 0; col < cols(); col++)
-                op(at(row, col), row, col);
-        return op;
-    }
+    /// Get the i'th row (default: first) from this NPArray.
+    Row begin(size_t i = 0) noexcept { return Row(*this, i); }
 
-    /// Applies a \p NPCollector function object to each element in the \p i'th
-    /// row (resp. column) as specified by \p axis in the NPArray and returns
-    /// it.
-    template <template <typename, bool> class collectorOp,
-              bool enableLocation = false>
-    [[nodiscard]] std::enable_if_t<
-        isNPCollector<Ty, collectorOp, enableLocation>() &&
-            std::is_copy_constructible<collectorOp<Ty, enableLocation>>(),
-        collectorOp<
-            Ty, enableLocation>> foreach (const collectorOp<Ty, enableLocation>
-                                              &collectOp,
-                                          Axis axis, size_t i) const {
-        collectorOp<Ty, enableLocation> op(collectOp);
-        switch (axis) {
-        case ROW:
-            assert(i < rows() &&
-                   "index is out of bound for row access in NPArray::foreach");
-            for (size_t col = 0; col < cols(); col++)
-                op(at(i, col), i, col);
-            break;
-        case COLUMN:
-            assert(
-                i < cols() &&
-                "index is out of bound for column access in NPArray::foreach");
-            for (size_t row = 0; row < rows(); row++)
-                op(at(row, i), row, i);
-            break;
-        }
-        return op;
-    }
+    /// Get a past-the-end row for this NPArray.
+    Row end() noexcept { return Row(*this, rows()); }
 
-    /// Applies a \p NPCollector function object to each element along axis \p
-    /// axis in the [ \p begin , \p end range of columns (resp. rows, as
-    /// specified by \p axis) of the NPArray and returns it.
-    template <template <typename, bool> class collectorOp,
-              bool enableLocation = false>
-    [[nodiscard]] std::enable_if_t<
-        isNPCollector<Ty, collectorOp, enableLocation>() &&
-            std::is_copy_constructible<collectorOp<Ty, enableLocation>>(),
-        collectorOp<
-            Ty, enableLocation>> foreach (const collectorOp<Ty, enableLocation>
-                                              &collectOp,
-                                          Axis axis, size_t begin,
-                                          size_t end) const {
-        assert(begin <= end && "begin index must be lower or equal to end "
-                               "index in NPArray::foreach");
-        collectorOp<Ty, enableLocation> op(collectOp);
-        switch (axis) {
-        case ROW:
-            assert(begin <= rows() && "begin index is out of bound for row "
-                                      "access in NPArray::foreach");
-            assert(
-                end <= rows() &&
-                "end index is out of bound for row access in NPArray::foreach");
-            for (size_t row = begin; row < end; row++)
-                for (size_t col = 0; col < cols(); col++)
-                    op(at(row, col), row, col);
-            break;
-        case COLUMN:
-            assert(begin <= cols() && "begin index is out of bound for column "
-                                      "access in NPArray::foreach");
-            assert(end <= cols() && "end index is out of bound for column "
-                                    "access in NPArray::foreach");
-            for (size_t row = 0; row < rows(); row++)
-                for (size_t col = begin; col < end; col++)
-                    op(at(row, col), row, col);
-            break;
-        }
-        return op;
+    /// Get the first row from this NPArray (const version).
+    [[nodiscard]] const_Row cbegin(size_t i = 0) const noexcept {
+        return const_Row(*this, i);
     }
 
-#define ADD_NP_COLLECTOR(fname, OpName)                                        \
-    /** Get the specific value in this NPArray. */                             \
-    Ty fname() const { return foreach (OpName<Ty, false>()).value(); }         \
-    /** Get the minimum value in this NPArray row \p i (resp. column, as       \
-     defined by \p axis ). */                                                  \
-    Ty fname(Axis axis, size_t i) const {                                      \
-        return foreach (OpName<Ty, false>(), axis, i).value();                 \
-    }                                                                          \
-    /** Get the specific value in this NPArray in the range [ \p begin, \p end \
-     ( of rows (resp. columns, as defined by \p axis ). */                     \
-    Ty fname(Axis axis, size_t begin, size_t end) const {                      \
-        return foreach (OpName<Ty, false>(), axis, begin, end).value();        \
-    }                                                                          \
-    /** Get the specific value in this NPArray. This variant returns           \
-     the location where the minimum was found. */                              \
-    Ty fname(size_t &row, size_t &col) const {                                 \
-        auto op = foreach (OpName<Ty, true>());                                \
-        row = op.row();                                                        \
-        col = op.col();                                                        \
-        return op.value();                                                     \
-    }                                                                          \
-    /** Get the specific value in this NPArray row \p i (resp. column, as      \
-     defined by \p axis ). This variant returns the location where the minimum \
-     was found. */                                                             \
-    Ty fname(size_t &row, size_t &col, Axis axis, size_t i) const {            \
-        auto op = foreach (OpName<Ty, true>(), axis, i);                       \
-        row = op.row();                                                        \
-        col = op.col();                                                        \
-        return op.value();                                                     \
-    }                                                                          \
-    /** Get the specific value in this NPArray in the range [ \p begin, \p end \
-     ( of rows (resp. columns, as defined by \p axis ). This variant returns   \
-     the location where the minimum was found. */                              \
-    Ty fname(size_t &row, size_t &col, Axis axis, size_t begin, size_t end)    \
-        const {                                                                \
-        auto op = foreach (OpName<Ty, true>(), axis, begin, end);              \
-        row = op.row();                                                        \
-        col = op.col();                                                        \
-        return op.value();                                                     \
+    /// Get a past-the-end row for this NPArray (const version).
+    [[nodiscard]] const_Row cend() const noexcept {
+        return const_Row(*this, rows());
     }
 
-    ADD_NP_COLLECTOR(min, Min);
-    ADD_NP_COLLECTOR(minAbs, MinAbs);
-    ADD_NP_COLLECTOR(max, Max);
-    ADD_NP_COLLECTOR(maxAbs, MaxAbs);
+    /// Get a view on the complete NPArray.
+    [[nodiscard]] NPArrayView<Ty> view() const noexcept {
+        return NPArrayView<Ty>(*this);
+    }
 
-#undef ADD_NP_COLLECTOR
-    /// @}
+    /// Get a view on rows [ \p row_begin, \p row_end ( and columns [ \p
+    /// col_begin, \p col_end ( of this NPArray, only retaining one row (resp.
+    /// column) every \p row_stride (resp. \p col_stride).
+    [[nodiscard]] NPArrayView<Ty> view(size_t row_begin, size_t row_end,
+                                       size_t col_begin, size_t col_end,
+                                       size_t row_stride = 1,
+                                       size_t col_stride = 1) const noexcept {
+        return NPArrayView<Ty>(*this, row_begin, row_end, col_begin, col_end,
+                               row_stride, col_stride);
+    }
 
     /// \defgroup SelfApply Modifies this NPArray by replacing each element with
     /// the result of the application of \p NPUnaryOperator function object to
@@ -1326,8 +1968,7 @@ template <class Ty> class NPArray : public NPArrayBase {
                          std::is_copy_constructible<unaryOperation<Ty>>(),
                      NPArray &>
     apply(const unaryOperation<Ty> &op) {
-        for (size_t idx = 0; idx < size(); idx++)
-            at(idx) = op(at(idx));
+        applyKernel(rowData(0), size(), op);
         return *this;
     }
 
@@ -1342,6 +1983,14 @@ template <class Ty> class NPArray : public NPArrayBase {
 
     /// Convert all elements in this NPArray to their square root value.
     NPArray &sqrt() noexcept { return apply(Sqrt<Ty>()); }
+
+    /// Convert all elements in this NPArray to their Hamming weight, masked
+    /// with \p mask.
+    template <typename T = Ty>
+    std::enable_if_t<std::is_unsigned_v<T>, NPArray &>
+    hammingWeight(Ty mask = std::numeric_limits<Ty>::max()) noexcept {
+        return apply(HammingWeight<Ty>(mask));
+    }
     /// @}
 
     /// \defgroup ScalarApply Modifies this NPArray by replacing each element
@@ -1357,8 +2006,7 @@ template <class Ty> class NPArray : public NPArrayBase {
                          std::is_copy_constructible<binaryOperation<Ty>>(),
                      NPArray &>
     apply(const binaryOperation<Ty> &op, const Ty &rhs) {
-        for (size_t idx = 0; idx < size(); idx++)
-            at(idx) = op(at(idx), rhs);
+        applyKernel(rowData(0), size(), op, rhs);
         return *this;
     }
 
@@ -1372,6 +2020,14 @@ template <class Ty> class NPArray : public NPArrayBase {
     NPArray &operator/=(const Ty &rhs) { return apply(Divide<Ty>(), rhs); }
     /// In-place absolute difference of this NPArray and the scalar \p v.
     NPArray &absdiff(const Ty &rhs) { return apply(AbsDiff<Ty>(), rhs); }
+    /// In-place Hamming distance of this NPArray and the scalar \p rhs,
+    /// masked with \p mask.
+    template <typename T = Ty>
+    std::enable_if_t<std::is_unsigned_v<T>, NPArray &>
+    hammingDistance(const Ty &rhs,
+                    Ty mask = std::numeric_limits<Ty>::max()) noexcept {
+        return apply(HammingDistance<Ty>(mask), rhs);
+    }
     /// @}
 
     /// \defgroup MatrixApply Those operations modifies this NPArray by
@@ -1402,345 +2058,230 @@ template <class Ty> class NPArray : public NPArrayBase {
             ((rhs.rows() == 1 ? 1 : 0) << 1) | ((rhs.cols() == 1 ? 1 : 0) << 0);
         switch (k) {
         case 0x0: // this: matrix + rhs: matrix -> matrix
-            for (size_t idx = 0; idx < size(); idx++)
-                at(idx) = op(at(idx), rhs.at(idx));
+        case 0x5: // this: | + rhs: | -> |
+        case 0xa: // this: - + rhs: - -> -
+        case 0xf: // this: scalar + rhs: scalar -> scalar
+            applyKernel(rowData(0), rhs.rowData(0), size(), op);
             break;
         case 0x1: // this: matrix + rhs: | -> matrix
             for (size_t row = 0; row < rows(); row++)
-                for (size_t col = 0; col < cols(); col++)
-                    at(row, col) = op(at(row, col), rhs.at(row, 0));
+                applyKernel(rowData(row), cols(), op, rhs.at(row, 0));
             break;
         case 0x2: // this: matrix + rhs: - -> matrix
             for (size_t row = 0; row < rows(); row++)
-                for (size_t col = 0; col < cols(); col++)
-                    at(row, col) = op(at(row, col), rhs.at(0, col));
+                applyKernel(rowData(row), rhs.rowData(0), cols(), op);
             break;
         case 0x3: // this: matrix + rhs: scalar -> matrix
-        {
-            const DataTy tmp = rhs.at(0, 0);
-            for (size_t idx = 0; idx < size(); idx++)
-                at(idx) = op(at(idx), tmp);
+        case 0x7: // this: | + rhs: scalar -> |
+        case 0xb: // this: - + rhs: scalar -> -
+            applyKernel(rowData(0), size(), op, rhs.at(0, 0));
             break;
-        }
         case 0x4: // this: | + rhs: matrix -> matrix
         {
-            NPArray tmp(*this);
+            const NPArray tmp(*this);
             *this = rhs;
             for (size_t row = 0; row < rows(); row++)
-                for (size_t col = 0; col < cols(); col++)
-                    at(row, col) = op(tmp.at(row, 0), at(row, col));
+                applyKernel(tmp.at(row, 0), rowData(row), cols(), op);
             break;
         }
-        case 0x5: // this: | + rhs: | -> |
-            for (size_t row = 0; row < rows(); row++)
-                at(row, 0) = op(at(row, 0), rhs.at(row, 0));
-            break;
         case 0x6: // this: | + rhs: -   !!!!!!
             assert(0 && "Unhandled case in NP::apply, can not combine a single "
                         "row with a single column");
             break;
-        case 0x7: // this: | + rhs: scalar -> |
-            for (size_t row = 0; row < rows(); row++)
-                at(row, 0) = op(at(row, 0), rhs.at(0, 0));
-            break;
         case 0x8: // this: - + rhs: matrix -> matrix
         {
-            NPArray tmp(*this);
+            const NPArray tmp(*this);
             *this = rhs;
             for (size_t row = 0; row < rows(); row++)
-                for (size_t col = 0; col < cols(); col++)
-                    at(row, col) = op(tmp.at(0, col), at(row, col));
+                applyKernel(tmp.rowData(0), rowData(row), cols(), op);
             break;
         }
         case 0x9: // this: - + rhs: | !!!!!!
             assert(0 && "Unhandled case in NP::apply, can not combine a single "
                         "row with a single column");
             break;
-        case 0xa: // this: - + rhs: - -> -
-            for (size_t col = 0; col < cols(); col++)
-                at(0, col) = op(at(0, col), rhs.at(0, col));
-            break;
-        case 0xb: // this: - + rhs: scalar -> -
-            for (size_t col = 0; col < cols(); col++)
-                at(0, col) = op(at(0, col), rhs.at(0, 0));
-            break;
         case 0xc: // this: scalar + rhs: matrix -> matrix
-        {
-            const DataTy tmp = at(0, 0);
-            *this = rhs;
-            for (size_t idx = 0; idx < size(); idx++)
-                at(idx) = op(tmp, at(idx));
-            break;
-        }
         case 0xd: // this: scalar + rhs: | -> |
-        {
-            const DataTy tmp = at(0, 0);
-            *this = rhs;
-            for (size_t row = 0; row < rows(); row++)
-                at(row, 0) = op(tmp, at(row, 0));
-            break;
-        }
-        case 0xe: // this: scalar + rhs: - -> -
-        {
-            const DataTy tmp = at(0, 0);
-            *this = rhs;
-            for (size_t col = 0; col < cols(); col++)
-                at(0, col) = op(tmp, at(0, col));
-            break;
-        }
-        case 0xf: // this: scalar + rhs: scalar -> scalar
-            at(0, 0) = op(at(0, 0), rhs.at(0, 0));
-            break;
-        default:
-            assert(0 && "Unhandled case in NP::apply");
-            break;
-        }
-        return *this;
-    }
-
-    /// In-place element-wise multiplication of this NPArray by \p rhs.
-    NPArray &operator*=(const NPArray &rhs) {
-        return apply(Multiply<Ty>(), rhs);
-    }
-    /// In-place element-wise addition of this NPArray by \p rhs.
-    NPArray &operator+=(const NPArray &rhs) { return apply(Add<Ty>(), rhs); }
-    /// In-place element-wise substraction of this NPArray by \p rhs.
-    NPArray &operator-=(const NPArray &rhs) {
-        return apply(Substract<Ty>(), rhs);
-    }
-    /// In-place element-wise division of this NPArray by \p rhs.
-    NPArray &operator/=(const NPArray &rhs) { return apply(Divide<Ty>(), rhs); }
-    /// In-place element-wise absolute difference of this NPArray and \p rhs.
-    NPArray &absdiff(const NPArray &rhs) { return apply(AbsDiff<Ty>(), rhs); }
-    /// @}
-
-    /// \defgroup FoldOperations Those operations fold a \p NPCollector function
-    /// object along an axis (or a subrange of it) and return a vector with the
-    /// result. This is performed in 2 steps, the first one being \p foldOp, the
-    /// second one begin the extraction of the data collected in the \p
-    /// NPCollector function objects with the \p extract method. Those 2 steps
-    /// are combined in the \p fold methods.
-    /// @{
-
-    /// Extracts the values from a range of \p unaryOperations.
-    template <template <typename, bool> class collectorOp,
-              bool enableLocation = false>
-    static std::enable_if_t<isNPCollector<Ty, collectorOp>(),
-                            NPArray<typename NPOperatorTraits<
-                                Ty, collectorOp, enableLocation>::valueType>>
-    extract(const std::vector<collectorOp<Ty, enableLocation>> &ops) {
-        if (ops.empty())
-            return NPArray<
-                typename NPOperatorTraits<Ty, collectorOp>::valueType>();
-
-        NPArray<typename NPOperatorTraits<Ty, collectorOp>::valueType> result(
-            1, ops.size());
-        std::transform(ops.begin(), ops.end(), result.begin().begin(),
-                       [&](const auto &op) { return op.value(); });
-        return result;
-    }
-
-    /// Applies a range of copy constructed \p collectorOp function objects to
-    /// all elements on each \p axis in the range [begin, end( and returns the
-    /// range of \p collectorOp.
-    template <template <typename, bool> class collectorOp,
-              bool enableLocation = false>
-    [[nodiscard]] std::enable_if_t<
-        isNPCollector<Ty, collectorOp, enableLocation>() &&
-            std::is_copy_constructible<collectorOp<Ty, enableLocation>>(),
-        std::vector<collectorOp<Ty, enableLocation>>>
-    foldOp(const collectorOp<Ty, enableLocation> &op, Axis axis, size_t begin,
-           size_t end) const {
-        assert(begin <= end && "begin index must be lower or equal to end "
-                               "index in NPArray::foldOp");
-        std::vector<collectorOp<Ty, enableLocation>> ops(end - begin, op);
-        switch (axis) {
-        case ROW:
-            assert(begin <= rows() && "begin index is out of bound for row "
-                                      "access in NPArray::foldOp");
-            assert(
-                end <= rows() &&
-                "end index is out of bound for row access in NPArray::foldOp");
-            for (size_t row = begin; row < end; row++)
-                for (size_t col = 0; col < cols(); col++)
-                    ops[row - begin](at(row, col), row, col);
-            break;
-        case COLUMN:
-            assert(begin <= cols() && "begin index is out of bound for column "
-                                      "access in NPArray::foldOp");
-            assert(end <= cols() && "end index is out of bound for column "
-                                    "access in NPArray::foldOp");
-            for (size_t row = 0; row < rows(); row++)
-                for (size_t col = begin; col < end; col++)
-                    ops[col - begin](at(row, col), row, col);
-            break;
-        }
-        return ops;
-    }
-
-    /// Applies a range of copy constructed \p collectorOp to all elements
-    /// on each \p axis of this NPArray and returns the range of
-    /// \p collectorOp.
-    template <template <typename, bool> class collectorOp,
-              bool enableLocation = false>
-    [[nodiscard]] std::enable_if_t<
-        isNPCollector<Ty, collectorOp>() &&
-            std::is_copy_constructible<collectorOp<Ty, enableLocation>>() &&
-            std::is_same<void, typename NPOperatorTraits<
-                                   Ty, collectorOp,
-                                   enableLocation>::applicationReturnType>(),
-        std::vector<collectorOp<Ty, enableLocation>>>
-    foldOp(const collectorOp<Ty, enableLocation> &op, Axis axis) const {
-        std::vector<collectorOp<Ty, enableLocation>> ops;
-        switch (axis) {
-        case ROW:
-            ops.resize(rows(), op);
-            for (size_t row = 0; row < rows(); row++)
-                for (size_t col = 0; col < cols(); col++)
-                    ops[row](at(row, col), row, col);
+        case 0xe: // this: scalar + rhs: - -> -
+        {
+            const DataTy tmp = at(0, 0);
+            *this = rhs;
+            applyKernel(tmp, rowData(0), size(), op);
             break;
-        case COLUMN:
-            ops.resize(cols(), op);
-            for (size_t row = 0; row < rows(); row++)
-                for (size_t col = 0; col < cols(); col++)
-                    ops[col](at(row, col), row, col);
+        }
+        default:
+            assert(0 && "Unhandled case in NP::apply");
             break;
         }
-        return ops;
+        return *this;
     }
 
-    /// Applies a default constructed \p collectorOp to all elements on axis
-    /// \p axis (row / column) \p i and returns its value.
-    template <template <typename, bool> class collectorOp,
-              bool enableLocation = false>
-    [[nodiscard]] std::enable_if_t<
-        isNPCollector<Ty, collectorOp, enableLocation>(),
-        typename NPOperatorTraits<Ty, collectorOp, enableLocation>::valueType>
-    fold(const collectorOp<Ty, enableLocation> &op, Axis axis, size_t i) const {
-        return foreach (op, axis, i).value();
+    /// In-place element-wise multiplication of this NPArray by \p rhs.
+    NPArray &operator*=(const NPArray &rhs) {
+        return apply(Multiply<Ty>(), rhs);
     }
-
-    /// Applies a range of default constructed \p collectorOp to all elements
-    /// on each \p axis in the range [begin, end( and returns the range of
-    /// computed values.
-    template <template <typename, bool> class collectorOp,
-              bool enableLocation = false>
-    [[nodiscard]] std::enable_if_t<
-        isNPCollector<Ty, collectorOp, enableLocation>(),
-        NPArray<typename NPOperatorTraits<Ty, collectorOp,
-                                          enableLocation>::valueType>>
-    fold(const collectorOp<Ty, enableLocation> &op, Axis axis, size_t begin,
-         size_t end) const {
-        return extract(foldOp(op, axis, begin, end));
+    /// In-place element-wise addition of this NPArray by \p rhs.
+    NPArray &operator+=(const NPArray &rhs) { return apply(Add<Ty>(), rhs); }
+    /// In-place element-wise substraction of this NPArray by \p rhs.
+    NPArray &operator-=(const NPArray &rhs) {
+        return apply(Substract<Ty>(), rhs);
     }
-
-    /// Applies a range of default constructed \p collectorOp to all elements
-    /// on each \p axis of this NPArray and returns the range of
-    /// computed values.
-    template <template <typename, bool> class collectorOp,
-              bool enableLocation = false>
-    [[nodiscard]] std::enable_if_t<
-        isNPCollector<Ty, collectorOp, enableLocation>(),
-        NPArray<typename NPOperatorTraits<Ty, collectorOp,
-                                          enableLocation>::valueType>>
-    fold(const collectorOp<Ty, enableLocation> &op, Axis axis) const {
-        return extract(foldOp(op, axis));
+    /// In-place element-wise division of this NPArray by \p rhs.
+    NPArray &operator/=(const NPArray &rhs) { return apply(Divide<Ty>(), rhs); }
+    /// In-place element-wise absolute difference of this NPArray and \p rhs.
+    NPArray &absdiff(const NPArray &rhs) { return apply(AbsDiff<Ty>(), rhs); }
+    /// In-place element-wise Hamming distance of this NPArray and \p rhs,
+    /// masked with \p mask.
+    template <typename T = Ty>
+    std::enable_if_t<std::is_unsigned_v<T>, NPArray &>
+    hammingDistance(const NPArray &rhs,
+                    Ty mask = std::numeric_limits<Ty>::max()) {
+        return apply(HammingDistance<Ty>(mask), rhs);
     }
+    /// @}
 
-    /// Sum elements in an NPArray in row \p i or column \p i.
-    [[nodiscard]] Ty sum(Axis axis, size_t i) const {
-        return fold(Accumulate<Ty>(), axis, i);
-    }
+    /// Get the numpy descriptor string to use when saving in a numpy file.
+    static std::string descr() { return getEltTyDescr<Ty>(); }
 
-    /// Sum elements in an NPArray on a range of rows or columns.
-    [[nodiscard]] NPArray<Ty> sum(Axis axis, size_t begin, size_t end) const {
-        return fold(Accumulate<Ty>(), axis, begin, end);
-    }
+  private:
+    /// Read \p num_elt elements of type \p fromTy from \p ifs and convert them
+    /// to \p Ty into \p dst. The file is read by blocks, and the element bytes
+    /// are swapped if \p swap is set.
+    template <typename fromTy>
+    static bool readAndConvert(std::istream &ifs, Ty *dst, size_t num_elt,
+                               bool swap) {
+        // Fast path: no conversion needed, read straight into dst.
+        if (std::is_same<Ty, fromTy>() && !swap) {
+            ifs.read(reinterpret_cast<char *>(dst), num_elt * sizeof(Ty));
+            return bool(ifs);
+        }
 
-    /// Sum elements in an NPArray along an \p axis --- for all rows/cols on
-    /// that axis.
-    [[nodiscard]] NPArray<Ty> sum(Axis axis) const {
-        return fold(Accumulate<Ty>(), axis);
+        constexpr size_t BLOCK_SIZE = 64 * 1024 / sizeof(fromTy);
+        std::unique_ptr<fromTy[]> buf(
+            new fromTy[std::min(num_elt, BLOCK_SIZE)]);
+        for (size_t i = 0; i < num_elt; i += BLOCK_SIZE) {
+            const size_t n = std::min(num_elt - i, BLOCK_SIZE);
+            ifs.read(reinterpret_cast<char *>(buf.get()), n * sizeof(fromTy));
+            if (!ifs)
+                return false;
+            if (swap)
+                for (size_t j = 0; j < n; j++)
+                    buf[j] = byteSwap(buf[j]);
+            // Keep this loop simple, so that the compiler can vectorize it.
+            for (size_t j = 0; j < n; j++)
+                dst[i + j] = static_cast<Ty>(buf[j]);
+        }
+        return true;
     }
 
-    /// Compute the mean on row \p i or column \p i.
-    [[nodiscard]] double mean(Axis axis, size_t i) const {
-        return fold(Mean<Ty>(), axis, i);
-    }
+    /// Read the region \p w of elements of type \p fromTy from \p ifs, in a
+    /// \p num_rows x \p num_cols matrix starting at \p offset, and convert
+    /// them to \p Ty into \p dst. A \p fortran order matrix is transposed
+    /// when read.
+    template <typename fromTy>
+    static bool readWindow(std::istream &ifs, size_t offset, Ty *dst,
+                           const Window &w, size_t num_rows, size_t num_cols,
+                           bool swap, bool fortran) {
+        if (w.rows() == 0 || w.cols() == 0)
+            return true;
 
-    /// Compute the mean on a range of rows or on a range of columns.
-    [[nodiscard]] NPArray<double> mean(Axis axis, size_t begin,
-                                       size_t end) const {
-        return fold(Mean<Ty>(), axis, begin, end);
+        if (fortran) {
+            // The file holds the transposed matrix, where each column of the
+            // window is a contiguous segment.
+            std::unique_ptr<Ty[]> t(new Ty[w.rows() * w.cols()]);
+            for (size_t c = 0; c < w.cols(); c++) {
+                const size_t col = w.colBegin + c * w.colStride;
+                ifs.seekg(offset + (col * num_rows + w.rowBegin) *
+                                       sizeof(fromTy));
+                if (!readAndConvert<fromTy>(ifs, &t[c * w.rows()], w.rows(),
+                                            swap))
+                    return false;
+            }
+            NPArrayBase::transpose(reinterpret_cast<char *>(dst),
+                                   reinterpret_cast<const char *>(t.get()),
+                                   w.cols(), w.rows(), sizeof(Ty));
+            return true;
+        }
+
+        // Complete rows are contiguous in the file: read them in one go.
+        if (w.colBegin == 0 && w.cols() == num_cols) {
+            ifs.seekg(offset + w.rowBegin * num_cols * sizeof(fromTy));
+            return readAndConvert<fromTy>(ifs, dst, w.rows() * w.cols(), swap);
+        }
+
+        std::unique_ptr<Ty[]> row;
+        if (w.colStride != 1)
+            row.reset(new Ty[w.span()]);
+        for (size_t r = w.rowBegin; r < w.rowEnd; r++) {
+            Ty *rdst = &dst[(r - w.rowBegin) * w.cols()];
+            ifs.seekg(offset + (r * num_cols + w.colBegin) * sizeof(fromTy));
+            if (!readAndConvert<fromTy>(ifs, row ? row.get() : rdst, w.span(),
+                                        swap))
+                return false;
+            if (row)
+                for (size_t c = 0; c < w.cols(); c++)
+                    rdst[c] = row[c * w.colStride];
+        }
+        return true;
     }
 
-    /// Compute the mean on all rows or all columns.
-    [[nodiscard]] NPArray<double> mean(Axis axis) const {
-        return fold(Mean<Ty>(), axis);
+    /// Get a pointer to the first element of row \p row. Contrary to
+    /// getAs, this can be used on an empty array or past its last row.
+    Ty *rowData(size_t row) noexcept {
+        return dataAs<Ty>() + row * cols();
     }
 
-    /// Compute the mean on row \p i or column \p i. It also computes the
-    /// variance (taking \p ddof into account) and the standard deviation.
-    double meanWithVar(Axis axis, size_t i, double *var,
-                       double *stddev = nullptr, unsigned ddof = 0) const {
-        MeanWithVar<Ty> avg = foreach (MeanWithVar<Ty>(), axis, i);
-        if (var)
-            *var = avg.var(ddof);
-        if (stddev)
-            *stddev = avg.stddev();
-        return avg.value();
+    /// Get a pointer to the first element of row \p row (const version).
+    [[nodiscard]] const Ty *rowData(size_t row) const noexcept {
+        return dataAs<Ty>() + row * cols();
     }
 
-    /// Compute the mean on a range of rows or on a range of columns, optionally
-    /// computing the variance (taking into account the \p ddof) and the
-    /// standard deviation.
-    NPArray<double> meanWithVar(Axis axis, size_t begin, size_t end,
-                                NPArray<double> *var,
-                                NPArray<double> *stddev = nullptr,
-                                unsigned ddof = 0) const {
-        std::vector<MeanWithVar<Ty>> means =
-            foldOp(MeanWithVar<Ty>(), axis, begin, end);
-        if (var) {
-            var->resize(1, means.size());
-            for (size_t i = 0; i < means.size(); i++)
-                (*var)(0, i) = means[i].var(ddof);
-        }
+    /// \defgroup ApplyKernels Element-wise loops used by the apply methods.
+    /// They operate on contiguous elements through plain pointers, without
+    /// any indexing arithmetic or bound checks in the loop body, so that the
+    /// compiler can vectorize them for the instruction set it targets.
+    /// @{
 
-        if (stddev) {
-            stddev->resize(1, means.size());
-            for (size_t i = 0; i < means.size(); i++)
-                (*stddev)(0, i) = means[i].stddev();
-        }
+    /// dst[i] <- op(dst[i]) for 0 <= i < n.
+    template <class unaryOperation>
+    static void applyKernel(Ty *dst, size_t n, const unaryOperation &op) {
+        for (size_t i = 0; i < n; i++)
+            dst[i] = op(dst[i]);
+    }
 
-        return extract(means);
+    /// dst[i] <- op(dst[i], rhs) for 0 <= i < n.
+    template <class binaryOperation>
+    static void applyKernel(Ty *dst, size_t n, const binaryOperation &op,
+                            const Ty rhs) {
+        for (size_t i = 0; i < n; i++)
+            dst[i] = op(dst[i], rhs);
     }
 
-    /// Compute the mean on all rows or all columns. It optionally computes the
-    /// variance or the standard deviation.
-    NPArray<double> meanWithVar(Axis axis, NPArray<double> *var,
-                                NPArray<double> *stddev = nullptr,
-                                unsigned ddof = 0) const {
-        std::vector<MeanWithVar<Ty>> means = foldOp(MeanWithVar<Ty>(), axis);
-        if (var) {
-            var->resize(1, means.size());
-            for (size_t i = 0; i < means.size(); i++)
-                (*var)(0, i) = means[i].var(ddof);
-        }
+    /// dst[i] <- op(dst[i], rhs[i]) for 0 <= i < n.
+    template <class binaryOperation>
+    static void applyKernel(Ty *dst, const Ty *rhs, size_t n,
+                            const binaryOperation &op) {
+        for (size_t i = 0; i < n; i++)
+            dst[i] = op(dst[i], rhs[i]);
+    }
 
-        if (stddev) {
-            stddev->resize(1, means.size());
-            for (size_t i = 0; i < means.size(); i++)
-                (*stddev)(0, i) = means[i].stddev();
-        }
+    /// dst[i] <- op(lhs, dst[i]) for 0 <= i < n.
+    template <class binaryOperation>
+    static void applyKernel(const Ty lhs, Ty *dst, size_t n,
+                            const binaryOperation &op) {
+        for (size_t i = 0; i < n; i++)
+            dst[i] = op(lhs, dst[i]);
+    }
 
-        return extract(means);
+    /// dst[i] <- op(lhs[i], dst[i]) for 0 <= i < n.
+    template <class binaryOperation>
+    static void applyKernel(const Ty *lhs, Ty *dst, size_t n,
+                            const binaryOperation &op) {
+        for (size_t i = 0; i < n; i++)
+            dst[i] = op(lhs[i], dst[i]);
     }
     /// @}
 
-    /// Get the numpy descriptor string to use when saving in a numpy file.
-    static std::string descr() { return getEltTyDescr<Ty>(); }
-
-  private:
     /// A convenience shorthand for in-class operations.
     Ty &at(size_t row, size_t col) { return (*this)(row, col); }
 
@@ -1758,6 +2299,409 @@ template <class Ty> class NPArray : public NPArrayBase {
     [[nodiscard]] const Ty &at(size_t idx) const { return *getAs<Ty>(idx); }
 };
 
+/// NPArrayView is a lightweight, non-owning and read-only view on a part of
+/// an NPArray: a range of rows and a range of columns, optionally strided. It
+/// supports the same predicates, collectors and folds as NPArray, without
+/// copying any element. The viewed NPArray must outlive its views, and must not
+/// be resized while they are in use.
+template <class Ty> class NPArrayView : public NPArrayOps<NPArrayView<Ty>, Ty> {
+    friend class NPArrayOps<NPArrayView<Ty>, Ty>;
+
+  public:
+    /// The viewed elements' type.
+    using DataTy = Ty;
+
+    /// Construct a view on the complete \p array.
+    NPArrayView(const NPArray<Ty> &array) noexcept
+        : NPArrayView(array, 0, array.rows(), 0, array.cols()) {}
+
+    /// Construct a view on rows [ \p row_begin, \p row_end ( and columns [ \p
+    /// col_begin, \p col_end ( of \p array, only retaining one row (resp.
+    /// column) every \p row_stride (resp. \p col_stride).
+    NPArrayView(const NPArray<Ty> &array, size_t row_begin, size_t row_end,
+                size_t col_begin, size_t col_end, size_t row_stride = 1,
+                size_t col_stride = 1) noexcept
+        : data(nullptr),
+          numRows(stridedCount(row_begin, row_end, row_stride)),
+          numColumns(stridedCount(col_begin, col_end, col_stride)),
+          rowStride(row_stride * array.cols()), colStride(col_stride) {
+        assert(row_begin <= row_end && "Wrong begin / end rows in NPArrayView");
+        assert(row_end <= array.rows() && "Not that many rows in the NPArray");
+        assert(col_begin <= col_end &&
+               "Wrong begin / end columns in NPArrayView");
+        assert(col_end <= array.cols() &&
+               "Not that many columns in the NPArray");
+        if (numRows != 0 && numColumns != 0)
+            data = &array(row_begin, col_begin);
+    }
+
+    /// Construct a view on the \p window region of \p array.
+    NPArrayView(const NPArray<Ty> &array,
+                const NPArrayBase::Window &window) noexcept
+        : NPArrayView(array) {
+        const NPArrayBase::Window w = window.clamp(rows(), cols());
+        *this = view(w.rowBegin, w.rowEnd, w.colBegin, w.colEnd, 1,
+                     w.colStride);
+    }
+
+    /// Construct a view on the \p num_rows x \p num_columns elements starting
+    /// at \p elts, with 2 consecutive rows (resp. columns) being \p row_stride
+    /// (resp. \p col_stride) elements apart. The view does not own the
+    /// elements, which can belong to anything else than an NPArray, e.g. a
+    /// numpy array.
+    NPArrayView(const Ty *elts, size_t num_rows, size_t num_columns,
+                size_t row_stride, size_t col_stride = 1) noexcept
+        : data(num_rows != 0 && num_columns != 0 ? elts : nullptr),
+          numRows(num_rows), numColumns(num_columns), rowStride(row_stride),
+          colStride(col_stride) {}
+
+    /// Get a view on rows [ \p row_begin, \p row_end ( and columns [ \p
+    /// col_begin, \p col_end ( of this view, only retaining one row (resp.
+    /// column) every \p row_stride (resp. \p col_stride).
+    [[nodiscard]] NPArrayView view(size_t row_begin, size_t row_end,
+                                   size_t col_begin, size_t col_end,
+                                   size_t row_stride = 1,
+                                   size_t col_stride = 1) const noexcept {
+        assert(row_begin <= row_end && "Wrong begin / end rows in NPArrayView");
+        assert(row_end <= rows() && "Not that many rows in the NPArrayView");
+        assert(col_begin <= col_end &&
+               "Wrong begin / end columns in NPArrayView");
+        assert(col_end <= cols() && "Not that many columns in the NPArrayView");
+        NPArrayView v(*this);
+        v.numRows = stridedCount(row_begin, row_end, row_stride);
+        v.numColumns = stridedCount(col_begin, col_end, col_stride);
+        v.rowStride = rowStride * row_stride;
+        v.colStride = colStride * col_stride;
+        v.data = v.numRows != 0 && v.numColumns != 0
+                     ? &(*this)(row_begin, col_begin)
+                     : nullptr;
+        return v;
+    }
+
+    /// Get the number of rows in this view.
+    [[nodiscard]] size_t rows() const noexcept { return numRows; }
+
+    /// Get the number of columns in this view.
+    [[nodiscard]] size_t cols() const noexcept { return numColumns; }
+
+    /// Get the number of elements in this view.
+    [[nodiscard]] size_t size() const noexcept { return numRows * numColumns; }
+
+    /// Is this view empty ?
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    /// Get the element at \p row and \p col in this view.
+    [[nodiscard]] const Ty &operator()(size_t row, size_t col) const noexcept {
+        assert(row < rows() && "Row is out-of-range");
+        assert(col < cols() && "Col is out-of-range");
+        return data[row * rowStride + col * colStride];
+    }
+
+  private:
+    const Ty *data;    ///< The first element in the view.
+    size_t numRows;    ///< The number of rows in the view.
+    size_t numColumns; ///< The number of columns in the view.
+    size_t rowStride;  ///< Distance between 2 rows, in number of elements.
+    size_t colStride;  ///< Distance between 2 columns, in number of elements.
+
+    /// Get the number of elements in [ \p begin, \p end ( with a \p stride.
+    static size_t stridedCount(size_t begin, size_t end,
+                               size_t stride) noexcept {
+        assert(stride > 0 && "NPArrayView stride can not be 0");
+        return end > begin ? (end - begin + stride - 1) / stride : 0;
+    }
+
+    /// A convenience shorthand for the NPArrayOps operations.
+    [[nodiscard]] Ty at(size_t row, size_t col) const {
+        return (*this)(row, col);
+    }
+};
+
+/// \defgroup Expressions Lazily evaluated element-wise expressions.
+///
+/// The element-wise arithmetic operators and functions on NPArray are eager:
+/// each of them returns a new NPArray. Lazy evaluation is opted in with expr,
+/// which wraps an NPArray (or an NPArrayView) in an expression node. The
+/// arithmetic operators and functions involving an expression node return
+/// expression nodes, so that a complete expression like
+/// (expr(a) - b) / sqrt(expr(c) + d) is evaluated in a single loop, without
+/// any intermediate NPArray, when it is assigned to an NPArray. The usual
+/// broadcasting rules apply: an operand with a single row (resp. column) is
+/// broadcasted to all rows (resp. columns).
+///
+/// An expression references the NPArray it has been built from (temporaries
+/// are moved into the expression), so it must be evaluated before those are
+/// modified or destroyed: prefer `NPArray<Ty> x = expr(a) + b;` to
+/// `auto x = expr(a) + b;`.
+/// @{
+
+/// NPExprOperand gives how an \p T operand is stored in an expression node:
+/// NPArray lvalues are referenced, everything else (NPArray temporaries,
+/// views and sub-expressions) is held by value.
+template <class T> struct NPExprOperand {
+    using type = std::decay_t<T>;
+};
+template <class Ty> struct NPExprOperand<NPArray<Ty> &> {
+    using type = const NPArray<Ty> &;
+};
+template <class Ty> struct NPExprOperand<const NPArray<Ty> &> {
+    using type = const NPArray<Ty> &;
+};
+
+/// Is \p T an NPArray, an NPArrayView or an expression node ?
+template <class T> struct isNPOperand {
+    static constexpr bool value = isNPExpression<T>();
+};
+template <class Ty> struct isNPOperand<NPArray<Ty>> {
+    static constexpr bool value = true;
+};
+template <class Ty> struct isNPOperand<NPArrayView<Ty>> {
+    static constexpr bool value = true;
+};
+template <class T>
+constexpr bool isNPOperand_v = isNPOperand<std::decay_t<T>>::value;
+
+/// Get the element type of operand \p T, an NPArray, an NPArrayView, an
+/// expression node or a scalar.
+template <class T, bool = isNPOperand_v<T>> struct NPOperandDataTy {
+    using type = typename std::decay_t<T>::DataTy;
+};
+template <class T> struct NPOperandDataTy<T, false> {
+    using type = std::decay_t<T>;
+};
+
+/// Can \p L and \p R be combined lazily by an element-wise binary operator ?
+/// At least one of them must be an expression node, and they must have the
+/// same element type.
+template <class L, class R> constexpr bool areNPBinaryOperands() {
+    return (isNPExpression<L>() || isNPExpression<R>()) &&
+           std::is_same_v<typename NPOperandDataTy<L>::type,
+                          typename NPOperandDataTy<R>::type>;
+}
+
+/// NPScalarExpression is a 1 x 1 expression node holding a scalar, which
+/// gets broadcasted to the shape of the other operand.
+template <class Ty>
+class NPScalarExpression : public NPArrayOps<NPScalarExpression<Ty>, Ty>,
+                           public NPExpressionTag {
+    friend class NPArrayOps<NPScalarExpression<Ty>, Ty>;
+
+  public:
+    using DataTy = Ty;
+
+    NPScalarExpression(const Ty &v) : v(v) {}
+
+    [[nodiscard]] size_t rows() const noexcept { return 1; }
+    [[nodiscard]] size_t cols() const noexcept { return 1; }
+    [[nodiscard]] bool empty() const noexcept { return false; }
+    Ty operator()(size_t, size_t) const noexcept { return v; }
+
+  private:
+    const Ty v;
+    [[nodiscard]] Ty at(size_t row, size_t col) const {
+        return (*this)(row, col);
+    }
+};
+
+/// NPLeafExpression is the expression node wrapping an NPArray or an
+/// NPArrayView \p E, i.e. the entry point to the lazy evaluation.
+template <class E>
+class NPLeafExpression
+    : public NPArrayOps<NPLeafExpression<E>, typename std::decay_t<E>::DataTy>,
+      public NPExpressionTag {
+    friend class NPArrayOps<NPLeafExpression<E>,
+                            typename std::decay_t<E>::DataTy>;
+
+  public:
+    using DataTy = typename std::decay_t<E>::DataTy;
+
+    template <class T>
+    explicit NPLeafExpression(T &&e) : e(std::forward<T>(e)) {}
+
+    [[nodiscard]] size_t rows() const noexcept { return e.rows(); }
+    [[nodiscard]] size_t cols() const noexcept { return e.cols(); }
+    [[nodiscard]] bool empty() const noexcept { return e.empty(); }
+    DataTy operator()(size_t row, size_t col) const { return e(row, col); }
+
+  private:
+    E e;
+    [[nodiscard]] DataTy at(size_t row, size_t col) const {
+        return (*this)(row, col);
+    }
+};
+
+/// Get operand \p e value at [ \p row, \p col ], taking broadcasting into
+/// account.
+template <class E>
+auto broadcastAt(const E &e, size_t row, size_t col) noexcept {
+    return e(e.rows() == 1 ? 0 : row, e.cols() == 1 ? 0 : col);
+}
+
+/// NPUnaryExpression is the expression node for the application of \p
+/// unaryOperation to each element of its operand \p E.
+template <template <typename> class unaryOperation, class E>
+class NPUnaryExpression
+    : public NPArrayOps<NPUnaryExpression<unaryOperation, E>,
+                        typename NPOperandDataTy<E>::type>,
+      public NPExpressionTag {
+    friend class NPArrayOps<NPUnaryExpression<unaryOperation, E>,
+                            typename NPOperandDataTy<E>::type>;
+
+  public:
+    using DataTy = typename NPOperandDataTy<E>::type;
+
+    template <class T>
+    explicit NPUnaryExpression(T &&e) : e(std::forward<T>(e)) {}
+
+    [[nodiscard]] size_t rows() const noexcept { return e.rows(); }
+    [[nodiscard]] size_t cols() const noexcept { return e.cols(); }
+    [[nodiscard]] bool empty() const noexcept { return e.empty(); }
+    DataTy operator()(size_t row, size_t col) const {
+        return unaryOperation<DataTy>()(e(row, col));
+    }
+
+  private:
+    E e;
+    [[nodiscard]] DataTy at(size_t row, size_t col) const {
+        return (*this)(row, col);
+    }
+};
+
+/// NPBinaryExpression is the expression node for the element-wise
+/// application of \p binaryOperation to its operands \p L and \p R.
+template <template <typename> class binaryOperation, class L, class R>
+class NPBinaryExpression
+    : public NPArrayOps<NPBinaryExpression<binaryOperation, L, R>,
+                        typename NPOperandDataTy<L>::type>,
+      public NPExpressionTag {
+    friend class NPArrayOps<NPBinaryExpression<binaryOperation, L, R>,
+                            typename NPOperandDataTy<L>::type>;
+
+  public:
+    using DataTy = typename NPOperandDataTy<L>::type;
+
+    template <class TL, class TR>
+    NPBinaryExpression(TL &&lhs, TR &&rhs)
+        : lhs(std::forward<TL>(lhs)), rhs(std::forward<TR>(rhs)) {
+        assert((this->lhs.rows() == this->rhs.rows() ||
+                this->lhs.rows() == 1 || this->rhs.rows() == 1) &&
+               "Rows dimensions must be equal or one of them must be 1");
+        assert((this->lhs.cols() == this->rhs.cols() ||
+                this->lhs.cols() == 1 || this->rhs.cols() == 1) &&
+               "Columns dimensions must be equal or one of them must be 1");
+        assert(!(this->lhs.rows() == 1 && this->rhs.cols() == 1 &&
+                 this->lhs.cols() != 1 && this->rhs.rows() != 1) &&
+               !(this->lhs.cols() == 1 && this->rhs.rows() == 1 &&
+                 this->lhs.rows() != 1 && this->rhs.cols() != 1) &&
+               "Can not combine a single row with a single column");
+    }
+
+    [[nodiscard]] size_t rows() const noexcept {
+        return lhs.rows() == 1 ? rhs.rows() : lhs.rows();
+    }
+    [[nodiscard]] size_t cols() const noexcept {
+        return lhs.cols() == 1 ? rhs.cols() : lhs.cols();
+    }
+    [[nodiscard]] bool empty() const noexcept { return rows() * cols() == 0; }
+    DataTy operator()(size_t row, size_t col) const {
+        return binaryOperation<DataTy>()(broadcastAt(lhs, row, col),
+                                         broadcastAt(rhs, row, col));
+    }
+
+  private:
+    L lhs;
+    R rhs;
+    [[nodiscard]] DataTy at(size_t row, size_t col) const {
+        return (*this)(row, col);
+    }
+};
+
+/// Wrap \p v in an expression node if it is a scalar, forward it otherwise.
+template <class T> decltype(auto) asNPOperand(T &&v) {
+    if constexpr (isNPOperand_v<T>)
+        return std::forward<T>(v);
+    else
+        return NPScalarExpression<std::decay_t<T>>(v);
+}
+
+/// Build the expression node for the application of \p unaryOperation to \p
+/// e.
+template <template <typename> class unaryOperation, class E>
+auto makeNPExpression(E &&e) {
+    return NPUnaryExpression<unaryOperation, typename NPExprOperand<E>::type>(
+        std::forward<E>(e));
+}
+
+/// Build the expression node for the element-wise application of \p
+/// binaryOperation to \p lhs and \p rhs.
+template <template <typename> class binaryOperation, class L, class R>
+auto makeNPExpression(L &&lhs, R &&rhs) {
+    using LOp = decltype(asNPOperand(std::forward<L>(lhs)));
+    using ROp = decltype(asNPOperand(std::forward<R>(rhs)));
+    return NPBinaryExpression<binaryOperation,
+                              typename NPExprOperand<LOp>::type,
+                              typename NPExprOperand<ROp>::type>(
+        asNPOperand(std::forward<L>(lhs)), asNPOperand(std::forward<R>(rhs)));
+}
+/// @}
+
+// The NPArrayOps methods below return or modify NPArray<double> objects, so
+// they can only be defined once NPArray is complete.
+template <class Derived, class Ty>
+NPArray<double> NPArrayOps<Derived, Ty>::mean(NPArrayBase::Axis axis,
+                                              size_t begin, size_t end) const {
+    return fold(Mean<Ty>(), axis, begin, end);
+}
+
+template <class Derived, class Ty>
+NPArray<double> NPArrayOps<Derived, Ty>::mean(NPArrayBase::Axis axis) const {
+    return fold(Mean<Ty>(), axis);
+}
+
+template <class Derived, class Ty>
+NPArray<double> NPArrayOps<Derived, Ty>::meanWithVar(NPArrayBase::Axis axis,
+                                                     size_t begin, size_t end,
+                                                     NPArray<double> *var,
+                                                     NPArray<double> *stddev,
+                                                     unsigned ddof) const {
+    std::vector<MeanWithVar<Ty>> means =
+        foldOp(MeanWithVar<Ty>(), axis, begin, end);
+    if (var) {
+        var->resize(1, means.size());
+        for (size_t i = 0; i < means.size(); i++)
+            (*var)(0, i) = means[i].var(ddof);
+    }
+
+    if (stddev) {
+        stddev->resize(1, means.size());
+        for (size_t i = 0; i < means.size(); i++)
+            (*stddev)(0, i) = means[i].stddev();
+    }
+
+    return extract(means);
+}
+
+template <class Derived, class Ty>
+NPArray<double> NPArrayOps<Derived, Ty>::meanWithVar(NPArrayBase::Axis axis,
+                                                     NPArray<double> *var,
+                                                     NPArray<double> *stddev,
+                                                     unsigned ddof) const {
+    std::vector<MeanWithVar<Ty>> means = foldOp(MeanWithVar<Ty>(), axis);
+    if (var) {
+        var->resize(1, means.size());
+        for (size_t i = 0; i < means.size(); i++)
+            (*var)(0, i) = means[i].var(ddof);
+    }
+
+    if (stddev) {
+        stddev->resize(1, means.size());
+        for (size_t i = 0; i < means.size(); i++)
+            (*stddev)(0, i) = means[i].stddev();
+    }
+
+    return extract(means);
+}
+
 /// Convert the type of the \p src NPArray elements from \p fromTy to \p newTy.
 /// This does not affect the Matrix shape or number of elements, only their
 /// type. The type conversion to smaller types may truncate some information.
@@ -1821,7 +2765,7 @@ template <class Ty> NPArray<Ty> log(const NPArray<Ty> &npy) {
     return NPArray<Ty>(npy).log();
 }
 
-/// Functional version of 'negate'.
+/// Functional version of 'sqrt'.
 template <class Ty> NPArray<Ty> sqrt(const NPArray<Ty> &npy) {
     return NPArray<Ty>(npy).sqrt();
 }
@@ -1898,6 +2842,113 @@ NPArray<Ty> absdiff(const NPArray<Ty> &lhs, const NPArray<Ty> &rhs) {
     return NPArray<Ty>(lhs).absdiff(rhs);
 }
 
+/// \ingroup Expressions
+/// @{
+/// Start a lazily evaluated expression from NPArray \p npy, which is
+/// referenced by the expression.
+template <class Ty> auto expr(const NPArray<Ty> &npy) {
+    return NPLeafExpression<const NPArray<Ty> &>(npy);
+}
+
+/// Start a lazily evaluated expression from temporary NPArray \p npy, which
+/// is moved into the expression.
+template <class Ty> auto expr(NPArray<Ty> &&npy) {
+    return NPLeafExpression<NPArray<Ty>>(std::move(npy));
+}
+
+/// Start a lazily evaluated expression from NPArrayView \p view.
+template <class Ty> auto expr(const NPArrayView<Ty> &view) {
+    return NPLeafExpression<NPArrayView<Ty>>(view);
+}
+
+/// Lazy functional version of 'abs'.
+template <class E, std::enable_if_t<isNPExpression<E>(), bool> = true>
+auto abs(E &&e) {
+    return makeNPExpression<Abs>(std::forward<E>(e));
+}
+
+/// Lazy functional version of 'negate'.
+template <class E, std::enable_if_t<isNPExpression<E>(), bool> = true>
+auto negate(E &&e) {
+    return makeNPExpression<Negate>(std::forward<E>(e));
+}
+
+/// Lazy functional version of 'log'.
+template <class E, std::enable_if_t<isNPExpression<E>(), bool> = true>
+auto log(E &&e) {
+    return makeNPExpression<Log>(std::forward<E>(e));
+}
+
+/// Lazy functional version of 'sqrt'.
+template <class E, std::enable_if_t<isNPExpression<E>(), bool> = true>
+auto sqrt(E &&e) {
+    return makeNPExpression<Sqrt>(std::forward<E>(e));
+}
+
+/// Lazy element-wise (or scalar) multiplication.
+template <class L, class R,
+          std::enable_if_t<areNPBinaryOperands<L, R>(), bool> = true>
+auto operator*(L &&lhs, R &&rhs) {
+    return makeNPExpression<Multiply>(std::forward<L>(lhs),
+                                      std::forward<R>(rhs));
+}
+
+/// Lazy element-wise (or scalar) division.
+template <class L, class R,
+          std::enable_if_t<areNPBinaryOperands<L, R>(), bool> = true>
+auto operator/(L &&lhs, R &&rhs) {
+    return makeNPExpression<Divide>(std::forward<L>(lhs), std::forward<R>(rhs));
+}
+
+/// Lazy element-wise (or scalar) addition.
+template <class L, class R,
+          std::enable_if_t<areNPBinaryOperands<L, R>(), bool> = true>
+auto operator+(L &&lhs, R &&rhs) {
+    return makeNPExpression<Add>(std::forward<L>(lhs), std::forward<R>(rhs));
+}
+
+/// Lazy element-wise (or scalar) substraction.
+template <class L, class R,
+          std::enable_if_t<areNPBinaryOperands<L, R>(), bool> = true>
+auto operator-(L &&lhs, R &&rhs) {
+    return makeNPExpression<Substract>(std::forward<L>(lhs),
+                                       std::forward<R>(rhs));
+}
+
+/// Lazy element-wise (or scalar) absolute difference.
+template <class L, class R,
+          std::enable_if_t<areNPBinaryOperands<L, R>(), bool> = true>
+auto absdiff(L &&lhs, R &&rhs) {
+    return makeNPExpression<AbsDiff>(std::forward<L>(lhs),
+                                     std::forward<R>(rhs));
+}
+
+/// Compare expression \p lhs, once evaluated, with \p rhs.
+template <class Expr, class Ty,
+          std::enable_if_t<isNPExpression<Expr>(), bool> = true>
+bool operator==(const Expr &lhs, const NPArray<Ty> &rhs) {
+    return NPArray<Ty>(lhs) == rhs;
+}
+/// Compare \p lhs with expression \p rhs, once evaluated.
+template <class Ty, class Expr,
+          std::enable_if_t<isNPExpression<Expr>(), bool> = true>
+bool operator==(const NPArray<Ty> &lhs, const Expr &rhs) {
+    return lhs == NPArray<Ty>(rhs);
+}
+/// Compare expression \p lhs, once evaluated, with \p rhs.
+template <class Expr, class Ty,
+          std::enable_if_t<isNPExpression<Expr>(), bool> = true>
+bool operator!=(const Expr &lhs, const NPArray<Ty> &rhs) {
+    return !(lhs == rhs);
+}
+/// Compare \p lhs with expression \p rhs, once evaluated.
+template <class Ty, class Expr,
+          std::enable_if_t<isNPExpression<Expr>(), bool> = true>
+bool operator!=(const NPArray<Ty> &lhs, const Expr &rhs) {
+    return !(lhs == rhs);
+}
+/// @}
+
 /// \ingroup Predicates
 /// @{
 /// Functional version of 'all' predicate checker on a complete NPArray.
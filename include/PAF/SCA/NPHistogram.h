@@ -0,0 +1,196 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace PAF::SCA {
+
+/// The MinMaxCount class tracks the minimum and maximum values in a set of
+/// samples, as well as the number of occurrences of each of them. Samples are
+/// processed by blocks, in simple loops that the compiler can vectorize, and
+/// partial results, e.g. from different threads, can be merged.
+template <typename Ty> class MinMaxCount {
+  public:
+    /// Construct an empty MinMaxCount.
+    MinMaxCount() = default;
+
+    /// Add the \p n samples at \p values.
+    void add(const Ty *values, size_t n) {
+        for (size_t b = 0; b < n; b += BLOCK_SIZE) {
+            const size_t e = std::min(n, b + BLOCK_SIZE);
+            // First find the extrema of the block, then count their
+            // occurrences.
+            Ty lo = values[b];
+            Ty hi = values[b];
+            for (size_t i = b + 1; i < e; i++) {
+                lo = values[i] < lo ? values[i] : lo;
+                hi = values[i] > hi ? values[i] : hi;
+            }
+            size_t lo_cnt = 0;
+            size_t hi_cnt = 0;
+            for (size_t i = b; i < e; i++) {
+                lo_cnt += values[i] == lo;
+                hi_cnt += values[i] == hi;
+            }
+            merge(lo, lo_cnt, hi, hi_cnt, e - b);
+        }
+    }
+
+    /// Merge the samples of \p other into this MinMaxCount.
+    MinMaxCount &operator+=(const MinMaxCount &other) {
+        if (other.num != 0)
+            merge(other.minValue, other.minCnt, other.maxValue, other.maxCnt,
+                  other.num);
+        return *this;
+    }
+
+    /// Get the number of samples seen.
+    [[nodiscard]] size_t count() const noexcept { return num; }
+
+    /// Get the minimum value (only valid if some samples were seen).
+    [[nodiscard]] Ty min() const noexcept { return minValue; }
+
+    /// Get the number of occurrences of the minimum value.
+    [[nodiscard]] size_t minCount() const noexcept { return minCnt; }
+
+    /// Get the maximum value (only valid if some samples were seen).
+    [[nodiscard]] Ty max() const noexcept { return maxValue; }
+
+    /// Get the number of occurrences of the maximum value.
+    [[nodiscard]] size_t maxCount() const noexcept { return maxCnt; }
+
+  private:
+    /// The number of samples processed at a time, small enough for a block
+    /// to remain in the L1 cache between the two passes over it.
+    static constexpr size_t BLOCK_SIZE = 4096;
+
+    Ty minValue{};
+    Ty maxValue{};
+    size_t minCnt = 0;
+    size_t maxCnt = 0;
+    size_t num = 0;
+
+    void merge(Ty lo, size_t lo_cnt, Ty hi, size_t hi_cnt, size_t n) {
+        if (num == 0 || lo < minValue) {
+            minValue = lo;
+            minCnt = lo_cnt;
+        } else if (lo == minValue)
+            minCnt += lo_cnt;
+
+        if (num == 0 || hi > maxValue) {
+            maxValue = hi;
+            maxCnt = hi_cnt;
+        } else if (hi == maxValue)
+            maxCnt += hi_cnt;
+
+        num += n;
+    }
+};
+
+/// The NPHistogram class counts samples in bins of the same width covering
+/// the [low, high( range. The samples outside of this range are counted
+/// separately, as being below or above the range. Partial histograms, e.g.
+/// from different threads, can be merged.
+template <typename Ty> class NPHistogram {
+  public:
+    /// Construct an NPHistogram with \p num_bins bins covering [\p low, \p
+    /// high(.
+    NPHistogram(double low, double high, size_t num_bins)
+        : counts(num_bins, 0), low(low), high(high),
+          scale(double(num_bins) / (high - low)) {
+        assert(num_bins != 0 && "An NPHistogram needs at least one bin");
+        assert(low < high && "The NPHistogram range can not be empty");
+    }
+
+    /// Construct an NPHistogram with one bin per value of the (small) integral
+    /// Ty, i.e. one bin per ADC code.
+    template <typename T = Ty,
+              std::enable_if_t<std::is_integral<T>() && sizeof(T) <= 2,
+                               bool> = true>
+    NPHistogram()
+        : NPHistogram(double(std::numeric_limits<T>::lowest()),
+                      double(std::numeric_limits<T>::max()) + 1.0,
+                      size_t(std::numeric_limits<T>::max()) -
+                          size_t(std::numeric_limits<T>::lowest()) + 1) {}
+
+    /// Add the \p n samples at \p values.
+    void add(const Ty *values, size_t n) {
+        const double num_bins = double(counts.size());
+        for (size_t i = 0; i < n; i++) {
+            const double x = (double(values[i]) - low) * scale;
+            // NaNs are counted as being below the range.
+            if (!(x >= 0.0))
+                numBelow += 1;
+            else if (x >= num_bins)
+                numAbove += 1;
+            else
+                counts[size_t(x)] += 1;
+        }
+    }
+
+    /// Merge the counts of \p other, which must have the same bins, into
+    /// this NPHistogram.
+    NPHistogram &operator+=(const NPHistogram &other) {
+        assert(other.counts.size() == counts.size() && other.low == low &&
+               other.high == high && "NPHistogram bins mismatch");
+        for (size_t i = 0; i < counts.size(); i++)
+            counts[i] += other.counts[i];
+        numBelow += other.numBelow;
+        numAbove += other.numAbove;
+        return *this;
+    }
+
+    /// Get the number of bins.
+    [[nodiscard]] size_t size() const noexcept { return counts.size(); }
+
+    /// Get the number of samples in bin \p i.
+    [[nodiscard]] size_t operator[](size_t i) const noexcept {
+        assert(i < size() && "NPHistogram bin index out of bounds");
+        return counts[i];
+    }
+
+    /// Get the lower bound of bin \p i.
+    [[nodiscard]] double binLow(size_t i) const noexcept {
+        return low + double(i) / scale;
+    }
+
+    /// Get the number of samples below the histogram range.
+    [[nodiscard]] size_t below() const noexcept { return numBelow; }
+
+    /// Get the number of samples above the histogram range.
+    [[nodiscard]] size_t above() const noexcept { return numAbove; }
+
+  private:
+    std::vector<size_t> counts;
+    const double low;
+    const double high;
+    const double scale;
+    size_t numBelow = 0;
+    size_t numAbove = 0;
+};
+
+} // namespace PAF::SCA
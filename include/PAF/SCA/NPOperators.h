@@ -22,6 +22,7 @@
 
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <type_traits>
 
@@ -194,6 +195,61 @@ template <typename Ty> class AbsDiff : public NPBinaryOperator {
     }
 };
 
+/// Count the bits set in \p v. With a population count instruction (e.g.
+/// x86's POPCNT, or aarch64's CNT), the compiler vectorizes loops of
+/// popcount, with AVX-512 VPOPCNTDQ or NEON CNT when available. Otherwise,
+/// the bits are counted in parallel within the value, which the compiler can
+/// vectorize as well.
+template <typename Ty> constexpr unsigned popcount(Ty v) noexcept {
+    static_assert(std::is_unsigned_v<Ty> && sizeof(Ty) <= sizeof(uint64_t),
+                  "Ty must be an unsigned integral type of at most 64 bits");
+#if defined(__POPCNT__) || defined(__aarch64__)
+    if constexpr (sizeof(Ty) <= sizeof(unsigned))
+        return __builtin_popcount(v);
+    else
+        return __builtin_popcountll(v);
+#else
+    constexpr Ty m1 = Ty(0x5555555555555555ULL);
+    constexpr Ty m2 = Ty(0x3333333333333333ULL);
+    constexpr Ty m4 = Ty(0x0F0F0F0F0F0F0F0FULL);
+    constexpr Ty h01 = Ty(0x0101010101010101ULL);
+    v = Ty(v - ((v >> 1) & m1));
+    v = Ty((v & m2) + ((v >> 2) & m2));
+    v = Ty((v + (v >> 4)) & m4);
+    return unsigned(Ty(v * h01) >> (8 * (sizeof(Ty) - 1)));
+#endif
+}
+
+/// Get the Hamming weight of \p v, masked with \p mask.
+template <typename Ty> class HammingWeight : public NPUnaryOperator {
+  public:
+    static_assert(std::is_unsigned_v<Ty>,
+                  "The Hamming weight is for unsigned integral types");
+    constexpr HammingWeight(Ty mask = std::numeric_limits<Ty>::max())
+        : mask(mask) {}
+    constexpr Ty operator()(const Ty &v) const noexcept {
+        return Ty(popcount<Ty>(v & mask));
+    }
+
+  private:
+    Ty mask;
+};
+
+/// Get the Hamming distance between \p a and \p b, masked with \p mask.
+template <typename Ty> class HammingDistance : public NPBinaryOperator {
+  public:
+    static_assert(std::is_unsigned_v<Ty>,
+                  "The Hamming distance is for unsigned integral types");
+    constexpr HammingDistance(Ty mask = std::numeric_limits<Ty>::max())
+        : mask(mask) {}
+    constexpr Ty operator()(const Ty &a, const Ty &b) const noexcept {
+        return Ty(popcount<Ty>((a ^ b) & mask));
+    }
+
+  private:
+    Ty mask;
+};
+
 /// Base class for most of our functors.
 template <typename Ty> class State : public NPCollector {
   public:
@@ -348,15 +404,29 @@ class Mean : public State<double> {
   public:
     Mean() : State<double>(0.0) {}
 
+    /// Construct a Mean of \p count samples, with value \p mean.
+    Mean(size_t count, double mean) : State<double>(mean), n(count) {}
+
     void reset() {
-        State<Ty>::setValue(0.0);
+        State<double>::setValue(0.0);
         n = 0;
     }
 
     void operator()(const Ty &s, size_t row = 0, size_t col = 0) {
         n += 1;
-        double delta1 = double(s) - State<Ty>::value();
-        State<Ty>::setValue(State<Ty>::value() + delta1 / double(n));
+        double delta1 = double(s) - State<double>::value();
+        State<double>::setValue(State<double>::value() + delta1 / double(n));
+    }
+
+    /// Merge the samples accumulated by \p other into this Mean.
+    void merge(const Mean &other) {
+        const size_t total = n + other.n;
+        if (total == 0)
+            return;
+        const double delta = other.value() - State<double>::value();
+        State<double>::setValue(State<double>::value() +
+                                delta * double(other.n) / double(total));
+        n = total;
     }
 
     [[nodiscard]] size_t count() const { return n; }
@@ -373,6 +443,11 @@ class MeanWithVar : public Mean<Ty> {
   public:
     MeanWithVar() : Mean<Ty>() {}
 
+    /// Construct a MeanWithVar of \p count samples, with value \p mean and
+    /// \p m2 as the sum of the squared differences to the mean.
+    MeanWithVar(size_t count, double mean, double m2)
+        : Mean<Ty>(count, mean), v(m2) {}
+
     void reset() {
         Mean<Ty>::reset();
         v = 0.0;
@@ -387,10 +462,25 @@ class MeanWithVar : public Mean<Ty> {
         v += delta1 * delta2;
     }
 
+    /// Merge the samples accumulated by \p other into this MeanWithVar,
+    /// using the pairwise update from Chan, Golub and LeVeque.
+    void merge(const MeanWithVar &other) {
+        const size_t total = Mean<Ty>::count() + other.count();
+        if (total == 0)
+            return;
+        const double delta = other.value() - Mean<Ty>::value();
+        v += other.v + delta * delta * double(Mean<Ty>::count()) *
+                           double(other.count()) / double(total);
+        Mean<Ty>::merge(other);
+    }
+
     [[nodiscard]] double var(unsigned ddof = 0) const {
         return v / double(Mean<Ty>::count() - ddof);
     }
 
+    /// Get the sum of the squared differences to the mean.
+    [[nodiscard]] double m2() const { return v; }
+
     [[nodiscard]] double stddev() const {
         return std::sqrt(v / double(Mean<Ty>::count()));
     }
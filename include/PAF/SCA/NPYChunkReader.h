@@ -0,0 +1,187 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/SCA/NPArray.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <string>
+#include <utility>
+
+namespace PAF::SCA {
+
+/// The NPYChunkReader class reads the rows of an NPY file by chunks, so that
+/// files which do not fit in memory can still be processed. While the current
+/// chunk is being processed, the next one can be read in the background.
+template <typename Ty> class NPYChunkReader {
+  public:
+    /// The type of the function used to load the \p window region of \p
+    /// filename.
+    using Loader = std::function<NPArray<Ty>(
+        const std::string &filename, const NPArrayBase::Window &window)>;
+
+    /// Construct an NPYChunkReader for file \p filename, which will read
+    /// chunks of \p chunk_rows rows of the \p window region of the file. The
+    /// next chunk is read in the background when \p prefetch is set. The
+    /// chunks are loaded with \p loader, which by default requires the file
+    /// elements to be of type \p Ty.
+    NPYChunkReader(const std::string &filename, size_t chunk_rows = 4096,
+                   const NPArrayBase::Window &window = NPArrayBase::Window(),
+                   bool prefetch = true, Loader loader = defaultLoader)
+        : filename(filename), loader(std::move(loader)),
+          chunkRows(std::max<size_t>(chunk_rows, 1)), window(window),
+          prefetch(prefetch) {
+        std::ifstream ifs(filename, std::ifstream::binary);
+        if (!ifs) {
+            errstr = "error opening file";
+            return;
+        }
+
+        size_t num_rows;
+        size_t num_columns;
+        std::string elt_ty;
+        size_t elt_size;
+        bool swap;
+        bool fortran;
+        if (!NPArrayBase::getInformation(ifs, num_rows, num_columns, elt_ty,
+                                         elt_size, &errstr, &swap, &fortran))
+            return;
+
+        this->window = window.clamp(num_rows, num_columns);
+        rewind();
+    }
+
+    /// Destruct this NPYChunkReader, waiting for a pending read if any.
+    ~NPYChunkReader() {
+        if (pending.valid())
+            pending.wait();
+    }
+
+    NPYChunkReader(const NPYChunkReader &) = delete;
+    NPYChunkReader &operator=(const NPYChunkReader &) = delete;
+
+    /// Is this NPYChunkReader in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Get the total number of rows that will be read.
+    [[nodiscard]] size_t rows() const noexcept { return window.rows(); }
+
+    /// Get the number of columns in each chunk.
+    [[nodiscard]] size_t cols() const noexcept { return window.cols(); }
+
+    /// Get the (maximum) number of rows in a chunk.
+    [[nodiscard]] size_t chunkSize() const noexcept { return chunkRows; }
+
+    /// Get the number of chunks needed to cover all rows.
+    [[nodiscard]] size_t numChunks() const noexcept {
+        return (rows() + chunkRows - 1) / chunkRows;
+    }
+
+    /// Restart reading from the first chunk.
+    void rewind() {
+        if (pending.valid())
+            pending.wait();
+        pending = std::future<NPArray<Ty>>();
+        current = NPArray<Ty>();
+        currentRow = 0;
+        nextRow = 0;
+        if (good() && prefetch && rows() != 0)
+            pending = std::async(std::launch::async, &NPYChunkReader::read,
+                                 this, nextRow);
+    }
+
+    /// Move to the next chunk. Returns false when all rows have been read or
+    /// in case of error.
+    bool next() {
+        if (!good() || nextRow >= rows()) {
+            current = NPArray<Ty>();
+            return false;
+        }
+
+        current = pending.valid() ? pending.get() : read(nextRow);
+        if (!current.good()) {
+            errstr = "error reading chunk";
+            return false;
+        }
+
+        currentRow = nextRow;
+        nextRow += current.rows();
+        if (prefetch && nextRow < rows())
+            pending = std::async(std::launch::async, &NPYChunkReader::read,
+                                 this, nextRow);
+        return true;
+    }
+
+    /// Get the current chunk.
+    [[nodiscard]] const NPArray<Ty> &chunk() const noexcept { return current; }
+
+    /// Get the index, in the complete set of rows, of the first row of the
+    /// current chunk.
+    [[nodiscard]] size_t chunkBegin() const noexcept { return currentRow; }
+
+    /// Get the first row of the current chunk.
+    [[nodiscard]] typename NPArray<Ty>::const_Row cbegin() const noexcept {
+        return current.cbegin();
+    }
+
+    /// Get a past-the-end row for the current chunk.
+    [[nodiscard]] typename NPArray<Ty>::const_Row cend() const noexcept {
+        return current.cend();
+    }
+
+  private:
+    const std::string filename;
+    const Loader loader;
+    const size_t chunkRows;
+    NPArrayBase::Window window;
+    const bool prefetch;
+    const char *errstr = nullptr;
+
+    NPArray<Ty> current;
+    std::future<NPArray<Ty>> pending;
+    size_t currentRow = 0;
+    size_t nextRow = 0;
+
+    /// Read the chunk starting at \p row. This only accesses immutable state,
+    /// so that it can run concurrently with the processing of the current
+    /// chunk.
+    NPArray<Ty> read(size_t row) const {
+        const size_t b = window.rowBegin + row;
+        const size_t e = std::min(b + chunkRows, window.rowEnd);
+        return loader(filename, NPArrayBase::Window(b, e, window.colBegin,
+                                                    window.colEnd,
+                                                    window.colStride));
+    }
+
+    static NPArray<Ty> defaultLoader(const std::string &filename,
+                                     const NPArrayBase::Window &window) {
+        return NPArray<Ty>(filename, window);
+    }
+};
+
+} // namespace PAF::SCA
@@ -0,0 +1,216 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/SCA/NPArray.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace PAF::SCA {
+
+/// The NPYStreamWriter class writes a matrix to an NPY file row by row, without
+/// holding the complete matrix in memory. The header is written when the file
+/// is opened, and updated with the actual dimensions when the file is closed.
+///
+/// When the number of columns is not known in advance, the rows are written
+/// as they come, and only padded with zeros to the longest row length when
+/// the file is closed. This padding is performed in place, from the last row
+/// to the first one, so that only a row has to be kept in memory.
+///
+/// Long rows are not kept in memory either: they are written to the file by
+/// chunks of ROW_CHUNK_SIZE elements as they grow.
+template <typename Ty> class NPYStreamWriter {
+  public:
+    /// Construct an NPYStreamWriter to file \p filename. If \p num_columns is
+    /// not 0, all rows are padded with zeros to \p num_columns elements and
+    /// longer rows are an error. Otherwise, the number of columns is the
+    /// length of the longest row.
+    NPYStreamWriter(const std::string &filename, size_t num_columns = 0)
+        : numColumns(num_columns), fixedWidth(num_columns != 0) {
+        if (filename.empty()) {
+            errstr = "no file name";
+            return;
+        }
+
+        fs.open(filename, std::fstream::in | std::fstream::out |
+                              std::fstream::trunc | std::fstream::binary);
+        if (!fs) {
+            errstr = "error opening file";
+            return;
+        }
+
+        // Reserve enough room in the header for the largest dimensions.
+        constexpr size_t MAX_DIM = std::numeric_limits<size_t>::max();
+        if (!NPArrayBase::saveHeader(fs, NPArrayBase::getEltTyDescr<Ty>(),
+                                     MAX_DIM, MAX_DIM)) {
+            errstr = "error writing header";
+            return;
+        }
+        dataOffset = fs.tellp();
+    }
+
+    /// Destruct this NPYStreamWriter, closing the file if needed.
+    ~NPYStreamWriter() { static_cast<void>(close()); }
+
+    NPYStreamWriter(const NPYStreamWriter &) = delete;
+    NPYStreamWriter &operator=(const NPYStreamWriter &) = delete;
+
+    /// Is this NPYStreamWriter in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Get the number of rows written so far.
+    [[nodiscard]] size_t rows() const noexcept { return numRows; }
+
+    /// Get the number of columns of the rows written so far.
+    [[nodiscard]] size_t cols() const noexcept { return numColumns; }
+
+    /// The number of elements of the current row kept in memory before they
+    /// are written to the file.
+    static constexpr size_t ROW_CHUNK_SIZE = 16384;
+
+    /// Append \p value to the current row.
+    void append(Ty value) {
+        if (good()) {
+            row.push_back(value);
+            if (row.size() >= ROW_CHUNK_SIZE)
+                writeRowChunk();
+        }
+    }
+
+    /// Append \p values to the current row.
+    void append(const std::vector<Ty> &values) {
+        if (good()) {
+            row.insert(row.end(), values.begin(), values.end());
+            if (row.size() >= ROW_CHUNK_SIZE)
+                writeRowChunk();
+        }
+    }
+
+    /// Terminate the current row, and write it to the file.
+    void next() {
+        if (!good())
+            return;
+
+        const size_t rowLength = rowWritten + row.size();
+        if (fixedWidth) {
+            if (rowLength > numColumns) {
+                errstr = "row is longer than the number of columns";
+                return;
+            }
+            row.resize(numColumns - rowWritten, Ty());
+        } else {
+            numColumns = std::max(numColumns, rowLength);
+            rowLengths.push_back(rowLength);
+        }
+
+        writeRowChunk();
+        numRows += 1;
+        rowWritten = 0;
+        Stats::add(Stats::NPY_ROWS_EMITTED);
+    }
+
+    /// Terminate the current row if it is not empty, pad the rows to the
+    /// number of columns, and update the header with the actual dimensions.
+    /// Returns true if the complete file could be written.
+    bool close() {
+        if (!fs.is_open())
+            return good();
+
+        if (rowWritten != 0 || !row.empty())
+            next();
+        if (good() && !fixedWidth)
+            pad();
+        if (good()) {
+            fs.seekp(0);
+            if (!NPArrayBase::saveHeader(
+                    fs, NPArrayBase::getEltTyDescr<Ty>(), numRows, numColumns,
+                    /* fortran_order: */ false, dataOffset))
+                errstr = "error updating header";
+        }
+        fs.close();
+        rowLengths = std::vector<size_t>();
+        return good();
+    }
+
+  private:
+    std::fstream fs;
+    size_t numRows = 0;
+    size_t numColumns;
+    const bool fixedWidth;
+    size_t dataOffset = 0;
+    const char *errstr = nullptr;
+    std::vector<Ty> row;            ///< The current row.
+    size_t rowWritten = 0;          ///< Elements of row already written.
+    std::vector<size_t> rowLengths; ///< The unpadded rows' lengths.
+
+    /// Write the elements of the current row held in memory to the file.
+    void writeRowChunk() {
+        if (fixedWidth && rowWritten + row.size() > numColumns) {
+            errstr = "row is longer than the number of columns";
+            return;
+        }
+        fs.write(reinterpret_cast<const char *>(row.data()),
+                 row.size() * sizeof(Ty));
+        if (!fs)
+            errstr = "error writing row";
+        rowWritten += row.size();
+        row.clear();
+    }
+
+    /// Spread the unpadded rows to their final position, and pad them with
+    /// zeros. The rows are processed from the last one, so that a row is
+    /// always moved before it is overwritten.
+    void pad() {
+        size_t src = 0;
+        for (size_t len : rowLengths)
+            src += len;
+
+        for (size_t r = numRows; r-- > 0;) {
+            const size_t len = rowLengths[r];
+            src -= len;
+            const size_t dst = r * numColumns;
+            if (src == dst && len == numColumns)
+                continue;
+            row.resize(len);
+            fs.seekg(dataOffset + src * sizeof(Ty));
+            fs.read(reinterpret_cast<char *>(row.data()), len * sizeof(Ty));
+            row.resize(numColumns, Ty());
+            fs.seekp(dataOffset + dst * sizeof(Ty));
+            fs.write(reinterpret_cast<const char *>(row.data()),
+                     numColumns * sizeof(Ty));
+            if (!fs) {
+                errstr = "error padding rows";
+                return;
+            }
+        }
+        row.clear();
+    }
+};
+
+} // namespace PAF::SCA
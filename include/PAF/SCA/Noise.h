@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
 namespace PAF::SCA {
@@ -54,8 +56,27 @@ class NoiseSource {
     /// Get the noise value.
     virtual double get() = 0;
 
-    /// Factory method to get one of the supported noise sources.
+    /// Fill \p out with \p n noise values, the same values that \p n
+    /// successive calls to get() would have returned.
+    virtual void fill(double *out, size_t n) {
+        for (size_t i = 0; i < n; i++)
+            out[i] = get();
+    }
+
+    /// Restart the noise sequence from \p seed, so that it is reproducible.
+    /// Different seeds, even consecutive ones, give unrelated sequences, so
+    /// that the noise of each trace can use its own seed. This has no effect
+    /// on the non random noise sources.
+    virtual void seed(uint64_t seed) {}
+
+    /// Factory method to get one of the supported noise sources. The random
+    /// noise sources are randomly seeded.
     static std::unique_ptr<NoiseSource> getSource(Type, double noiseLevel);
+
+    /// Factory method to get one of the supported noise sources, seeded with
+    /// \p seed.
+    static std::unique_ptr<NoiseSource> getSource(Type, double noiseLevel,
+                                                  uint64_t seed);
 };
 
 } // namespace PAF::SCA
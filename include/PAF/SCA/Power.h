@@ -23,15 +23,21 @@
 #include "PAF/ArchInfo.h"
 #include "PAF/PAF.h"
 #include "PAF/SCA/Dumper.h"
-#include "PAF/SCA/NPAdapter.h"
+#include "PAF/SCA/NPYStreamWriter.h"
 #include "PAF/SCA/Noise.h"
+#include "PAF/utils/Stats.h"
 
 #include "libtarmac/misc.hh"
 
+#include <cassert>
+#include <cstdint>
+#include <deque>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace PAF::SCA {
@@ -73,6 +79,16 @@ class TimingInfo {
         currentCycle = 0;
     }
 
+    /// Add the timing information of \p T, which covers a single trace, to
+    /// the current trace. This is used to gather the timing of traces that
+    /// were analyzed separately.
+    void add(const TimingInfo &T) {
+        if (first)
+            for (const auto &p : T.pcCycle)
+                pcCycle.emplace_back(p.first, currentCycle + p.second);
+        currentCycle += T.currentCycle;
+    }
+
   protected:
     /// The sequence of (pc, cycle_count).
     std::vector<std::pair<Addr, unsigned>> pcCycle;
@@ -94,6 +110,60 @@ class YAMLTimingInfo : public TimingInfo {
     void save(std::ostream &os) const override;
 };
 
+/// The binary Formatter class for TimingInfo, which can be read back with a
+/// BinaryTimingReader.
+class BinaryTimingInfo : public TimingInfo {
+  public:
+    /// Construct a BinaryTimingInfo, which will be gzip compressed if \p
+    /// compressed is set.
+    BinaryTimingInfo(bool compressed) : compressed(compressed) {}
+
+    /// Save this TimingInfo to stream os.
+    void save(std::ostream &os) const override;
+
+  private:
+    bool compressed;
+};
+
+/// PowerSamples holds a sequence of consecutive power samples, as a structure
+/// of arrays: the total power and the contribution of each power source, with
+/// one element per sample.
+struct PowerSamples {
+    std::vector<double> total;
+    std::vector<double> pc;
+    std::vector<double> instr;
+    std::vector<double> oreg;
+    std::vector<double> ireg;
+    std::vector<double> addr;
+    std::vector<double> data;
+    /// The instruction starting at each sample, nullptr for the other cycles.
+    std::vector<const PAF::ReferenceInstruction *> instruction;
+
+    /// Get the number of samples.
+    [[nodiscard]] size_t size() const { return total.size(); }
+    /// Are there any samples ?
+    [[nodiscard]] bool empty() const { return total.empty(); }
+
+    /// Reserve space for \p n samples.
+    void reserve(size_t n);
+    /// Remove all samples.
+    void clear();
+
+    /// Append a sample.
+    void push_back(double Total, double PC, double Instr, double ORegs,
+                   double IRegs, double Addr, double Data,
+                   const PAF::ReferenceInstruction *I) {
+        total.push_back(Total);
+        pc.push_back(PC);
+        instr.push_back(Instr);
+        oreg.push_back(ORegs);
+        ireg.push_back(IRegs);
+        addr.push_back(Addr);
+        data.push_back(Data);
+        instruction.push_back(I);
+    }
+};
+
 /// PowerDumper is a base class for emitting a power trace.
 ///
 /// Subclasssing it enables to support various power trace outputs like CSV or
@@ -108,6 +178,12 @@ class PowerDumper : public Dumper {
                       double ireg, double addr, double data,
                       const PAF::ReferenceInstruction *I) = 0;
 
+    /// Called for a batch of consecutive samples of the trace. The power
+    /// models emit their samples by batches, so dumpers should override this
+    /// to process them at once. The default implementation calls dump for
+    /// each sample.
+    virtual void dumpSamples(const PowerSamples &S);
+
     /// Destruct this PowerDumper
     ~PowerDumper() override = default;
 };
@@ -143,33 +219,107 @@ class CSVPowerDumper : public PowerDumper, public FileStreamDumper {
 /// in NPY format.
 class NPYPowerDumper : public PowerDumper, public FilenameDumper {
   public:
+    /// The element types the power samples can be written as.
+    enum class DType {
+        UINT8,  ///< Unsigned 8-bit integers.
+        UINT16, ///< Unsigned 16-bit integers.
+        FLOAT,  ///< Single precision floating point.
+        DOUBLE, ///< Double precision floating point.
+    };
+
     /// Construct a power trace that will be dumped in NPY format to file
-    /// filename.
-    NPYPowerDumper(const std::string &filename, size_t num_traces)
-        : FilenameDumper(filename), npyA(num_traces) {}
+    /// filename. The traces are written to the file as they are produced, so
+    /// \p num_traces is only a hint. The samples are multiplied by \p scale
+    /// and converted to \p dtype when they are written. Conversions to an
+    /// integer type round to the nearest integer, and saturate to the type
+    /// range.
+    NPYPowerDumper(const std::string &filename, size_t num_traces,
+                   DType dtype = DType::DOUBLE, double scale = 1.0);
 
     /// Construct a power trace that will be dumped in NPY format to stream
     /// os.
     NPYPowerDumper(std::ostream &os, size_t num_traces);
 
+    /// Get the element type from its name \p s (u1, u2, f4 or f8, as in the
+    /// NPY descriptors). Returns false if \p s is not a supported element
+    /// type.
+    static bool getDType(DType &dtype, const std::string &s);
+
     /// Update state when switching to next trace.
-    void nextTrace() override { npyA.next(); }
+    void nextTrace() override { npyW->next(); }
 
     /// Called for each sample in the trace.
     void dump(double total, double pc, double instr, double oreg, double ireg,
               double addr, double data,
               const PAF::ReferenceInstruction *I) override {
-        npyA.append(total);
+        npyW->append(&total, 1);
+    }
+
+    /// Called for a batch of consecutive samples of the trace.
+    void dumpSamples(const PowerSamples &S) override {
+        npyW->append(S.total.data(), S.total.size());
     }
 
     /// Destruct this NPYPowerDumper.
-    ~NPYPowerDumper() override {
-        // Intentionally ignore the return value.
-        static_cast<void>(npyA.save(filename));
+    ~NPYPowerDumper() override;
+
+  private:
+    /// Writer is the interface to the NPYStreamWriter of the selected element
+    /// type.
+    class Writer {
+      public:
+        virtual ~Writer() = default;
+        /// Convert and append the \p n samples in \p values.
+        virtual void append(const double *values, size_t n) = 0;
+        /// Terminate the current row.
+        virtual void next() = 0;
+        /// Complete the file.
+        virtual bool close() = 0;
+    };
+    template <typename Ty> class TypedWriter;
+
+    std::unique_ptr<Writer> npyW;
+};
+
+/// BufferedPowerDumper is a PowerDumper specialization which records a power
+/// trace in memory, so that it can later be replayed to another PowerDumper.
+/// The power trace can span several rows, e.g. the realizations of the noise,
+/// which are separated by calls to nextTrace.
+class BufferedPowerDumper : public PowerDumper {
+  public:
+    /// Construct an empty BufferedPowerDumper.
+    BufferedPowerDumper() {}
+
+    /// Called at the beginning of a trace.
+    void preDump() override {
+        started = true;
+        rows.resize(1);
+    }
+
+    /// Start a new row in the recorded power trace.
+    void nextTrace() override { rows.emplace_back(); }
+
+    /// Called for each sample in the trace.
+    void dump(double total, double pc, double instr, double oreg, double ireg,
+              double addr, double data,
+              const PAF::ReferenceInstruction *I) override {
+        rows.back().push_back(total, pc, instr, oreg, ireg, addr, data,
+                              I == nullptr ? nullptr
+                                           : &instructions.emplace_back(*I));
     }
 
+    /// Called for a batch of consecutive samples of the trace.
+    void dumpSamples(const PowerSamples &S) override;
+
+    /// Replay the recorded power trace to \p D.
+    void replay(PowerDumper &D) const;
+
   private:
-    NPAdapter<double> npyA;
+    std::vector<PowerSamples> rows;
+    /// Copies of the samples' instructions, which samples refers to. A deque
+    /// is used so that adding instructions does not move the existing ones.
+    std::deque<PAF::ReferenceInstruction> instructions;
+    bool started = false;
 };
 
 /// The PowerTraceConfig class is used to configure how a trace is processed in
@@ -206,6 +356,66 @@ class PowerTraceConfig {
         WITH_ALL = 0x3F
     };
 
+    /// The Window class restricts the power analysis to a window of the
+    /// trace: the power samples, the timing information and the register
+    /// bank, memory accesses and instruction traces are only computed and
+    /// dumped for the cycles or instructions [begin, end( of the trace. They
+    /// are counted from the start of the trace, or from the first execution
+    /// of the anchor address if one is set. The state of the complete trace
+    /// is still tracked, so that the hamming distances at the start of the
+    /// window are the same as without a window.
+    class Window {
+      public:
+        /// The unit of the window bounds.
+        enum Unit : uint8_t {
+            /// Cycles, i.e. power samples.
+            CYCLES,
+            /// Instructions.
+            INSTRUCTIONS
+        };
+
+        /// Construct a Window covering the complete trace.
+        Window() = default;
+        /// Construct a Window covering [begin, end( in \p unit.
+        Window(Unit unit, size_t begin,
+               size_t end = std::numeric_limits<size_t>::max())
+            : unit(unit), begin(begin), end(end) {
+            assert(begin <= end && "Window begin is after its end");
+        }
+
+        /// Count the window bounds from the first execution of the
+        /// instruction at \p address.
+        Window &setAnchor(Addr address) {
+            anchor = address;
+            anchored = true;
+            return *this;
+        }
+
+        /// Get the unit of the window bounds.
+        [[nodiscard]] Unit getUnit() const { return unit; }
+        /// Get the start of the window.
+        [[nodiscard]] size_t getBegin() const { return begin; }
+        /// Get the end of the window (excluded).
+        [[nodiscard]] size_t getEnd() const { return end; }
+        /// Are the window bounds counted from an anchor address ?
+        [[nodiscard]] bool hasAnchor() const { return anchored; }
+        /// Get the anchor address.
+        [[nodiscard]] Addr getAnchor() const { return anchor; }
+
+        /// Does this window cover the complete trace ?
+        [[nodiscard]] bool isComplete() const {
+            return !anchored && begin == 0 &&
+                   end == std::numeric_limits<size_t>::max();
+        }
+
+      private:
+        Unit unit{CYCLES};
+        size_t begin{0};
+        size_t end{std::numeric_limits<size_t>::max()};
+        Addr anchor{0};
+        bool anchored{false};
+    };
+
     /// Default constructor, consider all power sources.
     PowerTraceConfig() : config(WITH_ALL) {}
     /// Constructor for the case with a single power source.
@@ -274,9 +484,21 @@ class PowerTraceConfig {
     }
     /// Does this config have all power sources set ?
     [[nodiscard]] bool withAll() const { return config == WITH_ALL; }
+    /// Get the power sources set in this configuration, as a mask of
+    /// Selection values.
+    [[nodiscard]] unsigned getSources() const { return config & WITH_ALL; }
+
+    /// Restrict the analysis to window \p w of the traces.
+    PowerTraceConfig &setWindow(const Window &w) {
+        window = w;
+        return *this;
+    }
+    /// Get the window of the traces to analyze.
+    [[nodiscard]] const Window &getWindow() const { return window; }
 
   private:
     unsigned config;
+    Window window;
 };
 
 class PowerAnalysisConfig {
@@ -295,7 +517,17 @@ class PowerAnalysisConfig {
                         std::unique_ptr<PowerDumper> &&dumper,
                         NoiseSource::Type noiseTy, double noiseLevel)
         : noiseSource(NoiseSource::getSource(noiseTy, noiseLevel)),
-          powerDumper(std::move(dumper)), powerModel(PwrModel) {}
+          powerDumper(std::move(dumper)), powerModel(PwrModel),
+          noiseTy(noiseTy), noiseLevel(noiseLevel) {}
+
+    /// Construct a PowerAnalysisConfig with the same settings as \p Other,
+    /// but with its own noise source and dumping to \p dumper.
+    PowerAnalysisConfig(const PowerAnalysisConfig &Other,
+                        std::unique_ptr<PowerDumper> &&dumper)
+        : noiseSource(NoiseSource::getSource(Other.noiseTy, Other.noiseLevel)),
+          powerDumper(std::move(dumper)), powerModel(Other.powerModel),
+          noiseTy(Other.noiseTy), noiseLevel(Other.noiseLevel),
+          noise(Other.noise), realizations(Other.realizations) {}
 
     /// Set power model to use.
     PowerAnalysisConfig &set(PowerModel m) {
@@ -328,6 +560,24 @@ class PowerAnalysisConfig {
     }
     /// Get some noise to add to the computed power.
     [[nodiscard]] double getNoise() const { return noiseSource->get(); }
+    /// Get \p n noise values to add to the computed power into \p out.
+    void getNoise(double *out, size_t n) const { noiseSource->fill(out, n); }
+    /// Restart the noise sequence from \p seed.
+    PowerAnalysisConfig &seedNoise(uint64_t seed) {
+        noiseSource->seed(seed);
+        return *this;
+    }
+
+    /// Emit \p n power traces per analyzed execution, each with its own noise.
+    /// The noise free power is computed only once, and the noise of all the
+    /// realizations is drawn from it.
+    PowerAnalysisConfig &setRealizations(unsigned n) {
+        assert(n > 0 && "At least one realization is needed");
+        realizations = n;
+        return *this;
+    }
+    /// Get the number of power traces emitted per analyzed execution.
+    [[nodiscard]] unsigned getRealizations() const { return realizations; }
 
     PowerDumper &getDumper() { return *powerDumper; }
 
@@ -335,7 +585,10 @@ class PowerAnalysisConfig {
     std::unique_ptr<NoiseSource> noiseSource;
     std::unique_ptr<PowerDumper> powerDumper;
     PowerModel powerModel;
+    NoiseSource::Type noiseTy;
+    double noiseLevel;
     bool noise{true};
+    unsigned realizations{1};
 };
 
 /// The PowerTrace class represents a unit of work: an ExecutionRange
@@ -359,20 +612,26 @@ class PowerTrace {
                                                       Time t) const {
             return 0;
         }
+
+        /// Called when the analysis of a trace starts, with \p t the time
+        /// just before its first instruction.
+        virtual void start(Time t) {}
+
+        /// Called as each instruction \p I of the trace is replayed, once
+        /// the state before \p I is no longer needed.
+        virtual void update(const PAF::ReferenceInstruction &I) {}
     };
 
     class MTAOracle : public Oracle {
       public:
         MTAOracle(const PAF::MTAnalyzer &MTA, const PAF::ArchInfo &CPU)
-            : analyzer(MTA), CPU(CPU) {}
+            : analyzer(MTA), CPU(CPU) {
+            for (unsigned r = 0; r < CPU.numRegisters(); r++)
+                regNames.emplace_back(CPU.registerName(r));
+        }
         [[nodiscard]] std::vector<uint64_t>
         getRegBankState(Time t) const override {
-            const unsigned NR = CPU.numRegisters();
-            std::vector<uint64_t> regbankInitialState(NR);
-            for (unsigned r = 0; r < NR; r++)
-                regbankInitialState[r] =
-                    analyzer.getRegisterValueAtTime(CPU.registerName(r), t);
-            return regbankInitialState;
+            return analyzer.getRegisterValuesAtTime(regNames, t);
         }
         [[nodiscard]] uint64_t getMemoryState(Addr address, size_t size,
                                               Time t) const override {
@@ -381,7 +640,7 @@ class PowerTrace {
 
             uint64_t v = 0;
             for (size_t b = 0; b < size; b++) {
-                v <<= 1;
+                v <<= 8;
                 if (analyzer.isBigEndian())
                     v |= mem[b];
                 else
@@ -393,6 +652,53 @@ class PowerTrace {
       private:
         const PAF::MTAnalyzer &analyzer;
         const PAF::ArchInfo &CPU;
+        std::vector<std::string> regNames;
+    };
+
+    /// ShadowOracle tracks the register bank and memory state incrementally,
+    /// from the register and memory accesses of the instructions as they are
+    /// replayed. Only the initial register bank, and the memory bytes not
+    /// accessed yet, are fetched from the backing Oracle (usually an
+    /// MTAOracle, which has to query the index), so that the state queries
+    /// at the current replay point are cheap. Queries about times earlier
+    /// than the last replayed instruction are forwarded to the backing
+    /// Oracle.
+    class ShadowOracle : public Oracle {
+      public:
+        /// Construct a ShadowOracle, getting the initial state from \p
+        /// backing, for \p CPU, which is big endian if \p big_endian is set.
+        ShadowOracle(std::unique_ptr<Oracle> &&backing,
+                     const PAF::ArchInfo &CPU, bool big_endian);
+
+        [[nodiscard]] std::vector<uint64_t>
+        getRegBankState(Time t) const override;
+
+        [[nodiscard]] uint64_t getMemoryState(Addr address, size_t size,
+                                              Time t) const override;
+
+        void start(Time t) override;
+
+        void update(const PAF::ReferenceInstruction &I) override;
+
+      private:
+        std::unique_ptr<Oracle> backing;
+        const PAF::ArchInfo &CPU;
+        const bool bigEndian;
+        /// Map the register names to their index in the register bank.
+        std::map<std::string, unsigned> regIds;
+        /// The index of the pc in the register bank, if the CPU has one.
+        unsigned pcId;
+        /// The register bank state.
+        std::vector<uint64_t> regs;
+        /// The known memory bytes. It is mutable as bytes are fetched from
+        /// the backing oracle when they are first queried.
+        mutable std::unordered_map<Addr, uint8_t> memory;
+        /// The time of the start of the trace.
+        Time startTime{0};
+        /// The time of the state tracked by this ShadowOracle.
+        Time currentTime{0};
+        /// Has the tracking of the state started ?
+        bool tracking{false};
     };
 
     /// Construct a PowerTrace.
@@ -425,12 +731,72 @@ class PowerTrace {
     /// Get this PowerTrace ArchInfo.
     [[nodiscard]] const PAF::ArchInfo &getArchInfo() const { return CPU; }
 
+    /// Get the memory used by this PowerTrace, in bytes, including the
+    /// storage reserved for growth.
+    [[nodiscard]] size_t memoryUsage() const {
+        size_t bytes = sizeof(*this) +
+                       (instructions.capacity() - instructions.size()) *
+                           sizeof(PAF::ReferenceInstruction);
+        for (const PAF::ReferenceInstruction &I : instructions)
+            bytes += I.memoryUsage();
+        return bytes;
+    }
+
   private:
-    std::vector<PAF::ReferenceInstruction> instructions;
+    /// The instructions, whose storage is accounted to the SCA subsystem in
+    /// the Stats.
+    std::vector<PAF::ReferenceInstruction,
+                TrackingAllocator<PAF::ReferenceInstruction, Stats::MEM_SCA>>
+        instructions;
     const PowerTraceConfig &PTConfig;
     const PAF::ArchInfo &CPU;
 };
 
+/// The PowerTraceRecorder class records all the outputs of the analysis of a
+/// single PowerTrace, so that several PowerTraces can be analyzed
+/// concurrently, and their outputs later replayed in order to the actual
+/// dumpers, as if they had been analyzed sequentially.
+class PowerTraceRecorder {
+  public:
+    /// Construct a PowerTraceRecorder for the analyses in \p PAConfigs. The
+    /// register bank, memory accesses and instruction traces are recorded
+    /// only if \p RBDumper, \p MADumper or \p IDumper are enabled.
+    PowerTraceRecorder(const std::vector<PowerAnalysisConfig> &PAConfigs,
+                       const RegBankDumper &RBDumper,
+                       const MemoryAccessesDumper &MADumper,
+                       const InstrDumper &IDumper);
+
+    PowerTraceRecorder(const PowerTraceRecorder &) = delete;
+    /// Move construct a PowerTraceRecorder.
+    PowerTraceRecorder(PowerTraceRecorder &&) = default;
+
+    /// Get the power analysis configurations used for the recording.
+    std::vector<PowerAnalysisConfig> &getPowerAnalysisConfigs() {
+        return PAConfigs;
+    }
+
+    /// Analyze \p PT with \p oracle, recording its outputs.
+    void analyze(PowerTrace &PT, PowerTrace::Oracle &oracle) {
+        PT.analyze(PAConfigs, oracle, timing, RBDumper, MADumper, IDumper);
+    }
+
+    /// Replay the recorded outputs to the dumpers of \p PAConfigs, to \p
+    /// timing, \p RBDumper, \p MADumper and \p IDumper. Moving them to the
+    /// next trace is left to the caller.
+    void replay(std::vector<PowerAnalysisConfig> &PAConfigs,
+                TimingInfo &timing, RegBankDumper &RBDumper,
+                MemoryAccessesDumper &MADumper, InstrDumper &IDumper) const;
+
+  private:
+    std::vector<PowerAnalysisConfig> PAConfigs;
+    /// The BufferedPowerDumpers owned by PAConfigs.
+    std::vector<const BufferedPowerDumper *> powerDumpers;
+    YAMLTimingInfo timing;
+    BufferedRegBankDumper RBDumper;
+    BufferedMemoryAccessesDumper MADumper;
+    BufferedInstrDumper IDumper;
+};
+
 /// The PowerAnalyzer class is used to create a PowerTrace.
 class PowerAnalyzer : public PAF::MTAnalyzer {
 
@@ -443,6 +809,18 @@ class PowerAnalyzer : public PAF::MTAnalyzer {
     PowerTrace getPowerTrace(const PowerTraceConfig &PTConfig,
                              const ArchInfo &CPU,
                              const PAF::ExecutionRange &ER);
+
+    /// Get a PowerTrace from the tarmac trace lines streamed from \p is,
+    /// e.g. a pipe fed by the model as it runs, without any trace file nor
+    /// index. The register values read by the instructions are tracked along
+    /// the stream, starting from an all zero register bank.
+    static PowerTrace getPowerTrace(const PowerTraceConfig &PTConfig,
+                                    const ArchInfo &CPU, std::istream &is,
+                                    bool isBigEndian = false);
+
+  private:
+    /// The decoded instructions, kept from one PowerTrace to the next.
+    std::unique_ptr<PAF::InstrInfoCache> IICache;
 };
 
 } // namespace PAF::SCA
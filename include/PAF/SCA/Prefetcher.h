@@ -0,0 +1,97 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <utility>
+
+namespace PAF::SCA {
+
+/// The Prefetcher class walks a sequence of items (e.g. the traces files of
+/// a run) which are produced by a loader function, loading the next item in
+/// the background while the current one is being processed, so that I/O and
+/// computations overlap.
+template <typename Item> class Prefetcher {
+  public:
+    /// The type of the function used to produce the item at some index.
+    using Loader = std::function<Item(size_t index)>;
+
+    /// Construct a Prefetcher over the \p num_items items produced by \p
+    /// loader. The first item starts loading right away. The loader is called
+    /// from a background thread when \p prefetch is set, and must thus be safe
+    /// to call concurrently with the processing of the current item.
+    Prefetcher(size_t num_items, Loader loader, bool prefetch = true)
+        : loader(std::move(loader)), numItems(num_items), prefetch(prefetch) {
+        if (prefetch && numItems != 0)
+            pending = std::async(std::launch::async, this->loader, 0);
+    }
+
+    /// Destruct this Prefetcher, waiting for a pending load if any.
+    ~Prefetcher() {
+        if (pending.valid())
+            pending.wait();
+    }
+
+    Prefetcher(const Prefetcher &) = delete;
+    Prefetcher &operator=(const Prefetcher &) = delete;
+
+    /// Get the number of items in the sequence.
+    [[nodiscard]] size_t size() const noexcept { return numItems; }
+
+    /// Move to the next item, starting to load the one after it in the
+    /// background. Returns false when all items have been visited.
+    bool next() {
+        if (nextIndex >= numItems) {
+            item = Item();
+            return false;
+        }
+
+        // Get the load of the next item started before waiting for the
+        // current one, so that the two overlap.
+        std::future<Item> loading = std::move(pending);
+        currentIndex = nextIndex++;
+        if (prefetch && nextIndex < numItems)
+            pending = std::async(std::launch::async, loader, nextIndex);
+        item = loading.valid() ? loading.get() : loader(currentIndex);
+        return true;
+    }
+
+    /// Get the current item.
+    [[nodiscard]] Item &current() noexcept { return item; }
+    [[nodiscard]] const Item &current() const noexcept { return item; }
+
+    /// Get the index of the current item in the sequence.
+    [[nodiscard]] size_t index() const noexcept { return currentIndex; }
+
+  private:
+    const Loader loader;
+    const size_t numItems;
+    const bool prefetch;
+
+    Item item;
+    std::future<Item> pending;
+    size_t currentIndex = 0;
+    size_t nextIndex = 0;
+};
+
+} // namespace PAF::SCA
@@ -0,0 +1,110 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/SCA/NPArray.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace PAF::SCA {
+
+/// The Preprocessor class applies a pipeline of signal processing stages to
+/// each trace, e.g. to low-pass filter, downsample and integrate the samples
+/// per clock cycle before computing a metric. The stages are applied in the
+/// order they were added. Each trace is processed independently, so that
+/// traces can be streamed a chunk at a time, and chunks are processed with
+/// one block of traces per thread.
+///
+/// Traces are extended at their edges by replicating their first and last
+/// samples, and the filters are centered, so that a sample is not moved by
+/// filtering.
+class Preprocessor {
+  public:
+    Preprocessor() = default;
+
+    /// Add a finite impulse response filter with coefficients \p taps, with
+    /// output sample i being the sum of taps[k] * x[i + k - (taps.size() - 1)
+    /// / 2].
+    Preprocessor &addFIR(std::vector<double> taps);
+
+    /// Add a moving average filter over \p width samples.
+    Preprocessor &addMovingAverage(size_t width);
+
+    /// Add a downsampling by \p factor, keeping one sample every \p factor
+    /// samples after an anti-aliasing low-pass filter (a Hamming windowed
+    /// sinc with a cutoff at the new Nyquist frequency).
+    Preprocessor &addDownsample(size_t factor);
+
+    /// Add an integration per clock cycle of \p period samples, the first
+    /// cycle starting at sample \p offset: each output sample is the sum of
+    /// the samples of a cycle. Only complete cycles are kept.
+    Preprocessor &addIntegrate(size_t period, size_t offset = 0);
+
+    /// Get the number of stages in this pipeline.
+    [[nodiscard]] size_t size() const noexcept { return stages.size(); }
+    /// Does this pipeline have no stages at all ?
+    [[nodiscard]] bool empty() const noexcept { return stages.empty(); }
+
+    /// Get the number of samples output for traces of \p num_samples samples.
+    [[nodiscard]] size_t samples(size_t num_samples) const;
+
+    /// The scratch buffers used when applying a pipeline, which can be reused
+    /// from one trace to the next.
+    struct Scratch {
+        std::vector<double> padded;   ///< A stage input, with its edges.
+        std::vector<double> stage[2]; ///< The intermediate stage outputs.
+    };
+
+    /// Apply this pipeline to the \p n samples at \p in, writing the
+    /// samples(n) output samples to \p out.
+    void apply(double *out, const double *in, size_t n,
+               Scratch &scratch) const;
+
+    /// Apply this pipeline to all traces in \p traces.
+    template <typename Ty>
+    [[nodiscard]] NPArray<double> apply(const NPArrayView<Ty> &traces) const;
+
+    /// Apply this pipeline to all traces in \p traces.
+    template <typename Ty>
+    [[nodiscard]] NPArray<double> apply(const NPArray<Ty> &traces) const {
+        return apply(NPArrayView<Ty>(traces));
+    }
+
+  private:
+    struct Stage {
+        enum Kind { FIR, MOVING_AVERAGE, DOWNSAMPLE, INTEGRATE } kind;
+        size_t n;      ///< The width, factor or period of the stage.
+        size_t offset; ///< The first cycle offset, when integrating.
+        std::vector<double> taps; ///< The filter coefficients.
+    };
+    std::vector<Stage> stages;
+
+    /// Get the number of samples output by \p S for \p n input samples.
+    static size_t samples(const Stage &S, size_t n);
+
+    /// Apply stage \p S to the \p n samples at \p in, writing its output
+    /// samples to \p out, using \p padded as a scratch buffer.
+    static void apply(const Stage &S, double *out, const double *in, size_t n,
+                      std::vector<double> &padded);
+};
+
+} // namespace PAF::SCA
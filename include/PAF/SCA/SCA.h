@@ -21,9 +21,15 @@
 #pragma once
 
 #include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/NPOperators.h"
+#include "PAF/SCA/NPYChunkReader.h"
+#include "PAF/SCA/ShardedNPArray.h"
 
+#include <cstdint>
 #include <functional>
 #include <ostream>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 namespace PAF::SCA {
@@ -31,14 +37,26 @@ namespace PAF::SCA {
 /// Compute the hamming weight of \p val, masked with \p mask.
 template <class Ty>
 unsigned constexpr hamming_weight(Ty val, Ty mask) noexcept {
-    return __builtin_popcount(val & mask);
+    using UTy = std::make_unsigned_t<std::remove_cv_t<Ty>>;
+    return popcount<UTy>(val & mask);
+}
+
+/// Compute to \p hw the hamming weights of the \p n values in \p vals, each
+/// one masked with \p mask.
+template <class Ty, class OutTy>
+void hamming_weight(OutTy *hw, const Ty *vals, size_t n, Ty mask) noexcept {
+    static_assert(std::is_unsigned<Ty>() && sizeof(Ty) <= sizeof(uint64_t),
+                  "Ty must be an unsigned integral type of at most 64 bits");
+    for (size_t i = 0; i < n; i++)
+        hw[i] = OutTy(popcount<Ty>(vals[i] & mask));
 }
 
 /// Compute the hamming distance from \p val1 to \p val2 with \p mask applied to
 /// each.
 template <class Ty>
 unsigned constexpr hamming_distance(Ty val1, Ty val2, Ty mask) noexcept {
-    return __builtin_popcount((val1 & mask) ^ (val2 & mask));
+    using UTy = std::make_unsigned_t<std::remove_cv_t<Ty>>;
+    return popcount<UTy>((val1 ^ val2) & mask);
 }
 
 /// The Classification enum is used to assign a group (or no group) to traces
@@ -49,44 +67,207 @@ enum class Classification : char {
     IGNORE   ///< Exclude this traces from the test.
 };
 
+/// The Classifiers class holds several classifications of the same traces, as
+/// used by specific t-tests with many partitionings of the traces (e.g. one
+/// per bit of an S-box output). They are packed as bits, trace by trace: for
+/// each classifier, a bit tells if the trace is in group 1, and another one
+/// if it is ignored. Traces are in group 0 by default.
+class Classifiers {
+  public:
+    /// The number of classifiers packed in a word.
+    static constexpr size_t WORD_BITS = 64;
+
+    /// Construct \p num_classifiers classifiers of \p num_traces traces, all
+    /// in group 0.
+    explicit Classifiers(size_t num_classifiers = 0, size_t num_traces = 0)
+        : numClassifiers(num_classifiers), numTraces(num_traces),
+          numWords((num_classifiers + WORD_BITS - 1) / WORD_BITS),
+          group1Bits(numWords * num_traces, 0),
+          ignoreBits(numWords * num_traces, 0) {}
+
+    /// Get the number of classifiers.
+    [[nodiscard]] size_t size() const noexcept { return numClassifiers; }
+
+    /// Get the number of traces.
+    [[nodiscard]] size_t traces() const noexcept { return numTraces; }
+
+    /// Get the number of words holding the bits of a trace.
+    [[nodiscard]] size_t words() const noexcept { return numWords; }
+
+    /// Classify trace \p trace as \p c for classifier \p classifier.
+    void set(size_t classifier, size_t trace, Classification c) noexcept {
+        const size_t w = trace * numWords + classifier / WORD_BITS;
+        const uint64_t bit = uint64_t(1) << (classifier % WORD_BITS);
+        group1Bits[w] &= ~bit;
+        ignoreBits[w] &= ~bit;
+        if (c == Classification::GROUP_1)
+            group1Bits[w] |= bit;
+        else if (c == Classification::IGNORE)
+            ignoreBits[w] |= bit;
+    }
+
+    /// Set classifier \p classifier from \p classification.
+    void set(size_t classifier,
+             const std::vector<Classification> &classification) noexcept {
+        for (size_t t = 0; t < numTraces; t++)
+            set(classifier, t, classification[t]);
+    }
+
+    /// Get the classification of trace \p trace for classifier \p
+    /// classifier.
+    [[nodiscard]] Classification get(size_t classifier,
+                                     size_t trace) const noexcept {
+        const size_t w = trace * numWords + classifier / WORD_BITS;
+        const uint64_t bit = uint64_t(1) << (classifier % WORD_BITS);
+        if (ignoreBits[w] & bit)
+            return Classification::IGNORE;
+        return group1Bits[w] & bit ? Classification::GROUP_1
+                                   : Classification::GROUP_0;
+    }
+
+    /// Get the words holding the group 1 bits of trace \p trace.
+    [[nodiscard]] const uint64_t *group1(size_t trace) const noexcept {
+        return &group1Bits[trace * numWords];
+    }
+
+    /// Get the words holding the ignore bits of trace \p trace.
+    [[nodiscard]] const uint64_t *ignored(size_t trace) const noexcept {
+        return &ignoreBits[trace * numWords];
+    }
+
+  private:
+    size_t numClassifiers;
+    size_t numTraces;
+    size_t numWords;
+    std::vector<uint64_t> group1Bits;
+    std::vector<uint64_t> ignoreBits;
+};
+
+// The t-test and correlation functions below are templated on the storage
+// type Ty of the traces, so that traces can be analyzed without first being
+// converted to double. Whatever Ty is, the statistics are accumulated and the
+// results are computed in double precision. They are available for double,
+// float, int16_t and uint16_t traces.
+
 /// Compute Welsh t-test from sample \p b to \p e on \p traces, using the
 /// classification from \p classifier.
-NPArray<double> t_test(size_t b, size_t e, const NPArray<double> &traces,
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, const NPArrayView<Ty> &traces,
                        const std::vector<Classification> &classifier);
 
 /// Compute Welsh t-test for sample \p s on \p traces, using the
 /// classification from \p classifier.
-double t_test(size_t s, const NPArray<double> &traces,
+template <typename Ty>
+double t_test(size_t s, const NPArrayView<Ty> &traces,
               const std::vector<Classification> &classifier);
 
+/// Compute Welsh t-test from sample \p b to \p e on all the traces read by
+/// chunks from \p traces, using the classification from \p classifier.
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, NPYChunkReader<Ty> &traces,
+                       const std::vector<Classification> &classifier);
+
+/// Compute Welsh t-test from sample \p b to \p e on all the traces from the
+/// \p traces shards, using the classification from \p classifier.
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, ShardedNPArray<Ty> &traces,
+                       const std::vector<Classification> &classifier);
+
+/// \name Multiple classifiers t-tests
+/// Compute Welsh's t-test for each of the \p classifiers, in a single pass
+/// over the traces: each trace sample is read once for all classifiers. The
+/// result has one row per classifier. Each group of each classifier must have
+/// more than one trace.
+/// @{
+
+/// Compute Welsh's t-tests from sample \p b to \p e on \p traces, for each
+/// of the \p classifiers.
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, const NPArrayView<Ty> &traces,
+                       const Classifiers &classifiers);
+
+/// Compute Welsh's t-tests from sample \p b to \p e on all the traces from
+/// the \p traces shards, for each of the \p classifiers.
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, ShardedNPArray<Ty> &traces,
+                       const Classifiers &classifiers);
+/// @}
+
 /// Compute Welsh's t-test from sample \p b to \p e on traces, assuming the
 /// traces have been split into \p group0 and \p group1.
-NPArray<double> t_test(size_t b, size_t e, const NPArray<double> &group0,
-                       const NPArray<double> &group1);
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, const NPArrayView<Ty> &group0,
+                       const NPArrayView<Ty> &group1);
 
 /// Compute Welsh's t-test for sample \p s on traces, assuming the traces
 /// have been split into \p group0 and \p group1.
-double t_test(size_t s, const NPArray<double> &group0,
-              const NPArray<double> &group1);
+template <typename Ty>
+double t_test(size_t s, const NPArrayView<Ty> &group0,
+              const NPArrayView<Ty> &group1);
 
 /// Compute Student's t-test for samples \p s in all traces in \p traces.
-double t_test(size_t s, double m0, const NPArray<double> &traces);
+template <typename Ty>
+double t_test(size_t s, double m0, const NPArrayView<Ty> &traces);
 
 /// Compute Student's t-test for samples \p s in traces for which \p select
 /// returns true.
-double t_test(size_t s, double m0, const NPArray<double> &traces,
+template <typename Ty>
+double t_test(size_t s, double m0, const NPArrayView<Ty> &traces,
               const std::function<bool(size_t)> &select);
 
 /// Compute Student's t-test from samples \p b to \p e in \p traces.
+template <typename Ty>
 NPArray<double> t_test(size_t b, size_t e, const std::vector<double> &m0,
-                       const NPArray<double> &traces);
+                       const NPArrayView<Ty> &traces);
 
 /// Compute Student's t-test from samples \p b to \p e in \p traces for traces
 /// for which \p select returns true.
+template <typename Ty>
 NPArray<double> t_test(size_t b, size_t e, const std::vector<double> &m0,
-                       const NPArray<double> &traces,
+                       const NPArrayView<Ty> &traces,
                        const std::function<bool(size_t)> &select);
 
+/// \name Higher order t-tests
+/// Compute the univariate t-test of order \p order, as used for the leakage
+/// assessment of masked implementations. The samples are centered (order 2)
+/// or standardized (order 3 and above) before being compared, as described by
+/// T. Schneider and A. Moradi in "Leakage Assessment Methodology" (CHES
+/// 2015). The central moments up to order 2 x \p order are computed in a
+/// single pass over the traces, without any temporary copy of the traces.
+/// Order 1 is Welsh's t-test. Each group must have more than one trace.
+/// @{
+
+/// Compute the t-test of order \p order from sample \p b to \p e on \p
+/// traces, using the classification from \p classifier.
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, unsigned order,
+                       const NPArrayView<Ty> &traces,
+                       const std::vector<Classification> &classifier);
+
+/// Compute the t-test of order \p order from sample \p b to \p e on all the
+/// traces read by chunks from \p traces, using the classification from \p
+/// classifier.
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, unsigned order,
+                       NPYChunkReader<Ty> &traces,
+                       const std::vector<Classification> &classifier);
+
+/// Compute the t-test of order \p order from sample \p b to \p e on all the
+/// traces from the \p traces shards, using the classification from \p
+/// classifier.
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, unsigned order,
+                       ShardedNPArray<Ty> &traces,
+                       const std::vector<Classification> &classifier);
+
+/// Compute the t-test of order \p order from sample \p b to \p e, assuming
+/// the traces have been split into \p group0 and \p group1.
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, unsigned order,
+                       const NPArrayView<Ty> &group0,
+                       const NPArrayView<Ty> &group1);
+/// @}
+
 /// Compute the so-called perfect t-test between \p group0 and \p group1, from
 /// sample \p b to \p e.
 ///
@@ -98,9 +279,10 @@ NPArray<double> t_test(size_t b, size_t e, const std::vector<double> &m0,
 ///  - if variance(group0(t)) == 0 or variance(group1(t)) == 0, run a Student
 ///  t-test.
 ///  - run a Welsh t-test otherwise
+template <typename Ty>
 NPArray<double> perfect_t_test(size_t b, size_t e,
-                               const NPArray<double> &group0,
-                               const NPArray<double> &group1,
+                               const NPArrayView<Ty> &group0,
+                               const NPArrayView<Ty> &group1,
                                std::ostream *os = nullptr);
 
 /// Compute the so-called perfect t-test between 2 groups of traces from \p
@@ -114,13 +296,414 @@ NPArray<double> perfect_t_test(size_t b, size_t e,
 ///  - if variance(group0(t)) == 0 or variance(group1(t)) == 0, run a Student
 ///  t-test.
 ///  - run a Welsh t-test otherwise
+template <typename Ty>
 NPArray<double> perfect_t_test(size_t b, size_t e,
-                               const NPArray<double> &traces,
+                               const NPArrayView<Ty> &traces,
                                const std::vector<Classification> &classifier,
                                std::ostream *os = nullptr);
 
+/// \name Pearson correlation
+/// The intermediate values \p ival hold one or more hypotheses, with a row
+/// per hypothesis and a column per trace, and the result has the correlation
+/// of each hypothesis (row) with each sample (column). All hypotheses are
+/// evaluated at once, in a single pass over the traces, which is what a key
+/// recovery correlation power analysis needs.
+/// @{
+
 /// Compute the Pearson correlation, from samples \p b to
 /// \p e, on \p traces using the \p ival intermediate values.
-NPArray<double> correl(size_t b, size_t e, const NPArray<double> &traces,
+template <typename Ty>
+NPArray<double> correl(size_t b, size_t e, const NPArrayView<Ty> &traces,
                        const NPArray<double> &ival);
+
+/// Compute the Pearson correlation, from samples \p b to \p e, on all the
+/// traces read by chunks from \p traces using the \p ival intermediate
+/// values.
+template <typename Ty>
+NPArray<double> correl(size_t b, size_t e, NPYChunkReader<Ty> &traces,
+                       const NPArray<double> &ival);
+
+/// Compute the Pearson correlation, from samples \p b to \p e, on all the
+/// traces from the \p traces shards using the \p ival intermediate values.
+template <typename Ty>
+NPArray<double> correl(size_t b, size_t e, ShardedNPArray<Ty> &traces,
+                       const NPArray<double> &ival);
+/// @}
+
+/// \name Bivariate second order analyses
+/// The leakage of a first order masked implementation shows in the
+/// combination of pairs of samples. The pairs of samples (i, j) from \p b to
+/// \p e are combined with the centered product (x_i - m_i) * (x_j - m_j),
+/// where m is the sample mean (over all traces for the correlation, over the
+/// trace's group for the t-test). The (e - b)^2 / 2 combined points are never
+/// materialized: the traces are processed a block at a time, with the
+/// centered products of a tile of pairs formed on the fly and their moments
+/// accumulated per tile, the tiles being spread over the worker threads. The
+/// result is the symmetric (e - b) x (e - b) matrix of the metric for each
+/// pair, its diagonal holding the univariate second order metric.
+/// @{
+
+/// Compute the bivariate second order t-test, from samples \p b to \p e, on
+/// \p traces, using the classification from \p classifier. Each group must
+/// have more than one trace.
+template <typename Ty>
+NPArray<double>
+bivariate_t_test(size_t b, size_t e, const NPArrayView<Ty> &traces,
+                 const std::vector<Classification> &classifier);
+
+/// Compute the bivariate second order t-test, from samples \p b to \p e, on
+/// all the traces from the \p traces shards, using the classification from
+/// \p classifier. Each group must have more than one trace.
+template <typename Ty>
+NPArray<double>
+bivariate_t_test(size_t b, size_t e, ShardedNPArray<Ty> &traces,
+                 const std::vector<Classification> &classifier);
+
+/// Compute the bivariate second order Pearson correlation, from samples \p b
+/// to \p e, on \p traces using the intermediate values \p ival (a single
+/// row, with a column per trace).
+template <typename Ty>
+NPArray<double> bivariate_correl(size_t b, size_t e,
+                                 const NPArrayView<Ty> &traces,
+                                 const NPArray<double> &ival);
+
+/// Compute the bivariate second order Pearson correlation, from samples \p b
+/// to \p e, on all the traces from the \p traces shards using the
+/// intermediate values \p ival (a single row, with a column per trace).
+template <typename Ty>
+NPArray<double> bivariate_correl(size_t b, size_t e,
+                                 ShardedNPArray<Ty> &traces,
+                                 const NPArray<double> &ival);
+/// @}
+
+/// \name NPArray traces
+/// The element type can not be deduced through the conversion from an
+/// NPArray to an NPArrayView, so these overloads perform that conversion
+/// explicitly for the functions above.
+/// @{
+
+/// Are \p G0 and \p G1 a pair of groups of traces, with at least one of them
+/// being an NPArray rather than an NPArrayView ?
+template <class G0, class G1> struct isNPArrayGroups {
+    static constexpr bool value = false;
+};
+template <class Ty> struct isNPArrayGroups<NPArray<Ty>, NPArray<Ty>> {
+    static constexpr bool value = true;
+};
+template <class Ty> struct isNPArrayGroups<NPArray<Ty>, NPArrayView<Ty>> {
+    static constexpr bool value = true;
+};
+template <class Ty> struct isNPArrayGroups<NPArrayView<Ty>, NPArray<Ty>> {
+    static constexpr bool value = true;
+};
+template <class G0, class G1>
+constexpr bool isNPArrayGroups_v = isNPArrayGroups<G0, G1>::value;
+
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, const NPArray<Ty> &traces,
+                       const std::vector<Classification> &classifier) {
+    return t_test(b, e, NPArrayView<Ty>(traces), classifier);
+}
+
+template <typename Ty>
+double t_test(size_t s, const NPArray<Ty> &traces,
+              const std::vector<Classification> &classifier) {
+    return t_test(s, NPArrayView<Ty>(traces), classifier);
+}
+
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, const NPArray<Ty> &traces,
+                       const Classifiers &classifiers) {
+    return t_test(b, e, NPArrayView<Ty>(traces), classifiers);
+}
+
+template <class G0, class G1,
+          std::enable_if_t<isNPArrayGroups_v<G0, G1>, bool> = true>
+NPArray<double> t_test(size_t b, size_t e, const G0 &group0,
+                       const G1 &group1) {
+    using Ty = typename G0::DataTy;
+    return t_test(b, e, NPArrayView<Ty>(group0), NPArrayView<Ty>(group1));
+}
+
+template <class G0, class G1,
+          std::enable_if_t<isNPArrayGroups_v<G0, G1>, bool> = true>
+double t_test(size_t s, const G0 &group0, const G1 &group1) {
+    using Ty = typename G0::DataTy;
+    return t_test(s, NPArrayView<Ty>(group0), NPArrayView<Ty>(group1));
+}
+
+template <typename Ty>
+double t_test(size_t s, double m0, const NPArray<Ty> &traces) {
+    return t_test(s, m0, NPArrayView<Ty>(traces));
+}
+
+template <typename Ty>
+double t_test(size_t s, double m0, const NPArray<Ty> &traces,
+              const std::function<bool(size_t)> &select) {
+    return t_test(s, m0, NPArrayView<Ty>(traces), select);
+}
+
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, const std::vector<double> &m0,
+                       const NPArray<Ty> &traces) {
+    return t_test(b, e, m0, NPArrayView<Ty>(traces));
+}
+
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, const std::vector<double> &m0,
+                       const NPArray<Ty> &traces,
+                       const std::function<bool(size_t)> &select) {
+    return t_test(b, e, m0, NPArrayView<Ty>(traces), select);
+}
+
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, unsigned order,
+                       const NPArray<Ty> &traces,
+                       const std::vector<Classification> &classifier) {
+    return t_test(b, e, order, NPArrayView<Ty>(traces), classifier);
+}
+
+template <class G0, class G1,
+          std::enable_if_t<isNPArrayGroups_v<G0, G1>, bool> = true>
+NPArray<double> t_test(size_t b, size_t e, unsigned order, const G0 &group0,
+                       const G1 &group1) {
+    using Ty = typename G0::DataTy;
+    return t_test(b, e, order, NPArrayView<Ty>(group0),
+                  NPArrayView<Ty>(group1));
+}
+
+template <class G0, class G1,
+          std::enable_if_t<isNPArrayGroups_v<G0, G1>, bool> = true>
+NPArray<double> perfect_t_test(size_t b, size_t e, const G0 &group0,
+                               const G1 &group1, std::ostream *os = nullptr) {
+    using Ty = typename G0::DataTy;
+    return perfect_t_test(b, e, NPArrayView<Ty>(group0),
+                          NPArrayView<Ty>(group1), os);
+}
+
+template <typename Ty>
+NPArray<double> perfect_t_test(size_t b, size_t e, const NPArray<Ty> &traces,
+                               const std::vector<Classification> &classifier,
+                               std::ostream *os = nullptr) {
+    return perfect_t_test(b, e, NPArrayView<Ty>(traces), classifier, os);
+}
+
+template <typename Ty>
+NPArray<double> correl(size_t b, size_t e, const NPArray<Ty> &traces,
+                       const NPArray<double> &ival) {
+    return correl(b, e, NPArrayView<Ty>(traces), ival);
+}
+
+template <typename Ty>
+NPArray<double>
+bivariate_t_test(size_t b, size_t e, const NPArray<Ty> &traces,
+                 const std::vector<Classification> &classifier) {
+    return bivariate_t_test(b, e, NPArrayView<Ty>(traces), classifier);
+}
+
+template <typename Ty>
+NPArray<double> bivariate_correl(size_t b, size_t e,
+                                 const NPArray<Ty> &traces,
+                                 const NPArray<double> &ival) {
+    return bivariate_correl(b, e, NPArrayView<Ty>(traces), ival);
+}
+/// @}
+
+/// The TTestAccumulator class accumulates, one batch of traces at a time, the
+/// per-sample statistics of the 2 groups of traces needed by Welsh's t-test.
+/// Accumulators filled independently, e.g. on different acquisition
+/// machines, can be merged, and their state can be saved to and restored
+/// from an NPY file.
+template <typename Ty> class TTestAccumulator {
+  public:
+    /// Construct an empty TTestAccumulator for traces of \p num_samples
+    /// samples.
+    explicit TTestAccumulator(size_t num_samples = 0);
+
+    /// Construct a TTestAccumulator from the state saved in file \p
+    /// filename. Only the samples in the columns of \p window are restored
+    /// (its rows are ignored).
+    explicit TTestAccumulator(
+        const std::string &filename,
+        const NPArrayBase::Window &window = NPArrayBase::Window());
+
+    /// Is this TTestAccumulator in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Get the number of samples per trace.
+    [[nodiscard]] size_t samples() const noexcept { return avg[0].size(); }
+
+    /// Get the number of traces accumulated in \p group.
+    [[nodiscard]] size_t count(Classification group) const noexcept;
+
+    /// Add all \p traces to \p group. Traces classified as
+    /// Classification::IGNORE are ignored.
+    void add(const NPArrayView<Ty> &traces, Classification group);
+
+    /// Add \p traces, classified according to \p classifier, with \p
+    /// first_trace being the index in \p classifier of the first trace.
+    void add(const NPArrayView<Ty> &traces,
+             const std::vector<Classification> &classifier,
+             size_t first_trace = 0);
+
+    /// Merge the traces accumulated by \p other into this TTestAccumulator.
+    /// Returns false, leaving this TTestAccumulator unchanged, if they do not
+    /// have the same number of samples.
+    bool merge(const TTestAccumulator &other);
+
+    /// Compute Welsh's t-test for all samples. Each group must have more
+    /// than one trace.
+    [[nodiscard]] NPArray<double> t_test() const;
+
+    /// Save this TTestAccumulator state to file \p filename.
+    [[nodiscard]] bool save(const std::string &filename) const;
+
+  private:
+    std::vector<MeanWithVar<Ty>> avg[2];
+    const char *errstr = nullptr;
+};
+
+/// The CorrelAccumulator class accumulates, one batch of traces at a time,
+/// the per-sample sums needed by the Pearson correlation of the traces with
+/// their intermediate values, for one or more hypotheses. All hypotheses are
+/// accumulated in a single pass over the traces. Accumulators filled
+/// independently, e.g. on different acquisition machines, can be merged, and
+/// their state can be saved to and restored from an NPY file.
+template <typename Ty> class CorrelAccumulator {
+  public:
+    /// Construct an empty CorrelAccumulator for traces of \p num_samples
+    /// samples, and \p num_hypotheses hypotheses.
+    explicit CorrelAccumulator(size_t num_samples = 0,
+                               size_t num_hypotheses = 1);
+
+    /// Construct a CorrelAccumulator from the state saved in file \p
+    /// filename. Only the samples in the columns of \p window are restored
+    /// (its rows are ignored).
+    explicit CorrelAccumulator(
+        const std::string &filename,
+        const NPArrayBase::Window &window = NPArrayBase::Window());
+
+    /// Is this CorrelAccumulator in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Get the number of samples per trace.
+    [[nodiscard]] size_t samples() const noexcept { return sumT.cols(); }
+
+    /// Get the number of hypotheses.
+    [[nodiscard]] size_t hypotheses() const noexcept { return sumH.rows(); }
+
+    /// Get the number of traces accumulated.
+    [[nodiscard]] size_t count() const noexcept { return n; }
+
+    /// Add all \p traces, with the same intermediate value \p ival for all
+    /// hypotheses.
+    void add(const NPArrayView<Ty> &traces, double ival);
+
+    /// Add \p traces, with intermediate values \p ival (a row per
+    /// hypothesis, a column per trace), \p first_trace being the index in \p
+    /// ival of the first trace.
+    void add(const NPArrayView<Ty> &traces, const NPArray<double> &ival,
+             size_t first_trace = 0);
+
+    /// Merge the traces accumulated by \p other into this CorrelAccumulator.
+    /// Returns false, leaving this CorrelAccumulator unchanged, if they do
+    /// not have the same number of samples and hypotheses.
+    bool merge(const CorrelAccumulator &other);
+
+    /// Compute the Pearson correlation for all samples, with a row per
+    /// hypothesis.
+    [[nodiscard]] NPArray<double> correl() const;
+
+    /// Save this CorrelAccumulator state to file \p filename.
+    [[nodiscard]] bool save(const std::string &filename) const;
+
+  private:
+    size_t n = 0;
+    NPArray<double> sumH;
+    NPArray<double> sumH2;
+    NPArray<double> sumT;
+    NPArray<double> sumT2;
+    NPArray<double> sumHT;
+    const char *errstr = nullptr;
+};
+
+/// The ClassAccumulator class accumulates, one batch of traces at a time, the
+/// per-class and per-sample means and variances of traces partitioned in
+/// classes, e.g. by the value of an S-box output. All classes are accumulated
+/// in a single pass over the traces, from which multi-class leakage metrics,
+/// like the signal to noise ratio or the sum of squared pairwise
+/// t-differences, are derived. Accumulators filled independently can be
+/// merged, and their state can be saved to and restored from an NPY file.
+template <typename Ty> class ClassAccumulator {
+  public:
+    /// Construct an empty ClassAccumulator for \p num_classes classes of
+    /// traces of \p num_samples samples.
+    explicit ClassAccumulator(size_t num_classes = 0, size_t num_samples = 0);
+
+    /// Construct a ClassAccumulator from the state saved in file \p
+    /// filename.
+    explicit ClassAccumulator(const std::string &filename);
+
+    /// Is this ClassAccumulator in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Get the number of classes.
+    [[nodiscard]] size_t classes() const noexcept { return numClasses; }
+
+    /// Get the number of samples per trace.
+    [[nodiscard]] size_t samples() const noexcept { return numSamples; }
+
+    /// Get the number of traces accumulated in class \p cls.
+    [[nodiscard]] size_t count(size_t cls) const noexcept;
+
+    /// Add \p traces, trace t being in class \p classes[first_trace + t].
+    /// Traces with a class not lower than classes() are ignored. The traces
+    /// are bucketed by class first, and each class' statistics are then
+    /// updated once per batch, a tile of samples at a time.
+    void add(const NPArrayView<Ty> &traces,
+             const std::vector<uint32_t> &classes, size_t first_trace = 0);
+
+    /// Merge the traces accumulated by \p other into this ClassAccumulator.
+    /// Returns false, leaving this ClassAccumulator unchanged, if they do not
+    /// have the same number of classes and samples.
+    bool merge(const ClassAccumulator &other);
+
+    /// Get the mean of the traces of each class (a row per class), for all
+    /// samples.
+    [[nodiscard]] NPArray<double> means() const;
+
+    /// Compute the signal to noise ratio for all samples: the variance of
+    /// the class means divided by the mean of the class variances, over the
+    /// classes holding at least one trace.
+    [[nodiscard]] NPArray<double> snr() const;
+
+    /// Compute the sum of squared pairwise t-differences (SOST) for all
+    /// samples: the sum, over all pairs of classes holding more than one
+    /// trace, of the squared Welsh's t-statistic of the pair.
+    [[nodiscard]] NPArray<double> sost() const;
+
+    /// Save this ClassAccumulator state to file \p filename.
+    [[nodiscard]] bool save(const std::string &filename) const;
+
+  private:
+    size_t numClasses;
+    size_t numSamples;
+    // The statistics of sample s of class c are at c * numSamples + s.
+    std::vector<MeanWithVar<Ty>> stats;
+    const char *errstr = nullptr;
+
+    [[nodiscard]] const MeanWithVar<Ty> &at(size_t cls, size_t s) const {
+        return stats[cls * numSamples + s];
+    }
+};
+
 } // namespace PAF::SCA
@@ -0,0 +1,250 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/SCA/NPArray.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace PAF::SCA {
+
+/// Get the list of files described by \p spec, which can be:
+///  - '@' followed by the name of a manifest file, which lists a file name per
+///    line (empty lines and lines starting with '#' are ignored, and relative
+///    file names are relative to the manifest directory),
+///  - a glob pattern, in which case the matching file names are sorted,
+///  - a plain file name.
+/// An empty list is returned if the manifest can not be read or if the
+/// pattern does not match any file.
+std::vector<std::string> expandShards(const std::string &spec);
+
+/// The ShardedNPArray class presents a list of NPY files with the same number
+/// of columns (the shards) as a single matrix, which rows are the rows of the
+/// first shard, followed by the rows of the second shard, ... The shards are
+/// never concatenated: they are processed one at a time, like the chunks of
+/// an NPYChunkReader, and the next shard can be loaded in the background
+/// while the current one is processed.
+template <typename Ty> class ShardedNPArray {
+  public:
+    /// The elements' type.
+    using DataTy = Ty;
+
+    /// The type of the function used to load the \p window region of shard
+    /// \p filename.
+    using Loader = std::function<NPArray<Ty>(
+        const std::string &filename, const NPArrayBase::Window &window)>;
+
+    /// Construct a ShardedNPArray covering the \p window region of the
+    /// matrix made of the \p filenames shards, which must all have the same
+    /// number of columns and element type. The shards are read or memory
+    /// mapped according to \p mode, unless a specific \p loader is provided.
+    /// The next shard is loaded in the background when \p prefetch is set,
+    /// so \p loader must report its errors through the returned NPArray.
+    ShardedNPArray(const std::vector<std::string> &filenames,
+                   const NPArrayBase::Window &window = NPArrayBase::Window(),
+                   NPArrayBase::LoadMode mode = NPArrayBase::READ,
+                   bool prefetch = true, Loader loader = nullptr)
+        : filenames(filenames), loader(std::move(loader)), window(0, 0, 0, 0),
+          mode(mode), prefetch(prefetch) {
+        if (this->filenames.empty()) {
+            errstr = "no shard";
+            return;
+        }
+
+        size_t num_columns = 0;
+        std::string shard_elt_ty;
+        shardBegin.push_back(0);
+        for (const auto &filename : this->filenames) {
+            std::ifstream ifs(filename, std::ifstream::binary);
+            if (!ifs) {
+                errstr = "error opening shard";
+                return;
+            }
+
+            size_t num_rows;
+            size_t l_num_columns;
+            std::string elt_ty;
+            size_t elt_size;
+            bool swap;
+            bool fortran;
+            if (!NPArrayBase::getInformation(ifs, num_rows, l_num_columns,
+                                             elt_ty, elt_size, &errstr, &swap,
+                                             &fortran))
+                return;
+            if (shardBegin.size() == 1) {
+                num_columns = l_num_columns;
+                shard_elt_ty = elt_ty;
+            } else if (l_num_columns != num_columns) {
+                errstr = "shards have different numbers of columns";
+                return;
+            } else if (elt_ty != shard_elt_ty) {
+                errstr = "shards have different element types";
+                return;
+            }
+            shardBegin.push_back(shardBegin.back() + num_rows);
+        }
+
+        this->window = window.clamp(shardBegin.back(), num_columns);
+        rewind();
+    }
+
+    /// Destruct this ShardedNPArray, waiting for a pending load if any.
+    ~ShardedNPArray() {
+        if (pending.valid())
+            pending.wait();
+    }
+
+    ShardedNPArray(const ShardedNPArray &) = delete;
+    ShardedNPArray &operator=(const ShardedNPArray &) = delete;
+
+    /// Is this ShardedNPArray in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Get the total number of rows.
+    [[nodiscard]] size_t rows() const noexcept { return window.rows(); }
+
+    /// Get the number of columns.
+    [[nodiscard]] size_t cols() const noexcept { return window.cols(); }
+
+    /// Get the number of shards.
+    [[nodiscard]] size_t numShards() const noexcept {
+        return filenames.size();
+    }
+
+    /// Restart from the first shard.
+    void rewind() {
+        if (pending.valid())
+            pending.wait();
+        pending = std::future<NPArray<Ty>>();
+        current = NPArray<Ty>();
+        currentRow = 0;
+        nextShard = firstShard();
+        if (good() && prefetch && nextShard < numShards())
+            pending = std::async(std::launch::async, &ShardedNPArray::load,
+                                 this, nextShard);
+    }
+
+    /// Move to the next shard. Returns false when all shards have been
+    /// processed or in case of error.
+    bool next() {
+        if (!good() || nextShard >= numShards() ||
+            shardBegin[nextShard] >= window.rowEnd) {
+            current = NPArray<Ty>();
+            return false;
+        }
+
+        current = pending.valid() ? pending.get() : load(nextShard);
+        if (!current.good()) {
+            errstr = "error loading shard";
+            return false;
+        }
+
+        currentRow = std::max(shardBegin[nextShard], window.rowBegin) -
+                     window.rowBegin;
+        nextShard += 1;
+        if (prefetch && nextShard < numShards() &&
+            shardBegin[nextShard] < window.rowEnd)
+            pending = std::async(std::launch::async, &ShardedNPArray::load,
+                                 this, nextShard);
+        return true;
+    }
+
+    /// Get the rows from the current shard.
+    [[nodiscard]] const NPArray<Ty> &chunk() const noexcept { return current; }
+
+    /// Get the index, in the complete set of rows, of the first row of the
+    /// current shard.
+    [[nodiscard]] size_t chunkBegin() const noexcept { return currentRow; }
+
+    /// Get the first row of the current shard.
+    [[nodiscard]] typename NPArray<Ty>::const_Row cbegin() const noexcept {
+        return current.cbegin();
+    }
+
+    /// Get a past-the-end row for the current shard.
+    [[nodiscard]] typename NPArray<Ty>::const_Row cend() const noexcept {
+        return current.cend();
+    }
+
+    /// Get all rows in a single NPArray. This defeats the purpose of
+    /// sharding, but is useful for the algorithms which need all the traces
+    /// at once. An empty NPArray is returned in case of error.
+    [[nodiscard]] NPArray<Ty> concatenate() {
+        NPArray<Ty> result(rows(), cols());
+        rewind();
+        while (next())
+            if (!current.empty())
+                std::memcpy(&result(chunkBegin(), 0), &current(0, 0),
+                            current.size() * sizeof(Ty));
+        return good() ? result : NPArray<Ty>();
+    }
+
+  private:
+    const std::vector<std::string> filenames;
+    const Loader loader;
+    NPArrayBase::Window window;
+    const NPArrayBase::LoadMode mode;
+    const bool prefetch;
+    const char *errstr = nullptr;
+    /// The first row of each shard, followed by the total number of rows.
+    std::vector<size_t> shardBegin;
+
+    NPArray<Ty> current;
+    std::future<NPArray<Ty>> pending;
+    size_t currentRow = 0;
+    size_t nextShard = 0;
+
+    /// Get the first shard with rows in the window.
+    [[nodiscard]] size_t firstShard() const noexcept {
+        if (window.rows() == 0)
+            return numShards();
+        return std::upper_bound(shardBegin.begin(), shardBegin.end() - 1,
+                                window.rowBegin) -
+               shardBegin.begin() - 1;
+    }
+
+    /// Load the part of shard \p shard covered by the window. This only
+    /// accesses immutable state, so that it can run concurrently with the
+    /// processing of the current shard.
+    NPArray<Ty> load(size_t shard) const {
+        const size_t b = std::max(shardBegin[shard], window.rowBegin);
+        const size_t e = std::min(shardBegin[shard + 1], window.rowEnd);
+        const NPArrayBase::Window w(b - shardBegin[shard],
+                                    e - shardBegin[shard], window.colBegin,
+                                    window.colEnd, window.colStride);
+        if (loader)
+            return loader(filenames[shard], w);
+        return NPArray<Ty>(filenames[shard], w, mode);
+    }
+};
+
+} // namespace PAF::SCA
@@ -0,0 +1,142 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/SCA/NPArray.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace PAF::SCA {
+
+/// The StatsCache class persists the state of the per-sample statistics
+/// accumulators (TTestAccumulator, CorrelAccumulator) in a cache directory,
+/// so that the tools run later on the same traces, e.g. with another sample
+/// window or output format, do not have to go over the traces again.
+///
+/// Each state is saved to its own NPY file, named after a key and the range
+/// of samples it covers. The key ties the state to everything it has been
+/// computed from: the traces files, the traces used, their classification or
+/// intermediate values, ... A lookup for a range of samples is served by any
+/// state saved with the same key which covers this range.
+class StatsCache {
+  public:
+    /// The Key class computes the key of a state, by hashing the pieces of
+    /// information the state depends on.
+    class Key {
+      public:
+        /// Add the \p size bytes at \p data to this Key.
+        Key &add(const void *data, size_t size);
+
+        /// Add value \p v to this Key.
+        Key &add(uint64_t v) { return add(&v, sizeof(v)); }
+
+        /// Add string \p s to this Key.
+        Key &add(const std::string &s) {
+            add(uint64_t(s.size()));
+            return add(s.data(), s.size());
+        }
+
+        /// Add file \p filename to this Key: its size and modification time
+        /// are hashed, as well as its content if it is small, or else its
+        /// head and tail, as traces files are usually huge.
+        Key &addFile(const std::string &filename);
+
+        /// Get the key value.
+        [[nodiscard]] uint64_t get() const noexcept { return h; }
+
+      private:
+        uint64_t h = 0xcbf29ce484222325ULL; // 64-bit FNV-1a.
+    };
+
+    /// Construct a StatsCache in directory \p directory, which is created
+    /// if it does not exist yet.
+    explicit StatsCache(const std::string &directory);
+
+    StatsCache(const StatsCache &) = delete;
+    StatsCache &operator=(const StatsCache &) = delete;
+
+    /// Is this StatsCache in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Get the cache directory.
+    [[nodiscard]] const std::string &getDirectory() const noexcept {
+        return directory;
+    }
+
+    /// Get the name of the file where the state for \p key covering samples
+    /// [ \p b, \p e ( is saved.
+    [[nodiscard]] std::string getFilename(uint64_t key, size_t b,
+                                          size_t e) const;
+
+    /// Get the name of a file holding a state for \p key which covers
+    /// samples [ \p b, \p e (, or an empty string if there is none. \p
+    /// window is then set to the columns of those samples in the file.
+    [[nodiscard]] std::string lookup(uint64_t key, size_t b, size_t e,
+                                     NPArrayBase::Window &window) const;
+
+    /// Restore \p acc from a state saved for \p key which covers samples [
+    /// \p b, \p e (. Returns false, leaving \p acc unchanged, if there is no
+    /// such state.
+    template <class Accumulator>
+    bool lookup(uint64_t key, size_t b, size_t e, Accumulator &acc) const {
+        NPArrayBase::Window window;
+        const std::string filename = lookup(key, b, e, window);
+        if (filename.empty())
+            return false;
+        Accumulator cached(filename, window);
+        if (!cached.good() || cached.samples() != e - b)
+            return false;
+        acc = std::move(cached);
+        return true;
+    }
+
+    /// Save the state of \p acc, which covers samples [ \p b, \p e (, for \p
+    /// key. Returns false in case of error.
+    template <class Accumulator>
+    bool insert(uint64_t key, size_t b, size_t e, const Accumulator &acc) {
+        const std::string filename = getFilename(key, b, e);
+        const std::string tmpFilename = getTemporaryFilename(filename);
+        return commit(acc.save(tmpFilename), tmpFilename, filename);
+    }
+
+  private:
+    std::string directory;
+    const char *errstr = nullptr;
+
+    /// Get the name of the temporary file \p filename is written to first,
+    /// so that tools running concurrently never see a partially written
+    /// state.
+    [[nodiscard]] static std::string
+    getTemporaryFilename(const std::string &filename);
+
+    /// Move temporary file \p tmpFilename to \p filename if it has been \p
+    /// saved, or else remove it.
+    bool commit(bool saved, const std::string &tmpFilename,
+                const std::string &filename);
+};
+
+} // namespace PAF::SCA
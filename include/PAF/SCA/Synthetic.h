@@ -0,0 +1,119 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/Noise.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace PAF::SCA {
+
+/// The SyntheticTraces class generates side channel traces with a known
+/// leakage, so that the analyses can be tested, benchmarked or sized at scale
+/// without actual captures.
+///
+/// Each trace is associated to a random plaintext byte p. At sample
+/// leakSample, the trace leaks the Hamming weight of AES_SBOX(p ^ key), while
+/// the other samples hold the Hamming weight of unrelated random bytes. Noise
+/// from a NoiseSource is added to all samples.
+///
+/// A trace only depends on the seed and on its number, so that traces can be
+/// generated in any order, or by chunks, and are reproducible from one run to
+/// the next.
+class SyntheticTraces {
+  public:
+    /// Construct a SyntheticTraces generator for traces of \p numSamples
+    /// samples, leaking key byte \p key at sample \p leakSample, with noise of
+    /// type \p noiseTy and level \p noiseLevel.
+    SyntheticTraces(size_t numSamples, size_t leakSample, uint8_t key,
+                    NoiseSource::Type noiseTy, double noiseLevel,
+                    uint64_t seed = 0);
+
+    /// Get the number of samples in a trace.
+    [[nodiscard]] size_t getNumSamples() const { return numSamples; }
+
+    /// Get the sample where the key leaks.
+    [[nodiscard]] size_t getLeakSample() const { return leakSample; }
+
+    /// Get the key byte.
+    [[nodiscard]] uint8_t getKey() const { return key; }
+
+    /// Get the plaintext byte of trace \p n.
+    [[nodiscard]] uint8_t getInput(size_t n) const;
+
+    /// Get the value leaked by trace \p n, without noise.
+    [[nodiscard]] unsigned getLeakage(size_t n) const;
+
+    /// Generate trace \p n into \p samples, which must have room for
+    /// getNumSamples() elements.
+    void getTrace(size_t n, double *samples);
+
+    /// Get traces [first, first + numTraces) as a matrix with one trace per
+    /// row. For integral types, the samples are rounded to the nearest value
+    /// representable by Ty.
+    template <class Ty>
+    NPArray<Ty> getTraces(size_t first, size_t numTraces) {
+        NPArray<Ty> traces(numTraces, numSamples);
+        std::vector<double> samples(numSamples);
+        for (size_t r = 0; r < numTraces; r++) {
+            getTrace(first + r, samples.data());
+            for (size_t c = 0; c < numSamples; c++)
+                traces(r, c) = convert<Ty>(samples[c]);
+        }
+        return traces;
+    }
+
+    /// Get the plaintext bytes of traces [first, first + numTraces), as a
+    /// matrix with one row per trace. They are stored as 32-bit values, as
+    /// expected for the inputs of the SCA tools.
+    [[nodiscard]] NPArray<uint32_t> getInputs(size_t first,
+                                              size_t numTraces) const;
+
+    /// Convert sample \p v to type Ty, the way getTraces does.
+    template <class Ty> static Ty convert(double v) {
+        if constexpr (std::is_integral_v<Ty>) {
+            const double r = std::round(v);
+            if (r <= double(std::numeric_limits<Ty>::min()))
+                return std::numeric_limits<Ty>::min();
+            if (r >= double(std::numeric_limits<Ty>::max()))
+                return std::numeric_limits<Ty>::max();
+            return Ty(r);
+        } else
+            return Ty(v);
+    }
+
+  private:
+    const size_t numSamples;
+    const size_t leakSample;
+    const uint8_t key;
+    const uint64_t seed;
+    std::unique_ptr<NoiseSource> noise;
+    std::vector<double> noiseSamples;
+};
+
+} // namespace PAF::SCA
@@ -0,0 +1,158 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/SCA/NPArray.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PAF::SCA {
+
+/// The Templates class holds Gaussian templates for profiled attacks: a mean
+/// per class, and a covariance over the points of interest (POIs) which is
+/// pooled over all classes. Traces can then be matched against all templates
+/// at once, to get the log-likelihood of each trace under each class.
+///
+/// Templates are saved as a (classes + POIs) x POIs NPY array of doubles,
+/// with one row per class mean followed by the covariance matrix.
+class Templates {
+  public:
+    /// Construct empty templates.
+    Templates() = default;
+
+    /// Construct templates from \p means, with one row per class, and from
+    /// the pooled \p covariance of the POIs. The covariance matrix must be
+    /// positive definite. Classes with no profiling traces can have their
+    /// mean set to NaN: traces will never match them.
+    Templates(NPArray<double> means, NPArray<double> covariance);
+
+    /// Load templates from file \p filename.
+    explicit Templates(const std::string &filename);
+
+    /// Are these Templates in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Get the number of classes.
+    [[nodiscard]] size_t classes() const noexcept { return mu.rows(); }
+
+    /// Get the number of POIs.
+    [[nodiscard]] size_t pois() const noexcept { return cov.rows(); }
+
+    /// Get the class means, one row per class.
+    [[nodiscard]] const NPArray<double> &means() const noexcept { return mu; }
+
+    /// Get the pooled covariance matrix.
+    [[nodiscard]] const NPArray<double> &covariance() const noexcept {
+        return cov;
+    }
+
+    /// Match \p traces, with one POI per column, against all templates. The
+    /// result has one row per trace and one column per class, holding the
+    /// log-likelihood of the trace under the class' template (-infinity for
+    /// classes with no mean).
+    template <typename Ty>
+    [[nodiscard]] NPArray<double> match(const NPArrayView<Ty> &traces) const;
+
+    /// Save these templates to file \p filename. Returns false in case of
+    /// error.
+    [[nodiscard]] bool save(const std::string &filename) const;
+
+  private:
+    NPArray<double> mu;
+    NPArray<double> cov;
+    // The matching state, derived from mu and cov: with L the Cholesky factor
+    // of cov, the traces and the means are whitened by L^-1, after being
+    // centered on center. whitenedMeans holds the whitened means transposed,
+    // one row per POI.
+    std::vector<double> chol;
+    std::vector<double> center;
+    std::vector<double> whitenedMeans;
+    std::vector<double> whitenedNorms;
+    double logNorm = 0.0;
+    const char *errstr = nullptr;
+
+    // Factorize the covariance and whiten the means.
+    void prepare();
+};
+
+/// The TemplateBuilder class accumulates the statistics needed to build
+/// Templates from classified profiling traces, in a single pass over the
+/// traces: the per class sums and the pooled scatter matrix of the POIs.
+///
+/// The scatter matrix is updated with a batch of traces at a time, as a rank-k
+/// update which is cache blocked and spread over the worker threads. To keep
+/// it accurate, the samples are accumulated relative to a reference trace (the
+/// first trace added).
+template <typename Ty> class TemplateBuilder {
+  public:
+    /// Construct a TemplateBuilder for \p num_classes classes and \p num_pois
+    /// POIs.
+    explicit TemplateBuilder(size_t num_classes = 0, size_t num_pois = 0);
+
+    /// Get the number of classes.
+    [[nodiscard]] size_t classes() const noexcept { return numClasses; }
+
+    /// Get the number of POIs.
+    [[nodiscard]] size_t pois() const noexcept { return numPOIs; }
+
+    /// Get the number of traces accumulated for class \p cls.
+    [[nodiscard]] size_t count(size_t cls) const noexcept {
+        return cls < numClasses ? counts[cls] : 0;
+    }
+
+    /// Get the number of traces accumulated.
+    [[nodiscard]] size_t count() const noexcept;
+
+    /// Accumulate \p traces, with one POI per column. Trace t belongs to
+    /// class \p classes[first_trace + t]: traces with a class out of range
+    /// are ignored.
+    void add(const NPArrayView<Ty> &traces,
+             const std::vector<uint32_t> &classes, size_t first_trace = 0);
+
+    /// Merge the traces accumulated by \p other into this TemplateBuilder.
+    /// Returns false, leaving this TemplateBuilder untouched, if their numbers
+    /// of classes or POIs differ.
+    bool merge(const TemplateBuilder &other);
+
+    /// Build the templates from the accumulated traces. The covariance is the
+    /// pooled within class covariance, with one degree of freedom per class
+    /// with traces.
+    [[nodiscard]] Templates build() const;
+
+  private:
+    size_t numClasses;
+    size_t numPOIs;
+    std::vector<size_t> counts;
+    // The reference trace, which is empty until the first trace is added,
+    // and the sums (one row per class) and scatter matrix of the samples
+    // relative to it.
+    std::vector<double> reference;
+    std::vector<double> sums;
+    std::vector<double> scatter;
+};
+
+} // namespace PAF::SCA
@@ -20,16 +20,24 @@
 
 #pragma once
 
+#include "PAF/SCA/LiveTraces.h"
 #include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/ShardedNPArray.h"
+#include "PAF/SCA/StatsCache.h"
+#include "PAF/utils/Parallel.h"
 
 #include "libtarmac/argparse.hh"
 #include "libtarmac/reporter.hh"
 
+#include <cstdlib>
 #include <fstream>
+#include <iostream>
 #include <limits>
 #include <memory>
 #include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace PAF::SCA {
 
@@ -76,12 +84,23 @@ class OutputBase {
     /// Force closing of the file.
     void close();
 
+    /// Report the samples at their position in \p index_map, e.g. when the
+    /// traces only hold the points of interest of the original traces: the
+    /// values' column c is then reported as sample index_map[c].
+    void setIndexMap(std::vector<size_t> index_map) {
+        indexMap = std::move(index_map);
+    }
+
   private:
     const bool usingFile = false;
+    std::vector<size_t> indexMap;
 
   protected:
     /// Give our derived classes a shortcut to the underlying output stream.
     std::ostream *out = nullptr;
+
+    /// Get the sample position to report for the values' column \p col.
+    [[nodiscard]] size_t position(size_t col, size_t decimate) const;
 };
 
 /// Base class for all SCA applications, that provides them with the same
@@ -144,6 +163,40 @@ class SCAApp : public Argparse {
     /// Do we assume perfect inputs ?
     [[nodiscard]] bool isPerfect() const { return perfect; }
 
+    /// How should the traces be loaded in memory ?
+    [[nodiscard]] NPArrayBase::LoadMode loadMode() const {
+        return mapTraces ? NPArrayBase::MMAP : NPArrayBase::READ;
+    }
+
+    /// Get the part of the traces that computations have to consider, so
+    /// that only those samples need to be loaded from the traces file.
+    [[nodiscard]] NPArrayBase::Window tracesWindow() const {
+        return NPArrayBase::Window(0, -1, sampleStart(), sampleEnd());
+    }
+
+    /// Add the --live option, for the applications which can analyze the
+    /// traces while they are being acquired. This must be called before
+    /// setup().
+    void addLiveOption();
+
+    /// Are the traces streamed live, rather than read from files ?
+    [[nodiscard]] bool isLive() const { return !liveSpec.empty(); }
+
+    /// Get the source the live traces are streamed from.
+    [[nodiscard]] const std::string &liveSource() const { return liveSpec; }
+
+    /// Open the live traces source. This blocks until the stream header has
+    /// been received, and exits in case of error.
+    [[nodiscard]] std::unique_ptr<LiveTraceReader> openLiveTraces() const;
+
+    /// Add the --stats-cache option, for the applications which can reuse
+    /// the per-sample statistics of the traces accumulated by a previous
+    /// run. This must be called before setup().
+    void addStatsCacheOption();
+
+    /// Get the per-sample statistics cache, or nullptr if none is used.
+    [[nodiscard]] StatsCache *statsCache() const { return cache.get(); }
+
   private:
     unsigned verbosityLevel = 0;
 
@@ -157,6 +210,13 @@ class SCAApp : public Argparse {
     size_t offset = 0;
     std::unique_ptr<OutputBase> out;
     bool perfect = false;
+    bool mapTraces = false;
+    bool hugePages = false;
+    unsigned numJobs = defaultNumThreads(1);
+    std::string indexMapFile;
+    std::string liveSpec;
+    std::string cacheDirectory;
+    std::unique_ptr<StatsCache> cache;
 };
 
 /// Convert a value from its integral value to a floating point value in the
@@ -186,13 +246,69 @@ template <typename Ty> class ScaleFromInt16 : public Scale<Ty, int16_t> {};
 template <typename Ty> class ScaleFromInt32 : public Scale<Ty, int32_t> {};
 template <typename Ty> class ScaleFromInt64 : public Scale<Ty, int64_t> {};
 
+/// Scale the values of \p a, converted from NPY element type \p elt_ty, to
+/// the [-0.5, 0.5[ range for signed integers and [0.0, 1.0] range for
+/// unsigned integers. Floating point values are left untouched.
 template <typename Ty>
-NPArray<Ty> readNumpyPowerFile(const std::string &filename, bool convert,
-                               Reporter &reporter) {
+void scalePowerValues(NPArray<Ty> &a, const std::string &elt_ty,
+                      Reporter &reporter) {
+    assert(elt_ty.size() == 2 && "Unexpected size for NPArray eltTy");
+    if (elt_ty[0] == 'f') {
+        return;
+    } else if (elt_ty[0] == 'u') {
+        switch (elt_ty[1]) {
+        case '1':
+            a.apply(ScaleFromUInt8<Ty>());
+            return;
+        case '2':
+            a.apply(ScaleFromUInt16<Ty>());
+            return;
+        case '4':
+            a.apply(ScaleFromUInt32<Ty>());
+            return;
+        case '8':
+            a.apply(ScaleFromUInt64<Ty>());
+            return;
+        default:
+            reporter.errx(
+                EXIT_FAILURE,
+                "Unsupported unsigned integer element concatenation for now");
+        }
+    } else if (elt_ty[0] == 'i') {
+        switch (elt_ty[1]) {
+        case '1':
+            a.apply(ScaleFromInt8<Ty>());
+            return;
+        case '2':
+            a.apply(ScaleFromInt16<Ty>());
+            return;
+        case '4':
+            a.apply(ScaleFromInt32<Ty>());
+            return;
+        case '8':
+            a.apply(ScaleFromInt64<Ty>());
+            return;
+        default:
+            reporter.errx(EXIT_FAILURE,
+                          "Unsupported integer element concatenation for now");
+        }
+    } else
+        reporter.errx(EXIT_FAILURE, "Unsupported element type for now");
+}
+
+/// Read the \p window part of the power traces from NPY file \p filename,
+/// optionally converting them to \p Ty if \p convert is set. When no
+/// conversion is performed, the file content is loaded according to \p mode.
+template <typename Ty>
+NPArray<Ty>
+readNumpyPowerFile(const std::string &filename, bool convert,
+                   Reporter &reporter,
+                   NPArrayBase::LoadMode mode = NPArrayBase::READ,
+                   const NPArrayBase::Window &window = NPArrayBase::Window()) {
     // No conversion requested, return the NPArray as we read it ! This will
     // fail if the element type is not the expected floating point format.
     if (!convert)
-        return NPArray<Ty>(filename);
+        return NPArray<Ty>(filename, window, mode);
 
     // Conversion requested ! Discover the element type.
     std::ifstream ifs(filename, std::ifstream::binary);
@@ -205,56 +321,104 @@ NPArray<Ty> readNumpyPowerFile(const std::string &filename, bool convert,
     std::string elt_ty;
     size_t elt_size;
     const char *l_errstr = nullptr;
+    bool swap;
+    bool fortran;
     if (!NPArrayBase::getInformation(ifs, num_rows, num_cols, elt_ty, elt_size,
-                                     &l_errstr))
+                                     &l_errstr, &swap, &fortran))
         reporter.errx(EXIT_FAILURE,
                       "Error retrieving information for file '%s'",
                       filename.c_str());
     ifs.close();
 
     // Read the data as floating point, with a conversion done on the fly !
-    NPArray<Ty> a = NPArray<Ty>::readAs(filename);
+    NPArray<Ty> a = NPArray<Ty>::readAs(filename, window);
     if (!a.good())
         return a;
 
     // Scale data to the [-0.5, 0.5[ range for signed integers and [-1.0, 1.[
     // (unsigned integers).
-    assert(elt_ty.size() == 2 && "Unexpected size for NPArray eltTy");
-    if (elt_ty[0] == 'f') {
-        return a;
-    } else if (elt_ty[0] == 'u') {
-        switch (elt_ty[1]) {
-        case '1':
-            return a.apply(ScaleFromUInt8<Ty>());
-        case '2':
-            return a.apply(ScaleFromUInt16<Ty>());
-        case '4':
-            return a.apply(ScaleFromUInt32<Ty>());
-        case '8':
-            return a.apply(ScaleFromUInt64<Ty>());
-        default:
-            reporter.errx(
-                EXIT_FAILURE,
-                "Unsupported unsigned integer element concatenation for now");
+    scalePowerValues(a, elt_ty, reporter);
+    return a;
+}
+
+/// Get the number of rows \p num_rows, the number of columns \p num_cols and
+/// the element type \p elt_ty of the NPY traces file \p filename. Errors are
+/// fatal and reported with \p reporter.
+void getInformation(const std::string &filename, size_t &num_rows,
+                    size_t &num_cols, std::string &elt_ty, Reporter &reporter);
+
+/// Get the element type of the NPY traces file \p filename. Errors are fatal
+/// and reported with \p reporter.
+std::string getEltTy(const std::string &filename, Reporter &reporter);
+
+/// Read the \p window part of the power traces from NPY file \p filename, with
+/// \p elt_ty elements (as returned by getEltTy), as PowerTy elements. Only
+/// floating point traces can be converted, when \p convert is set, from
+/// another element type. When no conversion is performed, the file content
+/// is loaded according to \p mode. Unlike readNumpyPowerFile, errors are
+/// reported in the returned NPArray, so that traces can be read in the
+/// background.
+template <typename PowerTy>
+NPArray<PowerTy>
+readTraces(const std::string &filename, bool convert,
+           const std::string &elt_ty, Reporter &reporter,
+           NPArrayBase::LoadMode mode = NPArrayBase::READ,
+           const NPArrayBase::Window &window = NPArrayBase::Window()) {
+    if constexpr (std::is_floating_point<PowerTy>()) {
+        if (convert) {
+            NPArray<PowerTy> a = NPArray<PowerTy>::readAs(filename, window);
+            // readAs only succeeds for the element types scalePowerValues
+            // supports.
+            if (a.good())
+                scalePowerValues(a, elt_ty, reporter);
+            return a;
         }
-    } else if (elt_ty[0] == 'i') {
-        switch (elt_ty[1]) {
-        case '1':
-            return a.apply(ScaleFromInt8<Ty>());
-        case '2':
-            return a.apply(ScaleFromInt16<Ty>());
-        case '4':
-            return a.apply(ScaleFromInt32<Ty>());
-        case '8':
-            return a.apply(ScaleFromInt64<Ty>());
-        default:
-            reporter.errx(EXIT_FAILURE,
-                          "Unsupported integer element concatenation for now");
+    }
+    return NPArray<PowerTy>(filename, window, mode);
+}
+
+/// Call \p f on the PowerTy traces used by \p app, from a single file or
+/// sharded over \p traces_files, and return its result. \p f is called
+/// with either a const NPArray<PowerTy> or a ShardedNPArray<PowerTy>. Errors
+/// reading the traces are fatal.
+template <typename PowerTy, class Fn>
+NPArray<double> withTraces(SCAApp &app,
+                           const std::vector<std::string> &traces_files,
+                           bool convert, Fn f) {
+    // With sharded traces, ShardedNPArray checks that all shards have the
+    // element type of the first one.
+    const std::string elt_ty = getEltTy(traces_files[0], *reporter);
+    if (traces_files.size() == 1) {
+        const NPArray<PowerTy> traces =
+            readTraces<PowerTy>(traces_files[0], convert, elt_ty, *reporter,
+                                app.loadMode(), app.tracesWindow());
+        if (!traces.good())
+            reporter->errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
+                           traces_files[0].c_str(), traces.error());
+        if (app.verbose()) {
+            std::cout << "Read " << traces.rows() << " traces ("
+                      << traces.cols() << " samples per trace)\n";
+            if (app.verbosity() >= 2)
+                traces.dump(std::cout, 3, 4, "Traces");
         }
-    } else
-        reporter.errx(EXIT_FAILURE, "Unsupported element type for now");
+        return f(traces);
+    }
 
-    return NPArray<Ty>();
+    ShardedNPArray<PowerTy> traces(
+        traces_files, app.tracesWindow(), app.loadMode(),
+        /* prefetch: */ true,
+        [&](const std::string &filename, const NPArrayBase::Window &window) {
+            return readTraces<PowerTy>(filename, convert, elt_ty, *reporter,
+                                       app.loadMode(), window);
+        });
+    if (!traces.good())
+        reporter->errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
+                       traces_files[0].c_str(), traces.error());
+    if (app.verbose())
+        std::cout << "Using " << traces.rows() << " traces (" << traces.cols()
+                  << " samples per trace) from " << traces.numShards()
+                  << " shards\n";
+    return f(traces);
 }
 
 } // namespace PAF::SCA
@@ -22,6 +22,9 @@
 
 #include "PAF/SCA/NPArray.h"
 
+#include <cstddef>
+#include <vector>
+
 namespace PAF::SCA {
 
 // Returns the maximum value in data[0:n( and update index with the offset
@@ -29,4 +32,26 @@ namespace PAF::SCA {
 double find_max(const NPArray<double>::const_Row &row, size_t *index,
                 size_t decimate = 1, size_t offset = 0);
 
+/// Select the points of interest from \p scores, a matrix with one row per
+/// metric (e.g. t-values or correlations) and one column per sample. The
+/// samples are ranked by their largest absolute score over all rows, and the
+/// \p k best ones are selected, together with the \p window samples on each
+/// of their sides. A sample closer than \p window samples to a better ranked
+/// selected sample is not selected on its own, so that the windows cover
+/// different peaks. Returns the indices of the selected samples, in
+/// increasing order.
+std::vector<size_t> select_poi(const NPArray<double> &scores, size_t k,
+                               size_t window = 0);
+
+/// Get the \p samples columns (in this order) of \p traces.
+template <typename Ty>
+NPArray<Ty> select_samples(const NPArray<Ty> &traces,
+                           const std::vector<size_t> &samples) {
+    NPArray<Ty> selected(traces.rows(), samples.size());
+    for (size_t r = 0; r < traces.rows(); r++)
+        for (size_t c = 0; c < samples.size(); c++)
+            selected(r, c) = traces(r, samples[c]);
+    return selected;
+}
+
 } // namespace PAF::SCA
@@ -0,0 +1,39 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace PAF {
+
+/// Write to \p os a synthetic Tarmac trace of \p numInstructions instructions,
+/// for testing, benchmarking or sizing the trace analysis tools at scale
+/// without actual captures. The trace is the execution, on an Arm v7-M core,
+/// of a loop xoring a 64 words buffer with a random key, with the register and
+/// memory accesses of each instruction. The trace only depends on
+/// \p numInstructions and \p seed. Returns true if the complete trace could be
+/// written.
+bool writeSyntheticTarmac(std::ostream &os, size_t numInstructions,
+                          uint64_t seed = 0);
+
+} // namespace PAF
@@ -27,7 +27,9 @@
 #include "fstapi.h"
 
 #include <cstdint>
+#include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace PAF::WAN {
@@ -127,18 +129,39 @@ class FSTWaveFile : public WaveFile {
                                    &B, nullptr);
     }
 
-    /// Convenience method to read from a single input file.
-    Waveform read();
+    /// Visit the changes of the signals with handles \p handles only: the
+    /// other signals are not decoded.
+    template <class BuilderTy>
+    bool visitSignals(FSTWaveBuilderBase<BuilderTy> &B,
+                      const std::vector<fstHandle> &handles) const {
+        fstReaderClrFacProcessMaskAll(f);
+        for (const fstHandle H : handles)
+            fstReaderSetFacProcessMask(f, H);
+        return fstReaderIterBlocks(f, FSTWaveBuilderBase<BuilderTy>::callback,
+                                   &B, nullptr);
+    }
 
-    /// Construct a Waveform.
-    bool read(Waveform &W) override;
+    using WaveFile::read;
+
+    /// Construct a Waveform from file FileName, with only the scopes and
+    /// signals selected by \p options, and only the changes relevant to
+    /// \p windows.
+    bool read(Waveform &W, const Waveform::Visitor::Options &options,
+              const TimeWindows &windows) override;
 
     /// Save Waveform W to file 'FileName'.
     bool write(const Waveform &W) override;
 
+    /// Merge \p files into file 'FileName', reading them in \p numSlices
+    /// time slices: only one slice of each input is in memory at any time.
+    bool writeMerged(const std::vector<std::string> &files, size_t numSlices);
+
     /// Quickly read the file to collect all times with changes.
     std::vector<WAN::TimeTy> getAllChangesTimes() override;
 
+    /// Get the file start and end times, as recorded in its header.
+    std::pair<TimeTy, TimeTy> getTimeRange() override;
+
   private:
     bool openedForWrite;
     // An opaque pointer to the fst data structure / context from fstapi.h
@@ -0,0 +1,322 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/utils/Stats.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace PAF::WAN {
+
+/// The PackedIndices class stores a non decreasing sequence of 32-bit
+/// indices in bit-packed frames.
+///
+/// The indices are grouped in blocks of BLOCK_SIZE consecutive indices. Each
+/// full block is stored as a frame: a header with the first index of the
+/// block (its base) and the bit width of the largest delta to that base,
+/// followed by the deltas of all indices to the base, packed with that bit
+/// width. Indices thus stay randomly accessible in constant time, and an index
+/// can be searched for with a binary search over the block bases, followed by
+/// a binary search inside a single block. The last, incomplete, block is kept
+/// unpacked so that indices can be appended.
+class PackedIndices {
+  public:
+    using ValueTy = uint32_t;
+
+    /// The number of indices in a block.
+    static constexpr size_t BLOCK_SIZE = 128;
+
+    PackedIndices() = default;
+    PackedIndices(const PackedIndices &) = default;
+    PackedIndices(PackedIndices &&) = default;
+    PackedIndices &operator=(const PackedIndices &) = default;
+    PackedIndices &operator=(PackedIndices &&) = default;
+
+    [[nodiscard]] size_t size() const {
+        return headers.size() * BLOCK_SIZE + tail.size();
+    }
+    [[nodiscard]] bool empty() const { return size() == 0; }
+
+    [[nodiscard]] ValueTy operator[](size_t i) const {
+        assert(i < size() && "Out of bound access");
+        const size_t block = i / BLOCK_SIZE;
+        if (block == headers.size())
+            return tail[i % BLOCK_SIZE];
+        const Header &H = headers[block];
+        if (H.width == 0)
+            return H.base;
+        const size_t pos = H.offset * WORD_BITS + (i % BLOCK_SIZE) * H.width;
+        return H.base + ValueTy(extract(pos, H.width));
+    }
+
+    [[nodiscard]] ValueTy back() const {
+        assert(!empty() && "back() on empty PackedIndices");
+        return (*this)[size() - 1];
+    }
+
+    /// Append \p v, which must not be lower than the last index.
+    void push_back(ValueTy v) {
+        assert((empty() || v >= back()) &&
+               "PackedIndices values must not decrease");
+        tail.push_back(v);
+        if (tail.size() == BLOCK_SIZE)
+            pack();
+    }
+
+    void clear() {
+        headers.clear();
+        words.clear();
+        tail.clear();
+    }
+
+    /// Get the position of the first index not lower than \p v, or size() if
+    /// there is no such index.
+    [[nodiscard]] size_t lower_bound(ValueTy v) const {
+        // Find the first block with a base not lower than v: v, if present,
+        // is either at its start or in the previous block.
+        const auto it = std::partition_point(
+            headers.begin(), headers.end(),
+            [v](const Header &H) { return H.base < v; });
+        const size_t block = std::distance(headers.begin(), it);
+        if (block > 0) {
+            const size_t first = (block - 1) * BLOCK_SIZE;
+            const size_t pos = lowerBoundIn(first, first + BLOCK_SIZE, v);
+            if (pos != first + BLOCK_SIZE)
+                return pos;
+        }
+        if (block < headers.size())
+            return block * BLOCK_SIZE;
+        return headers.size() * BLOCK_SIZE +
+               std::distance(tail.begin(),
+                             std::lower_bound(tail.begin(), tail.end(), v));
+    }
+
+    /// Get the first position in [0, n) where this and \p RHS hold different
+    /// indices, or n if there is none. Both must hold at least n indices.
+    /// Identical frames are compared as a whole.
+    [[nodiscard]] size_t mismatch(const PackedIndices &RHS, size_t n) const {
+        assert(n <= size() && n <= RHS.size() && "Not that many indices");
+        size_t i = 0;
+        const size_t numBlocks = std::min(headers.size(), RHS.headers.size());
+        for (size_t b = 0; b < numBlocks && i + BLOCK_SIZE <= n; b++) {
+            const Header &L = headers[b];
+            const Header &R = RHS.headers[b];
+            if (L.base != R.base || L.width != R.width ||
+                !std::equal(words.begin() + L.offset,
+                            words.begin() + L.offset + 2 * L.width,
+                            RHS.words.begin() + R.offset))
+                break;
+            i += BLOCK_SIZE;
+        }
+        for (; i < n; i++)
+            if ((*this)[i] != RHS[i])
+                return i;
+        return n;
+    }
+
+    bool operator==(const PackedIndices &RHS) const {
+        // The representation is canonical: equal sequences are packed
+        // identically.
+        return tail == RHS.tail && headers.size() == RHS.headers.size() &&
+               words == RHS.words &&
+               std::equal(headers.begin(), headers.end(), RHS.headers.begin(),
+                          [](const Header &L, const Header &R) {
+                              return L.base == R.base && L.width == R.width;
+                          });
+    }
+    bool operator!=(const PackedIndices &RHS) const { return !(*this == RHS); }
+
+    /// Get the memory used by the indices.
+    [[nodiscard]] size_t getStorageSize() const {
+        return headers.size() * sizeof(Header) + words.size() * sizeof(WordTy) +
+               tail.size() * sizeof(ValueTy);
+    }
+
+    /// Get the memory allocated for the indices, including the storage
+    /// reserved for growth.
+    [[nodiscard]] size_t memoryUsage() const {
+        return headers.capacity() * sizeof(Header) +
+               words.capacity() * sizeof(WordTy) +
+               tail.capacity() * sizeof(ValueTy);
+    }
+
+    /// A read-only random access iterator on the indices.
+    class Iterator {
+      public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = ValueTy;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const ValueTy *;
+        using reference = ValueTy;
+
+        Iterator(const PackedIndices *PI, size_t Idx) : pi(PI), idx(Idx) {}
+
+        ValueTy operator*() const { return (*pi)[idx]; }
+        ValueTy operator[](difference_type n) const { return (*pi)[idx + n]; }
+
+        Iterator &operator++() {
+            idx++;
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator tmp(*this);
+            idx++;
+            return tmp;
+        }
+        Iterator &operator--() {
+            idx--;
+            return *this;
+        }
+        Iterator operator--(int) {
+            Iterator tmp(*this);
+            idx--;
+            return tmp;
+        }
+        Iterator &operator+=(difference_type n) {
+            idx += n;
+            return *this;
+        }
+        Iterator &operator-=(difference_type n) {
+            idx -= n;
+            return *this;
+        }
+        Iterator operator+(difference_type n) const {
+            return {pi, size_t(idx + n)};
+        }
+        Iterator operator-(difference_type n) const {
+            return {pi, size_t(idx - n)};
+        }
+        difference_type operator-(const Iterator &RHS) const {
+            assert(pi == RHS.pi && "Un-substractable iterators");
+            return difference_type(idx) - difference_type(RHS.idx);
+        }
+
+        bool operator==(const Iterator &RHS) const {
+            return pi == RHS.pi && idx == RHS.idx;
+        }
+        bool operator!=(const Iterator &RHS) const { return !(*this == RHS); }
+        bool operator<(const Iterator &RHS) const { return idx < RHS.idx; }
+        bool operator<=(const Iterator &RHS) const { return idx <= RHS.idx; }
+        bool operator>(const Iterator &RHS) const { return idx > RHS.idx; }
+        bool operator>=(const Iterator &RHS) const { return idx >= RHS.idx; }
+
+      private:
+        const PackedIndices *pi;
+        size_t idx;
+    };
+
+    [[nodiscard]] Iterator begin() const { return {this, 0}; }
+    [[nodiscard]] Iterator end() const { return {this, size()}; }
+
+  private:
+    friend class WaveCache;
+
+    using WordTy = uint64_t;
+    static constexpr size_t WORD_BITS = sizeof(WordTy) * 8;
+
+    // A full block: its deltas to base are packed with width bits each, in
+    // the 2 * width words starting at words[offset].
+    struct Header {
+        uint64_t offset;
+        ValueTy base;
+        uint32_t width;
+    };
+    static_assert(BLOCK_SIZE == 2 * WORD_BITS,
+                  "A block of deltas must use 2 words per bit of width");
+
+    // The indices storage is accounted to the WAN subsystem in the Stats.
+    template <class Ty>
+    using VectorTy = std::vector<Ty, TrackingAllocator<Ty, Stats::MEM_WAN>>;
+
+    VectorTy<Header> headers;
+    VectorTy<WordTy> words;
+    // The indices of the last, incomplete, block.
+    VectorTy<ValueTy> tail;
+
+    // Check the consistency of the frames, for PackedIndices read from a
+    // file.
+    [[nodiscard]] bool isWellFormed() const {
+        if (tail.size() >= BLOCK_SIZE)
+            return false;
+        uint64_t offset = 0;
+        for (const Header &H : headers) {
+            if (H.width > 32 || H.offset != offset)
+                return false;
+            offset += 2 * H.width;
+        }
+        return offset == words.size();
+    }
+
+    // Get the width bits at position pos in words.
+    [[nodiscard]] WordTy extract(size_t pos, size_t width) const {
+        const size_t word = pos / WORD_BITS;
+        const size_t offset = pos % WORD_BITS;
+        WordTy w = words[word] >> offset;
+        if (offset + width > WORD_BITS)
+            w |= words[word + 1] << (WORD_BITS - offset);
+        return w & ((WordTy(1) << width) - 1);
+    }
+
+    // Get the first position in the packed [first, last) range which holds
+    // an index not lower than v, or last if there is none.
+    [[nodiscard]] size_t lowerBoundIn(size_t first, size_t last,
+                                      ValueTy v) const {
+        while (first < last) {
+            const size_t mid = first + (last - first) / 2;
+            if ((*this)[mid] < v)
+                first = mid + 1;
+            else
+                last = mid;
+        }
+        return first;
+    }
+
+    // Pack the (full) tail block.
+    void pack() {
+        assert(tail.size() == BLOCK_SIZE && "Only full blocks can be packed");
+        const ValueTy base = tail.front();
+        const ValueTy maxDelta = tail.back() - base;
+        uint32_t width = 0;
+        while (width < 32 && (maxDelta >> width) != 0)
+            width++;
+        const uint64_t offset = words.size();
+        headers.push_back({offset, base, width});
+        if (width != 0) {
+            words.resize(offset + 2 * width, 0);
+            for (size_t i = 0; i < BLOCK_SIZE; i++) {
+                const WordTy delta = tail[i] - base;
+                const size_t pos = offset * WORD_BITS + i * width;
+                words[pos / WORD_BITS] |= delta << (pos % WORD_BITS);
+                if (pos % WORD_BITS + width > WORD_BITS)
+                    words[pos / WORD_BITS + 1] |=
+                        delta >> (WORD_BITS - pos % WORD_BITS);
+            }
+        }
+        tail.clear();
+    }
+};
+
+} // namespace PAF::WAN
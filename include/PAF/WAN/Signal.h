@@ -21,6 +21,8 @@
 #pragma once
 
 #include "PAF/Error.h"
+#include "PAF/WAN/PackedIndices.h"
+#include "PAF/utils/Stats.h"
 
 #include <algorithm>
 #include <cassert>
@@ -30,6 +32,7 @@
 #include <iterator>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace PAF::WAN {
@@ -281,47 +284,13 @@ inline ValueTy operator^(const ValueTy &LHS, const ValueTy &RHS) {
 
 class Signal {
 
-    /// The PackTy class packs several values together in the same (memory)
-    /// storage location. This optimization is done in order to use less memory.
-    class Pack {
-        using Ty = uint32_t;
-
-        static const constexpr Ty MASK = (1 << Logic::encoding()) - 1;
-        static constexpr size_t shiftAmount(size_t offset) {
-            return offset * Logic::encoding();
-        };
-
-      public:
-        [[nodiscard]] Ty raw() const { return value; }
-        static constexpr size_t capacity() {
-            return (sizeof(Ty) * 8) / Logic::encoding();
-        }
-
-        Pack() : value() {};
-        explicit Pack(Logic::Ty v) : value(0) { insert(v, 0); }
-        explicit Pack(char c) : Pack(Logic::fromChar(c)) {}
-
-        Pack(const Pack &) = default;
-        Pack &operator=(const Pack &) = default;
-
-        Pack &insert(Logic::Ty v, size_t offset) {
-            assert(offset < capacity() && "Out of pack access");
-            value &= ~(MASK << shiftAmount(offset));
-            value |= Ty(v) << shiftAmount(offset);
-            return *this;
-        }
-        Pack &insert(char c, size_t offset) {
-            return insert(Logic::fromChar(c), offset);
-        }
-
-        [[nodiscard]] Logic::Ty get(size_t offset) const {
-            assert(offset < capacity() && "Out of pack access");
-            return Logic::Ty((value >> shiftAmount(offset)) & MASK);
-        }
-
-      private:
-        Ty value;
-    };
+    /// The storage word of the value planes.
+    using WordTy = uint64_t;
+    static constexpr size_t WORD_BITS = sizeof(WordTy) * 8;
+    /// The value planes, whose storage is accounted to the WAN subsystem in
+    /// the Stats.
+    using PlaneTy =
+        std::vector<WordTy, TrackingAllocator<WordTy, Stats::MEM_WAN>>;
 
   public:
     Signal() = delete;
@@ -336,12 +305,18 @@ class Signal {
     [[nodiscard]] bool empty() const { return timeIdx.size() == 0; }
     [[nodiscard]] size_t getNumBits() const { return numBits; }
     [[nodiscard]] size_t getNumChanges() const {
-        assert(timeIdx.size() <= value.size() * Pack::capacity() / numBits &&
+        assert(timeIdx.size() * numBits <= value.size() * WORD_BITS &&
                "Time and Value size discrepancy");
         return timeIdx.size();
     }
 
-    static constexpr size_t packCapacity() { return Pack::capacity(); }
+    /// Get the number of bit values held by a storage word.
+    static constexpr size_t packCapacity() { return WORD_BITS; }
+
+    /// Does this Signal have a Z or X bit in any of its values ? Signals
+    /// which do not are 2-state signals, whose values are entirely held by
+    /// the value plane.
+    [[nodiscard]] bool hasHighZOrUnknown() const { return !zx.empty(); }
 
     bool operator==(const Signal &RHS) const {
         // We compare the actual physical values, so we don't bother
@@ -351,12 +326,13 @@ class Signal {
         if (getNumChanges() != RHS.getNumChanges())
             return false;
         // Perform a raw comparisons on the flat data.
-        if (memcmp(&timeIdx[0], &RHS.timeIdx[0],
-                   timeIdx.size() * sizeof(timeIdx[0])) != 0)
-            return false;
-        if (memcmp(&value[0], &RHS.value[0], value.size() * sizeof(value[0])) !=
-            0)
+        if (timeIdx != RHS.timeIdx || value != RHS.value)
             return false;
+        if (zxDense == RHS.zxDense)
+            return zx == RHS.zx;
+        for (size_t pos = 0; pos < timeIdx.size() * numBits; pos++)
+            if (isHighZOrUnknown(pos) != RHS.isHighZOrUnknown(pos))
+                return false;
         return true;
     }
     bool operator!=(const Signal &RHS) const { return !this->operator==(RHS); }
@@ -372,83 +348,33 @@ class Signal {
 
             os << "Values:";
             for (const auto &v : value)
-                os << std::hex << " 0x" << v.raw() << std::dec;
+                os << std::hex << " 0x" << v << std::dec;
             os << '\n';
+
+            if (!zx.empty()) {
+                os << (zxDense ? "ZX:" : "ZX positions:");
+                for (const auto &v : zx)
+                    os << std::hex << " 0x" << v << std::dec;
+                os << '\n';
+            }
         }
     }
 
     // Append a value at the back of the Signal.
     // Note: the value is zero extended if it does not have enough bits.
     Signal &append(WAN::TimeIdxTy t, const char *str) {
-        assert(timeIdx.size() <= value.size() * Pack::capacity() / numBits &&
-               "Time and Value size discrepancy");
         assert(str && "NULL pointer unexpected");
-        unsigned len = strlen(str);
-        assert(len <= numBits && "too many bits in value");
-        if (!timeIdx.empty())
-            assert(t >= timeIdx.back() && "Time must increase monotonically "
-                                          "when appending a value change");
-
-        if (timeIdx.empty() || t > timeIdx.back()) {
-            // New time : the value needs to be written in a new slot in the
-            // pack.
-            size_t packOffset = timeIdx.size() % Pack::capacity();
-            timeIdx.push_back(t);
-            if (packOffset == 0) {
-                // A new pack is needed: construct the value emplace.
-                for (unsigned i = 0; i < numBits; i++)
-                    value.emplace_back(i >= len ? '0' : str[len - i - 1]);
-            } else {
-                for (unsigned i = 0; i < numBits; i++)
-                    value[value.size() - numBits + i].insert(
-                        i >= len ? '0' : str[len - i - 1], packOffset);
-            }
-        } else if (t == timeIdx.back()) {
-            // Multiple changes at the same time: overwrite the current value.
-            size_t packOffset = (timeIdx.size() - 1) % Pack::capacity();
-            for (unsigned i = 0; i < numBits; i++)
-                value[value.size() - numBits + i].insert(
-                    i >= len ? '0' : str[len - i - 1], packOffset);
-        }
-
-        return *this;
+        return append(t, std::string_view(str));
     }
 
     // Append a value at the back of the Signal (string edition).
     // Note: the value is zero extended if it does not have enough bits.
-    Signal &append(WAN::TimeIdxTy t, const std::string &str) {
-        assert(timeIdx.size() <= value.size() * Pack::capacity() / numBits &&
-               "Time and Value size discrepancy");
+    Signal &append(WAN::TimeIdxTy t, std::string_view str) {
         assert(str.size() <= numBits && "too many bits in value");
-        if (!timeIdx.empty())
-            assert(t >= timeIdx.back() && "Time must increase monotonically "
-                                          "when appending a value change");
-
-        if (timeIdx.empty() || t > timeIdx.back()) {
-            // New time : the value needs to be written in a new slot in the
-            // pack.
-            size_t packOffset = timeIdx.size() % Pack::capacity();
-            timeIdx.push_back(t);
-            if (packOffset == 0) {
-                // A new pack is needed: construct the value emplace.
-                for (unsigned i = 0; i < numBits; i++)
-                    value.emplace_back(
-                        i >= str.size() ? '0' : str[str.size() - i - 1]);
-            } else {
-                for (unsigned i = 0; i < numBits; i++)
-                    value[value.size() - numBits + i].insert(
-                        i >= str.size() ? '0' : str[str.size() - i - 1],
-                        packOffset);
-            }
-        } else if (t == timeIdx.back()) {
-            // Multiple changes at the same time: overwrite the current value.
-            size_t packOffset = (timeIdx.size() - 1) % Pack::capacity();
-            for (unsigned i = 0; i < numBits; i++)
-                value[value.size() - numBits + i].insert(
-                    i >= str.size() ? '0' : str[str.size() - i - 1],
-                    packOffset);
-        }
-
+        const size_t base = newSlot(t);
+        for (unsigned i = 0; i < numBits; i++)
+            if (i < str.size())
+                set(base + i, Logic::fromChar(str[str.size() - i - 1]));
         return *this;
     }
 
@@ -467,68 +393,44 @@ class Signal {
     };
 
     // Append a value at the back of the Signal (ChangeTy edition).
-    // Note: the value is zero extended if it does not have enough bits.
     Signal &append(WAN::TimeIdxTy t, const ChangeTy &c) {
-        assert(timeIdx.size() <= value.size() * Pack::capacity() / numBits &&
-               "Time and Value size discrepancy");
         assert(c.value.size() == numBits && "different number of bits");
-        if (!timeIdx.empty())
-            assert(t >= timeIdx.back() && "Time must increase monotonically "
-                                          "when appending a value change");
         assert((*allTimes)[t] == c.time && "Time mismatch");
-
-        if (timeIdx.empty() || t > timeIdx.back()) {
-            // New time : the value needs to be written in a new slot in the
-            // pack.
-            size_t packOffset = timeIdx.size() % Pack::capacity();
-            timeIdx.push_back(t);
-            if (packOffset == 0) {
-                // A new pack is needed: construct the value emplace.
-                for (unsigned i = 0; i < numBits; i++)
-                    value.emplace_back(c.value.get(i));
-            } else {
-                for (unsigned i = 0; i < numBits; i++)
-                    value[value.size() - numBits + i].insert(c.value.get(i),
-                                                             packOffset);
-            }
-        } else if (t == timeIdx.back()) {
-            // Multiple changes at the same time: overwrite the current value.
-            size_t packOffset = (timeIdx.size() - 1) % Pack::capacity();
-            for (unsigned i = 0; i < numBits; i++)
-                value[value.size() - numBits + i].insert(c.value.get(i),
-                                                         packOffset);
-        }
-
+        const size_t base = newSlot(t);
+        for (unsigned i = 0; i < numBits; i++)
+            set(base + i, c.value.get(i));
         return *this;
     }
 
     [[nodiscard]] ChangeTy getChange(size_t change) const {
-        assert(change < timeIdx.size() && "Not that many changes");
-        assert(timeIdx.size() <= value.size() * Pack::capacity() / numBits &&
-               "Time and Value size discrepancy");
-        size_t packNum = (change / Pack::capacity()) * numBits;
-        size_t packOffset = change % Pack::capacity();
-        ValueTy C(numBits);
-        for (size_t i = 0; i < numBits; i++)
-            C.set(value[packNum + i].get(packOffset), i);
-        return {(*allTimes)[timeIdx[change]], std::move(C)};
+        return {getTimeChange(change), getValueChange(change)};
     }
 
     [[nodiscard]] ValueTy getValueChange(size_t change) const {
         assert(change < timeIdx.size() && "Not that many changes");
-        assert(timeIdx.size() <= value.size() * Pack::capacity() / numBits &&
+        assert(timeIdx.size() * numBits <= value.size() * WORD_BITS &&
                "Time and Value size discrepancy");
-        size_t packNum = (change / Pack::capacity()) * numBits;
-        size_t packOffset = change % Pack::capacity();
+        const size_t base = change * numBits;
         ValueTy C(numBits);
         for (size_t i = 0; i < numBits; i++)
-            C.set(value[packNum + i].get(packOffset), i);
+            C.set(Logic::fromBool(getPlaneBit(base + i)), i);
+        if (zx.empty())
+            return C;
+        if (zxDense) {
+            for (size_t i = 0; i < numBits; i++)
+                if (getBit(zx, base + i))
+                    C.set(getZX(base + i), i);
+        } else {
+            for (auto it = std::lower_bound(zx.begin(), zx.end(), base);
+                 it != zx.end() && *it < base + numBits; it++)
+                C.set(getZX(*it), *it - base);
+        }
         return C;
     }
 
     [[nodiscard]] TimeTy getTimeChange(size_t change) const {
         assert(change < timeIdx.size() && "Not that many changes");
-        assert(timeIdx.size() <= value.size() * Pack::capacity() / numBits &&
+        assert(timeIdx.size() * numBits <= value.size() * WORD_BITS &&
                "Time and Value size discrepancy");
         return (*allTimes)[timeIdx[change]];
     }
@@ -564,10 +466,7 @@ class Signal {
         WAN::TimeIdxTy Idx = std::distance(allTimes->begin(), Iter1);
         // Now search locally in our signal changes for a TimeIdxTy that is
         // greater or equal to Idx.
-        const auto Iter2 =
-            std::lower_bound(timeIdx.begin(), timeIdx.end(), Idx);
-        return std::distance(timeIdx.begin(), Iter2);
-        ;
+        return timeIdx.lower_bound(Idx);
     }
 
     [[nodiscard]] TimeTy getChangeTimeUp(TimeTy t) const {
@@ -602,6 +501,184 @@ class Signal {
         return getValueChange(Idx);
     }
 
+    /// The HammingTy struct holds, for each change of a Signal: its time
+    /// index, the Hamming weight of its value and the Hamming distance from
+    /// the previous value. As with ValueTy::countOnes, the Z and X bits do not
+    /// count, and the first change has a distance of 0.
+    struct HammingTy {
+        std::vector<WAN::TimeIdxTy> timeIdx;
+        std::vector<unsigned> weight;
+        std::vector<unsigned> distance;
+    };
+
+    /// Compute the Hamming weights and distances of all changes. This
+    /// works directly on the storage words, without decoding the values.
+    [[nodiscard]] HammingTy getHamming() const {
+        HammingTy H;
+        const size_t numChanges = timeIdx.size();
+        H.timeIdx.assign(timeIdx.begin(), timeIdx.end());
+        H.weight.resize(numChanges);
+        H.distance.resize(numChanges);
+
+        if (numBits == 1) {
+            // The values of WORD_BITS consecutive changes are in the same
+            // word: process them all at once.
+            WordTy carryV = 0;
+            WordTy carryM = 0;
+            auto zxIt = zx.begin();
+            for (size_t w = 0; w < value.size(); w++) {
+                const size_t pos = w * WORD_BITS;
+                const WordTy v = value[w];
+                WordTy m = 0;
+                if (zxDense) {
+                    m = zx[w];
+                } else {
+                    for (; zxIt != zx.end() && *zxIt < pos + WORD_BITS; zxIt++)
+                        m |= WordTy(1) << (*zxIt - pos);
+                }
+                // The previous values, aligned with their successor.
+                const WordTy pv = (v << 1) | carryV;
+                const WordTy pm = (m << 1) | carryM;
+                const WordTy ones = v & ~m;
+                const WordTy toggles = (v ^ pv) & ~(m | pm);
+                const size_t n = std::min(WORD_BITS, numChanges - pos);
+                for (size_t i = 0; i < n; i++) {
+                    H.weight[pos + i] = (ones >> i) & 1;
+                    H.distance[pos + i] = (toggles >> i) & 1;
+                }
+                carryV = v >> (WORD_BITS - 1);
+                carryM = m >> (WORD_BITS - 1);
+            }
+            if (numChanges != 0)
+                H.distance[0] = 0;
+            return H;
+        }
+
+        const size_t numWords = (numBits + WORD_BITS - 1) / WORD_BITS;
+        std::vector<WordTy> previous(2 * numWords, 0);
+        std::vector<WordTy> current(2 * numWords, 0);
+        auto zxIt = zx.begin();
+        for (size_t c = 0; c < numChanges; c++) {
+            unsigned weight = 0;
+            unsigned distance = 0;
+            for (size_t w = 0; w < numWords; w++) {
+                const size_t pos = c * numBits + w * WORD_BITS;
+                const size_t len = std::min(WORD_BITS, numBits - w * WORD_BITS);
+                const WordTy v = extract(value, pos, len);
+                WordTy m = 0;
+                if (zxDense) {
+                    m = extract(zx, pos, len);
+                } else {
+                    for (; zxIt != zx.end() && *zxIt < pos + len; zxIt++)
+                        m |= WordTy(1) << (*zxIt - pos);
+                }
+                weight += __builtin_popcountll(v & ~m);
+                if (c != 0)
+                    distance += __builtin_popcountll(
+                        (v ^ previous[2 * w]) & ~(m | previous[2 * w + 1]));
+                current[2 * w] = v;
+                current[2 * w + 1] = m;
+            }
+            H.weight[c] = weight;
+            H.distance[c] = distance;
+            previous.swap(current);
+        }
+
+        return H;
+    }
+
+    /// What is sampled from a Signal by sample.
+    enum class SampleKind : uint8_t {
+        VALUE,           ///< The value, truncated to its 64 low bits.
+        HAMMING_WEIGHT,  ///< The Hamming weight of the value.
+        HAMMING_DISTANCE ///< The Hamming distance from the previous sample.
+    };
+
+    /// Sample this Signal at the \p num_times non decreasing \p times, to \p
+    /// dst. This is a single sweep over the changes, which works directly on
+    /// the storage words. As with getHamming, the Z and X bits do not count:
+    /// their value is read as 0, and so is the value before the first
+    /// change. The first sample has a distance of 0.
+    void sample(uint64_t *dst, const TimeTy *times, size_t num_times,
+                SampleKind kind = SampleKind::VALUE) const {
+        const size_t numWords = (numBits + WORD_BITS - 1) / WORD_BITS;
+        // The value and Z / X mask words of the current and of the previous
+        // sample. All bits are unknown before the first change.
+        std::vector<WordTy> current(2 * numWords, 0);
+        std::vector<WordTy> previous(2 * numWords, 0);
+        for (size_t w = 0; w < numWords; w++)
+            current[2 * w + 1] = ~WordTy(0);
+
+        const size_t numChanges = timeIdx.size();
+        size_t c = 0; // The number of changes up to the sample time.
+        auto it = timeIdx.begin();
+        uint64_t s = 0;
+        for (size_t i = 0; i < num_times; i++) {
+            assert((i == 0 || times[i - 1] <= times[i]) &&
+                   "Sample times must not decrease");
+            const size_t first = c;
+            for (; c < numChanges && (*allTimes)[*it] <= times[i]; ++it)
+                c++;
+            if (c != first) {
+                previous.swap(current);
+                getValueWords(c - 1, current.data());
+            }
+            if (i == 0 || c != first) {
+                s = 0;
+                for (size_t w = 0; w < numWords; w++) {
+                    const WordTy v = current[2 * w] & ~current[2 * w + 1];
+                    switch (kind) {
+                    case SampleKind::VALUE:
+                        if (w == 0)
+                            s = v;
+                        break;
+                    case SampleKind::HAMMING_WEIGHT:
+                        s += __builtin_popcountll(v);
+                        break;
+                    case SampleKind::HAMMING_DISTANCE:
+                        if (c != first)
+                            s += __builtin_popcountll(
+                                (current[2 * w] ^ previous[2 * w]) &
+                                ~(current[2 * w + 1] | previous[2 * w + 1]));
+                        break;
+                    }
+                }
+            } else if (kind == SampleKind::HAMMING_DISTANCE)
+                s = 0;
+            dst[i] = s;
+        }
+    }
+
+    /// differ, in time or in value. When they do not differ on their common
+    /// changes, this is the number of changes of the shortest one: the
+    /// Signals are equal iff this is getNumChanges() and they have the same
+    /// number of changes. If not null, \p timeMap maps the time indices of
+    /// \p RHS to this Signal's time indices, for the Signals of Waveforms
+    /// with different times. The values are compared on the storage words.
+    [[nodiscard]] size_t
+    firstDifference(const Signal &RHS,
+                    const std::vector<WAN::TimeIdxTy> *timeMap = nullptr) const {
+        if (getNumBits() != RHS.getNumBits())
+            DIE("Can not compare Signals of different size.");
+        size_t n = std::min(getNumChanges(), RHS.getNumChanges());
+        if (timeMap) {
+            for (size_t c = 0; c < n; c++)
+                if ((*timeMap)[RHS.timeIdx[c]] != timeIdx[c]) {
+                    n = c;
+                    break;
+                }
+        } else {
+            n = timeIdx.mismatch(RHS.timeIdx, n);
+        }
+
+        // Look for the first differing bit in the changes with matching
+        // times, in the value plane then in the Z / X markers.
+        size_t pos = firstDifferentBit(value, RHS.value, n * numBits);
+        if (!zx.empty() || !RHS.zx.empty())
+            pos = firstZXDifference(RHS, pos);
+        return std::min(n, pos / numBits);
+    }
+
     class Iterator {
       public:
         using iterator_category = std::random_access_iterator_tag;
@@ -714,9 +791,22 @@ class Signal {
     [[nodiscard]] Iterator begin() const { return {this, 0}; }
     [[nodiscard]] Iterator end() const { return {this, getNumChanges()}; }
 
+    /// Get the size in bytes of the time indices storage.
+    [[nodiscard]] size_t getTimingsSize() const {
+        return timeIdx.getStorageSize();
+    }
+
     [[nodiscard]] size_t getObjectSize() const {
-        return sizeof(*this) + timeIdx.size() * sizeof(timeIdx[0]) +
-               value.size() * sizeof(value[0]);
+        return sizeof(*this) + timeIdx.getStorageSize() +
+               value.size() * sizeof(value[0]) + zx.size() * sizeof(zx[0]);
+    }
+
+    /// Get the memory used by this Signal, in bytes, including the storage
+    /// reserved for growth.
+    [[nodiscard]] size_t memoryUsage() const {
+        return sizeof(*this) + timeIdx.memoryUsage() +
+               value.capacity() * sizeof(value[0]) +
+               zx.capacity() * sizeof(zx[0]);
     }
 
     bool checkTimeOrigin(const std::vector<TimeTy> *times) const {
@@ -730,10 +820,169 @@ class Signal {
     void fixupTimeOrigin(const std::vector<TimeTy> *times) { allTimes = times; }
 
   private:
-    std::vector<WAN::TimeIdxTy> timeIdx;
-    std::vector<Pack> value;
+    friend class WaveCache;
+
+    // The time indices of the changes, in bit-packed frames of deltas.
+    PackedIndices timeIdx;
+    // The value plane holds one bit per value bit: the bits of change c are
+    // at positions [c * numBits, (c + 1) * numBits). Z and X are encoded as 0
+    // and 1 respectively in the value plane, and marked in the zx side table.
+    PlaneTy value;
+    // The positions holding a Z or X value: either a sorted list of the
+    // positions when they are sparse, or a plane with the value plane
+    // geometry once this is smaller.
+    PlaneTy zx;
     const std::vector<TimeTy> *allTimes;
     unsigned numBits;
+    bool zxDense = false;
+
+    static bool getBit(const PlaneTy &plane, size_t pos) {
+        return (plane[pos / WORD_BITS] >> (pos % WORD_BITS)) & 1;
+    }
+    static void setBit(PlaneTy &plane, size_t pos) {
+        plane[pos / WORD_BITS] |= WordTy(1) << (pos % WORD_BITS);
+    }
+    static void clearBit(PlaneTy &plane, size_t pos) {
+        plane[pos / WORD_BITS] &= ~(WordTy(1) << (pos % WORD_BITS));
+    }
+    // Get the len (at most WORD_BITS) bits of plane at [pos, pos + len).
+    static WordTy extract(const PlaneTy &plane, size_t pos, size_t len) {
+        const size_t word = pos / WORD_BITS;
+        const size_t offset = pos % WORD_BITS;
+        WordTy w = plane[word] >> offset;
+        if (offset + len > WORD_BITS)
+            w |= plane[word + 1] << (WORD_BITS - offset);
+        return len == WORD_BITS ? w : w & ((WordTy(1) << len) - 1);
+    }
+
+    // Get the first position in [0, numPos) where planes lhs and rhs differ,
+    // or numPos if they do not.
+    static size_t firstDifferentBit(const PlaneTy &lhs, const PlaneTy &rhs,
+                                    size_t numPos) {
+        for (size_t w = 0; w * WORD_BITS < numPos; w++)
+            if (const WordTy d = lhs[w] ^ rhs[w]; d != 0)
+                return std::min(numPos, w * WORD_BITS + __builtin_ctzll(d));
+        return numPos;
+    }
+
+    // Get the first position in [0, numPos) which holds a Z or X value in
+    // only one of this Signal and RHS, or numPos if there is none.
+    [[nodiscard]] size_t firstZXDifference(const Signal &RHS,
+                                           size_t numPos) const {
+        if (zxDense && RHS.zxDense)
+            return firstDifferentBit(zx, RHS.zx, numPos);
+        if (!zxDense && !RHS.zxDense) {
+            // The first mismatch in the sorted position lists is a position
+            // which is only in one of them.
+            const auto [it1, it2] =
+                std::mismatch(zx.begin(), zx.end(), RHS.zx.begin(),
+                              RHS.zx.end());
+            if (it1 != zx.end())
+                numPos = std::min<size_t>(numPos, *it1);
+            if (it2 != RHS.zx.end())
+                numPos = std::min<size_t>(numPos, *it2);
+            return numPos;
+        }
+        const auto getPlane = [](const Signal &S) {
+            if (S.zxDense)
+                return S.zx;
+            PlaneTy plane(S.value.size(), 0);
+            for (const auto &p : S.zx)
+                setBit(plane, p);
+            return plane;
+        };
+        return firstDifferentBit(getPlane(*this), getPlane(RHS), numPos);
+    }
+
+    // Get to vm the value and Z / X mask storage words of change, each
+    // value word being followed by its mask word.
+    void getValueWords(size_t change, WordTy *vm) const {
+        for (size_t w = 0; w * WORD_BITS < numBits; w++) {
+            const size_t pos = change * numBits + w * WORD_BITS;
+            const size_t len = std::min(WORD_BITS, numBits - w * WORD_BITS);
+            WordTy m = 0;
+            if (zxDense) {
+                m = extract(zx, pos, len);
+            } else {
+                for (auto zxIt = std::lower_bound(zx.begin(), zx.end(), pos);
+                     zxIt != zx.end() && *zxIt < pos + len; zxIt++)
+                    m |= WordTy(1) << (*zxIt - pos);
+            }
+            vm[2 * w] = extract(value, pos, len);
+            vm[2 * w + 1] = m;
+        }
+    }
+
+    [[nodiscard]] bool getPlaneBit(size_t pos) const {
+        return getBit(value, pos);
+    }
+    [[nodiscard]] Logic::Ty getZX(size_t pos) const {
+        return getPlaneBit(pos) ? Logic::Ty::UNKNOWN : Logic::Ty::HIGH_Z;
+    }
+    [[nodiscard]] bool isHighZOrUnknown(size_t pos) const {
+        if (zxDense)
+            return getBit(zx, pos);
+        return std::binary_search(zx.begin(), zx.end(), pos);
+    }
+
+    // Get the slot for a value change at time index t, returning the
+    // position of its first bit. The slot is all 0s.
+    size_t newSlot(WAN::TimeIdxTy t) {
+        assert(timeIdx.size() * numBits <= value.size() * WORD_BITS &&
+               "Time and Value size discrepancy");
+        if (!timeIdx.empty())
+            assert(t >= timeIdx.back() && "Time must increase monotonically "
+                                          "when appending a value change");
+
+        if (!timeIdx.empty() && t == timeIdx.back()) {
+            // Multiple changes at the same time: overwrite the current value.
+            const size_t base = (timeIdx.size() - 1) * numBits;
+            for (size_t pos = base; pos < base + numBits; pos++)
+                clearBit(value, pos);
+            if (zxDense) {
+                for (size_t pos = base; pos < base + numBits; pos++)
+                    clearBit(zx, pos);
+            } else {
+                while (!zx.empty() && zx.back() >= base)
+                    zx.pop_back();
+            }
+            return base;
+        }
+
+        // New time: the value needs to be written in a new slot.
+        const size_t base = timeIdx.size() * numBits;
+        timeIdx.push_back(t);
+        const size_t numWords = (base + numBits + WORD_BITS - 1) / WORD_BITS;
+        value.resize(numWords, 0);
+        if (zxDense)
+            zx.resize(numWords, 0);
+        return base;
+    }
+
+    // Set the (cleared) bit at position pos to v.
+    void set(size_t pos, Logic::Ty v) {
+        if (Logic::isLogic(v)) {
+            if (v == Logic::Ty::LOGIC_1)
+                setBit(value, pos);
+            return;
+        }
+        if (Logic::isUnknown(v))
+            setBit(value, pos);
+        if (zxDense) {
+            setBit(zx, pos);
+            return;
+        }
+        // The positions are set in increasing order.
+        zx.push_back(pos);
+        if (zx.size() > value.size()) {
+            // The sparse list became larger than a plane: switch to a plane.
+            PlaneTy plane(value.size(), 0);
+            for (const auto &p : zx)
+                setBit(plane, p);
+            zx.swap(plane);
+            zxDense = true;
+        }
+    }
 };
 
 inline Signal::Iterator operator+(const Signal::Iterator &it, int n) {
@@ -0,0 +1,41 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/WAN/Waveform.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace PAF::WAN {
+
+/// Get a synthetic Waveform, for testing, benchmarking or sizing the waveform
+/// tools at scale without actual captures. The Waveform has \p numSignals
+/// signals in a single "top" module, alternately 1-bit wires and 32-bit
+/// registers, and \p numTimes time steps, \p period time units apart. All
+/// signals get a value at the first time step, and then change at each time
+/// step with probability \p activity. The Waveform only depends on its
+/// parameters and on \p seed.
+Waveform syntheticWaveform(size_t numSignals, size_t numTimes,
+                           double activity, uint64_t seed = 0,
+                           TimeTy period = 10);
+
+} // namespace PAF::WAN
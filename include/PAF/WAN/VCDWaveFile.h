@@ -24,6 +24,7 @@
 #include "PAF/WAN/WaveFile.h"
 #include "PAF/WAN/Waveform.h"
 
+#include <cstddef>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -33,16 +34,33 @@ namespace PAF::WAN {
 /// The VCDWaveFile class is an abstraction of the VCD file format.
 class VCDWaveFile : public WaveFile {
   public:
+    /// The default minimum size of the chunks the VCD body is split in for
+    /// parsing: smaller chunks would cost more in scheduling and stitching
+    /// than they would save in parsing.
+    static constexpr size_t DEFAULT_MIN_CHUNK_SIZE = 1024 * 1024;
+
     VCDWaveFile() = delete;
     VCDWaveFile(const VCDWaveFile &) = delete;
     VCDWaveFile(std::string_view filename)
         : WaveFile(filename, WaveFile::FileFormat::VCD) {}
 
-    /// Convenience method to read from a single input file.
-    Waveform read();
+    /// Split the VCD body in (at most) \p numChunks chunks of at least \p
+    /// minChunkSize bytes for parsing. A \p numChunks of 0, the default,
+    /// uses one chunk per worker of the process ThreadPool.
+    VCDWaveFile &setChunking(size_t numChunks,
+                             size_t minChunkSize = DEFAULT_MIN_CHUNK_SIZE) {
+        this->numChunks = numChunks;
+        this->minChunkSize = minChunkSize;
+        return *this;
+    }
+
+    using WaveFile::read;
 
-    /// Construct a Waveform from file FileName.
-    bool read(Waveform &W) override;
+    /// Construct a Waveform from file FileName, with only the scopes and
+    /// signals selected by \p options, and only the changes relevant to
+    /// \p windows.
+    bool read(Waveform &W, const Waveform::Visitor::Options &options,
+              const TimeWindows &windows) override;
 
     /// Save Waveform W to file 'FileName'.
     bool write(const Waveform &W) override;
@@ -53,6 +71,10 @@ class VCDWaveFile : public WaveFile {
     /// Format the ValueChange string \p s for emitting in a VCD file by
     /// stripping leading zeroes and lowercasing the string.
     static std::string formatValueChange(std::string_view s);
+
+  private:
+    size_t numChunks = 0;
+    size_t minChunkSize = DEFAULT_MIN_CHUNK_SIZE;
 };
 
 } // namespace PAF::WAN
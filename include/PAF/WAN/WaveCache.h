@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/WAN/WaveFile.h"
+#include "PAF/WAN/Waveform.h"
+
+#include <string>
+
+namespace PAF::WAN {
+
+/// The WaveCache class persists a Waveform read from a VCD or FST file in a
+/// binary sidecar file, so that the tools run later on the same waveform file
+/// reload it without parsing it again.
+///
+/// The cache file holds the scope tree, the signal descriptions, the times and
+/// the signals' storage, the latter as 8-byte aligned arrays in native byte
+/// order: loading it amounts to mapping the file in memory and copying those
+/// arrays. It is tied to the waveform file it was read from by its size and
+/// modification time, and to the scopes, signals and time windows selected
+/// for the read: should any of them change, the cache content is discarded.
+class WaveCache {
+  public:
+    /// Construct a WaveCache for waveform file \p waveFilename, backed by
+    /// file \p filename.
+    WaveCache(const std::string &filename, const std::string &waveFilename)
+        : filename(filename), waveFilename(waveFilename) {}
+
+    /// Construct a WaveCache for waveform file \p waveFilename, backed by a
+    /// sidecar file next to it.
+    explicit WaveCache(const std::string &waveFilename)
+        : WaveCache(getCacheFilename(waveFilename), waveFilename) {}
+
+    WaveCache(const WaveCache &) = delete;
+    WaveCache &operator=(const WaveCache &) = delete;
+
+    /// Is this WaveCache in a good state ?
+    [[nodiscard]] bool good() const noexcept { return errstr == nullptr; }
+
+    /// Get the last error message, if any.
+    [[nodiscard]] const char *error() const noexcept { return errstr; }
+
+    /// Get the name of the file backing this cache.
+    [[nodiscard]] const std::string &getFilename() const noexcept {
+        return filename;
+    }
+
+    /// Load into \p W the Waveform cached for a read with \p options and \p
+    /// windows. Returns false, leaving \p W untouched, if there is no such
+    /// valid cache.
+    bool load(Waveform &W,
+              const Waveform::Visitor::Options &options =
+                  Waveform::Visitor::Options(),
+              const TimeWindows &windows = TimeWindows());
+
+    /// Save \p W, read with \p options and \p windows, to the cache file.
+    /// Returns false in case of error.
+    bool save(const Waveform &W,
+              const Waveform::Visitor::Options &options =
+                  Waveform::Visitor::Options(),
+              const TimeWindows &windows = TimeWindows());
+
+    /// Read our waveform file with \p options and \p windows: the Waveform
+    /// is loaded from the cache if it is valid, or else read from the
+    /// waveform file and saved to the cache.
+    Waveform read(const Waveform::Visitor::Options &options =
+                      Waveform::Visitor::Options(),
+                  const TimeWindows &windows = TimeWindows());
+
+    /// Get the name of the sidecar cache file for \p waveFilename.
+    static std::string getCacheFilename(const std::string &waveFilename);
+
+  private:
+    std::string filename;
+    std::string waveFilename;
+    const char *errstr = nullptr;
+
+    class Reader;
+    class Writer;
+
+    /// Get the key tying the cache content to our waveform file and to the
+    /// read selection, or an empty string if the waveform file can not be
+    /// accessed.
+    [[nodiscard]] std::string
+    getKey(const Waveform::Visitor::Options &options,
+           const TimeWindows &windows) const;
+
+    static void saveScope(Writer &Wr, const Waveform::Scope &S);
+    static bool loadScope(Reader &Rd, Waveform::Scope &S, size_t numSignals);
+};
+
+/// Read waveform file \p filename with only the scopes and signals selected by
+/// \p options, and only the changes relevant to \p windows. If \p useCache
+/// is set, the Waveform is loaded from the file's sidecar WaveCache when it is
+/// valid, and the cache is (re)created otherwise: failing to use the cache is
+/// not an error, the waveform file is then simply read.
+Waveform readWaveform(const std::string &filename, bool useCache,
+                      const Waveform::Visitor::Options &options =
+                          Waveform::Visitor::Options(),
+                      const TimeWindows &windows = TimeWindows());
+
+} // namespace PAF::WAN
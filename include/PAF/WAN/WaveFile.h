@@ -23,14 +23,104 @@
 #include "PAF/WAN/Signal.h"
 #include "PAF/WAN/Waveform.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace PAF::WAN {
 
+/// The TimeWindows class describes the [begin, end) time windows a waveform
+/// read is restricted to. An empty TimeWindows does not restrict anything.
+class TimeWindows {
+  public:
+    using Window = std::pair<TimeTy, TimeTy>;
+
+    /// Construct an empty TimeWindows, which selects all times.
+    TimeWindows() = default;
+    /// Construct a TimeWindows with a single [begin, end) window.
+    TimeWindows(TimeTy begin, TimeTy end) { add(begin, end); }
+
+    /// Add the [begin, end) window, which must start at or after the end of
+    /// the previously added window.
+    TimeWindows &add(TimeTy begin, TimeTy end);
+
+    /// Does this TimeWindows select all times ?
+    [[nodiscard]] bool empty() const { return windows.empty(); }
+    /// Get the number of windows.
+    [[nodiscard]] size_t size() const { return windows.size(); }
+    /// Get the \p i-th window.
+    [[nodiscard]] const Window &operator[](size_t i) const {
+        return windows[i];
+    }
+    /// Get the start time of the first window.
+    [[nodiscard]] TimeTy getBeginTime() const { return windows.front().first; }
+    /// Get the end time of the last window.
+    [[nodiscard]] TimeTy getEndTime() const { return windows.back().second; }
+
+    [[nodiscard]] std::vector<Window>::const_iterator begin() const {
+        return windows.begin();
+    }
+    [[nodiscard]] std::vector<Window>::const_iterator end() const {
+        return windows.end();
+    }
+
+    /// Get the index of the first window ending after time \p t, or size()
+    /// if there is none.
+    [[nodiscard]] size_t find(TimeTy t) const;
+
+    /// Is time \p t inside one of the windows ?
+    [[nodiscard]] bool contains(TimeTy t) const {
+        if (empty())
+            return true;
+        const size_t w = find(t);
+        return w < size() && t >= windows[w].first;
+    }
+
+  private:
+    std::vector<Window> windows;
+};
+
+/// The WriteOptions control how waveform files are saved, for the file
+/// formats which support it: the value changes are compressed by blocks in the
+/// fst format.
+struct WriteOptions {
+    /// The compression level, trading the file size for the saving speed.
+    enum class Compression : uint8_t {
+        FAST,     ///< Fastest compression (lz4 in fst files).
+        BALANCED, ///< Intermediate compression (fastlz in fst files).
+        SMALL     ///< Smallest files (zlib in fst files).
+    };
+
+    Compression compression = Compression::FAST;
+    /// Compress the blocks on a worker thread, while the value changes of the
+    /// next block are fed.
+    bool parallel = true;
+    /// The number of value changes per block, or 0 to let the file format
+    /// library decide based on the memory used.
+    size_t blockSize = 0;
+
+    WriteOptions &setCompression(Compression c) {
+        compression = c;
+        return *this;
+    }
+    WriteOptions &setParallel(bool p) {
+        parallel = p;
+        return *this;
+    }
+    WriteOptions &setBlockSize(size_t s) {
+        blockSize = s;
+        return *this;
+    }
+
+    /// Get the compression level named \p level ("fast", "balanced" or
+    /// "small"). Returns false if \p level is not a known level.
+    static bool getCompression(std::string_view level, Compression &c);
+};
+
 /// WaveFile is a base class for the different file formats supported by WAN:
 /// vcd, fst, ...
 class WaveFile {
@@ -53,16 +143,47 @@ class WaveFile {
     /// Get this WaveFile filename.
     [[nodiscard]] const std::string &getFileName() const { return fileName; }
 
+    /// Set the options used when saving to this WaveFile.
+    WaveFile &setWriteOptions(const WriteOptions &options) {
+        writeOptions = options;
+        return *this;
+    }
+
+    /// Get the options used when saving to this WaveFile.
+    [[nodiscard]] const WriteOptions &getWriteOptions() const {
+        return writeOptions;
+    }
+
     /// Convenience method to automatically detect the wavefile format and read
     /// it for read / write.
     static std::unique_ptr<WaveFile> get(std::string_view filename,
                                          bool write);
 
-    /// Convenience method to read from a single input file.
-    Waveform read();
+    /// Convenience method to read from a single input file, with only the
+    /// scopes and signals selected by \p options, and only the changes
+    /// relevant to the \p windows.
+    Waveform read(const Waveform::Visitor::Options &options =
+                      Waveform::Visitor::Options(),
+                  const TimeWindows &windows = TimeWindows());
 
     /// Construct a Waveform from file FileName.
-    virtual bool read(Waveform &W) = 0;
+    bool read(Waveform &W) {
+        return read(W, Waveform::Visitor::Options(), TimeWindows());
+    }
+
+    /// Construct a Waveform from file FileName, with only the scopes and
+    /// signals selected by \p options.
+    bool read(Waveform &W, const Waveform::Visitor::Options &options) {
+        return read(W, options, TimeWindows());
+    }
+
+    /// Construct a Waveform from file FileName, with only the scopes and
+    /// signals selected by \p options. The unselected signals are not
+    /// created, and their changes are not decoded. If \p windows is not
+    /// empty, only the changes inside the windows, and the last change before
+    /// each window, are loaded.
+    virtual bool read(Waveform &W, const Waveform::Visitor::Options &options,
+                      const TimeWindows &windows) = 0;
 
     /// Save Waveform W to file 'FileName'.
     virtual bool write(const Waveform &W) = 0;
@@ -70,12 +191,32 @@ class WaveFile {
     /// Quickly read the file to collect all times with changes.
     virtual std::vector<WAN::TimeTy> getAllChangesTimes() = 0;
 
+    /// Get the times of the first and last changes in the file. The default
+    /// implementation collects all times with changes, file formats which
+    /// record those times in their header should override it.
+    virtual std::pair<TimeTy, TimeTy> getTimeRange();
+
   protected:
     // The file name this waves are coming from.
     std::string fileName = "";
     FileFormat fileFmt;
+    WriteOptions writeOptions;
 };
 
-Waveform readAndMerge(const std::vector<std::string> &files);
+Waveform readAndMerge(const std::vector<std::string> &files,
+                      const Waveform::Visitor::Options &options =
+                          Waveform::Visitor::Options(),
+                      const TimeWindows &windows = TimeWindows());
+
+/// Merge \p files into the fst file \p output without loading them entirely:
+/// the inputs time range is split in \p numSlices time slices, and for each
+/// slice, the inputs are read and their value changes merged in time order
+/// and written to \p output. The memory used is thus bounded by the content
+/// of a time slice. This is efficient with fst inputs, where only the blocks
+/// overlapping a slice are decompressed. \p output is saved with \p
+/// writeOptions.
+void streamMerge(const std::vector<std::string> &files,
+                 const std::string &output, size_t numSlices = 64,
+                 const WriteOptions &writeOptions = WriteOptions());
 
 } // namespace PAF::WAN
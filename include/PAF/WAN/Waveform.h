@@ -31,6 +31,7 @@
 #include <set>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -228,12 +229,7 @@ class Waveform {
             : fullScopeName(other.fullScopeName), scopeName(other.scopeName),
               instanceName(other.instanceName), kind(other.kind),
               root(other.root) {
-            subScopes.reserve(other.subScopes.size());
-            for (const auto &s : other.subScopes)
-                subScopes.emplace_back(new Scope(*s.get()));
-            signals.reserve(other.signals.size());
-            for (const auto &s : other.signals)
-                signals.emplace_back(new SignalDesc(*s.get()));
+            copyContent(other);
         }
 
         Scope &operator=(Scope &&) = default;
@@ -243,14 +239,7 @@ class Waveform {
             instanceName = rhs.instanceName;
             kind = rhs.kind;
             root = rhs.root;
-            subScopes.clear();
-            subScopes.reserve(rhs.subScopes.size());
-            for (const auto &s : rhs.subScopes)
-                subScopes.emplace_back(new Scope(*s.get()));
-            signals.clear();
-            signals.reserve(rhs.signals.size());
-            for (const auto &s : rhs.signals)
-                signals.emplace_back(new SignalDesc(*s.get()));
+            copyContent(rhs);
             return *this;
         }
 
@@ -282,22 +271,16 @@ class Waveform {
         [[nodiscard]] bool hasSignals() const { return !signals.empty(); }
 
         [[nodiscard]] bool hasSubScope(const std::string &subScopeName) const {
-            for (const auto &s : subScopes)
-                if (s->instanceName == subScopeName)
-                    return true;
-            return false;
+            return subScopeIndex.count(subScopeName) != 0;
         }
         std::pair<bool, Scope *> findSubScope(const std::string &subScopeName) {
-            for (auto &s : subScopes)
-                if (s->instanceName == subScopeName)
-                    return std::make_pair(true, s.get());
-            return std::make_pair(false, nullptr);
+            const auto it = subScopeIndex.find(subScopeName);
+            if (it == subScopeIndex.end())
+                return std::make_pair(false, nullptr);
+            return std::make_pair(true, subScopes[it->second].get());
         }
         [[nodiscard]] bool hasSignal(const std::string &signalName) const {
-            for (const auto &s : signals)
-                if (s->getName() == signalName)
-                    return true;
-            return false;
+            return signalIndex.count(signalName) != 0;
         }
 
         void dump(std::ostream &os, bool rec = true, unsigned level = 0) const {
@@ -339,11 +322,14 @@ class Waveform {
 
             // Signals:
             size += signals.size() * sizeof(signals[0]);
+            size += signalIndex.size() * sizeof(*signalIndex.begin());
             for (const auto &s : signals)
                 size += s->getObjectSize();
 
             // SubScopes
             size += subScopes.size() * sizeof(subScopes[0]);
+            size += subScopeIndex.size() * sizeof(*subScopeIndex.begin());
+            size += fullNameIndex.size() * sizeof(*fullNameIndex.begin());
             for (const auto &s : subScopes)
                 size += s->getObjectSize();
 
@@ -359,6 +345,7 @@ class Waveform {
                 return *r.second;
             subScopes.emplace_back(
                 new Scope(fullScopeName, scopeName, instanceName, kind));
+            indexSubScope(subScopes.size() - 1);
             return *subScopes.back().get();
         }
 
@@ -371,6 +358,7 @@ class Waveform {
             subScopes.emplace_back(new Scope(std::move(fullScopeName),
                                              std::move(scopeName),
                                              std::move(instanceName), kind));
+            indexSubScope(subScopes.size() - 1);
             return *subScopes.back().get();
         }
 
@@ -403,6 +391,7 @@ class Waveform {
                 DIE("Signal already exists in this Scope");
 #endif
             signals.emplace_back(new SignalDesc(signalName, kind, alias, idx));
+            indexSignal(signals.size() - 1);
         }
 
         void addSignal(std::string &&signalName, SignalDesc::Kind kind,
@@ -413,14 +402,15 @@ class Waveform {
 #endif
             signals.emplace_back(
                 new SignalDesc(std::move(signalName), kind, alias, idx));
+            indexSignal(signals.size() - 1);
         }
 
         [[nodiscard]] const SignalDesc &
         getSignalDesc(const std::string &signalName) const {
-            for (const auto &s : signals)
-                if (s->getName() == signalName)
-                    return *s.get();
-            DIE("Signal does not exist");
+            const auto it = signalIndex.find(signalName);
+            if (it == signalIndex.end())
+                DIE("Signal does not exist");
+            return *signals[it->second].get();
         }
 
         [[nodiscard]] SignalIdxTy
@@ -433,12 +423,19 @@ class Waveform {
                        const std::string &signalName) const {
             if (fullScopeName == FSN) {
                 // Yay, we are in the right scope !
-                for (const auto &s : signals)
-                    if (s->getName() == signalName)
-                        return s.get();
-                return nullptr;
+                const auto it = signalIndex.find(signalName);
+                if (it == signalIndex.end())
+                    return nullptr;
+                return signals[it->second].get();
             }
 
+            // Fast path: FSN is one of our direct sub-scopes.
+            if (const auto it = fullNameIndex.find(FSN);
+                it != fullNameIndex.end())
+                if (const SignalDesc *res =
+                        subScopes[it->second]->findSignalDesc(FSN, signalName))
+                    return res;
+
             if (root || FSN.size() > fullScopeName.size())
                 for (const auto &s : subScopes) {
                     auto res = s->findSignalDesc(FSN, signalName);
@@ -481,6 +478,12 @@ class Waveform {
                     return *this;
                 }
 
+                /// Get the scope filters.
+                [[nodiscard]] const std::vector<std::string> &
+                getScopeFilters() const {
+                    return scopeFilters;
+                }
+
                 Options &setSkipRegisters(bool v) {
                     skipRegs = v;
                     return *this;
@@ -496,7 +499,12 @@ class Waveform {
 
                 /// Returns true iff Signal \p S shall be skipped.
                 [[nodiscard]] bool skip(const SignalDesc &SDesc) const {
-                    switch (SDesc.getKind()) {
+                    return skip(SDesc.getKind());
+                }
+
+                /// Returns true iff signals of kind \p kind shall be skipped.
+                [[nodiscard]] bool skip(SignalDesc::Kind kind) const {
+                    switch (kind) {
                     case SignalDesc::Kind::REGISTER:
                         return skipRegs;
                     case SignalDesc::Kind::WIRE:
@@ -510,8 +518,21 @@ class Waveform {
                     return skipRegs && skipWires && skipInts;
                 }
 
+                /// Returns true iff all scopes and all signals are selected.
+                [[nodiscard]] bool isAllSelected() const {
+                    return scopeFilters.empty() && !skipRegs && !skipWires &&
+                           !skipInts;
+                }
+
                 /// Returns false iff Scope \p scope shall be visited.
-                [[nodiscard]] FilterAction filter(const Scope &scope) const;
+                [[nodiscard]] FilterAction filter(const Scope &scope) const {
+                    return filter(scope.getFullScopeName());
+                }
+
+                /// Returns false iff the scope named \p fullScopeName shall
+                /// be visited.
+                [[nodiscard]] FilterAction
+                filter(const std::string &fullScopeName) const;
 
               private:
                 std::vector<std::string> scopeFilters;
@@ -557,13 +578,52 @@ class Waveform {
         }
 
       private:
+        friend class WaveCache;
+
         std::string fullScopeName;
         std::string scopeName;
         std::string instanceName;
         std::vector<std::unique_ptr<Scope>> subScopes;
         std::vector<std::unique_ptr<SignalDesc>> signals;
+        // Hash indexes into subScopes (by instance name and by full scope
+        // name) and signals (by name). The keys view the strings owned by the
+        // heap allocated sub-scopes and signals, so they remain valid when
+        // this Scope is moved.
+        std::unordered_map<std::string_view, size_t> subScopeIndex;
+        std::unordered_map<std::string_view, size_t> fullNameIndex;
+        std::unordered_map<std::string_view, size_t> signalIndex;
         Kind kind;
         bool root;
+
+        // Index the sub-scope at position i. Only the first sub-scope with a
+        // given name is indexed, as the linear searches used to find it.
+        void indexSubScope(size_t i) {
+            subScopeIndex.emplace(subScopes[i]->instanceName, i);
+            fullNameIndex.emplace(subScopes[i]->fullScopeName, i);
+        }
+        // Index the signal at position i.
+        void indexSignal(size_t i) {
+            signalIndex.emplace(signals[i]->getName(), i);
+        }
+
+        // Deep copy other's sub-scopes and signals into this Scope.
+        void copyContent(const Scope &other) {
+            subScopes.clear();
+            subScopeIndex.clear();
+            fullNameIndex.clear();
+            subScopes.reserve(other.subScopes.size());
+            for (const auto &s : other.subScopes) {
+                subScopes.emplace_back(new Scope(*s.get()));
+                indexSubScope(subScopes.size() - 1);
+            }
+            signals.clear();
+            signalIndex.clear();
+            signals.reserve(other.signals.size());
+            for (const auto &s : other.signals) {
+                signals.emplace_back(new SignalDesc(*s.get()));
+                indexSignal(signals.size() - 1);
+            }
+        }
     };
 
     Waveform() {}
@@ -698,6 +758,17 @@ class Waveform {
         return *this;
     }
 
+    /// Get the time indexes of \p times, adding to this Waveform those times
+    /// it does not have yet.
+    std::vector<WAN::TimeIdxTy>
+    indexTimes(const std::vector<WAN::TimeTy> &times) {
+        std::vector<WAN::TimeIdxTy> indexes;
+        indexes.reserve(times.size());
+        for (const WAN::TimeTy t : times)
+            indexes.push_back(addTime(t));
+        return indexes;
+    }
+
     Scope &addModule(std::string &&instanceName, std::string &&fullScopeName,
                      std::string &&scopeName) {
         return root.addModule(std::move(instanceName), std::move(fullScopeName),
@@ -827,7 +898,7 @@ class Waveform {
 
     // Add a change at time Time with value str to Signal SIdx (string edition).
     Waveform &addValueChange(SignalIdxTy SIdx, WAN::TimeTy Time,
-                             const std::string &str) {
+                             std::string_view str) {
         WAN::TimeIdxTy TIdx = addTime(Time);
         signals[SIdx]->append(TIdx, str);
         return *this;
@@ -870,6 +941,40 @@ class Waveform {
         return allTimes.end();
     }
 
+    /// Get the mapping from the time indices of \p other to the time indices
+    /// of this Waveform. The times of \p other which are not in this
+    /// Waveform are mapped to an index past the last time. The mapping is
+    /// empty when both Waveforms have the same times, in which case their
+    /// time indices can be used directly.
+    [[nodiscard]] std::vector<WAN::TimeIdxTy>
+    getTimeIdxMap(const Waveform &other) const {
+        std::vector<WAN::TimeIdxTy> map;
+        if (allTimes == other.allTimes)
+            return map;
+        map.reserve(other.allTimes.size());
+        // Both times are sorted: walk them in lockstep.
+        WAN::TimeIdxTy idx = 0;
+        for (const TimeTy t : other.allTimes) {
+            while (idx < allTimes.size() && allTimes[idx] < t)
+                idx++;
+            map.push_back(idx < allTimes.size() && allTimes[idx] == t
+                              ? idx
+                              : WAN::TimeIdxTy(allTimes.size()));
+        }
+        return map;
+    }
+
+    /// Sample the \p signals at the non decreasing \p times (see
+    /// Signal::sample) to \p dst, a row of times.size() samples per signal:
+    /// \p dst is typically the storage of an NPArray<uint64_t> with
+    /// signals.size() rows and times.size() columns. The signals are sampled
+    /// in parallel, using up to \p numThreads threads (0 means the ThreadPool
+    /// size).
+    void sample(uint64_t *dst, const std::vector<SignalIdxTy> &signals,
+                const std::vector<TimeTy> &times,
+                Signal::SampleKind kind = Signal::SampleKind::VALUE,
+                unsigned numThreads = 0) const;
+
     /// Waveform visitor base class.
     class Visitor : public Scope::Visitor {
       public:
@@ -900,7 +1005,25 @@ class Waveform {
         return size;
     }
 
+    /// Get the memory used by this Waveform, in bytes, including the storage
+    /// reserved for growth by its times and signals.
+    [[nodiscard]] size_t memoryUsage() const {
+        size_t size = sizeof(*this);
+        size += fileName.capacity();
+        size += version.capacity();
+        size += date.capacity();
+        size += comment.capacity();
+        size += allTimes.capacity() * sizeof(allTimes[0]);
+        size += root.getObjectSize();
+        size += signals.capacity() * sizeof(signals[0]);
+        for (const auto &s : signals)
+            size += s->memoryUsage();
+        return size;
+    }
+
   private:
+    friend class WaveCache;
+
     // The file from which those waves were read from.
     std::string fileName;
     // The file Version field.
@@ -944,30 +1067,64 @@ class Waveform {
     }
 };
 
+/// The WaveformStatistics visitor collects statistics about the scopes and
+/// signals of a Waveform. The visit only records the signals: their
+/// statistics are computed in parallel, with per thread partial statistics
+/// which are then merged.
 class WaveformStatistics : public Waveform::Visitor {
   public:
+    /// In \p fast mode, only the statistics available in constant time per
+    /// signal are computed, from the storage sizes: the signals' changes are
+    /// not iterated over.
     WaveformStatistics(const Waveform &W,
                        const Waveform::Visitor::Options &options =
-                           Waveform::Visitor::Options())
-        : Waveform::Visitor(&W, options) {}
+                           Waveform::Visitor::Options(),
+                       bool fast = false)
+        : Waveform::Visitor(&W, options), seen(W.getNumSignals(), false),
+          fast(fast) {}
 
     void enterScope(const Waveform::Scope &scope) override;
     void leaveScope() override;
     void visitSignal(const std::string &fullScopeName,
                      const Waveform::SignalDesc &SD) override;
 
+    /// The statistics of the (non alias) signals.
+    struct SignalsStatistics {
+        size_t numChanges{0};
+        size_t numToggles{0}; //< Number of bit toggles, not in fast mode.
+        size_t numHighZOrUnknown{0}; //< Number of signals with a Z or X.
+        size_t timingsMemSize{0}; //< Size in Bytes of the timing indexes.
+        size_t signalsMemSize{0}; //< Size in Bytes in memory of the Signals.
+
+        SignalsStatistics &operator+=(const SignalsStatistics &RHS) {
+            numChanges += RHS.numChanges;
+            numToggles += RHS.numToggles;
+            numHighZOrUnknown += RHS.numHighZOrUnknown;
+            timingsMemSize += RHS.timingsMemSize;
+            signalsMemSize += RHS.signalsMemSize;
+            return *this;
+        }
+    };
+
+    /// Compute the statistics of the visited signals, using up to \p
+    /// numThreads threads (0 means the ThreadPool size).
+    [[nodiscard]] SignalsStatistics
+    getSignalsStatistics(unsigned numThreads = 0) const;
+
+    [[nodiscard]] size_t getNumSignals() const { return signals.size(); }
+    [[nodiscard]] size_t getNumAliases() const { return numAliases; }
+    [[nodiscard]] size_t getScopesMemSize() const { return scopesMemSize; }
+
     void dump(std::ostream &out) const;
 
   private:
-    std::set<std::size_t> aliases;
-    size_t numSignals{0};
+    // The visited signals, and whether a signal has already been visited.
+    std::vector<SignalIdxTy> signals;
+    std::vector<bool> seen;
     size_t numAliases{0};
-    size_t numChanges{0};
-    size_t timingsMemSize{}; //< Size in Bytes of the timing indexes.
-    size_t signalsMemSize{
-        0}; //< Size in Bytes in memory of the Waveform structure.
     size_t scopesMemSize{
         0}; //< Size in Bytes in memory of the Scopes structure.
+    bool fast;
 };
 
 std::ostream &operator<<(std::ostream &os, Waveform::SignalDesc::Kind k);
@@ -0,0 +1,163 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PAF {
+
+/// Get the number of threads the hardware supports (at least 1).
+[[nodiscard]] unsigned hardwareNumThreads() noexcept;
+
+/// Get the number of threads to use when none has been explicitly requested:
+/// the value of the PAF_NUM_THREADS environment variable if it is set, or
+/// \p fallback otherwise. In both cases, 0 stands for as many threads as the
+/// hardware supports.
+[[nodiscard]] unsigned defaultNumThreads(unsigned fallback = 0);
+
+/// How the ThreadPool workers are pinned to the CPUs.
+enum class Affinity {
+    /// Let the operating system place the workers.
+    NONE,
+    /// Pin the workers so that they fill the NUMA nodes one after the other,
+    /// which keeps the workers close to each other's caches.
+    COMPACT,
+    /// Pin the workers round-robin on the NUMA nodes, which maximizes the
+    /// memory bandwidth available to the workers.
+    SPREAD
+};
+
+/// The ThreadPool class is a pool of worker threads executing tasks. Each
+/// worker has its own queue of tasks, and idle workers steal tasks from the
+/// other workers' queues. The tasks submitted from a worker go to its own
+/// queue, so that nested parallel sections stay local to the worker which
+/// reached them, unless other workers are idle.
+class ThreadPool {
+  public:
+    /// The type of the tasks. They must not throw.
+    using Task = std::function<void()>;
+
+    /// Construct a ThreadPool with \p numThreads workers (0 meaning as many
+    /// as the hardware supports), pinned to the CPUs according to \p
+    /// affinity.
+    explicit ThreadPool(unsigned numThreads = 0,
+                        Affinity affinity = Affinity::NONE);
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /// Destruct this ThreadPool, once all queued tasks have been executed.
+    ~ThreadPool();
+
+    /// Get the pool shared by the whole process, which is started on first
+    /// use. Its size is given by defaultNumThreads(), and its affinity by the
+    /// PAF_AFFINITY environment variable ("compact", "spread" or "none").
+    static ThreadPool &get();
+
+    /// Get the number of workers in this pool.
+    [[nodiscard]] size_t size() const noexcept { return workers.size(); }
+
+    /// Is the calling thread one of this pool's workers ?
+    [[nodiscard]] bool isWorker() const noexcept;
+
+    /// Queue \p task for execution by one of the workers.
+    void submit(Task task);
+
+  private:
+    struct Worker {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex mtx;
+    std::condition_variable workAvailable;
+    std::atomic<size_t> numQueued{0};
+    std::atomic<size_t> nextQueue{0};
+    bool stopping = false;
+
+    /// The main loop of worker \p index.
+    void run(size_t index);
+    /// Get a task for worker \p index: from the back of its own queue, or
+    /// else from the front of another worker's queue.
+    bool pop(size_t index, Task &task);
+};
+
+namespace detail {
+/// Implementation of parallelFor, see there.
+void parallelFor(size_t begin, size_t end, size_t grain,
+                 const std::function<void(size_t, size_t)> &f,
+                 unsigned numThreads);
+} // namespace detail
+
+/// Call \p f(b, e) on the consecutive sub-ranges [b, e( of \p grain indices
+/// (the last one may be shorter) covering [begin, end(, using up to \p
+/// numThreads threads (0 meaning all the shared ThreadPool workers). The
+/// calling thread takes part in the computation, and parallelFor returns once
+/// all sub-ranges have been processed. \p f must be safe to call concurrently
+/// on disjoint sub-ranges. If \p f throws, the remaining sub-ranges are
+/// skipped and the first exception is rethrown on the calling thread.
+template <class Function>
+void parallelFor(size_t begin, size_t end, size_t grain, const Function &f,
+                 unsigned numThreads = 0) {
+    detail::parallelFor(begin, end, grain, std::cref(f), numThreads);
+}
+
+/// Compute reduce(...reduce(reduce(init, map(b0, e0)), map(b1, e1))...),
+/// with the map calls on the sub-ranges [bi, ei( of \p grain indices
+/// covering [begin, end( computed in parallel by up to \p numThreads threads.
+/// The reductions are performed in order on the calling thread, so the
+/// result does not depend on the number of threads, even for non associative
+/// operations like floating point additions. Ty must be default
+/// constructible.
+template <class Ty, class Map, class Reduce>
+Ty parallelReduce(size_t begin, size_t end, size_t grain, Ty init,
+                  const Map &map, const Reduce &reduce,
+                  unsigned numThreads = 0) {
+    if (begin >= end)
+        return init;
+    if (grain == 0)
+        grain = 1;
+    std::vector<Ty> partial((end - begin + grain - 1) / grain);
+    parallelFor(
+        0, partial.size(), 1,
+        [&](size_t b, size_t e) {
+            for (size_t c = b; c < e; c++) {
+                const size_t first = begin + c * grain;
+                partial[c] = map(first, std::min(first + grain, end));
+            }
+        },
+        numThreads);
+    for (Ty &p : partial)
+        init = reduce(std::move(init), std::move(p));
+    return init;
+}
+
+} // namespace PAF
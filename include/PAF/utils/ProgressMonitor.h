@@ -20,14 +20,17 @@
 
 #pragma once
 
+#include <atomic>
 #include <limits>
+#include <mutex>
 #include <ostream>
 #include <string>
 
 namespace PAF {
 
 /// ProgressMonitor is a minimal helper class to display progresses when
-/// performing long computations.
+/// performing long computations. The progresses can be updated concurrently
+/// from several threads.
 class ProgressMonitor {
   public:
     /// Construct a ProgressMonitor, to output progress on OS, using Title as
@@ -36,13 +39,13 @@ class ProgressMonitor {
     ProgressMonitor(std::ostream &OS, const std::string &Title, size_t Total,
                     bool Visible = true)
         : os(OS), title(Title), totalNumberOfSteps(Total), visible(Visible) {
-        display();
+        display(0);
     }
 
     /// Advance progresses by count steps (default: 1).
     void update(size_t count = 1) {
-        progress += count;
-        display();
+        const size_t current = progress += count;
+        display(current);
     }
 
     /// Get the expected total number of steps to completion.
@@ -55,10 +58,15 @@ class ProgressMonitor {
     }
 
   private:
-    /// Display progresses on OS if the changes are big enough.
-    void display() {
-        unsigned percentage = 100 * progress / totalNumberOfSteps;
-        if (percentage != lastPercentageLogged) {
+    /// Display progresses on OS if the changes are big enough, \p current
+    /// being the number of steps completed.
+    void display(size_t current) {
+        unsigned percentage = 100 * current / totalNumberOfSteps;
+        std::lock_guard<std::mutex> lock(mtx);
+        // Do not go backwards if another thread has already displayed a more
+        // recent progress.
+        if (lastPercentageLogged == std::numeric_limits<unsigned>::max() ||
+            percentage > lastPercentageLogged) {
             if (visible) {
                 os << '\r' << title << ": " << percentage << '%';
                 os.flush();
@@ -73,7 +81,9 @@ class ProgressMonitor {
     /// The total number of steps expected to completion on this task.
     const size_t totalNumberOfSteps;
     /// How many steps have been performed since the beginning.
-    size_t progress{0};
+    std::atomic<size_t> progress{0};
+    /// Serializes the displays.
+    std::mutex mtx;
     /// The last percentage that was updated.
     unsigned lastPercentageLogged{std::numeric_limits<unsigned>::max()};
     /// Display the progress monitor iff true.
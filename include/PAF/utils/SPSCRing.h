@@ -0,0 +1,128 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace PAF {
+
+/// The SPSCRing class is a bounded, lock-free, queue of Ty objects, between a
+/// single producer thread and a single consumer thread.
+///
+/// The objects live in the ring's slots, which are constructed once and then
+/// recycled: the producer fills in place the slot it acquired and publishes
+/// it, and the consumer releases the slot once done with it, so that its
+/// storage (e.g. the capacity of its vectors) is reused by the producer.
+/// Both sides spin, then yield, while the ring is full or empty.
+template <typename Ty> class SPSCRing {
+  public:
+    /// Construct an SPSCRing with at least \p capacity slots (rounded up to a
+    /// power of 2).
+    explicit SPSCRing(size_t capacity)
+        : slots(roundUp(capacity)), mask(slots.size() - 1) {}
+
+    SPSCRing(const SPSCRing &) = delete;
+    SPSCRing &operator=(const SPSCRing &) = delete;
+
+    /// Get the number of slots in this SPSCRing.
+    [[nodiscard]] size_t capacity() const noexcept { return slots.size(); }
+
+    /// Producer side: get the next free slot, waiting for the consumer to
+    /// release one if the ring is full. Returns nullptr if the consumer has
+    /// cancelled the ring.
+    Ty *acquire() {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        for (unsigned spins = 0;
+             t - head.load(std::memory_order_acquire) == slots.size();
+             spins++) {
+            if (cancelled.load(std::memory_order_relaxed))
+                return nullptr;
+            backoff(spins);
+        }
+        return &slots[t & mask];
+    }
+
+    /// Producer side: hand over the slot returned by the last acquire to the
+    /// consumer.
+    void publish() noexcept {
+        tail.store(tail.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+    }
+
+    /// Producer side: no more slots will be published.
+    void close() noexcept { closed.store(true, std::memory_order_release); }
+
+    /// Consumer side: get the oldest published slot, waiting for the producer
+    /// to publish one if the ring is empty. Returns nullptr once the ring has
+    /// been closed and all its published slots consumed.
+    Ty *front() {
+        const size_t h = head.load(std::memory_order_relaxed);
+        for (unsigned spins = 0; tail.load(std::memory_order_acquire) == h;
+             spins++) {
+            // The producer may have published a last slot before closing.
+            if (closed.load(std::memory_order_acquire) &&
+                tail.load(std::memory_order_acquire) == h)
+                return nullptr;
+            backoff(spins);
+        }
+        return &slots[h & mask];
+    }
+
+    /// Consumer side: give the slot returned by the last front back to the
+    /// producer.
+    void release() noexcept {
+        head.store(head.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+    }
+
+    /// Consumer side: stop the producer, e.g. when the consumer fails. The
+    /// pending and later acquire calls return nullptr.
+    void cancel() noexcept { cancelled.store(true, std::memory_order_relaxed); }
+
+  private:
+    // The indices are only ever incremented, the slot of index i being
+    // slots[i & mask]. head and tail are on their own cache lines, as they
+    // are each written by a different thread.
+    std::vector<Ty> slots;
+    const size_t mask;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) std::atomic<bool> closed{false};
+    std::atomic<bool> cancelled{false};
+
+    static size_t roundUp(size_t n) noexcept {
+        size_t c = 1;
+        while (c < n)
+            c <<= 1;
+        return c;
+    }
+
+    // Spin for a little while, then let the other threads run.
+    static void backoff(unsigned spins) noexcept {
+        if (spins >= 64)
+            std::this_thread::yield();
+    }
+};
+
+} // namespace PAF
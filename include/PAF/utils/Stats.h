@@ -0,0 +1,216 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#pragma once
+
+#include "PAF/utils/StopWatch.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+
+class Argparse;
+
+namespace PAF {
+
+/// The Stats class collects statistics about a tool run: counters of the
+/// work performed, the time spent in the ScopedTimer instrumented scopes, and
+/// the memory usage. The counters are kept per thread, so updating them
+/// does not need any synchronization.
+///
+/// The statistics are only collected once enabled, so that the
+/// instrumentation costs a single test when disabled and can stay compiled in
+/// all builds.
+class Stats {
+  public:
+    /// The counters.
+    enum Counter : unsigned {
+        /// Number of instructions replayed from the traces.
+        INSTRUCTIONS_REPLAYED,
+        /// Number of lookups in the trace indexes.
+        INDEX_LOOKUPS,
+        /// Number of bytes read from the NPY files.
+        BYTES_READ,
+        /// Number of rows written to the NPY files.
+        NPY_ROWS_EMITTED,
+        /// Number of faults planned for injection.
+        FAULTS_PLANNED,
+        NUM_COUNTERS
+    };
+
+    /// The subsystems the memory usage is accounted to.
+    enum Subsystem : unsigned {
+        /// The core library: traces, indexes, ...
+        MEM_PAF,
+        /// The side channel analysis library: NPArray, power traces, ...
+        MEM_SCA,
+        /// The waveform library: signals, ...
+        MEM_WAN,
+        /// The fault injection library: campaigns, ...
+        MEM_FI,
+        NUM_SUBSYSTEMS
+    };
+
+    /// Is the statistics collection enabled ?
+    [[nodiscard]] static bool enabled() noexcept {
+        return isEnabled.load(std::memory_order_relaxed);
+    }
+
+    /// Enable (or disable) the statistics collection.
+    static void enable(bool e = true) noexcept { isEnabled = e; }
+
+    /// Add \p n to counter \p c of the calling thread.
+    static void add(Counter c, uint64_t n = 1) noexcept {
+        if (enabled())
+            addToThread(c, n);
+    }
+
+    /// Get the value of counter \p c, summed over all threads.
+    [[nodiscard]] static uint64_t get(Counter c);
+
+    /// Get the name of counter \p c.
+    [[nodiscard]] static const char *getName(Counter c) noexcept;
+
+    /// Get the name of subsystem \p s.
+    [[nodiscard]] static const char *getName(Subsystem s) noexcept;
+
+    /// Record the allocation of \p num_bytes bytes of storage by subsystem
+    /// \p s.
+    static void allocated(size_t num_bytes, Subsystem s = MEM_SCA) noexcept;
+
+    /// Record the release of \p num_bytes bytes of storage by subsystem \p s.
+    static void released(size_t num_bytes, Subsystem s = MEM_SCA) noexcept;
+
+    /// Get the number of bytes of storage currently allocated, by all
+    /// subsystems.
+    [[nodiscard]] static uint64_t getAllocatedBytes() noexcept;
+
+    /// Get the number of bytes of storage currently allocated by subsystem
+    /// \p s.
+    [[nodiscard]] static uint64_t getAllocatedBytes(Subsystem s) noexcept;
+
+    /// Get the peak number of bytes of storage allocated by all subsystems
+    /// since the statistics collection was enabled.
+    [[nodiscard]] static uint64_t getPeakAllocatedBytes() noexcept;
+
+    /// Get the peak number of bytes of storage allocated by subsystem \p s
+    /// since the statistics collection was enabled.
+    [[nodiscard]] static uint64_t getPeakAllocatedBytes(Subsystem s) noexcept;
+
+    /// Get the current resident set size of the process, in bytes, or 0 if
+    /// it is not available.
+    [[nodiscard]] static uint64_t getRSS();
+
+    /// Get the peak resident set size of the process, in bytes, or 0 if it
+    /// is not available.
+    [[nodiscard]] static uint64_t getPeakRSS();
+
+    /// Clear all statistics. This must not be called while other threads
+    /// are updating them.
+    static void reset();
+
+    /// Write the statistics, in JSON format, to \p os.
+    static void writeJSON(std::ostream &os);
+
+    /// Write the statistics, in JSON format, to file \p filename. Returns
+    /// false in case of error.
+    static bool writeJSON(const std::string &filename);
+
+    /// Add the --stats-json option to \p ap, which enables the statistics
+    /// collection and dumps them to the specified file when the program
+    /// exits.
+    static void addOptions(Argparse &ap);
+
+  private:
+    static std::atomic<bool> isEnabled;
+    static void addToThread(Counter c, uint64_t n) noexcept;
+};
+
+/// TrackingAllocator is a standard allocator which records the memory it
+/// allocates in the Stats, accounted to subsystem \p S. It is meant for the
+/// containers holding the bulk of the data (signal changes, instructions,
+/// ...), so that their current and peak footprint show up in the statistics.
+template <class Ty, Stats::Subsystem S> class TrackingAllocator {
+  public:
+    using value_type = Ty;
+
+    template <class Other> struct rebind {
+        using other = TrackingAllocator<Other, S>;
+    };
+
+    TrackingAllocator() noexcept = default;
+    template <class Other>
+    TrackingAllocator(const TrackingAllocator<Other, S> &) noexcept {}
+
+    [[nodiscard]] Ty *allocate(size_t n) {
+        Ty *p = std::allocator<Ty>().allocate(n);
+        Stats::allocated(n * sizeof(Ty), S);
+        return p;
+    }
+
+    void deallocate(Ty *p, size_t n) noexcept {
+        std::allocator<Ty>().deallocate(p, n);
+        Stats::released(n * sizeof(Ty), S);
+    }
+
+    template <class Other>
+    bool operator==(const TrackingAllocator<Other, S> &) const noexcept {
+        return true;
+    }
+    template <class Other>
+    bool operator!=(const TrackingAllocator<Other, S> &) const noexcept {
+        return false;
+    }
+};
+
+/// ScopedTimer measures the time spent in a scope, which is accumulated in
+/// the Stats under \p name. The ScopedTimers nest: a timer started while
+/// another one is running on the same thread is recorded as its child, as
+/// "parent/child".
+class ScopedTimer {
+  public:
+    /// Start timing the scope, with name \p name, if the statistics
+    /// collection is enabled.
+    explicit ScopedTimer(const char *name) {
+        if (Stats::enabled())
+            start(name);
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    /// Stop timing the scope, and record it.
+    ~ScopedTimer() {
+        if (active)
+            stop();
+    }
+
+  private:
+    StopWatchBase::TimePoint startTime;
+    bool active = false;
+
+    void start(const char *name);
+    void stop();
+};
+
+} // namespace PAF
@@ -0,0 +1,440 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/FI/CampaignFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <sstream>
+
+using std::ostream;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+using PAF::FI::BinaryCampaignReader;
+
+namespace {
+// The fault models, as encoded in the file header.
+enum FaultModel : uint32_t { UNKNOWN_MODEL, INSTRUCTION_SKIP, CORRUPT_REG_DEF };
+
+// The fault record flags.
+constexpr uint8_t HAS_BREAKPOINT = 1;
+constexpr uint8_t EXECUTED = 2;
+
+// The number of records read or written at once.
+constexpr size_t RECORDS_CHUNK = 4096;
+
+template <typename Ty> void put(unsigned char *p, Ty v) {
+    for (size_t i = 0; i < sizeof(Ty); i++)
+        p[i] = uint64_t(v) >> (8 * i);
+}
+
+template <typename Ty> Ty get(const unsigned char *p) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof(Ty); i++)
+        v |= uint64_t(p[i]) << (8 * i);
+    return Ty(v);
+}
+
+template <typename Ty> void writeValue(ostream &os, Ty v) {
+    unsigned char buf[sizeof(Ty)];
+    put(buf, v);
+    os.write(reinterpret_cast<const char *>(buf), sizeof(buf));
+}
+
+template <typename Ty> bool readValue(std::istream &is, Ty &v) {
+    unsigned char buf[sizeof(Ty)];
+    if (!is.read(reinterpret_cast<char *>(buf), sizeof(buf)))
+        return false;
+    v = get<Ty>(buf);
+    return true;
+}
+
+// The strings used by the faults (disassembly, register names), which are
+// stored once in the file.
+class StringTable {
+  public:
+    uint32_t add(const string &s) {
+        const auto r = index.emplace(s, uint32_t(strings.size()));
+        if (r.second)
+            strings.push_back(&r.first->first);
+        return r.first->second;
+    }
+
+    void write(ostream &os) const {
+        writeValue(os, uint32_t(strings.size()));
+        for (const string *s : strings) {
+            writeValue(os, uint32_t(s->size()));
+            os.write(s->data(), s->size());
+        }
+    }
+
+  private:
+    std::map<string, uint32_t> index;
+    vector<const string *> strings;
+};
+
+FaultModel getFaultModel(const PAF::FI::FaultModelBase &F) {
+    if (dynamic_cast<const PAF::FI::InstructionSkip *>(&F))
+        return INSTRUCTION_SKIP;
+    if (dynamic_cast<const PAF::FI::CorruptRegDef *>(&F))
+        return CORRUPT_REG_DEF;
+    return UNKNOWN_MODEL;
+}
+
+// Encode variant v of fault F into record buf.
+void encode(unsigned char *buf, const PAF::FI::FaultModelBase &F, unsigned v,
+            StringTable &strings) {
+    uint32_t extra = 0;
+    uint8_t flags = 0;
+    uint8_t pattern[4] = {0, 0, 0, 0};
+    if (const auto *IS = dynamic_cast<const PAF::FI::InstructionSkip *>(&F)) {
+        extra = IS->getFaultedInstr();
+        if (IS->isExecuted())
+            flags |= EXECUTED;
+    } else if (const auto *CRD =
+                   dynamic_cast<const PAF::FI::CorruptRegDef *>(&F)) {
+        extra = strings.add(CRD->getFaultedReg());
+        pattern[0] = uint8_t(CRD->getPattern());
+        pattern[1] = CRD->getRegWidth();
+        pattern[2] = CRD->getNumBits();
+        pattern[3] = CRD->getVariant(v);
+    }
+    const PAF::FI::BreakPoint *BP = F.getBreakpoint();
+    if (BP)
+        flags |= HAS_BREAKPOINT;
+
+    std::memset(buf, 0, BinaryCampaignReader::RECORD_SIZE);
+    put<uint64_t>(buf, F.getId() + v);
+    put<uint64_t>(buf + 8, F.getTime());
+    put<uint64_t>(buf + 16, F.getAddress());
+    put<uint64_t>(buf + 24, F.getWeight());
+    put<uint64_t>(buf + 32, BP ? BP->address : 0);
+    put<uint32_t>(buf + 40, F.getInstruction());
+    put<uint32_t>(buf + 44, BP ? BP->count : 0);
+    put<uint32_t>(buf + 48, strings.add(F.getDisassembly()));
+    put<uint32_t>(buf + 52, extra);
+    put<uint16_t>(buf + 56, F.getWidth());
+    buf[58] = flags;
+    buf[59] = uint8_t(F.getEffect());
+    std::memcpy(buf + 60, pattern, sizeof(pattern));
+}
+
+// Pad os with zeros up to a multiple of 8 bytes, assuming it is at offset.
+uint64_t align(ostream &os, uint64_t offset) {
+    for (; offset % 8 != 0; offset++)
+        os.put(0);
+    return offset;
+}
+} // namespace
+
+namespace PAF::FI {
+
+void InjectionCampaign::dumpBinary(ostream &os, const Shard &S) const {
+    std::ostringstream metadata;
+    dumpHeader(metadata);
+    const string md = metadata.str();
+
+    // The strings have to be collected before the records can be written.
+    StringTable strings;
+    unsigned char record[BinaryCampaignReader::RECORD_SIZE];
+    forEachFault(S, [&](const FaultModelBase &F, unsigned v) {
+        encode(record, F, v, strings);
+    });
+    std::ostringstream table;
+    strings.write(table);
+    const string st = table.str();
+
+    vector<uint64_t> cuts;
+    for (const size_t c : getInjectionRangeCuts())
+        if (c > S.begin && c < S.end)
+            cuts.push_back(c - S.begin);
+
+    const uint64_t metadataOffset = BinaryCampaignReader::HEADER_SIZE;
+    const uint64_t stringsOffset = metadataOffset + md.size();
+    const uint64_t cutsOffset = stringsOffset + st.size();
+    const uint64_t cutsEnd = cutsOffset + 8 * (cuts.size() + 1);
+    const uint64_t recordsOffset = (cutsEnd + 7) & ~uint64_t(7);
+
+    // The keys, if any, follow the records.
+    bool keyed = false;
+    forEachFault(S, [&](const FaultModelBase &F, unsigned v) {
+        keyed |= F.getKey(v) != 0;
+    });
+    const uint64_t keysOffset =
+        keyed ? recordsOffset + S.size() * BinaryCampaignReader::RECORD_SIZE
+              : 0;
+
+    os.write(BinaryCampaignReader::MAGIC, sizeof(BinaryCampaignReader::MAGIC));
+    writeValue(os, BinaryCampaignReader::VERSION);
+    const FaultModel model =
+        faults.empty() ? UNKNOWN_MODEL : getFaultModel(*faults[0]);
+    writeValue(os, uint32_t(model));
+    writeValue(os, uint64_t(S.size()));
+    writeValue(os, metadataOffset);
+    writeValue(os, uint64_t(md.size()));
+    writeValue(os, stringsOffset);
+    writeValue(os, recordsOffset);
+    writeValue(os, keysOffset);
+    os << md << st;
+    writeValue(os, uint64_t(cuts.size()));
+    for (const uint64_t c : cuts)
+        writeValue(os, c);
+    align(os, cutsEnd);
+
+    const size_t chunkSize = RECORDS_CHUNK * BinaryCampaignReader::RECORD_SIZE;
+    vector<unsigned char> buf;
+    buf.reserve(chunkSize);
+    forEachFault(S, [&](const FaultModelBase &F, unsigned v) {
+        buf.resize(buf.size() + BinaryCampaignReader::RECORD_SIZE);
+        encode(&buf[buf.size() - BinaryCampaignReader::RECORD_SIZE], F, v,
+               strings);
+        if (buf.size() == chunkSize) {
+            os.write(reinterpret_cast<const char *>(buf.data()), buf.size());
+            buf.clear();
+        }
+    });
+    os.write(reinterpret_cast<const char *>(buf.data()), buf.size());
+
+    if (keyed)
+        forEachFault(S, [&](const FaultModelBase &F, unsigned v) {
+            writeValue(os, F.getKey(v));
+        });
+}
+
+constexpr char BinaryCampaignReader::MAGIC[8];
+
+BinaryCampaignReader::BinaryCampaignReader(const string &filename)
+    : file(filename, std::ios::binary) {
+    if (!file) {
+        errstr = "error opening the campaign file";
+        return;
+    }
+
+    char magic[sizeof(MAGIC)];
+    uint32_t version;
+    uint64_t metadataOffset, metadataSize, stringsOffset;
+    if (!file.read(magic, sizeof(magic)) || !readValue(file, version) ||
+        !readValue(file, faultModel) || !readValue(file, numFaults) ||
+        !readValue(file, metadataOffset) || !readValue(file, metadataSize) ||
+        !readValue(file, stringsOffset) || !readValue(file, recordsOffset) ||
+        !readValue(file, keysOffset)) {
+        errstr = "error reading the campaign file header";
+        return;
+    }
+    if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        errstr = "not a binary campaign file";
+        return;
+    }
+    if (version != VERSION) {
+        errstr = "unsupported binary campaign file version";
+        return;
+    }
+
+    file.seekg(0, std::ios::end);
+    const auto fileSize = uint64_t(file.tellg());
+    if (metadataOffset + metadataSize > fileSize || recordsOffset > fileSize ||
+        numFaults > (fileSize - recordsOffset) / RECORD_SIZE ||
+        keysOffset > fileSize || (keysOffset != 0 &&
+                                  numFaults > (fileSize - keysOffset) / 8)) {
+        errstr = "truncated campaign file";
+        return;
+    }
+
+    metadata.resize(metadataSize);
+    file.seekg(metadataOffset);
+    if (!file.read(&metadata[0], metadata.size())) {
+        errstr = "error reading the campaign metadata";
+        return;
+    }
+
+    file.seekg(stringsOffset);
+    uint32_t numStrings;
+    if (!readValue(file, numStrings)) {
+        errstr = "error reading the campaign string table";
+        return;
+    }
+    for (uint32_t s = 0; s < numStrings; s++) {
+        uint32_t length;
+        if (!readValue(file, length) || length > fileSize) {
+            errstr = "error reading the campaign string table";
+            return;
+        }
+        string str(length, '\0');
+        if (!file.read(&str[0], length)) {
+            errstr = "error reading the campaign string table";
+            return;
+        }
+        strings.emplace_back(std::move(str));
+    }
+
+    uint64_t numCuts;
+    if (!readValue(file, numCuts) || numCuts > numFaults) {
+        errstr = "error reading the campaign shard cuts";
+        return;
+    }
+    cuts.resize(numCuts);
+    for (auto &c : cuts) {
+        uint64_t v;
+        if (!readValue(file, v) || v > numFaults) {
+            errstr = "error reading the campaign shard cuts";
+            return;
+        }
+        c = v;
+    }
+}
+
+bool BinaryCampaignReader::isBinaryCampaign(const string &filename) {
+    std::ifstream ifs(filename, std::ios::binary);
+    char magic[sizeof(MAGIC)];
+    return ifs.read(magic, sizeof(magic)) &&
+           std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+const char *BinaryCampaignReader::getFaultModelName() const {
+    switch (faultModel) {
+    case INSTRUCTION_SKIP:
+        return "InstructionSkip";
+    case CORRUPT_REG_DEF:
+        return "CorruptRegDef";
+    default:
+        return "unknown";
+    }
+}
+
+vector<InjectionCampaign::Shard>
+BinaryCampaignReader::getShards(unsigned K,
+                                InjectionCampaign::ShardBy By) const {
+    return InjectionCampaign::getShards(
+        numFaults, K,
+        By == InjectionCampaign::ShardBy::FAULT_ID ? nullptr : &cuts);
+}
+
+bool BinaryCampaignReader::read(const InjectionCampaign::Shard &S,
+                                vector<unique_ptr<FaultModelBase>> &faults) {
+    if (!good())
+        return false;
+    if (S.begin > S.end || S.end > numFaults) {
+        errstr = "out of bounds fault shard";
+        return false;
+    }
+
+    vector<unsigned char> buf;
+    file.clear();
+    file.seekg(recordsOffset + S.begin * RECORD_SIZE);
+    const size_t first = faults.size();
+    for (size_t b = S.begin; b < S.end; b += RECORDS_CHUNK) {
+        const size_t n = std::min(RECORDS_CHUNK, S.end - b);
+        buf.resize(n * RECORD_SIZE);
+        if (!file.read(reinterpret_cast<char *>(buf.data()), buf.size())) {
+            errstr = "error reading the fault records";
+            return false;
+        }
+        for (size_t i = 0; i < n; i++) {
+            unique_ptr<FaultModelBase> F = decode(&buf[i * RECORD_SIZE]);
+            if (!F)
+                return false;
+            faults.emplace_back(std::move(F));
+        }
+    }
+
+    if (keysOffset == 0)
+        return true;
+    buf.resize(8 * S.size());
+    file.seekg(keysOffset + 8 * S.begin);
+    if (!file.read(reinterpret_cast<char *>(buf.data()), buf.size())) {
+        errstr = "error reading the fault keys";
+        return false;
+    }
+    for (size_t i = 0; i < S.size(); i++)
+        faults[first + i]->setKey(get<uint64_t>(&buf[8 * i]));
+    return true;
+}
+
+unique_ptr<FaultModelBase> BinaryCampaignReader::read(size_t i) {
+    vector<unique_ptr<FaultModelBase>> faults;
+    if (!read({i, i + 1}, faults))
+        return nullptr;
+    return std::move(faults[0]);
+}
+
+unique_ptr<FaultModelBase>
+BinaryCampaignReader::decode(const unsigned char *buf) {
+    const uint32_t disassembly = get<uint32_t>(buf + 48);
+    const uint32_t extra = get<uint32_t>(buf + 52);
+    const uint8_t flags = buf[58];
+    const uint8_t effect = buf[59];
+    if (effect > uint8_t(FaultModelBase::Effect::UNDECIDED)) {
+        errstr = "unsupported fault effect in fault record";
+        return nullptr;
+    }
+    if (disassembly >= strings.size() ||
+        (faultModel == CORRUPT_REG_DEF && extra >= strings.size())) {
+        errstr = "corrupted string index in fault record";
+        return nullptr;
+    }
+
+    unique_ptr<FaultModelBase> F;
+    const auto time = get<uint64_t>(buf + 8);
+    const auto address = get<uint64_t>(buf + 16);
+    const auto instruction = get<uint32_t>(buf + 40);
+    const auto width = get<uint16_t>(buf + 56);
+    switch (faultModel) {
+    case INSTRUCTION_SKIP:
+        F = std::make_unique<InstructionSkip>(time, address, instruction, extra,
+                                              width, (flags & EXECUTED) != 0,
+                                              strings[disassembly]);
+        break;
+    case CORRUPT_REG_DEF: {
+        auto CRD = std::make_unique<CorruptRegDef>(
+            time, address, instruction, width, strings[disassembly],
+            strings[extra]);
+        const auto pattern = CorruptRegDef::Pattern(buf[60]);
+        if (pattern > CorruptRegDef::Pattern::RANDOM_BITS) {
+            errstr = "unsupported corruption pattern in fault record";
+            return nullptr;
+        }
+        if (pattern != CorruptRegDef::Pattern::VALUE) {
+            const unsigned variant = buf[63];
+            CRD->setPattern(pattern, buf[61], buf[62], variant + 1);
+            if (variant >= CRD->getNumVariants()) {
+                errstr = "corrupted pattern variant in fault record";
+                return nullptr;
+            }
+            CRD->setVariant(variant);
+        }
+        F = std::move(CRD);
+    } break;
+    default:
+        errstr = "unsupported fault model";
+        return nullptr;
+    }
+
+    F->setId(get<uint64_t>(buf));
+    F->setWeight(get<uint64_t>(buf + 24));
+    F->setEffect(FaultModelBase::Effect(effect));
+    if (flags & HAS_BREAKPOINT)
+        F->setBreakpoint(get<uint64_t>(buf + 32), get<uint32_t>(buf + 44));
+    return F;
+}
+
+} // namespace PAF::FI
@@ -20,7 +20,9 @@
 
 #include "PAF/FI/Fault.h"
 #include "PAF/FI/Oracle.h"
+#include "PAF/utils/Stats.h"
 
+#include <algorithm>
 #include <fstream>
 
 using namespace PAF::FI;
@@ -29,6 +31,22 @@ using std::hex;
 using std::ofstream;
 using std::ostream;
 using std::string;
+using std::vector;
+
+namespace {
+// The splitmix64 generator, used for the random corruption patterns: it is
+// trivial to reimplement wherever the patterns have to be regenerated.
+uint64_t splitmix64(uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+uint64_t ones(unsigned width) {
+    return width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+}
+} // namespace
 
 void InjectionRangeInfo::dump(ostream &os) const {
     os << "{ Name: \"" << name << '"';
@@ -48,8 +66,19 @@ void BreakPoint::dump(ostream &os) const {
 
 FaultModelBase::~FaultModelBase() = default;
 
-void FaultModelBase::dump(ostream &os) const {
-    os << "Id: " << id;
+void *FaultModelBase::operator new(size_t size) {
+    void *p = ::operator new(size);
+    PAF::Stats::allocated(size, PAF::Stats::MEM_FI);
+    return p;
+}
+
+void FaultModelBase::operator delete(void *p, size_t size) noexcept {
+    PAF::Stats::released(size, PAF::Stats::MEM_FI);
+    ::operator delete(p);
+}
+
+void FaultModelBase::dump(ostream &os, unsigned v) const {
+    os << "Id: " << id + v;
     os << ", Time: " << time;
     os << ", Address: 0x" << hex << address;
     os << ", Instruction: 0x" << instruction << dec;
@@ -59,11 +88,52 @@ void FaultModelBase::dump(ostream &os) const {
         bpInfo->dump(os);
     }
     os << ", Disassembly: \"" << disassembly << '"';
+    if (weight != 1)
+        os << ", Weight: " << weight;
+    if (effect != Effect::NONE)
+        os << ", Effect: \"" << getEffectName(effect) << '"';
+    if (key != 0)
+        os << ", Key: 0x" << hex << getKey(v) << dec;
 }
 
-void InstructionSkip::dump(ostream &os) const {
+uint64_t FaultModelBase::getKey(unsigned v) const {
+    if (key == 0 || v == 0)
+        return key;
+    // The variants of a family get their own keys, derived from the family's.
+    uint64_t state = key ^ v;
+    const uint64_t k = splitmix64(state);
+    return k != 0 ? k : 1;
+}
+
+const char *FaultModelBase::getEffectName(Effect e) {
+    switch (e) {
+    case Effect::NONE:
+        return nullptr;
+    case Effect::SUCCESS:
+        return "success";
+    case Effect::CRASH:
+        return "crash";
+    case Effect::NOEFFECT:
+        return "noeffect";
+    case Effect::CAUGHT:
+        return "caught";
+    case Effect::UNDECIDED:
+        return "undecided";
+    }
+    return nullptr;
+}
+
+FaultModelBase::Effect FaultModelBase::getEffect(const string &name) {
+    for (const Effect e : {Effect::SUCCESS, Effect::CRASH, Effect::NOEFFECT,
+                           Effect::CAUGHT, Effect::UNDECIDED})
+        if (name == getEffectName(e))
+            return e;
+    return Effect::NONE;
+}
+
+void InstructionSkip::dump(ostream &os, unsigned v) const {
     os << "{ ";
-    this->FaultModelBase::dump(os);
+    this->FaultModelBase::dump(os, v);
     os << ", Executed: " << (executed ? "true" : "false");
     os << ", FaultedInstr: 0x" << hex << faultedInstr << dec;
     os << "}";
@@ -71,16 +141,104 @@ void InstructionSkip::dump(ostream &os) const {
 
 InstructionSkip::~InstructionSkip() = default;
 
-void CorruptRegDef::dump(ostream &os) const {
+CorruptRegDef &CorruptRegDef::setPattern(Pattern P, unsigned RegWidth,
+                                         unsigned NumBits, unsigned Count) {
+    // A family has at least one variant.
+    pattern = P;
+    regWidth = std::clamp(RegWidth, 1U, 64U);
+    numBits = 0;
+    firstVariant = 0;
+    switch (P) {
+    case Pattern::VALUE:
+        regWidth = 0;
+        numVariants = 1;
+        break;
+    case Pattern::BIT_FLIP:
+        numVariants = regWidth;
+        break;
+    case Pattern::BYTE_SET:
+    case Pattern::BYTE_RESET:
+        numVariants = std::max(regWidth / 8, 1U);
+        break;
+    case Pattern::RANDOM_BITS:
+        numBits = std::min(NumBits, regWidth);
+        numVariants = std::clamp(Count, 1U, MAX_VARIANTS);
+        break;
+    }
+    return *this;
+}
+
+void CorruptRegDef::getMasks(unsigned v, uint64_t &andMask,
+                             uint64_t &xorMask) const {
+    const unsigned k = getVariant(v);
+    andMask = ones(regWidth);
+    xorMask = 0;
+    switch (pattern) {
+    case Pattern::VALUE:
+        andMask = 0;
+        break;
+    case Pattern::BIT_FLIP:
+        xorMask = uint64_t(1) << k;
+        break;
+    case Pattern::BYTE_SET:
+        xorMask = uint64_t(0xFF) << (8 * k);
+        andMask &= ~xorMask;
+        break;
+    case Pattern::BYTE_RESET:
+        andMask &= ~(uint64_t(0xFF) << (8 * k));
+        break;
+    case Pattern::RANDOM_BITS: {
+        // Draw bit positions until numBits distinct ones have been picked.
+        uint64_t state = (uint64_t(time) << 8) | k;
+        for (unsigned n = 0; n < numBits;) {
+            const uint64_t bit = uint64_t(1) << (splitmix64(state) % regWidth);
+            if ((xorMask & bit) == 0) {
+                xorMask |= bit;
+                n++;
+            }
+        }
+    } break;
+    }
+}
+
+const char *CorruptRegDef::getPatternName(Pattern P) {
+    switch (P) {
+    case Pattern::VALUE:
+        return "value";
+    case Pattern::BIT_FLIP:
+        return "bitflip";
+    case Pattern::BYTE_SET:
+        return "byteset";
+    case Pattern::BYTE_RESET:
+        return "bytereset";
+    case Pattern::RANDOM_BITS:
+        return "randombits";
+    }
+    return nullptr;
+}
+
+void CorruptRegDef::dump(ostream &os, unsigned v) const {
     os << "{ ";
-    this->FaultModelBase::dump(os);
+    this->FaultModelBase::dump(os, v);
     os << ", FaultedReg: \"" << faultedReg << '"';
+    if (pattern != Pattern::VALUE) {
+        uint64_t andMask;
+        uint64_t xorMask;
+        getMasks(v, andMask, xorMask);
+        os << ", Pattern: \"" << getPatternName(pattern) << '"';
+        os << ", RegWidth: " << regWidth;
+        if (pattern == Pattern::RANDOM_BITS)
+            os << ", NumBits: " << numBits;
+        os << ", Variant: " << getVariant(v);
+        os << ", AndMask: 0x" << hex << andMask;
+        os << ", XorMask: 0x" << xorMask << dec;
+    }
     os << "}";
 }
 
 CorruptRegDef::~CorruptRegDef() = default;
 
-void InjectionCampaign::dump(ostream &os) const {
+void InjectionCampaign::dumpHeader(ostream &os) const {
     os << "Image: \"" << image << "\"\n";
     os << "ReferenceTrace: \"" << referenceTrace << "\"\n";
     os << "MaxTraceTime: " << maxTraceTime << '\n';
@@ -103,22 +261,106 @@ void InjectionCampaign::dump(ostream &os) const {
         for (const Classifier &C : theOracle)
             C.dump(os);
     }
+}
+
+void InjectionCampaign::dump(ostream &os, const Shard &S) const {
+    dumpHeader(os);
     os << "Campaign:\n";
-    dumpCampaign(os);
+    dumpCampaign(os, S);
 }
 
-void InjectionCampaign::dumpToFile(const string &filename) const {
-    ofstream of(filename.c_str(), std::ios_base::out);
-    dump(of);
+bool InjectionCampaign::dumpToFile(const string &filename, Format F,
+                                   const Shard &S) const {
+    ofstream of(filename.c_str(), F == Format::BINARY
+                                      ? std::ios_base::out | std::ios::binary
+                                      : std::ios_base::out);
+    if (F == Format::BINARY)
+        dumpBinary(of, S);
+    else
+        dump(of, S);
     of.close();
+    return bool(of);
 }
 
-void InjectionCampaign::dumpCampaign(std::ostream &os) const {
-    for (const auto &F : faults) {
+void InjectionCampaign::dumpCampaign(std::ostream &os, const Shard &S) const {
+    forEachFault(S, [&os](const FaultModelBase &F, unsigned v) {
         os << "  - ";
-        F->dump(os);
+        F.dump(os, v);
         os << '\n';
+    });
+}
+
+size_t InjectionCampaign::find(size_t i) const {
+    const auto it = std::upper_bound(
+        faults.begin(), faults.end(), i,
+        [](size_t id, const std::unique_ptr<FaultModelBase> &F) {
+            return id < F->getId();
+        });
+    return it - faults.begin() - 1;
+}
+
+size_t InjectionCampaign::getInjectionRange(size_t i) const {
+    const unsigned long t = faults[find(i)]->getTime();
+    for (size_t r = 0; r < injectionRangeInformation.size(); r++)
+        if (injectionRangeInformation[r].contains(t))
+            return r;
+    return -1;
+}
+
+vector<size_t> InjectionCampaign::getInjectionRangeCuts() const {
+    // The faults are planned one injection range after the other, so only
+    // cut where the injection range changes. Consecutive faults are checked
+    // against the range of their predecessor first.
+    // The variants of a fault family are never split.
+    vector<size_t> cuts;
+    size_t range = -1;
+    for (size_t i = 0; i < faults.size(); i++) {
+        const size_t id = faults[i]->getId();
+        const size_t r = range < injectionRangeInformation.size() &&
+                                 injectionRangeInformation[range].contains(
+                                     faults[i]->getTime())
+                             ? range
+                             : getInjectionRange(id);
+        if (i != 0 && r != range)
+            cuts.push_back(id);
+        range = r;
+    }
+    return cuts;
+}
+
+vector<InjectionCampaign::Shard>
+InjectionCampaign::getShards(unsigned K, ShardBy By) const {
+    if (By == ShardBy::FAULT_ID)
+        return getShards(numFaults, K);
+    const vector<size_t> cuts = getInjectionRangeCuts();
+    return getShards(numFaults, K, &cuts);
+}
+
+vector<InjectionCampaign::Shard>
+InjectionCampaign::getShards(size_t numFaults, unsigned K,
+                             const vector<size_t> *cuts) {
+    if (K == 0)
+        return {};
+    vector<Shard> shards;
+    shards.reserve(K);
+    size_t begin = 0;
+    auto it = cuts ? cuts->begin() : vector<size_t>::const_iterator();
+    for (unsigned k = 1; k <= K; k++) {
+        // The ideal end of this shard, which is moved to the closest cut.
+        size_t end = numFaults / K * k + std::min<size_t>(numFaults % K, k);
+        if (cuts && k != K) {
+            while (it != cuts->end() && *it < end)
+                it++;
+            const size_t next = it != cuts->end() ? *it : numFaults;
+            const size_t previous = it != cuts->begin() ? *(it - 1) : 0;
+            end = previous > begin && end - previous <= next - end ? previous
+                                                                    : next;
+        }
+        end = std::max(begin, end);
+        shards.push_back({begin, end});
+        begin = end;
     }
+    return shards;
 }
 
 void InjectionCampaign::dumpFaultModel(std::ostream &os) const {
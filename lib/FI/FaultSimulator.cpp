@@ -0,0 +1,562 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/FI/FaultSimulator.h"
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+using std::string;
+using std::vector;
+
+namespace {
+constexpr unsigned PC = unsigned(PAF::V7MInfo::Register::PC);
+// All status registers are tracked as CPSR.
+constexpr unsigned FLAGS = unsigned(PAF::V7MInfo::Register::CPSR);
+
+constexpr uint32_t N_FLAG = 1U << 31;
+constexpr uint32_t Z_FLAG = 1U << 30;
+constexpr uint32_t C_FLAG = 1U << 29;
+constexpr uint32_t V_FLAG = 1U << 28;
+
+bool isThumb16(const PAF::ReferenceInstruction &I) {
+    return I.iset == THUMB && I.width == 16;
+}
+
+// Is I an IT instruction ? If so, set count to the number of instructions in
+// its block.
+bool isIT(const PAF::ReferenceInstruction &I, unsigned &count) {
+    if (!isThumb16(I) || (I.instruction & 0xFF00) != 0xBF00 ||
+        (I.instruction & 0x0F) == 0)
+        return false;
+    count = 4;
+    for (uint32_t mask = I.instruction & 0x0F; (mask & 1) == 0; mask >>= 1)
+        count--;
+    return true;
+}
+
+// Does condition cond pass with the flags in psr ?
+bool conditionPassed(unsigned cond, uint32_t psr) {
+    const bool N = (psr & N_FLAG) != 0;
+    const bool Z = (psr & Z_FLAG) != 0;
+    const bool C = (psr & C_FLAG) != 0;
+    const bool V = (psr & V_FLAG) != 0;
+    bool passed;
+    switch (cond >> 1) {
+    case 0:
+        passed = Z;
+        break;
+    case 1:
+        passed = C;
+        break;
+    case 2:
+        passed = N;
+        break;
+    case 3:
+        passed = V;
+        break;
+    case 4:
+        passed = C && !Z;
+        break;
+    case 5:
+        passed = N == V;
+        break;
+    case 6:
+        passed = N == V && !Z;
+        break;
+    default:
+        return true;
+    }
+    return (cond & 1) != 0 ? !passed : passed;
+}
+
+// The outputs of an emulated instruction.
+class Outputs {
+  public:
+    explicit Outputs(uint32_t psr) : psr(psr) {}
+
+    void set(unsigned r, uint32_t value) { regs.emplace_back(r, value); }
+
+    // Set the N and Z flags from value, and return it.
+    uint32_t setNZ(uint32_t value) {
+        setFlag(N_FLAG, (value & N_FLAG) != 0);
+        setFlag(Z_FLAG, value == 0);
+        return value;
+    }
+
+    void setFlag(uint32_t flag, bool value) {
+        psr = value ? psr | flag : psr & ~flag;
+        flagsWritten = true;
+    }
+
+    // Compute x + y + carry, setting all flags.
+    uint32_t addWithCarry(uint32_t x, uint32_t y, bool carry) {
+        const uint64_t usum = uint64_t(x) + y + carry;
+        const int64_t ssum = int64_t(int32_t(x)) + int32_t(y) + carry;
+        const uint32_t result = uint32_t(usum);
+        setFlag(C_FLAG, uint64_t(result) != usum);
+        setFlag(V_FLAG, int64_t(int32_t(result)) != ssum);
+        return setNZ(result);
+    }
+
+    [[nodiscard]] bool carry() const { return (psr & C_FLAG) != 0; }
+
+    // Get all registers written.
+    [[nodiscard]] vector<std::pair<unsigned, uint32_t>> get() const {
+        vector<std::pair<unsigned, uint32_t>> all(regs);
+        if (flagsWritten)
+            all.emplace_back(FLAGS, psr);
+        return all;
+    }
+
+  private:
+    vector<std::pair<unsigned, uint32_t>> regs;
+    uint32_t psr;
+    bool flagsWritten = false;
+};
+} // namespace
+
+namespace PAF::FI {
+
+FaultSimulator::FaultSimulator(const ArchInfo &CPU, unsigned Window)
+    : cpu(CPU), instrInfos(CPU), window(Window), regs(CPU.numRegisters()),
+      known(CPU.numRegisters(), false) {}
+
+bool FaultSimulator::isSupported(const ArchInfo &CPU) {
+    return dynamic_cast<const V7MInfo *>(&CPU) != nullptr;
+}
+
+void FaultSimulator::reset() {
+    flush();
+    std::fill(known.begin(), known.end(), false);
+    itRemaining = 0;
+}
+
+void FaultSimulator::setRegister(unsigned r, uint64_t value) {
+    if (r >= regs.size())
+        return;
+    if (cpu.isStatusRegister(r))
+        r = FLAGS;
+    regs[r] = value;
+    known[r] = true;
+}
+
+unsigned FaultSimulator::registerId(const RegisterAccess &Reg) const {
+    const unsigned r = Reg.id != RegisterAccess::UNKNOWN_ID
+                           ? Reg.id
+                           : cpu.findRegisterId(Reg.name);
+    if (r != RegisterAccess::UNKNOWN_ID && cpu.isStatusRegister(r))
+        return FLAGS;
+    return r;
+}
+
+bool FaultSimulator::get(const Simulation &S, unsigned r,
+                         uint32_t &value) const {
+    const auto it = S.diff.find(r);
+    if (it != S.diff.end()) {
+        value = it->second;
+        return true;
+    }
+    if (r >= known.size() || !known[r])
+        return false;
+    value = regs[r];
+    return true;
+}
+
+void FaultSimulator::start(Simulation &&S) {
+    if (S.diff.empty()) {
+        S.fault->setEffect(FaultModelBase::Effect::NOEFFECT);
+        numClassified++;
+    } else
+        starting.emplace_back(std::move(S));
+}
+
+void FaultSimulator::skip(FaultModelBase &F, const ReferenceInstruction &I) {
+    // Skipping an instruction which was not executed has no effect.
+    Simulation S{&F, {}, window};
+    if (!I.executed()) {
+        start(std::move(S));
+        return;
+    }
+
+    // Skipping a branch makes the control flow diverge, skipping a store
+    // makes the memory diverge and skipping an IT instruction changes the
+    // instructions executed in its block.
+    unsigned count;
+    const InstrInfo &II = instrInfos.get(I);
+    bool handOver = II.isBranch() || II.isCall() || cpu.isBranch(I) ||
+                    isIT(I, count);
+    for (const auto &M : I.memAccess)
+        handOver |= M.access == MemoryAccess::Type::WRITE;
+
+    // The registers I writes keep their previous value.
+    for (const auto &Reg : I.regAccess) {
+        if (handOver || Reg.access != RegisterAccess::Type::WRITE)
+            continue;
+        const unsigned r = registerId(Reg);
+        if (r >= regs.size() || r == PC || !known[r])
+            handOver = true;
+        else if (regs[r] != uint32_t(Reg.value))
+            S.diff[r] = regs[r];
+    }
+
+    if (handOver)
+        numHandedOver++;
+    else
+        start(std::move(S));
+}
+
+void FaultSimulator::corrupt(FaultModelBase &F, const ReferenceInstruction &I,
+                             unsigned r, uint64_t value) {
+    // The status registers are faulted with a specific semantic by the
+    // fault injection scripts, which is left to them.
+    if (r >= regs.size() || r == PC || cpu.isStatusRegister(r)) {
+        numHandedOver++;
+        return;
+    }
+
+    bool isKnown = known[r];
+    uint32_t reference = regs[r];
+    for (const auto &Reg : I.regAccess)
+        if (Reg.access == RegisterAccess::Type::WRITE && registerId(Reg) == r) {
+            reference = Reg.value;
+            isKnown = true;
+        }
+    if (!isKnown) {
+        numHandedOver++;
+        return;
+    }
+
+    Simulation S{&F, {}, window};
+    if (uint32_t(value) != reference)
+        S.diff[r] = value;
+    start(std::move(S));
+}
+
+void FaultSimulator::getInputs(const ReferenceInstruction &I,
+                               vector<unsigned> &inputs) {
+    inputs.clear();
+    const auto use = [&](unsigned r) {
+        if (r != RegisterAccess::UNKNOWN_ID && cpu.isStatusRegister(r))
+            r = FLAGS;
+        if (std::find(inputs.begin(), inputs.end(), r) == inputs.end())
+            inputs.push_back(r);
+    };
+
+    // An instruction which was not executed only depends on its condition.
+    if (!I.executed()) {
+        use(FLAGS);
+        return;
+    }
+
+    const InstrInfo &II = instrInfos.get(I);
+    for (const bool implicit : {false, true})
+        for (const unsigned r : II.getUniqueInputRegisters(implicit))
+            use(r);
+    // The branches and the instructions in an IT block may be conditional,
+    // and the flag setting instructions leave some of the flags unchanged.
+    if (itRemaining > 0 || II.isBranch())
+        use(FLAGS);
+    vector<unsigned> defs;
+    for (const auto &Reg : I.regAccess)
+        if (Reg.access == RegisterAccess::Type::WRITE) {
+            defs.push_back(registerId(Reg));
+            if (defs.back() == FLAGS)
+                use(FLAGS);
+        }
+
+    // The registers named in the disassembly, but not defined by I, are
+    // conservatively considered as used. Register lists, like {r4-r7}, name
+    // their bounds only.
+    unsigned previous = RegisterAccess::UNKNOWN_ID;
+    bool range = false;
+    const string &D = I.disassembly;
+    for (size_t b = 0; b < D.size();) {
+        size_t e = b;
+        while (e < D.size() && std::isalnum((unsigned char)D[e]))
+            e++;
+        if (e == b) {
+            range = D[b] == '-' && previous != RegisterAccess::UNKNOWN_ID;
+            b++;
+            continue;
+        }
+        const unsigned r = cpu.findRegisterId(D.substr(b, e - b));
+        if (r != RegisterAccess::UNKNOWN_ID) {
+            for (unsigned i = range ? previous + 1 : r; i <= r; i++)
+                if (std::find(defs.begin(), defs.end(), i) == defs.end())
+                    use(i);
+            previous = r;
+        } else
+            previous = RegisterAccess::UNKNOWN_ID;
+        range = false;
+        b = e;
+    }
+}
+
+bool FaultSimulator::emulate(Simulation &S,
+                             const ReferenceInstruction &I) const {
+    // Only the 16-bit Thumb instructions are supported. The ones in an IT
+    // block do not set the flags, and may not be executed.
+    if (!isThumb16(I) || itRemaining > 0)
+        return false;
+
+    // Only the conditional branches are expected not to be executed.
+    const uint32_t opcode = I.instruction & 0xFFFF;
+    const bool isBcc =
+        (opcode >> 12) == 0x0D && ((opcode >> 8) & 0x0F) < 0x0E;
+    if (!I.executed() && !isBcc)
+        return false;
+    const unsigned Rd = opcode & 0x07;
+    const unsigned Rm = (opcode >> 3) & 0x07;
+    uint32_t psr;
+    if (!get(S, FLAGS, psr))
+        return false;
+    Outputs O(psr);
+    uint32_t x = 0;
+    uint32_t y = 0;
+
+    if ((opcode >> 13) == 0 && (opcode >> 11) != 0x03) {
+        // LSL, LSR, ASR (immediate).
+        const unsigned imm5 = (opcode >> 6) & 0x1F;
+        const unsigned n = imm5 == 0 ? 32 : imm5;
+        if (!get(S, Rm, x))
+            return false;
+        uint32_t result = x;
+        switch (opcode >> 11) {
+        case 0:
+            if (imm5 != 0) {
+                O.setFlag(C_FLAG, ((x >> (32 - imm5)) & 1) != 0);
+                result = x << imm5;
+            }
+            break;
+        case 1:
+            O.setFlag(C_FLAG, ((x >> (n - 1)) & 1) != 0);
+            result = n == 32 ? 0 : x >> n;
+            break;
+        default:
+            O.setFlag(C_FLAG, ((x >> (n - 1)) & 1) != 0);
+            result = uint32_t(int32_t(x) >> std::min(n, 31U));
+            break;
+        }
+        O.set(Rd, O.setNZ(result));
+    } else if ((opcode >> 11) == 0x03) {
+        // ADD, SUB (register or 3-bit immediate).
+        const unsigned op = (opcode >> 6) & 0x07;
+        if (!get(S, Rm, x))
+            return false;
+        if ((opcode & (1 << 10)) != 0)
+            y = op;
+        else if (!get(S, op, y))
+            return false;
+        const bool sub = (opcode & (1 << 9)) != 0;
+        O.set(Rd, O.addWithCarry(x, sub ? ~y : y, sub));
+    } else if ((opcode >> 13) == 0x01) {
+        // MOV, CMP, ADD, SUB (8-bit immediate).
+        const unsigned Rdn = (opcode >> 8) & 0x07;
+        const unsigned op = (opcode >> 11) & 0x03;
+        y = opcode & 0xFF;
+        if (op != 0 && !get(S, Rdn, x))
+            return false;
+        switch (op) {
+        case 0:
+            O.set(Rdn, O.setNZ(y));
+            break;
+        case 1:
+            O.addWithCarry(x, ~y, true);
+            break;
+        case 2:
+            O.set(Rdn, O.addWithCarry(x, y, false));
+            break;
+        default:
+            O.set(Rdn, O.addWithCarry(x, ~y, true));
+            break;
+        }
+    } else if ((opcode >> 10) == 0x10) {
+        // Data processing (register).
+        const unsigned op = (opcode >> 6) & 0x0F;
+        if (!get(S, Rm, y) ||
+            (op != /* RSB */ 0x09 && op != /* MVN */ 0x0F && !get(S, Rd, x)))
+            return false;
+        switch (op) {
+        case /* AND */ 0x00:
+            O.set(Rd, O.setNZ(x & y));
+            break;
+        case /* EOR */ 0x01:
+            O.set(Rd, O.setNZ(x ^ y));
+            break;
+        case /* ADC */ 0x05:
+            O.set(Rd, O.addWithCarry(x, y, O.carry()));
+            break;
+        case /* SBC */ 0x06:
+            O.set(Rd, O.addWithCarry(x, ~y, O.carry()));
+            break;
+        case /* TST */ 0x08:
+            O.setNZ(x & y);
+            break;
+        case /* RSB */ 0x09:
+            O.set(Rd, O.addWithCarry(~y, 0, true));
+            break;
+        case /* CMP */ 0x0A:
+            O.addWithCarry(x, ~y, true);
+            break;
+        case /* CMN */ 0x0B:
+            O.addWithCarry(x, y, false);
+            break;
+        case /* ORR */ 0x0C:
+            O.set(Rd, O.setNZ(x | y));
+            break;
+        case /* MUL */ 0x0D:
+            O.set(Rd, O.setNZ(x * y));
+            break;
+        case /* BIC */ 0x0E:
+            O.set(Rd, O.setNZ(x & ~y));
+            break;
+        case /* MVN */ 0x0F:
+            O.set(Rd, O.setNZ(~y));
+            break;
+        default:
+            // The shifts by register are not supported.
+            return false;
+        }
+    } else if ((opcode >> 10) == 0x11 && ((opcode >> 8) & 0x03) != 0x03) {
+        // ADD, CMP, MOV (high registers), as long as they do not use the PC.
+        const unsigned Rdn = ((opcode >> 4) & 0x08) | Rd;
+        const unsigned Rm4 = (opcode >> 3) & 0x0F;
+        const unsigned op = (opcode >> 8) & 0x03;
+        if (Rdn == PC || Rm4 == PC || !get(S, Rm4, y) ||
+            (op != 2 && !get(S, Rdn, x)))
+            return false;
+        switch (op) {
+        case 0:
+            O.set(Rdn, x + y);
+            break;
+        case 1:
+            O.addWithCarry(x, ~y, true);
+            break;
+        default:
+            O.set(Rdn, y);
+            break;
+        }
+    } else if (isBcc) {
+        // Conditional branch: the faulted execution has to follow the
+        // reference path.
+        if (conditionPassed((opcode >> 8) & 0x0F, psr) != I.executed())
+            return false;
+    } else
+        return false;
+
+    // Update the difference with the faulted outputs, and with the registers
+    // only the reference execution writes.
+    vector<std::pair<unsigned, uint32_t>> faulted = O.get();
+    vector<std::pair<unsigned, uint32_t>> reference;
+    for (const auto &Reg : I.regAccess)
+        if (Reg.access == RegisterAccess::Type::WRITE) {
+            const unsigned r = registerId(Reg);
+            if (r >= regs.size())
+                return false;
+            reference.emplace_back(r, Reg.value);
+            const auto isR = [r](const std::pair<unsigned, uint32_t> &o) {
+                return o.first == r;
+            };
+            if (std::none_of(faulted.begin(), faulted.end(), isR)) {
+                uint32_t v;
+                if (!get(S, r, v))
+                    return false;
+                faulted.emplace_back(r, v);
+            }
+        }
+    for (const auto &[r, v] : faulted) {
+        if (r == PC)
+            return false;
+        bool isKnown = known[r];
+        uint32_t ref = regs[r];
+        for (const auto &w : reference)
+            if (w.first == r) {
+                ref = w.second;
+                isKnown = true;
+            }
+        if (!isKnown)
+            return false;
+        if (v == ref)
+            S.diff.erase(r);
+        else
+            S.diff[r] = v;
+    }
+    return true;
+}
+
+void FaultSimulator::step(const ReferenceInstruction &I) {
+    if (!active.empty()) {
+        vector<unsigned> inputs;
+        getInputs(I, inputs);
+        size_t kept = 0;
+        for (auto &S : active) {
+            const auto inDiff = [&S](unsigned r) { return S.diff.count(r); };
+            bool ok = true;
+            if (std::any_of(inputs.begin(), inputs.end(), inDiff))
+                ok = emulate(S, I);
+            else
+                // I behaves as in the reference execution.
+                for (const auto &Reg : I.regAccess)
+                    if (Reg.access == RegisterAccess::Type::WRITE)
+                        S.diff.erase(registerId(Reg));
+
+            if (ok && S.diff.empty()) {
+                S.fault->setEffect(FaultModelBase::Effect::NOEFFECT);
+                numClassified++;
+            } else if (!ok || --S.remaining == 0)
+                numHandedOver++;
+            else {
+                if (&active[kept] != &S)
+                    active[kept] = std::move(S);
+                kept++;
+            }
+        }
+        active.resize(kept);
+    }
+
+    // Update the reference state.
+    for (const auto &Reg : I.regAccess)
+        if (Reg.access == RegisterAccess::Type::WRITE) {
+            const unsigned r = registerId(Reg);
+            if (r < regs.size()) {
+                regs[r] = Reg.value;
+                known[r] = true;
+            }
+        }
+    unsigned count;
+    if (isIT(I, count))
+        itRemaining = count;
+    else if (itRemaining > 0)
+        itRemaining--;
+
+    for (auto &S : starting)
+        active.emplace_back(std::move(S));
+    starting.clear();
+}
+
+void FaultSimulator::flush() {
+    numHandedOver += active.size() + starting.size();
+    active.clear();
+    starting.clear();
+}
+
+} // namespace PAF::FI
@@ -0,0 +1,277 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/FI/Results.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+using std::string;
+using std::vector;
+
+namespace {
+// The number of records read at once from the binary campaign files.
+constexpr size_t RECORDS_CHUNK = 4096;
+
+// Does line start with prefix ?
+bool startsWith(const string &line, const char *prefix) {
+    return line.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+// Get the number following the first occurence of key in line, if any.
+bool getField(const string &line, const char *key, uint64_t &v) {
+    const size_t p = line.find(key);
+    if (p == string::npos)
+        return false;
+    const char *s = line.c_str() + p + std::strlen(key);
+    char *e;
+    v = std::strtoull(s, &e, 0);
+    return e != s;
+}
+
+// Get the quoted string following the first occurence of key in line, if
+// any.
+bool getField(const string &line, const char *key, string &v) {
+    const size_t p = line.find(key);
+    if (p == string::npos)
+        return false;
+    const size_t b = p + std::strlen(key);
+    const size_t e = line.find('"', b);
+    if (e == string::npos)
+        return false;
+    v = line.substr(b, e - b);
+    return true;
+}
+} // namespace
+
+namespace PAF::FI {
+
+CampaignResultsReader::CampaignResultsReader(const string &filename) {
+    if (BinaryCampaignReader::isBinaryCampaign(filename)) {
+        binary = std::make_unique<BinaryCampaignReader>(filename);
+        if (!binary->good()) {
+            errstr = binary->error();
+            return;
+        }
+        std::istringstream is(binary->getMetadata());
+        parseMetadata(is);
+        return;
+    }
+
+    text.open(filename);
+    if (!text) {
+        errstr = "error opening the campaign file";
+        return;
+    }
+    parseMetadata(text);
+}
+
+void CampaignResultsReader::parseMetadata(std::istream &is) {
+    string line;
+    bool inRanges = false;
+    while (std::getline(is, line)) {
+        if (startsWith(line, "Campaign:"))
+            return;
+        if (!startsWith(line, "  - {")) {
+            inRanges = startsWith(line, "InjectionRangeInfo:");
+            continue;
+        }
+        if (!inRanges)
+            continue;
+        string name;
+        uint64_t startTime, endTime, startAddress, endAddress;
+        if (!getField(line, "Name: \"", name) ||
+            !getField(line, "StartTime: ", startTime) ||
+            !getField(line, "EndTime: ", endTime) ||
+            !getField(line, "StartAddress: ", startAddress) ||
+            !getField(line, "EndAddress: ", endAddress)) {
+            errstr = "malformed injection range in campaign file";
+            return;
+        }
+        ranges.emplace_back(name, startTime, endTime, startAddress,
+                            endAddress);
+    }
+}
+
+bool CampaignResultsReader::next(Result &R) {
+    if (!good())
+        return false;
+
+    if (binary) {
+        if (nextFault == faults.size()) {
+            if (nextRecord == binary->size())
+                return false;
+            faults.clear();
+            nextFault = 0;
+            const size_t end =
+                std::min(nextRecord + RECORDS_CHUNK, binary->size());
+            if (!binary->read({nextRecord, end}, faults)) {
+                errstr = binary->error();
+                return false;
+            }
+            nextRecord = end;
+        }
+        const FaultModelBase &F = *faults[nextFault++];
+        R = {F.getId(),     F.getTime(), F.getAddress(),
+             F.getWeight(), F.getKey(),  F.getEffect()};
+        return true;
+    }
+
+    string line;
+    if (!std::getline(text, line)) {
+        if (text.bad())
+            errstr = "error reading the campaign file";
+        return false;
+    }
+    // The faults are the last entry of the campaign files.
+    if (!startsWith(line, "  - {"))
+        return false;
+    uint64_t time;
+    if (!getField(line, "{ Id: ", R.id) || !getField(line, ", Time: ", time) ||
+        !getField(line, ", Address: ", R.address)) {
+        errstr = "malformed fault in campaign file";
+        return false;
+    }
+    R.time = time;
+    uint64_t weight;
+    R.weight = getField(line, ", Weight: ", weight) ? weight : 1;
+    if (!getField(line, ", Key: ", R.key))
+        R.key = 0;
+    string effect;
+    R.effect = FaultModelBase::Effect::NONE;
+    if (getField(line, ", Effect: \"", effect)) {
+        R.effect = FaultModelBase::getEffect(effect);
+        if (R.effect == FaultModelBase::Effect::NONE) {
+            errstr = "unsupported fault effect in campaign file";
+            return false;
+        }
+    }
+    return true;
+}
+
+CampaignResults::CampaignResults(const string &filename) {
+    CampaignResultsReader CRR(filename);
+    CampaignResultsReader::Result R;
+    while (CRR.next(R))
+        add(R.key, R.effect);
+    errstr = CRR.error();
+}
+
+void CampaignResults::add(uint64_t key, FaultModelBase::Effect e) {
+    if (key == 0 || e == FaultModelBase::Effect::NONE)
+        return;
+    // Faults sharing a key, but not their effect, can not be trusted.
+    const auto r = effects.emplace(key, e);
+    if (!r.second && r.first->second != e)
+        r.first->second = FaultModelBase::Effect::NONE;
+}
+
+uint64_t ResultsIndex::Counts::total() const {
+    uint64_t t = 0;
+    for (const uint64_t c : byEffect)
+        t += c;
+    return t;
+}
+
+bool ResultsIndex::add(const string &filename, string &error) {
+    CampaignResultsReader CRR(filename);
+    if (!CRR.good()) {
+        error = CRR.error();
+        return false;
+    }
+
+    // The shards of a campaign share their injection ranges. Sort this
+    // campaign's ranges by start time, for looking them up.
+    vector<std::pair<unsigned long, size_t>> starts;
+    for (const InjectionRangeInfo &IRI : CRR.getInjectionRanges()) {
+        size_t r = 0;
+        while (r < ranges.size() &&
+               (ranges[r].getName() != IRI.getName() ||
+                ranges[r].getStartTime() != IRI.getStartTime() ||
+                ranges[r].getEndTime() != IRI.getEndTime()))
+            r++;
+        if (r == ranges.size()) {
+            ranges.push_back(IRI);
+            rangeCounts.emplace_back();
+        }
+        starts.emplace_back(IRI.getStartTime(), r);
+    }
+    std::sort(starts.begin(), starts.end());
+
+    CampaignResultsReader::Result R;
+    while (CRR.next(R)) {
+        // Use the innermost range, i.e. the one starting last, containing
+        // the fault.
+        auto it = std::upper_bound(
+            starts.begin(), starts.end(),
+            std::make_pair(R.time, size_t(NO_RANGE)));
+        size_t range = NO_RANGE;
+        while (it != starts.begin()) {
+            --it;
+            if (ranges[it->second].contains(R.time)) {
+                range = it->second;
+                break;
+            }
+        }
+        add(R, range);
+    }
+    if (!CRR.good()) {
+        error = CRR.error();
+        return false;
+    }
+    return true;
+}
+
+void ResultsIndex::add(const CampaignResultsReader::Result &R, size_t range) {
+    numResults++;
+    total.add(R.effect, R.weight);
+    if (R.id >= byId.size())
+        byId.resize(R.id + 1, ABSENT);
+    byId[R.id] = uint8_t(R.effect);
+    addresses[R.address].add(R.effect, R.weight);
+    if (range == NO_RANGE)
+        outside.add(R.effect, R.weight);
+    else
+        rangeCounts[range].add(R.effect, R.weight);
+    rangeAddresses[std::make_pair(range, R.address)].add(R.effect, R.weight);
+}
+
+vector<uint64_t> ResultsIndex::getIds(FaultModelBase::Effect e) const {
+    vector<uint64_t> ids;
+    for (size_t i = 0; i < byId.size(); i++)
+        if (byId[i] == uint8_t(e))
+            ids.push_back(i);
+    return ids;
+}
+
+std::map<string, ResultsIndex::Counts> ResultsIndex::byFunction() const {
+    std::map<string, Counts> functions;
+    for (size_t r = 0; r < ranges.size(); r++) {
+        const string &name = ranges[r].getName();
+        Counts &C = functions[name.substr(0, name.find('@'))];
+        for (size_t e = 0; e < NUM_EFFECTS; e++)
+            C.byEffect[e] += rangeCounts[r].byEffect[e];
+    }
+    return functions;
+}
+
+} // namespace PAF::FI
@@ -0,0 +1,259 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/AnalysisCache.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using std::ifstream;
+using std::istringstream;
+using std::ofstream;
+using std::string;
+using std::vector;
+
+namespace {
+// The cache file header.
+constexpr const char MAGIC[] = "PAF-ANALYSIS-CACHE";
+constexpr unsigned VERSION = 1;
+
+// The amount of data hashed at the start and end of the trace.
+constexpr size_t TRACE_CHUNK_SIZE = 64 * 1024;
+
+// A 64-bit FNV-1a hash.
+class FNV1a {
+  public:
+    void add(const void *data, size_t size) {
+        const auto *p = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; i++) {
+            h ^= p[i];
+            h *= 0x100000001b3ULL;
+        }
+    }
+    void add(uint64_t v) { add(&v, sizeof(v)); }
+    [[nodiscard]] uint64_t get() const { return h; }
+
+  private:
+    uint64_t h = 0xcbf29ce484222325ULL;
+};
+
+// Hash up to size bytes of ifs, starting at offset.
+void hashChunk(FNV1a &H, ifstream &ifs, uint64_t offset, size_t size) {
+    vector<char> buf(size);
+    ifs.clear();
+    ifs.seekg(offset);
+    ifs.read(buf.data(), buf.size());
+    H.add(buf.data(), ifs.gcount());
+}
+
+// Hash file filename's size and modification time, as well as its content
+// if it is smaller than maxContent, or else its head and tail.
+void hashFile(FNV1a &H, const string &filename, uint64_t maxContent) {
+    struct stat st;
+    if (filename.empty() || stat(filename.c_str(), &st) != 0) {
+        H.add(uint64_t(0));
+        return;
+    }
+    const auto size = uint64_t(st.st_size);
+    H.add(size);
+    H.add(uint64_t(st.st_mtime));
+
+    ifstream ifs(filename, ifstream::binary);
+    if (size <= maxContent)
+        hashChunk(H, ifs, 0, size);
+    else {
+        hashChunk(H, ifs, 0, TRACE_CHUNK_SIZE);
+        hashChunk(H, ifs, size - TRACE_CHUNK_SIZE, TRACE_CHUNK_SIZE);
+    }
+}
+
+void write(ofstream &os, const TarmacSite &S) {
+    os << ' ' << S.time << ' ' << S.tarmac_line << ' ' << S.tarmac_pos << ' '
+       << S.addr;
+}
+
+bool read(istringstream &is, TarmacSite &S) {
+    uint64_t time, line, pos, addr;
+    if (!(is >> time >> line >> pos >> addr))
+        return false;
+    S = TarmacSite(addr, time, line, pos);
+    return true;
+}
+
+// Check that line starts with tag, and consume it from is.
+bool expect(istringstream &is, const string &line, const char *tag) {
+    is.clear();
+    is.str(line);
+    string t;
+    return (is >> t) && t == tag;
+}
+} // namespace
+
+namespace PAF {
+
+AnalysisCache::AnalysisCache(const string &filename, uint64_t key)
+    : filename(filename), key(key) {
+    load();
+}
+
+AnalysisCache::AnalysisCache(const TracePair &trace,
+                             const string &image_filename)
+    : AnalysisCache(getCacheFilename(trace),
+                    getKey(trace.tarmac_filename, image_filename)) {}
+
+AnalysisCache::~AnalysisCache() { save(); }
+
+string AnalysisCache::getCacheFilename(const TracePair &trace) {
+    return (trace.index_on_disk ? trace.index_filename
+                                : trace.tarmac_filename) +
+           ".paf-cache";
+}
+
+uint64_t AnalysisCache::getKey(const string &tarmac_filename,
+                               const string &image_filename) {
+    FNV1a H;
+    hashFile(H, tarmac_filename, 2 * TRACE_CHUNK_SIZE);
+    hashFile(H, image_filename, uint64_t(-1));
+    return H.get();
+}
+
+const AnalysisCache::Entry *AnalysisCache::lookup(const string &query) const {
+    const auto it = entries.find(query);
+    return it == entries.end() ? nullptr : &it->second;
+}
+
+void AnalysisCache::insert(const string &query, Entry E) {
+    entries[query] = std::move(E);
+    modified = true;
+}
+
+void AnalysisCache::load() {
+    ifstream ifs(filename);
+    if (!ifs)
+        return; // No cache yet.
+
+    string line;
+    istringstream is;
+    unsigned version;
+    uint64_t fileKey;
+    if (!std::getline(ifs, line) || !expect(is, line, MAGIC) ||
+        !(is >> version >> std::hex >> fileKey) || version != VERSION ||
+        fileKey != key)
+        return; // Not a cache for this trace, it will be overwritten.
+
+    // Each entry is made of a "Q query" line, followed by a "R n" line and
+    // n ranges, and a "L n" line and n labels.
+    std::map<string, Entry> loaded;
+    while (std::getline(ifs, line)) {
+        if (line.size() < 2 || line.compare(0, 2, "Q ") != 0) {
+            errstr = "Malformed analysis cache entry";
+            return;
+        }
+        const string query = line.substr(2);
+        Entry E;
+
+        size_t n;
+        if (!std::getline(ifs, line) || !expect(is, line, "R") ||
+            !(is >> std::dec >> n)) {
+            errstr = "Malformed analysis cache ranges";
+            return;
+        }
+        for (size_t i = 0; i < n; i++) {
+            TarmacSite B, End;
+            if (!std::getline(ifs, line) || !expect(is, line, "r") ||
+                !read(is, B) || !read(is, End)) {
+                errstr = "Malformed analysis cache range";
+                return;
+            }
+            E.ranges.emplace_back(B, End);
+        }
+
+        if (!std::getline(ifs, line) || !expect(is, line, "L") ||
+            !(is >> n)) {
+            errstr = "Malformed analysis cache labels";
+            return;
+        }
+        for (size_t i = 0; i < n; i++) {
+            uint64_t addr;
+            string name;
+            if (!std::getline(ifs, line) || !expect(is, line, "l") ||
+                !(is >> addr) ||
+                !std::getline(is >> std::ws, name)) {
+                errstr = "Malformed analysis cache label";
+                return;
+            }
+            E.labels.emplace_back(addr, name);
+        }
+
+        loaded.emplace(query, std::move(E));
+    }
+
+    entries = std::move(loaded);
+}
+
+bool AnalysisCache::save() {
+    if (!modified)
+        return true;
+
+    // Write to a temporary file first, so that tools running concurrently
+    // never see a partially written cache.
+    const string tmpFilename = filename + ".tmp." + std::to_string(getpid());
+    {
+        ofstream os(tmpFilename);
+        if (!os) {
+            errstr = "Can not create the analysis cache file";
+            return false;
+        }
+        os << MAGIC << ' ' << VERSION << ' ' << std::hex << key << std::dec
+           << '\n';
+        for (const auto &[query, E] : entries) {
+            os << "Q " << query << '\n';
+            os << "R " << E.ranges.size() << '\n';
+            for (const ExecutionRange &ER : E.ranges) {
+                os << 'r';
+                write(os, ER.begin);
+                write(os, ER.end);
+                os << '\n';
+            }
+            os << "L " << E.labels.size() << '\n';
+            for (const auto &label : E.labels)
+                os << "l " << label.first << ' ' << label.second << '\n';
+        }
+        if (!os) {
+            errstr = "Error writing the analysis cache file";
+            return false;
+        }
+    }
+
+    if (std::rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+        std::remove(tmpFilename.c_str());
+        errstr = "Can not rename the analysis cache file";
+        return false;
+    }
+
+    modified = false;
+    return true;
+}
+
+} // namespace PAF
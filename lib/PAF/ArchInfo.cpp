@@ -33,6 +33,7 @@ using std::unique_ptr;
 using std::vector;
 
 using PAF::AddressingMode;
+using PAF::RegisterAccess;
 using PAF::V7MInfo;
 
 namespace {
@@ -1223,6 +1224,16 @@ const char *V7MInfo::registerName(unsigned reg) const {
 unsigned V7MInfo::registerId(string name) const {
     if (name.size() < 2)
         reporter->errx(EXIT_FAILURE, "Weird register name %s", name.c_str());
+    const unsigned id = findRegisterId(name);
+    if (id == RegisterAccess::UNKNOWN_ID)
+        reporter->errx(EXIT_FAILURE, "Unknown register name %s", name.c_str());
+    return id;
+}
+
+unsigned V7MInfo::findRegisterId(const string &reg) const {
+    if (reg.size() < 2)
+        return RegisterAccess::UNKNOWN_ID;
+    string name(reg);
     std::transform(name.begin(), name.end(), name.begin(),
                    [](unsigned char c) { return std::tolower(c); });
     switch (name[0]) {
@@ -1255,7 +1266,7 @@ unsigned V7MInfo::registerId(string name) const {
     default:
         break;
     }
-    reporter->errx(EXIT_FAILURE, "Unknown register name %s", name.c_str());
+    return RegisterAccess::UNKNOWN_ID;
 }
 
 const char *V7MInfo::name(Register reg) {
@@ -1326,6 +1337,16 @@ unsigned V8AInfo::registerId(string name) const {
     reporter->errx(EXIT_FAILURE, "V8A is not implemented yet");
 }
 
+unsigned V8AInfo::findRegisterId(const string &name) const {
+    // TODO: Implement !
+    return RegisterAccess::UNKNOWN_ID;
+}
+
+bool V8AInfo::isStatusRegister(unsigned reg) const {
+    // TODO: Implement !
+    return false;
+}
+
 const char *V8AInfo::name(Register reg) {
     // TODO: Implement !
     return "";
@@ -1343,6 +1364,63 @@ vector<V8AInfo::Register> V8AInfo::registersReadByInstr(const InstrInfo &I,
     return regs;
 }
 
+// ===================================================================
+// InstrInfo cache
+// -------------------------------------------------------------------
+namespace {
+uint64_t instrInfoKey(const ReferenceInstruction &I) {
+    return uint64_t(I.instruction) | (uint64_t(I.width & 0xFF) << 32) |
+           (uint64_t(I.iset & 0xFF) << 40);
+}
+} // namespace
+
+InstrInfoCache::InstrInfoCache(const ArchInfo &CPU, size_t capacity)
+    : cpu(CPU) {
+    size_t n = 16;
+    while (n < capacity)
+        n *= 2;
+    slots.resize(n);
+}
+
+size_t InstrInfoCache::find(uint64_t key) const {
+    const size_t mask = slots.size() - 1;
+    size_t i = size_t((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    while (slots[i].info && slots[i].key != key)
+        i = (i + 1) & mask;
+    return i;
+}
+
+void InstrInfoCache::grow() {
+    vector<Slot> old(slots.size() * 2);
+    old.swap(slots);
+    for (Slot &S : old)
+        if (S.info)
+            slots[find(S.key)] = std::move(S);
+}
+
+const InstrInfo &InstrInfoCache::get(const ReferenceInstruction &I) {
+    const uint64_t key = instrInfoKey(I);
+    size_t i = find(key);
+    if (slots[i].info)
+        return *slots[i].info;
+
+    // Keep the load factor under 3/4.
+    if (4 * (count + 1) > 3 * slots.size()) {
+        grow();
+        i = find(key);
+    }
+    slots[i].info = cpu.getInstrInfo(I);
+    slots[i].key = key;
+    count += 1;
+    return *slots[i].info;
+}
+
+void InstrInfoCache::clear() {
+    for (Slot &S : slots)
+        S.info.reset();
+    count = 0;
+}
+
 unique_ptr<ArchInfo> getCPU(const IndexReader &index) {
     if (index.isAArch64())
         return make_unique<V8AInfo>();
@@ -0,0 +1,80 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+
+#include "PAF/CompactTrace.h"
+
+#include <string_view>
+
+using std::string_view;
+
+namespace PAF {
+
+uint32_t StringTable::intern(string_view s) {
+    const auto it = ids.find(s);
+    if (it != ids.end())
+        return it->second;
+
+    const uint32_t id = strings.size();
+    strings.emplace_back(s);
+    ids.emplace(strings.back(), id);
+    return id;
+}
+
+void CompactTrace::add(const ReferenceInstruction &I) {
+    CompactInstruction &CI = instructions.emplace_back();
+    CI.time = I.time;
+    CI.pc = I.pc;
+    CI.instruction = I.instruction;
+    CI.disassembly = disassemblies.intern(I.disassembly);
+    CI.width = uint8_t(I.width);
+    CI.effect = uint8_t(I.effect);
+    CI.iset = uint8_t(I.iset);
+    CI.memAccess.reserve(I.memAccess.size());
+    for (const MemoryAccess &M : I.memAccess)
+        CI.memAccess.push_back(CompactMemoryAccess(M));
+    CI.regAccess.reserve(I.regAccess.size());
+    for (const RegisterAccess &R : I.regAccess)
+        CI.regAccess.push_back(
+            CompactRegisterAccess(uint16_t(registers.intern(R.name)), R));
+}
+
+ReferenceInstruction CompactTrace::get(size_t i) const {
+    const CompactInstruction &CI = instructions[i];
+    ReferenceInstruction I;
+    // The disassembly has already been trimmed when the instruction was
+    // added, so the fields are directly set.
+    I.disassembly = disassemblies[CI.disassembly];
+    I.time = CI.time;
+    I.pc = CI.pc;
+    I.effect = InstructionEffect(CI.effect);
+    I.iset = ISet(CI.iset);
+    I.width = CI.width;
+    I.instruction = CI.instruction;
+    I.memAccess.reserve(CI.memAccess.size());
+    for (const CompactMemoryAccess &M : CI.memAccess)
+        I.memAccess.push_back(M.get());
+    I.regAccess.reserve(CI.regAccess.size());
+    for (const CompactRegisterAccess &R : CI.regAccess)
+        I.regAccess.emplace_back(registers[R.reg], R.value, R.access);
+    return I;
+}
+
+} // namespace PAF
@@ -19,9 +19,12 @@
  */
 
 #include "PAF/PAF.h"
+#include "PAF/AnalysisCache.h"
+#include "PAF/ArchInfo.h"
 #include "PAF/Intervals.h"
 #include "libtarmac/calltree.hh"
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 
@@ -182,26 +185,19 @@ class LabelCollector {
 };
 
 // The WlabelCollector will scan though a range of tarmac lines and collect
-// the + / - N instructions around labels.
-class WLabelCollector : ParseReceiver {
+// the labels hits, around which the + / - N instructions windows are then
+// computed.
+class WLabelCollector {
 
   public:
-    WLabelCollector(Intervals<TarmacSite> &IR, const IndexNavigator &IN,
-                    unsigned N, const vector<uint64_t> &Addresses,
+    WLabelCollector(const vector<uint64_t> &Addresses,
                     const map<uint64_t, string> &LabelMap,
-                    vector<std::pair<uint64_t, string>> *OutLabels = nullptr,
-                    bool verbose = false)
-        : idxNav(IN), addresses(Addresses), intervals(IR), labelMap(LabelMap),
-          outLabels(OutLabels), window(N), verbose(verbose) {
-        buffer.reserve(2);
+                    vector<std::pair<uint64_t, string>> *OutLabels = nullptr)
+        : addresses(Addresses), labelMap(LabelMap), outLabels(OutLabels) {
         assert(is_sorted(Addresses.begin(), Addresses.end()) &&
                "Addresses must be sorted");
     }
 
-    void got_event(InstructionEvent &ev) override {
-        buffer.emplace_back(ev.pc & ~1UL, ev.time, 0, 0);
-    }
-
     void operator()(const TarmacSite &ts) {
         if (binary_search(addresses.begin(), addresses.end(), ts.addr)) {
             string label = "unknown";
@@ -210,81 +206,18 @@ class WLabelCollector : ParseReceiver {
                 label = it->second;
             if (outLabels)
                 outLabels->emplace_back(ts.time, label);
-
-            SeqOrderPayload SOP;
-
-            // Find the start / end time within the window.
-            idxNav.node_at_time(ts.time, &SOP);
-            SeqOrderPayload StartSOP(SOP);
-            TarmacLineParser TLP(ParseParams(idxNav.index.isBigEndian()),
-                                 *this);
-            for (unsigned i = window; i > 0; i--) {
-                if (!idxNav.get_previous_node(StartSOP, &StartSOP)) {
-                    reporter->warn(
-                        "Can not move window starting point to the full "
-                        "window.");
-                    break;
-                }
-            }
-            vector<string> Lines = idxNav.index.get_trace_lines(StartSOP);
-            for (const string &line : Lines)
-                try {
-                    TLP.parse(line);
-                } catch (TarmacParseError err) {
-                    // Ignore parse failures; we just leave the output event
-                    // fields set to null.
-                }
-
-            SeqOrderPayload EndSOP(SOP);
-            for (unsigned i = window; i > 0; i--) {
-                if (!idxNav.get_next_node(EndSOP, &EndSOP)) {
-                    reporter->warn("Can not move window end point to the full "
-                                   "window.");
-                    break;
-                }
-            }
-            Lines = idxNav.index.get_trace_lines(EndSOP);
-            for (const string &line : Lines)
-                try {
-                    TLP.parse(line);
-                } catch (TarmacParseError err) {
-                    // Ignore parse failures; we just leave the output event
-                    // fields set to null.
-                }
-
-            if (buffer.size() != 2)
-                reporter->errx(EXIT_FAILURE,
-                               "Not enough TarmacSites to create an Interval");
-            intervals.insert(buffer[0], buffer[1]);
-            if (verbose) {
-                cout << "Adding range ";
-                PAF::dump(cout, buffer[0]);
-                cout << " - ";
-                PAF::dump(cout, buffer[1]);
-                cout << '\n';
-            }
-            buffer.clear();
+            hits.push_back(ts.time);
         }
     }
 
-    void dump(ostream &os) const {
-        for (const auto &ir : intervals) {
-            PAF::dump(os, ir.beginValue());
-            os << " - ";
-            PAF::dump(os, ir.endValue());
-            os << '\n';
-        }
-    }
+    /// Get the times of the labels hits, in trace order.
+    [[nodiscard]] const vector<Time> &getHits() const { return hits; }
 
   private:
-    const IndexNavigator &idxNav;
     const vector<uint64_t> &addresses;
-    Intervals<TarmacSite> &intervals;
-    vector<TarmacSite> buffer;
     const map<uint64_t, string> &labelMap;
     vector<std::pair<uint64_t, string>> *outLabels;
-    unsigned window;
-    bool verbose;
+    vector<Time> hits;
 };
 
 } // namespace
@@ -341,6 +274,14 @@ void ReferenceInstruction::dump(ostream &OS) const {
     }
 }
 
+void ReferenceInstructionBuilder::event(ReferenceInstruction &Instr,
+                                        const RegisterEvent &ev) {
+    RegisterAccess RA(ev);
+    if (archInfo != nullptr)
+        RA.id = archInfo->findRegisterId(RA.name);
+    Instr.add(RA);
+}
+
 ExecutionRange MTAnalyzer::getFullExecutionRange() const {
     SeqOrderPayload finalNode;
     if (!indexNavigator.find_buffer_limit(true, &finalNode))
@@ -351,6 +292,7 @@ ExecutionRange MTAnalyzer::getFullExecutionRange() const {
 
 vector<ExecutionRange>
 MTAnalyzer::getInstances(const string &FunctionName) const {
+    const ScopedTimer T("getInstances");
     if (!indexNavigator.has_image())
         reporter->errx(EXIT_FAILURE,
                        "No image, function '%s' can not be looked up",
@@ -362,16 +304,22 @@ MTAnalyzer::getInstances(const string &FunctionName) const {
         reporter->errx(EXIT_FAILURE, "Symbol for function '%s' not found",
                        FunctionName.c_str());
 
-    const CallTree &CT = getCallTree();
+    const string query = "instances " + FunctionName;
     vector<ExecutionRange> Functions;
+    if (lookupCache(query, Functions))
+        return Functions;
+
+    const CallTree &CT = getCallTree();
     ExecsOfInterest EOI(CT, Functions, symb_addr);
     CT.visit(EOI);
 
+    updateCache(query, Functions);
     return Functions;
 }
 
 vector<ExecutionRange>
 MTAnalyzer::getCallSitesTo(const string &FunctionName) const {
+    const ScopedTimer T("getCallSitesTo");
     if (!indexNavigator.has_image())
         reporter->errx(EXIT_FAILURE,
                        "No image, function '%s' can not be looked up",
@@ -383,17 +331,23 @@ MTAnalyzer::getCallSitesTo(const string &FunctionName) const {
         reporter->errx(EXIT_FAILURE, "Symbol for function '%s' not found",
                        FunctionName.c_str());
 
-    const CallTree &CT = getCallTree();
+    const string query = "callsites " + FunctionName;
     vector<ExecutionRange> CS;
+    if (lookupCache(query, CS))
+        return CS;
+
+    const CallTree &CT = getCallTree();
     CSOfInterest CSOI(CT, CS, symb_addr);
     CT.visit(CSOI);
 
+    updateCache(query, CS);
     return CS;
 }
 
 vector<ExecutionRange>
 MTAnalyzer::getBetweenFunctionMarkers(const string &StartFunctionName,
                                       const string &EndFunctionName) const {
+    const ScopedTimer T("getBetweenFunctionMarkers");
     if (!indexNavigator.has_image())
         reporter->errx(
             EXIT_FAILURE,
@@ -411,6 +365,12 @@ MTAnalyzer::getBetweenFunctionMarkers(const string &StartFunctionName,
         reporter->errx(EXIT_FAILURE, "Symbol for function '%s' not found",
                        EndFunctionName.c_str());
 
+    const string query =
+        "between " + StartFunctionName + ' ' + EndFunctionName;
+    vector<ExecutionRange> result;
+    if (lookupCache(query, result))
+        return result;
+
     const CallTree &CT = getCallTree();
 
     // Get all StartSites.
@@ -457,16 +417,17 @@ MTAnalyzer::getBetweenFunctionMarkers(const string &StartFunctionName,
         reporter->errx(EXIT_FAILURE,
                        "Error in matching function starts / ends");
 
-    vector<ExecutionRange> result;
     for (const auto &ir : IR)
         result.emplace_back(ir.beginValue(), ir.endValue());
 
+    updateCache(query, result);
     return result;
 }
 
 vector<ExecutionRange>
 MTAnalyzer::getLabelPairs(const string &StartLabel, const string &EndLabel,
                           map<uint64_t, string> *LabelMap) const {
+    const ScopedTimer T("getLabelPairs");
     if (!indexNavigator.has_image())
         reporter->errx(EXIT_FAILURE,
                        "No image, labels '%s' and '%s' can not be looked up",
@@ -516,6 +477,11 @@ MTAnalyzer::getLabelPairs(const string &StartLabel, const string &EndLabel,
     if (StartAddresses.size() == 0)
         return {};
 
+    const string query = "labels " + StartLabel + ' ' + EndLabel;
+    vector<ExecutionRange> result;
+    if (lookupCache(query, result))
+        return result;
+
     sort(StartAddresses.begin(), StartAddresses.end());
     sort(EndAddresses.begin(), EndAddresses.end());
 
@@ -525,16 +491,17 @@ MTAnalyzer::getLabelPairs(const string &StartLabel, const string &EndLabel,
         indexNavigator);
     LC.build(getFullExecutionRange(), Labels);
 
-    vector<ExecutionRange> result;
     for (const auto &ir : IR)
         result.emplace_back(ir.beginValue(), ir.endValue());
 
+    updateCache(query, result);
     return result;
 }
 
 vector<ExecutionRange>
 MTAnalyzer::getWLabels(const vector<string> &labels, unsigned N,
                        vector<std::pair<uint64_t, string>> *OutLabels) const {
+    const ScopedTimer T("getWLabels");
     if (!indexNavigator.has_image())
         reporter->errx(EXIT_FAILURE, "No image, symbols can not be looked up");
 
@@ -554,58 +521,186 @@ MTAnalyzer::getWLabels(const vector<string> &labels, unsigned N,
     }
     sort(Addresses.begin(), Addresses.end());
 
-    Intervals<TarmacSite> IR;
-    WLabelCollector Labels(IR, indexNavigator, N, Addresses, LabelMap,
-                           OutLabels, verbose());
+    string query = "wlabels " + std::to_string(N);
+    for (const auto &label : labels)
+        query += ' ' + label;
+    vector<ExecutionRange> result;
+    vector<std::pair<uint64_t, string>> CachedLabels;
+    if (lookupCache(query, result, &CachedLabels)) {
+        if (OutLabels)
+            OutLabels->insert(OutLabels->end(), CachedLabels.begin(),
+                              CachedLabels.end());
+        return result;
+    }
+
+    // The labels are always collected when caching, as a later run may
+    // need them.
+    vector<std::pair<uint64_t, string>> CollectedLabels;
+    WLabelCollector Labels(Addresses, LabelMap,
+                           analysisCache ? &CollectedLabels : OutLabels);
     FromTraceBuilder<TarmacSite, LabelEventHandler, WLabelCollector> WLC(
         indexNavigator);
     WLC.build(getFullExecutionRange(), Labels);
 
+    // Compute the windows around all labels hits by navigating the index.
+    vector<TarmacSite> Starts, Ends;
+    if (getSitesAtOffset(Starts, Labels.getHits(), -int(N)) != 0)
+        reporter->warn(
+            "Can not move window starting point to the full window.");
+    if (getSitesAtOffset(Ends, Labels.getHits(), int(N)) != 0)
+        reporter->warn("Can not move window end point to the full window.");
+
+    Intervals<TarmacSite> IR;
+    for (size_t i = 0; i < Starts.size(); i++) {
+        IR.insert(Starts[i], Ends[i]);
+        if (verbose()) {
+            cout << "Adding range ";
+            PAF::dump(cout, Starts[i]);
+            cout << " - ";
+            PAF::dump(cout, Ends[i]);
+            cout << '\n';
+        }
+    }
+
+    if (analysisCache && OutLabels)
+        OutLabels->insert(OutLabels->end(), CollectedLabels.begin(),
+                          CollectedLabels.end());
+
     // Some Interval may have been merged, so check an invariant:
     if (OutLabels && IR.size() > OutLabels->size())
         reporter->errx(
             EXIT_FAILURE,
             "Broken invariant, can not have more Intervals than labels !");
 
-    vector<ExecutionRange> result;
     for (const auto &ir : IR)
         result.emplace_back(ir.beginValue(), ir.endValue());
 
+    updateCache(query, result, &CollectedLabels);
     return result;
 }
 
-uint64_t MTAnalyzer::getRegisterValueAtTime(const string &reg, Time t) const {
-    SeqOrderPayload SOP;
-    if (!indexNavigator.node_at_time(t, &SOP))
-        reporter->errx(1, "Can not find node at time %d in this trace", t);
-
-    if (reg == "pc")
-        return SOP.pc;
+bool MTAnalyzer::getSiteAtOffset(TarmacSite &S, Time t, int offset) const {
+    SeqOrderPayload SOP = nodeAtTime(t);
+    bool complete = true;
+    for (; offset > 0; offset--)
+        if (!indexNavigator.get_next_node(SOP, &SOP)) {
+            complete = false;
+            break;
+        }
+    for (; offset < 0; offset++)
+        if (!indexNavigator.get_previous_node(SOP, &SOP)) {
+            complete = false;
+            break;
+        }
+    S = TarmacSite(SOP.pc & ~1UL, SOP.mod_time, SOP.trace_file_firstline, 0);
+    return complete;
+}
 
-    RegisterId r;
-    if (!lookup_reg_name(r, reg))
-        reporter->errx(1, "Can not find register '%s'", reg.c_str());
+size_t MTAnalyzer::getSitesAtOffset(vector<TarmacSite> &sites,
+                                    const vector<Time> &ts,
+                                    int offset) const {
+    sites.clear();
+    sites.reserve(ts.size());
+    size_t truncated = 0;
+    bool complete = true;
+    for (size_t i = 0; i < ts.size(); i++) {
+        // Consecutive queries at the same time are common (e.g. several
+        // labels at the same address): reuse the previous result.
+        if (i > 0 && ts[i] == ts[i - 1])
+            sites.push_back(sites.back());
+        else {
+            sites.emplace_back();
+            complete = getSiteAtOffset(sites.back(), ts[i], offset);
+        }
+        if (!complete)
+            truncated++;
+    }
+    return truncated;
+}
 
-    std::pair<bool, uint64_t> res =
-        indexNavigator.get_reg_value(SOP.memory_root, r);
-    if (!res.first)
-        reporter->errx(EXIT_FAILURE, "Unable to get register value for '%s'",
-                       reg.c_str());
+bool MTAnalyzer::lookupCache(
+    const string &query, vector<ExecutionRange> &ranges,
+    vector<std::pair<uint64_t, string>> *labels) const {
+    if (!analysisCache)
+        return false;
+
+    const AnalysisCache::Entry *E = analysisCache->lookup(query);
+    if (!E)
+        return false;
+
+    if (verbose())
+        cout << "Using cached analysis results for '" << query << "'\n";
+    ranges = E->ranges;
+    if (labels)
+        *labels = E->labels;
+    return true;
+}
 
-    return res.second;
+void MTAnalyzer::updateCache(
+    const string &query, const vector<ExecutionRange> &ranges,
+    const vector<std::pair<uint64_t, string>> *labels) const {
+    if (!analysisCache)
+        return;
+
+    AnalysisCache::Entry E;
+    E.ranges = ranges;
+    if (labels)
+        E.labels = *labels;
+    analysisCache->insert(query, std::move(E));
 }
 
-vector<uint8_t> MTAnalyzer::getMemoryValueAtTime(uint64_t address,
-                                                 size_t num_bytes,
-                                                 Time t) const {
+SeqOrderPayload MTAnalyzer::nodeAtTime(Time t) const {
+    for (size_t i = 0; i < recentNodes.size(); i++)
+        if (recentNodes[i].first == t) {
+            // Move the node to the front, as the most recently used.
+            std::rotate(recentNodes.begin(), recentNodes.begin() + i,
+                        recentNodes.begin() + i + 1);
+            return recentNodes[0].second;
+        }
+
     SeqOrderPayload SOP;
+    Stats::add(Stats::INDEX_LOOKUPS);
     if (!indexNavigator.node_at_time(t, &SOP))
         reporter->errx(1, "Can not find node at time %d in this trace", t);
 
+    if (recentNodes.size() == RECENT_NODES)
+        recentNodes.pop_back();
+    recentNodes.emplace(recentNodes.begin(), t, SOP);
+    return SOP;
+}
+
+namespace {
+// A register, as queried from the index: the pc is not part of the register
+// state, but is held in each node.
+struct IndexRegister {
+    const string &name;
+    bool isPC;
+    RegisterId id;
+
+    IndexRegister(const string &reg) : name(reg), isPC(reg == "pc"), id() {
+        if (!isPC && !lookup_reg_name(id, reg))
+            reporter->errx(1, "Can not find register '%s'", reg.c_str());
+    }
+
+    uint64_t value(const IndexNavigator &IN, const SeqOrderPayload &SOP) const {
+        if (isPC)
+            return SOP.pc;
+
+        std::pair<bool, uint64_t> res = IN.get_reg_value(SOP.memory_root, id);
+        if (!res.first)
+            reporter->errx(EXIT_FAILURE,
+                           "Unable to get register value for '%s'",
+                           name.c_str());
+        return res.second;
+    }
+};
+
+vector<uint8_t> memoryValue(const IndexNavigator &IN,
+                            const SeqOrderPayload &SOP, uint64_t address,
+                            size_t num_bytes) {
     vector<uint8_t> def(num_bytes);
     vector<uint8_t> result(num_bytes);
-    indexNavigator.getmem(SOP.memory_root, 'm', address, num_bytes, &result[0],
-                          &def[0]);
+    IN.getmem(SOP.memory_root, 'm', address, num_bytes, &result[0], &def[0]);
 
     for (size_t i = 0; i < num_bytes; i++)
         if (!def[i])
@@ -614,9 +709,55 @@ vector<uint8_t> MTAnalyzer::getMemoryValueAtTime(uint64_t address,
 
     return result;
 }
+} // namespace
+
+uint64_t MTAnalyzer::getRegisterValueAtTime(const string &reg, Time t) const {
+    const SeqOrderPayload SOP = nodeAtTime(t);
+    return IndexRegister(reg).value(indexNavigator, SOP);
+}
+
+vector<uint64_t>
+MTAnalyzer::getRegisterValuesAtTime(const vector<string> &regs,
+                                    Time t) const {
+    const SeqOrderPayload SOP = nodeAtTime(t);
+    vector<uint64_t> values;
+    values.reserve(regs.size());
+    for (const string &reg : regs)
+        values.push_back(IndexRegister(reg).value(indexNavigator, SOP));
+    return values;
+}
+
+vector<uint64_t>
+MTAnalyzer::getRegisterValueAtTimes(const string &reg,
+                                    const vector<Time> &ts) const {
+    const IndexRegister r(reg);
+    vector<uint64_t> values;
+    values.reserve(ts.size());
+    for (const Time t : ts)
+        values.push_back(r.value(indexNavigator, nodeAtTime(t)));
+    return values;
+}
+
+vector<uint8_t> MTAnalyzer::getMemoryValueAtTime(uint64_t address,
+                                                 size_t num_bytes,
+                                                 Time t) const {
+    return memoryValue(indexNavigator, nodeAtTime(t), address, num_bytes);
+}
+
+vector<vector<uint8_t>> MTAnalyzer::getMemoryValuesAtTime(
+    const vector<std::pair<uint64_t, size_t>> &ranges, Time t) const {
+    const SeqOrderPayload SOP = nodeAtTime(t);
+    vector<vector<uint8_t>> values;
+    values.reserve(ranges.size());
+    for (const auto &range : ranges)
+        values.push_back(
+            memoryValue(indexNavigator, SOP, range.first, range.second));
+    return values;
+}
 
 bool MTAnalyzer::getInstructionAtTime(ReferenceInstruction &I, Time t) const {
     SeqOrderPayload SOP;
+    Stats::add(Stats::INDEX_LOOKUPS);
     if (!indexNavigator.node_at_time(t, &SOP))
         reporter->errx(1, "Can not find node at time %d in this trace", t);
 
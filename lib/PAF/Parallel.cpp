@@ -0,0 +1,318 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/utils/Parallel.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using std::string;
+using std::vector;
+
+namespace {
+// The pool the calling thread is a worker of, if any, and its index there.
+thread_local const PAF::ThreadPool *currentPool = nullptr;
+thread_local size_t currentIndex = 0;
+
+PAF::Affinity affinityFromEnvironment() {
+    const char *env = std::getenv("PAF_AFFINITY");
+    if (env != nullptr) {
+        if (std::strcmp(env, "compact") == 0)
+            return PAF::Affinity::COMPACT;
+        if (std::strcmp(env, "spread") == 0)
+            return PAF::Affinity::SPREAD;
+    }
+    return PAF::Affinity::NONE;
+}
+
+#ifdef __linux__
+// The maximum number of NUMA nodes looked for.
+constexpr unsigned MAX_NUMA_NODES = 64;
+
+// Parse a sysfs CPU list, e.g. "0-3,8-11", into cpus.
+void parseCPUList(const string &list, vector<unsigned> &cpus) {
+    const char *p = list.c_str();
+    while (*p != '\0') {
+        char *end;
+        const unsigned long first = std::strtoul(p, &end, 10);
+        if (end == p)
+            return;
+        unsigned long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = std::strtoul(p, &end, 10);
+            if (end == p)
+                return;
+        }
+        for (unsigned long cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+        if (*end != ',')
+            return;
+        p = end + 1;
+    }
+}
+
+// Get the CPUs the process is allowed to run on, in the order the workers
+// should be pinned to them for affinity.
+vector<unsigned> getCPUOrder(PAF::Affinity affinity) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return {};
+    const auto isAllowed = [&](unsigned cpu) {
+        return cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed);
+    };
+
+    // Group the allowed CPUs by NUMA node.
+    vector<vector<unsigned>> nodes;
+    for (unsigned n = 0; n < MAX_NUMA_NODES; n++) {
+        std::ifstream ifs("/sys/devices/system/node/node" + std::to_string(n) +
+                          "/cpulist");
+        string list;
+        if (!std::getline(ifs, list))
+            continue;
+        vector<unsigned> cpus;
+        parseCPUList(list, cpus);
+        const auto notAllowed = [&](unsigned cpu) { return !isAllowed(cpu); };
+        cpus.erase(std::remove_if(cpus.begin(), cpus.end(), notAllowed),
+                   cpus.end());
+        if (!cpus.empty())
+            nodes.emplace_back(std::move(cpus));
+    }
+    if (nodes.empty()) {
+        nodes.emplace_back();
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (isAllowed(cpu))
+                nodes.back().push_back(cpu);
+    }
+
+    vector<unsigned> order;
+    if (affinity == PAF::Affinity::COMPACT) {
+        for (const auto &cpus : nodes)
+            order.insert(order.end(), cpus.begin(), cpus.end());
+    } else {
+        size_t largest = 0;
+        for (const auto &cpus : nodes)
+            largest = std::max(largest, cpus.size());
+        for (size_t i = 0; i < largest; i++)
+            for (const auto &cpus : nodes)
+                if (i < cpus.size())
+                    order.push_back(cpus[i]);
+    }
+    return order;
+}
+
+// Pin thread to cpu. This is only a performance hint, so failures are
+// ignored.
+void pin(std::thread &thread, unsigned cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+}
+#endif
+} // namespace
+
+namespace PAF {
+
+unsigned hardwareNumThreads() noexcept {
+    return std::max(std::thread::hardware_concurrency(), 1U);
+}
+
+unsigned defaultNumThreads(unsigned fallback) {
+    unsigned n = fallback;
+    const char *env = std::getenv("PAF_NUM_THREADS");
+    if (env != nullptr && *env != '\0') {
+        char *end;
+        const unsigned long v = std::strtoul(env, &end, 0);
+        if (*end == '\0')
+            n = v;
+    }
+    return n == 0 ? hardwareNumThreads() : n;
+}
+
+ThreadPool::ThreadPool(unsigned numThreads, Affinity affinity) {
+    if (numThreads == 0)
+        numThreads = hardwareNumThreads();
+    workers.reserve(numThreads);
+    for (unsigned i = 0; i < numThreads; i++)
+        workers.emplace_back(std::make_unique<Worker>());
+    // Only start the threads once all queues exist, as the workers steal
+    // tasks from each other.
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i]->thread = std::thread([this, i]() { run(i); });
+
+#ifdef __linux__
+    if (affinity != Affinity::NONE) {
+        const vector<unsigned> order = getCPUOrder(affinity);
+        if (!order.empty())
+            for (size_t i = 0; i < workers.size(); i++)
+                pin(workers[i]->thread, order[i % order.size()]);
+    }
+#else
+    (void)affinity;
+#endif
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto &W : workers)
+        W->thread.join();
+}
+
+ThreadPool &ThreadPool::get() {
+    static ThreadPool pool(defaultNumThreads(), affinityFromEnvironment());
+    return pool;
+}
+
+bool ThreadPool::isWorker() const noexcept { return currentPool == this; }
+
+void ThreadPool::submit(Task task) {
+    const size_t index =
+        isWorker() ? currentIndex : nextQueue++ % workers.size();
+    {
+        Worker &W = *workers[index];
+        std::lock_guard<std::mutex> lock(W.mtx);
+        W.tasks.push_back(std::move(task));
+        numQueued++;
+    }
+    // Synchronize with the workers checking for work before they go to
+    // sleep, so that the notification can not be missed.
+    { std::lock_guard<std::mutex> lock(mtx); }
+    workAvailable.notify_one();
+}
+
+bool ThreadPool::pop(size_t index, Task &task) {
+    for (size_t i = 0; i < workers.size(); i++) {
+        Worker &W = *workers[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(W.mtx);
+        if (W.tasks.empty())
+            continue;
+        // The most recent task of our own queue is the most likely to have
+        // its data in our caches, whereas the oldest task of another queue
+        // is the most likely to be a large piece of work.
+        if (i == 0) {
+            task = std::move(W.tasks.back());
+            W.tasks.pop_back();
+        } else {
+            task = std::move(W.tasks.front());
+            W.tasks.pop_front();
+        }
+        numQueued--;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::run(size_t index) {
+    currentPool = this;
+    currentIndex = index;
+    for (;;) {
+        Task task;
+        if (pop(index, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mtx);
+        workAvailable.wait(lock,
+                           [this]() { return stopping || numQueued > 0; });
+        if (stopping && numQueued == 0)
+            return;
+    }
+}
+
+namespace detail {
+void parallelFor(size_t begin, size_t end, size_t grain,
+                 const std::function<void(size_t, size_t)> &f,
+                 unsigned numThreads) {
+    if (begin >= end)
+        return;
+    if (grain == 0)
+        grain = 1;
+    const size_t numChunks = (end - begin + grain - 1) / grain;
+
+    if (numChunks == 1 || numThreads == 1) {
+        for (size_t b = begin; b < end; b += std::min(grain, end - b))
+            f(b, std::min(b + grain, end));
+        return;
+    }
+
+    // The chunks are handed out dynamically to the calling thread and to
+    // the helper tasks. A helper task may only start once all chunks have
+    // been processed, so the state it uses is shared rather than living on
+    // our stack. The function itself is only used while processing a chunk,
+    // i.e. while we are still waiting.
+    struct State {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        std::mutex mtx;
+        std::condition_variable finished;
+    };
+    const auto S = std::make_shared<State>();
+    const auto *fp = &f;
+    const auto work = [S, fp, begin, end, grain, numChunks]() {
+        for (size_t c = S->next++; c < numChunks; c = S->next++) {
+            if (!S->failed) {
+                const size_t b = begin + c * grain;
+                try {
+                    (*fp)(b, std::min(b + grain, end));
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(S->mtx);
+                    if (!S->error)
+                        S->error = std::current_exception();
+                    S->failed = true;
+                }
+            }
+            if (++S->done == numChunks) {
+                std::lock_guard<std::mutex> lock(S->mtx);
+                S->finished.notify_all();
+            }
+        }
+    };
+
+    ThreadPool &pool = ThreadPool::get();
+    const size_t numHelpers = std::min(
+        numThreads == 0 ? pool.size() : size_t(numThreads - 1), numChunks - 1);
+    for (size_t i = 0; i < numHelpers; i++)
+        pool.submit(work);
+    work();
+
+    std::unique_lock<std::mutex> lock(S->mtx);
+    S->finished.wait(lock, [&]() { return S->done == numChunks; });
+    if (S->error)
+        std::rethrow_exception(S->error);
+}
+} // namespace detail
+
+} // namespace PAF
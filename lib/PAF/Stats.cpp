@@ -0,0 +1,340 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/utils/Stats.h"
+
+#include "libtarmac/argparse.hh"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using std::map;
+using std::ostream;
+using std::string;
+using std::vector;
+
+namespace {
+// The time spent in a ScopedTimer scope.
+struct TimerStats {
+    uint64_t count = 0;
+    double seconds = 0.0;
+    uint64_t peakRSS = 0;
+
+    void merge(const TimerStats &other) {
+        count += other.count;
+        seconds += other.seconds;
+        peakRSS = std::max(peakRSS, other.peakRSS);
+    }
+};
+
+// The statistics of a thread. The counters are only updated by their
+// thread, and the timers are protected by mtx, so that the statistics can be
+// dumped while the threads are running.
+struct ThreadStats {
+    std::atomic<uint64_t> counters[PAF::Stats::NUM_COUNTERS] = {};
+    std::mutex mtx;
+    map<string, TimerStats> timers;
+    // The names of the running ScopedTimers, only used by the thread.
+    vector<string> running;
+};
+
+// The statistics of all threads which have recorded some. They are kept
+// after their thread exits, so that nothing is lost with transient threads.
+// The registry is never destroyed, as the statistics are dumped at exit.
+std::mutex registryMtx;
+vector<std::shared_ptr<ThreadStats>> &registry() {
+    static auto *threads = new vector<std::shared_ptr<ThreadStats>>();
+    return *threads;
+}
+
+ThreadStats &threadStats() {
+    thread_local std::shared_ptr<ThreadStats> stats;
+    if (!stats) {
+        stats = std::make_shared<ThreadStats>();
+        std::lock_guard<std::mutex> lock(registryMtx);
+        registry().push_back(stats);
+    }
+    return *stats;
+}
+
+// The current and peak allocations, in total and per subsystem.
+std::atomic<uint64_t> allocatedBytes{0};
+std::atomic<uint64_t> peakAllocatedBytes{0};
+std::atomic<uint64_t> subsystemBytes[PAF::Stats::NUM_SUBSYSTEMS] = {};
+std::atomic<uint64_t> peakSubsystemBytes[PAF::Stats::NUM_SUBSYSTEMS] = {};
+
+void updatePeak(std::atomic<uint64_t> &peak, uint64_t current) noexcept {
+    uint64_t p = peak.load(std::memory_order_relaxed);
+    while (current > p && !peak.compare_exchange_weak(p, current))
+        ;
+}
+
+// The file to dump the statistics to when the program exits.
+string &statsFilename() {
+    static auto *filename = new string();
+    return *filename;
+}
+
+void dumpStatsAtExit() {
+    if (!PAF::Stats::writeJSON(statsFilename()))
+        std::cerr << "Error writing statistics to '" << statsFilename()
+                  << "'\n";
+}
+
+void writeString(ostream &os, const string &s) {
+    os << '"';
+    for (const char c : s) {
+        if (c == '"' || c == '\\')
+            os << '\\';
+        os << c;
+    }
+    os << '"';
+}
+
+using Counters = uint64_t[PAF::Stats::NUM_COUNTERS];
+
+void writeCounters(ostream &os, const Counters &counters) {
+    os << '{';
+    for (unsigned c = 0; c < PAF::Stats::NUM_COUNTERS; c++)
+        os << (c == 0 ? "" : ", ") << '"'
+           << PAF::Stats::getName(PAF::Stats::Counter(c))
+           << "\": " << counters[c];
+    os << '}';
+}
+} // namespace
+
+namespace PAF {
+
+std::atomic<bool> Stats::isEnabled{false};
+
+void Stats::addToThread(Counter c, uint64_t n) noexcept {
+    // Only this thread updates its counters, so there is no need for an
+    // atomic read-modify-write.
+    std::atomic<uint64_t> &counter = threadStats().counters[c];
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+}
+
+uint64_t Stats::get(Counter c) {
+    uint64_t total = 0;
+    std::lock_guard<std::mutex> lock(registryMtx);
+    for (const auto &T : registry())
+        total += T->counters[c].load(std::memory_order_relaxed);
+    return total;
+}
+
+const char *Stats::getName(Counter c) noexcept {
+    switch (c) {
+    case INSTRUCTIONS_REPLAYED:
+        return "instructions_replayed";
+    case INDEX_LOOKUPS:
+        return "index_lookups";
+    case BYTES_READ:
+        return "bytes_read";
+    case NPY_ROWS_EMITTED:
+        return "npy_rows_emitted";
+    case FAULTS_PLANNED:
+        return "faults_planned";
+    case NUM_COUNTERS:
+        break;
+    }
+    return "unknown";
+}
+
+const char *Stats::getName(Subsystem s) noexcept {
+    switch (s) {
+    case MEM_PAF:
+        return "paf";
+    case MEM_SCA:
+        return "sca";
+    case MEM_WAN:
+        return "wan";
+    case MEM_FI:
+        return "fi";
+    case NUM_SUBSYSTEMS:
+        break;
+    }
+    return "unknown";
+}
+
+void Stats::allocated(size_t num_bytes, Subsystem s) noexcept {
+    // The current allocation is always tracked, so that it remains
+    // consistent whenever the statistics collection is enabled.
+    const uint64_t current = allocatedBytes += num_bytes;
+    const uint64_t currentSubsystem = subsystemBytes[s] += num_bytes;
+    if (!enabled())
+        return;
+    updatePeak(peakAllocatedBytes, current);
+    updatePeak(peakSubsystemBytes[s], currentSubsystem);
+}
+
+void Stats::released(size_t num_bytes, Subsystem s) noexcept {
+    allocatedBytes -= num_bytes;
+    subsystemBytes[s] -= num_bytes;
+}
+
+uint64_t Stats::getAllocatedBytes() noexcept { return allocatedBytes; }
+
+uint64_t Stats::getAllocatedBytes(Subsystem s) noexcept {
+    return subsystemBytes[s];
+}
+
+uint64_t Stats::getPeakAllocatedBytes() noexcept {
+    return std::max(peakAllocatedBytes.load(), allocatedBytes.load());
+}
+
+uint64_t Stats::getPeakAllocatedBytes(Subsystem s) noexcept {
+    return std::max(peakSubsystemBytes[s].load(), subsystemBytes[s].load());
+}
+
+uint64_t Stats::getRSS() {
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size, resident;
+    if (!(statm >> size >> resident))
+        return 0;
+    return resident * uint64_t(sysconf(_SC_PAGESIZE));
+}
+
+uint64_t Stats::getPeakRSS() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return uint64_t(usage.ru_maxrss);
+#else
+    return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+}
+
+void Stats::reset() {
+    std::lock_guard<std::mutex> lock(registryMtx);
+    for (const auto &T : registry()) {
+        for (auto &counter : T->counters)
+            counter = 0;
+        std::lock_guard<std::mutex> tlock(T->mtx);
+        T->timers.clear();
+    }
+    peakAllocatedBytes = allocatedBytes.load();
+    for (unsigned s = 0; s < NUM_SUBSYSTEMS; s++)
+        peakSubsystemBytes[s] = subsystemBytes[s].load();
+}
+
+void Stats::writeJSON(ostream &os) {
+    Counters totals = {};
+    vector<std::shared_ptr<ThreadStats>> threads;
+    {
+        std::lock_guard<std::mutex> lock(registryMtx);
+        threads = registry();
+    }
+
+    os << "{\n  \"threads\": [";
+    map<string, TimerStats> timers;
+    for (size_t t = 0; t < threads.size(); t++) {
+        Counters counters;
+        for (unsigned c = 0; c < NUM_COUNTERS; c++) {
+            counters[c] = threads[t]->counters[c].load();
+            totals[c] += counters[c];
+        }
+        os << (t == 0 ? "\n    " : ",\n    ");
+        writeCounters(os, counters);
+
+        std::lock_guard<std::mutex> lock(threads[t]->mtx);
+        for (const auto &[name, TS] : threads[t]->timers)
+            timers[name].merge(TS);
+    }
+    os << "\n  ],\n  \"counters\": ";
+    writeCounters(os, totals);
+
+    os << ",\n  \"timers\": {";
+    bool first = true;
+    for (const auto &[name, TS] : timers) {
+        os << (first ? "\n    " : ",\n    ");
+        writeString(os, name);
+        os << ": {\"count\": " << TS.count << ", \"seconds\": " << TS.seconds
+           << ", \"peak_rss_bytes\": " << TS.peakRSS << '}';
+        first = false;
+    }
+    os << "\n  },\n  \"memory\": {\"rss_bytes\": " << getRSS()
+       << ", \"peak_rss_bytes\": " << getPeakRSS()
+       << ", \"allocated_bytes\": " << getAllocatedBytes()
+       << ", \"peak_allocated_bytes\": " << getPeakAllocatedBytes()
+       << ", \"subsystems\": {";
+    for (unsigned s = 0; s < NUM_SUBSYSTEMS; s++)
+        os << (s == 0 ? "" : ", ") << '"' << getName(Subsystem(s))
+           << "\": {\"allocated_bytes\": " << getAllocatedBytes(Subsystem(s))
+           << ", \"peak_allocated_bytes\": "
+           << getPeakAllocatedBytes(Subsystem(s)) << '}';
+    os << "}}\n}\n";
+}
+
+bool Stats::writeJSON(const string &filename) {
+    std::ofstream os(filename);
+    if (!os)
+        return false;
+    writeJSON(os);
+    return bool(os);
+}
+
+void Stats::addOptions(Argparse &ap) {
+    ap.optval({"--stats-json"}, "FILE",
+              "collect statistics about this run (time spent, work "
+              "performed, memory usage), and save them in JSON format to "
+              "FILE",
+              [](const string &s) {
+                  if (statsFilename().empty())
+                      std::atexit(dumpStatsAtExit);
+                  statsFilename() = s;
+                  enable();
+              });
+}
+
+void ScopedTimer::start(const char *name) {
+    vector<string> &running = threadStats().running;
+    running.push_back(running.empty() ? string(name)
+                                      : running.back() + '/' + name);
+    active = true;
+    startTime = StopWatchBase::Clock::now();
+}
+
+void ScopedTimer::stop() {
+    const double seconds =
+        StopWatchBase::elapsed(StopWatchBase::Clock::now(), startTime);
+    const uint64_t peakRSS = Stats::getPeakRSS();
+    ThreadStats &T = threadStats();
+    {
+        std::lock_guard<std::mutex> lock(T.mtx);
+        TimerStats &TS = T.timers[T.running.back()];
+        TS.count += 1;
+        TS.seconds += seconds;
+        TS.peakRSS = std::max(TS.peakRSS, peakRSS);
+    }
+    T.running.pop_back();
+}
+
+} // namespace PAF
@@ -0,0 +1,191 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/Synthetic.h"
+
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+
+using std::array;
+
+namespace PAF {
+
+namespace {
+// The splitmix64 pseudo random number generator.
+class SplitMix64 {
+  public:
+    SplitMix64(uint64_t seed) : state(seed) {}
+
+    uint64_t operator()() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+  private:
+    uint64_t state;
+};
+
+// Emit the Tarmac lines of the instructions, in the format output by the
+// FastModels.
+class TarmacEmitter {
+  public:
+    TarmacEmitter(std::ostream &os) : os(os) {}
+
+    void instr(bool executed, uint32_t pc, uint16_t opcode,
+               const char *disassembly) {
+        time += 1;
+        emit("%" PRIu64 " clk %s (%" PRIu64 ") %08" PRIx32 " %04" PRIx16
+             " T thread : %s\n",
+             time, executed ? "IT" : "IS", time, pc, opcode, disassembly);
+    }
+
+    void reg(const char *name, uint32_t value) {
+        emit("%" PRIu64 " clk R %s %08" PRIx32 "\n", time, name, value);
+    }
+
+    void mem(bool write, uint32_t addr, uint32_t value) {
+        emit("%" PRIu64 " clk %s %08" PRIx32 " %08" PRIx32 "\n", time,
+             write ? "MW4" : "MR4", addr, value);
+    }
+
+  private:
+    std::ostream &os;
+    uint64_t time = 0;
+    array<char, 128> buf;
+
+    template <class... Args> void emit(const char *fmt, Args... args) {
+        const int n = std::snprintf(buf.data(), buf.size(), fmt, args...);
+        os.write(buf.data(), n);
+    }
+};
+
+// The xor loop:
+//   0x8000  MOVS  r2,#0x40
+//   0x8002  MOV   r1,r4
+//   0x8004  LDR   r3,[r1,#0]
+//   0x8006  EORS  r3,r3,r0
+//   0x8008  STR   r3,[r1,#0]
+//   0x800a  ADDS  r1,r1,#4
+//   0x800c  SUBS  r2,r2,#1
+//   0x800e  BNE   0x8004
+//   0x8010  B     0x8000
+constexpr uint32_t BUFFER_ADDR = 0x00020000;
+constexpr uint32_t BUFFER_WORDS = 0x40;
+constexpr uint32_t THUMB_STATE = 0x01000000;
+
+uint32_t flags(uint32_t result, bool carry) {
+    return THUMB_STATE | (result & 0x80000000) | (result == 0 ? 1 << 30 : 0) |
+           (carry ? 1 << 29 : 0);
+}
+} // namespace
+
+bool writeSyntheticTarmac(std::ostream &os, size_t numInstructions,
+                          uint64_t seed) {
+    SplitMix64 R(seed);
+    array<uint32_t, BUFFER_WORDS> buffer;
+    for (uint32_t &w : buffer)
+        w = uint32_t(R());
+
+    uint32_t r0 = uint32_t(R());
+    uint32_t r1 = 0;
+    uint32_t r2 = 0;
+    uint32_t r3 = 0;
+    const uint32_t r4 = BUFFER_ADDR;
+    uint32_t cpsr = THUMB_STATE;
+
+    // The initial state.
+    TarmacEmitter E(os);
+    E.reg("r0", r0);
+    E.reg("r4", r4);
+    E.reg("cpsr", cpsr);
+
+    uint32_t pc = 0x8000;
+    for (size_t i = 0; i < numInstructions; i++) {
+        switch (pc) {
+        case 0x8000:
+            E.instr(true, pc, 0x2240, "MOVS     r2,#0x40");
+            r2 = BUFFER_WORDS;
+            cpsr = flags(r2, cpsr & (1 << 29));
+            E.reg("r2", r2);
+            E.reg("cpsr", cpsr);
+            pc += 2;
+            break;
+        case 0x8002:
+            E.instr(true, pc, 0x4621, "MOV      r1,r4");
+            r1 = r4;
+            E.reg("r1", r1);
+            pc += 2;
+            break;
+        case 0x8004:
+            E.instr(true, pc, 0x680b, "LDR      r3,[r1,#0]");
+            r3 = buffer[(r1 - BUFFER_ADDR) / 4];
+            E.mem(false, r1, r3);
+            E.reg("r3", r3);
+            pc += 2;
+            break;
+        case 0x8006:
+            E.instr(true, pc, 0x4043, "EORS     r3,r3,r0");
+            r3 ^= r0;
+            cpsr = flags(r3, cpsr & (1 << 29));
+            E.reg("r3", r3);
+            E.reg("cpsr", cpsr);
+            pc += 2;
+            break;
+        case 0x8008:
+            E.instr(true, pc, 0x600b, "STR      r3,[r1,#0]");
+            buffer[(r1 - BUFFER_ADDR) / 4] = r3;
+            E.mem(true, r1, r3);
+            pc += 2;
+            break;
+        case 0x800a:
+            E.instr(true, pc, 0x3104, "ADDS     r1,r1,#4");
+            cpsr = flags(r1 + 4, r1 + 4 < r1);
+            r1 += 4;
+            E.reg("r1", r1);
+            E.reg("cpsr", cpsr);
+            pc += 2;
+            break;
+        case 0x800c:
+            E.instr(true, pc, 0x3a01, "SUBS     r2,r2,#1");
+            cpsr = flags(r2 - 1, r2 >= 1);
+            r2 -= 1;
+            E.reg("r2", r2);
+            E.reg("cpsr", cpsr);
+            pc += 2;
+            break;
+        case 0x800e: {
+            const bool taken = r2 != 0;
+            E.instr(taken, pc, 0xd1f9, "BNE      {pc}-0xa ; 0x8004");
+            pc = taken ? 0x8004 : pc + 2;
+        } break;
+        case 0x8010:
+            E.instr(true, pc, 0xe7f6, "B        {pc}-0x10 ; 0x8000");
+            pc = 0x8000;
+            break;
+        }
+    }
+
+    return bool(os);
+}
+
+} // namespace PAF
@@ -0,0 +1,232 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/Align.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+using std::complex;
+using std::ptrdiff_t;
+using std::vector;
+
+namespace {
+constexpr double PI = 3.14159265358979323846;
+
+// Multiply complex numbers, without the NaN and infinity handling of the
+// std::complex operator, which the compiler can not inline.
+inline complex<double> mul(const complex<double> &a, const complex<double> &b) {
+    return {a.real() * b.real() - a.imag() * b.imag(),
+            a.real() * b.imag() + a.imag() * b.real()};
+}
+} // namespace
+
+namespace PAF::SCA {
+
+Aligner::Aligner(const double *pattern, size_t length, size_t position,
+                 size_t max_shift, size_t num_samples)
+    : patternLength(length), numSamples(num_samples) {
+    assert(length != 0 && "The reference pattern can not be empty");
+    assert(position + length <= num_samples &&
+           "The reference pattern must be inside the traces");
+
+    // Restrict the search window so that the pattern remains in the traces.
+    leftShifts = std::min(max_shift, position);
+    const size_t right_shifts =
+        std::min(max_shift, num_samples - position - length);
+    segmentBegin = position - leftShifts;
+    numShifts = leftShifts + right_shifts + 1;
+
+    // The cross-correlation does not wrap around as long as the FFT covers
+    // the searched segment.
+    const size_t segment_length = length + numShifts - 1;
+    size_t n = 1;
+    while (n < segment_length)
+        n <<= 1;
+
+    twiddles.resize(n / 2);
+    for (size_t k = 0; k < n / 2; k++) {
+        const double angle = -2.0 * PI * double(k) / double(n);
+        twiddles[k] = complex<double>(std::cos(angle), std::sin(angle));
+    }
+    reversed.resize(n);
+    for (size_t i = 0, j = 0; i < n; i++) {
+        reversed[i] = j;
+        size_t bit = n >> 1;
+        for (; bit != 0 && (j & bit); bit >>= 1)
+            j ^= bit;
+        j |= bit;
+    }
+
+    // The pattern is centered, so that the correlations do not depend on
+    // the segments' mean.
+    double mean = 0.0;
+    for (size_t i = 0; i < length; i++)
+        mean += pattern[i];
+    mean /= double(length);
+    reference.assign(n, complex<double>(0.0, 0.0));
+    for (size_t i = 0; i < length; i++)
+        reference[i] = pattern[i] - mean;
+    fft(reference.data(), /* inverse: */ false);
+    for (auto &r : reference)
+        r = std::conj(r);
+}
+
+void Aligner::fft(complex<double> *x, bool inverse) const {
+    const size_t n = reversed.size();
+    for (size_t i = 0; i < n; i++)
+        if (i < reversed[i])
+            std::swap(x[i], x[reversed[i]]);
+
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const size_t half = len / 2;
+        const size_t step = n / len;
+        for (size_t b = 0; b < n; b += len)
+            for (size_t k = 0; k < half; k++) {
+                const complex<double> &t = twiddles[k * step];
+                const complex<double> w = inverse ? std::conj(t) : t;
+                const complex<double> u = x[b + k];
+                const complex<double> v = mul(x[b + k + half], w);
+                x[b + k] = u + v;
+                x[b + k + half] = u - v;
+            }
+    }
+}
+
+ptrdiff_t Aligner::bestShift(const double *segment,
+                             const vector<double> &corr) const {
+    // Normalize the correlations with the segment's standard deviation for
+    // each shift, using running sums over the sliding window.
+    double s1 = 0.0;
+    double s2 = 0.0;
+    for (size_t i = 0; i < patternLength; i++) {
+        s1 += segment[i];
+        s2 += segment[i] * segment[i];
+    }
+
+    size_t best = 0;
+    double best_score = -std::numeric_limits<double>::infinity();
+    for (size_t d = 0; d < numShifts; d++) {
+        if (d != 0) {
+            const double out = segment[d - 1];
+            const double in = segment[d + patternLength - 1];
+            s1 += in - out;
+            s2 += in * in - out * out;
+        }
+        const double var = s2 - s1 * s1 / double(patternLength);
+        if (var > 0.0) {
+            const double score = corr[d] / std::sqrt(var);
+            if (score > best_score) {
+                best_score = score;
+                best = d;
+            }
+        }
+    }
+
+    return ptrdiff_t(best) - ptrdiff_t(leftShifts);
+}
+
+void Aligner::findShifts(ptrdiff_t &shift0, ptrdiff_t &shift1,
+                         const double *trace0, const double *trace1,
+                         vector<complex<double>> &buf,
+                         vector<complex<double>> &corr) const {
+    const size_t n = reference.size();
+    const size_t segment_length = patternLength + numShifts - 1;
+    const double *segment0 = trace0 + segmentBegin;
+    const double *segment1 = trace1 ? trace1 + segmentBegin : nullptr;
+
+    // Transform both real segments at once, as the real and imaginary parts
+    // of a single complex signal.
+    buf.assign(n, complex<double>(0.0, 0.0));
+    for (size_t i = 0; i < segment_length; i++)
+        buf[i] = complex<double>(segment0[i], segment1 ? segment1[i] : 0.0);
+    fft(buf.data(), /* inverse: */ false);
+
+    // Split the spectrum into the spectra X0 and X1 of the 2 segments, and
+    // pack their products with the reference spectrum so that the inverse
+    // transform gives both (real) cross-correlations at once.
+    corr.resize(n);
+    for (size_t k = 0; k < n; k++) {
+        const complex<double> a = buf[k];
+        const complex<double> b = std::conj(buf[(n - k) & (n - 1)]);
+        const complex<double> x0 = 0.5 * (a + b);
+        const complex<double> x1(0.5 * (a - b).imag(), -0.5 * (a - b).real());
+        const complex<double> c0 = mul(x0, reference[k]);
+        const complex<double> c1 = mul(x1, reference[k]);
+        corr[k] = complex<double>(c0.real() - c1.imag(), c0.imag() + c1.real());
+    }
+    fft(corr.data(), /* inverse: */ true);
+
+    vector<double> c(numShifts);
+    for (size_t d = 0; d < numShifts; d++)
+        c[d] = corr[d].real();
+    shift0 = bestShift(segment0, c);
+    if (segment1) {
+        for (size_t d = 0; d < numShifts; d++)
+            c[d] = corr[d].imag();
+        shift1 = bestShift(segment1, c);
+    }
+}
+
+ptrdiff_t Aligner::shift(const double *trace) const {
+    vector<complex<double>> buf;
+    vector<complex<double>> corr;
+    ptrdiff_t shift0;
+    ptrdiff_t shift1;
+    findShifts(shift0, shift1, trace, nullptr, buf, corr);
+    return shift0;
+}
+
+void Aligner::shifts(vector<ptrdiff_t> &shifts, const NPArray<double> &traces,
+                     size_t begin, size_t end) const {
+    assert(begin <= end && end <= traces.rows() && "Invalid rows range");
+    assert(traces.cols() == numSamples && "Unexpected number of samples");
+    shifts.resize(end - begin);
+    vector<complex<double>> buf;
+    vector<complex<double>> corr;
+    for (size_t r = begin; r < end; r += 2) {
+        const bool pair = r + 1 < end;
+        ptrdiff_t shift1;
+        findShifts(shifts[r - begin], pair ? shifts[r - begin + 1] : shift1,
+                   &traces(r, 0), pair ? &traces(r + 1, 0) : nullptr, buf,
+                   corr);
+    }
+}
+
+void Aligner::align(double *row, size_t n, ptrdiff_t shift) {
+    if (n == 0 || shift == 0)
+        return;
+
+    if (shift > 0) {
+        const size_t s = std::min(size_t(shift), n);
+        const double last = row[n - 1];
+        std::copy(row + s, row + n, row);
+        std::fill(row + n - s, row + n, last);
+    } else {
+        const size_t s = std::min(size_t(-shift), n);
+        const double first = row[0];
+        std::copy_backward(row, row + n - s, row + n);
+        std::fill(row, row + s, first);
+    }
+}
+
+} // namespace PAF::SCA
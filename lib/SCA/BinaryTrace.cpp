@@ -0,0 +1,441 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/BinaryTrace.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <zlib.h>
+
+using std::string;
+using std::vector;
+
+namespace {
+// The number of string bytes held by a STRING record.
+constexpr size_t STRING_CHUNK_SIZE = 3 * sizeof(uint64_t);
+// The number of bits used for each register index in a REGISTERS_DELTA record.
+constexpr unsigned DELTA_INDEX_BITS = 10;
+constexpr uint32_t DELTA_INDEX_MASK = (1U << DELTA_INDEX_BITS) - 1;
+
+uint64_t *payload(PAF::SCA::BinaryTraceRecord &R, size_t i) {
+    switch (i) {
+    case 0:
+        return &R.a;
+    case 1:
+        return &R.b;
+    default:
+        return &R.c;
+    }
+}
+} // namespace
+
+namespace PAF::SCA {
+
+/// Compressor holds the zlib state used for gzip compressing the output.
+struct BinaryTraceWriter::Compressor {
+    z_stream zs{};
+    bool ok;
+
+    Compressor() {
+        // 15 + 16 requests a gzip wrapper, which gzread understands.
+        ok = deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                          Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+    ~Compressor() {
+        if (ok)
+            deflateEnd(&zs);
+    }
+};
+
+BinaryTraceWriter::BinaryTraceWriter(std::ostream *os,
+                                     BinaryTraceContent content,
+                                     bool compressed)
+    : os(os) {
+    if (os == nullptr)
+        return;
+    if (compressed) {
+        compressor = std::make_unique<Compressor>();
+        if (!compressor->ok) {
+            errstr = "error initializing the compressor";
+            this->os = nullptr;
+            return;
+        }
+    }
+    buffer.reserve(BUFFER_SIZE);
+    BinaryTraceRecord H(BinaryTraceRecord::HEADER, BinaryTraceRecord::MAGIC);
+    H.u8 = static_cast<uint8_t>(content);
+    H.u16 = BinaryTraceRecord::VERSION;
+    write(H);
+}
+
+BinaryTraceWriter::~BinaryTraceWriter() {
+    // Intentionally ignore the return value.
+    static_cast<void>(close());
+}
+
+uint32_t BinaryTraceWriter::getStringId(const string &s) {
+    const auto it = strings.find(s);
+    if (it != strings.end())
+        return it->second;
+
+    const uint32_t id = strings.size();
+    strings.emplace(s, id);
+    size_t offset = 0;
+    do {
+        BinaryTraceRecord R(BinaryTraceRecord::STRING);
+        const size_t len = std::min(STRING_CHUNK_SIZE, s.size() - offset);
+        R.u8 = offset == 0; // Marks the first chunk of a string.
+        R.u16 = len;
+        R.u32 = id;
+        std::memcpy(&R.a, s.data() + offset, len);
+        write(R);
+        offset += len;
+    } while (offset < s.size());
+
+    return id;
+}
+
+void BinaryTraceWriter::writeInstruction(const ReferenceInstruction &I) {
+    BinaryTraceRecord R(BinaryTraceRecord::INSTRUCTION, I.time, I.pc,
+                        I.instruction);
+    R.u8 = (static_cast<uint8_t>(I.effect) & 0x0F) |
+           (static_cast<uint8_t>(I.iset) << 4);
+    R.u16 = I.width;
+    R.u32 = getStringId(I.disassembly);
+    write(R);
+}
+
+void BinaryTraceWriter::writeRegisters(const vector<uint64_t> &regs) {
+    for (size_t i = 0; i < regs.size(); i += 3) {
+        BinaryTraceRecord R(BinaryTraceRecord::REGISTERS);
+        R.u16 = std::min<size_t>(3, regs.size() - i);
+        R.u32 = i;
+        for (size_t j = 0; j < R.u16; j++)
+            *payload(R, j) = regs[i + j];
+        write(R);
+    }
+}
+
+void BinaryTraceWriter::writeRegistersDelta(const vector<uint64_t> &previous,
+                                            const vector<uint64_t> &regs) {
+    const bool all = previous.size() != regs.size();
+    BinaryTraceRecord R(BinaryTraceRecord::REGISTERS_DELTA);
+    R.u8 = 1;
+    for (size_t i = 0; i < regs.size(); i++) {
+        if (!all && previous[i] == regs[i])
+            continue;
+        *payload(R, R.u16) = regs[i];
+        R.u32 |= (i & DELTA_INDEX_MASK) << (R.u16 * DELTA_INDEX_BITS);
+        R.u16 += 1;
+        if (R.u16 == 3) {
+            write(R);
+            R = BinaryTraceRecord(BinaryTraceRecord::REGISTERS_DELTA);
+        }
+    }
+    // Always emit the first record, so that unchanged states are recorded.
+    if (R.u16 != 0 || R.u8 != 0)
+        write(R);
+}
+
+void BinaryTraceWriter::writeMemoryAccesses(Addr pc, uint32_t index,
+                                            const vector<MemoryAccess> &MA) {
+    for (const auto &a : MA) {
+        BinaryTraceRecord R(a.access == Access::Type::READ
+                                ? BinaryTraceRecord::LOAD
+                                : BinaryTraceRecord::STORE,
+                            a.addr, a.value, pc);
+        R.u8 = a.size;
+        R.u32 = index;
+        write(R);
+    }
+}
+
+bool BinaryTraceWriter::flush(bool last) {
+    if (os == nullptr)
+        return good();
+
+    const char *p = reinterpret_cast<const char *>(buffer.data());
+    const size_t len = buffer.size() * sizeof(BinaryTraceRecord);
+    if (!compressor) {
+        os->write(p, len);
+    } else {
+        z_stream &zs = compressor->zs;
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(p));
+        zs.avail_in = len;
+        char out[64 * 1024];
+        int ret;
+        do {
+            zs.next_out = reinterpret_cast<Bytef *>(out);
+            zs.avail_out = sizeof(out);
+            ret = deflate(&zs, last ? Z_FINISH : Z_NO_FLUSH);
+            if (ret == Z_STREAM_ERROR) {
+                errstr = "error compressing records";
+                os = nullptr;
+                return false;
+            }
+            os->write(out, sizeof(out) - zs.avail_out);
+        } while (zs.avail_out == 0 || (last && ret != Z_STREAM_END));
+    }
+    buffer.clear();
+
+    if (!*os) {
+        errstr = "error writing records";
+        os = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool BinaryTraceWriter::close() {
+    if (os == nullptr)
+        return good();
+    const bool ok = flush(true);
+    if (ok)
+        os->flush();
+    os = nullptr;
+    return ok;
+}
+
+BinaryTraceReader::BinaryTraceReader(const string &filename,
+                                     BinaryTraceContent content)
+    : file(gzopen(filename.c_str(), "rb")) {
+    if (file == nullptr) {
+        fail("error opening file");
+        return;
+    }
+
+    BinaryTraceRecord H;
+    if (!next(H)) {
+        fail("missing header");
+        return;
+    }
+    if (H.kind != BinaryTraceRecord::HEADER ||
+        H.a != BinaryTraceRecord::MAGIC) {
+        fail("not a binary trace file");
+        return;
+    }
+    if (H.u16 != BinaryTraceRecord::VERSION) {
+        fail("unsupported binary trace version");
+        return;
+    }
+    if (H.u8 != static_cast<uint8_t>(content))
+        fail("unexpected binary trace content");
+}
+
+BinaryTraceReader::~BinaryTraceReader() {
+    if (file != nullptr)
+        gzclose(static_cast<gzFile>(file));
+}
+
+bool BinaryTraceReader::fill() {
+    if (file == nullptr)
+        return false;
+
+    buffer.resize(4096);
+    const int len = gzread(static_cast<gzFile>(file), buffer.data(),
+                           buffer.size() * sizeof(BinaryTraceRecord));
+    if (len < 0)
+        return fail("error reading file");
+    if (len % sizeof(BinaryTraceRecord) != 0)
+        return fail("truncated record");
+
+    buffer.resize(len / sizeof(BinaryTraceRecord));
+    pos = 0;
+    return !buffer.empty();
+}
+
+bool BinaryTraceReader::peek(BinaryTraceRecord &R) {
+    while (good()) {
+        if (pos >= buffer.size() && !fill())
+            return false;
+
+        R = buffer[pos];
+        if (R.kind != BinaryTraceRecord::STRING)
+            return true;
+
+        pos += 1;
+        if (R.u16 > STRING_CHUNK_SIZE)
+            return fail("invalid string record");
+        if (R.u8) {
+            if (R.u32 != strings.size())
+                return fail("invalid string identifier");
+            strings.emplace_back();
+        } else if (R.u32 + 1 != strings.size())
+            return fail("invalid string identifier");
+        strings.back().append(reinterpret_cast<const char *>(&R.a), R.u16);
+    }
+
+    return false;
+}
+
+const string &BinaryTraceReader::getString(uint32_t id) const {
+    static const string empty;
+    return id < strings.size() ? strings[id] : empty;
+}
+
+BinaryTimingReader::BinaryTimingReader(const string &filename)
+    : BinaryTraceReader(filename, BinaryTraceContent::TIMING) {
+    BinaryTraceRecord R;
+    while (next(R))
+        switch (R.kind) {
+        case BinaryTraceRecord::STATS:
+            cmin = R.a;
+            cmax = R.b;
+            break;
+        case BinaryTraceRecord::TIMING:
+            pcCycle.emplace_back(R.a, R.b);
+            break;
+        default:
+            fail("unexpected record in timing information");
+            return;
+        }
+}
+
+size_t BinaryTimingReader::instructionAt(uint64_t cycle) const {
+    const auto it = std::upper_bound(
+        pcCycle.begin(), pcCycle.end(), cycle,
+        [](uint64_t c, const std::pair<Addr, uint64_t> &p) {
+            return c < p.second;
+        });
+    if (it == pcCycle.begin())
+        return pcCycle.size();
+    return std::distance(pcCycle.begin(), it) - 1;
+}
+
+bool BinaryInstrReader::nextTrace(vector<ReferenceInstruction> &instrs,
+                                  vector<vector<uint64_t>> *regBanks) {
+    instrs.clear();
+    if (regBanks)
+        regBanks->clear();
+
+    BinaryTraceRecord R;
+    if (!next(R))
+        return false;
+    if (R.kind != BinaryTraceRecord::TRACE)
+        return fail("expecting a trace record");
+
+    while (peek(R)) {
+        if (R.kind == BinaryTraceRecord::TRACE)
+            break;
+        next(R);
+
+        if (R.kind == BinaryTraceRecord::INSTRUCTION) {
+            instrs.emplace_back(
+                R.a, static_cast<InstructionEffect>(R.u8 & 0x0F), R.b,
+                static_cast<ISet>(R.u8 >> 4), R.u16, R.c, getString(R.u32),
+                vector<MemoryAccess>(), vector<RegisterAccess>());
+            if (regBanks)
+                regBanks->emplace_back();
+            continue;
+        }
+
+        if (instrs.empty())
+            return fail("record without an instruction");
+
+        switch (R.kind) {
+        case BinaryTraceRecord::LOAD:
+        case BinaryTraceRecord::STORE:
+            instrs.back().add(MemoryAccess(R.u8, R.a, R.b,
+                                           R.kind == BinaryTraceRecord::LOAD
+                                               ? Access::Type::READ
+                                               : Access::Type::WRITE));
+            break;
+        case BinaryTraceRecord::REGISTERS:
+            if (regBanks)
+                for (size_t j = 0; j < R.u16 && j < 3; j++)
+                    regBanks->back().push_back(*payload(R, j));
+            break;
+        default:
+            return fail("unexpected record in instructions trace");
+        }
+    }
+
+    return good();
+}
+
+bool BinaryRegBankReader::nextTrace(vector<vector<uint64_t>> &states) {
+    states.clear();
+
+    BinaryTraceRecord R;
+    if (!next(R))
+        return false;
+    if (R.kind != BinaryTraceRecord::TRACE)
+        return fail("expecting a trace record");
+
+    while (peek(R)) {
+        if (R.kind == BinaryTraceRecord::TRACE)
+            break;
+        next(R);
+
+        if (R.kind != BinaryTraceRecord::REGISTERS_DELTA)
+            return fail("unexpected record in register bank trace");
+
+        if (R.u8) {
+            if (states.empty())
+                states.emplace_back();
+            else
+                states.push_back(states.back());
+        } else if (states.empty())
+            return fail("register delta without a register bank state");
+
+        vector<uint64_t> &state = states.back();
+        for (size_t j = 0; j < R.u16 && j < 3; j++) {
+            const size_t reg =
+                (R.u32 >> (j * DELTA_INDEX_BITS)) & DELTA_INDEX_MASK;
+            if (reg >= state.size())
+                state.resize(reg + 1, 0);
+            state[reg] = *payload(R, j);
+        }
+    }
+
+    return good();
+}
+
+bool BinaryMemoryAccessesReader::nextTrace(vector<Entry> &entries) {
+    entries.clear();
+
+    BinaryTraceRecord R;
+    if (!next(R))
+        return false;
+    if (R.kind != BinaryTraceRecord::TRACE)
+        return fail("expecting a trace record");
+
+    while (peek(R)) {
+        if (R.kind == BinaryTraceRecord::TRACE)
+            break;
+        next(R);
+
+        if (R.kind != BinaryTraceRecord::LOAD &&
+            R.kind != BinaryTraceRecord::STORE)
+            return fail("unexpected record in memory accesses trace");
+
+        if (entries.empty() || entries.back().index != R.u32)
+            entries.push_back({R.u32, R.c, vector<MemoryAccess>()});
+        entries.back().accesses.emplace_back(
+            R.u8, R.a, R.b,
+            R.kind == BinaryTraceRecord::LOAD ? Access::Type::READ
+                                              : Access::Type::WRITE);
+    }
+
+    return good();
+}
+
+} // namespace PAF::SCA
@@ -85,6 +85,43 @@ void YAMLMemoryAccessesDumper::dump(uint64_t PC,
     *this << "}\n" << std::dec;
 }
 
+BinaryRegBankDumper::BinaryRegBankDumper(const std::string &filename,
+                                         bool compressed)
+    : RegBankDumper(!filename.empty()),
+      FileStreamDumper(filename, std::ofstream::out | std::ofstream::binary),
+      writer(os, BinaryTraceContent::REGISTER_BANK, compressed) {}
+
+BinaryRegBankDumper::BinaryRegBankDumper(std::ostream &s, bool compressed,
+                                         bool enable)
+    : RegBankDumper(enable), FileStreamDumper(s),
+      writer(enable ? os : nullptr, BinaryTraceContent::REGISTER_BANK,
+             compressed) {}
+
+void BinaryRegBankDumper::dump(const std::vector<uint64_t> &regs) {
+    writer.startTrace();
+    writer.writeRegistersDelta(previous, regs);
+    previous = regs;
+}
+
+BinaryMemoryAccessesDumper::BinaryMemoryAccessesDumper(
+    const std::string &filename, bool compressed)
+    : MemoryAccessesDumper(!filename.empty()),
+      FileStreamDumper(filename, std::ofstream::out | std::ofstream::binary),
+      writer(os, BinaryTraceContent::MEMORY_ACCESSES, compressed) {}
+
+BinaryMemoryAccessesDumper::BinaryMemoryAccessesDumper(std::ostream &s,
+                                                       bool compressed,
+                                                       bool enable)
+    : MemoryAccessesDumper(enable), FileStreamDumper(s),
+      writer(enable ? os : nullptr, BinaryTraceContent::MEMORY_ACCESSES,
+             compressed) {}
+
+void BinaryMemoryAccessesDumper::dump(uint64_t PC,
+                                      const std::vector<MemoryAccess> &MA) {
+    writer.startTrace();
+    writer.writeMemoryAccesses(PC, index++, MA);
+}
+
 YAMLInstrDumper::YAMLInstrDumper(const std::string &filename,
                                  bool dumpMemAccess, bool dumpRegBank)
     : InstrDumper(!filename.empty(), dumpMemAccess, dumpRegBank),
@@ -128,4 +165,29 @@ void YAMLInstrDumper::dumpImpl(const ReferenceInstruction &I,
     *this << "}\n";
 }
 
+BinaryInstrDumper::BinaryInstrDumper(const std::string &filename,
+                                     bool compressed, bool dumpMemAccess,
+                                     bool dumpRegBank)
+    : InstrDumper(!filename.empty(), dumpMemAccess, dumpRegBank),
+      FileStreamDumper(filename, std::ofstream::out | std::ofstream::binary),
+      writer(os, BinaryTraceContent::INSTRUCTIONS, compressed) {}
+
+BinaryInstrDumper::BinaryInstrDumper(std::ostream &s, bool compressed,
+                                     bool enable, bool dumpMemAccess,
+                                     bool dumpRegBank)
+    : InstrDumper(enable, dumpMemAccess, dumpRegBank), FileStreamDumper(s),
+      writer(enable ? os : nullptr, BinaryTraceContent::INSTRUCTIONS,
+             compressed) {}
+
+void BinaryInstrDumper::dumpImpl(const ReferenceInstruction &I,
+                                 const std::vector<uint64_t> *regs) {
+    writer.startTrace();
+    writer.writeInstruction(I);
+    if (dumpMemAccess)
+        writer.writeMemoryAccesses(I.pc, index, I.memAccess);
+    if (regs && dumpRegBank)
+        writer.writeRegisters(*regs);
+    index += 1;
+}
+
 } // namespace PAF::SCA
@@ -20,12 +20,16 @@
 
 #include "PAF/SCA/Expr.h"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <string>
+#include <vector>
 
 using std::array;
+using std::min;
 using std::string;
+using std::vector;
 
 namespace PAF::SCA::Expr {
 
@@ -135,6 +139,236 @@ Value AESISBox::eval() const {
     return {AES_isbox[idx], getType()};
 }
 
+size_t Program::add(const Expr &expr) {
+    results.push_back(expr.compile(*this));
+    return results.size() - 1;
+}
+
+unsigned Program::insert(const Instruction &insn) {
+    const Key key(insn.op, insn.ty, insn.lhs, insn.rhs, insn.value, insn.ptr,
+                  insn.stride);
+    const auto it = known.find(key);
+    if (it != known.end())
+        return it->second;
+    code.push_back(insn);
+    known.emplace(key, code.size() - 1);
+    return code.size() - 1;
+}
+
+unsigned Program::emit(OpCode op, ValueType::Type ty, unsigned lhs,
+                       unsigned rhs) {
+    assert(lhs < code.size() && "Invalid lhs register");
+    assert((op < AND || rhs < code.size()) && "Invalid rhs register");
+    const bool binary = op >= AND;
+    if (!binary)
+        rhs = 0;
+    const Instruction insn{op, ty, lhs, rhs, 0, nullptr, 0, nullptr};
+
+    // Fold the operations on constants.
+    if (code[lhs].op == CONSTANT && (!binary || code[rhs].op == CONSTANT)) {
+        Value::ConcreteType v;
+        execute(insn, &v, &code[lhs].value, &code[rhs].value, 0, 1);
+        return emitConstant(ty, v);
+    }
+
+    return insert(insn);
+}
+
+unsigned Program::emitConstant(ValueType::Type ty, Value::ConcreteType value) {
+    return insert({CONSTANT, ty, 0, 0, value, nullptr, 0, nullptr});
+}
+
+unsigned Program::emitLeaf(const Expr &leaf) {
+    return insert({LEAF, leaf.getType(), 0, 0, 0, &leaf, 0, nullptr});
+}
+
+unsigned Program::emitLoad(const void *base, size_t stride,
+                           ValueType::Type ty, Loader loader) {
+    return insert({LOAD, ty, 0, 0, 0, base, stride, loader});
+}
+
+namespace {
+/// The number of rows evaluated at a time by a Program, small enough for all
+/// its registers to stay in the cache.
+constexpr size_t ROWS_PER_BATCH = 256;
+
+/// Widen \p table to the registers' element type, so that the look-ups on a
+/// whole batch of registers can be vectorized as gathers when the target
+/// supports them.
+array<Value::ConcreteType, 256> widen(const array<uint8_t, 256> &table) {
+    array<Value::ConcreteType, 256> wide{};
+    for (size_t i = 0; i < table.size(); i++)
+        wide[i] = table[i];
+    return wide;
+}
+
+const array<Value::ConcreteType, 256> AES_sbox_wide = widen(AES_sbox);
+const array<Value::ConcreteType, 256> AES_isbox_wide = widen(AES_isbox);
+
+/// Get the mask to apply to the values of type \p ty.
+Value::ConcreteType mask(ValueType::Type ty) {
+    const size_t bits = ValueType::getNumBits(ty);
+    return bits >= 64 ? ~Value::ConcreteType(0)
+                      : (Value::ConcreteType(1) << bits) - 1;
+}
+
+/// Arithmetic shift right of the \p ty value \p val by \p shAmount.
+Value::ConcreteType asr(Value::ConcreteType val, Value::ConcreteType shAmount,
+                        ValueType::Type ty) {
+    switch (ty) {
+    case ValueType::UINT8:
+        return static_cast<Value::ConcreteType>(int8_t(val) >> shAmount);
+    case ValueType::UINT16:
+        return static_cast<Value::ConcreteType>(int16_t(val) >> shAmount);
+    case ValueType::UINT32:
+        return static_cast<Value::ConcreteType>(int32_t(val) >> shAmount);
+    case ValueType::UINT64:
+    case ValueType::UNDEF:
+        break;
+    }
+    return static_cast<Value::ConcreteType>(int64_t(val) >> shAmount);
+}
+} // namespace
+
+void Program::execute(const Instruction &insn, Value::ConcreteType *dst,
+                      const Value::ConcreteType *l,
+                      const Value::ConcreteType *r, size_t first_row,
+                      size_t n) {
+    const Value::ConcreteType m = mask(insn.ty);
+    switch (insn.op) {
+    case CONSTANT:
+        for (size_t j = 0; j < n; j++)
+            dst[j] = insn.value;
+        break;
+    case LEAF: {
+        const Value::ConcreteType v =
+            static_cast<const Expr *>(insn.ptr)->eval().getValue();
+        for (size_t j = 0; j < n; j++)
+            dst[j] = v;
+    } break;
+    case LOAD:
+        insn.loader(dst, insn.ptr, insn.stride, first_row, n);
+        for (size_t j = 0; j < n; j++)
+            dst[j] &= m;
+        break;
+    case NOT:
+        for (size_t j = 0; j < n; j++)
+            dst[j] = ~l[j] & m;
+        break;
+    case TRUNCATE:
+        for (size_t j = 0; j < n; j++)
+            dst[j] = l[j] & m;
+        break;
+    case AES_SBOX:
+        for (size_t j = 0; j < n; j++) {
+            assert(l[j] < AES_sbox.size() && "unexpected AES SBox index value");
+            dst[j] = AES_sbox_wide[l[j] & 0xFF];
+        }
+        break;
+    case AES_ISBOX:
+        for (size_t j = 0; j < n; j++) {
+            assert(l[j] < AES_isbox.size() &&
+                   "unexpected AES ISBox index value");
+            dst[j] = AES_isbox_wide[l[j] & 0xFF];
+        }
+        break;
+    case AND:
+        for (size_t j = 0; j < n; j++)
+            dst[j] = (l[j] & r[j]) & m;
+        break;
+    case OR:
+        for (size_t j = 0; j < n; j++)
+            dst[j] = (l[j] | r[j]) & m;
+        break;
+    case XOR:
+        for (size_t j = 0; j < n; j++)
+            dst[j] = (l[j] ^ r[j]) & m;
+        break;
+    case LSL:
+        for (size_t j = 0; j < n; j++) {
+            assert(r[j] <= ValueType::getNumBits(insn.ty) &&
+                   "Can not shift by more than bits in the data type");
+            dst[j] = (l[j] << r[j]) & m;
+        }
+        break;
+    case LSR:
+        for (size_t j = 0; j < n; j++) {
+            assert(r[j] <= ValueType::getNumBits(insn.ty) &&
+                   "Can not shift by more than bits in the data type");
+            dst[j] = ((l[j] & m) >> r[j]) & m;
+        }
+        break;
+    case ASR:
+        for (size_t j = 0; j < n; j++) {
+            assert(r[j] <= ValueType::getNumBits(insn.ty) &&
+                   "Can not shift by more than bits in the data type");
+            dst[j] = asr(l[j], r[j], insn.ty) & m;
+        }
+        break;
+    }
+}
+
+void Program::eval(Value::ConcreteType *out, size_t first_row,
+                   size_t num_rows) const {
+    assert(!results.empty() && "Can not evaluate an empty Program");
+
+    // Allocate the batch registers: an instruction result only needs to live
+    // until its last use, so that the registers in use stay in the cache.
+    // The constants are only materialized once, in registers of their own.
+    vector<size_t> lastUse(code.size(), 0);
+    for (size_t i = 0; i < code.size(); i++) {
+        lastUse[i] = i;
+        if (code[i].op >= NOT)
+            lastUse[code[i].lhs] = i;
+        if (code[i].op >= AND)
+            lastUse[code[i].rhs] = i;
+    }
+    vector<vector<size_t>> outputsOf(code.size());
+    for (size_t o = 0; o < results.size(); o++)
+        outputsOf[results[o]].push_back(o);
+
+    vector<size_t> slot(code.size());
+    vector<size_t> freeSlots;
+    size_t numSlots = 0;
+    for (size_t i = 0; i < code.size(); i++) {
+        if (code[i].op != CONSTANT && !freeSlots.empty()) {
+            slot[i] = freeSlots.back();
+            freeSlots.pop_back();
+        } else
+            slot[i] = numSlots++;
+        if (code[i].op >= NOT) {
+            if (lastUse[code[i].lhs] == i && code[code[i].lhs].op != CONSTANT)
+                freeSlots.push_back(slot[code[i].lhs]);
+            if (code[i].op >= AND && code[i].rhs != code[i].lhs &&
+                lastUse[code[i].rhs] == i &&
+                code[code[i].rhs].op != CONSTANT)
+                freeSlots.push_back(slot[code[i].rhs]);
+        }
+        if (lastUse[i] == i && code[i].op != CONSTANT)
+            freeSlots.push_back(slot[i]);
+    }
+
+    vector<Value::ConcreteType> regs(numSlots * ROWS_PER_BATCH);
+    for (size_t i = 0; i < code.size(); i++)
+        if (code[i].op == CONSTANT)
+            execute(code[i], &regs[slot[i] * ROWS_PER_BATCH], nullptr, nullptr,
+                    0, ROWS_PER_BATCH);
+
+    for (size_t rb = 0; rb < num_rows; rb += ROWS_PER_BATCH) {
+        const size_t n = min(ROWS_PER_BATCH, num_rows - rb);
+        for (size_t i = 0; i < code.size(); i++) {
+            const Instruction &insn = code[i];
+            Value::ConcreteType *dst = &regs[slot[i] * ROWS_PER_BATCH];
+            if (insn.op != CONSTANT)
+                execute(insn, dst, &regs[slot[insn.lhs] * ROWS_PER_BATCH],
+                        &regs[slot[insn.rhs] * ROWS_PER_BATCH], first_row + rb,
+                        n);
+            for (size_t o : outputsOf[i])
+                std::copy(dst, dst + n, out + o * num_rows + rb);
+        }
+    }
+}
+
 Value Lsl::eval() const {
     assert(getType() != ValueType::UNDEF &&
            "UNDEF is not support in shift operation");
@@ -0,0 +1,251 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/LiveTraces.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+using std::ostream;
+using std::string;
+
+namespace {
+uint32_t getU32(const unsigned char *p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) |
+           (uint32_t(p[3]) << 24);
+}
+
+// Accept a single connection on the socket fd, which is closed.
+int acceptOne(int fd, const char **errstr) {
+    int conn = -1;
+    if (listen(fd, 1) != 0)
+        *errstr = "error listening for a connection";
+    else if ((conn = accept(fd, nullptr, nullptr)) < 0)
+        *errstr = "error accepting a connection";
+    ::close(fd);
+    return conn;
+}
+
+int acceptUnix(const string &path, const char **errstr) {
+    sockaddr_un addr{};
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        *errstr = "invalid UNIX socket path";
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    // Only a stale socket is removed, never a regular file.
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path.c_str());
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        *errstr = "error creating the UNIX socket";
+        return -1;
+    }
+    if (bind(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) !=
+        0) {
+        *errstr = "error binding the UNIX socket";
+        ::close(fd);
+        return -1;
+    }
+    const int conn = acceptOne(fd, errstr);
+    unlink(path.c_str());
+    return conn;
+}
+
+int acceptTCP(const string &spec, const char **errstr) {
+    string host;
+    string port = spec;
+    if (const size_t colon = spec.rfind(':'); colon != string::npos) {
+        host = spec.substr(0, colon);
+        port = spec.substr(colon + 1);
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo *res = nullptr;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(),
+                    &hints, &res) != 0) {
+        *errstr = "error resolving the TCP address";
+        return -1;
+    }
+
+    int fd = -1;
+    for (const addrinfo *ai = res; ai != nullptr; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        const int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        ::close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0) {
+        *errstr = "error binding the TCP socket";
+        return -1;
+    }
+    return acceptOne(fd, errstr);
+}
+} // namespace
+
+namespace PAF::SCA {
+
+LiveTraceReader::LiveTraceReader(const string &source) {
+    if (source == "-")
+        fd = STDIN_FILENO;
+    else {
+        ownFd = true;
+        if (source.compare(0, 5, "unix:") == 0)
+            fd = acceptUnix(source.substr(5), &errstr);
+        else if (source.compare(0, 4, "tcp:") == 0)
+            fd = acceptTCP(source.substr(4), &errstr);
+        else if ((fd = open(source.c_str(), O_RDONLY)) < 0)
+            errstr = "error opening the live traces source";
+    }
+    if (fd < 0)
+        return;
+
+    unsigned char header[LiveTraces::HEADER_SIZE];
+    if (!readBytes(header, sizeof(header))) {
+        if (good())
+            errstr = "truncated live traces header";
+        return;
+    }
+    if (std::memcmp(header, LiveTraces::MAGIC, sizeof(LiveTraces::MAGIC)) !=
+        0) {
+        errstr = "not a live traces stream";
+        return;
+    }
+    if (header[4] != LiveTraces::VERSION) {
+        errstr = "unsupported live traces protocol version";
+        return;
+    }
+
+    eltTy = string(reinterpret_cast<const char *>(&header[5]), 2);
+    eltSize = eltTy[1] - '0';
+    const bool validSize =
+        eltTy[0] == 'f' ? eltSize == 4 || eltSize == 8
+                        : eltSize == 1 || eltSize == 2 || eltSize == 4 ||
+                              eltSize == 8;
+    if ((eltTy[0] != 'f' && eltTy[0] != 'i' && eltTy[0] != 'u') ||
+        !validSize) {
+        errstr = "unsupported live traces element type";
+        return;
+    }
+
+    numSamples = getU32(&header[8]);
+    numData = getU32(&header[12]);
+    row.resize(numData * sizeof(uint32_t) + numSamples * eltSize);
+}
+
+LiveTraceReader::~LiveTraceReader() {
+    if (ownFd && fd >= 0)
+        ::close(fd);
+}
+
+bool LiveTraceReader::readBytes(void *buf, size_t n) {
+    char *p = static_cast<char *>(buf);
+    while (n != 0) {
+        const ssize_t r = ::read(fd, p, n);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0) {
+            errstr = "error reading live traces";
+            return false;
+        }
+        if (r == 0)
+            return false;
+        p += r;
+        n -= r;
+    }
+    return true;
+}
+
+bool LiveTraceReader::nextRow() {
+    if (!good() || ended)
+        return false;
+
+    if (frameRows == 0) {
+        unsigned char count[4];
+        if (!readBytes(count, sizeof(count))) {
+            // The stream may simply be closed instead of being ended with an
+            // empty frame.
+            ended = true;
+            return false;
+        }
+        frameRows = getU32(count);
+        if (frameRows == 0) {
+            ended = true;
+            return false;
+        }
+    }
+
+    if (!readBytes(row.data(), row.size())) {
+        if (good())
+            errstr = "truncated live traces frame";
+        ended = true;
+        return false;
+    }
+    frameRows -= 1;
+    numTraces += 1;
+    return true;
+}
+
+LiveTraceWriter::LiveTraceWriter(ostream &os, const string &elt_ty,
+                                 size_t num_samples, size_t num_data)
+    : os(os), eltTy(elt_ty), numSamples(num_samples), numData(num_data) {
+    os.write(LiveTraces::MAGIC, sizeof(LiveTraces::MAGIC));
+    os.put(char(LiveTraces::VERSION));
+    os.write(eltTy.data(), 2);
+    os.put(0);
+    writeU32(numSamples);
+    writeU32(numData);
+}
+
+bool LiveTraceWriter::close() {
+    writeU32(0);
+    os.flush();
+    return bool(os);
+}
+
+void LiveTraceWriter::writeU32(uint32_t v) {
+    const char bytes[4] = {char(v), char(v >> 8), char(v >> 16),
+                           char(v >> 24)};
+    os.write(bytes, sizeof(bytes));
+}
+
+} // namespace PAF::SCA
@@ -0,0 +1,194 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/MetricsPowerDumper.h"
+#include "PAF/SCA/Expr.h"
+#include "PAF/SCA/ExprParser.h"
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/SCA.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace PAF::SCA {
+
+namespace {
+// The number of power traces fed at once to the accumulators, for which the
+// expressions are evaluated at once.
+constexpr size_t BATCH_ROWS = 256;
+} // namespace
+
+MetricsPowerDumper::MetricsPowerDumper(const string &filename,
+                                       const vector<string> &t_test_exprs,
+                                       const vector<string> &correl_exprs,
+                                       size_t num_data, size_t num_samples)
+    : filename(filename), tTestExprs(t_test_exprs), correlExprs(correl_exprs),
+      numData(num_data), numSamples(num_samples), currentData(num_data, 0),
+      batchData(BATCH_ROWS, num_data) {
+    // The expressions are compiled once: the context refers to batchData,
+    // which is never reallocated.
+    Expr::Context<uint32_t> context;
+    if (numData != 0)
+        context.addVariable("in", batchData.cbegin());
+    for (const auto *strs : {&tTestExprs, &correlExprs})
+        for (const string &str : *strs) {
+            Expr::Parser<uint32_t> parser(context, str);
+            exprs.emplace_back(parser.parse());
+            if (!exprs.back()) {
+                errstr = "error parsing an expression";
+                return;
+            }
+            program.add(*exprs.back());
+        }
+}
+
+MetricsPowerDumper::~MetricsPowerDumper() { close(); }
+
+void MetricsPowerDumper::setData(const vector<uint32_t> &data) {
+    std::fill(currentData.begin(), currentData.end(), 0);
+    std::copy_n(data.begin(), std::min(data.size(), numData),
+                currentData.begin());
+}
+
+void MetricsPowerDumper::nextTrace() {
+    // Power traces without samples, e.g. from an empty execution range, are
+    // not analyzed.
+    if (!good() || closed || current.empty())
+        return;
+
+    if (count == 0) {
+        if (numSamples == 0)
+            numSamples = current.size();
+        ttests.assign(tTestExprs.size(),
+                      TTestAccumulator<double>(numSamples));
+        correls = CorrelAccumulator<double>(numSamples, correlExprs.size());
+        batch = NPArray<double>(BATCH_ROWS, numSamples);
+    }
+
+    if (current.size() > numSamples) {
+        errstr = "power trace longer than the number of samples";
+        return;
+    }
+    current.resize(numSamples, 0.0);
+    std::copy(current.begin(), current.end(), &batch(batchRows, 0));
+    if (numData != 0)
+        std::copy(currentData.begin(), currentData.end(),
+                  &batchData(batchRows, 0));
+    current.clear();
+    count++;
+    if (++batchRows == BATCH_ROWS)
+        flush();
+}
+
+void MetricsPowerDumper::flush() {
+    if (batchRows == 0)
+        return;
+
+    const size_t n = batchRows;
+    const NPArrayView<double> traces(batch, 0, n, 0, numSamples);
+    vector<Expr::Value::ConcreteType> values(exprs.size() * n);
+    program.eval(values.data(), 0, n);
+    const Expr::Value::ConcreteType hwMask = uint32_t(-1);
+
+    // Classify the traces according to the Hamming weight of the t-test
+    // expressions' values.
+    vector<uint32_t> hws(n);
+    vector<Classification> classifier(n);
+    for (size_t i = 0; i < ttests.size(); i++) {
+        const uint32_t hw_max =
+            Expr::ValueType::getNumBits(exprs[i]->getType());
+        hamming_weight(hws.data(), &values[i * n], n, hwMask);
+        for (size_t t = 0; t < n; t++)
+            if (hws[t] < hw_max / 2)
+                classifier[t] = Classification::GROUP_0;
+            else if (hws[t] > hw_max / 2)
+                classifier[t] = Classification::GROUP_1;
+            else
+                classifier[t] = Classification::IGNORE;
+        ttests[i].add(traces, classifier);
+    }
+
+    // The intermediate values are the Hamming weights of the correlation
+    // expressions' values. The correlations with all of them are accumulated
+    // in a single pass over the traces.
+    if (correls.hypotheses() != 0) {
+        NPArray<double> ival(correls.hypotheses(), n);
+        for (size_t i = 0; i < correls.hypotheses(); i++)
+            hamming_weight(&ival(i, 0), &values[(ttests.size() + i) * n], n,
+                           hwMask);
+        correls.add(traces, ival);
+    }
+
+    batchRows = 0;
+}
+
+NPArray<double> MetricsPowerDumper::results() {
+    if (!good())
+        return {};
+    flush();
+
+    NPArray<double> res(0, numSamples);
+    for (const auto &tt : ttests) {
+        if (tt.count(Classification::GROUP_0) <= 1 ||
+            tt.count(Classification::GROUP_1) <= 1) {
+            errstr = "not enough power traces in a t-test group";
+            return {};
+        }
+        res = concatenate(res, tt.t_test(), NPArray<double>::COLUMN);
+    }
+    if (correls.hypotheses() != 0) {
+        if (correls.count() <= 1) {
+            errstr = "not enough power traces for the correlation";
+            return {};
+        }
+        res = concatenate(res, correls.correl(), NPArray<double>::COLUMN);
+    }
+    return res;
+}
+
+bool MetricsPowerDumper::close() {
+    if (closed)
+        return good();
+    closed = true;
+
+    if (!good())
+        return false;
+    if (count == 0) {
+        errstr = "no power trace to analyze";
+        return false;
+    }
+    const NPArray<double> res = results();
+    if (!good())
+        return false;
+    if (!res.save(filename)) {
+        errstr = "error writing the metrics";
+        return false;
+    }
+    return true;
+}
+
+} // namespace PAF::SCA
@@ -0,0 +1,193 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+
+#include "PAF/SCA/NPAllocator.h"
+#include "PAF/SCA/NPArray.h"
+#include "PAF/utils/Parallel.h"
+
+#include <cstdint>
+#include <new>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace PAF::SCA {
+
+namespace {
+/// The allocator returning all blocks to the heap.
+class HeapAllocator : public NPAllocator {
+  public:
+    [[nodiscard]] char *allocate(size_t num_bytes) override {
+        return heapAllocate(num_bytes);
+    }
+    void deallocate(char *p, size_t) noexcept override { heapDeallocate(p); }
+};
+
+/// Get \p num_bytes, rounded up to a multiple of the huge page size.
+size_t hugePageRound(size_t num_bytes) {
+    const size_t page = NPLargePageAllocator::HUGE_PAGE_SIZE;
+    return (num_bytes + page - 1) / page * page;
+}
+
+/// Map \p num_bytes bytes of anonymous memory, with huge pages from hugetlbfs
+/// if \p hugetlb is set and some are available, or else with transparent
+/// huge pages. Returns nullptr if the memory could not be mapped.
+char *mapLargeBlock(size_t num_bytes, bool hugetlb) {
+    const size_t page = NPLargePageAllocator::HUGE_PAGE_SIZE;
+    const int prot = PROT_READ | PROT_WRITE;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+    if (hugetlb) {
+        int hflags = flags | MAP_HUGETLB;
+#ifdef MAP_HUGE_2MB
+        hflags |= MAP_HUGE_2MB;
+#endif
+        void *p = mmap(nullptr, num_bytes, prot, hflags, -1, 0);
+        if (p != MAP_FAILED)
+            return static_cast<char *>(p);
+    }
+#else
+    (void)hugetlb;
+#endif
+
+    // Only the huge page aligned parts of a mapping can be backed by
+    // transparent huge pages: over-allocate, and trim the mapping to an
+    // aligned start.
+    void *p = mmap(nullptr, num_bytes + page, prot, flags, -1, 0);
+    if (p == MAP_FAILED)
+        return nullptr;
+    char *start = static_cast<char *>(p);
+    char *aligned = reinterpret_cast<char *>(
+        (reinterpret_cast<uintptr_t>(start) + page - 1) / page * page);
+    if (aligned != start)
+        munmap(start, aligned - start);
+    munmap(aligned + num_bytes, start + page - aligned);
+#ifdef MADV_HUGEPAGE
+    // This is only a hint, so failures are ignored.
+    madvise(aligned, num_bytes, MADV_HUGEPAGE);
+#endif
+    return aligned;
+}
+
+/// Touch the \p num_bytes bytes at \p p in parallel, in as many contiguous
+/// slices as the NPArray operations use threads, for the pages of each slice
+/// to be placed close to the thread touching them.
+void touchInParallel(char *p, size_t num_bytes) {
+    const size_t numThreads = NPArrayBase::numThreads();
+    if (numThreads <= 1)
+        return;
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    const size_t numPages = (num_bytes + pageSize - 1) / pageSize;
+    PAF::parallelFor(
+        0, numPages, (numPages + numThreads - 1) / numThreads,
+        [&](size_t b, size_t e) {
+            for (size_t i = b; i < e; i++)
+                p[i * pageSize] = 0;
+        },
+        numThreads);
+}
+} // namespace
+
+NPAllocator::~NPAllocator() {}
+
+NPAllocator &NPAllocator::heap() noexcept {
+    static HeapAllocator allocator;
+    return allocator;
+}
+
+char *NPAllocator::heapAllocate(size_t num_bytes) {
+    return static_cast<char *>(
+        ::operator new[](num_bytes, std::align_val_t(ALIGNMENT)));
+}
+
+void NPAllocator::heapDeallocate(char *p) noexcept {
+    ::operator delete[](p, std::align_val_t(ALIGNMENT));
+}
+
+NPPoolAllocator::~NPPoolAllocator() { release(); }
+
+char *NPPoolAllocator::allocate(size_t num_bytes) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = cache.find(num_bytes);
+        if (it != cache.end() && !it->second.empty()) {
+            char *p = it->second.back();
+            it->second.pop_back();
+            numCachedBytes -= num_bytes;
+            return p;
+        }
+    }
+    return heapAllocate(num_bytes);
+}
+
+void NPPoolAllocator::deallocate(char *p, size_t num_bytes) noexcept {
+    if (!p)
+        return;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (numCachedBytes + num_bytes <= maxCachedBytes) {
+            try {
+                cache[num_bytes].push_back(p);
+                numCachedBytes += num_bytes;
+                return;
+            } catch (...) {
+                // Fall back to releasing the block to the heap.
+            }
+        }
+    }
+    heapDeallocate(p);
+}
+
+size_t NPPoolAllocator::cachedBytes() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return numCachedBytes;
+}
+
+void NPPoolAllocator::release() noexcept {
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto &blocks : cache)
+        for (char *p : blocks.second)
+            heapDeallocate(p);
+    cache.clear();
+    numCachedBytes = 0;
+}
+
+char *NPLargePageAllocator::allocate(size_t num_bytes) {
+    if (!isMapped(num_bytes))
+        return heapAllocate(num_bytes);
+    char *p = mapLargeBlock(hugePageRound(num_bytes), hugeTLB);
+    if (!p)
+        throw std::bad_alloc();
+    if (firstTouch)
+        touchInParallel(p, num_bytes);
+    return p;
+}
+
+void NPLargePageAllocator::deallocate(char *p, size_t num_bytes) noexcept {
+    if (!p)
+        return;
+    if (isMapped(num_bytes))
+        munmap(p, hugePageRound(num_bytes));
+    else
+        heapDeallocate(p);
+}
+
+} // namespace PAF::SCA
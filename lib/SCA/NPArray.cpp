@@ -20,14 +20,24 @@
 
 #include "PAF/SCA/NPArray.h"
 #include "PAF/SCA/LWParser.h"
+#include "PAF/utils/Parallel.h"
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
+#include <functional>
 #include <memory>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 using std::array;
 using std::ifstream;
+using std::istream;
 using std::ofstream;
 using std::string;
 using std::string_view;
@@ -39,6 +49,11 @@ using PAF::SCA::LWParser;
 
 namespace {
 
+// The maximum number of threads the NPArray operations can use.
+std::atomic<unsigned> maxNumThreads{1};
+// The allocator used for the NPArray storage, or nullptr for the heap.
+std::atomic<PAF::SCA::NPAllocator *> storageAllocator{nullptr};
+
 bool parse_header(const string &header, string &descr, bool &fortran_order,
                   vector<size_t> &shape, const char **errstr) {
     LWParser H(header);
@@ -181,7 +196,7 @@ template <> const char *NPArrayBase::getEltTyDescr<int64_t>() { return "i8"; }
 template <> const char *NPArrayBase::getEltTyDescr<float>() { return "f4"; }
 template <> const char *NPArrayBase::getEltTyDescr<double>() { return "f8"; }
 
-bool NPArrayBase::getInformation(ifstream &ifs, unsigned &major,
+bool NPArrayBase::getInformation(istream &ifs, unsigned &major,
                                  unsigned &minor, string &descr,
                                  bool &fortran_order, vector<size_t> &shape,
                                  size_t &data_size, const char **errstr) {
@@ -191,6 +206,20 @@ bool NPArrayBase::getInformation(ifstream &ifs, unsigned &major,
         return false;
     }
 
+    // Compressed files embed the header of a plain NPY file.
+    if (streamFormat(ifs) != NPY) {
+        string header;
+        size_t l_data_size;
+        if (!getCompressedHeader(ifs, header, l_data_size, errstr))
+            return false;
+        std::istringstream iss(header);
+        if (!getInformation(iss, major, minor, descr, fortran_order, shape,
+                            data_size, errstr))
+            return false;
+        data_size = l_data_size;
+        return true;
+    }
+
     ifs.seekg(0, ifs.end);
     size_t actual_file_size = ifs.tellg();
 
@@ -252,17 +281,18 @@ bool NPArrayBase::getInformation(ifstream &ifs, unsigned &major,
     return true;
 }
 
-bool NPArrayBase::getInformation(ifstream &ifs, size_t &num_rows,
+bool NPArrayBase::getInformation(istream &ifs, size_t &num_rows,
                                  size_t &num_columns, string &elt_ty,
-                                 size_t &elt_size, const char **errstr) {
+                                 size_t &elt_size, const char **errstr,
+                                 bool *swap, bool *fortran_order) {
     unsigned major, minor;
-    bool fortran_order;
+    bool fortran;
     vector<size_t> shape;
     size_t data_size;
     string descr;
 
-    if (!NPArrayBase::getInformation(ifs, major, minor, descr, fortran_order,
-                                     shape, data_size, errstr))
+    if (!NPArrayBase::getInformation(ifs, major, minor, descr, fortran, shape,
+                                     data_size, errstr))
         return false;
 
     // Perform some validation that we can actually manage this specific npy
@@ -274,11 +304,16 @@ bool NPArrayBase::getInformation(ifstream &ifs, size_t &num_rows,
         return false;
     }
 
-    if (fortran_order) {
+    // The order does not matter for a single dimension array.
+    if (shape.size() == 1)
+        fortran = false;
+    if (fortran && !fortran_order) {
         if (errstr)
             *errstr = "fortran order not supported";
         return false;
     }
+    if (fortran_order)
+        *fortran_order = fortran;
 
     switch (shape.size()) {
     case 1:
@@ -308,11 +343,20 @@ bool NPArrayBase::getInformation(ifstream &ifs, size_t &num_rows,
         return false;
     }
 
-    if (descr[0] != '|' && descr[0] != native_endianness()) {
+    if (descr[0] != '|' && descr[0] != '<' && descr[0] != '>') {
+        if (errstr)
+            *errstr = "unexpected endianness found in descr";
+        return false;
+    }
+
+    const bool needs_swap = descr[0] != '|' && descr[0] != native_endianness();
+    if (needs_swap && !swap) {
         if (errstr)
             *errstr = "only native endianness is supported at the moment";
         return false;
     }
+    if (swap)
+        *swap = needs_swap;
 
     if (descr[2] < '0' || descr[2] > '9') {
         if (errstr)
@@ -331,7 +375,9 @@ bool NPArrayBase::getInformation(ifstream &ifs, size_t &num_rows,
     return true;
 }
 
-bool NPArrayBase::save(ofstream &os, string_view descr) const {
+bool NPArrayBase::saveHeader(std::ostream &os, string_view descr,
+                             size_t num_rows, size_t num_columns,
+                             bool fortran_order, size_t min_data_offset) {
     if (!os)
         return false;
 
@@ -349,11 +395,17 @@ bool NPArrayBase::save(ofstream &os, string_view descr) const {
         header += native_endianness();
     header += descr;
     header += "\',";
-    header += " 'fortran_order': False,";
+    header += " 'fortran_order': ";
+    header += fortran_order ? "True," : "False,";
     header += " 'shape': ";
-    header += shape(rows(), cols());
+    header += shape(num_rows, num_columns);
     header += '}';
-    header += string(63 - (header.size() + 10) % 64, ' ');
+    // The magic number, version and header size use 10 bytes, and the data
+    // have to start on a 64 bytes boundary.
+    size_t padding = 63 - (header.size() + 10) % 64;
+    while (header.size() + padding + 11 < min_data_offset)
+        padding += 64;
+    header += string(padding, ' ');
     header += '\n';
 
     // Write header size.
@@ -368,24 +420,77 @@ bool NPArrayBase::save(ofstream &os, string_view descr) const {
     // Write header.
     os.write(header.c_str(), header.size());
 
-    // And now write our data blob;
+    return bool(os);
+}
+
+bool NPArrayBase::saveData(ofstream &os) const {
+    if (!os)
+        return false;
+
     os.write(data.get(), size() * elementSize());
 
-    return true;
+    return bool(os);
+}
+
+unsigned NPArrayBase::numThreads() noexcept { return maxNumThreads; }
+
+void NPArrayBase::setNumThreads(unsigned num_threads) noexcept {
+    if (num_threads == 0)
+        num_threads = PAF::hardwareNumThreads();
+    maxNumThreads = num_threads;
+}
+
+void NPArrayBase::runParallel(
+    size_t begin, size_t end, size_t chunk,
+    const std::function<void(size_t, size_t)> &f) {
+    PAF::parallelFor(begin, end, chunk, f, numThreads());
+}
+
+NPAllocator &NPArrayBase::allocator() noexcept {
+    NPAllocator *a = storageAllocator;
+    return a ? *a : NPAllocator::heap();
+}
+
+void NPArrayBase::setAllocator(NPAllocator *allocator) noexcept {
+    storageAllocator = allocator;
+}
+
+bool NPArrayBase::save(ofstream &os, string_view descr,
+                       bool fortran_order) const {
+    if (!fortran_order)
+        return saveHeader(os, descr, rows(), cols()) && saveData(os);
+
+    // Fortran-order files store the transposed matrix.
+    NPArrayBase t(*this);
+    t.transpose();
+    return saveHeader(os, descr, rows(), cols(), /* fortran_order: */ true) &&
+           t.saveData(os);
 }
 
 // Save to file by name and descriptor (string_view overload)
-bool NPArrayBase::save(string_view filename, string_view descr) const {
+bool NPArrayBase::save(string_view filename, string_view descr,
+                       bool fortran_order) const {
+    switch (fileFormat(filename)) {
+    case NPY:
+        break;
+    case NPZ:
+        return saveNPZ(filename, descr, fortran_order);
+    case NPYZ:
+        return saveNPYZ(filename, descr);
+    case NPYT:
+        return saveNPYT(filename, descr);
+    }
+
     std::ofstream ofs(std::string(filename), ofstream::binary);
     if (!ofs)
         return false;
-    return save(ofs, std::string(descr));
+    return save(ofs, std::string(descr), fortran_order);
 }
 
 NPArrayBase::NPArrayBase(const std::vector<std::string> &filenames, Axis axis,
                          const char *expectedEltTy, size_t num_rows,
                          size_t num_columns, unsigned elt_size)
-    : data(new char[num_rows * num_columns * elt_size]), numRows(num_rows),
+    : data(allocate(num_rows * num_columns * elt_size)), numRows(num_rows),
       numColumns(num_columns), eltSize(elt_size), errstr(nullptr) {
     if (filenames.empty())
         return;
@@ -412,22 +517,34 @@ NPArrayBase::NPArrayBase(const std::vector<std::string> &filenames, Axis axis,
     }
 }
 
+void NPArrayBase::Deleter::operator()(char *p) const noexcept {
+    if (allocator) {
+        allocator->deallocate(p, length);
+        PAF::Stats::released(length, PAF::Stats::MEM_SCA);
+    } else if (isMapped())
+        munmap(p - mappingOffset, length);
+    else
+        delete[] p;
+}
+
 NPArrayBase::NPArrayBase(string_view filename, const char *expectedEltTy,
-                         size_t maxNumRows)
+                         const Window &window, LoadMode mode)
     : NPArrayBase() {
-    ifstream ifs(string(filename), ifstream::binary);
-    if (!ifs) {
-        errstr = "error opening file";
+    Window lw = window;
+    bool compressed;
+    unique_ptr<istream> is = openStream(filename, lw, &compressed, &errstr);
+    if (!is)
         return;
-    }
+    istream &ifs = *is;
 
     size_t l_num_rows;
     size_t l_num_columns;
     string l_elt_ty;
     size_t l_elt_size;
+    bool fortran;
 
     if (!getInformation(ifs, l_num_rows, l_num_columns, l_elt_ty, l_elt_size,
-                        &errstr))
+                        &errstr, nullptr, &fortran))
         return;
 
     // Some sanity checks.
@@ -436,24 +553,86 @@ NPArrayBase::NPArrayBase(string_view filename, const char *expectedEltTy,
         return;
     }
 
-    l_num_rows = std::min(maxNumRows, l_num_rows);
-    size_t num_bytes = l_num_rows * l_num_columns * l_elt_size;
-    data.reset(new char[num_bytes]);
-    ifs.read(data.get(), num_bytes);
-    numRows = l_num_rows;
-    numColumns = l_num_columns;
+    const Window w = lw.clamp(l_num_rows, l_num_columns);
+    const size_t offset = ifs.tellg();
+    const size_t row_bytes = l_num_columns * l_elt_size;
+    const bool full_rows = w.colBegin == 0 && w.cols() == l_num_columns;
+    const size_t num_bytes = w.rows() * w.cols() * l_elt_size;
+    if (fortran) {
+        // The file holds the transposed matrix, where each column of the
+        // window is a contiguous segment: read them as rows, and transpose
+        // them.
+        Storage t = allocate(num_bytes);
+        const size_t col_bytes = w.rows() * l_elt_size;
+        for (size_t c = 0; c < w.cols(); c++) {
+            const size_t col = w.colBegin + c * w.colStride;
+            ifs.seekg(offset + (col * l_num_rows + w.rowBegin) * l_elt_size);
+            ifs.read(&t[c * col_bytes], col_bytes);
+        }
+        data = allocate(num_bytes);
+        transpose(data.get(), t.get(), w.cols(), w.rows(), l_elt_size);
+    } else if (mode == MMAP && !compressed && full_rows && num_bytes != 0) {
+        // Map the header as well, as the data offset in the file is not
+        // guaranteed to be a multiple of the page size. The mapping is
+        // private, so that writes to the array are not propagated to the file.
+        const size_t data_offset = offset + w.rowBegin * row_bytes;
+        const int fd = open(string(filename).c_str(), O_RDONLY);
+        if (fd < 0) {
+            errstr = "error opening file for mapping";
+            return;
+        }
+        void *p = mmap(nullptr, data_offset + num_bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) {
+            errstr = "error mapping file";
+            return;
+        }
+        data = Storage(static_cast<char *>(p) + data_offset,
+                       Deleter(data_offset, data_offset + num_bytes));
+    } else if (full_rows) {
+        data = allocate(num_bytes);
+        ifs.seekg(offset + w.rowBegin * row_bytes);
+        ifs.read(data.get(), num_bytes);
+    } else {
+        // Only read the part of each row that covers the window, and pick the
+        // relevant columns from there.
+        data = allocate(num_bytes);
+        const size_t span_bytes = w.span() * l_elt_size;
+        unique_ptr<char[]> row(w.colStride == 1 ? nullptr
+                                                : new char[span_bytes]);
+        for (size_t r = w.rowBegin; r < w.rowEnd; r++) {
+            char *rdst = &data[(r - w.rowBegin) * w.cols() * l_elt_size];
+            ifs.seekg(offset + r * row_bytes + w.colBegin * l_elt_size);
+            ifs.read(row ? row.get() : rdst, span_bytes);
+            if (row)
+                for (size_t c = 0; c < w.cols(); c++)
+                    memcpy(&rdst[c * l_elt_size],
+                           &row[c * w.colStride * l_elt_size], l_elt_size);
+        }
+    }
+
+    if (!ifs) {
+        data.reset();
+        errstr = "error reading data from file";
+        return;
+    }
+
+    numRows = w.rows();
+    numColumns = w.cols();
     eltSize = l_elt_size;
+    PAF::Stats::add(PAF::Stats::BYTES_READ, num_bytes);
 }
 
 NPArrayBase::NPArrayBase(NPArrayBase &dest, size_t &index,
                          const string &filename, Axis axis,
                          const char *expectedEltTy, size_t expectedDimension)
     : NPArrayBase() {
-    ifstream ifs(filename, ifstream::binary);
-    if (!ifs) {
-        errstr = "error opening file";
+    Window window;
+    unique_ptr<istream> is = openStream(filename, window, nullptr, &errstr);
+    if (!is)
         return;
-    }
+    istream &ifs = *is;
 
     size_t l_num_rows;
     size_t l_num_columns;
@@ -510,57 +689,129 @@ NPArrayBase::NPArrayBase(NPArrayBase &dest, size_t &index,
     numRows = l_num_rows;
     numColumns = l_num_columns;
     eltSize = l_elt_size;
-    data = unique_ptr<char[]>(new char[numRows * numColumns * eltSize]);
+    data = allocate(numRows * numColumns * eltSize);
     ifs.read(data.get(), numRows * numColumns * eltSize);
 }
 
 NPArrayBase &NPArrayBase::insertRows(size_t row, size_t rows) {
     assert(row <= numRows && "Out of range row insertion");
-    unique_ptr<char[]> new_data(
-        new char[(numRows + rows) * numColumns * eltSize]);
-    if (row == 0) {
-        memcpy(&new_data[rows * numColumns * eltSize], data.get(),
-               numRows * numColumns * eltSize);
-    } else if (row == numRows) {
-        memcpy(new_data.get(), data.get(), numRows * numColumns * eltSize);
+    const size_t row_bytes = numColumns * eltSize;
+    const size_t num_bytes = (numRows + rows) * row_bytes;
+    const size_t tail_bytes = (numRows - row) * row_bytes;
+    if (num_bytes <= capacityBytes()) {
+        // There is enough room in the current storage: only move the rows
+        // after the insertion point.
+        if (tail_bytes != 0)
+            memmove(&data[(row + rows) * row_bytes], &data[row * row_bytes],
+                    tail_bytes);
     } else {
-        memcpy(new_data.get(), data.get(), row * numColumns * eltSize);
-        memcpy(&new_data[(row + rows) * numColumns * eltSize],
-               &data[row * numColumns * eltSize],
-               (numRows - row) * numColumns * eltSize);
+        Storage new_data = allocate(growCapacity(num_bytes));
+        if (row != 0)
+            memcpy(new_data.get(), data.get(), row * row_bytes);
+        if (tail_bytes != 0)
+            memcpy(&new_data[(row + rows) * row_bytes], &data[row * row_bytes],
+                   tail_bytes);
+        data = std::move(new_data);
     }
-    data = std::move(new_data);
     numRows += rows;
     return *this;
 }
 
 NPArrayBase &NPArrayBase::insertColumns(size_t col, size_t cols) {
     assert(col <= numColumns && "Out of range column insertion");
-    unique_ptr<char[]> new_data(
-        new char[numRows * (numColumns + cols) * eltSize]);
-    if (col == 0) {
-        for (size_t row = 0; row < numRows; row++)
-            memcpy(&new_data[(row * (numColumns + cols) + cols) * eltSize],
-                   &data[row * numColumns * eltSize], numColumns * eltSize);
-    } else if (col == numColumns) {
-        for (size_t row = 0; row < numRows; row++)
-            memcpy(&new_data[row * (numColumns + cols) * eltSize],
-                   &data[row * numColumns * eltSize], numColumns * eltSize);
+    const size_t old_row_bytes = numColumns * eltSize;
+    const size_t new_row_bytes = (numColumns + cols) * eltSize;
+    const size_t head_bytes = col * eltSize;
+    const size_t tail_bytes = (numColumns - col) * eltSize;
+    const size_t num_bytes = numRows * new_row_bytes;
+    if (num_bytes <= capacityBytes()) {
+        // There is enough room in the current storage: spread the rows, from
+        // the last one to the first one so that no row is overwritten before
+        // it has been moved.
+        for (size_t row = numRows; row-- > 0;) {
+            char *src = &data[row * old_row_bytes];
+            char *dst = &data[row * new_row_bytes];
+            memmove(dst + head_bytes + cols * eltSize, src + head_bytes,
+                    tail_bytes);
+            memmove(dst, src, head_bytes);
+        }
     } else {
+        Storage new_data = allocate(growCapacity(num_bytes));
         for (size_t row = 0; row < numRows; row++) {
-            memcpy(&new_data[row * (numColumns + cols) * eltSize],
-                   &data[row * numColumns * eltSize], col * eltSize);
-            memcpy(
-                &new_data[(row * (numColumns + cols) + col + cols) * eltSize],
-                &data[(row * numColumns + col) * eltSize],
-                (numColumns - col) * eltSize);
+            const char *src = &data[row * old_row_bytes];
+            char *dst = &new_data[row * new_row_bytes];
+            memcpy(dst, src, head_bytes);
+            memcpy(dst + head_bytes + cols * eltSize, src + head_bytes,
+                   tail_bytes);
         }
+        data = std::move(new_data);
     }
-    data = std::move(new_data);
     numColumns += cols;
     return *this;
 }
 
+namespace {
+// Transpose the num_rows x num_columns matrix src into dst, tile by tile. The
+// tiles are small enough that a tile row from src and a tile column from dst
+// stay in the cache while the tile is processed.
+template <typename Ty>
+void blockedTranspose(Ty *dst, const Ty *src, size_t num_rows,
+                      size_t num_columns) noexcept {
+    constexpr size_t TILE = 32;
+    for (size_t rb = 0; rb < num_rows; rb += TILE) {
+        const size_t re = std::min(rb + TILE, num_rows);
+        for (size_t cb = 0; cb < num_columns; cb += TILE) {
+            const size_t ce = std::min(cb + TILE, num_columns);
+            for (size_t r = rb; r < re; r++)
+                for (size_t c = cb; c < ce; c++)
+                    dst[c * num_rows + r] = src[r * num_columns + c];
+        }
+    }
+}
+} // namespace
+
+void NPArrayBase::transpose(char *dst, const char *src, size_t num_rows,
+                            size_t num_columns, size_t elt_size) noexcept {
+    switch (elt_size) {
+    case 1:
+        blockedTranspose(reinterpret_cast<uint8_t *>(dst),
+                         reinterpret_cast<const uint8_t *>(src), num_rows,
+                         num_columns);
+        break;
+    case 2:
+        blockedTranspose(reinterpret_cast<uint16_t *>(dst),
+                         reinterpret_cast<const uint16_t *>(src), num_rows,
+                         num_columns);
+        break;
+    case 4:
+        blockedTranspose(reinterpret_cast<uint32_t *>(dst),
+                         reinterpret_cast<const uint32_t *>(src), num_rows,
+                         num_columns);
+        break;
+    case 8:
+        blockedTranspose(reinterpret_cast<uint64_t *>(dst),
+                         reinterpret_cast<const uint64_t *>(src), num_rows,
+                         num_columns);
+        break;
+    default:
+        for (size_t r = 0; r < num_rows; r++)
+            for (size_t c = 0; c < num_columns; c++)
+                memcpy(&dst[(c * num_rows + r) * elt_size],
+                       &src[(r * num_columns + c) * elt_size], elt_size);
+        break;
+    }
+}
+
+NPArrayBase &NPArrayBase::transpose() {
+    if (numRows > 1 && numColumns > 1) {
+        Storage t = allocate(size() * eltSize);
+        transpose(t.get(), data.get(), numRows, numColumns, eltSize);
+        data = std::move(t);
+    }
+    std::swap(numRows, numColumns);
+    return *this;
+}
+
 NPArrayBase &NPArrayBase::extend(const NPArrayBase &other, Axis axis) {
     assert(elementSize() == other.elementSize() &&
            "element size difference in extend");
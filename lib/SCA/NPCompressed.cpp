@@ -0,0 +1,1048 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/NPArray.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <zlib.h>
+
+using std::ifstream;
+using std::istream;
+using std::ofstream;
+using std::string;
+using std::string_view;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// NPYZ files start with this magic, followed by the format version (major,
+// minor) and a reserved byte. The rest of the fixed size header holds, as 64
+// bits little endian integers, the number of rows per block, the number of
+// blocks, the size of the uncompressed data and the size of the NPY header
+// that follows. The NPY header is followed by the index of the blocks (the
+// offset in the file of each block and its compressed size), and then by the
+// zlib compressed blocks.
+const std::array<char, 5> NPYZ_MAGIC = {'\x93', 'N', 'P', 'Y', 'Z'};
+constexpr size_t NPYZ_HEADER_SIZE = 40;
+
+// The default uncompressed size of an NPYZ block.
+constexpr size_t NPYZ_BLOCK_SIZE = 1 << 20;
+
+// NPYT files start with this magic, followed by the format version (major,
+// minor) and a reserved byte. The rest of the fixed size header holds, as 64
+// bits little endian integers, the number of rows and columns per tile, the
+// number of tiles, the size of the matrix data and the size of the NPY header
+// that follows. The NPY header is followed by the index of the tiles (the
+// offset in the file of each tile and its stored size), in row major order of
+// the tiles grid, and then by the tiles. Each tile holds its elements in
+// column major order, and is zlib compressed unless its stored size is its
+// uncompressed size.
+const std::array<char, 5> NPYT_MAGIC = {'\x93', 'N', 'P', 'Y', 'T'};
+constexpr size_t NPYT_HEADER_SIZE = 48;
+
+// The default NPYT tile size: 4096 traces x 256 samples.
+constexpr size_t NPYT_TILE_ROWS = 4096;
+constexpr size_t NPYT_TILE_COLS = 256;
+
+// The zip records signatures.
+const char ZIP_LOCAL_HEADER[] = {'P', 'K', 3, 4};
+const char ZIP_CENTRAL_HEADER[] = {'P', 'K', 1, 2};
+const char ZIP_END_OF_CENTRAL_DIR[] = {'P', 'K', 5, 6};
+const char ZIP64_END_OF_CENTRAL_DIR[] = {'P', 'K', 6, 6};
+const char ZIP64_END_OF_CENTRAL_DIR_LOCATOR[] = {'P', 'K', 6, 7};
+
+// The name of the array in NPZ archives written by numpy.savez_compressed.
+const char NPZ_ENTRY_NAME[] = "arr_0.npy";
+
+// The largest amount of data passed to zlib in one call.
+constexpr size_t ZLIB_MAX_CHUNK = 1 << 30;
+
+bool fail(const char **errstr, const char *msg) {
+    if (errstr)
+        *errstr = msg;
+    return false;
+}
+
+// Get the \p n bytes little endian integer at \p p.
+uint64_t getLE(const char *p, size_t n) {
+    uint64_t v = 0;
+    for (size_t i = n; i-- > 0;)
+        v = (v << 8) | uint8_t(p[i]);
+    return v;
+}
+
+// Append \p v to \p s, as an \p n bytes little endian integer.
+void putLE(string &s, uint64_t v, size_t n) {
+    for (size_t i = 0; i < n; i++, v >>= 8)
+        s += char(v & 0xFF);
+}
+
+// A read-only stream buffer over an in memory file.
+class MemoryBuf : public std::streambuf {
+  public:
+    explicit MemoryBuf(string &&buf) : buf(std::move(buf)) {
+        char *b = this->buf.data();
+        setg(b, b, b + this->buf.size());
+    }
+
+  protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                     std::ios_base::openmode which) override {
+        char *base = dir == std::ios_base::beg   ? eback()
+                     : dir == std::ios_base::cur ? gptr()
+                                                 : egptr();
+        if (off < eback() - base || off > egptr() - base)
+            return pos_type(off_type(-1));
+        setg(eback(), base + off, egptr());
+        return pos_type(gptr() - eback());
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+  private:
+    string buf;
+};
+
+// An input stream over an in memory file.
+class MemoryStream : public istream {
+  public:
+    explicit MemoryStream(string &&buf) : istream(nullptr), sb(std::move(buf)) {
+        rdbuf(&sb);
+    }
+
+  private:
+    MemoryBuf sb;
+};
+
+// Read \p n bytes at \p offset in \p is into \p buf.
+bool readAt(istream &is, size_t offset, char *buf, size_t n) {
+    is.clear();
+    is.seekg(offset);
+    is.read(buf, n);
+    return bool(is);
+}
+
+// The location and size of an entry in a zip archive.
+struct ZipEntry {
+    uint16_t method;
+    uint32_t crc;
+    uint64_t compressedSize;
+    uint64_t uncompressedSize;
+    uint64_t dataOffset;
+};
+
+// Find the first entry of the zip archive in \p is, using the central
+// directory as the local headers may not hold the entries' sizes.
+bool findZipEntry(istream &is, ZipEntry &entry, const char **errstr) {
+    is.clear();
+    is.seekg(0, std::ios_base::end);
+    const size_t size = is.tellg();
+    if (size < 22)
+        return fail(errstr, "NPZ archive too short");
+
+    // The end of central directory record is at the end of the archive,
+    // only followed by a comment of at most 64KB. It may be preceded by the
+    // zip64 locator.
+    const size_t tail = std::min<size_t>(size, 20 + 22 + 0xFFFF);
+    vector<char> buf(tail);
+    if (!readAt(is, size - tail, buf.data(), tail))
+        return fail(errstr, "error reading NPZ archive");
+    size_t eocd = tail - 22;
+    while (memcmp(&buf[eocd], ZIP_END_OF_CENTRAL_DIR, 4) != 0) {
+        if (eocd == 0)
+            return fail(errstr, "NPZ end of central directory not found");
+        eocd -= 1;
+    }
+
+    uint64_t num_entries = getLE(&buf[eocd + 10], 2);
+    uint64_t cd_offset = getLE(&buf[eocd + 16], 4);
+    if (num_entries == 0xFFFF || cd_offset == 0xFFFFFFFF) {
+        if (eocd < 20 ||
+            memcmp(&buf[eocd - 20], ZIP64_END_OF_CENTRAL_DIR_LOCATOR, 4) != 0)
+            return fail(errstr, "NPZ zip64 locator not found");
+        char eocd64[56];
+        const size_t eocd64_offset = getLE(&buf[eocd - 20 + 8], 8);
+        if (!readAt(is, eocd64_offset, eocd64, sizeof(eocd64)) ||
+            memcmp(eocd64, ZIP64_END_OF_CENTRAL_DIR, 4) != 0)
+            return fail(errstr, "NPZ zip64 end of central directory not found");
+        num_entries = getLE(&eocd64[32], 8);
+        cd_offset = getLE(&eocd64[48], 8);
+    }
+    if (num_entries == 0)
+        return fail(errstr, "empty NPZ archive");
+
+    char cd[46];
+    if (!readAt(is, cd_offset, cd, sizeof(cd)) ||
+        memcmp(cd, ZIP_CENTRAL_HEADER, 4) != 0)
+        return fail(errstr, "NPZ central directory not found");
+    if (getLE(&cd[8], 2) & 1)
+        return fail(errstr, "encrypted NPZ archives are not supported");
+    entry.method = getLE(&cd[10], 2);
+    entry.crc = getLE(&cd[16], 4);
+    entry.compressedSize = getLE(&cd[20], 4);
+    entry.uncompressedSize = getLE(&cd[24], 4);
+    uint64_t local_offset = getLE(&cd[42], 4);
+
+    // The zip64 extra field holds the sizes and offset which do not fit in
+    // the central directory record.
+    const size_t name_len = getLE(&cd[28], 2);
+    const size_t extra_len = getLE(&cd[30], 2);
+    vector<char> extra(extra_len);
+    if (!readAt(is, cd_offset + sizeof(cd) + name_len, extra.data(),
+                extra_len))
+        return fail(errstr, "error reading NPZ central directory");
+    for (size_t pos = 0; pos + 4 <= extra_len;) {
+        const size_t id = getLE(&extra[pos], 2);
+        const size_t len = getLE(&extra[pos + 2], 2);
+        if (id == 1) {
+            size_t q = pos + 4;
+            for (uint64_t *v : {&entry.uncompressedSize, &entry.compressedSize,
+                                &local_offset})
+                if (*v == 0xFFFFFFFF && q + 8 <= pos + 4 + len) {
+                    *v = getLE(&extra[q], 8);
+                    q += 8;
+                }
+        }
+        pos += 4 + len;
+    }
+
+    char local[30];
+    if (!readAt(is, local_offset, local, sizeof(local)) ||
+        memcmp(local, ZIP_LOCAL_HEADER, 4) != 0)
+        return fail(errstr, "NPZ local header not found");
+    entry.dataOffset = local_offset + sizeof(local) + getLE(&local[26], 2) +
+                       getLE(&local[28], 2);
+    if (entry.dataOffset + entry.compressedSize > size)
+        return fail(errstr, "NPZ archive too short");
+
+    if (entry.method != Z_NO_COMPRESSION && entry.method != Z_DEFLATED)
+        return fail(errstr, "unsupported NPZ compression method");
+
+    return true;
+}
+
+// Decompress the first \p len bytes of zip \p entry from \p is into \p dst.
+bool readZipEntry(istream &is, const ZipEntry &entry, char *dst, size_t len,
+                  const char **errstr) {
+    if (len > entry.uncompressedSize)
+        return fail(errstr, "NPZ entry too short");
+
+    if (entry.method == Z_NO_COMPRESSION) {
+        if (!readAt(is, entry.dataOffset, dst, len))
+            return fail(errstr, "error reading NPZ entry");
+        return true;
+    }
+
+    z_stream zs{};
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+        return fail(errstr, "error initializing decompression");
+
+    is.clear();
+    is.seekg(entry.dataOffset);
+    vector<char> in(64 * 1024);
+    size_t remaining = entry.compressedSize;
+    size_t produced = 0;
+    int ret = Z_OK;
+    while (produced < len && ret == Z_OK) {
+        if (zs.avail_in == 0 && remaining != 0) {
+            const size_t n = std::min(remaining, in.size());
+            if (!is.read(in.data(), n))
+                break;
+            remaining -= n;
+            zs.next_in = reinterpret_cast<Bytef *>(in.data());
+            zs.avail_in = n;
+        }
+        zs.next_out = reinterpret_cast<Bytef *>(dst + produced);
+        zs.avail_out = std::min(len - produced, ZLIB_MAX_CHUNK);
+        ret = inflate(&zs, Z_NO_FLUSH);
+        produced = reinterpret_cast<char *>(zs.next_out) - dst;
+    }
+    inflateEnd(&zs);
+
+    if (produced != len)
+        return fail(errstr, "error decompressing NPZ entry");
+    return true;
+}
+
+// Compute the CRC32 of the \p len bytes at \p p.
+uint32_t crc(const char *p, size_t len) {
+    uLong c = crc32(0L, Z_NULL, 0);
+    for (size_t i = 0; i < len; i += ZLIB_MAX_CHUNK)
+        c = crc32(c, reinterpret_cast<const Bytef *>(p + i),
+                  std::min(len - i, ZLIB_MAX_CHUNK));
+    return c;
+}
+
+// Deflate (without the zlib wrapper) the \p len bytes at \p p into \p out.
+bool deflateRaw(const char *p, size_t len, string &out) {
+    z_stream zs{};
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    out.resize(deflateBound(&zs, len));
+    size_t consumed = 0;
+    size_t produced = 0;
+    int ret = Z_OK;
+    while (ret == Z_OK) {
+        zs.next_in =
+            reinterpret_cast<Bytef *>(const_cast<char *>(p + consumed));
+        zs.avail_in = std::min(len - consumed, ZLIB_MAX_CHUNK);
+        zs.next_out = reinterpret_cast<Bytef *>(&out[produced]);
+        zs.avail_out = std::min(out.size() - produced, ZLIB_MAX_CHUNK);
+        const bool last = consumed + zs.avail_in == len;
+        ret = deflate(&zs, last ? Z_FINISH : Z_NO_FLUSH);
+        consumed = reinterpret_cast<const char *>(zs.next_in) - p;
+        produced = reinterpret_cast<char *>(zs.next_out) - out.data();
+    }
+    deflateEnd(&zs);
+
+    out.resize(produced);
+    return ret == Z_STREAM_END;
+}
+
+// The fixed size header of an NPYZ file.
+struct NPYZHeader {
+    uint64_t blockRows;    // Number of rows per block.
+    uint64_t numBlocks;    // Number of blocks.
+    uint64_t dataSize;     // Size of the uncompressed data.
+    uint64_t headerLength; // Size of the NPY header.
+};
+
+// Read the fixed size header of the NPYZ file in \p is, and the NPY header
+// that follows it into \p npy_header.
+bool readNPYZHeader(istream &is, NPYZHeader &hdr, string &npy_header,
+                    const char **errstr) {
+    char buf[NPYZ_HEADER_SIZE];
+    if (!readAt(is, 0, buf, sizeof(buf)) ||
+        memcmp(buf, NPYZ_MAGIC.data(), NPYZ_MAGIC.size()) != 0)
+        return fail(errstr, "wrong NPYZ magic");
+    if (buf[5] != 1 || buf[6] != 0)
+        return fail(errstr, "unsupported NPYZ format version");
+
+    hdr.blockRows = getLE(&buf[8], 8);
+    hdr.numBlocks = getLE(&buf[16], 8);
+    hdr.dataSize = getLE(&buf[24], 8);
+    hdr.headerLength = getLE(&buf[32], 8);
+    if (hdr.blockRows == 0 || hdr.headerLength > 1 << 17)
+        return fail(errstr, "inconsistent NPYZ header");
+
+    npy_header.resize(hdr.headerLength);
+    if (!is.read(npy_header.data(), npy_header.size()))
+        return fail(errstr, "error reading NPYZ header");
+    return true;
+}
+
+// The fixed size header of an NPYT file.
+struct NPYTHeader {
+    uint64_t tileRows;     // Number of rows per tile.
+    uint64_t tileCols;     // Number of columns per tile.
+    uint64_t numTiles;     // Number of tiles.
+    uint64_t dataSize;     // Size of the matrix data.
+    uint64_t headerLength; // Size of the NPY header.
+};
+
+// Read the fixed size header of the NPYT file in \p is, and the NPY header
+// that follows it into \p npy_header.
+bool readNPYTHeader(istream &is, NPYTHeader &hdr, string &npy_header,
+                    const char **errstr) {
+    char buf[NPYT_HEADER_SIZE];
+    if (!readAt(is, 0, buf, sizeof(buf)) ||
+        memcmp(buf, NPYT_MAGIC.data(), NPYT_MAGIC.size()) != 0)
+        return fail(errstr, "wrong NPYT magic");
+    if (buf[5] != 1 || buf[6] != 0)
+        return fail(errstr, "unsupported NPYT format version");
+
+    hdr.tileRows = getLE(&buf[8], 8);
+    hdr.tileCols = getLE(&buf[16], 8);
+    hdr.numTiles = getLE(&buf[24], 8);
+    hdr.dataSize = getLE(&buf[32], 8);
+    hdr.headerLength = getLE(&buf[40], 8);
+    if (hdr.tileRows == 0 || hdr.tileCols == 0 || hdr.headerLength > 1 << 17)
+        return fail(errstr, "inconsistent NPYT header");
+
+    npy_header.resize(hdr.headerLength);
+    if (!is.read(npy_header.data(), npy_header.size()))
+        return fail(errstr, "error reading NPYT header");
+    return true;
+}
+
+// Copy the \p num_rows x \p num_cols elements of \p N bytes of the matrix at
+// \p matrix, which rows are \p matrix_stride bytes apart, to the column major
+// tile at \p tile, which columns are \p tile_stride bytes apart, if \p gather
+// is set, or the other way round.
+template <size_t N>
+void copyTile(bool gather, char *matrix, size_t matrix_stride, char *tile,
+              size_t tile_stride, size_t num_rows, size_t num_cols) {
+    // Proceed by small blocks, so that the strided accesses stay in cache.
+    constexpr size_t B = 32;
+    for (size_t rb = 0; rb < num_rows; rb += B)
+        for (size_t cb = 0; cb < num_cols; cb += B) {
+            const size_t re = std::min(rb + B, num_rows);
+            const size_t ce = std::min(cb + B, num_cols);
+            if (gather) {
+                for (size_t c = cb; c < ce; c++)
+                    for (size_t r = rb; r < re; r++)
+                        memcpy(&tile[c * tile_stride + r * N],
+                               &matrix[r * matrix_stride + c * N], N);
+            } else {
+                for (size_t r = rb; r < re; r++)
+                    for (size_t c = cb; c < ce; c++)
+                        memcpy(&matrix[r * matrix_stride + c * N],
+                               &tile[c * tile_stride + r * N], N);
+            }
+        }
+}
+
+// Dispatch copyTile on \p elt_size.
+void copyTile(bool gather, char *matrix, size_t matrix_stride, char *tile,
+              size_t tile_stride, size_t num_rows, size_t num_cols,
+              size_t elt_size) {
+    switch (elt_size) {
+    case 1:
+        return copyTile<1>(gather, matrix, matrix_stride, tile, tile_stride,
+                           num_rows, num_cols);
+    case 2:
+        return copyTile<2>(gather, matrix, matrix_stride, tile, tile_stride,
+                           num_rows, num_cols);
+    case 4:
+        return copyTile<4>(gather, matrix, matrix_stride, tile, tile_stride,
+                           num_rows, num_cols);
+    case 8:
+        return copyTile<8>(gather, matrix, matrix_stride, tile, tile_stride,
+                           num_rows, num_cols);
+    default:
+        // Any other element size, byte by byte.
+        for (size_t r = 0; r < num_rows; r++)
+            for (size_t c = 0; c < num_cols; c++)
+                for (size_t b = 0; b < elt_size; b++) {
+                    char &m = matrix[r * matrix_stride + c * elt_size + b];
+                    char &t = tile[c * tile_stride + r * elt_size + b];
+                    if (gather)
+                        t = m;
+                    else
+                        m = t;
+                }
+    }
+}
+
+// Open the NPYT file in \p is for reading the \p window region of its matrix,
+// and return an in memory NPY file holding the rows of \p window, restricted
+// to the columns it spans, with \p window updated to designate the same
+// region in it.
+unique_ptr<istream> openNPYT(istream &is, PAF::SCA::NPArrayBase::Window &window,
+                             const char **errstr) {
+    using PAF::SCA::NPArrayBase;
+    size_t num_rows;
+    size_t num_columns;
+    string elt_ty;
+    size_t elt_size;
+    bool swap;
+    if (!NPArrayBase::getInformation(is, num_rows, num_columns, elt_ty,
+                                     elt_size, errstr, &swap))
+        return nullptr;
+    if (swap) {
+        fail(errstr, "only native endianness is supported for NPYT files");
+        return nullptr;
+    }
+
+    NPYTHeader hdr;
+    string npy_header;
+    if (!readNPYTHeader(is, hdr, npy_header, errstr))
+        return nullptr;
+    const size_t grid_rows = (num_rows + hdr.tileRows - 1) / hdr.tileRows;
+    const size_t grid_cols = (num_columns + hdr.tileCols - 1) / hdr.tileCols;
+    if (hdr.numTiles != grid_rows * grid_cols) {
+        fail(errstr, "inconsistent NPYT index");
+        return nullptr;
+    }
+
+    // Find the tiles covering the window.
+    const NPArrayBase::Window w = window.clamp(num_rows, num_columns);
+    const size_t col_end = w.colBegin + w.span();
+    const size_t first_tr = w.rowBegin / hdr.tileRows;
+    const size_t end_tr = w.rows() == 0 ? first_tr
+                                        : (w.rowEnd + hdr.tileRows - 1) /
+                                              hdr.tileRows;
+    const size_t first_tc = w.colBegin / hdr.tileCols;
+    const size_t end_tc =
+        w.cols() == 0 ? first_tc : (col_end + hdr.tileCols - 1) / hdr.tileCols;
+
+    // With a column stride, some tile columns may not hold any of the window
+    // columns: they do not need to be read.
+    const auto needed = [&](size_t tc) {
+        const size_t b = std::max(tc * hdr.tileCols, w.colBegin);
+        const size_t c = w.colBegin + (b - w.colBegin + w.colStride - 1) /
+                                          w.colStride * w.colStride;
+        return c < std::min((tc + 1) * hdr.tileCols, col_end);
+    };
+
+    // Read the index of the tiles rows covering the window, and then the
+    // part of the needed tiles that covers the window. As the tiles are
+    // column major, this is the window columns for uncompressed tiles.
+    vector<char> index(16 * (end_tr - first_tr) * grid_cols);
+    if (!readAt(is,
+                NPYT_HEADER_SIZE + hdr.headerLength + 16 * first_tr * grid_cols,
+                index.data(), index.size())) {
+        fail(errstr, "error reading NPYT index");
+        return nullptr;
+    }
+    struct Tile {
+        size_t row;        // First row of the tile.
+        size_t col;        // First column of the tile.
+        size_t rows;       // Number of rows in the tile.
+        size_t cols;       // Number of columns in the tile.
+        size_t firstCol;   // First column read, for uncompressed tiles.
+        bool isCompressed; // Is this tile compressed ?
+        string stored;     // The tile content, as read from the file.
+    };
+    vector<Tile> tiles;
+    for (size_t tr = first_tr; tr < end_tr; tr++)
+        for (size_t tc = first_tc; tc < end_tc; tc++) {
+            if (!needed(tc))
+                continue;
+            const char *entry = &index[16 * ((tr - first_tr) * grid_cols + tc)];
+            Tile t;
+            t.row = tr * hdr.tileRows;
+            t.col = tc * hdr.tileCols;
+            t.rows = std::min<size_t>(hdr.tileRows, num_rows - t.row);
+            t.cols = std::min<size_t>(hdr.tileCols, num_columns - t.col);
+            size_t offset = getLE(entry, 8);
+            size_t size = getLE(&entry[8], 8);
+            t.isCompressed = size != t.rows * t.cols * elt_size;
+            t.firstCol = t.isCompressed ? t.col : std::max(t.col, w.colBegin);
+            if (!t.isCompressed) {
+                const size_t col_bytes = t.rows * elt_size;
+                offset += (t.firstCol - t.col) * col_bytes;
+                size = (std::min(t.col + t.cols, col_end) - t.firstCol) *
+                       col_bytes;
+            }
+            t.stored.resize(size);
+            if (!readAt(is, offset, t.stored.data(), size)) {
+                fail(errstr, "error reading NPYT tile");
+                return nullptr;
+            }
+            tiles.push_back(std::move(t));
+        }
+
+    std::ostringstream oss;
+    if (!NPArrayBase::saveHeader(oss, elt_ty, w.rows(), w.span())) {
+        fail(errstr, "error creating NPY header");
+        return nullptr;
+    }
+    string image = oss.str();
+    const size_t data_offset = image.size();
+    const size_t row_bytes = w.span() * elt_size;
+    image.resize(data_offset + w.rows() * row_bytes);
+
+    // Decompress the tiles, and copy their part covering the window to the
+    // image, in parallel.
+    std::atomic<bool> ok{true};
+    NPArrayBase::parallelFor(
+        0, tiles.size(), hdr.tileRows * hdr.tileCols,
+        [&](size_t tb, size_t te) {
+            string buf;
+            for (size_t i = tb; i < te; i++) {
+                Tile &t = tiles[i];
+                string *tile = &t.stored;
+                if (t.isCompressed) {
+                    uLongf len = t.rows * t.cols * elt_size;
+                    buf.resize(len);
+                    if (uncompress(reinterpret_cast<Bytef *>(buf.data()), &len,
+                                   reinterpret_cast<const Bytef *>(
+                                       t.stored.data()),
+                                   t.stored.size()) != Z_OK ||
+                        len != buf.size()) {
+                        ok = false;
+                        continue;
+                    }
+                    tile = &buf;
+                }
+                const size_t rb = std::max(t.row, w.rowBegin);
+                const size_t re = std::min(t.row + t.rows, w.rowEnd);
+                const size_t cb = std::max(t.col, w.colBegin);
+                const size_t ce = std::min(t.col + t.cols, col_end);
+                const size_t col_bytes = t.rows * elt_size;
+                copyTile(/* gather: */ false,
+                         &image[data_offset + (rb - w.rowBegin) * row_bytes +
+                                (cb - w.colBegin) * elt_size],
+                         row_bytes,
+                         &(*tile)[(cb - t.firstCol) * col_bytes +
+                                  (rb - t.row) * elt_size],
+                         col_bytes, re - rb, ce - cb, elt_size);
+            }
+        });
+    if (!ok) {
+        fail(errstr, "error decompressing NPYT tile");
+        return nullptr;
+    }
+
+    window = NPArrayBase::Window(0, w.rows(), 0, w.span(), w.colStride);
+    return unique_ptr<istream>(new MemoryStream(std::move(image)));
+}
+
+} // namespace
+
+namespace PAF::SCA {
+
+NPArrayBase::Format NPArrayBase::fileFormat(string_view filename) noexcept {
+    const auto hasExtension = [&](string_view ext) {
+        return filename.size() >= ext.size() &&
+               filename.substr(filename.size() - ext.size()) == ext;
+    };
+    if (hasExtension(".npz"))
+        return NPZ;
+    if (hasExtension(".npyz"))
+        return NPYZ;
+    if (hasExtension(".npyt"))
+        return NPYT;
+    return NPY;
+}
+
+NPArrayBase::Format NPArrayBase::streamFormat(istream &is) {
+    char magic[NPYZ_MAGIC.size()];
+    is.clear();
+    is.seekg(0);
+    is.read(magic, sizeof(magic));
+    const bool complete = is.gcount() == sizeof(magic);
+    is.clear();
+    is.seekg(0);
+
+    if (complete && memcmp(magic, ZIP_LOCAL_HEADER, 4) == 0)
+        return NPZ;
+    if (complete && memcmp(magic, NPYZ_MAGIC.data(), sizeof(magic)) == 0)
+        return NPYZ;
+    if (complete && memcmp(magic, NPYT_MAGIC.data(), sizeof(magic)) == 0)
+        return NPYT;
+    return NPY;
+}
+
+bool NPArrayBase::getCompressedHeader(istream &is, string &header,
+                                      size_t &data_size, const char **errstr) {
+    switch (streamFormat(is)) {
+    case NPY:
+        break;
+
+    case NPZ: {
+        // Only decompress the NPY header, which length is given by its first
+        // 10 bytes.
+        ZipEntry entry;
+        if (!findZipEntry(is, entry, errstr))
+            return false;
+        char start[10];
+        if (!readZipEntry(is, entry, start, sizeof(start), errstr))
+            return false;
+        const size_t header_length = sizeof(start) + getLE(&start[8], 2);
+        header.resize(header_length);
+        if (!readZipEntry(is, entry, header.data(), header_length, errstr))
+            return false;
+        data_size = entry.uncompressedSize - header_length;
+        return true;
+    }
+
+    case NPYZ: {
+        NPYZHeader hdr;
+        if (!readNPYZHeader(is, hdr, header, errstr))
+            return false;
+        data_size = hdr.dataSize;
+        return true;
+    }
+
+    case NPYT: {
+        NPYTHeader hdr;
+        if (!readNPYTHeader(is, hdr, header, errstr))
+            return false;
+        data_size = hdr.dataSize;
+        return true;
+    }
+    }
+
+    return fail(errstr, "not a compressed file");
+}
+
+unique_ptr<istream> NPArrayBase::openStream(string_view filename,
+                                            Window &window, bool *compressed,
+                                            const char **errstr) {
+    unique_ptr<ifstream> ifs(new ifstream(string(filename), ifstream::binary));
+    if (!*ifs) {
+        fail(errstr, "error opening file");
+        return nullptr;
+    }
+
+    const Format format = streamFormat(*ifs);
+    if (compressed)
+        *compressed = format != NPY;
+
+    switch (format) {
+    case NPY:
+        return ifs;
+
+    case NPZ: {
+        ZipEntry entry;
+        if (!findZipEntry(*ifs, entry, errstr))
+            return nullptr;
+        string image(entry.uncompressedSize, '\0');
+        if (!readZipEntry(*ifs, entry, image.data(), image.size(), errstr))
+            return nullptr;
+        if (crc(image.data(), image.size()) != entry.crc) {
+            fail(errstr, "NPZ entry checksum mismatch");
+            return nullptr;
+        }
+        return unique_ptr<istream>(new MemoryStream(std::move(image)));
+    }
+
+    case NPYZ:
+        break;
+
+    case NPYT:
+        return openNPYT(*ifs, window, errstr);
+    }
+
+    size_t num_rows;
+    size_t num_columns;
+    string elt_ty;
+    size_t elt_size;
+    bool swap;
+    if (!getInformation(*ifs, num_rows, num_columns, elt_ty, elt_size, errstr,
+                        &swap))
+        return nullptr;
+    if (swap) {
+        fail(errstr, "only native endianness is supported for NPYZ files");
+        return nullptr;
+    }
+
+    NPYZHeader hdr;
+    string npy_header;
+    if (!readNPYZHeader(*ifs, hdr, npy_header, errstr))
+        return nullptr;
+    if (hdr.numBlocks != (num_rows + hdr.blockRows - 1) / hdr.blockRows) {
+        fail(errstr, "inconsistent NPYZ index");
+        return nullptr;
+    }
+
+    // Find the blocks covering the window rows.
+    const Window w = window.clamp(num_rows, num_columns);
+    const size_t first_block = w.rowBegin / hdr.blockRows;
+    const size_t end_block =
+        w.rows() == 0 ? first_block
+                      : (w.rowEnd + hdr.blockRows - 1) / hdr.blockRows;
+    const size_t first_row = first_block * hdr.blockRows;
+    const size_t end_row = std::min(end_block * hdr.blockRows, num_rows);
+    const size_t row_bytes = num_columns * elt_size;
+
+    // Read those blocks, and decompress them in parallel in an NPY image
+    // holding only their rows.
+    vector<char> index(16 * (end_block - first_block));
+    if (!readAt(*ifs, NPYZ_HEADER_SIZE + hdr.headerLength + 16 * first_block,
+                index.data(), index.size())) {
+        fail(errstr, "error reading NPYZ index");
+        return nullptr;
+    }
+    vector<string> blocks(end_block - first_block);
+    for (size_t b = 0; b < blocks.size(); b++) {
+        blocks[b].resize(getLE(&index[16 * b + 8], 8));
+        if (!readAt(*ifs, getLE(&index[16 * b], 8), blocks[b].data(),
+                    blocks[b].size())) {
+            fail(errstr, "error reading NPYZ block");
+            return nullptr;
+        }
+    }
+
+    std::ostringstream oss;
+    if (!saveHeader(oss, elt_ty, end_row - first_row, num_columns)) {
+        fail(errstr, "error creating NPY header");
+        return nullptr;
+    }
+    string image = oss.str();
+    const size_t data_offset = image.size();
+    image.resize(data_offset + (end_row - first_row) * row_bytes);
+
+    std::atomic<bool> ok{true};
+    parallelFor(0, blocks.size(), hdr.blockRows * num_columns,
+                [&](size_t bb, size_t be) {
+                    for (size_t b = bb; b < be; b++) {
+                        const size_t r = b * hdr.blockRows;
+                        uLongf len =
+                            (std::min(r + hdr.blockRows, end_row - first_row) -
+                             r) *
+                            row_bytes;
+                        const uLongf expected = len;
+                        if (uncompress(
+                                reinterpret_cast<Bytef *>(
+                                    &image[data_offset + r * row_bytes]),
+                                &len,
+                                reinterpret_cast<const Bytef *>(
+                                    blocks[b].data()),
+                                blocks[b].size()) != Z_OK ||
+                            len != expected)
+                            ok = false;
+                    }
+                });
+    if (!ok) {
+        fail(errstr, "error decompressing NPYZ block");
+        return nullptr;
+    }
+
+    window = Window(w.rowBegin - first_row, w.rowEnd - first_row, w.colBegin,
+                    w.colEnd, w.colStride);
+    return unique_ptr<istream>(new MemoryStream(std::move(image)));
+}
+
+bool NPArrayBase::saveNPZ(string_view filename, string_view descr,
+                          bool fortran_order) const {
+    // Build the NPY file in memory, and deflate it.
+    std::ostringstream oss;
+    if (!saveHeader(oss, descr, rows(), cols(), fortran_order))
+        return false;
+    string image = oss.str();
+    const size_t data_offset = image.size();
+    image.resize(data_offset + size() * elementSize());
+    if (fortran_order)
+        transpose(&image[data_offset], data.get(), rows(), cols(),
+                  elementSize());
+    else if (!empty())
+        memcpy(&image[data_offset], data.get(), size() * elementSize());
+
+    string compressed;
+    if (!deflateRaw(image.data(), image.size(), compressed))
+        return false;
+
+    // The zip64 extensions are only used when the sizes or offsets may not
+    // fit in 32 bits, with some margin for the headers.
+    const size_t name_len = sizeof(NPZ_ENTRY_NAME) - 1;
+    const bool zip64 = std::max(image.size(), compressed.size()) >=
+                       0xFFFFFFFF - 1024;
+    const uint32_t checksum = crc(image.data(), image.size());
+
+    // The fields common to the local header and the central directory.
+    const auto entryFields = [&](string &s) {
+        putLE(s, zip64 ? 45 : 20, 2); // Version needed to extract.
+        putLE(s, 0, 2);               // Flags.
+        putLE(s, Z_DEFLATED, 2);      // Compression method.
+        putLE(s, 0, 2);               // Modification time.
+        putLE(s, (0 << 9) | (1 << 5) | 1, 2); // Modification date.
+        putLE(s, checksum, 4);
+        putLE(s, zip64 ? 0xFFFFFFFF : compressed.size(), 4);
+        putLE(s, zip64 ? 0xFFFFFFFF : image.size(), 4);
+        putLE(s, name_len, 2);
+        putLE(s, zip64 ? 20 : 0, 2); // Extra field length.
+    };
+    const auto zip64Extra = [&](string &s) {
+        if (!zip64)
+            return;
+        putLE(s, 1, 2);
+        putLE(s, 16, 2);
+        putLE(s, image.size(), 8);
+        putLE(s, compressed.size(), 8);
+    };
+
+    string local(ZIP_LOCAL_HEADER, 4);
+    entryFields(local);
+    local += NPZ_ENTRY_NAME;
+    zip64Extra(local);
+    const size_t cd_offset = local.size() + compressed.size();
+
+    string cd(ZIP_CENTRAL_HEADER, 4);
+    putLE(cd, 45, 2); // Version made by.
+    entryFields(cd);
+    putLE(cd, 0, 2); // File comment length.
+    putLE(cd, 0, 2); // Disk number.
+    putLE(cd, 0, 2); // Internal attributes.
+    putLE(cd, 0, 4); // External attributes.
+    putLE(cd, 0, 4); // Local header offset.
+    cd += NPZ_ENTRY_NAME;
+    zip64Extra(cd);
+
+    string end;
+    if (zip64) {
+        end.append(ZIP64_END_OF_CENTRAL_DIR, 4);
+        putLE(end, 44, 8); // Size of the remaining record.
+        putLE(end, 45, 2); // Version made by.
+        putLE(end, 45, 2); // Version needed to extract.
+        putLE(end, 0, 4);  // Disk number.
+        putLE(end, 0, 4);  // Disk with the central directory.
+        putLE(end, 1, 8);  // Number of entries on this disk.
+        putLE(end, 1, 8);  // Number of entries.
+        putLE(end, cd.size(), 8);
+        putLE(end, cd_offset, 8);
+        end.append(ZIP64_END_OF_CENTRAL_DIR_LOCATOR, 4);
+        putLE(end, 0, 4); // Disk with the zip64 end of central directory.
+        putLE(end, cd_offset + cd.size(), 8);
+        putLE(end, 1, 4); // Number of disks.
+    }
+    end.append(ZIP_END_OF_CENTRAL_DIR, 4);
+    putLE(end, 0, 2); // Disk number.
+    putLE(end, 0, 2); // Disk with the central directory.
+    putLE(end, 1, 2); // Number of entries on this disk.
+    putLE(end, 1, 2); // Number of entries.
+    putLE(end, cd.size(), 4);
+    putLE(end, zip64 ? 0xFFFFFFFF : cd_offset, 4);
+    putLE(end, 0, 2); // Comment length.
+
+    ofstream ofs(string(filename), ofstream::binary);
+    ofs.write(local.data(), local.size());
+    ofs.write(compressed.data(), compressed.size());
+    ofs.write(cd.data(), cd.size());
+    ofs.write(end.data(), end.size());
+    return bool(ofs);
+}
+
+bool NPArrayBase::saveNPYZ(string_view filename, string_view descr,
+                           size_t block_rows) const {
+    const size_t row_bytes = cols() * elementSize();
+    if (block_rows == 0)
+        block_rows = std::max<size_t>(1, NPYZ_BLOCK_SIZE / std::max<size_t>(
+                                                               row_bytes, 1));
+    const size_t num_blocks = (rows() + block_rows - 1) / block_rows;
+
+    // Compress the blocks in parallel.
+    vector<string> blocks(num_blocks);
+    std::atomic<bool> ok{true};
+    parallelFor(0, num_blocks, block_rows * cols(), [&](size_t bb, size_t be) {
+        for (size_t b = bb; b < be; b++) {
+            const size_t r = b * block_rows;
+            const size_t n = (std::min(r + block_rows, rows()) - r) * row_bytes;
+            uLongf len = compressBound(n);
+            blocks[b].resize(len);
+            if (compress2(reinterpret_cast<Bytef *>(blocks[b].data()), &len,
+                          reinterpret_cast<const Bytef *>(&data[r * row_bytes]),
+                          n, Z_DEFAULT_COMPRESSION) != Z_OK)
+                ok = false;
+            blocks[b].resize(len);
+        }
+    });
+    if (!ok)
+        return false;
+
+    std::ostringstream oss;
+    if (!saveHeader(oss, descr, rows(), cols()))
+        return false;
+    const string npy_header = oss.str();
+
+    string header(NPYZ_MAGIC.data(), NPYZ_MAGIC.size());
+    header += {1, 0, 0}; // Version 1.0, and a reserved byte.
+    putLE(header, block_rows, 8);
+    putLE(header, num_blocks, 8);
+    putLE(header, size() * elementSize(), 8);
+    putLE(header, npy_header.size(), 8);
+    header += npy_header;
+    size_t offset = header.size() + 16 * num_blocks;
+    for (const auto &block : blocks) {
+        putLE(header, offset, 8);
+        putLE(header, block.size(), 8);
+        offset += block.size();
+    }
+
+    ofstream ofs(string(filename), ofstream::binary);
+    ofs.write(header.data(), header.size());
+    for (const auto &block : blocks)
+        ofs.write(block.data(), block.size());
+    return bool(ofs);
+}
+
+bool NPArrayBase::saveNPYT(string_view filename, string_view descr,
+                           size_t tile_rows, size_t tile_cols,
+                           bool compress) const {
+    if (tile_rows == 0)
+        tile_rows = NPYT_TILE_ROWS;
+    if (tile_cols == 0)
+        tile_cols = NPYT_TILE_COLS;
+    const size_t grid_rows = (rows() + tile_rows - 1) / tile_rows;
+    const size_t grid_cols = (cols() + tile_cols - 1) / tile_cols;
+    const size_t num_tiles = grid_rows * grid_cols;
+    const size_t row_bytes = cols() * elementSize();
+
+    // Transpose, and compress, the tiles in parallel. Tiles which do not
+    // compress are stored as is.
+    vector<string> tiles(num_tiles);
+    std::atomic<bool> ok{true};
+    const auto tileJob = [&](size_t tb, size_t te) {
+        string buf;
+        for (size_t t = tb; t < te; t++) {
+            const size_t r = t / grid_cols * tile_rows;
+            const size_t c = t % grid_cols * tile_cols;
+            const size_t nr = std::min(tile_rows, rows() - r);
+            const size_t nc = std::min(tile_cols, cols() - c);
+            const size_t n = nr * nc * elementSize();
+            buf.resize(n);
+            copyTile(/* gather: */ true,
+                     &data[r * row_bytes + c * elementSize()], row_bytes,
+                     buf.data(), nr * elementSize(), nr, nc, elementSize());
+            if (compress) {
+                uLongf len = compressBound(n);
+                tiles[t].resize(len);
+                if (compress2(reinterpret_cast<Bytef *>(tiles[t].data()),
+                              &len, reinterpret_cast<const Bytef *>(buf.data()),
+                              n, Z_DEFAULT_COMPRESSION) != Z_OK)
+                    ok = false;
+                if (len < n) {
+                    tiles[t].resize(len);
+                    continue;
+                }
+            }
+            tiles[t] = buf;
+        }
+    };
+    parallelFor(0, num_tiles, tile_rows * tile_cols, tileJob);
+    if (!ok)
+        return false;
+
+    std::ostringstream oss;
+    if (!saveHeader(oss, descr, rows(), cols()))
+        return false;
+    const string npy_header = oss.str();
+
+    string header(NPYT_MAGIC.data(), NPYT_MAGIC.size());
+    header += {1, 0, 0}; // Version 1.0, and a reserved byte.
+    putLE(header, tile_rows, 8);
+    putLE(header, tile_cols, 8);
+    putLE(header, num_tiles, 8);
+    putLE(header, size() * elementSize(), 8);
+    putLE(header, npy_header.size(), 8);
+    header += npy_header;
+    size_t offset = header.size() + 16 * num_tiles;
+    for (const auto &tile : tiles) {
+        putLE(header, offset, 8);
+        putLE(header, tile.size(), 8);
+        offset += tile.size();
+    }
+
+    ofstream ofs(string(filename), ofstream::binary);
+    ofs.write(header.data(), header.size());
+    for (const auto &tile : tiles)
+        ofs.write(tile.data(), tile.size());
+    return bool(ofs);
+}
+
+} // namespace PAF::SCA
@@ -19,16 +19,70 @@
  */
 
 #include "PAF/SCA/Noise.h"
+#include "PAF/Error.h"
 
+#include <algorithm>
+#include <cmath>
 #include <random>
 
 namespace PAF::SCA {
 
+namespace {
+// The xoshiro256++ pseudo random number generator, from David Blackman and
+// Sebastiano Vigna: much faster than std::mt19937, with a small state and
+// good statistical properties.
+class Xoshiro256pp {
+  public:
+    Xoshiro256pp(uint64_t seed) { this->seed(seed); }
+
+    // Initialize the state with splitmix64, as recommended by the authors,
+    // so that close seeds give unrelated sequences.
+    void seed(uint64_t seed) {
+        for (uint64_t &v : s) {
+            uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            v = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        const uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // Get a uniformly distributed double in [0, 1).
+    double uniform() { return double(next() >> 11) * 0x1.0p-53; }
+
+  private:
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+};
+
+uint64_t randomSeed() {
+    std::random_device rndDevice;
+    return (uint64_t(rndDevice()) << 32) | rndDevice();
+}
+} // namespace
+
 class ConstantNoiseSource : public NoiseSource {
   public:
     ConstantNoiseSource(double value) : value(value) {}
     ~ConstantNoiseSource() override = default;
     double get() override { return value; }
+    void fill(double *out, size_t n) override {
+        std::fill(out, out + n, value);
+    }
 
   private:
     double value;
@@ -43,46 +97,127 @@ class NullNoise : public ConstantNoiseSource {
 
 class RandomNoiseSource : public NoiseSource {
   public:
-    RandomNoiseSource() : twister(rndDevice()) {}
+    RandomNoiseSource(uint64_t seed) : rng(seed) {}
+
+    void seed(uint64_t seed) override { rng.seed(seed); }
 
   protected:
-    std::random_device rndDevice;
-    std::mt19937 twister;
+    Xoshiro256pp rng;
 };
 
 class UniformNoise : public RandomNoiseSource {
   public:
-    UniformNoise(double NoiseLevel)
-        : noiseDist(-NoiseLevel / 2.0, NoiseLevel / 2.0) {}
+    UniformNoise(double NoiseLevel, uint64_t seed)
+        : RandomNoiseSource(seed), low(-NoiseLevel / 2.0), range(NoiseLevel) {}
 
-    double get() override { return noiseDist(twister); }
+    double get() override { return low + range * rng.uniform(); }
+
+    void fill(double *out, size_t n) override {
+        for (size_t i = 0; i < n; i++)
+            out[i] = low + range * rng.uniform();
+    }
 
   private:
-    std::uniform_real_distribution<double> noiseDist;
+    const double low;
+    const double range;
 };
 
+// Normally distributed noise, using the Box-Muller transform, which produces
+// the values by pairs. The batch version first draws the uniform values for a
+// block of pairs, and then transforms them in a separate loop, so that the
+// transcendental functions are not interleaved with the generator.
 class NormalNoise : public RandomNoiseSource {
   public:
-    NormalNoise(double NoiseLevel) : noiseDist(0.0, NoiseLevel / 2.0) {}
+    NormalNoise(double NoiseLevel, uint64_t seed)
+        : RandomNoiseSource(seed), sigma(NoiseLevel / 2.0) {}
+
+    double get() override {
+        if (hasSpare) {
+            hasSpare = false;
+            return spare;
+        }
+        double v[2];
+        pairs(v, 1);
+        spare = v[1];
+        hasSpare = true;
+        return v[0];
+    }
 
-    double get() override { return noiseDist(twister); }
+    void fill(double *out, size_t n) override {
+        size_t i = 0;
+        if (hasSpare && n != 0) {
+            out[i++] = spare;
+            hasSpare = false;
+        }
+        if (n - i >= 2) {
+            const size_t num_pairs = (n - i) / 2;
+            pairs(&out[i], num_pairs);
+            i += 2 * num_pairs;
+        }
+        if (i < n)
+            out[i] = get();
+    }
+
+    void seed(uint64_t seed) override {
+        RandomNoiseSource::seed(seed);
+        hasSpare = false;
+    }
 
   private:
-    std::normal_distribution<double> noiseDist;
+    const double sigma;
+    double spare = 0.0;
+    bool hasSpare = false;
+
+    // Generate 2 * num_pairs normally distributed values to out.
+    void pairs(double *out, size_t num_pairs) {
+        constexpr size_t BLOCK_PAIRS = 128;
+        constexpr double TWO_PI = 6.283185307179586476925286766559;
+        double u1[BLOCK_PAIRS];
+        double u2[BLOCK_PAIRS];
+        for (size_t b = 0; b < num_pairs; b += BLOCK_PAIRS) {
+            const size_t e = std::min(b + BLOCK_PAIRS, num_pairs);
+            for (size_t p = 0; p < e - b; p++) {
+                u1[p] = 1.0 - rng.uniform(); // In (0, 1], for the log.
+                u2[p] = rng.uniform();
+            }
+            for (size_t p = 0; p < e - b; p++) {
+                const double r = sigma * std::sqrt(-2.0 * std::log(u1[p]));
+                const double theta = TWO_PI * u2[p];
+                out[2 * (b + p)] = r * std::cos(theta);
+                out[2 * (b + p) + 1] = r * std::sin(theta);
+            }
+        }
+    }
 };
 
 std::unique_ptr<NoiseSource> NoiseSource::getSource(Type noiseTy,
                                                     double noiseLevel) {
     switch (noiseTy) {
+    case NoiseSource::ZERO:
+    case NoiseSource::CONSTANT:
+        return getSource(noiseTy, noiseLevel, 0);
+    case NoiseSource::UNIFORM:
+    case NoiseSource::NORMAL:
+        return getSource(noiseTy, noiseLevel, randomSeed());
+    }
+
+    DIE("Unhandled noise source type");
+}
+
+std::unique_ptr<NoiseSource>
+NoiseSource::getSource(Type noiseTy, double noiseLevel, uint64_t seed) {
+    switch (noiseTy) {
     case NoiseSource::ZERO:
         return std::make_unique<NullNoise>();
     case NoiseSource::CONSTANT:
         return std::make_unique<ConstantNoiseSource>(noiseLevel);
     case NoiseSource::UNIFORM:
-        return std::make_unique<UniformNoise>(noiseLevel);
+        return std::make_unique<UniformNoise>(noiseLevel, seed);
     case NoiseSource::NORMAL:
-        return std::make_unique<NormalNoise>(noiseLevel);
+        return std::make_unique<NormalNoise>(noiseLevel, seed);
     }
+
+    DIE("Unhandled noise source type");
 }
 
 } // namespace PAF::SCA
@@ -24,11 +24,21 @@
 #include "PAF/SCA/Dumper.h"
 #include "PAF/SCA/SCA.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cctype>
+#include <cmath>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 using std::ostream;
@@ -36,24 +46,225 @@ using std::string;
 using std::unique_ptr;
 using std::vector;
 
+using PAF::FromStreamBuilder;
 using PAF::FromTraceBuilder;
 using PAF::MemoryAccess;
 using PAF::MTAnalyzer;
 using PAF::ReferenceInstruction;
 using PAF::RegisterAccess;
 using PAF::SCA::PowerAnalysisConfig;
+using PAF::SCA::PowerSamples;
 using PAF::SCA::PowerTrace;
 using PAF::SCA::PowerTraceConfig;
 
 namespace {
 
+// A per instruction buffer, with room for N elements in place so that adding
+// an instruction does not need to allocate memory. The rare instructions with
+// more elements (e.g. large load / store multiples) spill to the heap.
+template <class Ty, size_t N> class InstrBuffer {
+  public:
+    void clear() {
+        num = 0;
+        spill.clear();
+    }
+
+    void push_back(const Ty &v) {
+        if (num < N)
+            inPlace[num] = v;
+        else
+            spill.push_back(v);
+        num++;
+    }
+
+    [[nodiscard]] size_t size() const { return num; }
+
+    const Ty &operator[](size_t i) const {
+        return i < N ? inPlace[i] : spill[i - N];
+    }
+
+  private:
+    std::array<Ty, N> inPlace;
+    vector<Ty> spill;
+    size_t num = 0;
+};
+
+// The data independent attributes of an instruction: they only depend on its
+// pc, instruction set and encoding, so they can be computed once for all the
+// executions of the instruction (e.g. in loop bodies).
+class StaticInstrInfo {
+  public:
+    StaticInstrInfo(const PAF::ArchInfo &CPU, const ReferenceInstruction &I)
+        : hwPC(PAF::SCA::hamming_weight<Addr>(I.pc, -1)),
+          hwInstr(PAF::SCA::hamming_weight<uint32_t>(I.instruction, -1)),
+          isBranch(CPU.isBranch(I)), cpu(CPU) {
+        setRegisters(I);
+    }
+
+    const double hwPC;    // The Hamming weight of the pc.
+    const double hwInstr; // The Hamming weight of the encoding.
+    const bool isBranch;  // Is this a branch instruction ?
+
+    // Are the register roles valid for I's register accesses ? They may not
+    // be, for example if the instruction was not executed.
+    [[nodiscard]] bool sameRegisters(const ReferenceInstruction &I) const {
+        if (I.regAccess.size() != regs.size())
+            return false;
+        for (size_t i = 0; i < regs.size(); i++) {
+            const RegisterAccess &RA = I.regAccess[i];
+            if (RA.id != RegisterAccess::UNKNOWN_ID
+                    ? RA.id != regs[i].id
+                    : RA.name != regs[i].name)
+                return false;
+        }
+        return true;
+    }
+
+    // Set the register roles from I's register accesses. The registers ids
+    // resolved at parse time are used when available.
+    void setRegisters(const ReferenceInstruction &I) {
+        regs.clear();
+        regs.reserve(I.regAccess.size());
+        for (const RegisterAccess &RA : I.regAccess)
+            regs.push_back({RA.name,
+                            RA.id != RegisterAccess::UNKNOWN_ID
+                                ? cpu.isStatusRegister(RA.id)
+                                : cpu.isStatusRegister(RA.name),
+                            RA.id});
+    }
+
+    // Is the i-th register accessed a status register ?
+    [[nodiscard]] bool isStatusRegister(size_t i) const {
+        return regs[i].isStatus;
+    }
+
+    // Get the i-th register accessed's id. It is only looked up when needed,
+    // as not all power models use it.
+    [[nodiscard]] unsigned registerId(size_t i) const {
+        if (regs[i].id == RegisterAccess::UNKNOWN_ID)
+            regs[i].id = cpu.registerId(regs[i].name);
+        return regs[i].id;
+    }
+
+  private:
+    struct RegRole {
+        string name;
+        bool isStatus;
+        mutable unsigned id;
+    };
+    vector<RegRole> regs;
+    const PAF::ArchInfo &cpu;
+};
+
+// A cache of the StaticInstrInfo, keyed by (pc, instruction set, encoding).
+class StaticInstrInfoCache {
+  public:
+    StaticInstrInfoCache(const PAF::ArchInfo &CPU) : cpu(CPU) {}
+
+    const StaticInstrInfo &get(const ReferenceInstruction &I) {
+        auto [it, inserted] =
+            cache.try_emplace(Key{I.pc, I.instruction, I.iset}, cpu, I);
+        if (!inserted && !it->second.sameRegisters(I))
+            it->second.setRegisters(I);
+        return it->second;
+    }
+
+  private:
+    struct Key {
+        Addr pc;
+        uint32_t instruction;
+        ISet iset;
+        bool operator==(const Key &RHS) const {
+            return pc == RHS.pc && instruction == RHS.instruction &&
+                   iset == RHS.iset;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &K) const {
+            const uint64_t k = K.pc ^ (uint64_t(K.instruction) << 32) ^
+                               (uint64_t(K.iset) << 61);
+            return std::hash<uint64_t>()(k);
+        }
+    };
+
+    const PAF::ArchInfo &cpu;
+    std::unordered_map<Key, StaticInstrInfo, KeyHash> cache;
+};
+
+// The interface to the power models used by PowerTrace::analyze. The samples
+// are accumulated, and passed by batches to the power dumper.
+//
+// When several realizations of the power trace are requested, the noise free
+// samples of the whole trace are kept instead, and each realization gets its
+// noise added to a copy of them when the trace is flushed.
+class PowerModelBase {
+  public:
+    PowerModelBase(PowerAnalysisConfig &PAConfig)
+        : PAConfig(PAConfig), realizations(PAConfig.getRealizations()) {
+        samples.reserve(BATCH_SIZE);
+    }
+    virtual ~PowerModelBase() = default;
+
+    [[nodiscard]] unsigned getLastInstrCycles() const { return cycles; }
+
+    virtual void add(const ReferenceInstruction &I,
+                     const StaticInstrInfo &SI) = 0;
+    /// Dump the power of the cycles [first, last( of the last added
+    /// instruction \p I, which is nullptr for the dummy cycles.
+    virtual void dump(const ReferenceInstruction *I, unsigned first,
+                      unsigned last) = 0;
+
+    /// Pass the pending samples to the power dumper.
+    void flush() {
+        if (samples.empty())
+            return;
+        if (realizations == 1) {
+            PAConfig.getDumper().dumpSamples(samples);
+        } else {
+            PowerSamples noisy;
+            for (unsigned r = 0; r < realizations; r++) {
+                if (r > 0)
+                    PAConfig.getDumper().nextTrace();
+                noisy = samples;
+                if (PAConfig.addNoise())
+                    addNoise(noisy);
+                PAConfig.getDumper().dumpSamples(noisy);
+            }
+        }
+        samples.clear();
+    }
+
+  protected:
+    static constexpr size_t BATCH_SIZE = 4096;
+
+    PowerAnalysisConfig &PAConfig;
+    PowerSamples samples;
+    unsigned cycles = 1;
+    const unsigned realizations;
+
+    /// Add a fresh draw of noise to the noise free samples \p S.
+    virtual void addNoise(PowerSamples &S) = 0;
+
+    void addSample(double total, double pc, double instr, double oreg,
+                   double ireg, double addr, double data,
+                   const ReferenceInstruction *I) {
+        samples.push_back(total, pc, instr, oreg, ireg, addr, data, I);
+        if (realizations == 1 && samples.size() >= BATCH_SIZE)
+            flush();
+    }
+};
+
 // This is an attempt to model where power is coming from and when (i.e. at
 // which cycle) it appears. It is a very crude estimate as we don't have the
 // underlying micro-architecture.
 // The assumption implemented here is that the first cycle contains the
 // instruction and its operands, while memory accesses will take place in the
 // subsequent cycles.
-class PowerModelBase {
+//
+// The power models are specialized on Sources, the mask of power sources
+// selected in the PowerTraceConfig, so that the sources which are not
+// selected are compiled out of the per instruction processing.
+template <unsigned Sources> class PowerModel : public PowerModelBase {
   public:
     struct MemAccessPower {
         MemAccessPower() = default;
@@ -64,20 +275,19 @@ class PowerModelBase {
         double address = 0.0;
     };
 
-    PowerModelBase() = delete;
-    virtual ~PowerModelBase() = default;
-
-    PowerModelBase(const PAF::ArchInfo &CPU, const PowerTraceConfig &PTConfig,
-                   PowerAnalysisConfig &PAConfig)
-        : cpu(CPU), PTConfig(PTConfig), PAConfig(PAConfig), inputRegs(0.0),
-          pc(0.0), psr(0.0), instr(0.0), cycles(1) {}
+    PowerModel() = delete;
 
-    [[nodiscard]] unsigned getLastInstrCycles() const { return cycles; }
-
-    virtual void add(const ReferenceInstruction &I) = 0;
+    PowerModel(const PAF::ArchInfo &CPU, const PowerTraceConfig &PTConfig,
+               PowerAnalysisConfig &PAConfig)
+        : PowerModelBase(PAConfig), cpu(CPU), PTConfig(PTConfig),
+          inputRegs(0.0), pc(0.0), psr(0.0), instr(0.0) {
+        assert(PTConfig.getSources() == Sources &&
+               "Power model specialized for other power sources");
+    }
 
-    void dump(const ReferenceInstruction *I = nullptr) const {
-        for (unsigned i = 0; i < cycles; i++) {
+    void dump(const ReferenceInstruction *I, unsigned first,
+              unsigned last) override {
+        for (unsigned i = first; i < std::min(last, cycles); i++) {
             double POReg = i < outputRegs.size() ? outputRegs[i] : 0.0;
             double PIReg = inputRegs;
             double PAddr = i < memory.size() ? memory[i].address : 0.0;
@@ -86,53 +296,115 @@ class PowerModelBase {
             double PPSR = psr;
             double PInstr = instr;
 
-            if (PAConfig.addNoise()) {
-                if (PTConfig.withInstructionsOutputs()) {
-                    POReg += PAConfig.getNoise();
-                    PPSR += PAConfig.getNoise();
+            if constexpr (numNoiseValues > 0) {
+                // With several realizations, the noise is added at flush
+                // time.
+                if (PAConfig.addNoise() && realizations == 1) {
+                    // Get all the noise values needed for this cycle at once.
+                    double noise[numNoiseValues];
+                    PAConfig.getNoise(noise, numNoiseValues);
+                    const double *n = noise;
+                    if constexpr (withOutputs) {
+                        POReg += *n++;
+                        PPSR += *n++;
+                    }
+                    if constexpr (withInputs)
+                        PIReg += *n++;
+                    if constexpr (withMemAddress)
+                        PAddr += *n++;
+                    if constexpr (withMemData)
+                        PData += *n++;
+                    if constexpr (withPC)
+                        PPC += *n++;
+                    if constexpr (withOpcode)
+                        PInstr += *n++;
                 }
-                if (PTConfig.withInstructionsInputs())
-                    PIReg += PAConfig.getNoise();
-                if (PTConfig.withMemAddress())
-                    PAddr += PAConfig.getNoise();
-                if (PTConfig.withMemData())
-                    PData += PAConfig.getNoise();
-                if (PTConfig.withPC())
-                    PPC += PAConfig.getNoise();
-                if (PTConfig.withOpcode())
-                    PInstr += PAConfig.getNoise();
             }
 
-            // Scaling factors, very finger in the air values.
-            const double F_PC = 1.0;
-            const double F_PSR = 0.5;
-            const double F_Instr = 1.0;
-            const double F_ORegisters = 2.0;
-            const double F_IRegisters = 2.0;
-            const double F_Data = 2.0;
-            const double F_Address = 1.2;
-
             double total = F_PC * PPC + F_Instr * PInstr + F_PSR * PPSR +
                            F_ORegisters * POReg + F_IRegisters * PIReg +
                            F_Address * PAddr + F_Data * PData;
 
-            PAConfig.getDumper().dump(total, pc, instr, POReg + PPSR, PIReg,
-                                      PAddr, PData, i == 0 ? I : nullptr);
+            addSample(total, pc, instr, POReg + PPSR, PIReg, PAddr, PData,
+                      i == 0 ? I : nullptr);
         }
     }
 
   protected:
     const PAF::ArchInfo &cpu;
     const PowerTraceConfig &PTConfig;
-    PowerAnalysisConfig &PAConfig;
 
-    vector<MemAccessPower> memory;
-    vector<double> outputRegs;
+    InstrBuffer<MemAccessPower, 16> memory;
+    InstrBuffer<double, 16> outputRegs;
     double inputRegs;
     double pc;
     double psr;
     double instr;
-    unsigned cycles;
+
+    // The selected power sources.
+    static constexpr bool withPC = Sources & PowerTraceConfig::WITH_PC;
+    static constexpr bool withOpcode = Sources & PowerTraceConfig::WITH_OPCODE;
+    static constexpr bool withMemAddress =
+        Sources & PowerTraceConfig::WITH_MEM_ADDRESS;
+    static constexpr bool withMemData =
+        Sources & PowerTraceConfig::WITH_MEM_DATA;
+    static constexpr bool withInputs =
+        Sources & PowerTraceConfig::WITH_INSTRUCTIONS_INPUTS;
+    static constexpr bool withOutputs =
+        Sources & PowerTraceConfig::WITH_INSTRUCTIONS_OUTPUTS;
+
+    /// The number of noise values needed for each cycle.
+    static constexpr size_t numNoiseValues = 2 * withOutputs + withInputs +
+                                             withMemAddress + withMemData +
+                                             withPC + withOpcode;
+
+    // Scaling factors, very finger in the air values.
+    static constexpr double F_PC = 1.0;
+    static constexpr double F_PSR = 0.5;
+    static constexpr double F_Instr = 1.0;
+    static constexpr double F_ORegisters = 2.0;
+    static constexpr double F_IRegisters = 2.0;
+    static constexpr double F_Data = 2.0;
+    static constexpr double F_Address = 1.2;
+
+    // The noise values for all the samples of a realization, drawn at once.
+    std::vector<double> noise;
+
+    void addNoise(PowerSamples &S) override {
+        if constexpr (numNoiseValues > 0) {
+            // The noise values are drawn in the same order as dump would
+            // have: up to rounding, the first realization is the power trace
+            // emitted without realizations.
+            noise.resize(S.size() * numNoiseValues);
+            PAConfig.getNoise(noise.data(), noise.size());
+            const double *n = noise.data();
+            for (size_t i = 0; i < S.size(); i++) {
+                double total = 0.0;
+                if constexpr (withOutputs) {
+                    S.oreg[i] += n[0] + n[1];
+                    total += F_ORegisters * n[0] + F_PSR * n[1];
+                    n += 2;
+                }
+                if constexpr (withInputs) {
+                    S.ireg[i] += *n;
+                    total += F_IRegisters * *n++;
+                }
+                if constexpr (withMemAddress) {
+                    S.addr[i] += *n;
+                    total += F_Address * *n++;
+                }
+                if constexpr (withMemData) {
+                    S.data[i] += *n;
+                    total += F_Data * *n++;
+                }
+                if constexpr (withPC)
+                    total += F_PC * *n++;
+                if constexpr (withOpcode)
+                    total += F_Instr * *n++;
+                S.total[i] += total;
+            }
+        }
+    }
 
     /// Set how many cycles were used by the last added instruction.
     void setLastInstrCycles() {
@@ -143,106 +415,101 @@ class PowerModelBase {
     }
 };
 
-class HammingWeightPM : public PowerModelBase {
-
-    template <class Ty> class HammingWeight {
-      public:
-        HammingWeight() : enable(true) {}
-        HammingWeight(bool enable) : enable(enable) {}
-        double operator()(Ty v) {
-            if (!enable)
-                return 0.0;
-            return PAF::SCA::hamming_weight<Ty>(v, -1);
-        }
-
-      private:
-        bool enable;
-    };
+template <unsigned Sources>
+class HammingWeightPM : public PowerModel<Sources> {
+    using Base = PowerModel<Sources>;
+    using typename Base::MemAccessPower;
+    using Base::cpu, Base::memory, Base::outputRegs, Base::inputRegs, Base::pc,
+        Base::psr, Base::instr;
+    using Base::withPC, Base::withOpcode, Base::withMemAddress,
+        Base::withMemData, Base::withInputs, Base::withOutputs;
+
+    template <class Ty> static double HW(Ty v) {
+        return PAF::SCA::hamming_weight<Ty>(v, -1);
+    }
 
   public:
     HammingWeightPM() = delete;
     HammingWeightPM(const PAF::ArchInfo &CPU, const PowerTraceConfig &PTConfig,
                     PowerAnalysisConfig &PAConfig)
-        : PowerModelBase(CPU, PTConfig, PAConfig), hwPC(PTConfig.withPC()),
-          hwInstr(PTConfig.withOpcode()), hwMemAddr(PTConfig.withMemAddress()),
-          hwMemData(PTConfig.withMemData()),
-          hwPSR(PTConfig.withInstructionsOutputs()),
-          hwInputReg(PTConfig.withInstructionsInputs()),
-          hwOutputReg(PTConfig.withInstructionsOutputs()) {}
+        : Base(CPU, PTConfig, PAConfig) {}
 
-    void add(const ReferenceInstruction &I) override {
-        pc = hwPC(I.pc);
-        instr = hwInstr(I.instruction);
+    void add(const ReferenceInstruction &I,
+             const StaticInstrInfo &SI) override {
+        if constexpr (withPC)
+            pc = SI.hwPC;
+        if constexpr (withOpcode)
+            instr = SI.hwInstr;
 
         memory.clear();
         // Memory access related power consumption estimation.
         for (const MemoryAccess &MA : I.memAccess)
-            memory.emplace_back(hwMemAddr(MA.addr), hwMemData(MA.value));
+            memory.push_back(MemAccessPower(
+                withMemAddress ? HW<Addr>(MA.addr) : 0.0,
+                withMemData ? HW<unsigned long long>(MA.value) : 0.0));
 
         psr = 0.0;
         inputRegs = 0.0;
         outputRegs.clear();
         // Register accesses estimated power consumption
-        if (PTConfig.withInstructionsInputs() ||
-            PTConfig.withInstructionsOutputs())
-            for (const RegisterAccess &RA : I.regAccess) {
+        if constexpr (withInputs || withOutputs)
+            for (size_t r = 0; r < I.regAccess.size(); r++) {
+                const RegisterAccess &RA = I.regAccess[r];
                 switch (RA.access) {
                 // Output registers.
                 case RegisterAccess::Type::WRITE:
-                    if (cpu.isStatusRegister(RA.name))
-                        psr = hwPSR(RA.value);
-                    else
-                        outputRegs.push_back(hwOutputReg(RA.value));
+                    if (SI.isStatusRegister(r)) {
+                        if constexpr (withOutputs)
+                            psr = HW<uint32_t>(RA.value);
+                    } else
+                        outputRegs.push_back(
+                            withOutputs ? HW<uint32_t>(RA.value) : 0.0);
                     break;
                 // Input registers.
                 case RegisterAccess::Type::READ:
-                    inputRegs += hwInputReg(RA.value);
+                    if constexpr (withInputs)
+                        inputRegs += HW<uint32_t>(RA.value);
                     break;
                 }
             }
 
-        setLastInstrCycles();
+        this->setLastInstrCycles();
     }
-
-  private:
-    HammingWeight<Addr> hwPC;
-    HammingWeight<uint32_t> hwInstr;
-    HammingWeight<Addr> hwMemAddr;
-    HammingWeight<unsigned long long> hwMemData;
-    HammingWeight<uint32_t> hwPSR;
-    HammingWeight<uint32_t> hwInputReg;
-    HammingWeight<uint32_t> hwOutputReg;
 };
 
-template <class Ty> double HD(Ty val, Ty previous, bool enable = true) {
-    return enable ? PAF::SCA::hamming_distance<Ty>(val, previous, -1) : 0.0;
+template <class Ty> double HD(Ty val, Ty previous) {
+    return PAF::SCA::hamming_distance<Ty>(val, previous, -1);
 }
 
-class HammingDistancePM : public PowerModelBase {
+template <unsigned Sources>
+class HammingDistancePM : public PowerModel<Sources> {
+    using Base = PowerModel<Sources>;
+    using typename Base::MemAccessPower;
+    using Base::cpu, Base::PTConfig, Base::memory, Base::outputRegs, Base::pc,
+        Base::psr, Base::instr;
+    using Base::withPC, Base::withOpcode, Base::withMemAddress,
+        Base::withMemData, Base::withInputs, Base::withOutputs;
 
     template <class Ty> class Reg {
       public:
-        Reg() : previousValue(Ty()), enable(true) {}
-        Reg(bool enable) : previousValue(Ty()), enable(enable) {}
+        Reg() : previousValue(Ty()) {}
         double operator()(Ty v) {
-            double p = HD<Ty>(v, previousValue, enable);
+            double p = HD<Ty>(v, previousValue);
             previousValue = v;
             return p;
         }
 
       private:
         Ty previousValue;
-        bool enable;
     };
 
     class RegBank {
       public:
-        RegBank(bool enable, vector<uint64_t> &&init)
-            : state(std::move(init)), enable(enable) {}
+        RegBank(vector<uint64_t> &&init) : state(std::move(init)) {}
 
         double operator()(unsigned regId, uint64_t v) {
             assert(regId < state.size() && "Out of bound register bank access");
-            double p = HD<typeof(state[0])>(v, state[regId], enable);
+            double p = HD<typeof(state[0])>(v, state[regId]);
             state[regId] = v;
             return p;
         }
@@ -251,7 +518,6 @@ class HammingDistancePM : public PowerModelBase {
 
       private:
         vector<uint64_t> state;
-        bool enable;
     };
 
     struct Bus {
@@ -272,90 +538,56 @@ class HammingDistancePM : public PowerModelBase {
                       const PowerTraceConfig &PTConfig,
                       PowerAnalysisConfig &PAConfig,
                       const PowerTrace::Oracle &oracle, vector<uint64_t> &&regs)
-        : PowerModelBase(CPU, PTConfig, PAConfig), oracle(oracle),
-          hdPC(PTConfig.withPC()), hdInstr(PTConfig.withOpcode()),
-          regs(PTConfig.withInstructionsOutputs(), std::move(regs)),
+        : Base(CPU, PTConfig, PAConfig), oracle(oracle), regs(std::move(regs)),
           lastLoad(nullptr), lastStore(nullptr), lastAccess(nullptr) {}
 
-    void add(const ReferenceInstruction &I) override {
-        pc = hdPC(I.pc);
-        instr = hdInstr(I.instruction);
+    void add(const ReferenceInstruction &I,
+             const StaticInstrInfo &SI) override {
+        if constexpr (withPC)
+            pc = hdPC(I.pc);
+        if constexpr (withOpcode)
+            instr = hdInstr(I.instruction);
 
         // Memory access related power consumption estimation.
         memory.clear();
         for (unsigned i = 0; i < I.memAccess.size(); i++) {
             double AddrPwr = 0.0;
             double DataPwr = 0.0;
-            if ((PTConfig.withMemAddress() || PTConfig.withMemData()) &&
-                (PTConfig.withMemoryAccessTransitions() ||
-                 PTConfig.withMemoryUpdateTransitions())) {
-                const MemoryAccess &MA = I.memAccess[i];
-                switch (MA.access) {
-                case MemoryAccess::Type::READ:
-                    // Address bus transitions modelling.
-                    if (PTConfig.withMemAddress()) {
-                        if (PTConfig.withLoadToLoadTransitions())
-                            AddrPwr += Bus::addr(MA, lastLoad);
-                        if (PTConfig.withLastMemoryAccessTransitions())
-                            AddrPwr += Bus::addr(MA, lastAccess);
-                    }
-                    // Data bus transitions modelling.
-                    if (PTConfig.withMemData()) {
-                        if (PTConfig.withLoadToLoadTransitions())
-                            DataPwr += Bus::value(MA, lastLoad);
-                        if (PTConfig.withLastMemoryAccessTransitions())
-                            DataPwr += Bus::value(MA, lastAccess);
-                    }
-                    break;
-                case MemoryAccess::Type::WRITE:
-                    // Address bus transitions modelling.
-                    if (PTConfig.withMemAddress()) {
-                        if (PTConfig.withStoreToStoreTransitions())
-                            AddrPwr += Bus::addr(MA, lastStore);
-                        if (PTConfig.withLastMemoryAccessTransitions())
-                            AddrPwr += Bus::addr(MA, lastAccess);
+            if constexpr (withMemAddress || withMemData) {
+                if (PTConfig.withMemoryAccessTransitions() ||
+                    PTConfig.withMemoryUpdateTransitions()) {
+                    const MemoryAccess &MA = I.memAccess[i];
+                    addMemoryAccess(MA, AddrPwr, DataPwr, I.time);
+                    // Remember our last memory accesses.
+                    lastAccess = &MA;
+                    switch (MA.access) {
+                    case PAF::Access::Type::READ:
+                        lastLoad = &MA;
+                        break;
+                    case PAF::Access::Type::WRITE:
+                        lastStore = &MA;
+                        break;
                     }
-                    // Data bus transitions modelling.
-                    if (PTConfig.withMemData()) {
-                        if (PTConfig.withStoreToStoreTransitions())
-                            DataPwr += Bus::value(MA, lastStore);
-                        if (PTConfig.withLastMemoryAccessTransitions())
-                            DataPwr += Bus::value(MA, lastAccess);
-                    }
-                    // Memory point update.
-                    if (PTConfig.withMemoryUpdateTransitions()) {
-                        DataPwr += HD<typeof(MemoryAccess::value)>(
-                            MA.value, oracle.getMemoryState(MA.addr, MA.size,
-                                                            I.time - 1));
-                    }
-                    break;
-                }
-                // Remember our last memory accesses.
-                lastAccess = &MA;
-                switch (MA.access) {
-                case PAF::Access::Type::READ:
-                    lastLoad = &MA;
-                    break;
-                case PAF::Access::Type::WRITE:
-                    lastStore = &MA;
-                    break;
                 }
             }
-            memory.emplace_back(AddrPwr, DataPwr);
+            memory.push_back(MemAccessPower(AddrPwr, DataPwr));
         }
 
         psr = 0.0;
         outputRegs.clear();
         // Register accesses estimated power consumption
-        for (const RegisterAccess &RA : I.regAccess) {
+        for (size_t r = 0; r < I.regAccess.size(); r++) {
+            const RegisterAccess &RA = I.regAccess[r];
             switch (RA.access) {
             // Output registers.
             case RegisterAccess::Type::WRITE:
-                if (cpu.isStatusRegister(RA.name))
-                    psr = regs(cpu.registerId(RA.name), RA.value);
+                if (SI.isStatusRegister(r)) {
+                    if constexpr (withOutputs)
+                        psr = regs(SI.registerId(r), RA.value);
+                } else if constexpr (withOutputs)
+                    outputRegs.push_back(regs(SI.registerId(r), RA.value));
                 else
-                    outputRegs.push_back(
-                        regs(cpu.registerId(RA.name), RA.value));
+                    outputRegs.push_back(0.0);
                 break;
             // Ignore input registers.
             case RegisterAccess::Type::READ:
@@ -363,7 +595,7 @@ class HammingDistancePM : public PowerModelBase {
             }
         }
 
-        setLastInstrCycles();
+        this->setLastInstrCycles();
     }
 
   private:
@@ -374,8 +606,82 @@ class HammingDistancePM : public PowerModelBase {
     const MemoryAccess *lastLoad;
     const MemoryAccess *lastStore;
     const MemoryAccess *lastAccess;
+
+    // Accumulate the address and data bus transitions of MA, performed at
+    // time t, into AddrPwr and DataPwr.
+    void addMemoryAccess(const MemoryAccess &MA, double &AddrPwr,
+                         double &DataPwr, Time t) const {
+        switch (MA.access) {
+        case MemoryAccess::Type::READ:
+            // Address bus transitions modelling.
+            if constexpr (withMemAddress) {
+                if (PTConfig.withLoadToLoadTransitions())
+                    AddrPwr += Bus::addr(MA, lastLoad);
+                if (PTConfig.withLastMemoryAccessTransitions())
+                    AddrPwr += Bus::addr(MA, lastAccess);
+            }
+            // Data bus transitions modelling.
+            if constexpr (withMemData) {
+                if (PTConfig.withLoadToLoadTransitions())
+                    DataPwr += Bus::value(MA, lastLoad);
+                if (PTConfig.withLastMemoryAccessTransitions())
+                    DataPwr += Bus::value(MA, lastAccess);
+            }
+            break;
+        case MemoryAccess::Type::WRITE:
+            // Address bus transitions modelling.
+            if constexpr (withMemAddress) {
+                if (PTConfig.withStoreToStoreTransitions())
+                    AddrPwr += Bus::addr(MA, lastStore);
+                if (PTConfig.withLastMemoryAccessTransitions())
+                    AddrPwr += Bus::addr(MA, lastAccess);
+            }
+            // Data bus transitions modelling.
+            if constexpr (withMemData) {
+                if (PTConfig.withStoreToStoreTransitions())
+                    DataPwr += Bus::value(MA, lastStore);
+                if (PTConfig.withLastMemoryAccessTransitions())
+                    DataPwr += Bus::value(MA, lastAccess);
+            }
+            // Memory point update.
+            if (PTConfig.withMemoryUpdateTransitions()) {
+                DataPwr += HD<typeof(MemoryAccess::value)>(
+                    MA.value, oracle.getMemoryState(MA.addr, MA.size, t - 1));
+            }
+            break;
+        }
+    }
 };
 
+template <template <unsigned> class PM, unsigned Sources, class... Args>
+unique_ptr<PowerModelBase> createPowerModel(Args &&...args) {
+    return std::make_unique<PM<Sources>>(std::forward<Args>(args)...);
+}
+
+// Create the PM power model specialized for PTConfig's power sources, which
+// will be constructed from PTConfig and args.
+template <template <unsigned> class PM, size_t... Sources, class... Args>
+unique_ptr<PowerModelBase>
+createPowerModel(std::index_sequence<Sources...>, const PAF::ArchInfo &CPU,
+                 const PowerTraceConfig &PTConfig, Args &&...args) {
+    using Creator = unique_ptr<PowerModelBase> (*)(
+        const PAF::ArchInfo &, const PowerTraceConfig &, Args &&...);
+    static const Creator creators[] = {
+        &createPowerModel<PM, Sources, const PAF::ArchInfo &,
+                          const PowerTraceConfig &, Args...>...};
+    return creators[PTConfig.getSources()](CPU, PTConfig,
+                                           std::forward<Args>(args)...);
+}
+
+template <template <unsigned> class PM, class... Args>
+unique_ptr<PowerModelBase> createPowerModel(const PAF::ArchInfo &CPU,
+                                            const PowerTraceConfig &PTConfig,
+                                            Args &&...args) {
+    return createPowerModel<PM>(
+        std::make_index_sequence<PowerTraceConfig::WITH_ALL + 1>(), CPU,
+        PTConfig, std::forward<Args>(args)...);
+}
+
 } // namespace
 
 namespace PAF::SCA {
@@ -386,7 +692,8 @@ void TimingInfo::saveToFile(const string &filename) const {
     if (filename.empty() || pcCycle.empty())
         return;
 
-    std::ofstream os(filename.c_str(), std::ofstream::out);
+    std::ofstream os(filename.c_str(),
+                     std::ofstream::out | std::ofstream::binary);
     save(os);
 }
 
@@ -407,6 +714,85 @@ void YAMLTimingInfo::save(ostream &os) const {
     os << " ]\n";
 }
 
+void BinaryTimingInfo::save(ostream &os) const {
+    BinaryTraceWriter W(&os, BinaryTraceContent::TIMING, compressed);
+    W.write(BinaryTraceRecord(BinaryTraceRecord::STATS, cmin, cmax));
+    for (const auto &p : pcCycle)
+        W.write(BinaryTraceRecord(BinaryTraceRecord::TIMING, p.first,
+                                  p.second));
+    // Intentionally ignore the return value.
+    static_cast<void>(W.close());
+}
+
+/// NPYPowerDumper::TypedWriter converts the samples to Ty before writing them
+/// with an NPYStreamWriter.
+template <typename Ty>
+class NPYPowerDumper::TypedWriter : public NPYPowerDumper::Writer {
+  public:
+    TypedWriter(const string &filename, double scale)
+        : npyW(filename), scale(scale) {}
+
+    void append(const double *values, size_t n) override {
+        for (size_t i = 0; i < n; i++)
+            npyW.append(convert(values[i] * scale));
+    }
+
+    void next() override { npyW.next(); }
+
+    bool close() override { return npyW.close(); }
+
+  private:
+    NPYStreamWriter<Ty> npyW;
+    const double scale;
+
+    static Ty convert(double v) {
+        if constexpr (std::is_integral_v<Ty>) {
+            constexpr double max = std::numeric_limits<Ty>::max();
+            v = std::round(v);
+            return v <= 0.0 ? Ty(0) : v >= max ? Ty(max) : Ty(v);
+        } else
+            return Ty(v);
+    }
+};
+
+NPYPowerDumper::NPYPowerDumper(const string &filename, size_t num_traces,
+                               DType dtype, double scale)
+    : FilenameDumper(filename) {
+    switch (dtype) {
+    case DType::UINT8:
+        npyW = std::make_unique<TypedWriter<uint8_t>>(filename, scale);
+        break;
+    case DType::UINT16:
+        npyW = std::make_unique<TypedWriter<uint16_t>>(filename, scale);
+        break;
+    case DType::FLOAT:
+        npyW = std::make_unique<TypedWriter<float>>(filename, scale);
+        break;
+    case DType::DOUBLE:
+        npyW = std::make_unique<TypedWriter<double>>(filename, scale);
+        break;
+    }
+}
+
+NPYPowerDumper::~NPYPowerDumper() {
+    // Intentionally ignore the return value.
+    static_cast<void>(npyW->close());
+}
+
+bool NPYPowerDumper::getDType(DType &dtype, const string &s) {
+    if (s == "u1")
+        dtype = DType::UINT8;
+    else if (s == "u2")
+        dtype = DType::UINT16;
+    else if (s == "f4")
+        dtype = DType::FLOAT;
+    else if (s == "f8")
+        dtype = DType::DOUBLE;
+    else
+        return false;
+    return true;
+}
+
 CSVPowerDumper::CSVPowerDumper(const string &filename, bool detailed_output)
     : FileStreamDumper(filename), sep(","), detailedOutput(detailed_output) {
     *this << std::fixed << std::setprecision(2);
@@ -477,6 +863,111 @@ void CSVPowerDumper::dump(double total, double pc, double instr, double oreg,
     *this << '\n';
 }
 
+void PowerSamples::reserve(size_t n) {
+    total.reserve(n);
+    pc.reserve(n);
+    instr.reserve(n);
+    oreg.reserve(n);
+    ireg.reserve(n);
+    addr.reserve(n);
+    data.reserve(n);
+    instruction.reserve(n);
+}
+
+void PowerSamples::clear() {
+    total.clear();
+    pc.clear();
+    instr.clear();
+    oreg.clear();
+    ireg.clear();
+    addr.clear();
+    data.clear();
+    instruction.clear();
+}
+
+void PowerDumper::dumpSamples(const PowerSamples &S) {
+    for (size_t i = 0; i < S.size(); i++)
+        dump(S.total[i], S.pc[i], S.instr[i], S.oreg[i], S.ireg[i], S.addr[i],
+             S.data[i], S.instruction[i]);
+}
+
+void BufferedPowerDumper::dumpSamples(const PowerSamples &S) {
+    PowerSamples &samples = rows.back();
+    samples.total.insert(samples.total.end(), S.total.begin(), S.total.end());
+    samples.pc.insert(samples.pc.end(), S.pc.begin(), S.pc.end());
+    samples.instr.insert(samples.instr.end(), S.instr.begin(), S.instr.end());
+    samples.oreg.insert(samples.oreg.end(), S.oreg.begin(), S.oreg.end());
+    samples.ireg.insert(samples.ireg.end(), S.ireg.begin(), S.ireg.end());
+    samples.addr.insert(samples.addr.end(), S.addr.begin(), S.addr.end());
+    samples.data.insert(samples.data.end(), S.data.begin(), S.data.end());
+    for (const ReferenceInstruction *I : S.instruction)
+        samples.instruction.push_back(
+            I == nullptr ? nullptr : &instructions.emplace_back(*I));
+}
+
+void BufferedPowerDumper::replay(PowerDumper &D) const {
+    if (!started)
+        return;
+    D.preDump();
+    for (size_t r = 0; r < rows.size(); r++) {
+        if (r > 0)
+            D.nextTrace();
+        D.dumpSamples(rows[r]);
+    }
+    D.postDump();
+}
+
+namespace {
+// Track the position of the instructions and cycles of a PowerTrace relative
+// to the window of the trace to analyze.
+class WindowTracker {
+  public:
+    WindowTracker(const PowerTraceConfig::Window &W)
+        : W(W), anchored(!W.hasAnchor()) {}
+
+    /// Is the end of the window passed, i.e. nothing more will be dumped ?
+    [[nodiscard]] bool done() const { return anchored && pos >= W.getEnd(); }
+
+    /// Start the processing of instruction \p I.
+    void start(const ReferenceInstruction &I) {
+        if (!anchored && (I.pc & ~Addr(1)) == (W.getAnchor() & ~Addr(1)))
+            anchored = true;
+        inWindow = false;
+        if (anchored && W.getUnit() == PowerTraceConfig::Window::INSTRUCTIONS) {
+            inWindow = pos >= W.getBegin() && pos < W.getEnd();
+            pos += 1;
+        }
+    }
+
+    /// Get the sub-range [first, last( of the next \p n cycles of the current
+    /// instruction which are in the window, relative to the first of them.
+    std::pair<unsigned, unsigned> cycles(unsigned n) {
+        if (!anchored)
+            return {0, 0};
+        if (W.getUnit() == PowerTraceConfig::Window::INSTRUCTIONS)
+            return {0, inWindow ? n : 0};
+        const size_t first = std::max(pos, W.getBegin());
+        const size_t last = std::min(pos + n, W.getEnd());
+        const size_t start = pos;
+        pos += n;
+        if (first >= last)
+            return {0, 0};
+        inWindow = true;
+        return {first - start, last - start};
+    }
+
+    /// Does the current instruction have (some of its cycles) in the window ?
+    [[nodiscard]] bool isInWindow() const { return inWindow; }
+
+  private:
+    const PowerTraceConfig::Window &W;
+    /// The position, in the window unit, from the anchor.
+    size_t pos{0};
+    bool anchored;
+    bool inWindow{false};
+};
+} // namespace
+
 void PowerTrace::analyze(std::vector<PowerAnalysisConfig> &PAConfigs,
                          Oracle &oracle, TimingInfo &timing,
                          RegBankDumper &RBDumper,
@@ -492,53 +983,79 @@ void PowerTrace::analyze(std::vector<PowerAnalysisConfig> &PAConfigs,
     if (IDumper.enabled())
         IDumper.preDump();
 
+    oracle.start(instructions[0].time - 1);
+
     vector<unique_ptr<PowerModelBase>> PMs;
     PMs.reserve(PAConfigs.size());
     for (auto &cfg : PAConfigs) {
         cfg.getDumper().preDump();
         switch (cfg.getPowerModel()) {
         case PowerAnalysisConfig::HAMMING_WEIGHT:
-            PMs.emplace_back(new HammingWeightPM(CPU, PTConfig, cfg));
+            PMs.emplace_back(
+                createPowerModel<HammingWeightPM>(CPU, PTConfig, cfg));
             break;
         case PowerAnalysisConfig::HAMMING_DISTANCE:
-            PMs.emplace_back(new HammingDistancePM(
+            PMs.emplace_back(createPowerModel<HammingDistancePM>(
                 CPU, PTConfig, cfg, oracle,
                 oracle.getRegBankState(instructions[0].time - 1)));
             break;
         }
     }
 
-    for (unsigned i = 0; i < instructions.size(); i++) {
+    // The instructions outside of the window are still added to the power
+    // models, so that their state (and the cycle count) is tracked, but
+    // their power is neither computed nor dumped.
+    StaticInstrInfoCache SICache(CPU);
+    WindowTracker window(PTConfig.getWindow());
+    for (unsigned i = 0; i < instructions.size() && !window.done(); i++) {
         const ReferenceInstruction &I = instructions[i];
-        for (auto &pm : PMs) {
-            pm->add(I);
-            pm->dump(&I);
-        }
+        const StaticInstrInfo &SI = SICache.get(I);
+        window.start(I);
+        for (auto &pm : PMs)
+            pm->add(I, SI);
         unsigned cycles = PMs[0]->getLastInstrCycles();
-        timing.add(I.pc, cycles);
-        const auto regBank = oracle.getRegBankState(I.time);
-        if (RBDumper.enabled())
-            RBDumper.dump(regBank);
-        if (MADumper.enabled())
-            MADumper.dump(I.pc, I.memAccess);
-        if (IDumper.enabled())
-            IDumper.dump(I, regBank);
+        const auto instrCycles = window.cycles(cycles);
+        if (instrCycles.first != instrCycles.second)
+            for (auto &pm : PMs)
+                pm->dump(&I, instrCycles.first, instrCycles.second);
+        oracle.update(I);
+        if (window.isInWindow()) {
+            timing.add(I.pc, cycles);
+            vector<uint64_t> regBank;
+            if (RBDumper.enabled() || IDumper.enabled())
+                regBank = oracle.getRegBankState(I.time);
+            if (RBDumper.enabled())
+                RBDumper.dump(regBank);
+            if (MADumper.enabled())
+                MADumper.dump(I.pc, I.memAccess);
+            if (IDumper.enabled())
+                IDumper.dump(I, regBank);
+        }
 
         // Insert dummy cycles when needed if we are not at the end of the
         // sequence.
         if (i < instructions.size() - 1) {
-            if (CPU.isBranch(I)) {
+            if (SI.isBranch) {
                 unsigned bcycles = CPU.getCycles(I, &instructions[i + 1]);
                 if (bcycles > cycles) {
-                    timing.incr(bcycles - cycles);
-                    for (unsigned i = 0; i < bcycles - cycles; i++)
+                    unsigned dummyCycles = 0;
+                    for (unsigned i = 0; i < bcycles - cycles; i++) {
+                        const auto c = window.cycles(cycles);
+                        if (c.first == c.second)
+                            continue;
+                        dummyCycles += 1;
                         for (auto &pm : PMs)
-                            pm->dump();
+                            pm->dump(nullptr, c.first, c.second);
+                    }
+                    if (dummyCycles)
+                        timing.incr(dummyCycles);
                 }
             }
         }
     }
 
+    for (auto &pm : PMs)
+        pm->flush();
     for (auto &cfg : PAConfigs)
         cfg.getDumper().postDump();
 
@@ -550,6 +1067,149 @@ void PowerTrace::analyze(std::vector<PowerAnalysisConfig> &PAConfigs,
         IDumper.postDump();
 }
 
+PowerTrace::ShadowOracle::ShadowOracle(unique_ptr<Oracle> &&backing,
+                                       const ArchInfo &CPU, bool big_endian)
+    : backing(std::move(backing)), CPU(CPU), bigEndian(big_endian) {
+    for (unsigned r = 0; r < CPU.numRegisters(); r++)
+        regIds[CPU.registerName(r)] = r;
+    const auto pc = regIds.find("pc");
+    pcId = pc != regIds.end() ? pc->second : CPU.numRegisters();
+}
+
+vector<uint64_t> PowerTrace::ShadowOracle::getRegBankState(Time t) const {
+    if (!tracking || t < currentTime)
+        return backing->getRegBankState(t);
+    return regs;
+}
+
+uint64_t PowerTrace::ShadowOracle::getMemoryState(Addr address, size_t size,
+                                                  Time t) const {
+    if (!tracking || t < currentTime)
+        return backing->getMemoryState(address, size, t);
+
+    // Fetch the bytes never seen so far from the backing oracle: they have
+    // not changed since the start of the trace. The whole access is fetched
+    // at once when none of its bytes is known.
+    bool all_unknown = true;
+    for (size_t b = 0; b < size && all_unknown; b++)
+        all_unknown = memory.count(address + b) == 0;
+    if (all_unknown) {
+        const uint64_t v = backing->getMemoryState(address, size, startTime);
+        for (size_t b = 0; b < size; b++)
+            memory[address + b] =
+                v >> (8 * (bigEndian ? size - 1 - b : b)) & 0xFF;
+    } else {
+        for (size_t b = 0; b < size; b++)
+            if (memory.count(address + b) == 0)
+                memory[address + b] =
+                    backing->getMemoryState(address + b, 1, startTime);
+    }
+
+    uint64_t v = 0;
+    for (size_t b = 0; b < size; b++) {
+        v <<= 8;
+        v |= memory[address + (bigEndian ? b : size - 1 - b)];
+    }
+    return v;
+}
+
+void PowerTrace::ShadowOracle::start(Time t) {
+    regs = backing->getRegBankState(t);
+    // A backing oracle without any state, e.g. for streamed traces, starts
+    // from an all zero register bank.
+    regs.resize(CPU.numRegisters(), 0);
+    memory.clear();
+    startTime = t;
+    currentTime = t;
+    tracking = true;
+}
+
+void PowerTrace::ShadowOracle::update(const ReferenceInstruction &I) {
+    for (const RegisterAccess &RA : I.regAccess) {
+        if (RA.access != RegisterAccess::Type::WRITE)
+            continue;
+        if (RA.id != RegisterAccess::UNKNOWN_ID) {
+            if (RA.id < regs.size())
+                regs[RA.id] = RA.value;
+            continue;
+        }
+        auto it = regIds.find(RA.name);
+        if (it == regIds.end()) {
+            string name = RA.name;
+            std::transform(name.begin(), name.end(), name.begin(),
+                           [](unsigned char c) { return std::tolower(c); });
+            it = regIds.find(name);
+        }
+        // Registers not modelled by the CPU are not part of the state.
+        if (it != regIds.end() && it->second < regs.size())
+            regs[it->second] = RA.value;
+    }
+    // The pc is the one of the last executed instruction, as in the index.
+    if (pcId < regs.size())
+        regs[pcId] = I.pc;
+
+    // Both loads and stores expose the memory content.
+    for (const MemoryAccess &MA : I.memAccess)
+        for (size_t b = 0; b < MA.size; b++)
+            memory[MA.addr + b] =
+                MA.value >> (8 * (bigEndian ? MA.size - 1 - b : b)) & 0xFF;
+
+    currentTime = I.time;
+}
+
+PowerTraceRecorder::PowerTraceRecorder(
+    const vector<PowerAnalysisConfig> &PAConfigs, const RegBankDumper &RBDumper,
+    const MemoryAccessesDumper &MADumper, const InstrDumper &IDumper)
+    : RBDumper(RBDumper.enabled()), MADumper(MADumper.enabled()),
+      IDumper(IDumper.enabled()) {
+    this->PAConfigs.reserve(PAConfigs.size());
+    powerDumpers.reserve(PAConfigs.size());
+    for (const auto &cfg : PAConfigs) {
+        auto dumper = std::make_unique<BufferedPowerDumper>();
+        powerDumpers.push_back(dumper.get());
+        this->PAConfigs.emplace_back(cfg, std::move(dumper));
+    }
+}
+
+void PowerTraceRecorder::replay(vector<PowerAnalysisConfig> &PAConfigs,
+                                TimingInfo &timing, RegBankDumper &RBDumper,
+                                MemoryAccessesDumper &MADumper,
+                                InstrDumper &IDumper) const {
+    assert(PAConfigs.size() == powerDumpers.size() &&
+           "Mismatch in the number of power analyses");
+    for (size_t i = 0; i < powerDumpers.size(); i++)
+        powerDumpers[i]->replay(PAConfigs[i].getDumper());
+    timing.add(this->timing);
+    this->RBDumper.replay(RBDumper);
+    this->MADumper.replay(MADumper);
+    this->IDumper.replay(IDumper);
+}
+
+namespace {
+// FastModel simulate some of the dual load or store accesses as single 64-bit
+// accesses: break those accesses of I in 2 x 32-bit accesses.
+void splitDualAccesses(ReferenceInstruction &I) {
+    if (I.iset != ISet::THUMB || I.width != 32)
+        return;
+    bool index = ((I.instruction >> 24) & 0x01) == 1;
+    bool wback = ((I.instruction >> 21) & 0x01) == 1;
+    if ((I.instruction >> 25) == 0x74 && ((I.instruction >> 22) & 0x01) == 1 &&
+        ((index && !wback) || wback)) {
+        if (I.memAccess.size() == 1) {
+            MemoryAccess MA = I.memAccess[0];
+            assert(MA.size == 8 &&
+                   "Expecting an 8-byte memory access for LDRD or STRD");
+            I.memAccess.clear();
+            I.memAccess.emplace_back(4, MA.addr, MA.value & 0x0FFFFFFFF,
+                                     MA.access);
+            I.memAccess.emplace_back(4, MA.addr + 4,
+                                     MA.value >> (8 * 4) & 0x0FFFFFFFF,
+                                     MA.access);
+        }
+    }
+}
+} // namespace
+
 PowerTrace PowerAnalyzer::getPowerTrace(const PowerTraceConfig &PTConfig,
                                         const ArchInfo &CPU,
                                         const ExecutionRange &ER) {
@@ -559,59 +1219,91 @@ PowerTrace PowerAnalyzer::getPowerTrace(const PowerTraceConfig &PTConfig,
         PowerTrace &trace;
         const PowerTraceConfig &PTConfig;
         const ArchInfo &CPU;
+        InstrInfoCache &IICache;
 
         PTCont(MTAnalyzer &MTA, PowerTrace &PT,
-               const PowerTraceConfig &PTConfig)
+               const PowerTraceConfig &PTConfig, InstrInfoCache &IICache)
             : analyzer(MTA), trace(PT), PTConfig(PTConfig),
-              CPU(PT.getArchInfo()) {}
+              CPU(PT.getArchInfo()), IICache(IICache) {}
 
         void operator()(ReferenceInstruction &I) {
             if (PTConfig.withInstructionsInputs()) {
-                const InstrInfo II = CPU.getInstrInfo(I);
+                const InstrInfo &II = IICache.get(I);
                 for (const auto &r :
                      II.getUniqueInputRegisters(/* Implicit: */ false)) {
                     const char *name = CPU.registerName(r);
                     uint32_t value =
                         analyzer.getRegisterValueAtTime(name, I.time - 1);
                     I.add(RegisterAccess(name, value,
-                                         RegisterAccess::Type::READ));
-                }
-            }
-
-            /* FastModel simulate some of the dual load or store accesses as
-             * single 64-bit accesses: break those accesses in 2 x 32-bit
-             * accesses. */
-            if (I.iset == ISet::THUMB && I.width == 32) {
-                bool index = ((I.instruction >> 24) & 0x01) == 1;
-                bool wback = ((I.instruction >> 21) & 0x01) == 1;
-                if ((I.instruction >> 25) == 0x74 &&
-                    ((I.instruction >> 22) & 0x01) == 1 &&
-                    ((index && !wback) || wback)) {
-                    if (I.memAccess.size() == 1) {
-                        MemoryAccess MA = I.memAccess[0];
-                        assert(MA.size == 8 && "Expecting an 8-byte memory "
-                                               "access for LDRD or STRD");
-                        I.memAccess.clear();
-                        I.memAccess.emplace_back(
-                            4, MA.addr, MA.value & 0x0FFFFFFFF, MA.access);
-                        I.memAccess.emplace_back(
-                            4, MA.addr + 4, MA.value >> (8 * 4) & 0x0FFFFFFFF,
-                            MA.access);
-                    }
+                                         RegisterAccess::Type::READ, r));
                 }
             }
 
+            splitDualAccesses(I);
             trace.add(I);
         }
     };
 
+    if (!IICache || &IICache->getArchInfo() != &CPU)
+        IICache = std::make_unique<InstrInfoCache>(CPU);
+
     PowerTrace PT(PTConfig, CPU);
-    PTCont PTC(*this, PT, PTConfig);
+    PTCont PTC(*this, PT, PTConfig, *IICache);
     FromTraceBuilder<ReferenceInstruction, ReferenceInstructionBuilder, PTCont>
         FTB(indexNavigator);
+    FTB.setArchInfo(&CPU);
+    // The instructions inputs are looked up in the trace by the continuation,
+    // which can then not run concurrently with the parsing.
+    if (!PTConfig.withInstructionsInputs())
+        FTB.setPipelineDepth(FTB.PIPELINE_DEPTH);
     FTB.build(ER, PTC);
 
     return PT;
 }
 
+PowerTrace PowerAnalyzer::getPowerTrace(const PowerTraceConfig &PTConfig,
+                                        const ArchInfo &CPU, std::istream &is,
+                                        bool isBigEndian) {
+
+    // Without an index, the register values are tracked along the stream.
+    struct StreamPTCont {
+        PowerTrace &trace;
+        const PowerTraceConfig &PTConfig;
+        const ArchInfo &CPU;
+        InstrInfoCache IICache;
+        vector<uint64_t> regs;
+
+        StreamPTCont(PowerTrace &PT, const PowerTraceConfig &PTConfig)
+            : trace(PT), PTConfig(PTConfig), CPU(PT.getArchInfo()),
+              IICache(CPU), regs(CPU.numRegisters(), 0) {}
+
+        void operator()(ReferenceInstruction &I) {
+            if (PTConfig.withInstructionsInputs()) {
+                const InstrInfo &II = IICache.get(I);
+                for (const auto &r :
+                     II.getUniqueInputRegisters(/* Implicit: */ false))
+                    I.add(RegisterAccess(CPU.registerName(r), regs[r],
+                                         RegisterAccess::Type::READ, r));
+            }
+            for (const RegisterAccess &RA : I.regAccess)
+                if (RA.access == RegisterAccess::Type::WRITE &&
+                    RA.id < regs.size())
+                    regs[RA.id] = RA.value;
+
+            splitDualAccesses(I);
+            trace.add(I);
+        }
+    };
+
+    PowerTrace PT(PTConfig, CPU);
+    StreamPTCont PTC(PT, PTConfig);
+    FromStreamBuilder<ReferenceInstruction, ReferenceInstructionBuilder,
+                      StreamPTCont>
+        FSB(is);
+    FSB.setArchInfo(&CPU);
+    FSB.build(PTC, isBigEndian);
+
+    return PT;
+}
+
 } // namespace PAF::SCA
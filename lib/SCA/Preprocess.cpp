@@ -0,0 +1,259 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/Preprocess.h"
+#include "PAF/SCA/NPArray.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using std::vector;
+
+namespace PAF::SCA {
+
+namespace {
+// The filters are applied by blocks of BLOCK output samples, so that a block
+// stays in the L1 cache while the taps are accumulated into it one by one.
+constexpr size_t BLOCK = 1024;
+// The number of independent partial sums in the reductions, so that they can
+// be vectorized.
+constexpr size_t LANES = 4;
+
+// Copy the n samples at in to padded, extended with before (resp. after)
+// replicas of the first (resp. last) sample.
+void pad(vector<double> &padded, const double *in, size_t n, size_t before,
+         size_t after) {
+    padded.resize(before + n + after);
+    std::fill_n(padded.begin(), before, in[0]);
+    std::copy(in, in + n, padded.begin() + before);
+    std::fill_n(padded.begin() + before + n, after, in[n - 1]);
+}
+
+// Get the sum of the n samples at x.
+double sum(const double *x, size_t n) {
+    double acc[LANES] = {};
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES)
+        for (size_t l = 0; l < LANES; l++)
+            acc[l] += x[i + l];
+    for (; i < n; i++)
+        acc[0] += x[i];
+    return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+// Get the dot product of the n samples at x and y.
+double dot(const double *x, const double *y, size_t n) {
+    double acc[LANES] = {};
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES)
+        for (size_t l = 0; l < LANES; l++)
+            acc[l] += x[i + l] * y[i + l];
+    for (; i < n; i++)
+        acc[0] += x[i] * y[i];
+    return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+// Get the taps of the anti-aliasing filter for a downsampling by factor: a
+// Hamming windowed sinc over 4 * factor + 1 samples, with a unit gain at DC.
+vector<double> lowPass(size_t factor) {
+    if (factor == 1)
+        return {1.0};
+
+    const size_t half = 2 * factor;
+    const double cutoff = 0.5 / double(factor);
+    vector<double> taps(2 * half + 1);
+    double total = 0.0;
+    for (size_t k = 0; k < taps.size(); k++) {
+        const double m = double(k) - double(half);
+        const double sinc =
+            m == 0.0 ? 2.0 * cutoff
+                     : std::sin(2.0 * M_PI * cutoff * m) / (M_PI * m);
+        const double window =
+            0.54 - 0.46 * std::cos(2.0 * M_PI * double(k) / double(2 * half));
+        taps[k] = sinc * window;
+        total += taps[k];
+    }
+    for (double &t : taps)
+        t /= total;
+    return taps;
+}
+} // namespace
+
+Preprocessor &Preprocessor::addFIR(vector<double> taps) {
+    assert(!taps.empty() && "A FIR filter needs at least one tap");
+    stages.push_back({Stage::FIR, taps.size(), 0, std::move(taps)});
+    return *this;
+}
+
+Preprocessor &Preprocessor::addMovingAverage(size_t width) {
+    assert(width > 0 && "The moving average width can not be 0");
+    stages.push_back({Stage::MOVING_AVERAGE, width, 0, {}});
+    return *this;
+}
+
+Preprocessor &Preprocessor::addDownsample(size_t factor) {
+    assert(factor > 0 && "The downsampling factor can not be 0");
+    stages.push_back({Stage::DOWNSAMPLE, factor, 0, lowPass(factor)});
+    return *this;
+}
+
+Preprocessor &Preprocessor::addIntegrate(size_t period, size_t offset) {
+    assert(period > 0 && "The integration period can not be 0");
+    stages.push_back({Stage::INTEGRATE, period, offset, {}});
+    return *this;
+}
+
+size_t Preprocessor::samples(const Stage &S, size_t n) {
+    switch (S.kind) {
+    case Stage::FIR:
+    case Stage::MOVING_AVERAGE:
+        return n;
+    case Stage::DOWNSAMPLE:
+        return (n + S.n - 1) / S.n;
+    case Stage::INTEGRATE:
+        return n > S.offset ? (n - S.offset) / S.n : 0;
+    }
+    return 0;
+}
+
+size_t Preprocessor::samples(size_t num_samples) const {
+    for (const Stage &S : stages)
+        num_samples = samples(S, num_samples);
+    return num_samples;
+}
+
+void Preprocessor::apply(const Stage &S, double *out, const double *in,
+                         size_t n, vector<double> &padded) {
+    if (n == 0)
+        return;
+
+    switch (S.kind) {
+    case Stage::FIR: {
+        // Accumulate the taps one at a time into each block of output
+        // samples: the inner loop is a contiguous multiply-add.
+        const size_t len = S.taps.size();
+        const size_t half = (len - 1) / 2;
+        pad(padded, in, n, half, len - 1 - half);
+        for (size_t ib = 0; ib < n; ib += BLOCK) {
+            const size_t ie = std::min(ib + BLOCK, n);
+            std::fill(out + ib, out + ie, 0.0);
+            for (size_t k = 0; k < len; k++) {
+                const double t = S.taps[k];
+                const double *x = &padded[k];
+                for (size_t i = ib; i < ie; i++)
+                    out[i] += t * x[i];
+            }
+        }
+    } break;
+
+    case Stage::MOVING_AVERAGE: {
+        // Differences of the prefix sums of the padded samples, computed in
+        // place, give the sums of all windows.
+        const size_t width = S.n;
+        const size_t half = (width - 1) / 2;
+        pad(padded, in, n, half, width - 1 - half);
+        for (size_t i = 1; i < padded.size(); i++)
+            padded[i] += padded[i - 1];
+        const double scale = 1.0 / double(width);
+        out[0] = padded[width - 1] * scale;
+        const double *last = &padded[width];
+        const double *first = &padded[0];
+        for (size_t i = 1; i < n; i++)
+            out[i] = (last[i - 1] - first[i - 1]) * scale;
+    } break;
+
+    case Stage::DOWNSAMPLE: {
+        // Only the kept samples are filtered.
+        const size_t len = S.taps.size();
+        const size_t half = (len - 1) / 2;
+        pad(padded, in, n, half, len - 1 - half);
+        const size_t m = samples(S, n);
+        for (size_t j = 0; j < m; j++)
+            out[j] = dot(S.taps.data(), &padded[j * S.n], len);
+    } break;
+
+    case Stage::INTEGRATE: {
+        const size_t m = samples(S, n);
+        for (size_t j = 0; j < m; j++)
+            out[j] = sum(&in[S.offset + j * S.n], S.n);
+    } break;
+    }
+}
+
+void Preprocessor::apply(double *out, const double *in, size_t n,
+                         Scratch &scratch) const {
+    if (stages.empty()) {
+        std::copy(in, in + n, out);
+        return;
+    }
+
+    // Each stage reads the output of the previous one, the last stage
+    // writing directly to out.
+    const double *src = in;
+    for (size_t s = 0; s < stages.size(); s++) {
+        const Stage &S = stages[s];
+        const size_t m = samples(S, n);
+        double *dst = out;
+        if (s + 1 != stages.size()) {
+            scratch.stage[s % 2].resize(m);
+            dst = scratch.stage[s % 2].data();
+        }
+        apply(S, dst, src, n, scratch.padded);
+        src = dst;
+        n = m;
+    }
+}
+
+template <typename Ty>
+NPArray<double> Preprocessor::apply(const NPArrayView<Ty> &traces) const {
+    const size_t n = traces.cols();
+    NPArray<double> result(traces.rows(), samples(n));
+    if (result.cols() == 0)
+        return result;
+
+    NPArrayBase::parallelFor(
+        0, traces.rows(), n * (size() + 1), [&](size_t b, size_t e) {
+            Scratch scratch;
+            vector<double> row(n);
+            for (size_t r = b; r < e; r++) {
+                for (size_t c = 0; c < n; c++)
+                    row[c] = double(traces(r, c));
+                apply(&result(r, 0), row.data(), n, scratch);
+            }
+        });
+
+    return result;
+}
+
+// Instantiate the pipeline application for the supported trace storage types.
+#define INSTANTIATE_PREPROCESS(Ty)                                             \
+    template NPArray<double> Preprocessor::apply(const NPArrayView<Ty> &)      \
+        const;
+
+INSTANTIATE_PREPROCESS(double)
+INSTANTIATE_PREPROCESS(float)
+INSTANTIATE_PREPROCESS(int16_t)
+INSTANTIATE_PREPROCESS(uint16_t)
+
+} // namespace PAF::SCA
@@ -0,0 +1,75 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/ShardedNPArray.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include <glob.h>
+
+using std::ifstream;
+using std::string;
+using std::vector;
+
+namespace PAF::SCA {
+
+vector<string> expandShards(const string &spec) {
+    vector<string> filenames;
+
+    // A manifest file.
+    if (!spec.empty() && spec[0] == '@') {
+        const string manifest = spec.substr(1);
+        ifstream ifs(manifest);
+        if (!ifs)
+            return filenames;
+
+        const size_t slash = manifest.rfind('/');
+        const string dir =
+            slash == string::npos ? string() : manifest.substr(0, slash + 1);
+        string line;
+        while (std::getline(ifs, line)) {
+            const size_t b = line.find_first_not_of(" \t");
+            if (b == string::npos || line[b] == '#')
+                continue;
+            const size_t e = line.find_last_not_of(" \t\r");
+            const string filename = line.substr(b, e - b + 1);
+            filenames.push_back(filename[0] == '/' ? filename : dir + filename);
+        }
+        return filenames;
+    }
+
+    // A plain file name.
+    if (spec.find_first_of("*?[") == string::npos) {
+        filenames.push_back(spec);
+        return filenames;
+    }
+
+    // A glob pattern.
+    glob_t g;
+    if (glob(spec.c_str(), 0, nullptr, &g) == 0)
+        for (size_t i = 0; i < g.gl_pathc; i++)
+            filenames.emplace_back(g.gl_pathv[i]);
+    globfree(&g);
+    std::sort(filenames.begin(), filenames.end());
+    return filenames;
+}
+
+} // namespace PAF::SCA
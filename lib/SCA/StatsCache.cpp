@@ -0,0 +1,174 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/StatsCache.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+using std::ifstream;
+using std::string;
+using std::vector;
+
+namespace {
+// The amount of data hashed at the start and end of the large files.
+constexpr size_t FILE_CHUNK_SIZE = 64 * 1024;
+
+// Get key as the fixed width hexadecimal string used in the file names.
+string keyString(uint64_t key) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)key);
+    return buf;
+}
+
+// Parse the "B-E.npy" suffix of a state file name into b and e.
+bool parseRange(const char *s, size_t &b, size_t &e) {
+    char *end;
+    errno = 0;
+    b = std::strtoull(s, &end, 10);
+    if (end == s || *end != '-')
+        return false;
+    s = end + 1;
+    e = std::strtoull(s, &end, 10);
+    return end != s && string(end) == ".npy" && errno == 0 && b <= e;
+}
+} // namespace
+
+namespace PAF::SCA {
+
+StatsCache::Key &StatsCache::Key::add(const void *data, size_t size) {
+    const auto *p = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return *this;
+}
+
+StatsCache::Key &StatsCache::Key::addFile(const string &filename) {
+    struct stat st;
+    if (filename.empty() || stat(filename.c_str(), &st) != 0)
+        return add(uint64_t(0));
+    const auto size = uint64_t(st.st_size);
+    add(size);
+    add(uint64_t(st.st_mtime));
+
+    // Hash the whole content of small files, or else their head and tail.
+    ifstream ifs(filename, ifstream::binary);
+    vector<char> buf(FILE_CHUNK_SIZE);
+    const auto chunk = [&](uint64_t offset, size_t n) {
+        ifs.clear();
+        ifs.seekg(offset);
+        ifs.read(buf.data(), n);
+        add(buf.data(), ifs.gcount());
+    };
+    if (size <= 2 * FILE_CHUNK_SIZE) {
+        buf.resize(size);
+        chunk(0, size);
+    } else {
+        chunk(0, FILE_CHUNK_SIZE);
+        chunk(size - FILE_CHUNK_SIZE, FILE_CHUNK_SIZE);
+    }
+    return *this;
+}
+
+StatsCache::StatsCache(const string &directory) : directory(directory) {
+    if (directory.empty()) {
+        errstr = "no cache directory";
+        return;
+    }
+    if (mkdir(directory.c_str(), 0777) != 0 && errno != EEXIST) {
+        errstr = "can not create the cache directory";
+        return;
+    }
+    struct stat st;
+    if (stat(directory.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+        errstr = "the cache directory is not a directory";
+}
+
+string StatsCache::getFilename(uint64_t key, size_t b, size_t e) const {
+    return directory + '/' + keyString(key) + '-' + std::to_string(b) + '-' +
+           std::to_string(e) + ".npy";
+}
+
+string StatsCache::lookup(uint64_t key, size_t b, size_t e,
+                          NPArrayBase::Window &window) const {
+    if (!good())
+        return {};
+
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+        return {};
+
+    // Among the states covering [b, e(, use the narrowest one.
+    const string prefix = keyString(key) + '-';
+    string best;
+    size_t bestBegin = 0;
+    size_t bestEnd = 0;
+    while (const struct dirent *entry = readdir(dir)) {
+        const string name = entry->d_name;
+        size_t sb;
+        size_t se;
+        if (name.compare(0, prefix.size(), prefix) != 0 ||
+            !parseRange(name.c_str() + prefix.size(), sb, se))
+            continue;
+        if (sb > b || se < e)
+            continue;
+        if (best.empty() || se - sb < bestEnd - bestBegin) {
+            best = name;
+            bestBegin = sb;
+            bestEnd = se;
+        }
+    }
+    closedir(dir);
+
+    if (best.empty())
+        return {};
+    window = NPArrayBase::Window(0, -1, b - bestBegin, e - bestBegin);
+    return directory + '/' + best;
+}
+
+string StatsCache::getTemporaryFilename(const string &filename) {
+    return filename + ".tmp." + std::to_string(getpid());
+}
+
+bool StatsCache::commit(bool saved, const string &tmpFilename,
+                        const string &filename) {
+    if (!saved) {
+        std::remove(tmpFilename.c_str());
+        errstr = "can not save the state file";
+        return false;
+    }
+    if (std::rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+        std::remove(tmpFilename.c_str());
+        errstr = "can not rename the state file";
+        return false;
+    }
+    return true;
+}
+
+} // namespace PAF::SCA
@@ -0,0 +1,101 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/Synthetic.h"
+#include "PAF/SCA/Expr.h"
+#include "PAF/SCA/SCA.h"
+
+#include <array>
+#include <cassert>
+
+using std::array;
+
+namespace PAF::SCA {
+
+namespace {
+// The splitmix64 finalizer: different inputs, even consecutive ones, give
+// unrelated outputs.
+uint64_t mix(uint64_t z) {
+    z += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Use the same AES SBox as the AES_SBOX expression operator.
+const array<uint8_t, 256> &getSBox() {
+    static const array<uint8_t, 256> SBox = [] {
+        array<uint8_t, 256> S;
+        for (unsigned b = 0; b < S.size(); b++)
+            S[b] = Expr::AESSBox(
+                       new Expr::Constant(Expr::ValueType::UINT8, b))
+                       .eval()
+                       .getValue();
+        return S;
+    }();
+    return SBox;
+}
+} // namespace
+
+SyntheticTraces::SyntheticTraces(size_t numSamples, size_t leakSample,
+                                 uint8_t key, NoiseSource::Type noiseTy,
+                                 double noiseLevel, uint64_t seed)
+    : numSamples(numSamples), leakSample(leakSample), key(key), seed(seed),
+      noise(NoiseSource::getSource(noiseTy, noiseLevel, seed)),
+      noiseSamples(numSamples) {
+    assert(leakSample < numSamples && "Leaking sample out of the trace");
+}
+
+uint8_t SyntheticTraces::getInput(size_t n) const {
+    return mix(seed ^ mix(n)) & 0xFF;
+}
+
+unsigned SyntheticTraces::getLeakage(size_t n) const {
+    return hamming_weight<uint8_t>(getSBox()[getInput(n) ^ key], 0xFF);
+}
+
+void SyntheticTraces::getTrace(size_t n, double *samples) {
+    // The background activity: the hamming weight of random bytes, drawn 8
+    // at a time from a stream unrelated to the input.
+    uint64_t state = mix(~seed ^ mix(n));
+    uint64_t bytes = 0;
+    for (size_t s = 0; s < numSamples; s++) {
+        if (s % 8 == 0)
+            bytes = mix(state++);
+        samples[s] = hamming_weight<uint8_t>(bytes & 0xFF, 0xFF);
+        bytes >>= 8;
+    }
+    samples[leakSample] = getLeakage(n);
+
+    noise->seed(mix(seed + n));
+    noise->fill(noiseSamples.data(), numSamples);
+    for (size_t s = 0; s < numSamples; s++)
+        samples[s] += noiseSamples[s];
+}
+
+NPArray<uint32_t> SyntheticTraces::getInputs(size_t first,
+                                             size_t numTraces) const {
+    NPArray<uint32_t> inputs(numTraces, 1);
+    for (size_t r = 0; r < numTraces; r++)
+        inputs(r, 0) = getInput(first + r);
+    return inputs;
+}
+
+} // namespace PAF::SCA
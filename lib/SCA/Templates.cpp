@@ -0,0 +1,401 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/Templates.h"
+#include "PAF/SCA/NPArray.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::vector;
+
+namespace PAF::SCA {
+
+namespace {
+// The scatter matrix is updated by square tiles of TILE x TILE elements, small
+// enough to stay in the L1 cache while the traces of a batch are streamed.
+constexpr size_t TILE = 32;
+// The number of traces in a rank-k update of the scatter matrix.
+constexpr size_t TRACES_PER_BATCH = 4096;
+// The number of traces matched together, sharing the whitened means reads.
+constexpr size_t TRACES_PER_BLOCK = 16;
+
+// Whiten x in place, i.e. replace it with L^-1 x, Lt being the Cholesky
+// factor L of the n x n covariance matrix stored column by column.
+void whiten(const double *Lt, size_t n, double *x) {
+    for (size_t k = 0; k < n; k++) {
+        const double *col = &Lt[k * n];
+        const double z = x[k] / col[k];
+        x[k] = z;
+        for (size_t i = k + 1; i < n; i++)
+            x[i] -= col[i] * z;
+    }
+}
+} // namespace
+
+Templates::Templates(NPArray<double> means, NPArray<double> covariance)
+    : mu(std::move(means)), cov(std::move(covariance)) {
+    prepare();
+}
+
+Templates::Templates(const std::string &filename) {
+    const NPArray<double> a(filename);
+    if (!a.good()) {
+        errstr = a.error();
+        return;
+    }
+    if (a.cols() == 0 || a.rows() <= a.cols()) {
+        errstr = "wrong dimensions for templates";
+        return;
+    }
+
+    const size_t numClasses = a.rows() - a.cols();
+    mu = NPArray<double>(&a(0, 0), numClasses, a.cols());
+    cov = NPArray<double>(&a(numClasses, 0), a.cols(), a.cols());
+    prepare();
+}
+
+void Templates::prepare() {
+    const size_t P = cov.rows();
+    const size_t K = mu.rows();
+    if (cov.cols() != P || mu.cols() != P) {
+        errstr = "wrong dimensions for the template means or covariance";
+        return;
+    }
+
+    // Cholesky factorization of the covariance, L being stored column by
+    // column so that the whitening walks it contiguously.
+    chol.assign(P * P, 0.0);
+    double logDet = 0.0;
+    for (size_t j = 0; j < P; j++) {
+        double d = cov(j, j);
+        for (size_t k = 0; k < j; k++)
+            d -= chol[k * P + j] * chol[k * P + j];
+        if (!(d > 0.0)) {
+            errstr = "the covariance matrix is not positive definite";
+            return;
+        }
+        const double ljj = std::sqrt(d);
+        chol[j * P + j] = ljj;
+        logDet += 2.0 * std::log(ljj);
+        for (size_t i = j + 1; i < P; i++) {
+            double s = cov(i, j);
+            for (size_t k = 0; k < j; k++)
+                s -= chol[k * P + i] * chol[k * P + j];
+            chol[j * P + i] = s / ljj;
+        }
+    }
+    logNorm = -0.5 * (double(P) * std::log(2.0 * M_PI) + logDet);
+
+    // Center the means on their average, for accuracy.
+    center.assign(P, 0.0);
+    size_t numValid = 0;
+    for (size_t c = 0; c < K; c++) {
+        if (std::isnan(mu(c, 0)))
+            continue;
+        numValid += 1;
+        for (size_t p = 0; p < P; p++)
+            center[p] += mu(c, p);
+    }
+    if (numValid != 0)
+        for (size_t p = 0; p < P; p++)
+            center[p] /= double(numValid);
+
+    // Whiten the means. A class without a mean gets an infinite norm, and
+    // thus a -infinity log-likelihood for all traces.
+    whitenedMeans.assign(P * K, 0.0);
+    whitenedNorms.assign(K, std::numeric_limits<double>::infinity());
+    vector<double> v(P);
+    for (size_t c = 0; c < K; c++) {
+        if (std::isnan(mu(c, 0)))
+            continue;
+        for (size_t p = 0; p < P; p++)
+            v[p] = mu(c, p) - center[p];
+        whiten(chol.data(), P, v.data());
+        double norm = 0.0;
+        for (size_t p = 0; p < P; p++) {
+            whitenedMeans[p * K + c] = v[p];
+            norm += v[p] * v[p];
+        }
+        whitenedNorms[c] = norm;
+    }
+}
+
+template <typename Ty>
+NPArray<double> Templates::match(const NPArrayView<Ty> &traces) const {
+    assert(good() && "Can not match traces with bad templates");
+    assert(traces.cols() == pois() &&
+           "Number of POIs does not match the templates'");
+    const size_t P = pois();
+    const size_t K = classes();
+    const size_t numBlocks =
+        (traces.rows() + TRACES_PER_BLOCK - 1) / TRACES_PER_BLOCK;
+
+    // With z the whitened trace and v the whitened mean of a class, the
+    // log-likelihood is logNorm - 0.5 * (|z|^2 - 2 z.v + |v|^2). The z.v dot
+    // products of a block of traces are computed together, as a matrix
+    // product which streams each row of whitenedMeans once per block.
+    NPArray<double> result(traces.rows(), K);
+    NPArrayBase::parallelFor(
+        0, numBlocks, TRACES_PER_BLOCK * P * (P + K),
+        [&](size_t bb, size_t be) {
+            vector<double> z(TRACES_PER_BLOCK * P);
+            double zNorms[TRACES_PER_BLOCK];
+            for (size_t b = bb; b < be; b++) {
+                const size_t tb = b * TRACES_PER_BLOCK;
+                const size_t n =
+                    std::min(TRACES_PER_BLOCK, traces.rows() - tb);
+                for (size_t t = 0; t < n; t++) {
+                    double *zt = &z[t * P];
+                    for (size_t p = 0; p < P; p++)
+                        zt[p] = double(traces(tb + t, p)) - center[p];
+                    whiten(chol.data(), P, zt);
+                    zNorms[t] = 0.0;
+                    for (size_t p = 0; p < P; p++)
+                        zNorms[t] += zt[p] * zt[p];
+                    std::fill(&result(tb + t, 0), &result(tb + t, 0) + K,
+                              0.0);
+                }
+                for (size_t p = 0; p < P; p++) {
+                    const double *v = &whitenedMeans[p * K];
+                    for (size_t t = 0; t < n; t++) {
+                        const double zp = z[t * P + p];
+                        double *row = &result(tb + t, 0);
+                        for (size_t c = 0; c < K; c++)
+                            row[c] += zp * v[c];
+                    }
+                }
+                for (size_t t = 0; t < n; t++) {
+                    double *row = &result(tb + t, 0);
+                    for (size_t c = 0; c < K; c++)
+                        row[c] = logNorm - 0.5 * (zNorms[t] - 2.0 * row[c] +
+                                                  whitenedNorms[c]);
+                }
+            }
+        });
+    return result;
+}
+
+bool Templates::save(const std::string &filename) const {
+    return concatenate(mu, cov, NPArray<double>::COLUMN).save(filename);
+}
+
+template <typename Ty>
+TemplateBuilder<Ty>::TemplateBuilder(size_t num_classes, size_t num_pois)
+    : numClasses(num_classes), numPOIs(num_pois), counts(num_classes, 0),
+      sums(num_classes * num_pois, 0.0), scatter(num_pois * num_pois, 0.0) {}
+
+template <typename Ty> size_t TemplateBuilder<Ty>::count() const noexcept {
+    size_t total = 0;
+    for (size_t n : counts)
+        total += n;
+    return total;
+}
+
+template <typename Ty>
+void TemplateBuilder<Ty>::add(const NPArrayView<Ty> &traces,
+                              const vector<uint32_t> &classes,
+                              size_t first_trace) {
+    assert(traces.cols() == pois() &&
+           "Number of POIs does not match the builder's");
+    assert(classes.size() >= first_trace + traces.rows() &&
+           "Not enough classes for the traces");
+    const size_t P = numPOIs;
+    if (traces.rows() == 0 || P == 0)
+        return;
+
+    if (reference.empty()) {
+        reference.resize(P);
+        for (size_t p = 0; p < P; p++)
+            reference[p] = double(traces(0, p));
+    }
+
+    // The upper triangle tiles of the scatter matrix, which are updated
+    // independently.
+    const size_t numTiles = (P + TILE - 1) / TILE;
+    vector<std::pair<size_t, size_t>> tiles;
+    for (size_t ti = 0; ti < numTiles; ti++)
+        for (size_t tj = ti; tj < numTiles; tj++)
+            tiles.emplace_back(ti * TILE, tj * TILE);
+
+    vector<double> Y;
+    for (size_t bb = 0; bb < traces.rows(); bb += TRACES_PER_BATCH) {
+        const size_t be = std::min(bb + TRACES_PER_BATCH, traces.rows());
+
+        // Gather the batch traces with a valid class, relative to the
+        // reference, and update the class sums.
+        Y.clear();
+        for (size_t t = bb; t < be; t++) {
+            const uint32_t c = classes[first_trace + t];
+            if (c >= numClasses)
+                continue;
+            counts[c] += 1;
+            double *s = &sums[c * P];
+            for (size_t p = 0; p < P; p++) {
+                const double y = double(traces(t, p)) - reference[p];
+                Y.push_back(y);
+                s[p] += y;
+            }
+        }
+        const size_t n = Y.size() / P;
+        if (n == 0)
+            continue;
+
+        // The rank-n update of the scatter matrix, one tile at a time: the
+        // tile is accumulated locally with outer products of the traces'
+        // rows, whose inner loop is vectorizable.
+        NPArrayBase::parallelFor(
+            0, tiles.size(), n * TILE * TILE, [&](size_t b, size_t e) {
+                double acc[TILE * TILE];
+                for (size_t k = b; k < e; k++) {
+                    const size_t ib = tiles[k].first;
+                    const size_t jb = tiles[k].second;
+                    const size_t ni = std::min(TILE, P - ib);
+                    const size_t nj = std::min(TILE, P - jb);
+                    std::fill(acc, acc + TILE * TILE, 0.0);
+                    // 4 traces are accumulated at a time, to amortize the
+                    // loads and stores of the tile.
+                    size_t t = 0;
+                    for (; t + 4 <= n; t += 4) {
+                        const double *y0 = &Y[t * P];
+                        const double *y1 = y0 + P;
+                        const double *y2 = y1 + P;
+                        const double *y3 = y2 + P;
+                        for (size_t i = 0; i < ni; i++) {
+                            const double a0 = y0[ib + i];
+                            const double a1 = y1[ib + i];
+                            const double a2 = y2[ib + i];
+                            const double a3 = y3[ib + i];
+                            double *row = &acc[i * TILE];
+                            for (size_t j = 0; j < nj; j++)
+                                row[j] += a0 * y0[jb + j] + a1 * y1[jb + j] +
+                                          a2 * y2[jb + j] + a3 * y3[jb + j];
+                        }
+                    }
+                    for (; t < n; t++) {
+                        const double *y = &Y[t * P];
+                        for (size_t i = 0; i < ni; i++) {
+                            const double a = y[ib + i];
+                            double *row = &acc[i * TILE];
+                            for (size_t j = 0; j < nj; j++)
+                                row[j] += a * y[jb + j];
+                        }
+                    }
+                    for (size_t i = 0; i < ni; i++)
+                        for (size_t j = 0; j < nj; j++)
+                            scatter[(ib + i) * P + jb + j] += acc[i * TILE + j];
+                }
+            });
+    }
+}
+
+template <typename Ty>
+bool TemplateBuilder<Ty>::merge(const TemplateBuilder &other) {
+    if (other.classes() != classes() || other.pois() != pois())
+        return false;
+    if (other.reference.empty())
+        return true;
+    if (reference.empty()) {
+        *this = other;
+        return true;
+    }
+
+    // Move other's accumulators to our reference: with d the difference of
+    // the references, the samples y relative to other's reference become
+    // y + d, so the sums get n.d added, and the scatter matrix gets
+    // d.Sy^t + Sy.d^t + N.d.d^t, with Sy the sum of all of other's samples.
+    const size_t P = numPOIs;
+    vector<double> d(P);
+    for (size_t p = 0; p < P; p++)
+        d[p] = other.reference[p] - reference[p];
+    vector<double> total(P, 0.0);
+    for (size_t c = 0; c < numClasses; c++) {
+        counts[c] += other.counts[c];
+        for (size_t p = 0; p < P; p++) {
+            const double s = other.sums[c * P + p];
+            total[p] += s;
+            sums[c * P + p] += s + double(other.counts[c]) * d[p];
+        }
+    }
+    const double N = double(other.count());
+    NPArrayBase::parallelFor(0, P, P, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; i++)
+            for (size_t j = i; j < P; j++)
+                scatter[i * P + j] += other.scatter[i * P + j] +
+                                      d[i] * total[j] + total[i] * d[j] +
+                                      N * d[i] * d[j];
+    });
+    return true;
+}
+
+template <typename Ty> Templates TemplateBuilder<Ty>::build() const {
+    const size_t P = numPOIs;
+    size_t numValid = 0;
+    NPArray<double> means(numClasses, P);
+    for (size_t c = 0; c < numClasses; c++) {
+        if (counts[c] != 0)
+            numValid += 1;
+        for (size_t p = 0; p < P; p++)
+            means(c, p) =
+                counts[c] == 0
+                    ? std::numeric_limits<double>::quiet_NaN()
+                    : sums[c * P + p] / double(counts[c]) + reference[p];
+    }
+
+    // The pooled within class scatter is the scatter of the samples minus the
+    // scatter of the class means: S - sum_c(Sc.Sc^t / nc).
+    const double dof = double(count()) - double(numValid);
+    NPArray<double> covariance(P, P);
+    NPArrayBase::parallelFor(0, P, P * numClasses, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; i++)
+            for (size_t j = i; j < P; j++) {
+                double w = scatter[i * P + j];
+                for (size_t c = 0; c < numClasses; c++)
+                    if (counts[c] != 0)
+                        w -= sums[c * P + i] * sums[c * P + j] /
+                             double(counts[c]);
+                covariance(i, j) = w / dof;
+            }
+    });
+    for (size_t i = 0; i < P; i++)
+        for (size_t j = 0; j < i; j++)
+            covariance(i, j) = covariance(j, i);
+
+    return {std::move(means), std::move(covariance)};
+}
+
+// Instantiate the templates matching and building for the supported trace
+// storage types.
+#define INSTANTIATE_TEMPLATES(Ty)                                              \
+    template NPArray<double> Templates::match(const NPArrayView<Ty> &) const;  \
+    template class TemplateBuilder<Ty>;
+
+INSTANTIATE_TEMPLATES(double)
+INSTANTIATE_TEMPLATES(float)
+INSTANTIATE_TEMPLATES(int16_t)
+INSTANTIATE_TEMPLATES(uint16_t)
+
+} // namespace PAF::SCA
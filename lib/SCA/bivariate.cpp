@@ -0,0 +1,369 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/SCA.h"
+#include "PAF/SCA/ShardedNPArray.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using std::vector;
+
+namespace PAF::SCA {
+
+namespace {
+/// The pairs of samples are processed by square tiles of TILE x TILE pairs,
+/// whose sums stay in the L1 cache while a block of traces is walked.
+constexpr size_t TILE = 32;
+/// The number of traces centered at a time.
+constexpr size_t TRACES_PER_BLOCK = 1024;
+
+/// The sums of the centered products of all pairs of samples, of their squares
+/// and, for the correlation, of their products with the centered intermediate
+/// values, over a group of traces. Only the upper triangle (i <= j) of each
+/// matrix is meaningful.
+struct PairSums {
+    PairSums(size_t nbsamples, bool with_ival)
+        : nbsamples(nbsamples), sumP(nbsamples * nbsamples, 0.0),
+          sumP2(nbsamples * nbsamples, 0.0),
+          sumPH(with_ival ? nbsamples * nbsamples : 0, 0.0) {}
+
+    const size_t nbsamples;
+    size_t count = 0;
+    vector<double> sumP;
+    vector<double> sumP2;
+    vector<double> sumPH;
+};
+
+/// Get the upper triangle tiles of an n x n matrix, as the first row and
+/// column of each tile.
+vector<std::pair<size_t, size_t>> upperTiles(size_t n) {
+    vector<std::pair<size_t, size_t>> tiles;
+    for (size_t ib = 0; ib < n; ib += TILE)
+        for (size_t jb = ib; jb < n; jb += TILE)
+            tiles.emplace_back(ib, jb);
+    return tiles;
+}
+
+/// Accumulate in \p sums the centered products of the pairs of samples of the
+/// \p rows traces in \p centered (a row per trace, already centered). \p h,
+/// if not null, holds the centered intermediate value of each trace. Each
+/// tile of pairs accumulates the products of all traces in local sums, with
+/// a vectorizable inner loop, before adding them to \p sums, so that the
+/// tiles can be processed in parallel.
+void accumulatePairs(PairSums &sums, const double *centered, size_t rows,
+                     const double *h,
+                     const vector<std::pair<size_t, size_t>> &tiles) {
+    const size_t n = sums.nbsamples;
+    NPArrayBase::parallelFor(
+        0, tiles.size(), rows * TILE * TILE, [&](size_t b, size_t e) {
+            double p1[TILE * TILE];
+            double p2[TILE * TILE];
+            double ph[TILE * TILE];
+            for (size_t k = b; k < e; k++) {
+                const size_t ib = tiles[k].first;
+                const size_t jb = tiles[k].second;
+                const size_t ni = std::min(TILE, n - ib);
+                const size_t nj = std::min(TILE, n - jb);
+                std::fill(p1, p1 + TILE * TILE, 0.0);
+                std::fill(p2, p2 + TILE * TILE, 0.0);
+                std::fill(ph, ph + TILE * TILE, 0.0);
+                for (size_t t = 0; t < rows; t++) {
+                    const double *ci = &centered[t * n + ib];
+                    const double *cj = &centered[t * n + jb];
+                    const double hv = h ? h[t] : 0.0;
+                    for (size_t i = 0; i < ni; i++) {
+                        const double a = ci[i];
+                        double *r1 = &p1[i * TILE];
+                        double *r2 = &p2[i * TILE];
+                        double *rh = &ph[i * TILE];
+                        for (size_t j = 0; j < nj; j++) {
+                            const double p = a * cj[j];
+                            r1[j] += p;
+                            r2[j] += p * p;
+                            rh[j] += p * hv;
+                        }
+                    }
+                }
+                for (size_t i = 0; i < ni; i++)
+                    for (size_t j = 0; j < nj; j++) {
+                        const size_t idx = (ib + i) * n + jb + j;
+                        sums.sumP[idx] += p1[i * TILE + j];
+                        sums.sumP2[idx] += p2[i * TILE + j];
+                        if (h)
+                            sums.sumPH[idx] += ph[i * TILE + j];
+                    }
+            }
+        });
+    sums.count += rows;
+}
+
+/// Accumulate in \p sums the sums of the samples from \p b of \p traces, for
+/// the traces of group \p group according to \p groups (with \p first_trace
+/// the index of the first trace in \p groups).
+template <typename Ty>
+void sumSamples(vector<double> &sums, size_t b, const NPArrayView<Ty> &traces,
+                const vector<int> &groups, int group, size_t first_trace) {
+    NPArrayBase::parallelFor(
+        0, sums.size(), traces.rows(), [&](size_t sb, size_t se) {
+            for (size_t t = 0; t < traces.rows(); t++) {
+                if (groups[first_trace + t] != group)
+                    continue;
+                for (size_t s = sb; s < se; s++)
+                    sums[s] += double(traces(t, b + s));
+            }
+        });
+}
+
+/// Accumulate the centered products of the traces of group \p group (with
+/// \p groups giving the group of each trace, \p first_trace being the index
+/// of the first trace), centered on \p mean, a block of traces at a time. \p
+/// hc, if not empty, holds the centered intermediate value of each trace.
+template <typename Ty>
+void addPairs(PairSums &sums, size_t b, const NPArrayView<Ty> &traces,
+              const vector<int> &groups, int group, size_t first_trace,
+              const vector<double> &mean, const vector<double> &hc,
+              const vector<std::pair<size_t, size_t>> &tiles) {
+    const size_t n = sums.nbsamples;
+    vector<double> centered;
+    vector<double> h;
+    for (size_t tb = 0; tb < traces.rows(); tb += TRACES_PER_BLOCK) {
+        const size_t te = std::min(tb + TRACES_PER_BLOCK, traces.rows());
+        centered.clear();
+        h.clear();
+        for (size_t t = tb; t < te; t++) {
+            if (groups[first_trace + t] != group)
+                continue;
+            for (size_t s = 0; s < n; s++)
+                centered.push_back(double(traces(t, b + s)) - mean[s]);
+            if (!hc.empty())
+                h.push_back(hc[first_trace + t]);
+        }
+        if (!centered.empty())
+            accumulatePairs(sums, centered.data(), centered.size() / n,
+                            hc.empty() ? nullptr : h.data(), tiles);
+    }
+}
+
+/// Mirror the upper triangle of the n x n matrix \p m to its lower triangle.
+void symmetrize(NPArray<double> &m) {
+    for (size_t i = 0; i < m.rows(); i++)
+        for (size_t j = 0; j < i; j++)
+            m(i, j) = m(j, i);
+}
+
+/// Bivariate t-test on the traces \p feed passes, one chunk at a time, to the
+/// function it is called with, as f(chunk, first_trace). The traces are
+/// walked twice: once for the group means, and once for the centered
+/// products.
+template <typename Ty, class FeedFn>
+NPArray<double> bivariateTTest(size_t b, size_t e,
+                               const vector<Classification> &classifier,
+                               const FeedFn &feed) {
+    const size_t n = e - b;
+    vector<int> groups(classifier.size());
+    for (size_t t = 0; t < classifier.size(); t++)
+        groups[t] = classifier[t] == Classification::GROUP_0   ? 0
+                    : classifier[t] == Classification::GROUP_1 ? 1
+                                                               : -1;
+
+    vector<double> mean[2] = {vector<double>(n, 0.0),
+                              vector<double>(n, 0.0)};
+    size_t count[2] = {0, 0};
+    feed([&](const NPArrayView<Ty> &traces, size_t first_trace) {
+        for (int g = 0; g < 2; g++)
+            sumSamples(mean[g], b, traces, groups, g, first_trace);
+        for (size_t t = 0; t < traces.rows(); t++)
+            if (groups[first_trace + t] >= 0)
+                count[groups[first_trace + t]] += 1;
+    });
+    assert(count[0] > 1 && count[1] > 1 &&
+           "groups must have more than one trace");
+    for (int g = 0; g < 2; g++)
+        for (double &m : mean[g])
+            m /= double(count[g]);
+
+    const vector<std::pair<size_t, size_t>> tiles = upperTiles(n);
+    PairSums sums[2] = {PairSums(n, false), PairSums(n, false)};
+    feed([&](const NPArrayView<Ty> &traces, size_t first_trace) {
+        for (int g = 0; g < 2; g++)
+            addPairs(sums[g], b, traces, groups, g, first_trace, mean[g], {},
+                     tiles);
+    });
+
+    NPArray<double> result(n, n);
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = i; j < n; j++) {
+            double m[2];
+            double v[2];
+            for (int g = 0; g < 2; g++) {
+                const double cnt = double(sums[g].count);
+                m[g] = sums[g].sumP[i * n + j] / cnt;
+                v[g] = (sums[g].sumP2[i * n + j] / cnt - m[g] * m[g]) / cnt;
+            }
+            result(i, j) = (m[0] - m[1]) / std::sqrt(v[0] + v[1]);
+        }
+    symmetrize(result);
+    return result;
+}
+
+/// Bivariate correlation on the traces \p feed passes, as for
+/// bivariateTTest.
+template <typename Ty, class FeedFn>
+NPArray<double> bivariateCorrel(size_t b, size_t e, const NPArray<double> &ival,
+                                const FeedFn &feed) {
+    const size_t n = e - b;
+    const size_t nbtraces = ival.cols();
+    const vector<int> groups(nbtraces, 0);
+
+    // Center the intermediate values.
+    double hMean = 0.0;
+    for (size_t t = 0; t < nbtraces; t++)
+        hMean += ival(0, t);
+    hMean /= double(nbtraces);
+    vector<double> hc(nbtraces);
+    double sumH = 0.0;
+    double sumH2 = 0.0;
+    for (size_t t = 0; t < nbtraces; t++) {
+        hc[t] = ival(0, t) - hMean;
+        sumH += hc[t];
+        sumH2 += hc[t] * hc[t];
+    }
+
+    vector<double> mean(n, 0.0);
+    feed([&](const NPArrayView<Ty> &traces, size_t first_trace) {
+        sumSamples(mean, b, traces, groups, 0, first_trace);
+    });
+    for (double &m : mean)
+        m /= double(nbtraces);
+
+    const vector<std::pair<size_t, size_t>> tiles = upperTiles(n);
+    PairSums sums(n, true);
+    feed([&](const NPArrayView<Ty> &traces, size_t first_trace) {
+        addPairs(sums, b, traces, groups, 0, first_trace, mean, hc, tiles);
+    });
+
+    const double cnt = double(nbtraces);
+    const double varH = sumH2 / cnt - (sumH / cnt) * (sumH / cnt);
+    NPArray<double> result(n, n);
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = i; j < n; j++) {
+            const double mP = sums.sumP[i * n + j] / cnt;
+            const double varP = sums.sumP2[i * n + j] / cnt - mP * mP;
+            const double cov = sums.sumPH[i * n + j] / cnt - mP * sumH / cnt;
+            result(i, j) = cov / std::sqrt(varP * varH);
+        }
+    symmetrize(result);
+    return result;
+}
+} // namespace
+
+template <typename Ty>
+NPArray<double> bivariate_t_test(size_t b, size_t e,
+                                 const NPArrayView<Ty> &traces,
+                                 const vector<Classification> &classifier) {
+    assert(b <= e && "Wrong begin / end samples");
+    assert(e <= traces.cols() && "Not that many samples in the trace");
+    assert(classifier.size() >= traces.rows() &&
+           "Not enough classification data for the traces");
+    if (b == e)
+        return {};
+    return bivariateTTest<Ty>(b, e, classifier, [&](const auto &f) {
+        f(traces, 0);
+    });
+}
+
+template <typename Ty>
+NPArray<double> bivariate_t_test(size_t b, size_t e,
+                                 ShardedNPArray<Ty> &traces,
+                                 const vector<Classification> &classifier) {
+    assert(b <= e && "Wrong begin / end samples");
+    assert(e <= traces.cols() && "Not that many samples in the trace");
+    assert(classifier.size() >= traces.rows() &&
+           "Not enough classification data for the traces");
+    if (b == e)
+        return {};
+    return bivariateTTest<Ty>(b, e, classifier, [&](const auto &f) {
+        traces.rewind();
+        while (traces.next())
+            f(NPArrayView<Ty>(traces.chunk()), traces.chunkBegin());
+        assert(traces.good() && "Error reading traces by chunks");
+    });
+}
+
+template <typename Ty>
+NPArray<double> bivariate_correl(size_t b, size_t e,
+                                 const NPArrayView<Ty> &traces,
+                                 const NPArray<double> &ival) {
+    assert(b <= e && "Wrong begin / end samples");
+    assert(e <= traces.cols() && "Not that many samples in the trace");
+    assert(ival.rows() == 1 && "Only one hypothesis is supported");
+    assert(ival.cols() == traces.rows() &&
+           "Number of intermediate values does not match number of traces");
+    if (b == e)
+        return {};
+    return bivariateCorrel<Ty>(b, e, ival,
+                               [&](const auto &f) { f(traces, 0); });
+}
+
+template <typename Ty>
+NPArray<double> bivariate_correl(size_t b, size_t e,
+                                 ShardedNPArray<Ty> &traces,
+                                 const NPArray<double> &ival) {
+    assert(b <= e && "Wrong begin / end samples");
+    assert(e <= traces.cols() && "Not that many samples in the trace");
+    assert(ival.rows() == 1 && "Only one hypothesis is supported");
+    assert(ival.cols() == traces.rows() &&
+           "Number of intermediate values does not match number of traces");
+    if (b == e)
+        return {};
+    return bivariateCorrel<Ty>(b, e, ival, [&](const auto &f) {
+        traces.rewind();
+        while (traces.next())
+            f(NPArrayView<Ty>(traces.chunk()), traces.chunkBegin());
+        assert(traces.good() && "Error reading traces by chunks");
+    });
+}
+
+// Instantiate the bivariate analyses for the supported trace storage types.
+#define INSTANTIATE_BIVARIATE(Ty)                                              \
+    template NPArray<double> bivariate_t_test(                                 \
+        size_t, size_t, const NPArrayView<Ty> &,                               \
+        const vector<Classification> &);                                       \
+    template NPArray<double> bivariate_t_test(                                 \
+        size_t, size_t, ShardedNPArray<Ty> &,                                  \
+        const vector<Classification> &);                                       \
+    template NPArray<double> bivariate_correl(                                 \
+        size_t, size_t, const NPArrayView<Ty> &, const NPArray<double> &);     \
+    template NPArray<double> bivariate_correl(                                 \
+        size_t, size_t, ShardedNPArray<Ty> &, const NPArray<double> &);
+
+INSTANTIATE_BIVARIATE(double)
+INSTANTIATE_BIVARIATE(float)
+INSTANTIATE_BIVARIATE(int16_t)
+INSTANTIATE_BIVARIATE(uint16_t)
+
+#undef INSTANTIATE_BIVARIATE
+
+} // namespace PAF::SCA
@@ -20,21 +20,111 @@
 
 #include "PAF/SCA/SCA.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <string>
 #include <vector>
 
 using std::sqrt;
 using std::vector;
 
 namespace PAF::SCA {
-NPArray<double> correl(size_t b, size_t e, const NPArray<double> &traces,
+
+namespace {
+/// The number of samples processed at a time by accumulate, small enough for
+/// the sums of all hypotheses over those samples to stay in the cache.
+constexpr size_t SAMPLES_PER_TILE = 128;
+
+/// Accumulate in \p sum_t and \p sum_t2 the sums of the samples and of their
+/// squares, and in \p sum_ht the sums of their products with each of the
+/// hypotheses from the intermediate values \p ival (a row per hypothesis, a
+/// column per trace), for all \p traces and the samples starting at \p b. \p
+/// first_trace is the index in \p ival of the first trace.
+///
+/// This is a blocked matrix product: the samples are split between the worker
+/// threads, each of them walking all traces row by row over tiles of its own
+/// slice of samples. Each trace sample is thus read once for all hypotheses,
+/// and the innermost loop is a contiguous multiply-add the compiler can
+/// vectorize. Each sum is updated in trace order, whatever the number of
+/// threads.
+template <typename Ty>
+void accumulate(NPArray<double> &sum_t, NPArray<double> &sum_t2,
+                NPArray<double> &sum_ht, size_t b,
+                const NPArrayView<Ty> &traces, const NPArray<double> &ival,
+                size_t first_trace = 0) {
+    const size_t nbhyp = ival.rows();
+
+    // Have the hypotheses for a trace contiguous.
+    NPArray<double> hyp(traces.rows(), nbhyp);
+    for (size_t h = 0; h < nbhyp; h++)
+        for (size_t t = 0; t < traces.rows(); t++)
+            hyp(t, h) = ival(h, first_trace + t);
+
+    NPArrayBase::parallelFor(
+        0, sum_t.cols(), traces.rows() * nbhyp, [&](size_t sb, size_t se) {
+            double v[SAMPLES_PER_TILE];
+            for (size_t tb = sb; tb < se; tb += SAMPLES_PER_TILE) {
+                const size_t n = std::min(SAMPLES_PER_TILE, se - tb);
+                for (size_t t = 0; t < traces.rows(); t++) {
+                    for (size_t i = 0; i < n; i++) {
+                        v[i] = double(traces(t, b + tb + i));
+                        sum_t(0, tb + i) += v[i];
+                        sum_t2(0, tb + i) += v[i] * v[i];
+                    }
+                    for (size_t h = 0; h < nbhyp; h++) {
+                        const double iv = hyp(t, h);
+                        double *sums = &sum_ht(h, tb);
+                        for (size_t i = 0; i < n; i++)
+                            sums[i] += v[i] * iv;
+                    }
+                }
+            }
+        });
+}
+
+/// Accumulate in \p sum_h and \p sum_h2 the sums of each hypothesis from \p
+/// ival, and of their squares, for \p nbtraces traces starting at trace \p
+/// first_trace.
+void accumulate(NPArray<double> &sum_h, NPArray<double> &sum_h2,
+                const NPArray<double> &ival, size_t first_trace,
+                size_t nbtraces) {
+    for (size_t h = 0; h < ival.rows(); h++)
+        for (size_t t = first_trace; t < first_trace + nbtraces; t++) {
+            const double iv = ival(h, t);
+            sum_h(h, 0) += iv;
+            sum_h2(h, 0) += iv * iv;
+        }
+}
+
+/// Compute the Pearson correlation of each hypothesis with each sample from
+/// the sums accumulated over \p nbtraces traces.
+NPArray<double> pearson(size_t nbtraces, const NPArray<double> &sum_h,
+                        const NPArray<double> &sum_h2,
+                        const NPArray<double> &sum_t,
+                        const NPArray<double> &sum_t2,
+                        const NPArray<double> &sum_ht) {
+    const double n = double(nbtraces);
+    NPArray<double> cvalue(sum_ht.rows(), sum_ht.cols());
+    for (size_t h = 0; h < sum_ht.rows(); h++)
+        for (size_t s = 0; s < sum_ht.cols(); s++)
+            cvalue(h, s) =
+                (n * sum_ht(h, s) - sum_h(h, 0) * sum_t(0, s)) /
+                std::sqrt((sum_h(h, 0) * sum_h(h, 0) - n * sum_h2(h, 0)) *
+                          (sum_t(0, s) * sum_t(0, s) - n * sum_t2(0, s)));
+    return cvalue;
+}
+} // namespace
+
+template <typename Ty>
+NPArray<double> correl(size_t b, size_t e, const NPArrayView<Ty> &traces,
                        const NPArray<double> &ival) {
 
     assert(b <= e && "Wrong begin / end samples");
     assert(b <= traces.cols() && "Not that many samples in the trace");
     assert(e <= traces.cols() && "Not that many samples in the trace");
-    assert(ival.size() == traces.rows() &&
+    assert(ival.cols() == traces.rows() &&
            "Number of intermediate values does not match number of traces");
 
     if (b == e)
@@ -42,31 +132,193 @@ NPArray<double> correl(size_t b, size_t e, const NPArray<double> &traces,
 
     const size_t nbtraces = traces.rows();
     const size_t nbsamples = e - b;
+    const size_t nbhyp = ival.rows();
 
     auto sum_t = NPArray<double>::zeros(1, nbsamples);
     auto sum_t2 = NPArray<double>::zeros(1, nbsamples);
-    auto sum_ht = NPArray<double>::zeros(1, nbsamples);
-    double sum_h = 0.0;
-    double sum_h2 = 0.0;
-
-    for (size_t t = 0; t < nbtraces; t++) {
-        const double iv = ival(0, t);
-        sum_h += iv;
-        sum_h2 += iv * iv;
-
-        for (size_t s = 0; s < nbsamples; s++) {
-            const double v = traces(t, b + s);
-            sum_t(0, s) += v;
-            sum_t2(0, s) += v * v;
-            sum_ht(0, s) += v * iv;
+    auto sum_ht = NPArray<double>::zeros(nbhyp, nbsamples);
+    auto sum_h = NPArray<double>::zeros(nbhyp, 1);
+    auto sum_h2 = NPArray<double>::zeros(nbhyp, 1);
+
+    accumulate(sum_h, sum_h2, ival, 0, nbtraces);
+    accumulate(sum_t, sum_t2, sum_ht, b, traces, ival);
+
+    return pearson(nbtraces, sum_h, sum_h2, sum_t, sum_t2, sum_ht);
+}
+
+namespace {
+// Pearson correlation on traces read by chunks.
+template <typename Ty, class ChunkedTraces>
+NPArray<double> chunked_correl(size_t b, size_t e, ChunkedTraces &traces,
+                               const NPArray<double> &ival) {
+
+    assert(b <= e && "Wrong begin / end samples");
+    assert(b <= traces.cols() && "Not that many samples in the trace");
+    assert(e <= traces.cols() && "Not that many samples in the trace");
+    assert(ival.cols() == traces.rows() &&
+           "Number of intermediate values does not match number of traces");
+
+    if (b == e)
+        return {};
+
+    const size_t nbtraces = traces.rows();
+    const size_t nbsamples = e - b;
+    const size_t nbhyp = ival.rows();
+
+    auto sum_t = NPArray<double>::zeros(1, nbsamples);
+    auto sum_t2 = NPArray<double>::zeros(1, nbsamples);
+    auto sum_ht = NPArray<double>::zeros(nbhyp, nbsamples);
+    auto sum_h = NPArray<double>::zeros(nbhyp, 1);
+    auto sum_h2 = NPArray<double>::zeros(nbhyp, 1);
+
+    // Accumulate the sums, one chunk of traces at a time.
+    traces.rewind();
+    while (traces.next()) {
+        const NPArray<Ty> &chunk = traces.chunk();
+        accumulate(sum_h, sum_h2, ival, traces.chunkBegin(), chunk.rows());
+        accumulate<Ty>(sum_t, sum_t2, sum_ht, b, chunk, ival,
+                       traces.chunkBegin());
+    }
+    assert(traces.good() && "Error reading traces by chunks");
+
+    return pearson(nbtraces, sum_h, sum_h2, sum_t, sum_t2, sum_ht);
+}
+} // namespace
+
+template <typename Ty>
+NPArray<double> correl(size_t b, size_t e, NPYChunkReader<Ty> &traces,
+                       const NPArray<double> &ival) {
+    return chunked_correl<Ty>(b, e, traces, ival);
+}
+
+template <typename Ty>
+NPArray<double> correl(size_t b, size_t e, ShardedNPArray<Ty> &traces,
+                       const NPArray<double> &ival) {
+    return chunked_correl<Ty>(b, e, traces, ival);
+}
+
+template <typename Ty>
+CorrelAccumulator<Ty>::CorrelAccumulator(size_t num_samples,
+                                         size_t num_hypotheses)
+    : sumH(NPArray<double>::zeros(num_hypotheses, 1)),
+      sumH2(NPArray<double>::zeros(num_hypotheses, 1)),
+      sumT(NPArray<double>::zeros(1, num_samples)),
+      sumT2(NPArray<double>::zeros(1, num_samples)),
+      sumHT(NPArray<double>::zeros(num_hypotheses, num_samples)) {}
+
+template <typename Ty>
+CorrelAccumulator<Ty>::CorrelAccumulator(const std::string &filename,
+                                         const NPArrayBase::Window &window) {
+    // The state is saved with a row for each of the sums of the samples and
+    // of their squares, and a row per hypothesis for the sums of the
+    // products of the samples with the intermediate values. They are
+    // followed by the number of traces, and by the sums of the intermediate
+    // values and of their squares for each hypothesis, repeated on a row
+    // each.
+    const NPArray<double> state(
+        filename, NPArrayBase::Window(0, -1, window.colBegin, window.colEnd,
+                                      window.colStride));
+    if (!state.good()) {
+        errstr = state.error();
+        return;
+    }
+    if (state.rows() < 6 || state.rows() % 3 != 0) {
+        errstr = "wrong number of rows in correlation accumulator state";
+        return;
+    }
+
+    const size_t nbhyp = (state.rows() - 3) / 3;
+    sumH = NPArray<double>::zeros(nbhyp, 1);
+    sumH2 = NPArray<double>::zeros(nbhyp, 1);
+    sumT = NPArray<double>(1, state.cols());
+    sumT2 = NPArray<double>(1, state.cols());
+    sumHT = NPArray<double>(nbhyp, state.cols());
+    for (size_t s = 0; s < state.cols(); s++) {
+        sumT(0, s) = state(0, s);
+        sumT2(0, s) = state(1, s);
+        for (size_t h = 0; h < nbhyp; h++)
+            sumHT(h, s) = state(2 + h, s);
+    }
+    if (state.cols() != 0) {
+        n = size_t(state(2 + nbhyp, 0));
+        for (size_t h = 0; h < nbhyp; h++) {
+            sumH(h, 0) = state(3 + nbhyp + h, 0);
+            sumH2(h, 0) = state(3 + 2 * nbhyp + h, 0);
         }
     }
+}
 
-    NPArray<double> cvalue = (double(nbtraces) * sum_ht - sum_h * sum_t) /
-                             sqrt((sum_h * sum_h - double(nbtraces) * sum_h2) *
-                                  (sum_t * sum_t - double(nbtraces) * sum_t2));
+template <typename Ty>
+void CorrelAccumulator<Ty>::add(const NPArrayView<Ty> &traces, double ival) {
+    add(traces, NPArray<double>(hypotheses(), traces.rows()).fill(ival));
+}
 
-    return cvalue;
+template <typename Ty>
+void CorrelAccumulator<Ty>::add(const NPArrayView<Ty> &traces,
+                                const NPArray<double> &ival,
+                                size_t first_trace) {
+    assert(traces.cols() == samples() &&
+           "Number of samples does not match the accumulator's");
+    assert(ival.rows() == hypotheses() &&
+           "Number of hypotheses does not match the accumulator's");
+    assert(ival.cols() >= first_trace + traces.rows() &&
+           "Not enough intermediate values for the traces");
+    accumulate(sumH, sumH2, ival, first_trace, traces.rows());
+    n += traces.rows();
+    accumulate(sumT, sumT2, sumHT, 0, traces, ival, first_trace);
+}
+
+template <typename Ty>
+bool CorrelAccumulator<Ty>::merge(const CorrelAccumulator &other) {
+    if (other.samples() != samples() || other.hypotheses() != hypotheses())
+        return false;
+    n += other.n;
+    sumH += other.sumH;
+    sumH2 += other.sumH2;
+    sumT += other.sumT;
+    sumT2 += other.sumT2;
+    sumHT += other.sumHT;
+    return true;
+}
+
+template <typename Ty> NPArray<double> CorrelAccumulator<Ty>::correl() const {
+    if (samples() == 0)
+        return {};
+    return pearson(n, sumH, sumH2, sumT, sumT2, sumHT);
 }
 
+template <typename Ty>
+bool CorrelAccumulator<Ty>::save(const std::string &filename) const {
+    const size_t nbhyp = hypotheses();
+    NPArray<double> state(3 + 3 * nbhyp, samples());
+    for (size_t s = 0; s < samples(); s++) {
+        state(0, s) = sumT(0, s);
+        state(1, s) = sumT2(0, s);
+        state(2 + nbhyp, s) = double(n);
+        for (size_t h = 0; h < nbhyp; h++) {
+            state(2 + h, s) = sumHT(h, s);
+            state(3 + nbhyp + h, s) = sumH(h, 0);
+            state(3 + 2 * nbhyp + h, s) = sumH2(h, 0);
+        }
+    }
+    return state.save(filename);
+}
+
+// Instantiate the correlations for the supported trace storage types.
+#define INSTANTIATE_CORREL(Ty)                                                 \
+    template NPArray<double> correl(size_t, size_t, const NPArrayView<Ty> &,   \
+                                    const NPArray<double> &);                  \
+    template NPArray<double> correl(size_t, size_t, NPYChunkReader<Ty> &,      \
+                                    const NPArray<double> &);                  \
+    template NPArray<double> correl(size_t, size_t, ShardedNPArray<Ty> &,      \
+                                    const NPArray<double> &);                  \
+    template class CorrelAccumulator<Ty>;
+
+INSTANTIATE_CORREL(double)
+INSTANTIATE_CORREL(float)
+INSTANTIATE_CORREL(int16_t)
+INSTANTIATE_CORREL(uint16_t)
+
+#undef INSTANTIATE_CORREL
+
 } // namespace PAF::SCA
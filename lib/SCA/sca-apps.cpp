@@ -21,15 +21,21 @@
 #include "PAF/SCA/sca-apps.h"
 #include "PAF/SCA/NPArray.h"
 #include "PAF/SCA/utils.h"
+#include "PAF/utils/Stats.h"
 
 #include "libtarmac/reporter.hh"
 
+#include <algorithm>
 #include <cassert>
+#include <charconv>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
+using PAF::Stats;
 using PAF::SCA::find_max;
 
 using std::cout;
@@ -64,6 +70,19 @@ SCAApp::SCAApp(const char *appname, int argc, char *argv[])
              [this]() { outputFormat = OutputBase::OUTPUT_NUMPY; });
     optnoval({"--perfect"}, "assume perfect inputs (i.e. no noise).",
              [this]() { perfect = true; });
+    optnoval({"--mmap"},
+             "memory map the traces instead of reading them (only when no "
+             "conversion is performed).",
+             [this]() { mapTraces = true; });
+    optnoval({"--huge-pages"},
+             "back the large arrays with huge pages, first touched by the "
+             "threads which will process them.",
+             [this]() { hugePages = true; });
+    optval({"-j", "--jobs"}, "N",
+           "use up to N threads for the computations (default: "
+           "$PAF_NUM_THREADS, or 1; 0 uses as many threads as the hardware "
+           "supports).",
+           [this](const string &s) { numJobs = stoul(s, nullptr, 0); });
     optval({"--decimate"}, "PERIOD%OFFSET",
            "decimate result (default: PERIOD=1, OFFSET=0)",
            [&](const string &s) {
@@ -92,6 +111,11 @@ SCAApp::SCAApp(const char *appname, int argc, char *argv[])
     optval({"-n", "--numsamples"}, "N",
            "restrict computation to N samples (default: all).",
            [this](const string &s) { nbSamples = stoull(s, nullptr, 0); });
+    optval({"--index-map"}, "FILE",
+           "report the samples at their original position, from the index map "
+           "FILE saved by paf-poi.",
+           [this](const string &s) { indexMapFile = s; });
+    Stats::addOptions(*this);
 }
 
 void SCAApp::setup() {
@@ -109,7 +133,91 @@ void SCAApp::setup() {
     }
     if (nbSamples == 0)
         nbSamples = std::numeric_limits<size_t>::max() - startSample;
+    NPArrayBase::setNumThreads(numJobs);
+    if (hugePages) {
+        static NPLargePageAllocator largePages;
+        NPArrayBase::setAllocator(&largePages);
+    }
     out.reset(OutputBase::create(outputType(), outputFilename(), append()));
+
+    if (!cacheDirectory.empty()) {
+        cache = std::make_unique<StatsCache>(cacheDirectory);
+        if (!cache->good())
+            reporter->errx(EXIT_FAILURE,
+                           "Error opening statistics cache '%s' (%s)",
+                           cacheDirectory.c_str(), cache->error());
+    }
+
+    if (!indexMapFile.empty()) {
+        NPArray<uint64_t> index_map(indexMapFile);
+        if (!index_map.good() || index_map.rows() != 1)
+            reporter->errx(EXIT_FAILURE, "Error reading index map from '%s'",
+                           indexMapFile.c_str());
+        // The results start at sample startSample of the traces.
+        vector<size_t> positions;
+        for (size_t c = startSample; c < index_map.cols() && c < sampleEnd();
+             c++)
+            positions.push_back(index_map(0, c));
+        out->setIndexMap(std::move(positions));
+    }
+}
+
+void SCAApp::addLiveOption() {
+    optval({"--live"}, "SOURCE",
+           "analyze the traces while they are being acquired, as they are "
+           "streamed from SOURCE with the live traces protocol. SOURCE is "
+           "'-' for the standard input, unix:PATH to accept a connection on "
+           "UNIX socket PATH, tcp:[HOST:]PORT to accept a TCP connection on "
+           "PORT, or the name of a file or named pipe",
+           [this](const string &s) { liveSpec = s; });
+}
+
+void SCAApp::addStatsCacheOption() {
+    optval({"--stats-cache"}, "DIR",
+           "save the per-sample statistics of the traces to directory DIR, "
+           "and reuse them when the same traces are analyzed again, e.g. "
+           "with another sample window or output format",
+           [this](const string &s) { cacheDirectory = s; });
+}
+
+std::unique_ptr<LiveTraceReader> SCAApp::openLiveTraces() const {
+    if (verbose())
+        cout << "Waiting for live traces from '" << liveSpec << "'\n";
+    auto live = std::make_unique<LiveTraceReader>(liveSpec);
+    if (!live->good())
+        reporter->errx(EXIT_FAILURE,
+                       "Error receiving live traces from '%s' (%s)",
+                       liveSpec.c_str(), live->error());
+    if (verbose())
+        cout << "Receiving traces of " << live->getNumSamples() << " "
+             << live->getEltTy() << " samples, with " << live->getNumData()
+             << " data words\n";
+    return live;
+}
+
+void getInformation(const string &filename, size_t &num_rows,
+                    size_t &num_cols, string &elt_ty, Reporter &reporter) {
+    std::ifstream ifs(filename, std::ifstream::binary);
+    if (!ifs)
+        reporter.errx(EXIT_FAILURE, "Error opening traces file '%s'",
+                      filename.c_str());
+
+    size_t elt_size;
+    const char *errstr = nullptr;
+    bool swap;
+    bool fortran;
+    if (!NPArrayBase::getInformation(ifs, num_rows, num_cols, elt_ty, elt_size,
+                                     &errstr, &swap, &fortran))
+        reporter.errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
+                      filename.c_str(), errstr);
+}
+
+string getEltTy(const string &filename, Reporter &reporter) {
+    size_t num_rows;
+    size_t num_cols;
+    string elt_ty;
+    getInformation(filename, num_rows, num_cols, elt_ty, reporter);
+    return elt_ty;
 }
 
 OutputBase::OutputBase(const std::string &filename, bool append, bool binary)
@@ -146,6 +254,16 @@ OutputBase::~OutputBase() {
     close();
 }
 
+size_t OutputBase::position(size_t col, size_t decimate) const {
+    if (indexMap.empty())
+        return col / decimate;
+    if (col >= indexMap.size())
+        reporter->errx(EXIT_FAILURE,
+                       "Sample %zu is out of the index map (%zu samples)", col,
+                       indexMap.size());
+    return indexMap[col];
+}
+
 void OutputBase::emitComment(const NPArray<double> &values, size_t decimate,
                              size_t offset) const {
     if (values.empty())
@@ -159,10 +277,84 @@ void OutputBase::emitComment(const NPArray<double> &values, size_t decimate,
         *out << "# max = " << max_v << " at index ";
         if (values.rows() > 1)
             *out << r << ',';
-        *out << (index / decimate) << '\n';
+        *out << position(index, decimate) << '\n';
     }
 }
 
+namespace {
+// TextBuffer formats values into a large reusable buffer, which is written to
+// the output stream one block at a time, rather than having each value go
+// through the (locale aware) stream formatting. Values are formatted the same
+// way as the default ostream formatting would.
+class TextBuffer {
+  public:
+    TextBuffer(std::ostream &os, vector<char> &buf) : os(os), buf(buf) {
+        buf.resize(BLOCK_SIZE);
+    }
+    TextBuffer(const TextBuffer &) = delete;
+    ~TextBuffer() { flush(); }
+
+    TextBuffer &operator<<(double v) {
+        char *p = room();
+#if defined(__cpp_lib_to_chars)
+        used = std::to_chars(p, p + MAX_ITEM_SIZE, v,
+                             std::chars_format::general, 6)
+                   .ptr -
+               buf.data();
+#else
+        used += std::snprintf(p, MAX_ITEM_SIZE, "%g", v);
+#endif
+        return *this;
+    }
+
+    TextBuffer &operator<<(size_t v) {
+        char *p = room();
+        used = std::to_chars(p, p + MAX_ITEM_SIZE, v).ptr - buf.data();
+        return *this;
+    }
+
+    TextBuffer &operator<<(char c) {
+        *room() = c;
+        used += 1;
+        return *this;
+    }
+
+    TextBuffer &operator<<(const char *str) {
+        const size_t len = std::strlen(str);
+        if (len > MAX_ITEM_SIZE) {
+            flush();
+            os.write(str, len);
+        } else {
+            std::memcpy(room(), str, len);
+            used += len;
+        }
+        return *this;
+    }
+
+    // Write the buffered text to the output stream.
+    void flush() {
+        if (used != 0)
+            os.write(buf.data(), used);
+        used = 0;
+    }
+
+  private:
+    static constexpr size_t BLOCK_SIZE = 1 << 20;
+    static constexpr size_t MAX_ITEM_SIZE = 64;
+    std::ostream &os;
+    vector<char> &buf;
+    size_t used = 0;
+
+    // Get a pointer to where the next item, of at most MAX_ITEM_SIZE
+    // characters, should be formatted.
+    char *room() {
+        if (used + MAX_ITEM_SIZE > BLOCK_SIZE)
+            flush();
+        return buf.data() + used;
+    }
+};
+} // namespace
+
 class TerseOutput : public OutputBase {
   public:
     TerseOutput(const std::string &filename, bool append = true)
@@ -186,15 +378,21 @@ class GnuplotOutput : public OutputBase {
 
         assert(decimate > 0 && "decimate can not be 0");
 
-        for (size_t col = offset; col < values.cols(); col += decimate) {
-            *out << (col / decimate);
-            for (size_t row = 0; row < values.rows(); row++)
-                *out << "  " << values(row, col);
-            *out << '\n';
+        {
+            TextBuffer tb(*out, buffer);
+            for (size_t col = offset; col < values.cols(); col += decimate) {
+                tb << position(col, decimate);
+                for (size_t row = 0; row < values.rows(); row++)
+                    tb << "  " << values(row, col);
+                tb << '\n';
+            }
         }
 
         emitComment(values, decimate, offset);
     }
+
+  private:
+    mutable vector<char> buffer;
 };
 
 class NumpyOutput : public OutputBase {
@@ -215,15 +413,35 @@ class NumpyOutput : public OutputBase {
         if (!ofs)
             reporter->errx(EXIT_FAILURE, "Numpy output must be a file");
         if (decimate == 1) {
+            // Write the values buffer as is.
             values.save(*ofs);
-        } else {
-            NPArray<double> NP(values.rows(), values.cols() / decimate);
-            for (size_t i = 0; i < NP.rows(); i++)
-                for (size_t j = 0; j < NP.cols(); j++)
-                    NP(i, j) = values(i, j * decimate + offset);
-            NP.save(*ofs);
+            return;
         }
+
+        // Decimate the values while copying them to a reusable block buffer,
+        // rather than building a decimated copy of the whole array.
+        const size_t num_cols = values.cols() / decimate;
+        if (!NPArray<double>::saveHeader(*ofs, values.rows(), num_cols))
+            return;
+        buffer.resize(std::min(values.rows() * num_cols, BLOCK_ELEMENTS));
+        size_t used = 0;
+        for (size_t i = 0; i < values.rows(); i++)
+            for (size_t j = 0; j < num_cols; j++) {
+                buffer[used++] = values(i, j * decimate + offset);
+                if (used == buffer.size()) {
+                    ofs->write(reinterpret_cast<const char *>(buffer.data()),
+                               used * sizeof(double));
+                    used = 0;
+                }
+            }
+        if (used != 0)
+            ofs->write(reinterpret_cast<const char *>(buffer.data()),
+                       used * sizeof(double));
     }
+
+  private:
+    static constexpr size_t BLOCK_ELEMENTS = 1 << 17;
+    mutable vector<double> buffer;
 };
 
 class PythonOutput : public OutputBase {
@@ -238,16 +456,20 @@ class PythonOutput : public OutputBase {
 
         assert(decimate > 0 && "decimate can not be 0");
 
+        TextBuffer tb(*out, buffer);
         for (size_t r = 0; r < values.rows(); r++) {
-            *out << "waves.append(Waveform([";
+            tb << "waves.append(Waveform([";
             const char *sep = "";
             for (size_t i = offset; i < values.cols(); i += decimate) {
-                *out << sep << values(r, i);
+                tb << sep << values(r, i);
                 sep = ", ";
             }
-            *out << "]))\n";
+            tb << "]))\n";
         }
     }
+
+  private:
+    mutable vector<char> buffer;
 };
 
 OutputBase *OutputBase::create(OutputType ty, const std::string &filename,
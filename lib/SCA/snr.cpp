@@ -0,0 +1,230 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/NPOperators.h"
+#include "PAF/SCA/SCA.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::vector;
+
+namespace PAF::SCA {
+
+namespace {
+/// The number of samples processed at a time by ClassAccumulator::add, small
+/// enough for the per-class partial sums to stay in the cache while the
+/// traces of a class are walked.
+constexpr size_t SAMPLES_PER_TILE = 1024;
+} // namespace
+
+template <typename Ty>
+ClassAccumulator<Ty>::ClassAccumulator(size_t num_classes, size_t num_samples)
+    : numClasses(num_classes), numSamples(num_samples),
+      stats(num_classes * num_samples) {}
+
+template <typename Ty>
+ClassAccumulator<Ty>::ClassAccumulator(const std::string &filename)
+    : numClasses(0), numSamples(0) {
+    // The state is saved with, for each class, a row of counts, a row of
+    // means and a row of sums of squared differences to the mean.
+    const NPArray<double> state(filename);
+    if (!state.good()) {
+        errstr = state.error();
+        return;
+    }
+    if (state.rows() % 3 != 0) {
+        errstr = "wrong number of rows in class accumulator state";
+        return;
+    }
+
+    numClasses = state.rows() / 3;
+    numSamples = state.cols();
+    stats.reserve(numClasses * numSamples);
+    for (size_t c = 0; c < numClasses; c++)
+        for (size_t s = 0; s < numSamples; s++)
+            stats.emplace_back(size_t(state(3 * c, s)), state(3 * c + 1, s),
+                               state(3 * c + 2, s));
+}
+
+template <typename Ty>
+size_t ClassAccumulator<Ty>::count(size_t cls) const noexcept {
+    return cls >= numClasses || numSamples == 0 ? 0 : at(cls, 0).count();
+}
+
+template <typename Ty>
+void ClassAccumulator<Ty>::add(const NPArrayView<Ty> &traces,
+                               const vector<uint32_t> &classes,
+                               size_t first_trace) {
+    assert(traces.cols() == samples() &&
+           "Number of samples does not match the accumulator's");
+    assert(classes.size() >= first_trace + traces.rows() &&
+           "Not enough classes for the traces");
+
+    // Bucket the traces by class: the traces of class c are
+    // order[start[c]] ... order[start[c + 1] - 1].
+    vector<size_t> start(numClasses + 1, 0);
+    for (size_t t = 0; t < traces.rows(); t++)
+        if (const uint32_t c = classes[first_trace + t]; c < numClasses)
+            start[c + 1] += 1;
+    for (size_t c = 0; c < numClasses; c++)
+        start[c + 1] += start[c];
+    vector<size_t> order(start.back());
+    vector<size_t> next(start.begin(), start.end() - 1);
+    for (size_t t = 0; t < traces.rows(); t++)
+        if (const uint32_t c = classes[first_trace + t]; c < numClasses)
+            order[next[c]++] = t;
+
+    // The samples are split between the worker threads. For each tile of
+    // samples, the mean and sum of squared differences of the batch traces
+    // of each class are computed (in 2 passes, for accuracy), and then merged
+    // in the class statistics.
+    NPArrayBase::parallelFor(
+        0, numSamples, order.size(), [&](size_t sb, size_t se) {
+            vector<double> mean(SAMPLES_PER_TILE);
+            vector<double> m2(SAMPLES_PER_TILE);
+            for (size_t tb = sb; tb < se; tb += SAMPLES_PER_TILE) {
+                const size_t te = std::min(tb + SAMPLES_PER_TILE, se);
+                const size_t n = te - tb;
+                for (size_t c = 0; c < numClasses; c++) {
+                    const size_t cnt = start[c + 1] - start[c];
+                    if (cnt == 0)
+                        continue;
+                    std::fill(mean.begin(), mean.begin() + n, 0.0);
+                    std::fill(m2.begin(), m2.begin() + n, 0.0);
+                    for (size_t i = start[c]; i < start[c + 1]; i++)
+                        for (size_t s = 0; s < n; s++)
+                            mean[s] += double(traces(order[i], tb + s));
+                    for (size_t s = 0; s < n; s++)
+                        mean[s] /= double(cnt);
+                    for (size_t i = start[c]; i < start[c + 1]; i++)
+                        for (size_t s = 0; s < n; s++) {
+                            const double d =
+                                double(traces(order[i], tb + s)) - mean[s];
+                            m2[s] += d * d;
+                        }
+                    MeanWithVar<Ty> *cstats = &stats[c * numSamples + tb];
+                    for (size_t s = 0; s < n; s++)
+                        cstats[s].merge(MeanWithVar<Ty>(cnt, mean[s], m2[s]));
+                }
+            }
+        });
+}
+
+template <typename Ty>
+bool ClassAccumulator<Ty>::merge(const ClassAccumulator &other) {
+    if (other.classes() != classes() || other.samples() != samples())
+        return false;
+    NPArrayBase::parallelFor(0, stats.size(), 1, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; i++)
+            stats[i].merge(other.stats[i]);
+    });
+    return true;
+}
+
+template <typename Ty> NPArray<double> ClassAccumulator<Ty>::means() const {
+    NPArray<double> m(numClasses, numSamples);
+    for (size_t c = 0; c < numClasses; c++)
+        for (size_t s = 0; s < numSamples; s++)
+            m(c, s) = at(c, s).value();
+    return m;
+}
+
+template <typename Ty> NPArray<double> ClassAccumulator<Ty>::snr() const {
+    if (numSamples == 0)
+        return {};
+
+    NPArray<double> result(1, numSamples);
+    NPArrayBase::parallelFor(
+        0, numSamples, numClasses, [&](size_t sb, size_t se) {
+            for (size_t s = sb; s < se; s++) {
+                // The signal is the variance of the class means, and the
+                // noise is the mean of the class variances.
+                MeanWithVar<double> signal;
+                Mean<double> noise;
+                for (size_t c = 0; c < numClasses; c++) {
+                    const MeanWithVar<Ty> &st = at(c, s);
+                    if (st.count() == 0)
+                        continue;
+                    signal(st.value());
+                    noise(st.var());
+                }
+                result(0, s) = signal.count() == 0
+                                   ? 0.0
+                                   : signal.var() / noise.value();
+            }
+        });
+    return result;
+}
+
+template <typename Ty> NPArray<double> ClassAccumulator<Ty>::sost() const {
+    if (numSamples == 0)
+        return {};
+
+    NPArray<double> result(1, numSamples);
+    NPArrayBase::parallelFor(
+        0, numSamples, numClasses * numClasses / 2, [&](size_t sb, size_t se) {
+            vector<double> mean(numClasses);
+            vector<double> var(numClasses); // The variance of the mean.
+            for (size_t s = sb; s < se; s++) {
+                size_t k = 0;
+                for (size_t c = 0; c < numClasses; c++) {
+                    const MeanWithVar<Ty> &st = at(c, s);
+                    if (st.count() < 2)
+                        continue;
+                    mean[k] = st.value();
+                    var[k] = st.var(/* ddof: */ 1) / double(st.count());
+                    k++;
+                }
+                double sum = 0.0;
+                for (size_t i = 0; i < k; i++)
+                    for (size_t j = i + 1; j < k; j++) {
+                        const double d = mean[i] - mean[j];
+                        sum += d * d / (var[i] + var[j]);
+                    }
+                result(0, s) = sum;
+            }
+        });
+    return result;
+}
+
+template <typename Ty>
+bool ClassAccumulator<Ty>::save(const std::string &filename) const {
+    NPArray<double> state(3 * numClasses, numSamples);
+    for (size_t c = 0; c < numClasses; c++)
+        for (size_t s = 0; s < numSamples; s++) {
+            const MeanWithVar<Ty> &st = at(c, s);
+            state(3 * c, s) = double(st.count());
+            state(3 * c + 1, s) = st.value();
+            state(3 * c + 2, s) = st.m2();
+        }
+    return state.save(filename);
+}
+
+// Instantiate the class accumulator for the supported trace storage types.
+template class ClassAccumulator<double>;
+template class ClassAccumulator<float>;
+template class ClassAccumulator<int16_t>;
+template class ClassAccumulator<uint16_t>;
+
+} // namespace PAF::SCA
@@ -21,10 +21,13 @@
 #include "PAF/SCA/NPOperators.h"
 #include "PAF/SCA/SCA.h"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <string>
 
 using std::array;
 using std::function;
@@ -34,19 +37,62 @@ using std::vector;
 
 namespace PAF::SCA {
 
-/// Welsh t-test with one group of traces and a classification array.
-NPArray<double> t_test(size_t b, size_t e, const NPArray<double> &traces,
-                       const vector<Classification> &classifier) {
-    assert(b <= e && "Wrong begin / end samples");
-    assert(b <= traces.cols() && "Not that many samples in the trace");
-    assert(e <= traces.cols() && "Not that many samples in the trace");
-
-    if (b == e)
-        return {};
+namespace {
+template <typename Ty> using MeanWithVarVector = vector<MeanWithVar<Ty>>;
+
+/// Get the classification group index (0 or 1) for \p c, or -1 if the trace
+/// has to be ignored.
+int groupIndex(Classification c) {
+    switch (c) {
+    case Classification::GROUP_0:
+        return 0;
+    case Classification::GROUP_1:
+        return 1;
+    case Classification::IGNORE:
+        break;
+    }
+    return -1;
+}
 
-    const size_t nbtraces = traces.rows();
-    const size_t nbsamples = e - b;
+/// The number of samples processed at a time by accumulate, small enough for
+/// their statistics to stay in the cache while all traces are walked.
+constexpr size_t SAMPLES_PER_TILE = 1024;
+
+/// Accumulate in \p avg the samples from \p b to \p e of all \p traces
+/// according to \p classifier, with \p first_trace being the index of the
+/// first trace in \p classifier. The samples are split between the worker
+/// threads, each of them walking all traces row by row over its own slice of
+/// samples, one tile of SAMPLES_PER_TILE samples at a time. Each statistic is
+/// thus updated in trace order, whatever the number of threads.
+template <typename Ty>
+void accumulate(MeanWithVarVector<Ty> avg[2], size_t b, size_t e,
+                const NPArrayView<Ty> &traces,
+                const vector<Classification> &classifier,
+                size_t first_trace = 0) {
+    vector<int> groups(traces.rows());
+    for (size_t tnum = 0; tnum < traces.rows(); tnum++)
+        groups[tnum] = groupIndex(classifier[first_trace + tnum]);
+
+    NPArrayBase::parallelFor(
+        0, e - b, traces.rows(), [&](size_t sb, size_t se) {
+            for (size_t tb = sb; tb < se; tb += SAMPLES_PER_TILE) {
+                const size_t te = std::min(tb + SAMPLES_PER_TILE, se);
+                for (size_t tnum = 0; tnum < traces.rows(); tnum++) {
+                    if (groups[tnum] < 0)
+                        continue;
+                    MeanWithVar<Ty> *stats = avg[groups[tnum]].data();
+                    for (size_t sample = tb; sample < te; sample++)
+                        stats[sample](traces(tnum, b + sample));
+                }
+            }
+        });
+}
 
+/// Compute Welsh's t-test from the per-sample statistics \p avg of the 2
+/// groups.
+template <typename Ty>
+NPArray<double> welsh(const MeanWithVarVector<Ty> avg[2]) {
+    const size_t nbsamples = avg[0].size();
     NPArray<double> mean0(1, nbsamples);
     NPArray<double> var0(1, nbsamples);
     NPArray<double> cnt0(1, nbsamples);
@@ -55,43 +101,265 @@ NPArray<double> t_test(size_t b, size_t e, const NPArray<double> &traces,
     NPArray<double> cnt1(1, nbsamples);
 
     for (size_t sample = 0; sample < nbsamples; sample++) {
-        MeanWithVar<NPArray<double>::DataTy> avg[2];
-        for (size_t tnum = 0; tnum < nbtraces; tnum++)
-            switch (classifier[tnum]) {
-            case Classification::GROUP_0:
-                avg[0](traces(tnum, b + sample), tnum, sample);
-                break;
-            case Classification::GROUP_1:
-                avg[1](traces(tnum, b + sample), tnum, sample);
-                break;
-            case Classification::IGNORE:
-                break;
-            }
+        assert(avg[0][sample].count() > 1 &&
+               "group0 must have more than one trace");
+        mean0(0, sample) = avg[0][sample].value();
+        var0(0, sample) = avg[0][sample].var(/* ddof: */ 1);
+        cnt0(0, sample) = double(avg[0][sample].count());
+
+        assert(avg[1][sample].count() > 1 &&
+               "group1 must have more than one trace");
+        mean1(0, sample) = avg[1][sample].value();
+        var1(0, sample) = avg[1][sample].var(/* ddof: */ 1);
+        cnt1(0, sample) = double(avg[1][sample].count());
+    }
 
-        assert(avg[0].count() > 1 && "group0 must have more than one trace");
-        mean0(0, sample) = avg[0].value();
-        var0(0, sample) = avg[0].var(/* ddof: */ 1);
-        cnt0(0, sample) = double(avg[0].count());
+    return (expr(mean0) - mean1) / sqrt(expr(var0) / cnt0 + expr(var1) / cnt1);
+}
+} // namespace
 
-        assert(avg[1].count() > 1 && "group1 must have more than one trace");
-        mean1(0, sample) = avg[1].value();
-        var1(0, sample) = avg[1].var(/* ddof: */ 1);
-        cnt1(0, sample) = double(avg[1].count());
-    }
+/// Welsh t-test with one group of traces and a classification array.
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, const NPArrayView<Ty> &traces,
+                       const vector<Classification> &classifier) {
+    assert(b <= e && "Wrong begin / end samples");
+    assert(b <= traces.cols() && "Not that many samples in the trace");
+    assert(e <= traces.cols() && "Not that many samples in the trace");
+
+    if (b == e)
+        return {};
 
-    return (mean0 - mean1) / sqrt(var0 / cnt0 + var1 / cnt1);
+    MeanWithVarVector<Ty> avg[2] = {MeanWithVarVector<Ty>(e - b),
+                                    MeanWithVarVector<Ty>(e - b)};
+    accumulate(avg, b, e, traces, classifier);
+    return welsh(avg);
 }
 
 /// Welsh t-test with one group of traces and a classification array.
-double t_test(size_t s, const NPArray<double> &traces,
+template <typename Ty>
+double t_test(size_t s, const NPArrayView<Ty> &traces,
               const vector<Classification> &classifier) {
     const NPArray<double> tvalues = t_test(s, s + 1, traces, classifier);
     return tvalues(0, 0);
 }
 
+namespace {
+/// Welsh t-test with one group of traces read by chunks and a classification
+/// array.
+template <typename Ty, class ChunkedTraces>
+NPArray<double> chunked_t_test(size_t b, size_t e, ChunkedTraces &traces,
+                               const vector<Classification> &classifier) {
+    assert(b <= e && "Wrong begin / end samples");
+    assert(b <= traces.cols() && "Not that many samples in the trace");
+    assert(e <= traces.cols() && "Not that many samples in the trace");
+    assert(classifier.size() >= traces.rows() &&
+           "Not enough classification data for the traces");
+
+    if (b == e)
+        return {};
+
+    // Accumulate the statistics, one chunk of traces at a time.
+    MeanWithVarVector<Ty> avg[2] = {MeanWithVarVector<Ty>(e - b),
+                                    MeanWithVarVector<Ty>(e - b)};
+    traces.rewind();
+    while (traces.next())
+        accumulate<Ty>(avg, b, e, traces.chunk(), classifier,
+                       traces.chunkBegin());
+    assert(traces.good() && "Error reading traces by chunks");
+
+    return welsh(avg);
+}
+} // namespace
+
+/// Welsh t-test with one group of traces read by chunks and a classification
+/// array.
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, NPYChunkReader<Ty> &traces,
+                       const vector<Classification> &classifier) {
+    return chunked_t_test<Ty>(b, e, traces, classifier);
+}
+
+/// Welsh t-test with one group of sharded traces and a classification array.
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, ShardedNPArray<Ty> &traces,
+                       const vector<Classification> &classifier) {
+    return chunked_t_test<Ty>(b, e, traces, classifier);
+}
+
+namespace {
+/// The number of samples processed at a time by accumulateClassifiers, small
+/// enough for the sums of all classifiers over those samples to stay in the
+/// cache.
+constexpr size_t SAMPLES_PER_CLASSIFIERS_TILE = 64;
+
+/// The sums of the samples and of their squares needed by the t-tests of
+/// several classifiers. The samples are taken relative to a reference trace
+/// (the first one) for accuracy. Only the sums of the group 1 and of the
+/// ignored traces of each classifier are accumulated, those of its group 0
+/// being the sums over all traces minus them.
+struct ClassifiersSums {
+    ClassifiersSums(size_t num_classifiers, size_t nbsamples)
+        : nbsamples(nbsamples), sum(nbsamples, 0.0), sum2(nbsamples, 0.0),
+          sum1(num_classifiers * nbsamples, 0.0),
+          sum1Sq(num_classifiers * nbsamples, 0.0),
+          sumI(num_classifiers * nbsamples, 0.0),
+          sumISq(num_classifiers * nbsamples, 0.0),
+          count1(num_classifiers, 0), countI(num_classifiers, 0) {}
+
+    const size_t nbsamples;
+    vector<double> reference;
+    size_t count = 0;
+    vector<double> sum;
+    vector<double> sum2;
+    vector<double> sum1;
+    vector<double> sum1Sq;
+    vector<double> sumI;
+    vector<double> sumISq;
+    vector<size_t> count1;
+    vector<size_t> countI;
+};
+
+/// Call \p f(c) for each classifier c whose bit is set in the \p num_words
+/// words at \p bits.
+template <class Fn>
+void forEachBit(const uint64_t *bits, size_t num_words, Fn f) {
+    for (size_t w = 0; w < num_words; w++)
+        for (uint64_t word = bits[w]; word != 0; word &= word - 1)
+            f(w * Classifiers::WORD_BITS + __builtin_ctzll(word));
+}
+
+/// Accumulate in \p sums the samples from \p b of all \p traces for all
+/// \p classifiers, with \p first_trace being the index of the first trace in
+/// \p classifiers. As in accumulate, the samples are split between the worker
+/// threads, each of them walking all traces over tiles of its own slice of
+/// samples: a trace sample is read once, and added to the sums of the
+/// classifiers which have the trace in group 1 or ignore it.
+template <typename Ty>
+void accumulateClassifiers(ClassifiersSums &sums, size_t b,
+                           const NPArrayView<Ty> &traces,
+                           const Classifiers &classifiers,
+                           size_t first_trace = 0) {
+    const size_t n = sums.nbsamples;
+    if (traces.rows() == 0)
+        return;
+    if (sums.reference.empty()) {
+        sums.reference.resize(n);
+        for (size_t s = 0; s < n; s++)
+            sums.reference[s] = double(traces(0, b + s));
+    }
+
+    const size_t numWords = classifiers.words();
+    sums.count += traces.rows();
+    for (size_t t = 0; t < traces.rows(); t++) {
+        forEachBit(classifiers.group1(first_trace + t), numWords,
+                   [&](size_t c) { sums.count1[c] += 1; });
+        forEachBit(classifiers.ignored(first_trace + t), numWords,
+                   [&](size_t c) { sums.countI[c] += 1; });
+    }
+
+    NPArrayBase::parallelFor(
+        0, n, traces.rows() * classifiers.size(), [&](size_t sb, size_t se) {
+            double y[SAMPLES_PER_CLASSIFIERS_TILE];
+            double y2[SAMPLES_PER_CLASSIFIERS_TILE];
+            for (size_t tb = sb; tb < se; tb += SAMPLES_PER_CLASSIFIERS_TILE) {
+                const size_t te =
+                    std::min(tb + SAMPLES_PER_CLASSIFIERS_TILE, se);
+                const size_t ts = te - tb;
+                for (size_t t = 0; t < traces.rows(); t++) {
+                    for (size_t s = 0; s < ts; s++) {
+                        y[s] = double(traces(t, b + tb + s)) -
+                               sums.reference[tb + s];
+                        y2[s] = y[s] * y[s];
+                        sums.sum[tb + s] += y[s];
+                        sums.sum2[tb + s] += y2[s];
+                    }
+                    auto add = [&](vector<double> &s1, vector<double> &s2) {
+                        return [&, ts](size_t c) {
+                            double *p1 = &s1[c * n + tb];
+                            double *p2 = &s2[c * n + tb];
+                            for (size_t s = 0; s < ts; s++) {
+                                p1[s] += y[s];
+                                p2[s] += y2[s];
+                            }
+                        };
+                    };
+                    forEachBit(classifiers.group1(first_trace + t), numWords,
+                               add(sums.sum1, sums.sum1Sq));
+                    forEachBit(classifiers.ignored(first_trace + t), numWords,
+                               add(sums.sumI, sums.sumISq));
+                }
+            }
+        });
+}
+
+/// Compute Welsh's t-test of each classifier from \p sums.
+NPArray<double> welsh(const ClassifiersSums &sums) {
+    const size_t numClassifiers = sums.count1.size();
+    const size_t n = sums.nbsamples;
+    NPArray<double> result(numClassifiers, n);
+    for (size_t c = 0; c < numClassifiers; c++) {
+        const double n1 = double(sums.count1[c]);
+        const double n0 = double(sums.count - sums.count1[c] - sums.countI[c]);
+        assert(n0 > 1 && "group0 must have more than one trace");
+        assert(n1 > 1 && "group1 must have more than one trace");
+        for (size_t s = 0; s < n; s++) {
+            const size_t i = c * n + s;
+            const double s1 = sums.sum1[i];
+            const double s0 = sums.sum[s] - s1 - sums.sumI[i];
+            const double q0 = sums.sum2[s] - sums.sum1Sq[i] - sums.sumISq[i];
+            const double m0 = s0 / n0;
+            const double m1 = s1 / n1;
+            const double v0 = (q0 - s0 * m0) / (n0 - 1.0);
+            const double v1 = (sums.sum1Sq[i] - s1 * m1) / (n1 - 1.0);
+            result(c, s) = (m0 - m1) / std::sqrt(v0 / n0 + v1 / n1);
+        }
+    }
+    return result;
+}
+} // namespace
+
+/// Welsh t-tests with one group of traces and multiple classifiers.
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, const NPArrayView<Ty> &traces,
+                       const Classifiers &classifiers) {
+    assert(b <= e && "Wrong begin / end samples");
+    assert(e <= traces.cols() && "Not that many samples in the trace");
+    assert(classifiers.traces() >= traces.rows() &&
+           "Not enough classification data for the traces");
+
+    if (b == e || classifiers.size() == 0)
+        return {};
+
+    ClassifiersSums sums(classifiers.size(), e - b);
+    accumulateClassifiers(sums, b, traces, classifiers);
+    return welsh(sums);
+}
+
+/// Welsh t-tests with one group of sharded traces and multiple classifiers.
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, ShardedNPArray<Ty> &traces,
+                       const Classifiers &classifiers) {
+    assert(b <= e && "Wrong begin / end samples");
+    assert(e <= traces.cols() && "Not that many samples in the trace");
+    assert(classifiers.traces() >= traces.rows() &&
+           "Not enough classification data for the traces");
+
+    if (b == e || classifiers.size() == 0)
+        return {};
+
+    ClassifiersSums sums(classifiers.size(), e - b);
+    traces.rewind();
+    while (traces.next())
+        accumulateClassifiers<Ty>(sums, b, traces.chunk(), classifiers,
+                                  traces.chunkBegin());
+    assert(traces.good() && "Error reading traces by chunks");
+    return welsh(sums);
+}
+
 /// Welsh t-test with 2 groups of traces.
-NPArray<double> t_test(size_t b, size_t e, const NPArray<double> &group0,
-                       const NPArray<double> &group1) {
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, const NPArrayView<Ty> &group0,
+                       const NPArrayView<Ty> &group1) {
     assert(b <= e && "Wrong begin / end samples");
     assert(b <= group0.cols() && "Not that many samples in group0 traces");
     assert(e <= group0.cols() && "Not that many samples in group0 traces");
@@ -105,39 +373,43 @@ NPArray<double> t_test(size_t b, size_t e, const NPArray<double> &group0,
 
     NPArray<double> variance0;
     NPArray<double> mean0 = group0.meanWithVar(
-        NPArray<double>::COLUMN, b, e, &variance0, nullptr, /* ddof: */ 1);
+        NPArrayBase::COLUMN, b, e, &variance0, nullptr, /* ddof: */ 1);
 
     NPArray<double> variance1;
     NPArray<double> mean1 = group1.meanWithVar(
-        NPArray<double>::COLUMN, b, e, &variance1, nullptr, /* ddof: */ 1);
+        NPArrayBase::COLUMN, b, e, &variance1, nullptr, /* ddof: */ 1);
 
-    return (mean0 - mean1) / sqrt(variance0 / double(group0.rows()) +
-                                  variance1 / double(group1.rows()));
+    return (expr(mean0) - mean1) /
+           sqrt(expr(variance0) / double(group0.rows()) +
+                expr(variance1) / double(group1.rows()));
 }
 
 /// Compute Welsh's t-test for sample s.
-double t_test(size_t s, const NPArray<double> &group0,
-              const NPArray<double> &group1) {
+template <typename Ty>
+double t_test(size_t s, const NPArrayView<Ty> &group0,
+              const NPArrayView<Ty> &group1) {
     const NPArray<double> tvalues = t_test(s, s + 1, group0, group1);
     return tvalues(0, 0);
 }
 
 /// Compute Student's t-test for sample s.
-double t_test(size_t s, double m0, const NPArray<double> &traces) {
+template <typename Ty>
+double t_test(size_t s, double m0, const NPArrayView<Ty> &traces) {
     assert(s <= traces.cols() && "Out of bound sample access in traces");
 
     double var;
-    double m = traces.meanWithVar(NPArray<double>::COLUMN, s, &var, nullptr, 1);
+    double m = traces.meanWithVar(NPArrayBase::COLUMN, s, &var, nullptr, 1);
     return std::sqrt(traces.rows()) * (m - m0) / std::sqrt(var);
 }
 
 /// Compute Student's t-test for sample s for the traces where select returns
 /// true.
-double t_test(size_t s, double m0, const NPArray<double> &traces,
+template <typename Ty>
+double t_test(size_t s, double m0, const NPArrayView<Ty> &traces,
               const function<bool(size_t)> &select) {
     assert(s <= traces.cols() && "Not that many samples in the trace");
 
-    MeanWithVar<NPArray<double>::DataTy> avg;
+    MeanWithVar<Ty> avg;
     for (size_t tnum = 0; tnum < traces.rows(); tnum++)
         if (select(tnum))
             avg(traces(tnum, s), tnum, s);
@@ -150,8 +422,9 @@ double t_test(size_t s, double m0, const NPArray<double> &traces,
 }
 
 /// Compute Student's t-test from samples b to e.
+template <typename Ty>
 NPArray<double> t_test(size_t b, size_t e, const vector<double> &m0,
-                       const NPArray<double> &traces) {
+                       const NPArrayView<Ty> &traces) {
     assert(b <= e && "Wrong begin / end samples");
     assert(b < traces.cols() && "Not that many samples in traces");
     assert(e <= traces.cols() && "Not that many samples in traces");
@@ -169,8 +442,9 @@ NPArray<double> t_test(size_t b, size_t e, const vector<double> &m0,
 
 /// Compute Student's t-test from sample b to e for the traces where select
 /// returns true.
+template <typename Ty>
 NPArray<double> t_test(size_t b, size_t e, const vector<double> &m0,
-                       const NPArray<double> &traces,
+                       const NPArrayView<Ty> &traces,
                        const function<bool(size_t)> &select) {
     assert(b <= e && "Wrong begin / end samples");
     assert(b < traces.cols() && "Not that many samples in traces");
@@ -228,145 +502,515 @@ class PerfectStats {
         os << "%)\n";
     }
 };
-} // namespace
 
-NPArray<double> perfect_t_test(size_t b, size_t e,
-                               const NPArray<double> &group0,
-                               const NPArray<double> &group1, ostream *os) {
-    assert(b <= e && "Wrong begin / end samples");
-    assert(b < group0.cols() && "Not that many samples in traces");
-    assert(e <= group0.cols() && "Not that many samples in traces");
-    assert(group0.cols() == group1.cols() && "Mismatch in number of columns");
+/// The statistics of one sample of a group of traces needed by the perfect
+/// t-test: its mean and variance, and whether it is constant, i.e. whether
+/// all its values are equal to the first one.
+template <typename Ty> struct PerfectSample {
+    MeanWithVar<Ty> avg;
+    Ty first = Ty();
+    bool constant = true;
+
+    void operator()(const Ty &v) {
+        if (avg.count() == 0)
+            first = v;
+        else if (constant && v != first)
+            constant = false;
+        avg(v);
+    }
+};
 
-    PerfectStats PS;
-    NPArray<double> tt(1, e - b);
-
-    for (size_t s = b; s < e; s++) {
-        const double group0Value = group0(0, s);
-        const bool isGroup0Constant =
-            group0.all(Equal<double>(group0Value), NPArray<double>::COLUMN, s);
-        const double group1Value = group1(0, s);
-        const bool isGroup1Constant =
-            group1.all(Equal<double>(group1Value), NPArray<double>::COLUMN, s);
-
-        if (isGroup0Constant && isGroup1Constant) {
-            if (group0Value == group1Value) {
+template <typename Ty> using PerfectSampleVector = vector<PerfectSample<Ty>>;
+
+/// Accumulate in \p stats the samples from \p b to \p e of all \p traces,
+/// with \p groups holding the group index of each trace, or -1 if it has to
+/// be ignored. This is a single trace-major pass, split between the worker
+/// threads and tiled the same way as accumulate, so that constant detection
+/// and moments are computed together and in trace order.
+template <typename Ty>
+void accumulatePerfect(PerfectSampleVector<Ty> stats[2], size_t b, size_t e,
+                       const NPArrayView<Ty> &traces,
+                       const vector<int> &groups) {
+    NPArrayBase::parallelFor(
+        0, e - b, traces.rows(), [&](size_t sb, size_t se) {
+            for (size_t tb = sb; tb < se; tb += SAMPLES_PER_TILE) {
+                const size_t te = std::min(tb + SAMPLES_PER_TILE, se);
+                for (size_t tnum = 0; tnum < traces.rows(); tnum++) {
+                    if (groups[tnum] < 0)
+                        continue;
+                    PerfectSample<Ty> *ps = stats[groups[tnum]].data();
+                    for (size_t sample = tb; sample < te; sample++)
+                        ps[sample](traces(tnum, b + sample));
+                }
+            }
+        });
+}
+
+/// Compute Student's t-test of the sample with statistics \p avg against
+/// the constant \p m0.
+template <typename Ty>
+double student(double m0, const MeanWithVar<Ty> &avg) {
+    if (avg.count() <= 1)
+        return std::nan("");
+
+    return std::sqrt(double(avg.count())) * (avg.value() - m0) /
+           std::sqrt(avg.var(/* ddof: */ 1));
+}
+
+/// Compute the perfect t-test from the per-sample statistics \p stats of the
+/// 2 groups, recording in \p PS which kind of test was used for each sample.
+template <typename Ty>
+NPArray<double> perfect(const PerfectSampleVector<Ty> stats[2],
+                        PerfectStats &PS) {
+    const size_t nbsamples = stats[0].size();
+    NPArray<double> tt(1, nbsamples);
+
+    for (size_t s = 0; s < nbsamples; s++) {
+        const PerfectSample<Ty> &g0 = stats[0][s];
+        const PerfectSample<Ty> &g1 = stats[1][s];
+        if (g0.constant && g1.constant) {
+            if (g0.first == g1.first) {
                 PS.incr(PerfectStats::SAME_CONSTANT_VALUE);
-                tt(0, s - b) = 0.0;
+                tt(0, s) = 0.0;
             } else {
                 PS.incr(PerfectStats::DIFFERENT_CONSTANT_VALUES);
                 // TODO: report ?
-                tt(0, s - b) = 0.0;
+                tt(0, s) = 0.0;
             }
-        } else if (isGroup0Constant || isGroup1Constant) {
+        } else if (g0.constant || g1.constant) {
             PS.incr(PerfectStats::STUDENT_T_TEST);
-            if (isGroup0Constant)
-                tt(0, s - b) = t_test(s, group0Value, group1);
+            if (g0.constant)
+                tt(0, s) = student(g0.first, g1.avg);
             else
-                tt(0, s - b) = t_test(s, group1Value, group0);
+                tt(0, s) = student(g1.first, g0.avg);
         } else {
             PS.incr(PerfectStats::WELSH_T_TEST);
-            tt(0, s - b) = t_test(s, s + 1, group0, group1)(0, 0);
+            tt(0, s) = (g0.avg.value() - g1.avg.value()) /
+                       std::sqrt(g0.avg.var(/* ddof: */ 1) /
+                                     double(g0.avg.count()) +
+                                 g1.avg.var(/* ddof: */ 1) /
+                                     double(g1.avg.count()));
         }
     }
 
+    return tt;
+}
+} // namespace
+
+template <typename Ty>
+NPArray<double> perfect_t_test(size_t b, size_t e,
+                               const NPArrayView<Ty> &group0,
+                               const NPArrayView<Ty> &group1, ostream *os) {
+    assert(b <= e && "Wrong begin / end samples");
+    assert(b < group0.cols() && "Not that many samples in traces");
+    assert(e <= group0.cols() && "Not that many samples in traces");
+    assert(group0.cols() == group1.cols() && "Mismatch in number of columns");
+
+    PerfectSampleVector<Ty> stats[2] = {PerfectSampleVector<Ty>(e - b),
+                                        PerfectSampleVector<Ty>(e - b)};
+    accumulatePerfect(stats, b, e, group0, vector<int>(group0.rows(), 0));
+    accumulatePerfect(stats, b, e, group1, vector<int>(group1.rows(), 1));
+
+    PerfectStats PS;
+    NPArray<double> tt = perfect(stats, PS);
+
     if (os)
         PS.dump(*os, group0.rows(), group1.rows());
 
     return tt;
 }
 
+template <typename Ty>
 NPArray<double> perfect_t_test(size_t b, size_t e,
-                               const NPArray<double> &traces,
+                               const NPArrayView<Ty> &traces,
                                const vector<Classification> &classifier,
                                ostream *os) {
     assert(b <= e && "Wrong begin / end samples");
     assert(b < traces.cols() && "Not that many samples in traces");
     assert(e <= traces.cols() && "Not that many samples in traces");
 
-    size_t group0Cnt = 0;
-    size_t group1Cnt = 0;
-    for (size_t t = 0; t < traces.rows(); t++)
-        switch (classifier[t]) {
-        case Classification::GROUP_0:
-            group0Cnt += 1;
-            break;
-        case Classification::GROUP_1:
-            group1Cnt += 1;
-            break;
-        case Classification::IGNORE:
-            break;
-        }
+    vector<int> groups(traces.rows());
+    size_t groupCnt[2] = {0, 0};
+    for (size_t t = 0; t < traces.rows(); t++) {
+        groups[t] = groupIndex(classifier[t]);
+        if (groups[t] >= 0)
+            groupCnt[groups[t]] += 1;
+    }
 
-    assert(group0Cnt > 1 && "Not enough samples in group0");
-    assert(group1Cnt > 1 && "Not enough samples in group1");
+    assert(groupCnt[0] > 1 && "Not enough samples in group0");
+    assert(groupCnt[1] > 1 && "Not enough samples in group1");
 
     // Return a somehow sensible result if we reach this case.
-    if (group0Cnt <= 1 || group1Cnt <= 1)
+    if (groupCnt[0] <= 1 || groupCnt[1] <= 1)
         return {};
 
-    function<bool(size_t)> selectGroup0 = [&classifier](size_t s) {
-        return classifier[s] == Classification::GROUP_0;
-    };
-    function<bool(size_t)> selectGroup1 = [&classifier](size_t s) {
-        return classifier[s] == Classification::GROUP_1;
-    };
+    PerfectSampleVector<Ty> stats[2] = {PerfectSampleVector<Ty>(e - b),
+                                        PerfectSampleVector<Ty>(e - b)};
+    accumulatePerfect(stats, b, e, traces, groups);
 
     PerfectStats PS;
-    NPArray<double> tt(1, e - b);
-
-    for (size_t s = b; s < e; s++) {
-        double group0Value, group1Value;
-        bool isGroup0Constant = true;
-        bool isGroup1Constant = true;
-        bool group0Init = false;
-        bool group1Init = false;
-
-        for (size_t t = 0; t < traces.rows(); t++)
-            switch (classifier[t]) {
-            case Classification::GROUP_0:
-                if (!group0Init) {
-                    group0Init = true;
-                    group0Value = traces(t, s);
-                } else if (isGroup0Constant && group0Value != traces(t, s))
-                    isGroup0Constant = false;
-                break;
-            case Classification::GROUP_1:
-                if (!group1Init) {
-                    group1Init = true;
-                    group1Value = traces(t, s);
-                } else if (isGroup1Constant && group1Value != traces(t, s))
-                    isGroup1Constant = false;
-                break;
-            case Classification::IGNORE:
-                break;
+    NPArray<double> tt = perfect(stats, PS);
+
+    if (os)
+        PS.dump(*os, groupCnt[0], groupCnt[1]);
+
+    return tt;
+}
+
+namespace {
+/// The central moment sums of the samples of a group of traces, i.e. for
+/// each sample its mean and the sums of the powers 2 to maxOrder of its
+/// differences to the mean.
+struct CentralMoments {
+    CentralMoments(size_t nbsamples, unsigned max_order)
+        : maxOrder(max_order), sums(nbsamples * (max_order + 1), 0.0) {}
+
+    /// Get the sums for sample \p s: the mean is at index 0, and the sum of
+    /// the p-th powers of the differences to the mean at index p.
+    [[nodiscard]] double *sample(size_t s) { return &sums[s * (maxOrder + 1)]; }
+    [[nodiscard]] const double *sample(size_t s) const {
+        return &sums[s * (maxOrder + 1)];
+    }
+
+    /// Get the central moment of order \p p of sample \p s.
+    [[nodiscard]] double moment(size_t s, unsigned p) const {
+        return sample(s)[p] / double(count);
+    }
+
+    const unsigned maxOrder;
+    size_t count = 0;
+    vector<double> sums;
+};
+
+/// Accumulate in \p cm the central moments of the samples from \p b to \p e
+/// of all \p traces according to \p classifier, with \p first_trace being
+/// the index of the first trace in \p classifier. This is a single pass over
+/// the traces, using the numerically stable update from P. Pébay, "Formulas
+/// for Robust, One-Pass Parallel Computation of Covariances and
+/// Arbitrary-Order Statistical Moments" (2008). As in accumulate, the samples
+/// are split between the worker threads and processed by tiles.
+template <typename Ty>
+void accumulateMoments(CentralMoments *cm[2], size_t b, size_t e,
+                       const NPArrayView<Ty> &traces,
+                       const vector<Classification> &classifier,
+                       size_t first_trace = 0) {
+    const unsigned max_order = cm[0]->maxOrder;
+
+    // The group of each trace, and the number of traces in its group once
+    // it has been added.
+    vector<int> groups(traces.rows());
+    vector<size_t> counts(traces.rows());
+    for (size_t tnum = 0; tnum < traces.rows(); tnum++) {
+        groups[tnum] = groupIndex(classifier[first_trace + tnum]);
+        if (groups[tnum] >= 0)
+            counts[tnum] = ++cm[groups[tnum]]->count;
+    }
+
+    // The binomial coefficients.
+    vector<vector<double>> binomial(max_order + 1);
+    for (unsigned p = 0; p <= max_order; p++) {
+        binomial[p].resize(p + 1, 1.0);
+        for (unsigned k = 1; k < p; k++)
+            binomial[p][k] = binomial[p - 1][k - 1] + binomial[p - 1][k];
+    }
+
+    NPArrayBase::parallelFor(
+        0, e - b, traces.rows() * max_order, [&](size_t sb, size_t se) {
+            for (size_t tb = sb; tb < se; tb += SAMPLES_PER_TILE) {
+                const size_t te = std::min(tb + SAMPLES_PER_TILE, se);
+                for (size_t tnum = 0; tnum < traces.rows(); tnum++) {
+                    if (groups[tnum] < 0)
+                        continue;
+                    CentralMoments &m = *cm[groups[tnum]];
+                    const double n = double(counts[tnum]);
+                    for (size_t sample = tb; sample < te; sample++) {
+                        double *sums = m.sample(sample);
+                        const double delta =
+                            double(traces(tnum, b + sample)) - sums[0];
+                        const double delta_n = delta / n;
+                        sums[0] += delta_n;
+                        if (counts[tnum] == 1)
+                            continue;
+                        // Update the highest orders first, as they depend on
+                        // the lower order sums before the update.
+                        for (unsigned p = max_order; p >= 2; p--) {
+                            double sum = sums[p];
+                            double f = 1.0;
+                            for (unsigned k = 1; k + 2 <= p; k++) {
+                                f *= -delta_n;
+                                sum += binomial[p][k] * sums[p - k] * f;
+                            }
+                            sum += std::pow((n - 1.0) * delta_n, p) *
+                                   (1.0 - std::pow(-1.0 / (n - 1.0), p - 1));
+                            sums[p] = sum;
+                        }
+                    }
+                }
             }
+        });
+}
 
-        if (isGroup0Constant && isGroup1Constant) {
-            if (group0Value == group1Value) {
-                PS.incr(PerfectStats::SAME_CONSTANT_VALUE);
-                tt(0, s - b) = 0.0;
+/// Compute the univariate t-test of order \p order from the central moments
+/// \p cm of the 2 groups, with the preprocessing from T. Schneider and A.
+/// Moradi, "Leakage Assessment Methodology" (CHES 2015): the samples are
+/// centered at order 2, and standardized above.
+NPArray<double> higherOrderWelsh(const CentralMoments *cm[2],
+                                 unsigned order) {
+    const size_t nbsamples = cm[0]->sums.size() / (cm[0]->maxOrder + 1);
+    NPArray<double> mean[2] = {NPArray<double>(1, nbsamples),
+                               NPArray<double>(1, nbsamples)};
+    NPArray<double> var[2] = {NPArray<double>(1, nbsamples),
+                              NPArray<double>(1, nbsamples)};
+    for (size_t g = 0; g < 2; g++) {
+        assert(cm[g]->count > 1 && "groups must have more than one trace");
+        for (size_t s = 0; s < nbsamples; s++) {
+            const double cm2 = cm[g]->moment(s, 2);
+            const double cmd = cm[g]->moment(s, order);
+            const double cm2d = cm[g]->moment(s, 2 * order);
+            if (order == 2) {
+                mean[g](0, s) = cm2;
+                var[g](0, s) = cm2d - cm2 * cm2;
             } else {
-                PS.incr(PerfectStats::DIFFERENT_CONSTANT_VALUES);
-                // TODO: report ?
-                tt(0, s - b) = 0.0;
+                mean[g](0, s) = cmd / std::pow(cm2, order / 2.0);
+                var[g](0, s) = (cm2d - cmd * cmd) / std::pow(cm2, order);
             }
-        } else if (isGroup0Constant || isGroup1Constant) {
-            PS.incr(PerfectStats::STUDENT_T_TEST);
-            if (isGroup0Constant)
-                tt(0, s - b) = t_test(s, group0Value, traces, selectGroup1);
-            else
-                tt(0, s - b) = t_test(s, group1Value, traces, selectGroup0);
-        } else {
-            PS.incr(PerfectStats::WELSH_T_TEST);
-            tt(0, s - b) = t_test(s, s + 1, traces, classifier)(0, 0);
         }
     }
 
-    if (os)
-        PS.dump(*os, group0Cnt, group1Cnt);
+    return (expr(mean[0]) - mean[1]) /
+           sqrt(expr(var[0]) / double(cm[0]->count) +
+                expr(var[1]) / double(cm[1]->count));
+}
 
-    return tt;
+/// Univariate t-test of order \p order, on the traces \p feed passes, with
+/// their classification, to the function it is called with.
+template <typename Ty, class FeedFn>
+NPArray<double> higher_order_t_test(size_t b, size_t e, unsigned order,
+                                    const FeedFn &feed) {
+    CentralMoments cm0(e - b, 2 * order);
+    CentralMoments cm1(e - b, 2 * order);
+    CentralMoments *cm[2] = {&cm0, &cm1};
+    feed([&](const NPArrayView<Ty> &traces,
+             const vector<Classification> &classifier, size_t first_trace) {
+        accumulateMoments(cm, b, e, traces, classifier, first_trace);
+    });
+    const CentralMoments *ccm[2] = {&cm0, &cm1};
+    return higherOrderWelsh(ccm, order);
+}
+} // namespace
+
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, unsigned order,
+                       const NPArrayView<Ty> &traces,
+                       const vector<Classification> &classifier) {
+    assert(order >= 1 && "The t-test order must be at least 1");
+    assert(b <= e && "Wrong begin / end samples");
+    assert(e <= traces.cols() && "Not that many samples in the trace");
+
+    if (order == 1)
+        return t_test(b, e, traces, classifier);
+    if (b == e)
+        return {};
+
+    return higher_order_t_test<Ty>(b, e, order, [&](const auto &add) {
+        add(traces, classifier, 0);
+    });
 }
 
+namespace {
+template <typename Ty, class ChunkedTraces>
+NPArray<double>
+chunked_higher_order_t_test(size_t b, size_t e, unsigned order,
+                            ChunkedTraces &traces,
+                            const vector<Classification> &classifier) {
+    assert(order >= 1 && "The t-test order must be at least 1");
+    assert(b <= e && "Wrong begin / end samples");
+    assert(e <= traces.cols() && "Not that many samples in the trace");
+    assert(classifier.size() >= traces.rows() &&
+           "Not enough classification data for the traces");
+
+    if (order == 1)
+        return t_test(b, e, traces, classifier);
+    if (b == e)
+        return {};
+
+    return higher_order_t_test<Ty>(b, e, order, [&](const auto &add) {
+        traces.rewind();
+        while (traces.next())
+            add(traces.chunk(), classifier, traces.chunkBegin());
+        assert(traces.good() && "Error reading traces by chunks");
+    });
+}
+} // namespace
+
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, unsigned order,
+                       NPYChunkReader<Ty> &traces,
+                       const vector<Classification> &classifier) {
+    return chunked_higher_order_t_test<Ty>(b, e, order, traces, classifier);
+}
+
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, unsigned order,
+                       ShardedNPArray<Ty> &traces,
+                       const vector<Classification> &classifier) {
+    return chunked_higher_order_t_test<Ty>(b, e, order, traces, classifier);
+}
+
+template <typename Ty>
+NPArray<double> t_test(size_t b, size_t e, unsigned order,
+                       const NPArrayView<Ty> &group0,
+                       const NPArrayView<Ty> &group1) {
+    assert(order >= 1 && "The t-test order must be at least 1");
+    assert(b <= e && "Wrong begin / end samples");
+    assert(e <= group0.cols() && "Not that many samples in group0 traces");
+    assert(e <= group1.cols() && "Not that many samples in group1 traces");
+
+    if (order == 1)
+        return t_test(b, e, group0, group1);
+    if (b == e)
+        return {};
+
+    return higher_order_t_test<Ty>(b, e, order, [&](const auto &add) {
+        add(group0,
+            vector<Classification>(group0.rows(), Classification::GROUP_0), 0);
+        add(group1,
+            vector<Classification>(group1.rows(), Classification::GROUP_1), 0);
+    });
+}
+
+template <typename Ty>
+TTestAccumulator<Ty>::TTestAccumulator(size_t num_samples)
+    : avg{MeanWithVarVector<Ty>(num_samples),
+          MeanWithVarVector<Ty>(num_samples)} {}
+
+template <typename Ty>
+TTestAccumulator<Ty>::TTestAccumulator(const std::string &filename,
+                                       const NPArrayBase::Window &window) {
+    // The state is saved with, for each group, a row of counts, a row of
+    // means and a row of sums of squared differences to the mean.
+    const NPArray<double> state(
+        filename, NPArrayBase::Window(0, -1, window.colBegin, window.colEnd,
+                                      window.colStride));
+    if (!state.good()) {
+        errstr = state.error();
+        return;
+    }
+    if (state.rows() != 6) {
+        errstr = "wrong number of rows in t-test accumulator state";
+        return;
+    }
+
+    for (size_t g = 0; g < 2; g++) {
+        avg[g].reserve(state.cols());
+        for (size_t s = 0; s < state.cols(); s++)
+            avg[g].emplace_back(size_t(state(3 * g, s)), state(3 * g + 1, s),
+                                state(3 * g + 2, s));
+    }
+}
+
+template <typename Ty>
+size_t TTestAccumulator<Ty>::count(Classification group) const noexcept {
+    const int g = groupIndex(group);
+    return g < 0 || avg[g].empty() ? 0 : avg[g][0].count();
+}
+
+template <typename Ty>
+void TTestAccumulator<Ty>::add(const NPArrayView<Ty> &traces,
+                               Classification group) {
+    add(traces, vector<Classification>(traces.rows(), group));
+}
+
+template <typename Ty>
+void TTestAccumulator<Ty>::add(const NPArrayView<Ty> &traces,
+                               const vector<Classification> &classifier,
+                               size_t first_trace) {
+    assert(traces.cols() == samples() &&
+           "Number of samples does not match the accumulator's");
+    assert(classifier.size() >= first_trace + traces.rows() &&
+           "Not enough classification data for the traces");
+    accumulate(avg, 0, samples(), traces, classifier, first_trace);
+}
+
+template <typename Ty>
+bool TTestAccumulator<Ty>::merge(const TTestAccumulator &other) {
+    if (other.samples() != samples())
+        return false;
+    for (size_t g = 0; g < 2; g++)
+        for (size_t s = 0; s < samples(); s++)
+            avg[g][s].merge(other.avg[g][s]);
+    return true;
+}
+
+template <typename Ty> NPArray<double> TTestAccumulator<Ty>::t_test() const {
+    if (samples() == 0)
+        return {};
+    return welsh(avg);
+}
+
+template <typename Ty>
+bool TTestAccumulator<Ty>::save(const std::string &filename) const {
+    NPArray<double> state(6, samples());
+    for (size_t g = 0; g < 2; g++)
+        for (size_t s = 0; s < samples(); s++) {
+            state(3 * g, s) = double(avg[g][s].count());
+            state(3 * g + 1, s) = avg[g][s].value();
+            state(3 * g + 2, s) = avg[g][s].m2();
+        }
+    return state.save(filename);
+}
+
+// Instantiate the t-tests for the supported trace storage types.
+#define INSTANTIATE_T_TEST(Ty)                                                 \
+    template NPArray<double> t_test(size_t, size_t, const NPArrayView<Ty> &,   \
+                                    const vector<Classification> &);           \
+    template double t_test(size_t, const NPArrayView<Ty> &,                    \
+                           const vector<Classification> &);                    \
+    template NPArray<double> t_test(size_t, size_t, NPYChunkReader<Ty> &,      \
+                                    const vector<Classification> &);           \
+    template NPArray<double> t_test(size_t, size_t, ShardedNPArray<Ty> &,      \
+                                    const vector<Classification> &);           \
+    template NPArray<double> t_test(size_t, size_t, const NPArrayView<Ty> &,   \
+                                    const NPArrayView<Ty> &);                  \
+    template double t_test(size_t, const NPArrayView<Ty> &,                    \
+                           const NPArrayView<Ty> &);                           \
+    template double t_test(size_t, double, const NPArrayView<Ty> &);           \
+    template double t_test(size_t, double, const NPArrayView<Ty> &,            \
+                           const function<bool(size_t)> &);                    \
+    template NPArray<double> t_test(size_t, size_t, const vector<double> &,    \
+                                    const NPArrayView<Ty> &);                  \
+    template NPArray<double> t_test(size_t, size_t, const vector<double> &,    \
+                                    const NPArrayView<Ty> &,                   \
+                                    const function<bool(size_t)> &);           \
+    template NPArray<double> perfect_t_test(                                   \
+        size_t, size_t, const NPArrayView<Ty> &, const NPArrayView<Ty> &,      \
+        ostream *);                                                            \
+    template NPArray<double> perfect_t_test(                                   \
+        size_t, size_t, const NPArrayView<Ty> &,                               \
+        const vector<Classification> &, ostream *);                           \
+    template NPArray<double> t_test(size_t, size_t, unsigned,                  \
+                                    const NPArrayView<Ty> &,                   \
+                                    const vector<Classification> &);           \
+    template NPArray<double> t_test(size_t, size_t, unsigned,                  \
+                                    NPYChunkReader<Ty> &,                      \
+                                    const vector<Classification> &);           \
+    template NPArray<double> t_test(size_t, size_t, unsigned,                  \
+                                    ShardedNPArray<Ty> &,                      \
+                                    const vector<Classification> &);           \
+    template NPArray<double> t_test(size_t, size_t, unsigned,                  \
+                                    const NPArrayView<Ty> &,                   \
+                                    const NPArrayView<Ty> &);                  \
+    template NPArray<double> t_test(size_t, size_t, const NPArrayView<Ty> &,   \
+                                    const Classifiers &);                      \
+    template NPArray<double> t_test(size_t, size_t, ShardedNPArray<Ty> &,      \
+                                    const Classifiers &);                      \
+    template class TTestAccumulator<Ty>;
+
+INSTANTIATE_T_TEST(double)
+INSTANTIATE_T_TEST(float)
+INSTANTIATE_T_TEST(int16_t)
+INSTANTIATE_T_TEST(uint16_t)
+
+#undef INSTANTIATE_T_TEST
+
 } // namespace PAF::SCA
@@ -20,10 +20,14 @@
 
 #include "PAF/SCA/utils.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <numeric>
+#include <set>
 
 using std::fabs;
+using std::vector;
 
 namespace PAF::SCA {
 
@@ -50,4 +54,56 @@ double find_max(const NPArray<double>::const_Row &row, size_t *index,
     return max_v;
 }
 
+vector<size_t> select_poi(const NPArray<double> &scores, size_t k,
+                          size_t window) {
+    const size_t num_samples = scores.cols();
+    if (k == 0 || num_samples == 0)
+        return vector<size_t>();
+
+    // The score of a sample is its largest absolute value over all rows, NaNs
+    // being ignored.
+    vector<double> score(num_samples, 0.0);
+    for (size_t r = 0; r < scores.rows(); r++)
+        for (size_t c = 0; c < num_samples; c++) {
+            const double v = fabs(scores(r, c));
+            if (v > score[c])
+                score[c] = v;
+        }
+
+    // Rank the samples by decreasing score, ties being broken by the sample
+    // index so that the selection is deterministic.
+    vector<size_t> ranked(num_samples);
+    std::iota(ranked.begin(), ranked.end(), 0);
+    std::stable_sort(ranked.begin(), ranked.end(), [&](size_t a, size_t b) {
+        return score[a] > score[b];
+    });
+
+    // Greedily select the peaks, skipping the samples which are in the window
+    // of an already selected peak.
+    std::set<size_t> peaks;
+    for (size_t i = 0; i < num_samples && peaks.size() < k; i++) {
+        const size_t s = ranked[i];
+        if (window != 0) {
+            const auto next = peaks.lower_bound(s);
+            if (next != peaks.end() && *next - s <= window)
+                continue;
+            if (next != peaks.begin() && s - *std::prev(next) <= window)
+                continue;
+        }
+        peaks.insert(s);
+    }
+
+    // And expand the peaks to their windows.
+    vector<size_t> poi;
+    for (const size_t p : peaks) {
+        const size_t b = p >= window ? p - window : 0;
+        const size_t e = std::min(p + window + 1, num_samples);
+        for (size_t s = poi.empty() ? b : std::max(b, poi.back() + 1); s < e;
+             s++)
+            poi.push_back(s);
+    }
+
+    return poi;
+}
+
 } // namespace PAF::SCA
@@ -24,9 +24,14 @@
 
 #include "fstapi.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <limits>
+#include <functional>
 #include <map>
+#include <memory>
+#include <queue>
 #include <set>
 #include <string>
 #include <vector>
@@ -44,10 +49,18 @@ namespace {
 using FstHandleMapTy = map<fstHandle, SignalIdxTy>;
 
 class ScopesBuilder : public FSTHierarchyVisitorBase {
+    using FilterAction = Waveform::Visitor::FilterAction;
+
   public:
-    ScopesBuilder(Waveform &W) : w(W) { scopes.push_back(W.getRootScope()); }
+    ScopesBuilder(Waveform &W, const Waveform::Visitor::Options &Options)
+        : w(W), options(Options) {
+        scopes.push_back(W.getRootScope());
+        selectSignals.push_back(true);
+    }
 
     bool onModule(const char *fullScopeName, const fstHier *h) override {
+        if (skipScope(fullScopeName))
+            return true;
         const decltype(h->u.scope) *Scope =
             FSTHierarchyVisitorBase::getAsFstHierScope(h);
         scopes.push_back(&scopes.back()->addModule(Scope->name, fullScopeName,
@@ -56,6 +69,8 @@ class ScopesBuilder : public FSTHierarchyVisitorBase {
     }
 
     bool onTask(const char *fullScopeName, const fstHier *h) override {
+        if (skipScope(fullScopeName))
+            return true;
         const decltype(h->u.scope) *Scope =
             FSTHierarchyVisitorBase::getAsFstHierScope(h);
         scopes.push_back(&scopes.back()->addTask(Scope->name, fullScopeName,
@@ -64,6 +79,8 @@ class ScopesBuilder : public FSTHierarchyVisitorBase {
     }
 
     bool onFunction(const char *fullScopeName, const fstHier *h) override {
+        if (skipScope(fullScopeName))
+            return true;
         const decltype(h->u.scope) *Scope =
             FSTHierarchyVisitorBase::getAsFstHierScope(h);
         scopes.push_back(&scopes.back()->addFunction(Scope->name, fullScopeName,
@@ -72,6 +89,8 @@ class ScopesBuilder : public FSTHierarchyVisitorBase {
     }
 
     bool onBlockBegin(const char *fullScopeName, const fstHier *h) override {
+        if (skipScope(fullScopeName))
+            return true;
         const decltype(h->u.scope) *Scope =
             FSTHierarchyVisitorBase::getAsFstHierScope(h);
         scopes.push_back(&scopes.back()->addBlock(Scope->name, fullScopeName,
@@ -80,7 +99,12 @@ class ScopesBuilder : public FSTHierarchyVisitorBase {
     }
 
     bool leaveCurrentScope() override {
+        if (skippedScopes > 0) {
+            skippedScopes -= 1;
+            return true;
+        }
         scopes.pop_back();
+        selectSignals.pop_back();
         return true;
     }
 
@@ -88,6 +112,8 @@ class ScopesBuilder : public FSTHierarchyVisitorBase {
                bool isAlias) override {
         const decltype(h->u.var) *Var =
             FSTHierarchyVisitorBase::getAsFstHierVar(h);
+        if (!select(Waveform::SignalDesc::Kind::REGISTER, Var, isAlias))
+            return true;
         if (!isAlias) {
             SignalIdxTy idx =
                 w.addRegister(*scopes.back(), string(Var->name), Var->length);
@@ -112,6 +138,8 @@ class ScopesBuilder : public FSTHierarchyVisitorBase {
                 bool isAlias) override {
         const decltype(h->u.var) *Var =
             FSTHierarchyVisitorBase::getAsFstHierVar(h);
+        if (!select(Waveform::SignalDesc::Kind::WIRE, Var, isAlias))
+            return true;
         if (!isAlias) {
             SignalIdxTy idx =
                 w.addWire(*scopes.back(), string(Var->name), Var->length);
@@ -141,6 +169,8 @@ class ScopesBuilder : public FSTHierarchyVisitorBase {
                bool isAlias) override {
         const decltype(h->u.var) *Var =
             FSTHierarchyVisitorBase::getAsFstHierVar(h);
+        if (!select(Waveform::SignalDesc::Kind::INTEGER, Var, isAlias))
+            return true;
         if (!isAlias) {
             SignalIdxTy idx =
                 w.addInteger(*scopes.back(), string(Var->name), Var->length);
@@ -167,8 +197,45 @@ class ScopesBuilder : public FSTHierarchyVisitorBase {
 
   private:
     Waveform &w;
+    const Waveform::Visitor::Options &options;
     vector<Waveform::Scope *> scopes;
+    // Are the signals in scopes selected ?
+    vector<bool> selectSignals;
+    // The number of nested scopes being skipped, which are not created.
+    size_t skippedScopes = 0;
     FstHandleMapTy fstHandles;
+    // The handles of the signals which have not been selected.
+    set<fstHandle> skippedHandles;
+
+    // Returns true iff the scope named fullScopeName shall be skipped. If not,
+    // records if its signals are selected.
+    bool skipScope(const char *fullScopeName) {
+        if (skippedScopes > 0) {
+            skippedScopes += 1;
+            return true;
+        }
+        const FilterAction action = options.filter(fullScopeName);
+        if (action == FilterAction::SKIP_ALL) {
+            skippedScopes = 1;
+            return true;
+        }
+        selectSignals.push_back(action == FilterAction::VISIT_ALL);
+        return false;
+    }
+
+    // Returns true iff the signal Var, of kind k, is selected. A selected
+    // alias to a skipped signal becomes a new signal.
+    bool select(Waveform::SignalDesc::Kind k, const fstHierVar *Var,
+                bool &isAlias) {
+        if (skippedScopes > 0 || !selectSignals.back() || options.skip(k)) {
+            if (!isAlias)
+                skippedHandles.insert(Var->handle);
+            return false;
+        }
+        if (isAlias && skippedHandles.erase(Var->handle) != 0)
+            isAlias = false;
+        return true;
+    }
 };
 
 struct WaveformBuilder : public FSTWaveBuilderBase<WaveformBuilder> {
@@ -185,6 +252,72 @@ struct WaveformBuilder : public FSTWaveBuilderBase<WaveformBuilder> {
     const FstHandleMapTy &fstHandles;
 };
 
+// The WindowedWaveformBuilder class builds the Waveform from the changes in a
+// [begin, end) window, and from the last change before the window so that the
+// signals' value at the window start is known.
+struct WindowedWaveformBuilder
+    : public FSTWaveBuilderBase<WindowedWaveformBuilder> {
+    WindowedWaveformBuilder(Waveform &W, const FstHandleMapTy &FstHandles)
+        : w(W), fstHandles(FstHandles), pending(W.getNumSignals()) {}
+
+    // Select the [begin, end) window. The changes before \p floor have
+    // already been processed with a previous window and must be ignored.
+    void setWindow(TimeTy floor, TimeTy begin, TimeTy end) {
+        floorTime = floor;
+        beginTime = begin;
+        endTime = end;
+    }
+
+    void process(uint64_t time, fstHandle facidx, const unsigned char *value) {
+        if (time < floorTime || time >= endTime)
+            return;
+        const auto it = fstHandles.find(facidx);
+        if (it == fstHandles.end())
+            return;
+        if (time < beginTime) {
+            Pending &p = pending[it->second];
+            if (!p.valid) {
+                p.valid = true;
+                pendingSignals.push_back(it->second);
+            }
+            p.time = time;
+            p.value = (const char *)value;
+            return;
+        }
+        flush();
+        w.addValueChange(it->second, time, (const char *)value);
+    }
+
+    // Add the pending changes to the Waveform, in time order.
+    void flush() {
+        if (pendingSignals.empty())
+            return;
+        std::sort(pendingSignals.begin(), pendingSignals.end(),
+                  [&](SignalIdxTy lhs, SignalIdxTy rhs) {
+                      return pending[lhs].time < pending[rhs].time;
+                  });
+        for (const SignalIdxTy s : pendingSignals) {
+            w.addValueChange(s, pending[s].time, string_view(pending[s].value));
+            pending[s].valid = false;
+        }
+        pendingSignals.clear();
+    }
+
+    Waveform &w;
+    const FstHandleMapTy &fstHandles;
+    TimeTy floorTime = 0;
+    TimeTy beginTime = 0;
+    TimeTy endTime = 0;
+    // The last change before the window, for each signal.
+    struct Pending {
+        TimeTy time = 0;
+        string value;
+        bool valid = false;
+    };
+    vector<Pending> pending;
+    vector<SignalIdxTy> pendingSignals;
+};
+
 struct FstBuilder : public Waveform::Visitor {
 
     void visitSignal(const string &fullScopeName,
@@ -245,6 +378,22 @@ struct FstBuilder : public Waveform::Visitor {
 
     void leaveScope() override { fstWriterSetUpscope(ctx); }
 
+    // Emit a time change. The current block is handed over to the
+    // compression first if it has enough value changes: blocks are only
+    // split between times.
+    void emitTimeChange(TimeTy time) {
+        if (blockSize != 0 && numChanges >= blockSize) {
+            fstWriterFlushContext(ctx);
+            numChanges = 0;
+        }
+        fstWriterEmitTimeChange(ctx, time);
+    }
+
+    void emitValueChange(fstHandle handle, const ValueTy &value) {
+        fstWriterEmitValueChange(ctx, handle, string(value).c_str());
+        numChanges += 1;
+    }
+
     void process() {
         assert(w && "Waveform pointer must not be null");
         vector<Signal::Iterator> SigIt;
@@ -254,7 +403,7 @@ struct FstBuilder : public Waveform::Visitor {
 
         // For each time of change
         for (auto time = w->timesBegin(); time != w->timesEnd(); time++) {
-            fstWriterEmitTimeChange(ctx, *time);
+            emitTimeChange(*time);
             for (SignalIdxTy sidx = 0; sidx < SigIt.size(); sidx++) {
                 if (!SigIt[sidx].hasReachedEnd()) {
                     const Signal::ChangeTy C = *SigIt[sidx];
@@ -266,8 +415,7 @@ struct FstBuilder : public Waveform::Visitor {
                             DIE("Can not find FstHandle for the this "
                                 "SignalIdx");
                         // And emit change
-                        fstWriterEmitValueChange(ctx, it->second,
-                                                 string(C.value).c_str());
+                        emitValueChange(it->second, C.value);
                         SigIt[sidx]++;
                     }
                 }
@@ -281,17 +429,32 @@ struct FstBuilder : public Waveform::Visitor {
 #endif
     }
 
-    FstBuilder(const string &FileName, const Waveform &W)
+    FstBuilder(const string &FileName, const Waveform &W,
+               const WriteOptions &options)
         : Waveform::Visitor(&W),
-          ctx(fstWriterCreate(FileName.c_str(), 1 /* use_compressed_hier */)) {
+          ctx(fstWriterCreate(FileName.c_str(), 1 /* use_compressed_hier */)),
+          blockSize(options.blockSize) {
         if (!ctx)
             return;
 
-        fstWriterSetPackType(ctx, FST_WR_PT_LZ4);
+        switch (options.compression) {
+        case WriteOptions::Compression::FAST:
+            fstWriterSetPackType(ctx, FST_WR_PT_LZ4);
+            break;
+        case WriteOptions::Compression::BALANCED:
+            fstWriterSetPackType(ctx, FST_WR_PT_FASTLZ);
+            break;
+        case WriteOptions::Compression::SMALL:
+            fstWriterSetPackType(ctx, FST_WR_PT_ZLIB);
+            break;
+        }
         fstWriterSetRepackOnClose(
             ctx, 0 /* 0 is normal, 1 does the repack (via fstapi) at end */);
+        // In parallel mode, the value change blocks are compressed by a
+        // worker thread while the next block is being fed.
         fstWriterSetParallelMode(
-            ctx, 0 /* 0 is is single threaded, 1 is multi-threaded */);
+            ctx, options.parallel ? 1 : 0 /* 0 is is single threaded, 1 is
+                                             multi-threaded */);
         fstWriterSetTimescale(ctx, W.getTimeScale());
         fstWriterSetTimezero(ctx, W.getTimeZero());
     }
@@ -302,6 +465,54 @@ struct FstBuilder : public Waveform::Visitor {
 
     map<SignalIdxTy, fstHandle> idx2FstHandleMap;
     void *ctx;
+    // The number of value changes per block (0 lets fstapi decide), and in
+    // the current block.
+    size_t blockSize;
+    size_t numChanges = 0;
+};
+
+// The MergedScopesBuilder class merges the scopes and signals of an input
+// Waveform into the Waveform describing the merged output, and records the
+// output signal index of each of the input signals.
+class MergedScopesBuilder : public Waveform::Visitor {
+  public:
+    // A marker for the input signals which are not in the output.
+    static constexpr SignalIdxTy NONE = SignalIdxTy(-1);
+
+    MergedScopesBuilder(Waveform &Out, const Waveform &In,
+                        vector<SignalIdxTy> &OutIdx)
+        : Waveform::Visitor(&In), out(Out), outIdx(OutIdx) {
+        outIdx.assign(In.getNumSignals(), NONE);
+        scopes.push_back(Out.getRootScope());
+    }
+
+    void enterScope(const Waveform::Scope &scope) override {
+        scopes.push_back(&scopes.back()->addScope(
+            scope.getInstanceName(), scope.getFullScopeName(),
+            scope.getScopeName(), scope.getKind()));
+    }
+
+    void leaveScope() override { scopes.pop_back(); }
+
+    void visitSignal(const string &fullScopeName,
+                     const Waveform::SignalDesc &SD) override {
+        if (scopes.back()->hasSignal(SD.getName()))
+            DIE("signal '", SD.getName(), "' in scope '", fullScopeName,
+                "' is present in several of the merged files");
+        const SignalIdxTy idx = SD.getIdx();
+        const unsigned numBits = (*w)[idx].getNumBits();
+        if (outIdx[idx] == NONE)
+            outIdx[idx] = out.addSignal(*scopes.back(), string(SD.getName()),
+                                        numBits, SD.getKind());
+        else
+            out.addSignal(*scopes.back(), string(SD.getName()), numBits,
+                          SD.getKind(), outIdx[idx]);
+    }
+
+  private:
+    Waveform &out;
+    vector<SignalIdxTy> &outIdx;
+    vector<Waveform::Scope *> scopes;
 };
 } // namespace
 
@@ -372,14 +583,8 @@ FSTWaveFile::~FSTWaveFile() {
     }
 }
 
-Waveform FSTWaveFile::read() {
-    Waveform W(fileName, 0, 0, 0);
-    if (!FSTWaveFile::read(W))
-        DIE("error reading '%s", fileName.c_str());
-    return W;
-}
-
-bool FSTWaveFile::read(Waveform &W) {
+bool FSTWaveFile::read(Waveform &W, const Waveform::Visitor::Options &options,
+                       const TimeWindows &windows) {
     if (openedForWrite)
         DIE("Can not read FST file that has been opened for write");
 
@@ -388,15 +593,47 @@ bool FSTWaveFile::read(Waveform &W) {
     W.setTimeScale(fstReaderGetTimescale(f));
     W.setTimeZero(fstReaderGetTimezero(f));
 
-    // Build the scopes data structure.
-    ScopesBuilder SB(W);
+    // Build the scopes data structure, with the selected signals only.
+    ScopesBuilder SB(W, options);
     if (!visitHierarchy(&SB))
         DIE("Error in processing scopes !");
 
-    // Slurp all signals, creating them as they appear.
-    WaveformBuilder WB(W, SB.getFstHandles());
-    if (!visitSignals(WB))
-        DIE("Error in reading signals !");
+    // Slurp all selected signals: the other signals are not even decoded.
+    vector<fstHandle> handles;
+    if (!options.isAllSelected()) {
+        handles.reserve(SB.getFstHandles().size());
+        for (const auto &h : SB.getFstHandles())
+            handles.push_back(h.first);
+    }
+    const auto visit = [&](auto &B) {
+        return options.isAllSelected() ? visitSignals(B)
+                                       : visitSignals(B, handles);
+    };
+
+    if (windows.empty()) {
+        WaveformBuilder WB(W, SB.getFstHandles());
+        if (!visit(WB))
+            DIE("Error in reading signals !");
+        return true;
+    }
+
+    // Only the blocks overlapping a window are decompressed, one window at a
+    // time. The first block of a window provides the signals' value at the
+    // window start.
+    WindowedWaveformBuilder WB(W, SB.getFstHandles());
+    TimeTy floor = 0;
+    for (const auto &window : windows) {
+        WB.setWindow(floor, window.first, window.second);
+        fstReaderSetLimitTimeRange(f, window.first, window.second - 1);
+        if (!visit(WB))
+            DIE("Error in reading signals !");
+        WB.flush();
+        floor = window.second;
+    }
+    fstReaderSetUnlimitedTimeRange(f);
+
+    W.setStartTime(std::max(W.getStartTime(), windows.getBeginTime()));
+    W.setEndTime(std::min(W.getEndTime(), windows.getEndTime()));
 
     return true;
 }
@@ -404,7 +641,7 @@ bool FSTWaveFile::read(Waveform &W) {
 bool FSTWaveFile::write(const Waveform &W) {
     if (!openedForWrite)
         DIE("Can not write FST file that has been opened for read");
-    FstBuilder FB(fileName, W);
+    FstBuilder FB(fileName, W, writeOptions);
     if (!FB)
         DIE("Error creating output file: ", fileName);
 
@@ -415,6 +652,106 @@ bool FSTWaveFile::write(const Waveform &W) {
     return true;
 }
 
+bool FSTWaveFile::writeMerged(const vector<string> &files, size_t numSlices) {
+    if (!openedForWrite)
+        DIE("Can not write FST file that has been opened for read");
+    if (files.empty())
+        return false;
+    if (numSlices == 0)
+        numSlices = 1;
+
+    // The headers provide the overall time range, which is split in slices.
+    TimeTy startTime = std::numeric_limits<TimeTy>::max();
+    TimeTy endTime = 0;
+    for (const auto &file : files) {
+        const auto range =
+            WaveFile::get(file, /* write: */ false)->getTimeRange();
+        startTime = std::min(startTime, range.first);
+        endTime = std::max(endTime, range.second);
+    }
+    const TimeTy duration = (endTime - startTime) / numSlices + 1;
+
+    Waveform WH(fileName, startTime, endTime, 0);
+    std::unique_ptr<FstBuilder> FB;
+    // For each input, the output index of each of its signals.
+    vector<vector<SignalIdxTy>> outIdx(files.size());
+
+    // The value changes of one signal from one input.
+    struct Stream {
+        const Signal *s;
+        fstHandle handle;
+        size_t change;
+    };
+    vector<Stream> streams;
+    using HeapItem = std::pair<TimeTy, size_t>;
+    std::priority_queue<HeapItem, vector<HeapItem>, std::greater<HeapItem>>
+        heap;
+    TimeTy lastTime = 0;
+    bool emittedTime = false;
+
+    for (TimeTy begin = startTime; begin <= endTime; begin += duration) {
+        // Read this slice from all inputs. A windowed read also provides the
+        // value of each signal at the slice start, which has been emitted
+        // with the previous slice already.
+        const TimeWindows TW(begin, begin + duration);
+        vector<Waveform> slices;
+        slices.reserve(files.size());
+        for (const auto &file : files)
+            slices.emplace_back(
+                WaveFile::get(file, /* write: */ false)->read(
+                    Waveform::Visitor::Options(), TW));
+
+        if (!FB) {
+            WH.setTimeScale(slices[0].getTimeScale());
+            WH.setTimeZero(slices[0].getTimeZero());
+            for (size_t i = 0; i < slices.size(); i++) {
+                MergedScopesBuilder MSB(WH, slices[i], outIdx[i]);
+                slices[i].visit(MSB);
+            }
+            FB = std::make_unique<FstBuilder>(fileName, WH, writeOptions);
+            if (!*FB)
+                DIE("Error creating output file: ", fileName);
+            WH.visit(*FB);
+        }
+
+        // k-way merge of the slice's value changes, in time order.
+        streams.clear();
+        for (size_t i = 0; i < slices.size(); i++)
+            for (SignalIdxTy s = 0; s < slices[i].getNumSignals(); s++) {
+                if (outIdx[i][s] == MergedScopesBuilder::NONE)
+                    continue;
+                const Signal &S = slices[i][s];
+                size_t c = 0;
+                while (c < S.getNumChanges() && S.getTimeChange(c) < begin)
+                    c++;
+                if (c == S.getNumChanges())
+                    continue;
+                streams.push_back(
+                    {&S, FB->idx2FstHandleMap.at(outIdx[i][s]), c});
+                heap.emplace(S.getTimeChange(c), streams.size() - 1);
+            }
+
+        while (!heap.empty()) {
+            const auto [time, sIdx] = heap.top();
+            heap.pop();
+            if (!emittedTime || time != lastTime) {
+                FB->emitTimeChange(time);
+                lastTime = time;
+                emittedTime = true;
+            }
+            Stream &St = streams[sIdx];
+            FB->emitValueChange(St.handle, St.s->getValueChange(St.change));
+            if (++St.change < St.s->getNumChanges())
+                heap.emplace(St.s->getTimeChange(St.change), sIdx);
+        }
+
+        if (endTime - begin < duration)
+            break;
+    }
+
+    return true;
+}
+
 bool FSTWaveFile::visitHierarchy(FSTHierarchyVisitorBase *V) const {
     if (openedForWrite)
         DIE("Can not read FST file that has been opened for write");
@@ -499,6 +836,14 @@ bool FSTWaveFile::visitHierarchy(FSTHierarchyVisitorBase *V) const {
     return true;
 }
 
+std::pair<TimeTy, TimeTy> FSTWaveFile::getTimeRange() {
+    if (!f)
+        DIE("Can not read from input file: ", fileName);
+    if (openedForWrite)
+        DIE("Can not read FST file that has been opened for write");
+    return {fstReaderGetStartTime(f), fstReaderGetEndTime(f)};
+}
+
 struct QuickTimeBuilder : public FSTWaveBuilderBase<QuickTimeBuilder> {
     QuickTimeBuilder() {}
 
@@ -0,0 +1,99 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/WAN/Synthetic.h"
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace PAF::WAN {
+
+namespace {
+// The splitmix64 pseudo random number generator.
+class SplitMix64 {
+  public:
+    SplitMix64(uint64_t seed) : state(seed) {}
+
+    uint64_t operator()() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // Get a uniformly distributed double in [0, 1).
+    double uniform() { return double((*this)() >> 11) * 0x1.0p-53; }
+
+  private:
+    uint64_t state;
+};
+
+constexpr unsigned REGISTER_WIDTH = 32;
+
+void setBits(string &str, uint64_t v) {
+    for (size_t b = 0; b < str.size(); b++)
+        str[str.size() - 1 - b] = (v >> b) & 1 ? '1' : '0';
+}
+} // namespace
+
+Waveform syntheticWaveform(size_t numSignals, size_t numTimes,
+                           double activity, uint64_t seed, TimeTy period) {
+    Waveform W("synthetic", 0, numTimes == 0 ? 0 : (numTimes - 1) * period,
+               -12);
+    W.setVersion("PAF synthetic waveform");
+    Waveform::Scope &S = W.getRootScope()->addModule("top", "top", "top");
+
+    vector<SignalIdxTy> signals;
+    signals.reserve(numSignals);
+    for (size_t s = 0; s < numSignals; s++)
+        if (s % 2 == 0)
+            signals.push_back(W.addWire(S, "w" + std::to_string(s), 1));
+        else
+            signals.push_back(
+                W.addRegister(S, "r" + std::to_string(s), REGISTER_WIDTH));
+
+    // The wires' current values, so that their changes are actual changes.
+    vector<bool> wires(numSignals);
+    SplitMix64 R(seed);
+    string wire(1, '0');
+    string reg(REGISTER_WIDTH, '0');
+    for (size_t t = 0; t < numTimes; t++) {
+        const TimeTy time = t * period;
+        for (size_t s = 0; s < numSignals; s++) {
+            if (t != 0 && R.uniform() >= activity)
+                continue;
+            if (s % 2 == 0) {
+                wires[s] = t == 0 ? R() & 1 : !wires[s];
+                wire[0] = wires[s] ? '1' : '0';
+                W.addValueChange(signals[s], time, wire);
+            } else {
+                setBits(reg, R());
+                W.addValueChange(signals[s], time, reg);
+            }
+        }
+    }
+
+    return W;
+}
+
+} // namespace PAF::WAN
@@ -22,20 +22,31 @@
 #include "PAF/Error.h"
 #include "PAF/WAN/Signal.h"
 #include "PAF/WAN/Waveform.h"
+#include "PAF/utils/Parallel.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 using std::cerr;
 using std::ifstream;
 using std::log10;
@@ -46,51 +57,133 @@ using std::string_view;
 using std::unordered_map;
 using std::vector;
 
+using PAF::WAN::Signal;
 using PAF::WAN::SignalIdxTy;
+using PAF::WAN::TimeIdxTy;
 using PAF::WAN::TimeTy;
+using PAF::WAN::TimeWindows;
 using PAF::WAN::VCDWaveFile;
 using PAF::WAN::Waveform;
 
 namespace {
 
-class VCDParserBase {
+// The VCDFile class holds the content of a VCD file. The file is mapped in
+// memory, so that the (possibly huge) VCD files are parsed without copying
+// them. Files which can not be mapped are read in memory instead.
+class VCDFile {
   public:
-    VCDParserBase(const string &Filename)
-        : filename(Filename), is(Filename.c_str()) {
-        if (!good())
+    VCDFile(const string &Filename) {
+        const int fd = open(Filename.c_str(), O_RDONLY);
+        if (fd < 0)
             DIE("Invalid VCD stream");
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                buffer = static_cast<const char *>(p);
+                bufferSize = st.st_size;
+                mapped = true;
+            }
+        }
+        close(fd);
+        if (!mapped) {
+            ifstream is(Filename.c_str(), std::ios::binary);
+            if (!is)
+                DIE("Invalid VCD stream");
+            content.assign(std::istreambuf_iterator<char>(is),
+                           std::istreambuf_iterator<char>());
+            buffer = content.data();
+            bufferSize = content.size();
+        }
     }
 
-    bool eof() const { return is.eof(); }
-    bool good() const { return is.good(); }
-    bool eol() const { return offset == currentLine.size(); }
+    VCDFile(const VCDFile &) = delete;
+    VCDFile &operator=(const VCDFile &) = delete;
+
+    ~VCDFile() {
+        if (mapped)
+            munmap(const_cast<char *>(buffer), bufferSize);
+    }
+
+    [[nodiscard]] string_view getContent() const {
+        return {buffer, bufferSize};
+    }
+
+  private:
+    const char *buffer = nullptr;
+    size_t bufferSize = 0;
+    bool mapped = false;
+    // The file content, when it could not be mapped.
+    string content;
+};
+
+// The VCDParserBase class tokenizes (a part of) a VCD file content. The lines
+// and tokens are views into this content.
+class VCDParserBase {
+  public:
+    // Keyword kinds.
+    enum class KW : uint8_t {
+        UNKNOWN,
+        DATE,
+        COMMENT,
+        VERSION,
+        TIMESCALE,
+        SCOPE,
+        UPSCOPE,
+        ENDDEFINITIONS,
+        VAR,
+        DUMPALL,
+        DUMPVARS,
+        DUMPOFF,
+        DUMPON,
+        END
+    };
+
+    // The parse errors, with the line (relative to the parsed content) they
+    // occurred at.
+    using ErrorsTy = vector<std::pair<size_t, string>>;
+
+    VCDParserBase(const string &Filename, string_view Content)
+        : filename(Filename), buffer(Content.data()),
+          bufferSize(Content.size()) {}
+
+    bool eof() const { return position >= bufferSize; }
+    bool eol() const { return offset >= currentLine.size(); }
+
+    // Where the next line starts in the content.
+    size_t getPosition() const { return position; }
+    // The number of lines read so far.
+    size_t getLineNumber() const { return lineNumber; }
+
+    // Collect the errors into Errors instead of reporting them immediately.
+    void deferErrors(ErrorsTy &Errors) { deferredErrors = &Errors; }
 
     bool reportError(const string &s) const {
-        cerr << "Parse error in file " << filename << " at line " << lineNumber
-             << " : " << s << '\n';
+        if (deferredErrors)
+            deferredErrors->emplace_back(lineNumber, s);
+        else
+            reportError(filename, lineNumber, s);
         return false;
     }
 
+    static void reportError(const string &Filename, size_t Line,
+                            const string &s) {
+        cerr << "Parse error in file " << Filename << " at line " << Line
+             << " : " << s << '\n';
+    }
+
     bool readline() {
-        // std::cout << __PRETTY_FUNCTION__ << '\n';
-        if (is.eof())
+        if (eof())
             return false;
 
-        currentLine.clear();
-
-        string tmp;
-        while (true) {
-            getline(is, tmp);
-            currentLine.append(tmp);
-            if (is.good())
-                break;
-            if (is.eof())
-                return false;
-            if (is.fail()) {
-                is.clear();
-                continue;
-            }
-        }
+        const char *b = buffer + position;
+        const size_t remaining = bufferSize - position;
+        const char *nl =
+            static_cast<const char *>(std::memchr(b, '\n', remaining));
+        const size_t len = nl ? nl - b : remaining;
+        currentLine = string_view(b, len);
+        position += nl ? len + 1 : len;
 
         lineNumber += 1;
         offset = 0;
@@ -99,15 +192,13 @@ class VCDParserBase {
     }
 
     void skipWS() {
-        // std::cout << __PRETTY_FUNCTION__ << '\n';
         while (offset < currentLine.size() &&
                (currentLine[offset] == ' ' || currentLine[offset] == '\t'))
             offset += 1;
     }
 
     bool expect(char c) {
-        // std::cout << __PRETTY_FUNCTION__ << '\n';
-        if (offset > currentLine.size())
+        if (offset >= currentLine.size())
             return false;
 
         if (currentLine[offset] == c) {
@@ -118,8 +209,7 @@ class VCDParserBase {
         return false;
     }
 
-    bool expect(const string &s) {
-        // std::cout << __PRETTY_FUNCTION__ << '\n';
+    bool expect(string_view s) {
         if (offset + s.size() > currentLine.size())
             return false;
 
@@ -133,40 +223,45 @@ class VCDParserBase {
     }
 
     // Get all non whitespace characters.
-    bool getWord(string &kw) {
-        // std::cout << __PRETTY_FUNCTION__ << '\n';
-        size_t pos = currentLine.find_first_of(" \t", offset);
-        if (pos == string::npos) {
-            kw = currentLine.substr(offset);
-            offset += kw.size();
-            return true;
-        }
-
+    bool getWord(string_view &kw) {
+        size_t pos = offset;
+        while (pos < currentLine.size() && currentLine[pos] != ' ' &&
+               currentLine[pos] != '\t')
+            pos += 1;
         kw = currentLine.substr(offset, pos - offset);
         offset = pos;
         skipWS();
         return true;
     }
 
+    bool getWord(string &kw) {
+        string_view w;
+        if (!getWord(w))
+            return false;
+        kw = w;
+        return true;
+    }
+
     bool getInt(size_t &i) {
-        string tmp = currentLine.substr(offset);
-        size_t intChars = 0;
-        try {
-            i = std::stoll(tmp, &intChars, 10);
-        } catch (const std::invalid_argument &ia) {
-            return reportError(string("invalid argument in std::stoll (") +
-                               currentLine + ")");
-        } catch (const std::out_of_range &oor) {
-            return reportError(
-                string("out of range conversion in std::stoll (") +
-                currentLine + ")");
+        const size_t begin = offset;
+        i = 0;
+        while (offset < currentLine.size() && currentLine[offset] >= '0' &&
+               currentLine[offset] <= '9') {
+            const size_t d = currentLine[offset] - '0';
+            if (i > (std::numeric_limits<size_t>::max() - d) / 10)
+                return reportError("out of range integer (" +
+                                   string(currentLine) + ")");
+            i = i * 10 + d;
+            offset += 1;
         }
-        offset += intChars;
+        if (offset == begin)
+            return reportError("invalid integer (" + string(currentLine) +
+                               ")");
         skipWS();
         return true;
     }
 
-    bool timescale(signed char &ts, int n, const string &unit) {
+    bool timescale(signed char &ts, int n, string_view unit) {
         ts = log10(n);
         if (unit == "s")
             ts += 0;
@@ -181,29 +276,117 @@ class VCDParserBase {
         else if (unit == "fs")
             ts -= 15;
         else
-            return reportError("unexpected timescale unit '" + unit + "'");
+            return reportError("unexpected timescale unit '" + string(unit) +
+                               "'");
         return true;
     }
 
   protected:
-    string currentLine;
+    string_view currentLine;
     size_t offset = 0; // Offset in current line.
 
+    bool expect(KW kw) {
+        size_t Offset_back = offset;
+        KW kw1;
+        if (!getKeyword(kw1))
+            return reportError("a keyword expected");
+
+        if (kw != kw1) {
+            offset = Offset_back;
+            return reportError("not the expected keyword");
+        }
+
+        return true;
+    }
+
+    // A keyword is a word prefixed with the '$' symbol: $end, $scope, ...
+    bool getKeyword(KW &kw) {
+        kw = KW::UNKNOWN;
+        if (!expect('$'))
+            return reportError("expected keyword start '$' not found");
+
+        string_view w;
+        if (!getWord(w))
+            return reportError("can not read keyword");
+
+        if (w == "end")
+            kw = KW::END;
+        else if (w == "var")
+            kw = KW::VAR;
+        else if (w == "date")
+            kw = KW::DATE;
+        else if (w == "comment")
+            kw = KW::COMMENT;
+        else if (w == "version")
+            kw = KW::VERSION;
+        else if (w == "timescale")
+            kw = KW::TIMESCALE;
+        else if (w == "scope")
+            kw = KW::SCOPE;
+        else if (w == "upscope")
+            kw = KW::UPSCOPE;
+        else if (w == "enddefinitions")
+            kw = KW::ENDDEFINITIONS;
+        else if (w == "dumpall")
+            kw = KW::DUMPALL;
+        else if (w == "dumpvars")
+            kw = KW::DUMPVARS;
+        else if (w == "dumpoff")
+            kw = KW::DUMPOFF;
+        else if (w == "dumpon")
+            kw = KW::DUMPON;
+        else
+            kw = KW::UNKNOWN;
+        return kw != KW::UNKNOWN;
+    }
+
+    bool getContent(const string &field, string &data) {
+        if (eol()) {
+            // Content is spread on separate line(s).
+            do {
+                if (!readline())
+                    return reportError(string("could not get ") + field +
+                                       " line");
+                if (offset == 0 && currentLine.size() == 4 &&
+                    currentLine[0] == '$' && currentLine[1] == 'e' &&
+                    currentLine[2] == 'n' && currentLine[3] == 'd')
+                    return true;
+                data += currentLine.substr(offset);
+            } while (true);
+        } else {
+            const size_t LS = currentLine.size();
+            if (LS >= offset + 5 && currentLine[LS - 4] == '$' &&
+                currentLine[LS - 3] == 'e' &&
+                currentLine[LS - 2] == 'n' && currentLine[LS - 1] == 'd') {
+                data = currentLine.substr(offset, LS - 5 - offset);
+                return true;
+            } else
+                return reportError(string("could not get $end in ") + field +
+                                   " single line");
+        }
+    }
+
   private:
     const string &filename;
-    ifstream is;
-    size_t lineNumber = 1;
+    // The content, and where the next line starts in it.
+    const char *buffer = nullptr;
+    size_t bufferSize = 0;
+    size_t position = 0;
+    size_t lineNumber = 0;
+    ErrorsTy *deferredErrors = nullptr;
 };
 
 class VCDParserQuick : public VCDParserBase {
   public:
-    VCDParserQuick(const string &Filename) : VCDParserBase(Filename) {}
+    VCDParserQuick(const string &Filename, string_view Content)
+        : VCDParserBase(Filename, Content) {}
     vector<TimeTy> parse() {
         signed char TS;
         bool hasTimescale = false;
         bool ok;
         while (!hasTimescale) {
-            readline();
+            if (!readline())
+                return {};
             if (expect("$timescale")) {
                 readline();
                 skipWS();
@@ -248,25 +431,44 @@ class VCDParserQuick : public VCDParserBase {
     }
 };
 
-class VCDParserFull : public VCDParserBase {
-    // Keyword kinds.
-    enum class KW : uint8_t {
-        UNKNOWN,
-        DATE,
-        COMMENT,
-        VERSION,
-        TIMESCALE,
-        SCOPE,
-        UPSCOPE,
-        ENDDEFINITIONS,
-        VAR,
-        DUMPALL,
-        DUMPVARS,
-        DUMPOFF,
-        DUMPON,
-        END
-    };
+// The VCD signals, by identifier.
+class VCDSignalIds {
+  public:
+    static constexpr SignalIdxTy NO_SIGNAL = SignalIdxTy(-1);
+    // A signal which exists in the file, but has not been selected.
+    static constexpr SignalIdxTy SKIPPED = SignalIdxTy(-2);
+
+    VCDSignalIds() { shortIds.fill(NO_SIGNAL); }
 
+    // Get the signal with identifier Id, or NO_SIGNAL.
+    SignalIdxTy find(string_view Id) const {
+        const auto r = sigIds.find(Id);
+        return r == sigIds.end() ? NO_SIGNAL : r->second;
+    }
+
+    // Get the signal with the single character identifier c, or NO_SIGNAL.
+    SignalIdxTy find(char c) const {
+        return (unsigned char)c < 128 ? shortIds[(unsigned char)c] : NO_SIGNAL;
+    }
+
+    void insert(string_view Id, SignalIdxTy Idx) {
+        sigIds.insert_or_assign(Id, Idx);
+        if (Id.size() == 1 && (unsigned char)Id[0] < 128)
+            shortIds[(unsigned char)Id[0]] = Idx;
+    }
+
+  private:
+    // The identifiers are views into the file content, which outlives the
+    // parsers. The single character identifiers, the most common ones, are
+    // also in shortIds.
+    unordered_map<string_view, SignalIdxTy> sigIds;
+    std::array<SignalIdxTy, 128> shortIds;
+};
+
+// The VCDHeaderParser class parses the VCD header, up to and including
+// $enddefinitions: it creates the selected scopes and signals in the Waveform,
+// and collects the signals' identifiers.
+class VCDHeaderParser : public VCDParserBase {
     // Scope kinds.
     enum class SK : uint8_t { MODULE, TASK, FUNCTION, BLOCK };
 
@@ -274,14 +476,23 @@ class VCDParserFull : public VCDParserBase {
     enum class VK : uint8_t { WIRE, REG, INTEGER };
 
   public:
-    VCDParserFull(Waveform &W, const string &Filename)
-        : VCDParserBase(Filename), w(W) {}
+    VCDHeaderParser(Waveform &W, VCDSignalIds &SigIds,
+                    const Waveform::Visitor::Options &Options,
+                    const string &Filename, string_view Content)
+        : VCDParserBase(Filename, Content), w(W), sigIds(SigIds),
+          options(Options) {}
 
     bool parse() {
-        vector<Waveform::Scope *> scopeStack;
-        unordered_map<string, SignalIdxTy> sigIds;
+        using FilterAction = Waveform::Visitor::FilterAction;
+        // The selected scopes, and if their signals are selected.
+        struct ScopeEntry {
+            Waveform::Scope *scope;
+            bool selectSignals;
+        };
+        vector<ScopeEntry> scopeStack;
+        // The number of nested scopes being skipped, which are not created.
+        size_t skippedScopes = 0;
 
-        // Parse the VCD header.
         bool in_vcd_header = true;
         while (in_vcd_header) {
             if (eof())
@@ -331,6 +542,11 @@ class VCDParserFull : public VCDParserBase {
                     if (!getNewScope(scopeKind, instance))
                         return reportError("unable to parse new scope");
 
+                    if (skippedScopes > 0) {
+                        skippedScopes += 1;
+                        break;
+                    }
+
                     string ScopeName(instance);
                     string fullScopeName;
                     Waveform::Scope *currentScope;
@@ -338,9 +554,16 @@ class VCDParserFull : public VCDParserBase {
                         fullScopeName = instance;
                         currentScope = w.getRootScope();
                     } else {
-                        fullScopeName = scopeStack.back()->getFullScopeName() +
-                                        '.' + instance;
-                        currentScope = scopeStack.back();
+                        fullScopeName =
+                            scopeStack.back().scope->getFullScopeName() + '.' +
+                            instance;
+                        currentScope = scopeStack.back().scope;
+                    }
+
+                    const FilterAction action = options.filter(fullScopeName);
+                    if (action == FilterAction::SKIP_ALL) {
+                        skippedScopes = 1;
+                        break;
                     }
 
                     Waveform::Scope *newScope;
@@ -366,58 +589,70 @@ class VCDParserFull : public VCDParserBase {
                             std::move(ScopeName));
                         break;
                     }
-                    scopeStack.push_back(newScope);
+                    scopeStack.push_back(
+                        {newScope, action == FilterAction::VISIT_ALL});
                     break;
                 }
                 case KW::UPSCOPE: {
                     if (!expect(KW::END))
                         return reportError(
                             "expecting $end when parsing $upscope");
-                    scopeStack.pop_back();
+                    if (skippedScopes > 0)
+                        skippedScopes -= 1;
+                    else
+                        scopeStack.pop_back();
                     break;
                 }
                 case KW::VAR: {
                     VK vk;
                     size_t bits;
-                    string id;
+                    string_view id;
                     string name;
                     if (!getVar(vk, bits, id, name))
                         return reportError("unable to parse var");
 
-                    const auto r = sigIds.find(id);
-                    if (r == sigIds.end()) {
+                    const SignalIdxTy existingIdx = sigIds.find(id);
+                    if (skippedScopes > 0 ||
+                        !scopeStack.back().selectSignals ||
+                        options.skip(getKind(vk))) {
+                        // The changes to an unselected signal are ignored,
+                        // unless it is aliased by a selected signal.
+                        if (existingIdx == VCDSignalIds::NO_SIGNAL)
+                            sigIds.insert(id, VCDSignalIds::SKIPPED);
+                        break;
+                    }
+
+                    Waveform::Scope &scope = *scopeStack.back().scope;
+                    if (existingIdx == VCDSignalIds::NO_SIGNAL ||
+                        existingIdx == VCDSignalIds::SKIPPED) {
                         // This is a new Signal.
                         SignalIdxTy idx;
                         switch (vk) {
                         case VK::WIRE:
-                            idx = w.addWire(*scopeStack.back(), std::move(name),
-                                            bits);
+                            idx = w.addWire(scope, std::move(name), bits);
                             break;
                         case VK::INTEGER:
-                            idx = w.addInteger(*scopeStack.back(),
-                                               std::move(name), bits);
+                            idx = w.addInteger(scope, std::move(name), bits);
                             break;
                         case VK::REG:
-                            idx = w.addRegister(*scopeStack.back(),
-                                                std::move(name), bits);
+                            idx = w.addRegister(scope, std::move(name), bits);
                             break;
                         }
-                        sigIds.insert(std::make_pair(id, idx));
+                        sigIds.insert(id, idx);
                     } else {
                         // This is an alias to an exiting Signal.
-                        SignalIdxTy idx = r->second;
                         switch (vk) {
                         case VK::WIRE:
-                            w.addWire(*scopeStack.back(), std::move(name), bits,
-                                      idx);
+                            w.addWire(scope, std::move(name), bits,
+                                      existingIdx);
                             break;
                         case VK::INTEGER:
-                            w.addInteger(*scopeStack.back(), std::move(name),
-                                         bits, idx);
+                            w.addInteger(scope, std::move(name), bits,
+                                         existingIdx);
                             break;
                         case VK::REG:
-                            w.addRegister(*scopeStack.back(), std::move(name),
-                                          bits, idx);
+                            w.addRegister(scope, std::move(name), bits,
+                                          existingIdx);
                             break;
                         }
                     }
@@ -443,98 +678,25 @@ class VCDParserFull : public VCDParserBase {
             }
         }
 
-        // Parse the VCD body.
-        size_t current_time;
-        enum {
-            IN_DUMPALL,
-            IN_DUMPVARS,
-            IN_DUMPOFF,
-            IN_DUMPON,
-            NOT_A_DUMP_SECTION
-        } section = NOT_A_DUMP_SECTION;
-        while (readline()) {
-            if (currentLine[offset] == '#') {
-                offset += 1;
-                if (!getInt(current_time))
-                    return reportError("error reading current time");
-            } else if (currentLine[offset] == '$') {
-                if (section == NOT_A_DUMP_SECTION) {
-                    KW kw;
-                    if (!getKeyword(kw))
-                        return reportError("error getting keyword");
-                    switch (kw) {
-                    default:
-                        return reportError("unexpected keyword in vcd body");
-                    case KW::COMMENT: {
-                        string drop;
-                        if (!getContent("comment", drop))
-                            return reportError(
-                                "unable to parse comment in VCD body");
-                        break;
-                    }
-                    case KW::DUMPALL:
-                        section = IN_DUMPALL;
-                        break;
-                    case KW::DUMPOFF:
-                        section = IN_DUMPOFF;
-                        break;
-                    case KW::DUMPON:
-                        section = IN_DUMPON;
-                        break;
-                    case KW::DUMPVARS:
-                        section = IN_DUMPVARS;
-                        // As we are in the value initialization section,
-                        // set simulation start time.
-                        w.setStartTime(current_time);
-                        break;
-                    }
-                } else {
-                    if (!expect(KW::END))
-                        return reportError(
-                            "expecting end keyword to dump section");
-                    section = NOT_A_DUMP_SECTION;
-                }
-            } else {
-                string sigId;
-                string sigValue;
-                if (currentLine[offset] == 'b') {
-                    offset += 1;
-                    if (!getWord(sigValue))
-                        return reportError("error reading bus value");
-                } else {
-                    sigValue = currentLine[offset];
-                    offset += 1;
-                    skipWS();
-                }
-                sigId = currentLine.substr(offset);
-                const auto r = sigIds.find(sigId);
-                if (r == sigIds.end())
-                    return reportError("unknown signal referenced");
-                w.addValueChange(r->second, current_time, sigValue);
-            }
-        }
-
-        // Set simulation end time.
-        w.setEndTime(current_time);
-
         return true;
     }
 
   private:
     Waveform &w;
-
-    bool expect(KW kw) {
-        size_t Offset_back = offset;
-        KW kw1;
-        if (!getKeyword(kw1))
-            return reportError("a keyword expected");
-
-        if (kw != kw1) {
-            offset = Offset_back;
-            return reportError("not the expected keyword");
+    VCDSignalIds &sigIds;
+    const Waveform::Visitor::Options &options;
+
+    static Waveform::SignalDesc::Kind getKind(VK vk) {
+        switch (vk) {
+        case VK::WIRE:
+            return Waveform::SignalDesc::Kind::WIRE;
+        case VK::REG:
+            return Waveform::SignalDesc::Kind::REGISTER;
+        case VK::INTEGER:
+            return Waveform::SignalDesc::Kind::INTEGER;
         }
 
-        return true;
+        DIE("Unhandled VCD variable kind");
     }
 
     bool getNewScope(SK &scopeKind, string &instance) {
@@ -560,7 +722,7 @@ class VCDParserFull : public VCDParserBase {
         return true;
     }
 
-    bool getVar(VK &vk, size_t &bits, string &id, string &name) {
+    bool getVar(VK &vk, size_t &bits, string_view &id, string &name) {
         string varTy;
         string bus;
         if (!getWord(varTy))
@@ -580,7 +742,8 @@ class VCDParserFull : public VCDParserBase {
             return reportError("error getting var id");
         if (!getWord(name))
             return reportError("error getting var name");
-        if ((bits > 1 && vk != VK::INTEGER) || currentLine[offset] == '[') {
+        if ((bits > 1 && vk != VK::INTEGER) ||
+            (!eol() && currentLine[offset] == '[')) {
             if (!getWord(bus))
                 return reportError("error getting var bus");
             name += " ";
@@ -592,72 +755,6 @@ class VCDParserFull : public VCDParserBase {
         return true;
     }
 
-    // A keyword is a word prefixed with the '$' symbol: $end, $scope, ...
-    bool getKeyword(KW &kw) {
-        kw = KW::UNKNOWN;
-        if (!VCDParserBase::expect('$'))
-            return reportError("expected keyword start '$' not found");
-
-        string w;
-        if (!getWord(w))
-            return reportError("can not read keyword");
-
-        if (w == "end")
-            kw = KW::END;
-        else if (w == "var")
-            kw = KW::VAR;
-        else if (w == "date")
-            kw = KW::DATE;
-        else if (w == "comment")
-            kw = KW::COMMENT;
-        else if (w == "version")
-            kw = KW::VERSION;
-        else if (w == "timescale")
-            kw = KW::TIMESCALE;
-        else if (w == "scope")
-            kw = KW::SCOPE;
-        else if (w == "upscope")
-            kw = KW::UPSCOPE;
-        else if (w == "enddefinitions")
-            kw = KW::ENDDEFINITIONS;
-        else if (w == "dumpall")
-            kw = KW::DUMPALL;
-        else if (w == "dumpvars")
-            kw = KW::DUMPVARS;
-        else if (w == "dumpoff")
-            kw = KW::DUMPOFF;
-        else if (w == "dumpon")
-            kw = KW::DUMPON;
-        else
-            kw = KW::UNKNOWN;
-        return kw != KW::UNKNOWN;
-    }
-
-    bool getContent(const string &field, string &data) {
-        if (eol()) {
-            // Content is spread on separate line(s).
-            do {
-                if (!readline())
-                    return reportError(string("could not get ") + field +
-                                       " line");
-                if (offset == 0 && currentLine.size() == 4 &&
-                    currentLine[0] == '$' && currentLine[1] == 'e' &&
-                    currentLine[2] == 'n' && currentLine[3] == 'd')
-                    return true;
-                data += currentLine.substr(offset);
-            } while (true);
-        } else {
-            const size_t LS = currentLine.size();
-            if (currentLine[LS - 4] == '$' && currentLine[LS - 3] == 'e' &&
-                currentLine[LS - 2] == 'n' && currentLine[LS - 1] == 'd') {
-                data = currentLine.substr(offset, LS - 5 - offset);
-                return true;
-            } else
-                return reportError(string("could not get $end in ") + field +
-                                   " single line");
-        }
-    }
-
     bool getTimescale(signed char &ts) {
         if (!readline())
             return reportError("could not get timescale line");
@@ -677,29 +774,497 @@ class VCDParserFull : public VCDParserBase {
     }
 };
 
+// The value changes found in a chunk of the VCD body. The body is cut in
+// chunks starting at a time line ("#123"), so that the chunks can be parsed
+// independently.
+// The WindowFilter class selects, from the time ordered changes of a signal,
+// the ones to keep: the changes inside the time windows, as well as the last
+// change before each window so that the signal value at the window start is
+// known.
+template <class ChangeTy> class WindowFilter {
+  public:
+    WindowFilter(const TimeWindows &TW) : windows(TW) {}
+
+    // Process change c, at time t, invoking keep(change) for each change to
+    // keep.
+    template <class KeepTy>
+    void operator()(TimeTy t, const ChangeTy &c, KeepTy &&keep) {
+        const size_t w = windows.find(t);
+        if (w < windows.size() && t >= windows[w].first) {
+            if (hasPending) {
+                keep(pending);
+                hasPending = false;
+            }
+            keep(c);
+            return;
+        }
+        // The pending change holds the value at the start of its window,
+        // unless c supersedes it.
+        if (hasPending && pendingWindow != w)
+            keep(pending);
+        hasPending = w < windows.size();
+        pending = c;
+        pendingWindow = w;
+    }
+
+    // Keep the pending change, if any.
+    template <class KeepTy> void finish(KeepTy &&keep) {
+        if (hasPending)
+            keep(pending);
+        hasPending = false;
+    }
+
+  private:
+    const TimeWindows &windows;
+    ChangeTy pending{};
+    size_t pendingWindow = 0;
+    bool hasPending = false;
+};
+
+struct VCDChunk {
+    struct Change {
+        TimeIdxTy time; // Index in times.
+        string_view value;
+    };
+
+    // The chunk, in the file content.
+    string_view content;
+    // The times with value changes, in order of appearance.
+    vector<TimeTy> times;
+    // The first and last times with value changes, including the changes to
+    // the unselected signals.
+    bool hasChanges = false;
+    TimeTy firstTime = 0;
+    TimeTy lastTime = 0;
+    // The value changes, grouped by signal and in file order: the changes
+    // of signal S are changes[offsets[S]] up to changes[offsets[S+1]-1].
+    vector<Change> changes;
+    vector<size_t> offsets;
+    // The number of lines in this chunk.
+    size_t numLines = 0;
+    // The parsing stopped at the end of the last time window.
+    bool truncated = false;
+    // A dump section ($dumpvars, ...) can span several chunks. The first
+    // dump section keyword of this chunk, if any, and the line it is on.
+    bool hasSectionKeyword = false;
+    bool startsInSection = false; // The first section keyword is an $end.
+    size_t firstSectionLine = 0;
+    bool endsInSection = false;
+    VCDParserBase::ErrorsTy errors;
+};
+
+// The VCDChunkParser class parses a chunk of the VCD body.
+class VCDChunkParser : public VCDParserBase {
+  public:
+    VCDChunkParser(VCDChunk &Chunk, const VCDSignalIds &SigIds,
+                   size_t NumSignals, const TimeWindows &Windows,
+                   const string &Filename, bool First)
+        : VCDParserBase(Filename, Chunk.content), chunk(Chunk),
+          sigIds(SigIds), numSignals(NumSignals), windows(Windows),
+          first(First) {
+        deferErrors(chunk.errors);
+    }
+
+    bool parse() {
+        const bool ok = parseChanges();
+        chunk.numLines = getLineNumber();
+        if (ok) {
+            groupBySignal();
+            if (!windows.empty())
+                filterWindows();
+        }
+        return ok;
+    }
+
+  private:
+    VCDChunk &chunk;
+    const VCDSignalIds &sigIds;
+    const size_t numSignals;
+    const TimeWindows &windows;
+    const bool first; // Is this the first chunk of the body ?
+
+    struct SignalChange {
+        SignalIdxTy signal;
+        VCDChunk::Change change;
+    };
+    vector<SignalChange> signalChanges;
+
+    // The time of the value changes being parsed. It is only added to the
+    // chunk times once a change occurs at this time.
+    size_t currentTime = 0;
+    bool currentTimeAdded = false;
+
+    void addValueChange(SignalIdxTy idx, string_view value) {
+        if (!chunk.hasChanges) {
+            chunk.hasChanges = true;
+            chunk.firstTime = currentTime;
+        }
+        chunk.lastTime = currentTime;
+        if (idx == VCDSignalIds::SKIPPED)
+            return;
+        if (!currentTimeAdded) {
+            chunk.times.push_back(currentTime);
+            currentTimeAdded = true;
+        }
+        signalChanges.push_back(
+            {idx, {TimeIdxTy(chunk.times.size() - 1), value}});
+    }
+
+    bool parseChanges() {
+        enum {
+            IN_DUMPALL,
+            IN_DUMPVARS,
+            IN_DUMPOFF,
+            IN_DUMPON,
+            NOT_A_DUMP_SECTION
+        } section = NOT_A_DUMP_SECTION;
+        while (readline()) {
+            if (eol())
+                continue;
+            const char c = currentLine[offset];
+            // The fast paths: time changes ("#123") and scalar value changes
+            // ("0!"), with a single character signal identifier.
+            if (c == '#') {
+                offset += 1;
+                size_t time;
+                if (!getInt(time))
+                    return reportError("error reading current time");
+                if (!windows.empty() && time >= windows.getEndTime()) {
+                    chunk.truncated = true;
+                    break;
+                }
+                if (time != currentTime) {
+                    currentTime = time;
+                    currentTimeAdded = false;
+                }
+                continue;
+            }
+            if (currentLine.size() == offset + 2) {
+                const SignalIdxTy idx = sigIds.find(currentLine[offset + 1]);
+                if (idx != VCDSignalIds::NO_SIGNAL && c != '$' && c != 'b' &&
+                    c != 'B' && c != 'r' && c != 'R') {
+                    addValueChange(idx, currentLine.substr(offset, 1));
+                    continue;
+                }
+            }
+            if (c == '$') {
+                if (section == NOT_A_DUMP_SECTION) {
+                    KW kw;
+                    if (!getKeyword(kw))
+                        return reportError("error getting keyword");
+                    switch (kw) {
+                    default:
+                        return reportError("unexpected keyword in vcd body");
+                    case KW::COMMENT: {
+                        string drop;
+                        if (!getContent("comment", drop))
+                            return reportError(
+                                "unable to parse comment in VCD body");
+                        break;
+                    }
+                    case KW::DUMPALL:
+                        section = IN_DUMPALL;
+                        break;
+                    case KW::DUMPOFF:
+                        section = IN_DUMPOFF;
+                        break;
+                    case KW::DUMPON:
+                        section = IN_DUMPON;
+                        break;
+                    case KW::DUMPVARS:
+                        section = IN_DUMPVARS;
+                        break;
+                    case KW::END:
+                        // This can only close a dump section started in a
+                        // previous chunk.
+                        if (first || chunk.hasSectionKeyword)
+                            return reportError(
+                                "unexpected keyword in vcd body");
+                        chunk.startsInSection = true;
+                        break;
+                    }
+                    if (kw != KW::COMMENT && !chunk.hasSectionKeyword) {
+                        chunk.hasSectionKeyword = true;
+                        chunk.firstSectionLine = getLineNumber();
+                    }
+                } else {
+                    if (!expect(KW::END))
+                        return reportError(
+                            "expecting end keyword to dump section");
+                    section = NOT_A_DUMP_SECTION;
+                }
+            } else {
+                string_view sigValue;
+                if (c == 'b') {
+                    offset += 1;
+                    if (!getWord(sigValue))
+                        return reportError("error reading bus value");
+                } else {
+                    sigValue = currentLine.substr(offset, 1);
+                    offset += 1;
+                    skipWS();
+                }
+                string_view sigId = currentLine.substr(offset);
+                while (!sigId.empty() &&
+                       (sigId.back() == ' ' || sigId.back() == '\t' ||
+                        sigId.back() == '\r'))
+                    sigId.remove_suffix(1);
+                const SignalIdxTy idx = sigIds.find(sigId);
+                if (idx == VCDSignalIds::NO_SIGNAL)
+                    return reportError("unknown signal referenced");
+                addValueChange(idx, sigValue);
+            }
+        }
+
+        chunk.endsInSection = section != NOT_A_DUMP_SECTION;
+
+        return true;
+    }
+
+    // Sort the changes by signal (a stable counting sort), so that each
+    // signal can later be stitched independently from the others.
+    void groupBySignal() {
+        chunk.offsets.assign(numSignals + 1, 0);
+        for (const auto &sc : signalChanges)
+            chunk.offsets[sc.signal + 1] += 1;
+        for (size_t s = 0; s < numSignals; s++)
+            chunk.offsets[s + 1] += chunk.offsets[s];
+        chunk.changes.resize(signalChanges.size());
+        vector<size_t> next(chunk.offsets.begin(), chunk.offsets.end() - 1);
+        for (const auto &sc : signalChanges)
+            chunk.changes[next[sc.signal]++] = sc.change;
+        vector<SignalChange>().swap(signalChanges);
+    }
+
+    // Only keep the changes relevant to the time windows, as well as the
+    // times they use. This is done locally to the chunk: the changes kept
+    // here may still be superseded by a later chunk.
+    void filterWindows() {
+        size_t out = 0;
+        for (size_t s = 0; s < numSignals; s++) {
+            const size_t b = chunk.offsets[s];
+            const size_t e = chunk.offsets[s + 1];
+            chunk.offsets[s] = out;
+            WindowFilter<VCDChunk::Change> filter(windows);
+            const auto keep = [&](const VCDChunk::Change &c) {
+                chunk.changes[out++] = c;
+            };
+            for (size_t c = b; c < e; c++)
+                filter(chunk.times[chunk.changes[c].time], chunk.changes[c],
+                       keep);
+            filter.finish(keep);
+        }
+        chunk.offsets[numSignals] = out;
+        chunk.changes.resize(out);
+
+        vector<bool> used(chunk.times.size(), false);
+        for (const auto &c : chunk.changes)
+            used[c.time] = true;
+        vector<TimeIdxTy> timeIdx(chunk.times.size(), 0);
+        size_t numTimes = 0;
+        for (size_t t = 0; t < chunk.times.size(); t++)
+            if (used[t]) {
+                chunk.times[numTimes] = chunk.times[t];
+                timeIdx[t] = numTimes++;
+            }
+        chunk.times.resize(numTimes);
+        for (auto &c : chunk.changes)
+            c.time = timeIdx[c.time];
+    }
+};
+
+// Cut the VCD body in (at most) numChunks chunks of similar sizes, and of at
+// least minChunkSize bytes. All chunks but the first start with a time line
+// ("#123"): no line spans two chunks, and each chunk knows the time of its
+// value changes.
+vector<VCDChunk> splitBody(string_view body, size_t numChunks,
+                           size_t minChunkSize) {
+    const size_t maxChunks = body.size() / std::max<size_t>(1, minChunkSize);
+    numChunks = std::max<size_t>(1, std::min(numChunks, maxChunks));
+    vector<size_t> starts(1, 0);
+    for (size_t i = 1; i < numChunks; i++) {
+        size_t pos = std::max(starts.back() + 1, i * body.size() / numChunks);
+        // Look for the next line starting with '#' and a digit.
+        while (true) {
+            pos = body.find("\n#", pos - 1);
+            if (pos == string_view::npos)
+                break;
+            pos += 2;
+            if (pos < body.size() && body[pos] >= '0' && body[pos] <= '9')
+                break;
+        }
+        if (pos == string_view::npos)
+            break;
+        starts.push_back(pos - 1);
+    }
+    starts.push_back(body.size());
+
+    vector<VCDChunk> chunks(starts.size() - 1);
+    for (size_t i = 0; i < chunks.size(); i++)
+        chunks[i].content = body.substr(starts[i], starts[i + 1] - starts[i]);
+    return chunks;
+}
+
+// Get the time a chunk (but the first one) starts at, from its leading time
+// line.
+TimeTy getChunkTime(const VCDChunk &chunk) {
+    TimeTy t = 0;
+    for (size_t i = 1; i < chunk.content.size(); i++) {
+        const char c = chunk.content[i];
+        if (c < '0' || c > '9')
+            break;
+        t = t * 10 + (c - '0');
+    }
+    return t;
+}
+
+// Check that the dump sections are balanced across the chunks, and report an
+// error (as VCDChunkParser would have done on the whole body) if not.
+bool checkSections(const vector<VCDChunk> &chunks, const string &Filename,
+                   size_t firstLine) {
+    bool inSection = false;
+    size_t line = firstLine;
+    for (const auto &chunk : chunks) {
+        if (chunk.hasSectionKeyword) {
+            if (chunk.startsInSection != inSection) {
+                VCDParserBase::reportError(
+                    Filename, line + chunk.firstSectionLine,
+                    inSection ? "expecting end keyword to dump section"
+                              : "unexpected keyword in vcd body");
+                return false;
+            }
+            inSection = chunk.endsInSection;
+        }
+        line += chunk.numLines;
+    }
+    return true;
+}
+
 } // namespace
 
 vector<TimeTy> VCDWaveFile::getAllChangesTimes() {
-    return VCDParserQuick(fileName).parse();
+    const VCDFile F(fileName);
+    return VCDParserQuick(fileName, F.getContent()).parse();
 }
 
-bool VCDWaveFile::read(Waveform &W) {
-    VCDParserFull P(W, fileName);
+bool VCDWaveFile::read(Waveform &W, const Waveform::Visitor::Options &options,
+                       const TimeWindows &windows) {
+    const VCDFile F(fileName);
+    const string_view content = F.getContent();
 
-    if (!P.parse())
+    VCDSignalIds sigIds;
+    VCDHeaderParser HP(W, sigIds, options, fileName, content);
+    if (!HP.parse())
         DIE("Error parsing input VCD file '", fileName, "'");
 
+    // Parse the body chunks concurrently.
+    const size_t numSignals = W.getNumSignals();
+    vector<VCDChunk> chunks = splitBody(
+        content.substr(HP.getPosition()),
+        numChunks != 0 ? numChunks : PAF::ThreadPool::get().size(),
+        minChunkSize);
+    // The chunks starting after the last time window are not even parsed.
+    // The earlier chunks still have to be parsed, to get the signals' value
+    // at the windows start.
+    bool truncated = false;
+    if (!windows.empty())
+        for (size_t i = 1; i < chunks.size(); i++)
+            if (getChunkTime(chunks[i]) >= windows.getEndTime()) {
+                chunks.resize(i);
+                truncated = true;
+                break;
+            }
+    PAF::parallelFor(0, chunks.size(), 1, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; i++)
+            VCDChunkParser(chunks[i], sigIds, numSignals, windows, fileName,
+                           i == 0)
+                .parse();
+    });
+
+    // Report the first error, if any, now that the line numbers are known.
+    size_t line = HP.getLineNumber();
+    for (const auto &chunk : chunks) {
+        if (!chunk.errors.empty()) {
+            for (const auto &error : chunk.errors)
+                VCDParserBase::reportError(fileName, line + error.first,
+                                           error.second);
+            DIE("Error parsing input VCD file '", fileName, "'");
+        }
+        line += chunk.numLines;
+    }
+    if (!checkSections(chunks, fileName, HP.getLineNumber()))
+        DIE("Error parsing input VCD file '", fileName, "'");
+
+    // Stitch the chunks: their times go, in order, in the Waveform's times,
+    // then each signal gets its changes from all chunks, in order. The
+    // signals are independent from each other, so they are stitched
+    // concurrently.
+    vector<vector<TimeIdxTy>> timeIdx(chunks.size());
+    for (size_t i = 0; i < chunks.size(); i++)
+        timeIdx[i] = W.indexTimes(chunks[i].times);
+    PAF::parallelFor(0, numSignals, 64, [&](size_t b, size_t e) {
+        for (size_t s = b; s < e; s++) {
+            Signal &S = W[s];
+            if (windows.empty()) {
+                for (size_t i = 0; i < chunks.size(); i++) {
+                    const VCDChunk &chunk = chunks[i];
+                    for (size_t c = chunk.offsets[s];
+                         c < chunk.offsets[s + 1]; c++)
+                        S.append(timeIdx[i][chunk.changes[c].time],
+                                 chunk.changes[c].value);
+                }
+                continue;
+            }
+            // With time windows, the changes kept by a chunk may be
+            // superseded by a later chunk: filter them again, with the time
+            // indexes in the Waveform.
+            WindowFilter<VCDChunk::Change> filter(windows);
+            const auto keep = [&](const VCDChunk::Change &c) {
+                S.append(c.time, c.value);
+            };
+            for (size_t i = 0; i < chunks.size(); i++) {
+                const VCDChunk &chunk = chunks[i];
+                for (size_t c = chunk.offsets[s]; c < chunk.offsets[s + 1];
+                     c++) {
+                    const VCDChunk::Change &change = chunk.changes[c];
+                    filter(chunk.times[change.time],
+                           {timeIdx[i][change.time], change.value}, keep);
+                }
+            }
+            filter.finish(keep);
+        }
+    });
+
+    // The start and end times account for the unselected signals too.
     W.setStartTime();
     W.setEndTime();
+    const bool hasTimes = W.timesBegin() != W.timesEnd();
+    for (const auto &chunk : chunks)
+        if (chunk.hasChanges) {
+            if (!hasTimes || chunk.firstTime < W.getStartTime())
+                W.setStartTime(chunk.firstTime);
+            break;
+        }
+    for (auto chunk = chunks.rbegin(); chunk != chunks.rend(); chunk++)
+        if (chunk->hasChanges) {
+            if (!hasTimes || chunk->lastTime > W.getEndTime())
+                W.setEndTime(chunk->lastTime);
+            break;
+        }
 
-    return true;
-}
+    // With time windows, the start and end times are limited to the windows.
+    // The parsing might have stopped before the end of the file, in which
+    // case the end time is the end of the last window.
+    if (!windows.empty()) {
+        for (const auto &chunk : chunks)
+            truncated |= chunk.truncated;
+        W.setStartTime(std::max(W.getStartTime(), windows.getBeginTime()));
+        W.setEndTime(truncated
+                         ? windows.getEndTime()
+                         : std::min(W.getEndTime(), windows.getEndTime()));
+    }
 
-Waveform VCDWaveFile::read() {
-    Waveform W(fileName, 0, 0, 0);
-    if (!VCDWaveFile::read(W))
-        DIE("error reading '%s", fileName.c_str());
-    return W;
+    return true;
 }
 
 namespace {
@@ -0,0 +1,417 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/WAN/WaveCache.h"
+#include "PAF/Error.h"
+#include "PAF/WAN/Signal.h"
+#include "PAF/WAN/WaveFile.h"
+#include "PAF/WAN/Waveform.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::ofstream;
+using std::ostream;
+using std::string;
+using std::vector;
+
+namespace {
+// The cache file header.
+constexpr char MAGIC[8] = "PAFWAVE";
+constexpr uint64_t VERSION = 2;
+// Files saved on a host with a different byte order are not valid caches.
+constexpr uint64_t BYTE_ORDER_MARK = 0x0102030405060708ULL;
+// All items in the cache file are aligned on this boundary.
+constexpr size_t ALIGN = 8;
+
+// Get filename's size and modification time.
+bool getFileId(const string &filename, uint64_t &size, uint64_t &mtime) {
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0)
+        return false;
+    size = uint64_t(st.st_size);
+    mtime = uint64_t(st.st_mtime);
+    return true;
+}
+} // namespace
+
+namespace PAF::WAN {
+
+// The Writer class emits the cache file items, padded to ALIGN bytes.
+class WaveCache::Writer {
+  public:
+    Writer(ostream &os) : os(os) {}
+
+    void u64(uint64_t v) { os.write(reinterpret_cast<const char *>(&v), 8); }
+
+    void str(const string &s) {
+        u64(s.size());
+        bytes(s.data(), s.size());
+    }
+
+    template <class Ty, class Alloc> void array(const vector<Ty, Alloc> &v) {
+        u64(v.size());
+        bytes(v.data(), v.size() * sizeof(Ty));
+    }
+
+  private:
+    ostream &os;
+
+    void bytes(const void *p, size_t n) {
+        static const char zeros[ALIGN] = {};
+        os.write(static_cast<const char *>(p), n);
+        os.write(zeros, (ALIGN - n % ALIGN) % ALIGN);
+    }
+};
+
+// The Reader class reads the cache file items from the mapped cache file,
+// checking that they lie within the file.
+class WaveCache::Reader {
+  public:
+    Reader(const char *buffer, size_t size) : cur(buffer), end(buffer + size) {}
+
+    [[nodiscard]] bool atEnd() const { return cur == end; }
+
+    bool u64(uint64_t &v) {
+        const char *p = take(8);
+        if (p == nullptr)
+            return false;
+        std::memcpy(&v, p, 8);
+        return true;
+    }
+
+    bool str(string &s) {
+        uint64_t n;
+        if (!u64(n))
+            return false;
+        const char *p = take(n);
+        if (p == nullptr)
+            return false;
+        s.assign(p, n);
+        return true;
+    }
+
+    template <class Ty, class Alloc> bool array(vector<Ty, Alloc> &v) {
+        uint64_t n;
+        if (!u64(n) || n > size_t(end - cur) / sizeof(Ty))
+            return false;
+        const char *p = take(n * sizeof(Ty));
+        if (p == nullptr)
+            return false;
+        v.resize(n);
+        if (n != 0)
+            std::memcpy(v.data(), p, n * sizeof(Ty));
+        return true;
+    }
+
+  private:
+    const char *cur;
+    const char *end;
+
+    // Consume n bytes, and the padding after them.
+    const char *take(uint64_t n) {
+        const uint64_t padded = (n + ALIGN - 1) / ALIGN * ALIGN;
+        if (n > padded || padded > uint64_t(end - cur))
+            return nullptr;
+        const char *p = cur;
+        cur += padded;
+        return p;
+    }
+};
+
+string WaveCache::getKey(const Waveform::Visitor::Options &options,
+                         const TimeWindows &windows) const {
+    uint64_t size, mtime;
+    if (!getFileId(waveFilename, size, mtime))
+        return "";
+
+    std::ostringstream os;
+    Writer Wr(os);
+    Wr.u64(size);
+    Wr.u64(mtime);
+    Wr.u64(options.skip(Waveform::SignalDesc::Kind::REGISTER));
+    Wr.u64(options.skip(Waveform::SignalDesc::Kind::WIRE));
+    Wr.u64(options.skip(Waveform::SignalDesc::Kind::INTEGER));
+    Wr.u64(options.getScopeFilters().size());
+    for (const auto &filter : options.getScopeFilters())
+        Wr.str(filter);
+    Wr.u64(windows.size());
+    for (const auto &w : windows) {
+        Wr.u64(w.first);
+        Wr.u64(w.second);
+    }
+    return os.str();
+}
+
+string WaveCache::getCacheFilename(const string &waveFilename) {
+    return waveFilename + ".paf-wave";
+}
+
+void WaveCache::saveScope(Writer &Wr, const Waveform::Scope &S) {
+    Wr.u64(S.signals.size());
+    for (const auto &s : S.signals) {
+        Wr.str(s->getName());
+        Wr.u64(uint64_t(s->getKind()));
+        Wr.u64(s->isAlias());
+        Wr.u64(s->getIdx());
+    }
+    Wr.u64(S.subScopes.size());
+    for (const auto &s : S.subScopes) {
+        Wr.u64(uint64_t(s->kind));
+        Wr.str(s->instanceName);
+        Wr.str(s->fullScopeName);
+        Wr.str(s->scopeName);
+        saveScope(Wr, *s.get());
+    }
+}
+
+bool WaveCache::loadScope(Reader &Rd, Waveform::Scope &S, size_t numSignals) {
+    uint64_t n;
+    if (!Rd.u64(n))
+        return false;
+    for (uint64_t i = 0; i < n; i++) {
+        string name;
+        uint64_t kind, alias, idx;
+        if (!Rd.str(name) || !Rd.u64(kind) || !Rd.u64(alias) ||
+            !Rd.u64(idx) ||
+            kind > uint64_t(Waveform::SignalDesc::Kind::INTEGER) ||
+            idx >= numSignals)
+            return false;
+        S.addSignal(std::move(name), Waveform::SignalDesc::Kind(kind),
+                    alias != 0, SignalIdxTy(idx));
+    }
+
+    if (!Rd.u64(n))
+        return false;
+    for (uint64_t i = 0; i < n; i++) {
+        string instanceName, fullScopeName, scopeName;
+        uint64_t kind;
+        if (!Rd.u64(kind) || !Rd.str(instanceName) || !Rd.str(fullScopeName) ||
+            !Rd.str(scopeName) ||
+            kind > uint64_t(Waveform::Scope::Kind::BLOCK))
+            return false;
+        Waveform::Scope &Sub = S.addScope(
+            std::move(instanceName), std::move(fullScopeName),
+            std::move(scopeName), Waveform::Scope::Kind(kind));
+        if (!loadScope(Rd, Sub, numSignals))
+            return false;
+    }
+
+    return true;
+}
+
+bool WaveCache::save(const Waveform &W,
+                     const Waveform::Visitor::Options &options,
+                     const TimeWindows &windows) {
+    const string key = getKey(options, windows);
+    if (key.empty()) {
+        errstr = "Can not stat the waveform file";
+        return false;
+    }
+
+    // Write to a temporary file first, so that tools running concurrently
+    // never see a partially written cache.
+    const string tmpFilename = filename + ".tmp." + std::to_string(getpid());
+    {
+        ofstream os(tmpFilename, ofstream::binary);
+        if (!os) {
+            errstr = "Can not create the waveform cache file";
+            return false;
+        }
+        Writer Wr(os);
+        os.write(MAGIC, sizeof(MAGIC));
+        Wr.u64(VERSION);
+        Wr.u64(BYTE_ORDER_MARK);
+        Wr.str(key);
+
+        Wr.str(W.fileName);
+        Wr.str(W.version);
+        Wr.str(W.date);
+        Wr.str(W.comment);
+        Wr.u64(W.startTime);
+        Wr.u64(W.endTime);
+        Wr.u64(uint64_t(W.timeZero));
+        Wr.u64(uint64_t(int64_t(W.timeScale)));
+        Wr.array(W.allTimes);
+
+        Wr.u64(W.signals.size());
+        for (const auto &s : W.signals) {
+            Wr.u64(s->numBits);
+            Wr.u64(s->zxDense);
+            Wr.array(s->timeIdx.headers);
+            Wr.array(s->timeIdx.words);
+            Wr.array(s->timeIdx.tail);
+            Wr.array(s->value);
+            Wr.array(s->zx);
+        }
+
+        saveScope(Wr, W.root);
+
+        if (!os) {
+            std::remove(tmpFilename.c_str());
+            errstr = "Error writing the waveform cache file";
+            return false;
+        }
+    }
+
+    if (std::rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+        std::remove(tmpFilename.c_str());
+        errstr = "Can not rename the waveform cache file";
+        return false;
+    }
+
+    return true;
+}
+
+bool WaveCache::load(Waveform &W, const Waveform::Visitor::Options &options,
+                     const TimeWindows &windows) {
+    const string key = getKey(options, windows);
+    if (key.empty())
+        return false;
+
+    // Map the cache file.
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false; // No cache yet.
+    struct stat st;
+    void *p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return false;
+    const size_t fileSize = st.st_size;
+    const std::unique_ptr<void, std::function<void(void *)>> mapping(
+        p, [fileSize](void *p) { munmap(p, fileSize); });
+    const char *buffer = static_cast<const char *>(p);
+
+    // Check the header and the key: a cache for another version of the
+    // waveform file, or for another selection, is not an error, it will be
+    // overwritten.
+    if (fileSize < sizeof(MAGIC) ||
+        std::memcmp(buffer, MAGIC, sizeof(MAGIC)) != 0)
+        return false;
+    Reader Rd(buffer + sizeof(MAGIC), fileSize - sizeof(MAGIC));
+    uint64_t version, byteOrder;
+    string fileKey;
+    if (!Rd.u64(version) || version != VERSION || !Rd.u64(byteOrder) ||
+        byteOrder != BYTE_ORDER_MARK || !Rd.str(fileKey) || fileKey != key)
+        return false;
+
+    Waveform CW;
+    uint64_t startTime, endTime, timeZero, timeScale;
+    if (!Rd.str(CW.fileName) || !Rd.str(CW.version) || !Rd.str(CW.date) ||
+        !Rd.str(CW.comment) || !Rd.u64(startTime) || !Rd.u64(endTime) ||
+        !Rd.u64(timeZero) || !Rd.u64(timeScale) || !Rd.array(CW.allTimes)) {
+        errstr = "Malformed waveform cache header";
+        return false;
+    }
+    CW.startTime = startTime;
+    CW.endTime = endTime;
+    CW.timeZero = int64_t(timeZero);
+    CW.timeScale = static_cast<signed char>(int64_t(timeScale));
+
+    uint64_t numSignals;
+    if (!Rd.u64(numSignals)) {
+        errstr = "Malformed waveform cache signals";
+        return false;
+    }
+    CW.signals.reserve(numSignals);
+    for (uint64_t i = 0; i < numSignals; i++) {
+        uint64_t numBits, zxDense;
+        if (!Rd.u64(numBits) || !Rd.u64(zxDense)) {
+            errstr = "Malformed waveform cache signal";
+            return false;
+        }
+        CW.signals.emplace_back(new Signal(CW.allTimes, numBits));
+        Signal &S = *CW.signals.back();
+        S.zxDense = zxDense != 0;
+        if (!Rd.array(S.timeIdx.headers) || !Rd.array(S.timeIdx.words) ||
+            !Rd.array(S.timeIdx.tail) || !S.timeIdx.isWellFormed() ||
+            !Rd.array(S.value) || !Rd.array(S.zx) ||
+            S.value.size() !=
+                (S.timeIdx.size() * numBits + Signal::WORD_BITS - 1) /
+                    Signal::WORD_BITS ||
+            (S.zxDense && S.zx.size() != S.value.size())) {
+            errstr = "Malformed waveform cache signal";
+            return false;
+        }
+        for (const TimeIdxTy t : S.timeIdx)
+            if (t >= CW.allTimes.size()) {
+                errstr = "Malformed waveform cache signal";
+                return false;
+            }
+    }
+
+    if (!loadScope(Rd, CW.root, numSignals) || !Rd.atEnd()) {
+        errstr = "Malformed waveform cache scopes";
+        return false;
+    }
+
+    W = std::move(CW);
+    return true;
+}
+
+namespace {
+Waveform readWaveFile(const string &filename,
+                      const Waveform::Visitor::Options &options,
+                      const TimeWindows &windows) {
+    const std::unique_ptr<WaveFile> wf =
+        WaveFile::get(filename, /* write: */ false);
+    if (!wf)
+        DIE("Unsupported waveform file format for '", filename, "'");
+    return wf->read(options, windows);
+}
+} // namespace
+
+Waveform WaveCache::read(const Waveform::Visitor::Options &options,
+                         const TimeWindows &windows) {
+    Waveform W;
+    if (load(W, options, windows))
+        return W;
+
+    W = readWaveFile(waveFilename, options, windows);
+    save(W, options, windows);
+    return W;
+}
+
+Waveform readWaveform(const string &filename, bool useCache,
+                      const Waveform::Visitor::Options &options,
+                      const TimeWindows &windows) {
+    if (!useCache)
+        return readWaveFile(filename, options, windows);
+    return WaveCache(filename).read(options, windows);
+}
+
+} // namespace PAF::WAN
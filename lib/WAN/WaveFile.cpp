@@ -26,18 +26,49 @@
 #include "PAF/WAN/FSTWaveFile.h"
 #endif
 
+#include <algorithm>
 #include <memory>
 #include <set>
 
 using std::set;
 using std::string;
 using std::unique_ptr;
+using std::vector;
 
 namespace PAF::WAN {
 
+TimeWindows &TimeWindows::add(TimeTy begin, TimeTy end) {
+    if (begin >= end)
+        DIE("Empty time window [", begin, ", ", end, ")");
+    if (!windows.empty() && begin < windows.back().second)
+        DIE("Time window [", begin, ", ", end,
+            ") overlaps or precedes the previous one");
+    windows.emplace_back(begin, end);
+    return *this;
+}
+
+size_t TimeWindows::find(TimeTy t) const {
+    const auto it =
+        std::upper_bound(windows.begin(), windows.end(), t,
+                         [](TimeTy t, const Window &w) { return t < w.second; });
+    return it - windows.begin();
+}
+
 WaveFile::~WaveFile() = default;
 
 // Guess the file format by looking at the file suffix.
+bool WriteOptions::getCompression(std::string_view level, Compression &c) {
+    if (level == "fast")
+        c = Compression::FAST;
+    else if (level == "balanced")
+        c = Compression::BALANCED;
+    else if (level == "small")
+        c = Compression::SMALL;
+    else
+        return false;
+    return true;
+}
+
 WaveFile::FileFormat WaveFile::getFileFormat(std::string_view filename) {
     auto pos = filename.find_last_of('.');
     if (pos == std::string_view::npos)
@@ -70,14 +101,24 @@ unique_ptr<WaveFile> WaveFile::get(std::string_view filename, bool write) {
     return F;
 }
 
-Waveform WaveFile::read() {
+std::pair<TimeTy, TimeTy> WaveFile::getTimeRange() {
+    const vector<TimeTy> times = getAllChangesTimes();
+    if (times.empty())
+        return {0, 0};
+    return {times.front(), times.back()};
+}
+
+Waveform WaveFile::read(const Waveform::Visitor::Options &options,
+                        const TimeWindows &windows) {
     Waveform W(fileName, 0, 0, 0);
-    if (!read(W))
+    if (!read(W, options, windows))
         DIE("error reading '%s", fileName.c_str());
     return W;
 }
 
-Waveform readAndMerge(const std::vector<std::string> &files) {
+Waveform readAndMerge(const std::vector<std::string> &files,
+                      const Waveform::Visitor::Options &options,
+                      const TimeWindows &windows) {
     if (files.empty())
         return {};
 
@@ -93,10 +134,24 @@ Waveform readAndMerge(const std::vector<std::string> &files) {
     Waveform WMain(files[0], 0, 0, 0);
     WMain.addTimes(AllTimes.begin(), AllTimes.end());
     for (const auto &f : files)
-        if (!WaveFile::get(f, /* write: */ false)->read(WMain))
+        if (!WaveFile::get(f, /* write: */ false)->read(WMain, options, windows))
             DIE("error reading '%s", f.c_str());
 
     return WMain;
 }
 
+void streamMerge(const vector<string> &files, const string &output,
+                 size_t numSlices, const WriteOptions &writeOptions) {
+    if (WaveFile::getFileFormat(output) != WaveFile::FileFormat::FST)
+        DIE("the streaming merge output '", output, "' must be an fst file");
+#ifdef HAS_GTKWAVE_FST
+    FSTWaveFile F(output, /* write: */ true);
+    F.setWriteOptions(writeOptions);
+    if (!F.writeMerged(files, numSlices))
+        DIE("error saving waveform to '", output, "'");
+#else
+    DIE("can not write '", output, "': FST support was not built.");
+#endif
+}
+
 } // namespace PAF::WAN
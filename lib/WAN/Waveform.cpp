@@ -20,13 +20,18 @@
 
 #include "PAF/WAN/Waveform.h"
 #include "PAF/WAN/Signal.h"
+#include "PAF/utils/Parallel.h"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <string>
+#include <vector>
 
 using std::string;
+using std::vector;
 
 namespace PAF::WAN {
 
@@ -36,13 +41,12 @@ void Waveform::SignalDesc::dump(std::ostream &os) const {
 }
 
 Waveform::Visitor::FilterAction
-Waveform::Visitor::Options::filter(const Waveform::Scope &scope) const {
+Waveform::Visitor::Options::filter(const string &fullScopeName) const {
     using FilterAction = Waveform::Visitor::FilterAction;
     // If there is no filter at all, just visit that scope !
     if (scopeFilters.empty())
         return FilterAction::VISIT_ALL;
 
-    const string &fullScopeName = scope.getFullScopeName();
     // Reject all scopes unless one of the filter matches.
     for (const auto &filter : scopeFilters) {
         if (filter.size() == fullScopeName.size()) {
@@ -102,6 +106,20 @@ void Waveform::dumpMetadata(std::ostream &os) const {
     os << "Timescale: " << ts << '\n';
 }
 
+void Waveform::sample(uint64_t *dst, const vector<SignalIdxTy> &signals,
+                      const vector<TimeTy> &times, Signal::SampleKind kind,
+                      unsigned numThreads) const {
+    const size_t numTimes = times.size();
+    PAF::parallelFor(
+        0, signals.size(), 1,
+        [&](size_t b, size_t e) {
+            for (size_t s = b; s < e; s++)
+                (*this)[signals[s]].sample(&dst[s * numTimes], times.data(),
+                                           numTimes, kind);
+        },
+        numThreads);
+}
+
 void WaveformStatistics::enterScope(const Waveform::Scope &scope) {
     scopesMemSize += scope.getObjectSize();
 }
@@ -112,29 +130,60 @@ void WaveformStatistics::leaveScope() {
 
 void WaveformStatistics::visitSignal(const std::string &fullScopeName,
                                      const Waveform::SignalDesc &SD) {
-    SignalIdxTy idx = SD.getIdx();
-    if (aliases.count(idx) > 0) {
+    const SignalIdxTy idx = SD.getIdx();
+    if (seen[idx]) {
         numAliases += 1;
         return;
     }
+    seen[idx] = true;
+    signals.push_back(idx);
+}
 
+WaveformStatistics::SignalsStatistics
+WaveformStatistics::getSignalsStatistics(unsigned numThreads) const {
     assert(w && "Waveform pointer must not be null");
-    const Signal &S = (*w)[idx];
-    numSignals += 1;
-    numChanges += S.getNumChanges();
-    timingsMemSize += S.getNumChanges() * sizeof(WAN::TimeIdxTy);
-    signalsMemSize += S.getObjectSize();
-    aliases.insert(idx);
+    const size_t threads =
+        numThreads != 0 ? numThreads : PAF::ThreadPool::get().size();
+    const size_t grain =
+        std::max<size_t>(1, (signals.size() + threads - 1) / threads);
+    return PAF::parallelReduce(
+        0, signals.size(), grain, SignalsStatistics(),
+        [&](size_t b, size_t e) {
+            SignalsStatistics partial;
+            for (size_t i = b; i < e; i++) {
+                const Signal &S = (*w)[signals[i]];
+                partial.numChanges += S.getNumChanges();
+                partial.numHighZOrUnknown += S.hasHighZOrUnknown() ? 1 : 0;
+                partial.timingsMemSize += S.getTimingsSize();
+                partial.signalsMemSize += S.getObjectSize();
+                if (!fast)
+                    for (const unsigned d : S.getHamming().distance)
+                        partial.numToggles += d;
+            }
+            return partial;
+        },
+        [](SignalsStatistics acc, const SignalsStatistics &partial) {
+            acc += partial;
+            return acc;
+        },
+        numThreads);
 }
 
 void WaveformStatistics::dump(std::ostream &out) const {
     const size_t OneMB = 1024 * 1024;
 
     assert(w && "Waveform pointer must not be null");
+    const SignalsStatistics stats = getSignalsStatistics();
+    const size_t &signalsMemSize = stats.signalsMemSize;
+    const size_t &timingsMemSize = stats.timingsMemSize;
     out << "Statistics " << "for " << w->getFileName() << ":\n";
-    out << " - number of Signals: " << numSignals << '\n';
+    out << " - number of Signals: " << signals.size() << '\n';
     out << " - number of aliases: " << numAliases << '\n';
-    out << " - number of changes: " << numChanges << '\n';
+    out << " - number of changes: " << stats.numChanges << '\n';
+    if (!fast)
+        out << " - number of bit toggles: " << stats.numToggles << '\n';
+    out << " - number of Signals with Z or X values: "
+        << stats.numHighZOrUnknown << '\n';
     out << " - signals memory consumption: ";
     if (signalsMemSize >= OneMB)
         out << double(signalsMemSize) / double(OneMB) << " MB";
@@ -0,0 +1,430 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+// The paf python module exposes the NPArray, the SCA kernels and accumulators
+// and the waveform sampling to python, exchanging numpy arrays without
+// copying them:
+//  - the traces passed to the kernels and accumulators are viewed in place,
+//    whatever their memory layout, as long as their element type is one of
+//    float64, float32, int16 or uint16 (traces of another type are converted
+//    to float64),
+//  - the arrays computed by the kernels are handed over to numpy, which
+//    releases them once they are no longer referenced,
+//  - the NPArray classes implement the buffer protocol, so numpy.asarray
+//    gives a view on their elements.
+//
+// The GIL is released while the kernels run.
+
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/SCA.h"
+#include "PAF/WAN/Signal.h"
+#include "PAF/WAN/WaveFile.h"
+#include "PAF/WAN/Waveform.h"
+
+#include "libtarmac/reporter.hh"
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace py = pybind11;
+
+using PAF::SCA::Classification;
+using PAF::SCA::CorrelAccumulator;
+using PAF::SCA::NPArray;
+using PAF::SCA::NPArrayView;
+using PAF::SCA::TTestAccumulator;
+using PAF::WAN::Signal;
+using PAF::WAN::SignalIdxTy;
+using PAF::WAN::TimeTy;
+using PAF::WAN::WaveFile;
+using PAF::WAN::Waveform;
+
+using std::string;
+using std::vector;
+
+std::unique_ptr<Reporter> reporter = make_cli_reporter();
+
+namespace {
+
+// The numpy arrays of traces. Arrays of another element type are converted.
+template <class Ty> using TracesTy = py::array_t<Ty, py::array::forcecast>;
+
+// Get a view on the 1D (a single trace) or 2D (a trace per row) numpy array
+// a, without copying it.
+template <class Ty> NPArrayView<Ty> view(const TracesTy<Ty> &a) {
+    if (a.ndim() != 1 && a.ndim() != 2)
+        throw py::value_error("expecting a 1D or a 2D array");
+    const bool single = a.ndim() == 1;
+    const py::ssize_t strides[2] = {single ? 0 : a.strides(0),
+                                    a.strides(single ? 0 : 1)};
+    for (const py::ssize_t s : strides)
+        if (s < 0 || s % py::ssize_t(sizeof(Ty)) != 0)
+            throw py::value_error("unsupported array strides, use "
+                                  "numpy.ascontiguousarray first");
+    return NPArrayView<Ty>(a.data(), single ? 1 : a.shape(0),
+                           a.shape(single ? 0 : 1), strides[0] / sizeof(Ty),
+                           strides[1] / sizeof(Ty));
+}
+
+// Check that samples [b, e( are in the traces of v.
+template <class Ty>
+void checkSamples(size_t b, size_t e, const NPArrayView<Ty> &v) {
+    if (b > e || e > v.cols())
+        throw py::index_error("sample range out of the traces");
+}
+
+// Get the classification of the traces from the integers in a: 0 for group
+// 0, 1 for group 1, and anything else for the ignored traces.
+vector<Classification> classification(const py::array &a) {
+    const py::array_t<int, py::array::c_style | py::array::forcecast> c(a);
+    if (c.ndim() != 1)
+        throw py::value_error("expecting a 1D classifier");
+    vector<Classification> classifier(c.size());
+    for (py::ssize_t i = 0; i < c.size(); i++)
+        classifier[i] = c.data()[i] == 0   ? Classification::GROUP_0
+                        : c.data()[i] == 1 ? Classification::GROUP_1
+                                           : Classification::IGNORE;
+    return classifier;
+}
+
+// Get the intermediate values in a, with a row per hypothesis and a column
+// per trace, or a single hypothesis if a is 1D.
+NPArray<double> intermediateValues(const py::array &a) {
+    const py::array_t<double, py::array::c_style | py::array::forcecast> iv(a);
+    if (iv.ndim() != 1 && iv.ndim() != 2)
+        throw py::value_error("expecting 1D or 2D intermediate values");
+    return NPArray<double>(iv.data(), iv.ndim() == 1 ? 1 : iv.shape(0),
+                           iv.shape(iv.ndim() - 1));
+}
+
+// Hand the elements of a over to a numpy array, without copying them.
+template <class Ty> py::array_t<Ty> toNumpy(NPArray<Ty> &&a) {
+    auto *owner = new NPArray<Ty>(std::move(a));
+    const py::capsule base(
+        owner, [](void *p) { delete static_cast<NPArray<Ty> *>(p); });
+    return py::array_t<Ty>({owner->rows(), owner->cols()},
+                           owner->empty() ? nullptr : &(*owner)(0, 0), base);
+}
+
+// Run kernel f without holding the GIL, and return its result to numpy.
+template <class Kernel> py::array_t<double> compute(Kernel &&f) {
+    NPArray<double> result;
+    {
+        const py::gil_scoped_release nogil;
+        result = f();
+    }
+    return toNumpy(std::move(result));
+}
+
+// Raise a python exception if o is not in a good state.
+template <class Ty> Ty checked(Ty &&o) {
+    if (!o.good())
+        throw std::runtime_error(o.error());
+    return std::forward<Ty>(o);
+}
+
+template <class Ty>
+void bindNPArray(py::module_ &m, const string &suffix) {
+    py::class_<NPArray<Ty>>(m, ("NPArray" + suffix).c_str(),
+                            py::buffer_protocol())
+        .def(py::init([](const string &filename) {
+                 return checked(NPArray<Ty>(filename));
+             }),
+             "Load the NPArray from file filename.", py::arg("filename"))
+        .def(py::init([](const TracesTy<Ty> &a) {
+                 return NPArray<Ty>(view(a));
+             }),
+             "Copy the numpy array a.", py::arg("a"))
+        .def_property_readonly("rows",
+                               [](const NPArray<Ty> &a) { return a.rows(); })
+        .def_property_readonly("cols",
+                               [](const NPArray<Ty> &a) { return a.cols(); })
+        .def(
+            "save",
+            [](const NPArray<Ty> &a, const string &filename) {
+                if (!a.save(filename))
+                    throw std::runtime_error("failed to save to " + filename);
+            },
+            "Save to file filename.", py::arg("filename"))
+        .def_buffer([](NPArray<Ty> &a) {
+            return py::buffer_info(a.empty() ? nullptr : &a(0, 0), sizeof(Ty),
+                                   py::format_descriptor<Ty>::format(), 2,
+                                   {a.rows(), a.cols()},
+                                   {sizeof(Ty) * a.cols(), sizeof(Ty)});
+        });
+}
+
+template <class Ty> void bindKernels(py::module_ &m) {
+    m.def(
+        "t_test",
+        [](size_t b, size_t e, const TracesTy<Ty> &traces,
+           const py::array &classifier, unsigned order) {
+            const NPArrayView<Ty> v = view(traces);
+            checkSamples(b, e, v);
+            const vector<Classification> c = classification(classifier);
+            if (c.size() < v.rows())
+                throw py::value_error("not enough classifications");
+            if (order == 0)
+                throw py::value_error("t-test order can not be 0");
+            return compute([&]() {
+                return order == 1 ? PAF::SCA::t_test(b, e, v, c)
+                                  : PAF::SCA::t_test(b, e, order, v, c);
+            });
+        },
+        "Compute the t-test of order order, from sample b to e, on traces "
+        "classified by classifier (0: group 0, 1: group 1, else ignored).",
+        py::arg("b"), py::arg("e"), py::arg("traces"), py::arg("classifier"),
+        py::arg("order") = 1);
+    m.def(
+        "t_test_groups",
+        [](size_t b, size_t e, const TracesTy<Ty> &group0,
+           const TracesTy<Ty> &group1) {
+            const NPArrayView<Ty> g0 = view(group0);
+            const NPArrayView<Ty> g1 = view(group1);
+            checkSamples(b, e, g0);
+            checkSamples(b, e, g1);
+            return compute([&]() { return PAF::SCA::t_test(b, e, g0, g1); });
+        },
+        "Compute Welsh's t-test, from sample b to e, between the traces of "
+        "group0 and group1.",
+        py::arg("b"), py::arg("e"), py::arg("group0"), py::arg("group1"));
+    m.def(
+        "perfect_t_test",
+        [](size_t b, size_t e, const TracesTy<Ty> &traces,
+           const py::array &classifier) {
+            const NPArrayView<Ty> v = view(traces);
+            checkSamples(b, e, v);
+            const vector<Classification> c = classification(classifier);
+            if (c.size() < v.rows())
+                throw py::value_error("not enough classifications");
+            return compute(
+                [&]() { return PAF::SCA::perfect_t_test(b, e, v, c); });
+        },
+        "Compute the perfect t-test, for noiseless traces, from sample b to "
+        "e, on traces classified by classifier.",
+        py::arg("b"), py::arg("e"), py::arg("traces"), py::arg("classifier"));
+    m.def(
+        "perfect_t_test_groups",
+        [](size_t b, size_t e, const TracesTy<Ty> &group0,
+           const TracesTy<Ty> &group1) {
+            const NPArrayView<Ty> g0 = view(group0);
+            const NPArrayView<Ty> g1 = view(group1);
+            checkSamples(b, e, g0);
+            checkSamples(b, e, g1);
+            return compute(
+                [&]() { return PAF::SCA::perfect_t_test(b, e, g0, g1); });
+        },
+        "Compute the perfect t-test, for noiseless traces, from sample b to "
+        "e, between the traces of group0 and group1.",
+        py::arg("b"), py::arg("e"), py::arg("group0"), py::arg("group1"));
+    m.def(
+        "correl",
+        [](size_t b, size_t e, const TracesTy<Ty> &traces,
+           const py::array &ival) {
+            const NPArrayView<Ty> v = view(traces);
+            checkSamples(b, e, v);
+            const NPArray<double> iv = intermediateValues(ival);
+            if (iv.cols() < v.rows())
+                throw py::value_error("not enough intermediate values");
+            return compute([&]() { return PAF::SCA::correl(b, e, v, iv); });
+        },
+        "Compute the Pearson correlation, from sample b to e, of traces with "
+        "the intermediate values ival (a row per hypothesis).",
+        py::arg("b"), py::arg("e"), py::arg("traces"), py::arg("ival"));
+}
+
+template <class Ty>
+void bindAccumulators(py::module_ &m, const string &suffix) {
+    using TTestAcc = TTestAccumulator<Ty>;
+    py::class_<TTestAcc>(m, ("TTestAccumulator" + suffix).c_str())
+        .def(py::init<size_t>(), py::arg("num_samples"))
+        .def(py::init([](const string &filename) {
+                 return checked(TTestAcc(filename));
+             }),
+             py::arg("filename"))
+        .def_property_readonly("samples", &TTestAcc::samples)
+        .def(
+            "count",
+            [](const TTestAcc &a, unsigned group) {
+                return a.count(group == 0 ? Classification::GROUP_0
+                                          : Classification::GROUP_1);
+            },
+            py::arg("group"))
+        .def(
+            "add",
+            [](TTestAcc &a, const TracesTy<Ty> &traces,
+               const py::array &classifier, size_t first_trace) {
+                const NPArrayView<Ty> v = view(traces);
+                const vector<Classification> c = classification(classifier);
+                if (v.cols() != a.samples())
+                    throw py::value_error("unexpected number of samples");
+                if (c.size() < first_trace + v.rows())
+                    throw py::value_error("not enough classifications");
+                const py::gil_scoped_release nogil;
+                a.add(v, c, first_trace);
+            },
+            py::arg("traces"), py::arg("classifier"),
+            py::arg("first_trace") = 0)
+        .def("merge", &TTestAcc::merge, py::arg("other"))
+        .def("t_test",
+             [](const TTestAcc &a) {
+                 return compute([&]() { return a.t_test(); });
+             })
+        .def(
+            "save",
+            [](const TTestAcc &a, const string &filename) {
+                if (!a.save(filename))
+                    throw std::runtime_error("failed to save to " + filename);
+            },
+            py::arg("filename"));
+
+    using CorrelAcc = CorrelAccumulator<Ty>;
+    py::class_<CorrelAcc>(m, ("CorrelAccumulator" + suffix).c_str())
+        .def(py::init<size_t, size_t>(), py::arg("num_samples"),
+             py::arg("num_hypotheses") = 1)
+        .def(py::init([](const string &filename) {
+                 return checked(CorrelAcc(filename));
+             }),
+             py::arg("filename"))
+        .def_property_readonly("samples", &CorrelAcc::samples)
+        .def_property_readonly("hypotheses", &CorrelAcc::hypotheses)
+        .def_property_readonly("count", &CorrelAcc::count)
+        .def(
+            "add",
+            [](CorrelAcc &a, const TracesTy<Ty> &traces, const py::array &ival,
+               size_t first_trace) {
+                const NPArrayView<Ty> v = view(traces);
+                const NPArray<double> iv = intermediateValues(ival);
+                if (v.cols() != a.samples())
+                    throw py::value_error("unexpected number of samples");
+                if (iv.rows() != a.hypotheses())
+                    throw py::value_error("unexpected number of hypotheses");
+                if (iv.cols() < first_trace + v.rows())
+                    throw py::value_error("not enough intermediate values");
+                const py::gil_scoped_release nogil;
+                a.add(v, iv, first_trace);
+            },
+            py::arg("traces"), py::arg("ival"), py::arg("first_trace") = 0)
+        .def("merge", &CorrelAcc::merge, py::arg("other"))
+        .def("correl",
+             [](const CorrelAcc &a) {
+                 return compute([&]() { return a.correl(); });
+             })
+        .def(
+            "save",
+            [](const CorrelAcc &a, const string &filename) {
+                if (!a.save(filename))
+                    throw std::runtime_error("failed to save to " + filename);
+            },
+            py::arg("filename"));
+}
+
+template <class Ty> void bindAll(py::module_ &m, const string &suffix) {
+    bindNPArray<Ty>(m, suffix);
+    bindKernels<Ty>(m);
+    bindAccumulators<Ty>(m, suffix);
+}
+
+void bindWaveform(py::module_ &m) {
+    py::enum_<Signal::SampleKind>(m, "SampleKind")
+        .value("VALUE", Signal::SampleKind::VALUE)
+        .value("HAMMING_WEIGHT", Signal::SampleKind::HAMMING_WEIGHT)
+        .value("HAMMING_DISTANCE", Signal::SampleKind::HAMMING_DISTANCE);
+
+    py::class_<Waveform>(m, "Waveform")
+        .def(py::init([](const string &filename) {
+                 std::unique_ptr<WaveFile> f = WaveFile::get(filename, false);
+                 if (!f)
+                     throw std::runtime_error("unsupported waveform file " +
+                                              filename);
+                 const py::gil_scoped_release nogil;
+                 return f->read();
+             }),
+             "Load the waveform from file filename.", py::arg("filename"))
+        .def_property_readonly("num_signals", &Waveform::getNumSignals)
+        .def_property_readonly("start_time", &Waveform::getStartTime)
+        .def_property_readonly("end_time", &Waveform::getEndTime)
+        .def(
+            "times",
+            [](const Waveform &W) {
+                vector<TimeTy> times(W.timesBegin(), W.timesEnd());
+                return py::array_t<TimeTy>(times.size(), times.data());
+            },
+            "Get the times of all the changes.")
+        .def(
+            "find_signal",
+            [](const Waveform &W, const string &scope,
+               const string &name) -> py::object {
+                const auto [found, idx] = W.findSignalIdx(scope, name);
+                if (!found)
+                    return py::none();
+                return py::int_(idx);
+            },
+            "Get the index of signal name in scope, or None.",
+            py::arg("scope"), py::arg("name"))
+        .def(
+            "sample",
+            [](const Waveform &W, const vector<SignalIdxTy> &signals,
+               const py::array_t<TimeTy, py::array::c_style |
+                                             py::array::forcecast> &times,
+               Signal::SampleKind kind, unsigned num_threads) {
+                if (times.ndim() != 1)
+                    throw py::value_error("expecting 1D times");
+                for (const SignalIdxTy s : signals)
+                    if (s >= W.getNumSignals())
+                        throw py::index_error("no such signal");
+                const vector<TimeTy> t(times.data(),
+                                       times.data() + times.size());
+                for (size_t i = 1; i < t.size(); i++)
+                    if (t[i] < t[i - 1])
+                        throw py::value_error("times must not decrease");
+                py::array_t<uint64_t> result({signals.size(), t.size()});
+                uint64_t *dst = result.mutable_data();
+                {
+                    const py::gil_scoped_release nogil;
+                    W.sample(dst, signals, t, kind, num_threads);
+                }
+                return result;
+            },
+            "Sample signals at times, with a row per signal.",
+            py::arg("signals"), py::arg("times"),
+            py::arg("kind") = Signal::SampleKind::VALUE,
+            py::arg("num_threads") = 0);
+}
+
+} // namespace
+
+PYBIND11_MODULE(paf, m) {
+    m.doc() = "PAF, the Physical Attack Framework.";
+
+    bindAll<double>(m, "Float64");
+    bindAll<float>(m, "Float32");
+    bindAll<int16_t>(m, "Int16");
+    bindAll<uint16_t>(m, "UInt16");
+    bindWaveform(m);
+}
@@ -20,6 +20,7 @@
 
 #include "PAF/ArchInfo.h"
 #include "PAF/PAF.h"
+#include "PAF/utils/Stats.h"
 
 #include "libtarmac/argparse.hh"
 #include "libtarmac/index_ds.hh"
@@ -27,88 +28,169 @@
 #include "libtarmac/reporter.hh"
 #include "libtarmac/tarmacutil.hh"
 
+#include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <libtarmac/index.hh>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 using std::cout;
+using std::make_unique;
 using std::ostream;
 using std::string;
 using std::unique_ptr;
+using std::unordered_map;
+using std::unordered_set;
 using std::vector;
 
 using PAF::ArchInfo;
 using PAF::ExecutionRange;
-using PAF::FromTraceBuilder;
 using PAF::InstrInfo;
+using PAF::InstrInfoCache;
 using PAF::MTAnalyzer;
+using PAF::ParallelTraceBuilder;
 using PAF::ReferenceInstruction;
 using PAF::ReferenceInstructionBuilder;
+using PAF::ScopedTimer;
+using PAF::Stats;
 
 unique_ptr<Reporter> reporter = make_cli_reporter();
 
 namespace {
+
+// The key of a check: the memory attributes are static properties of an
+// instruction, so they only need to be validated once per instruction (pc and
+// encoding) and kind of memory accesses it performed.
+struct CheckKey {
+    Addr pc;
+    uint32_t instruction;
+    bool reads;
+    bool writes;
+
+    bool operator==(const CheckKey &RHS) const {
+        return pc == RHS.pc && instruction == RHS.instruction &&
+               reads == RHS.reads && writes == RHS.writes;
+    }
+
+    struct Hash {
+        size_t operator()(const CheckKey &K) const {
+            return std::hash<uint64_t>()(
+                (K.pc * 0x9e3779b97f4a7c15ULL) ^
+                (uint64_t(K.instruction) << 2 | (K.reads ? 2 : 0) |
+                 (K.writes ? 1 : 0)));
+        }
+    };
+};
+
+// The checks of an execution range. The errors are buffered, so that the
+// ranges can be checked concurrently and their errors reported in order.
+class RangeChecker {
+  public:
+    struct Error {
+        CheckKey key;
+        string msg;
+    };
+
+    RangeChecker(InstrInfoCache &IICache) : IICache(IICache) {}
+
+    void operator()(const ReferenceInstruction &I) {
+        instructions += 1;
+        if (I.memAccess.empty())
+            return;
+
+        CheckKey key{I.pc, I.instruction, false, false};
+        for (const auto &ma : I.memAccess) {
+            if (ma.access == PAF::Access::Type::READ)
+                key.reads = true;
+            if (ma.access == PAF::Access::Type::WRITE)
+                key.writes = true;
+        }
+        if (!checked.insert(key).second)
+            return;
+
+        const InstrInfo &II = IICache.get(I);
+        if (key.reads && !II.isLoad())
+            reportError(key, I,
+                        "reads from memory but is not marked as 'Load'");
+        if (key.writes && !II.isStore())
+            reportError(key, I,
+                        "writes to memory but is not marked as 'Store'");
+        if (!II.isMemoryAccess())
+            reportError(key, I,
+                        "accesses memory but is not marked as 'MemoryAccess'");
+        // TODO: check branches and calls
+    }
+
+    [[nodiscard]] const vector<Error> &getErrors() const { return errors; }
+    [[nodiscard]] size_t getNumInstructions() const { return instructions; }
+
+  private:
+    InstrInfoCache &IICache;
+    unordered_set<CheckKey, CheckKey::Hash> checked;
+    vector<Error> errors;
+    size_t instructions = 0;
+
+    void reportError(const CheckKey &key, const ReferenceInstruction &I,
+                     const char *msg) {
+        std::ostringstream os;
+        os << "At time " << I.time << ", instruction '" << I.disassembly
+           << "' (0x" << std::hex << I.instruction << std::dec << ") " << msg;
+        errors.push_back({key, os.str()});
+    }
+};
+
 class AttributeChecker : public MTAnalyzer {
   public:
     AttributeChecker(const AttributeChecker &) = delete;
     AttributeChecker(const IndexNavigator &IN)
         : MTAnalyzer(IN), cpu(PAF::getCPU(IN.index)) {}
 
-    void check(const ExecutionRange &ER) {
-        struct ACCont {
-            MTAnalyzer &analyzer;
-            ArchInfo &cpu;
-            unsigned errors = 0;
-            unsigned instructions = 0;
-
-            ACCont(MTAnalyzer &MTA, ArchInfo &CPU) : analyzer(MTA), cpu(CPU) {}
+    // Check the ranges in ERS, using up to numJobs threads, reporting the
+    // errors to os in order. An error is reported only once per instruction
+    // and kind of memory accesses, at its first occurrence.
+    void check(const vector<ExecutionRange> &ERS, const TracePair &trace,
+               unsigned numJobs, ostream &os) {
+        // Each thread gets its own decode cache, reused for all the ranges it
+        // checks.
+        std::mutex mtx;
+        unordered_map<std::thread::id, unique_ptr<InstrInfoCache>> caches;
+        vector<unique_ptr<RangeChecker>> checkers(ERS.size());
 
-            void reportError(const ReferenceInstruction &I, const char *msg) {
-                errors += 1;
-                cout << "At time " << I.time << ", instruction '"
-                     << I.disassembly << "' (0x" << std::hex << I.instruction
-                     << std::dec << ") " << msg << '\n';
+        ParallelTraceBuilder<ReferenceInstruction, ReferenceInstructionBuilder,
+                             RangeChecker>
+            PTB([&]() { return make_unique<IndexNavigator>(trace, ""); },
+                numJobs);
+        PTB.build(ERS, [&](size_t i) -> RangeChecker & {
+            InstrInfoCache *IICache;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                auto &C = caches[std::this_thread::get_id()];
+                if (!C)
+                    C = make_unique<InstrInfoCache>(*cpu);
+                IICache = C.get();
             }
+            checkers[i] = make_unique<RangeChecker>(*IICache);
+            return *checkers[i];
+        });
 
-            void operator()(ReferenceInstruction &I) {
-                instructions += 1;
-                const InstrInfo II = cpu.getInstrInfo(I);
-                // Check attributes here.
-                if (!I.memAccess.empty()) {
-                    bool hasReadAccess = false;
-                    bool hasWriteAccess = false;
-                    for (const auto &ma : I.memAccess) {
-                        if (ma.access == PAF::Access::Type::READ)
-                            hasReadAccess = true;
-                        if (ma.access == PAF::Access::Type::WRITE)
-                            hasWriteAccess = true;
-                    }
-                    if (hasReadAccess && !II.isLoad())
-                        reportError(
-                            I, "reads from memory but is not marked as 'Load'");
-                    if (hasWriteAccess && !II.isStore())
-                        reportError(
-                            I, "writes to memory but is not marked as 'Store'");
-                    if ((hasReadAccess || hasWriteAccess) &&
-                        !II.isMemoryAccess())
-                        reportError(I, "accesses memory but is not marked as "
-                                       "'MemoryAccess'");
-                    // TODO: check branches and calls
-                }
+        unordered_map<CheckKey, size_t, CheckKey::Hash> reported;
+        for (size_t i = 0; i < checkers.size(); i++) {
+            for (const auto &E : checkers[i]->getErrors()) {
+                if (reported.emplace(E.key, i).first->second != i)
+                    continue;
+                errorCnt += 1;
+                os << E.msg << '\n';
             }
-        };
-
-        ACCont ACC(*this, *cpu.get());
-        FromTraceBuilder<ReferenceInstruction, ReferenceInstructionBuilder,
-                         ACCont>
-            FTB(indexNavigator);
-        FTB.build(ER, ACC);
-
-        errorCnt += ACC.errors;
-        instCnt += ACC.instructions;
+            instCnt += checkers[i]->getNumInstructions();
+        }
     }
 
     size_t errors() const { return errorCnt; }
@@ -123,15 +205,23 @@ class AttributeChecker : public MTAnalyzer {
 
 int main(int argc, char **argv) {
     string FunctionName;
+    unsigned NumJobs = PAF::defaultNumThreads(1);
 
     Argparse ap("paf-check-attributes", argc, argv);
     ap.optval({"--function"}, "FUNCTION",
               "Only analyze the portion of the trace in FUNCTION",
               [&](const string &s) { FunctionName = s; });
+    ap.optval({"-j", "--jobs"}, "N",
+              "check up to N execution ranges concurrently (default: "
+              "$PAF_NUM_THREADS, or 1; 0 uses as many threads as the "
+              "hardware supports)",
+              [&](const string &s) { NumJobs = stoul(s, nullptr, 0); });
     TarmacUtility tu;
     tu.add_options(ap);
 
+    Stats::addOptions(ap);
     ap.parse();
+    const ScopedTimer T("paf-check-attributes");
     tu.setup();
 
     if (tu.is_verbose())
@@ -156,8 +246,7 @@ int main(int argc, char **argv) {
         Ranges.emplace_back(SOPStart, SOPEnd);
     }
 
-    for (const auto &R : Ranges)
-        AC.check(R);
+    AC.check(Ranges, tu.trace, NumJobs, cout);
 
     if (tu.is_verbose())
         cout << "Checked " << AC.instructions()
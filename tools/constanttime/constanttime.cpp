@@ -18,49 +18,65 @@
  * This file is part of PAF, the Physical Attack Framework.
  */
 
+#include "PAF/AnalysisCache.h"
+#include "PAF/CompactTrace.h"
 #include "PAF/PAF.h"
+#include "PAF/utils/Stats.h"
 
 #include "libtarmac/argparse.hh"
 #include "libtarmac/calltree.hh"
 #include "libtarmac/reporter.hh"
 #include "libtarmac/tarmacutil.hh"
 
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
 #include <vector>
 
 using std::cout;
+using std::make_unique;
 using std::ostream;
+using std::ostringstream;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 
+using PAF::AnalysisCache;
+using PAF::CompactInstruction;
+using PAF::CompactMemoryAccess;
+using PAF::CompactTrace;
 using PAF::ExecutionRange;
 using PAF::FromTraceBuilder;
 using PAF::MemoryAccess;
 using PAF::MTAnalyzer;
+using PAF::ParallelTraceBuilder;
 using PAF::ReferenceInstruction;
 using PAF::ReferenceInstructionBuilder;
+using PAF::ScopedTimer;
+using PAF::Stats;
 
 namespace {
 
-class ReferenceTrace : public vector<ReferenceInstruction> {
+// The reference trace is held in its compact form, as it is kept in memory
+// during the whole analysis.
+class ReferenceTrace : public CompactTrace {
   public:
     ReferenceTrace() {}
 
-    void operator()(const ReferenceInstruction &I) { this->push_back(I); }
-
     void dump(ostream &os) {
         for (const auto &I : *this) {
             os << I.time;
             os << '\t';
             os << (I.executed() ? 'X' : '-');
             os << '\t';
-            os << I.disassembly;
+            os << disassembly(I);
             os << '\t';
-            for (const MemoryAccess &M : I.memAccess) {
+            for (const CompactMemoryAccess &M : I.memAccess) {
                 os << ' ';
-                M.dump(os);
+                M.get().dump(os);
             }
             os << '\n';
         }
@@ -71,10 +87,10 @@ class TraceComparator {
   public:
     TraceComparator() = delete;
     TraceComparator(const TraceComparator &) = delete;
-    TraceComparator(const ReferenceTrace &Ref,
+    TraceComparator(const ReferenceTrace &Ref, ostream &os,
                     bool IgnoreConditionalExecutionDifferences,
                     bool IgnoreMemoryAccessDifferences)
-        : ref(Ref), instr(0), errors(0),
+        : ref(Ref), os(os), instr(0), errors(0),
           ignoreConditionalExecutionDifferences(
               IgnoreConditionalExecutionDifferences),
           ignoreMemoryAccessDifferences(IgnoreMemoryAccessDifferences),
@@ -88,7 +104,7 @@ class TraceComparator {
 
         if (!controlFlowDivergence && !cmpRI(ref[instr], I)) {
             errors++;
-            dumpDiff(cout, ref[instr], I);
+            dumpDiff(os, ref.get(instr), I);
         }
         instr++;
     }
@@ -97,23 +113,23 @@ class TraceComparator {
 
   private:
     const ReferenceTrace &ref;
+    ostream &os;     // Where to report the differences
     unsigned instr;  // The current instruction
     unsigned errors; // Error count
     const bool ignoreConditionalExecutionDifferences;
     const bool ignoreMemoryAccessDifferences;
     bool controlFlowDivergence;
 
-    bool cmpRI(const ReferenceInstruction &I, const ReferenceInstruction &O) {
-        if (I.pc == O.pc && I.iset == O.iset && I.width == O.width &&
-            I.instruction == O.instruction) {
+    bool cmpRI(const CompactInstruction &I, const ReferenceInstruction &O) {
+        if (I.sameStatic(O)) {
             if (!ignoreConditionalExecutionDifferences)
-                if (I.effect != O.effect)
+                if (InstructionEffect(I.effect) != O.effect)
                     return false;
             if (!ignoreMemoryAccessDifferences) {
                 if (I.memAccess.size() != O.memAccess.size())
                     return false;
                 for (unsigned i = 0; i < I.memAccess.size(); i++)
-                    if (I.memAccess[i] != O.memAccess[i])
+                    if (I.memAccess[i].get() != O.memAccess[i])
                         return false;
             }
             return true;
@@ -134,6 +150,151 @@ class TraceComparator {
     }
 };
 
+// The fingerprint of a reference instruction, for the streaming mode: its
+// static values and effect, and a hash of its memory accesses (addresses,
+// sizes and directions, like MemoryAccess::operator==). The disassembly and
+// the register accesses are not kept.
+struct InstructionFingerprint {
+    Time time;
+    uint64_t memHash;
+    Addr pc;
+    uint32_t instruction;
+    uint8_t width;
+    uint8_t effect;
+    uint8_t iset;
+
+    InstructionFingerprint(const ReferenceInstruction &I)
+        : time(I.time), memHash(hash(I.memAccess)), pc(I.pc),
+          instruction(I.instruction), width(uint8_t(I.width)),
+          effect(uint8_t(I.effect)), iset(uint8_t(I.iset)) {}
+
+    [[nodiscard]] bool sameStatic(const ReferenceInstruction &I) const {
+        return pc == I.pc && ISet(iset) == I.iset && width == I.width &&
+               instruction == I.instruction;
+    }
+
+    void dump(ostream &os) const {
+        os << "Time:" << time;
+        os << " Executed:" << (InstructionEffect(effect) == IE_EXECUTED);
+        os << " PC:0x" << std::hex << pc << std::dec;
+        os << " ISet:" << unsigned(iset);
+        os << " Width:" << unsigned(width);
+        os << " Instruction:0x" << std::hex << instruction << std::dec;
+    }
+
+    // A 64-bit FNV-1a hash of the memory accesses, folding their number in.
+    static uint64_t hash(const vector<MemoryAccess> &MA) {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        const auto add = [&h](uint64_t v) {
+            for (unsigned i = 0; i < 8; i++) {
+                h ^= (v >> (8 * i)) & 0xff;
+                h *= 0x100000001b3ULL;
+            }
+        };
+        add(MA.size());
+        for (const MemoryAccess &M : MA) {
+            add(M.addr);
+            add(M.size);
+            add(uint64_t(M.access));
+        }
+        return h;
+    }
+};
+
+// The reference trace reduced to its instructions' fingerprints. The
+// instructions can be dumped as they are added, as they are not kept.
+class ReferenceFingerprints : public vector<InstructionFingerprint> {
+  public:
+    explicit ReferenceFingerprints(ostream *os = nullptr) : os(os) {}
+
+    void operator()(const ReferenceInstruction &I) {
+        emplace_back(I);
+        if (os == nullptr)
+            return;
+        *os << I.time << '\t' << (I.executed() ? 'X' : '-') << '\t'
+            << I.disassembly << '\t';
+        for (const MemoryAccess &M : I.memAccess) {
+            *os << ' ';
+            M.dump(*os);
+        }
+        *os << '\n';
+    }
+
+  private:
+    ostream *os;
+};
+
+// Compare an instance to the reference fingerprints. Only the number of
+// differences and the first one are recorded, so that many instances can be
+// checked with little memory.
+class FingerprintComparator {
+  public:
+    FingerprintComparator() = delete;
+    FingerprintComparator(const FingerprintComparator &) = delete;
+    FingerprintComparator(const ReferenceFingerprints &Ref,
+                          bool IgnoreConditionalExecutionDifferences,
+                          bool IgnoreMemoryAccessDifferences)
+        : ref(Ref), ignoreConditionalExecutionDifferences(
+                        IgnoreConditionalExecutionDifferences),
+          ignoreMemoryAccessDifferences(IgnoreMemoryAccessDifferences) {}
+
+    void operator()(const ReferenceInstruction &I) {
+        if (instr >= ref.size()) {
+            errors++;
+            return;
+        }
+
+        if (!controlFlowDivergence && !matches(ref[instr], I)) {
+            if (errors == 0) {
+                first = make_unique<ReferenceInstruction>(I);
+                firstInstr = instr;
+            }
+            errors++;
+        }
+        instr++;
+    }
+
+    [[nodiscard]] bool hasErrors() const { return errors != 0; }
+
+    void report(ostream &os) const {
+        if (errors == 0)
+            return;
+        os << "   o " << errors << " difference(s)";
+        if (first) {
+            os << ", the first one being:\n     ";
+            ref[firstInstr].dump(os);
+            os << " (reference)\n     ";
+            first->dump(os);
+        }
+        os << '\n';
+    }
+
+  private:
+    const ReferenceFingerprints &ref;
+    unique_ptr<ReferenceInstruction> first; // The first difference
+    size_t firstInstr = 0; // The reference instruction for first
+    size_t instr = 0;      // The current instruction
+    size_t errors = 0;     // Error count
+    const bool ignoreConditionalExecutionDifferences;
+    const bool ignoreMemoryAccessDifferences;
+    bool controlFlowDivergence = false;
+
+    bool matches(const InstructionFingerprint &F,
+                 const ReferenceInstruction &O) {
+        if (!F.sameStatic(O)) {
+            controlFlowDivergence = true;
+            return false;
+        }
+        if (!ignoreConditionalExecutionDifferences &&
+            InstructionEffect(F.effect) != O.effect)
+            return false;
+        if (!ignoreMemoryAccessDifferences &&
+            F.memHash != InstructionFingerprint::hash(O.memAccess))
+            return false;
+        return true;
+    }
+};
+
 class CTAnalyzer : public MTAnalyzer {
 
   public:
@@ -150,20 +311,83 @@ class CTAnalyzer : public MTAnalyzer {
         FromTraceBuilder<ReferenceInstruction, ReferenceInstructionBuilder,
                          ReferenceTrace>
             FTB(indexNavigator);
+        FTB.setPipelineDepth(FTB.PIPELINE_DEPTH);
         FTB.build(ER, RT);
         return RT;
     }
 
-    bool check(const ReferenceTrace &Ref, const ExecutionRange &ER) {
-
-        TraceComparator TraceCmp(Ref, ignoreConditionalExecutionDifferences,
-                                 ignoreMemoryAccessDifferences);
+    // Build the reference fingerprints from ER, dumping the reference
+    // instructions to os if it is not null.
+    ReferenceFingerprints getReferenceFingerprints(const ExecutionRange &ER,
+                                                   ostream *os) {
+        ReferenceFingerprints RF(os);
         FromTraceBuilder<ReferenceInstruction, ReferenceInstructionBuilder,
-                         TraceComparator>
+                         ReferenceFingerprints>
             FTB(indexNavigator);
-        FTB.build(ER, TraceCmp);
+        FTB.setPipelineDepth(FTB.PIPELINE_DEPTH);
+        FTB.build(ER, RF);
+        return RF;
+    }
 
-        return TraceCmp.hasErrors();
+    // Compare the instances in ERS of the trace to the reference
+    // fingerprints, using up to numJobs threads. Only a summary of each
+    // comparison is kept, and reported to os in order.
+    bool check(const ReferenceFingerprints &Ref,
+               const vector<ExecutionRange> &ERS, const TracePair &trace,
+               unsigned numJobs, ostream &os) {
+        vector<unique_ptr<FingerprintComparator>> Cmps;
+        Cmps.reserve(ERS.size());
+        for (size_t i = 0; i < ERS.size(); i++)
+            Cmps.emplace_back(make_unique<FingerprintComparator>(
+                Ref, ignoreConditionalExecutionDifferences,
+                ignoreMemoryAccessDifferences));
+
+        ParallelTraceBuilder<ReferenceInstruction, ReferenceInstructionBuilder,
+                             FingerprintComparator>
+            PTB([&]() { return make_unique<IndexNavigator>(trace, ""); },
+                numJobs);
+        PTB.build(ERS, [&](size_t i) -> FingerprintComparator & {
+            return *Cmps[i];
+        });
+
+        bool errors = false;
+        for (size_t i = 0; i < ERS.size(); i++) {
+            os << " - Comparing reference to instance at time : "
+               << ERS[i].begin.time << " to " << ERS[i].end.time << '\n';
+            Cmps[i]->report(os);
+            errors |= Cmps[i]->hasErrors();
+        }
+        return errors;
+    }
+
+    // Compare the instances in ERS of the trace to the reference, using up
+    // to numJobs threads. The comparisons are reported to os in order.
+    bool check(const ReferenceTrace &Ref, const vector<ExecutionRange> &ERS,
+               const TracePair &trace, unsigned numJobs, ostream &os) {
+        vector<ostringstream> reports(ERS.size());
+        vector<unique_ptr<TraceComparator>> TraceCmps;
+        TraceCmps.reserve(ERS.size());
+        for (auto &report : reports)
+            TraceCmps.emplace_back(make_unique<TraceComparator>(
+                Ref, report, ignoreConditionalExecutionDifferences,
+                ignoreMemoryAccessDifferences));
+
+        ParallelTraceBuilder<ReferenceInstruction, ReferenceInstructionBuilder,
+                             TraceComparator>
+            PTB([&]() { return make_unique<IndexNavigator>(trace, ""); },
+                numJobs);
+        PTB.build(ERS, [&](size_t i) -> TraceComparator & {
+            return *TraceCmps[i];
+        });
+
+        bool errors = false;
+        for (size_t i = 0; i < ERS.size(); i++) {
+            os << " - Comparing reference to instance at time : "
+               << ERS[i].begin.time << " to " << ERS[i].end.time << '\n';
+            os << reports[i].str();
+            errors |= TraceCmps[i]->hasErrors();
+        }
+        return errors;
     }
 
   private:
@@ -179,6 +403,9 @@ int main(int argc, char **argv) {
     string FunctionName;
     bool IgnoreConditionalExecutionDifferences = false;
     bool IgnoreMemoryAccessDifferences = false;
+    bool UseAnalysisCache = false;
+    bool Stream = false;
+    unsigned NumJobs = PAF::defaultNumThreads(1);
 
     Argparse ap("paf-constanttime", argc, argv);
     ap.optnoval({"--ignore-conditional-execution-differences"},
@@ -187,16 +414,34 @@ int main(int argc, char **argv) {
     ap.optnoval({"--ignore-memory-access-differences"},
                 "ignore differences in memory accesses",
                 [&]() { IgnoreMemoryAccessDifferences = true; });
+    ap.optnoval({"--analysis-cache"},
+                "save the function instances found in each trace to a cache "
+                "file next to its index, and reuse them in later runs",
+                [&]() { UseAnalysisCache = true; });
+    ap.optnoval({"--stream"},
+                "reduce the reference to per instruction fingerprints, and "
+                "only report the number of differences and the first one for "
+                "each instance",
+                [&]() { Stream = true; });
+    ap.optval({"-j", "--jobs"}, "N",
+              "compare up to N function instances concurrently (default: "
+              "$PAF_NUM_THREADS, or 1; 0 uses as many threads as the "
+              "hardware supports)",
+              [&](const string &s) { NumJobs = stoul(s, nullptr, 0); });
     ap.positional("FUNCTION", "name or hex address of function to analyze",
                   [&](const string &s) { FunctionName = s; });
 
     TarmacUtilityMT tu;
     tu.add_options(ap);
 
+    Stats::addOptions(ap);
     ap.parse();
+    const ScopedTimer T("paf-constanttime");
     tu.setup();
 
     ReferenceTrace RefTrace;
+    ReferenceFingerprints RefFingerprints;
+    bool HasReference = false;
 
     for (const auto &trace : tu.traces) {
         if (tu.is_verbose()) {
@@ -207,6 +452,15 @@ int main(int argc, char **argv) {
         CTAnalyzer CTA(IN, IgnoreConditionalExecutionDifferences,
                        IgnoreMemoryAccessDifferences);
 
+        unique_ptr<AnalysisCache> AC;
+        if (UseAnalysisCache) {
+            AC = make_unique<AnalysisCache>(trace, tu.image_filename);
+            if (!AC->good())
+                reporter->warn("Ignoring analysis cache '%s': %s",
+                               AC->getFilename().c_str(), AC->error());
+            CTA.setAnalysisCache(AC.get());
+        }
+
         vector<ExecutionRange> Functions = CTA.getInstances(FunctionName);
 
         // Some sanity checks.
@@ -215,22 +469,30 @@ int main(int argc, char **argv) {
                            "Function '%s' was not found in the trace",
                            FunctionName.c_str());
 
-        for (const ExecutionRange &ER : Functions) {
-            // Build the reference trace if we do not already have one. This
-            // effectively means we are using the first function instance found
-            // in the first trace file.
-            if (RefTrace.size() == 0) {
+        // Build the reference trace if we do not already have one. This
+        // effectively means we are using the first function instance found
+        // in the first trace file.
+        if (!HasReference) {
+            const ExecutionRange &ER = Functions.front();
+            cout << " - Building reference trace from " << FunctionName
+                 << " instance at time : " << ER.begin.time << " to "
+                 << ER.end.time << '\n';
+            if (Stream)
+                RefFingerprints = CTA.getReferenceFingerprints(ER, &cout);
+            else {
                 RefTrace = CTA.getReferenceTrace(ER);
-                cout << " - Building reference trace from " << FunctionName
-                     << " instance at time : " << ER.begin.time << " to "
-                     << ER.end.time << '\n';
                 RefTrace.dump(cout);
-            } else {
-                cout << " - Comparing reference to instance at time : "
-                     << ER.begin.time << " to " << ER.end.time << '\n';
-                CTA.check(RefTrace, ER);
             }
+            Functions.erase(Functions.begin());
+            HasReference = true;
         }
+
+        // The other instances are independent from each other, so they are
+        // compared to the reference concurrently.
+        if (Stream)
+            CTA.check(RefFingerprints, Functions, trace, NumJobs, cout);
+        else
+            CTA.check(RefTrace, Functions, trace, NumJobs, cout);
     }
 
     return EXIT_SUCCESS;
@@ -21,21 +21,32 @@
 #include "faulter.h"
 
 #include "PAF/ArchInfo.h"
+#include "PAF/FI/CampaignFile.h"
 #include "PAF/FI/Fault.h"
+#include "PAF/FI/FaultSimulator.h"
 #include "PAF/FI/Oracle.h"
+#include "PAF/FI/Results.h"
 #include "PAF/Intervals.h"
 #include "PAF/PAF.h"
+#include "PAF/utils/Parallel.h"
+#include "PAF/utils/Stats.h"
 
 #include "libtarmac/calltree.hh"
 #include "libtarmac/index.hh"
 #include "libtarmac/parser.hh"
 #include "libtarmac/reporter.hh"
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
 #include <cstdlib>
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <unordered_map>
 #include <vector>
 
@@ -51,11 +62,18 @@ using std::vector;
 using PAF::ArchInfo;
 using PAF::ExecutionRange;
 using PAF::FromTraceBuilder;
+using PAF::InstrInfoCache;
 using PAF::Intervals;
 using PAF::ReferenceInstruction;
 using PAF::ReferenceInstructionBuilder;
+using PAF::ScopedTimer;
+using PAF::Stats;
+using PAF::V7MInfo;
+using PAF::FI::CampaignResults;
 using PAF::FI::Classifier;
 using PAF::FI::CorruptRegDef;
+using PAF::FI::FaultModelBase;
+using PAF::FI::FaultSimulator;
 using PAF::FI::InjectionCampaign;
 using PAF::FI::InjectionRangeInfo;
 using PAF::FI::InstructionSkip;
@@ -63,6 +81,21 @@ using PAF::FI::Oracle;
 
 namespace {
 
+// Mix value v into hash h, for computing the fault keys.
+uint64_t mix(uint64_t h, uint64_t v) {
+    uint64_t z = h ^ (v + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2));
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Mix string s into hash h.
+uint64_t mix(uint64_t h, const string &s) {
+    for (const char c : s)
+        h = mix(h, uint64_t((unsigned char)c));
+    return mix(h, s.size());
+}
+
 // The BPCollector class collects and accumulates overtime how many time an
 // address has been seen, so that a breakpoint count can be set, for example
 // when one needs to break at the third iteration of a loop.
@@ -94,7 +127,30 @@ class BPCollector {
         return 0;
     }
 
+    // Mark the current point, so that the counts at this point can still be
+    // queried with countAtMark once more addresses have been seen.
+    void mark() {
+        marked = true;
+        atMark.clear();
+    }
+
+    [[nodiscard]] unsigned countAtMark(uint64_t addr) const {
+        auto it = atMark.find(addr);
+        if (it != atMark.end())
+            return it->second;
+        return count(addr);
+    }
+
+    // Set the count of addr, e.g. to the number of times it was executed
+    // before the current part of the trace.
+    void set(uint64_t addr, unsigned count) {
+        if (count != 0)
+            brkCnt[addr] = count;
+    }
+
     BPCollector &add(uint64_t addr) {
+        if (marked)
+            atMark.emplace(addr, count(addr));
         auto it = brkCnt.find(addr);
         if (it != brkCnt.end())
             it->second += 1;
@@ -109,10 +165,17 @@ class BPCollector {
                << '\n';
     }
 
-    void clear() { brkCnt.clear(); }
+    void clear() {
+        brkCnt.clear();
+        atMark.clear();
+        marked = false;
+    }
 
   private:
     std::unordered_map<uint64_t, unsigned> brkCnt;
+    // The counts at the mark of the addresses seen since the mark.
+    std::unordered_map<uint64_t, unsigned> atMark;
+    bool marked = false;
 };
 
 // The SuccessorCollector class contains a sequence of (time, address) pairs and
@@ -149,6 +212,8 @@ class SuccessorCollector {
         return trace[idx];
     }
 
+    [[nodiscard]] size_t size() const { return trace.size(); }
+
     void dump(ostream &os) const {
         for (const auto &P : trace)
             os << std::dec << P.time << ": 0x" << std::hex << P.addr << '\n';
@@ -212,35 +277,103 @@ class FaulterInjectionPlanner {
     FaulterInjectionPlanner(const string &Image, const string &Tarmac,
                             const ArchInfo &CPU, unsigned long MaxTraceTime,
                             uint64_t ProgramEntryAddress,
-                            uint64_t ProgramEndAddress)
-        : cpu(CPU),
+                            uint64_t ProgramEndAddress,
+                            const Faulter::Pruning &Pruning)
+        : cpu(CPU), instrInfos(CPU), pruning(Pruning),
+          // The register usage is only decoded for Arm v7-M.
+          liveness(Pruning.benign && dynamic_cast<const V7MInfo *>(&CPU)),
+          equivalence(Pruning.equivalent &&
+                      dynamic_cast<const V7MInfo *>(&CPU)),
+          simulator(Pruning.simulate && FaultSimulator::isSupported(CPU)
+                        ? new FaultSimulator(CPU)
+                        : nullptr),
           campaign(Image, Tarmac, MaxTraceTime, ProgramEntryAddress & ~1UL,
                    ProgramEndAddress & ~1UL) {}
     virtual ~FaulterInjectionPlanner() = default;
 
-    virtual void operator()(const ReferenceInstruction &I) = 0;
+    // Plan the faults to inject on instruction I.
+    void operator()(const ReferenceInstruction &I) {
+        if (keyed)
+            code.push_back({I.time, I.pc - rangeStart, I.instruction});
+        if (checkpointInterval != 0) {
+            if (!checkpointPending &&
+                I.time >= rangeCheckpoints.back().time + checkpointInterval)
+                checkpointPending = true;
+            // The checkpoint will be at the first fault planned from here.
+            if (checkpointPending)
+                breakpoints.mark();
+        }
+
+        if (!liveness && !equivalence) {
+            inject(I);
+            if (simulator)
+                simulator->step(I);
+            return;
+        }
 
-    // Prepare Successors and Breakpoint information.
+        analyze(I);
+        if (liveness) {
+            for (const unsigned r : uses)
+                setUsed(r);
+            for (const unsigned r : defs)
+                setOverwritten(r);
+        }
+        inject(I);
+        if (equivalence)
+            for (const auto &Reg : I.regAccess)
+                if (Reg.access == PAF::RegisterAccess::Type::WRITE)
+                    values[registerId(Reg)] = Reg.value;
+        if (simulator)
+            simulator->step(I);
+    }
+
+    // The faults planned in an injection range, ready to be added to the
+    // campaign.
+    struct RangePlan;
+
+    // Prepare the planning of the injection range starting at start, with
+    // the Successors of its instructions, and the Breakpoints counts at its
+    // start of the addresses it executes.
     void setup(const IndexNavigator &IN, const TarmacSite &start,
-               const TarmacSite &end) {
-        // Collect the list of all addresses we have visited upto
-        // (excluded) the interval start, including the number of times
-        // they were visited. This will be used as the starting
-        // point for breakpoint count.
-        breakpoints.clear();
-        FromTraceBuilder<BPCollector::BPoint, BPCollector::EventHandler,
-                         BPCollector>
-            BPC(IN);
-        BPC.build(ExecutionRange(TarmacSite(), start), breakpoints, 0, -1);
-
-        // Collect all instructions successors.
-        successors.clear();
-        FromTraceBuilder<SuccessorCollector::Point,
-                         SuccessorCollector::EventHandler, SuccessorCollector>
-            SB(IN);
-        SB.build(ExecutionRange(start, end), successors, 0, 1);
+               SuccessorCollector &&Successors, BPCollector &&Breakpoints) {
+        breakpoints = std::move(Breakpoints);
+        successors = std::move(Successors);
+        instCnt = 0;
+        rangeStart = start.addr;
+        code.clear();
+        // The breakpoint counts restart from scratch, so do the checkpoints.
+        checkpointPending = checkpointInterval != 0;
+
+        // The fault simulation starts from the register values before the
+        // range, as far as they are known.
+        if (simulator) {
+            simulator->reset();
+            numClassified = simulator->getNumClassified();
+            SeqOrderPayload SOP;
+            if (IN.node_at_time(start.time, &SOP) &&
+                IN.get_previous_node(SOP, &SOP))
+                for (unsigned r = 0; r < cpu.numRegisters(); r++) {
+                    RegisterId id;
+                    if (!lookup_reg_name(id, cpu.registerName(r)))
+                        continue;
+                    const std::pair<bool, uint64_t> res =
+                        IN.get_reg_value(SOP.memory_root, id);
+                    if (res.first)
+                        simulator->setRegister(r, res.second);
+                }
+        }
     }
 
+    // Get the faults planned in the current range, once its liveness is
+    // known. The registers still live at the end of the range are
+    // conservatively assumed to be used later.
+    RangePlan finish();
+
+    // Add the faults planned in range Plan to the campaign. The ranges
+    // must be merged in order, so that the fault Ids, the equivalence
+    // representatives and the keys do not depend on the planning order.
+    void merge(RangePlan &&Plan);
+
     // Add a simple Oracle for now : check the function return value.
     FaulterInjectionPlanner &addOracle(Oracle &&O) {
         campaign.addOracle(std::move(O));
@@ -267,42 +400,499 @@ class FaulterInjectionPlanner {
         return *this;
     }
 
-    void dump(const string &campaign_filename) const {
-        if (campaign_filename.size() != 0)
-            campaign.dumpToFile(campaign_filename);
-        else
+    void dump(const string &campaign_filename,
+              const Faulter::Output &output) const {
+        if (campaign_filename.size() == 0) {
             campaign.dump(cout);
+            return;
+        }
+
+        if (output.numShards == 1) {
+            save(campaign_filename, output.format, campaign.all());
+            return;
+        }
+        const vector<InjectionCampaign::Shard> shards =
+            campaign.getShards(output.numShards, output.shardBy);
+        for (size_t k = 0; k < shards.size(); k++)
+            save(campaign_filename + '.' + std::to_string(k), output.format,
+                 shards[k]);
+    }
+
+    void save(const string &filename, InjectionCampaign::Format format,
+              const InjectionCampaign::Shard &shard) const {
+        if (!campaign.dumpToFile(filename, format, shard))
+            reporter->errx(EXIT_FAILURE, "Error writing campaign file '%s'",
+                           filename.c_str());
+    }
+
+    // Plan a checkpoint every Interval time units, from which the faults
+    // following it can be run. An Interval of 0 disables the checkpoints.
+    void setCheckpointInterval(unsigned long Interval) {
+        checkpointInterval = Interval;
+        checkpointPending = Interval != 0;
+    }
+
+    // Set how the CorruptRegDef faults corrupt their register.
+    void setCorruption(const Faulter::Corruption &C) { corruption = C; }
+
+    // Give each fault a key, which identifies it across program rebuilds,
+    // and copy the effects of the faults with a key in Results, if any.
+    void setKeys(const CampaignResults *Results) {
+        keyed = true;
+        results = Results;
+    }
+
+    // Save the checkpoint plan, in YAML format, to filename.
+    void dumpCheckpoints(const string &filename) const {
+        std::ofstream os(filename.c_str());
+        os << "Checkpoints:\n";
+        for (const Checkpoint &C : checkpoints) {
+            // All faults of this checkpoint may have been pruned or folded.
+            if (C.faults.empty())
+                continue;
+            os << "  - { Time: " << C.time << ", ";
+            C.breakpoint.dump(os);
+            os << ", Faults: [";
+            const char *sep = "";
+            for (const auto &F : C.faults) {
+                os << sep << '[' << F.first << ", " << F.second << ']';
+                sep = ", ";
+            }
+            os << "]}\n";
+        }
+        if (!os)
+            reporter->errx(EXIT_FAILURE,
+                           "Error writing checkpoint plan file '%s'",
+                           filename.c_str());
+    }
+
+    // Describe how much the fault space was reduced.
+    void dumpPruning(ostream &os) const {
+        if (pruning.benign)
+            os << "Pruned " << numPruned << " faults with no effect\n";
+        if (pruning.equivalent)
+            os << "Folded " << numFolded << " equivalent faults\n";
+        if (simulator)
+            os << "Simulated " << numSimulated << " faults with no effect\n";
+        if ((pruning.benign && !liveness) ||
+            (pruning.equivalent && !equivalence))
+            os << "Register usage is not available for " << cpu.description()
+               << ", the pruning was limited\n";
+        if (pruning.simulate && !simulator)
+            os << "Faults can not be simulated for " << cpu.description()
+               << '\n';
+        if (results)
+            os << "Reused the results of " << numReused << " faults\n";
     }
 
     static std::unique_ptr<FaulterInjectionPlanner>
     get(Faulter::FaultModel Model, const string &Image, const string &Tarmac,
         const ArchInfo &CPU, unsigned long MaxTraceTime,
-        uint64_t ProgramEntryAddress, uint64_t ProgramEndAddress);
+        uint64_t ProgramEntryAddress, uint64_t ProgramEndAddress,
+        const Faulter::Pruning &Pruning);
 
   protected:
     const ArchInfo &cpu;
     BPCollector breakpoints;
     SuccessorCollector successors;
+    InstrInfoCache instrInfos;
+    const Faulter::Pruning pruning;
+    const bool liveness;
+    const bool equivalence;
+    // The simulator classifying the faults, if enabled and supported.
+    const unique_ptr<FaultSimulator> simulator;
+    // The registers used and defined by the current instruction, when the
+    // liveness or the equivalence are tracked.
+    vector<unsigned> uses;
+    vector<unsigned> defs;
     InjectionCampaign campaign;
+    Faulter::Corruption corruption;
     size_t instCnt{0};
+    // The number of faults pruned: in the current range while planning it,
+    // or in the merged ranges.
+    size_t numPruned{0};
+    size_t numFolded{0};
+
+    // Plan the faults to inject on instruction I.
+    virtual void inject(const ReferenceInstruction &I) = 0;
+
+    // Get the hash of fault F's model specific parameters, for its key.
+    [[nodiscard]] virtual uint64_t
+    getParametersHash(const FaultModelBase &F) const = 0;
+
+    // Plan fault F, injected on instruction I. With liveness tracking, F is
+    // pruned if all registers in Defs are overwritten before being used: an
+    // empty Defs is never pruned. Extra distinguishes the different faults
+    // injected on the same instruction, for the equivalence. The faults are
+    // only added to the campaign once their range is merged, as their
+    // liveness and their simulated effect are not known before.
+    void plan(FaultModelBase *F, const ReferenceInstruction &I,
+              const vector<unsigned> &Defs, uint64_t Extra = 0) {
+        const CheckpointRef checkpoint = getCheckpoint(F, I);
+        vector<uint64_t> context;
+        if (equivalence)
+            context = getContext(I, Extra);
+        for (const unsigned r : Defs)
+            pendingDefs[r].push_back(planned.size());
+        planned.emplace_back(F, std::move(context), Defs.size(), checkpoint);
+    }
+
+    // Can the liveness of register r be tracked ? The stack pointer, the
+    // program counter and the status registers are used implicitly by too
+    // many instructions.
+    [[nodiscard]] static bool isTracked(unsigned r) {
+        return r < unsigned(V7MInfo::Register::MSP) ||
+               r == unsigned(V7MInfo::Register::LR);
+    }
+
+    [[nodiscard]] unsigned registerId(const PAF::RegisterAccess &Reg) const {
+        return Reg.id != PAF::RegisterAccess::UNKNOWN_ID
+                   ? Reg.id
+                   : cpu.findRegisterId(Reg.name);
+    }
+
+  private:
+    // A point of the reference execution, reached by running to breakpoint,
+    // where the model state can be saved, and the faults which can be run
+    // from this saved state, with their breakpoint count relative to it.
+    struct Checkpoint {
+        unsigned long time;
+        PAF::FI::BreakPoint breakpoint;
+        vector<std::pair<unsigned long, unsigned>> faults;
+    };
+    // The checkpoint a fault is run from, and its breakpoint count relative
+    // to this checkpoint.
+    struct CheckpointRef {
+        size_t checkpoint;
+        unsigned count;
+    };
+    // The checkpoints of the campaign, and those of the current range, with
+    // their Ids relative to the range.
+    vector<Checkpoint> checkpoints;
+    vector<Checkpoint> rangeCheckpoints;
+    unsigned long checkpointInterval{0};
+    // Shall a new checkpoint be created at the next planned fault ?
+    bool checkpointPending{false};
+
+    struct PlannedFault {
+        unique_ptr<FaultModelBase> fault;
+        vector<uint64_t> context;
+        // The number of registers which still have to be overwritten, before
+        // being used, for this fault to have no effect.
+        size_t numDefs;
+        bool used;
+        CheckpointRef checkpoint;
+        PlannedFault(FaultModelBase *F, vector<uint64_t> &&Context,
+                     size_t NumDefs, const CheckpointRef &Checkpoint)
+            : fault(F), context(std::move(Context)), numDefs(NumDefs),
+              used(NumDefs == 0), checkpoint(Checkpoint) {}
+    };
+    // The faults planned in the current range, pending their liveness.
+    vector<PlannedFault> planned;
+    // The number of faults classified by the simulator before the current
+    // range, and the total of those classified in the merged ranges.
+    size_t numClassified{0};
+    size_t numSimulated{0};
+    // The planned faults waiting for a register to be used or overwritten.
+    map<unsigned, vector<size_t>> pendingDefs;
+    // The values of the registers, as far as they are known in the range.
+    map<unsigned, uint64_t> values;
+    // The representative of each equivalence class.
+    map<vector<uint64_t>, FaultModelBase *> representatives;
+
+    // The number of instructions around a fault whose encoding is part of
+    // its key.
+    static constexpr size_t KEY_CONTEXT = 4;
+    // An instruction of the current range, with its address relative to
+    // the range start, for the fault keys.
+    struct CodePoint {
+        unsigned long time;
+        uint64_t offset;
+        uint32_t instruction;
+    };
+    bool keyed{false};
+    const CampaignResults *results{nullptr};
+    size_t numReused{0};
+    uint64_t rangeStart{0};
+    vector<CodePoint> code;
+    // The faults added to the campaign from the range being merged.
+    vector<FaultModelBase *> rangeFaults;
+    // The number of faults seen so far with each key, so that the faults
+    // injected on each iteration of a loop get their own key.
+    std::unordered_map<uint64_t, unsigned> occurrences;
+
+    // Key the faults added from the range with instructions Code: a fault
+    // key is a hash of its instruction address (relative to the range
+    // start) and encoding, of the instructions executed around it, of its
+    // model parameters and of its occurrence number. The faults with a known
+    // result get it.
+    void assignKeys(const vector<CodePoint> &Code) {
+        for (FaultModelBase *F : rangeFaults) {
+            const auto it = std::lower_bound(
+                Code.begin(), Code.end(), F->getTime(),
+                [](const CodePoint &C, unsigned long t) { return C.time < t; });
+            if (it == Code.end() || it->time != F->getTime())
+                continue;
+            const size_t i = it - Code.begin();
+            uint64_t h = mix(mix(0, it->offset), it->instruction);
+            for (size_t j = i > KEY_CONTEXT ? i - KEY_CONTEXT : 0;
+                 j < std::min(i + KEY_CONTEXT + 1, Code.size()); j++)
+                h = mix(mix(mix(h, j + KEY_CONTEXT - i), Code[j].offset),
+                        Code[j].instruction);
+            h = mix(h, getParametersHash(*F));
+            h = mix(h, occurrences[h]++);
+            F->setKey(h != 0 ? h : 1);
+
+            if (!results || F->getEffect() != FaultModelBase::Effect::NONE)
+                continue;
+            // A family only reuses results if all its variants agree.
+            const FaultModelBase::Effect e = results->lookup(F->getKey());
+            bool reuse = e != FaultModelBase::Effect::NONE;
+            for (unsigned v = 1; reuse && v < F->getNumVariants(); v++)
+                reuse = results->lookup(F->getKey(v)) == e;
+            if (reuse) {
+                F->setEffect(e);
+                numReused += F->getNumVariants();
+            }
+        }
+        rangeFaults.clear();
+    }
+
+    // Get the checkpoint fault F, injected on instruction I, will be run
+    // from, creating it at F's breakpoint if one is pending.
+    CheckpointRef getCheckpoint(const FaultModelBase *F,
+                                const ReferenceInstruction &I) {
+        if (checkpointInterval == 0)
+            return {0, 0};
+        const PAF::FI::BreakPoint &BP = *F->getBreakpoint();
+        if (checkpointPending) {
+            rangeCheckpoints.push_back({I.time, BP, {}});
+            checkpointPending = false;
+        }
+        return {rangeCheckpoints.size() - 1,
+                BP.count - breakpoints.countAtMark(BP.address)};
+    }
+
+    // Add fault F to the campaign, or fold it into an equivalent one.
+    void add(FaultModelBase *F, vector<uint64_t> &&context,
+             const CheckpointRef &checkpoint) {
+        if (!context.empty()) {
+            const auto it = representatives.find(context);
+            if (it != representatives.end()) {
+                it->second->setWeight(it->second->getWeight() + 1);
+                numFolded += F->getNumVariants();
+                delete F;
+                return;
+            }
+            representatives.emplace(std::move(context), F);
+        }
+        campaign.addFault(F);
+        if (keyed)
+            rangeFaults.push_back(F);
+        Stats::add(Stats::FAULTS_PLANNED, F->getNumVariants());
+        if (checkpointInterval != 0)
+            for (unsigned v = 0; v < F->getNumVariants(); v++)
+                checkpoints[checkpoint.checkpoint].faults.emplace_back(
+                    F->getId() + v, checkpoint.count);
+    }
+
+    void setUsed(unsigned r) {
+        const auto it = pendingDefs.find(r);
+        if (it == pendingDefs.end())
+            return;
+        for (const size_t i : it->second)
+            planned[i].used = true;
+        pendingDefs.erase(it);
+    }
+
+    void setOverwritten(unsigned r) {
+        const auto it = pendingDefs.find(r);
+        if (it == pendingDefs.end())
+            return;
+        for (const size_t i : it->second)
+            planned[i].numDefs--;
+        pendingDefs.erase(it);
+    }
+
+    // Collect the tracked registers used and defined by instruction I. On
+    // top of the decoded inputs, the registers named in the disassembly are
+    // conservatively considered as used, unless they are defined by I.
+    void analyze(const ReferenceInstruction &I) {
+        uses.clear();
+        defs.clear();
+        for (const auto &Reg : I.regAccess)
+            if (Reg.access == PAF::RegisterAccess::Type::WRITE) {
+                const unsigned r = registerId(Reg);
+                if (isTracked(r))
+                    defs.push_back(r);
+            }
+
+        const PAF::InstrInfo &II = instrInfos.get(I);
+        for (const bool implicit : {false, true})
+            for (const unsigned r : II.getUniqueInputRegisters(implicit))
+                use(r);
+
+        const auto isDef = [&](unsigned r) {
+            return std::find(defs.begin(), defs.end(), r) != defs.end();
+        };
+        // Register lists, like {r4-r7}, name their bounds only.
+        unsigned previous = PAF::RegisterAccess::UNKNOWN_ID;
+        bool range = false;
+        const string &D = I.disassembly;
+        for (size_t b = 0; b < D.size();) {
+            size_t e = b;
+            while (e < D.size() && std::isalnum((unsigned char)D[e]))
+                e++;
+            if (e == b) {
+                range =
+                    D[b] == '-' && previous != PAF::RegisterAccess::UNKNOWN_ID;
+                b++;
+                continue;
+            }
+            const unsigned r = cpu.findRegisterId(D.substr(b, e - b));
+            if (r != PAF::RegisterAccess::UNKNOWN_ID) {
+                for (unsigned i = range ? previous + 1 : r; i <= r; i++)
+                    if (!isDef(i))
+                        use(i);
+                previous = r;
+            } else
+                previous = PAF::RegisterAccess::UNKNOWN_ID;
+            range = false;
+            b = e;
+        }
+    }
+
+    void use(unsigned r) {
+        if (std::find(uses.begin(), uses.end(), r) == uses.end())
+            uses.push_back(r);
+    }
+
+    // Get the context fault injection happens in for instruction I, or an
+    // empty context if it is not fully known.
+    [[nodiscard]] vector<uint64_t>
+    getContext(const ReferenceInstruction &I, uint64_t Extra) const {
+        vector<uint64_t> context{I.pc, I.instruction, uint64_t(I.effect),
+                                 Extra};
+        for (const unsigned r : uses) {
+            const auto it = values.find(r);
+            if (it == values.end())
+                return {};
+            context.push_back(r);
+            context.push_back(it->second);
+        }
+        for (const auto &Reg : I.regAccess) {
+            context.push_back(registerId(Reg));
+            context.push_back(Reg.value);
+        }
+        for (const auto &M : I.memAccess) {
+            context.push_back(M.addr);
+            context.push_back(M.size);
+            context.push_back(uint64_t(M.access));
+            context.push_back(M.value);
+        }
+        return context;
+    }
+};
+
+struct FaulterInjectionPlanner::RangePlan {
+    // The faults which have not been pruned, in planning order, with their
+    // checkpoints Ids relative to the range.
+    vector<PlannedFault> faults;
+    vector<Checkpoint> checkpoints;
+    vector<CodePoint> code;
+    size_t numPruned{0};
+    size_t numSimulated{0};
 };
 
+FaulterInjectionPlanner::RangePlan FaulterInjectionPlanner::finish() {
+    RangePlan Plan;
+    if (simulator) {
+        simulator->flush();
+        Plan.numSimulated = simulator->getNumClassified() - numClassified;
+    }
+    for (auto &P : planned)
+        if (!P.used && P.numDefs == 0)
+            numPruned++;
+        else
+            Plan.faults.emplace_back(std::move(P));
+    Plan.numPruned = numPruned;
+    numPruned = 0;
+    Plan.checkpoints = std::move(rangeCheckpoints);
+    Plan.code = std::move(code);
+    rangeCheckpoints.clear();
+    code.clear();
+    planned.clear();
+    pendingDefs.clear();
+    values.clear();
+    return Plan;
+}
+
+void FaulterInjectionPlanner::merge(RangePlan &&Plan) {
+    const size_t firstCheckpoint = checkpoints.size();
+    for (auto &C : Plan.checkpoints)
+        checkpoints.emplace_back(std::move(C));
+    for (auto &P : Plan.faults) {
+        P.checkpoint.checkpoint += firstCheckpoint;
+        add(P.fault.release(), std::move(P.context), P.checkpoint);
+    }
+    if (keyed)
+        assignKeys(Plan.code);
+    numPruned += Plan.numPruned;
+    numSimulated += Plan.numSimulated;
+}
+
 class InstructionSkipPlanner : public FaulterInjectionPlanner {
   public:
     InstructionSkipPlanner(const string &Image, const string &Tarmac,
                            const ArchInfo &CPU, unsigned long MaxTraceTime,
                            uint64_t ProgramEntryAddress,
-                           uint64_t ProgramEndAddress)
+                           uint64_t ProgramEndAddress,
+                           const Faulter::Pruning &Pruning)
         : FaulterInjectionPlanner(Image, Tarmac, CPU, MaxTraceTime,
-                                  ProgramEntryAddress, ProgramEndAddress) {}
+                                  ProgramEntryAddress, ProgramEndAddress,
+                                  Pruning) {}
+
+  protected:
+    void inject(const ReferenceInstruction &I) override {
+        const unsigned count = breakpoints.count(I.pc);
+        breakpoints.add(I.pc);
+
+        // Skipping a NOP, or an instruction which was not executed (e.g.
+        // in an IT block), has no effect.
+        const uint32_t NOP = cpu.getNOP(I.width);
+        if (pruning.benign && (!I.executed() || I.instruction == NOP)) {
+            numPruned++;
+            return;
+        }
 
-    void operator()(const ReferenceInstruction &I) override {
         auto *theFault = new InstructionSkip(
-            I.time, I.pc, I.instruction, cpu.getNOP(I.width), I.width, I.effect,
+            I.time, I.pc, I.instruction, NOP, I.width, I.executed(),
             PAF::trimSpacesAndComment(I.disassembly));
-        theFault->setBreakpoint(I.pc, breakpoints.count(I.pc));
-        breakpoints.add(I.pc);
-        campaign.addFault(theFault);
+        theFault->setBreakpoint(I.pc, count);
+
+        // Skipping an instruction which only defines registers that are
+        // overwritten before being used has no effect either.
+        bool mayBeDead = liveness && !defs.empty();
+        if (mayBeDead) {
+            const PAF::InstrInfo &II = instrInfos.get(I);
+            mayBeDead = !II.isBranch() && !II.isCall() && !cpu.isBranch(I);
+        }
+        if (mayBeDead)
+            for (const auto &M : I.memAccess)
+                mayBeDead &= M.access != PAF::MemoryAccess::Type::WRITE;
+        if (mayBeDead)
+            for (const auto &Reg : I.regAccess)
+                mayBeDead &= Reg.access != PAF::RegisterAccess::Type::WRITE ||
+                             isTracked(registerId(Reg));
+        if (simulator)
+            simulator->skip(*theFault, I);
+        plan(theFault, I, mayBeDead ? defs : vector<unsigned>());
+    }
+
+    [[nodiscard]] uint64_t
+    getParametersHash(const FaultModelBase &F) const override {
+        const auto &IS = static_cast<const InstructionSkip &>(F);
+        return mix(IS.getFaultedInstr(), IS.isExecuted());
     }
 };
 
@@ -311,11 +901,14 @@ class CorruptRegDefPlanner : public FaulterInjectionPlanner {
     CorruptRegDefPlanner(const string &Image, const string &Tarmac,
                          const ArchInfo &CPU, unsigned long MaxTraceTime,
                          uint64_t ProgramEntryAddress,
-                         uint64_t ProgramEndAddress)
+                         uint64_t ProgramEndAddress,
+                         const Faulter::Pruning &Pruning)
         : FaulterInjectionPlanner(Image, Tarmac, CPU, MaxTraceTime,
-                                  ProgramEntryAddress, ProgramEndAddress) {}
+                                  ProgramEntryAddress, ProgramEndAddress,
+                                  Pruning) {}
 
-    void operator()(const ReferenceInstruction &I) override {
+  protected:
+    void inject(const ReferenceInstruction &I) override {
         // The CorruptRegDef fault model corrupts the output registers of an
         // instruction: this requires to break at the next intruction, once
         // the instruction to fault has been executed.
@@ -331,34 +924,168 @@ class CorruptRegDefPlanner : public FaulterInjectionPlanner {
                     I.time, I.pc, I.instruction, I.width,
                     PAF::trimSpacesAndComment(I.disassembly), Reg.name);
                 theFault->setBreakpoint(BkptAddr, breakpoints.count(BkptAddr));
-                campaign.addFault(theFault);
+                if (corruption.pattern != CorruptRegDef::Pattern::VALUE) {
+                    RegisterId id;
+                    const unsigned regWidth = lookup_reg_name(id, Reg.name)
+                                                  ? 8 * reg_size(id)
+                                                  : 32;
+                    theFault->setPattern(corruption.pattern, regWidth,
+                                         corruption.numBits, corruption.count);
+                }
+                const unsigned r = registerId(Reg);
+                // The simulation only models the register being reset.
+                if (simulator &&
+                    corruption.pattern == CorruptRegDef::Pattern::VALUE)
+                    simulator->corrupt(*theFault, I, r);
+                plan(theFault, I,
+                     liveness && isTracked(r) ? vector<unsigned>{r}
+                                              : vector<unsigned>(),
+                     r);
             }
         }
         if (faultAdded)
             breakpoints.add(BkptAddr);
     }
+
+    [[nodiscard]] uint64_t
+    getParametersHash(const FaultModelBase &F) const override {
+        const auto &CRD = static_cast<const CorruptRegDef &>(F);
+        return mix(mix(mix(mix(0, CRD.getFaultedReg()),
+                           uint64_t(CRD.getPattern())),
+                       CRD.getRegWidth()),
+                   CRD.getNumBits());
+    }
 };
 
 std::unique_ptr<FaulterInjectionPlanner> FaulterInjectionPlanner::get(
     Faulter::FaultModel Model, const string &Image, const string &Tarmac,
     const ArchInfo &CPU, unsigned long MaxTraceTime,
-    uint64_t ProgramEntryAddress, uint64_t ProgramEndAddress) {
+    uint64_t ProgramEntryAddress, uint64_t ProgramEndAddress,
+    const Faulter::Pruning &Pruning) {
 
     switch (Model) {
     case Faulter::FaultModel::INSTRUCTION_SKIP:
         return std::unique_ptr<FaulterInjectionPlanner>(
             new InstructionSkipPlanner(Image, Tarmac, CPU, MaxTraceTime,
-                                       ProgramEntryAddress, ProgramEndAddress));
+                                       ProgramEntryAddress, ProgramEndAddress,
+                                       Pruning));
     case Faulter::FaultModel::CORRUPT_REG_DEF:
         return std::unique_ptr<FaulterInjectionPlanner>(
             new CorruptRegDefPlanner(Image, Tarmac, CPU, MaxTraceTime,
-                                     ProgramEntryAddress, ProgramEndAddress));
+                                     ProgramEntryAddress, ProgramEndAddress,
+                                     Pruning));
+    }
+}
+
+// The PlanningPool class calls a function on each injection range, using up
+// to numJobs threads. Each thread gets its own worker, i.e. its own planner
+// and IndexNavigator, as the navigators can not be shared between threads.
+// The workers are recycled from one range to the next.
+class PlanningPool {
+  public:
+    struct Worker {
+        const IndexNavigator *navigator;
+        unique_ptr<IndexNavigator> ownNavigator;
+        unique_ptr<FaulterInjectionPlanner> planner;
+    };
+    using PlannerFactory = std::function<unique_ptr<FaulterInjectionPlanner>()>;
+
+    // Construct a PlanningPool. The first worker uses IN, and the others get
+    // their navigator from MakeNavigator. Without MakeNavigator, the ranges
+    // are processed in order by the calling thread.
+    PlanningPool(const IndexNavigator &IN,
+                 const Faulter::NavigatorFactory &MakeNavigator,
+                 PlannerFactory MakePlanner, unsigned NumJobs)
+        : mainNavigator(IN), makeNavigator(MakeNavigator),
+          makePlanner(std::move(MakePlanner)),
+          numJobs(MakeNavigator ? NumJobs : 1) {}
+
+    // Call f(W, i) for each range i in [0, n(, with worker W. The calls for
+    // different ranges may be concurrent.
+    template <class Function> void forEach(size_t n, const Function &f) {
+        PAF::parallelFor(
+            0, n, 1,
+            [&](size_t b, size_t e) {
+                unique_ptr<Worker> W = acquire();
+                for (size_t i = b; i < e; i++)
+                    f(*W, i);
+                std::lock_guard<std::mutex> lock(mtx);
+                idle.emplace_back(std::move(W));
+            },
+            numJobs);
+    }
+
+  private:
+    const IndexNavigator &mainNavigator;
+    const Faulter::NavigatorFactory &makeNavigator;
+    const PlannerFactory makePlanner;
+    const unsigned numJobs;
+    std::mutex mtx;
+    vector<unique_ptr<Worker>> idle;
+    bool mainNavigatorUsed{false};
+
+    unique_ptr<Worker> acquire() {
+        bool useMain;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!idle.empty()) {
+                unique_ptr<Worker> W = std::move(idle.back());
+                idle.pop_back();
+                return W;
+            }
+            useMain = !mainNavigatorUsed;
+            mainNavigatorUsed = true;
+        }
+        auto W = std::make_unique<Worker>();
+        if (!useMain) {
+            W->ownNavigator = makeNavigator();
+            W->navigator = W->ownNavigator.get();
+        } else
+            W->navigator = &mainNavigator;
+        W->planner = makePlanner();
+        return W;
+    }
+};
+
+// Get, for each range in ER, the number of times each of the addresses in
+// its Successors was executed before the range start, which is where its
+// breakpoint counts start from. The counts are collected in a single pass
+// over the trace, shared by all ranges.
+vector<BPCollector>
+countBreakpoints(const IndexNavigator &IN, const vector<ExecutionRange> &ER,
+                 const vector<SuccessorCollector> &Successors) {
+    vector<size_t> order(ER.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return ER[a].begin.time < ER[b].begin.time;
+    });
+
+    vector<BPCollector> Counts(ER.size());
+    BPCollector all;
+    FromTraceBuilder<BPCollector::BPoint, BPCollector::EventHandler,
+                     BPCollector>
+        BPC(IN);
+    const TarmacSite *from = nullptr;
+    for (const size_t i : order) {
+        // Count the addresses up to (excluded) the range start.
+        const TarmacSite &start = ER[i].begin;
+        if (!from || from->time != start.time) {
+            BPC.build(ExecutionRange(from ? *from : TarmacSite(), start), all,
+                      0, -1);
+            from = &start;
+        }
+        for (size_t j = 0; j < Successors[i].size(); j++) {
+            const uint64_t addr = Successors[i][j].addr;
+            Counts[i].set(addr, all.count(addr));
+        }
     }
+    return Counts;
 }
 } // namespace
 
 void Faulter::run(const InjectionRangeSpec &IRS, FaultModel Model,
                   const string &oracleSpec) {
+    const ScopedTimer T("faulter");
     if (!indexNavigator.has_image()) {
         reporter->warn("No image, no function can not be looked up by name.");
         return;
@@ -367,12 +1094,33 @@ void Faulter::run(const InjectionRangeSpec &IRS, FaultModel Model,
     const unique_ptr<ArchInfo> CPU = PAF::getCPU(indexNavigator.index);
     CallTree CT(indexNavigator);
 
-    // Create our FaultInjectionPlanner.
-    std::unique_ptr<FaulterInjectionPlanner> FIP = FaulterInjectionPlanner::get(
-        Model, indexNavigator.get_image()->get_filename(),
-        indexNavigator.get_tarmac_filename(), *CPU.get(),
-        CT.getFunctionExit().time, CT.getFunctionEntry().addr,
-        CT.getFunctionExit().addr);
+    unique_ptr<CampaignResults> results;
+    if (!incremental.previousResults.empty()) {
+        results =
+            std::make_unique<CampaignResults>(incremental.previousResults);
+        if (!results->good())
+            reporter->errx(EXIT_FAILURE, "Error reading campaign file '%s': %s",
+                           incremental.previousResults.c_str(),
+                           results->error());
+    }
+
+    // Create our FaultInjectionPlanners: one building the campaign, and one
+    // per thread planning the injection ranges.
+    const auto makePlanner = [&]() {
+        std::unique_ptr<FaulterInjectionPlanner> P =
+            FaulterInjectionPlanner::get(
+                Model, indexNavigator.get_image()->get_filename(),
+                indexNavigator.get_tarmac_filename(), *CPU.get(),
+                CT.getFunctionExit().time, CT.getFunctionEntry().addr,
+                CT.getFunctionExit().addr, pruning);
+        if (!output.checkpointFilename.empty())
+            P->setCheckpointInterval(output.checkpointInterval);
+        P->setCorruption(corruption);
+        if (incremental.keys || results)
+            P->setKeys(results.get());
+        return P;
+    };
+    std::unique_ptr<FaulterInjectionPlanner> FIP = makePlanner();
 
     // Build the intervals where faults have to be injected.
     vector<ExecutionRange> ER;
@@ -527,25 +1275,43 @@ void Faulter::run(const InjectionRangeSpec &IRS, FaultModel Model,
     } break;
     }
 
-    // Inject faults into each range.
-    for (const auto &er : ER) {
+    // Plan the faults of each range independently, possibly concurrently,
+    // then add them to the campaign in order.
+    PlanningPool Pool(indexNavigator, makeNavigator, makePlanner, numJobs);
+    vector<SuccessorCollector> Successors(ER.size());
+    Pool.forEach(ER.size(), [&](PlanningPool::Worker &W, size_t i) {
+        FromTraceBuilder<SuccessorCollector::Point,
+                         SuccessorCollector::EventHandler, SuccessorCollector>
+            SB(*W.navigator);
+        SB.build(ER[i], Successors[i], 0, 1);
+    });
+    vector<BPCollector> Breakpoints =
+        countBreakpoints(indexNavigator, ER, Successors);
+
+    vector<FaulterInjectionPlanner::RangePlan> Plans(ER.size());
+    Pool.forEach(ER.size(), [&](PlanningPool::Worker &W, size_t i) {
+        FaulterInjectionPlanner &P = *W.planner;
+        P.setup(*W.navigator, ER[i].begin, std::move(Successors[i]),
+                std::move(Breakpoints[i]));
+        FromTraceBuilder<ReferenceInstruction, ReferenceInstructionBuilder,
+                         FaulterInjectionPlanner>
+            FTP(*W.navigator);
+        FTP.build(ER[i], P);
+        Plans[i] = P.finish();
+    });
 
+    for (size_t i = 0; i < ER.size(); i++) {
         if (verbose()) {
             cout << "Injecting faults on range ";
-            PAF::dump(cout, er.begin);
+            PAF::dump(cout, ER[i].begin);
             cout << " - ";
-            PAF::dump(cout, er.end);
+            PAF::dump(cout, ER[i].end);
             cout << '\n';
         }
-
-        FIP->setup(indexNavigator, er.begin, er.end);
-
-        // Inject the faults.
-        FromTraceBuilder<ReferenceInstruction, ReferenceInstructionBuilder,
-                         decltype(*FIP)>
-            FTP(indexNavigator);
-        FTP.build(ExecutionRange(er.begin, er.end), *FIP);
+        FIP->merge(std::move(Plans[i]));
     }
+    if (verbose())
+        FIP->dumpPruning(cout);
 
     // Build the Oracle we got from the command line and add it to the Campaign.
     // FIXME: these are very simple oracles for now, but at some point, they'll
@@ -616,5 +1382,7 @@ void Faulter::run(const InjectionRangeSpec &IRS, FaultModel Model,
     FIP->addOracle(std::move(O));
 
     // Save the results.
-    FIP->dump(campaignFilename);
+    FIP->dump(campaignFilename, output);
+    if (!output.checkpointFilename.empty())
+        FIP->dumpCheckpoints(output.checkpointFilename);
 }
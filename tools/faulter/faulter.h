@@ -20,10 +20,13 @@
 
 #pragma once
 
+#include "PAF/FI/Fault.h"
 #include "PAF/PAF.h"
 
 #include <cstdint>
+#include <functional>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 
@@ -103,13 +106,87 @@ class Faulter : public PAF::MTAnalyzer {
   public:
     enum class FaultModel : uint8_t { INSTRUCTION_SKIP, CORRUPT_REG_DEF };
 
+    // How the fault space is reduced when planning the campaign.
+    struct Pruning {
+        // Remove the faults which provably have no effect: skipping a NOP or
+        // an instruction which was not executed, or corrupting a register
+        // which is overwritten before being used.
+        bool benign = false;
+        // Only keep one representative of the faults injected in identical
+        // contexts (same instruction, input and output values), weighted by
+        // the number of faults it stands for. This assumes these faults
+        // have the same outcome, which is a heuristic.
+        bool equivalent = false;
+        // Classify the faults which provably have no effect by replaying the
+        // reference trace on the faulted state, while planning the campaign.
+        // They are kept in the campaign, with their effect recorded.
+        bool simulate = false;
+    };
+
+    // How the CorruptRegDef faults corrupt their register: with anything
+    // but Pattern::VALUE, each register definition gets a family of faults.
+    struct Corruption {
+        PAF::FI::CorruptRegDef::Pattern pattern =
+            PAF::FI::CorruptRegDef::Pattern::VALUE;
+        // The number of bits flipped by each Pattern::RANDOM_BITS fault, and
+        // the number of these faults per register definition.
+        unsigned numBits = 1;
+        unsigned count = 1;
+    };
+
+    // How a campaign reuses the results of a previous one, for a program
+    // which has been rebuilt with small changes.
+    struct Incremental {
+        // Give each fault a key, which identifies it across rebuilds.
+        bool keys = false;
+        // The previous campaign, with its results, if any. The faults whose
+        // key is found there get its effect, rather than being run again.
+        std::string previousResults;
+    };
+
     Faulter(const IndexNavigator &IN, bool verbose,
             const std::string &campaign_filename = "")
         : PAF::MTAnalyzer(IN, verbose), campaignFilename(campaign_filename) {}
 
+    // How the campaign is saved.
+    struct Output {
+        PAF::FI::InjectionCampaign::Format format =
+            PAF::FI::InjectionCampaign::Format::YAML;
+        unsigned numShards = 1;
+        PAF::FI::InjectionCampaign::ShardBy shardBy =
+            PAF::FI::InjectionCampaign::ShardBy::FAULT_ID;
+        // Where to save the checkpoint plan, if any, and the time between
+        // the checkpoints.
+        std::string checkpointFilename;
+        unsigned long checkpointInterval = 10000;
+    };
+
+    void setPruning(const Pruning &P) { pruning = P; }
+    void setCorruption(const Corruption &C) { corruption = C; }
+    void setIncremental(const Incremental &I) { incremental = I; }
+    void setOutput(const Output &O) { output = O; }
+
+    // The factory creating the IndexNavigator used by a planning thread.
+    using NavigatorFactory = std::function<std::unique_ptr<IndexNavigator>()>;
+
+    // Plan the injection ranges concurrently, with up to NumJobs threads (0
+    // meaning as many as the hardware supports), the threads but the first
+    // one getting their IndexNavigator from MakeNavigator. The campaign does
+    // not depend on the number of threads.
+    void setJobs(unsigned NumJobs, NavigatorFactory MakeNavigator) {
+        numJobs = NumJobs;
+        makeNavigator = std::move(MakeNavigator);
+    }
+
     void run(const InjectionRangeSpec &IRS, FaultModel Model,
              const std::string &oracleSpec);
 
   private:
     const std::string campaignFilename;
+    Pruning pruning;
+    Corruption corruption;
+    Incremental incremental;
+    Output output;
+    unsigned numJobs = 1;
+    NavigatorFactory makeNavigator;
 };
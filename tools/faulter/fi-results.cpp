@@ -0,0 +1,232 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/FI/Fault.h"
+#include "PAF/FI/Results.h"
+#include "PAF/utils/Stats.h"
+
+#include "libtarmac/argparse.hh"
+#include "libtarmac/reporter.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::ostream;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+using PAF::ScopedTimer;
+using PAF::Stats;
+using PAF::FI::FaultModelBase;
+using PAF::FI::ResultsIndex;
+
+using Effect = FaultModelBase::Effect;
+using Counts = ResultsIndex::Counts;
+
+unique_ptr<Reporter> reporter = make_cli_reporter();
+
+namespace {
+// The table columns, in the campaign files order, with the faults which
+// have not been run last.
+const Effect Columns[] = {Effect::SUCCESS, Effect::CRASH, Effect::NOEFFECT,
+                          Effect::CAUGHT,  Effect::UNDECIDED, Effect::NONE};
+
+const char *name(Effect e) {
+    const char *n = FaultModelBase::getEffectName(e);
+    return n ? n : "notrun";
+}
+
+void header(ostream &os, const vector<const char *> &keys) {
+    for (const char *k : keys)
+        os << k << '\t';
+    for (const Effect e : Columns)
+        os << name(e) << '\t';
+    os << "total\n";
+}
+
+void row(ostream &os, const Counts &C) {
+    for (const Effect e : Columns)
+        os << C.get(e) << '\t';
+    os << C.total() << '\n';
+}
+
+// Print the rows of table T (key, counts), the most successful attacks
+// first if top is not 0, keeping only the top first rows.
+template <class Key, class KeyPrinter>
+void table(ostream &os, vector<std::pair<Key, const Counts *>> &T,
+           size_t top, KeyPrinter key) {
+    if (top != 0) {
+        std::stable_sort(T.begin(), T.end(), [](const auto &a, const auto &b) {
+            return a.second->get(Effect::SUCCESS) >
+                   b.second->get(Effect::SUCCESS);
+        });
+        if (T.size() > top)
+            T.resize(top);
+    }
+    for (const auto &r : T) {
+        key(os, r.first);
+        row(os, *r.second);
+    }
+}
+
+void address(ostream &os, uint64_t a) {
+    os << "0x" << std::hex << a << std::dec << '\t';
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    enum class Report { SUMMARY, BY_PC, BY_RANGE, BY_FUNCTION, HEATMAP, IDS };
+    Report report = Report::SUMMARY;
+    Effect IdsEffect = Effect::NONE;
+    size_t top = 0;
+    string OutputFilename;
+    vector<string> CampaignFiles;
+
+    Argparse ap("paf-fi-results", argc, argv);
+    ap.optnoval({"--summary"},
+                "print the number of faults with each effect (default)",
+                [&]() { report = Report::SUMMARY; });
+    ap.optnoval({"--by-pc"}, "print the fault effects per faulted address",
+                [&]() { report = Report::BY_PC; });
+    ap.optnoval({"--by-range"}, "print the fault effects per injection range",
+                [&]() { report = Report::BY_RANGE; });
+    ap.optnoval({"--by-function"},
+                "print the fault effects per function, over all its "
+                "invocations",
+                [&]() { report = Report::BY_FUNCTION; });
+    ap.optnoval({"--heatmap"},
+                "print the fault effects per injection range and faulted "
+                "address",
+                [&]() { report = Report::HEATMAP; });
+    ap.optval({"--effect"}, "EFFECT",
+              "print the Ids of the faults with effect EFFECT (success, "
+              "crash, noeffect, caught, undecided or notrun)",
+              [&](const string &s) {
+                  report = Report::IDS;
+                  IdsEffect = FaultModelBase::getEffect(s);
+                  if (IdsEffect == Effect::NONE && s != "notrun")
+                      reporter->errx(EXIT_FAILURE, "Unknown fault effect '%s'",
+                                     s.c_str());
+              });
+    ap.optval({"--top"}, "N",
+              "only print the N rows with the most successful faults",
+              [&](const string &s) { top = std::stoul(s); });
+    ap.optval({"-o", "--output"}, "FILENAME",
+              "write the report to FILENAME instead of the standard output",
+              [&](const string &s) { OutputFilename = s; });
+    ap.positional_multiple(
+        "CAMPAIGN_FILES",
+        "the campaign files (or campaign shards) to aggregate the results of",
+        [&](const string &s) { CampaignFiles.push_back(s); },
+        /* Required: */ true);
+    Stats::addOptions(ap);
+    ap.parse();
+    const ScopedTimer T("paf-fi-results");
+
+    ResultsIndex RI;
+    for (const string &F : CampaignFiles) {
+        string error;
+        if (!RI.add(F, error))
+            reporter->errx(EXIT_FAILURE, "Error reading campaign file '%s': %s",
+                           F.c_str(), error.c_str());
+    }
+
+    std::ofstream ofs;
+    if (!OutputFilename.empty()) {
+        ofs.open(OutputFilename);
+        if (!ofs)
+            reporter->errx(EXIT_FAILURE, "Error opening output file '%s'",
+                           OutputFilename.c_str());
+    }
+    ostream &os = OutputFilename.empty() ? std::cout : ofs;
+
+    const auto &Ranges = RI.getInjectionRanges();
+    switch (report) {
+    case Report::SUMMARY: {
+        // Use the same format as campaign.py --summary.
+        vector<std::pair<string, uint64_t>> S;
+        for (const Effect e : Columns)
+            S.emplace_back(name(e), RI.getTotal().get(e));
+        std::sort(S.begin(), S.end());
+        os << RI.getTotal().total() << " faults: ";
+        for (size_t i = 0; i < S.size(); i++)
+            os << (i ? ", " : "") << S[i].second << ' ' << S[i].first;
+        os << '\n';
+    } break;
+    case Report::BY_PC: {
+        vector<std::pair<uint64_t, const Counts *>> Rows;
+        for (const auto &A : RI.byAddress())
+            Rows.emplace_back(A.first, &A.second);
+        header(os, {"address"});
+        table(os, Rows, top, address);
+    } break;
+    case Report::BY_RANGE: {
+        vector<std::pair<size_t, const Counts *>> Rows;
+        for (size_t r = 0; r < Ranges.size(); r++)
+            Rows.emplace_back(r, &RI.byRange()[r]);
+        if (RI.getOutside().total() != 0)
+            Rows.emplace_back(ResultsIndex::NO_RANGE, &RI.getOutside());
+        header(os, {"range", "start", "end"});
+        table(os, Rows, top, [&](ostream &os, size_t r) {
+            if (r == ResultsIndex::NO_RANGE)
+                os << "-\t-\t-\t";
+            else
+                os << Ranges[r].getName() << '\t' << Ranges[r].getStartTime()
+                   << '\t' << Ranges[r].getEndTime() << '\t';
+        });
+    } break;
+    case Report::BY_FUNCTION: {
+        const auto Functions = RI.byFunction();
+        vector<std::pair<string, const Counts *>> Rows;
+        for (const auto &F : Functions)
+            Rows.emplace_back(F.first, &F.second);
+        header(os, {"function"});
+        table(os, Rows, top,
+              [](ostream &os, const string &f) { os << f << '\t'; });
+    } break;
+    case Report::HEATMAP: {
+        vector<std::pair<std::pair<size_t, uint64_t>, const Counts *>> Rows;
+        for (const auto &RA : RI.byRangeAndAddress())
+            Rows.emplace_back(RA.first, &RA.second);
+        header(os, {"range", "address"});
+        table(os, Rows, top,
+              [&](ostream &os, const std::pair<size_t, uint64_t> &k) {
+                  if (k.first == ResultsIndex::NO_RANGE)
+                      os << "-\t";
+                  else
+                      os << Ranges[k.first].getName() << '\t';
+                  address(os, k.second);
+              });
+    } break;
+    case Report::IDS:
+        for (const uint64_t id : RI.getIds(IdsEffect))
+            os << id << '\n';
+        break;
+    }
+
+    return EXIT_SUCCESS;
+}
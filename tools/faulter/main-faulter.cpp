@@ -20,21 +20,34 @@
 
 #include "faulter.h"
 
+#include "PAF/AnalysisCache.h"
+#include "PAF/utils/Parallel.h"
+#include "PAF/utils/Stats.h"
+
 #include "libtarmac/argparse.hh"
 #include "libtarmac/reporter.hh"
 #include "libtarmac/tarmacutil.hh"
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <libtarmac/index.hh>
+#include <memory>
 #include <string>
 #include <vector>
 
 using std::cout;
+using std::make_unique;
 using std::ostream;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 
+using PAF::AnalysisCache;
+using PAF::FI::InjectionCampaign;
+using PAF::ScopedTimer;
+using PAF::Stats;
+
 namespace {
 
 // Split the function name if we find an '@', which is used a a delimiter to
@@ -121,6 +134,50 @@ unsigned add_window_labels(InjectionRangeSpec &IRS, const string &arg) {
     return cnt;
 }
 
+// Parse a register corruption specification: bitflip, byteset, bytereset
+// or randombits:BITS[:COUNT].
+void parse_corruption(Faulter::Corruption &C, const string &arg) {
+    using Pattern = PAF::FI::CorruptRegDef::Pattern;
+    const string kind = arg.substr(0, arg.find(':'));
+    if (kind == "bitflip")
+        C.pattern = Pattern::BIT_FLIP;
+    else if (kind == "byteset")
+        C.pattern = Pattern::BYTE_SET;
+    else if (kind == "bytereset")
+        C.pattern = Pattern::BYTE_RESET;
+    else if (kind == "randombits")
+        C.pattern = Pattern::RANDOM_BITS;
+    else
+        reporter->errx(EXIT_FAILURE, "Unknown corruption pattern '%s'",
+                       arg.c_str());
+
+    vector<string> params;
+    for (size_t pos = kind.size(); pos < arg.size();) {
+        const size_t next = std::min(arg.find(':', pos + 1), arg.size());
+        params.push_back(arg.substr(pos + 1, next - pos - 1));
+        pos = next;
+    }
+    if (C.pattern != Pattern::RANDOM_BITS) {
+        if (!params.empty())
+            reporter->errx(EXIT_FAILURE,
+                           "Unexpected parameters to corruption pattern '%s'",
+                           arg.c_str());
+        return;
+    }
+    if (params.empty() || params.size() > 2)
+        reporter->errx(EXIT_FAILURE,
+                       "Expecting randombits:BITS[:COUNT], got '%s'",
+                       arg.c_str());
+    C.numBits = stoul(params[0], nullptr, 0);
+    C.count = params.size() > 1 ? stoul(params[1], nullptr, 0) : 1;
+    if (C.numBits == 0 || C.numBits > 64)
+        reporter->errx(EXIT_FAILURE, "Unexpected number of random bits: %u",
+                       C.numBits);
+    if (C.count == 0 || C.count > PAF::FI::CorruptRegDef::MAX_VARIANTS)
+        reporter->errx(EXIT_FAILURE,
+                       "Unexpected number of random patterns: %u", C.count);
+}
+
 void dump(ostream &os, const FunctionSpec &FS) {
     for (const auto &f : FS) {
         os << ' ' << f.first;
@@ -152,6 +209,12 @@ int main(int argc, char **argv) {
     string campaign_filename(""); // Use cout by default.
     InjectionRangeSpec IRS;
     string oracle_spec; // The oracle to use for classifying faults.
+    bool use_analysis_cache = false;
+    Faulter::Pruning pruning;
+    Faulter::Corruption corruption;
+    Faulter::Incremental incremental;
+    Faulter::Output output;
+    unsigned num_jobs = PAF::defaultNumThreads(1);
 
     Argparse ap("paf-faulter", argc, argv);
     TarmacUtility tu;
@@ -161,10 +224,75 @@ int main(int argc, char **argv) {
                 [&]() { fault_model = Faulter::FaultModel::INSTRUCTION_SKIP; });
     ap.optnoval({"--corruptregdef"}, "select CorruptRegDef faultModel",
                 [&]() { fault_model = Faulter::FaultModel::CORRUPT_REG_DEF; });
+    ap.optnoval({"--prune"},
+                "do not inject the faults which provably have no effect "
+                "(skipped NOPs and not executed instructions, corrupted "
+                "registers overwritten before being used)",
+                [&]() { pruning.benign = true; });
+    ap.optnoval({"--fold-equivalent"},
+                "only inject one fault, with a weight, per set of faults in "
+                "identical contexts (same instruction, with the same input "
+                "and output values)",
+                [&]() { pruning.equivalent = true; });
+    ap.optnoval({"--simulate"},
+                "classify the faults whose effect vanishes shortly after "
+                "their injection as having no effect, by replaying the "
+                "reference trace on the faulted state",
+                [&]() { pruning.simulate = true; });
+    ap.optval({"--corruption"}, "PATTERN",
+              "with CorruptRegDef, inject a family of faults per register "
+              "definition: its single bit flips (bitflip), its bytes set "
+              "(byteset) or reset (bytereset), or COUNT (default: 1) "
+              "patterns of BITS random bit flips (randombits:BITS[:COUNT])",
+              [&](const string &s) { parse_corruption(corruption, s); });
+    ap.optnoval({"--keys"},
+                "give each fault a key which identifies it across program "
+                "rebuilds, so that the campaign results can be reused",
+                [&]() { incremental.keys = true; });
+    ap.optval({"--reuse-results"}, "CAMPAIGNFILE",
+              "copy the results of the faults of campaign CAMPAIGNFILE, which "
+              "has been run on a previous build of the program, to the "
+              "faults with the same key (implies --keys)",
+              [&](const string &s) { incremental.previousResults = s; });
     ap.optval({"--output"}, "CAMPAIGNFILE", "campaign file name",
               [&](const string &s) { campaign_filename = s; });
+    ap.optnoval({"--binary"},
+                "save the campaign in the compact binary format, rather than "
+                "in YAML",
+                [&]() { output.format = InjectionCampaign::Format::BINARY; });
+    ap.optval({"--shards"}, "K",
+              "split the campaign into K shards, saved to CAMPAIGNFILE.0 to "
+              "CAMPAIGNFILE.<K-1>",
+              [&](const string &s) {
+                  output.numShards = stoul(s, nullptr, 0);
+              });
+    ap.optnoval({"--shard-by-range"},
+                "do not split the faults of an injection range over several "
+                "shards",
+                [&]() {
+                    output.shardBy =
+                        InjectionCampaign::ShardBy::INJECTION_RANGE;
+                });
+    ap.optval({"--checkpoint-plan"}, "FILE",
+              "save to FILE a plan of checkpoints from which the faults can "
+              "be run, rather than from the program start",
+              [&](const string &s) { output.checkpointFilename = s; });
+    ap.optval({"--checkpoint-interval"}, "TIME",
+              "the minimum time between two checkpoints (default: 10000)",
+              [&](const string &s) {
+                  output.checkpointInterval = stoul(s, nullptr, 0);
+              });
+    ap.optval({"-j", "--jobs"}, "N",
+              "plan the injection ranges with up to N threads (default: "
+              "$PAF_NUM_THREADS, or 1; 0 uses as many threads as the "
+              "hardware supports)",
+              [&](const string &s) { num_jobs = stoul(s, nullptr, 0); });
     ap.optval({"--oracle"}, "ORACLESPEC", "oracle specification",
               [&](const string &s) { oracle_spec = s; });
+    ap.optnoval({"--analysis-cache"},
+                "save the injection ranges found in the trace to a cache file "
+                "next to its index, and reuse them in later runs",
+                [&]() { use_analysis_cache = true; });
     ap.optval(
         {"--window-labels"}, "WINDOW,LABEL[,LABEL+]",
         "a pair of labels that delimit the region where to inject faults.",
@@ -227,7 +355,9 @@ int main(int argc, char **argv) {
             IRS.kind = InjectionRangeSpec::FUNCTIONS;
         });
 
+    Stats::addOptions(ap);
     ap.parse();
+    const ScopedTimer T("paf-faulter");
     tu.setup();
 
     // Check arguments sanity.
@@ -236,6 +366,16 @@ int main(int argc, char **argv) {
                        "Missing injection range specification (--functions or "
                        "--label-pair)");
 
+    if (campaign_filename.empty() &&
+        (output.format == InjectionCampaign::Format::BINARY ||
+         output.numShards != 1))
+        reporter->errx(EXIT_FAILURE,
+                       "The binary format and the shards require --output");
+    if (output.numShards == 0)
+        reporter->errx(EXIT_FAILURE, "Unexpected number of shards: 0");
+    if (output.checkpointInterval == 0)
+        reporter->errx(EXIT_FAILURE, "Unexpected checkpoint interval: 0");
+
     if (IRS.kind == InjectionRangeSpec::FUNCTIONS && IRS.included.size() == 0)
         reporter->errx(EXIT_FAILURE, "Missing function specification");
 
@@ -298,6 +438,21 @@ int main(int argc, char **argv) {
     // The real workload.
     IndexNavigator IN(tu.trace, tu.image_filename);
     Faulter F(IN, tu.is_verbose(), campaign_filename);
+    unique_ptr<AnalysisCache> AC;
+    if (use_analysis_cache) {
+        AC = make_unique<AnalysisCache>(tu.trace, tu.image_filename);
+        if (!AC->good())
+            reporter->warn("Ignoring analysis cache '%s': %s",
+                           AC->getFilename().c_str(), AC->error());
+        F.setAnalysisCache(AC.get());
+    }
+    F.setPruning(pruning);
+    F.setCorruption(corruption);
+    F.setIncremental(incremental);
+    F.setOutput(output);
+    // The planning threads do not need the image.
+    F.setJobs(num_jobs,
+              [&]() { return make_unique<IndexNavigator>(tu.trace, ""); });
     F.run(IRS, fault_model, oracle_spec);
 
     return 0;
@@ -18,62 +18,71 @@
  * This file is part of PAF, the Physical Attack Framework.
  */
 
-#include "PAF/Intervals.h"
 #include "PAF/Memory.h"
 #include "PAF/PAF.h"
+#include "PAF/SCA/Dumper.h"
+#include "PAF/utils/Stats.h"
 
 #include "libtarmac/argparse.hh"
 #include "libtarmac/reporter.hh"
 #include "libtarmac/tarmacutil.hh"
 #include <libtarmac/index.hh>
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 using std::cout;
+using std::make_unique;
 using std::ostream;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::unordered_map;
 using std::vector;
 
-using PAF::AccessedMemory;
 using PAF::EmptyHandler;
 using PAF::FromTraceBuilder;
-using PAF::Interval;
-using PAF::Intervals;
 using PAF::MemoryAccess;
 using PAF::ReferenceInstruction;
+using PAF::SCA::BinaryMemoryAccessesDumper;
+using PAF::SCA::MemoryAccessesDumper;
+using PAF::SCA::YAMLMemoryAccessesDumper;
+using PAF::ScopedTimer;
+using PAF::ShadowMemory;
+using PAF::Stats;
 
 namespace {
 
 class MemoryAccesses {
   public:
-    MemoryAccesses(AccessedMemory &am, const vector<Segment> &segments,
-                   bool verbose, bool checkMemoryReads)
-        : writtenMemory(am), verbose(verbose),
+    MemoryAccesses(ShadowMemory &writtenMemory,
+                   const vector<Segment> &segments, bool verbose,
+                   bool checkMemoryReads, MemoryAccessesDumper &MADumper)
+        : writtenMemory(writtenMemory), MADumper(MADumper), verbose(verbose),
           checkMemoryReads(checkMemoryReads) {
-        initialized_segments.reserve(segments.size());
-        for (const auto &segment : segments)
-            if (segment.readable)
-                initialized_segments.push_back(AccessedMemory::makeInterval(
-                    segment.addr, segment.filesize, true));
+        if (checkMemoryReads)
+            for (const auto &segment : segments)
+                if (segment.readable)
+                    initializedMemory.mark(segment.addr, segment.filesize);
     }
 
     /// Record memory writes & optionally check memory reads.
     void add(const MemoryAccess &ma, const string &disas, Addr pc, Time time) {
         if (checkMemoryReads && ma.access == MemoryAccess::Type::READ) {
-            if (!is_location_initialized(
-                    AccessedMemory::makeInterval(ma.addr, ma.size))) {
+            if (!initializedMemory.isMarked(ma.addr, ma.size)) {
                 numUndefinedReads++;
-                reporter->warnx(
-                    "WARNING: read of size %llu from undefined memory "
-                    "location at 0x%llx from instruction '%s' at pc=0x%llx "
-                    "(time %llu)",
-                    ma.size, ma.addr, disas.c_str(), pc, time);
+                auto &UR = undefinedReads[pc];
+                if (UR.count++ == 0) {
+                    UR.disassembly = disas;
+                    UR.time = time;
+                    UR.addr = ma.addr;
+                    UR.size = ma.size;
+                }
             }
         }
 
@@ -83,45 +92,70 @@ class MemoryAccesses {
                      << " to address 0x" << std::hex << ma.addr << std::dec
                      << '\n';
             }
-            writtenMemory.add(
-                AccessedMemory::makeInterval(ma.addr, ma.size, true));
+            writtenMemory.mark(ma.addr, ma.size);
+            if (checkMemoryReads)
+                initializedMemory.mark(ma.addr, ma.size);
         }
     }
 
     void operator()(const ReferenceInstruction &Inst) {
         for (const auto &ma : Inst.memAccess)
             add(ma, Inst.disassembly, Inst.pc, Inst.time);
+        if (MADumper.enabled())
+            MADumper.dump(Inst.pc, Inst.memAccess);
     }
 
     [[nodiscard]] size_t getNumUndefinedReads() const {
         return numUndefinedReads;
     }
 
+    /// Report the reads from undefined memory locations, aggregated by
+    /// instruction, in the order the instructions first performed one.
+    void reportUndefinedReads() const {
+        vector<std::pair<Addr, const UndefinedReads *>> URs;
+        URs.reserve(undefinedReads.size());
+        for (const auto &ur : undefinedReads)
+            URs.emplace_back(ur.first, &ur.second);
+        std::sort(URs.begin(), URs.end(), [](const auto &lhs, const auto &rhs) {
+            return lhs.second->time < rhs.second->time;
+        });
+        for (const auto &[pc, UR] : URs)
+            reporter->warnx(
+                "WARNING: %llu read(s) from undefined memory locations from "
+                "instruction '%s' at pc=0x%llx, the first one of size %llu at "
+                "0x%llx (time %llu)",
+                (unsigned long long)UR->count, UR->disassembly.c_str(),
+                (unsigned long long)pc, (unsigned long long)UR->size,
+                (unsigned long long)UR->addr, (unsigned long long)UR->time);
+    }
+
   private:
-    vector<AccessedMemory::Interval> initialized_segments;
-    AccessedMemory &writtenMemory;
+    // The reads from undefined memory locations performed by an instruction.
+    struct UndefinedReads {
+        size_t count = 0;
+        // The first read details.
+        string disassembly;
+        Time time = 0;
+        Addr addr = 0;
+        size_t size = 0;
+    };
+
+    // The memory locations which have been initialized, either from the
+    // image segments or by a write.
+    ShadowMemory initializedMemory;
+    ShadowMemory &writtenMemory;
+    MemoryAccessesDumper &MADumper;
+    unordered_map<Addr, UndefinedReads> undefinedReads;
     size_t numUndefinedReads = 0;
     bool verbose = false;
     bool checkMemoryReads = false;
-
-    [[nodiscard]] bool
-    is_location_initialized(const AccessedMemory::Interval &I) const {
-        // Is this access contained in any of the initialized memory segment ?
-        for (const auto &segment : initialized_segments)
-            if (segment.contains(I))
-                return true;
-
-        // If not, is it contained in any of the memory intervals that have been
-        // written to ?
-        return writtenMemory.contains(I);
-    }
 };
 
 class MemInstrBuilder {
   public:
     /// Handler for instruction events.
     void event(ReferenceInstruction &Instr, const InstructionEvent &ev) {
-        Instr = ReferenceInstruction(ev);
+        Instr.reset(ev);
     }
     /// Handler for memory events.
     void event(ReferenceInstruction &Instr, const MemoryEvent &ev) {
@@ -141,17 +175,20 @@ class MemAnalyzer : public PAF::MTAnalyzer {
         : MTAnalyzer(index, verbosity) {}
 
     unsigned analyze(const PAF::ExecutionRange &ER, bool checkMemoryReads,
-                     bool dumpInfo) {
+                     bool dumpInfo, MemoryAccessesDumper &MADumper) {
         vector<Segment> segments;
         if (auto image = indexNavigator.get_image(); image)
             segments = image->get_segments();
 
-        AccessedMemory writtenMemory;
+        ShadowMemory writtenMemory;
         MemoryAccesses MA(writtenMemory, segments, this->verbose(),
-                          checkMemoryReads);
+                          checkMemoryReads, MADumper);
         FromTraceBuilder<ReferenceInstruction, MemInstrBuilder, MemoryAccesses>
             FTB(indexNavigator);
+        FTB.setPipelineDepth(FTB.PIPELINE_DEPTH);
         FTB.build(ER, MA);
+        if (checkMemoryReads)
+            MA.reportUndefinedReads();
 
         if (dumpInfo) {
             if (!segments.empty()) {
@@ -178,12 +215,10 @@ class MemAnalyzer : public PAF::MTAnalyzer {
                 cout << "No image segments.\n";
             }
             cout << "Written memory intervals:\n";
-            for (const auto &interval : writtenMemory) {
-                cout << " - [0x" << std::hex << interval.beginValue() << ":0x"
-                     << (interval.endValue()) << "( (" << std::dec
-                     << (interval.endValue() - interval.beginValue())
-                     << " bytes)\n";
-            }
+            writtenMemory.forEachInterval([](Addr begin, Addr end) {
+                cout << " - [0x" << std::hex << begin << ":0x" << end << "( ("
+                     << std::dec << (end - begin) << " bytes)\n";
+            });
         }
 
         return checkMemoryReads ? MA.getNumUndefinedReads() : 0;
@@ -197,6 +232,9 @@ unique_ptr<Reporter> reporter = make_cli_reporter();
 int main(int argc, char **argv) {
     bool dumpInfo = true;
     bool checkMemoryReads = false;
+    string memoryAccessesTraceFileName;
+    bool binaryFormat = false;
+    bool compressedFormat = false;
 
     Argparse ap("paf-memory-accesses", argc, argv);
     ap.optnoval({"--check-memory-reads"},
@@ -205,13 +243,41 @@ int main(int argc, char **argv) {
     ap.optnoval({"--no-dump-info"},
                 "do not dump the accessed memory and elf segments",
                 [&]() { dumpInfo = false; });
+    ap.optval({"--memory-accesses-trace"}, "FILENAME",
+              "dump a trace of memory accesses to FILENAME",
+              [&](const string &fileName) {
+                  memoryAccessesTraceFileName = fileName;
+              });
+    ap.optval({"--format"}, "FORMAT",
+              "format of the memory accesses trace: yaml, bin or bin.gz "
+              "(default: yaml)",
+              [&](const string &s) {
+                  if (s == "yaml") {
+                      binaryFormat = false;
+                  } else if (s == "bin" || s == "bin.gz") {
+                      binaryFormat = true;
+                      compressedFormat = s == "bin.gz";
+                  } else
+                      reporter->errx(EXIT_FAILURE,
+                                     "Unknown trace format '%s'", s.c_str());
+              });
 
     TarmacUtilityMT tu;
     tu.add_options(ap);
 
+    Stats::addOptions(ap);
     ap.parse();
+    const ScopedTimer T("paf-memory-accesses");
     tu.setup();
 
+    unique_ptr<MemoryAccessesDumper> MADumper;
+    if (binaryFormat)
+        MADumper = make_unique<BinaryMemoryAccessesDumper>(
+            memoryAccessesTraceFileName, compressedFormat);
+    else
+        MADumper =
+            make_unique<YAMLMemoryAccessesDumper>(memoryAccessesTraceFileName);
+
     bool errors = false;
     for (const auto &trace : tu.traces) {
         if (tu.is_verbose()) {
@@ -224,7 +290,8 @@ int main(int argc, char **argv) {
         PAF::ExecutionRange FullRange = MA.getFullExecutionRange();
 
         unsigned numUndefinedReads =
-            MA.analyze(FullRange, checkMemoryReads, dumpInfo);
+            MA.analyze(FullRange, checkMemoryReads, dumpInfo, *MADumper);
+        MADumper->nextTrace();
 
         if (checkMemoryReads && numUndefinedReads > 0) {
             errors = true;
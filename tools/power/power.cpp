@@ -20,22 +20,31 @@
  */
 
 #include "PAF/SCA/Power.h"
+#include "PAF/AnalysisCache.h"
 #include "PAF/ArchInfo.h"
 #include "PAF/PAF.h"
 #include "PAF/SCA/Dumper.h"
+#include "PAF/SCA/MetricsPowerDumper.h"
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/NPYStreamWriter.h"
 #include "PAF/SCA/Noise.h"
 #include "PAF/utils/Misc.h"
+#include "PAF/utils/Parallel.h"
+#include "PAF/utils/Stats.h"
 
 #include "libtarmac/argparse.hh"
 #include "libtarmac/reporter.hh"
 #include "libtarmac/tarmacutil.hh"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -45,28 +54,40 @@ using std::ifstream;
 using std::make_unique;
 using std::map;
 using std::pair;
+using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
 
+using PAF::AnalysisCache;
 using PAF::ExecutionRange;
 using PAF::split;
+using PAF::SCA::BinaryInstrDumper;
+using PAF::SCA::BinaryMemoryAccessesDumper;
+using PAF::SCA::BinaryRegBankDumper;
+using PAF::SCA::BinaryTimingInfo;
 using PAF::SCA::CSVPowerDumper;
 using PAF::SCA::InstrDumper;
 using PAF::SCA::MemoryAccessesDumper;
+using PAF::SCA::MetricsPowerDumper;
 using PAF::SCA::NoiseSource;
+using PAF::SCA::NPArrayBase;
 using PAF::SCA::NPYPowerDumper;
 using PAF::SCA::NPYRegBankDumper;
+using PAF::SCA::NPYStreamWriter;
 using PAF::SCA::PowerAnalysisConfig;
 using PAF::SCA::PowerAnalyzer;
 using PAF::SCA::PowerDumper;
 using PAF::SCA::PowerTrace;
 using PAF::SCA::PowerTraceConfig;
+using PAF::SCA::PowerTraceRecorder;
 using PAF::SCA::RegBankDumper;
 using PAF::SCA::TimingInfo;
 using PAF::SCA::YAMLInstrDumper;
 using PAF::SCA::YAMLMemoryAccessesDumper;
 using PAF::SCA::YAMLTimingInfo;
+using PAF::ScopedTimer;
+using PAF::Stats;
 
 unique_ptr<Reporter> reporter = make_cli_reporter();
 
@@ -101,6 +122,79 @@ class AnalysisRangeSpecifier {
     pair<string, string> markers;
 };
 
+// An IndexNavigator using an already loaded image, so that the image and its
+// symbols are only loaded once, whatever the number of traces analyzed.
+class SharedImageNavigator : public IndexNavigator {
+  public:
+    SharedImageNavigator(const TracePair &trace, shared_ptr<Image> img)
+        : IndexNavigator(trace, "") {
+        image = std::move(img);
+    }
+};
+
+// Create the least powerful Oracle that is required. The state is tracked
+// along the traces, so that the index is only queried for the initial state.
+unique_ptr<PowerTrace::Oracle> makeOracle(const PowerAnalyzer &PA,
+                                          const PAF::ArchInfo &CPU,
+                                          bool needsMTAOracle) {
+    if (!needsMTAOracle)
+        return make_unique<PowerTrace::Oracle>();
+    return make_unique<PowerTrace::ShadowOracle>(
+        make_unique<PowerTrace::MTAOracle>(PA, CPU), CPU, PA.isBigEndian());
+}
+
+// The state needed for analyzing a trace.
+struct TraceAnalysis {
+    SharedImageNavigator IN;
+    PowerAnalyzer PA;
+    unique_ptr<PAF::ArchInfo> CPU;
+    unique_ptr<PowerTrace::Oracle> oracle;
+
+    TraceAnalysis(const TracePair &trace, const shared_ptr<Image> &image,
+                  bool needsMTAOracle)
+        : IN(trace, image), PA(IN), CPU(PAF::getCPU(IN.index)),
+          oracle(makeOracle(PA, *CPU, needsMTAOracle)) {}
+};
+
+// Get the execution ranges to analyze in the trace analyzed by PA.
+vector<ExecutionRange> getExecutionRanges(const PowerAnalyzer &PA,
+                                          const AnalysisRangeSpecifier &ARS) {
+    switch (ARS.getKind()) {
+    case AnalysisRangeSpecifier::FUNCTION:
+        return PA.getInstances(ARS.getFunctionName());
+    case AnalysisRangeSpecifier::FUNCTION_MARKERS: {
+        const auto &markers = ARS.getMarkers();
+        return PA.getBetweenFunctionMarkers(markers.first, markers.second);
+    }
+    case AnalysisRangeSpecifier::NOT_SET:
+        break;
+    }
+    return {};
+}
+
+// Get the execution ranges to analyze in trace, analyzed by PA, using the
+// trace's analysis cache if useCache is set.
+vector<ExecutionRange> getExecutionRanges(PowerAnalyzer &PA,
+                                          const AnalysisRangeSpecifier &ARS,
+                                          const TracePair &trace,
+                                          const string &image_filename,
+                                          bool useCache) {
+    if (!useCache)
+        return getExecutionRanges(PA, ARS);
+
+    AnalysisCache AC(trace, image_filename);
+    if (!AC.good())
+        reporter->warn("Ignoring analysis cache '%s': %s",
+                       AC.getFilename().c_str(), AC.error());
+    PA.setAnalysisCache(&AC);
+    vector<ExecutionRange> ERS = getExecutionRanges(PA, ARS);
+    PA.setAnalysisCache(nullptr);
+    if (!AC.save())
+        reporter->warn("Can not save analysis cache '%s': %s",
+                       AC.getFilename().c_str(), AC.error());
+    return ERS;
+}
+
 enum class FileFormat : uint8_t { UNKNOWN, CSV, NPY };
 
 FileFormat getFileFormat(const string &fileName) {
@@ -124,21 +218,69 @@ FileFormat getFileFormat(const string &fileName) {
 int main(int argc, char **argv) {
 
     bool detailedOutput = false;
+    NPYPowerDumper::DType outputDType = NPYPowerDumper::DType::DOUBLE;
+    double outputScale = 1.0;
 
     bool dontAddNoise = false;
     double noiseLevel = 1.0;
     NoiseSource::Type noiseTy = NoiseSource::NORMAL;
+    bool withNoiseSeed = false;
+    uint64_t noiseSeed = 0;
+    unsigned realizations = 1;
 
     vector<PowerTraceConfig::Selection> PTSelect;
     AnalysisRangeSpecifier ARS;
 
+    // The window of the execution ranges to analyze, optionally relative to
+    // the first execution of a label.
+    PowerTraceConfig::Window window;
+    string windowLabel;
+    const auto parseWindow = [&](PowerTraceConfig::Window::Unit unit,
+                                 const string &s) {
+        const vector<string> bounds = split(',', s);
+        if (bounds.empty() || bounds.size() > 2)
+            reporter->errx(EXIT_FAILURE, "Bogus window specification '%s'",
+                           s.c_str());
+        const size_t begin = stoul(bounds[0], nullptr, 0);
+        const size_t end = bounds.size() == 2
+                               ? stoul(bounds[1], nullptr, 0)
+                               : std::numeric_limits<size_t>::max();
+        if (begin >= end)
+            reporter->errx(EXIT_FAILURE,
+                           "Bogus window specification '%s', BEGIN must be "
+                           "strictly lower than END",
+                           s.c_str());
+        window = PowerTraceConfig::Window(unit, begin, end);
+    };
+
     string timingFileName;
     string regBankTraceFileName;
+    bool compactRegBankTrace = false;
     string memoryAccessesTraceFileName;
     string instructionTraceFileName;
+    // Emit the timing, memory accesses and instruction traces in the binary
+    // trace format rather than in yaml, possibly compressed.
+    bool binaryFormat = false;
+    bool compressedFormat = false;
 
     map<PowerAnalysisConfig::PowerModel, string> analyses;
 
+    unsigned num_jobs = PAF::defaultNumThreads(1);
+    bool useAnalysisCache = false;
+
+    // Analyze the tarmac trace lines streamed from a file or a pipe, instead
+    // of indexed trace files.
+    string streamFileName;
+    bool streamAArch64 = false;
+
+    // The values associated to each trace in the manifest.
+    map<string, vector<uint32_t>> manifestData;
+    string manifestDataFileName;
+
+    // Analyze the power traces in process, instead of storing them.
+    vector<string> tTestExprs;
+    vector<string> correlExprs;
+
     Argparse ap("paf-power", argc, argv);
     ap.optnoval({"--no-noise"}, "Do not add noise to the power trace", [&]() {
         dontAddNoise = true;
@@ -149,6 +291,17 @@ int main(int argc, char **argv) {
               [&](const string &s) { noiseLevel = stod(s); });
     ap.optnoval({"--uniform-noise"}, "Use a uniform distribution noise source",
                 [&]() { noiseTy = NoiseSource::UNIFORM; });
+    ap.optval({"--realizations"}, "K",
+              "Emit K power traces, each with its own noise, per analyzed "
+              "execution (default: 1)",
+              [&](const string &s) { realizations = stoul(s, nullptr, 0); });
+    ap.optval({"--noise-seed"}, "SEED",
+              "Seed the noise sources with SEED, for reproducible traces "
+              "whatever the number of jobs (default: randomly seeded)",
+              [&](const string &s) {
+                  withNoiseSeed = true;
+                  noiseSeed = stoull(s, nullptr, 0);
+              });
     ap.optval(
         {"--hamming-weight"}, "FILENAME", "Use the Hamming Weight power model",
         [&](const string &fileName) {
@@ -181,17 +334,50 @@ int main(int argc, char **argv) {
               [&](const string &fileName) { timingFileName = fileName; });
     ap.optval(
         {"--regbank-trace"}, "FILENAME",
-        "Dump a trace of the register bank content in numpy format to FILENAME",
+        "Dump a trace of the register bank content to FILENAME",
         [&](const string &fileName) { regBankTraceFileName = fileName; });
+    ap.optnoval({"--compact-regbank-trace"},
+                "Store the registers with the architecture register width in "
+                "the register bank trace in numpy format (e.g. uint32 for "
+                "Arm V7M)",
+                [&]() { compactRegBankTrace = true; });
     ap.optval({"--memory-accesses-trace"}, "FILENAME",
-              "Dump a trace of memory accesses in yaml format to FILENAME",
+              "Dump a trace of memory accesses to FILENAME",
               [&](const string &fileName) {
                   memoryAccessesTraceFileName = fileName;
               });
     ap.optval(
         {"--instruction-trace"}, "FILENAME",
-        "Dump an instruction trace in yaml format to FILENAME",
+        "Dump an instruction trace to FILENAME",
         [&](const string &fileName) { instructionTraceFileName = fileName; });
+    ap.optval({"--format"}, "FORMAT",
+              "Format of the timing, memory accesses, instruction and "
+              "register bank traces: yaml (numpy for the register bank), bin "
+              "or bin.gz (default: yaml)",
+              [&](const string &s) {
+                  if (s == "yaml") {
+                      binaryFormat = false;
+                  } else if (s == "bin" || s == "bin.gz") {
+                      binaryFormat = true;
+                      compressedFormat = s == "bin.gz";
+                  } else
+                      reporter->errx(EXIT_FAILURE,
+                                     "Unknown trace format '%s'", s.c_str());
+              });
+    ap.optval({"--dtype"}, "ELT_TYPE",
+              "Element type of the power traces in numpy format: u1, u2, f4 "
+              "or f8 (default: f8)",
+              [&](const string &s) {
+                  if (!NPYPowerDumper::getDType(outputDType, s))
+                      reporter->errx(EXIT_FAILURE,
+                                     "Unsupported element type '%s'",
+                                     s.c_str());
+              });
+    ap.optval({"--output-scale"}, "FACTOR",
+              "Multiply the power samples by FACTOR before converting them to "
+              "the element type of the power traces in numpy format (default: "
+              "1.0)",
+              [&](const string &s) { outputScale = stod(s); });
     ap.optnoval({"--detailed-output"},
                 "Emit more detailed information in the CSV file",
                 [&]() { detailedOutput = true; });
@@ -253,6 +439,24 @@ int main(int argc, char **argv) {
     ap.optval({"--function"}, "FUNCTION",
               "Analyze code running within FUNCTION",
               [&](const string &s) { ARS.setFunction(s); });
+    ap.optval({"--window-cycles"}, "BEGIN[,END]",
+              "Only compute and dump the power (and the timing, register "
+              "bank, memory accesses and instruction traces) for the cycles "
+              "[BEGIN, END( of each execution range",
+              [&](const string &s) {
+                  parseWindow(PowerTraceConfig::Window::CYCLES, s);
+              });
+    ap.optval({"--window-instructions"}, "BEGIN[,END]",
+              "Only compute and dump the power (and the timing, register "
+              "bank, memory accesses and instruction traces) for the "
+              "instructions [BEGIN, END( of each execution range",
+              [&](const string &s) {
+                  parseWindow(PowerTraceConfig::Window::INSTRUCTIONS, s);
+              });
+    ap.optval({"--window-label"}, "LABEL",
+              "Count the --window-cycles or --window-instructions bounds from "
+              "the first execution of LABEL in each execution range",
+              [&](const string &s) { windowLabel = s; });
     ap.optval({"--via-file"}, "FILE", "Read command line arguments from FILE",
               [&](const string &filename) {
                   ifstream viafile(filename.c_str());
@@ -272,6 +476,66 @@ int main(int argc, char **argv) {
                       words.pop_back();
                   }
               });
+    ap.optval(
+        {"--manifest"}, "FILE",
+        "Analyze the trace files listed in FILE, one per line, each optionally "
+        "followed by integer values (e.g. its inputs or keys)",
+        [&](const string &filename) {
+            ifstream manifest(filename.c_str());
+            if (!manifest)
+                reporter->errx(EXIT_FAILURE, "Error opening manifest '%s'",
+                               filename.c_str());
+            vector<string> traces;
+            string line;
+            while (std::getline(manifest, line)) {
+                std::istringstream is(line);
+                string trace;
+                if (!(is >> trace) || trace[0] == '#')
+                    continue;
+                vector<uint32_t> values;
+                string value;
+                while (is >> value) {
+                    const unsigned long long v = stoull(value, nullptr, 0);
+                    if (v > std::numeric_limits<uint32_t>::max())
+                        reporter->errx(EXIT_FAILURE,
+                                       "Value '%s' of trace '%s' does not fit "
+                                       "in 32 bits",
+                                       value.c_str(), trace.c_str());
+                    values.push_back(v);
+                }
+                if (!manifestData.empty() &&
+                    manifestData.begin()->second.size() != values.size())
+                    reporter->errx(EXIT_FAILURE,
+                                   "Inconsistent number of values for trace "
+                                   "'%s' in manifest '%s'",
+                                   trace.c_str(), filename.c_str());
+                if (!manifestData.emplace(trace, std::move(values)).second)
+                    reporter->errx(EXIT_FAILURE,
+                                   "Duplicate trace '%s' in manifest '%s'",
+                                   trace.c_str(), filename.c_str());
+                traces.push_back(trace);
+            }
+            while (!traces.empty()) {
+                ap.prepend_cmdline_word(traces.back());
+                traces.pop_back();
+            }
+        });
+    ap.optval({"--manifest-data"}, "FILE",
+              "Save the values from the manifest to FILE, in NPY format, with "
+              "one row per power trace",
+              [&](const string &s) { manifestDataFileName = s; });
+    ap.optval({"--t-test"}, "EXPR",
+              "Do not store the power traces, but compute the t-test of the "
+              "traces classified by EXPR, evaluated on the manifest values "
+              "($in), and save the t-values to the power model output file "
+              "(can be used multiple times)",
+              [&](const string &s) { tTestExprs.push_back(s); });
+    ap.optval({"--correl"}, "EXPR",
+              "Do not store the power traces, but compute their correlation "
+              "with EXPR, evaluated on the manifest values ($in), and save "
+              "the correlation coefficients to the power model output file "
+              "(can be used multiple times)",
+              [&](const string &s) { correlExprs.push_back(s); });
     ap.optval(
         {"--between-functions"}, "FUNCTION_START,FUNCTION_END",
         "Analyze code between FUNCTION_START return and FUNCTION_END call",
@@ -294,9 +558,28 @@ int main(int argc, char **argv) {
             }
         });
 
+    ap.optval({"-j", "--jobs"}, "N",
+              "Analyze up to N traces or execution ranges concurrently "
+              "(default: $PAF_NUM_THREADS, or 1; 0 uses as many threads as "
+              "the hardware supports)",
+              [&](const string &s) { num_jobs = stoul(s, nullptr, 0); });
+    ap.optval({"--stream"}, "FILE",
+              "Analyze the tarmac trace lines streamed from FILE (e.g. a "
+              "named pipe fed by the model, or - for stdin) as a single power "
+              "trace, without any trace file nor index",
+              [&](const string &s) { streamFileName = s; });
+    ap.optnoval({"--stream-aarch64"},
+                "The streamed trace is an AArch64 trace (default: Arm V7M)",
+                [&]() { streamAArch64 = true; });
+    ap.optnoval({"--analysis-cache"},
+                "Save the execution ranges found in each trace to a cache "
+                "file next to its index, and reuse them in later runs",
+                [&]() { useAnalysisCache = true; });
+
     TarmacUtilityMT tu;
     tu.add_options(ap);
 
+    Stats::addOptions(ap);
     ap.parse([&]() {
         if (analyses.empty())
             reporter->errx(EXIT_FAILURE,
@@ -306,9 +589,65 @@ int main(int argc, char **argv) {
             if (a.second.empty())
                 reporter->errx(EXIT_FAILURE, "Output file name for power model "
                                              "analysis can not be empty");
+        if (realizations == 0)
+            reporter->errx(EXIT_FAILURE,
+                           "The number of realizations must be at least 1");
+        if (!streamFileName.empty()) {
+            if (ARS.getKind() != AnalysisRangeSpecifier::NOT_SET)
+                reporter->errx(EXIT_FAILURE,
+                               "--function or --between-functions can not be "
+                               "used with --stream, the whole stream is "
+                               "analyzed");
+            if (!manifestDataFileName.empty())
+                reporter->errx(EXIT_FAILURE,
+                               "--manifest-data can not be used with "
+                               "--stream");
+            if (!windowLabel.empty())
+                reporter->errx(EXIT_FAILURE,
+                               "--window-label can not be used with "
+                               "--stream, as there is no image to look the "
+                               "label up");
+        } else if (ARS.getKind() == AnalysisRangeSpecifier::NOT_SET)
+            reporter->errx(EXIT_FAILURE,
+                           "Analysis range not specified, use one of "
+                           "--function or --between-functions");
     });
+    const ScopedTimer T("paf-power");
     tu.setup();
 
+    // A streamed trace comes without an index to tell its architecture.
+    unique_ptr<PAF::ArchInfo> streamCPU;
+    if (!streamFileName.empty()) {
+        if (!tu.traces.empty())
+            reporter->errx(EXIT_FAILURE,
+                           "Trace files can not be used with --stream");
+        if (streamAArch64)
+            streamCPU = make_unique<PAF::V8AInfo>();
+        else
+            streamCPU = make_unique<PAF::V7MInfo>();
+    }
+    const size_t numTraces = streamCPU ? 1 : tu.traces.size();
+
+    // The values from the manifest, saved for each power trace.
+    unique_ptr<NPYStreamWriter<uint32_t>> manifestDataWriter;
+    if (!manifestDataFileName.empty()) {
+        if (manifestData.empty() || manifestData.begin()->second.empty())
+            reporter->errx(EXIT_FAILURE, "No values found in the manifest");
+        for (const auto &trace : tu.traces)
+            if (manifestData.count(trace.tarmac_filename) == 0)
+                reporter->errx(EXIT_FAILURE,
+                               "No values for trace '%s' in the manifest",
+                               trace.tarmac_filename.c_str());
+        manifestDataWriter = make_unique<NPYStreamWriter<uint32_t>>(
+            manifestDataFileName, manifestData.begin()->second.size());
+        if (!manifestDataWriter->good())
+            reporter->errx(EXIT_FAILURE, "Error opening file '%s': %s",
+                           manifestDataFileName.c_str(),
+                           manifestDataWriter->error());
+    }
+
+    NPArrayBase::setNumThreads(num_jobs);
+
     PowerTraceConfig PTConfig;
     // Process the contributions sources if any. Default to all of them if
     // none was specified.
@@ -320,9 +659,34 @@ int main(int argc, char **argv) {
 
     vector<PowerAnalysisConfig> PAConfigs;
     PAConfigs.reserve(analyses.size());
+    // The power dumpers computing the metrics in process, if any, with their
+    // output file names.
+    vector<pair<MetricsPowerDumper *, string>> metricsDumpers;
+    const size_t numData =
+        manifestData.empty() ? 0 : manifestData.begin()->second.size();
     for (const auto &a : analyses) {
         const PowerAnalysisConfig::PowerModel &pwrModel = a.first;
         const string &outputFileName = a.second;
+        if (!tTestExprs.empty() || !correlExprs.empty()) {
+            if (getFileFormat(outputFileName) != FileFormat::NPY)
+                reporter->errx(EXIT_FAILURE,
+                               "The metrics can only be saved in NPY format "
+                               "('%s')",
+                               outputFileName.c_str());
+            auto dumper = make_unique<MetricsPowerDumper>(
+                outputFileName, tTestExprs, correlExprs, numData);
+            if (!dumper->good())
+                reporter->errx(EXIT_FAILURE, "Error with the metrics for '%s' "
+                                             "(%s)",
+                               outputFileName.c_str(), dumper->error());
+            metricsDumpers.emplace_back(dumper.get(), outputFileName);
+            PAConfigs.emplace_back(pwrModel, std::move(dumper), noiseTy,
+                                   noiseLevel);
+            if (dontAddNoise)
+                PAConfigs.back().setWithoutNoise();
+            PAConfigs.back().setRealizations(realizations);
+            continue;
+        }
         switch (getFileFormat(outputFileName)) {
         case FileFormat::UNKNOWN:
             reporter->errx(
@@ -338,85 +702,280 @@ int main(int argc, char **argv) {
         case FileFormat::NPY:
             PAConfigs.emplace_back(
                 pwrModel,
-                make_unique<NPYPowerDumper>(outputFileName, tu.traces.size()),
+                make_unique<NPYPowerDumper>(outputFileName,
+                                            numTraces * realizations,
+                                            outputDType, outputScale),
                 noiseTy, noiseLevel);
             break;
         }
         if (dontAddNoise)
             PAConfigs.back().setWithoutNoise();
+        PAConfigs.back().setRealizations(realizations);
     }
 
     // Timing information.
-    auto timing = make_unique<YAMLTimingInfo>();
+    unique_ptr<TimingInfo> timing;
+    if (binaryFormat)
+        timing = make_unique<BinaryTimingInfo>(compressedFormat);
+    else
+        timing = make_unique<YAMLTimingInfo>();
     // Register bank dump.
-    auto RBDumper =
-        make_unique<NPYRegBankDumper>(regBankTraceFileName, tu.traces.size());
+    unique_ptr<RegBankDumper> RBDumper;
+    if (binaryFormat)
+        RBDumper = make_unique<BinaryRegBankDumper>(regBankTraceFileName,
+                                                    compressedFormat);
+    else {
+        unsigned registerSize = 8;
+        if (compactRegBankTrace && !regBankTraceFileName.empty()) {
+            if (streamCPU)
+                registerSize = streamCPU->registerSize();
+            else if (!tu.traces.empty())
+                registerSize =
+                    PAF::getCPU(IndexReader(tu.traces[0]))->registerSize();
+        }
+        RBDumper = make_unique<NPYRegBankDumper>(regBankTraceFileName,
+                                                 numTraces, registerSize);
+    }
     // Memory access dump.
-    auto MADumper =
-        make_unique<YAMLMemoryAccessesDumper>(memoryAccessesTraceFileName);
+    unique_ptr<MemoryAccessesDumper> MADumper;
+    if (binaryFormat)
+        MADumper = make_unique<BinaryMemoryAccessesDumper>(
+            memoryAccessesTraceFileName, compressedFormat);
+    else
+        MADumper =
+            make_unique<YAMLMemoryAccessesDumper>(memoryAccessesTraceFileName);
     // Instruction trace dump.
-    auto IDumper =
-        make_unique<YAMLInstrDumper>(instructionTraceFileName, true, true);
+    unique_ptr<InstrDumper> IDumper;
+    if (binaryFormat)
+        IDumper = make_unique<BinaryInstrDumper>(
+            instructionTraceFileName, compressedFormat, true, true);
+    else
+        IDumper =
+            make_unique<YAMLInstrDumper>(instructionTraceFileName, true, true);
+
+    // Seed the noise sources of Configs for the num-th power trace, so that
+    // each power trace gets its own reproducible noise.
+    size_t traceNum = 0;
+    const auto seedNoise = [&](vector<PowerAnalysisConfig> &Configs,
+                               size_t num) {
+        if (!withNoiseSeed)
+            return;
+        for (size_t i = 0; i < Configs.size(); i++)
+            Configs[i].seedNoise(noiseSeed + num * Configs.size() + i);
+    };
+
+    const bool needsMTAOracle =
+        analyses.count(PowerAnalysisConfig::HAMMING_DISTANCE) != 0 ||
+        RBDumper->enabled() || IDumper->enabled();
+
+    // The image is loaded only once, and shared by all traces.
+    const shared_ptr<Image> image =
+        tu.image_filename.empty() || tu.traces.empty()
+            ? nullptr
+            : IndexNavigator(tu.traces[0], tu.image_filename).get_image();
+
+    // The label is looked up once, as all traces share the same image.
+    if (!windowLabel.empty() && !tu.traces.empty()) {
+        SharedImageNavigator IN(tu.traces[0], image);
+        uint64_t labelAddr;
+        size_t labelSize; // Unused.
+        if (!IN.has_image())
+            reporter->errx(EXIT_FAILURE,
+                           "No image, label '%s' can not be looked up",
+                           windowLabel.c_str());
+        if (!IN.lookup_symbol(windowLabel, labelAddr, labelSize))
+            reporter->errx(EXIT_FAILURE, "Symbol for label '%s' not found",
+                           windowLabel.c_str());
+        window.setAnchor(labelAddr);
+    }
+    PTConfig.setWindow(window);
 
-    for (const auto &trace : tu.traces) {
+    const auto reportTrace = [&](const TracePair &trace) {
         if (tu.is_verbose())
             cout << "Running analysis on trace '" << trace.tarmac_filename
                  << "'\n";
-        IndexNavigator IN(trace, tu.image_filename);
-        PowerAnalyzer PA(IN);
-
-        vector<ExecutionRange> ERS;
-        switch (ARS.getKind()) {
-        case AnalysisRangeSpecifier::FUNCTION:
-            ERS = PA.getInstances(ARS.getFunctionName());
-            break;
-        case AnalysisRangeSpecifier::FUNCTION_MARKERS: {
-            const auto &markers = ARS.getMarkers();
-            ERS = PA.getBetweenFunctionMarkers(markers.first, markers.second);
-            break;
+    };
+
+    const auto report = [&](const ExecutionRange &er) {
+        if (tu.is_verbose()) {
+            cout << " - Building power trace from " << er.begin.time << " to "
+                 << er.end.time;
+            if (ARS.getKind() == AnalysisRangeSpecifier::FUNCTION)
+                cout << " (" << ARS.getFunctionName() << ')';
+            cout << '\n';
         }
-        case AnalysisRangeSpecifier::NOT_SET:
-            reporter->errx(EXIT_FAILURE,
-                           "Analysis range not specified, use one of "
-                           "--function or --between-functions");
+    };
+
+    // Set the manifest values of the trace-th trace as the data of the power
+    // traces it will produce, for the metrics computed in process.
+    const auto setTraceData = [&](size_t trace) {
+        if (numData == 0)
+            return;
+        for (auto &MD : metricsDumpers)
+            MD.first->setData(manifestData[tu.traces[trace].tarmac_filename]);
+    };
+
+    // Get to the next power trace, which the trace-th trace produced.
+    const auto nextTrace = [&](size_t trace) {
+        for (auto &cfg : PAConfigs)
+            cfg.getDumper().nextTrace();
+        timing->nextTrace();
+        RBDumper->nextTrace();
+        MADumper->nextTrace();
+        IDumper->nextTrace();
+        // The manifest values are repeated for each realization, so that
+        // they stay in sync with the power traces.
+        if (manifestDataWriter)
+            for (unsigned r = 0; r < realizations; r++) {
+                manifestDataWriter->append(
+                    manifestData[tu.traces[trace].tarmac_filename]);
+                manifestDataWriter->next();
+            }
+        traceNum++;
+    };
+
+    if (streamCPU) {
+        // The instructions are analyzed as they are streamed: no trace file
+        // is written, and no index is built. The state tracking starts from
+        // an all zero state, as nothing is known before the stream starts.
+        ifstream ifs;
+        if (streamFileName != "-") {
+            ifs.open(streamFileName);
+            if (!ifs)
+                reporter->errx(EXIT_FAILURE, "Error opening stream '%s'",
+                               streamFileName.c_str());
         }
+        std::istream &is = streamFileName == "-" ? std::cin : ifs;
+        if (tu.is_verbose())
+            cout << "Running analysis on stream '" << streamFileName << "'\n";
+        unique_ptr<PowerTrace::Oracle> oracle;
+        if (needsMTAOracle)
+            oracle = make_unique<PowerTrace::ShadowOracle>(
+                make_unique<PowerTrace::Oracle>(), *streamCPU,
+                /* big_endian: */ false);
+        else
+            oracle = make_unique<PowerTrace::Oracle>();
+        seedNoise(PAConfigs, traceNum);
+        PowerTrace PTrace =
+            PowerAnalyzer::getPowerTrace(PTConfig, *streamCPU, is);
+        PTrace.analyze(PAConfigs, *oracle, *timing, *RBDumper, *MADumper,
+                       *IDumper);
+        nextTrace(0);
+    } else if (NPArrayBase::numThreads() <= 1) {
+        for (size_t t = 0; t < tu.traces.size(); t++) {
+            reportTrace(tu.traces[t]);
+            TraceAnalysis TA(tu.traces[t], image, needsMTAOracle);
+            const vector<ExecutionRange> ERS =
+                getExecutionRanges(TA.PA, ARS, tu.traces[t],
+                                   tu.image_filename, useAnalysisCache);
+            if (ERS.empty())
+                reporter->errx(EXIT_FAILURE,
+                               "Analysis range not found in the trace file");
+            for (const ExecutionRange &er : ERS) {
+                report(er);
+                setTraceData(t);
+                seedNoise(PAConfigs, traceNum);
+                PowerTrace PTrace = TA.PA.getPowerTrace(PTConfig, *TA.CPU, er);
+                PTrace.analyze(PAConfigs, *TA.oracle, *timing, *RBDumper,
+                               *MADumper, *IDumper);
+                nextTrace(t);
+            }
+        }
+    } else {
+        // The traces, and the execution ranges within a trace, are
+        // independent: analyze them concurrently, by batches to bound the
+        // memory usage. Each execution range records its outputs, which are
+        // then replayed in order so that the results are the same as with a
+        // sequential analysis. Each block of work uses its own navigators, so
+        // that no state is shared between threads.
+        const size_t batchSize = 16 * NPArrayBase::numThreads();
+        for (size_t tb = 0; tb < tu.traces.size(); tb += batchSize) {
+            const size_t te = std::min(tb + batchSize, tu.traces.size());
+
+            // Find the execution ranges of this batch of traces.
+            vector<vector<ExecutionRange>> TERS(te - tb);
+            NPArrayBase::parallelFor(
+                tb, te, NPArrayBase::MIN_ELEMENTS_PER_THREAD,
+                [&](size_t b, size_t e) {
+                    for (size_t t = b; t < e; t++) {
+                        SharedImageNavigator IN(tu.traces[t], image);
+                        PowerAnalyzer PA(IN);
+                        TERS[t - tb] =
+                            getExecutionRanges(PA, ARS, tu.traces[t],
+                                               tu.image_filename,
+                                               useAnalysisCache);
+                    }
+                });
 
-        // Some sanity checks.
-        if (ERS.size() == 0)
-            reporter->errx(EXIT_FAILURE,
-                           "Analysis range not found in the trace file");
-
-        unique_ptr<PAF::ArchInfo> CPU(PAF::getCPU(IN.index));
-
-        // Create the least powerful Oracle that is required.
-        unique_ptr<PowerTrace::Oracle> oracle(
-            analyses.count(PowerAnalysisConfig::HAMMING_DISTANCE) != 0 ||
-                    RBDumper->enabled() || IDumper->enabled()
-                ? make_unique<PowerTrace::MTAOracle>(PA, *CPU)
-                : make_unique<PowerTrace::Oracle>());
-
-        for (const ExecutionRange &er : ERS) {
-
-            if (tu.is_verbose()) {
-                cout << " - Building power trace from " << er.begin.time
-                     << " to " << er.end.time;
-                if (ARS.getKind() == AnalysisRangeSpecifier::FUNCTION)
-                    cout << " (" << ARS.getFunctionName() << ')';
-                cout << '\n';
+            // The (trace, execution range) pairs to analyze, in order.
+            vector<pair<size_t, const ExecutionRange *>> work;
+            for (size_t t = tb; t < te; t++) {
+                if (TERS[t - tb].empty())
+                    reporter->errx(
+                        EXIT_FAILURE,
+                        "Analysis range not found in the trace file '%s'",
+                        tu.traces[t].tarmac_filename.c_str());
+                for (const ExecutionRange &er : TERS[t - tb])
+                    work.emplace_back(t, &er);
             }
 
-            PowerTrace PTrace = PA.getPowerTrace(PTConfig, *CPU, er);
-            PTrace.analyze(PAConfigs, *oracle, *timing, *RBDumper, *MADumper,
-                           *IDumper);
-            for (auto &cfg : PAConfigs)
-                cfg.getDumper().nextTrace();
-            timing->nextTrace();
-            RBDumper->nextTrace();
-            MADumper->nextTrace();
-            IDumper->nextTrace();
+            size_t lastTrace = tb;
+            reportTrace(tu.traces[tb]);
+            for (size_t b = 0; b < work.size(); b += batchSize) {
+                const size_t e = std::min(b + batchSize, work.size());
+                vector<PowerTraceRecorder> recorders;
+                recorders.reserve(e - b);
+                for (size_t r = b; r < e; r++) {
+                    recorders.emplace_back(PAConfigs, *RBDumper, *MADumper,
+                                           *IDumper);
+                    seedNoise(recorders.back().getPowerAnalysisConfigs(),
+                              traceNum + r - b);
+                }
+
+                NPArrayBase::parallelFor(
+                    b, e, NPArrayBase::MIN_ELEMENTS_PER_THREAD,
+                    [&](size_t rb, size_t re) {
+                        unique_ptr<TraceAnalysis> TA;
+                        size_t t = 0;
+                        for (size_t r = rb; r < re; r++) {
+                            if (!TA || work[r].first != t) {
+                                t = work[r].first;
+                                TA.reset();
+                                TA = make_unique<TraceAnalysis>(
+                                    tu.traces[t], image, needsMTAOracle);
+                            }
+                            PowerTrace PTrace = TA->PA.getPowerTrace(
+                                PTConfig, *TA->CPU, *work[r].second);
+                            recorders[r - b].analyze(PTrace, *TA->oracle);
+                        }
+                    });
+
+                for (size_t r = b; r < e; r++) {
+                    if (work[r].first != lastTrace) {
+                        lastTrace = work[r].first;
+                        reportTrace(tu.traces[lastTrace]);
+                    }
+                    report(*work[r].second);
+                    setTraceData(work[r].first);
+                    recorders[r - b].replay(PAConfigs, *timing, *RBDumper,
+                                            *MADumper, *IDumper);
+                    nextTrace(work[r].first);
+                }
+            }
         }
     }
 
+    if (manifestDataWriter && !manifestDataWriter->close())
+        reporter->errx(EXIT_FAILURE, "Error writing file '%s': %s",
+                       manifestDataFileName.c_str(),
+                       manifestDataWriter->error());
+
+    for (auto &MD : metricsDumpers)
+        if (!MD.first->close())
+            reporter->errx(EXIT_FAILURE,
+                           "Error computing the metrics for '%s' (%s)",
+                           MD.second.c_str(), MD.first->error());
+
     if (!timingFileName.empty())
         timing->saveToFile(timingFileName);
 
@@ -17,6 +17,7 @@
 #
 # This file is part of PAF, the Physical Attack Framework.
 
+import struct
 import yaml
 
 from FI.utils import die, warning
@@ -156,17 +157,21 @@ class ClassificationExpr:
     def __init__(self, CE):
         self.__Classifications = list()
         for C in CE:
-            if C[0] not in ['noeffect', 'success', 'crash', 'caught']:
-                die("{} is not a known Classification term".format(k))
+            if C[0] not in ['noeffect', 'success', 'crash', 'caught', 'undecided']:
+                die("{} is not a known Classification term".format(C[0]))
             if len(C[1]) != 0:
                 die("Checkers are not supported (yet) in Classifications.")
             self.__Classifications.append(Classification(str(C[0])))
-
-    def eval(self):
+        # Without checkers, the first Classification always applies: resolve
+        # it once, rather than for each fault.
+        self.__Effect = 'undecided'
         for C in self.__Classifications:
             if C.eval():
-                return C.Kind
-        return 'undecided'
+                self.__Effect = C.Kind
+                break
+
+    def eval(self):
+        return self.__Effect
 
     def __repr__(self):
         s = "["
@@ -199,11 +204,27 @@ class Oracle:
         self.__Classifiers = list()
         for C in O:
             self.__Classifiers.append(Classifier(C))
+        # The Classifiers indexed by their Pc, so that classifying a fault is
+        # a single lookup. Only the first Classifier at a Pc is considered.
+        self.__ByPc = dict()
+        for C in self.__Classifiers:
+            self.__ByPc.setdefault(C.Pc, C)
 
     @property
     def Classifiers(self):
         return iter(self.__Classifiers)
 
+    @property
+    def Pcs(self):
+        """The addresses where the Oracle has to be asked."""
+        return iter(self.__ByPc.keys())
+
+    def classify(self, Pc):
+        """Get the effect of a fault reaching Pc, or None if no Classifier is
+        located at Pc."""
+        C = self.__ByPc.get(Pc)
+        return C.eval() if C is not None else None
+
     def __repr__(self):
         s = list()
         for C in self.__Classifiers:
@@ -307,12 +328,17 @@ class Fault:
         self.__BPInfo = BreakpointInfo(IS[ 'Breakpoint'])
         self.__Instruction = IS[ 'Instruction']
         self.__Disassembly = IS[ 'Disassembly']
+        # The number of faults this one stands for, when it represents a
+        # class of equivalent faults.
+        self.__Weight = int(IS.get('Weight', 1))
         self.__Effect = None
         if 'Effect' in IS:
             effect = IS['Effect']
             if effect not in Fault.Effects:
                 die("Unsuported fault effect: {}".format(effect))
             self.__Effect = effect
+        # The key identifying this fault across program rebuilds, if any.
+        self.__Key = IS.get('Key')
 
     @property
     def Id(self):
@@ -350,6 +376,10 @@ class Fault:
     def Disassembly(self):
         return self.__Disassembly
 
+    @property
+    def Weight(self):
+        return self.__Weight
+
     @property
     def Effect(self):
         return self.__Effect
@@ -360,6 +390,10 @@ class Fault:
             die("Unsuported fault effect: {}".format(s))
         self.__Effect = s
 
+    @property
+    def Key(self):
+        return self.__Key
+
     @staticmethod
     def get(FaultModel, IS):
         if FaultModel == 'InstructionSkip':
@@ -372,8 +406,12 @@ class Fault:
         str = "Id: {}, Time: {}".format(self.Id, self.Time)
         str += ", Address: 0x{:x}, Instruction: 0x{:x}".format(self.Address, self.Instruction)
         str += ", Width: {}, Breakpoint: {}, Disassembly: \"{}\"".format(self.Width, self.BreakpointInfo, self.Disassembly)
+        if self.Weight != 1:
+            str += ", Weight: {}".format(self.Weight)
         if self.Effect:
             str += ", Effect: \"{}\"".format(self.Effect)
+        if self.Key:
+            str += ", Key: 0x{:x}".format(self.Key)
         return str
 
 class InstructionSkip(Fault):
@@ -396,44 +434,346 @@ class InstructionSkip(Fault):
         str = "{}, Executed: {}, FaultedInstr: 0x{:x}".format(Fault.__repr__(self), self.Executed, self.FaultedInstr)
         return '{ ' + str + '}'
 
+def splitmix64(state):
+    """The splitmix64 generator, as used by the faulter for the random
+    corruption patterns. Returns the new state and the random value."""
+    M = (1 << 64) - 1
+    state = (state + 0x9E3779B97F4A7C15) & M
+    z = ((state ^ (state >> 30)) * 0xBF58476D1CE4E5B9) & M
+    z = ((z ^ (z >> 27)) * 0x94D049BB133111EB) & M
+    return state, z ^ (z >> 31)
+
+def getCorruptionMasks(Pattern, RegWidth, NumBits, Variant, Time):
+    """Get the (AndMask, XorMask) pair a corruption pattern variant applies
+    to its register, the same way the faulter computes them."""
+    andMask = (1 << RegWidth) - 1
+    xorMask = 0
+    if Pattern == 'value':
+        andMask = 0
+    elif Pattern == 'bitflip':
+        xorMask = 1 << Variant
+    elif Pattern == 'byteset':
+        xorMask = 0xFF << (8 * Variant)
+        andMask &= ~xorMask
+    elif Pattern == 'bytereset':
+        andMask &= ~(0xFF << (8 * Variant))
+    elif Pattern == 'randombits':
+        state = ((Time << 8) | Variant) & ((1 << 64) - 1)
+        n = 0
+        while n < NumBits:
+            state, r = splitmix64(state)
+            bit = 1 << (r % RegWidth)
+            if xorMask & bit == 0:
+                xorMask |= bit
+                n += 1
+    else:
+        die("Unsupported corruption pattern '{}'".format(Pattern))
+    return andMask, xorMask
+
 class CorruptRegDef(Fault):
 
+    Patterns = ['value', 'bitflip', 'byteset', 'bytereset', 'randombits']
+
     def __init__(self, IS):
         assertEntityContainsAllOf(IS, 'CorruptRegDef', ['Id', 'Time', 'Address', 'Width', 'Instruction', 'FaultedReg', 'Disassembly'])
         Fault.__init__(self, IS)
         self.__FaultedReg = IS[ 'FaultedReg']
+        # Faults from a corruption family (all but the 'value' pattern,
+        # which resets the register) describe how the register gets
+        # corrupted: it is replaced by (value & AndMask) ^ XorMask.
+        self.__Pattern = IS.get('Pattern', 'value')
+        self.__RegWidth = IS.get('RegWidth', 0)
+        self.__NumBits = IS.get('NumBits', 0)
+        self.__Variant = IS.get('Variant', 0)
+        self.__AndMask = IS.get('AndMask', 0)
+        self.__XorMask = IS.get('XorMask', 0)
+        if self.__Pattern != 'value' and 'AndMask' not in IS:
+            self.__AndMask, self.__XorMask = getCorruptionMasks(self.__Pattern,
+                self.__RegWidth, self.__NumBits, self.__Variant, self.Time)
 
     @property
     def FaultedReg(self):
         return self.__FaultedReg
 
+    @property
+    def Pattern(self):
+        return self.__Pattern
+
+    @property
+    def RegWidth(self):
+        return self.__RegWidth
+
+    @property
+    def NumBits(self):
+        return self.__NumBits
+
+    @property
+    def Variant(self):
+        return self.__Variant
+
+    @property
+    def AndMask(self):
+        return self.__AndMask
+
+    @property
+    def XorMask(self):
+        return self.__XorMask
+
+    def hasMasks(self):
+        return self.__Pattern != 'value'
+
     def __repr__(self):
         str = "{}, FaultedReg: \"{}\"".format(Fault.__repr__(self), self.FaultedReg)
+        if self.hasMasks():
+            str += ", Pattern: \"{}\", RegWidth: {}".format(self.Pattern, self.RegWidth)
+            if self.Pattern == 'randombits':
+                str += ", NumBits: {}".format(self.NumBits)
+            str += ", Variant: {}, AndMask: 0x{:x}, XorMask: 0x{:x}".format(self.Variant, self.AndMask, self.XorMask)
         return '{ ' + str + '}'
 
+class Checkpoint:
+    """A point of the reference execution, reached by running to its
+    breakpoint, where the model state can be saved so that the faults
+    following it can be run from there rather than from the program start.
+    The faults are (Id, Count) pairs, where Count is the fault breakpoint
+    count relative to the checkpoint."""
 
-class FaultInjectionCampaign:
+    def __init__(self, C):
+        assertEntityContainsAllOf(C, 'Checkpoint', ['Time', 'Breakpoint', 'Faults'])
+        self.__Time = int(C['Time'])
+        self.__BPInfo = BreakpointInfo(C['Breakpoint'])
+        self.__Faults = [(int(F[0]), int(F[1])) for F in C['Faults']]
+
+    @property
+    def Time(self):
+        return self.__Time
+
+    @property
+    def BreakpointInfo(self):
+        return self.__BPInfo
+
+    @property
+    def Faults(self):
+        return self.__Faults
+
+class CheckpointPlan:
+    """The checkpoints planned by the faulter with --checkpoint-plan."""
 
     def __init__(self, filename):
-        self.__Filename = filename
-        with open(self.Filename, 'r') as f:
+        with open(filename, 'r') as f:
             y = yaml.safe_load(f)
-            assertEntityContainsAllOf(y, "Fault injection campaign file '{}'".format(self.__Filename), ['Image', 'ReferenceTrace', 'MaxTraceTime', 'ProgramEntryAddress', 'ProgramEndAddress', 'FaultModel', 'InjectionRangeInfo', 'Oracle', 'Campaign'])
-            self.__Image = y['Image']
-            self.__ReferenceTrace = y['ReferenceTrace']
-            self.__MaxTraceTime = int(y['MaxTraceTime'])
-            self.__ProgramEntryAddress = int(y['ProgramEntryAddress'])
-            self.__ProgramEndAddress = int(y['ProgramEndAddress'])
-            self.__FaultModel = y['FaultModel']
-            if self.FaultModel not in ['InstructionSkip', 'CorruptRegDef']:
-                die("Unsupported fault model '{}' in campaign file '{}'".format(self.FaultModel, self.Filename))
-            self.__InjectionRangeInfo = list()
-            for F in y['InjectionRangeInfo']:
-                self.__InjectionRangeInfo.append(InjectionRangeInfo(F))
-            self.__Oracle = Oracle(y['Oracle'])
-            self.__Campaign = list()
-            for F in y['Campaign']:
-                self.__Campaign.append(Fault.get(self.FaultModel, F))
+            assertEntityContainsAllOf(y, "Checkpoint plan file '{}'".format(filename), ['Checkpoints'])
+            self.__Checkpoints = [Checkpoint(C) for C in y['Checkpoints'] or []]
+
+    @property
+    def Checkpoints(self):
+        return self.__Checkpoints
+
+def getShards(numFaults, K, cuts=None):
+    """Split numFaults faults into K contiguous shards of similar sizes, as
+    a list of (begin, end) pairs. If cuts is provided, the shard boundaries
+    are moved to the closest of the cuts, so that the faults of an injection
+    range are not split accross shards. This mirrors
+    InjectionCampaign::getShards in the faulter."""
+    shards = list()
+    begin = 0
+    for k in range(1, K + 1):
+        end = numFaults // K * k + min(numFaults % K, k)
+        if cuts is not None and k != K:
+            nxt = [c for c in cuts if c >= end]
+            prv = [c for c in cuts if begin < c < end]
+            candidates = list()
+            if prv:
+                candidates.append(max(prv))
+            candidates.append(min(nxt) if nxt else numFaults)
+            end = min(candidates, key=lambda c: abs(c - end))
+        end = max(begin, min(end, numFaults))
+        shards.append((begin, end))
+        begin = end
+    return shards
+
+class BinaryCampaign:
+    """The binary campaign file format, as produced by the faulter with
+    --binary. See PAF/FI/CampaignFile.h for its description."""
+
+    Magic = b'PAF-FIC\x00'
+    Version = 1
+    Header = struct.Struct('<8sIIQQQQQQ')
+    Record = struct.Struct('<QQQQQIIIIHBBBBBB')
+    FaultModels = ['', 'InstructionSkip', 'CorruptRegDef']
+
+    @staticmethod
+    def isBinary(filename):
+        with open(filename, 'rb') as f:
+            return f.read(len(BinaryCampaign.Magic)) == BinaryCampaign.Magic
+
+    @staticmethod
+    def read(filename, shard=None, byRange=False):
+        """Read the binary campaign in filename, and return its metadata as a
+        dictionnary, with its 'Campaign' entry filled with the faults of shard
+        (a (k, K) pair), or with all faults if shard is None, as well as the
+        injection range cuts relative to the faults read."""
+        with open(filename, 'rb') as f:
+            data = f.read(BinaryCampaign.Header.size)
+            if len(data) != BinaryCampaign.Header.size:
+                die("Truncated campaign file '{}'".format(filename))
+            (magic, version, model, numFaults, mdOffset, mdSize, strOffset,
+                recOffset, keysOffset) = BinaryCampaign.Header.unpack(data)
+            if magic != BinaryCampaign.Magic:
+                die("'{}' is not a binary campaign file".format(filename))
+            if version != BinaryCampaign.Version:
+                die("Unsupported binary campaign file version {} in '{}'".format(version, filename))
+            f.seek(mdOffset)
+            y = yaml.safe_load(f.read(mdSize).decode())
+            f.seek(strOffset)
+            strings = list()
+            for i in range(BinaryCampaign.readValue(f, '<I')):
+                l = BinaryCampaign.readValue(f, '<I')
+                strings.append(f.read(l).decode())
+            cuts = [BinaryCampaign.readValue(f, '<Q') for i in range(BinaryCampaign.readValue(f, '<Q'))]
+
+            begin, end = 0, numFaults
+            if shard is not None:
+                k, K = shard
+                begin, end = getShards(numFaults, K, cuts if byRange else None)[k]
+            f.seek(recOffset + begin * BinaryCampaign.Record.size)
+            data = f.read((end - begin) * BinaryCampaign.Record.size)
+            if len(data) != (end - begin) * BinaryCampaign.Record.size:
+                die("Truncated campaign file '{}'".format(filename))
+            keys = [0] * (end - begin)
+            if keysOffset != 0:
+                f.seek(keysOffset + begin * 8)
+                kd = f.read((end - begin) * 8)
+                if len(kd) != (end - begin) * 8:
+                    die("Truncated campaign file '{}'".format(filename))
+                keys = [k for (k,) in struct.iter_unpack('<Q', kd)]
+
+        model = BinaryCampaign.FaultModels[model] if model < len(BinaryCampaign.FaultModels) else ''
+        y['Campaign'] = [BinaryCampaign.decode(r, model, strings)
+                         for r in BinaryCampaign.Record.iter_unpack(data)]
+        for F, k in zip(y['Campaign'], keys):
+            if k != 0:
+                F['Key'] = k
+        return y, [c - begin for c in cuts if begin < c < end]
+
+    @staticmethod
+    def readValue(f, fmt):
+        size = struct.calcsize(fmt)
+        data = f.read(size)
+        if len(data) != size:
+            die("Truncated campaign file '{}'".format(f.name))
+        return struct.unpack(fmt, data)[0]
+
+    @staticmethod
+    def decode(r, model, strings):
+        (Id, Time, Address, Weight, BPAddress, Instruction, BPCount,
+            Disassembly, Extra, Width, Flags, Effect, Pattern, RegWidth,
+            NumBits, Variant) = r
+        F = {'Id': Id, 'Time': Time, 'Address': Address,
+             'Instruction': Instruction, 'Width': Width,
+             'Disassembly': strings[Disassembly], 'Weight': Weight,
+             'Executed': (Flags & 2) != 0}
+        if model == 'CorruptRegDef':
+            F['FaultedReg'] = strings[Extra]
+            if Pattern >= len(CorruptRegDef.Patterns):
+                die("Unsupported corruption pattern in fault record")
+            if Pattern != 0:
+                F['Pattern'] = CorruptRegDef.Patterns[Pattern]
+                F['RegWidth'] = RegWidth
+                if F['Pattern'] == 'randombits':
+                    F['NumBits'] = NumBits
+                F['Variant'] = Variant
+        else:
+            F['FaultedInstr'] = Extra
+        if Flags & 1:
+            F['Breakpoint'] = {'Address': BPAddress, 'Count': BPCount}
+        if Effect != 0:
+            F['Effect'] = Fault.Effects[Effect - 1]
+        return F
+
+    @staticmethod
+    def write(f, FIC, header, cuts):
+        """Write FIC to f, with the YAML header and the injection range
+        cuts."""
+        strings = dict()
+        def intern(s):
+            return strings.setdefault(s, len(strings))
+        records = bytearray()
+        keys = bytearray()
+        for F in FIC.Campaign:
+            # All faults have a breakpoint.
+            flags = 1
+            pattern = (0, 0, 0, 0)
+            if FIC.FaultModel == 'InstructionSkip':
+                extra = F.FaultedInstr
+                if F.Executed:
+                    flags |= 2
+            else:
+                extra = intern(F.FaultedReg)
+                if F.hasMasks():
+                    pattern = (CorruptRegDef.Patterns.index(F.Pattern),
+                               F.RegWidth, F.NumBits, F.Variant)
+            BP = F.BreakpointInfo
+            effect = Fault.Effects.index(F.Effect) + 1 if F.Effect else 0
+            records += BinaryCampaign.Record.pack(F.Id, F.Time, F.Address,
+                F.Weight, BP.Address, F.Instruction, BP.Count,
+                intern(F.Disassembly), extra, F.Width, flags, effect,
+                *pattern)
+            keys += struct.pack('<Q', F.Key or 0)
+
+        md = header.encode()
+        st = struct.pack('<I', len(strings))
+        for s in strings:
+            st += struct.pack('<I', len(s.encode())) + s.encode()
+        ct = struct.pack('<Q', len(cuts)) + b''.join(struct.pack('<Q', c) for c in cuts)
+        mdOffset = BinaryCampaign.Header.size
+        strOffset = mdOffset + len(md)
+        ctEnd = strOffset + len(st) + len(ct)
+        recOffset = (ctEnd + 7) & ~7
+        keyed = any(F.Key for F in FIC.Campaign)
+        keysOffset = recOffset + len(records) if keyed else 0
+        f.write(BinaryCampaign.Header.pack(BinaryCampaign.Magic,
+            BinaryCampaign.Version,
+            BinaryCampaign.FaultModels.index(FIC.FaultModel),
+            FIC.getNumFaults(), mdOffset, len(md), strOffset, recOffset,
+            keysOffset))
+        f.write(md + st + ct + bytes(recOffset - ctEnd) + records)
+        if keyed:
+            f.write(keys)
+
+class FaultInjectionCampaign:
+
+    def __init__(self, filename, shard=None, shardByRange=False):
+        """Load the fault injection campaign from filename, which can either
+        be in the YAML or in the binary format. If shard is a (k, K) pair,
+        only the k-th of K shards is loaded, where the shard boundaries are
+        moved to the injection range boundaries if shardByRange is set. This
+        is only supported with the binary format."""
+        self.__Filename = filename
+        self.__Binary = BinaryCampaign.isBinary(filename)
+        if self.__Binary:
+            y, _ = BinaryCampaign.read(filename, shard, shardByRange)
+        else:
+            if shard is not None:
+                die("Campaign sharding requires a binary campaign file")
+            with open(self.Filename, 'r') as f:
+                y = yaml.safe_load(f)
+        assertEntityContainsAllOf(y, "Fault injection campaign file '{}'".format(self.__Filename), ['Image', 'ReferenceTrace', 'MaxTraceTime', 'ProgramEntryAddress', 'ProgramEndAddress', 'FaultModel', 'InjectionRangeInfo', 'Oracle', 'Campaign'])
+        self.__Image = y['Image']
+        self.__ReferenceTrace = y['ReferenceTrace']
+        self.__MaxTraceTime = int(y['MaxTraceTime'])
+        self.__ProgramEntryAddress = int(y['ProgramEntryAddress'])
+        self.__ProgramEndAddress = int(y['ProgramEndAddress'])
+        self.__FaultModel = y['FaultModel']
+        if self.FaultModel not in ['InstructionSkip', 'CorruptRegDef']:
+            die("Unsupported fault model '{}' in campaign file '{}'".format(self.FaultModel, self.Filename))
+        self.__InjectionRangeInfo = list()
+        for F in y['InjectionRangeInfo']:
+            self.__InjectionRangeInfo.append(InjectionRangeInfo(F))
+        self.__Oracle = Oracle(y['Oracle'])
+        self.__Campaign = list()
+        for F in y['Campaign']:
+            self.__Campaign.append(Fault.get(self.FaultModel, F))
 
     @property
     def Filename(self):
@@ -475,7 +815,16 @@ class FaultInjectionCampaign:
         return len(self.__Campaign)
 
     def getFault(self, Id):
-        return self.__Campaign[Id]
+        """Get the fault with Id. The campaign may be a shard, so its first
+        fault Id is not necessarily 0."""
+        if self.__Campaign:
+            i = Id - self.__Campaign[0].Id
+            if 0 <= i < len(self.__Campaign) and self.__Campaign[i].Id == Id:
+                return self.__Campaign[i]
+        for F in self.__Campaign:
+            if F.Id == Id:
+                return F
+        raise IndexError("No fault with Id {}".format(Id))
 
     @property
     def Oracle(self):
@@ -501,20 +850,49 @@ class FaultInjectionCampaign:
             F.Address += offset
             F.BreakpointInfo.Address += offset
 
+    def getInjectionRangeCuts(self):
+        """Get the indexes of the faults where the injection range changes."""
+        cuts = list()
+        current = None
+        for i, F in enumerate(self.Campaign):
+            # The faults are planned one injection range after the other, so
+            # check them against the range of their predecessor first.
+            r = current
+            if r is None or not r.StartTime <= F.Time <= r.EndTime:
+                r = next((fi for fi in self.InjectionRangeInfo if fi.StartTime <= F.Time <= fi.EndTime), None)
+            if i != 0 and r is not current:
+                cuts.append(i)
+            current = r
+        return cuts
+
+    def merge(self, other):
+        """Append the faults of campaign other, which is typically another
+        shard of the same campaign, to this campaign."""
+        if other.FaultModel != self.FaultModel or other.Image != self.Image:
+            die("Can not merge campaign '{}' into '{}'".format(other.Filename, self.Filename))
+        self.__Campaign += other.Campaign
+
     def summary(self):
         effects = Fault.Effects + ['notrun', 'total']
         stats = dict((e,0) for e in effects)
-        stats['total'] += self.getNumFaults()
         for F in self.Campaign:
+            stats['total'] += F.Weight
             if F.Effect:
-                stats[F.Effect] += 1
+                stats[F.Effect] += F.Weight
             else:
-                stats['notrun'] += 1
+                stats['notrun'] += F.Weight
         return stats
 
     def __repr__(self):
         str = "FaultInjectionCampain: \"{}\"\n".format(self.Filename)
-        str += "Image: \"{}\"\n".format(self.Image)
+        str += self.headerRepr()
+        str += "Campaign:\n"
+        for F in self.Campaign:
+            str += "  - {}\n".format(F)
+        return str
+
+    def headerRepr(self):
+        str = "Image: \"{}\"\n".format(self.Image)
         str += "ReferenceTrace: \"{}\"\n".format(self.ReferenceTrace)
         str += "MaxTraceTime: {}\n".format(self.MaxTraceTime)
         str += "ProgramEntryAddress: 0x{:x}\n".format(self.ProgramEntryAddress)
@@ -524,12 +902,13 @@ class FaultInjectionCampaign:
         for fi in self.InjectionRangeInfo:
             str += "  - {}\n".format(fi)
         str += "Oracle:\n{}\n".format(self.Oracle)
-        str += "Campaign:\n"
-        for F in self.Campaign:
-            str += "  - {}\n".format(F)
         return str
 
     def saveToFile(self, filename):
+        """Save the campaign to filename, in the format it was loaded from."""
         with open(filename, 'wb') as f:
-            f.write("{}".format(self).encode())
+            if self.__Binary:
+                BinaryCampaign.write(f, self, self.headerRepr(), self.getInjectionRangeCuts())
+            else:
+                f.write("{}".format(self).encode())
 
@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+# affiliates <open-source-office@arm.com></text>
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# This file is part of PAF, the Physical Attack Framework.
+
+import bisect
+import collections
+import math
+import random
+import statistics
+
+def wilsonInterval(k, n, z):
+    """Get the Wilson score interval, as a (low, high) pair, of a rate
+    estimated from k positive outcomes out of n draws, with z the quantile of
+    the normal distribution for the confidence level."""
+    if n == 0:
+        return (0.0, 1.0)
+    p = k / n
+    d = 1 + z * z / n
+    center = (p + z * z / (2 * n)) / d
+    h = z * math.sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / d
+    return (max(0.0, center - h), min(1.0, center + h))
+
+class Stratum:
+    """A part of the fault space, whose effect rates are estimated on their
+    own. Its faults are drawn with replacement, with a probability
+    proportional to their weight, so that a fault folded by the faulter
+    counts for all the faults it stands for."""
+
+    def __init__(self, Name):
+        self.Name = Name
+        self.Faults = list()
+        self.CumWeights = list()
+        # The effects of the draws whose fault has been classified.
+        self.Effects = collections.Counter()
+        self.Draws = 0
+        # The number of faults without a known effect, and among them, the
+        # ones which are not being run.
+        self.Unknown = 0
+        self.Idle = 0
+        self.Run = 0
+
+    @property
+    def TotalWeight(self):
+        return self.CumWeights[-1] if self.CumWeights else 0
+
+    def add(self, F, Known):
+        self.Faults.append(F)
+        self.CumWeights.append(self.TotalWeight + F.Weight)
+        if not Known:
+            self.Unknown += 1
+            self.Idle += 1
+
+    def draw(self, Rng):
+        i = bisect.bisect_right(self.CumWeights, Rng.random() * self.TotalWeight)
+        return self.Faults[min(i, len(self.Faults) - 1)]
+
+    def record(self, Effect, Count=1):
+        self.Effects[Effect] += Count
+        self.Draws += Count
+
+    @property
+    def Exhaustive(self):
+        """Are all the faults of this stratum classified ? The rates are then
+        exact."""
+        return self.Unknown == 0
+
+    def rate(self, Effect, z):
+        """Get the (estimate, low, high) rate of Effect in this stratum."""
+        if self.Exhaustive:
+            w = sum(F.Weight for F in self.Faults if F.Effect == Effect)
+            p = w / self.TotalWeight
+            return (p, p, p)
+        low, high = wilsonInterval(self.Effects[Effect], self.Draws, z)
+        return (self.Effects[Effect] / self.Draws if self.Draws else 0.0, low, high)
+
+class FaultSampler:
+    """Estimate, for each stratum of a campaign's fault space, the rates of
+    the 'success' and 'crash' effects, by running a random sample of its
+    faults rather than all of them.
+
+    The faults are stratified by injection range ('range'), by faulted
+    instruction address ('pc'), or not at all ('uniform'). The strata are
+    drawn from in turn, and a stratum is done once the half width of the
+    Wilson score interval of both rates, at the Confidence level, is not
+    larger than Precision, or once all its faults have been classified.
+
+    As the faults are drawn with replacement, drawing a fault which has
+    already been classified, or which is being run, does not cost another
+    run: only the faults never drawn before are handed out to be run.
+    """
+
+    Stratifications = ['uniform', 'range', 'pc']
+    Tracked = ['success', 'crash']
+
+    def __init__(self, Faults, Ranges, Stratify='uniform', Precision=0.01,
+                 Confidence=0.95, Seed=None, Rerun=False):
+        assert Stratify in FaultSampler.Stratifications, "Unknown stratification"
+        assert 0 < Confidence < 1, "Expecting a confidence level in ]0, 1["
+        self.__Rng = random.Random(Seed)
+        self.__Z = statistics.NormalDist().inv_cdf(0.5 + Confidence / 2)
+        self.__Precision = Precision
+        # The faults with a known effect, and the number of pending draws of
+        # the faults being run.
+        self.__Known = set()
+        self.__Pending = dict()
+        self.__StratumOf = dict()
+
+        strata = dict()
+        for F in Faults:
+            if Stratify == 'range':
+                r = next((i for i, fi in enumerate(Ranges) if fi.StartTime <= F.Time <= fi.EndTime), None)
+                key = r
+                name = "{}@{}".format(Ranges[r].Name, Ranges[r].StartTime) if r is not None else "<none>"
+            elif Stratify == 'pc':
+                key = F.Address
+                name = "0x{:x}".format(F.Address)
+            else:
+                key = None
+                name = "all"
+            if key not in strata:
+                strata[key] = Stratum(name)
+            S = strata[key]
+            Known = not Rerun and F.Effect is not None
+            if Known:
+                self.__Known.add(F.Id)
+            S.add(F, Known)
+            self.__StratumOf[F.Id] = S
+        self.__Strata = list(strata.values())
+        self.__Active = collections.deque(self.__Strata)
+
+    @property
+    def Strata(self):
+        return self.__Strata
+
+    def isDone(self, S):
+        """Is the precision reached for stratum S ?"""
+        if S.Exhaustive:
+            return True
+        if S.Draws == 0:
+            return False
+        for Effect in FaultSampler.Tracked:
+            _, low, high = S.rate(Effect, self.__Z)
+            if (high - low) / 2 > self.__Precision:
+                return False
+        return True
+
+    def next(self):
+        """Draw faults until one has to be run, and return it, or return None
+        if no fault has to be run, either because all strata are done or
+        because all the faults left to classify are being run."""
+        stalled = 0
+        while self.__Active and stalled < len(self.__Active):
+            S = self.__Active[0]
+            if self.isDone(S):
+                self.__Active.popleft()
+                stalled = 0
+                continue
+            self.__Active.rotate(-1)
+            # All the faults this stratum could still need are being run:
+            # it will be exhaustive once they are classified.
+            if S.Idle == 0:
+                stalled += 1
+                continue
+            stalled = 0
+            F = S.draw(self.__Rng)
+            if F.Id in self.__Known:
+                S.record(F.Effect)
+            elif F.Id in self.__Pending:
+                self.__Pending[F.Id] += 1
+            else:
+                self.__Pending[F.Id] = 1
+                S.Idle -= 1
+                return F
+        return None
+
+    def record(self, F):
+        """Record the effect of fault F, which has been run."""
+        S = self.__StratumOf[F.Id]
+        S.record(F.Effect, self.__Pending.pop(F.Id))
+        S.Unknown -= 1
+        S.Run += 1
+        self.__Known.add(F.Id)
+
+    def report(self):
+        """Get a summary of the rate estimates, one line per stratum."""
+        lines = list()
+        for S in self.__Strata:
+            rates = list()
+            for Effect in FaultSampler.Tracked:
+                p, low, high = S.rate(Effect, self.__Z)
+                rates.append("{} {:.2%} [{:.2%}, {:.2%}]".format(Effect, p, low, high))
+            lines.append("{}: {} faults ({} run, {} draws{}), {}".format(
+                S.Name, len(S.Faults), S.Run, S.Draws,
+                ", exhaustive" if S.Exhaustive else "", ", ".join(rates)))
+        return lines
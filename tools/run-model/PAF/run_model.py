@@ -23,7 +23,7 @@ import binascii
 import os
 import multiprocessing
 import threading
-import queue
+import collections
 import struct
 from abc import ABC, abstractmethod
 import re
@@ -34,6 +34,7 @@ from elftools.elf.sections import SymbolTableSection
 
 from FI.utils import die, warning
 from FI.faultcampaign import *
+from FI.sampling import FaultSampler
 
 def getEnvVar(VarName, Required = True):
     """Return an env variable content, or die if it is required and does not exist."""
@@ -487,6 +488,12 @@ class IrisDriver:
     def resetModel(self):
         self.model.reset()
 
+    def saveCheckpoint(self, checkpoint_dir):
+        self.model.save_checkpoint(checkpoint_dir)
+
+    def restoreCheckpoint(self, checkpoint_dir):
+        self.model.restore_checkpoint(checkpoint_dir)
+
     def getInstructionCount(self):
         return self.cpu.get_instruction_count()
 
@@ -665,31 +672,107 @@ class DataOverrider(IrisDriver):
             IrisDriver.runModel(self, blocking = True)
 
 class FaultDispatcher:
-    """Dispatch faults accross theaded drivers."""
+    """Dispatch faults accross theaded drivers.
+
+    The faults are handed out in batches of (Fault, Count) pairs, all run
+    from the same checkpoint, with a breakpoint Count relative to that
+    checkpoint. Faults without a checkpoint are run from the program start,
+    on their own. The batches are initially split in contiguous chunks, one
+    per worker, so that each worker runs faults close to each other. A
+    worker which has run all of its batches steals the last batch of the
+    worker with the most remaining batches.
+
+    The faults which already have an effect, e.g. classified by the faulter's
+    simulation, are not run again, unless Rerun is set.
+
+    With Sampling, the keyword arguments of a FaultSampler, only a random
+    sample of the faults is run, one fault at a time from the program start,
+    until the effect rates are estimated with the requested precision.
+    """
 
-    def __init__(self, FaultInjectionCampaign, FaultIds, verbosity):
-        self.__Campaign = FaultInjectionCampaign
-        self.__Faults = queue.Queue()
+    def __init__(self, Campaigns, FaultIds, verbosity, Plan=None, Workers=1, BatchSize=0, Rerun=False, Sampling=None):
+        assert len(Campaigns) > 0, "Expecting at least one fault injection campaign"
+        self.__Campaigns = Campaigns
         self.__AllFaults = list()
-        for f in self.__Campaign.allFaults():
-            if FaultIds is None or f.Id in FaultIds:
-                self.__Faults.put(f)
-                self.__AllFaults.append(f)
-        self.__CntInjection = len(self.__AllFaults)
+        for FIC in self.__Campaigns:
+            if FIC.FaultModel != self.Campaign.FaultModel or FIC.Image != self.Campaign.Image:
+                die("Fault injection campaign '{}' does not match '{}'".format(FIC.Filename, self.Campaign.Filename))
+            for f in FIC.allFaults():
+                if FaultIds is None or f.Id in FaultIds:
+                    self.__AllFaults.append(f)
+
+        self.__Lock = threading.Lock()
+        self.__Sampler = None
+        if Sampling is not None:
+            self.__Sampler = FaultSampler(self.__AllFaults, self.Campaign.InjectionRangeInfo, Rerun=Rerun, **Sampling)
+            self.__CntClassified = 0 if Rerun else sum(1 for f in self.__AllFaults if f.Effect is not None)
+            self.__CntInjection = 0
+            if verbosity >= 1:
+                for FIC in self.__Campaigns:
+                    print("{}".format(FIC))
+            print("Sampling {} faults in {} strata.".format(len(self.__AllFaults), len(self.__Sampler.Strata)))
+            self.__pbar = tqdm(ascii=True, unit=" faults", disable=verbosity != 0)
+            return
+
+        batches = list()
+        remaining = dict((f.Id, f) for f in self.__AllFaults if Rerun or f.Effect is None)
+        self.__CntClassified = len(self.__AllFaults) - len(remaining)
+        if Plan is not None:
+            for C in Plan.Checkpoints:
+                group = [(remaining.pop(Id), Count) for Id, Count in C.Faults if Id in remaining]
+                size = BatchSize if BatchSize > 0 else max(len(group), 1)
+                for i in range(0, len(group), size):
+                    batches.append((C, group[i:i+size]))
+        for f in remaining.values():
+            batches.append((None, [(f, None)]))
+
+        self.__Batches = list()
+        for w in range(0, Workers):
+            b = len(batches) * w // Workers
+            e = len(batches) * (w + 1) // Workers
+            self.__Batches.append(collections.deque(batches[b:e]))
+
+        self.__CntInjection = len(remaining)
         if verbosity >= 1:
-            print("{}".format(self.Campaign))
+            for FIC in self.__Campaigns:
+                print("{}".format(FIC))
+        if self.__CntClassified > 0:
+            print("{} faults already classified.".format(self.__CntClassified))
         print("{} faults to inject.".format(self.__CntInjection))
         self.__pbar = tqdm(total=self.__CntInjection, ascii=True, unit=" faults", disable=verbosity != 0)
 
     @property
     def Campaign(self):
-        return self.__Campaign
+        """The campaign all others are consistent with."""
+        return self.__Campaigns[0]
 
     @property
-    def Faults(self):
-        return self.__Faults
-
-    def update(self):
+    def Campaigns(self):
+        return self.__Campaigns
+
+    def get(self, Worker):
+        """Get the next batch of faults for Worker to run, or None if all
+        faults have been handed out."""
+        with self.__Lock:
+            if self.__Sampler is not None:
+                f = self.__Sampler.next()
+                if f is None:
+                    return None
+                self.__CntInjection += 1
+                return (None, [(f, None)])
+            own = self.__Batches[Worker % len(self.__Batches)]
+            if own:
+                return own.popleft()
+            victim = max(self.__Batches, key=len)
+            if victim:
+                return victim.pop()
+        return None
+
+    def update(self, TheFault):
+        """Record that TheFault has been run."""
+        if self.__Sampler is not None:
+            with self.__Lock:
+                self.__Sampler.record(TheFault)
         self.__pbar.update(1)
 
     def close(self):
@@ -698,12 +781,20 @@ class FaultDispatcher:
         # Compute and display some statistics.
         Cnt = {'success':0, 'caught':0, 'noeffect':0, 'crash':0, 'undecided':0}
         for f in self.__AllFaults:
+            # The faults which have not been sampled have not been run.
+            if f.Effect is None and self.__Sampler is not None:
+                continue
             if f.Effect not in Cnt:
                 die("Unexpected fault reported : '{}'".format(f.Effect))
             Cnt[f.Effect] += 1
 
+        # The statistics cover the faults classified without being injected.
         print("{} faults injected: {} successful, {} caught, {} noeffect, {} crash and {} undecided"
-                .format(self.__CntInjection, Cnt['success'], Cnt['caught'], Cnt['noeffect'], Cnt['crash'], Cnt['undecided']))
+                .format(self.__CntInjection + self.__CntClassified, Cnt['success'], Cnt['caught'], Cnt['noeffect'], Cnt['crash'], Cnt['undecided']))
+        if self.__Sampler is not None:
+            print("Estimated effect rates:")
+            for line in self.__Sampler.report():
+                print("  {}".format(line))
 
 class FaultInjectionBaseDriver(IrisDriver, ABC):
     """Base class for fault injection drivers."""
@@ -713,10 +804,14 @@ class FaultInjectionBaseDriver(IrisDriver, ABC):
     def __init__(self, dispatcher, image, port, verbosity, hostname):
         IrisDriver.__init__(self, image, port, verbosity, hostname)
         self.__Dispatcher = dispatcher
+        # The workers are numbered in creation order, which is also the
+        # order of their batches in the dispatcher.
         self.__instance = FaultInjectionBaseDriver.num
         self.__logfile = open("fibd-{}.log".format(self.__instance), "w")
         FaultInjectionBaseDriver.num += 1
         self.__IBP = None
+        self.__CheckpointDir = "fibd-{}.checkpoint".format(self.__instance)
+        self.__CheckpointSupported = True
 
     @property
     def Dispatcher(self):
@@ -744,22 +839,11 @@ class FaultInjectionBaseDriver(IrisDriver, ABC):
     def isInjectionBreakpoint(self, addr):
         return self.__IBP is not None and self.__IBP.address == addr
 
-    def runToInjectionPoint(self, TheFault):
-        assert isinstance(TheFault, Fault), "Expecting a subclass of Fault as the fault parameter"
-
-        # Set the breakpoint for injecting the fault.
-        BpAddr = TheFault.BreakpointInfo.Address
-
-        # We need to preserve the breakpoint, for if we see it again (because
-        # the faulted instr was in a loop for example), then we need to restore
-        # the original instruction.
-        assert self.__IBP is None, "Previous Injection breakpoint found."
-        self.__IBP = self.addProgramBreakpoint(BpAddr)
-
+    def runToBreakpoint(self, BpAddr, cnt):
+        """Run until the cnt-th hit of the breakpoint at BpAddr."""
         # Note: it is safe to use run, because the reference trace gives
         # insurance that this breakpoint will be hit. If not, the fault
         # injection campaign file is just wrong.
-        cnt = 1 + TheFault.BreakpointInfo.Count
         while cnt > 0:
             IrisDriver.runModel(self, blocking = True)
             PC = self.readPC()
@@ -772,6 +856,56 @@ class FaultInjectionBaseDriver(IrisDriver, ABC):
                 cnt -= 1
                 self.model._stop_event.clear()
 
+    def resetToProgramEntry(self):
+        if self.isModelRunning():
+            self.stopModel()
+        self.resetModel()
+
+        # Point the reset vector to the image entry.
+        vector_table = self.readMemWord(0xE000ED08)
+        self.writeMemWord(vector_table + 4, self.Dispatcher.Campaign.ProgramEntryAddress | 0x01)
+        self.reloadImage()
+        # PSR is UNK on reset from the ARM ARM, but is 0x01000000 in
+        # the model. To ensure consistent simulations, reset it
+        # ourselves.
+        self.writeRegister("XPSR", 0x01000000)
+
+    def runToCheckpoint(self, TheCheckpoint):
+        """Run from the program start to TheCheckpoint, and save the model
+        state there. Returns False if the model state could not be saved, in
+        which case the faults have to be run from the program start."""
+        if not self.__CheckpointSupported:
+            return False
+        self.resetToProgramEntry()
+        BP = self.addProgramBreakpoint(TheCheckpoint.BreakpointInfo.Address)
+        self.runToBreakpoint(TheCheckpoint.BreakpointInfo.Address, 1 + TheCheckpoint.BreakpointInfo.Count)
+        BP.delete()
+        try:
+            self.saveCheckpoint(self.__CheckpointDir)
+        except Exception as e:
+            warning("Saving the model state is not supported ({}), running the faults from the program start.".format(e))
+            self.__CheckpointSupported = False
+            return False
+        return True
+
+    def runToInjectionPoint(self, TheFault, cnt = None):
+        """Run to the injection point of TheFault, i.e. until the cnt-th hit of
+        its breakpoint, which is by default computed from the program start."""
+        assert isinstance(TheFault, Fault), "Expecting a subclass of Fault as the fault parameter"
+
+        # Set the breakpoint for injecting the fault.
+        BpAddr = TheFault.BreakpointInfo.Address
+
+        # We need to preserve the breakpoint, for if we see it again (because
+        # the faulted instr was in a loop for example), then we need to restore
+        # the original instruction.
+        assert self.__IBP is None, "Previous Injection breakpoint found."
+        self.__IBP = self.addProgramBreakpoint(BpAddr)
+
+        if cnt is None:
+            cnt = 1 + TheFault.BreakpointInfo.Count
+        self.runToBreakpoint(BpAddr, cnt)
+
         # When we reach this point, we are supposed to be at the injection point.
         # Assert this is the case.
         PC = self.readPC()
@@ -782,134 +916,139 @@ class FaultInjectionBaseDriver(IrisDriver, ABC):
         if self.verbosity >= 1:
             print("Injecting Fault Id:{} => ".format(TheFault.Id), end = '')
 
+    def runFault(self, TheFault, cnt = None):
+        """Run TheFault, from the current model state, and classify its
+        effect. cnt is the number of hits of the fault breakpoint to wait
+        for before injecting it, which is by default computed from the
+        program start."""
+        # Run to the injection point and inject the fault !
+        self.inject(TheFault, cnt)
+
+        # Now run (carefuly) to the end or until a breakpoint is hit..
+        # This is pessimistic as we have already run some cycles, but
+        # this gives some upper bound.
+        # Note: it is tempting to rather rely on a timeout.
+        # Unfortunately, at the time of writing, the FastModel exists
+        # on a timeout rather than stops letting the user decide what's
+        # to be done. We thus have to step, keeping in mind that
+        # FastModel stepping is at best imprecise (so take some
+        # security margins).
+        OracleMet = False
+        i = 0 # Avoid infinite loops...
+        while not OracleMet and i < 3:
+            try:
+                IrisDriver.runModel(self, timeout = 5)
+            except iris.debug.Exceptions.TimeoutError:
+                # Break out of this main loop. The TimeOut error
+                # signals that we are in some kind of infinite loop.
+                # This is analyzed further when the Oracle has not been
+                # met.
+                Pc = self.readPC()
+                if self.verbosity >= 1:
+                    print("(hit run timeout)")
+                break
+            else:
+                Pc = self.readPC()
+
+                # Catch ProgramEnd here, although it's not strictly
+                # speaking an oracle, but it's still an easy guess and an
+                # early exit possibility speeding up the simulation time.
+                if Pc == self.Dispatcher.Campaign.ProgramEndAddress:
+                    TheFault.Effect = 'noeffect'
+                    OracleMet = True
+                    if self.verbosity >= 1:
+                        print("{}: reached end of program, without meeting the Oracle...".format(TheFault.Effect))
+                    break
+
+                # Catch fault injection point breakpoint and clear it: this
+                # means this was in a sort of loop, and if we reach this
+                # breakpoint, this means the FaultInjectionDriver wants to
+                # do some state restoring. There is no need to increment the
+                # loop counter yet.
+                if self.isInjectionBreakpoint(Pc):
+                    if self.verbosity >= 2:
+                        print("Hit injection breakpoint (pc=0x{:X}), clearing it...".format(Pc))
+                    self.model._stop_event.clear()
+                    self.restore(TheFault)
+                    continue
+
+                # Did we hit one of the Oracle's breakpoints ? If yes, ask the Oracle
+                # for a statement, and stop the simulation.
+                Effect = self.Dispatcher.Campaign.Oracle.classify(Pc)
+                if Effect is not None:
+                    TheFault.Effect = Effect
+                    if self.verbosity >= 1:
+                        print("{} (from the Oracle)".format(TheFault.Effect))
+                    OracleMet = True
+                    self.model._stop_event.clear()
+
+                # We may be caught in a loop / computation taking a
+                # bit more time than usual, so try to see if we can get to
+                # a decision by simulating a bit longer.
+                if not OracleMet:
+                    i += 1
+                    if self.verbosity >= 2:
+                        print(" (spinning, pc=0x{:X}) ".format(Pc), end = '')
+
+        # We are at the end of simulation time, and did not meet the Oracle.
+        # We still can try to make some educated guess about what happened.
+        if not OracleMet:
+            inCallTree = False
+            for F in self.Dispatcher.Campaign.InjectionRangeInfo:
+                if F.isInCallTree(Pc):
+                    # Here we really want to handle the case where the PC is
+                    # somewhere in the valid call tree. A longer simulation time
+                    # could, but no guarantee, enable the oracle to find out more.
+                    TheFault.Effect = 'undecided'
+                    inCallTree = True
+                    if self.verbosity >= 1:
+                        print("{}: still somewhere in a plausible calltree".format(TheFault.Effect))
+                    break
+            if not inCallTree:
+                TheFault.Effect = 'crash'
+                if self.verbosity >= 1:
+                    print("{}: more abnormal than expected program behaviour...".format(TheFault.Effect))
+
+        # Clear any state in the Driver:
+        self.restore()
+
+        self.Dispatcher.update(TheFault)
+        self.__logfile.write("Fault #{} => {}\n".format(TheFault.Id, TheFault.Effect))
+        self.__logfile.flush()
+
     def runModel(self, blocking = True, timeout = None):
 
         # Breakpoints are persistent over model resets, so let's set them once for all for the Oracle.
-        for C in self.Dispatcher.Campaign.Oracle.Classifiers:
-            self.addProgramBreakpoint(C.Pc)
+        for Pc in self.Dispatcher.Campaign.Oracle.Pcs:
+            self.addProgramBreakpoint(Pc)
 
         # Keep a list of the faults we have processed for logging / debugging purpose.
         ourFaults = list()
 
-        try:
-            # Slurp faults while there are some available.
-            while True:
-                TheFault = self.Dispatcher.Faults.get(block=False)
+        # Slurp faults while there are some available.
+        while True:
+            Batch = self.Dispatcher.get(self.__instance)
+            if Batch is None:
+                break
+            TheCheckpoint, Group = Batch
+            Snapshot = TheCheckpoint is not None and self.runToCheckpoint(TheCheckpoint)
+            for TheFault, Count in Group:
                 ourFaults.append(TheFault)
-
-                if self.isModelRunning():
-                    self.stopModel()
-                self.resetModel()
-
-                # Point the reset vector to the image entry.
-                vector_table = self.readMemWord(0xE000ED08)
-                self.writeMemWord(vector_table + 4, self.Dispatcher.Campaign.ProgramEntryAddress | 0x01)
-                self.reloadImage()
-                # PSR is UNK on reset from the ARM ARM, but is 0x01000000 in
-                # the model. To ensure consistent simulations, reset it
-                # ourselves.
-                self.writeRegister("XPSR", 0x01000000)
-
-                # Run to the injection point and inject the fault !
-                self.inject(TheFault)
-
-                # Now run (carefuly) to the end or until a breakpoint is hit..
-                # This is pessimistic as we have already run some cycles, but
-                # this gives some upper bound.
-                # Note: it is tempting to rather rely on a timeout.
-                # Unfortunately, at the time of writing, the FastModel exists
-                # on a timeout rather than stops letting the user decide what's
-                # to be done. We thus have to step, keeping in mind that
-                # FastModel stepping is at best imprecise (so take some
-                # security margins).
-                OracleMet = False
-                i = 0 # Avoid infinite loops...
-                while not OracleMet and i < 3:
-                    try:
-                        IrisDriver.runModel(self, timeout = 5)
-                    except iris.debug.Exceptions.TimeoutError:
-                        # Break out of this main loop. The TimeOut error
-                        # signals that we are in some kind of infinite loop.
-                        # This is analyzed further when the Oracle has not been
-                        # met.
-                        Pc = self.readPC()
-                        if self.verbosity >= 1:
-                            print("(hit run timeout)")
-                        break
-                    else:
-                        Pc = self.readPC()
-
-                        # Catch ProgramEnd here, although it's not strictly
-                        # speaking an oracle, but it's still an easy guess and an
-                        # early exit possibility speeding up the simulation time.
-                        if Pc == self.Dispatcher.Campaign.ProgramEndAddress:
-                            TheFault.Effect = 'noeffect'
-                            OracleMet = True
-                            if self.verbosity >= 1:
-                                print("{}: reached end of program, without meeting the Oracle...".format(TheFault.Effect))
-                            break
-
-                        # Catch fault injection point breakpoint and clear it: this
-                        # means this was in a sort of loop, and if we reach this
-                        # breakpoint, this means the FaultInjectionDriver wants to
-                        # do some state restoring. There is no need to increment the
-                        # loop counter yet.
-                        if self.isInjectionBreakpoint(Pc):
-                            if self.verbosity >= 2:
-                                print("Hit injection breakpoint (pc=0x{:X}), clearing it...".format(Pc))
-                            self.model._stop_event.clear()
-                            self.restore(TheFault)
-                            continue
-
-                        # Did we hit one of the Oracle's breakpoints ? If yes, ask the Oracle
-                        # for a statement, and stop the simulation.
-                        for C in self.Dispatcher.Campaign.Oracle.Classifiers:
-                            if Pc == C.Pc:
-                                TheFault.Effect = C.eval()
-                                if self.verbosity >= 1:
-                                    print("{} (from the Oracle)".format(TheFault.Effect))
-                                OracleMet = True
-                                self.model._stop_event.clear()
-                                break
-
-                        # We may be caught in a loop / computation taking a
-                        # bit more time than usual, so try to see if we can get to
-                        # a decision by simulating a bit longer.
-                        if not OracleMet:
-                            i += 1
-                            if self.verbosity >= 2:
-                                print(" (spinning, pc=0x{:X}) ".format(Pc), end = '')
-
-                # We are at the end of simulation time, and did not meet the Oracle.
-                # We still can try to make some educated guess about what happened.
-                if not OracleMet:
-                    inCallTree = False
-                    for F in self.Dispatcher.Campaign.InjectionRangeInfo:
-                        if F.isInCallTree(Pc):
-                            # Here we really want to handle the case where the PC is
-                            # somewhere in the valid call tree. A longer simulation time
-                            # could, but no guarantee, enable the oracle to find out more.
-                            TheFault.Effect = 'undecided'
-                            inCallTree = True
-                            if self.verbosity >= 1:
-                                print("{}: still somewhere in a plausible calltree".format(TheFault.Effect))
-                            break
-                    if not inCallTree:
-                        TheFault.Effect = 'crash'
-                        if self.verbosity >= 1:
-                            print("{}: more abnormal than expected program behaviour...".format(TheFault.Effect))
-
-                # Clear any state in the Driver:
-                self.restore()
-
-                self.Dispatcher.update()
-                self.__logfile.write("Fault #{} => {}\n".format(TheFault.Id, TheFault.Effect))
-                self.__logfile.flush()
-
-        except queue.Empty:
-            self.__logfile.write("This session can be replayed by adding '-f {}' to your run-model.py invocation.\n"
-                    .format(",".join(["{}".format(f.Id) for f in ourFaults])))
-            self.__logfile.flush()
+                if Snapshot:
+                    self.restoreCheckpoint(self.__CheckpointDir)
+                    # The model is stopped at the checkpoint breakpoint,
+                    # so when the fault uses the same breakpoint, its
+                    # current hit is already consumed.
+                    if TheFault.BreakpointInfo.Address != TheCheckpoint.BreakpointInfo.Address:
+                        Count += 1
+                    self.runFault(TheFault, Count)
+                else:
+                    self.resetToProgramEntry()
+                    self.runFault(TheFault)
+
+        self.__logfile.write("This session can be replayed by adding '-f {}' to your run-model.py invocation.\n"
+                .format(",".join(["{}".format(f.Id) for f in ourFaults])))
+        self.__logfile.flush()
 
 class InstructionSkipDriver(FaultInjectionBaseDriver):
     """InstructionSkip fault simulation driver"""
@@ -944,10 +1083,10 @@ class InstructionSkipDriver(FaultInjectionBaseDriver):
         # We no longer need that breakpoint: nuke it.
         self.clearInjectionBreakpoint()
 
-    def inject(self, TheFault):
+    def inject(self, TheFault, cnt = None):
         assert isinstance(TheFault, InstructionSkip), \
                "Expecting an InstructionSkip as the fault parameter"
-        FaultInjectionBaseDriver.runToInjectionPoint(self, TheFault)
+        FaultInjectionBaseDriver.runToInjectionPoint(self, TheFault, cnt)
 
         # Sanity check the instruction to fault matches our fault injection campaign.
         PC = self.readPC()
@@ -1010,16 +1149,22 @@ class CorruptRegDefDriver(FaultInjectionBaseDriver):
         # as we did it as soon as the fault was injected.
         pass
 
-    def inject(self, TheFault):
+    def inject(self, TheFault, cnt = None):
         assert isinstance(TheFault, CorruptRegDef), \
                "Expecting a CorruptRegDef as the fault parameter"
 
-        FaultInjectionBaseDriver.runToInjectionPoint(self, TheFault)
+        FaultInjectionBaseDriver.runToInjectionPoint(self, TheFault, cnt)
         # The breakpoint is no longer needed, there is nothing to restore as
         # the data is propagated by the program execution.
         self.clearInjectionBreakpoint()
 
-        if TheFault.FaultedReg == "PSR":
+        if TheFault.hasMasks():
+            # The fault belongs to a corruption family, which specifies how
+            # the register value gets corrupted.
+            reg = "XPSR" if TheFault.FaultedReg == "PSR" else TheFault.FaultedReg
+            val = self.readRegister(reg)
+            self.writeRegister(reg, (val & TheFault.AndMask) ^ TheFault.XorMask)
+        elif TheFault.FaultedReg == "PSR":
             PSR = "XPSR"
             if self.HardPSRFault:
                 self.writeRegister(PSR, self.FaultValue)
@@ -1102,18 +1247,59 @@ def run_model(args):
         choices = ['IrisDriver', 'FaultInjection', 'CheckPoint', 'DataOverrider'],
         default = 'IrisDriver')
     parser.add_argument("-c", "--driver-cfg",
-        help = "simulation driver configuration to use (a.k.a fault injection campaign)",
+        help = "simulation driver configuration to use (a.k.a fault injection campaign), which can be specified multiple times to run several campaign shards",
         metavar = 'CampaignFile',
+        action = 'append',
         default = None)
     parser.add_argument("-f", "--fault-ids",
         help = "A comma separated list of fault Ids or Ids range to run (from the fault injection campaign)",
         metavar = 'FaultIds',
         default = None)
+    parser.add_argument("--shard",
+        help = "Only run shard K of N (counting from 0) of a binary fault injection campaign",
+        metavar = 'K/N',
+        default = None)
+    parser.add_argument("--shard-by-range",
+        help = "Do not split the injection ranges accross the campaign shards",
+        action = "store_true",
+        default = False)
+    parser.add_argument("--checkpoint-plan",
+        help = "Run the faults from the checkpoints planned by the faulter in CheckpointFile, rather than from the program start",
+        metavar = 'CheckpointFile',
+        default = None)
+    parser.add_argument("--batch-size",
+        help = "Maximum number of faults run from the same checkpoint that are handed out at once to a job (default: all of them)",
+        type = int,
+        metavar = 'NUM',
+        default = 0)
     parser.add_argument("-j", "--jobs",
         help = "Number of fault injection jobs to run in parallel (default: %(default)s)",
         type = int,
         metavar = 'NUM',
         default = 1)
+    parser.add_argument("--sample",
+        help = "Only run a random sample of the faults, until the success and crash rates are estimated with the requested precision in each stratum of the faults: all faults, or per injection range or faulted instruction address",
+        choices = FaultSampler.Stratifications,
+        default = None)
+    parser.add_argument("--precision",
+        help = "With --sample, the half width of the confidence interval to reach on the rates (default: %(default)s)",
+        type = float,
+        metavar = 'P',
+        default = 0.01)
+    parser.add_argument("--confidence",
+        help = "With --sample, the confidence level of the interval on the rates (default: %(default)s)",
+        type = float,
+        metavar = 'C',
+        default = 0.95)
+    parser.add_argument("--seed",
+        help = "With --sample, the seed of the random sampling, for reproducible samples",
+        type = int,
+        metavar = 'SEED',
+        default = None)
+    parser.add_argument("--rerun-classified",
+        help = "Also inject the faults which already have an effect in the campaign, e.g. classified by the faulter's simulation",
+        action = "store_true",
+        default = False)
     parser.add_argument("--hard-psr-fault",
         help = "With the CorruptRegDef model, fault the full PSR instead of just the CC",
         action = "store_true",
@@ -1181,8 +1367,22 @@ def run_model(args):
     if options.driver == 'FaultInjection':
         if options.driver_cfg is None:
             die("Fault simulation driver {} requires a fault injection campaing file.".format(options.driver))
-        if not os.path.isfile(options.driver_cfg):
-            die("Fault injection campaign file {} does not exist.".format(options.driver_cfg))
+        for F in options.driver_cfg:
+            if not os.path.isfile(F):
+                die("Fault injection campaign file {} does not exist.".format(F))
+        if options.shard is not None:
+            m = re.match('^(\d+)/(\d+)$', options.shard)
+            if not m or int(m.group(1)) >= int(m.group(2)):
+                die("Unrecognized shard specification: '{}'".format(options.shard))
+            options.shard = (int(m.group(1)), int(m.group(2)))
+        if options.sample is not None:
+            if not 0 < options.precision < 0.5:
+                die("Unexpected sampling precision: {}".format(options.precision))
+            if not 0 < options.confidence < 1:
+                die("Unexpected sampling confidence level: {}".format(options.confidence))
+            if options.checkpoint_plan is not None:
+                warning("The sampled faults are run from the program start, ignoring the checkpoint plan")
+                options.checkpoint_plan = None
     elif options.driver == 'DataOverrider':
         if options.override_when_entering is None:
             die("Data overrider driver error ! No override point specified")
@@ -1273,8 +1473,20 @@ def run_model(args):
             jobs = options.jobs)
 
     if options.driver == 'FaultInjection':
-        FIC = FaultInjectionCampaign(options.driver_cfg)
-        Dispatcher = FaultDispatcher(FIC, options.fault_ids, verbosity=options.verbose)
+        FICs = [FaultInjectionCampaign(F, options.shard, options.shard_by_range) for F in options.driver_cfg]
+        FIC = FICs[0]
+        Plan = None
+        if options.checkpoint_plan is not None:
+            Plan = CheckpointPlan(options.checkpoint_plan)
+        # The faulter simulates the register corruptions as resets.
+        Rerun = options.rerun_classified or (FIC.FaultModel == 'CorruptRegDef' and options.reg_fault_value != 'reset')
+        Sampling = None
+        if options.sample is not None:
+            Sampling = {'Stratify': options.sample, 'Precision': options.precision,
+                        'Confidence': options.confidence, 'Seed': options.seed}
+        Dispatcher = FaultDispatcher(FICs, options.fault_ids, verbosity=options.verbose, Plan=Plan,
+                                     Workers=options.jobs, BatchSize=options.batch_size, Rerun=Rerun,
+                                     Sampling=Sampling)
         for i in range(0, options.jobs):
             ID = FaultInjectionBaseDriver.getConcreteDriver(Dispatcher, elfImage, options.iris_port+i, verbosity=options.verbose)
             if FIC.FaultModel == 'CorruptRegDef':
@@ -1284,11 +1496,14 @@ def run_model(args):
         IDP.run()
         IDP.finalize()
         Dispatcher.close()
-        if options.driver_cfg is not None:
-            FIC.saveToFile(options.driver_cfg + ".results")
-        if options.verbose >= 1:
-            print("Fault injection campaign results:")
-            print("{}".format(FIC))
+        for F, FIC in zip(options.driver_cfg, FICs):
+            if options.shard is not None:
+                FIC.saveToFile("{}.{}.results".format(F, options.shard[0]))
+            else:
+                FIC.saveToFile(F + ".results")
+            if options.verbose >= 1:
+                print("Fault injection campaign results:")
+                print("{}".format(FIC))
     elif options.driver == 'CheckPoint':
         ID = CheckPointDriver(elfImage, options.iris_port, verbosity=options.verbose)
         IDP.addDriver(ID, options.cpu_limit)
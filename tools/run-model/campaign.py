@@ -51,6 +51,9 @@ def main(args):
     actions.add_argument("--summary",
         help="Display a summary of the campaign results",
         action="store_true")
+    actions.add_argument("--merge",
+        help="Merge all campaign files, e.g. the results of the campaign shards, into OUTPUT",
+        metavar="OUTPUT")
 
     # Our options:
     parser.add_argument("--dry-run",
@@ -66,6 +69,22 @@ def main(args):
 
     options = parser.parse_args(args)
 
+    if options.merge:
+        Merged = None
+        for F in options.campaign_files:
+            if options.verbose:
+                print("Merging '{}'".format(F))
+            FIC = FaultInjectionCampaign(F)
+            if Merged is None:
+                Merged = FIC
+            else:
+                Merged.merge(FIC)
+        if options.dry_run:
+            print("{}".format(Merged))
+        else:
+            Merged.saveToFile(options.merge)
+        return 0
+
     ExitValue = 0
     for F in options.campaign_files:
         if options.verbose:
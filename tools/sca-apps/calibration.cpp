@@ -19,67 +19,77 @@
  */
 
 #include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/NPHistogram.h"
+#include "PAF/SCA/Prefetcher.h"
+#include "PAF/utils/Parallel.h"
+#include "PAF/utils/Stats.h"
 
+#include "libtarmac/argparse.hh"
 #include "libtarmac/reporter.hh"
 
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <mutex>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 using namespace std;
 using namespace PAF::SCA;
+using PAF::ScopedTimer;
+using PAF::Stats;
 
-template <typename Ty> struct MinMax {
-    Ty minValue;
-    Ty maxValue;
-    size_t minCnt{0};
-    size_t maxCnt{0};
-
-    MinMax()
-        : minValue(numeric_limits<Ty>::max()),
-          maxValue(numeric_limits<Ty>::min()) {}
-
-    void operator()(double v) {
-        if (v > maxValue) {
-            maxValue = v;
-            maxCnt = 1;
-        } else if (v == maxValue) {
-            maxCnt += 1;
-        } else if (v == minValue) {
-            minCnt += 1;
-        } else if (v < minValue) {
-            minValue = v;
-            minCnt = 1;
-        }
-    }
+// Get the histogram of the ADC codes: one bin per code for the small integral
+// types, num_bins bins over the type range for the other integral types, and
+// num_bins bins over the [-0.5, 0.5( range of the ChipWhisperer ADC for the
+// floating point types.
+template <typename Ty> NPHistogram<Ty> makeHistogram(size_t num_bins) {
+    if constexpr (is_integral<Ty>() && sizeof(Ty) <= 2)
+        return NPHistogram<Ty>();
+    else if constexpr (is_integral<Ty>())
+        return NPHistogram<Ty>(double(numeric_limits<Ty>::lowest()),
+                               double(numeric_limits<Ty>::max()) + 1.0,
+                               num_bins);
+    else
+        return NPHistogram<Ty>(-0.5, 0.5, num_bins);
+}
 
-    void operator+=(const MinMax &o) {
-        if (o.maxValue > maxValue) {
-            maxValue = o.maxValue;
-            maxCnt = o.maxCnt;
-        } else if (o.maxValue == maxValue)
-            maxCnt += o.maxCnt;
-
-        if (o.minValue < minValue) {
-            minValue = o.minValue;
-            minCnt = o.minCnt;
-        } else if (o.minValue == minValue)
-            minCnt += o.minCnt;
-    }
+template <typename Ty>
+void dump(ostream &os, const char *filename, const MinMaxCount<Ty> &minmax) {
+    // The unary + gets the 8 bits types displayed as numbers.
+    os << filename << ": \t" << +minmax.min() << " (" << minmax.minCount()
+       << ')';
+    os << "\t" << +minmax.max() << " (" << minmax.maxCount() << ")\n";
+}
 
-    void dump(ostream &os, const char *filename) const {
-        os << filename << ": \t" << minValue << " (" << minCnt << ')';
-        os << "\t" << maxValue << " (" << maxCnt << ")\n";
-    }
-};
+template <typename Ty>
+void dump(ostream &os, const NPHistogram<Ty> &histogram) {
+    // Only the non empty bins are displayed.
+    os << "Histogram:\n";
+    for (size_t i = 0; i < histogram.size(); i++)
+        if (histogram[i] != 0)
+            os << "  " << histogram.binLow(i) << ": " << histogram[i] << '\n';
+    if (histogram.below() != 0)
+        os << "  below: " << histogram.below() << '\n';
+    if (histogram.above() != 0)
+        os << "  above: " << histogram.above() << '\n';
+}
 
-template <typename Ty> bool visit(const vector<const char *> &filenames) {
-    MinMax<Ty> g_minmax;
+template <typename Ty>
+bool visit(const vector<string> &filenames, NPArrayBase::LoadMode mode,
+           bool with_histogram, size_t num_bins) {
+    MinMaxCount<Ty> g_minmax;
+    NPHistogram<Ty> g_histogram = makeHistogram<Ty>(num_bins);
 
-    for (const auto &filename : filenames) {
-        NPArray<Ty> t(filename);
+    // Read the next file while the current one is being scanned.
+    Prefetcher<NPArray<Ty>> files(filenames.size(), [&](size_t i) {
+        return NPArray<Ty>(filenames[i], NPArrayBase::Window(), mode);
+    });
+    while (files.next()) {
+        const string &filename = filenames[files.index()];
+        const NPArray<Ty> &t = files.current();
 
         if (!t.good()) {
             cerr << "Error reading '" << filename << "' (" << t.error()
@@ -87,19 +97,37 @@ template <typename Ty> bool visit(const vector<const char *> &filenames) {
             return false;
         }
 
-        MinMax<Ty> minmax;
-
-        for (size_t r = 0; r < t.rows(); r++)
-            for (size_t c = 0; c < t.cols(); c++)
-                minmax(t(r, c));
+        // Scan blocks of rows in parallel, then merge the partial results:
+        // minima, maxima and counts do not depend on the merge order.
+        MinMaxCount<Ty> minmax;
+        NPHistogram<Ty> histogram = makeHistogram<Ty>(num_bins);
+        mutex mtx;
+        if (!t.empty())
+            NPArrayBase::parallelFor(
+                0, t.rows(), t.cols(), [&](size_t b, size_t e) {
+                    // The rows are contiguous in memory.
+                    const Ty *values = &t(b, 0);
+                    const size_t n = (e - b) * t.cols();
+                    MinMaxCount<Ty> l_minmax;
+                    l_minmax.add(values, n);
+                    NPHistogram<Ty> l_histogram = makeHistogram<Ty>(num_bins);
+                    if (with_histogram)
+                        l_histogram.add(values, n);
+                    lock_guard<mutex> lock(mtx);
+                    minmax += l_minmax;
+                    histogram += l_histogram;
+                });
 
         if (filenames.size() > 1)
-            minmax.dump(cout, filename);
+            dump(cout, filename.c_str(), minmax);
 
         g_minmax += minmax;
+        g_histogram += histogram;
     }
 
-    g_minmax.dump(cout, "Overall");
+    dump(cout, "Overall", g_minmax);
+    if (with_histogram)
+        dump(cout, g_histogram);
 
 #if 0
     const double ADC_MIN = -0.5;
@@ -125,13 +153,44 @@ template <typename Ty> bool visit(const vector<const char *> &filenames) {
 unique_ptr<Reporter> reporter = make_cli_reporter();
 
 int main(int argc, char *argv[]) {
+    vector<string> filenames;
+    unsigned num_jobs = PAF::defaultNumThreads(1);
+    NPArrayBase::LoadMode mode = NPArrayBase::READ;
+    bool with_histogram = false;
+    size_t num_bins = 1024;
 
-    if (argc <= 1) {
-        cerr << "Usage: calibration file.npy [file.npy]\n";
-        return EXIT_FAILURE;
-    }
+    Argparse argparser("paf-calibration", argc, argv);
+    argparser.optval({"-j", "--jobs"}, "N",
+                     "use up to N threads for the computations (default: "
+                     "$PAF_NUM_THREADS, or 1; 0 uses as many threads as the "
+                     "hardware supports).",
+                     [&](const string &s) {
+                         num_jobs = stoul(s, nullptr, 0);
+                     });
+    argparser.optnoval({"--mmap"},
+                       "memory map the files instead of reading them.",
+                       [&]() { mode = NPArrayBase::MMAP; });
+    argparser.optnoval({"--histogram"},
+                       "display the histogram of the ADC codes.",
+                       [&]() { with_histogram = true; });
+    argparser.optval({"--bins"}, "N",
+                     "use N bins for the histogram of the floating point and "
+                     "32 or 64 bits integer types (default: 1024).",
+                     [&](const string &s) {
+                         num_bins = stoull(s, nullptr, 0);
+                         if (num_bins == 0)
+                             reporter->errx(EXIT_FAILURE,
+                                            "the number of bins can not be 0");
+                     });
+    argparser.positional_multiple(
+        "NPY_FILES", "input files in numpy format",
+        [&](const string &s) { filenames.push_back(s); },
+        /* Required: */ true);
+    Stats::addOptions(argparser);
+    argparser.parse();
+    const ScopedTimer T("paf-calibration");
 
-    const vector<const char *> filenames(&argv[1], &argv[argc]);
+    NPArrayBase::setNumThreads(num_jobs);
 
     // Check that if we were given several input files they are all with the
     // same element types.
@@ -168,10 +227,10 @@ int main(int argc, char *argv[]) {
     if (elt_ty[0] == 'f') {
         switch (elt_ty[1]) {
         case '4':
-            err = visit<float>(filenames);
+            err = !visit<float>(filenames, mode, with_histogram, num_bins);
             break;
         case '8':
-            err = visit<double>(filenames);
+            err = !visit<double>(filenames, mode, with_histogram, num_bins);
             break;
         default:
             cerr << "Unsupported floating point type '" << elt_ty << "'\n";
@@ -179,18 +238,18 @@ int main(int argc, char *argv[]) {
             break;
         }
     } else if (elt_ty[0] == 'i') {
-        switch (elt_size) {
+        switch (elt_ty[1]) {
         case '1':
-            err = visit<int8_t>(filenames);
+            err = !visit<int8_t>(filenames, mode, with_histogram, num_bins);
             break;
         case '2':
-            err = visit<int16_t>(filenames);
+            err = !visit<int16_t>(filenames, mode, with_histogram, num_bins);
             break;
         case '4':
-            err = visit<int32_t>(filenames);
+            err = !visit<int32_t>(filenames, mode, with_histogram, num_bins);
             break;
         case '8':
-            err = visit<int64_t>(filenames);
+            err = !visit<int64_t>(filenames, mode, with_histogram, num_bins);
             break;
         default:
             cerr << "Unsupported integer type '" << elt_ty << "'\n";
@@ -198,18 +257,18 @@ int main(int argc, char *argv[]) {
             break;
         }
     } else if (elt_ty[0] == 'u') {
-        switch (elt_size) {
+        switch (elt_ty[1]) {
         case '1':
-            err = visit<uint8_t>(filenames);
+            err = !visit<uint8_t>(filenames, mode, with_histogram, num_bins);
             break;
         case '2':
-            err = visit<uint16_t>(filenames);
+            err = !visit<uint16_t>(filenames, mode, with_histogram, num_bins);
             break;
         case '4':
-            err = visit<uint32_t>(filenames);
+            err = !visit<uint32_t>(filenames, mode, with_histogram, num_bins);
             break;
         case '8':
-            err = visit<uint64_t>(filenames);
+            err = !visit<uint64_t>(filenames, mode, with_histogram, num_bins);
             break;
         default:
             cerr << "Unsupported unsigned integer type '" << elt_ty << "'\n";
@@ -0,0 +1,314 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited
+ * and/or its affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/Expr.h"
+#include "PAF/SCA/ExprParser.h"
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/SCA.h"
+#include "PAF/SCA/ShardedNPArray.h"
+#include "PAF/SCA/sca-apps.h"
+#include "PAF/utils/Stats.h"
+
+#include "libtarmac/reporter.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+using namespace PAF::SCA;
+
+// The expected type in the 'data' files (e.g. inputs, masks, keys, ...)
+using NPDataTy = uint32_t;
+static_assert(is_integral<NPDataTy>(), "NPDataTy must be an integral type");
+
+enum class ClassMetric : uint8_t { SNR, SOST };
+
+#ifndef CLASS_METRIC
+#error The CLASS_METRIC macro is not defined. Select one from SNR, SOST.
+#endif
+
+unique_ptr<Reporter> reporter = make_cli_reporter();
+
+unique_ptr<NPArray<NPDataTy>> readNumpyDataFile(const string &name,
+                                                const string &filename,
+                                                unsigned verbosity) {
+    if (filename.empty())
+        return nullptr;
+
+    unique_ptr<NPArray<NPDataTy>> np(new NPArray<NPDataTy>(filename));
+    if (!np->good())
+        reporter->errx(EXIT_FAILURE,
+                       "Error reading numpy data for '%s' from file '%s' (%s)",
+                       name.c_str(), filename.c_str(), np->error());
+
+    if (verbosity > 0) {
+        cout << "Read " << np->rows() << " x " << np->cols() << " data from "
+             << filename << '\n';
+        if (verbosity >= 2)
+            np->dump(cout, 3, 4, name.c_str());
+    }
+
+    return np;
+}
+
+// Evaluate the expressions in expr_strings, with the variables in context,
+// on the nbtraces traces: the value of an expression is the class of a trace.
+// The number of classes of an expression is derived from its width, which
+// must be at most 16 bits.
+vector<vector<uint32_t>> getClasses(Expr::Context<uint32_t> &context,
+                                    const vector<string> &expr_strings,
+                                    size_t nbtraces,
+                                    vector<size_t> &num_classes) {
+    // Compile all expressions to a single program, so that their common
+    // subterms are only evaluated once.
+    vector<unique_ptr<Expr::Expr>> exprs;
+    Expr::Program program;
+    for (const string &str : expr_strings) {
+        Expr::Parser<NPDataTy> parser(context, str);
+        exprs.emplace_back(parser.parse());
+        if (!exprs.back())
+            reporter->errx(EXIT_FAILURE, "Error parsing expression '%s'",
+                           str.c_str());
+        const size_t numBits =
+            Expr::ValueType::getNumBits(exprs.back()->getType());
+        if (numBits > 16)
+            reporter->errx(EXIT_FAILURE,
+                           "Expression '%s' is %zu bits wide, at most 16 bits "
+                           "are supported (use trunc8 or trunc16)",
+                           str.c_str(), numBits);
+        num_classes.push_back(size_t(1) << numBits);
+        program.add(*exprs.back());
+    }
+
+    // Evaluate the expressions a chunk of traces at a time.
+    vector<vector<uint32_t>> classes(exprs.size(), vector<uint32_t>(nbtraces));
+    const size_t chunkSize = 65536;
+    vector<Expr::Value::ConcreteType> values(exprs.size() *
+                                             min(chunkSize, nbtraces));
+    for (size_t tb = 0; tb < nbtraces; tb += chunkSize) {
+        const size_t cn = min(chunkSize, nbtraces - tb);
+        program.eval(values.data(), tb, cn);
+        for (size_t i = 0; i < exprs.size(); i++)
+            for (size_t t = 0; t < cn; t++)
+                classes[i][tb + t] =
+                    uint32_t(values[i * cn + t] & (num_classes[i] - 1));
+    }
+
+    return classes;
+}
+
+// Feed all traces to the accumulators, one chunk at a time for sharded
+// traces.
+template <typename PowerTy>
+void accumulate(vector<ClassAccumulator<PowerTy>> &accs,
+                const NPArray<PowerTy> &traces,
+                const vector<vector<uint32_t>> &classes) {
+    for (size_t i = 0; i < accs.size(); i++)
+        accs[i].add(traces, classes[i]);
+}
+
+template <typename PowerTy>
+void accumulate(vector<ClassAccumulator<PowerTy>> &accs,
+                ShardedNPArray<PowerTy> &traces,
+                const vector<vector<uint32_t>> &classes) {
+    while (traces.next())
+        for (size_t i = 0; i < accs.size(); i++)
+            accs[i].add(traces.chunk(), classes[i], traces.chunkBegin());
+    if (!traces.good())
+        reporter->errx(EXIT_FAILURE, "Error reading traces (%s)",
+                       traces.error());
+}
+
+// Compute the metric for each of the expressions in expr_strings on traces.
+template <class TracesTy>
+NPArray<double> computeMetrics(SCAApp &app, TracesTy &traces,
+                               Expr::Context<uint32_t> &context,
+                               const vector<string> &expr_strings) {
+    using PowerTy = typename remove_const_t<TracesTy>::DataTy;
+    const size_t nbsamples = traces.cols();
+
+    if (app.verbose())
+        cout << "Will process " << nbsamples
+             << " samples per traces, starting at sample " << app.sampleStart()
+             << "\n";
+
+    vector<size_t> numClasses;
+    const vector<vector<uint32_t>> classes =
+        getClasses(context, expr_strings, traces.rows(), numClasses);
+
+    // All the accumulators are fed in a single pass over the traces.
+    vector<ClassAccumulator<PowerTy>> accs;
+    for (size_t n : numClasses)
+        accs.emplace_back(n, nbsamples);
+    accumulate(accs, traces, classes);
+
+    NPArray<double> results(0, nbsamples);
+    for (const auto &acc : accs)
+        results = concatenate(
+            results, CLASS_METRIC == ClassMetric::SNR ? acc.snr() : acc.sost(),
+            NPArray<double>::COLUMN);
+    return results;
+}
+
+// Compute the metrics on the PowerTy traces, from a single file or sharded
+// over the traces_files.
+template <typename PowerTy>
+NPArray<double> analyze(SCAApp &app, const vector<string> &traces_files,
+                        bool convert, Expr::Context<uint32_t> &context,
+                        const vector<string> &expr_strings) {
+    return withTraces<PowerTy>(app, traces_files, convert, [&](auto &traces) {
+        return computeMetrics(app, traces, context, expr_strings);
+    });
+}
+
+int main(int argc, char *argv[]) {
+
+    string traces_file;
+    string inputs_file;
+    string masks_file;
+    string keys_file;
+    bool convert = false;
+    vector<string> expr_strings;
+
+    SCAApp app(argv[0], argc, argv);
+    app.optval({"-t", "--traces"}, "TRACESFILE",
+               "use TRACESFILE as traces, in npy format. The traces can be "
+               "sharded over several files, with TRACESFILE being a glob "
+               "pattern or @MANIFEST, where MANIFEST lists the shards, one "
+               "per line",
+               [&](const string &s) { traces_file = s; });
+    app.optval({"-i", "--inputs"}, "INPUTSFILE",
+               "use INPUTSFILE as input data, in npy format.",
+               [&](const string &s) { inputs_file = s; });
+    app.optval({"-m", "--masks"}, "MASKSFILE",
+               "use MASKSFILE as mask data, in npy format",
+               [&](const string &s) { masks_file = s; });
+    app.optval({"-k", "--keys"}, "KEYSFILE",
+               "use KEYSFILE as key data, in npy format",
+               [&](const string &s) { keys_file = s; });
+    app.optnoval(
+        {"--convert"},
+        "convert the power information to floating point (default: no, the "
+        "traces are analyzed in their storage type, which can be f8, f4, i2 "
+        "or u2)",
+        [&]() { convert = true; });
+    app.positional_multiple(
+        "EXPRESSION",
+        "use EXPRESSION to compute the class of each trace, e.g. "
+        "'trunc8($in[0] ^ $key[0])' for 256 classes. A specific value can be "
+        "referred to with $in[idx] (from INPUTSFILE), $key[idx] (from "
+        "KEYSFILE) or $mask[idx] (from MASKSFILE) in the expression.",
+        [&](const string &s) { expr_strings.push_back(s); });
+    app.setup();
+    const PAF::ScopedTimer T(CLASS_METRIC == ClassMetric::SNR ? "paf-snr"
+                                                              : "paf-sost");
+
+    // Sanity check: we have at least one of inputs_file, masks_file or
+    // keys_file.
+    if (inputs_file.empty() && keys_file.empty() && masks_file.empty()) {
+        app.help(cout);
+        reporter->errx(
+            EXIT_FAILURE,
+            "Need at least one of INPUTSFILE, KEYSFILE or MASKSFILE");
+    }
+
+    // Sanity check : we must be able to compute the classes.
+    if (expr_strings.empty()) {
+        app.help(cout);
+        reporter->errx(
+            EXIT_FAILURE,
+            "No expression provided, at least one of them is needed");
+    }
+
+    if (app.isPerfect())
+        reporter->errx(EXIT_FAILURE, "--perfect is not supported");
+
+    if (app.verbose()) {
+        cout << "Reading traces from: '" << traces_file << "'\n";
+        if (!inputs_file.empty())
+            cout << "Reading inputs from: '" << inputs_file << "'\n";
+        if (!masks_file.empty())
+            cout << "Reading masks from: '" << masks_file << "'\n";
+        if (!keys_file.empty())
+            cout << "Reading keys from: '" << keys_file << "'\n";
+        cout << "Converting power trace to float: " << (convert ? "yes" : "no")
+             << '\n';
+        cout << "Computing classes from expression(s):";
+        for (const auto &e : expr_strings)
+            cout << " \"" << e << "\"";
+        cout << '\n';
+    }
+
+    // Get the traces files, which may be sharded.
+    const vector<string> traces_files = expandShards(traces_file);
+    if (traces_files.empty())
+        reporter->errx(EXIT_FAILURE, "No traces file found for '%s'",
+                       traces_file.c_str());
+
+    // Read our inputs, keys and masks data.
+    unique_ptr<const NPArray<NPDataTy>> inputs =
+        readNumpyDataFile("input", inputs_file, app.verbosity());
+    unique_ptr<const NPArray<NPDataTy>> keys =
+        readNumpyDataFile("keys", keys_file, app.verbosity());
+    unique_ptr<const NPArray<NPDataTy>> masks =
+        readNumpyDataFile("masks", masks_file, app.verbosity());
+
+    Expr::Context<uint32_t> context;
+    if (inputs)
+        context.addVariable("in", inputs->cbegin());
+    if (keys)
+        context.addVariable("key", keys->cbegin());
+    if (masks)
+        context.addVariable("mask", masks->cbegin());
+
+    // Compute the metrics. Unless a conversion is requested, the traces are
+    // analyzed in their storage type.
+    NPArray<double> results;
+    const string elt_ty = convert ? "f8" : getEltTy(traces_files[0], *reporter);
+    if (elt_ty == "f8")
+        results = analyze<double>(app, traces_files, convert, context,
+                                  expr_strings);
+    else if (elt_ty == "f4")
+        results =
+            analyze<float>(app, traces_files, convert, context, expr_strings);
+    else if (elt_ty == "i2")
+        results = analyze<int16_t>(app, traces_files, convert, context,
+                                   expr_strings);
+    else if (elt_ty == "u2")
+        results = analyze<uint16_t>(app, traces_files, convert, context,
+                                    expr_strings);
+    else
+        reporter->errx(EXIT_FAILURE,
+                       "Unsupported element type '%s' for traces in '%s', use "
+                       "--convert",
+                       elt_ty.c_str(), traces_files[0].c_str());
+
+    // Output results.
+    app.output(results);
+
+    return EXIT_SUCCESS;
+}
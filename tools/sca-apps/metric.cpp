@@ -20,15 +20,21 @@
 
 #include "PAF/SCA/Expr.h"
 #include "PAF/SCA/ExprParser.h"
+#include "PAF/SCA/LiveTraces.h"
 #include "PAF/SCA/NPArray.h"
 #include "PAF/SCA/SCA.h"
+#include "PAF/SCA/ShardedNPArray.h"
+#include "PAF/SCA/StatsCache.h"
 #include "PAF/SCA/sca-apps.h"
+#include "PAF/utils/Stats.h"
 
 #include "libtarmac/reporter.hh"
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -42,11 +48,6 @@ using namespace PAF::SCA;
 using NPDataTy = uint32_t;
 static_assert(is_integral<NPDataTy>(), "NPDataTy must be an integral type");
 
-// The expected type for the power trace data.
-using NPPowerTy = double;
-static_assert(is_floating_point<NPPowerTy>(),
-              "NPPowerTy must be a floating point type");
-
 enum class Metric : uint8_t { PEARSON_CORRELATION, T_TEST };
 
 #ifndef METRIC
@@ -83,6 +84,588 @@ unique_ptr<NPArray<Ty>> readNumpyDataFile(const string &name,
     return np;
 }
 
+// The perfect t-test needs all the traces at once.
+template <typename PowerTy>
+NPArray<double> perfectTTest(size_t nbsamples, const NPArray<PowerTy> &traces,
+                             const vector<Classification> &classifier,
+                             ostream *os) {
+    return perfect_t_test(0, nbsamples, traces, classifier, os);
+}
+
+template <typename PowerTy>
+NPArray<double> perfectTTest(size_t nbsamples, ShardedNPArray<PowerTy> &traces,
+                             const vector<Classification> &classifier,
+                             ostream *os) {
+    return perfect_t_test(0, nbsamples, traces.concatenate(), classifier, os);
+}
+
+// The progressive mode settings: a snapshot of the metrics is emitted every
+// 'every' traces, and the computation stops as soon as the maximum absolute
+// metric value is above 'threshold' (when not 0), or when the location of the
+// maximum has not changed for 'stable' snapshots (when not 0).
+struct Progressive {
+    size_t every = 0;
+    double threshold = 0.0;
+    unsigned stable = 0;
+
+    [[nodiscard]] bool enabled() const { return every != 0; }
+};
+
+// Call f on the batches of traces, as f(batch, first_trace), the batches
+// boundaries being at multiples of batch_size traces. Stop as soon as f
+// returns false.
+template <typename PowerTy, class Fn>
+void forEachBatch(const NPArray<PowerTy> &traces, size_t batch_size, Fn f) {
+    for (size_t t = 0; t < traces.rows(); t += batch_size) {
+        const size_t te = min(t + batch_size, traces.rows());
+        if (!f(NPArrayView<PowerTy>(traces, t, te, 0, traces.cols()), t))
+            return;
+    }
+}
+
+template <typename PowerTy, class Fn>
+void forEachBatch(ShardedNPArray<PowerTy> &traces, size_t batch_size, Fn f) {
+    traces.rewind();
+    while (traces.next()) {
+        const NPArray<PowerTy> &chunk = traces.chunk();
+        const size_t first = traces.chunkBegin();
+        for (size_t t = 0; t < chunk.rows();) {
+            const size_t next = ((first + t) / batch_size + 1) * batch_size;
+            const size_t te = min(next - first, chunk.rows());
+            if (!f(NPArrayView<PowerTy>(chunk, t, te, 0, chunk.cols()),
+                   first + t))
+                return;
+            t = te;
+        }
+    }
+    if (!traces.good())
+        reporter->errx(EXIT_FAILURE, "Error reading traces (%s)",
+                       traces.error());
+}
+
+// The accumulators of the progressive and live modes, which are fed one
+// batch of traces at a time, and from which snapshots of the metrics are
+// taken.
+template <typename PowerTy> class MetricsAccumulator {
+  public:
+    MetricsAccumulator(size_t nbsamples, size_t num_ttests,
+                       size_t num_correls)
+        : nbsamples(nbsamples),
+          ttests(num_ttests, TTestAccumulator<PowerTy>(nbsamples)),
+          correls(nbsamples, num_correls) {}
+
+    // Add batch, whose first trace is at index first_trace in the
+    // classifiers and in the intermediate values ivalues. The correlations
+    // with all the intermediate values are accumulated in a single pass over
+    // batch.
+    void add(const NPArrayView<PowerTy> &batch,
+             const vector<vector<Classification>> &classifiers,
+             const NPArray<double> &ivalues, size_t first_trace) {
+        for (size_t i = 0; i < ttests.size(); i++)
+            ttests[i].add(batch, classifiers[i], first_trace);
+        if (correls.hypotheses() != 0)
+            correls.add(batch, ivalues, first_trace);
+        count += batch.rows();
+    }
+
+    // Get the number of traces accumulated.
+    [[nodiscard]] size_t traces() const { return count; }
+
+    // Have enough traces been accumulated for the metrics to be defined ?
+    [[nodiscard]] bool ready() const {
+        for (const auto &tt : ttests)
+            if (tt.count(Classification::GROUP_0) <= 1 ||
+                tt.count(Classification::GROUP_1) <= 1)
+                return false;
+        return count > 1;
+    }
+
+    // Take a snapshot of the metrics. Returns false if the computation
+    // should stop, according to progressive.
+    bool snapshot(SCAApp &app, const Progressive &progressive) {
+        last = NPArray<double>(0, nbsamples);
+        for (const auto &tt : ttests)
+            last = concatenate(last, tt.t_test(), NPArray<double>::COLUMN);
+        if (correls.hypotheses() != 0)
+            last = concatenate(last, correls.correl(), NPArray<double>::COLUMN);
+
+        // Locate the maximum absolute value in this snapshot.
+        size_t location = 0;
+        double maxValue = 0.0;
+        for (size_t r = 0; r < last.rows(); r++)
+            for (size_t c = 0; c < last.cols(); c++)
+                if (std::abs(last(r, c)) > maxValue) {
+                    maxValue = std::abs(last(r, c));
+                    location = r * nbsamples + c;
+                }
+        stableCnt = location == maxLocation ? stableCnt + 1 : 0;
+        maxLocation = location;
+
+        if (app.verbose())
+            cout << "Snapshot after " << count << " traces: max = " << maxValue
+                 << " at index " << maxLocation / nbsamples << ','
+                 << maxLocation % nbsamples << '\n';
+
+        if (progressive.threshold != 0.0 && maxValue > progressive.threshold) {
+            cout << "Threshold " << progressive.threshold << " crossed after "
+                 << count << " traces\n";
+            return false;
+        }
+        if (progressive.stable != 0 && stableCnt >= progressive.stable) {
+            cout << "Maximum stable for " << stableCnt << " snapshots after "
+                 << count << " traces\n";
+            return false;
+        }
+        return true;
+    }
+
+    // Get the last snapshot.
+    [[nodiscard]] const NPArray<double> &lastSnapshot() const { return last; }
+
+  private:
+    const size_t nbsamples;
+    vector<TTestAccumulator<PowerTy>> ttests;
+    CorrelAccumulator<PowerTy> correls;
+    size_t count = 0;
+    NPArray<double> last;
+    size_t maxLocation = -1;
+    unsigned stableCnt = 0;
+};
+
+// Compute the metrics progressively on traces, with the accumulators being
+// fed one batch of traces at a time, and a snapshot of the metrics emitted
+// after each batch. The metrics are computed with classifiers for the
+// t-test, or with the intermediate values ivalues for the correlation. The
+// last snapshot is returned.
+template <class TracesTy>
+NPArray<double>
+progressiveMetrics(SCAApp &app, TracesTy &traces,
+                   const Progressive &progressive,
+                   const vector<vector<Classification>> &classifiers,
+                   const NPArray<double> &ivalues) {
+    using PowerTy = typename remove_const_t<TracesTy>::DataTy;
+    const size_t nbsamples = traces.cols();
+    const size_t nbtraces = traces.rows();
+
+    MetricsAccumulator<PowerTy> acc(nbsamples, classifiers.size(),
+                                    ivalues.rows());
+    auto feed = [&](const NPArrayView<PowerTy> &batch, size_t first_trace) {
+        acc.add(batch, classifiers, ivalues, first_trace);
+
+        // Only take a snapshot at the end of a period, and once enough
+        // traces have been accumulated for the metrics to be defined.
+        const size_t count = acc.traces();
+        if (count % progressive.every != 0 && count != nbtraces)
+            return true;
+        if (!acc.ready())
+            return true;
+        if (!acc.snapshot(app, progressive))
+            return false;
+
+        // The last snapshot is emitted by the caller.
+        if (count != nbtraces)
+            app.output(acc.lastSnapshot());
+        return true;
+    };
+    forEachBatch(traces, progressive.every, feed);
+
+    return acc.lastSnapshot();
+}
+
+// Parse the expressions in expr_strings, with the variables in context, and
+// compile them to program, so that their common subterms are only evaluated
+// once.
+void compileExpressions(Expr::Context<uint32_t> &context,
+                        const vector<string> &expr_strings,
+                        vector<unique_ptr<Expr::Expr>> &exprs,
+                        Expr::Program &program) {
+    context.reset();
+    for (const string &str : expr_strings) {
+        Expr::Parser<NPDataTy> parser(context, str);
+        exprs.emplace_back(parser.parse());
+        if (!exprs.back())
+            reporter->errx(EXIT_FAILURE, "Error parsing expression '%s'",
+                           str.c_str());
+        program.add(*exprs.back());
+    }
+}
+
+// Get the number of t-test classifiers for exprs: one per expression, or one
+// per bit of each expression with bits.
+size_t numClassifiers(const vector<unique_ptr<Expr::Expr>> &exprs,
+                      bool bits) {
+    if (!bits)
+        return exprs.size();
+    size_t n = 0;
+    for (const auto &expr : exprs)
+        n += Expr::ValueType::getNumBits(expr->getType());
+    return n;
+}
+
+// Evaluate program, compiled from exprs, on the n traces starting at row
+// first, and derive from the values the intermediate values (for the
+// correlation) or the classifications (for the t-test) of those traces,
+// stored from column dst of ivalues or classifiers. With bits, each bit of
+// each expression's value classifies the traces on its own.
+void evaluateExpressions(const Expr::Program &program,
+                         const vector<unique_ptr<Expr::Expr>> &exprs,
+                         size_t first, size_t n, size_t dst, bool bits,
+                         NPArray<double> &ivalues,
+                         vector<vector<Classification>> &classifiers) {
+    // Evaluate the expressions a chunk of traces at a time.
+    const size_t chunkSize = 65536;
+    const Expr::Value::ConcreteType hwMask = uint32_t(-1);
+    vector<Expr::Value::ConcreteType> values(exprs.size() *
+                                             min(chunkSize, n));
+    vector<uint32_t> hws(min(chunkSize, n));
+    for (size_t tb = 0; tb < n; tb += chunkSize) {
+        const size_t cn = min(chunkSize, n - tb);
+        program.eval(values.data(), first + tb, cn);
+        size_t k = 0; // The next classifier in bits mode.
+        for (size_t i = 0; i < exprs.size(); i++) {
+            const Expr::Value::ConcreteType *v = &values[i * cn];
+            switch (METRIC) {
+            case Metric::PEARSON_CORRELATION:
+                hamming_weight(&ivalues(i, dst + tb), v, cn, hwMask);
+                break;
+            case Metric::T_TEST: {
+                const uint32_t hw_max =
+                    Expr::ValueType::getNumBits(exprs[i]->getType());
+                if (bits) {
+                    for (uint32_t b = 0; b < hw_max; b++, k++)
+                        for (size_t t = 0; t < cn; t++)
+                            classifiers[k][dst + tb + t] =
+                                (v[t] >> b) & 1 ? Classification::GROUP_1
+                                                : Classification::GROUP_0;
+                    break;
+                }
+                hamming_weight(hws.data(), v, cn, hwMask);
+                for (size_t t = 0; t < cn; t++) {
+                    Classification &c = classifiers[i][dst + tb + t];
+                    if (hws[t] < hw_max / 2)
+                        c = Classification::GROUP_0;
+                    else if (hws[t] > hw_max / 2)
+                        c = Classification::GROUP_1;
+                    else
+                        c = Classification::IGNORE;
+                }
+            } break;
+            }
+        }
+    }
+}
+
+// Compute, for the nbtraces traces, the intermediate values ivalues (for
+// the correlation) or the classifiers (for the t-test) of each of the
+// expressions in expr_strings, or of their bits with bits.
+void classify(Expr::Context<uint32_t> &context,
+              const vector<string> &expr_strings, size_t nbtraces, bool bits,
+              NPArray<double> &ivalues,
+              vector<vector<Classification>> &classifiers) {
+    // The intermediate values for each of the expressions, so that their
+    // correlations are all computed in a single pass over the traces.
+    ivalues = NPArray<double>(
+        METRIC == Metric::PEARSON_CORRELATION ? expr_strings.size() : 0,
+        nbtraces);
+
+    // Compile all expressions to a single program.
+    vector<unique_ptr<Expr::Expr>> exprs;
+    Expr::Program program;
+    compileExpressions(context, expr_strings, exprs, program);
+
+    // The classifiers for each of the expressions (or of their bits).
+    classifiers = vector<vector<Classification>>(
+        METRIC == Metric::T_TEST ? numClassifiers(exprs, bits) : 0,
+        vector<Classification>(nbtraces));
+
+    // Derive the intermediate values or the classifiers from the
+    // expressions' values.
+    evaluateExpressions(program, exprs, 0, nbtraces, 0, bits, ivalues,
+                        classifiers);
+}
+
+// Compute the metric for each of the expressions in expr_strings on traces,
+// order being the t-test order. With bivariate, the second order metric of
+// all pairs of samples is computed, as a square matrix per expression. With
+// bits, a t-test is computed for each bit of each expression.
+template <class TracesTy>
+NPArray<double> computeMetrics(SCAApp &app, TracesTy &traces,
+                               unsigned order, bool bivariate, bool bits,
+                               const Progressive &progressive,
+                               Expr::Context<uint32_t> &context,
+                               const vector<string> &expr_strings) {
+    // Only the samples of interest have been loaded from the traces file.
+    const size_t nbsamples = traces.cols();
+    const size_t nbtraces = traces.rows();
+
+    if (app.verbose())
+        cout << "Will process " << nbsamples
+             << " samples per traces, starting at sample " << app.sampleStart()
+             << "\n";
+
+    // Our empty (for now) metric results.
+    NPArray<double> results(0, nbsamples);
+
+    NPArray<double> ivalues;
+    vector<vector<Classification>> classifiers;
+    classify(context, expr_strings, nbtraces, bits, ivalues, classifiers);
+
+    if (progressive.enabled())
+        return progressiveMetrics(app, traces, progressive, classifiers,
+                                  ivalues);
+
+    if (bivariate) {
+        for (size_t i = 0; i < ivalues.rows(); i++)
+            results = concatenate(
+                results,
+                bivariate_correl(0, nbsamples, traces,
+                                 NPArray<double>(&ivalues(i, 0), 1, nbtraces)),
+                NPArray<double>::COLUMN);
+        for (const auto &classifier : classifiers)
+            results = concatenate(
+                results, bivariate_t_test(0, nbsamples, traces, classifier),
+                NPArray<double>::COLUMN);
+        return results;
+    }
+
+    // Compute the metrics. The first order t-tests of all classifiers are
+    // computed in a single pass over the traces.
+    if (METRIC == Metric::PEARSON_CORRELATION && ivalues.rows() != 0)
+        results = correl(0, nbsamples, traces, ivalues);
+    if (order == 1 && !app.isPerfect() && !classifiers.empty()) {
+        Classifiers cls(classifiers.size(), nbtraces);
+        for (size_t i = 0; i < classifiers.size(); i++)
+            cls.set(i, classifiers[i]);
+        return t_test(0, nbsamples, traces, cls);
+    }
+    for (const auto &classifier : classifiers)
+        results = concatenate(
+            results,
+            app.isPerfect()
+                ? perfectTTest(nbsamples, traces, classifier,
+                               app.verbose() ? &cout : nullptr)
+                : t_test(0, nbsamples, order, traces, classifier),
+            NPArray<double>::COLUMN);
+
+    return results;
+}
+
+// Compute the metrics on the traces streamed live, feeding the accumulators
+// one batch of progressive.every traces at a time, and emitting a snapshot of
+// the metrics after each batch. The inputs of the traces are streamed with
+// them as their data words, whereas the keys and masks are read from files,
+// with one row per trace.
+template <typename PowerTy>
+void liveMetrics(SCAApp &app, LiveTraceReader &live, bool convert,
+                 const Progressive &progressive, const NPArray<NPDataTy> *keys,
+                 const NPArray<NPDataTy> *masks,
+                 const vector<string> &expr_strings) {
+    const size_t sb = min(app.sampleStart(), live.getNumSamples());
+    const size_t se = min(app.sampleEnd(), live.getNumSamples());
+    const size_t numTTests =
+        METRIC == Metric::T_TEST ? expr_strings.size() : 0;
+    const size_t numCorrels =
+        METRIC == Metric::PEARSON_CORRELATION ? expr_strings.size() : 0;
+    MetricsAccumulator<PowerTy> acc(se - sb, numTTests, numCorrels);
+
+    NPArray<PowerTy> batch(0, live.getNumSamples());
+    NPArray<NPDataTy> inputs(0, live.getNumData());
+    while (const size_t n = live.read(batch, inputs, progressive.every)) {
+        const size_t first = acc.traces();
+        if ((keys && first + n > keys->rows()) ||
+            (masks && first + n > masks->rows()))
+            reporter->errx(EXIT_FAILURE,
+                           "Not enough keys or masks for %zu traces",
+                           first + n);
+        if constexpr (is_floating_point<PowerTy>())
+            if (convert)
+                scalePowerValues(batch, live.getEltTy(), *reporter);
+
+        // The expressions are compiled for each batch, as the inputs are
+        // only available for the traces of the batch.
+        Expr::Context<uint32_t> context;
+        if (inputs.cols() != 0)
+            context.addVariable("in", inputs.cbegin());
+        if (keys)
+            context.addVariable("key", keys->cbegin(first));
+        if (masks)
+            context.addVariable("mask", masks->cbegin(first));
+        vector<unique_ptr<Expr::Expr>> exprs;
+        Expr::Program program;
+        compileExpressions(context, expr_strings, exprs, program);
+
+        NPArray<double> ivalues(numCorrels, n);
+        vector<vector<Classification>> classifiers(numTTests,
+                                                   vector<Classification>(n));
+        evaluateExpressions(program, exprs, 0, n, 0, /* bits: */ false,
+                            ivalues, classifiers);
+        acc.add(NPArrayView<PowerTy>(batch, 0, n, sb, se), classifiers,
+                ivalues, 0);
+        if (!acc.ready())
+            continue;
+        const bool more = acc.snapshot(app, progressive);
+        app.output(acc.lastSnapshot());
+        app.flushOutput();
+        if (!more)
+            return;
+    }
+
+    if (!live.good())
+        reporter->errx(EXIT_FAILURE, "Error receiving live traces (%s)",
+                       live.error());
+    if (app.verbose())
+        cout << "Live traces ended after " << acc.traces() << " traces\n";
+}
+
+// Analyze the traces streamed live, in their element type unless a
+// conversion is requested.
+void analyzeLive(SCAApp &app, bool convert, const Progressive &progressive,
+                 const NPArray<NPDataTy> *keys, const NPArray<NPDataTy> *masks,
+                 const vector<string> &expr_strings) {
+    const unique_ptr<LiveTraceReader> live = app.openLiveTraces();
+    const string &elt_ty = live->getEltTy();
+    if (convert)
+        liveMetrics<double>(app, *live, convert, progressive, keys, masks,
+                            expr_strings);
+    else if (elt_ty == "f8")
+        liveMetrics<double>(app, *live, convert, progressive, keys, masks,
+                            expr_strings);
+    else if (elt_ty == "f4")
+        liveMetrics<float>(app, *live, convert, progressive, keys, masks,
+                           expr_strings);
+    else if (elt_ty == "i2")
+        liveMetrics<int16_t>(app, *live, convert, progressive, keys, masks,
+                             expr_strings);
+    else if (elt_ty == "u2")
+        liveMetrics<uint16_t>(app, *live, convert, progressive, keys, masks,
+                              expr_strings);
+    else
+        reporter->errx(EXIT_FAILURE,
+                       "Unsupported element type '%s' for live traces, use "
+                       "--convert",
+                       elt_ty.c_str());
+}
+
+// Compute the first order metric for each of the expressions in
+// expr_strings on the PowerTy traces, from their per-sample statistics. The
+// statistics for an expression (or a bit of it with bits) are restored from
+// the statistics cache when they have already been accumulated on the same
+// traces, with the same classification (t-test) or intermediate values
+// (correlation), over samples covering the samples of interest. The traces
+// are only read if some statistics are missing: those are then accumulated
+// in a single pass over the traces, and saved to the cache.
+template <typename PowerTy>
+NPArray<double> cachedMetrics(SCAApp &app, const vector<string> &traces_files,
+                              bool convert, bool bits,
+                              Expr::Context<uint32_t> &context,
+                              const vector<string> &expr_strings) {
+    StatsCache &cache = *app.statsCache();
+
+    // Get the traces dimensions, without reading them.
+    const ShardedNPArray<PowerTy> dims(traces_files, app.tracesWindow(),
+                                       app.loadMode(), /* prefetch: */ false);
+    if (!dims.good())
+        reporter->errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
+                       traces_files[0].c_str(), dims.error());
+    const size_t nbtraces = dims.rows();
+    const size_t nbsamples = dims.cols();
+    const size_t sb = app.sampleStart();
+    const size_t se = sb + nbsamples;
+
+    NPArray<double> ivalues;
+    vector<vector<Classification>> classifiers;
+    classify(context, expr_strings, nbtraces, bits, ivalues, classifiers);
+    const bool ttest = METRIC == Metric::T_TEST;
+    const size_t n = ttest ? classifiers.size() : ivalues.rows();
+
+    // The statistics depend on the traces, how they are analyzed, and on the
+    // classification or intermediate values of each trace.
+    StatsCache::Key base;
+    base.add(string(ttest ? "t-test" : "correl"));
+    for (const string &filename : traces_files)
+        base.addFile(filename);
+    base.add(string(NPArrayBase::getEltTyDescr<PowerTy>()))
+        .add(uint64_t(convert))
+        .add(uint64_t(nbtraces));
+
+    vector<uint64_t> keys;
+    vector<TTestAccumulator<PowerTy>> ttests(
+        ttest ? n : 0, TTestAccumulator<PowerTy>(nbsamples));
+    vector<CorrelAccumulator<PowerTy>> correls(
+        ttest ? 0 : n, CorrelAccumulator<PowerTy>(nbsamples));
+    vector<NPArray<double>> ivals;
+    vector<size_t> missing;
+    for (size_t i = 0; i < n; i++) {
+        StatsCache::Key K = base;
+        bool cached;
+        if (ttest) {
+            K.add(classifiers[i].data(),
+                  nbtraces * sizeof(Classification));
+            cached = cache.lookup(K.get(), sb, se, ttests[i]);
+        } else {
+            ivals.emplace_back(ivalues.view(i, i + 1, 0, nbtraces));
+            if (nbtraces != 0)
+                K.add(&ivals[i](0, 0), nbtraces * sizeof(double));
+            cached = cache.lookup(K.get(), sb, se, correls[i]);
+        }
+        keys.push_back(K.get());
+        if (!cached)
+            missing.push_back(i);
+    }
+
+    if (app.verbose())
+        cout << "Statistics restored from cache for " << n - missing.size()
+             << " of " << n << " expressions\n";
+
+    if (!missing.empty()) {
+        withTraces<PowerTy>(app, traces_files, convert, [&](auto &traces) {
+            forEachBatch(traces, max<size_t>(nbtraces, 1),
+                         [&](const NPArrayView<PowerTy> &batch, size_t first) {
+                             for (const size_t i : missing)
+                                 if (ttest)
+                                     ttests[i].add(batch, classifiers[i],
+                                                   first);
+                                 else
+                                     correls[i].add(batch, ivals[i], first);
+                             return true;
+                         });
+            return NPArray<double>();
+        });
+        for (const size_t i : missing)
+            if (!(ttest ? cache.insert(keys[i], sb, se, ttests[i])
+                        : cache.insert(keys[i], sb, se, correls[i])))
+                reporter->warn("Can not save statistics to cache '%s' (%s)",
+                               cache.getDirectory().c_str(), cache.error());
+    }
+
+    NPArray<double> results(0, nbsamples);
+    for (size_t i = 0; i < n && nbsamples != 0; i++)
+        results = concatenate(results,
+                              ttest ? ttests[i].t_test() : correls[i].correl(),
+                              NPArray<double>::COLUMN);
+    return results;
+}
+
+// Compute the metrics on the PowerTy traces, from a single file or sharded
+// over the traces_files. Only first order metrics are computed from cached
+// statistics.
+template <typename PowerTy>
+NPArray<double> analyze(SCAApp &app, const vector<string> &traces_files,
+                        bool convert, unsigned order, bool bivariate,
+                        bool bits, const Progressive &progressive,
+                        Expr::Context<uint32_t> &context,
+                        const vector<string> &expr_strings) {
+    if (app.statsCache())
+        return cachedMetrics<PowerTy>(app, traces_files, convert, bits,
+                                      context, expr_strings);
+
+    return withTraces<PowerTy>(
+        app, traces_files, convert, [&](auto &traces) {
+            return computeMetrics(app, traces, order, bivariate, bits,
+                                  progressive, context, expr_strings);
+        });
+}
+
 int main(int argc, char *argv[]) {
 
     string traces_file;
@@ -90,11 +673,18 @@ int main(int argc, char *argv[]) {
     string masks_file;
     string keys_file;
     bool convert = false;
+    unsigned order = 1;
+    bool bivariate = false;
+    bool bits = false;
+    Progressive progressive;
     vector<string> expr_strings;
 
     SCAApp app(argv[0], argc, argv);
     app.optval({"-t", "--traces"}, "TRACESFILE",
-               "use TRACESFILE as traces, in npy format",
+               "use TRACESFILE as traces, in npy format. The traces can be "
+               "sharded over several files, with TRACESFILE being a glob "
+               "pattern or @MANIFEST, where MANIFEST lists the shards, one "
+               "per line",
                [&](const string &s) { traces_file = s; });
     app.optval({"-i", "--inputs"}, "INPUTSFILE",
                "use INPUTSFILE as input data, in npy format.",
@@ -107,8 +697,42 @@ int main(int argc, char *argv[]) {
                [&](const string &s) { keys_file = s; });
     app.optnoval(
         {"--convert"},
-        "convert the power information to floating point (default: no)",
+        "convert the power information to floating point (default: no, the "
+        "traces are analyzed in their storage type, which can be f8, f4, i2 "
+        "or u2)",
         [&]() { convert = true; });
+    if (METRIC == Metric::T_TEST)
+        app.optval({"--order"}, "ORDER",
+                   "compute the univariate t-test of order ORDER, e.g. 2 for "
+                   "masked implementations (default: 1)",
+                   [&](const string &s) { order = stoul(s, nullptr, 0); });
+    if (METRIC == Metric::T_TEST)
+        app.optnoval({"--bits"},
+                     "compute a t-test for each bit of each expression, the "
+                     "traces being classified by the value of that bit, "
+                     "instead of a t-test per expression",
+                     [&]() { bits = true; });
+    app.optnoval({"--bivariate"},
+                 "compute the bivariate second order metric of all pairs of "
+                 "samples, for first order masked implementations. The result "
+                 "is a square matrix per expression",
+                 [&]() { bivariate = true; });
+    app.optval({"--progressive"}, "N",
+               "compute the metrics progressively, emitting a snapshot of "
+               "them every N traces (default: 1000 with --live)",
+               [&](const string &s) {
+                   progressive.every = stoul(s, nullptr, 0);
+               });
+    app.optval({"--stop-above"}, "THRESHOLD",
+               "in progressive mode, stop as soon as the absolute value of a "
+               "metric is above THRESHOLD, e.g. 4.5 for a t-test",
+               [&](const string &s) { progressive.threshold = stod(s); });
+    app.optval({"--stop-stable"}, "K",
+               "in progressive mode, stop as soon as the location of the "
+               "maximum has not changed for K snapshots",
+               [&](const string &s) {
+                   progressive.stable = stoul(s, nullptr, 0);
+               });
     app.positional_multiple(
         "EXPRESSION",
         "use EXPRESSION to compute the intermediate value. A specific value "
@@ -116,11 +740,27 @@ int main(int argc, char *argv[]) {
         "KEYSFILE) or $mask[idx] (from MASKSFILE) in the intermediate "
         "expression computation.",
         [&](const string &s) { expr_strings.push_back(s); });
+    app.addLiveOption();
+    app.addStatsCacheOption();
     app.setup();
+    const PAF::ScopedTimer T("paf-metric");
+
+    // In live mode, the traces and their inputs are streamed, and the metrics
+    // are computed progressively.
+    if (app.isLive()) {
+        if (!traces_file.empty() || !inputs_file.empty())
+            reporter->errx(EXIT_FAILURE,
+                           "--live can not be used with TRACESFILE or "
+                           "INPUTSFILE, the traces and their inputs are "
+                           "streamed");
+        if (!progressive.enabled())
+            progressive.every = 1000;
+    }
 
     // Sanity check: we have at least one of inputs_file, masks_file or
     // keys_file.
-    if (inputs_file.empty() && keys_file.empty() && masks_file.empty()) {
+    if (!app.isLive() && inputs_file.empty() && keys_file.empty() &&
+        masks_file.empty()) {
         app.help(cout);
         reporter->errx(
             EXIT_FAILURE,
@@ -135,8 +775,46 @@ int main(int argc, char *argv[]) {
             "No expression provided, at least one of them is needed");
     }
 
+    if (order == 0)
+        reporter->errx(EXIT_FAILURE, "The t-test order must be at least 1");
+    if (order > 1 && app.isPerfect())
+        reporter->errx(EXIT_FAILURE,
+                       "--perfect can not be used with higher order t-tests");
+    if (bivariate && (order > 1 || app.isPerfect() || progressive.enabled() ||
+                      app.isLive()))
+        reporter->errx(EXIT_FAILURE,
+                       "--bivariate can not be used with --order, --perfect, "
+                       "--progressive or --live");
+    if (bits && app.isLive())
+        reporter->errx(EXIT_FAILURE, "--bits can not be used with --live");
+    if (app.statsCache() && (order > 1 || app.isPerfect() || bivariate ||
+                             progressive.enabled() || app.isLive()))
+        reporter->errx(EXIT_FAILURE,
+                       "--stats-cache can not be used with --order, "
+                       "--perfect, --bivariate, --progressive or --live");
+    if (progressive.enabled()) {
+        if (app.isPerfect())
+            reporter->errx(EXIT_FAILURE,
+                           "--perfect can not be used with --progressive or "
+                           "--live");
+        if (order > 1)
+            reporter->errx(EXIT_FAILURE,
+                           "--progressive or --live can not be used with "
+                           "higher order t-tests");
+        if (app.outputType() == OutputBase::OUTPUT_NUMPY)
+            reporter->errx(EXIT_FAILURE,
+                           "--progressive or --live can not be used with "
+                           "--numpy");
+    } else if (progressive.threshold != 0.0 || progressive.stable != 0)
+        reporter->errx(EXIT_FAILURE,
+                       "--stop-above and --stop-stable need --progressive");
+
     if (app.verbose()) {
-        cout << "Reading traces from: '" << traces_file << "'\n";
+        if (app.isLive())
+            cout << "Receiving live traces from: '" << app.liveSource()
+                 << "'\n";
+        else
+            cout << "Reading traces from: '" << traces_file << "'\n";
         if (!inputs_file.empty())
             cout << "Reading inputs from: '" << inputs_file << "'\n";
         if (!masks_file.empty())
@@ -152,6 +830,11 @@ int main(int argc, char *argv[]) {
             cout << " \"" << e << "\"";
         cout << '\n';
 
+        if (order > 1)
+            cout << "T-Test order: " << order << '\n';
+        if (progressive.enabled())
+            cout << "Progressive snapshots every " << progressive.every
+                 << " traces\n";
         if (app.decimationPeriod() != 1 || app.decimationOffset() != 0)
             cout << "Decimation: " << app.decimationPeriod() << '%'
                  << app.decimationOffset() << '\n';
@@ -165,31 +848,32 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    // Read our traces.
-    const NPArray<NPPowerTy> traces =
-        readNumpyPowerFile<NPPowerTy>(traces_file, convert, *reporter);
+    // Read our keys and masks data.
+    unique_ptr<const NPArray<NPDataTy>> keys =
+        readNumpyDataFile<NPDataTy>("keys", keys_file, app.verbosity());
+    unique_ptr<const NPArray<NPDataTy>> masks =
+        readNumpyDataFile<NPDataTy>("masks", masks_file, app.verbosity());
 
-    if (!traces.good())
-        reporter->errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
-                       traces_file.c_str(), traces.error());
-    if (app.verbose()) {
-        cout << "Read " << traces.rows() << " traces (" << traces.cols()
-             << " samples per trace)\n";
-        if (app.verbosity() >= 2)
-            traces.dump(cout, 3, 4, "Traces");
-        const size_t nbsamples = min(app.numSamples(), traces.cols());
-        cout << "Will process " << nbsamples
-             << " samples per traces, starting at sample " << app.sampleStart()
-             << "\n";
+    // The live mode emits the metrics snapshots while the traces are
+    // received.
+    if (app.isLive()) {
+        analyzeLive(app, convert, progressive, keys.get(), masks.get(),
+                    expr_strings);
+        return EXIT_SUCCESS;
     }
 
-    // Read our inputs, keys and masks data.
+    // Get the traces files, which may be sharded.
+    const vector<string> traces_files = expandShards(traces_file);
+    if (traces_files.empty())
+        reporter->errx(EXIT_FAILURE, "No traces file found for '%s'",
+                       traces_file.c_str());
+    if (app.verbose() && traces_files.size() > 1)
+        cout << "Traces are sharded over " << traces_files.size()
+             << " files\n";
+
+    // Read our inputs data.
     unique_ptr<const NPArray<NPDataTy>> inputs =
         readNumpyDataFile<NPDataTy>("input", inputs_file, app.verbosity());
-    unique_ptr<const NPArray<NPDataTy>> keys =
-        readNumpyDataFile<NPDataTy>("keys", keys_file, app.verbosity());
-    unique_ptr<const NPArray<NPDataTy>> masks =
-        readNumpyDataFile<NPDataTy>("masks", masks_file, app.verbosity());
 
     // Construct the intermediate value expression.
     Expr::Context<uint32_t> context;
@@ -200,63 +884,36 @@ int main(int argc, char *argv[]) {
     if (masks)
         context.addVariable("mask", masks->cbegin());
 
-    const size_t sample_to_stop_at = min(app.sampleEnd(), traces.cols());
-    const size_t nbtraces = traces.rows();
-
-    // Our empty (for now) metric results.
-    NPArray<double> results(0, sample_to_stop_at - app.sampleStart());
-
-    // Compute the metrics for each of the expressions.
-    for (const auto &str : expr_strings) {
-        context.reset();
-        Expr::Parser<NPDataTy> parser(context, str);
-        unique_ptr<Expr::Expr> expr(parser.parse());
-        if (!expr)
-            reporter->errx(EXIT_FAILURE, "Error parsing expression '%s'",
-                           str.c_str());
-
-        switch (METRIC) {
-        case Metric::PEARSON_CORRELATION: {
-            // Compute the intermediate values.
-            NPArray<double> ivalues(1, nbtraces);
-            for (size_t tnum = 0; tnum < nbtraces; context.incr(), tnum++)
-                ivalues(0, tnum) =
-                    hamming_weight<uint32_t>(expr->eval().getValue(), -1);
-
-            // Compute the metric.
-            results = concatenate(
-                results,
-                correl(app.sampleStart(), sample_to_stop_at, traces, ivalues),
-                NPArray<double>::COLUMN);
-        } break;
-        case Metric::T_TEST: {
-            // Build the classifier.
-            const uint32_t hw_max =
-                Expr::ValueType::getNumBits(expr->getType());
-            vector<Classification> classifier(nbtraces);
-            for (size_t tnum = 0; tnum < nbtraces; context.incr(), tnum++) {
-                const uint32_t hw =
-                    hamming_weight<uint32_t>(expr->eval().getValue(), -1);
-                if (hw < hw_max / 2)
-                    classifier[tnum] = Classification::GROUP_0;
-                else if (hw > hw_max / 2)
-                    classifier[tnum] = Classification::GROUP_1;
-                else
-                    classifier[tnum] = Classification::IGNORE;
-            }
-
-            // Compute the metric.
-            results = concatenate(
-                results,
-                app.isPerfect()
-                    ? perfect_t_test(app.sampleStart(), sample_to_stop_at,
-                                     traces, classifier,
-                                     app.verbose() ? &cout : nullptr)
-                    : t_test(app.sampleStart(), sample_to_stop_at, traces,
-                             classifier),
-                NPArray<double>::COLUMN);
-        } break;
-        }
+    // Compute the metrics. Unless a conversion is requested, the traces are
+    // analyzed in their storage type.
+    NPArray<double> results;
+    if (convert)
+        results = analyze<double>(app, traces_files, convert, order,
+                                  bivariate, bits, progressive, context,
+                                  expr_strings);
+    else {
+        const string elt_ty = getEltTy(traces_files[0], *reporter);
+        if (elt_ty == "f8")
+            results = analyze<double>(app, traces_files, convert, order,
+                                      bivariate, bits, progressive, context,
+                                      expr_strings);
+        else if (elt_ty == "f4")
+            results = analyze<float>(app, traces_files, convert, order,
+                                     bivariate, bits, progressive, context,
+                                     expr_strings);
+        else if (elt_ty == "i2")
+            results = analyze<int16_t>(app, traces_files, convert, order,
+                                       bivariate, bits, progressive, context,
+                                       expr_strings);
+        else if (elt_ty == "u2")
+            results = analyze<uint16_t>(app, traces_files, convert, order,
+                                        bivariate, bits, progressive, context,
+                                        expr_strings);
+        else
+            reporter->errx(EXIT_FAILURE,
+                           "Unsupported element type '%s' for traces in '%s', "
+                           "use --convert",
+                           elt_ty.c_str(), traces_files[0].c_str());
     }
 
     // Output results.
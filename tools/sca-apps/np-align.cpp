@@ -0,0 +1,194 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/Align.h"
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/NPYChunkReader.h"
+#include "PAF/SCA/sca-apps.h"
+#include "PAF/utils/Parallel.h"
+#include "PAF/utils/ProgressMonitor.h"
+#include "PAF/utils/Stats.h"
+
+#include "libtarmac/argparse.hh"
+#include "libtarmac/reporter.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace PAF::SCA;
+using PAF::ProgressMonitor;
+using PAF::ScopedTimer;
+using PAF::Stats;
+
+unique_ptr<Reporter> reporter = make_cli_reporter();
+
+int main(int argc, char *argv[]) {
+    string traces_filename;
+    string output_filename;
+    string shifts_filename;
+    size_t reference_trace = 0;
+    size_t from = 0;
+    size_t length = 0;
+    size_t max_shift = 0;
+    bool convert = false;
+    size_t chunk_size = 4096;
+    unsigned num_jobs = PAF::defaultNumThreads(1);
+    unsigned verbose = 0;
+
+    Argparse argparser("paf-np-align", argc, argv);
+    argparser.optnoval(
+        {"-v", "--verbose"},
+        "increase verbosity level (can be specified multiple times)",
+        [&]() { verbose += 1; });
+    argparser.optval({"-o", "--output"}, "FILENAME",
+                     "save the aligned traces to FILENAME",
+                     [&](const string &s) { output_filename = s; });
+    argparser.optval({"--shifts"}, "FILENAME",
+                     "save the shift of each trace to FILENAME",
+                     [&](const string &s) { shifts_filename = s; });
+    argparser.optval({"-r", "--reference"}, "TRACE",
+                     "use trace number TRACE as the reference (default: 0)",
+                     [&](const string &s) {
+                         reference_trace = stoull(s, nullptr, 0);
+                     });
+    argparser.optval({"-f", "--from"}, "S",
+                     "the reference pattern starts at sample S (default: 0)",
+                     [&](const string &s) { from = stoull(s, nullptr, 0); });
+    argparser.optval({"-n", "--numsamples"}, "N",
+                     "the reference pattern is N samples long",
+                     [&](const string &s) { length = stoull(s, nullptr, 0); });
+    argparser.optval({"--max-shift"}, "M",
+                     "look for shifts of up to M samples in either direction",
+                     [&](const string &s) {
+                         max_shift = stoull(s, nullptr, 0);
+                     });
+    argparser.optnoval(
+        {"--convert"},
+        "convert the power information to floating point (default: no)",
+        [&]() { convert = true; });
+    argparser.optval({"--chunk-size"}, "N",
+                     "process N traces at a time (default: 4096)",
+                     [&](const string &s) {
+                         chunk_size = stoull(s, nullptr, 0);
+                         if (chunk_size == 0)
+                             reporter->errx(EXIT_FAILURE,
+                                            "chunk size can not be 0");
+                     });
+    argparser.optval({"-j", "--jobs"}, "N",
+                     "use up to N threads for the computations (default: "
+                     "$PAF_NUM_THREADS, or 1; 0 uses as many threads as the "
+                     "hardware supports).",
+                     [&](const string &s) {
+                         num_jobs = stoul(s, nullptr, 0);
+                     });
+    argparser.positional(
+        "TRACES", "traces file in numpy format",
+        [&](const string &s) { traces_filename = s; }, /* Required: */ true);
+    Stats::addOptions(argparser);
+    argparser.parse();
+    const ScopedTimer T("paf-np-align");
+
+    if (output_filename.empty())
+        reporter->errx(EXIT_FAILURE, "An output file name is required");
+    if (length == 0 || max_shift == 0)
+        reporter->errx(EXIT_FAILURE,
+                       "Both a pattern length and a maximum shift are needed");
+
+    NPArrayBase::setNumThreads(num_jobs);
+
+    // The traces are read by chunks, each of them being aligned against the
+    // reference trace and appended to the output. Only the shifts are kept
+    // for all traces.
+    const auto loader = [&](const string &filename,
+                            const NPArrayBase::Window &window) {
+        return readNumpyPowerFile<double>(filename, convert, *reporter,
+                                          NPArrayBase::READ, window);
+    };
+    NPYChunkReader<double> traces(traces_filename, chunk_size,
+                                  NPArrayBase::Window(), /* prefetch: */ true,
+                                  loader);
+    if (!traces.good())
+        reporter->errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
+                       traces_filename.c_str(), traces.error());
+    if (reference_trace >= traces.rows())
+        reporter->errx(EXIT_FAILURE, "The reference trace does not exist");
+    if (from + length > traces.cols())
+        reporter->errx(EXIT_FAILURE,
+                       "The reference pattern is not inside the traces");
+
+    const NPArray<double> reference =
+        loader(traces_filename,
+               NPArrayBase::Window(reference_trace, reference_trace + 1));
+    if (!reference.good())
+        reporter->errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
+                       traces_filename.c_str(), reference.error());
+    const Aligner aligner(&reference(0, from), length, from, max_shift,
+                          traces.cols());
+
+    ofstream ofs(output_filename, ofstream::binary);
+    if (!NPArray<double>::saveHeader(ofs, traces.rows(), traces.cols()))
+        reporter->errx(EXIT_FAILURE, "Error saving aligned traces to '%s'",
+                       output_filename.c_str());
+
+    ProgressMonitor pm(cout, string("Aligning to ") + output_filename,
+                       traces.numChunks(), verbose);
+
+    NPArray<int64_t> all_shifts(traces.rows(), 1);
+    while (traces.next()) {
+        // Find the shifts of the chunk traces, two by two, and align them in
+        // place. Each block of rows is processed independently.
+        NPArray<double> chunk = traces.chunk();
+        NPArrayBase::parallelFor(
+            0, (chunk.rows() + 1) / 2, 2 * chunk.cols(),
+            [&](size_t b, size_t e) {
+                const size_t rb = 2 * b;
+                const size_t re = std::min(2 * e, chunk.rows());
+                vector<ptrdiff_t> shifts;
+                aligner.shifts(shifts, chunk, rb, re);
+                for (size_t r = rb; r < re; r++) {
+                    Aligner::align(&chunk(r, 0), chunk.cols(), shifts[r - rb]);
+                    all_shifts(traces.chunkBegin() + r, 0) = shifts[r - rb];
+                }
+            });
+
+        if (!chunk.saveData(ofs))
+            reporter->errx(EXIT_FAILURE, "Error saving aligned traces to '%s'",
+                           output_filename.c_str());
+        pm.update();
+    }
+
+    if (!traces.good())
+        reporter->errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
+                       traces_filename.c_str(), traces.error());
+
+    if (!shifts_filename.empty() && !all_shifts.save(shifts_filename))
+        reporter->errx(EXIT_FAILURE, "Error saving shifts to '%s'",
+                       shifts_filename.c_str());
+
+    return EXIT_SUCCESS;
+}
@@ -19,14 +19,18 @@
  */
 
 #include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/NPYChunkReader.h"
 #include "PAF/SCA/sca-apps.h"
+#include "PAF/utils/Parallel.h"
 #include "PAF/utils/ProgressMonitor.h"
+#include "PAF/utils/Stats.h"
 
 #include "libtarmac/argparse.hh"
 #include "libtarmac/reporter.hh"
 
 #include <cassert>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -39,6 +43,8 @@ using PAF::ProgressMonitor;
 unique_ptr<Reporter> reporter = make_cli_reporter();
 
 using NPPowerTy = double;
+using PAF::ScopedTimer;
+using PAF::Stats;
 static_assert(is_floating_point<NPPowerTy>(),
               "NPPowerTy must be a floating point type");
 
@@ -47,6 +53,8 @@ int main(int argc, char *argv[]) {
     vector<string> input_filenames;
     unsigned verbose = 0;
     bool convert = false;
+    size_t chunk_size = 4096;
+    unsigned num_jobs = PAF::defaultNumThreads(1);
 
     Argparse argparser("paf-np-average", argc, argv);
     argparser.optnoval(
@@ -60,48 +68,99 @@ int main(int argc, char *argv[]) {
         {"--convert"},
         "convert the power information to floating point (default: no)",
         [&]() { convert = true; });
+    argparser.optval({"--chunk-size"}, "N",
+                     "process N traces at a time (default: 4096)",
+                     [&](const string &s) {
+                         chunk_size = stoull(s, nullptr, 0);
+                         if (chunk_size == 0)
+                             reporter->errx(EXIT_FAILURE,
+                                            "chunk size can not be 0");
+                     });
+    argparser.optval({"-j", "--jobs"}, "N",
+                     "use up to N threads for the computations (default: "
+                     "$PAF_NUM_THREADS, or 1; 0 uses as many threads as the "
+                     "hardware supports).",
+                     [&](const string &s) {
+                         num_jobs = stoul(s, nullptr, 0);
+                     });
     argparser.positional_multiple(
         "INPUT_NPY_FILES", "input files in numpy format",
         [&](const string &s) { input_filenames.push_back(s); },
         /* Required: */ true);
+    Stats::addOptions(argparser);
     argparser.parse();
+    const ScopedTimer T("paf-np-average");
 
     if (input_filenames.empty())
         return EXIT_SUCCESS;
 
-    ProgressMonitor pm(cout, string("Averaging to ") + output_filename,
-                       input_filenames.size(), verbose);
-
-    NPArray<NPPowerTy> result =
-        readNumpyPowerFile<NPPowerTy>(input_filenames[0], convert, *reporter);
-    if (!result.good())
-        reporter->errx(EXIT_FAILURE, "Error reading first numpy file '%s'",
-                       input_filenames[0].c_str());
-
-    pm.update();
-    for (size_t i = 1; i < input_filenames.size(); i++) {
-        NPArray<NPPowerTy> tmp = readNumpyPowerFile<NPPowerTy>(
-            input_filenames[i], convert, *reporter);
-        if (!tmp.good())
-            reporter->errx(EXIT_FAILURE, "Error reading numpy file '%s'",
-                           input_filenames[i].c_str());
-
-        if (tmp.rows() != result.rows() || tmp.cols() != result.cols())
+    NPArrayBase::setNumThreads(num_jobs);
+
+    // Process the input files by chunks of traces, so that the memory usage
+    // remains bounded whatever the input files size.
+    const auto loader = [&](const string &filename,
+                            const NPArrayBase::Window &window) {
+        return readNumpyPowerFile<NPPowerTy>(filename, convert, *reporter,
+                                             NPArrayBase::READ, window);
+    };
+    vector<unique_ptr<NPYChunkReader<NPPowerTy>>> inputs;
+    for (const auto &filename : input_filenames) {
+        inputs.push_back(make_unique<NPYChunkReader<NPPowerTy>>(
+            filename, chunk_size, NPArrayBase::Window(), /* prefetch: */ true,
+            loader));
+        const NPYChunkReader<NPPowerTy> &in = *inputs.back();
+        if (!in.good())
+            reporter->errx(EXIT_FAILURE, "Error reading numpy file '%s' (%s)",
+                           filename.c_str(), in.error());
+        if (in.rows() != inputs[0]->rows() || in.cols() != inputs[0]->cols())
             reporter->errx(EXIT_FAILURE,
                            "Shape mismatch between '%s'[%d,%d] and '%s'[%d,%d]",
-                           input_filenames[0].c_str(), result.rows(),
-                           result.cols(), input_filenames[i].c_str(),
-                           tmp.rows(), tmp.cols());
-
-        result += tmp;
-        pm.update();
+                           input_filenames[0].c_str(), inputs[0]->rows(),
+                           inputs[0]->cols(), filename.c_str(), in.rows(),
+                           in.cols());
     }
 
-    result /= NPPowerTy(input_filenames.size());
-
-    if (!result.save(output_filename))
+    ofstream ofs(output_filename, ofstream::binary);
+    if (!NPArray<NPPowerTy>::saveHeader(ofs, inputs[0]->rows(),
+                                        inputs[0]->cols()))
         reporter->errx(EXIT_FAILURE, "Error saving average to '%s'",
                        output_filename.c_str());
 
+    ProgressMonitor pm(cout, string("Averaging to ") + output_filename,
+                       inputs[0]->numChunks(), verbose);
+
+    while (inputs[0]->next()) {
+        for (size_t i = 1; i < inputs.size(); i++)
+            if (!inputs[i]->next())
+                reporter->errx(EXIT_FAILURE, "Error reading numpy file '%s'",
+                               input_filenames[i].c_str());
+
+        // Split the chunk rows between the threads. Each element is summed
+        // over the inputs in the same order whatever the number of threads,
+        // so the average does not depend on it.
+        NPArray<NPPowerTy> result = inputs[0]->chunk();
+        const NPPowerTy num_inputs(inputs.size());
+        NPArrayBase::parallelFor(
+            0, result.rows(), result.cols() * inputs.size(),
+            [&](size_t b, size_t e) {
+                for (size_t r = b; r < e; r++)
+                    for (size_t c = 0; c < result.cols(); c++) {
+                        NPPowerTy sum = result(r, c);
+                        for (size_t i = 1; i < inputs.size(); i++)
+                            sum += inputs[i]->chunk()(r, c);
+                        result(r, c) = sum / num_inputs;
+                    }
+            });
+
+        if (!result.saveData(ofs))
+            reporter->errx(EXIT_FAILURE, "Error saving average to '%s'",
+                           output_filename.c_str());
+        pm.update();
+    }
+
+    if (!inputs[0]->good())
+        reporter->errx(EXIT_FAILURE, "Error reading numpy file '%s'",
+                       input_filenames[0].c_str());
+
     return EXIT_SUCCESS;
 }
@@ -19,6 +19,7 @@
  */
 
 #include "PAF/SCA/NPArray.h"
+#include "PAF/utils/Stats.h"
 
 #include "libtarmac/argparse.hh"
 #include "libtarmac/reporter.hh"
@@ -32,20 +33,39 @@
 
 using namespace std;
 using namespace PAF::SCA;
+using PAF::ScopedTimer;
+using PAF::Stats;
 
 unique_ptr<Reporter> reporter = make_cli_reporter();
 
 namespace {
 
+// The tiling of NPYT outputs.
+struct Tiling {
+    size_t rows = 0; // 0 means the default.
+    size_t cols = 0; // 0 means the default.
+    bool compress = true;
+};
+
+// Save \p a to \p output, in the format selected by its extension.
+template <typename Ty>
+bool saveOutput(const NPArray<Ty> &a, const string &output,
+                const Tiling &tiling) {
+    if (NPArrayBase::fileFormat(output) == NPArrayBase::NPYT)
+        return a.saveNPYT(output, tiling.rows, tiling.cols, tiling.compress);
+    return a.save(output);
+}
+
 bool doConcatenate(const string &output, const vector<string> &inputs,
-                   NPArrayBase::Axis axis, const string &eltTy) {
+                   NPArrayBase::Axis axis, const string &eltTy,
+                   const Tiling &tiling) {
     assert(eltTy.size() == 2 && "Unexpected size for NPArray eltTy");
     if (eltTy[0] == 'f') {
         switch (eltTy[1]) {
         case '8':
-            return NPArray<double>(inputs, axis).save(output);
+            return saveOutput(NPArray<double>(inputs, axis), output, tiling);
         case '4':
-            return NPArray<float>(inputs, axis).save(output);
+            return saveOutput(NPArray<float>(inputs, axis), output, tiling);
         default:
             reporter->errx(
                 EXIT_FAILURE,
@@ -54,13 +74,13 @@ bool doConcatenate(const string &output, const vector<string> &inputs,
     } else if (eltTy[0] == 'u') {
         switch (eltTy[1]) {
         case '1':
-            return NPArray<uint8_t>(inputs, axis).save(output);
+            return saveOutput(NPArray<uint8_t>(inputs, axis), output, tiling);
         case '2':
-            return NPArray<uint16_t>(inputs, axis).save(output);
+            return saveOutput(NPArray<uint16_t>(inputs, axis), output, tiling);
         case '4':
-            return NPArray<uint32_t>(inputs, axis).save(output);
+            return saveOutput(NPArray<uint32_t>(inputs, axis), output, tiling);
         case '8':
-            return NPArray<uint64_t>(inputs, axis).save(output);
+            return saveOutput(NPArray<uint64_t>(inputs, axis), output, tiling);
         default:
             reporter->errx(
                 EXIT_FAILURE,
@@ -69,13 +89,13 @@ bool doConcatenate(const string &output, const vector<string> &inputs,
     } else if (eltTy[0] == 'i') {
         switch (eltTy[1]) {
         case '1':
-            return NPArray<int8_t>(inputs, axis).save(output);
+            return saveOutput(NPArray<int8_t>(inputs, axis), output, tiling);
         case '2':
-            return NPArray<int16_t>(inputs, axis).save(output);
+            return saveOutput(NPArray<int16_t>(inputs, axis), output, tiling);
         case '4':
-            return NPArray<int32_t>(inputs, axis).save(output);
+            return saveOutput(NPArray<int32_t>(inputs, axis), output, tiling);
         case '8':
-            return NPArray<int64_t>(inputs, axis).save(output);
+            return saveOutput(NPArray<int64_t>(inputs, axis), output, tiling);
         default:
             reporter->errx(EXIT_FAILURE,
                            "Unsupported integer element concatenation for now");
@@ -106,11 +126,23 @@ int main(int argc, char *argv[]) {
     argparser.optval({"-o", "--output"}, "FILENAME",
                      "concatenate INPUT_NPY_FILES into FILENAME",
                      [&](const string &s) { output_filename = s; });
+    Tiling tiling;
+    argparser.optval({"--tile-rows"}, "N",
+                     "use tiles of N rows for NPYT outputs (default: 4096)",
+                     [&](const string &s) { tiling.rows = stoul(s); });
+    argparser.optval({"--tile-columns"}, "N",
+                     "use tiles of N columns for NPYT outputs (default: 256)",
+                     [&](const string &s) { tiling.cols = stoul(s); });
+    argparser.optnoval({"--uncompressed"},
+                       "do not compress the tiles of NPYT outputs",
+                       [&]() { tiling.compress = false; });
     argparser.positional_multiple(
         "INPUT_NPY_FILES", "input files in numpy format",
         [&](const string &s) { input_filenames.push_back(s); },
         /* Required: */ true);
+    Stats::addOptions(argparser);
     argparser.parse();
+    const ScopedTimer T("paf-np-cat");
 
     if (input_filenames.empty())
         return EXIT_SUCCESS;
@@ -132,7 +164,8 @@ int main(int argc, char *argv[]) {
                        "Error retrieving information for file '%s'",
                        input_filenames[0].c_str());
 
-    if (!doConcatenate(output_filename, input_filenames, cat_axis, elt_ty))
+    if (!doConcatenate(output_filename, input_filenames, cat_axis, elt_ty,
+                       tiling))
         return EXIT_FAILURE;
 
     return EXIT_SUCCESS;
@@ -19,6 +19,7 @@
  */
 
 #include "PAF/SCA/NPArray.h"
+#include "PAF/utils/Stats.h"
 
 #include "libtarmac/argparse.hh"
 #include "libtarmac/reporter.hh"
@@ -30,6 +31,8 @@
 
 using namespace std;
 using namespace PAF::SCA;
+using PAF::ScopedTimer;
+using PAF::Stats;
 
 namespace {
 
@@ -109,7 +112,9 @@ int main(int argc, char *argv[]) {
     argparser.positional_multiple(
         "VALUE", "values to fill the matrix with",
         [&](const string &s) { cmdline_data.push_back(s); });
+    Stats::addOptions(argparser);
     argparser.parse();
+    const ScopedTimer T("paf-np-create");
 
     // Sanitize our arguments now that we have processed all of them.
     if (filename.empty())
@@ -20,22 +20,64 @@
 
 #include "PAF/SCA/NPArray.h"
 #include "PAF/SCA/Noise.h"
+#include "PAF/utils/Parallel.h"
+#include "PAF/utils/Stats.h"
 
 #include "libtarmac/argparse.hh"
 #include "libtarmac/reporter.hh"
 
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <memory>
 #include <string>
 
+using std::ifstream;
+using std::min;
+using std::ofstream;
 using std::string;
 using std::unique_ptr;
 
 using PAF::SCA::NoiseSource;
 using PAF::SCA::NPArray;
+using PAF::SCA::NPArrayBase;
+using PAF::ScopedTimer;
+using PAF::Stats;
 
 unique_ptr<Reporter> reporter = make_cli_reporter();
 
+namespace {
+// Load the \p num_columns first columns of the input rows needed for the
+// output rows [b, e(, i.e. input rows b % num_rows (included) to e % num_rows,
+// wrapping around to the first input row if needed. The output block can
+// not be larger than the input.
+NPArray<double> inputRows(const string &filename, size_t num_rows,
+                          size_t num_columns, size_t b, size_t e) {
+    const size_t first = b % num_rows;
+    const size_t n = e - b;
+    if (first + n <= num_rows)
+        return NPArray<double>(
+            filename, NPArrayBase::Window(first, first + n, 0, num_columns));
+
+    NPArray<double> head(filename, NPArrayBase::Window(first, num_rows, 0,
+                                                       num_columns));
+    if (!head.good())
+        return head;
+    NPArray<double> tail(filename, NPArrayBase::Window(0, first + n - num_rows,
+                                                       0, num_columns));
+    if (!tail.good())
+        return tail;
+
+    NPArray<double> rows(n, num_columns);
+    std::memcpy(&rows(0, 0), &head(0, 0), head.size() * sizeof(double));
+    std::memcpy(&rows(head.rows(), 0), &tail(0, 0),
+                tail.size() * sizeof(double));
+    return rows;
+}
+} // namespace
+
 int main(int argc, char *argv[]) {
     string inputFileName;
     string outputFileName;
@@ -43,7 +85,11 @@ int main(int argc, char *argv[]) {
     size_t newRowNumber = 0;
     double noiseLevel = 0.0;
     NoiseSource::Type noiseTy = NoiseSource::ZERO;
+    bool withSeed = false;
+    uint64_t seed = 0;
     unsigned verbose = 0;
+    size_t chunkSize = 4096;
+    unsigned numJobs = PAF::defaultNumThreads(1);
 
     Argparse argparser("paf-np-expand", argc, argv);
     argparser.optnoval(
@@ -71,10 +117,32 @@ int main(int argc, char *argv[]) {
     argparser.optnoval({"--normal-noise"},
                        "Use a normal distribution noise source",
                        [&]() { noiseTy = NoiseSource::NORMAL; });
+    argparser.optval({"--seed"}, "SEED",
+                     "Seed the noise source with SEED + ROW for each output "
+                     "row, for reproducible outputs whatever the number of "
+                     "jobs (default: randomly seeded)",
+                     [&](const string &s) {
+                         withSeed = true;
+                         seed = stoull(s, nullptr, 0);
+                     });
+    argparser.optval({"--chunk-size"}, "N",
+                     "Produce N output rows at a time (default: 4096)",
+                     [&](const string &s) {
+                         chunkSize = stoull(s, nullptr, 0);
+                         if (chunkSize == 0)
+                             reporter->errx(EXIT_FAILURE,
+                                            "chunk size can not be 0");
+                     });
+    argparser.optval({"-j", "--jobs"}, "N",
+                     "Use up to N threads (default: $PAF_NUM_THREADS, or 1; "
+                     "0 uses as many threads as the hardware supports)",
+                     [&](const string &s) { numJobs = stoul(s, nullptr, 0); });
     argparser.positional(
         "NPY", "input file in NPY format",
         [&](const string &s) { inputFileName = s; }, /* Required: */ true);
+    Stats::addOptions(argparser);
     argparser.parse();
+    const ScopedTimer T("paf-np-expand");
 
     if (noiseLevel < 0.0)
         reporter->errx(EXIT_FAILURE, "negative noise level is not supported");
@@ -83,29 +151,111 @@ int main(int argc, char *argv[]) {
     if (outputFileName.empty())
         outputFileName = inputFileName;
 
-    NPArray<double> inputNPY(inputFileName);
-    if (!inputNPY.good())
-        reporter->errx(EXIT_FAILURE, "Error reading input file: %s",
-                       inputNPY.error());
+    NPArrayBase::setNumThreads(numJobs);
+
+    size_t numRows;
+    size_t numCols;
+    {
+        ifstream ifs(inputFileName, ifstream::binary);
+        string eltTy;
+        size_t eltSize;
+        const char *errstr = "error opening file";
+        bool swap;
+        bool fortran;
+        if (!ifs || !NPArrayBase::getInformation(ifs, numRows, numCols, eltTy,
+                                                 eltSize, &errstr, &swap,
+                                                 &fortran))
+            reporter->errx(EXIT_FAILURE, "Error reading input file: %s",
+                           errstr);
+    }
 
     if (newRowNumber == 0)
-        newRowNumber = inputNPY.rows();
+        newRowNumber = numRows;
     if (newColNumber == 0)
-        newColNumber = inputNPY.cols();
+        newColNumber = numCols;
+    if (numRows == 0 || numCols == 0)
+        reporter->errx(EXIT_FAILURE, "Can not expand an empty input matrix");
+
+    // Only the rows and columns of the input which are used are read.
+    const size_t inRows = min(numRows, newRowNumber);
+    const size_t inCols = min(numCols, newColNumber);
+
+    // The output is produced, and written, by chunks of rows, so that the
+    // memory usage remains bounded whatever the matrices sizes. Compressed
+    // outputs are produced in a single chunk, as they can not be streamed.
+    const bool compressed =
+        NPArrayBase::fileFormat(outputFileName) != NPArrayBase::NPY;
+    if (compressed)
+        chunkSize = newRowNumber;
+
+    // When the input is smaller than a chunk, keep all of it in memory.
+    NPArray<double> wholeInput;
+    if (inRows <= chunkSize) {
+        wholeInput = NPArray<double>(inputFileName,
+                                     NPArrayBase::Window(0, inRows, 0, inCols));
+        if (!wholeInput.good())
+            reporter->errx(EXIT_FAILURE, "Error reading input file: %s",
+                           wholeInput.error());
+    }
+
+    // Do not overwrite the input while it is being read.
+    const string tmpFileName = outputFileName == inputFileName
+                                   ? outputFileName + ".tmp"
+                                   : outputFileName;
+    ofstream ofs;
+    if (!compressed) {
+        ofs.open(tmpFileName, ofstream::binary);
+        if (!NPArray<double>::saveHeader(ofs, newRowNumber, newColNumber))
+            reporter->errx(EXIT_FAILURE, "Error writing output to file: %s",
+                           tmpFileName.c_str());
+    }
+
+    for (size_t b = 0; b < newRowNumber; b += chunkSize) {
+        const size_t e = min(b + chunkSize, newRowNumber);
+        NPArray<double> blockInput;
+        if (wholeInput.empty()) {
+            blockInput = inputRows(inputFileName, inRows, inCols, b, e);
+            if (!blockInput.good())
+                reporter->errx(EXIT_FAILURE, "Error reading input file: %s",
+                               blockInput.error());
+        }
+        const NPArray<double> &input =
+            wholeInput.empty() ? blockInput : wholeInput;
+        const size_t firstRow = wholeInput.empty() ? b : 0;
 
-    unique_ptr<PAF::SCA::NoiseSource> NS(
-        NoiseSource::getSource(noiseTy, noiseLevel));
-    unique_ptr<double[]> outputSamples(new double[newRowNumber * newColNumber]);
-    NPArray<double> outputNPY(std::move(outputSamples), newRowNumber,
-                              newColNumber);
+        // Expand the input NPY on the X and Y axis. Each block of rows gets
+        // its own noise source, so that they can be processed independently,
+        // and the noise for a row is generated at once.
+        NPArray<double> outputNPY(e - b, newColNumber);
+        NPArrayBase::parallelFor(
+            b, e, newColNumber, [&](size_t rb, size_t re) {
+                unique_ptr<NoiseSource> NS(
+                    NoiseSource::getSource(noiseTy, noiseLevel));
+                for (size_t r = rb; r < re; r++) {
+                    const size_t ir = (r - firstRow) % input.rows();
+                    double *row = &outputNPY(r - b, 0);
+                    if (withSeed)
+                        NS->seed(seed + r);
+                    NS->fill(row, newColNumber);
+                    for (size_t c = 0; c < newColNumber; c++)
+                        row[c] += input(ir, c % input.cols());
+                }
+            });
 
-    // Expand the input NPY on the X and Y axis.
-    for (size_t r = 0; r < outputNPY.rows(); r++)
-        for (size_t c = 0; c < outputNPY.cols(); c++)
-            outputNPY(r, c) =
-                inputNPY(r % inputNPY.rows(), c % inputNPY.cols()) + NS->get();
+        if (compressed ? !outputNPY.save(tmpFileName)
+                       : !outputNPY.saveData(ofs))
+            reporter->errx(EXIT_FAILURE, "Error writing output to file: %s",
+                           tmpFileName.c_str());
+    }
 
-    if (!outputNPY.save(outputFileName))
+    if (!compressed) {
+        ofs.close();
+        if (!ofs)
+            reporter->errx(EXIT_FAILURE, "Error writing output to file: %s",
+                           tmpFileName.c_str());
+    }
+    if (tmpFileName != outputFileName &&
+        std::rename(tmpFileName.c_str(), outputFileName.c_str()) != 0)
         reporter->errx(EXIT_FAILURE, "Error writing output to file: %s",
                        outputFileName.c_str());
 
@@ -0,0 +1,200 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/NPYChunkReader.h"
+#include "PAF/SCA/Preprocess.h"
+#include "PAF/SCA/sca-apps.h"
+#include "PAF/utils/Parallel.h"
+#include "PAF/utils/ProgressMonitor.h"
+#include "PAF/utils/Stats.h"
+
+#include "libtarmac/argparse.hh"
+#include "libtarmac/reporter.hh"
+
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace PAF::SCA;
+using PAF::ProgressMonitor;
+using PAF::ScopedTimer;
+using PAF::Stats;
+
+unique_ptr<Reporter> reporter = make_cli_reporter();
+
+namespace {
+// Parse the non-zero size in \p s, given for \p option.
+size_t parseSize(const string &s, const char *option) {
+    const size_t n = stoull(s, nullptr, 0);
+    if (n == 0)
+        reporter->errx(EXIT_FAILURE, "%s can not be 0", option);
+    return n;
+}
+
+// Parse the comma separated list of coefficients in \p s.
+vector<double> parseTaps(const string &s) {
+    vector<double> taps;
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        const size_t next = min(s.find(',', pos), s.size());
+        try {
+            taps.push_back(stod(s.substr(pos, next - pos)));
+        } catch (const exception &) {
+            reporter->errx(EXIT_FAILURE, "Invalid FIR coefficients in '%s'",
+                           s.c_str());
+        }
+        pos = next + 1;
+    }
+    return taps;
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+    string traces_filename;
+    string output_filename;
+    Preprocessor preprocessor;
+    bool convert = false;
+    size_t chunk_size = 4096;
+    unsigned num_jobs = PAF::defaultNumThreads(1);
+    unsigned verbose = 0;
+
+    Argparse argparser("paf-np-preprocess", argc, argv);
+    argparser.optnoval(
+        {"-v", "--verbose"},
+        "increase verbosity level (can be specified multiple times)",
+        [&]() { verbose += 1; });
+    argparser.optval({"-o", "--output"}, "FILENAME",
+                     "save the preprocessed traces to FILENAME",
+                     [&](const string &s) { output_filename = s; });
+    argparser.optval({"--fir"}, "C0,C1,...",
+                     "filter the traces with the FIR filter with coefficients "
+                     "C0, C1, ...",
+                     [&](const string &s) {
+                         preprocessor.addFIR(parseTaps(s));
+                     });
+    argparser.optval({"--moving-average"}, "W",
+                     "filter the traces with a moving average over W samples",
+                     [&](const string &s) {
+                         preprocessor.addMovingAverage(
+                             parseSize(s, "--moving-average"));
+                     });
+    argparser.optval({"--downsample"}, "F",
+                     "downsample the traces by a factor F, after an "
+                     "anti-aliasing low-pass filter",
+                     [&](const string &s) {
+                         preprocessor.addDownsample(
+                             parseSize(s, "--downsample"));
+                     });
+    argparser.optval({"--integrate"}, "PERIOD[%OFFSET]",
+                     "sum the samples of each clock cycle of PERIOD samples, "
+                     "the first cycle starting at sample OFFSET (default: 0)",
+                     [&](const string &s) {
+                         const size_t pos = s.find('%');
+                         const size_t period = parseSize(
+                             s.substr(0, pos), "The integration PERIOD");
+                         const size_t offset =
+                             pos == string::npos
+                                 ? 0
+                                 : stoull(s.substr(pos + 1), nullptr, 0);
+                         preprocessor.addIntegrate(period, offset);
+                     });
+    argparser.optnoval(
+        {"--convert"},
+        "convert the power information to floating point (default: no)",
+        [&]() { convert = true; });
+    argparser.optval({"--chunk-size"}, "N",
+                     "process N traces at a time (default: 4096)",
+                     [&](const string &s) {
+                         chunk_size = parseSize(s, "The chunk size");
+                     });
+    argparser.optval({"-j", "--jobs"}, "N",
+                     "use up to N threads for the computations (default: "
+                     "$PAF_NUM_THREADS, or 1; 0 uses as many threads as the "
+                     "hardware supports).",
+                     [&](const string &s) {
+                         num_jobs = stoul(s, nullptr, 0);
+                     });
+    argparser.positional(
+        "TRACES", "traces file in numpy format",
+        [&](const string &s) { traces_filename = s; }, /* Required: */ true);
+    Stats::addOptions(argparser);
+    argparser.parse();
+    const ScopedTimer T("paf-np-preprocess");
+
+    if (output_filename.empty())
+        reporter->errx(EXIT_FAILURE, "An output file name is required");
+    if (preprocessor.empty())
+        reporter->errx(EXIT_FAILURE, "No preprocessing stage specified");
+
+    NPArrayBase::setNumThreads(num_jobs);
+
+    // The preprocessing stages work on each trace independently, so the
+    // traces are read by chunks, each of them being preprocessed and
+    // appended to the output before the next one is needed.
+    NPYChunkReader<double> traces(
+        traces_filename, chunk_size, NPArrayBase::Window(),
+        /* prefetch: */ true,
+        [&](const string &filename, const NPArrayBase::Window &window) {
+            return readNumpyPowerFile<double>(filename, convert, *reporter,
+                                              NPArrayBase::READ, window);
+        });
+    if (!traces.good())
+        reporter->errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
+                       traces_filename.c_str(), traces.error());
+
+    const size_t num_samples = preprocessor.samples(traces.cols());
+    if (num_samples == 0)
+        reporter->errx(EXIT_FAILURE,
+                       "No samples left after preprocessing %zu samples",
+                       traces.cols());
+    if (verbose)
+        cout << "Preprocessing " << traces.rows() << " traces of "
+             << traces.cols() << " samples with " << preprocessor.size()
+             << " stages, to " << num_samples << " samples\n";
+
+    ofstream ofs(output_filename, ofstream::binary);
+    if (!NPArray<double>::saveHeader(ofs, traces.rows(), num_samples))
+        reporter->errx(EXIT_FAILURE,
+                       "Error saving preprocessed traces to '%s'",
+                       output_filename.c_str());
+
+    ProgressMonitor pm(cout, string("Preprocessing to ") + output_filename,
+                       traces.numChunks(), verbose);
+
+    while (traces.next()) {
+        if (!preprocessor.apply(traces.chunk()).saveData(ofs))
+            reporter->errx(EXIT_FAILURE,
+                           "Error saving preprocessed traces to '%s'",
+                           output_filename.c_str());
+        pm.update();
+    }
+
+    if (!traces.good())
+        reporter->errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
+                       traces_filename.c_str(), traces.error());
+
+    return EXIT_SUCCESS;
+}
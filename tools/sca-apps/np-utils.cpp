@@ -19,28 +19,143 @@
  */
 
 #include "PAF/SCA/NPArray.h"
+#include "PAF/utils/Parallel.h"
+#include "PAF/utils/Stats.h"
 
 #include "libtarmac/argparse.hh"
 #include "libtarmac/reporter.hh"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <type_traits>
 
 using namespace std;
 using namespace PAF::SCA;
+using PAF::ScopedTimer;
+using PAF::Stats;
 
 unique_ptr<Reporter> reporter = make_cli_reporter();
 
 namespace {
 
-template <class Ty> bool pprint(ostream &os, const string &filename) {
-    NPArray<Ty> t(filename);
-    if (t.good()) {
+// Call f with a value of the element type described by eltTy (e.g. 'f8'),
+// and return its result.
+template <class Function> bool withEltType(const string &eltTy, Function f) {
+    if (eltTy.size() == 2) {
+        if (eltTy[0] == 'f') {
+            switch (eltTy[1]) {
+            case '8':
+                return f(double());
+            case '4':
+                return f(float());
+            }
+        } else if (eltTy[0] == 'u') {
+            switch (eltTy[1]) {
+            case '1':
+                return f(uint8_t());
+            case '2':
+                return f(uint16_t());
+            case '4':
+                return f(uint32_t());
+            case '8':
+                return f(uint64_t());
+            }
+        } else if (eltTy[0] == 'i') {
+            switch (eltTy[1]) {
+            case '1':
+                return f(int8_t());
+            case '2':
+                return f(int16_t());
+            case '4':
+                return f(int32_t());
+            case '8':
+                return f(int64_t());
+            }
+        }
+    }
+
+    reporter->errx(EXIT_FAILURE, "Unsupported element type '%s'",
+                   eltTy.c_str());
+}
+
+// Get the name of the C type for Ty.
+template <class Ty> const char *cTypeName() {
+    if (is_floating_point<Ty>())
+        return sizeof(Ty) == 8 ? "double" : "float";
+    if (is_signed<Ty>())
+        switch (sizeof(Ty)) {
+        case 1:
+            return "int8_t";
+        case 2:
+            return "int16_t";
+        case 4:
+            return "int32_t";
+        default:
+            return "int64_t";
+        }
+    switch (sizeof(Ty)) {
+    case 1:
+        return "uint8_t";
+    case 2:
+        return "uint16_t";
+    case 4:
+        return "uint32_t";
+    default:
+        return "uint64_t";
+    }
+}
+
+// Read the window w of the matrix in file filename, converting its elements
+// to Ty. The rows are spread over the NPArray threads, each of them reading
+// and converting its own rows.
+template <class Ty>
+NPArray<Ty> readWindow(const string &filename, const NPArrayBase::Window &w) {
+    NPArray<Ty> result(w.rows(), w.cols());
+    if (result.empty())
+        return result;
+
+    atomic<const char *> errstr{nullptr};
+    NPArrayBase::parallelFor(0, w.rows(), w.cols(), [&](size_t b, size_t e) {
+        const NPArray<Ty> rows = NPArray<Ty>::readAs(
+            filename,
+            NPArrayBase::Window(w.rowBegin + b, w.rowBegin + e, w.colBegin,
+                                w.colEnd, w.colStride));
+        if (!rows.good() || rows.size() != (e - b) * w.cols()) {
+            errstr = rows.good() ? "short read" : rows.error();
+            return;
+        }
+        copy_n(&rows(0, 0), rows.size(), &result(b, 0));
+    });
+
+    if (errstr)
+        reporter->errx(EXIT_FAILURE, "Error reading '%s': %s",
+                       filename.c_str(), errstr.load());
+    return result;
+}
+
+// Print the window w of the matrix in file filename, chunkSize rows at a
+// time, as a python array or as a C array.
+template <class Ty>
+bool print(ostream &os, const string &filename, const NPArrayBase::Window &w,
+           size_t chunkSize, bool asC) {
+    if (asC)
+        os << "const " << cTypeName<Ty>() << " data[" << w.rows() << "]["
+           << w.cols() << "] = {\n";
+    else
         os << "[\n";
+
+    for (size_t b = 0; b < w.rows(); b += chunkSize) {
+        const size_t e = min(b + chunkSize, w.rows());
+        const NPArray<Ty> t = readWindow<Ty>(
+            filename, NPArrayBase::Window(w.rowBegin + b, w.rowBegin + e,
+                                          w.colBegin, w.colEnd, w.colStride));
         for (size_t r = 0; r < t.rows(); r++) {
-            os << "  [ ";
+            os << (asC ? "  { " : "  [ ");
             const char *sep = "";
             for (size_t c = 0; c < t.cols(); c++) {
                 os << sep;
@@ -53,137 +168,110 @@ template <class Ty> bool pprint(ostream &os, const string &filename) {
                     os << t(r, c);
                 sep = ", ";
             }
-            os << " ],\n";
+            os << (asC ? " },\n" : " ],\n");
         }
-        os << "]\n";
-        return true;
     }
 
-    reporter->warn("Error loading array: %s", t.error());
-    return false;
+    os << (asC ? "};\n" : "]\n");
+    return bool(os);
 }
 
+// Save the window w of the matrix in file input to file output, with Ty
+// elements, transposing it if transpose is set. Plain NPY outputs are
+// produced chunkSize rows (or chunkSize x chunkSize tiles when transposing)
+// at a time, so that the memory usage does not depend on the matrix size:
+// the transposed tiles are written in place, each of their rows going to
+// its final position in the output file. Compressed outputs are produced
+// in a single chunk, as they can not be streamed.
 template <class Ty>
-bool cprint(ostream &os, const string &filename, const char *ty) {
-    NPArray<Ty> t(filename);
-    const size_t rows = t.rows();
-    const size_t cols = t.cols();
-    if (t.good()) {
-        os << "const " << ty << " data[" << rows << "][" << cols << "] = {\n";
-        for (size_t r = 0; r < rows; r++) {
-            os << "  { ";
-            const char *sep = "";
-            for (size_t c = 0; c < cols; c++) {
-                os << sep;
-                if (is_integral<Ty>() && sizeof(Ty) == 1)
-                    if (is_signed<Ty>())
-                        os << int(t(r, c));
-                    else
-                        os << unsigned(t(r, c));
-                else
-                    os << t(r, c);
-                sep = ", ";
+bool convert(const string &input, const string &output,
+             const NPArrayBase::Window &w, bool transpose, size_t chunkSize) {
+    const size_t rows = transpose ? w.cols() : w.rows();
+    const size_t cols = transpose ? w.rows() : w.cols();
+
+    // Do not overwrite the input while it is being read.
+    const string tmpFileName = output == input ? output + ".tmp" : output;
+
+    if (NPArrayBase::fileFormat(output) != NPArrayBase::NPY) {
+        NPArray<Ty> a = readWindow<Ty>(input, w);
+        if (transpose)
+            a.transpose();
+        if (!a.save(tmpFileName))
+            return false;
+    } else {
+        ofstream ofs(tmpFileName, ofstream::binary);
+        if (!NPArray<Ty>::saveHeader(ofs, rows, cols))
+            return false;
+        const size_t dataOffset = ofs.tellp();
+
+        for (size_t rb = 0; rb < w.rows(); rb += chunkSize) {
+            const size_t re = min(rb + chunkSize, w.rows());
+            if (!transpose) {
+                const NPArray<Ty> a = readWindow<Ty>(
+                    input,
+                    NPArrayBase::Window(w.rowBegin + rb, w.rowBegin + re,
+                                        w.colBegin, w.colEnd, w.colStride));
+                if (!a.saveData(ofs))
+                    return false;
+                continue;
+            }
+
+            for (size_t cb = 0; cb < w.cols(); cb += chunkSize) {
+                const size_t ce = min(cb + chunkSize, w.cols());
+                NPArray<Ty> tile = readWindow<Ty>(
+                    input,
+                    NPArrayBase::Window(
+                        w.rowBegin + rb, w.rowBegin + re,
+                        w.colBegin + cb * w.colStride,
+                        min(w.colBegin + ce * w.colStride, w.colEnd),
+                        w.colStride));
+                tile.transpose();
+                for (size_t r = 0; r < tile.rows(); r++) {
+                    ofs.seekp(dataOffset + ((cb + r) * cols + rb) * sizeof(Ty));
+                    ofs.write(reinterpret_cast<const char *>(&tile(r, 0)),
+                              tile.cols() * sizeof(Ty));
+                }
+                if (!ofs)
+                    return false;
             }
-            os << " },\n";
         }
-        os << "};\n";
-        return true;
+
+        ofs.close();
+        if (!ofs)
+            return false;
     }
 
-    reporter->warn("Error loading array: %s", t.error());
-    return false;
+    return tmpFileName == output ||
+           std::rename(tmpFileName.c_str(), output.c_str()) == 0;
 }
 
-bool print_as_python(ostream &os, const string &descr, const string &filename) {
-    if (descr[1] == 'f') {
-        switch (descr[2]) {
-        case '8':
-            return pprint<double>(cout, filename);
-        case '4':
-            return pprint<float>(cout, filename);
-        default:
-            reporter->errx(
-                EXIT_FAILURE,
-                "Unsupported floating point element printing for now");
-        }
-    } else if (descr[1] == 'u') {
-        switch (descr[2]) {
-        case '1':
-            return pprint<uint8_t>(cout, filename);
-        case '2':
-            return pprint<uint16_t>(cout, filename);
-        case '4':
-            return pprint<uint32_t>(cout, filename);
-        case '8':
-            return pprint<uint64_t>(cout, filename);
-        default:
-            reporter->errx(
-                EXIT_FAILURE,
-                "Unsupported unsigned integer element printing for now");
-        }
-    } else if (descr[1] == 'i') {
-        switch (descr[2]) {
-        case '1':
-            return pprint<int8_t>(cout, filename);
-        case '2':
-            return pprint<int16_t>(cout, filename);
-        case '4':
-            return pprint<int32_t>(cout, filename);
-        case '8':
-            return pprint<int64_t>(cout, filename);
-        default:
-            reporter->errx(EXIT_FAILURE,
-                           "Unsupported integer element printing for now");
-        }
-    } else
-        reporter->errx(EXIT_FAILURE,
-                       "Unsupported element type printing for now");
-}
-
-bool print_as_c(ostream &os, const string &descr, const string &filename) {
-    if (descr[1] == 'f') {
-        switch (descr[2]) {
-        case '8':
-            return cprint<double>(cout, filename, "double");
-        case '4':
-            return cprint<float>(cout, filename, "float");
-        default:
-            reporter->errx(
-                EXIT_FAILURE,
-                "Unsupported floating point element printing for now");
-        }
-    } else if (descr[1] == 'u') {
-        switch (descr[2]) {
-        case '1':
-            return cprint<uint8_t>(cout, filename, "uint8_t");
-        case '2':
-            return cprint<uint16_t>(cout, filename, "uint16_t");
-        case '4':
-            return cprint<uint32_t>(cout, filename, "uint32_t");
-        case '8':
-            return cprint<uint64_t>(cout, filename, "uint64_t");
-        default:
-            reporter->errx(
-                EXIT_FAILURE,
-                "Unsupported unsigned integer element printing for now");
-        }
-    } else if (descr[1] == 'i') {
-        switch (descr[2]) {
-        case '1':
-            return cprint<int8_t>(cout, filename, "int8_t");
-        case '2':
-            return cprint<int16_t>(cout, filename, "int16_t");
-        case '4':
-            return cprint<int32_t>(cout, filename, "int32_t");
-        case '8':
-            return cprint<int64_t>(cout, filename, "int64_t");
-        default:
-            reporter->errx(EXIT_FAILURE,
-                           "Unsupported integer element printing for now");
+// Parse a BEGIN[,END[,STEP]] range specification into begin, end and step
+// (if step is not null).
+void parseRange(const string &s, size_t &begin, size_t &end, size_t *step) {
+    try {
+        size_t pos;
+        begin = stoull(s, &pos, 0);
+        if (pos < s.size() && s[pos] == ',') {
+            const string rest = s.substr(pos + 1);
+            end = stoull(rest, &pos, 0);
+            if (step && pos < rest.size() && rest[pos] == ',') {
+                const string last = rest.substr(pos + 1);
+                *step = stoull(last, &pos, 0);
+                pos += rest.size() - last.size();
+            }
+            pos += s.size() - rest.size();
         }
-    } else
-        reporter->errx(EXIT_FAILURE,
-                       "Unsupported element type printing for now");
+        if (pos != s.size())
+            throw invalid_argument("trailing characters");
+    } catch (const logic_error &) {
+        reporter->errx(EXIT_FAILURE, "Invalid range '%s'", s.c_str());
+    }
+    if (end < begin)
+        reporter->errx(EXIT_FAILURE, "Invalid range '%s' (END < BEGIN)",
+                       s.c_str());
+    if (step && *step == 0)
+        reporter->errx(EXIT_FAILURE, "Invalid range '%s' (STEP is 0)",
+                       s.c_str());
 }
 
 } // namespace
@@ -200,8 +288,15 @@ int main(int argc, char *argv[]) {
         PRINT_C_ARRAY = 4,
         PRINT_INFO = 5,
         PRINT_REV = 6,
+        CONVERT = 7,
     } action_type = PRINT_COLUMNS;
     unsigned verbose = 0; // Controls the verbosity of our program.
+    string outputFileName;
+    NPArrayBase::Window window;
+    string eltType;
+    bool transpose = false;
+    size_t chunkSize = 0;
+    unsigned numJobs = PAF::defaultNumThreads(1);
 
     Argparse argparser("paf-np-utils", argc, argv);
     argparser.optnoval(
@@ -225,10 +320,52 @@ int main(int argc, char *argv[]) {
                        [&]() { action_type = PRINT_INFO; });
     argparser.optnoval({"-m", "--revision"}, "print NPY revision",
                        [&]() { action_type = PRINT_REV; });
+    argparser.optval(
+        {"-o", "--output"}, "FILENAME",
+        "save the (sliced, converted or transposed) array to FILENAME",
+        [&](const string &s) {
+            outputFileName = s;
+            action_type = CONVERT;
+        });
+    argparser.optval({"--slice-rows"}, "BEGIN[,END]",
+                     "only use rows [BEGIN, END( of the input array",
+                     [&](const string &s) {
+                         parseRange(s, window.rowBegin, window.rowEnd,
+                                    nullptr);
+                     });
+    argparser.optval({"--slice-columns"}, "BEGIN[,END[,STEP]]",
+                     "only use one column every STEP columns in [BEGIN, END( "
+                     "of the input array",
+                     [&](const string &s) {
+                         parseRange(s, window.colBegin, window.colEnd,
+                                    &window.colStride);
+                     });
+    argparser.optval({"--dtype"}, "ELT_TYPE",
+                     "convert the elements to ELT_TYPE (f8, f4, u1, u2, u4, "
+                     "u8, i1, i2, i4 or i8) in the output file (default: the "
+                     "input element type)",
+                     [&](const string &s) { eltType = s; });
+    argparser.optnoval({"--transpose"}, "transpose the output array",
+                       [&]() { transpose = true; });
+    argparser.optval({"--chunk-size"}, "N",
+                     "process N rows at a time (default: 4096), or tiles of "
+                     "N x N elements when transposing (default: 1024)",
+                     [&](const string &s) {
+                         chunkSize = stoull(s, nullptr, 0);
+                         if (chunkSize == 0)
+                             reporter->errx(EXIT_FAILURE,
+                                            "chunk size can not be 0");
+                     });
+    argparser.optval({"-j", "--jobs"}, "N",
+                     "Use up to N threads (default: $PAF_NUM_THREADS, or 1; "
+                     "0 uses as many threads as the hardware supports)",
+                     [&](const string &s) { numJobs = stoul(s, nullptr, 0); });
     argparser.positional(
         "NPY", "input file in numpy format",
         [&](const string &s) { filename = s; }, /* Required: */ true);
+    Stats::addOptions(argparser);
     argparser.parse();
+    const ScopedTimer T("paf-np-utils");
 
     unsigned major, minor;
     size_t data_size;
@@ -269,6 +406,11 @@ int main(int argc, char *argv[]) {
         reporter->errx(EXIT_FAILURE, "Unexpected array dimension");
     }
 
+    if (chunkSize == 0)
+        chunkSize = transpose ? 1024 : 4096;
+    NPArrayBase::setNumThreads(numJobs);
+    window = window.clamp(rows, columns);
+
     switch (action_type) {
     case PRINT_COLUMNS:
         if (verbose)
@@ -286,17 +428,29 @@ int main(int argc, char *argv[]) {
         cout << descr << '\n';
         break;
     case PRINT_PYTHON_ARRAY:
-        if (!print_as_python(cout, descr, filename))
-            return EXIT_FAILURE;
-        break;
     case PRINT_C_ARRAY:
-        if (!print_as_c(cout, descr, filename))
+        if (!withEltType(descr.substr(1), [&](auto v) {
+                return print<decltype(v)>(cout, filename, window, chunkSize,
+                                          action_type == PRINT_C_ARRAY);
+            }))
             return EXIT_FAILURE;
         break;
+    case CONVERT:
+        if (eltType.empty())
+            eltType = descr.substr(1);
+        if (!withEltType(eltType, [&](auto v) {
+                return convert<decltype(v)>(filename, outputFileName, window,
+                                            transpose, chunkSize);
+            }))
+            reporter->errx(EXIT_FAILURE, "Error writing output to file: %s",
+                           outputFileName.c_str());
+        break;
     case PRINT_INFO:
         cout << "Revision: " << major << '.' << minor << '\n';
         cout << "Dimensions: " << rows << " x " << columns << '\n';
         cout << "Element type: " << descr << '\n';
+        cout << "Fortran order: " << (fortran_order ? "yes" : "no") << '\n';
+        cout << "Data size: " << data_size << " bytes\n";
         break;
     case PRINT_REV:
         if (verbose)
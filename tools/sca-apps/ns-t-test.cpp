@@ -19,16 +19,22 @@
  */
 
 #include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/Prefetcher.h"
 #include "PAF/SCA/SCA.h"
+#include "PAF/SCA/StatsCache.h"
 #include "PAF/SCA/sca-apps.h"
+#include "PAF/utils/Stats.h"
 
 #include "libtarmac/reporter.hh"
 
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 using namespace std;
@@ -36,21 +42,187 @@ using namespace PAF::SCA;
 
 unique_ptr<Reporter> reporter = make_cli_reporter();
 
+enum Grouping { GROUP_BY_NPY, GROUP_INTERLEAVED };
+
+// Load the traces in traces_path, stored as PowerTy elements, and set
+// nbtraces and nbsamples to the minimum number of traces and samples per
+// trace of the files. Only floating point traces can be converted from
+// another element type.
+template <typename PowerTy>
+vector<NPArray<PowerTy>> loadTraces(SCAApp &app,
+                                    const vector<string> &traces_path,
+                                    bool convert, size_t &nbtraces,
+                                    size_t &nbsamples) {
+    nbtraces = numeric_limits<size_t>::max();
+    nbsamples = numeric_limits<size_t>::max();
+    vector<NPArray<PowerTy>> traces;
+    // The element types are retrieved upfront, as the files are read in the
+    // background, where errors can not be fatal.
+    vector<string> elt_tys;
+    for (const string &trace_path : traces_path)
+        elt_tys.push_back(getEltTy(trace_path, *reporter));
+    // Only load the samples we are going to process, reading the next file
+    // while the current one is being checked.
+    Prefetcher<NPArray<PowerTy>> files(traces_path.size(), [&](size_t i) {
+        return readTraces<PowerTy>(traces_path[i], convert, elt_tys[i],
+                                   *reporter, app.loadMode(),
+                                   app.tracesWindow());
+    });
+    while (files.next()) {
+        const string &trace_path = traces_path[files.index()];
+        NPArray<PowerTy> &t = files.current();
+        if (!t.good())
+            reporter->errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
+                           trace_path.c_str(), t.error());
+
+        nbtraces = min(nbtraces, t.rows());
+        nbsamples = min(nbsamples, t.cols());
+
+        if (app.verbose()) {
+            cout << "Read " << t.rows() << " traces (" << t.cols()
+                 << " samples) from '" << trace_path << "'\n";
+            if (app.verbosity() >= 2)
+                t.dump(cout, 3, 4, "Traces");
+        }
+
+        traces.push_back(std::move(t));
+    }
+
+    return traces;
+}
+
+// Compute the first order non-specific t-test on the traces in traces_path
+// from its per-sample statistics, which are restored from the statistics
+// cache when they have already been accumulated on the same traces, over
+// samples covering the samples of interest. The traces are only read if they
+// have not, and their statistics are then saved to the cache.
+template <typename PowerTy>
+NPArray<double> cachedTTest(SCAApp &app, const vector<string> &traces_path,
+                            bool convert, Grouping grouping) {
+    StatsCache &cache = *app.statsCache();
+
+    // The statistics depend on the traces and on how they are grouped and
+    // analyzed.
+    StatsCache::Key key;
+    key.add(string("ns-t-test"))
+        .add(uint64_t(grouping))
+        .add(string(NPArrayBase::getEltTyDescr<PowerTy>()))
+        .add(uint64_t(convert));
+    size_t nbsamples = numeric_limits<size_t>::max();
+    for (const string &trace_path : traces_path) {
+        size_t num_rows;
+        size_t num_cols;
+        string elt_ty;
+        getInformation(trace_path, num_rows, num_cols, elt_ty, *reporter);
+        const NPArrayBase::Window window =
+            app.tracesWindow().clamp(num_rows, num_cols);
+        key.addFile(trace_path).add(uint64_t(window.rows()));
+        nbsamples = min(nbsamples, window.cols());
+    }
+    const size_t sb = app.sampleStart();
+    const size_t se = sb + nbsamples;
+
+    TTestAccumulator<PowerTy> acc(nbsamples);
+    if (cache.lookup(key.get(), sb, se, acc)) {
+        if (app.verbose())
+            cout << "Statistics restored from cache for samples [" << sb
+                 << ", " << se << ")\n";
+        return acc.t_test();
+    }
+
+    size_t nbtraces;
+    const vector<NPArray<PowerTy>> traces =
+        loadTraces<PowerTy>(app, traces_path, convert, nbtraces, nbsamples);
+    switch (grouping) {
+    case GROUP_BY_NPY:
+        acc.add(traces[0].view(0, traces[0].rows(), 0, nbsamples),
+                Classification::GROUP_0);
+        acc.add(traces[1].view(0, traces[1].rows(), 0, nbsamples),
+                Classification::GROUP_1);
+        break;
+    case GROUP_INTERLEAVED:
+        acc.add(traces[0].view(0, nbtraces, 0, nbsamples, 2),
+                Classification::GROUP_0);
+        acc.add(traces[0].view(1, nbtraces, 0, nbsamples, 2),
+                Classification::GROUP_1);
+        break;
+    }
+
+    if (!cache.insert(key.get(), sb, se, acc))
+        reporter->warn("Can not save statistics to cache '%s' (%s)",
+                       cache.getDirectory().c_str(), cache.error());
+
+    return acc.t_test();
+}
+
+// Compute the non-specific t-test on the traces in traces_path, stored as
+// PowerTy elements. The groups are never copied: in interleaved mode, they
+// are strided views on the single traces file.
+template <typename PowerTy>
+NPArray<double> analyze(SCAApp &app, const vector<string> &traces_path,
+                        bool convert, unsigned order, Grouping grouping) {
+    if (app.statsCache())
+        return cachedTTest<PowerTy>(app, traces_path, convert, grouping);
+
+    size_t nbtraces;
+    size_t nbsamples;
+    const vector<NPArray<PowerTy>> traces =
+        loadTraces<PowerTy>(app, traces_path, convert, nbtraces, nbsamples);
+
+    if (app.verbose()) {
+        cout << "Will process " << nbsamples
+             << " samples per traces, starting at sample " << app.sampleStart()
+             << "\n";
+    }
+
+    // Compute the non-specific T-Test.
+    switch (grouping) {
+    case GROUP_BY_NPY:
+        return app.isPerfect()
+                   ? perfect_t_test(0, nbsamples, traces[0], traces[1],
+                                    app.verbose() ? &cout : nullptr)
+                   : t_test(0, nbsamples, order, traces[0], traces[1]);
+    case GROUP_INTERLEAVED: {
+        // Even traces are in group0 and odd traces in group1: look at them
+        // through strided views rather than classifying each trace.
+        const NPArrayView<PowerTy> group0 =
+            traces[0].view(0, nbtraces, 0, nbsamples, 2);
+        const NPArrayView<PowerTy> group1 =
+            traces[0].view(1, nbtraces, 0, nbsamples, 2);
+        return app.isPerfect()
+                   ? perfect_t_test(0, nbsamples, group0, group1,
+                                    app.verbose() ? &cout : nullptr)
+                   : t_test(0, nbsamples, order, group0, group1);
+    }
+    }
+
+    return {};
+}
+
 int main(int argc, char *argv[]) {
     bool convert = false;
+    unsigned order = 1;
     vector<string> traces_path;
-    enum { GROUP_BY_NPY, GROUP_INTERLEAVED } grouping = GROUP_BY_NPY;
+    Grouping grouping = GROUP_BY_NPY;
     SCAApp app("paf-ns-t-test", argc, argv);
     app.optnoval({"--interleaved"},
                  "assume interleaved traces in a single NPY file",
                  [&]() { grouping = GROUP_INTERLEAVED; });
     app.optnoval(
         {"--convert"},
-        "convert the power information to floating point (default: no)",
+        "convert the power information to floating point (default: no, the "
+        "traces are analyzed in their storage type, which can be f8, f4, i2 "
+        "or u2)",
         [&]() { convert = true; });
+    app.optval({"--order"}, "ORDER",
+               "compute the univariate t-test of order ORDER, e.g. 2 for "
+               "masked implementations (default: 1)",
+               [&](const string &s) { order = stoul(s, nullptr, 0); });
     app.positional_multiple("TRACES", "group of traces",
                             [&](const string &s) { traces_path.push_back(s); });
+    app.addStatsCacheOption();
     app.setup();
+    const PAF::ScopedTimer T("paf-ns-t-test");
 
     // Sanitize our inputs.
     if (traces_path.empty()) {
@@ -74,11 +246,23 @@ int main(int argc, char *argv[]) {
         break;
     }
 
+    if (order == 0)
+        reporter->errx(EXIT_FAILURE, "The t-test order must be at least 1");
+    if (order > 1 && app.isPerfect())
+        reporter->errx(EXIT_FAILURE,
+                       "--perfect can not be used with higher order t-tests");
+    if (app.statsCache() && (order > 1 || app.isPerfect()))
+        reporter->errx(EXIT_FAILURE,
+                       "--stats-cache can not be used with --order or "
+                       "--perfect");
+
     if (app.verbose()) {
         cout << "Performing non-specific T-Test on traces :";
         for (const auto &t : traces_path)
             cout << " " << t;
         cout << '\n';
+        if (order > 1)
+            cout << "T-Test order: " << order << '\n';
         if (app.decimationPeriod() != 1 || app.decimationOffset() != 0)
             cout << "Decimation: " << app.decimationPeriod() << '%'
                  << app.decimationOffset() << '\n';
@@ -91,60 +275,24 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    size_t nbtraces = numeric_limits<size_t>::max();
-    size_t sample_to_stop_at = app.sampleEnd();
-    vector<NPArray<double>> traces;
-    for (const auto &trace_path : traces_path) {
-        NPArray<double> t =
-            readNumpyPowerFile<double>(trace_path, convert, *reporter);
-        if (!t.good())
-            reporter->errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
-                           trace_path.c_str(), t.error());
-
-        nbtraces = min(nbtraces, t.rows());
-        sample_to_stop_at = min(sample_to_stop_at, t.cols());
-
-        if (app.verbose()) {
-            cout << "Read " << t.rows() << " traces (" << t.cols()
-                 << " samples) from '" << trace_path << "'\n";
-            if (app.verbosity() >= 2)
-                t.dump(cout, 3, 4, "Traces");
-        }
-
-        traces.push_back(std::move(t));
-    }
-
-    if (app.verbose()) {
-        const size_t nbsamples = sample_to_stop_at - app.sampleStart();
-        cout << "Will process " << nbsamples
-             << " samples per traces, starting at sample " << app.sampleStart()
-             << "\n";
-    }
-
-    // Compute the non-specific T-Test.
+    // Compute the non-specific T-Test. Unless a conversion is requested, the
+    // traces are analyzed in their storage type.
     NPArray<double> results;
-    switch (grouping) {
-    case GROUP_BY_NPY:
-        results = app.isPerfect()
-                      ? perfect_t_test(app.sampleStart(), sample_to_stop_at,
-                                       traces[0], traces[1],
-                                       app.verbose() ? &cout : nullptr)
-                      : t_test(app.sampleStart(), sample_to_stop_at, traces[0],
-                               traces[1]);
-        break;
-    case GROUP_INTERLEAVED: {
-        vector<Classification> classifier(nbtraces);
-        for (size_t i = 0; i < nbtraces; i++)
-            classifier[i] =
-                i % 2 == 0 ? Classification::GROUP_0 : Classification::GROUP_1;
-        results = app.isPerfect()
-                      ? perfect_t_test(app.sampleStart(), sample_to_stop_at,
-                                       traces[0], classifier,
-                                       app.verbose() ? &cout : nullptr)
-                      : t_test(app.sampleStart(), sample_to_stop_at, traces[0],
-                               classifier);
-    } break;
-    }
+    const string elt_ty = convert ? "f8" : getEltTy(traces_path[0], *reporter);
+    if (elt_ty == "f8")
+        results = analyze<double>(app, traces_path, convert, order, grouping);
+    else if (elt_ty == "f4")
+        results = analyze<float>(app, traces_path, convert, order, grouping);
+    else if (elt_ty == "i2")
+        results = analyze<int16_t>(app, traces_path, convert, order, grouping);
+    else if (elt_ty == "u2")
+        results =
+            analyze<uint16_t>(app, traces_path, convert, order, grouping);
+    else
+        reporter->errx(EXIT_FAILURE,
+                       "Unsupported element type '%s' for traces in '%s', use "
+                       "--convert",
+                       elt_ty.c_str(), traces_path[0].c_str());
 
     // Output results.
     app.output(results);
@@ -0,0 +1,202 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/NPYChunkReader.h"
+#include "PAF/SCA/SCA.h"
+#include "PAF/SCA/sca-apps.h"
+#include "PAF/SCA/utils.h"
+#include "PAF/utils/Parallel.h"
+#include "PAF/utils/Stats.h"
+
+#include "libtarmac/argparse.hh"
+#include "libtarmac/reporter.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace PAF::SCA;
+using PAF::ScopedTimer;
+using PAF::Stats;
+
+unique_ptr<Reporter> reporter = make_cli_reporter();
+
+int main(int argc, char *argv[]) {
+    string traces_filename;
+    string output_filename;
+    string map_filename;
+    string scores_filename;
+    bool interleaved = false;
+    bool convert = false;
+    size_t num_poi = 0;
+    size_t window = 0;
+    size_t chunk_size = 4096;
+    unsigned num_jobs = PAF::defaultNumThreads(1);
+    unsigned verbose = 0;
+
+    Argparse argparser("paf-poi", argc, argv);
+    argparser.optnoval(
+        {"-v", "--verbose"},
+        "increase verbosity level (can be specified multiple times)",
+        [&]() { verbose += 1; });
+    argparser.optval({"-o", "--output"}, "FILENAME",
+                     "save the points of interest of the traces to FILENAME",
+                     [&](const string &s) { output_filename = s; });
+    argparser.optval({"--index-map"}, "FILENAME",
+                     "save the original position of each point of interest to "
+                     "FILENAME",
+                     [&](const string &s) { map_filename = s; });
+    argparser.optval({"-k", "--num-poi"}, "K",
+                     "select the K best points of interest",
+                     [&](const string &s) { num_poi = stoull(s, nullptr, 0); });
+    argparser.optval({"--window"}, "W",
+                     "also select the W samples on each side of a point of "
+                     "interest (default: 0)",
+                     [&](const string &s) { window = stoull(s, nullptr, 0); });
+    argparser.optval({"--scores"}, "FILENAME",
+                     "rank the samples with the scores in FILENAME, e.g. the "
+                     "numpy output of paf-t-test or paf-correl",
+                     [&](const string &s) { scores_filename = s; });
+    argparser.optnoval({"--interleaved"},
+                       "rank the samples with the non-specific t-test of the "
+                       "interleaved traces",
+                       [&]() { interleaved = true; });
+    argparser.optnoval(
+        {"--convert"},
+        "convert the power information to floating point (default: no)",
+        [&]() { convert = true; });
+    argparser.optval({"--chunk-size"}, "N",
+                     "process N traces at a time (default: 4096)",
+                     [&](const string &s) {
+                         chunk_size = stoull(s, nullptr, 0);
+                         if (chunk_size == 0)
+                             reporter->errx(EXIT_FAILURE,
+                                            "chunk size can not be 0");
+                     });
+    argparser.optval({"-j", "--jobs"}, "N",
+                     "use up to N threads for the computations (default: "
+                     "$PAF_NUM_THREADS, or 1; 0 uses as many threads as the "
+                     "hardware supports).",
+                     [&](const string &s) {
+                         num_jobs = stoul(s, nullptr, 0);
+                     });
+    argparser.positional(
+        "TRACES", "traces file in numpy format",
+        [&](const string &s) { traces_filename = s; }, /* Required: */ true);
+    Stats::addOptions(argparser);
+    argparser.parse();
+    const ScopedTimer T("paf-poi");
+
+    if (output_filename.empty() || map_filename.empty())
+        reporter->errx(EXIT_FAILURE,
+                       "Both an output file and an index map file are needed");
+    if (num_poi == 0)
+        reporter->errx(EXIT_FAILURE,
+                       "The number of points of interest can not be 0");
+    if (scores_filename.empty() == !interleaved)
+        reporter->errx(EXIT_FAILURE,
+                       "Exactly one of --scores and --interleaved is needed");
+
+    NPArrayBase::setNumThreads(num_jobs);
+
+    // The traces are read by chunks, in up to two passes: one to accumulate
+    // the t-test statistics when the scores are computed, and one to extract
+    // the points of interest from each chunk.
+    const auto loader = [&](const string &filename,
+                            const NPArrayBase::Window &window) {
+        return readNumpyPowerFile<double>(filename, convert, *reporter,
+                                          NPArrayBase::READ, window);
+    };
+    NPYChunkReader<double> traces(traces_filename, chunk_size,
+                                  NPArrayBase::Window(), /* prefetch: */ true,
+                                  loader);
+    if (!traces.good())
+        reporter->errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
+                       traces_filename.c_str(), traces.error());
+
+    // Get the scores of the samples, from a file or with a first pass over
+    // the traces.
+    NPArray<double> scores;
+    if (interleaved) {
+        TTestAccumulator<double> acc(traces.cols());
+        while (traces.next()) {
+            // Even traces are in group0 and odd traces in group1.
+            const NPArray<double> &chunk = traces.chunk();
+            const size_t first = traces.chunkBegin() % 2;
+            acc.add(chunk.view(first, chunk.rows(), 0, chunk.cols(), 2),
+                    Classification::GROUP_0);
+            acc.add(chunk.view(1 - first, chunk.rows(), 0, chunk.cols(), 2),
+                    Classification::GROUP_1);
+        }
+        if (!traces.good())
+            reporter->errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
+                           traces_filename.c_str(), traces.error());
+        if (acc.count(Classification::GROUP_0) < 2 ||
+            acc.count(Classification::GROUP_1) < 2)
+            reporter->errx(EXIT_FAILURE,
+                           "At least 4 traces are needed for the t-test");
+        scores = acc.t_test();
+        traces.rewind();
+    } else {
+        scores = NPArray<double>(scores_filename);
+        if (!scores.good())
+            reporter->errx(EXIT_FAILURE, "Error reading scores from '%s' (%s)",
+                           scores_filename.c_str(), scores.error());
+        if (scores.cols() != traces.cols())
+            reporter->errx(EXIT_FAILURE,
+                           "Scores (%zu samples) and traces (%zu samples) "
+                           "do not match",
+                           scores.cols(), traces.cols());
+    }
+
+    const vector<size_t> poi = select_poi(scores, num_poi, window);
+    if (verbose)
+        cout << "Selected " << poi.size() << " points of interest out of "
+             << traces.cols() << " samples\n";
+
+    NPArray<uint64_t> index_map(1, poi.size());
+    for (size_t i = 0; i < poi.size(); i++)
+        index_map(0, i) = poi[i];
+    if (!index_map.save(map_filename))
+        reporter->errx(EXIT_FAILURE, "Error saving index map to '%s'",
+                       map_filename.c_str());
+
+    // Save the reduced traces.
+    ofstream ofs(output_filename, ofstream::binary);
+    if (!NPArray<double>::saveHeader(ofs, traces.rows(), poi.size()))
+        reporter->errx(EXIT_FAILURE, "Error saving points of interest to '%s'",
+                       output_filename.c_str());
+    while (traces.next())
+        if (!select_samples(traces.chunk(), poi).saveData(ofs))
+            reporter->errx(EXIT_FAILURE,
+                           "Error saving points of interest to '%s'",
+                           output_filename.c_str());
+    if (!traces.good())
+        reporter->errx(EXIT_FAILURE, "Error reading traces from '%s' (%s)",
+                       traces_filename.c_str(), traces.error());
+
+    return EXIT_SUCCESS;
+}
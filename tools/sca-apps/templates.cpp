@@ -0,0 +1,336 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited
+ * and/or its affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/Expr.h"
+#include "PAF/SCA/ExprParser.h"
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/ShardedNPArray.h"
+#include "PAF/SCA/Templates.h"
+#include "PAF/SCA/sca-apps.h"
+#include "PAF/utils/Stats.h"
+
+#include "libtarmac/reporter.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+using namespace PAF::SCA;
+
+// The expected type in the 'data' files (e.g. inputs, masks, keys, ...)
+using NPDataTy = uint32_t;
+static_assert(is_integral<NPDataTy>(), "NPDataTy must be an integral type");
+
+unique_ptr<Reporter> reporter = make_cli_reporter();
+
+unique_ptr<NPArray<NPDataTy>> readNumpyDataFile(const string &name,
+                                                const string &filename,
+                                                unsigned verbosity) {
+    if (filename.empty())
+        return nullptr;
+
+    unique_ptr<NPArray<NPDataTy>> np(new NPArray<NPDataTy>(filename));
+    if (!np->good())
+        reporter->errx(EXIT_FAILURE,
+                       "Error reading numpy data for '%s' from file '%s' (%s)",
+                       name.c_str(), filename.c_str(), np->error());
+
+    if (verbosity > 0) {
+        cout << "Read " << np->rows() << " x " << np->cols() << " data from "
+             << filename << '\n';
+        if (verbosity >= 2)
+            np->dump(cout, 3, 4, name.c_str());
+    }
+
+    return np;
+}
+
+// Evaluate expression expr_string, with the variables in context, on the
+// nbtraces traces: its value is the class of a trace. The number of classes
+// is derived from the expression width, which must be at most 16 bits.
+vector<uint32_t> getClasses(Expr::Context<uint32_t> &context,
+                            const string &expr_string, size_t nbtraces,
+                            size_t &num_classes) {
+    Expr::Parser<NPDataTy> parser(context, expr_string);
+    const unique_ptr<Expr::Expr> expr(parser.parse());
+    if (!expr)
+        reporter->errx(EXIT_FAILURE, "Error parsing expression '%s'",
+                       expr_string.c_str());
+    const size_t numBits = Expr::ValueType::getNumBits(expr->getType());
+    if (numBits > 16)
+        reporter->errx(EXIT_FAILURE,
+                       "Expression '%s' is %zu bits wide, at most 16 bits are "
+                       "supported (use trunc8 or trunc16)",
+                       expr_string.c_str(), numBits);
+    num_classes = size_t(1) << numBits;
+
+    Expr::Program program;
+    program.add(*expr);
+    vector<uint32_t> classes(nbtraces);
+    const size_t chunkSize = 65536;
+    vector<Expr::Value::ConcreteType> values(min(chunkSize, nbtraces));
+    for (size_t tb = 0; tb < nbtraces; tb += chunkSize) {
+        const size_t cn = min(chunkSize, nbtraces - tb);
+        program.eval(values.data(), tb, cn);
+        for (size_t t = 0; t < cn; t++)
+            classes[tb + t] = uint32_t(values[t] & (num_classes - 1));
+    }
+
+    return classes;
+}
+
+// Call f(chunk, first_trace) on all traces, one chunk at a time for sharded
+// traces.
+template <typename PowerTy, class Fn>
+void forEachChunk(const NPArray<PowerTy> &traces, Fn f) {
+    f(NPArrayView<PowerTy>(traces), 0);
+}
+
+template <typename PowerTy, class Fn>
+void forEachChunk(ShardedNPArray<PowerTy> &traces, Fn f) {
+    while (traces.next())
+        f(NPArrayView<PowerTy>(traces.chunk()), traces.chunkBegin());
+    if (!traces.good())
+        reporter->errx(EXIT_FAILURE, "Error reading traces (%s)",
+                       traces.error());
+}
+
+// Build the templates from the profiling traces, and save them to
+// templates_file.
+template <class TracesTy>
+void build(SCAApp &app, TracesTy &traces, Expr::Context<uint32_t> &context,
+           const string &expr_string, const string &templates_file) {
+    using PowerTy = typename remove_const_t<TracesTy>::DataTy;
+    size_t numClasses;
+    const vector<uint32_t> classes =
+        getClasses(context, expr_string, traces.rows(), numClasses);
+
+    TemplateBuilder<PowerTy> builder(numClasses, traces.cols());
+    forEachChunk(traces,
+                 [&](const NPArrayView<PowerTy> &chunk, size_t first_trace) {
+                     builder.add(chunk, classes, first_trace);
+                 });
+
+    const Templates templates = builder.build();
+    if (!templates.good())
+        reporter->errx(EXIT_FAILURE, "Error building the templates (%s)",
+                       templates.error());
+    if (!templates.save(templates_file))
+        reporter->errx(EXIT_FAILURE, "Error saving the templates to '%s'",
+                       templates_file.c_str());
+    if (app.verbose())
+        cout << "Built " << numClasses << " templates of " << traces.cols()
+             << " POIs from " << builder.count() << " traces\n";
+}
+
+// Match the attack traces against the templates, returning the
+// log-likelihoods, one row per trace and one column per class.
+template <class TracesTy>
+NPArray<double> match(TracesTy &traces, const Templates &templates) {
+    using PowerTy = typename remove_const_t<TracesTy>::DataTy;
+    if (traces.cols() != templates.pois())
+        reporter->errx(EXIT_FAILURE,
+                       "The traces have %zu samples, but the templates have "
+                       "%zu POIs",
+                       traces.cols(), templates.pois());
+
+    NPArray<double> results(traces.rows(), templates.classes());
+    forEachChunk(traces,
+                 [&](const NPArrayView<PowerTy> &chunk, size_t first_trace) {
+                     const NPArray<double> ll = templates.match(chunk);
+                     for (size_t t = 0; t < ll.rows(); t++)
+                         for (size_t c = 0; c < ll.cols(); c++)
+                             results(first_trace + t, c) = ll(t, c);
+                 });
+    return results;
+}
+
+// Build the templates from, or match against the templates, the PowerTy
+// traces, from a single file or sharded over the traces_files.
+template <typename PowerTy>
+NPArray<double> analyze(SCAApp &app, const vector<string> &traces_files,
+                        bool convert, const Templates *templates,
+                        Expr::Context<uint32_t> &context,
+                        const string &expr_string,
+                        const string &templates_file) {
+    return withTraces<PowerTy>(app, traces_files, convert, [&](auto &traces) {
+        if (templates)
+            return match(traces, *templates);
+        build(app, traces, context, expr_string, templates_file);
+        return NPArray<double>();
+    });
+}
+
+int main(int argc, char *argv[]) {
+
+    string traces_file;
+    string inputs_file;
+    string masks_file;
+    string keys_file;
+    string build_file;
+    string match_file;
+    bool convert = false;
+    vector<string> expr_strings;
+
+    SCAApp app(argv[0], argc, argv);
+    app.optval({"-t", "--traces"}, "TRACESFILE",
+               "use TRACESFILE as traces, in npy format. The traces can be "
+               "sharded over several files, with TRACESFILE being a glob "
+               "pattern or @MANIFEST, where MANIFEST lists the shards, one "
+               "per line",
+               [&](const string &s) { traces_file = s; });
+    app.optval({"-i", "--inputs"}, "INPUTSFILE",
+               "use INPUTSFILE as input data, in npy format.",
+               [&](const string &s) { inputs_file = s; });
+    app.optval({"-m", "--masks"}, "MASKSFILE",
+               "use MASKSFILE as mask data, in npy format",
+               [&](const string &s) { masks_file = s; });
+    app.optval({"-k", "--keys"}, "KEYSFILE",
+               "use KEYSFILE as key data, in npy format",
+               [&](const string &s) { keys_file = s; });
+    app.optnoval(
+        {"--convert"},
+        "convert the power information to floating point (default: no, the "
+        "traces are analyzed in their storage type, which can be f8, f4, i2 "
+        "or u2)",
+        [&]() { convert = true; });
+    app.optval({"--build"}, "TEMPLATESFILE",
+               "build the templates from the profiling traces, classified by "
+               "EXPRESSION, and save them to TEMPLATESFILE",
+               [&](const string &s) { build_file = s; });
+    app.optval({"--match"}, "TEMPLATESFILE",
+               "match the attack traces against the templates from "
+               "TEMPLATESFILE, and output their log-likelihoods, one row per "
+               "trace and one column per class",
+               [&](const string &s) { match_file = s; });
+    app.positional_multiple(
+        "EXPRESSION",
+        "use EXPRESSION to compute the class of each profiling trace, e.g. "
+        "'trunc8($in[0] ^ $key[0])' for 256 classes. A specific value can be "
+        "referred to with $in[idx] (from INPUTSFILE), $key[idx] (from "
+        "KEYSFILE) or $mask[idx] (from MASKSFILE) in the expression.",
+        [&](const string &s) { expr_strings.push_back(s); });
+    app.setup();
+    const PAF::ScopedTimer T("paf-templates");
+
+    // Sanity checks.
+    if (build_file.empty() == match_file.empty()) {
+        app.help(cout);
+        reporter->errx(EXIT_FAILURE, "Need exactly one of --build or --match");
+    }
+    if (!build_file.empty()) {
+        if (expr_strings.size() != 1) {
+            app.help(cout);
+            reporter->errx(EXIT_FAILURE,
+                           "Building templates needs exactly one expression");
+        }
+        if (inputs_file.empty() && keys_file.empty() && masks_file.empty()) {
+            app.help(cout);
+            reporter->errx(
+                EXIT_FAILURE,
+                "Need at least one of INPUTSFILE, KEYSFILE or MASKSFILE");
+        }
+    } else if (!expr_strings.empty())
+        reporter->errx(EXIT_FAILURE,
+                       "Matching traces does not use any expression");
+    if (app.isPerfect())
+        reporter->errx(EXIT_FAILURE, "--perfect is not supported");
+
+    if (app.verbose()) {
+        cout << "Reading traces from: '" << traces_file << "'\n";
+        if (!build_file.empty())
+            cout << "Building templates to: '" << build_file << "'\n";
+        else
+            cout << "Matching against templates from: '" << match_file
+                 << "'\n";
+        cout << "Converting power trace to float: " << (convert ? "yes" : "no")
+             << '\n';
+    }
+
+    // Get the traces files, which may be sharded.
+    const vector<string> traces_files = expandShards(traces_file);
+    if (traces_files.empty())
+        reporter->errx(EXIT_FAILURE, "No traces file found for '%s'",
+                       traces_file.c_str());
+
+    // Read our inputs, keys and masks data, to classify the profiling traces.
+    unique_ptr<const NPArray<NPDataTy>> inputs =
+        readNumpyDataFile("input", inputs_file, app.verbosity());
+    unique_ptr<const NPArray<NPDataTy>> keys =
+        readNumpyDataFile("keys", keys_file, app.verbosity());
+    unique_ptr<const NPArray<NPDataTy>> masks =
+        readNumpyDataFile("masks", masks_file, app.verbosity());
+
+    Expr::Context<uint32_t> context;
+    if (inputs)
+        context.addVariable("in", inputs->cbegin());
+    if (keys)
+        context.addVariable("key", keys->cbegin());
+    if (masks)
+        context.addVariable("mask", masks->cbegin());
+
+    // Read the templates to match against.
+    unique_ptr<const Templates> templates;
+    if (!match_file.empty()) {
+        templates = make_unique<const Templates>(match_file);
+        if (!templates->good())
+            reporter->errx(EXIT_FAILURE,
+                           "Error reading templates from '%s' (%s)",
+                           match_file.c_str(), templates->error());
+    }
+    const string expr_string = expr_strings.empty() ? "" : expr_strings[0];
+
+    // Unless a conversion is requested, the traces are processed in their
+    // storage type.
+    NPArray<double> results;
+    const string elt_ty = convert ? "f8" : getEltTy(traces_files[0], *reporter);
+    if (elt_ty == "f8")
+        results = analyze<double>(app, traces_files, convert, templates.get(),
+                                  context, expr_string, build_file);
+    else if (elt_ty == "f4")
+        results = analyze<float>(app, traces_files, convert, templates.get(),
+                                 context, expr_string, build_file);
+    else if (elt_ty == "i2")
+        results = analyze<int16_t>(app, traces_files, convert,
+                                   templates.get(), context, expr_string,
+                                   build_file);
+    else if (elt_ty == "u2")
+        results = analyze<uint16_t>(app, traces_files, convert,
+                                    templates.get(), context, expr_string,
+                                    build_file);
+    else
+        reporter->errx(EXIT_FAILURE,
+                       "Unsupported element type '%s' for traces in '%s', use "
+                       "--convert",
+                       elt_ty.c_str(), traces_files[0].c_str());
+
+    // Output the log-likelihoods of the matched traces.
+    if (templates)
+        app.output(results);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,215 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/NPYStreamWriter.h"
+#include "PAF/SCA/Noise.h"
+#include "PAF/SCA/Synthetic.h"
+#include "PAF/Synthetic.h"
+#include "PAF/WAN/Synthetic.h"
+#include "PAF/WAN/WaveFile.h"
+#include "PAF/utils/Stats.h"
+
+#include "libtarmac/argparse.hh"
+#include "libtarmac/reporter.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using PAF::ScopedTimer;
+using PAF::Stats;
+using PAF::SCA::NoiseSource;
+using PAF::SCA::NPYStreamWriter;
+using PAF::SCA::SyntheticTraces;
+using PAF::WAN::WaveFile;
+
+namespace {
+
+// Stream the traces to file filename, and their inputs to file
+// inputsFilename (as 32-bit values, as expected by the SCA tools) if it is not
+// empty, so that the memory usage remains bounded
+// whatever the number of traces.
+template <class Ty>
+void writeTraces(SyntheticTraces &ST, size_t numTraces,
+                 const string &filename, const string &inputsFilename) {
+    NPYStreamWriter<Ty> traces(filename, ST.getNumSamples());
+    vector<double> samples(ST.getNumSamples());
+    for (size_t n = 0; n < numTraces && traces.good(); n++) {
+        ST.getTrace(n, samples.data());
+        for (const double s : samples)
+            traces.append(SyntheticTraces::convert<Ty>(s));
+        traces.next();
+    }
+    if (!traces.close())
+        reporter->errx(EXIT_FAILURE, "Error writing traces to '%s': %s",
+                       filename.c_str(), traces.error());
+
+    if (!inputsFilename.empty()) {
+        NPYStreamWriter<uint32_t> inputs(inputsFilename, 1);
+        for (size_t n = 0; n < numTraces && inputs.good(); n++) {
+            inputs.append(ST.getInput(n));
+            inputs.next();
+        }
+        if (!inputs.close())
+            reporter->errx(EXIT_FAILURE, "Error writing inputs to '%s': %s",
+                           inputsFilename.c_str(), inputs.error());
+    }
+}
+
+} // namespace
+
+unique_ptr<Reporter> reporter = make_cli_reporter();
+
+int main(int argc, char *argv[]) {
+    string kind;
+    string filename;
+    uint64_t seed = 0;
+    // Traces.
+    size_t numTraces = 1000;
+    size_t numSamples = 100;
+    size_t leakSample = -1;
+    uint8_t key = 0x2b;
+    double noiseLevel = 1.0;
+    NoiseSource::Type noiseTy = NoiseSource::NORMAL;
+    string eltType = "f8";
+    string inputsFilename;
+    // Waveforms.
+    size_t numSignals = 100;
+    size_t numTimes = 10000;
+    double activity = 0.25;
+    // Tarmac traces.
+    size_t numInstructions = 1000000;
+
+    Argparse ap("paf-synth", argc, argv);
+    ap.optval({"-o", "--output"}, "FILE", "output file name",
+              [&](const string &s) { filename = s; });
+    ap.optval({"--seed"}, "SEED",
+              "seed the generator with SEED (default: 0): the same seed "
+              "always gives the same output",
+              [&](const string &s) { seed = stoull(s, nullptr, 0); });
+    ap.optval({"--traces"}, "N", "number of traces (default: 1000)",
+              [&](const string &s) { numTraces = stoul(s, nullptr, 0); });
+    ap.optval({"--samples"}, "N", "number of samples per trace (default: 100)",
+              [&](const string &s) { numSamples = stoul(s, nullptr, 0); });
+    ap.optval({"--leak-sample"}, "N",
+              "sample where the key leaks (default: the middle of the trace)",
+              [&](const string &s) { leakSample = stoul(s, nullptr, 0); });
+    ap.optval({"--key"}, "BYTE", "the key byte to leak (default: 0x2b)",
+              [&](const string &s) { key = stoul(s, nullptr, 0); });
+    ap.optval({"--noise-level"}, "Value",
+              "level of noise to add to the traces (default: 1.0)",
+              [&](const string &s) { noiseLevel = stod(s); });
+    ap.optnoval({"--uniform-noise"}, "use a uniform distribution noise source",
+                [&]() { noiseTy = NoiseSource::UNIFORM; });
+    ap.optnoval({"--no-noise"}, "do not add noise to the traces",
+                [&]() { noiseTy = NoiseSource::ZERO; });
+    ap.optval({"-t", "--element-type"}, "ELT_TYPE",
+              "traces element type (u1, u2, u4, i1, i2, i4, f4, f8; "
+              "default: f8)",
+              [&](const string &s) { eltType = s; });
+    ap.optval({"--inputs"}, "FILE",
+              "save the traces' input bytes in numpy format to FILE",
+              [&](const string &s) { inputsFilename = s; });
+    ap.optval({"--signals"}, "N",
+              "number of signals in the waveform (default: 100)",
+              [&](const string &s) { numSignals = stoul(s, nullptr, 0); });
+    ap.optval({"--times"}, "N",
+              "number of time steps in the waveform (default: 10000)",
+              [&](const string &s) { numTimes = stoul(s, nullptr, 0); });
+    ap.optval({"--activity"}, "RATIO",
+              "probability for a signal to change at each time step "
+              "(default: 0.25)",
+              [&](const string &s) { activity = stod(s); });
+    ap.optval({"--instructions"}, "N",
+              "number of instructions in the Tarmac trace (default: 1000000)",
+              [&](const string &s) {
+                  numInstructions = stoul(s, nullptr, 0);
+              });
+    ap.positional(
+        "KIND",
+        "the kind of data to generate: 'traces' (side channel traces with "
+        "the hamming weight of an AES SBox output leaking, in numpy format), "
+        "'waveform' (in VCD or FST format, depending on the output file "
+        "name extension) or 'tarmac' (an instruction trace)",
+        [&](const string &s) { kind = s; }, /* Required: */ true);
+    Stats::addOptions(ap);
+    ap.parse();
+    const ScopedTimer T("paf-synth");
+
+    if (filename.empty())
+        reporter->errx(EXIT_FAILURE, "An output file name is required");
+
+    if (kind == "traces") {
+        if (numSamples == 0)
+            reporter->errx(EXIT_FAILURE, "Traces need at least one sample");
+        if (leakSample == size_t(-1))
+            leakSample = numSamples / 2;
+        if (leakSample >= numSamples)
+            reporter->errx(EXIT_FAILURE,
+                           "The leaking sample must be in the traces");
+        SyntheticTraces ST(numSamples, leakSample, key, noiseTy, noiseLevel,
+                           seed);
+        if (eltType == "u1")
+            writeTraces<uint8_t>(ST, numTraces, filename, inputsFilename);
+        else if (eltType == "u2")
+            writeTraces<uint16_t>(ST, numTraces, filename, inputsFilename);
+        else if (eltType == "u4")
+            writeTraces<uint32_t>(ST, numTraces, filename, inputsFilename);
+        else if (eltType == "i1")
+            writeTraces<int8_t>(ST, numTraces, filename, inputsFilename);
+        else if (eltType == "i2")
+            writeTraces<int16_t>(ST, numTraces, filename, inputsFilename);
+        else if (eltType == "i4")
+            writeTraces<int32_t>(ST, numTraces, filename, inputsFilename);
+        else if (eltType == "f4")
+            writeTraces<float>(ST, numTraces, filename, inputsFilename);
+        else if (eltType == "f8")
+            writeTraces<double>(ST, numTraces, filename, inputsFilename);
+        else
+            reporter->errx(EXIT_FAILURE, "Unsupported element type");
+    } else if (kind == "waveform") {
+        if (activity < 0.0 || activity > 1.0)
+            reporter->errx(EXIT_FAILURE, "The activity must be in [0, 1]");
+        if (WaveFile::getFileFormat(filename) ==
+            WaveFile::FileFormat::UNKNOWN)
+            reporter->errx(EXIT_FAILURE,
+                           "Unknown waveform file format for '%s'",
+                           filename.c_str());
+        if (!WaveFile::get(filename, /* write: */ true)
+                 ->write(PAF::WAN::syntheticWaveform(numSignals, numTimes,
+                                                     activity, seed)))
+            reporter->errx(EXIT_FAILURE, "Error writing waveform to '%s'",
+                           filename.c_str());
+    } else if (kind == "tarmac") {
+        std::ofstream os(filename);
+        if (!os || !PAF::writeSyntheticTarmac(os, numInstructions, seed))
+            reporter->errx(EXIT_FAILURE, "Error writing Tarmac trace to '%s'",
+                           filename.c_str());
+    } else
+        reporter->errx(EXIT_FAILURE,
+                       "Unknown data kind '%s' (expected 'traces', "
+                       "'waveform' or 'tarmac')",
+                       kind.c_str());
+
+    return EXIT_SUCCESS;
+}
@@ -22,10 +22,12 @@
 #include <cassert>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <set>
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "libtarmac/argparse.hh"
@@ -33,11 +35,16 @@
 
 #include "PAF/Error.h"
 #include "PAF/WAN/Signal.h"
+#include "PAF/WAN/WaveCache.h"
 #include "PAF/WAN/WaveFile.h"
 #include "PAF/WAN/Waveform.h"
+#include "PAF/utils/Parallel.h"
+#include "PAF/utils/Stats.h"
 
 using namespace std;
 using namespace PAF::WAN;
+using PAF::ScopedTimer;
+using PAF::Stats;
 
 namespace {
 
@@ -80,13 +87,16 @@ class SignalDiff {
 
     struct Difference {
         Difference(const string &fullScopeName, const string &signalName,
-                   const MySignalDesc &SD1, const MySignalDesc &SD2)
+                   const MySignalDesc &SD1, const MySignalDesc &SD2,
+                   size_t first)
             : fullScopeName(fullScopeName), signalName(signalName),
-              sigDesc1(SD1), sigDesc2(SD2) {}
+              sigDesc1(SD1), sigDesc2(SD2), first(first) {}
         string fullScopeName;
         string signalName;
         const MySignalDesc &sigDesc1;
         const MySignalDesc &sigDesc2;
+        // The index of the first differing change.
+        size_t first;
 
         [[nodiscard]] string getFullSignalName() const {
             return fullScopeName + '/' + signalName;
@@ -111,6 +121,9 @@ class SignalDiff {
             return;
         }
 
+        // Match the signals to compare.
+        using MapIterator = multimap<string, MySignalDesc>::const_iterator;
+        vector<pair<MapIterator, MapIterator>> matches;
         for (auto it1 = DDC1.map.begin(), it2 = DDC2.map.begin();
              it1 != DDC1.map.end() && it2 != DDC2.map.end(); it1++, it2++) {
 
@@ -132,15 +145,34 @@ class SignalDiff {
                 return;
             }
 
-            const Signal &S1 = (*W1)[it1->second.getIdx()];
-            const Signal &S2 = (*W2)[it2->second.getIdx()];
-            if (S1 != S2) {
+            matches.emplace_back(it1, it2);
+        }
+
+        // Compare the matched signals in parallel, each one up to its first
+        // difference only. The time indices of W2 are translated to W1's when
+        // they do not have the same times.
+        const vector<TimeIdxTy> timeMap = W1->getTimeIdxMap(*W2);
+        const vector<TimeIdxTy> *TM = timeMap.empty() ? nullptr : &timeMap;
+        vector<size_t> first(matches.size());
+        vector<char> differ(matches.size());
+        PAF::parallelFor(0, matches.size(), 64, [&](size_t b, size_t e) {
+            for (size_t i = b; i < e; i++) {
+                const Signal &S1 = (*W1)[matches[i].first->second.getIdx()];
+                const Signal &S2 = (*W2)[matches[i].second->second.getIdx()];
+                first[i] = S1.firstDifference(S2, TM);
+                differ[i] = first[i] != S1.getNumChanges() ||
+                            S1.getNumChanges() != S2.getNumChanges();
+            }
+        });
+
+        for (size_t i = 0; i < matches.size(); i++)
+            if (differ[i]) {
+                const auto &[it1, it2] = matches[i];
                 differences.emplace_back(it1->first, it1->second.name,
-                                         it1->second, it2->second);
+                                         it1->second, it2->second, first[i]);
                 if (stopAtFirstDifference)
                     break;
             }
-        }
     }
 
     [[nodiscard]] bool isUncomparable() const { return uncomparable; }
@@ -209,6 +241,54 @@ class SignalDiff {
         }
     }
 
+    /// Dumps the first difference of each differing Signal, in time order.
+    void dumpFirstDifferences(ostream &os, bool Verbose) const {
+        if (uncomparable || differences.empty())
+            return;
+
+        const Waveform *W1 = ddC1.getWaveform();
+        const Waveform *W2 = ddC2.getWaveform();
+        assert(W1 && "W1 Waveform pointer should not be null");
+        assert(W2 && "W2 Waveform pointer should not be null");
+
+        // Order the differences by the time at which they first appear: the
+        // earliest of the first differing changes.
+        multimap<TimeTy, size_t> ToD;
+        for (size_t i = 0; i < differences.size(); i++) {
+            const Signal &S1 = (*W1)[differences[i].sigDesc1.getIdx()];
+            const Signal &S2 = (*W2)[differences[i].sigDesc2.getIdx()];
+            const size_t c = differences[i].first;
+            TimeTy time = numeric_limits<TimeTy>::max();
+            if (c < S1.getNumChanges())
+                time = S1.getTimeChange(c);
+            if (c < S2.getNumChanges())
+                time = min(time, S2.getTimeChange(c));
+            ToD.emplace(time, i);
+        }
+
+        for (const auto &[time, i] : ToD) {
+            const Difference &Diff = differences[i];
+            os << time << ' ' << Diff.getFullSignalName() << ' '
+               << Diff.sigDesc1.getKind() << " difference\n";
+            if (Verbose) {
+                const Signal &S1 = (*W1)[Diff.sigDesc1.getIdx()];
+                const Signal &S2 = (*W2)[Diff.sigDesc2.getIdx()];
+                const auto dump = [&](const Signal &S) {
+                    if (Diff.first < S.getNumChanges())
+                        os << S.getTimeChange(Diff.first) << '\t'
+                           << S.getValueChange(Diff.first);
+                    else
+                        os << "(no change)";
+                };
+                os << " - ";
+                dump(S1);
+                os << " <> ";
+                dump(S2);
+                os << '\n';
+            }
+        }
+    }
+
     /// Dumps the differences per time.
     void dumpByTime(ostream &os, bool Verbose) const {
         if (uncomparable || differences.empty())
@@ -343,9 +423,12 @@ int main(int argc, char *argv[]) {
         DISPLAY_MODULE_SUMMARY,
         DISPLAY_BY_SIGNAL,
         DISPLAY_BY_TIME,
+        DISPLAY_FIRST_DIFFERENCES,
         DUMP_TO_FILE
     } action = DISPLAY_BY_SIGNAL;
     string outputFile;
+    bool useCache = false;
+    WriteOptions writeOptions;
 
     Argparse ap("wan-diff", argc, argv);
     ap.optnoval({"--verbose"}, "verbose output", [&]() { verbose++; });
@@ -366,6 +449,10 @@ int main(int argc, char *argv[]) {
     ap.optnoval({"--time-view"},
                 "Display difference by time, rather than by signal",
                 [&]() { action = DISPLAY_BY_TIME; });
+    ap.optnoval({"--first-difference"},
+                "Report only the first difference of each differing signal, "
+                "ordered by time",
+                [&]() { action = DISPLAY_FIRST_DIFFERENCES; });
     ap.optnoval({"--signal-summary"},
                 "Report a summary list of differing signals",
                 [&]() { action = DISPLAY_SIGNAL_SUMMARY; });
@@ -375,9 +462,27 @@ int main(int argc, char *argv[]) {
     ap.optval(
         {"--scope-filter"}, "FILTER", "Filter scopes matching FILTER",
         [&](const string &Filter) { visitOptions.addScopeFilter(Filter); });
+    ap.optnoval({"--wave-cache"},
+                "Load the waveforms from a binary cache file next to each "
+                "input file, creating it when it is missing or outdated",
+                [&]() { useCache = true; });
+    ap.optval({"--compression"}, "LEVEL",
+              "compression level of the fst output: fast (default), balanced "
+              "or small",
+              [&](const string &s) {
+                  WriteOptions::Compression c;
+                  if (!WriteOptions::getCompression(s, c))
+                      DIE("Unknown compression level '", s, "'");
+                  writeOptions.setCompression(c);
+              });
+    ap.optval({"--block-size"}, "CHANGES",
+              "number of value changes per compressed block in the fst "
+              "output (default: decided by the fst library)",
+              [&](const string &s) { writeOptions.setBlockSize(stoul(s)); });
     ap.positional_multiple("FILES", "Files in fst or vcd format to read",
                            [&](const string &s) { inputFiles.push_back(s); });
 
+    Stats::addOptions(ap);
     ap.parse([&]() {
         if (inputFiles.size() != 2)
             DIE("expected exactly 2 file names");
@@ -385,10 +490,11 @@ int main(int argc, char *argv[]) {
             DIE("Registers, Wires and Integers are all skipped: there "
                 "will be nothing to process");
     });
+    const ScopedTimer T("wan-diff");
 
-    array<Waveform, 2> W{
-        WaveFile::get(inputFiles[0], /* write: */ false)->read(),
-        WaveFile::get(inputFiles[1], /* write: */ false)->read()};
+    // Only load the signals which will be compared.
+    array<Waveform, 2> W{readWaveform(inputFiles[0], useCache, visitOptions),
+                         readWaveform(inputFiles[1], useCache, visitOptions)};
 
     if (W[0].getEndTime() != W[1].getEndTime()) {
         cout << W[0].getFileName() << " and " << W[1].getFileName()
@@ -432,11 +538,16 @@ int main(int argc, char *argv[]) {
         case DISPLAY_BY_TIME:
             diff.dumpByTime(cout, verbose);
             break;
-        case DUMP_TO_FILE:
-            diff.dumpToFile(WaveFile::get(outputFile, /* write: */ true).get(),
-                            verbose);
+        case DISPLAY_FIRST_DIFFERENCES:
+            diff.dumpFirstDifferences(cout, verbose);
+            break;
+        case DUMP_TO_FILE: {
+            const auto Out = WaveFile::get(outputFile, /* write: */ true);
+            Out->setWriteOptions(writeOptions);
+            diff.dumpToFile(Out.get(), verbose);
             break;
         }
+        }
     else
         cout << "No difference found.\n";
 
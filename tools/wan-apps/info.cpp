@@ -22,8 +22,9 @@
 #include "libtarmac/reporter.hh"
 
 #include "PAF/Error.h"
-#include "PAF/WAN/WaveFile.h"
+#include "PAF/WAN/WaveCache.h"
 #include "PAF/WAN/Waveform.h"
+#include "PAF/utils/Stats.h"
 
 #include <cstdlib>
 #include <iostream>
@@ -31,6 +32,8 @@
 
 using namespace std;
 using namespace PAF::WAN;
+using PAF::ScopedTimer;
+using PAF::Stats;
 
 namespace {
 struct MyInfoVisitor : public Waveform::Visitor {
@@ -137,22 +140,37 @@ std::unique_ptr<Reporter> reporter = make_cli_reporter();
 int main(int argc, char *argv[]) {
     vector<string> inputFiles;
     enum { DUMP_INFO, DUMP_HIER } action = DUMP_INFO;
+    bool useCache = false;
+    bool stats = false;
+    bool fast = false;
 
     Argparse ap("wan-info", argc, argv);
     ap.optnoval({"--hier"}, "dump hierarchy", [&]() { action = DUMP_HIER; });
+    ap.optnoval({"--stats"},
+                "dump statistics about the signals' changes and memory "
+                "consumption",
+                [&]() { stats = true; });
+    ap.optnoval({"--fast"},
+                "only compute the statistics available without iterating "
+                "over the signals' changes",
+                [&]() { fast = true; });
+    ap.optnoval({"--wave-cache"},
+                "Load the waveforms from a binary cache file next to each "
+                "input file, creating it when it is missing or outdated",
+                [&]() { useCache = true; });
     ap.positional_multiple("FILES", "Files in fst format to read",
                            [&](const string &s) { inputFiles.push_back(s); });
 
+    Stats::addOptions(ap);
     ap.parse([&]() {
         if (inputFiles.empty())
             DIE("expected at least one file name");
     });
+    const ScopedTimer T("wan-info");
 
     for (const auto &filename : inputFiles) {
 
-        std::unique_ptr<WaveFile> wf =
-            WaveFile::get(filename, /* write: */ false);
-        const Waveform W = wf->read();
+        const Waveform W = readWaveform(filename, useCache);
 
         switch (action) {
         case DUMP_INFO: {
@@ -160,6 +178,11 @@ int main(int argc, char *argv[]) {
             MyInfoVisitor I(W);
             W.visit(I);
             I.dump(cout);
+            if (stats) {
+                WaveformStatistics WS(W, Waveform::Visitor::Options(), fast);
+                W.visit(WS);
+                WS.dump(cout);
+            }
             break;
         }
         case DUMP_HIER: {
@@ -31,9 +31,12 @@
 #include "PAF/Error.h"
 #include "PAF/WAN/WaveFile.h"
 #include "PAF/WAN/Waveform.h"
+#include "PAF/utils/Stats.h"
 
 using namespace std;
 using namespace PAF::WAN;
+using PAF::ScopedTimer;
+using PAF::Stats;
 
 std::unique_ptr<Reporter> reporter = make_cli_reporter();
 
@@ -41,6 +44,9 @@ int main(int argc, char *argv[]) {
     vector<string> inputFiles;
     unsigned Verbose = 0;
     string SaveFileName;
+    bool Stream = false;
+    size_t NumSlices = 64;
+    WriteOptions writeOptions;
 
     Waveform::Visitor::Options VisitOptions(
         false /* skipRegs */, false /* skipWires */, false /* skipInts */);
@@ -49,10 +55,36 @@ int main(int argc, char *argv[]) {
     ap.optnoval({"--verbose"}, "verbose output", [&]() { Verbose++; });
     ap.optval({"--output"}, "OUTPUT_FILE", "Save merged traces in OUTPUT_FILE",
               [&](const string &filename) { SaveFileName = filename; });
+    ap.optnoval({"--stream"},
+                "merge the inputs time slice by time slice, without loading "
+                "them entirely in memory (the output must be an fst file)",
+                [&]() { Stream = true; });
+    ap.optval({"--slices"}, "NUM",
+              "split the inputs in NUM time slices when streaming (default: "
+              "64)",
+              [&](const string &s) {
+                  NumSlices = stoul(s);
+                  if (NumSlices == 0)
+                      DIE("The number of slices must be strictly positive");
+              });
+    ap.optval({"--compression"}, "LEVEL",
+              "compression level of the fst output: fast (default), balanced "
+              "or small",
+              [&](const string &s) {
+                  WriteOptions::Compression c;
+                  if (!WriteOptions::getCompression(s, c))
+                      DIE("Unknown compression level '", s, "'");
+                  writeOptions.setCompression(c);
+              });
+    ap.optval({"--block-size"}, "CHANGES",
+              "number of value changes per compressed block in the fst "
+              "output (default: decided by the fst library)",
+              [&](const string &s) { writeOptions.setBlockSize(stoul(s)); });
 
     ap.positional_multiple("FILES", "Input file in fst or vcd format to read",
                            [&](const string &s) { inputFiles.push_back(s); });
 
+    Stats::addOptions(ap);
     ap.parse([&]() {
         if (inputFiles.empty())
             DIE("No input file");
@@ -60,12 +92,23 @@ int main(int argc, char *argv[]) {
             WaveFile::getFileFormat(SaveFileName) ==
                 WaveFile::getFileFormat(inputFiles[0]))
             DIE("Nothing to do with this single output");
+        if (Stream && WaveFile::getFileFormat(SaveFileName) !=
+                          WaveFile::FileFormat::FST)
+            DIE("Streaming requires an fst output file");
     });
+    const ScopedTimer T("wan-merge");
+
+    if (Stream) {
+        streamMerge(inputFiles, SaveFileName, NumSlices, writeOptions);
+        return EXIT_SUCCESS;
+    }
 
     Waveform WMain = readAndMerge(inputFiles);
 
     // Save the merge.
-    if (!WaveFile::get(SaveFileName, /* write: */ true)->write(WMain))
+    if (!WaveFile::get(SaveFileName, /* write: */ true)
+             ->setWriteOptions(writeOptions)
+             .write(WMain))
         DIE("error saving waveform to '%s'", SaveFileName.c_str());
 
     return EXIT_SUCCESS;
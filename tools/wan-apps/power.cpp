@@ -18,6 +18,7 @@
  * This file is part of PAF, the Physical Attack Framework.
  */
 
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
@@ -32,16 +33,21 @@
 #include "libtarmac/reporter.hh"
 
 #include "PAF/Error.h"
-#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/NPYStreamWriter.h"
 #include "PAF/WAN/Signal.h"
+#include "PAF/WAN/WaveCache.h"
 #include "PAF/WAN/WaveFile.h"
 #include "PAF/WAN/Waveform.h"
 #include "PAF/utils/Misc.h"
+#include "PAF/utils/Parallel.h"
+#include "PAF/utils/Stats.h"
 
 using namespace std;
 using namespace PAF::WAN;
 using PAF::split;
-using PAF::SCA::NPArray;
+using PAF::SCA::NPYStreamWriter;
+using PAF::ScopedTimer;
+using PAF::Stats;
 
 namespace {
 
@@ -64,16 +70,16 @@ class RunInfo {
 
         size_t lineNum = 1;
         string line;
+        size_t previous_end = 0;
         while (getline(f, line)) {
             size_t comma = line.find_first_of(',');
-            size_t previous_end = 0;
             if (comma != string::npos) {
                 size_t begin = stoul(line.substr(0, comma));
                 size_t end = stoul(line.substr(comma + 1));
                 if (begin >= end)
                     DIE("Expecting begin < end at line ", lineNum, " in file '",
                         filename, "'");
-                if (begin <= previous_end)
+                if (begin < previous_end)
                     DIE("Expecting a monotonous increase in segments at line ",
                         lineNum, " in file '", filename, "'");
                 previous_end = end;
@@ -97,31 +103,29 @@ class RunInfo {
             os << " - " << ci.start << " - " << ci.end << '\n';
     }
 
-    [[nodiscard]] pair<bool, Segment> getSegment(size_t time) const {
+    [[nodiscard]] Segment getSegment(size_t num) const {
         // If we have no segments at all (no run.info), then consider the
         // complete trace.
         if (segments.size() == 0)
-            return make_pair(true, Segment(0, -1));
-
-        // Look for a segment of interest.
-        for (const auto &s : segments)
-            if (s.start <= time && time < s.end)
-                return make_pair(true, s);
-
-        // No segment found, exclude this area.
-        return make_pair(false, Segment());
+            return {0, size_t(-1)};
+        return segments[num];
     }
 
-    [[nodiscard]] size_t getSegmentNum(size_t time) const {
+    /// Get the number of the segment \p time is in, if any.
+    [[nodiscard]] pair<bool, size_t> getSegmentNum(size_t time) const {
         // No segment at all, consider the whole trace as a segment.
         if (segments.size() == 0)
-            return 0;
-
-        for (size_t s = 0; s < segments.size(); s++)
-            if (segments[s].start <= time && time < segments[s].end)
-                return s;
-
-        DIE("time is not part of segment");
+            return make_pair(true, 0);
+
+        // The segments are sorted and do not overlap: look for the last one
+        // starting at or before time.
+        const auto it = std::upper_bound(
+            segments.begin(), segments.end(), time,
+            [](size_t t, const Segment &s) { return t < s.start; });
+        if (it == segments.begin() || time >= std::prev(it)->end)
+            // No segment found, exclude this area.
+            return make_pair(false, 0);
+        return make_pair(true, std::prev(it) - segments.begin());
     }
 
     [[nodiscard]] size_t getDuration() const {
@@ -132,6 +136,22 @@ class RunInfo {
         return segments[0].end - segments[0].start;
     }
 
+    /// Get the time windows covering all segments, to only load the parts of
+    /// the waveforms which are relevant to the segments.
+    [[nodiscard]] TimeWindows getTimeWindows() const {
+        vector<Segment> merged;
+        for (const auto &s : segments)
+            if (!merged.empty() && s.start <= merged.back().end)
+                merged.back().end = std::max(merged.back().end, s.end);
+            else
+                merged.push_back(s);
+
+        TimeWindows windows;
+        for (const auto &s : merged)
+            windows.add(s.start, s.end);
+        return windows;
+    }
+
     [[nodiscard]] bool checkDuration(size_t d) const {
         for (const auto &segment : segments)
             if (segment.end - segment.start != d)
@@ -158,70 +178,76 @@ struct HammingVisitor : public Waveform::Visitor {
     HammingVisitor &setWaveform(const Waveform *wf, const RunInfo *ri) {
         w = wf;
         runInfo = ri;
-        // Reset all figures that have been collected so far.
-        for (auto &p : powerTmp)
-            p.second = 0.0;
+        signals.clear();
         return *this;
     }
 
     void enterScope(const Waveform::Scope &scope) override {}
     void leaveScope() override {}
 
+    void visitSignal(const string &FullScopeName,
+                     const Waveform::SignalDesc &SD) override {
+        signals.push_back(SD.getIdx());
+    }
+
     void reduce() {
-        const size_t N = power.size() == 0 ? 0 : power.begin()->second.size();
+        const size_t N = numTraces;
         const size_t R = runInfo->size();
+        numTraces += R;
 
         // Resize all known records.
         for (auto &p : power)
             p.second.resize(N + R, 0.0);
 
-        // Add samples in segments to the newly added records. We exploit the
-        // fact that a map is an ordered container, so PowerTmp will be iterated
-        // over in monotonically increasing time.
-        bool inSegment = false;
-        size_t start, end, segment;
-
-        for (const auto &p : powerTmp) {
-            TimeTy Time = p.first;
-            double Val = p.second;
-            if (inSegment == false) {
-                // Are entering a new segment ?
-                auto r = runInfo->getSegment(Time);
-                if (r.first) {
-                    start = r.second.start;
-                    end = r.second.end;
-                    inSegment = true;
-                    segment = runInfo->getSegmentNum(Time);
-                }
+        // Accumulate the samples from all visited signals, indexed by time
+        // index. The signals are partitioned across threads, each with its
+        // own accumulator.
+        const Accumulator acc = accumulate();
+
+        // Add samples in segments to the newly added records.
+        const auto times = w->timesBegin();
+        for (size_t t = 0; t < acc.hasSample.size(); t++) {
+            if (!acc.hasSample[t])
+                continue;
+            const TimeTy Time = times[t];
+            const auto r = runInfo->getSegmentNum(Time);
+            if (!r.first)
+                continue;
+            const size_t segment = r.second;
+            const size_t start = runInfo->getSegment(segment).start;
+            auto it = power.find(Time - start);
+            if (it == power.end()) {
+                // For some reason, we've never seen this time sample.
+                // Create a record filled with zero, and insert our sample.
+                auto it2 = power.insert(
+                    make_pair(Time - start, vector<double>(N + R, 0.0)));
+                if (!it2.second)
+                    DIE("Error creating a vector at time ", Time);
+                it2.first->second[N + segment] = acc.power[t];
             } else {
-                // Are we leaving a segment ?
-                if (Time >= end)
-                    inSegment = false;
-            }
-
-            if (inSegment) {
-                auto it = power.find(Time - start);
-                if (it == power.end()) {
-                    // For some reason, we've never seen this time sample.
-                    // Create a record filled with zero, and insert our sample.
-                    auto it2 = power.insert(
-                        make_pair(Time - start, vector<double>(N + R, 0.0)));
-                    if (!it2.second)
-                        DIE("Error creating a vector at time ", Time);
-                    it2.first->second[N + segment] = Val;
-                } else {
-                    it->second[N + segment] = Val;
-                }
+                it->second[N + segment] = acc.power[t];
             }
         }
     }
 
-    void collect(TimeTy Time, double Val) {
-        auto it = powerTmp.find(Time);
-        if (it != powerTmp.end())
-            it->second += Val;
-        else
-            powerTmp.emplace(Time, Val);
+    /// Append the traces computed by \p other, from a subsequent input, to
+    /// this visitor's traces.
+    void append(HammingVisitor &&other) {
+        const size_t N = numTraces;
+        const size_t R = other.numTraces;
+        numTraces += R;
+
+        for (auto &p : power)
+            p.second.resize(N + R, 0.0);
+        for (auto &o : other.power) {
+            auto it = power.find(o.first);
+            if (it == power.end())
+                it = power.emplace(o.first, vector<double>(N + R, 0.0)).first;
+            std::copy(o.second.begin(), o.second.end(), it->second.begin() + N);
+        }
+
+        other.power.clear();
+        other.numTraces = 0;
     }
 
     void addNoise() {
@@ -241,12 +267,56 @@ struct HammingVisitor : public Waveform::Visitor {
     }
 
   protected:
-    map<TimeTy, double> powerTmp;
+    // Get the samples of interest for this analysis.
+    virtual const vector<unsigned> &
+    getSamples(const Signal::HammingTy &H) const = 0;
+
+    // The signals visited, in visit order.
+    vector<SignalIdxTy> signals;
     map<TimeTy, vector<double>> power;
+    size_t numTraces{0};
     string fileName;
     const RunInfo *runInfo{nullptr};
 
   private:
+    // The power at each time index, and whether there is a sample at this time
+    // index.
+    struct Accumulator {
+        vector<double> power;
+        vector<bool> hasSample;
+    };
+
+    Accumulator accumulate() const {
+        const size_t numTimes = w->timesEnd() - w->timesBegin();
+        const size_t numThreads = PAF::ThreadPool::get().size();
+        const size_t grain = (signals.size() + numThreads - 1) / numThreads;
+        return PAF::parallelReduce(
+            0, signals.size(), grain,
+            Accumulator{vector<double>(numTimes, 0.0),
+                        vector<bool>(numTimes, false)},
+            [&](size_t b, size_t e) {
+                Accumulator acc{vector<double>(numTimes, 0.0),
+                                vector<bool>(numTimes, false)};
+                for (size_t s = b; s < e; s++) {
+                    const Signal::HammingTy H = (*w)[signals[s]].getHamming();
+                    const vector<unsigned> &samples = getSamples(H);
+                    for (size_t i = 0; i < samples.size(); i++) {
+                        acc.power[H.timeIdx[i]] += samples[i];
+                        acc.hasSample[H.timeIdx[i]] = true;
+                    }
+                }
+                return acc;
+            },
+            [](Accumulator lhs, Accumulator rhs) {
+                for (size_t t = 0; t < lhs.power.size(); t++) {
+                    lhs.power[t] += rhs.power[t];
+                    if (rhs.hasSample[t])
+                        lhs.hasSample[t] = true;
+                }
+                return lhs;
+            });
+    }
+
     // Check our invariant: all records should have the same number of samples.
     void check() const {
         size_t N = 0;
@@ -312,20 +382,24 @@ struct HammingVisitor : public Waveform::Visitor {
     }
 
     [[nodiscard]] bool dumpAsNPY(size_t period, size_t offset) const {
-        const size_t numCols = power.size() / period;
-        const size_t numRows = power.cbegin()->second.size();
-        NPArray<double> npy(numRows, numCols);
-
+        // The traces are streamed row by row, in input order, rather than
+        // transposed to a complete matrix in memory.
+        vector<const vector<double> *> columns;
         size_t col = 0;
         for (const auto &H : power) {
-            if (col % period == offset) {
-                for (size_t row = 0; row < numRows; row++)
-                    npy(row, col / period) = H.second[row];
-            }
+            if (col % period == offset)
+                columns.push_back(&H.second);
             col += 1;
         }
 
-        return npy.save(fileName);
+        NPYStreamWriter<double> npy(fileName, columns.size());
+        for (size_t row = 0; row < numTraces && npy.good(); row++) {
+            for (const vector<double> *c : columns)
+                npy.append((*c)[row]);
+            npy.next();
+        }
+
+        return npy.close();
     }
 };
 
@@ -335,14 +409,10 @@ struct HammingWeight : public HammingVisitor {
                   const Waveform::Visitor::Options &options)
         : HammingVisitor(fileName, options) {}
 
-    void visitSignal(const string &FullScopeName,
-                     const Waveform::SignalDesc &SD) override {
-        const SignalIdxTy idx = SD.getIdx();
-        for (const Signal::ChangeTy &Change : (*w)[idx]) {
-            const TimeTy &Time = Change.time;
-            double Val = Change.value.countOnes();
-            collect(Time, Val);
-        }
+  protected:
+    const vector<unsigned> &
+    getSamples(const Signal::HammingTy &H) const override {
+        return H.weight;
     }
 };
 
@@ -352,24 +422,10 @@ struct HammingDistance : public HammingVisitor {
                     const Waveform::Visitor::Options &options)
         : HammingVisitor(fileName, options) {}
 
-    void visitSignal(const string &FullScopeName,
-                     const Waveform::SignalDesc &SD) override {
-        const SignalIdxTy idx = SD.getIdx();
-        const Signal &S = (*w)[idx];
-        size_t NumChanges = S.getNumChanges();
-
-        if (NumChanges < 1)
-            return;
-
-        ValueTy PreviousValue = S.getValueChange(0);
-
-        for (size_t i = 0; i < NumChanges; i++) {
-            Signal::ChangeTy Change = S.getChange(i);
-            ValueTy Xor = Change.value ^ PreviousValue;
-            double Val = Xor.countOnes();
-            collect(Change.time, Val);
-            PreviousValue = Change.value;
-        }
+  protected:
+    const vector<unsigned> &
+    getSamples(const Signal::HammingTy &H) const override {
+        return H.distance;
     }
 };
 
@@ -387,17 +443,23 @@ class Analysis {
     bool create(Kind kind, const Waveform::Visitor::Options &options) {
         if (fileName.empty())
             return false;
+        this->kind = kind;
+        this->options = options;
+        HV = newVisitor();
+        return true;
+    }
+
+    /// Create a new visitor for this analysis, to process a single input.
+    [[nodiscard]] unique_ptr<HammingVisitor> newVisitor() const {
         switch (kind) {
         case Kind::HAMMING_WEIGHT:
-            HV = std::make_unique<HammingWeight>(fileName, options);
-            return true;
+            return std::make_unique<HammingWeight>(fileName, options);
         case Kind::HAMMING_DISTANCE:
-            HV = std::make_unique<HammingDistance>(fileName, options);
-            return true;
+            return std::make_unique<HammingDistance>(fileName, options);
         case Kind::NUM_ANALYSIS:
             DIE("This Kind should not be used as an analysis");
         }
-        return false;
+        return nullptr;
     }
 
     operator bool() const { return HV.get() != nullptr; }
@@ -409,6 +471,8 @@ class Analysis {
   private:
     unique_ptr<HammingVisitor> HV;
     string fileName;
+    Kind kind{NUM_ANALYSIS};
+    Waveform::Visitor::Options options;
 };
 
 class Inputs {
@@ -421,10 +485,16 @@ class Inputs {
 
         [[nodiscard]] bool hasCycleInfo() const { return cycleInfo.size(); }
 
-        [[nodiscard]] Waveform getWaveform() const {
+        /// Get the Waveform, with only the signals selected by \p options,
+        /// and only the changes relevant to \p windows. Single input files
+        /// go through their WaveCache if \p useCache is set.
+        [[nodiscard]] Waveform
+        getWaveform(const Waveform::Visitor::Options &options,
+                    const TimeWindows &windows, bool useCache) const {
             if (inputFiles.size() == 1)
-                return WaveFile::get(inputFiles[0], /* write: */ false)->read();
-            return PAF::WAN::readAndMerge(inputFiles);
+                return PAF::WAN::readWaveform(inputFiles[0], useCache,
+                                              options, windows);
+            return PAF::WAN::readAndMerge(inputFiles, options, windows);
         }
 
         operator string() const {
@@ -447,6 +517,8 @@ class Inputs {
     Inputs() {}
 
     [[nodiscard]] bool empty() const { return inputs.empty(); }
+    [[nodiscard]] size_t size() const { return inputs.size(); }
+    [[nodiscard]] const Input &operator[](size_t i) const { return inputs[i]; }
 
     [[nodiscard]] vector<Input>::const_iterator begin() const {
         return inputs.begin();
@@ -487,6 +559,8 @@ int main(int argc, char *argv[]) {
     size_t period = 1;
     size_t offset = 0;
     bool addNoise = true;
+    bool useCache = false;
+    unsigned numJobs = PAF::defaultNumThreads(1);
     Waveform::Visitor::Options visitOptions(
         false /* skipRegs */, false /* skipWires */, false /* skipIntegers */);
 
@@ -537,6 +611,16 @@ int main(int argc, char *argv[]) {
         "Filter scopes matching FILTER (use '^' to anchor the search at the "
         "start of the full scope name",
         [&](const string &Filter) { visitOptions.addScopeFilter(Filter); });
+    ap.optnoval({"--wave-cache"},
+                "Load the waveforms from a binary cache file next to each "
+                "input file, creating it when it is missing or outdated "
+                "(merged inputs are not cached)",
+                [&]() { useCache = true; });
+    ap.optval({"-j", "--jobs"}, "N",
+              "load and analyze up to N input files concurrently (default: "
+              "$PAF_NUM_THREADS, or 1; 0 uses as many threads as the hardware "
+              "supports)",
+              [&](const string &s) { numJobs = stoul(s, nullptr, 0); });
     ap.positional_multiple(
         "F[,F]*[%CYCLE_INFO]?",
         "Input file(s) in fst or vcd format to read, with an "
@@ -544,6 +628,7 @@ int main(int argc, char *argv[]) {
         "merged into a single waveform",
         [&](const string &s) { in.parse(s); });
 
+    Stats::addOptions(ap);
     ap.parse([&]() {
         if (in.empty())
             DIE("No input file name");
@@ -557,56 +642,105 @@ int main(int argc, char *argv[]) {
         if (cnt == 0)
             DIE("No analysis to perform");
     });
+    const ScopedTimer T("wan-power");
 
     if (verbose)
         in.dump(cout);
 
-    size_t duration = 0;
-    size_t numSignals = 0;
-    for (const auto &I : in) {
-        Waveform WIn = I.getWaveform();
-        RunInfo CI(I.cycleInfo);
-
-        if (verbose) {
-            cout << "Processing " << string(I) << '\n';
-            if (I.hasCycleInfo())
-                CI.dump(cout);
-        }
+    // The result of loading and analyzing a single input.
+    struct InputResult {
+        RunInfo CI;
+        size_t duration = 0;
+        bool consistentSegments = true;
+        size_t numSignals = 0;
+        vector<unique_ptr<HammingVisitor>> visitors;
+    };
 
-        // Some quick sanity checks:
-        //  - all segments from all FSTs must have the same duration.
-        //  - same number of signals in all FSTs.
-        if (duration == 0) {
-            if (CI.empty())
-                duration = WIn.getEndTime() - WIn.getStartTime();
-            else
-                duration = CI.getDuration();
-            if (verbose)
-                cout << "Simulation segment duration: " << duration << '\n';
+    // Only the segments of interest are loaded from the waveforms, and each
+    // input is analyzed with its own visitors: the waveform can then be
+    // released as soon as the input has been analyzed.
+    const auto process = [&](const Inputs::Input &I, InputResult &R) {
+        R.CI = RunInfo(I.cycleInfo);
+        Waveform WIn =
+            I.getWaveform(visitOptions, R.CI.getTimeWindows(), useCache);
+
+        if (R.CI.empty())
+            R.duration = WIn.getEndTime() - WIn.getStartTime();
+        else {
+            R.duration = R.CI.getDuration();
+            R.consistentSegments = R.CI.checkDuration(R.duration);
         }
-        if (CI.empty()) {
-            if (duration != WIn.getEndTime() - WIn.getStartTime())
-                DIE("Simulation duration in ", string(I).c_str(),
-                    " is inconsistent with the previous files");
-        } else if (!CI.checkDuration(duration))
-            DIE("Inconsistent segment simulation duration in ",
-                string(I).c_str());
-
-        if (numSignals == 0) {
-            numSignals = WIn.getNumSignals();
-            if (verbose)
-                cout << "Signals to analyze: " << WIn.getNumSignals() << '\n';
-        } else if (numSignals != WIn.getNumSignals())
-            DIE("Number of signals in ", string(I).c_str(),
-                " is inconsistent with the previous files");
-
-        // Now the real work !
-        for (auto &analysis : analyses) {
+        R.numSignals = WIn.getNumSignals();
+
+        for (const auto &analysis : analyses) {
             if (analysis) {
-                analysis->setWaveform(&WIn, &CI);
-                WIn.visit(*analysis);
-                analysis->reduce();
+                R.visitors.push_back(analysis.newVisitor());
+                HammingVisitor &HV = *R.visitors.back();
+                HV.setWaveform(&WIn, &R.CI);
+                WIn.visit(HV);
+                HV.reduce();
+                HV.setWaveform(nullptr, nullptr);
+            } else
+                R.visitors.emplace_back(nullptr);
+        }
+    };
+
+    // The inputs are processed concurrently, by groups of up to numJobs
+    // inputs so that the memory used by the waveforms remains bounded. The
+    // traces are then appended in input order, whatever the number of jobs.
+    if (numJobs == 0)
+        numJobs = PAF::hardwareNumThreads();
+    size_t duration = 0;
+    size_t numSignals = 0;
+    for (size_t first = 0; first < in.size(); first += numJobs) {
+        const size_t numInputs = std::min<size_t>(numJobs, in.size() - first);
+        vector<InputResult> results(numInputs);
+        PAF::parallelFor(
+            0, results.size(), 1,
+            [&](size_t b, size_t e) {
+                for (size_t i = b; i < e; i++)
+                    process(in[first + i], results[i]);
+            },
+            numJobs);
+
+        for (size_t i = 0; i < results.size(); i++) {
+            const Inputs::Input &I = in[first + i];
+            InputResult &R = results[i];
+
+            if (verbose) {
+                cout << "Processing " << string(I) << '\n';
+                if (I.hasCycleInfo())
+                    R.CI.dump(cout);
             }
+
+            // Some quick sanity checks:
+            //  - all segments from all FSTs must have the same duration.
+            //  - same number of signals in all FSTs.
+            if (duration == 0) {
+                duration = R.duration;
+                if (verbose)
+                    cout << "Simulation segment duration: " << duration
+                         << '\n';
+            }
+            if (R.CI.empty()) {
+                if (duration != R.duration)
+                    DIE("Simulation duration in ", string(I).c_str(),
+                        " is inconsistent with the previous files");
+            } else if (!R.consistentSegments || duration != R.duration)
+                DIE("Inconsistent segment simulation duration in ",
+                    string(I).c_str());
+
+            if (numSignals == 0) {
+                numSignals = R.numSignals;
+                if (verbose)
+                    cout << "Signals to analyze: " << numSignals << '\n';
+            } else if (numSignals != R.numSignals)
+                DIE("Number of signals in ", string(I).c_str(),
+                    " is inconsistent with the previous files");
+
+            for (size_t a = 0; a < analyses.size(); a++)
+                if (analyses[a])
+                    analyses[a]->append(std::move(*R.visitors[a]));
         }
     }
 
@@ -0,0 +1,129 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/Align.h"
+#include "PAF/SCA/NPArray.h"
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace PAF::SCA;
+
+using std::ptrdiff_t;
+using std::vector;
+
+namespace {
+// A deterministic, non periodic, signal.
+double signal(ptrdiff_t i) {
+    uint32_t x = uint32_t(i) * 2654435761U;
+    x ^= x >> 15;
+    return std::sin(0.3 * double(i)) + double(x % 1000) / 1000.0;
+}
+
+// Fill row \p r of \p traces with the signal, delayed by \p shift samples.
+void fill(NPArray<double> &traces, size_t r, ptrdiff_t shift) {
+    for (size_t c = 0; c < traces.cols(); c++)
+        traces(r, c) = signal(ptrdiff_t(c) - shift);
+}
+} // namespace
+
+TEST(Aligner, shift) {
+    constexpr size_t N = 200;
+    NPArray<double> traces(1, N);
+    fill(traces, 0, 0);
+
+    const Aligner A(&traces(0, 80), 32, 80, 10, N);
+    EXPECT_EQ(A.length(), 32);
+    EXPECT_EQ(A.samples(), N);
+    EXPECT_EQ(A.shift(&traces(0, 0)), 0);
+
+    for (ptrdiff_t s : {-10, -7, -1, 1, 3, 10}) {
+        fill(traces, 0, s);
+        EXPECT_EQ(A.shift(&traces(0, 0)), s);
+    }
+}
+
+TEST(Aligner, shifts) {
+    constexpr size_t N = 256;
+    const vector<ptrdiff_t> expected{0, 5, -3, 12, -12, 1, -1};
+    NPArray<double> traces(expected.size(), N);
+    for (size_t r = 0; r < expected.size(); r++)
+        fill(traces, r, expected[r]);
+
+    const Aligner A(&traces(0, 100), 40, 100, 12, N);
+
+    // An odd number of traces.
+    vector<ptrdiff_t> shifts;
+    A.shifts(shifts, traces, 0, traces.rows());
+    EXPECT_EQ(shifts, expected);
+
+    // A pair of traces.
+    A.shifts(shifts, traces, 3, 5);
+    EXPECT_EQ(shifts, vector<ptrdiff_t>({12, -12}));
+
+    // A single trace.
+    A.shifts(shifts, traces, 2, 3);
+    EXPECT_EQ(shifts, vector<ptrdiff_t>({-3}));
+
+    // No trace.
+    A.shifts(shifts, traces, 4, 4);
+    EXPECT_TRUE(shifts.empty());
+
+    // Scaled and offset traces have the same shifts.
+    for (size_t r = 0; r < traces.rows(); r++)
+        for (size_t c = 0; c < N; c++)
+            traces(r, c) = 3.0 * traces(r, c) - 10.0;
+    A.shifts(shifts, traces, 0, traces.rows());
+    EXPECT_EQ(shifts, expected);
+
+    // And can then be aligned.
+    for (size_t r = 0; r < traces.rows(); r++) {
+        Aligner::align(&traces(r, 0), N, shifts[r]);
+        EXPECT_EQ(A.shift(&traces(r, 0)), 0);
+    }
+}
+
+TEST(Aligner, align) {
+    const vector<double> v{0.0, 1.0, 2.0, 3.0, 4.0, 5.0};
+
+    vector<double> r = v;
+    Aligner::align(r.data(), r.size(), 0);
+    EXPECT_EQ(r, v);
+
+    r = v;
+    Aligner::align(r.data(), r.size(), 2);
+    EXPECT_EQ(r, vector<double>({2.0, 3.0, 4.0, 5.0, 5.0, 5.0}));
+
+    r = v;
+    Aligner::align(r.data(), r.size(), -2);
+    EXPECT_EQ(r, vector<double>({0.0, 0.0, 0.0, 1.0, 2.0, 3.0}));
+
+    r = v;
+    Aligner::align(r.data(), r.size(), 10);
+    EXPECT_EQ(r, vector<double>(v.size(), 5.0));
+
+    r = v;
+    Aligner::align(r.data(), r.size(), -10);
+    EXPECT_EQ(r, vector<double>(v.size(), 0.0));
+}
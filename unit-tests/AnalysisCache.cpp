@@ -0,0 +1,138 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/AnalysisCache.h"
+#include "PAF/PAF.h"
+#include "paf-unit-testing.h"
+
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace testing;
+
+using std::string;
+using std::vector;
+
+using PAF::AnalysisCache;
+using PAF::ExecutionRange;
+
+namespace {
+void expectEq(const TarmacSite &lhs, const TarmacSite &rhs) {
+    EXPECT_EQ(lhs.addr, rhs.addr);
+    EXPECT_EQ(lhs.time, rhs.time);
+    EXPECT_EQ(lhs.tarmac_line, rhs.tarmac_line);
+    EXPECT_EQ(lhs.tarmac_pos, rhs.tarmac_pos);
+}
+} // namespace
+
+TEST_WITH_TEMP_FILES(AnalysisCacheF, "test-AnalysisCache.XXXXXX", 2);
+
+TEST_F(AnalysisCacheF, base) {
+    const string &filename = getTemporaryFilename(0);
+    const vector<ExecutionRange> ranges = {
+        {TarmacSite(0x8000, 12, 34, 567), TarmacSite(0x8010, 20, 50, 890)},
+        {TarmacSite(0x8100, 42, 84, 1234), TarmacSite(0x8110, 43, 86, 1300)},
+    };
+
+    {
+        AnalysisCache AC(filename, 0x1234);
+        EXPECT_TRUE(AC.good());
+        EXPECT_EQ(AC.getFilename(), filename);
+        EXPECT_EQ(AC.size(), 0);
+        EXPECT_EQ(AC.lookup("instances foo"), nullptr);
+
+        AC.insert("instances foo", {ranges, {}});
+        AC.insert("wlabels 2 start end", {{ranges[1]}, {{42, "start 1"}}});
+        AC.insert("instances none", {});
+        EXPECT_EQ(AC.size(), 3);
+        ASSERT_NE(AC.lookup("instances foo"), nullptr);
+        EXPECT_EQ(AC.lookup("instances foo")->ranges.size(), 2);
+        EXPECT_TRUE(AC.save());
+    }
+
+    // Reload it.
+    {
+        AnalysisCache AC(filename, 0x1234);
+        EXPECT_TRUE(AC.good());
+        EXPECT_EQ(AC.size(), 3);
+
+        const AnalysisCache::Entry *E = AC.lookup("instances foo");
+        ASSERT_NE(E, nullptr);
+        ASSERT_EQ(E->ranges.size(), 2);
+        for (size_t i = 0; i < ranges.size(); i++) {
+            expectEq(E->ranges[i].begin, ranges[i].begin);
+            expectEq(E->ranges[i].end, ranges[i].end);
+        }
+        EXPECT_TRUE(E->labels.empty());
+
+        E = AC.lookup("wlabels 2 start end");
+        ASSERT_NE(E, nullptr);
+        ASSERT_EQ(E->ranges.size(), 1);
+        expectEq(E->ranges[0].begin, ranges[1].begin);
+        ASSERT_EQ(E->labels.size(), 1);
+        EXPECT_EQ(E->labels[0].first, 42);
+        EXPECT_EQ(E->labels[0].second, "start 1");
+
+        E = AC.lookup("instances none");
+        ASSERT_NE(E, nullptr);
+        EXPECT_TRUE(E->ranges.empty());
+    }
+
+    // A cache saved for another key is discarded.
+    {
+        AnalysisCache AC(filename, 0x4321);
+        EXPECT_TRUE(AC.good());
+        EXPECT_EQ(AC.size(), 0);
+    }
+}
+
+TEST_F(AnalysisCacheF, errors) {
+    const string &filename = getTemporaryFilename(0);
+    std::ofstream(filename) << "PAF-ANALYSIS-CACHE 1 1234\nQ instances foo\n"
+                            << "R 2\nr 1 2 3 4 5 6 7 8\n";
+    AnalysisCache AC(filename, 0x1234);
+    EXPECT_FALSE(AC.good());
+    EXPECT_NE(AC.error(), nullptr);
+    EXPECT_EQ(AC.size(), 0);
+}
+
+TEST_F(AnalysisCacheF, getKey) {
+    const string &trace = getTemporaryFilename(1);
+    std::ofstream(trace) << "0 clk IT (0) 00008000 e3a00000 A svc_s : MOV "
+                            "r0,#0\n";
+    const uint64_t key = AnalysisCache::getKey(trace, "");
+    EXPECT_EQ(AnalysisCache::getKey(trace, ""), key);
+    EXPECT_NE(AnalysisCache::getKey(trace, trace), key);
+
+    std::ofstream(trace, std::ofstream::app)
+        << "1 clk IT (1) 00008004 e3a01000 A svc_s : MOV r1,#0\n";
+    EXPECT_NE(AnalysisCache::getKey(trace, ""), key);
+
+    TracePair TP;
+    TP.tarmac_filename = "trace.tarmac";
+    TP.index_filename = "trace.index";
+    TP.index_on_disk = true;
+    EXPECT_EQ(AnalysisCache::getCacheFilename(TP), "trace.index.paf-cache");
+    TP.index_on_disk = false;
+    EXPECT_EQ(AnalysisCache::getCacheFilename(TP), "trace.tarmac.paf-cache");
+}
@@ -32,6 +32,7 @@ using namespace testing;
 
 using PAF::AddressingMode;
 using PAF::InstrInfo;
+using PAF::InstrInfoCache;
 using PAF::ReferenceInstruction;
 using PAF::RegisterAccess;
 using PAF::V7MInfo;
@@ -90,6 +91,10 @@ TEST(V7MCPUInfo, isStatusRegister) {
     unique_ptr<V7MInfo> CPU(new V7MInfo);
     for (size_t i = 0; i < regs.size(); i++)
         EXPECT_EQ(CPU->isStatusRegister(regs[i]), i < 2);
+
+    for (unsigned r = 0; r < CPU->numRegisters(); r++)
+        EXPECT_EQ(CPU->isStatusRegister(r),
+                  CPU->isStatusRegister(CPU->registerName(r)));
 }
 
 TEST(V7MCPUInfo, getNOP) {
@@ -169,6 +174,7 @@ TEST(V7MCPUInfo, getCycles) {
 TEST(V7MCPUInfo, registers) {
     unique_ptr<V7MInfo> CPU(new V7MInfo);
     EXPECT_EQ(CPU->numRegisters(), unsigned(V7MInfo::Register::NUM_REGISTERS));
+    EXPECT_EQ(CPU->registerSize(), 4);
 
     EXPECT_STREQ(V7MInfo::name(V7MInfo::Register::R0), "r0");
     EXPECT_STREQ(V7MInfo::name(V7MInfo::Register::R1), "r1");
@@ -226,6 +232,16 @@ TEST(V7MCPUInfo, registers) {
     EXPECT_EQ(CPU->registerId("pc"), unsigned(V7MInfo::Register::PC));
     EXPECT_EQ(CPU->registerId("cPsr"), unsigned(V7MInfo::Register::CPSR));
     EXPECT_EQ(CPU->registerId("psR"), unsigned(V7MInfo::Register::PSR));
+
+    for (unsigned r = 0; r < CPU->numRegisters(); r++)
+        EXPECT_EQ(CPU->findRegisterId(CPU->registerName(r)), r);
+    EXPECT_EQ(CPU->findRegisterId("lr"), unsigned(V7MInfo::Register::LR));
+    EXPECT_EQ(CPU->findRegisterId("r13"), unsigned(V7MInfo::Register::MSP));
+    // Registers which are not part of the register bank are not an error.
+    EXPECT_EQ(CPU->findRegisterId("r"), RegisterAccess::UNKNOWN_ID);
+    EXPECT_EQ(CPU->findRegisterId("r16"), RegisterAccess::UNKNOWN_ID);
+    EXPECT_EQ(CPU->findRegisterId("s0"), RegisterAccess::UNKNOWN_ID);
+    EXPECT_EQ(CPU->findRegisterId("whatever"), RegisterAccess::UNKNOWN_ID);
 }
 
 // Helper to test InstrInfo.
@@ -1513,6 +1529,12 @@ TEST(V8ACPUInfo, isStatusRegister) {
         EXPECT_EQ(CPU->isStatusRegister(regs[i]), i < 6);
 }
 
+TEST(V8ACPUInfo, findRegisterId) {
+    unique_ptr<V8AInfo> CPU(new V8AInfo);
+    EXPECT_EQ(CPU->findRegisterId("x0"), RegisterAccess::UNKNOWN_ID);
+    EXPECT_EQ(CPU->findRegisterId("cpsr"), RegisterAccess::UNKNOWN_ID);
+}
+
 TEST(V8ACPUInfo, getNOP) {
     unique_ptr<V8AInfo> CPU(new V8AInfo);
     EXPECT_EQ(CPU->getNOP(32), 0xD503401F);
@@ -1535,4 +1557,65 @@ TEST(V8MCPUInfo, getCycles) {
 TEST(V8ACPUInfo, registers) {
     unique_ptr<V8AInfo> CPU(new V8AInfo);
     EXPECT_EQ(CPU->numRegisters(), unsigned(V8AInfo::Register::NUM_REGISTERS));
+    EXPECT_EQ(CPU->registerSize(), 8);
+}
+
+// ===================================================================
+// InstrInfo cache tests
+// -------------------------------------------------------------------
+TEST(InstrInfoCache, base) {
+    V7MInfo CPU;
+    const auto check = [&](InstrInfoCache &IIC, const ReferenceInstruction &I) {
+        const InstrInfo II = CPU.getInstrInfo(I);
+        const InstrInfo &C = IIC.get(I);
+        EXPECT_EQ(C.getKind(), II.getKind());
+        EXPECT_EQ(C.getInputRegisters(false), II.getInputRegisters(false));
+        EXPECT_EQ(C.getInputRegisters(true), II.getInputRegisters(true));
+        if (II.isMemoryAccess())
+            EXPECT_EQ(C.getAddressingMode(), II.getAddressingMode());
+    };
+
+    const array<ReferenceInstruction, 5> instrs{{
+        // clang-format off
+        {0, IE_EXECUTED, 0x1000, THUMB, 16, 0x2105, "movs r1,#5", {}, {}},
+        {1, IE_EXECUTED, 0x1002, THUMB, 16, 0x4408, "add r0,r1", {}, {}},
+        {2, IE_EXECUTED, 0x1004, THUMB, 16, 0x6808, "ldr r0,[r1,#0]", {}, {}},
+        {3, IE_EXECUTED, 0x1006, THUMB, 16, 0x6008, "str r0,[r1,#0]", {}, {}},
+        {4, IE_EXECUTED, 0x1008, THUMB, 32, 0xf8db0800, "ldr.w r0,[r11,#2048]", {}, {}},
+        // clang-format on
+    }};
+
+    InstrInfoCache IIC(CPU);
+    EXPECT_EQ(&IIC.getArchInfo(), &CPU);
+    EXPECT_EQ(IIC.size(), 0);
+    for (const auto &I : instrs)
+        check(IIC, I);
+    EXPECT_EQ(IIC.size(), instrs.size());
+
+    // The cache only depends on the instruction set, width and encoding.
+    ReferenceInstruction I(instrs[2]);
+    I.pc = 0x2000;
+    I.time = 1000;
+    check(IIC, I);
+    EXPECT_EQ(IIC.size(), instrs.size());
+
+    IIC.clear();
+    EXPECT_EQ(IIC.size(), 0);
+    check(IIC, instrs[4]);
+    EXPECT_EQ(IIC.size(), 1);
+}
+
+TEST(InstrInfoCache, grow) {
+    V7MInfo CPU;
+    // Start with a small cache so that it has to grow.
+    InstrInfoCache IIC(CPU, 4);
+    for (unsigned round = 0; round < 2; round++)
+        for (uint32_t imm = 0; imm < 256; imm++) {
+            const ReferenceInstruction I(imm, IE_EXECUTED, 0x1000, THUMB, 16,
+                                         0x2100 | imm, "movs r1,#imm", {}, {});
+            const InstrInfo &II = IIC.get(I);
+            EXPECT_TRUE(II.hasNoKind());
+            EXPECT_TRUE(II.getInputRegisters(false).empty());
+        }
+    EXPECT_EQ(IIC.size(), 256);
 }
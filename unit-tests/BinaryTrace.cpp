@@ -0,0 +1,285 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/BinaryTrace.h"
+#include "PAF/PAF.h"
+#include "PAF/SCA/Dumper.h"
+#include "PAF/SCA/Power.h"
+#include "libtarmac/parser.hh"
+#include "paf-unit-testing.h"
+
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace testing;
+
+using std::string;
+using std::vector;
+
+using PAF::MemoryAccess;
+using PAF::ReferenceInstruction;
+using PAF::RegisterAccess;
+using PAF::SCA::BinaryInstrDumper;
+using PAF::SCA::BinaryInstrReader;
+using PAF::SCA::BinaryMemoryAccessesDumper;
+using PAF::SCA::BinaryMemoryAccessesReader;
+using PAF::SCA::BinaryRegBankDumper;
+using PAF::SCA::BinaryRegBankReader;
+using PAF::SCA::BinaryTimingInfo;
+using PAF::SCA::BinaryTimingReader;
+
+namespace {
+// Get the first 2 bytes of file \p filename.
+string magic(const string &filename) {
+    std::ifstream ifs(filename, std::ifstream::binary);
+    string m(2, '\0');
+    ifs.read(&m[0], m.size());
+    return m;
+}
+} // namespace
+
+// Create the test fixture for the binary traces.
+TEST_WITH_TEMP_FILE(BinaryTraceF, "test-BinaryTrace.bin.XXXXXX");
+
+TEST_F(BinaryTraceF, timing) {
+    for (bool compressed : {false, true}) {
+        BinaryTimingInfo TI(compressed);
+        TI.add(123, 2);
+        TI.add(124, 1);
+        TI.add(125, 1);
+        TI.incr(4);
+        TI.nextTrace();
+        TI.add(123, 2);
+        TI.nextTrace();
+        TI.saveToFile(getTemporaryFilename());
+
+        EXPECT_EQ(magic(getTemporaryFilename()) == "\x1f\x8b", compressed);
+
+        BinaryTimingReader TR(getTemporaryFilename());
+        EXPECT_TRUE(TR.good());
+        EXPECT_EQ(TR.min(), 2);
+        EXPECT_EQ(TR.max(), 8);
+        ASSERT_EQ(TR.size(), 3);
+        EXPECT_EQ(TR[0].first, 123);
+        EXPECT_EQ(TR[0].second, 0);
+        EXPECT_EQ(TR[1].first, 124);
+        EXPECT_EQ(TR[1].second, 2);
+        EXPECT_EQ(TR[2].first, 125);
+        EXPECT_EQ(TR[2].second, 3);
+
+        EXPECT_EQ(TR.instructionAt(0), 0);
+        EXPECT_EQ(TR.instructionAt(1), 0);
+        EXPECT_EQ(TR.instructionAt(2), 1);
+        EXPECT_EQ(TR.instructionAt(3), 2);
+        EXPECT_EQ(TR.instructionAt(100), 2);
+    }
+}
+
+TEST_F(BinaryTraceF, memoryAccesses) {
+    for (bool compressed : {false, true}) {
+        {
+            BinaryMemoryAccessesDumper MA(getTemporaryFilename(), compressed);
+            EXPECT_TRUE(MA.enabled());
+            MA.dump(0x1000, {});
+            MA.dump(0x1234,
+                    {MemoryAccess(4, 0x21f5c, 0x3, MemoryAccess::Type::READ),
+                     MemoryAccess(2, 0xabcde, 0x1234,
+                                  MemoryAccess::Type::WRITE)});
+            MA.nextTrace();
+            MA.dump(0x2345, {MemoryAccess(1, 0xabcdc, 0x56,
+                                          MemoryAccess::Type::WRITE)});
+            // Traces are started lazily, so no empty trace should be emitted.
+            MA.nextTrace();
+        }
+
+        BinaryMemoryAccessesReader R(getTemporaryFilename());
+        EXPECT_TRUE(R.good());
+        vector<BinaryMemoryAccessesReader::Entry> E;
+
+        EXPECT_TRUE(R.nextTrace(E));
+        ASSERT_EQ(E.size(), 1);
+        EXPECT_EQ(E[0].index, 1);
+        EXPECT_EQ(E[0].pc, 0x1234);
+        ASSERT_EQ(E[0].accesses.size(), 2);
+        EXPECT_EQ(E[0].accesses[0],
+                  MemoryAccess(4, 0x21f5c, 0x3, MemoryAccess::Type::READ));
+        EXPECT_EQ(E[0].accesses[0].value, 0x3);
+        EXPECT_EQ(E[0].accesses[1],
+                  MemoryAccess(2, 0xabcde, 0x1234, MemoryAccess::Type::WRITE));
+        EXPECT_EQ(E[0].accesses[1].value, 0x1234);
+
+        EXPECT_TRUE(R.nextTrace(E));
+        ASSERT_EQ(E.size(), 1);
+        EXPECT_EQ(E[0].index, 0);
+        EXPECT_EQ(E[0].pc, 0x2345);
+        ASSERT_EQ(E[0].accesses.size(), 1);
+        EXPECT_EQ(E[0].accesses[0],
+                  MemoryAccess(1, 0xabcdc, 0x56, MemoryAccess::Type::WRITE));
+
+        EXPECT_FALSE(R.nextTrace(E));
+        EXPECT_TRUE(E.empty());
+        EXPECT_TRUE(R.good());
+    }
+}
+
+TEST_F(BinaryTraceF, instructions) {
+    const ReferenceInstruction I[3] = {
+        // clang-format off
+        {
+            28, IE_EXECUTED, 0x08326, ARM, 32, 0xf8db0800, "ldr.w      r0,[r11,#2048]",
+            {
+                MemoryAccess(4, 0xf939b40, 0xdeadbeef, MemoryAccess::Type::READ)
+            },
+            {
+                RegisterAccess("r0", 0xdeadbeef, RegisterAccess::Type::WRITE),
+                RegisterAccess("r11", 0xf939340, RegisterAccess::Type::READ)
+            }
+        },
+        {
+            29, IE_CCFAIL, 0x0832a, THUMB, 16, 0x4408, "add      r0,r1",
+            {},
+            {}
+        },
+        {
+            30, IE_EXECUTED, 0x0832c, THUMB, 16, 0x4408, "",
+            {},
+            {}
+        },
+        // clang-format on
+    };
+    const vector<uint64_t> regs[3] = {
+        {0, 1, 2, 3, 4}, {5, 6, 7, 8, 9}, {10, 11, 12, 13, 14}};
+
+    for (bool compressed : {false, true}) {
+        {
+            BinaryInstrDumper ID(getTemporaryFilename(), compressed, true,
+                                 true);
+            EXPECT_TRUE(ID.enabled());
+            ID.dump(I[0], regs[0]);
+            ID.dump(I[1], regs[1]);
+            ID.nextTrace();
+            ID.dump(I[1], regs[1]);
+            ID.dump(I[2], regs[2]);
+            ID.dump(I[0]);
+        }
+
+        BinaryInstrReader R(getTemporaryFilename());
+        EXPECT_TRUE(R.good());
+        vector<ReferenceInstruction> instrs;
+        vector<vector<uint64_t>> regBanks;
+
+        EXPECT_TRUE(R.nextTrace(instrs, &regBanks));
+        ASSERT_EQ(instrs.size(), 2);
+        ASSERT_EQ(regBanks.size(), 2);
+        for (size_t i = 0; i < 2; i++) {
+            EXPECT_EQ(instrs[i].time, I[i].time);
+            EXPECT_EQ(instrs[i].effect, I[i].effect);
+            EXPECT_EQ(instrs[i].pc, I[i].pc);
+            EXPECT_EQ(instrs[i].iset, I[i].iset);
+            EXPECT_EQ(instrs[i].width, I[i].width);
+            EXPECT_EQ(instrs[i].instruction, I[i].instruction);
+            EXPECT_EQ(instrs[i].disassembly, I[i].disassembly);
+            EXPECT_EQ(instrs[i].memAccess, I[i].memAccess);
+            EXPECT_TRUE(instrs[i].regAccess.empty());
+            EXPECT_EQ(regBanks[i], regs[i]);
+        }
+        EXPECT_EQ(instrs[0].memAccess[0].value, 0xdeadbeef);
+
+        // Check the register bank states are optional.
+        EXPECT_TRUE(R.nextTrace(instrs));
+        ASSERT_EQ(instrs.size(), 3);
+        EXPECT_EQ(instrs[0].disassembly, "add r0,r1");
+        EXPECT_EQ(instrs[1].disassembly, "");
+        EXPECT_EQ(instrs[2].disassembly, "ldr.w r0,[r11,#2048]");
+        EXPECT_EQ(instrs[2].memAccess, I[0].memAccess);
+
+        EXPECT_FALSE(R.nextTrace(instrs));
+        EXPECT_TRUE(R.good());
+    }
+}
+
+TEST_F(BinaryTraceF, registerBank) {
+    const vector<vector<uint64_t>> T0 = {
+        {0, 0, 0, 0, 0},
+        {0, 0, 0, 0, 0},
+        {1, 0, 0, 0, 0},
+        {1, 2, 3, 4, 5},
+        {6, 2, 3, 4, 7},
+    };
+    const vector<vector<uint64_t>> T1 = {{8, 9, 10, 11, 12}};
+
+    for (bool compressed : {false, true}) {
+        {
+            BinaryRegBankDumper RB(getTemporaryFilename(), compressed);
+            EXPECT_TRUE(RB.enabled());
+            for (const auto &regs : T0)
+                RB.dump(regs);
+            RB.nextTrace();
+            for (const auto &regs : T1)
+                RB.dump(regs);
+            RB.nextTrace();
+        }
+
+        BinaryRegBankReader R(getTemporaryFilename());
+        EXPECT_TRUE(R.good());
+        vector<vector<uint64_t>> states;
+        EXPECT_TRUE(R.nextTrace(states));
+        EXPECT_EQ(states, T0);
+        EXPECT_TRUE(R.nextTrace(states));
+        EXPECT_EQ(states, T1);
+        EXPECT_FALSE(R.nextTrace(states));
+        EXPECT_TRUE(R.good());
+    }
+
+    // Only the changed registers are recorded, with up to 3 registers per
+    // record: T0 needs 2 + 1 + 1 + 2 + 1 records, after the header and the
+    // trace records.
+    {
+        BinaryRegBankDumper RB(getTemporaryFilename(), false);
+        for (const auto &regs : T0)
+            RB.dump(regs);
+    }
+    std::ifstream ifs(getTemporaryFilename(),
+                      std::ifstream::binary | std::ifstream::ate);
+    EXPECT_EQ(size_t(ifs.tellg()), 9 * sizeof(PAF::SCA::BinaryTraceRecord));
+}
+
+TEST_F(BinaryTraceF, errors) {
+    BinaryTimingReader TR("non-existent-file.bin");
+    EXPECT_FALSE(TR.good());
+    EXPECT_NE(TR.error(), nullptr);
+
+    BinaryTimingInfo TI(false);
+    TI.add(123, 2);
+    TI.nextTrace();
+    TI.saveToFile(getTemporaryFilename());
+
+    BinaryInstrReader IR(getTemporaryFilename());
+    EXPECT_FALSE(IR.good());
+    vector<ReferenceInstruction> instrs;
+    EXPECT_FALSE(IR.nextTrace(instrs));
+
+    std::ofstream(getTemporaryFilename()) << "instr:\n";
+    BinaryMemoryAccessesReader MR(getTemporaryFilename());
+    EXPECT_FALSE(MR.good());
+}
@@ -0,0 +1,326 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/FI/CampaignFile.h"
+#include "PAF/FI/Fault.h"
+#include "PAF/FI/Results.h"
+
+#include "paf-unit-testing.h"
+
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+using PAF::FI::BinaryCampaignReader;
+using PAF::FI::CampaignResults;
+using PAF::FI::CorruptRegDef;
+using PAF::FI::FaultModelBase;
+using PAF::FI::InjectionCampaign;
+using PAF::FI::InjectionRangeInfo;
+using PAF::FI::InstructionSkip;
+
+namespace {
+using Shard = InjectionCampaign::Shard;
+using ShardBy = InjectionCampaign::ShardBy;
+
+// Build a campaign with 2 injection ranges: 3 faults in the first one, 5 in
+// the second one.
+void fill(InjectionCampaign &IC, bool skip) {
+    IC.addInjectionRangeInfo(
+        InjectionRangeInfo("f1@0", 10, 20, 0x8000, 0x8010));
+    IC.addInjectionRangeInfo(
+        InjectionRangeInfo("f2@0", 30, 40, 0x8100, 0x8110));
+    for (unsigned i = 0; i < 8; i++) {
+        const unsigned long time = i < 3 ? 10 + i : 30 + i;
+        FaultModelBase *F;
+        if (skip)
+            F = new InstructionSkip(time, 0x8000 + 2 * i, 0x2000 + i, 0xbf00,
+                                    16, i != 4, "MOVS r0,#" +
+                                                    std::to_string(i % 2));
+        else
+            F = new CorruptRegDef(time, 0x8000 + 2 * i, 0x2000 + i, 16,
+                                  "MOVS r" + std::to_string(i % 3) + ",#1",
+                                  "r" + std::to_string(i % 3));
+        if (i != 6)
+            F->setBreakpoint(0x8002 + 2 * i, i / 2);
+        if (i == 5)
+            F->setWeight(7);
+        if (i == 3)
+            F->setEffect(FaultModelBase::Effect::CRASH);
+        IC.addFault(F);
+    }
+}
+
+string dump(const InjectionCampaign &IC, const Shard &S) {
+    std::ostringstream os;
+    IC.dumpCampaign(os, S);
+    return os.str();
+}
+
+string dump(const vector<unique_ptr<FaultModelBase>> &faults) {
+    std::ostringstream os;
+    for (const auto &F : faults) {
+        os << "  - ";
+        F->dump(os);
+        os << '\n';
+    }
+    return os.str();
+}
+} // namespace
+
+TEST(CampaignFile, shards) {
+    EXPECT_TRUE(InjectionCampaign::getShards(10, 0).empty());
+    EXPECT_EQ(InjectionCampaign::getShards(10, 1), vector<Shard>({{0, 10}}));
+    EXPECT_EQ(InjectionCampaign::getShards(10, 3),
+              vector<Shard>({{0, 4}, {4, 7}, {7, 10}}));
+    EXPECT_EQ(InjectionCampaign::getShards(2, 3),
+              vector<Shard>({{0, 1}, {1, 2}, {2, 2}}));
+
+    // Only cut at the allowed places.
+    const vector<size_t> cuts{2, 8};
+    EXPECT_EQ(InjectionCampaign::getShards(10, 2, &cuts),
+              vector<Shard>({{0, 2}, {2, 10}}));
+    EXPECT_EQ(InjectionCampaign::getShards(10, 3, &cuts),
+              vector<Shard>({{0, 2}, {2, 8}, {8, 10}}));
+    EXPECT_EQ(InjectionCampaign::getShards(10, 4, &cuts),
+              vector<Shard>({{0, 2}, {2, 8}, {8, 8}, {8, 10}}));
+
+    InjectionCampaign IC("image.elf", "trace.tarmac", 1000, 0x8000, 0x9000);
+    fill(IC, true);
+    EXPECT_EQ(IC.size(), 8);
+    EXPECT_EQ(IC.getInjectionRange(2), 0);
+    EXPECT_EQ(IC.getInjectionRange(3), 1);
+    EXPECT_EQ(IC.getInjectionRangeCuts(), vector<size_t>({3}));
+    EXPECT_EQ(IC.getShards(2), vector<Shard>({{0, 4}, {4, 8}}));
+    EXPECT_EQ(IC.getShards(2, ShardBy::INJECTION_RANGE),
+              vector<Shard>({{0, 3}, {3, 8}}));
+    EXPECT_EQ(IC.getShards(3, ShardBy::INJECTION_RANGE),
+              vector<Shard>({{0, 3}, {3, 8}, {8, 8}}));
+
+    // The faults keep their Id in a shard.
+    std::ostringstream os;
+    IC.dump(os, {6, 7});
+    EXPECT_NE(os.str().find("Campaign:\n  - { Id: 6, Time: 36"), string::npos);
+    EXPECT_EQ(os.str().find("Id: 5"), string::npos);
+    EXPECT_EQ(os.str().find("Id: 7"), string::npos);
+}
+
+TEST_WITH_TEMP_FILE(CampaignFileF, "test-CampaignFile.bin.XXXXXX");
+
+TEST_F(CampaignFileF, InstructionSkip) {
+    InjectionCampaign IC("image.elf", "trace.tarmac", 1000, 0x8000, 0x9000);
+    fill(IC, true);
+    ASSERT_TRUE(IC.dumpToFile(getTemporaryFilename(),
+                              InjectionCampaign::Format::BINARY, IC.all()));
+    EXPECT_TRUE(BinaryCampaignReader::isBinaryCampaign(getTemporaryFilename()));
+
+    BinaryCampaignReader BCR(getTemporaryFilename());
+    ASSERT_TRUE(BCR.good()) << BCR.error();
+    EXPECT_EQ(BCR.size(), 8);
+    EXPECT_STREQ(BCR.getFaultModelName(), "InstructionSkip");
+    std::ostringstream header;
+    IC.dumpHeader(header);
+    EXPECT_EQ(BCR.getMetadata(), header.str());
+    EXPECT_EQ(BCR.getShards(2, ShardBy::INJECTION_RANGE),
+              IC.getShards(2, ShardBy::INJECTION_RANGE));
+    EXPECT_EQ(BCR.getShards(3), IC.getShards(3));
+
+    vector<unique_ptr<FaultModelBase>> faults;
+    ASSERT_TRUE(BCR.read(BCR.getShards(1)[0], faults));
+    EXPECT_EQ(dump(faults), dump(IC, IC.all()));
+    EXPECT_NE(dump(faults).find("Weight: 7"), string::npos);
+    EXPECT_NE(dump(faults).find("Effect: \"crash\""), string::npos);
+    EXPECT_NE(dump(faults).find("Executed: false"), string::npos);
+
+    // Random access, and shards.
+    unique_ptr<FaultModelBase> F = BCR.read(6);
+    ASSERT_TRUE(F);
+    EXPECT_EQ(F->getId(), 6);
+    EXPECT_FALSE(F->hasBreakpoint());
+    faults.clear();
+    ASSERT_TRUE(BCR.read({3, 8}, faults));
+    EXPECT_EQ(dump(faults), dump(IC, {3, 8}));
+
+    // Out of bounds.
+    EXPECT_FALSE(BCR.read(8));
+    EXPECT_FALSE(BCR.good());
+}
+
+TEST_F(CampaignFileF, CorruptRegDef) {
+    InjectionCampaign IC("image.elf", "trace.tarmac", 1000, 0x8000, 0x9000);
+    fill(IC, false);
+
+    // Save a shard only.
+    ASSERT_TRUE(IC.dumpToFile(getTemporaryFilename(),
+                              InjectionCampaign::Format::BINARY, {2, 6}));
+    BinaryCampaignReader BCR(getTemporaryFilename());
+    ASSERT_TRUE(BCR.good()) << BCR.error();
+    EXPECT_EQ(BCR.size(), 4);
+    EXPECT_STREQ(BCR.getFaultModelName(), "CorruptRegDef");
+    EXPECT_EQ(BCR.getShards(2, ShardBy::INJECTION_RANGE),
+              vector<Shard>({{0, 1}, {1, 4}}));
+
+    vector<unique_ptr<FaultModelBase>> faults;
+    ASSERT_TRUE(BCR.read({0, 4}, faults));
+    EXPECT_EQ(dump(faults), dump(IC, {2, 6}));
+    EXPECT_EQ(faults[0]->getId(), 2);
+    const auto *CRD = dynamic_cast<const CorruptRegDef *>(faults[1].get());
+    ASSERT_NE(CRD, nullptr);
+    EXPECT_EQ(CRD->getFaultedReg(), "R0");
+}
+
+TEST_F(CampaignFileF, CorruptRegDefFamilies) {
+    using Pattern = CorruptRegDef::Pattern;
+    InjectionCampaign IC("image.elf", "trace.tarmac", 1000, 0x8000, 0x9000);
+    IC.addInjectionRangeInfo(
+        InjectionRangeInfo("f1@0", 10, 20, 0x8000, 0x8010));
+    IC.addInjectionRangeInfo(
+        InjectionRangeInfo("f2@0", 30, 40, 0x8100, 0x8110));
+    auto *F = new CorruptRegDef(10, 0x8000, 0x2001, 16, "MOVS r1,#1", "r1");
+    F->setBreakpoint(0x8002, 0);
+    F->setPattern(Pattern::BYTE_RESET, 32);
+    IC.addFault(F);
+    F = new CorruptRegDef(31, 0x8102, 0x2201, 16, "MOVS r2,#1", "r2");
+    F->setBreakpoint(0x8104, 0);
+    F->setPattern(Pattern::RANDOM_BITS, 32, 2, 3);
+    IC.addFault(F);
+
+    // The families are expanded, with one Id per variant.
+    EXPECT_EQ(IC.size(), 7);
+    EXPECT_EQ(IC.getInjectionRange(3), 0);
+    EXPECT_EQ(IC.getInjectionRange(4), 1);
+    EXPECT_EQ(IC.getInjectionRangeCuts(), vector<size_t>({4}));
+    EXPECT_EQ(IC.getShards(2, ShardBy::INJECTION_RANGE),
+              vector<Shard>({{0, 4}, {4, 7}}));
+    EXPECT_EQ(IC.getFault(5).getId(), 4);
+    const string yaml = dump(IC, {2, 5});
+    EXPECT_NE(yaml.find("{ Id: 2, Time: 10, "), string::npos);
+    EXPECT_NE(yaml.find("Variant: 2, AndMask: 0xff00ffff, XorMask: 0x0}"),
+              string::npos);
+    EXPECT_NE(yaml.find("{ Id: 4, Time: 31, "), string::npos);
+    EXPECT_EQ(yaml.find("Id: 5"), string::npos);
+
+    ASSERT_TRUE(IC.dumpToFile(getTemporaryFilename(),
+                              InjectionCampaign::Format::BINARY, IC.all()));
+    BinaryCampaignReader BCR(getTemporaryFilename());
+    ASSERT_TRUE(BCR.good()) << BCR.error();
+    EXPECT_EQ(BCR.size(), 7);
+    EXPECT_EQ(BCR.getShards(2, ShardBy::INJECTION_RANGE),
+              IC.getShards(2, ShardBy::INJECTION_RANGE));
+    vector<unique_ptr<FaultModelBase>> faults;
+    ASSERT_TRUE(BCR.read(BCR.getShards(1)[0], faults));
+    EXPECT_EQ(dump(faults), dump(IC, IC.all()));
+    const auto *CRD = dynamic_cast<const CorruptRegDef *>(faults[6].get());
+    ASSERT_NE(CRD, nullptr);
+    EXPECT_EQ(CRD->getNumVariants(), 1);
+    EXPECT_EQ(CRD->getVariant(0), 2);
+    EXPECT_EQ(CRD->getNumBits(), 2);
+}
+
+TEST_F(CampaignFileF, keys) {
+    using Effect = FaultModelBase::Effect;
+    InjectionCampaign IC("image.elf", "trace.tarmac", 1000, 0x8000, 0x9000);
+    fill(IC, true);
+    // Campaigns without keys have no results to reuse.
+    ASSERT_TRUE(IC.dumpToFile(getTemporaryFilename(),
+                              InjectionCampaign::Format::BINARY, IC.all()));
+    CampaignResults NoKeys(getTemporaryFilename());
+    ASSERT_TRUE(NoKeys.good()) << NoKeys.error();
+    EXPECT_EQ(NoKeys.size(), 0);
+
+    InjectionCampaign Keyed("image.elf", "trace.tarmac", 1000, 0x8000, 0x9000);
+    for (unsigned i = 0; i < 4; i++) {
+        auto *F = new InstructionSkip(10 + i, 0x8000 + 2 * i, 0x2000 + i,
+                                      0xbf00, 16, true, "MOVS r0,#1");
+        F->setBreakpoint(0x8000 + 2 * i, 0);
+        // Fault 3 has no key, and fault 2 shares fault 1's key, but not its
+        // effect.
+        if (i != 3)
+            F->setKey(i == 2 ? 0x200 : 0x100 * (i + 1));
+        F->setEffect(i == 2 ? Effect::CRASH : Effect::SUCCESS);
+        Keyed.addFault(F);
+    }
+    auto *F = new InstructionSkip(20, 0x8010, 0x2004, 0xbf00, 16, true,
+                                  "MOVS r0,#1");
+    F->setBreakpoint(0x8010, 0);
+    F->setKey(0x500);
+    Keyed.addFault(F);
+
+    for (const auto Format :
+         {InjectionCampaign::Format::YAML, InjectionCampaign::Format::BINARY}) {
+        ASSERT_TRUE(
+            Keyed.dumpToFile(getTemporaryFilename(), Format, Keyed.all()));
+        CampaignResults CR(getTemporaryFilename());
+        ASSERT_TRUE(CR.good()) << CR.error();
+        EXPECT_EQ(CR.lookup(0x100), Effect::SUCCESS);
+        EXPECT_EQ(CR.lookup(0x200), Effect::NONE);
+        EXPECT_EQ(CR.lookup(0x300), Effect::NONE);
+        // A fault which has not been run has no result.
+        EXPECT_EQ(CR.lookup(0x500), Effect::NONE);
+    }
+
+    // The keys survive a binary round trip.
+    BinaryCampaignReader BCR(getTemporaryFilename());
+    ASSERT_TRUE(BCR.good()) << BCR.error();
+    vector<unique_ptr<FaultModelBase>> faults;
+    ASSERT_TRUE(BCR.read({1, 5}, faults));
+    EXPECT_EQ(faults[0]->getKey(), 0x200);
+    EXPECT_EQ(faults[2]->getKey(), 0);
+    EXPECT_EQ(faults[3]->getKey(), 0x500);
+    EXPECT_EQ(dump(faults), dump(Keyed, {1, 5}));
+
+    CampaignResults Missing("non-existent-campaign.yml");
+    EXPECT_FALSE(Missing.good());
+}
+
+TEST_F(CampaignFileF, errors) {
+    BinaryCampaignReader Missing("non-existent-campaign.bin");
+    EXPECT_FALSE(Missing.good());
+    EXPECT_FALSE(BinaryCampaignReader::isBinaryCampaign(
+        "non-existent-campaign.bin"));
+
+    // A text campaign file is not a binary one.
+    InjectionCampaign IC("image.elf", "trace.tarmac", 1000, 0x8000, 0x9000);
+    fill(IC, true);
+    IC.dumpToFile(getTemporaryFilename());
+    EXPECT_FALSE(BinaryCampaignReader::isBinaryCampaign(getTemporaryFilename()));
+    BinaryCampaignReader Text(getTemporaryFilename());
+    EXPECT_FALSE(Text.good());
+
+    // A truncated file.
+    std::ostringstream os;
+    IC.dumpBinary(os, IC.all());
+    const string content = os.str();
+    {
+        std::ofstream ofs(getTemporaryFilename(), std::ios::binary);
+        ofs.write(content.data(), content.size() - 10);
+    }
+    BinaryCampaignReader Truncated(getTemporaryFilename());
+    EXPECT_FALSE(Truncated.good());
+    EXPECT_STREQ(Truncated.error(), "truncated campaign file");
+}
@@ -0,0 +1,186 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+
+#include "PAF/CompactTrace.h"
+#include "PAF/PAF.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+using PAF::CompactInstruction;
+using PAF::CompactTrace;
+using PAF::MemoryAccess;
+using PAF::ReferenceInstruction;
+using PAF::RegisterAccess;
+using PAF::SmallVector;
+using PAF::StringTable;
+
+TEST(SmallVector, base) {
+    SmallVector<uint32_t, 2> SV;
+    EXPECT_TRUE(SV.empty());
+    EXPECT_EQ(SV.size(), 0);
+    EXPECT_EQ(SV.capacity(), 2);
+    EXPECT_TRUE(SV.isInline());
+
+    SV.push_back(1);
+    SV.push_back(3);
+    EXPECT_EQ(SV.size(), 2);
+    EXPECT_TRUE(SV.isInline());
+    EXPECT_EQ(SV[0], 1);
+    EXPECT_EQ(SV[1], 3);
+
+    // Growing beyond the inline capacity moves the elements to the heap.
+    SV.push_back(SV[0]);
+    EXPECT_EQ(SV.size(), 3);
+    EXPECT_FALSE(SV.isInline());
+    EXPECT_EQ(SV[2], 1);
+
+    SV.insert(SV.begin() + 1, 2);
+    SV.insert(SV.end(), 4);
+    SV.insert(SV.begin(), 0);
+    EXPECT_EQ(vector<uint32_t>(SV.begin(), SV.end()),
+              vector<uint32_t>({0, 1, 2, 3, 1, 4}));
+
+    // Copy and move.
+    SmallVector<uint32_t, 2> C(SV);
+    EXPECT_EQ(C, SV);
+    SmallVector<uint32_t, 2> M(std::move(C));
+    EXPECT_EQ(M, SV);
+    EXPECT_TRUE(C.empty());
+    EXPECT_TRUE(C.isInline());
+
+    SmallVector<uint32_t, 2> S;
+    S.push_back(5);
+    M = S;
+    EXPECT_EQ(M.size(), 1);
+    EXPECT_EQ(M[0], 5);
+    EXPECT_NE(M, SV);
+    S = std::move(SV);
+    EXPECT_EQ(S.size(), 6);
+    EXPECT_EQ(S[5], 4);
+
+    S.clear();
+    EXPECT_TRUE(S.empty());
+}
+
+TEST(StringTable, base) {
+    StringTable ST;
+    EXPECT_EQ(ST.size(), 0);
+    EXPECT_EQ(ST.intern("add r0,r1"), 0);
+    EXPECT_EQ(ST.intern("mov r0,#1"), 1);
+    EXPECT_EQ(ST.intern("add r0,r1"), 0);
+    EXPECT_EQ(ST.size(), 2);
+    EXPECT_EQ(ST[0], "add r0,r1");
+    EXPECT_EQ(ST[1], "mov r0,#1");
+
+    // Check the lookups still work once many strings have been added.
+    for (unsigned i = 0; i < 1000; i++)
+        EXPECT_EQ(ST.intern(std::to_string(i)), i + 2);
+    EXPECT_EQ(ST.intern("mov r0,#1"), 1);
+    EXPECT_EQ(ST.intern("999"), 1001);
+
+    ST.clear();
+    EXPECT_EQ(ST.size(), 0);
+    EXPECT_EQ(ST.intern("mov r0,#1"), 0);
+}
+
+TEST(CompactTrace, base) {
+    const ReferenceInstruction I[3] = {
+        // clang-format off
+        {
+            28, IE_EXECUTED, 0x08326, ARM, 32, 0xf8db0800, "ldr.w      r0,[r11,#2048]",
+            {
+                MemoryAccess(4, 0xf939b40, 0xdeadbeef, MemoryAccess::Type::READ)
+            },
+            {
+                RegisterAccess("r0", 0xdeadbeef, RegisterAccess::Type::WRITE),
+                RegisterAccess("r11", 0xf939340, RegisterAccess::Type::READ)
+            }
+        },
+        {
+            29, IE_CCFAIL, 0x0832a, THUMB, 16, 0x4408, "add      r0,r1",
+            {},
+            {}
+        },
+        {
+            30, IE_EXECUTED, 0x0832c, THUMB, 16, 0xe8bd4010, "pop {r4,lr}",
+            {
+                MemoryAccess(4, 0x1000, 0x1234, MemoryAccess::Type::READ),
+                MemoryAccess(4, 0x1004, 0x5678, MemoryAccess::Type::READ)
+            },
+            {
+                RegisterAccess("lr", 0x5678, RegisterAccess::Type::WRITE),
+                RegisterAccess("r0", 0x1234, RegisterAccess::Type::WRITE),
+                RegisterAccess("r13", 0x1008, RegisterAccess::Type::WRITE)
+            }
+        },
+        // clang-format on
+    };
+
+    CompactTrace CT;
+    EXPECT_TRUE(CT.empty());
+    for (const auto &i : {0, 1, 2, 1, 0})
+        CT(I[i]);
+    EXPECT_EQ(CT.size(), 5);
+
+    const CompactInstruction &CI = CT[0];
+    EXPECT_TRUE(CI.executed());
+    EXPECT_FALSE(CT[1].executed());
+    EXPECT_TRUE(CI.sameStatic(I[0]));
+    EXPECT_FALSE(CI.sameStatic(I[1]));
+    EXPECT_EQ(CT.disassembly(CI), "ldr.w r0,[r11,#2048]");
+    ASSERT_EQ(CI.regAccess.size(), 2);
+    EXPECT_EQ(CT.registerName(CI.regAccess[0]), "r0");
+    EXPECT_EQ(CT.registerName(CI.regAccess[1]), "r11");
+    EXPECT_EQ(CI.regAccess[0].value, 0xdeadbeef);
+
+    // Repeated disassembly and register names are interned.
+    EXPECT_EQ(CT[4].disassembly, CI.disassembly);
+    EXPECT_EQ(CT[2].regAccess[1], CI.regAccess[0]);
+
+    // The common instructions have their accesses stored inline.
+    EXPECT_TRUE(CI.memAccess.isInline());
+    EXPECT_TRUE(CI.regAccess.isInline());
+    EXPECT_FALSE(CT[2].regAccess.isInline());
+
+    // Check the conversion back to ReferenceInstructions.
+    for (size_t i = 0; i < CT.size(); i++) {
+        const ReferenceInstruction RI = CT.get(i);
+        const ReferenceInstruction &Exp = I[i < 3 ? i : 4 - i];
+        EXPECT_EQ(RI, Exp);
+        EXPECT_EQ(RI.time, Exp.time);
+        EXPECT_EQ(RI.effect, Exp.effect);
+        EXPECT_EQ(RI.disassembly, Exp.disassembly);
+        EXPECT_EQ(RI.memAccess, Exp.memAccess);
+        EXPECT_EQ(RI.regAccess, Exp.regAccess);
+        for (size_t j = 0; j < RI.memAccess.size(); j++)
+            EXPECT_EQ(RI.memAccess[j].value, Exp.memAccess[j].value);
+        for (size_t j = 0; j < RI.regAccess.size(); j++)
+            EXPECT_EQ(RI.regAccess[j].value, Exp.regAccess[j].value);
+    }
+
+    CT.clear();
+    EXPECT_TRUE(CT.empty());
+}
@@ -276,3 +276,80 @@ TEST(Expr, NPInputs) {
     r++;
     EXPECT_EQ(e->repr(), "OR($a[0](4660),17185)");
 }
+
+TEST(Expr, Program) {
+    // More rows than fit in a batch.
+    const size_t num_rows = 1000;
+    PAF::SCA::NPArray<uint16_t> a(num_rows, 3);
+    PAF::SCA::NPArray<uint8_t> b(num_rows, 2);
+    for (size_t r = 0; r < num_rows; r++) {
+        for (size_t c = 0; c < a.cols(); c++)
+            a(r, c) = uint16_t(r * 7919 + c * 104729);
+        for (size_t c = 0; c < b.cols(); c++)
+            b(r, c) = uint8_t(r * 31 + c);
+    }
+    auto ra = a.cbegin();
+    auto rb = b.cbegin();
+
+    unique_ptr<Expr> e(new Xor(
+        new AESSBox(new Xor(new Truncate(ValueType::UINT8,
+                                         new Or(new NPInput<uint16_t>(ra, 0),
+                                                new Not(new NPInput<uint16_t>(
+                                                    ra, 2)))),
+                            new NPInput<uint8_t>(rb, 1))),
+        new Asr(new Lsr(new Lsl(new NPInput<uint8_t>(rb, 0),
+                                new Constant(ValueType::UINT8, 1)),
+                        new And(new Input(ValueType::UINT8, 3),
+                                new Constant(ValueType::UINT8, 1))),
+                new Constant(ValueType::UINT8, 2))));
+
+    const Program p(*e);
+    EXPECT_EQ(p.getType(), ValueType::UINT8);
+    // Both 1_u8 constants share the same register.
+    EXPECT_EQ(p.size(), 17);
+
+    // Evaluate the rows in 2 parts, starting in the middle of a batch.
+    std::vector<Value::ConcreteType> values(num_rows);
+    p.eval(values.data(), 0, 100);
+    p.eval(&values[100], 100, num_rows - 100);
+    for (size_t r = 0; r < num_rows; r++, ra++, rb++)
+        EXPECT_EQ(values[r], e->eval().getValue());
+}
+
+TEST(Expr, ProgramSharing) {
+    const uint8_t a_init[] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+    PAF::SCA::NPArray<uint8_t> a(a_init, 3, 2);
+    auto r = a.cbegin();
+
+    // Both expressions share XOR($a[0],$a[1]), and the operations on
+    // constants are folded.
+    unique_ptr<Expr> e0(new AESSBox(
+        new Xor(new NPInput<uint8_t>(r, 0), new NPInput<uint8_t>(r, 1))));
+    unique_ptr<Expr> e1(new Xor(
+        new Xor(new NPInput<uint8_t>(r, 0), new NPInput<uint8_t>(r, 1)),
+        new Not(new Xor(new Constant(ValueType::UINT8, 0xF0),
+                        new Constant(ValueType::UINT8, 0x0F)))));
+    unique_ptr<Expr> e2(new Truncate(
+        ValueType::UINT8, new Lsl(new Constant(ValueType::UINT16, 0x0123),
+                                  new Constant(ValueType::UINT16, 4))));
+
+    Program p;
+    EXPECT_EQ(p.add(*e0), 0);
+    EXPECT_EQ(p.add(*e1), 1);
+    EXPECT_EQ(p.add(*e2), 2);
+    EXPECT_EQ(p.outputs(), 3);
+    EXPECT_EQ(p.getType(0), ValueType::UINT8);
+    EXPECT_EQ(p.getType(2), ValueType::UINT8);
+    // LOAD, LOAD, XOR and AES_SBOX for e0. XOR with a folded constant for
+    // e1, with the 0xF0, 0x0F, their XOR and its NOT constants. The 0x0123,
+    // 4, LSL and TRUNCATE constants for e2.
+    EXPECT_EQ(p.size(), 4 + 5 + 4);
+
+    std::vector<Value::ConcreteType> values(3 * a.rows());
+    p.eval(values.data(), 0, a.rows());
+    for (size_t i = 0; i < a.rows(); i++, r++) {
+        EXPECT_EQ(values[i], e0->eval().getValue());
+        EXPECT_EQ(values[a.rows() + i], e1->eval().getValue());
+        EXPECT_EQ(values[2 * a.rows() + i], 0x30);
+    }
+}
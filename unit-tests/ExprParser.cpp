@@ -77,6 +77,14 @@ struct ExprChecker {
         EXPECT_NE(E.get(), nullptr);
         if (E) {
             EXPECT_EQ(E->getType(), vt);
+
+            // The compiled expression evaluates all rows at once.
+            const Expr::Program P(*E);
+            EXPECT_EQ(P.getType(), vt);
+            vector<Expr::Value::ConcreteType> pvalues(values.size());
+            P.eval(pvalues.data(), 0, values.size());
+            EXPECT_EQ(pvalues, values);
+
             for (size_t i = 0; i < values.size(); i++) {
                 EXPECT_EQ(E->eval().getValue(), values[i]);
                 EXPECT_EQ(E->repr(), reprs[reprs.size() > 1 ? i : 0]);
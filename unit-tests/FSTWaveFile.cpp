@@ -21,7 +21,11 @@
 #include "PAF/WAN/FSTWaveFile.h"
 #include "PAF/WAN/Waveform.h"
 
+#include "paf-unit-testing.h"
+
+#include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -69,3 +73,38 @@ TEST(FSTWaveFile, emptyFSTHierarchyVisitor) {
     FSTWaveFile F(FSTInput, /* write: */ false);
     F.visitHierarchy(&V);
 }
+
+TEST(FSTWaveFile, getTimeRange) {
+    FSTWaveFile F(FSTInput, /* write: */ false);
+    EXPECT_EQ(F.getTimeRange(), std::make_pair(TimeTy(0), TimeTy(110000)));
+}
+
+// Create the test fixture for the streaming merge.
+TEST_WITH_TEMP_FILE(FSTWaveFileF, "test-FSTWriteMerged.XXXXXX");
+TEST_F(FSTWaveFileF, writeMerged) {
+    const Waveform Ref = FSTWaveFile(FSTInput, /* write: */ false).read();
+    for (const size_t numSlices : {1, 5, 64}) {
+        {
+            // Exercise the block batching and the compression levels too.
+            FSTWaveFile F(getTemporaryFilename(), /* write: */ true);
+            F.setWriteOptions(
+                WriteOptions()
+                    .setBlockSize(numSlices)
+                    .setCompression(numSlices == 1
+                                        ? WriteOptions::Compression::SMALL
+                                        : WriteOptions::Compression::FAST));
+            EXPECT_TRUE(F.writeMerged({FSTInput}, numSlices));
+        }
+        const Waveform W =
+            FSTWaveFile(getTemporaryFilename(), /* write: */ false).read();
+        EXPECT_EQ(W.getTimeScale(), Ref.getTimeScale());
+        EXPECT_TRUE(std::equal(W.timesBegin(), W.timesEnd(), Ref.timesBegin(),
+                               Ref.timesEnd()));
+        for (const char *sig : {"cnt [8:0]", "cnt1 [7:0]", "clk", "reset"}) {
+            const auto idx = W.findSignalIdx("tbench.DUT", sig);
+            const auto refIdx = Ref.findSignalIdx("tbench.DUT", sig);
+            ASSERT_TRUE(idx.first && refIdx.first);
+            EXPECT_EQ(W[idx.second], Ref[refIdx.second]);
+        }
+    }
+}
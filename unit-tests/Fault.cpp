@@ -120,6 +120,59 @@ TEST(Fault, FaultModelBase) {
     // Check the breakpoint copied
     FaultModelTest f1(f0);
     EXPECT_TRUE(f1.hasBreakpoint());
+
+    // A weight is only dumped when the fault stands for others.
+    EXPECT_EQ(f0.getWeight(), 1);
+    f0.setWeight(3);
+    EXPECT_EQ(f0.getWeight(), 3);
+    out.str("");
+    f0.dump(out);
+    EXPECT_EQ(out.str(),
+              "Id: 1, Time: 1, Address: 0x4d2, Instruction: 0x2105, Width: 16, "
+              "Breakpoint: { Address: 0x4d0, Count: 1}, Disassembly: \"MOVS "
+              "r1,#5\", Weight: 3");
+    FaultModelTest f2(f0);
+    EXPECT_EQ(f2.getWeight(), 3);
+
+    // An effect is only dumped once the fault has been classified.
+    EXPECT_EQ(f0.getEffect(), FaultModelBase::Effect::NONE);
+    f0.setEffect(FaultModelBase::Effect::NOEFFECT);
+    EXPECT_EQ(f0.getEffect(), FaultModelBase::Effect::NOEFFECT);
+    out.str("");
+    f0.dump(out);
+    EXPECT_EQ(out.str(),
+              "Id: 1, Time: 1, Address: 0x4d2, Instruction: 0x2105, Width: 16, "
+              "Breakpoint: { Address: 0x4d0, Count: 1}, Disassembly: \"MOVS "
+              "r1,#5\", Weight: 3, Effect: \"noeffect\"");
+    FaultModelTest f3(f0);
+    EXPECT_EQ(f3.getEffect(), FaultModelBase::Effect::NOEFFECT);
+    EXPECT_EQ(FaultModelBase::getEffectName(FaultModelBase::Effect::NONE),
+              nullptr);
+    EXPECT_STREQ(
+        FaultModelBase::getEffectName(FaultModelBase::Effect::UNDECIDED),
+        "undecided");
+    EXPECT_EQ(FaultModelBase::getEffect("caught"),
+              FaultModelBase::Effect::CAUGHT);
+    EXPECT_EQ(FaultModelBase::getEffect("unknown"),
+              FaultModelBase::Effect::NONE);
+
+    // A key is only dumped when the fault has one.
+    EXPECT_EQ(f0.getKey(), 0);
+    EXPECT_EQ(f0.getKey(1), 0);
+    f0.setKey(0x1234);
+    EXPECT_EQ(f0.getKey(), 0x1234);
+    out.str("");
+    f0.dump(out);
+    EXPECT_EQ(out.str(),
+              "Id: 1, Time: 1, Address: 0x4d2, Instruction: 0x2105, Width: 16, "
+              "Breakpoint: { Address: 0x4d0, Count: 1}, Disassembly: \"MOVS "
+              "r1,#5\", Weight: 3, Effect: \"noeffect\", Key: 0x1234");
+    FaultModelTest f4(f0);
+    EXPECT_EQ(f4.getKey(), 0x1234);
+    // The variants of a family get distinct keys.
+    EXPECT_NE(f0.getKey(1), 0);
+    EXPECT_NE(f0.getKey(1), f0.getKey());
+    EXPECT_NE(f0.getKey(1), f0.getKey(2));
 }
 
 TEST(Fault, InstructionSkip) {
@@ -145,6 +198,71 @@ TEST(Fault, CorruptRegDef) {
               "{ Id: 0, Time: 1000, Address: 0x832a, Instruction: 0xe9d63401, "
               "Width: 32, Disassembly: \"LDRD r3,r4,[r6,#4]\", "
               "FaultedReg: \"R3\"}");
+    EXPECT_EQ(f0.getNumVariants(), 1);
+    uint64_t andMask, xorMask;
+    f0.getMasks(0, andMask, xorMask);
+    EXPECT_EQ(andMask, 0);
+    EXPECT_EQ(xorMask, 0);
+}
+
+TEST(Fault, CorruptRegDefPatterns) {
+    using Pattern = CorruptRegDef::Pattern;
+    CorruptRegDef f(1000, 0x0832a, 0xe9d63401, 32, "LDRD r3,r4,[r6,#4]", "r3");
+    uint64_t andMask, xorMask;
+
+    f.setPattern(Pattern::BIT_FLIP, 32);
+    EXPECT_EQ(f.getNumVariants(), 32);
+    f.getMasks(5, andMask, xorMask);
+    EXPECT_EQ(andMask, 0xFFFFFFFF);
+    EXPECT_EQ(xorMask, 0x20);
+    std::ostringstream out;
+    f.dump(out, 5);
+    EXPECT_EQ(out.str(),
+              "{ Id: 5, Time: 1000, Address: 0x832a, Instruction: 0xe9d63401, "
+              "Width: 32, Disassembly: \"LDRD r3,r4,[r6,#4]\", "
+              "FaultedReg: \"R3\", Pattern: \"bitflip\", RegWidth: 32, "
+              "Variant: 5, AndMask: 0xffffffff, XorMask: 0x20}");
+
+    f.setPattern(Pattern::BYTE_SET, 64);
+    EXPECT_EQ(f.getNumVariants(), 8);
+    f.getMasks(1, andMask, xorMask);
+    EXPECT_EQ(andMask, 0xFFFFFFFFFFFF00FF);
+    EXPECT_EQ(xorMask, 0xFF00);
+
+    f.setPattern(Pattern::BYTE_RESET, 32);
+    EXPECT_EQ(f.getNumVariants(), 4);
+    f.getMasks(3, andMask, xorMask);
+    EXPECT_EQ(andMask, 0x00FFFFFF);
+    EXPECT_EQ(xorMask, 0);
+
+    // Random patterns are reproducible, and flip exactly NumBits bits.
+    f.setPattern(Pattern::RANDOM_BITS, 32, 3, 10);
+    EXPECT_EQ(f.getNumVariants(), 10);
+    for (unsigned v = 0; v < f.getNumVariants(); v++) {
+        f.getMasks(v, andMask, xorMask);
+        EXPECT_EQ(andMask, 0xFFFFFFFF);
+        EXPECT_EQ(__builtin_popcountll(xorMask), 3);
+        EXPECT_EQ(xorMask & ~andMask, 0);
+        uint64_t andMask2, xorMask2;
+        f.getMasks(v, andMask2, xorMask2);
+        EXPECT_EQ(xorMask, xorMask2);
+    }
+    f.setPattern(Pattern::RANDOM_BITS, 8, 20, 1);
+    EXPECT_EQ(f.getNumBits(), 8);
+    f.getMasks(0, andMask, xorMask);
+    EXPECT_EQ(xorMask, 0xFF);
+
+    // A single variant can be selected from a family.
+    f.setPattern(Pattern::BIT_FLIP, 32);
+    f.setVariant(7);
+    EXPECT_EQ(f.getNumVariants(), 1);
+    EXPECT_EQ(f.getVariant(0), 7);
+    f.getMasks(0, andMask, xorMask);
+    EXPECT_EQ(xorMask, 0x80);
+
+    EXPECT_STREQ(CorruptRegDef::getPatternName(Pattern::VALUE), "value");
+    EXPECT_STREQ(CorruptRegDef::getPatternName(Pattern::RANDOM_BITS),
+                 "randombits");
 }
 
 TEST(Fault, FunctionInfo) {
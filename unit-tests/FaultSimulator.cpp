@@ -0,0 +1,196 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/FI/FaultSimulator.h"
+#include "PAF/ArchInfo.h"
+#include "PAF/FI/Fault.h"
+#include "PAF/PAF.h"
+
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+using PAF::MemoryAccess;
+using PAF::ReferenceInstruction;
+using PAF::RegisterAccess;
+using PAF::V7MInfo;
+using PAF::V8AInfo;
+using PAF::FI::CorruptRegDef;
+using PAF::FI::FaultModelBase;
+using PAF::FI::FaultSimulator;
+using PAF::FI::InstructionSkip;
+
+using Effect = FaultModelBase::Effect;
+
+namespace {
+RegisterAccess W(const char *name, uint64_t value) {
+    return {name, value, RegisterAccess::Type::WRITE};
+}
+
+// Build a 16-bit Thumb instruction, executed at time t.
+ReferenceInstruction thumb16(Time t, uint32_t opcode,
+                             const string &disassembly,
+                             const vector<RegisterAccess> &writes,
+                             InstructionEffect effect = IE_EXECUTED,
+                             const vector<MemoryAccess> &mem = {}) {
+    return {t, effect, 0x1000 + 2 * t, THUMB, 16, opcode, disassembly, mem,
+            writes};
+}
+
+InstructionSkip skipFault(const ReferenceInstruction &I) {
+    return {I.time, I.pc, I.instruction, 0xbf00, 16, I.executed(),
+            I.disassembly};
+}
+
+CorruptRegDef corruptFault(const ReferenceInstruction &I, const char *reg) {
+    return {I.time, I.pc, I.instruction, 16, I.disassembly, reg};
+}
+
+void seed(FaultSimulator &FS) {
+    FS.setRegister(unsigned(V7MInfo::Register::R0), 1);
+    FS.setRegister(unsigned(V7MInfo::Register::R1), 2);
+    FS.setRegister(unsigned(V7MInfo::Register::R2), 0);
+    FS.setRegister(unsigned(V7MInfo::Register::CPSR), 0x01000000);
+}
+} // namespace
+
+TEST(FaultSimulator, isSupported) {
+    EXPECT_TRUE(FaultSimulator::isSupported(V7MInfo()));
+    EXPECT_FALSE(FaultSimulator::isSupported(V8AInfo()));
+}
+
+TEST(FaultSimulator, InstructionSkip) {
+    const vector<ReferenceInstruction> Trace = {
+        thumb16(0, 0x2005, "movs r0,#5", {W("r0", 5), W("cpsr", 0x01000000)}),
+        thumb16(1, 0x2007, "movs r0,#7", {W("r0", 7), W("cpsr", 0x01000000)}),
+        thumb16(2, 0x1c42, "adds r2,r0,#1",
+                {W("r2", 8), W("cpsr", 0x01000000)}),
+        thumb16(3, 0x2200, "movs r2,#0", {W("r2", 0), W("cpsr", 0x41000000)}),
+        thumb16(4, 0x440a, "add r2,r1", {}, IE_CCFAIL),
+        thumb16(5, 0x600a, "str r2,[r1,#0]", {}, IE_EXECUTED,
+                {MemoryAccess(4, 2, 7, MemoryAccess::Type::WRITE)}),
+        thumb16(6, 0x2000, "movs r0,#0", {W("r0", 0), W("cpsr", 0x41000000)}),
+    };
+
+    const V7MInfo CPU;
+    FaultSimulator FS(CPU);
+    seed(FS);
+    vector<InstructionSkip> Faults;
+    Faults.reserve(Trace.size());
+    for (const auto &I : Trace) {
+        Faults.push_back(skipFault(I));
+        FS.skip(Faults.back(), I);
+        FS.step(I);
+    }
+    FS.flush();
+
+    // r0 is overwritten before being used.
+    EXPECT_EQ(Faults[0].getEffect(), Effect::NOEFFECT);
+    // r0 propagates to r2, and both are overwritten later.
+    EXPECT_EQ(Faults[1].getEffect(), Effect::NOEFFECT);
+    // r2 is overwritten with the same flags.
+    EXPECT_EQ(Faults[2].getEffect(), Effect::NOEFFECT);
+    // The Z flag differs, so the conditional add could be executed.
+    EXPECT_EQ(Faults[3].getEffect(), Effect::NONE);
+    // The instruction was not executed.
+    EXPECT_EQ(Faults[4].getEffect(), Effect::NOEFFECT);
+    // Skipping a store makes the memory diverge.
+    EXPECT_EQ(Faults[5].getEffect(), Effect::NONE);
+    // The end of the trace is reached.
+    EXPECT_EQ(Faults[6].getEffect(), Effect::NONE);
+    EXPECT_EQ(FS.getNumClassified(), 4);
+    EXPECT_EQ(FS.getNumHandedOver(), 3);
+}
+
+TEST(FaultSimulator, CorruptRegDef) {
+    const vector<ReferenceInstruction> Trace = {
+        thumb16(0, 0x2101, "movs r1,#1", {W("r1", 1), W("cpsr", 0x01000000)}),
+        thumb16(1, 0x2901, "cmp r1,#1", {W("cpsr", 0x61000000)}),
+        thumb16(2, 0xd000, "beq 0x1006", {}),
+        thumb16(3, 0x2000, "movs r0,#0", {W("r0", 0), W("cpsr", 0x61000000)}),
+        thumb16(4, 0x4008, "ands r0,r1", {W("r0", 0), W("cpsr", 0x61000000)}),
+        thumb16(5, 0x2101, "movs r1,#1", {W("r1", 1), W("cpsr", 0x21000000)}),
+    };
+
+    const V7MInfo CPU;
+    FaultSimulator FS(CPU);
+    seed(FS);
+    vector<CorruptRegDef> Faults;
+    Faults.reserve(Trace.size());
+    // Zeroing r1 makes the branch go the other way.
+    Faults.push_back(corruptFault(Trace[0], "r1"));
+    FS.corrupt(Faults.back(), Trace[0], unsigned(V7MInfo::Register::R1));
+    // Setting r1 to 1 does not change the value it gets.
+    Faults.push_back(corruptFault(Trace[0], "r1"));
+    FS.corrupt(Faults.back(), Trace[0], unsigned(V7MInfo::Register::R1), 1);
+    FS.step(Trace[0]);
+    FS.step(Trace[1]);
+    FS.step(Trace[2]);
+    // Setting r0 to 2 is masked by the and with r1.
+    Faults.push_back(corruptFault(Trace[3], "r0"));
+    FS.corrupt(Faults.back(), Trace[3], unsigned(V7MInfo::Register::R0), 2);
+    // The status registers are left to the model.
+    Faults.push_back(corruptFault(Trace[3], "cpsr"));
+    FS.corrupt(Faults.back(), Trace[3], unsigned(V7MInfo::Register::CPSR));
+    for (size_t i = 3; i < Trace.size(); i++)
+        FS.step(Trace[i]);
+    FS.flush();
+
+    EXPECT_EQ(Faults[0].getEffect(), Effect::NONE);
+    EXPECT_EQ(Faults[1].getEffect(), Effect::NOEFFECT);
+    EXPECT_EQ(Faults[2].getEffect(), Effect::NOEFFECT);
+    EXPECT_EQ(Faults[3].getEffect(), Effect::NONE);
+    EXPECT_EQ(FS.getNumClassified(), 2);
+    EXPECT_EQ(FS.getNumHandedOver(), 2);
+}
+
+TEST(FaultSimulator, window) {
+    const vector<ReferenceInstruction> Trace = {
+        thumb16(0, 0x2105, "movs r1,#5", {W("r1", 5), W("cpsr", 0x01000000)}),
+        thumb16(1, 0x2203, "movs r2,#3", {W("r2", 3), W("cpsr", 0x01000000)}),
+        thumb16(2, 0x2204, "movs r2,#4", {W("r2", 4), W("cpsr", 0x01000000)}),
+        thumb16(3, 0x2100, "movs r1,#0", {W("r1", 0), W("cpsr", 0x41000000)}),
+    };
+
+    const V7MInfo CPU;
+    for (const unsigned window : {2, 3}) {
+        FaultSimulator FS(CPU, window);
+        seed(FS);
+        CorruptRegDef F = corruptFault(Trace[0], "r1");
+        FS.corrupt(F, Trace[0], unsigned(V7MInfo::Register::R1));
+        for (const auto &I : Trace)
+            FS.step(I);
+        FS.flush();
+        EXPECT_EQ(F.getEffect(),
+                  window == 2 ? Effect::NONE : Effect::NOEFFECT);
+    }
+
+    // An unknown reference value can not be simulated.
+    FaultSimulator FS(CPU);
+    InstructionSkip F = skipFault(Trace[1]);
+    FS.skip(F, Trace[1]);
+    EXPECT_EQ(FS.getNumHandedOver(), 1);
+    FS.reset();
+    EXPECT_EQ(F.getEffect(), Effect::NONE);
+}
@@ -33,6 +33,11 @@ template <typename Ty> void PrintTo(const Interval<Ty> &I, std::ostream *os) {
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <vector>
+
 using namespace std;
 
 using TInterval = PAF::Interval<uint64_t>;
@@ -331,3 +336,89 @@ TEST(Intervals, contain) {
     EXPECT_TRUE(t.contains(TInterval(32, 40)));
     EXPECT_TRUE(t.contains(TInterval(30, 38)));
 }
+
+TEST(Intervals, intersect) {
+    TIntervals t;
+    EXPECT_FALSE(t.intersect(TInterval(0, 100)));
+    t.insert(10, 20);
+    t.insert(30, 40);
+
+    EXPECT_FALSE(t.intersect(TInterval(0, 9)));
+    EXPECT_FALSE(t.intersect(TInterval(21, 29)));
+    EXPECT_FALSE(t.intersect(TInterval(41, 50)));
+
+    EXPECT_TRUE(t.intersect(TInterval(0, 10)));
+    EXPECT_TRUE(t.intersect(TInterval(12, 14)));
+    EXPECT_TRUE(t.intersect(TInterval(20, 29)));
+    EXPECT_TRUE(t.intersect(TInterval(21, 30)));
+    EXPECT_TRUE(t.intersect(TInterval(0, 50)));
+    EXPECT_TRUE(t.intersect(TInterval(40, 50)));
+}
+
+TEST(Intervals, insertAll) {
+    const vector<TInterval> v = {
+        TInterval(50, 60), TInterval(10, 20), TInterval(15, 25),
+        TInterval(70, 70), TInterval(25, 30), TInterval(0, 2),
+        TInterval(60, 65), TInterval(3, 4),
+    };
+
+    TIntervals expected;
+    for (const auto &i : v)
+        expected.insert(i);
+    EXPECT_EQ(expected.size(), 5);
+
+    TIntervals t;
+    t.insertAll(v.begin(), v.end());
+    EXPECT_EQ(t, expected);
+
+    // Insert into a non empty Intervals.
+    t = TIntervals({TInterval(5, 8), TInterval(66, 69)});
+    t.insertAll(v.begin(), v.end());
+    expected.insert(5, 8);
+    expected.insert(66, 69);
+    EXPECT_EQ(t, expected);
+    auto p = t.begin();
+    EXPECT_EQ(*p++, TInterval(0, 2));
+    EXPECT_EQ(*p++, TInterval(3, 4));
+    EXPECT_EQ(*p++, TInterval(5, 8));
+    EXPECT_EQ(*p++, TInterval(10, 30));
+    EXPECT_EQ(*p++, TInterval(50, 65));
+    EXPECT_EQ(*p++, TInterval(66, 69));
+    EXPECT_EQ(*p++, TInterval(70, 70));
+    EXPECT_EQ(p, t.end());
+
+    // Inserting nothing is a no-op.
+    t.insertAll(v.end(), v.end());
+    EXPECT_EQ(t, expected);
+}
+
+TEST(Intervals, randomized) {
+    // Compare against a bitmap of the covered values.
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<unsigned> value(0, 999);
+    std::uniform_int_distribution<unsigned> length(0, 20);
+    vector<TInterval> v;
+    vector<unsigned> covered(1000, 0);
+    TIntervals t;
+    for (unsigned i = 0; i < 200; i++) {
+        const unsigned b = value(gen);
+        const unsigned e = std::min(b + length(gen), 999U);
+        v.emplace_back(b, e);
+        t.insert(b, e);
+        for (unsigned j = b; j <= e; j++)
+            covered[j] = 1;
+    }
+
+    TIntervals tb;
+    tb.insertAll(v.begin(), v.end());
+    EXPECT_EQ(tb, t);
+
+    for (unsigned i = 0; i < 1000; i++) {
+        EXPECT_EQ(t.contains(TInterval(i, i)), covered[i] != 0);
+        EXPECT_EQ(t.intersect(TInterval(i, i)), covered[i] != 0);
+    }
+
+    // The elements are sorted and disjoint.
+    for (auto p = t.begin(); std::next(p) != t.end(); p++)
+        EXPECT_LT(p->end(), std::next(p)->begin());
+}
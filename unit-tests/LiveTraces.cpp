@@ -0,0 +1,127 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/LiveTraces.h"
+#include "PAF/SCA/NPArray.h"
+
+#include "paf-unit-testing.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+
+using namespace PAF::SCA;
+
+// Create the test fixture for LiveTraces.
+TEST_WITH_TEMP_FILE(LiveTracesF, "test-LiveTraces.bin.XXXXXX");
+
+TEST_F(LiveTracesF, roundTrip) {
+    const NPArray<double> traces(
+        {0.5, 1.5, 2.5, 3.5, 4.5, 5.5, 6.5, 7.5, 8.5, 10.5, 11.5, 12.5}, 4, 3);
+    const NPArray<uint32_t> data({1, 2, 3, 4, 5, 6, 7, 8}, 4, 2);
+    {
+        std::ofstream os(getTemporaryFilename(), std::ios::binary);
+        LiveTraceWriter W(os, "f8", 3, 2);
+        EXPECT_TRUE(W.write(NPArray<double>(&traces(0, 0), 3, 3),
+                            NPArray<uint32_t>(&data(0, 0), 3, 2)));
+        // Empty frames are not written, as they would end the stream.
+        EXPECT_TRUE(W.write(NPArray<double>(0, 3), NPArray<uint32_t>(0, 2)));
+        EXPECT_TRUE(W.write(NPArray<double>(&traces(3, 0), 1, 3),
+                            NPArray<uint32_t>(&data(3, 0), 1, 2)));
+        // Mismatching element types or shapes are rejected.
+        EXPECT_FALSE(W.write(NPArray<float>(1, 3), NPArray<uint32_t>(1, 2)));
+        EXPECT_FALSE(W.write(NPArray<double>(1, 2), NPArray<uint32_t>(1, 2)));
+        EXPECT_FALSE(W.write(NPArray<double>(1, 3), NPArray<uint32_t>(2, 2)));
+        EXPECT_TRUE(W.close());
+    }
+
+    LiveTraceReader R(getTemporaryFilename());
+    ASSERT_TRUE(R.good());
+    EXPECT_EQ(R.getEltTy(), "f8");
+    EXPECT_EQ(R.getNumSamples(), 3);
+    EXPECT_EQ(R.getNumData(), 2);
+    EXPECT_FALSE(R.atEnd());
+
+    // Batches are not tied to the frames.
+    NPArray<double> t;
+    NPArray<uint32_t> d;
+    EXPECT_EQ(R.read(t, d, 2), 2);
+    EXPECT_EQ(t, NPArray<double>(&traces(0, 0), 2, 3));
+    EXPECT_EQ(d, NPArray<uint32_t>(&data(0, 0), 2, 2));
+    EXPECT_EQ(R.read(t, d, 3), 2);
+    EXPECT_EQ(t, NPArray<double>(&traces(2, 0), 2, 3));
+    EXPECT_EQ(d, NPArray<uint32_t>(&data(2, 0), 2, 2));
+    EXPECT_EQ(R.getNumTraces(), 4);
+    EXPECT_TRUE(R.atEnd());
+    EXPECT_EQ(R.read(t, d, 3), 0);
+    EXPECT_TRUE(R.good());
+}
+
+TEST_F(LiveTracesF, conversion) {
+    {
+        std::ofstream os(getTemporaryFilename(), std::ios::binary);
+        LiveTraceWriter W(os, "i2", 4, 0);
+        EXPECT_TRUE(W.write(NPArray<int16_t>({-2, -1, 0, 1, 2, 3, 4, -5}, 2, 4),
+                            NPArray<uint32_t>(2, 0)));
+        EXPECT_TRUE(W.close());
+    }
+
+    LiveTraceReader R(getTemporaryFilename());
+    ASSERT_TRUE(R.good());
+    EXPECT_EQ(R.getEltTy(), "i2");
+    NPArray<double> t;
+    NPArray<uint32_t> d;
+    EXPECT_EQ(R.read(t, d, 10), 2);
+    EXPECT_EQ(t, NPArray<double>({-2, -1, 0, 1, 2, 3, 4, -5}, 2, 4));
+    EXPECT_EQ(d.rows(), 2);
+    EXPECT_EQ(d.cols(), 0);
+}
+
+TEST_F(LiveTracesF, errors) {
+    {
+        std::ofstream os(getTemporaryFilename(), std::ios::binary);
+        os << "NOT A LIVE TRACES STREAM";
+    }
+    LiveTraceReader R1(getTemporaryFilename());
+    EXPECT_FALSE(R1.good());
+    EXPECT_NE(R1.error(), nullptr);
+
+    // A truncated stream is an error.
+    {
+        std::ofstream os(getTemporaryFilename(), std::ios::binary);
+        LiveTraceWriter W(os, "u1", 2, 1);
+        EXPECT_TRUE(W.write(NPArray<uint8_t>({1, 2, 3, 4}, 2, 2),
+                            NPArray<uint32_t>({5, 6}, 2, 1)));
+    }
+    std::filesystem::resize_file(getTemporaryFilename(),
+                                 LiveTraces::HEADER_SIZE + 4 + 6 + 3);
+    LiveTraceReader R2(getTemporaryFilename());
+    ASSERT_TRUE(R2.good());
+    NPArray<uint8_t> t;
+    NPArray<uint32_t> d;
+    EXPECT_EQ(R2.read(t, d, 2), 1);
+    EXPECT_FALSE(R2.good());
+
+    LiveTraceReader R3("does-not-exist.bin");
+    EXPECT_FALSE(R3.good());
+}
@@ -0,0 +1,105 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/Memory.h"
+
+#include "gtest/gtest.h"
+
+#include <utility>
+#include <vector>
+
+using PAF::ShadowMemory;
+
+using std::pair;
+using std::vector;
+
+namespace {
+vector<pair<Addr, Addr>> intervals(const ShadowMemory &SM) {
+    vector<pair<Addr, Addr>> I;
+    SM.forEachInterval([&I](Addr b, Addr e) { I.emplace_back(b, e); });
+    return I;
+}
+} // namespace
+
+TEST(ShadowMemory, base) {
+    ShadowMemory SM;
+    EXPECT_TRUE(SM.empty());
+    EXPECT_EQ(SM.getNumPages(), 0);
+    EXPECT_FALSE(SM.isMarked(0x1000, 4));
+    EXPECT_TRUE(SM.isMarked(0x1000, 0));
+
+    SM.mark(0x1000, 4);
+    EXPECT_FALSE(SM.empty());
+    EXPECT_EQ(SM.getNumPages(), 1);
+    EXPECT_TRUE(SM.isMarked(0x1000, 4));
+    EXPECT_TRUE(SM.isMarked(0x1001, 2));
+    EXPECT_TRUE(SM.isMarked(0x1003, 1));
+    EXPECT_FALSE(SM.isMarked(0x0fff, 2));
+    EXPECT_FALSE(SM.isMarked(0x1002, 4));
+    EXPECT_FALSE(SM.isMarked(0x2000, 1));
+
+    // Adjacent marks are merged, across words too.
+    SM.mark(0x1004, 0x40);
+    EXPECT_TRUE(SM.isMarked(0x1000, 0x44));
+    EXPECT_FALSE(SM.isMarked(0x1000, 0x45));
+    EXPECT_EQ(intervals(SM), (vector<pair<Addr, Addr>>{{0x1000, 0x1044}}));
+
+    SM.mark(0x1080, 1);
+    EXPECT_EQ(intervals(SM),
+              (vector<pair<Addr, Addr>>{{0x1000, 0x1044}, {0x1080, 0x1081}}));
+
+    SM.reset();
+    EXPECT_TRUE(SM.empty());
+    EXPECT_FALSE(SM.isMarked(0x1000, 1));
+    EXPECT_TRUE(intervals(SM).empty());
+}
+
+TEST(ShadowMemory, pages) {
+    ShadowMemory SM;
+
+    // A mark crossing a page boundary.
+    const Addr boundary = 4 * ShadowMemory::PAGE_SIZE;
+    SM.mark(boundary - 2, 4);
+    EXPECT_EQ(SM.getNumPages(), 2);
+    EXPECT_TRUE(SM.isMarked(boundary - 2, 4));
+    EXPECT_TRUE(SM.isMarked(boundary - 1, 2));
+    EXPECT_FALSE(SM.isMarked(boundary - 3, 2));
+    EXPECT_FALSE(SM.isMarked(boundary + 1, 2));
+    EXPECT_EQ(intervals(SM),
+              (vector<pair<Addr, Addr>>{{boundary - 2, boundary + 2}}));
+
+    // A mark spanning several full pages, like an image segment.
+    const Addr segment = 0x80000000;
+    SM.mark(segment + 1, 3 * ShadowMemory::PAGE_SIZE);
+    EXPECT_EQ(SM.getNumPages(), 6);
+    EXPECT_TRUE(SM.isMarked(segment + 1, 3 * ShadowMemory::PAGE_SIZE));
+    EXPECT_FALSE(SM.isMarked(segment, 2));
+    EXPECT_FALSE(SM.isMarked(segment + 3 * ShadowMemory::PAGE_SIZE, 2));
+    EXPECT_EQ(intervals(SM),
+              (vector<pair<Addr, Addr>>{
+                  {boundary - 2, boundary + 2},
+                  {segment + 1, segment + 1 + 3 * ShadowMemory::PAGE_SIZE}}));
+
+    // Intervals stop at the end of a page followed by an unallocated one.
+    SM.mark(segment + 5 * ShadowMemory::PAGE_SIZE - 1, 1);
+    EXPECT_EQ(intervals(SM).back(),
+              (pair<Addr, Addr>(segment + 5 * ShadowMemory::PAGE_SIZE - 1,
+                                segment + 5 * ShadowMemory::PAGE_SIZE)));
+}
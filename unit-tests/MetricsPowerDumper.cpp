@@ -0,0 +1,157 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/MetricsPowerDumper.h"
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/Power.h"
+#include "PAF/SCA/SCA.h"
+
+#include "paf-unit-testing.h"
+
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace PAF::SCA;
+
+using std::vector;
+
+// Create the test fixture for MetricsPowerDumper.
+TEST_WITH_TEMP_FILE(MetricsPowerDumperF, "test-MetricsPowerDumper.npy.XXXXXX");
+
+namespace {
+// The power traces and their data: the first sample leaks the data, whereas
+// the others are independent from it.
+constexpr size_t NUM_TRACES = 600;
+constexpr size_t NUM_SAMPLES = 4;
+
+uint32_t data(size_t t) { return t % 3 == 0 ? 0xFF : t % 5; }
+
+vector<double> trace(size_t t) {
+    vector<double> samples(NUM_SAMPLES);
+    samples[0] = __builtin_popcount(data(t)) + double(t % 7) / 7.0;
+    for (size_t s = 1; s < NUM_SAMPLES; s++)
+        samples[s] = double((t * (s + 3)) % 11);
+    return samples;
+}
+
+// Feed the NUM_TRACES power traces to D, the samples of each trace being
+// split in 2 batches.
+void feed(MetricsPowerDumper &D) {
+    for (size_t t = 0; t < NUM_TRACES; t++) {
+        const vector<double> samples = trace(t);
+        D.setData({data(t)});
+        D.preDump();
+        D.dump(samples[0], 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, nullptr);
+        PowerSamples PS;
+        for (size_t s = 1; s < NUM_SAMPLES; s++)
+            PS.push_back(samples[s], 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, nullptr);
+        D.dumpSamples(PS);
+        D.postDump();
+        D.nextTrace();
+    }
+}
+} // namespace
+
+TEST_F(MetricsPowerDumperF, base) {
+    MetricsPowerDumper D(getTemporaryFilename(), {"trunc8($in[0])"},
+                         {"trunc8($in[0])"}, 1);
+    EXPECT_TRUE(D.good());
+    feed(D);
+    EXPECT_EQ(D.traces(), NUM_TRACES);
+
+    // The reference metrics, computed on the stored traces.
+    NPArray<double> traces(NUM_TRACES, NUM_SAMPLES);
+    vector<Classification> classifier(NUM_TRACES);
+    NPArray<double> ival(1, NUM_TRACES);
+    for (size_t t = 0; t < NUM_TRACES; t++) {
+        const vector<double> samples = trace(t);
+        for (size_t s = 0; s < NUM_SAMPLES; s++)
+            traces(t, s) = samples[s];
+        const unsigned hw = __builtin_popcount(data(t));
+        classifier[t] = hw < 4   ? Classification::GROUP_0
+                        : hw > 4 ? Classification::GROUP_1
+                                 : Classification::IGNORE;
+        ival(0, t) = hw;
+    }
+    const NPArray<double> tt = t_test(0, NUM_SAMPLES, traces, classifier);
+    const NPArray<double> rho = correl(0, NUM_SAMPLES, traces, ival);
+
+    const NPArray<double> res = D.results();
+    EXPECT_TRUE(D.good());
+    ASSERT_EQ(res.rows(), 2);
+    ASSERT_EQ(res.cols(), NUM_SAMPLES);
+    for (size_t s = 0; s < NUM_SAMPLES; s++) {
+        EXPECT_NEAR(res(0, s), tt(0, s), 1e-9);
+        EXPECT_NEAR(res(1, s), rho(0, s), 1e-9);
+    }
+    EXPECT_GT(std::abs(res(0, 0)), 100.0);
+    EXPECT_GT(res(1, 0), 0.9);
+
+    // Only the metrics are written.
+    EXPECT_TRUE(D.close());
+    const NPArray<double> saved(getTemporaryFilename());
+    EXPECT_TRUE(saved.good());
+    EXPECT_EQ(saved, res);
+}
+
+TEST_F(MetricsPowerDumperF, numSamples) {
+    // Shorter power traces are padded with zeros, longer ones are an error.
+    MetricsPowerDumper D(getTemporaryFilename(), {}, {"$in[0]"}, 1, 2);
+    D.setData({1});
+    D.dump(1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, nullptr);
+    D.nextTrace();
+    D.setData({2});
+    D.dump(2.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, nullptr);
+    D.dump(1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, nullptr);
+    D.nextTrace();
+    EXPECT_TRUE(D.good());
+    EXPECT_EQ(D.traces(), 2);
+
+    // Empty power traces are not analyzed.
+    D.nextTrace();
+    EXPECT_EQ(D.traces(), 2);
+
+    for (unsigned i = 0; i < 3; i++)
+        D.dump(1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, nullptr);
+    D.nextTrace();
+    EXPECT_FALSE(D.good());
+    EXPECT_FALSE(D.close());
+}
+
+TEST_F(MetricsPowerDumperF, errors) {
+    MetricsPowerDumper D1(getTemporaryFilename(), {"foo($in[0])"}, {}, 1);
+    EXPECT_FALSE(D1.good());
+
+    // Not enough traces in each group.
+    MetricsPowerDumper D2(getTemporaryFilename(), {"trunc8($in[0])"}, {}, 1);
+    D2.setData({0});
+    D2.dump(1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, nullptr);
+    D2.nextTrace();
+    EXPECT_TRUE(D2.good());
+    EXPECT_FALSE(D2.close());
+    EXPECT_FALSE(D2.good());
+
+    // No trace at all.
+    MetricsPowerDumper D3(getTemporaryFilename(), {"trunc8($in[0])"}, {}, 1);
+    EXPECT_FALSE(D3.close());
+}
@@ -18,14 +18,20 @@
  * This file is part of PAF, the Physical Attack Framework.
  */
 
+#include "PAF/SCA/NPAllocator.h"
 #include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/NPYChunkReader.h"
 
 #include "paf-unit-testing.h"
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <initializer_list>
 #include <limits>
 #include <memory>
@@ -94,6 +100,31 @@ TEST(NPArrayBase, base) {
     EXPECT_EQ(f.elementSize(), 4);
 }
 
+TEST(NPArrayBase, parallelFor) {
+    EXPECT_EQ(NPArrayBase::numThreads(), 1);
+    NPArrayBase::setNumThreads(0);
+    EXPECT_GE(NPArrayBase::numThreads(), 1);
+
+    for (unsigned num_threads : {1, 3, 8}) {
+        NPArrayBase::setNumThreads(num_threads);
+        EXPECT_EQ(NPArrayBase::numThreads(), num_threads);
+        for (size_t n : {0, 1, 5, 100, 1000}) {
+            // Each index in the range must be processed exactly once.
+            vector<unsigned> seen(n + 10, 0);
+            NPArrayBase::parallelFor(
+                10, n + 10, NPArrayBase::MIN_ELEMENTS_PER_THREAD,
+                [&](size_t b, size_t e) {
+                    EXPECT_LE(b, e);
+                    for (size_t i = b; i < e; i++)
+                        seen[i] += 1;
+                });
+            for (size_t i = 0; i < seen.size(); i++)
+                EXPECT_EQ(seen[i], i < 10 ? 0 : 1);
+        }
+    }
+    NPArrayBase::setNumThreads(1);
+}
+
 TEST(NPArray, empty) {
     EXPECT_TRUE(NPArray<int32_t>(0, 12).empty());
     EXPECT_TRUE(NPArray<int32_t>(3, 0).empty());
@@ -864,6 +895,170 @@ TEST(NPArray, extend) {
     testExtend<double>();
 }
 
+TEST(NPArray, storage) {
+    // All storage is aligned.
+    for (size_t n : {1, 3, 17, 1000}) {
+        const NPArray<uint8_t> a(n, n);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(&a(0, 0)) %
+                      NPAllocator::ALIGNMENT,
+                  0);
+        EXPECT_GE(a.capacity(), a.size());
+    }
+
+    // Appending rows or columns one at a time grows the storage
+    // geometrically, and preserves the content.
+    NPArray<uint32_t> r(0, 3);
+    NPArray<uint32_t> c(2, 0);
+    size_t num_reallocs = 0;
+    for (uint32_t i = 0; i < 100; i++) {
+        const uint32_t *before = r.size() ? &r(0, 0) : nullptr;
+        r.extend(NPArray<uint32_t>({3 * i, 3 * i + 1, 3 * i + 2}, 1, 3),
+                 NPArrayBase::COLUMN);
+        if (&r(0, 0) != before)
+            num_reallocs++;
+        c.extend(NPArray<uint32_t>({i, 1000 + i}, 2, 1), NPArrayBase::ROW);
+    }
+    EXPECT_LT(num_reallocs, 20);
+    EXPECT_EQ(r.rows(), 100);
+    EXPECT_EQ(r.cols(), 3);
+    EXPECT_EQ(c.rows(), 2);
+    EXPECT_EQ(c.cols(), 100);
+    for (uint32_t i = 0; i < 100; i++) {
+        for (uint32_t j = 0; j < 3; j++)
+            EXPECT_EQ(r(i, j), 3 * i + j);
+        EXPECT_EQ(c(0, i), i);
+        EXPECT_EQ(c(1, i), 1000 + i);
+    }
+
+    // Insertions in the middle, within the current capacity.
+    NPArray<uint32_t> m({0, 1, 2, 3, 4, 5}, 2, 3);
+    m.insertColumns(1, 1);
+    m(0, 1) = 10;
+    m(1, 1) = 13;
+    EXPECT_EQ(m, NPArray<uint32_t>({0, 10, 1, 2, 3, 13, 4, 5}, 2, 4));
+    m.insertColumns(2, 2);
+    for (size_t i = 0; i < 2; i++) {
+        m(i, 2) = 20 + i;
+        m(i, 3) = 30 + i;
+    }
+    EXPECT_EQ(m, NPArray<uint32_t>(
+                     {0, 10, 20, 30, 1, 2, 3, 13, 21, 31, 4, 5}, 2, 6));
+    m.insertRows(1, 1);
+    for (size_t j = 0; j < 6; j++)
+        m(1, j) = 100 + j;
+    m.insertRows(0, 1);
+    for (size_t j = 0; j < 6; j++)
+        m(0, j) = 200 + j;
+    EXPECT_EQ(m, NPArray<uint32_t>({200, 201, 202, 203, 204, 205, //
+                                    0,   10,  20,  30,  1,   2,   //
+                                    100, 101, 102, 103, 104, 105, //
+                                    3,   13,  21,  31,  4,   5},
+                                   4, 6));
+
+    // Shrinking or copying into a large enough array reuses its storage.
+    NPArray<double> big(10, 10);
+    const double *p = &big(0, 0);
+    big.resize(3, 3);
+    EXPECT_EQ(&big(0, 0), p);
+    EXPECT_GE(big.capacity(), 100);
+    EXPECT_EQ(big.memoryUsage(),
+              sizeof(NPArrayBase) + big.capacity() * sizeof(double));
+    const NPArray<double> small({1.0, 2.0, 3.0, 4.0}, 2, 2);
+    big = small;
+    EXPECT_EQ(&big(0, 0), p);
+    EXPECT_EQ(big, small);
+}
+
+TEST(NPArray, allocator) {
+    EXPECT_EQ(&NPArrayBase::allocator(), &NPAllocator::heap());
+
+    NPPoolAllocator pool;
+    NPArrayBase::setAllocator(&pool);
+    EXPECT_EQ(&NPArrayBase::allocator(), &pool);
+
+    const double *p;
+    {
+        const NPArray<double> a(16, 8);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(&a(0, 0)) %
+                      NPAllocator::ALIGNMENT,
+                  0);
+        p = &a(0, 0);
+        EXPECT_EQ(pool.cachedBytes(), 0);
+    }
+    EXPECT_EQ(pool.cachedBytes(), 16 * 8 * sizeof(double));
+
+    // A block of the same size is recycled.
+    {
+        NPArray<double> b(8, 16);
+        EXPECT_EQ(&b(0, 0), p);
+        EXPECT_EQ(pool.cachedBytes(), 0);
+        b.fill(1.0);
+        EXPECT_EQ(b.sum(NPArrayBase::COLUMN),
+                  NPArray<double>(1, 16).fill(8.0));
+    }
+    EXPECT_GE(pool.cachedBytes(), 16 * 8 * sizeof(double));
+
+    pool.release();
+    EXPECT_EQ(pool.cachedBytes(), 0);
+
+    // The pool does not keep more than its limit.
+    NPPoolAllocator small_pool(100);
+    NPArrayBase::setAllocator(&small_pool);
+    { const NPArray<uint8_t> a(10, 10); }
+    EXPECT_EQ(small_pool.cachedBytes(), 100);
+    { const NPArray<uint8_t> a(10, 11); }
+    EXPECT_EQ(small_pool.cachedBytes(), 100);
+
+    NPArrayBase::setAllocator(nullptr);
+    EXPECT_EQ(&NPArrayBase::allocator(), &NPAllocator::heap());
+}
+
+TEST(NPArray, largePageAllocator) {
+    const unsigned numThreads = NPArrayBase::numThreads();
+    NPArrayBase::setNumThreads(4);
+
+    NPLargePageAllocator large(4096);
+    EXPECT_FALSE(large.isMapped(0));
+    EXPECT_FALSE(large.isMapped(4095));
+    EXPECT_TRUE(large.isMapped(4096));
+    NPArrayBase::setAllocator(&large);
+    EXPECT_EQ(&NPArrayBase::allocator(), &large);
+
+    {
+        // A small array, from the heap.
+        NPArray<double> a(2, 3);
+        a.fill(2.0);
+        EXPECT_EQ(a.sum(NPArrayBase::COLUMN), NPArray<double>(1, 3).fill(4.0));
+
+        // A large one, mapped.
+        NPArray<uint32_t> b(1000, 300);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(&b(0, 0)) %
+                      NPLargePageAllocator::HUGE_PAGE_SIZE,
+                  0);
+        for (size_t r = 0; r < b.rows(); r++)
+            for (size_t c = 0; c < b.cols(); c++)
+                b(r, c) = uint32_t(r + c);
+        EXPECT_EQ(b(999, 299), 1298);
+        b.resize(1200, 300);
+        b.fill(3);
+        EXPECT_EQ(b(1199, 299), 3);
+    }
+
+    // With hugetlbfs pages, which fall back to transparent huge pages when
+    // the system has none reserved.
+    NPLargePageAllocator hugetlb(4096, /* hugetlb: */ true,
+                                 /* first_touch: */ false);
+    NPArrayBase::setAllocator(&hugetlb);
+    {
+        NPArray<double> c = NPArray<double>::ones(512, 16);
+        EXPECT_EQ(c.sum(NPArrayBase::COLUMN),
+                  NPArray<double>(1, 16).fill(512.0));
+    }
+
+    NPArrayBase::setAllocator(nullptr);
+    NPArrayBase::setNumThreads(numThreads);
+}
+
 template <typename Ty> void testConcatenate() {
     const Ty init1[] = {0, 1, 2, 3, 4, 5, 6, 7};
     const Ty init2[] = {10, 11, 12, 13, 14, 15, 16, 17};
@@ -1217,6 +1412,87 @@ TEST_F(NPArrayF, readAs) {
     testReadAs<double, uint64_t>(tmpFile);
 }
 
+// Save \p a to file \p filename, using the non-native endianness.
+template <typename Ty>
+void saveWithSwappedEndianness(const string &filename, const NPArray<Ty> &a) {
+    const bool little = []() {
+        const uint16_t w = 1;
+        return *reinterpret_cast<const char *>(&w) == 1;
+    }();
+    string header = "{'descr': '";
+    header += little ? '>' : '<';
+    header += NPArray<Ty>::descr();
+    header += "', 'fortran_order': False, 'shape': (";
+    header += std::to_string(a.rows()) + "," + std::to_string(a.cols()) + ")}";
+    header += string(63 - (header.size() + 10) % 64, ' ');
+    header += '\n';
+
+    std::ofstream os(filename, std::ofstream::binary);
+    ASSERT_TRUE(os);
+    os.write("\x93NUMPY\x01\x00", 8);
+    const char hl[2] = {char(header.size() & 0xFF),
+                        char((header.size() >> 8) & 0xFF)};
+    os.write(hl, 2);
+    os.write(header.c_str(), header.size());
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t c = 0; c < a.cols(); c++) {
+            Ty v = a(r, c);
+            char *p = reinterpret_cast<char *>(&v);
+            std::reverse(p, p + sizeof(Ty));
+            os.write(p, sizeof(Ty));
+        }
+}
+
+template <typename newTy, typename fromTy>
+void testReadAsSwapped(const string &filename) {
+    const vector<fromTy> init = {0, 1, 2, 3, 4, 5, 6, 7, 100, 101, 102, 103};
+    const NPArray<fromTy> a(init, 3, 4);
+    saveWithSwappedEndianness(filename, a);
+
+    // Direct reads do not handle byte swapping.
+    EXPECT_FALSE(NPArray<fromTy>(filename).good());
+
+    const NPArray<newTy> b = NPArray<newTy>::readAs(filename);
+    EXPECT_TRUE(b.good());
+    EXPECT_EQ(b.rows(), 3);
+    EXPECT_EQ(b.cols(), 4);
+    EXPECT_EQ(b, convert<newTy>(a));
+}
+
+TEST_F(NPArrayF, readAsSwapped) {
+    const string tmpFile = getTemporaryFilename(0);
+
+    testReadAsSwapped<uint16_t, uint16_t>(tmpFile);
+    testReadAsSwapped<double, uint16_t>(tmpFile);
+    testReadAsSwapped<double, int16_t>(tmpFile);
+    testReadAsSwapped<float, uint32_t>(tmpFile);
+    testReadAsSwapped<double, int64_t>(tmpFile);
+    testReadAsSwapped<double, float>(tmpFile);
+    testReadAsSwapped<float, double>(tmpFile);
+}
+
+TEST_F(NPArrayF, readAsLarge) {
+    // Use enough elements to require several blocks for the conversion.
+    NPArray<uint16_t> a(1000, 100);
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t c = 0; c < a.cols(); c++)
+            a(r, c) = uint16_t(r * a.cols() + c);
+    ASSERT_TRUE(a.save(getTemporaryFilename()));
+
+    const NPArray<double> b = NPArray<double>::readAs(getTemporaryFilename());
+    EXPECT_TRUE(b.good());
+    EXPECT_EQ(b, convert<double>(a));
+
+    const NPArray<double> c =
+        NPArray<double>::readAs(getTemporaryFilename(), 10);
+    EXPECT_TRUE(c.good());
+    EXPECT_EQ(c.rows(), 10);
+    EXPECT_EQ(c.cols(), 100);
+    for (size_t r = 0; r < c.rows(); r++)
+        for (size_t col = 0; col < c.cols(); col++)
+            EXPECT_EQ(c(r, col), double(a(r, col)));
+}
+
 template <typename newTy, typename fromTy>
 void testViewAs(size_t rows, size_t cols, const vector<fromTy> &init) {
     ASSERT_EQ(init.size(), rows * cols);
@@ -1277,6 +1553,362 @@ TEST(NPArray, viewAs) {
     testViewAs<uint8_t>(6, 8, init16);
 }
 
+TEST(NPArray, views) {
+    const NPArray<int64_t> a(
+        {0, 1, 2, 3, 4, 10, 11, 12, 13, 14, 20, 21, 22, 23, 24, 30, 31, 32,
+         33, 34},
+        4, 5);
+
+    // A view of the complete array.
+    const NPArrayView<int64_t> v = a.view();
+    EXPECT_EQ(v.rows(), a.rows());
+    EXPECT_EQ(v.cols(), a.cols());
+    EXPECT_EQ(v.size(), a.size());
+    EXPECT_FALSE(v.empty());
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t c = 0; c < a.cols(); c++)
+            EXPECT_EQ(v(r, c), a(r, c));
+    EXPECT_EQ(NPArray<int64_t>(v), a);
+
+    // A view of a range of rows and columns.
+    const NPArrayView<int64_t> v1 = a.view(1, 3, 2, 5);
+    EXPECT_EQ(v1.rows(), 2);
+    EXPECT_EQ(v1.cols(), 3);
+    EXPECT_EQ(NPArray<int64_t>(v1),
+              NPArray<int64_t>({12, 13, 14, 22, 23, 24}, 2, 3));
+
+    // Strided views.
+    EXPECT_EQ(NPArray<int64_t>(a.view(0, 4, 0, 5, 2)),
+              NPArray<int64_t>({0, 1, 2, 3, 4, 20, 21, 22, 23, 24}, 2, 5));
+    EXPECT_EQ(NPArray<int64_t>(a.view(1, 4, 0, 5, 2, 3)),
+              NPArray<int64_t>({10, 13, 30, 33}, 2, 2));
+    EXPECT_EQ(NPArray<int64_t>(a.view(0, 3, 1, 4, 1, 2)),
+              NPArray<int64_t>({1, 3, 11, 13, 21, 23}, 3, 2));
+
+    // Sub-views.
+    EXPECT_EQ(NPArray<int64_t>(v1.view(1, 2, 0, 3)),
+              NPArray<int64_t>({22, 23, 24}, 1, 3));
+    EXPECT_EQ(NPArray<int64_t>(a.view(0, 4, 0, 5, 2).view(0, 2, 1, 5, 1, 2)),
+              NPArray<int64_t>({1, 3, 21, 23}, 2, 2));
+
+    // Views from a Window, which gets clamped to the array dimensions.
+    EXPECT_EQ(NPArray<int64_t>(NPArrayView<int64_t>(
+                  a, NPArrayBase::Window(2, 10, 1, 10, 2))),
+              NPArray<int64_t>({21, 23, 31, 33}, 2, 2));
+
+    // Views on memory not owned by an NPArray, e.g. a column major array.
+    const int64_t colMajor[] = {0, 10, 20, 1, 11, 21};
+    EXPECT_EQ(NPArray<int64_t>(NPArrayView<int64_t>(colMajor, 3, 2, 1, 3)),
+              NPArray<int64_t>({0, 1, 10, 11, 20, 21}, 3, 2));
+    EXPECT_TRUE(NPArrayView<int64_t>(colMajor, 0, 2, 1, 3).empty());
+
+    // Empty views.
+    EXPECT_TRUE(a.view(2, 2, 0, 5).empty());
+    EXPECT_TRUE(a.view(0, 4, 3, 3).empty());
+    EXPECT_EQ(a.view(0, 4, 3, 3).rows(), 4);
+    EXPECT_EQ(a.view(0, 4, 3, 3).cols(), 0);
+
+    // Operations on views give the same results as on a copy.
+    const NPArrayView<int64_t> sv = a.view(0, 4, 1, 5, 1, 2);
+    const NPArray<int64_t> sa(sv);
+    Equal<int64_t> equalsOne(1);
+    EXPECT_EQ(sv.all(equalsOne), sa.all(equalsOne));
+    EXPECT_EQ(sv.any(equalsOne), sa.any(equalsOne));
+    EXPECT_EQ(sv.count(equalsOne), sa.count(equalsOne));
+    EXPECT_EQ(sv.count(equalsOne, NPArrayBase::ROW, 0),
+              sa.count(equalsOne, NPArrayBase::ROW, 0));
+    EXPECT_EQ(sv.min(), sa.min());
+    EXPECT_EQ(sv.max(), sa.max());
+    EXPECT_EQ(sv.sum(NPArrayBase::ROW), sa.sum(NPArrayBase::ROW));
+    EXPECT_EQ(sv.sum(NPArrayBase::COLUMN), sa.sum(NPArrayBase::COLUMN));
+    EXPECT_EQ(sv.mean(NPArrayBase::ROW), sa.mean(NPArrayBase::ROW));
+    EXPECT_EQ(sv.mean(NPArrayBase::COLUMN), sa.mean(NPArrayBase::COLUMN));
+    for (NPArrayBase::Axis axis : {NPArrayBase::ROW, NPArrayBase::COLUMN}) {
+        NPArray<double> vvar, vstddev, avar, astddev;
+        EXPECT_EQ(sv.meanWithVar(axis, &vvar, &vstddev, 1),
+                  sa.meanWithVar(axis, &avar, &astddev, 1));
+        EXPECT_EQ(vvar, avar);
+        EXPECT_EQ(vstddev, astddev);
+    }
+}
+
+TEST(NPArray, transpose) {
+    NPArray<uint16_t> a({0, 1, 2, 3, 4, 5}, 2, 3);
+    a.transpose();
+    EXPECT_EQ(a, NPArray<uint16_t>({0, 3, 1, 4, 2, 5}, 3, 2));
+    a.transpose();
+    EXPECT_EQ(a, NPArray<uint16_t>({0, 1, 2, 3, 4, 5}, 2, 3));
+
+    // Vectors only change shape.
+    NPArray<double> v({1.0, 2.0, 3.0}, 1, 3);
+    EXPECT_EQ(v.transpose(), NPArray<double>({1.0, 2.0, 3.0}, 3, 1));
+
+    // Larger than a tile in both directions, and not a multiple of it.
+    NPArray<int32_t> b(45, 71);
+    for (size_t r = 0; r < b.rows(); r++)
+        for (size_t c = 0; c < b.cols(); c++)
+            b(r, c) = int32_t(r * 1000 + c);
+    NPArray<int32_t> t(b);
+    t.transpose();
+    EXPECT_EQ(t.rows(), b.cols());
+    EXPECT_EQ(t.cols(), b.rows());
+    for (size_t r = 0; r < b.rows(); r++)
+        for (size_t c = 0; c < b.cols(); c++)
+            EXPECT_EQ(t(c, r), b(r, c));
+    EXPECT_EQ(t.transpose(), b);
+
+    NPArray<float> e;
+    EXPECT_TRUE(e.transpose().empty());
+}
+
+TEST_F(NPArrayF, fortranOrder) {
+    NPArray<int16_t> a(5, 7);
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t c = 0; c < a.cols(); c++)
+            a(r, c) = int16_t(r * 10 + c);
+    ASSERT_TRUE(a.save(getTemporaryFilename(), /* fortran_order: */ true));
+
+    // The file stores the columns contiguously.
+    std::ifstream ifs(getTemporaryFilename(), std::ifstream::binary);
+    size_t num_rows, num_cols, elt_size;
+    string elt_ty;
+    const char *errstr = nullptr;
+    bool fortran = false;
+    EXPECT_FALSE(NPArrayBase::getInformation(ifs, num_rows, num_cols, elt_ty,
+                                             elt_size, &errstr));
+    EXPECT_NE(errstr, nullptr);
+    ifs.seekg(0);
+    ASSERT_TRUE(NPArrayBase::getInformation(ifs, num_rows, num_cols, elt_ty,
+                                            elt_size, &errstr, nullptr,
+                                            &fortran));
+    EXPECT_TRUE(fortran);
+    EXPECT_EQ(num_rows, 5);
+    EXPECT_EQ(num_cols, 7);
+    vector<int16_t> raw(a.size());
+    ifs.read(reinterpret_cast<char *>(raw.data()), raw.size() * 2);
+    ASSERT_TRUE(ifs.good());
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t c = 0; c < a.cols(); c++)
+            EXPECT_EQ(raw[c * a.rows() + r], a(r, c));
+    ifs.close();
+
+    // Loading gives back the original matrix, whatever the mode or window.
+    for (NPArrayBase::LoadMode mode : {NPArrayBase::READ, NPArrayBase::MMAP}) {
+        const NPArray<int16_t> b(getTemporaryFilename(), -1, mode);
+        EXPECT_TRUE(b.good());
+        EXPECT_FALSE(b.isMapped());
+        EXPECT_EQ(b, a);
+    }
+    const NPArray<int16_t> w(getTemporaryFilename(),
+                             NPArrayBase::Window(1, 4, 1, 7, 3));
+    EXPECT_TRUE(w.good());
+    EXPECT_EQ(w, NPArray<int16_t>({11, 14, 21, 24, 31, 34}, 3, 2));
+    NPArray<double> d =
+        NPArray<double>::readAs(getTemporaryFilename(),
+                                NPArrayBase::Window(1, 4, 1, 7, 3));
+    EXPECT_TRUE(d.good());
+    EXPECT_EQ(d, NPArray<double>({11, 14, 21, 24, 31, 34}, 3, 2));
+    d = NPArray<double>::readAs(getTemporaryFilename());
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t c = 0; c < a.cols(); c++)
+            EXPECT_EQ(d(r, c), double(a(r, c)));
+
+    // Saving back in C order.
+    ASSERT_TRUE(NPArray<int16_t>(getTemporaryFilename())
+                    .save(getTemporaryFilename(1)));
+    EXPECT_EQ(NPArray<int16_t>(getTemporaryFilename(1), -1, NPArrayBase::MMAP),
+              a);
+}
+
+TEST_F(NPArrayF, compressed) {
+    EXPECT_EQ(NPArrayBase::fileFormat("traces.npy"), NPArrayBase::NPY);
+    EXPECT_EQ(NPArrayBase::fileFormat("traces.npz"), NPArrayBase::NPZ);
+    EXPECT_EQ(NPArrayBase::fileFormat("traces.npyz"), NPArrayBase::NPYZ);
+    EXPECT_EQ(NPArrayBase::fileFormat("npz"), NPArrayBase::NPY);
+
+    NPArray<int16_t> a(37, 11);
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t c = 0; c < a.cols(); c++)
+            a(r, c) = int16_t((r * 7 + c * 3) % 29) - 14;
+
+    for (bool npz : {true, false}) {
+        if (npz)
+            ASSERT_TRUE(a.saveNPZ(getTemporaryFilename()));
+        else
+            ASSERT_TRUE(
+                a.saveNPYZ(getTemporaryFilename(), /* block_rows: */ 5));
+
+        // The information is the one of the embedded NPY file.
+        std::ifstream ifs(getTemporaryFilename(), std::ifstream::binary);
+        size_t num_rows, num_cols, elt_size;
+        string elt_ty;
+        const char *errstr = nullptr;
+        ASSERT_TRUE(NPArrayBase::getInformation(ifs, num_rows, num_cols,
+                                                elt_ty, elt_size, &errstr));
+        EXPECT_EQ(num_rows, 37);
+        EXPECT_EQ(num_cols, 11);
+        EXPECT_EQ(elt_size, 2);
+
+        // Compressed files are always read, whatever the mode.
+        for (NPArrayBase::LoadMode mode :
+             {NPArrayBase::READ, NPArrayBase::MMAP}) {
+            const NPArray<int16_t> b(getTemporaryFilename(), -1, mode);
+            EXPECT_TRUE(b.good());
+            EXPECT_FALSE(b.isMapped());
+            EXPECT_EQ(b, a);
+        }
+
+        // Windows, starting and ending in the middle of blocks.
+        const NPArray<int16_t> w(getTemporaryFilename(),
+                                 NPArrayBase::Window(7, 23, 1, 11, 4));
+        EXPECT_TRUE(w.good());
+        EXPECT_EQ(w, NPArray<int16_t>(a.view(7, 23, 1, 11, 1, 4)));
+        const NPArray<int16_t> e(getTemporaryFilename(),
+                                 NPArrayBase::Window(40, 50));
+        EXPECT_TRUE(e.good());
+        EXPECT_EQ(e.rows(), 0);
+        const NPArray<double> d = NPArray<double>::readAs(
+            getTemporaryFilename(), NPArrayBase::Window(30, 37));
+        EXPECT_TRUE(d.good());
+        for (size_t r = 0; r < d.rows(); r++)
+            for (size_t c = 0; c < d.cols(); c++)
+                EXPECT_EQ(d(r, c), double(a(r + 30, c)));
+
+        // Chunked reads.
+        NPYChunkReader<int16_t> reader(getTemporaryFilename(), 8);
+        NPArray<int16_t> chunks(0, a.cols());
+        while (reader.next())
+            chunks.extend(reader.chunk(), NPArrayBase::COLUMN);
+        EXPECT_TRUE(reader.good());
+        EXPECT_EQ(chunks, a);
+    }
+
+    // Fortran order NPZ.
+    ASSERT_TRUE(a.saveNPZ(getTemporaryFilename(), /* fortran_order: */ true));
+    EXPECT_EQ(NPArray<int16_t>(getTemporaryFilename()), a);
+
+    // Default block size, and empty matrices.
+    ASSERT_TRUE(a.saveNPYZ(getTemporaryFilename()));
+    EXPECT_EQ(NPArray<int16_t>(getTemporaryFilename()), a);
+    const NPArray<float> z(0, 4);
+    ASSERT_TRUE(z.saveNPYZ(getTemporaryFilename()));
+    const NPArray<float> zy(getTemporaryFilename());
+    EXPECT_TRUE(zy.good());
+    EXPECT_EQ(zy.rows(), 0);
+    ASSERT_TRUE(z.saveNPZ(getTemporaryFilename()));
+    const NPArray<float> zz(getTemporaryFilename());
+    EXPECT_TRUE(zz.good());
+    EXPECT_EQ(zz.rows(), 0);
+
+    // Corrupted files.
+    ASSERT_TRUE(a.saveNPYZ(getTemporaryFilename()));
+    {
+        std::fstream f(getTemporaryFilename(),
+                       std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(-10, std::ios::end);
+        f.write("corrupted!", 10);
+    }
+    const NPArray<int16_t> c(getTemporaryFilename());
+    EXPECT_FALSE(c.good());
+    EXPECT_NE(c.error(), nullptr);
+    ASSERT_TRUE(a.saveNPZ(getTemporaryFilename()));
+    {
+        std::fstream f(getTemporaryFilename(),
+                       std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(60);
+        f.write("corrupted!", 10);
+    }
+    EXPECT_FALSE(NPArray<int16_t>(getTemporaryFilename()).good());
+}
+
+TEST_F(NPArrayF, tiled) {
+    EXPECT_EQ(NPArrayBase::fileFormat("traces.npyt"), NPArrayBase::NPYT);
+
+    NPArray<double> a(37, 23);
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t c = 0; c < a.cols(); c++)
+            a(r, c) = double(r * 100 + c);
+
+    for (bool compress : {true, false}) {
+        // Tiles of 8 x 5 elements, with partial tiles on the last row and
+        // column of the tiles grid.
+        ASSERT_TRUE(a.saveNPYT(getTemporaryFilename(), 8, 5, compress));
+
+        // The information is the one of the embedded NPY file.
+        std::ifstream ifs(getTemporaryFilename(), std::ifstream::binary);
+        size_t num_rows, num_cols, elt_size;
+        string elt_ty;
+        const char *errstr = nullptr;
+        ASSERT_TRUE(NPArrayBase::getInformation(ifs, num_rows, num_cols,
+                                                elt_ty, elt_size, &errstr));
+        EXPECT_EQ(num_rows, 37);
+        EXPECT_EQ(num_cols, 23);
+        EXPECT_EQ(elt_ty, "f8");
+
+        const NPArray<double> b(getTemporaryFilename(), -1, NPArrayBase::MMAP);
+        EXPECT_TRUE(b.good());
+        EXPECT_FALSE(b.isMapped());
+        EXPECT_EQ(b, a);
+
+        // Sample windows, trace subsets, and both, starting and ending in
+        // the middle of tiles.
+        for (const NPArrayBase::Window &win :
+             {NPArrayBase::Window(0, -1, 7, 13), NPArrayBase::Window(9, 30),
+              NPArrayBase::Window(3, 17, 4, 21, 3),
+              // With a stride skipping tiles columns.
+              NPArrayBase::Window(0, 37, 1, 23, 11),
+              NPArrayBase::Window(36, 37, 22, 23)}) {
+            const NPArray<double> w(getTemporaryFilename(), win);
+            EXPECT_TRUE(w.good());
+            const NPArrayBase::Window cw = win.clamp(a.rows(), a.cols());
+            EXPECT_EQ(w, NPArray<double>(a.view(cw.rowBegin, cw.rowEnd,
+                                                cw.colBegin, cw.colEnd, 1,
+                                                cw.colStride)));
+        }
+        const NPArray<double> e(getTemporaryFilename(),
+                                NPArrayBase::Window(40, 50));
+        EXPECT_TRUE(e.good());
+        EXPECT_EQ(e.rows(), 0);
+        const NPArray<float> f = NPArray<float>::readAs(
+            getTemporaryFilename(), NPArrayBase::Window(30, 37, 20));
+        EXPECT_TRUE(f.good());
+        for (size_t r = 0; r < f.rows(); r++)
+            for (size_t c = 0; c < f.cols(); c++)
+                EXPECT_EQ(f(r, c), float(a(r + 30, c + 20)));
+
+        // Chunked reads.
+        NPYChunkReader<double> reader(getTemporaryFilename(), 8,
+                                      NPArrayBase::Window(0, -1, 10, 15));
+        NPArray<double> chunks(0, 5);
+        while (reader.next())
+            chunks.extend(reader.chunk(), NPArrayBase::COLUMN);
+        EXPECT_TRUE(reader.good());
+        EXPECT_EQ(chunks, NPArray<double>(a.view(0, 37, 10, 15)));
+    }
+
+    // Default tile size, integer elements, and empty matrices.
+    NPArray<int16_t> i(a.rows(), a.cols());
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t c = 0; c < a.cols(); c++)
+            i(r, c) = int16_t(a(r, c)) - 1000;
+    ASSERT_TRUE(i.saveNPYT(getTemporaryFilename()));
+    EXPECT_EQ(NPArray<int16_t>(getTemporaryFilename()), i);
+    const NPArray<float> z(0, 4);
+    ASSERT_TRUE(z.saveNPYT(getTemporaryFilename()));
+    const NPArray<float> zt(getTemporaryFilename());
+    EXPECT_TRUE(zt.good());
+    EXPECT_EQ(zt.rows(), 0);
+
+    // Truncated files.
+    ASSERT_TRUE(a.saveNPYT(getTemporaryFilename(), 8, 5));
+    std::filesystem::resize_file(
+        getTemporaryFilename(),
+        std::filesystem::file_size(getTemporaryFilename()) - 10);
+    const NPArray<double> c(getTemporaryFilename());
+    EXPECT_FALSE(c.good());
+    EXPECT_NE(c.error(), nullptr);
+}
+
 TEST_F(NPArrayF, saveAndRestore) {
     // Save NPArray.
     const int64_t MI64_init[] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
@@ -1316,6 +1948,111 @@ TEST_F(NPArrayF, readFromFile) {
             EXPECT_EQ(a(r, c), init[r * a.cols() + c]);
 }
 
+TEST_F(NPArrayF, mapFromFile) {
+    const uint32_t init[] = {0, 1, 2, 3, 4, 5, 6, 7};
+    NPArray<uint32_t> a(init, 2, 4);
+    ASSERT_TRUE(a.save(getTemporaryFilename()));
+    EXPECT_FALSE(a.isMapped());
+
+    NPArray<uint32_t> b(getTemporaryFilename(), -1, NPArrayBase::MMAP);
+    EXPECT_TRUE(b.good());
+    EXPECT_TRUE(b.isMapped());
+    EXPECT_EQ(b.rows(), 2);
+    EXPECT_EQ(b.cols(), 4);
+    EXPECT_EQ(b.elementSize(), sizeof(init[0]));
+    EXPECT_EQ(a, b);
+
+    // Only map a subset of the rows.
+    NPArray<uint32_t> c(getTemporaryFilename(), 1, NPArrayBase::MMAP);
+    EXPECT_TRUE(c.good());
+    EXPECT_TRUE(c.isMapped());
+    EXPECT_EQ(c.rows(), 1);
+    EXPECT_EQ(c.cols(), 4);
+    EXPECT_EQ(c, NPArray<uint32_t>(init, 1, 4));
+
+    // Modifications are private to the mapping.
+    b(1, 3) = 42;
+    EXPECT_EQ(b(1, 3), 42);
+    EXPECT_EQ(NPArray<uint32_t>(getTemporaryFilename()), a);
+
+    // Copies and structural changes do not use the mapping.
+    NPArray<uint32_t> d(b);
+    EXPECT_FALSE(d.isMapped());
+    EXPECT_EQ(d, b);
+    NPArray<uint32_t> e(std::move(b));
+    EXPECT_TRUE(e.isMapped());
+    e.insertRow(1);
+    EXPECT_FALSE(e.isMapped());
+    EXPECT_EQ(e.rows(), 3);
+    EXPECT_EQ(e(2, 3), 42);
+
+    // Type mismatch.
+    NPArray<uint16_t> f(getTemporaryFilename(), -1, NPArrayBase::MMAP);
+    EXPECT_FALSE(f.good());
+    EXPECT_FALSE(f.isMapped());
+}
+
+TEST_F(NPArrayF, readWindowFromFile) {
+    const uint16_t init[] = {0,  1,  2,  3,  4,  5,  6,  7,  8,  9,
+                             10, 11, 12, 13, 14, 15, 16, 17, 18, 19};
+    NPArray<uint16_t> a(init, 4, 5);
+    ASSERT_TRUE(a.save(getTemporaryFilename()));
+
+    // The default window covers the complete matrix.
+    EXPECT_EQ(NPArray<uint16_t>(getTemporaryFilename(), NPArrayBase::Window()),
+              a);
+
+    // A range of rows.
+    NPArray<uint16_t> b(getTemporaryFilename(), NPArrayBase::Window(1, 3));
+    EXPECT_TRUE(b.good());
+    EXPECT_EQ(b, NPArray<uint16_t>({5, 6, 7, 8, 9, 10, 11, 12, 13, 14}, 2, 5));
+
+    // A range of columns.
+    NPArray<uint16_t> c(getTemporaryFilename(),
+                        NPArrayBase::Window(0, -1, 1, 3));
+    EXPECT_TRUE(c.good());
+    EXPECT_EQ(c, NPArray<uint16_t>({1, 2, 6, 7, 11, 12, 16, 17}, 4, 2));
+
+    // A range of rows and columns, with a stride.
+    NPArray<uint16_t> d(getTemporaryFilename(),
+                        NPArrayBase::Window(2, 4, 0, 5, 2));
+    EXPECT_TRUE(d.good());
+    EXPECT_EQ(d, NPArray<uint16_t>({10, 12, 14, 15, 17, 19}, 2, 3));
+
+    // Windows get clamped to the matrix dimensions.
+    NPArray<uint16_t> e(getTemporaryFilename(),
+                        NPArrayBase::Window(3, 10, 3, 10));
+    EXPECT_TRUE(e.good());
+    EXPECT_EQ(e, NPArray<uint16_t>({18, 19}, 1, 2));
+    NPArray<uint16_t> f(getTemporaryFilename(),
+                        NPArrayBase::Window(0, -1, 6, -1));
+    EXPECT_TRUE(f.good());
+    EXPECT_EQ(f.rows(), 4);
+    EXPECT_EQ(f.cols(), 0);
+
+    // Row windows can be mapped, other windows are read.
+    NPArray<uint16_t> g(getTemporaryFilename(), NPArrayBase::Window(2, 3),
+                        NPArrayBase::MMAP);
+    EXPECT_TRUE(g.good());
+    EXPECT_TRUE(g.isMapped());
+    EXPECT_EQ(g, NPArray<uint16_t>({10, 11, 12, 13, 14}, 1, 5));
+    NPArray<uint16_t> h(getTemporaryFilename(),
+                        NPArrayBase::Window(2, 3, 1, 3), NPArrayBase::MMAP);
+    EXPECT_TRUE(h.good());
+    EXPECT_FALSE(h.isMapped());
+    EXPECT_EQ(h, NPArray<uint16_t>({11, 12}, 1, 2));
+
+    // Windows with a conversion.
+    NPArray<double> i = NPArray<double>::readAs(
+        getTemporaryFilename(), NPArrayBase::Window(1, 3, 1, 5, 3));
+    EXPECT_TRUE(i.good());
+    EXPECT_EQ(i, NPArray<double>({6, 9, 11, 14}, 2, 2));
+    NPArray<double> j = NPArray<double>::readAs(
+        getTemporaryFilename(), NPArrayBase::Window(0, 2, 2, 4));
+    EXPECT_TRUE(j.good());
+    EXPECT_EQ(j, NPArray<double>({2, 3, 7, 8}, 2, 2));
+}
+
 TEST(NPArray, Row) {
     const int64_t MI64_init[] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
     NPArray<int64_t> a(MI64_init, 3, 3);
@@ -1475,6 +2212,40 @@ TEST(NPArray, sqrt) {
     sqrtCheck<double>();
 }
 
+template <typename Ty> void hammingCheck() {
+    const Ty init[] = {0x00, 0x0F, 0xA5, 0xFF};
+    const Ty hw[] = {0, 4, 4, 8};
+    const Ty hwMasked[] = {0, 0, 2, 4};
+    const Ty hdScalar[] = {2, 2, 4, 6};
+
+    NPArray<Ty> a(init, 2, 2);
+    EXPECT_EQ(a.hammingWeight(), NPArray<Ty>(hw, 2, 2));
+    NPArray<Ty> b(init, 2, 2);
+    EXPECT_EQ(b.hammingWeight(0xF0), NPArray<Ty>(hwMasked, 2, 2));
+    NPArray<Ty> c(init, 2, 2);
+    EXPECT_EQ(c.hammingDistance(Ty(0x03)), NPArray<Ty>(hdScalar, 2, 2));
+    NPArray<Ty> d(init, 2, 2);
+    EXPECT_EQ(d.hammingDistance(NPArray<Ty>(init, 2, 2)),
+              NPArray<Ty>::zeros(2, 2));
+
+    NPArray<Ty> e(init, 2, 2);
+    EXPECT_EQ(e.hammingDistance(NPArray<Ty>({0x01, 0xF0}, 1, 2)),
+              NPArray<Ty>({1, 8, 3, 4}, 2, 2));
+    NPArray<Ty> row({0x00, 0x03, 0x0F, 0xFF}, 1, 4);
+    EXPECT_EQ(row.hammingDistance(Ty(0), 0x0F),
+              NPArray<Ty>({0, 2, 4, 4}, 1, 4));
+}
+
+TEST(NPArray, hamming) {
+    hammingCheck<uint8_t>();
+    hammingCheck<uint16_t>();
+    hammingCheck<uint32_t>();
+    hammingCheck<uint64_t>();
+
+    NPArray<uint64_t> a({0xFFFFFFFF00000001ULL, 0x8000000000000000ULL}, 1, 2);
+    EXPECT_EQ(a.hammingWeight(), NPArray<uint64_t>({33, 1}, 1, 2));
+}
+
 template <typename Ty> void logCheck() {
     const Ty init[] = {4, 9, 16};
     const Ty expect[] = {Ty(std::log(Ty(4))), Ty(std::log(Ty(9))),
@@ -2008,6 +2779,183 @@ TEST(NPArray, eltWiseAbsDiff) {
     EXPECT_TRUE(EltWiseAbsDiffChecker<double>().check());
 }
 
+namespace {
+// Check the element-wise operations on arrays large enough to exercise the
+// vectorized loops, including their remainders, in all broadcast cases.
+template <typename Ty, template <typename> class Op> void checkLargeApply() {
+    constexpr size_t R = 7;
+    constexpr size_t C = 37;
+    NPArray<Ty> m(R, C);
+    for (size_t r = 0; r < R; r++)
+        for (size_t c = 0; c < C; c++)
+            m(r, c) = Ty((r * C + c) % 50 + 1);
+    NPArray<Ty> hv(1, C);
+    for (size_t c = 0; c < C; c++)
+        hv(0, c) = Ty(c % 5 + 1);
+    NPArray<Ty> vv(R, 1);
+    for (size_t r = 0; r < R; r++)
+        vv(r, 0) = Ty(r + 1);
+    NPArray<Ty> s({Ty(3)}, 1, 1);
+
+    const Op<Ty> op;
+    const auto check = [&](const NPArray<Ty> &lhs, const NPArray<Ty> &rhs) {
+        NPArray<Ty> res(lhs);
+        res.apply(op, rhs);
+        ASSERT_EQ(res.rows(), std::max(lhs.rows(), rhs.rows()));
+        ASSERT_EQ(res.cols(), std::max(lhs.cols(), rhs.cols()));
+        for (size_t r = 0; r < res.rows(); r++)
+            for (size_t c = 0; c < res.cols(); c++)
+                EXPECT_EQ(res(r, c),
+                          op(lhs(lhs.rows() == 1 ? 0 : r,
+                                 lhs.cols() == 1 ? 0 : c),
+                             rhs(rhs.rows() == 1 ? 0 : r,
+                                 rhs.cols() == 1 ? 0 : c)));
+    };
+
+    for (NPArray<Ty> *rhs : {&m, &hv, &vv, &s})
+        check(m, *rhs);
+    for (NPArray<Ty> *lhs : {&hv, &vv, &s})
+        check(*lhs, m);
+    check(hv, hv);
+    check(vv, vv);
+    check(hv, s);
+    check(vv, s);
+    check(s, hv);
+    check(s, vv);
+
+    // Scalar operand.
+    NPArray<Ty> res(m);
+    res.apply(op, Ty(2));
+    for (size_t r = 0; r < R; r++)
+        for (size_t c = 0; c < C; c++)
+            EXPECT_EQ(res(r, c), op(m(r, c), Ty(2)));
+}
+
+template <template <typename> class Op> void checkLargeApply() {
+    checkLargeApply<uint8_t, Op>();
+    checkLargeApply<int16_t, Op>();
+    checkLargeApply<uint32_t, Op>();
+    checkLargeApply<int64_t, Op>();
+    checkLargeApply<float, Op>();
+    checkLargeApply<double, Op>();
+}
+} // namespace
+
+TEST(NPArray, eltWiseLarge) {
+    checkLargeApply<Add>();
+    checkLargeApply<Substract>();
+    checkLargeApply<Multiply>();
+    checkLargeApply<Divide>();
+    checkLargeApply<AbsDiff>();
+
+    // Unary operations.
+    NPArray<double> a(5, 41);
+    for (size_t i = 0; i < a.size(); i++)
+        a(i / a.cols(), i % a.cols()) = double(i) - 100.0;
+    NPArray<double> b(a);
+    b.abs();
+    NPArray<double> c(a);
+    c.negate();
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t col = 0; col < a.cols(); col++) {
+            EXPECT_EQ(b(r, col), std::abs(a(r, col)));
+            EXPECT_EQ(c(r, col), -a(r, col));
+        }
+    b.sqrt();
+    c = b;
+    c.log();
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t col = 0; col < a.cols(); col++) {
+            EXPECT_EQ(b(r, col), std::sqrt(std::abs(a(r, col))));
+            EXPECT_EQ(c(r, col), std::log(b(r, col)));
+        }
+
+    // Operations on empty arrays are no-ops.
+    NPArray<float> e;
+    e += 1.0f;
+    e.negate();
+    EXPECT_TRUE(e.empty());
+}
+
+TEST(NPArray, expressions) {
+    const NPArray<double> a({1, 2, 3, 4, 5, 6}, 2, 3);
+    const NPArray<double> b({6, 5, 4, 3, 2, 1}, 2, 3);
+    const NPArray<double> row({1, 2, 4}, 1, 3);
+    const NPArray<double> col({2, 8}, 2, 1);
+
+    // Expressions are evaluated when assigned to an NPArray, with the same
+    // results as the eager operations.
+    NPArray<double> e = (expr(a) - b) / sqrt(expr(a) * b + 1.0);
+    EXPECT_EQ(e, (a - b) / sqrt(a * b + 1.0));
+
+    // Broadcasting, with scalars on either side.
+    EXPECT_EQ(expr(a) + row, NPArray<double>({2, 4, 7, 5, 7, 10}, 2, 3));
+    EXPECT_EQ(col * expr(a), NPArray<double>({2, 4, 6, 32, 40, 48}, 2, 3));
+    EXPECT_EQ(10.0 - expr(a), NPArray<double>({9, 8, 7, 6, 5, 4}, 2, 3));
+    EXPECT_EQ(absdiff(expr(a), 3.5) * 2.0,
+              NPArray<double>({5, 3, 1, 1, 3, 5}, 2, 3));
+    EXPECT_EQ(negate(abs(expr(b) - a)), -1.0 * abs(a - b));
+
+    // Temporary operands are owned by the expression.
+    const auto f = log(expr(NPArray<double>(a)) + NPArray<double>(b));
+    const double l7 = std::log(7.0);
+    EXPECT_EQ(f, NPArray<double>({l7, l7, l7, l7, l7, l7}, 2, 3));
+
+    // Views can be used as operands.
+    EXPECT_EQ(expr(a.view(0, 2, 1, 3)) * b.view(0, 2, 0, 2),
+              NPArray<double>({12, 15, 15, 12}, 2, 2));
+
+    // Collectors can be used directly on expressions.
+    EXPECT_EQ((expr(a) - b).max(), 5.0);
+    EXPECT_EQ((expr(a) - b).min(), -5.0);
+    EXPECT_EQ((expr(a) * b).mean(NPArrayBase::ROW),
+              NPArray<double>({(6. + 10 + 12) / 3, (12. + 10 + 6) / 3}, 1, 2));
+
+    // Assignment evaluates the expression before overwriting the operands.
+    NPArray<double> g(a);
+    g = expr(g) * g + g;
+    EXPECT_EQ(g, NPArray<double>({2, 6, 12, 20, 30, 42}, 2, 3));
+
+    // Integral types.
+    const NPArray<uint8_t> u({1, 2, 200, 250}, 2, 2);
+    EXPECT_EQ(absdiff(expr(u), NPArray<uint8_t>({3, 3, 3, 3}, 2, 2)),
+              NPArray<uint8_t>({2, 1, 197, 247}, 2, 2));
+    EXPECT_EQ(expr(u) + uint8_t(10),
+              NPArray<uint8_t>({11, 12, 210, 4}, 2, 2));
+}
+
+TEST(NPArray, parallelFold) {
+    // Large enough to be split between threads.
+    NPArray<double> a(300, 700);
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t c = 0; c < a.cols(); c++)
+            a(r, c) = std::sin(double(r * a.cols() + c));
+
+    NPArray<double> v1, s1;
+    const NPArray<double> m1 = a.meanWithVar(NPArrayBase::COLUMN, &v1, &s1, 1);
+    const NPArray<double> m1r = a.meanWithVar(NPArrayBase::ROW, 5, 295, &v1);
+    const NPArray<double> max1 = a.fold(Max<double>(), NPArrayBase::COLUMN);
+    const NPArray<double> min1 = a.fold(Min<double>(), NPArrayBase::ROW);
+    const NPArray<double> sum1 = a.sum(NPArrayBase::COLUMN, 3, 600);
+
+    // The results must be the same, whatever the number of threads.
+    for (unsigned num_threads : {2, 5, 16}) {
+        NPArrayBase::setNumThreads(num_threads);
+        NPArray<double> vn, sn;
+        EXPECT_EQ(a.meanWithVar(NPArrayBase::COLUMN, &vn, &sn, 1), m1);
+        EXPECT_EQ(sn, s1);
+        EXPECT_EQ(a.meanWithVar(NPArrayBase::ROW, 5, 295, &vn), m1r);
+        EXPECT_EQ(vn, v1);
+        EXPECT_EQ(a.fold(Max<double>(), NPArrayBase::COLUMN), max1);
+        EXPECT_EQ(a.fold(Min<double>(), NPArrayBase::ROW), min1);
+        EXPECT_EQ(a.sum(NPArrayBase::COLUMN, 3, 600), sum1);
+        EXPECT_EQ(a.view(0, 300, 1, 700, 1, 2).mean(NPArrayBase::COLUMN),
+                  NPArray<double>(a.view(0, 300, 1, 700, 1, 2))
+                      .mean(NPArrayBase::COLUMN));
+    }
+    NPArrayBase::setNumThreads(1);
+}
+
 TEST(NPArray, all) {
     const int64_t init[] = {1, 1, 1, 1, 1, 1, 1, 1, 0};
     NPArray<int64_t> a(init, 3, 3);
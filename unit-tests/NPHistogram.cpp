@@ -0,0 +1,146 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/NPHistogram.h"
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using namespace PAF::SCA;
+
+using std::vector;
+
+TEST(MinMaxCount, basic) {
+    MinMaxCount<double> E;
+    EXPECT_EQ(E.count(), 0);
+
+    const vector<double> v{1.0, -2.0, 3.0, 3.0, -2.0, 0.5, -2.0};
+    MinMaxCount<double> M;
+    M.add(v.data(), v.size());
+    EXPECT_EQ(M.count(), v.size());
+    EXPECT_EQ(M.min(), -2.0);
+    EXPECT_EQ(M.minCount(), 3);
+    EXPECT_EQ(M.max(), 3.0);
+    EXPECT_EQ(M.maxCount(), 2);
+
+    // Negative only values.
+    const vector<float> n{-1.0f, -3.0f, -1.0f};
+    MinMaxCount<float> N;
+    N.add(n.data(), n.size());
+    EXPECT_EQ(N.min(), -3.0f);
+    EXPECT_EQ(N.minCount(), 1);
+    EXPECT_EQ(N.max(), -1.0f);
+    EXPECT_EQ(N.maxCount(), 2);
+
+    // A single value is both the minimum and the maximum.
+    const int8_t s = -5;
+    MinMaxCount<int8_t> S;
+    S.add(&s, 1);
+    EXPECT_EQ(S.min(), -5);
+    EXPECT_EQ(S.max(), -5);
+    EXPECT_EQ(S.minCount(), 1);
+    EXPECT_EQ(S.maxCount(), 1);
+}
+
+TEST(MinMaxCount, merge) {
+    // Enough values to span several blocks.
+    vector<int16_t> v(10000);
+    for (size_t i = 0; i < v.size(); i++)
+        v[i] = int16_t(std::lround(1000.0 * std::sin(double(i))));
+
+    MinMaxCount<int16_t> All;
+    All.add(v.data(), v.size());
+
+    size_t min_cnt = 0;
+    size_t max_cnt = 0;
+    for (const auto &x : v) {
+        min_cnt += x == -1000;
+        max_cnt += x == 1000;
+    }
+    EXPECT_EQ(All.count(), v.size());
+    EXPECT_EQ(All.min(), -1000);
+    EXPECT_EQ(All.minCount(), min_cnt);
+    EXPECT_EQ(All.max(), 1000);
+    EXPECT_EQ(All.maxCount(), max_cnt);
+
+    // Merging partial results, in any order, gives the same result.
+    MinMaxCount<int16_t> P0;
+    MinMaxCount<int16_t> P1;
+    P0.add(v.data(), 1234);
+    P1.add(v.data() + 1234, v.size() - 1234);
+    MinMaxCount<int16_t> Merged;
+    Merged += P1;
+    Merged += MinMaxCount<int16_t>();
+    Merged += P0;
+    EXPECT_EQ(Merged.count(), All.count());
+    EXPECT_EQ(Merged.min(), All.min());
+    EXPECT_EQ(Merged.minCount(), All.minCount());
+    EXPECT_EQ(Merged.max(), All.max());
+    EXPECT_EQ(Merged.maxCount(), All.maxCount());
+}
+
+TEST(NPHistogram, codes) {
+    NPHistogram<int8_t> H;
+    EXPECT_EQ(H.size(), 256);
+    EXPECT_EQ(H.binLow(0), -128.0);
+    EXPECT_EQ(H.binLow(255), 127.0);
+
+    const vector<int8_t> v{-128, 0, 0, 127, 5, 0};
+    H.add(v.data(), v.size());
+    EXPECT_EQ(H[0], 1);
+    EXPECT_EQ(H[128], 3);
+    EXPECT_EQ(H[133], 1);
+    EXPECT_EQ(H[255], 1);
+    EXPECT_EQ(H.below(), 0);
+    EXPECT_EQ(H.above(), 0);
+
+    NPHistogram<uint16_t> U;
+    EXPECT_EQ(U.size(), 65536);
+    const uint16_t u = 65535;
+    U.add(&u, 1);
+    EXPECT_EQ(U[65535], 1);
+}
+
+TEST(NPHistogram, bins) {
+    NPHistogram<double> H(-0.5, 0.5, 4);
+    EXPECT_EQ(H.size(), 4);
+    EXPECT_EQ(H.binLow(0), -0.5);
+    EXPECT_EQ(H.binLow(2), 0.0);
+
+    const vector<double> v{-0.5, -0.3, 0.0, 0.1, 0.26, 0.49, 0.5, -0.6, NAN};
+    H.add(v.data(), v.size());
+    EXPECT_EQ(H[0], 2);
+    EXPECT_EQ(H[1], 0);
+    EXPECT_EQ(H[2], 2);
+    EXPECT_EQ(H[3], 2);
+    EXPECT_EQ(H.below(), 2);
+    EXPECT_EQ(H.above(), 1);
+
+    NPHistogram<double> G(-0.5, 0.5, 4);
+    G.add(v.data(), 2);
+    G += H;
+    EXPECT_EQ(G[0], 4);
+    EXPECT_EQ(G[3], 2);
+    EXPECT_EQ(G.below(), 2);
+    EXPECT_EQ(G.above(), 1);
+}
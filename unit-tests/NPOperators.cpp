@@ -34,6 +34,8 @@ using PAF::SCA::Divide;
 using PAF::SCA::Equal;
 using PAF::SCA::Greater;
 using PAF::SCA::GreaterOrEqual;
+using PAF::SCA::HammingDistance;
+using PAF::SCA::HammingWeight;
 using PAF::SCA::Less;
 using PAF::SCA::LessOrEqual;
 using PAF::SCA::Log;
@@ -48,6 +50,7 @@ using PAF::SCA::Negate;
 using PAF::SCA::NotEqual;
 using PAF::SCA::NPArray;
 using PAF::SCA::NPArrayBase;
+using PAF::SCA::popcount;
 using PAF::SCA::Sqrt;
 using PAF::SCA::Substract;
 
@@ -646,6 +649,37 @@ TEST(NPCollector, AveragerWithVar) {
     EXPECT_EQ(avg0.stddev(), std::sqrt(0.5));
 }
 
+TEST(NPCollector, AveragerWithVarMerge) {
+    MeanWithVar<double> avg0;
+    MeanWithVar<double> avg1;
+    MeanWithVar<double> all;
+    for (const double &d : {3.0, 2.0, 3.0}) {
+        avg0(d);
+        all(d);
+    }
+    for (const double &d : {4.0, 7.0}) {
+        avg1(d);
+        all(d);
+    }
+    avg0.merge(avg1);
+    EXPECT_EQ(avg0.count(), 5);
+    EXPECT_DOUBLE_EQ(avg0.value(), all.value());
+    EXPECT_DOUBLE_EQ(avg0.var(), all.var());
+    EXPECT_DOUBLE_EQ(avg0.m2(), all.m2());
+
+    // Merging empty statistics is a no-op.
+    avg0.merge(MeanWithVar<double>());
+    EXPECT_EQ(avg0.count(), 5);
+    MeanWithVar<double> e;
+    e.merge(MeanWithVar<double>());
+    EXPECT_EQ(e.count(), 0);
+
+    // Restoring the state.
+    const MeanWithVar<double> r(avg0.count(), avg0.value(), avg0.m2());
+    EXPECT_EQ(r.count(), 5);
+    EXPECT_EQ(r.var(1), avg0.var(1));
+}
+
 template <typename Ty> bool checkAbs() {
     Abs<Ty> abs;
     EXPECT_EQ(abs(Ty(5)), Ty(5));
@@ -866,3 +900,74 @@ TEST(NPOperator, Absdiff) {
     EXPECT_TRUE(checkAbsdiff<float>());
     EXPECT_TRUE(checkAbsdiff<double>());
 }
+
+template <typename Ty> bool checkPopcount() {
+    EXPECT_EQ(popcount<Ty>(0), 0);
+    EXPECT_EQ(popcount<Ty>(1), 1);
+    EXPECT_EQ(popcount<Ty>(0xA5), 4);
+    EXPECT_EQ(popcount<Ty>(std::numeric_limits<Ty>::max()), 8 * sizeof(Ty));
+    EXPECT_EQ(popcount<Ty>(Ty(std::numeric_limits<Ty>::max() - 1)),
+              8 * sizeof(Ty) - 1);
+    EXPECT_EQ(popcount<Ty>(Ty(Ty(1) << (8 * sizeof(Ty) - 1)) | 1), 2);
+
+    return !testing::Test::HasFatalFailure() &&
+           !testing::Test::HasNonfatalFailure();
+}
+
+TEST(NPOperator, popcount) {
+    EXPECT_TRUE(checkPopcount<uint8_t>());
+    EXPECT_TRUE(checkPopcount<uint16_t>());
+    EXPECT_TRUE(checkPopcount<uint32_t>());
+    EXPECT_TRUE(checkPopcount<uint64_t>());
+}
+
+template <typename Ty> bool checkHammingWeight() {
+    HammingWeight<Ty> hw;
+    EXPECT_EQ(hw(Ty(0)), Ty(0));
+    EXPECT_EQ(hw(Ty(0xA5)), Ty(4));
+    EXPECT_EQ(hw(std::numeric_limits<Ty>::max()), Ty(8 * sizeof(Ty)));
+
+    HammingWeight<Ty> hwm(0x0F);
+    EXPECT_EQ(hwm(Ty(0xA5)), Ty(2));
+    EXPECT_EQ(hwm(std::numeric_limits<Ty>::max()), Ty(4));
+
+    return !testing::Test::HasFatalFailure() &&
+           !testing::Test::HasNonfatalFailure();
+}
+
+TEST(NPOperator, HammingWeight) {
+    EXPECT_TRUE(checkHammingWeight<uint8_t>());
+    EXPECT_TRUE(checkHammingWeight<uint16_t>());
+    EXPECT_TRUE(checkHammingWeight<uint32_t>());
+    EXPECT_TRUE(checkHammingWeight<uint64_t>());
+
+    // Check all 64 bits are accounted for.
+    EXPECT_EQ(HammingWeight<uint64_t>()(0xFFFFFFFF00000001ULL), 33);
+    EXPECT_EQ(HammingWeight<uint64_t>(0xFF00000000000000ULL)(
+                  0xF0F0F0F0F0F0F0F0ULL),
+              4);
+}
+
+template <typename Ty> bool checkHammingDistance() {
+    HammingDistance<Ty> hd;
+    EXPECT_EQ(hd(Ty(0x5A), Ty(0x5A)), Ty(0));
+    EXPECT_EQ(hd(Ty(0xA5), Ty(0x5A)), Ty(8));
+    EXPECT_EQ(hd(Ty(0), std::numeric_limits<Ty>::max()), Ty(8 * sizeof(Ty)));
+
+    HammingDistance<Ty> hdm(0xF0);
+    EXPECT_EQ(hdm(Ty(0xA5), Ty(0x5A)), Ty(4));
+    EXPECT_EQ(hdm(Ty(0xA5), Ty(0xAF)), Ty(0));
+
+    return !testing::Test::HasFatalFailure() &&
+           !testing::Test::HasNonfatalFailure();
+}
+
+TEST(NPOperator, HammingDistance) {
+    EXPECT_TRUE(checkHammingDistance<uint8_t>());
+    EXPECT_TRUE(checkHammingDistance<uint16_t>());
+    EXPECT_TRUE(checkHammingDistance<uint32_t>());
+    EXPECT_TRUE(checkHammingDistance<uint64_t>());
+
+    // Check all 64 bits are accounted for.
+    EXPECT_EQ(HammingDistance<uint64_t>()(0x8000000000000000ULL, 1), 2);
+}
@@ -0,0 +1,156 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/NPYChunkReader.h"
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/SCA.h"
+
+#include "paf-unit-testing.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace PAF::SCA;
+
+using std::string;
+using std::vector;
+
+// Create the test fixture for NPYChunkReader.
+TEST_WITH_TEMP_FILE(NPYChunkReaderF, "test-NPYChunkReader.npy.XXXXXX");
+
+namespace {
+// Read all chunks from reader and check they match expected.
+void checkChunks(NPYChunkReader<double> &reader,
+                 const NPArray<double> &expected, size_t chunk_size) {
+    EXPECT_TRUE(reader.good());
+    EXPECT_EQ(reader.rows(), expected.rows());
+    EXPECT_EQ(reader.cols(), expected.cols());
+    EXPECT_EQ(reader.chunkSize(), chunk_size);
+    EXPECT_EQ(reader.numChunks(),
+              (expected.rows() + chunk_size - 1) / chunk_size);
+
+    size_t num_chunks = 0;
+    size_t row = 0;
+    while (reader.next()) {
+        EXPECT_EQ(reader.chunkBegin(), row);
+        for (NPArray<double>::const_Row r = reader.cbegin();
+             r != reader.cend(); r++) {
+            EXPECT_EQ(r.size(), expected.cols());
+            size_t c = 0;
+            for (const auto &e : r)
+                EXPECT_EQ(e, expected(row, c++));
+            row++;
+        }
+        num_chunks++;
+    }
+    EXPECT_TRUE(reader.good());
+    EXPECT_EQ(row, expected.rows());
+    EXPECT_EQ(num_chunks, reader.numChunks());
+
+    // Once all rows have been read, the reader stays at the end.
+    EXPECT_FALSE(reader.next());
+    EXPECT_EQ(reader.chunk().rows(), 0);
+}
+} // namespace
+
+TEST_F(NPYChunkReaderF, read) {
+    const NPArray<double> a = traces(10, 4);
+    ASSERT_TRUE(a.save(getTemporaryFilename()));
+
+    for (bool prefetch : {false, true}) {
+        for (size_t chunk_size : {1, 3, 5, 10, 20}) {
+            NPYChunkReader<double> reader(getTemporaryFilename(), chunk_size,
+                                          NPArrayBase::Window(), prefetch);
+            checkChunks(reader, a, chunk_size);
+
+            // Read everything a second time.
+            reader.rewind();
+            checkChunks(reader, a, chunk_size);
+        }
+    }
+
+    // A chunk size of 0 reads rows one at a time.
+    NPYChunkReader<double> reader0(getTemporaryFilename(), 0);
+    checkChunks(reader0, a, 1);
+
+    // Only read a window of the file.
+    NPYChunkReader<double> reader1(getTemporaryFilename(), 3,
+                                   NPArrayBase::Window(2, 9, 1, 4, 2));
+    NPArray<double> w(7, 2);
+    for (size_t r = 0; r < w.rows(); r++) {
+        w(r, 0) = a(r + 2, 1);
+        w(r, 1) = a(r + 2, 3);
+    }
+    checkChunks(reader1, w, 3);
+}
+
+TEST_F(NPYChunkReaderF, errors) {
+    // Non existent file.
+    NPYChunkReader<double> reader0("non-existent-file.npy");
+    EXPECT_FALSE(reader0.good());
+    EXPECT_NE(reader0.error(), nullptr);
+    EXPECT_FALSE(reader0.next());
+
+    // Element type mismatch.
+    const NPArray<uint32_t> a({0, 1, 2, 3, 4, 5}, 3, 2);
+    ASSERT_TRUE(a.save(getTemporaryFilename()));
+    NPYChunkReader<double> reader1(getTemporaryFilename(), 2);
+    EXPECT_TRUE(reader1.good());
+    EXPECT_FALSE(reader1.next());
+    EXPECT_FALSE(reader1.good());
+
+    // Element type conversion with a custom loader.
+    NPYChunkReader<double> reader2(
+        getTemporaryFilename(), 2, NPArrayBase::Window(), /* prefetch: */ true,
+        [](const string &filename, const NPArrayBase::Window &window) {
+            return NPArray<double>::readAs(filename, window);
+        });
+    checkChunks(reader2, NPArray<double>({0, 1, 2, 3, 4, 5}, 3, 2), 2);
+}
+
+TEST_F(NPYChunkReaderF, metrics) {
+    const NPArray<double> a = traces(25, 6);
+    ASSERT_TRUE(a.save(getTemporaryFilename()));
+
+    vector<Classification> classifier(a.rows());
+    NPArray<double> ival(1, a.rows());
+    for (size_t i = 0; i < a.rows(); i++) {
+        classifier[i] = i % 3 == 0   ? Classification::GROUP_0
+                        : i % 3 == 1 ? Classification::GROUP_1
+                                     : Classification::IGNORE;
+        ival(0, i) = double((i * 7) % 11);
+    }
+
+    for (size_t chunk_size : {1, 4, 25, 100}) {
+        NPYChunkReader<double> reader(getTemporaryFilename(), chunk_size);
+        EXPECT_EQ(t_test(0, a.cols(), reader, classifier),
+                  t_test(0, a.cols(), a, classifier));
+        EXPECT_EQ(t_test(1, 4, reader, classifier),
+                  t_test(1, 4, a, classifier));
+        EXPECT_EQ(t_test(2, 2, reader, classifier).size(), 0);
+        EXPECT_EQ(correl(0, a.cols(), reader, ival),
+                  correl(0, a.cols(), a, ival));
+        EXPECT_EQ(correl(2, 5, reader, ival), correl(2, 5, a, ival));
+        EXPECT_EQ(correl(3, 3, reader, ival).size(), 0);
+    }
+}
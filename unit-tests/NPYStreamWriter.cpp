@@ -0,0 +1,188 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/NPYStreamWriter.h"
+#include "PAF/SCA/NPAdapter.h"
+#include "PAF/SCA/NPArray.h"
+
+#include "paf-unit-testing.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace PAF::SCA;
+
+using std::vector;
+
+// Create the test fixture for NPYStreamWriter.
+TEST_WITH_TEMP_FILE(NPYStreamWriterF, "test-NPYStreamWriter.npy.XXXXXX");
+
+TEST_F(NPYStreamWriterF, maxWidth) {
+    {
+        NPYStreamWriter<uint32_t> w(getTemporaryFilename());
+        EXPECT_TRUE(w.good());
+        w.append({1, 2});
+        w.next();
+        w.append(3);
+        w.append(4);
+        w.append({5, 6});
+        w.next();
+        w.next();
+        w.append(7);
+        // The last row is terminated on close.
+        EXPECT_EQ(w.rows(), 3);
+        EXPECT_EQ(w.cols(), 4);
+        EXPECT_TRUE(w.close());
+        EXPECT_EQ(w.rows(), 4);
+        // Closing is idempotent.
+        EXPECT_TRUE(w.close());
+    }
+
+    const NPArray<uint32_t> a(getTemporaryFilename());
+    EXPECT_TRUE(a.good());
+    EXPECT_EQ(a, NPArray<uint32_t>({1, 2, 0, 0, //
+                                    3, 4, 5, 6, //
+                                    0, 0, 0, 0, //
+                                    7, 0, 0, 0},
+                                   4, 4));
+
+    // Many rows of varying lengths.
+    NPArray<double> e(100, 37);
+    {
+        NPYStreamWriter<double> w(getTemporaryFilename());
+        for (size_t r = 0; r < e.rows(); r++) {
+            const size_t len = r == 50 ? e.cols() : (r * 7) % e.cols();
+            for (size_t c = 0; c < e.cols(); c++) {
+                e(r, c) = c < len ? double(r * 100 + c) : 0.0;
+                if (c < len)
+                    w.append(e(r, c));
+            }
+            w.next();
+        }
+    }
+    EXPECT_EQ(NPArray<double>(getTemporaryFilename()), e);
+
+    // Nothing written.
+    {
+        NPYStreamWriter<double> w(getTemporaryFilename());
+        w.next();
+    }
+    const NPArray<double> z(getTemporaryFilename());
+    EXPECT_TRUE(z.good());
+    EXPECT_EQ(z.rows(), 1);
+    EXPECT_EQ(z.cols(), 0);
+}
+
+TEST_F(NPYStreamWriterF, fixedWidth) {
+    {
+        NPYStreamWriter<int16_t> w(getTemporaryFilename(), 3);
+        w.append({1, 2, 3});
+        w.next();
+        w.append(-4);
+        w.next();
+        EXPECT_EQ(w.rows(), 2);
+        EXPECT_EQ(w.cols(), 3);
+    }
+    EXPECT_EQ(NPArray<int16_t>(getTemporaryFilename()),
+              NPArray<int16_t>({1, 2, 3, -4, 0, 0}, 2, 3));
+
+    // Rows longer than the width are an error.
+    NPYStreamWriter<int16_t> w(getTemporaryFilename(), 2);
+    w.append({1, 2, 3});
+    w.next();
+    EXPECT_FALSE(w.good());
+    EXPECT_NE(w.error(), nullptr);
+    EXPECT_FALSE(w.close());
+}
+
+TEST_F(NPYStreamWriterF, longRows) {
+    // Rows longer than ROW_CHUNK_SIZE are written by chunks.
+    constexpr size_t N = 2 * NPYStreamWriter<uint32_t>::ROW_CHUNK_SIZE + 7;
+    vector<uint32_t> exp;
+    {
+        NPYStreamWriter<uint32_t> w(getTemporaryFilename());
+        for (size_t i = 0; i < N; i++)
+            w.append(i);
+        w.next();
+        w.append({1, 2});
+        w.next();
+        for (size_t i = 0; i < N + 3; i++)
+            w.append(3 * i);
+        EXPECT_TRUE(w.close());
+        EXPECT_EQ(w.rows(), 3);
+        EXPECT_EQ(w.cols(), N + 3);
+    }
+    for (size_t i = 0; i < N + 3; i++)
+        exp.push_back(i < N ? i : 0);
+    exp.insert(exp.end(), {1, 2});
+    exp.resize(2 * (N + 3), 0);
+    for (size_t i = 0; i < N + 3; i++)
+        exp.push_back(3 * i);
+    EXPECT_EQ(NPArray<uint32_t>(getTemporaryFilename()),
+              NPArray<uint32_t>(exp, 3, N + 3));
+
+    // And so are fixed width rows.
+    {
+        NPYStreamWriter<uint32_t> w(getTemporaryFilename(), N);
+        for (size_t i = 0; i < N - 1; i++)
+            w.append(i);
+        w.next();
+        EXPECT_TRUE(w.close());
+    }
+    exp.clear();
+    for (size_t i = 0; i < N; i++)
+        exp.push_back(i < N - 1 ? i : 0);
+    EXPECT_EQ(NPArray<uint32_t>(getTemporaryFilename()),
+              NPArray<uint32_t>(exp, 1, N));
+
+    // Long rows exceeding the width are still an error.
+    NPYStreamWriter<uint32_t> w(getTemporaryFilename(), 10);
+    for (size_t i = 0; i < N; i++)
+        w.append(i);
+    EXPECT_FALSE(w.good());
+    EXPECT_FALSE(w.close());
+}
+
+TEST_F(NPYStreamWriterF, errors) {
+    NPYStreamWriter<double> w0("");
+    EXPECT_FALSE(w0.good());
+    w0.append(1.0);
+    w0.next();
+    EXPECT_EQ(w0.rows(), 0);
+    EXPECT_FALSE(w0.close());
+
+    NPYStreamWriter<double> w1("non-existent-dir/file.npy");
+    EXPECT_FALSE(w1.good());
+    EXPECT_NE(w1.error(), nullptr);
+}
+
+TEST_F(NPYStreamWriterF, NPAdapter) {
+    NPAdapter<uint64_t> a(2);
+    a.append({1, 2, 3});
+    a.next();
+    a.append(4);
+    a.next();
+    a.append({5, 6, 7, 8});
+    ASSERT_TRUE(a.save(getTemporaryFilename()));
+    EXPECT_EQ(NPArray<uint64_t>(getTemporaryFilename()),
+              NPArray<uint64_t>({1, 2, 3, 0, 4, 0, 0, 0, 5, 6, 7, 8}, 3, 4));
+}
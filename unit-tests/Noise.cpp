@@ -20,13 +20,16 @@
 
 #include "PAF/SCA/Noise.h"
 
+#include <cmath>
 #include <memory>
+#include <vector>
 
 #include "gtest/gtest.h"
 
 using namespace PAF::SCA;
 
 using std::unique_ptr;
+using std::vector;
 
 TEST(Noise, NullNoise) {
     unique_ptr<NoiseSource> NS(NoiseSource::getSource(NoiseSource::ZERO, 3.14));
@@ -50,3 +53,79 @@ TEST(Noise, OtherNoiseSource) {
         NoiseSource::getSource(NoiseSource::UNIFORM, 5.));
     NS = NoiseSource::getSource(NoiseSource::NORMAL, 5.);
 }
+
+TEST(Noise, fill) {
+    double v[5];
+    unique_ptr<NoiseSource> NS(
+        NoiseSource::getSource(NoiseSource::CONSTANT, 3.14));
+    NS->fill(v, 5);
+    for (const double d : v)
+        EXPECT_DOUBLE_EQ(d, 3.14);
+
+    NS = NoiseSource::getSource(NoiseSource::ZERO, 3.14);
+    NS->fill(v, 5);
+    for (const double d : v)
+        EXPECT_DOUBLE_EQ(d, 0.0);
+
+    // The random sources must produce the same values with fill than with
+    // successive calls to get, including when the normal noise source has a
+    // spare value left.
+    for (const auto ty : {NoiseSource::UNIFORM, NoiseSource::NORMAL}) {
+        unique_ptr<NoiseSource> S1(NoiseSource::getSource(ty, 2.0, 1234));
+        unique_ptr<NoiseSource> S2(NoiseSource::getSource(ty, 2.0, 1234));
+        vector<double> v1(1001);
+        vector<double> v2(1001);
+        S1->fill(&v1[0], 3);
+        S1->fill(&v1[3], 998);
+        for (double &d : v2)
+            d = S2->get();
+        EXPECT_EQ(v1, v2);
+    }
+}
+
+TEST(Noise, seed) {
+    for (const auto ty : {NoiseSource::UNIFORM, NoiseSource::NORMAL}) {
+        unique_ptr<NoiseSource> S1(NoiseSource::getSource(ty, 2.0, 42));
+        unique_ptr<NoiseSource> S2(NoiseSource::getSource(ty, 2.0, 43));
+        vector<double> v1(100);
+        vector<double> v2(100);
+        vector<double> v3(100);
+        S1->fill(v1.data(), v1.size());
+        S2->fill(v2.data(), v2.size());
+        EXPECT_NE(v1, v2);
+
+        // Reseeding restarts the sequence.
+        S1->get();
+        S1->seed(42);
+        S1->fill(v3.data(), v3.size());
+        EXPECT_EQ(v1, v3);
+    }
+}
+
+TEST(Noise, distributions) {
+    const size_t N = 100000;
+    vector<double> v(N);
+
+    unique_ptr<NoiseSource> NS(
+        NoiseSource::getSource(NoiseSource::UNIFORM, 4.0, 1));
+    NS->fill(v.data(), N);
+    double sum = 0.0;
+    for (const double d : v) {
+        EXPECT_GE(d, -2.0);
+        EXPECT_LT(d, 2.0);
+        sum += d;
+    }
+    EXPECT_NEAR(sum / N, 0.0, 0.05);
+
+    NS = NoiseSource::getSource(NoiseSource::NORMAL, 4.0, 1);
+    NS->fill(v.data(), N);
+    sum = 0.0;
+    double sum2 = 0.0;
+    for (const double d : v) {
+        sum += d;
+        sum2 += d * d;
+    }
+    const double mean = sum / N;
+    EXPECT_NEAR(mean, 0.0, 0.05);
+    EXPECT_NEAR(std::sqrt(sum2 / N - mean * mean), 2.0, 0.05);
+}
@@ -19,6 +19,7 @@
  */
 
 #include "PAF/PAF.h"
+#include "PAF/ArchInfo.h"
 
 #include "libtarmac/parser.hh"
 #include "libtarmac/reporter.hh"
@@ -27,7 +28,9 @@
 
 #include <array>
 #include <libtarmac/index.hh>
+#include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -41,12 +44,14 @@ using std::string;
 using std::vector;
 
 using PAF::Access;
+using PAF::ArchInfo;
 using PAF::ExecutionRange;
 using PAF::FromStreamBuilder;
 using PAF::MemoryAccess;
 using PAF::ReferenceInstruction;
 using PAF::ReferenceInstructionBuilder;
 using PAF::RegisterAccess;
+using PAF::V7MInfo;
 
 TEST(PAF, ExecutionRange) {
     ExecutionRange ER(TarmacSite(1234, 0), TarmacSite(5678, 0));
@@ -147,12 +152,14 @@ TEST(RegAcces, parsing) {
 
       public:
         RegAccessReceiver() = delete;
-        RegAccessReceiver(const char *str) : iss(str) {}
+        RegAccessReceiver(const char *str, const ArchInfo *CPU = nullptr)
+            : iss(str), CPU(CPU) {}
 
         const RegisterAccess &get() {
             FromStreamBuilder<ReferenceInstruction, ReferenceInstructionBuilder,
                               RegAccessReceiver>
                 FSB(iss);
+            FSB.setArchInfo(CPU);
             FSB.build(*this);
             return regAccesses[0];
         }
@@ -164,9 +171,11 @@ TEST(RegAcces, parsing) {
       private:
         vector<RegisterAccess> regAccesses;
         istringstream iss;
+        const ArchInfo *CPU;
     };
 
     RegisterAccess a1 = RegAccessReceiver("669 clk R r1 0000ba95").get();
+    EXPECT_EQ(a1.id, RegisterAccess::UNKNOWN_ID);
     EXPECT_EQ(a1.name, "r1");
     EXPECT_EQ(a1.value, 0x0ba95);
     EXPECT_EQ(a1.access, RegisterAccess::Type::WRITE);
@@ -180,6 +189,16 @@ TEST(RegAcces, parsing) {
     EXPECT_EQ(a3.name, "psr");
     EXPECT_EQ(a3.value, 0x21000000);
     EXPECT_EQ(a3.access, RegisterAccess::Type::WRITE);
+
+    // The register ids are resolved at parse time when a CPU is provided.
+    const V7MInfo CPU;
+    RegisterAccess a4 = RegAccessReceiver("669 clk R r1 0000ba95", &CPU).get();
+    EXPECT_EQ(a4.id, unsigned(V7MInfo::Register::R1));
+    EXPECT_EQ(a4.name, "r1");
+    RegisterAccess a5 =
+        RegAccessReceiver("661 clk R cpsr 21000000", &CPU).get();
+    EXPECT_EQ(a5.id, unsigned(V7MInfo::Register::PSR));
+    EXPECT_TRUE(CPU.isStatusRegister(a5.id));
 }
 
 TEST(RegAccess, dump) {
@@ -579,6 +598,29 @@ TEST(MTAnalyzer, base) {
         EXPECT_EQ(val, valExp[i]);
     }
 
+    // Batched state queries must agree with the single queries.
+    vector<Time> times;
+    vector<uint64_t> r0Exp;
+    for (size_t i = 0; i < Instances.size(); i++) {
+        const Time t = Instances[i].begin.time - 1;
+        times.push_back(t);
+        r0Exp.push_back(i);
+
+        const vector<uint64_t> regs =
+            T.getRegisterValuesAtTime({"r0", "pc", "r1"}, t);
+        ASSERT_EQ(regs.size(), 3);
+        EXPECT_EQ(regs[0], i);
+        EXPECT_EQ(regs[1], T.getRegisterValueAtTime("pc", t));
+        EXPECT_EQ(regs[2], T.getRegisterValueAtTime("r1", t));
+
+        const vector<vector<uint8_t>> mems = T.getMemoryValuesAtTime(
+            {{symb_addr, symb_size}, {symb_addr + 1, 2}}, t);
+        ASSERT_EQ(mems.size(), 2);
+        EXPECT_EQ(mems[0], T.getMemoryValueAtTime(symb_addr, symb_size, t));
+        EXPECT_EQ(mems[1], T.getMemoryValueAtTime(symb_addr + 1, 2, t));
+    }
+    EXPECT_EQ(T.getRegisterValueAtTimes("r0", times), r0Exp);
+
     for (auto &Instance : Instances) {
         T.getFunctionBody(Instance, T);
         EXPECT_EQ(T.instructions[0].disassembly, string("MUL r3,r0,r0"));
@@ -605,6 +647,103 @@ TEST(MTAnalyzer, base) {
     }
 }
 
+namespace {
+// Collect the instructions of an execution range.
+struct InstrCollector {
+    void operator()(const ReferenceInstruction &I) {
+        instructions.push_back(I);
+    }
+    vector<ReferenceInstruction> instructions;
+};
+} // namespace
+
+TEST(MTAnalyzer, parallelBuild) {
+    TracePair Inputs = makeTracePair(SAMPLES_SRC_DIR "instances-v7m.trace",
+                                     "instances-v7m.trace.index");
+    run_indexer(Inputs, IndexerParams(), IndexerDiagnostics(),
+                ParseParams(/* big_endian */ false));
+    IndexNavigator IN(Inputs, SAMPLES_SRC_DIR "instances-v7m.elf");
+    TestMTAnalyzer T(IN);
+
+    vector<ExecutionRange> Instances = T.getInstances("foo");
+    ASSERT_EQ(Instances.size(), 4);
+    Instances.push_back(T.getFullExecutionRange());
+
+    // The reference: a sequential replay.
+    vector<vector<ReferenceInstruction>> expected;
+    for (auto &Instance : Instances) {
+        T.getFunctionBody(Instance, T);
+        expected.push_back(T.instructions);
+    }
+
+    for (unsigned numThreads : {1, 2, 8}) {
+        vector<InstrCollector> collectors(Instances.size());
+        PAF::ParallelTraceBuilder<ReferenceInstruction,
+                                  ReferenceInstructionBuilder, InstrCollector>
+            PTB([&]() { return std::make_unique<IndexNavigator>(Inputs, ""); },
+                numThreads);
+        PTB.build(Instances, [&](size_t i) -> InstrCollector & {
+            return collectors[i];
+        });
+        for (size_t i = 0; i < Instances.size(); i++) {
+            const auto &instrs = collectors[i].instructions;
+            ASSERT_EQ(instrs.size(), expected[i].size());
+            for (size_t j = 0; j < instrs.size(); j++) {
+                EXPECT_EQ(instrs[j], expected[i][j]);
+                EXPECT_EQ(instrs[j].time, expected[i][j].time);
+            }
+        }
+    }
+}
+
+TEST(MTAnalyzer, pipelinedBuild) {
+    TracePair Inputs = makeTracePair(SAMPLES_SRC_DIR "instances-v7m.trace",
+                                     "instances-v7m.trace.index");
+    run_indexer(Inputs, IndexerParams(), IndexerDiagnostics(),
+                ParseParams(/* big_endian */ false));
+    IndexNavigator IN(Inputs, SAMPLES_SRC_DIR "instances-v7m.elf");
+    TestMTAnalyzer T(IN);
+
+    ExecutionRange FER = T.getFullExecutionRange();
+    T.getFunctionBody(FER, T);
+    const vector<ReferenceInstruction> expected = T.instructions;
+    ASSERT_FALSE(expected.empty());
+
+    // The instructions are recycled by the pipeline, so its depth (even
+    // smaller than the number of instructions) has no effect on the result.
+    for (size_t depth : {1, 4, 1024}) {
+        InstrCollector C;
+        PAF::FromTraceBuilder<ReferenceInstruction, ReferenceInstructionBuilder,
+                              InstrCollector>
+            FTB(IN);
+        FTB.setPipelineDepth(depth);
+        FTB.build(FER, C);
+        ASSERT_EQ(C.instructions.size(), expected.size());
+        for (size_t j = 0; j < expected.size(); j++) {
+            EXPECT_EQ(C.instructions[j], expected[j]);
+            EXPECT_EQ(C.instructions[j].time, expected[j].time);
+            EXPECT_EQ(C.instructions[j].disassembly, expected[j].disassembly);
+            EXPECT_EQ(C.instructions[j].memAccess, expected[j].memAccess);
+            EXPECT_EQ(C.instructions[j].regAccess, expected[j].regAccess);
+        }
+    }
+
+    // Exceptions from the continuation stop the parsing, and are forwarded.
+    struct Throwing {
+        size_t count = 0;
+        void operator()(const ReferenceInstruction &) {
+            if (++count == 3)
+                throw std::runtime_error("stop");
+        }
+    } Thrower;
+    PAF::FromTraceBuilder<ReferenceInstruction, ReferenceInstructionBuilder,
+                          Throwing>
+        FTB(IN);
+    FTB.setPipelineDepth(2);
+    EXPECT_THROW(FTB.build(FER, Thrower), std::runtime_error);
+    EXPECT_EQ(Thrower.count, 3);
+}
+
 TEST(MTAnalyzer, labels) {
     TracePair Inputs = makeTracePair(SAMPLES_SRC_DIR "labels-v7m.trace",
                                      "labels-v7m.trace.index");
@@ -629,7 +768,35 @@ TEST(MTAnalyzer, labels) {
         EXPECT_TRUE(T.getInstructionAtTime(WStartInstr, cs.begin.time));
         EXPECT_TRUE(T.getInstructionAtTime(WEndInstr, cs.end.time));
         EXPECT_GT(WEndInstr.pc, WStartInstr.pc);
+        EXPECT_EQ(cs.begin.addr, WStartInstr.pc);
+        EXPECT_EQ(cs.end.addr, WEndInstr.pc);
+    }
+
+    // Index navigation by instructions.
+    const ExecutionRange FER = T.getFullExecutionRange();
+    TarmacSite S;
+    vector<Time> times;
+    for (const auto &cs : WLabels) {
+        EXPECT_TRUE(T.getSiteAtOffset(S, cs.begin.time, 2));
+        EXPECT_EQ(S.time, cs.end.time);
+        EXPECT_EQ(S.addr, cs.end.addr);
+        EXPECT_TRUE(T.getSiteAtOffset(S, cs.end.time, -2));
+        EXPECT_EQ(S.time, cs.begin.time);
+        EXPECT_TRUE(T.getSiteAtOffset(S, cs.begin.time, 0));
+        EXPECT_EQ(S.time, cs.begin.time);
+        times.push_back(cs.begin.time);
+        times.push_back(cs.begin.time);
     }
+    EXPECT_FALSE(T.getSiteAtOffset(S, FER.end.time, 1));
+    EXPECT_EQ(S.time, FER.end.time);
+
+    vector<TarmacSite> sites;
+    EXPECT_EQ(T.getSitesAtOffset(sites, times, 2), 0);
+    ASSERT_EQ(sites.size(), times.size());
+    for (size_t i = 0; i < sites.size(); i++)
+        EXPECT_EQ(sites[i].time, WLabels[i / 2].end.time);
+    times.push_back(FER.end.time);
+    EXPECT_EQ(T.getSitesAtOffset(sites, times, 1), 1);
 }
 
 TEST(MTAnalyzer, markers) {
@@ -0,0 +1,124 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/WAN/PackedIndices.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+using namespace PAF::WAN;
+using namespace testing;
+
+using std::vector;
+
+namespace {
+// Build a PackedIndices and its reference vector, with n indices whose
+// deltas cycle through 0 .. maxDelta.
+void fill(PackedIndices &PI, vector<uint32_t> &Ref, size_t n,
+          uint32_t maxDelta) {
+    uint32_t v = 0;
+    for (size_t i = 0; i < n; i++) {
+        v += (i * 7) % (maxDelta + 1);
+        PI.push_back(v);
+        Ref.push_back(v);
+    }
+}
+} // namespace
+
+TEST(PackedIndices, Basics) {
+    PackedIndices PI;
+    EXPECT_TRUE(PI.empty());
+    EXPECT_EQ(PI.size(), 0);
+    EXPECT_EQ(PI.getStorageSize(), 0);
+    EXPECT_EQ(PI.lower_bound(0), 0);
+    EXPECT_EQ(PI.begin(), PI.end());
+
+    PI.push_back(3);
+    PI.push_back(5);
+    EXPECT_FALSE(PI.empty());
+    EXPECT_EQ(PI.size(), 2);
+    EXPECT_EQ(PI[0], 3);
+    EXPECT_EQ(PI[1], 5);
+    EXPECT_EQ(PI.back(), 5);
+    EXPECT_EQ(PI.lower_bound(0), 0);
+    EXPECT_EQ(PI.lower_bound(4), 1);
+    EXPECT_EQ(PI.lower_bound(6), 2);
+
+    PI.clear();
+    EXPECT_TRUE(PI.empty());
+}
+
+TEST(PackedIndices, Frames) {
+    for (const uint32_t maxDelta : {0u, 1u, 100u, 70000u, 0x3ffffu}) {
+        PackedIndices PI;
+        vector<uint32_t> Ref;
+        fill(PI, Ref, 1000, maxDelta);
+        ASSERT_EQ(PI.size(), Ref.size());
+        EXPECT_TRUE(std::equal(PI.begin(), PI.end(), Ref.begin(), Ref.end()));
+        for (size_t i = 0; i < Ref.size(); i++)
+            EXPECT_EQ(PI[i], Ref[i]);
+        EXPECT_EQ(PI.back(), Ref.back());
+
+        // The packed storage is smaller than a plain vector.
+        EXPECT_LT(PI.getStorageSize(), Ref.size() * sizeof(Ref[0]));
+
+        // Search all values, present or not.
+        for (uint32_t v = 0; v <= Ref.back() + 1;
+             v += std::max(1u, maxDelta / 3)) {
+            const size_t Expected =
+                std::lower_bound(Ref.begin(), Ref.end(), v) - Ref.begin();
+            EXPECT_EQ(PI.lower_bound(v), Expected);
+        }
+    }
+
+    // A full 32-bit range in a block.
+    PackedIndices PI;
+    for (size_t i = 0; i < PackedIndices::BLOCK_SIZE - 1; i++)
+        PI.push_back(0);
+    PI.push_back(UINT32_MAX);
+    EXPECT_EQ(PI[0], 0);
+    EXPECT_EQ(PI.back(), UINT32_MAX);
+    EXPECT_EQ(PI.lower_bound(1), PackedIndices::BLOCK_SIZE - 1);
+}
+
+TEST(PackedIndices, Comparisons) {
+    PackedIndices PI1, PI2;
+    vector<uint32_t> Ref;
+    fill(PI1, Ref, 1000, 100);
+    Ref.clear();
+    fill(PI2, Ref, 1000, 100);
+    EXPECT_EQ(PI1, PI2);
+    EXPECT_EQ(PI1.mismatch(PI2, 1000), 1000);
+
+    PackedIndices PI3;
+    for (size_t i = 0; i < Ref.size(); i++)
+        PI3.push_back(Ref[i] + (i >= 700 ? 1 : 0));
+    EXPECT_NE(PI1, PI3);
+    EXPECT_EQ(PI1.mismatch(PI3, 1000), 700);
+    EXPECT_EQ(PI3.mismatch(PI1, 1000), 700);
+    EXPECT_EQ(PI1.mismatch(PI3, 500), 500);
+
+    PI2.push_back(Ref.back() + 1);
+    EXPECT_NE(PI1, PI2);
+    EXPECT_EQ(PI1.mismatch(PI2, 1000), 1000);
+}
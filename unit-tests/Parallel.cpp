@@ -0,0 +1,181 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/utils/Parallel.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using std::vector;
+
+using PAF::Affinity;
+using PAF::parallelFor;
+using PAF::parallelReduce;
+using PAF::ThreadPool;
+
+TEST(Parallel, numThreads) {
+    EXPECT_GE(PAF::hardwareNumThreads(), 1);
+
+    unsetenv("PAF_NUM_THREADS");
+    EXPECT_EQ(PAF::defaultNumThreads(3), 3);
+    EXPECT_EQ(PAF::defaultNumThreads(0), PAF::hardwareNumThreads());
+    setenv("PAF_NUM_THREADS", "5", 1);
+    EXPECT_EQ(PAF::defaultNumThreads(3), 5);
+    setenv("PAF_NUM_THREADS", "0", 1);
+    EXPECT_EQ(PAF::defaultNumThreads(3), PAF::hardwareNumThreads());
+    setenv("PAF_NUM_THREADS", "many", 1);
+    EXPECT_EQ(PAF::defaultNumThreads(3), 3);
+    unsetenv("PAF_NUM_THREADS");
+}
+
+TEST(Parallel, ThreadPool) {
+    for (const Affinity A :
+         {Affinity::NONE, Affinity::COMPACT, Affinity::SPREAD}) {
+        std::atomic<unsigned> count{0};
+        {
+            ThreadPool TP(3, A);
+            EXPECT_EQ(TP.size(), 3);
+            EXPECT_FALSE(TP.isWorker());
+            for (unsigned i = 0; i < 100; i++)
+                TP.submit([&]() {
+                    EXPECT_TRUE(TP.isWorker());
+                    count++;
+                });
+        }
+        // The pool destruction waits for all tasks.
+        EXPECT_EQ(count, 100);
+    }
+
+    // Tasks submitted from a worker are executed too.
+    std::mutex mtx;
+    std::condition_variable cv;
+    unsigned done = 0;
+    ThreadPool TP(2);
+    TP.submit([&]() {
+        for (unsigned i = 0; i < 10; i++)
+            TP.submit([&]() {
+                std::lock_guard<std::mutex> lock(mtx);
+                done += 1;
+                cv.notify_one();
+            });
+    });
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [&]() { return done == 10; });
+    EXPECT_EQ(done, 10);
+}
+
+TEST(Parallel, parallelFor) {
+    for (const unsigned numThreads : {0U, 1U, 2U, 8U})
+        for (const size_t grain : {0UL, 1UL, 7UL, 1000UL}) {
+            vector<unsigned> hits(1000, 0);
+            parallelFor(
+                10, hits.size(), grain,
+                [&](size_t b, size_t e) {
+                    EXPECT_LT(b, e);
+                    EXPECT_LE(e - b, std::max(grain, size_t(1)));
+                    for (size_t i = b; i < e; i++)
+                        hits[i] += 1;
+                },
+                numThreads);
+            for (size_t i = 0; i < hits.size(); i++)
+                EXPECT_EQ(hits[i], i < 10 ? 0 : 1);
+        }
+
+    // Empty ranges.
+    unsigned calls = 0;
+    parallelFor(5, 5, 1, [&](size_t, size_t) { calls++; });
+    parallelFor(6, 5, 1, [&](size_t, size_t) { calls++; });
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(Parallel, nested) {
+    std::atomic<unsigned> count{0};
+    parallelFor(0, 16, 1, [&](size_t, size_t) {
+        parallelFor(0, 100, 10, [&](size_t b, size_t e) { count += e - b; });
+    });
+    EXPECT_EQ(count, 1600);
+}
+
+TEST(Parallel, exceptions) {
+    std::atomic<unsigned> count{0};
+    EXPECT_THROW(parallelFor(0, 1000, 1,
+                             [&](size_t b, size_t) {
+                                 count++;
+                                 if (b == 10)
+                                     throw std::runtime_error("b == 10");
+                             }),
+                 std::runtime_error);
+    EXPECT_GE(count, 1);
+    EXPECT_LE(count, 1000);
+
+    // The pool is still usable afterwards.
+    count = 0;
+    parallelFor(0, 1000, 1, [&](size_t, size_t) { count++; });
+    EXPECT_EQ(count, 1000);
+}
+
+TEST(Parallel, parallelReduce) {
+    const auto sum = [](size_t a, size_t b) { return a + b; };
+    const auto mapSum = [](size_t b, size_t e) {
+        size_t s = 0;
+        for (size_t i = b; i < e; i++)
+            s += i;
+        return s;
+    };
+    for (const unsigned numThreads : {0U, 1U, 3U})
+        for (const size_t grain : {1UL, 13UL, 10000UL}) {
+            EXPECT_EQ(parallelReduce(0, 1000, grain, size_t(0), mapSum, sum,
+                                     numThreads),
+                      999 * 1000 / 2);
+            EXPECT_EQ(parallelReduce(0, 0, grain, size_t(42), mapSum, sum,
+                                     numThreads),
+                      42);
+        }
+
+    // The reduction order does not depend on the number of threads.
+    const auto mapObs = [](size_t b, size_t e) {
+        double s = 0.0;
+        for (size_t i = b; i < e; i++)
+            s += 1.0 / double(i + 1);
+        return s;
+    };
+    const auto fsum = [](double a, double b) { return a + b; };
+    const double ref = parallelReduce(0, 100000, 77, 0.0, mapObs, fsum, 1);
+    for (const unsigned numThreads : {0U, 2U, 5U})
+        EXPECT_EQ(
+            parallelReduce(0, 100000, 77, 0.0, mapObs, fsum, numThreads), ref);
+
+    // The reduction is performed in order.
+    const auto mapIdx = [](size_t b, size_t) { return vector<size_t>{b}; };
+    const auto concat = [](vector<size_t> a, vector<size_t> b) {
+        a.insert(a.end(), b.begin(), b.end());
+        return a;
+    };
+    const vector<size_t> order =
+        parallelReduce(0, 50, 10, vector<size_t>(), mapIdx, concat);
+    EXPECT_EQ(order, vector<size_t>({0, 10, 20, 30, 40}));
+}
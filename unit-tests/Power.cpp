@@ -55,6 +55,10 @@ using PAF::ArchInfo;
 using PAF::MemoryAccess;
 using PAF::ReferenceInstruction;
 using PAF::RegisterAccess;
+using PAF::SCA::BufferedInstrDumper;
+using PAF::SCA::BufferedMemoryAccessesDumper;
+using PAF::SCA::BufferedPowerDumper;
+using PAF::SCA::BufferedRegBankDumper;
 using PAF::SCA::CSVPowerDumper;
 using PAF::SCA::InstrDumper;
 using PAF::SCA::MemoryAccessesDumper;
@@ -64,8 +68,10 @@ using PAF::SCA::NPYPowerDumper;
 using PAF::SCA::NPYRegBankDumper;
 using PAF::SCA::PowerAnalysisConfig;
 using PAF::SCA::PowerDumper;
+using PAF::SCA::PowerSamples;
 using PAF::SCA::PowerTrace;
 using PAF::SCA::PowerTraceConfig;
+using PAF::SCA::PowerTraceRecorder;
 using PAF::SCA::RegBankDumper;
 using PAF::SCA::TimingInfo;
 using PAF::SCA::YAMLInstrDumper;
@@ -120,6 +126,38 @@ TEST(TimingInfo, Base) {
     EXPECT_EQ(TTI.locations(), t1);
 }
 
+TEST(TimingInfo, addTrace) {
+    TestTimingInfo T1;
+    T1.add(124, 2);
+    T1.incr(4);
+    T1.add(132, 1);
+
+    TestTimingInfo T2;
+    T2.add(124, 3);
+
+    // Gathering traces analyzed separately must give the same results as
+    // analyzing them in sequence.
+    TestTimingInfo TTI;
+    TTI.add(T1);
+    TTI.nextTrace();
+    TTI.add(T2);
+    TTI.nextTrace();
+
+    vector<pair<Addr, unsigned>> t1({{124, 0}, {132, 6}});
+    EXPECT_EQ(TTI.minimum(), 3);
+    EXPECT_EQ(TTI.maximum(), 7);
+    EXPECT_EQ(TTI.locations(), t1);
+
+    // Traces can also be gathered piecewise.
+    TestTimingInfo TTI2;
+    TTI2.add(100, 1);
+    TTI2.add(T1);
+    TTI2.nextTrace();
+    EXPECT_EQ(TTI2.minimum(), 8);
+    vector<pair<Addr, unsigned>> t2({{100, 0}, {124, 1}, {132, 7}});
+    EXPECT_EQ(TTI2.locations(), t2);
+}
+
 // Create the test fixture for YAMLTimingInfo.
 TEST_WITH_TEMP_FILE(YAMLTimingInfoF, "test-YAMLTimingInfo.yml.XXXXXX");
 
@@ -396,9 +434,15 @@ struct TestPowerDumper : public PowerDumper {
         pwf.emplace_back(t, p, i, oreg, ireg, a, d, I);
     }
 
-    void reset() { pwf.clear(); }
+    void nextTrace() override { numNextTrace++; }
+
+    void reset() {
+        pwf.clear();
+        numNextTrace = 0;
+    }
 
     vector<PowerFields> pwf;
+    size_t numNextTrace = 0;
 };
 
 // A mock for testing register bank traces.
@@ -659,6 +703,109 @@ TEST(PowerDumper, base) {
               PowerFields(1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, &Insts[0]));
 }
 
+TEST(PowerSamples, base) {
+    PowerSamples PS;
+    EXPECT_TRUE(PS.empty());
+    EXPECT_EQ(PS.size(), 0);
+
+    PS.push_back(1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, &Insts[0]);
+    PS.push_back(2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, nullptr);
+    EXPECT_FALSE(PS.empty());
+    EXPECT_EQ(PS.size(), 2);
+    EXPECT_EQ(PS.total, vector<double>({1.0, 2.0}));
+    EXPECT_EQ(PS.pc, vector<double>({2.0, 3.0}));
+    EXPECT_EQ(PS.instr, vector<double>({3.0, 4.0}));
+    EXPECT_EQ(PS.oreg, vector<double>({4.0, 5.0}));
+    EXPECT_EQ(PS.ireg, vector<double>({5.0, 6.0}));
+    EXPECT_EQ(PS.addr, vector<double>({6.0, 7.0}));
+    EXPECT_EQ(PS.data, vector<double>({7.0, 8.0}));
+    EXPECT_EQ(PS.instruction[0], &Insts[0]);
+    EXPECT_EQ(PS.instruction[1], nullptr);
+
+    // By default, the samples are dumped one by one.
+    TestPowerDumper TPD;
+    TPD.preDump();
+    TPD.dumpSamples(PS);
+    TPD.postDump();
+    EXPECT_EQ(TPD.pwf.size(), 2);
+    EXPECT_EQ(TPD.pwf[0],
+              PowerFields(1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, &Insts[0]));
+    EXPECT_EQ(TPD.pwf[1],
+              PowerFields(2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, nullptr));
+
+    PS.clear();
+    EXPECT_TRUE(PS.empty());
+    EXPECT_TRUE(PS.instruction.empty());
+}
+
+TEST(BufferedPowerDumper, base) {
+    BufferedPowerDumper BPD;
+    TestPowerDumper TPD;
+
+    // Nothing is replayed if nothing was dumped.
+    BPD.replay(TPD);
+    EXPECT_TRUE(TPD.pwf.empty());
+
+    BPD.preDump();
+    BPD.dump(1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, &Insts[0]);
+    BPD.dump(2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, nullptr);
+    BPD.dump(3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, &Insts[1]);
+    BPD.postDump();
+
+    BPD.replay(TPD);
+    EXPECT_EQ(TPD.pwf.size(), 3);
+    EXPECT_EQ(TPD.pwf[0],
+              PowerFields(1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, &Insts[0]));
+    EXPECT_EQ(TPD.pwf[1],
+              PowerFields(2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, nullptr));
+    EXPECT_EQ(TPD.pwf[2],
+              PowerFields(3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, &Insts[1]));
+}
+
+TEST(BufferedPowerDumper, dumpSamples) {
+    BufferedPowerDumper BPD;
+    TestPowerDumper TPD;
+
+    PowerSamples PS;
+    PS.push_back(1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, &Insts[0]);
+    PS.push_back(2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, nullptr);
+    BPD.preDump();
+    BPD.dumpSamples(PS);
+    BPD.dump(3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, &Insts[1]);
+    BPD.postDump();
+
+    // The instructions are copied.
+    PS.clear();
+    BPD.replay(TPD);
+    EXPECT_EQ(TPD.pwf.size(), 3);
+    EXPECT_EQ(TPD.pwf[0],
+              PowerFields(1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, &Insts[0]));
+    EXPECT_NE(TPD.pwf[0].inst, &Insts[0]);
+    EXPECT_EQ(TPD.pwf[1],
+              PowerFields(2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, nullptr));
+    EXPECT_EQ(TPD.pwf[2],
+              PowerFields(3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, &Insts[1]));
+}
+
+TEST(BufferedPowerDumper, rows) {
+    BufferedPowerDumper BPD;
+    TestPowerDumper TPD;
+
+    BPD.preDump();
+    BPD.dump(1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, &Insts[0]);
+    BPD.nextTrace();
+    BPD.dump(2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, &Insts[0]);
+    BPD.postDump();
+
+    BPD.replay(TPD);
+    EXPECT_EQ(TPD.numNextTrace, 1);
+    EXPECT_EQ(TPD.pwf.size(), 2);
+    EXPECT_EQ(TPD.pwf[0],
+              PowerFields(1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, &Insts[0]));
+    EXPECT_EQ(TPD.pwf[1],
+              PowerFields(2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, &Insts[0]));
+}
+
 TEST(CSVPowerDumper, base) {
     std::ostringstream s;
     CSVPowerDumper CPD1(s, false);
@@ -730,6 +877,82 @@ TEST_F(NPYPowerDumperF, base) {
             EXPECT_EQ(npy(row, col), double((row + 1) * (col + 1)));
 }
 
+TEST_F(NPYPowerDumperF, dumpSamples) {
+    {
+        NPYPowerDumper NPD(getTemporaryFilename(), 2);
+        PowerSamples PS;
+        PS.push_back(1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, &Insts[0]);
+        PS.push_back(2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, nullptr);
+        NPD.preDump();
+        NPD.dumpSamples(PS);
+        NPD.dump(3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, &Insts[1]);
+        NPD.postDump();
+        NPD.nextTrace();
+    }
+
+    NPArray<double> npy(getTemporaryFilename().c_str());
+    EXPECT_TRUE(npy.error() == nullptr);
+    EXPECT_EQ(npy.rows(), 1);
+    EXPECT_EQ(npy.cols(), 3);
+    for (size_t col = 0; col < npy.cols(); col++)
+        EXPECT_EQ(npy(0, col), double(col + 1));
+}
+
+TEST_F(NPYPowerDumperF, dtype) {
+    const vector<double> samples{-1.0, 0.4, 1.6, 21.25, 300.0, 70000.0};
+    const auto dumpWith = [&](NPYPowerDumper::DType dtype, double scale) {
+        NPYPowerDumper NPD(getTemporaryFilename(), 1, dtype, scale);
+        PowerSamples PS;
+        for (double v : samples)
+            PS.push_back(v, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, nullptr);
+        NPD.preDump();
+        NPD.dumpSamples(PS);
+        NPD.postDump();
+        NPD.nextTrace();
+    };
+
+    dumpWith(NPYPowerDumper::DType::UINT8, 1.0);
+    NPArray<uint8_t> u8(getTemporaryFilename().c_str());
+    EXPECT_TRUE(u8.good());
+    EXPECT_EQ(u8.cols(), samples.size());
+    EXPECT_EQ(u8.elementSize(), sizeof(uint8_t));
+    EXPECT_EQ(u8(0, 0), 0);
+    EXPECT_EQ(u8(0, 1), 0);
+    EXPECT_EQ(u8(0, 2), 2);
+    EXPECT_EQ(u8(0, 3), 21);
+    EXPECT_EQ(u8(0, 4), 255);
+    EXPECT_EQ(u8(0, 5), 255);
+
+    dumpWith(NPYPowerDumper::DType::UINT16, 2.0);
+    NPArray<uint16_t> u16(getTemporaryFilename().c_str());
+    EXPECT_TRUE(u16.good());
+    EXPECT_EQ(u16.elementSize(), sizeof(uint16_t));
+    EXPECT_EQ(u16(0, 0), 0);
+    EXPECT_EQ(u16(0, 1), 1);
+    EXPECT_EQ(u16(0, 2), 3);
+    EXPECT_EQ(u16(0, 3), 43);
+    EXPECT_EQ(u16(0, 4), 600);
+    EXPECT_EQ(u16(0, 5), 65535);
+
+    dumpWith(NPYPowerDumper::DType::FLOAT, 0.5);
+    NPArray<float> f32(getTemporaryFilename().c_str());
+    EXPECT_TRUE(f32.good());
+    EXPECT_EQ(f32.elementSize(), sizeof(float));
+    for (size_t i = 0; i < samples.size(); i++)
+        EXPECT_FLOAT_EQ(f32(0, i), samples[i] * 0.5);
+
+    NPYPowerDumper::DType dtype;
+    EXPECT_TRUE(NPYPowerDumper::getDType(dtype, "u1"));
+    EXPECT_EQ(dtype, NPYPowerDumper::DType::UINT8);
+    EXPECT_TRUE(NPYPowerDumper::getDType(dtype, "u2"));
+    EXPECT_EQ(dtype, NPYPowerDumper::DType::UINT16);
+    EXPECT_TRUE(NPYPowerDumper::getDType(dtype, "f4"));
+    EXPECT_EQ(dtype, NPYPowerDumper::DType::FLOAT);
+    EXPECT_TRUE(NPYPowerDumper::getDType(dtype, "f8"));
+    EXPECT_EQ(dtype, NPYPowerDumper::DType::DOUBLE);
+    EXPECT_FALSE(NPYPowerDumper::getDType(dtype, "u4"));
+}
+
 TEST(RegBankDumper, base) {
     TestRegBankDumper TRBD(true);
 
@@ -777,6 +1000,26 @@ TEST_F(NPYRegBankDumperF, base) {
             EXPECT_EQ(npy(row, col), row * npy.cols() + col);
 }
 
+TEST_F(NPYRegBankDumperF, registerSize) {
+    {
+        NPYRegBankDumper NRBD(getTemporaryFilename(), 1, 4);
+        NRBD.preDump();
+        NRBD.dump({0, 1, 2});
+        NRBD.dump({3, 4, 0xdeadbeef});
+        NRBD.postDump();
+        NRBD.nextTrace();
+    }
+
+    NPArray<uint32_t> npy(getTemporaryFilename().c_str());
+    EXPECT_TRUE(npy.error() == nullptr);
+    EXPECT_EQ(npy.rows(), 1);
+    EXPECT_EQ(npy.cols(), 6);
+    EXPECT_EQ(npy.elementSize(), sizeof(uint32_t));
+    for (size_t col = 0; col < 5; col++)
+        EXPECT_EQ(npy(0, col), col);
+    EXPECT_EQ(npy(0, 5), 0xdeadbeef);
+}
+
 TEST(PowerTraceConfig, base) {
     PowerTraceConfig PTC;
     EXPECT_TRUE(PTC.withAll());
@@ -927,6 +1170,42 @@ TEST(PowerTraceConfig, base) {
     EXPECT_TRUE(PTC.withMemoryAccessTransitions());
 }
 
+TEST(PowerTraceConfig, getSources) {
+    PowerTraceConfig PTC;
+    EXPECT_EQ(PTC.getSources(), PowerTraceConfig::WITH_ALL);
+
+    // The transitions are not power sources.
+    PTC.clear();
+    PTC.set(PowerTraceConfig::WITH_LOAD_TO_LOAD_TRANSITIONS,
+            PowerTraceConfig::WITH_MEMORY_UPDATE_TRANSITIONS);
+    EXPECT_EQ(PTC.getSources(), 0);
+
+    PTC.set(PowerTraceConfig::WITH_PC, PowerTraceConfig::WITH_MEM_DATA);
+    EXPECT_EQ(PTC.getSources(),
+              PowerTraceConfig::WITH_PC | PowerTraceConfig::WITH_MEM_DATA);
+}
+
+TEST(PowerTraceConfig, window) {
+    PowerTraceConfig PTC;
+    EXPECT_TRUE(PTC.getWindow().isComplete());
+
+    using Window = PowerTraceConfig::Window;
+    PTC.setWindow(Window(Window::INSTRUCTIONS, 10, 20));
+    EXPECT_FALSE(PTC.getWindow().isComplete());
+    EXPECT_EQ(PTC.getWindow().getUnit(), Window::INSTRUCTIONS);
+    EXPECT_EQ(PTC.getWindow().getBegin(), 10);
+    EXPECT_EQ(PTC.getWindow().getEnd(), 20);
+    EXPECT_FALSE(PTC.getWindow().hasAnchor());
+
+    PTC.setWindow(Window().setAnchor(0x8000));
+    EXPECT_FALSE(PTC.getWindow().isComplete());
+    EXPECT_EQ(PTC.getWindow().getUnit(), Window::CYCLES);
+    EXPECT_EQ(PTC.getWindow().getBegin(), 0);
+    EXPECT_EQ(PTC.getWindow().getEnd(), std::numeric_limits<size_t>::max());
+    EXPECT_TRUE(PTC.getWindow().hasAnchor());
+    EXPECT_EQ(PTC.getWindow().getAnchor(), 0x8000);
+}
+
 TEST(PowerAnalysisConfig, base) {
     PowerAnalysisConfig PACHW(PowerAnalysisConfig::HAMMING_WEIGHT,
                               make_unique<TestPowerDumper>(), NoiseSource::ZERO,
@@ -954,6 +1233,41 @@ TEST(PowerAnalysisConfig, base) {
     EXPECT_EQ(PACHD.getPowerModel(), PowerAnalysisConfig::HAMMING_WEIGHT);
 }
 
+TEST(PowerAnalysisConfig, copy) {
+    PowerAnalysisConfig PAC(PowerAnalysisConfig::HAMMING_DISTANCE,
+                            make_unique<TestPowerDumper>(),
+                            NoiseSource::CONSTANT, 3.);
+    PAC.setWithoutNoise();
+
+    auto TPD = make_unique<TestPowerDumper>();
+    PowerDumper *D = TPD.get();
+    PowerAnalysisConfig Copy(PAC, std::move(TPD));
+    EXPECT_TRUE(Copy.isHammingDistance());
+    EXPECT_FALSE(Copy.addNoise());
+    EXPECT_EQ(Copy.getNoise(), 3.0);
+    EXPECT_EQ(&Copy.getDumper(), D);
+    EXPECT_NE(&Copy.getDumper(), &PAC.getDumper());
+
+    PAC.setRealizations(4);
+    PowerAnalysisConfig Copy2(PAC, make_unique<TestPowerDumper>());
+    EXPECT_EQ(Copy2.getRealizations(), 4);
+}
+
+TEST(PowerAnalysisConfig, seedNoise) {
+    PowerAnalysisConfig PAC1(PowerAnalysisConfig::HAMMING_WEIGHT,
+                             make_unique<TestPowerDumper>(),
+                             NoiseSource::NORMAL, 1.);
+    PowerAnalysisConfig PAC2(PowerAnalysisConfig::HAMMING_WEIGHT,
+                             make_unique<TestPowerDumper>(),
+                             NoiseSource::NORMAL, 1.);
+    PAC1.seedNoise(1234);
+    PAC2.seedNoise(1234);
+    double noise[3];
+    PAC1.getNoise(noise, 3);
+    for (const double n : noise)
+        EXPECT_EQ(PAC2.getNoise(), n);
+}
+
 TEST(PowerTrace, Oracle) {
     PAF::SCA::PowerTrace::Oracle oracle;
     EXPECT_EQ(oracle.getMemoryState(0x1234, 4, 5), 0ull);
@@ -1104,6 +1418,131 @@ TEST(PowerTrace, withNoise) {
     EXPECT_EQ(TID.numInstructions(), 0);
 }
 
+TEST(PowerTrace, realizations) {
+    TestRegBankDumper TRBD;
+    TestMemAccessesDumper TMAD;
+    TestInstrDumper TID;
+    TestTimingInfo TTI;
+    PowerTraceConfig PTC;
+    vector<PowerAnalysisConfig> PAConfig;
+    PAConfig.emplace_back(PowerAnalysisConfig::HAMMING_WEIGHT,
+                          make_unique<TestPowerDumper>(), NoiseSource::NORMAL,
+                          1.0);
+    auto &TPD = dynamic_cast<TestPowerDumper &>(PAConfig[0].getDumper());
+    unique_ptr<ArchInfo> CPU = make_unique<PAF::V7MInfo>();
+    TestOracle oracle(&Insts[0], Insts.size());
+
+    PowerTrace PT(PTC, *CPU);
+    PT.add(Insts[0]);
+    PT.add(Insts[1]);
+
+    // The reference, noise free, power trace.
+    PAConfig[0].setWithoutNoise();
+    PT.analyze(PAConfig, oracle, TTI, TRBD, TMAD, TID);
+    const vector<PowerFields> clean = TPD.pwf;
+    const size_t n = clean.size();
+
+    // The power trace with noise, as emitted without realizations.
+    PAConfig[0].setWithNoise().seedNoise(1234);
+    TPD.reset();
+    PT.analyze(PAConfig, oracle, TTI, TRBD, TMAD, TID);
+    const vector<PowerFields> noisy = TPD.pwf;
+    EXPECT_EQ(noisy.size(), n);
+
+    // Each realization is a row, with its own noise. The first one gets the
+    // noise the power trace would have got without realizations.
+    PAConfig[0].setRealizations(3).seedNoise(1234);
+    TPD.reset();
+    PT.analyze(PAConfig, oracle, TTI, TRBD, TMAD, TID);
+    EXPECT_EQ(TPD.numNextTrace, 2);
+    EXPECT_EQ(TPD.pwf.size(), 3 * n);
+    for (size_t i = 0; i < n; i++) {
+        EXPECT_NEAR(TPD.pwf[i].total, noisy[i].total, 1e-9);
+        EXPECT_NEAR(TPD.pwf[i].oreg, noisy[i].oreg, 1e-9);
+        EXPECT_NEAR(TPD.pwf[i].ireg, noisy[i].ireg, 1e-9);
+        EXPECT_NEAR(TPD.pwf[i].addr, noisy[i].addr, 1e-9);
+        EXPECT_NEAR(TPD.pwf[i].data, noisy[i].data, 1e-9);
+        EXPECT_EQ(TPD.pwf[i].pc, noisy[i].pc);
+        EXPECT_EQ(TPD.pwf[i].instr, noisy[i].instr);
+        EXPECT_EQ(TPD.pwf[i].inst, noisy[i].inst);
+        EXPECT_NE(TPD.pwf[i].total, TPD.pwf[n + i].total);
+        EXPECT_NE(TPD.pwf[n + i].total, TPD.pwf[2 * n + i].total);
+    }
+
+    // Without noise, all realizations are the noise free power trace.
+    PAConfig[0].setWithoutNoise();
+    TPD.reset();
+    PT.analyze(PAConfig, oracle, TTI, TRBD, TMAD, TID);
+    EXPECT_EQ(TPD.numNextTrace, 2);
+    EXPECT_EQ(TPD.pwf.size(), 3 * n);
+    for (size_t r = 0; r < 3; r++)
+        for (size_t i = 0; i < n; i++)
+            EXPECT_EQ(TPD.pwf[r * n + i], clean[i]);
+}
+
+TEST(PowerTrace, repeatedInstructions) {
+    // The same instruction (pc and encoding) executed several times, with
+    // different register accesses: each execution must get the same power as
+    // when it is analyzed alone.
+    const vector<ReferenceInstruction> Loop{
+        // clang-format off
+        Insts[0],
+        {
+            28, IE_CCFAIL, 0x089bc, THUMB, 16, 0x02105, "MOVS r1,#5",
+            {},
+            {}
+        },
+        {
+            29, IE_EXECUTED, 0x089bc, THUMB, 16, 0x02105, "MOVS r1,#5",
+            {},
+            {
+                RegisterAccess("cpsr", 0x61000000, RegisterAccess::Type::WRITE),
+                RegisterAccess("r1", 0xff, RegisterAccess::Type::WRITE),
+            }
+        },
+        {
+            30, IE_EXECUTED, 0x089bc, THUMB, 16, 0x02105, "MOVS r1,#5",
+            {},
+            {
+                RegisterAccess("r1", 5, RegisterAccess::Type::WRITE),
+                RegisterAccess("cpsr", 0x21000000, RegisterAccess::Type::WRITE),
+            }
+        },
+        // clang-format on
+    };
+
+    const auto analyze = [](const vector<ReferenceInstruction> &instrs) {
+        TestRegBankDumper TRBD;
+        TestMemAccessesDumper TMAD;
+        TestInstrDumper TID;
+        TestTimingInfo TTI;
+        PowerTraceConfig PTC;
+        vector<PowerAnalysisConfig> PAConfig;
+        PAConfig.emplace_back(PowerAnalysisConfig::HAMMING_WEIGHT,
+                              make_unique<TestPowerDumper>(),
+                              NoiseSource::ZERO, 0.0);
+        PAConfig[0].setWithoutNoise();
+        unique_ptr<ArchInfo> CPU = make_unique<PAF::V7MInfo>();
+        TestOracle oracle(&instrs[0], instrs.size());
+        PowerTrace PT(PTC, *CPU);
+        for (const auto &I : instrs)
+            PT.add(I);
+        PT.analyze(PAConfig, oracle, TTI, TRBD, TMAD, TID);
+        return dynamic_cast<TestPowerDumper &>(PAConfig[0].getDumper()).pwf;
+    };
+
+    const vector<PowerFields> all = analyze(Loop);
+    ASSERT_EQ(all.size(), Loop.size());
+    for (size_t i = 0; i < Loop.size(); i++) {
+        const vector<PowerFields> one = analyze({Loop[i]});
+        ASSERT_EQ(one.size(), 1);
+        EXPECT_EQ(all[i], one[0]);
+    }
+    EXPECT_NE(all[0], all[1]);
+    EXPECT_NE(all[0], all[2]);
+    EXPECT_EQ(all[0], all[3]);
+}
+
 TEST(PowerTrace, HammingWeightWithConfig) {
     // Tests that only the source contributing to the power have non zero power.
     TestRegBankDumper TRBD(true);
@@ -1694,6 +2133,334 @@ TEST(PowerTrace, multipleAnalyses) {
     // Test regbank, memaccesses, instr and timing.
 }
 
+// An oracle counting the queries it gets, where the register bank
+// state is fixed and each memory byte holds the low byte of its address.
+class CountingOracle : public PowerTrace::Oracle {
+  public:
+    CountingOracle(size_t NR, bool big_endian = false)
+        : regBank(NR), bigEndian(big_endian) {
+        for (size_t r = 0; r < NR; r++)
+            regBank[r] = 0x10 + r;
+    }
+
+    [[nodiscard]] std::vector<uint64_t> getRegBankState(Time t) const override {
+        regQueries += 1;
+        return regBank;
+    }
+
+    [[nodiscard]] uint64_t getMemoryState(Addr address, size_t size,
+                                          Time t) const override {
+        memQueries += 1;
+        uint64_t v = 0;
+        for (size_t b = 0; b < size; b++)
+            v |= ((address + b) & 0xFF) << (8 * (bigEndian ? size - 1 - b : b));
+        return v;
+    }
+
+    const vector<uint64_t> &initialState() const { return regBank; }
+
+    mutable size_t regQueries{0};
+    mutable size_t memQueries{0};
+
+  private:
+    vector<uint64_t> regBank;
+    const bool bigEndian;
+};
+
+TEST(ShadowOracle, base) {
+    unique_ptr<ArchInfo> CPU = make_unique<PAF::V7MInfo>();
+    auto backing = make_unique<CountingOracle>(CPU->numRegisters());
+    const CountingOracle &CO = *backing;
+    PowerTrace::ShadowOracle SO(std::move(backing), *CPU,
+                                /* big_endian: */ false);
+    vector<uint64_t> regs = CO.initialState();
+
+    // Queries are forwarded until the tracking starts.
+    EXPECT_EQ(SO.getRegBankState(10), regs);
+    EXPECT_EQ(CO.regQueries, 1);
+
+    SO.start(26);
+    EXPECT_EQ(CO.regQueries, 2);
+    EXPECT_EQ(SO.getRegBankState(26), regs);
+    EXPECT_EQ(CO.regQueries, 2);
+
+    SO.update(Insts[0]);
+    regs[CPU->registerId("r1")] = 5;
+    regs[CPU->registerId("cpsr")] = 0x21000000;
+    regs[CPU->registerId("pc")] = Insts[0].pc;
+    EXPECT_EQ(SO.getRegBankState(27), regs);
+    EXPECT_EQ(CO.regQueries, 2);
+
+    // Earlier states are queried from the backing oracle.
+    EXPECT_EQ(SO.getRegBankState(26), CO.initialState());
+    EXPECT_EQ(CO.regQueries, 3);
+
+    SO.update(Insts[1]);
+    SO.update(Insts[2]);
+    regs[CPU->registerId("r2")] = 5;
+    regs[CPU->registerId("pc")] = Insts[2].pc;
+    EXPECT_EQ(SO.getRegBankState(29), regs);
+    EXPECT_EQ(CO.regQueries, 3);
+
+    // Stored bytes are known.
+    EXPECT_EQ(SO.getMemoryState(0x21afc, 4, 29), 5);
+    EXPECT_EQ(SO.getMemoryState(0x21afe, 4, 29), 0x50000);
+    EXPECT_EQ(SO.getMemoryState(0x21b00, 1, 29), 5);
+    EXPECT_EQ(CO.memQueries, 0);
+
+    // Unknown bytes are fetched once.
+    EXPECT_EQ(SO.getMemoryState(0x1234, 2, 29), 0x3534);
+    EXPECT_EQ(CO.memQueries, 1);
+    EXPECT_EQ(SO.getMemoryState(0x1234, 2, 29), 0x3534);
+    EXPECT_EQ(CO.memQueries, 1);
+
+    // Only the unknown bytes of partially known accesses are fetched.
+    EXPECT_EQ(SO.getMemoryState(0x21afa, 4, 29), 0x0005fbfa);
+    EXPECT_EQ(CO.memQueries, 3);
+
+    // Loaded bytes are known too.
+    SO.update(Insts[3]);
+    regs[CPU->registerId("r3")] = 3;
+    regs[CPU->registerId("r4")] = 0x21f64;
+    regs[CPU->registerId("pc")] = Insts[3].pc;
+    EXPECT_EQ(SO.getRegBankState(30), regs);
+    EXPECT_EQ(SO.getMemoryState(0x21f60, 4, 30), 0x21f64);
+    EXPECT_EQ(SO.getMemoryState(0x21f5c, 4, 30), 3);
+    EXPECT_EQ(CO.memQueries, 3);
+
+    // Restarting forgets the tracked state.
+    SO.start(100);
+    EXPECT_EQ(CO.regQueries, 4);
+    EXPECT_EQ(SO.getRegBankState(100), CO.initialState());
+    EXPECT_EQ(SO.getMemoryState(0x21afc, 4, 100), 0xfffefdfc);
+    EXPECT_EQ(CO.memQueries, 4);
+}
+
+TEST(ShadowOracle, bigEndian) {
+    unique_ptr<ArchInfo> CPU = make_unique<PAF::V7MInfo>();
+    auto backing = make_unique<CountingOracle>(CPU->numRegisters(),
+                                               /* big_endian: */ true);
+    const CountingOracle &CO = *backing;
+    PowerTrace::ShadowOracle SO(std::move(backing), *CPU,
+                                /* big_endian: */ true);
+
+    SO.start(28);
+    SO.update(Insts[2]);
+    EXPECT_EQ(SO.getMemoryState(0x21afc, 4, 29), 5);
+    EXPECT_EQ(SO.getMemoryState(0x21afc, 2, 29), 0);
+    EXPECT_EQ(SO.getMemoryState(0x21afe, 2, 29), 5);
+    EXPECT_EQ(CO.memQueries, 0);
+
+    EXPECT_EQ(SO.getMemoryState(0x1234, 2, 29), 0x3435);
+    EXPECT_EQ(SO.getMemoryState(0x1235, 1, 29), 0x35);
+    EXPECT_EQ(CO.memQueries, 1);
+    EXPECT_EQ(SO.getMemoryState(0x21afa, 4, 29), 0xfafb0000);
+    EXPECT_EQ(CO.memQueries, 3);
+}
+
+TEST(PowerTrace, registerIds) {
+    // The register ids resolved at parse time must not change the power
+    // compared to the ids looked up from the register names.
+    unique_ptr<ArchInfo> CPU = make_unique<PAF::V7MInfo>();
+    vector<ReferenceInstruction> withIds(Insts.begin(), Insts.end());
+    for (auto &I : withIds)
+        for (auto &RA : I.regAccess) {
+            EXPECT_EQ(RA.id, RegisterAccess::UNKNOWN_ID);
+            RA.id = CPU->findRegisterId(RA.name);
+            EXPECT_NE(RA.id, RegisterAccess::UNKNOWN_ID);
+        }
+
+    const auto analyze = [&](const vector<ReferenceInstruction> &instrs,
+                             PowerAnalysisConfig::PowerModel model) {
+        TestRegBankDumper TRBD;
+        TestMemAccessesDumper TMAD;
+        TestInstrDumper TID;
+        TestTimingInfo TTI;
+        PowerTraceConfig PTC;
+        vector<PowerAnalysisConfig> PAConfig;
+        PAConfig.emplace_back(model, make_unique<TestPowerDumper>(),
+                              NoiseSource::ZERO, 0.0);
+        PAConfig[0].setWithoutNoise();
+        InstsStateOracle oracle;
+        PowerTrace PT(PTC, *CPU);
+        for (const auto &I : instrs)
+            PT.add(I);
+        PT.analyze(PAConfig, oracle, TTI, TRBD, TMAD, TID);
+        return dynamic_cast<TestPowerDumper &>(PAConfig[0].getDumper()).pwf;
+    };
+
+    const vector<ReferenceInstruction> withNames(Insts.begin(), Insts.end());
+    for (const auto model : {PowerAnalysisConfig::HAMMING_WEIGHT,
+                             PowerAnalysisConfig::HAMMING_DISTANCE})
+        EXPECT_EQ(analyze(withIds, model), analyze(withNames, model));
+}
+
+TEST(PowerTrace, window) {
+    // The samples in the window must be the ones the complete trace has at
+    // the same position, as the state is tracked outside of the window.
+    unique_ptr<ArchInfo> CPU = make_unique<PAF::V7MInfo>();
+    struct Result {
+        vector<PowerFields> pwf;
+        size_t numSnapshots;
+        size_t numInstructions;
+    };
+    const auto analyze = [&](PowerAnalysisConfig::PowerModel model,
+                             const PowerTraceConfig::Window &W) {
+        TestRegBankDumper TRBD(true);
+        TestMemAccessesDumper TMAD;
+        TestInstrDumper TID(true);
+        TestTimingInfo TTI;
+        PowerTraceConfig PTC;
+        PTC.setWindow(W);
+        vector<PowerAnalysisConfig> PAConfig;
+        PAConfig.emplace_back(model, make_unique<TestPowerDumper>(),
+                              NoiseSource::ZERO, 0.0);
+        PAConfig[0].setWithoutNoise();
+        InstsStateOracle oracle;
+        PowerTrace PT(PTC, *CPU);
+        for (size_t i = 0; i < 4; i++)
+            PT.add(Insts[i]);
+        PT.analyze(PAConfig, oracle, TTI, TRBD, TMAD, TID);
+        return Result{
+            dynamic_cast<TestPowerDumper &>(PAConfig[0].getDumper()).pwf,
+            TRBD.numSnapshots(), TID.numInstructions()};
+    };
+
+    using Window = PowerTraceConfig::Window;
+    for (const auto model : {PowerAnalysisConfig::HAMMING_WEIGHT,
+                             PowerAnalysisConfig::HAMMING_DISTANCE}) {
+        const vector<PowerFields> all = analyze(model, Window()).pwf;
+        ASSERT_EQ(all.size(), 6); // 4 instructions, 2 extra cycles.
+        const auto slice = [&](size_t b, size_t e) {
+            return vector<PowerFields>(all.begin() + b, all.begin() + e);
+        };
+
+        // Cycles, which may start or end in the middle of an instruction.
+        Result R = analyze(model, Window(Window::CYCLES, 3, 5));
+        EXPECT_EQ(R.pwf, slice(3, 5));
+        EXPECT_EQ(R.numSnapshots, 2);
+        EXPECT_EQ(R.numInstructions, 2);
+        EXPECT_EQ(analyze(model, Window(Window::CYCLES, 1)).pwf, slice(1, 6));
+        EXPECT_TRUE(analyze(model, Window(Window::CYCLES, 2, 2)).pwf.empty());
+
+        // Instructions.
+        R = analyze(model, Window(Window::INSTRUCTIONS, 1, 3));
+        EXPECT_EQ(R.pwf, slice(1, 4));
+        EXPECT_EQ(R.numSnapshots, 2);
+        EXPECT_EQ(R.numInstructions, 2);
+        EXPECT_TRUE(
+            analyze(model, Window(Window::INSTRUCTIONS, 4, 10)).pwf.empty());
+
+        // Relative to the first execution of an address.
+        EXPECT_EQ(analyze(model, Window(Window::INSTRUCTIONS, 0, 1)
+                                     .setAnchor(Insts[2].pc))
+                      .pwf,
+                  slice(2, 4));
+        EXPECT_EQ(analyze(model, Window(Window::CYCLES, 1).setAnchor(
+                                     Insts[2].pc | 1))
+                      .pwf,
+                  slice(3, 6));
+        const Addr unreached = Insts[3].pc + 0x100;
+        EXPECT_TRUE(analyze(model, Window().setAnchor(unreached)).pwf.empty());
+    }
+}
+
+TEST(ShadowOracle, registerIds) {
+    unique_ptr<ArchInfo> CPU = make_unique<PAF::V7MInfo>();
+    auto backing = make_unique<CountingOracle>(CPU->numRegisters());
+    const CountingOracle &CO = *backing;
+    PowerTrace::ShadowOracle SO(std::move(backing), *CPU,
+                                /* big_endian: */ false);
+    vector<uint64_t> regs = CO.initialState();
+
+    // The register ids resolved at parse time are used, even for the names
+    // which are not the ones from the CPU description.
+    const unsigned LR = CPU->findRegisterId("lr");
+    const ReferenceInstruction I(
+        27, IE_EXECUTED, 0x089ba, THUMB, 16, 0x4770, "BX lr", {},
+        {RegisterAccess("lr", 0x1234, RegisterAccess::Type::WRITE, LR),
+         RegisterAccess("s0", 0x5678, RegisterAccess::Type::WRITE,
+                        RegisterAccess::UNKNOWN_ID)});
+    SO.start(26);
+    SO.update(I);
+    regs[LR] = 0x1234;
+    regs[CPU->registerId("pc")] = I.pc;
+    EXPECT_EQ(SO.getRegBankState(27), regs);
+}
+
+TEST(PowerTraceRecorder, base) {
+    PowerTraceConfig PTC;
+    unique_ptr<ArchInfo> CPU = make_unique<PAF::V7MInfo>();
+    InstsStateOracle oracle;
+    PowerTrace PT(PTC, *CPU);
+    for (const auto &I : Insts)
+        PT.add(I);
+
+    // The reference: analyze the trace twice, in sequence.
+    TestRegBankDumper TRBD(true);
+    TestMemAccessesDumper TMAD(true);
+    TestInstrDumper TID(true);
+    TestTimingInfo TTI;
+    vector<PowerAnalysisConfig> PAConfigs;
+    PAConfigs.emplace_back(PowerAnalysisConfig::HAMMING_WEIGHT,
+                           make_unique<TestPowerDumper>(), NoiseSource::ZERO,
+                           1.0);
+    PAConfigs.emplace_back(PowerAnalysisConfig::HAMMING_DISTANCE,
+                           make_unique<TestPowerDumper>(), NoiseSource::ZERO,
+                           1.0);
+    for (size_t t = 0; t < 2; t++) {
+        PT.analyze(PAConfigs, oracle, TTI, TRBD, TMAD, TID);
+        for (auto &cfg : PAConfigs)
+            cfg.getDumper().nextTrace();
+        TTI.nextTrace();
+        TRBD.nextTrace();
+    }
+
+    // Record the analyses, and replay them.
+    TestRegBankDumper RRBD(true);
+    TestMemAccessesDumper RMAD(true);
+    TestInstrDumper RID(true);
+    TestTimingInfo RTI;
+    vector<PowerAnalysisConfig> RPAConfigs;
+    RPAConfigs.emplace_back(PowerAnalysisConfig::HAMMING_WEIGHT,
+                            make_unique<TestPowerDumper>(), NoiseSource::ZERO,
+                            1.0);
+    RPAConfigs.emplace_back(PowerAnalysisConfig::HAMMING_DISTANCE,
+                            make_unique<TestPowerDumper>(), NoiseSource::ZERO,
+                            1.0);
+    vector<PowerTraceRecorder> recorders;
+    for (size_t t = 0; t < 2; t++)
+        recorders.emplace_back(RPAConfigs, RRBD, RMAD, RID);
+    for (auto &r : recorders)
+        r.analyze(PT, oracle);
+    for (const auto &r : recorders) {
+        r.replay(RPAConfigs, RTI, RRBD, RMAD, RID);
+        for (auto &cfg : RPAConfigs)
+            cfg.getDumper().nextTrace();
+        RTI.nextTrace();
+        RRBD.nextTrace();
+    }
+
+    for (size_t i = 0; i < PAConfigs.size(); i++) {
+        const auto &TPD =
+            dynamic_cast<const TestPowerDumper &>(PAConfigs[i].getDumper());
+        const auto &RPD =
+            dynamic_cast<const TestPowerDumper &>(RPAConfigs[i].getDumper());
+        EXPECT_EQ(TPD.pwf.size(), 12);
+        EXPECT_EQ(TPD.pwf, RPD.pwf);
+    }
+    EXPECT_EQ(RTI.minimum(), TTI.minimum());
+    EXPECT_EQ(RTI.maximum(), TTI.maximum());
+    EXPECT_EQ(RTI.locations(), TTI.locations());
+    EXPECT_EQ(RRBD.numTraces(), TRBD.numTraces());
+    EXPECT_EQ(RRBD.numSnapshots(), TRBD.numSnapshots());
+    for (size_t s = 0; s < Insts.size(); s++)
+        EXPECT_TRUE(RRBD.check(0, s, oracle.getRegBankState(Insts[s].time)));
+    EXPECT_EQ(RMAD.instrWithAccesses(), TMAD.instrWithAccesses());
+    EXPECT_EQ(RMAD.lastAccessesSize(), TMAD.lastAccessesSize());
+    EXPECT_EQ(RID.numInstructions(), TID.numInstructions());
+}
+
 #if 0
 // Additional tests for PowerTrace::Oracle and PowerTrace::MTAOracle
 namespace {
@@ -0,0 +1,99 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/Prefetcher.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+using namespace PAF::SCA;
+
+using std::string;
+using std::vector;
+
+TEST(Prefetcher, Empty) {
+    size_t calls = 0;
+    Prefetcher<int> P(0, [&](size_t i) {
+        calls++;
+        return int(i);
+    });
+    EXPECT_EQ(P.size(), 0);
+    EXPECT_FALSE(P.next());
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(Prefetcher, Sequence) {
+    for (bool prefetch : {false, true}) {
+        std::atomic<size_t> calls{0};
+        Prefetcher<string> P(
+            4,
+            [&](size_t i) {
+                calls++;
+                return string(i + 1, 'a' + i);
+            },
+            prefetch);
+        EXPECT_EQ(P.size(), 4);
+
+        vector<string> items;
+        while (P.next()) {
+            EXPECT_EQ(P.index(), items.size());
+            items.push_back(P.current());
+        }
+        EXPECT_EQ(items, vector<string>({"a", "bb", "ccc", "dddd"}));
+        EXPECT_EQ(calls, 4);
+
+        // The sequence stays exhausted.
+        EXPECT_FALSE(P.next());
+        EXPECT_EQ(calls, 4);
+    }
+}
+
+TEST(Prefetcher, LoadsAhead) {
+    std::atomic<size_t> calls{0};
+    {
+        Prefetcher<int> P(3, [&](size_t i) {
+            calls++;
+            return int(i);
+        });
+        EXPECT_TRUE(P.next());
+        EXPECT_EQ(P.current(), 0);
+    }
+    // The second item was being loaded while the first one was processed,
+    // and the Prefetcher destructor waited for it, but the third item was
+    // never requested.
+    EXPECT_EQ(calls, 2);
+
+    calls = 0;
+    {
+        Prefetcher<int> P(
+            3,
+            [&](size_t i) {
+                calls++;
+                return int(i);
+            },
+            /* prefetch: */ false);
+        EXPECT_TRUE(P.next());
+        EXPECT_EQ(P.current(), 0);
+    }
+    EXPECT_EQ(calls, 1);
+}
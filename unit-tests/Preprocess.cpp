@@ -0,0 +1,194 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/Preprocess.h"
+#include "PAF/SCA/NPArray.h"
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace PAF::SCA;
+
+using std::vector;
+
+namespace {
+// Apply P to the samples in x.
+vector<double> run(const Preprocessor &P, const vector<double> &x) {
+    vector<double> out(P.samples(x.size()));
+    Preprocessor::Scratch scratch;
+    P.apply(out.data(), x.data(), x.size(), scratch);
+    return out;
+}
+
+void expectNear(const vector<double> &actual, const vector<double> &expected,
+                double tolerance = 1e-12) {
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); i++)
+        EXPECT_NEAR(actual[i], expected[i], tolerance) << "at index " << i;
+}
+} // namespace
+
+TEST(Preprocessor, empty) {
+    const Preprocessor P;
+    EXPECT_TRUE(P.empty());
+    EXPECT_EQ(P.size(), 0);
+    EXPECT_EQ(P.samples(10), 10);
+    expectNear(run(P, {1.0, 2.0, 3.0}), {1.0, 2.0, 3.0});
+}
+
+TEST(Preprocessor, FIR) {
+    const vector<double> x{1.0, 2.0, 4.0, 8.0, 16.0};
+
+    // Filters are centered, the edges replicating the first and last samples.
+    expectNear(run(Preprocessor().addFIR({2.0}), x),
+               {2.0, 4.0, 8.0, 16.0, 32.0});
+    expectNear(run(Preprocessor().addFIR({1.0, 0.0, 0.0}), x),
+               {1.0, 1.0, 2.0, 4.0, 8.0});
+    expectNear(run(Preprocessor().addFIR({0.0, 0.0, 1.0}), x),
+               {2.0, 4.0, 8.0, 16.0, 16.0});
+    expectNear(run(Preprocessor().addFIR({1.0, -1.0}), x),
+               {-1.0, -2.0, -4.0, -8.0, 0.0});
+
+    // Longer traces, spanning several blocks.
+    vector<double> y(3000);
+    for (size_t i = 0; i < y.size(); i++)
+        y[i] = std::sin(0.01 * double(i)) + double(i % 7);
+    const vector<double> taps{0.25, 0.5, 0.125, 0.0625, 0.0625};
+    vector<double> expected(y.size());
+    for (size_t i = 0; i < y.size(); i++)
+        for (size_t k = 0; k < taps.size(); k++) {
+            const ptrdiff_t j = ptrdiff_t(i + k) - 2;
+            expected[i] +=
+                taps[k] * y[std::min(std::max<ptrdiff_t>(j, 0),
+                                     ptrdiff_t(y.size() - 1))];
+        }
+    expectNear(run(Preprocessor().addFIR(taps), y), expected);
+}
+
+TEST(Preprocessor, movingAverage) {
+    const vector<double> x{1.0, 2.0, 4.0, 8.0, 16.0};
+    expectNear(run(Preprocessor().addMovingAverage(1), x), x);
+    expectNear(run(Preprocessor().addMovingAverage(3), x),
+               {4.0 / 3.0, 7.0 / 3.0, 14.0 / 3.0, 28.0 / 3.0, 40.0 / 3.0});
+    expectNear(run(Preprocessor().addMovingAverage(2), x),
+               {1.5, 3.0, 6.0, 12.0, 16.0});
+    // Windows wider than the trace.
+    expectNear(run(Preprocessor().addMovingAverage(11), {1.0, 3.0}),
+               {21.0 / 11.0, 23.0 / 11.0});
+
+    // A moving average is a FIR filter with equal taps.
+    vector<double> y(2500);
+    for (size_t i = 0; i < y.size(); i++)
+        y[i] = std::cos(0.02 * double(i)) * double(i % 13);
+    expectNear(run(Preprocessor().addMovingAverage(8), y),
+               run(Preprocessor().addFIR(vector<double>(8, 0.125)), y),
+               1e-9);
+}
+
+TEST(Preprocessor, downsample) {
+    const Preprocessor P = Preprocessor().addDownsample(4);
+    EXPECT_EQ(P.samples(0), 0);
+    EXPECT_EQ(P.samples(1), 1);
+    EXPECT_EQ(P.samples(16), 4);
+    EXPECT_EQ(P.samples(17), 5);
+
+    // A factor of 1 leaves the trace untouched.
+    const vector<double> x{1.0, -2.0, 4.0, 0.5};
+    expectNear(run(Preprocessor().addDownsample(1), x), x);
+
+    // The anti-aliasing filter has a unit gain at DC.
+    expectNear(run(P, vector<double>(17, 3.0)), vector<double>(5, 3.0));
+
+    // A slow signal goes through, with the kept samples staying in place,
+    // whereas a signal above the new Nyquist frequency is removed.
+    vector<double> slow(400);
+    vector<double> fast(400);
+    for (size_t i = 0; i < slow.size(); i++) {
+        slow[i] = std::sin(2.0 * M_PI * double(i) / 100.0);
+        fast[i] = std::sin(2.0 * M_PI * 0.375 * double(i));
+    }
+    const vector<double> s = run(P, slow);
+    const vector<double> f = run(P, fast);
+    ASSERT_EQ(s.size(), 100);
+    ASSERT_EQ(f.size(), 100);
+    for (size_t j = 4; j < 96; j++) {
+        EXPECT_NEAR(s[j], slow[4 * j], 0.02);
+        EXPECT_NEAR(f[j], 0.0, 0.02);
+    }
+}
+
+TEST(Preprocessor, integrate) {
+    const vector<double> x{1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0};
+    expectNear(run(Preprocessor().addIntegrate(3), x), {6.0, 15.0, 24.0});
+    expectNear(run(Preprocessor().addIntegrate(4), x), {10.0, 26.0});
+    expectNear(run(Preprocessor().addIntegrate(2, 1), x),
+               {5.0, 9.0, 13.0, 17.0});
+    expectNear(run(Preprocessor().addIntegrate(9), x), {45.0});
+    EXPECT_EQ(Preprocessor().addIntegrate(10).samples(9), 0);
+    EXPECT_EQ(Preprocessor().addIntegrate(2, 9).samples(9), 0);
+    EXPECT_EQ(Preprocessor().addIntegrate(2, 12).samples(9), 0);
+}
+
+TEST(Preprocessor, pipeline) {
+    Preprocessor P;
+    P.addMovingAverage(3).addDownsample(2).addIntegrate(5, 1);
+    EXPECT_EQ(P.size(), 3);
+    EXPECT_FALSE(P.empty());
+    EXPECT_EQ(P.samples(100), 9);
+
+    // The stages are applied in order.
+    vector<double> x(100);
+    for (size_t i = 0; i < x.size(); i++)
+        x[i] = double((i * 37) % 101);
+    expectNear(run(P, x),
+               run(Preprocessor().addIntegrate(5, 1),
+                     run(Preprocessor().addDownsample(2),
+                           run(Preprocessor().addMovingAverage(3), x))));
+
+    // All traces are processed, in their storage type, in parallel or not.
+    NPArray<int16_t> traces(37, 100);
+    for (size_t r = 0; r < traces.rows(); r++)
+        for (size_t c = 0; c < traces.cols(); c++)
+            traces(r, c) = int16_t((r * 101 + c * 37) % 211) - 100;
+    const NPArray<double> expected = P.apply(traces);
+    ASSERT_EQ(expected.rows(), traces.rows());
+    ASSERT_EQ(expected.cols(), 9);
+    for (size_t r = 0; r < traces.rows(); r++) {
+        vector<double> row(traces.cols());
+        for (size_t c = 0; c < traces.cols(); c++)
+            row[c] = traces(r, c);
+        const vector<double> out = run(P, row);
+        for (size_t c = 0; c < out.size(); c++)
+            EXPECT_DOUBLE_EQ(expected(r, c), out[c]);
+    }
+
+    const unsigned num_threads = NPArrayBase::numThreads();
+    NPArrayBase::setNumThreads(4);
+    const NPArray<double> parallel = P.apply(traces);
+    NPArrayBase::setNumThreads(num_threads);
+    EXPECT_EQ(parallel, expected);
+
+    // Pipelines leaving no samples.
+    EXPECT_EQ(Preprocessor().addIntegrate(200).apply(traces).cols(), 0);
+}
@@ -22,6 +22,8 @@
 
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -88,3 +90,25 @@ TEST(ProgressMonitor, Invisible) {
     EXPECT_EQ(PM.count(), 4);
     EXPECT_EQ(PM.remaining(), 96);
 }
+
+TEST(ProgressMonitor, Concurrent) {
+    ostringstream os;
+    ProgressMonitor PM(os, "MyTitle", 4000);
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < 4; t++)
+        threads.emplace_back([&]() {
+            for (unsigned i = 0; i < 1000; i++)
+                PM.update();
+        });
+    for (auto &thread : threads)
+        thread.join();
+
+    EXPECT_EQ(PM.count(), 4000);
+    EXPECT_EQ(PM.remaining(), 0);
+    // Each percentage is displayed once, in increasing order.
+    string expected;
+    for (unsigned p = 0; p <= 100; p++)
+        expected += "\rMyTitle: " + std::to_string(p) + "%";
+    EXPECT_EQ(os.str(), expected);
+}
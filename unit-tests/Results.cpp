@@ -0,0 +1,175 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/FI/Results.h"
+#include "PAF/FI/Fault.h"
+
+#include "paf-unit-testing.h"
+
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+using PAF::FI::CampaignResultsReader;
+using PAF::FI::FaultModelBase;
+using PAF::FI::InjectionCampaign;
+using PAF::FI::InjectionRangeInfo;
+using PAF::FI::InstructionSkip;
+using PAF::FI::ResultsIndex;
+
+using Effect = FaultModelBase::Effect;
+
+namespace {
+// Build a campaign with 2 injection ranges, with faults 0..3 in the first one
+// and faults 4..5 in the second one. Fault 6 is outside of both ranges.
+void fill(InjectionCampaign &IC) {
+    IC.addInjectionRangeInfo(
+        InjectionRangeInfo("f1@0", 10, 20, 0x8000, 0x8010));
+    IC.addInjectionRangeInfo(
+        InjectionRangeInfo("f1@1", 30, 40, 0x8000, 0x8010));
+    const Effect effects[] = {Effect::SUCCESS,  Effect::CRASH,
+                              Effect::SUCCESS,  Effect::NOEFFECT,
+                              Effect::SUCCESS,  Effect::NONE,
+                              Effect::UNDECIDED};
+    for (unsigned i = 0; i < 7; i++) {
+        const unsigned long time = i < 4 ? 10 + i : i < 6 ? 26 + i : 50;
+        auto *F = new InstructionSkip(time, 0x8000 + 2 * (i % 2), 0x2000,
+                                      0xbf00, 16, true, "MOVS r0,#0");
+        F->setBreakpoint(0x8000 + 2 * (i % 2), 0);
+        if (i == 4)
+            F->setWeight(3);
+        F->setEffect(effects[i]);
+        IC.addFault(F);
+    }
+}
+} // namespace
+
+TEST_WITH_TEMP_FILES(ResultsF, "test-Results.XXXXXX", 2);
+
+TEST_F(ResultsF, reader) {
+    InjectionCampaign IC("image.elf", "trace.tarmac", 1000, 0x8000, 0x9000);
+    fill(IC);
+    for (const auto Format :
+         {InjectionCampaign::Format::YAML, InjectionCampaign::Format::BINARY}) {
+        ASSERT_TRUE(IC.dumpToFile(getTemporaryFilename(), Format, IC.all()));
+        CampaignResultsReader CRR(getTemporaryFilename());
+        ASSERT_TRUE(CRR.good()) << CRR.error();
+        const auto &ranges = CRR.getInjectionRanges();
+        ASSERT_EQ(ranges.size(), 2);
+        EXPECT_EQ(ranges[1].getName(), "f1@1");
+        EXPECT_EQ(ranges[1].getStartTime(), 30);
+        EXPECT_EQ(ranges[1].getEndTime(), 40);
+        EXPECT_EQ(ranges[1].getStartAddress(), 0x8000);
+        EXPECT_EQ(ranges[1].getEndAddress(), 0x8010);
+
+        CampaignResultsReader::Result R;
+        vector<CampaignResultsReader::Result> results;
+        while (CRR.next(R))
+            results.push_back(R);
+        ASSERT_TRUE(CRR.good()) << CRR.error();
+        ASSERT_EQ(results.size(), 7);
+        EXPECT_EQ(results[4].id, 4);
+        EXPECT_EQ(results[4].time, 30);
+        EXPECT_EQ(results[4].address, 0x8000);
+        EXPECT_EQ(results[4].weight, 3);
+        EXPECT_EQ(results[4].effect, Effect::SUCCESS);
+        EXPECT_EQ(results[5].address, 0x8002);
+        EXPECT_EQ(results[5].weight, 1);
+        EXPECT_EQ(results[5].effect, Effect::NONE);
+    }
+
+    CampaignResultsReader Missing("non-existent-campaign.yml");
+    EXPECT_FALSE(Missing.good());
+
+    std::ofstream(getTemporaryFilename())
+        << "Campaign:\n"
+        << "  - { Id: 0, Time: 10, Address: 0x8000, Effect: \"success\"}\n"
+        << "  - { Id: 1, Time: 11, Address: 0x8002, Effect: \"broken\"}\n";
+    CampaignResultsReader Bad(getTemporaryFilename());
+    ASSERT_TRUE(Bad.good()) << Bad.error();
+    CampaignResultsReader::Result R;
+    EXPECT_TRUE(Bad.next(R));
+    EXPECT_FALSE(Bad.next(R));
+    EXPECT_FALSE(Bad.good());
+}
+
+TEST_F(ResultsF, index) {
+    InjectionCampaign IC("image.elf", "trace.tarmac", 1000, 0x8000, 0x9000);
+    fill(IC);
+    ASSERT_TRUE(IC.dumpToFile(getTemporaryFilename(0),
+                              InjectionCampaign::Format::YAML, {0, 4}));
+    ASSERT_TRUE(IC.dumpToFile(getTemporaryFilename(1),
+                              InjectionCampaign::Format::BINARY, {4, 7}));
+
+    // Aggregate the 2 shards.
+    ResultsIndex RI;
+    string error;
+    ASSERT_TRUE(RI.add(getTemporaryFilename(0), error)) << error;
+    ASSERT_TRUE(RI.add(getTemporaryFilename(1), error)) << error;
+    EXPECT_EQ(RI.size(), 7);
+    EXPECT_EQ(RI.getInjectionRanges().size(), 2);
+
+    const ResultsIndex::Counts &T = RI.getTotal();
+    EXPECT_EQ(T.get(Effect::SUCCESS), 5);
+    EXPECT_EQ(T.get(Effect::CRASH), 1);
+    EXPECT_EQ(T.get(Effect::NOEFFECT), 1);
+    EXPECT_EQ(T.get(Effect::UNDECIDED), 1);
+    EXPECT_EQ(T.get(Effect::NONE), 1);
+    EXPECT_EQ(T.get(Effect::CAUGHT), 0);
+    EXPECT_EQ(T.total(), 9);
+
+    EXPECT_EQ(RI.getEffect(1), Effect::CRASH);
+    EXPECT_EQ(RI.getEffect(5), Effect::NONE);
+    EXPECT_EQ(RI.getEffect(100), Effect::NONE);
+    EXPECT_EQ(RI.getIds(Effect::SUCCESS), vector<uint64_t>({0, 2, 4}));
+
+    const auto &A = RI.byAddress();
+    ASSERT_EQ(A.size(), 2);
+    EXPECT_EQ(A.at(0x8000).get(Effect::SUCCESS), 5);
+    EXPECT_EQ(A.at(0x8000).total(), 6);
+    EXPECT_EQ(A.at(0x8002).get(Effect::CRASH), 1);
+    EXPECT_EQ(A.at(0x8002).total(), 3);
+
+    const auto &R = RI.byRange();
+    ASSERT_EQ(R.size(), 2);
+    EXPECT_EQ(R[0].total(), 4);
+    EXPECT_EQ(R[1].get(Effect::SUCCESS), 3);
+    EXPECT_EQ(R[1].total(), 4);
+    EXPECT_EQ(RI.getOutside().get(Effect::UNDECIDED), 1);
+    EXPECT_EQ(RI.getOutside().total(), 1);
+
+    const auto &RA = RI.byRangeAndAddress();
+    EXPECT_EQ(RA.size(), 5);
+    EXPECT_EQ(RA.at({1, 0x8000}).get(Effect::SUCCESS), 3);
+    EXPECT_EQ(RA.at({ResultsIndex::NO_RANGE, 0x8000}).total(), 1);
+
+    const auto F = RI.byFunction();
+    ASSERT_EQ(F.size(), 1);
+    EXPECT_EQ(F.at("f1").get(Effect::SUCCESS), 5);
+    EXPECT_EQ(F.at("f1").total(), 8);
+
+    EXPECT_FALSE(RI.add("non-existent-campaign.yml", error));
+    EXPECT_FALSE(error.empty());
+}
@@ -22,9 +22,12 @@
 #include "PAF/SCA/NPArray.h"
 #include "PAF/SCA/utils.h"
 
+#include "paf-unit-testing.h"
+
 #include "gtest/gtest.h"
 
 #include <cmath>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <memory>
@@ -49,6 +52,28 @@ TEST(SCA, HammingWeight) {
     EXPECT_EQ(hamming_weight<uint32_t>(data, 0x0FFFF), 12);
     EXPECT_EQ(hamming_weight<uint32_t>(data, 0xFFFF0000), 7);
     EXPECT_EQ(hamming_weight<uint32_t>(data, -1U), 19);
+
+    const uint64_t data64 = 0xFFFFFFFF00000001ULL;
+    EXPECT_EQ(hamming_weight<uint64_t>(data64, -1), 33);
+    EXPECT_EQ(hamming_distance<uint64_t>(data64, 0, -1), 33);
+}
+
+TEST(SCA, HammingWeights) {
+    const uint64_t data[] = {0x1267ADEF, 0, 0xFFFFFFFFFFFFFFFF,
+                             0x8000000000000001};
+    double hw[4];
+    hamming_weight(hw, data, 4, uint64_t(-1));
+    EXPECT_EQ(hw[0], 19.0);
+    EXPECT_EQ(hw[1], 0.0);
+    EXPECT_EQ(hw[2], 64.0);
+    EXPECT_EQ(hw[3], 2.0);
+
+    unsigned hw8[4];
+    hamming_weight(hw8, data, 4, uint64_t(0xFF));
+    EXPECT_EQ(hw8[0], 7);
+    EXPECT_EQ(hw8[1], 0);
+    EXPECT_EQ(hw8[2], 8);
+    EXPECT_EQ(hw8[3], 1);
 }
 
 TEST(SCA, HammingDistance) {
@@ -111,6 +136,41 @@ TEST(Utils, find_max) {
     EXPECT_EQ(max_index, 2);
 }
 
+TEST(Utils, select_poi) {
+    const NPArray<double> scores(
+        {0.0, 1.0, -5.0, 0.5, 0.0, 4.0, 0.2, NAN, 0.1, -3.0, //
+         0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 6.0, 0.0, 0.0, 0.0},
+        2, 10);
+
+    EXPECT_EQ(select_poi(scores, 0), vector<size_t>());
+    EXPECT_EQ(select_poi(NPArray<double>(), 3), vector<size_t>());
+
+    // The samples are ranked by their largest absolute score over the rows.
+    EXPECT_EQ(select_poi(scores, 1), vector<size_t>({6}));
+    EXPECT_EQ(select_poi(scores, 3), vector<size_t>({2, 5, 6}));
+    EXPECT_EQ(select_poi(scores, 4), vector<size_t>({2, 5, 6, 9}));
+    EXPECT_EQ(select_poi(scores, 20),
+              vector<size_t>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+
+    // Samples in the window of a better peak are not peaks on their own, and
+    // the windows are merged.
+    EXPECT_EQ(select_poi(scores, 1, 1), vector<size_t>({5, 6, 7}));
+    EXPECT_EQ(select_poi(scores, 2, 1), vector<size_t>({1, 2, 3, 5, 6, 7}));
+    EXPECT_EQ(select_poi(scores, 3, 1),
+              vector<size_t>({1, 2, 3, 5, 6, 7, 8, 9}));
+    EXPECT_EQ(select_poi(scores, 2, 3),
+              vector<size_t>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST(Utils, select_samples) {
+    const NPArray<int16_t> traces({1, 2, 3, 4, 5, 6, 7, 8}, 2, 4);
+    EXPECT_EQ(select_samples(traces, {1, 3}),
+              NPArray<int16_t>({2, 4, 6, 8}, 2, 2));
+    EXPECT_EQ(select_samples(traces, {2, 0, 2}),
+              NPArray<int16_t>({3, 1, 3, 7, 5, 7}, 2, 3));
+    EXPECT_EQ(select_samples(traces, {}).cols(), 0);
+}
+
 static constexpr double EPSILON = 0.000001;
 
 namespace {
@@ -638,3 +698,690 @@ TEST(Correl, pearson) {
     C_a.check(0, 3);
     C_a.check(a.cols() - 4, a.cols() - 1);
 }
+
+TEST(SCA, views) {
+    NPArray<double> a(12, 5);
+    NPArray<double> ival(1, a.rows());
+    std::vector<Classification> classifier(a.rows());
+    for (size_t r = 0; r < a.rows(); r++) {
+        for (size_t c = 0; c < a.cols(); c++)
+            a(r, c) = std::sin(double(r * a.cols() + c)) + 0.1 * double(r % 2);
+        ival(0, r) = double((r * 5) % 7);
+        classifier[r] =
+            r % 2 == 0 ? Classification::GROUP_0 : Classification::GROUP_1;
+    }
+
+    // Interleaved traces can be split into 2 groups with strided views.
+    const NPArrayView<double> g0 = a.view(0, a.rows(), 0, a.cols(), 2);
+    const NPArrayView<double> g1 = a.view(1, a.rows(), 0, a.cols(), 2);
+    EXPECT_EQ(t_test(0, a.cols(), g0, g1), t_test(0, a.cols(), a, classifier));
+    EXPECT_EQ(t_test(1, 4, g0, g1), t_test(1, 4, a, classifier));
+    EXPECT_EQ(perfect_t_test(0, a.cols(), g0, g1),
+              perfect_t_test(0, a.cols(), a, classifier));
+
+    // Computations on a view of the traces are the same as on a copy.
+    const NPArrayView<double> v = a.view(0, a.rows(), 1, 4);
+    const NPArray<double> c(v);
+    EXPECT_EQ(correl(0, v.cols(), v, ival), correl(0, c.cols(), c, ival));
+    EXPECT_EQ(t_test(0, v.cols(), v, classifier),
+              t_test(0, c.cols(), c, classifier));
+}
+
+TEST(SCA, threads) {
+    NPArray<double> a(400, 600);
+    NPArray<double> ival(1, a.rows());
+    std::vector<Classification> classifier(a.rows());
+    for (size_t r = 0; r < a.rows(); r++) {
+        for (size_t c = 0; c < a.cols(); c++)
+            a(r, c) = std::cos(double(r * a.cols() + c)) + 0.01 * double(r % 3);
+        ival(0, r) = double((r * 11) % 13);
+        classifier[r] = r % 3 == 0   ? Classification::GROUP_0
+                        : r % 3 == 1 ? Classification::GROUP_1
+                                     : Classification::IGNORE;
+    }
+    const NPArrayView<double> g0 = a.view(0, a.rows(), 0, a.cols(), 2);
+    const NPArrayView<double> g1 = a.view(1, a.rows(), 0, a.cols(), 2);
+
+    const NPArray<double> t1 = t_test(0, a.cols(), a, classifier);
+    const NPArray<double> t2 = t_test(10, 500, g0, g1);
+    const NPArray<double> c1 = correl(0, a.cols(), a, ival);
+
+    // The results must not depend on the number of threads.
+    for (unsigned num_threads : {3, 8}) {
+        NPArrayBase::setNumThreads(num_threads);
+        EXPECT_EQ(t_test(0, a.cols(), a, classifier), t1);
+        EXPECT_EQ(t_test(10, 500, g0, g1), t2);
+        EXPECT_EQ(correl(0, a.cols(), a, ival), c1);
+    }
+    NPArrayBase::setNumThreads(1);
+}
+
+TEST(SCA, wideTraces) {
+    // More samples than fit in a tile of accumulators.
+    NPArray<double> a(9, 2600);
+    std::vector<Classification> classifier(a.rows());
+    for (size_t r = 0; r < a.rows(); r++) {
+        for (size_t c = 0; c < a.cols(); c++)
+            a(r, c) = std::sin(double(r * a.cols() + c)) + 0.1 * double(r % 2);
+        classifier[r] = r % 2 == 0 ? Classification::GROUP_0
+                                   : Classification::GROUP_1;
+    }
+    classifier[4] = Classification::IGNORE;
+
+    for (unsigned num_threads : {1, 3}) {
+        NPArrayBase::setNumThreads(num_threads);
+        const NPArray<double> t = t_test(3, a.cols(), a, classifier);
+        ASSERT_EQ(t.cols(), a.cols() - 3);
+        for (size_t s = 3; s < a.cols(); s++)
+            EXPECT_EQ(t(0, s - 3), t_test(s, a, classifier));
+    }
+    NPArrayBase::setNumThreads(1);
+}
+
+TEST(SCA, widePerfectTraces) {
+    // More samples than fit in a tile, with some constant columns.
+    NPArray<double> a(9, 2600);
+    std::vector<Classification> classifier(a.rows());
+    for (size_t r = 0; r < a.rows(); r++) {
+        for (size_t c = 0; c < a.cols(); c++)
+            switch (c % 4) {
+            case 0: // Same constant value in both groups.
+                a(r, c) = 1.0;
+                break;
+            case 1: // Different constant values in each group.
+                a(r, c) = double(r % 2);
+                break;
+            case 2: // Constant in group1 only.
+                a(r, c) = r % 2 == 0 ? std::sin(double(r * c)) : 2.0;
+                break;
+            default:
+                a(r, c) = std::sin(double(r * a.cols() + c));
+                break;
+            }
+        classifier[r] = r % 2 == 0 ? Classification::GROUP_0
+                                   : Classification::GROUP_1;
+    }
+
+    NPArray<double> group0(a.rows() / 2 + 1, a.cols());
+    NPArray<double> group1(a.rows() / 2, a.cols());
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t c = 0; c < a.cols(); c++)
+            if (r % 2 == 0)
+                group0(r / 2, c) = a(r, c);
+            else
+                group1(r / 2, c) = a(r, c);
+
+    for (unsigned num_threads : {1, 3}) {
+        NPArrayBase::setNumThreads(num_threads);
+        std::ostringstream os;
+        const NPArray<double> t =
+            perfect_t_test(0, a.cols(), a, classifier, &os);
+        ASSERT_EQ(t.cols(), a.cols());
+        for (size_t s = 0; s < a.cols(); s++)
+            switch (s % 4) {
+            case 0:
+            case 1:
+                EXPECT_EQ(t(0, s), 0.0);
+                break;
+            case 2:
+                EXPECT_EQ(t(0, s), t_test(s, 2.0, group0));
+                break;
+            default:
+                EXPECT_EQ(t(0, s), t_test(s, a, classifier));
+                break;
+            }
+        EXPECT_EQ(os.str(), "Num samples:2600\tNum traces:5+4\n"
+                            "Same constant value: 650 (25%)\n"
+                            "Different constant values: 650 (25%)\n"
+                            "Student t-test: 650 (25%)\n"
+                            "Welsh t-test: 650 (25%)\n");
+        EXPECT_EQ(perfect_t_test(0, a.cols(), group0, group1), t);
+    }
+    NPArrayBase::setNumThreads(1);
+}
+
+// Create the test fixture for the accumulators.
+TEST_WITH_TEMP_FILE(SCAF, "test-SCA.npy.XXXXXX");
+
+TEST_F(SCAF, TTestAccumulator) {
+    const NPArray<double> a = traces(60, 9);
+    vector<Classification> classifier(a.rows());
+    for (size_t r = 0; r < a.rows(); r++)
+        classifier[r] = r % 3 == 0   ? Classification::GROUP_0
+                        : r % 3 == 1 ? Classification::GROUP_1
+                                     : Classification::IGNORE;
+    const NPArray<double> expected = t_test(0, a.cols(), a, classifier);
+
+    // Accumulating all traces at once gives the same result as t_test.
+    TTestAccumulator<double> all(a.cols());
+    EXPECT_TRUE(all.good());
+    EXPECT_EQ(all.samples(), 9);
+    all.add(a, classifier);
+    EXPECT_EQ(all.count(Classification::GROUP_0), 20);
+    EXPECT_EQ(all.count(Classification::GROUP_1), 20);
+    EXPECT_EQ(all.count(Classification::IGNORE), 0);
+    EXPECT_EQ(all.t_test(), expected);
+
+    // Accumulate a batch in one accumulator and single traces in another one,
+    // then merge them.
+    TTestAccumulator<double> acc0(a.cols());
+    TTestAccumulator<double> acc1(a.cols());
+    acc0.add(a.view(0, 25, 0, a.cols()), classifier);
+    for (size_t r = 25; r < a.rows(); r++)
+        acc1.add(a.view(r, r + 1, 0, a.cols()), classifier[r]);
+    EXPECT_EQ(acc1.count(Classification::GROUP_0), 11);
+    EXPECT_TRUE(acc0.merge(acc1));
+    EXPECT_EQ(acc0.count(Classification::GROUP_0), 20);
+    expectNear(acc0.t_test(), expected);
+
+    // Save and restore.
+    ASSERT_TRUE(acc0.save(getTemporaryFilename()));
+    const TTestAccumulator<double> restored(getTemporaryFilename());
+    EXPECT_TRUE(restored.good());
+    EXPECT_EQ(restored.samples(), 9);
+    EXPECT_EQ(restored.count(Classification::GROUP_1), 20);
+    EXPECT_EQ(restored.t_test(), acc0.t_test());
+
+    // Errors.
+    EXPECT_FALSE(acc0.merge(TTestAccumulator<double>(3)));
+    expectNear(acc0.t_test(), expected);
+    ASSERT_TRUE(NPArray<double>(2, 9).save(getTemporaryFilename()));
+    const TTestAccumulator<double> wrong(getTemporaryFilename());
+    EXPECT_FALSE(wrong.good());
+    EXPECT_NE(wrong.error(), nullptr);
+    EXPECT_FALSE(TTestAccumulator<double>("non-existent.npy").good());
+    EXPECT_TRUE(TTestAccumulator<float>().t_test().empty());
+}
+
+TEST_F(SCAF, CorrelAccumulator) {
+    const NPArray<double> a = traces(40, 7);
+    NPArray<double> ival(1, a.rows());
+    for (size_t r = 0; r < a.rows(); r++)
+        ival(0, r) = double((r * 7) % 11);
+    const NPArray<double> expected = correl(0, a.cols(), a, ival);
+
+    // Accumulating all traces at once gives the same result as correl.
+    CorrelAccumulator<double> all(a.cols());
+    EXPECT_TRUE(all.good());
+    EXPECT_EQ(all.samples(), 7);
+    all.add(a, ival);
+    EXPECT_EQ(all.count(), 40);
+    EXPECT_EQ(all.correl(), expected);
+
+    // Accumulate a batch in one accumulator and single traces in another one,
+    // then merge them.
+    CorrelAccumulator<double> acc0(a.cols());
+    CorrelAccumulator<double> acc1(a.cols());
+    acc0.add(a.view(0, 15, 0, a.cols()), ival);
+    for (size_t r = 15; r < a.rows(); r++)
+        acc1.add(a.view(r, r + 1, 0, a.cols()), ival(0, r));
+    EXPECT_EQ(acc1.count(), 25);
+    EXPECT_TRUE(acc0.merge(acc1));
+    EXPECT_EQ(acc0.count(), 40);
+    expectNear(acc0.correl(), expected);
+
+    // Save and restore.
+    ASSERT_TRUE(acc0.save(getTemporaryFilename()));
+    const CorrelAccumulator<double> restored(getTemporaryFilename());
+    EXPECT_TRUE(restored.good());
+    EXPECT_EQ(restored.count(), 40);
+    EXPECT_EQ(restored.correl(), acc0.correl());
+
+    // Accumulate several hypotheses at once.
+    NPArray<double> ivals(3, a.rows());
+    for (size_t r = 0; r < a.rows(); r++) {
+        ivals(0, r) = ival(0, r);
+        ivals(1, r) = double((r * 5) % 9);
+        ivals(2, r) = double(r % 2);
+    }
+    const NPArray<double> expectedH = correl(0, a.cols(), a, ivals);
+    CorrelAccumulator<double> hyp0(a.cols(), 3);
+    CorrelAccumulator<double> hyp1(a.cols(), 3);
+    EXPECT_EQ(hyp0.hypotheses(), 3);
+    hyp0.add(a.view(0, 30, 0, a.cols()), ivals);
+    hyp1.add(a.view(30, a.rows(), 0, a.cols()), ivals, 30);
+    EXPECT_TRUE(hyp0.merge(hyp1));
+    EXPECT_EQ(hyp0.count(), 40);
+    expectNear(hyp0.correl(), expectedH);
+    ASSERT_TRUE(hyp0.save(getTemporaryFilename()));
+    const CorrelAccumulator<double> restoredH(getTemporaryFilename());
+    EXPECT_TRUE(restoredH.good());
+    EXPECT_EQ(restoredH.hypotheses(), 3);
+    EXPECT_EQ(restoredH.count(), 40);
+    EXPECT_EQ(restoredH.correl(), hyp0.correl());
+
+    // Errors.
+    EXPECT_FALSE(acc0.merge(CorrelAccumulator<double>(3)));
+    EXPECT_FALSE(acc0.merge(hyp0));
+    ASSERT_TRUE(NPArray<double>(3, 7).save(getTemporaryFilename()));
+    const CorrelAccumulator<double> wrong(getTemporaryFilename());
+    EXPECT_FALSE(wrong.good());
+    EXPECT_NE(wrong.error(), nullptr);
+    EXPECT_TRUE(CorrelAccumulator<int16_t>().correl().empty());
+}
+
+TEST_F(SCAF, ClassAccumulator) {
+    const NPArray<double> a = traces(60, 9);
+    const size_t numClasses = 4;
+    // Class 3 gets a single trace, which SOST must ignore.
+    vector<uint32_t> classes(a.rows());
+    for (size_t r = 0; r < a.rows(); r++)
+        classes[r] = r == 7 ? 3 : (r * 5) % 3;
+
+    // Compute the expected SNR and SOST naively, from per class means and
+    // variances.
+    NPArray<double> expectedMeans(numClasses, a.cols());
+    NPArray<double> expectedSNR(1, a.cols());
+    NPArray<double> expectedSOST(1, a.cols());
+    for (size_t s = 0; s < a.cols(); s++) {
+        vector<double> sum(numClasses, 0.0);
+        vector<double> sum2(numClasses, 0.0);
+        vector<size_t> cnt(numClasses, 0);
+        for (size_t r = 0; r < a.rows(); r++) {
+            sum[classes[r]] += a(r, s);
+            sum2[classes[r]] += a(r, s) * a(r, s);
+            cnt[classes[r]] += 1;
+        }
+        vector<double> mean(numClasses);
+        vector<double> var(numClasses);
+        for (size_t c = 0; c < numClasses; c++) {
+            mean[c] = sum[c] / double(cnt[c]);
+            var[c] = sum2[c] / double(cnt[c]) - mean[c] * mean[c];
+            expectedMeans(c, s) = mean[c];
+        }
+        double mm = 0.0;
+        double mv = 0.0;
+        for (size_t c = 0; c < numClasses; c++) {
+            mm += mean[c] / double(numClasses);
+            mv += var[c] / double(numClasses);
+        }
+        double vm = 0.0;
+        for (size_t c = 0; c < numClasses; c++)
+            vm += (mean[c] - mm) * (mean[c] - mm) / double(numClasses);
+        expectedSNR(0, s) = vm / mv;
+        double sost = 0.0;
+        for (size_t i = 0; i < numClasses; i++)
+            for (size_t j = i + 1; j < numClasses; j++) {
+                if (cnt[i] < 2 || cnt[j] < 2)
+                    continue;
+                const double d = mean[i] - mean[j];
+                sost += d * d /
+                        (var[i] / double(cnt[i] - 1) +
+                         var[j] / double(cnt[j] - 1));
+            }
+        expectedSOST(0, s) = sost;
+    }
+
+    ClassAccumulator<double> all(numClasses, a.cols());
+    EXPECT_TRUE(all.good());
+    EXPECT_EQ(all.classes(), 4);
+    EXPECT_EQ(all.samples(), 9);
+    all.add(a, classes);
+    EXPECT_EQ(all.count(0), 20);
+    EXPECT_EQ(all.count(3), 1);
+    EXPECT_EQ(all.count(4), 0);
+    expectNear(all.means(), expectedMeans);
+    expectNear(all.snr(), expectedSNR);
+    expectNear(all.sost(), expectedSOST);
+
+    // Accumulate batches in one accumulator and single traces in another
+    // one, then merge them.
+    ClassAccumulator<double> acc0(numClasses, a.cols());
+    ClassAccumulator<double> acc1(numClasses, a.cols());
+    acc0.add(a.view(0, 10, 0, a.cols()), classes);
+    acc0.add(a.view(10, 25, 0, a.cols()), classes, 10);
+    for (size_t r = 25; r < a.rows(); r++)
+        acc1.add(a.view(r, r + 1, 0, a.cols()), classes, r);
+    EXPECT_TRUE(acc0.merge(acc1));
+    EXPECT_EQ(acc0.count(1), 20);
+    expectNear(acc0.snr(), expectedSNR);
+    expectNear(acc0.sost(), expectedSOST);
+
+    // Save and restore.
+    ASSERT_TRUE(acc0.save(getTemporaryFilename()));
+    const ClassAccumulator<double> restored(getTemporaryFilename());
+    EXPECT_TRUE(restored.good());
+    EXPECT_EQ(restored.classes(), 4);
+    EXPECT_EQ(restored.samples(), 9);
+    EXPECT_EQ(restored.count(2), 19);
+    EXPECT_EQ(restored.snr(), acc0.snr());
+    EXPECT_EQ(restored.sost(), acc0.sost());
+
+    // Errors.
+    EXPECT_FALSE(acc0.merge(ClassAccumulator<double>(numClasses, 3)));
+    EXPECT_FALSE(acc0.merge(ClassAccumulator<double>(2, a.cols())));
+    ASSERT_TRUE(NPArray<double>(4, 9).save(getTemporaryFilename()));
+    const ClassAccumulator<double> wrong(getTemporaryFilename());
+    EXPECT_FALSE(wrong.good());
+    EXPECT_NE(wrong.error(), nullptr);
+    EXPECT_TRUE(ClassAccumulator<uint16_t>().snr().empty());
+}
+
+namespace {
+// Compute the t-test of order d for sample s, with several passes over the
+// traces.
+double naiveTTest(unsigned d, size_t s, const NPArray<double> &a,
+                  const vector<Classification> &classifier) {
+    double mean[2];
+    double var[2];
+    double count[2];
+    for (size_t g = 0; g < 2; g++) {
+        const Classification group =
+            g == 0 ? Classification::GROUP_0 : Classification::GROUP_1;
+        vector<double> v;
+        for (size_t r = 0; r < a.rows(); r++)
+            if (classifier[r] == group)
+                v.push_back(a(r, s));
+        count[g] = double(v.size());
+        double m = 0.0;
+        for (double x : v)
+            m += x / count[g];
+        const auto cm = [&](unsigned p) {
+            double sum = 0.0;
+            for (double x : v)
+                sum += std::pow(x - m, p);
+            return sum / count[g];
+        };
+        if (d == 2) {
+            mean[g] = cm(2);
+            var[g] = cm(4) - cm(2) * cm(2);
+        } else {
+            mean[g] = cm(d) / std::pow(cm(2), d / 2.0);
+            var[g] = (cm(2 * d) - cm(d) * cm(d)) / std::pow(cm(2), d);
+        }
+    }
+    return (mean[0] - mean[1]) /
+           std::sqrt(var[0] / count[0] + var[1] / count[1]);
+}
+} // namespace
+
+TEST_F(SCAF, higherOrderTTest) {
+    NPArray<double> a = traces(90, 6);
+    vector<Classification> classifier(a.rows());
+    for (size_t r = 0; r < a.rows(); r++) {
+        classifier[r] = r % 3 == 0   ? Classification::GROUP_0
+                        : r % 3 == 1 ? Classification::GROUP_1
+                                     : Classification::IGNORE;
+        // Make group 1 noisier.
+        if (r % 3 == 1)
+            for (size_t c = 0; c < a.cols(); c++)
+                a(r, c) *= 1.0 + 0.5 * std::cos(double(r + c));
+    }
+
+    // Order 1 is Welsh's t-test.
+    EXPECT_EQ(t_test(0, a.cols(), 1, a, classifier),
+              t_test(0, a.cols(), a, classifier));
+
+    for (unsigned order : {2, 3, 4}) {
+        const NPArray<double> t = t_test(1, a.cols(), order, a, classifier);
+        ASSERT_EQ(t.rows(), 1);
+        ASSERT_EQ(t.cols(), a.cols() - 1);
+        for (size_t s = 1; s < a.cols(); s++) {
+            const double expected = naiveTTest(order, s, a, classifier);
+            EXPECT_NEAR(t(0, s - 1), expected,
+                        1e-9 * std::max(1.0, std::abs(expected)));
+        }
+
+        // The same traces split into 2 groups.
+        NPArray<double> g0(0, a.cols());
+        NPArray<double> g1(0, a.cols());
+        for (size_t r = 0; r < a.rows(); r++)
+            if (classifier[r] == Classification::GROUP_0)
+                g0.extend(NPArray<double>(a.view(r, r + 1, 0, a.cols())),
+                          NPArrayBase::COLUMN);
+            else if (classifier[r] == Classification::GROUP_1)
+                g1.extend(NPArray<double>(a.view(r, r + 1, 0, a.cols())),
+                          NPArrayBase::COLUMN);
+        EXPECT_EQ(t_test(1, a.cols(), order, g0, g1), t);
+
+        // The same traces read by chunks.
+        ASSERT_TRUE(a.save(getTemporaryFilename()));
+        NPYChunkReader<double> reader(getTemporaryFilename(), 16);
+        EXPECT_EQ(t_test(1, a.cols(), order, reader, classifier), t);
+        ShardedNPArray<double> sharded({getTemporaryFilename()});
+        EXPECT_EQ(t_test(1, a.cols(), order, sharded, classifier), t);
+    }
+
+    // The results do not depend on the number of threads.
+    const NPArray<double> wide = traces(60, 3000);
+    const NPArray<double> t2 = t_test(0, wide.cols(), 2, wide, classifier);
+    NPArrayBase::setNumThreads(4);
+    EXPECT_EQ(t_test(0, wide.cols(), 2, wide, classifier), t2);
+    NPArrayBase::setNumThreads(1);
+
+    EXPECT_TRUE(t_test(2, 2, 2, a, classifier).empty());
+}
+
+TEST_F(SCAF, multipleClassifiers) {
+    const NPArray<double> a = traces(120, 150);
+
+    // More classifiers than bits in a word, some of them ignoring traces.
+    const size_t numClassifiers = 70;
+    Classifiers classifiers(numClassifiers, a.rows());
+    EXPECT_EQ(classifiers.size(), numClassifiers);
+    EXPECT_EQ(classifiers.traces(), a.rows());
+    EXPECT_EQ(classifiers.words(), 2);
+    vector<vector<Classification>> classifier(
+        numClassifiers, vector<Classification>(a.rows()));
+    for (size_t c = 0; c < numClassifiers; c++) {
+        for (size_t r = 0; r < a.rows(); r++) {
+            const unsigned v = (r * 2654435761U + c * 40503U) >> 7;
+            classifier[c][r] = c % 3 == 2 && v % 5 == 0
+                                   ? Classification::IGNORE
+                               : v % 2 ? Classification::GROUP_1
+                                       : Classification::GROUP_0;
+        }
+        classifiers.set(c, classifier[c]);
+    }
+    EXPECT_EQ(classifiers.get(5, 7), classifier[5][7]);
+    EXPECT_EQ(classifiers.get(68, 11), classifier[68][11]);
+
+    // The same results as one classifier at a time.
+    const NPArray<double> t = t_test(10, 140, a, classifiers);
+    ASSERT_EQ(t.rows(), numClassifiers);
+    ASSERT_EQ(t.cols(), 130);
+    for (size_t c = 0; c < numClassifiers; c++) {
+        const NPArray<double> tc = t_test(10, 140, a, classifier[c]);
+        for (size_t s = 0; s < t.cols(); s++)
+            EXPECT_NEAR(t(c, s), tc(0, s),
+                        1e-9 * std::max(1.0, std::abs(tc(0, s))));
+    }
+
+    // Whatever the number of threads, or the way the traces are read.
+    NPArrayBase::setNumThreads(4);
+    EXPECT_EQ(t_test(10, 140, a, classifiers), t);
+    NPArrayBase::setNumThreads(1);
+    ASSERT_TRUE(a.save(getTemporaryFilename()));
+    ShardedNPArray<double> sharded({getTemporaryFilename()});
+    EXPECT_EQ(t_test(10, 140, sharded, classifiers), t);
+
+    // A classifier can be reset.
+    classifiers.set(3, 0, Classification::IGNORE);
+    EXPECT_EQ(classifiers.get(3, 0), Classification::IGNORE);
+    classifiers.set(3, 0, Classification::GROUP_0);
+    EXPECT_EQ(classifiers.get(3, 0), Classification::GROUP_0);
+
+    EXPECT_TRUE(t_test(10, 10, a, classifiers).empty());
+    EXPECT_TRUE(t_test(0, 10, a, Classifiers(0, a.rows())).empty());
+}
+
+TEST_F(SCAF, correlHypotheses) {
+    const NPArray<double> a = traces(70, 300);
+    NPArray<double> ival(20, a.rows());
+    for (size_t h = 0; h < ival.rows(); h++)
+        for (size_t t = 0; t < ival.cols(); t++)
+            ival(h, t) = hamming_weight<unsigned>(t * 37 + h * 11, 0xFF);
+
+    // All hypotheses at once give the same correlations as one at a time.
+    const NPArray<double> c = correl(10, 290, a, ival);
+    ASSERT_EQ(c.rows(), ival.rows());
+    ASSERT_EQ(c.cols(), 280);
+    for (size_t h = 0; h < ival.rows(); h++) {
+        const NPArray<double> iv(ival.view(h, h + 1, 0, ival.cols()));
+        const NPArray<double> ch = correl(10, 290, a, iv);
+        for (size_t s = 0; s < c.cols(); s++)
+            EXPECT_EQ(c(h, s), ch(0, s));
+    }
+
+    // Whatever the number of threads, or the way the traces are read.
+    NPArrayBase::setNumThreads(4);
+    EXPECT_EQ(correl(10, 290, a, ival), c);
+    NPArrayBase::setNumThreads(1);
+    ASSERT_TRUE(a.save(getTemporaryFilename()));
+    NPYChunkReader<double> reader(getTemporaryFilename(), 16);
+    EXPECT_EQ(correl(10, 290, reader, ival), c);
+    ShardedNPArray<double> sharded({getTemporaryFilename()});
+    EXPECT_EQ(correl(10, 290, sharded, ival), c);
+}
+
+namespace {
+// Compute the bivariate t-test (if ival is empty) or correlation of the pair
+// of samples (i, j), by materializing the centered products.
+double naiveBivariate(size_t i, size_t j, const NPArray<double> &a,
+                      const vector<Classification> &classifier,
+                      const vector<double> &ival) {
+    const size_t numGroups = ival.empty() ? 2 : 1;
+    vector<double> products[2];
+    vector<double> h;
+    for (size_t g = 0; g < numGroups; g++) {
+        double mi = 0.0;
+        double mj = 0.0;
+        size_t n = 0;
+        for (size_t r = 0; r < a.rows(); r++)
+            if (!ival.empty() || int(classifier[r]) == int(g)) {
+                mi += a(r, i);
+                mj += a(r, j);
+                n++;
+            }
+        mi /= double(n);
+        mj /= double(n);
+        for (size_t r = 0; r < a.rows(); r++)
+            if (!ival.empty() || int(classifier[r]) == int(g)) {
+                products[g].push_back((a(r, i) - mi) * (a(r, j) - mj));
+                if (!ival.empty())
+                    h.push_back(ival[r]);
+            }
+    }
+
+    auto meanVar = [](const vector<double> &v, double &m, double &var) {
+        m = 0.0;
+        for (double x : v)
+            m += x;
+        m /= double(v.size());
+        var = 0.0;
+        for (double x : v)
+            var += (x - m) * (x - m);
+        var /= double(v.size());
+    };
+    double m[2];
+    double var[2];
+    meanVar(products[0], m[0], var[0]);
+    if (ival.empty()) {
+        meanVar(products[1], m[1], var[1]);
+        return (m[0] - m[1]) / std::sqrt(var[0] / double(products[0].size()) +
+                                         var[1] / double(products[1].size()));
+    }
+    meanVar(h, m[1], var[1]);
+    double cov = 0.0;
+    for (size_t r = 0; r < h.size(); r++)
+        cov += (products[0][r] - m[0]) * (h[r] - m[1]);
+    cov /= double(h.size());
+    return cov / std::sqrt(var[0] * var[1]);
+}
+} // namespace
+
+TEST_F(SCAF, bivariate) {
+    // More samples than a tile of pairs.
+    NPArray<double> a = traces(150, 45);
+    vector<Classification> classifier(a.rows());
+    vector<double> iv(a.rows());
+    NPArray<double> ival(1, a.rows());
+    for (size_t r = 0; r < a.rows(); r++) {
+        classifier[r] = r % 3 == 0   ? Classification::GROUP_0
+                        : r % 3 == 1 ? Classification::GROUP_1
+                                     : Classification::IGNORE;
+        // A masked leakage: samples 3 and 40 hold a share each.
+        const double mask = double((r * 7) % 5);
+        a(r, 3) += mask;
+        a(r, 40) += mask + (r % 3 == 1 ? 1.0 : 0.0);
+        iv[r] = ival(0, r) = double(hamming_weight<unsigned>(r * 13, 0xFF));
+    }
+
+    const NPArray<double> t = bivariate_t_test(2, a.cols(), a, classifier);
+    const NPArray<double> c = bivariate_correl(2, a.cols(), a, ival);
+    ASSERT_EQ(t.rows(), a.cols() - 2);
+    ASSERT_EQ(t.cols(), a.cols() - 2);
+    ASSERT_EQ(c.rows(), a.cols() - 2);
+    ASSERT_EQ(c.cols(), a.cols() - 2);
+    for (size_t i = 2; i < a.cols(); i++)
+        for (size_t j = i; j < a.cols(); j++) {
+            const double et = naiveBivariate(i, j, a, classifier, {});
+            EXPECT_NEAR(t(i - 2, j - 2), et,
+                        1e-9 * std::max(1.0, std::abs(et)));
+            EXPECT_EQ(t(j - 2, i - 2), t(i - 2, j - 2));
+            const double ec = naiveBivariate(i, j, a, classifier, iv);
+            EXPECT_NEAR(c(i - 2, j - 2), ec, 1e-9);
+            EXPECT_EQ(c(j - 2, i - 2), c(i - 2, j - 2));
+        }
+
+    // Whatever the number of threads, or the way the traces are read.
+    NPArrayBase::setNumThreads(4);
+    EXPECT_EQ(bivariate_t_test(2, a.cols(), a, classifier), t);
+    EXPECT_EQ(bivariate_correl(2, a.cols(), a, ival), c);
+    NPArrayBase::setNumThreads(1);
+    ASSERT_TRUE(a.save(getTemporaryFilename()));
+    ShardedNPArray<double> sharded({getTemporaryFilename()});
+    expectNear(bivariate_t_test(2, a.cols(), sharded, classifier), t);
+    expectNear(bivariate_correl(2, a.cols(), sharded, ival), c);
+
+    EXPECT_TRUE(bivariate_t_test(2, 2, a, classifier).empty());
+    EXPECT_TRUE(bivariate_correl(5, 5, a, ival).empty());
+}
+
+TEST(SCA, storageTypes) {
+    NPArray<int16_t> a(40, 9);
+    NPArray<double> ival(1, a.rows());
+    std::vector<Classification> classifier(a.rows());
+    for (size_t r = 0; r < a.rows(); r++) {
+        for (size_t c = 0; c < a.cols(); c++)
+            a(r, c) = int16_t(1000.0 * std::sin(double(r * a.cols() + c)) +
+                              100.0 * double(r % 2));
+        ival(0, r) = double((r * 5) % 7);
+        classifier[r] =
+            r % 2 == 0 ? Classification::GROUP_0 : Classification::GROUP_1;
+    }
+
+    // The same traces, stored as double, float and uint16_t values.
+    NPArray<double> d(a.rows(), a.cols());
+    NPArray<float> f(a.rows(), a.cols());
+    NPArray<uint16_t> u(a.rows(), a.cols());
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t c = 0; c < a.cols(); c++) {
+            d(r, c) = double(a(r, c));
+            f(r, c) = float(a(r, c));
+            u(r, c) = uint16_t(a(r, c) + 2000);
+        }
+
+    // The statistics are computed in double precision whatever the storage
+    // type, so they only differ by rounding errors. The t-test and the
+    // correlation are not sensitive to the offset on the unsigned traces.
+    const NPArray<double> t = t_test(0, d.cols(), d, classifier);
+    const NPArray<double> p = correl(0, d.cols(), d, ival);
+    const NPArray<double> pt = perfect_t_test(0, d.cols(), d, classifier);
+    const NPArrayView<double> g0 = d.view(0, d.rows(), 0, d.cols(), 2);
+    const NPArrayView<double> g1 = d.view(1, d.rows(), 0, d.cols(), 2);
+    const NPArray<double> tg = t_test(0, d.cols(), g0, g1);
+    for (size_t s = 0; s < d.cols(); s++) {
+        EXPECT_NEAR(t_test(0, a.cols(), a, classifier)(0, s), t(0, s), 1e-9);
+        EXPECT_NEAR(t_test(0, f.cols(), f, classifier)(0, s), t(0, s), 1e-9);
+        EXPECT_NEAR(t_test(0, u.cols(), u, classifier)(0, s), t(0, s), 1e-9);
+        EXPECT_NEAR(correl(0, a.cols(), a, ival)(0, s), p(0, s), 1e-9);
+        EXPECT_NEAR(correl(0, f.cols(), f, ival)(0, s), p(0, s), 1e-9);
+        EXPECT_NEAR(correl(0, u.cols(), u, ival)(0, s), p(0, s), 1e-9);
+        EXPECT_NEAR(perfect_t_test(0, a.cols(), a, classifier)(0, s),
+                    pt(0, s), 1e-9);
+        EXPECT_NEAR(t_test(0, f.cols(), f.view(0, f.rows(), 0, f.cols(), 2),
+                           f.view(1, f.rows(), 0, f.cols(), 2))(0, s),
+                    tg(0, s), 1e-9);
+    }
+}
@@ -0,0 +1,106 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/utils/SPSCRing.h"
+
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+using PAF::SPSCRing;
+
+TEST(SPSCRing, base) {
+    EXPECT_EQ(SPSCRing<int>(1).capacity(), 1);
+    EXPECT_EQ(SPSCRing<int>(3).capacity(), 4);
+    EXPECT_EQ(SPSCRing<int>(1024).capacity(), 1024);
+
+    // Single threaded use, without ever waiting.
+    SPSCRing<int> R(2);
+    *R.acquire() = 1;
+    R.publish();
+    *R.acquire() = 2;
+    R.publish();
+    ASSERT_NE(R.front(), nullptr);
+    EXPECT_EQ(*R.front(), 1);
+    R.release();
+    *R.acquire() = 3;
+    R.publish();
+    R.close();
+    ASSERT_NE(R.front(), nullptr);
+    EXPECT_EQ(*R.front(), 2);
+    R.release();
+    ASSERT_NE(R.front(), nullptr);
+    EXPECT_EQ(*R.front(), 3);
+    R.release();
+    EXPECT_EQ(R.front(), nullptr);
+}
+
+TEST(SPSCRing, threads) {
+    const size_t N = 100000;
+    for (size_t capacity : {1, 8, 256}) {
+        SPSCRing<vector<size_t>> R(capacity);
+        std::thread Producer([&]() {
+            for (size_t i = 0; i < N; i++) {
+                vector<size_t> *v = R.acquire();
+                ASSERT_NE(v, nullptr);
+                // The slots are recycled: they keep their storage.
+                v->clear();
+                v->push_back(i);
+                v->push_back(i * 3);
+                R.publish();
+            }
+            R.close();
+        });
+
+        size_t n = 0;
+        while (const vector<size_t> *v = R.front()) {
+            ASSERT_EQ(v->size(), 2);
+            EXPECT_EQ((*v)[0], n);
+            EXPECT_EQ((*v)[1], n * 3);
+            R.release();
+            n++;
+        }
+        Producer.join();
+        EXPECT_EQ(n, N);
+    }
+}
+
+TEST(SPSCRing, cancel) {
+    SPSCRing<int> R(4);
+    std::thread Producer([&]() {
+        size_t n = 0;
+        while (int *i = R.acquire()) {
+            *i = int(n++);
+            R.publish();
+        }
+        R.close();
+    });
+
+    ASSERT_NE(R.front(), nullptr);
+    EXPECT_EQ(*R.front(), 0);
+    R.release();
+    // The producer is blocked on a full ring, until it is cancelled.
+    R.cancel();
+    Producer.join();
+}
@@ -23,6 +23,8 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -68,6 +70,8 @@ TEST(Scope, Basics) {
     EXPECT_FALSE(Root.isFunction());
     EXPECT_FALSE(Root.isBlock());
 
+    // The size of an entry in the sub-scopes / signals hash indexes.
+    const size_t IdxSize = sizeof(std::pair<const std::string_view, size_t>);
     size_t rootSize = sizeof(Scope) + Root.getFullScopeName().size() +
                       Root.getScopeName().size() +
                       Root.getInstanceName().size();
@@ -96,7 +100,8 @@ TEST(Scope, Basics) {
     EXPECT_FALSE(Root.isTask());
     EXPECT_FALSE(Root.isFunction());
     EXPECT_FALSE(Root.isBlock());
-    rootSize += TSize + sizeof(std::unique_ptr<Scope>);
+    // A sub-scope is indexed by instance name and by full scope name.
+    rootSize += TSize + sizeof(std::unique_ptr<Scope>) + 2 * IdxSize;
     EXPECT_EQ(Root.getObjectSize(), rootSize);
 
     T.addSignal("SignalInT", SignalDesc::Kind::REGISTER, /* alias: */ false,
@@ -132,9 +137,11 @@ TEST(Scope, Basics) {
     EXPECT_FALSE(SDR->isAlias());
     EXPECT_EQ(SDR->getKind(), SignalDesc::Kind::REGISTER);
 
-    TSize += sizeof(std::unique_ptr<SignalDesc>) + SDR->getObjectSize();
+    TSize +=
+        sizeof(std::unique_ptr<SignalDesc>) + SDR->getObjectSize() + IdxSize;
     EXPECT_EQ(T.getObjectSize(), TSize);
-    rootSize += sizeof(std::unique_ptr<SignalDesc>) + SDR->getObjectSize();
+    rootSize +=
+        sizeof(std::unique_ptr<SignalDesc>) + SDR->getObjectSize() + IdxSize;
     EXPECT_EQ(Root.getObjectSize(), rootSize);
 
     Root.addSignal("SignalInRoot", SignalDesc::Kind::WIRE, /* alias: */ true,
@@ -189,10 +196,53 @@ TEST(Scope, Basics) {
     EXPECT_EQ(T.findSignalIdx("Top", "SignalInRoot"), searchResult(false, -1));
 
     EXPECT_EQ(T.getObjectSize(), TSize);
-    rootSize += sizeof(std::unique_ptr<SignalDesc>) + SDW->getObjectSize();
+    rootSize +=
+        sizeof(std::unique_ptr<SignalDesc>) + SDW->getObjectSize() + IdxSize;
     EXPECT_EQ(Root.getObjectSize(), rootSize);
 }
 
+TEST(Scope, Index) {
+    // Lookups must keep working after the Scope has been copied or moved, as
+    // the indexes view strings owned by the sub-scopes and signals.
+    Scope Root;
+    for (size_t i = 0; i < 100; i++) {
+        const string n = "s" + std::to_string(i);
+        Scope &S = Root.addModule(string(n), "top." + n, "mod");
+        for (size_t j = 0; j < 10; j++)
+            S.addSignal("w" + std::to_string(j), SignalDesc::Kind::WIRE, false,
+                        i * 10 + j);
+    }
+    // Adding an existing scope returns it.
+    EXPECT_EQ(&Root.addModule("s42", "top.s42", "mod"),
+              Root.findSubScope("s42").second);
+    EXPECT_EQ(Root.getNumSubScopes(), 100);
+
+    const auto check = [](const Scope &R) {
+        EXPECT_TRUE(R.hasSubScope("s0"));
+        EXPECT_TRUE(R.hasSubScope("s99"));
+        EXPECT_FALSE(R.hasSubScope("s100"));
+        EXPECT_EQ(R.findSignalIdx("top.s57", "w3"), searchResult(true, 573));
+        EXPECT_EQ(R.findSignalIdx("top.s57", "w10"), searchResult(false, -1));
+        EXPECT_EQ(R.findSignalIdx("top.s100", "w0"), searchResult(false, -1));
+    };
+    check(Root);
+
+    Scope Copy(Root);
+    check(Copy);
+    EXPECT_EQ(Copy.getObjectSize(), Root.getObjectSize());
+    EXPECT_EQ(Copy.findSubScope("s3").second->getSignalIdx("w9"), 39);
+
+    Scope Assigned;
+    Assigned = Copy;
+    check(Assigned);
+
+    Scope Moved(std::move(Copy));
+    check(Moved);
+    Scope MoveAssigned;
+    MoveAssigned = std::move(Moved);
+    check(MoveAssigned);
+}
+
 TEST(Scope, Dump) {
     Scope Root;
     Root.addSignal("SignalInRoot", SignalDesc::Kind::REGISTER, false, 2);
@@ -0,0 +1,210 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/ShardedNPArray.h"
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/SCA.h"
+
+#include "paf-unit-testing.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace PAF::SCA;
+
+using std::string;
+using std::vector;
+
+// Create the test fixture for ShardedNPArray, with 3 shards and a manifest.
+TEST_WITH_TEMP_FILES(ShardedNPArrayF, "test-ShardedNPArray.npy.XXXXXX", 4);
+
+namespace {
+// Get all rows from sharded, checking the shards' positions along the way.
+NPArray<double> collect(ShardedNPArray<double> &sharded) {
+    NPArray<double> result(0, sharded.cols());
+    sharded.rewind();
+    while (sharded.next()) {
+        EXPECT_EQ(sharded.chunkBegin(), result.rows());
+        result.extend(sharded.chunk(), NPArrayBase::COLUMN);
+    }
+    EXPECT_TRUE(sharded.good());
+    EXPECT_EQ(result.rows(), sharded.rows());
+    return result;
+}
+} // namespace
+
+TEST_F(ShardedNPArrayF, base) {
+    const NPArray<double> a = traces(17, 6);
+    const vector<size_t> splits = {0, 5, 5 + 8, 17};
+    vector<string> shards;
+    for (size_t i = 0; i < 3; i++) {
+        const NPArray<double> shard(
+            NPArrayView<double>(a, splits[i], splits[i + 1], 0, a.cols()));
+        ASSERT_TRUE(shard.save(getTemporaryFilename(i)));
+        shards.push_back(getTemporaryFilename(i));
+    }
+
+    for (bool prefetch : {false, true}) {
+        for (NPArrayBase::LoadMode mode :
+             {NPArrayBase::READ, NPArrayBase::MMAP}) {
+            ShardedNPArray<double> s(shards, NPArrayBase::Window(), mode,
+                                     prefetch);
+            EXPECT_TRUE(s.good());
+            EXPECT_EQ(s.rows(), 17);
+            EXPECT_EQ(s.cols(), 6);
+            EXPECT_EQ(s.numShards(), 3);
+            EXPECT_EQ(collect(s), a);
+            // A second pass gives the same result.
+            EXPECT_EQ(collect(s), a);
+            EXPECT_EQ(s.concatenate(), a);
+        }
+    }
+
+    // Windows, with rows spanning several shards.
+    ShardedNPArray<double> w(shards, NPArrayBase::Window(3, 15, 1, 6, 2));
+    EXPECT_EQ(w.rows(), 12);
+    EXPECT_EQ(w.cols(), 3);
+    EXPECT_EQ(collect(w), NPArray<double>(a.view(3, 15, 1, 6, 1, 2)));
+    ShardedNPArray<double> w1(shards, NPArrayBase::Window(6, 9));
+    EXPECT_EQ(collect(w1), NPArray<double>(a.view(6, 9, 0, 6)));
+    ShardedNPArray<double> w2(shards, NPArrayBase::Window(20, 30));
+    EXPECT_EQ(w2.rows(), 0);
+    EXPECT_FALSE(w2.next());
+
+    // Custom loader.
+    size_t num_loads = 0;
+    ShardedNPArray<double> l(
+        shards, NPArrayBase::Window(), NPArrayBase::READ,
+        /* prefetch: */ false,
+        [&](const string &filename, const NPArrayBase::Window &window) {
+            num_loads++;
+            return NPArray<double>(filename, window);
+        });
+    EXPECT_EQ(collect(l), a);
+    EXPECT_EQ(num_loads, 3);
+}
+
+TEST_F(ShardedNPArrayF, metrics) {
+    const NPArray<double> a = traces(25, 7);
+    vector<string> shards;
+    for (size_t i = 0; i < 3; i++) {
+        const NPArray<double> shard(
+            NPArrayView<double>(a, i * 10, std::min<size_t>(i * 10 + 10, 25),
+                                0, a.cols()));
+        ASSERT_TRUE(shard.save(getTemporaryFilename(i)));
+        shards.push_back(getTemporaryFilename(i));
+    }
+
+    vector<Classification> classifier(a.rows());
+    NPArray<double> ival(1, a.rows());
+    for (size_t i = 0; i < a.rows(); i++) {
+        classifier[i] = i % 3 == 0   ? Classification::GROUP_0
+                        : i % 3 == 1 ? Classification::GROUP_1
+                                     : Classification::IGNORE;
+        ival(0, i) = double((i * 7) % 11);
+    }
+
+    ShardedNPArray<double> s(shards);
+    EXPECT_EQ(t_test(0, a.cols(), s, classifier),
+              t_test(0, a.cols(), a, classifier));
+    EXPECT_EQ(t_test(1, 4, s, classifier), t_test(1, 4, a, classifier));
+    EXPECT_EQ(correl(0, a.cols(), s, ival), correl(0, a.cols(), a, ival));
+    EXPECT_EQ(correl(2, 5, s, ival), correl(2, 5, a, ival));
+}
+
+TEST_F(ShardedNPArrayF, errors) {
+    ASSERT_TRUE(traces(3, 4).save(getTemporaryFilename(0)));
+    ASSERT_TRUE(traces(3, 5).save(getTemporaryFilename(1)));
+    ASSERT_TRUE(NPArray<float>(2, 4).save(getTemporaryFilename(2)));
+
+    ShardedNPArray<double> s0(vector<string>{});
+    EXPECT_FALSE(s0.good());
+    EXPECT_EQ(s0.rows(), 0);
+
+    ShardedNPArray<double> s1({getTemporaryFilename(0), "non-existent.npy"});
+    EXPECT_FALSE(s1.good());
+    EXPECT_NE(s1.error(), nullptr);
+
+    ShardedNPArray<double> s2({getTemporaryFilename(0),
+                               getTemporaryFilename(1)});
+    EXPECT_FALSE(s2.good());
+
+    // Element type mismatch in the second shard, rejected upfront even if a
+    // custom loader could convert it.
+    ShardedNPArray<double> s3(
+        {getTemporaryFilename(0), getTemporaryFilename(2)},
+        NPArrayBase::Window(), NPArrayBase::READ, /* prefetch: */ true,
+        [&](const string &filename, const NPArrayBase::Window &window) {
+            return NPArray<double>::readAs(filename, window);
+        });
+    EXPECT_FALSE(s3.good());
+    EXPECT_NE(s3.error(), nullptr);
+    EXPECT_FALSE(s3.next());
+    EXPECT_TRUE(s3.concatenate().empty());
+
+    // A shard disappearing after construction is reported when loading it.
+    ASSERT_TRUE(traces(2, 4).save(getTemporaryFilename(3)));
+    ShardedNPArray<double> s4({getTemporaryFilename(0),
+                               getTemporaryFilename(3)},
+                              NPArrayBase::Window(), NPArrayBase::READ,
+                              /* prefetch: */ false);
+    EXPECT_TRUE(s4.good());
+    std::remove(getTemporaryFilename(3).c_str());
+    EXPECT_TRUE(s4.next());
+    EXPECT_FALSE(s4.next());
+    EXPECT_FALSE(s4.good());
+}
+
+TEST_F(ShardedNPArrayF, expandShards) {
+    // A plain file name.
+    EXPECT_EQ(expandShards("traces.npy"), vector<string>{"traces.npy"});
+
+    // A manifest, with comments and empty lines.
+    const string manifest = getTemporaryFilename(3);
+    {
+        std::ofstream ofs(manifest);
+        ofs << "# Some traces\n"
+            << "b.npy\n"
+            << "\n"
+            << "  a.npy  \n"
+            << "/absolute/c.npy\n";
+    }
+    const size_t slash = manifest.rfind('/');
+    const string dir =
+        slash == string::npos ? string() : manifest.substr(0, slash + 1);
+    EXPECT_EQ(expandShards('@' + manifest),
+              vector<string>({dir + "b.npy", dir + "a.npy",
+                              "/absolute/c.npy"}));
+    EXPECT_TRUE(expandShards("@non-existent-manifest").empty());
+
+    // Glob patterns, that match each file exactly.
+    ASSERT_TRUE(traces(1, 1).save(getTemporaryFilename(0)));
+    ASSERT_TRUE(traces(1, 1).save(getTemporaryFilename(1)));
+    for (size_t i : {0, 1}) {
+        const string f = getTemporaryFilename(i);
+        const string pattern = f.substr(0, f.size() - 1) + '[' + f.back() + ']';
+        EXPECT_EQ(expandShards(pattern), vector<string>{f});
+    }
+    EXPECT_TRUE(expandShards("non-existent-*.npy").empty());
+}
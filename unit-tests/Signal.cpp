@@ -19,6 +19,7 @@
  */
 
 #include "PAF/WAN/Signal.h"
+#include "PAF/utils/Stats.h"
 
 #include "gtest/gtest.h"
 
@@ -732,7 +733,7 @@ TEST(Signal, BasicOps) {
     EXPECT_EQ(Bob.getValueAtTime(25), ValueTy("10000111"));
 
     // getObjectSize()
-    EXPECT_EQ(Bob.getObjectSize(), 104);
+    EXPECT_EQ(Bob.getObjectSize(), 152);
 }
 
 TEST(Signal, AppendBit) {
@@ -750,43 +751,49 @@ TEST(Signal, AppendBit) {
         TV1(25, "Z"), TV1(26, "0"), TV1(27, "1"), TV1(28, "0"), TV1(29, "Z"),
         TV1(30, "X"), TV1(31, "Z"), TV1(32, "X")};
 
-    // Ensure we are testing with multiple packs.
-    ASSERT_GT(TestValues.size(), Signal::packCapacity());
+    // Repeat the test values, to ensure we are testing with multiple storage
+    // words.
+    vector<TV1> Values;
+    for (size_t round = 0; round < 3; round++)
+        for (const auto &change : TestValues)
+            Values.emplace_back(round * TestValues.size() + change.time,
+                                change.value);
+    ASSERT_GT(Values.size(), Signal::packCapacity());
 
     // Test append --- string version
     vector<TimeTy> AllTimes;
     Signal Sut1(AllTimes, 1);
     // Stuff out signal with numerous changes.
-    for (const auto &change : TestValues) {
+    for (const auto &change : Values) {
         AllTimes.push_back(change.time);
         Sut1.append(AllTimes.size() - 1, string(change.value));
     }
     // And now check we find all the expected changes.
-    EXPECT_EQ(Sut1.getNumChanges(), TestValues.size());
+    EXPECT_EQ(Sut1.getNumChanges(), Values.size());
     for (size_t i = 0; i < Sut1.getNumChanges(); i++) {
-        EXPECT_EQ(Sut1.getTimeChange(i), TestValues[i].time);
-        EXPECT_EQ(string(Sut1.getValueChange(i)), TestValues[i].value);
+        EXPECT_EQ(Sut1.getTimeChange(i), Values[i].time);
+        EXPECT_EQ(string(Sut1.getValueChange(i)), Values[i].value);
         const ChangeTy C = Sut1.getChange(i);
-        EXPECT_EQ(C.time, TestValues[i].time);
-        EXPECT_EQ(C.value, ValueTy(TestValues[i].value));
+        EXPECT_EQ(C.time, Values[i].time);
+        EXPECT_EQ(C.value, ValueTy(Values[i].value));
     }
 
     // Test append --- const char * version
     AllTimes.clear();
     Signal Sut2(AllTimes, 1);
     // Stuff out signal with numerous changes.
-    for (const auto &change : TestValues) {
+    for (const auto &change : Values) {
         AllTimes.push_back(change.time);
         Sut2.append(AllTimes.size() - 1, change.value);
     }
     // And now check we find all the expected changes.
-    EXPECT_EQ(Sut2.getNumChanges(), TestValues.size());
+    EXPECT_EQ(Sut2.getNumChanges(), Values.size());
     for (size_t i = 0; i < Sut2.getNumChanges(); i++) {
-        EXPECT_EQ(Sut2.getTimeChange(i), TestValues[i].time);
-        EXPECT_EQ(string(Sut2.getValueChange(i)), TestValues[i].value);
+        EXPECT_EQ(Sut2.getTimeChange(i), Values[i].time);
+        EXPECT_EQ(string(Sut2.getValueChange(i)), Values[i].value);
         const ChangeTy C = Sut2.getChange(i);
-        EXPECT_EQ(C.time, TestValues[i].time);
-        EXPECT_EQ(C.value, ValueTy(TestValues[i].value));
+        EXPECT_EQ(C.time, Values[i].time);
+        EXPECT_EQ(C.value, ValueTy(Values[i].value));
     }
 }
 
@@ -813,7 +820,7 @@ TEST(Signal, AppendBus) {
     for i in range(len(Bus)):
         print("    TV1({}, \"{}\"),".format(i, Bus[i]))
     */
-    std::array<TV1, 34> TestValues{
+    std::array<TV1, 34> BusValues{
         // clang-format off
     TV1(0, "00000000000000000"),
     TV1(1, "ZZZ11ZZ1X1ZZXX1X1"),
@@ -852,7 +859,13 @@ TEST(Signal, AppendBus) {
         // clang-format on
     };
 
-    // Ensure we are testing with multiple packs.
+    // Repeat the bus values, to ensure we are testing with multiple storage
+    // words.
+    vector<TV1> TestValues;
+    for (size_t round = 0; round < 3; round++)
+        for (const auto &change : BusValues)
+            TestValues.emplace_back(round * BusValues.size() + change.time,
+                                    change.value);
     ASSERT_GT(TestValues.size(), Signal::packCapacity());
 
     // Test append --- string version
@@ -911,6 +924,195 @@ TEST(Signal, AppendExtend) {
     EXPECT_EQ(Bob.getValueChange(2), ValueTy("00001111"));
 }
 
+TEST(Signal, Storage) {
+    vector<TimeTy> AllTimes;
+    Signal TwoState(AllTimes, 1);
+    Signal Sparse(AllTimes, 1);
+    Signal Dense(AllTimes, 1);
+    for (TimeTy t = 0; t < 128; t++) {
+        AllTimes.push_back(t);
+        TwoState.append(AllTimes.size() - 1, t % 2 ? "1" : "0");
+        Sparse.append(AllTimes.size() - 1,
+                      t == 3 ? "X" : (t == 70 ? "Z" : (t % 2 ? "1" : "0")));
+        Dense.append(AllTimes.size() - 1, t % 2 ? "X" : "Z");
+    }
+
+    EXPECT_FALSE(TwoState.hasHighZOrUnknown());
+    EXPECT_TRUE(Sparse.hasHighZOrUnknown());
+    EXPECT_TRUE(Dense.hasHighZOrUnknown());
+
+    // A 2-state signal only uses its value plane, with 1 bit per value bit.
+    // The 128 time indices fill a block, packed with 7 bits per index.
+    const size_t ObjectSize = sizeof(Signal) + 16 + 14 * 8 + 16;
+    EXPECT_EQ(TwoState.getObjectSize(), ObjectSize);
+    // The few Z and X are recorded by position.
+    EXPECT_EQ(Sparse.getObjectSize(), ObjectSize + 2 * 8);
+    // Frequent Z and X are recorded in a second plane.
+    EXPECT_EQ(Dense.getObjectSize(), ObjectSize + 16);
+    // The memory usage also counts the storage reserved for growth.
+    EXPECT_GE(TwoState.memoryUsage(), TwoState.getObjectSize());
+    EXPECT_GE(Dense.memoryUsage(), Dense.getObjectSize());
+
+    for (size_t i = 0; i < 128; i++) {
+        EXPECT_EQ(TwoState.getValueChange(i), ValueTy(i % 2 ? "1" : "0"));
+        EXPECT_EQ(Sparse.getValueChange(i),
+                  ValueTy(i == 3 ? "X" : (i == 70 ? "Z" : (i % 2 ? "1" : "0"))));
+        EXPECT_EQ(Dense.getValueChange(i), ValueTy(i % 2 ? "X" : "Z"));
+    }
+
+    // Overwriting a value also overwrites its Z and X.
+    AllTimes.push_back(128);
+    Sparse.append(AllTimes.size() - 1, "X");
+    EXPECT_EQ(Sparse.getValueChange(128), ValueTy("X"));
+    Sparse.append(AllTimes.size() - 1, "1");
+    EXPECT_EQ(Sparse.getValueChange(128), ValueTy("1"));
+    Dense.append(AllTimes.size() - 1, "Z");
+    Dense.append(AllTimes.size() - 1, "1");
+    EXPECT_EQ(Dense.getValueChange(128), ValueTy("1"));
+    EXPECT_EQ(Dense.getValueChange(127), ValueTy("X"));
+
+    // Signals with the same values compare equal, whatever their Z and X
+    // storage.
+    vector<TimeTy> Times{0, 1};
+    Signal A(Times, 4);
+    A.append(0, "XXXX");
+    A.append(1, "XXXX");
+    A.append(1, "0000");
+    Signal B(Times, 4);
+    B.append(0, "XXXX");
+    B.append(1, "0000");
+    EXPECT_EQ(A, B);
+    Signal C(Times, 4);
+    C.append(0, "1XXX");
+    C.append(1, "0000");
+    EXPECT_NE(A, C);
+
+    // The signals storage is accounted to the WAN subsystem.
+    const uint64_t Base = PAF::Stats::getAllocatedBytes(PAF::Stats::MEM_WAN);
+    {
+        Signal D(Times, 128);
+        D.append(0, string(128, '1'));
+        EXPECT_GT(PAF::Stats::getAllocatedBytes(PAF::Stats::MEM_WAN), Base);
+    }
+    EXPECT_EQ(PAF::Stats::getAllocatedBytes(PAF::Stats::MEM_WAN), Base);
+}
+
+TEST(Signal, Hamming) {
+    // Check the Hamming weights and distances against the ones computed on
+    // the ValueTys.
+    const auto check = [](const Signal &S) {
+        const Signal::HammingTy H = S.getHamming();
+        ASSERT_EQ(H.timeIdx.size(), S.getNumChanges());
+        ASSERT_EQ(H.weight.size(), S.getNumChanges());
+        ASSERT_EQ(H.distance.size(), S.getNumChanges());
+        for (size_t i = 0; i < S.getNumChanges(); i++) {
+            const ValueTy V = S.getValueChange(i);
+            const ValueTy P = S.getValueChange(i == 0 ? 0 : i - 1);
+            EXPECT_EQ(S.getTimeChange(i), i * 10);
+            EXPECT_EQ(H.timeIdx[i], i);
+            EXPECT_EQ(H.weight[i], V.countOnes());
+            EXPECT_EQ(H.distance[i], (V ^ P).countOnes());
+        }
+    };
+
+    // Generate signals with pseudo random values, with Z and X bits
+    // occurring with probability 1 / zxRate.
+    vector<TimeTy> AllTimes;
+    for (TimeTy t = 0; t < 200; t++)
+        AllTimes.push_back(t * 10);
+    uint32_t state = 12345;
+    const auto random = [&state]() {
+        state = state * 1103515245 + 12345;
+        return (state >> 16) & 0x7fff;
+    };
+    for (const size_t numBits : {1, 7, 17, 64, 100, 130})
+        for (const unsigned zxRate : {0, 3, 50, 1000}) {
+            Signal S(AllTimes, numBits);
+            for (size_t t = 0; t < AllTimes.size(); t++) {
+                string v;
+                for (size_t b = 0; b < numBits; b++) {
+                    const unsigned r = random();
+                    if (zxRate != 0 && r % zxRate == 0)
+                        v += (r / zxRate) % 2 ? 'X' : 'Z';
+                    else
+                        v += r % 2 ? '1' : '0';
+                }
+                S.append(t, v);
+            }
+            if (zxRate == 0)
+                EXPECT_FALSE(S.hasHighZOrUnknown());
+            check(S);
+        }
+
+    // An empty Signal.
+    check(Signal(AllTimes, 3));
+}
+
+TEST(Signal, Sample) {
+    using SampleKind = Signal::SampleKind;
+    // Sample times before the first change, between changes, on changes
+    // (some of them repeated), and after the last change.
+    vector<TimeTy> Times{0, 3, 10, 10, 15};
+    for (TimeTy t = 20; t < 2200; t += 7)
+        Times.push_back(t);
+
+    // Check the samples against the ValueTys at the sample times.
+    const auto check = [&Times](const Signal &S) {
+        vector<uint64_t> values(Times.size());
+        vector<uint64_t> weights(Times.size());
+        vector<uint64_t> distances(Times.size());
+        S.sample(values.data(), Times.data(), Times.size());
+        S.sample(weights.data(), Times.data(), Times.size(),
+                 SampleKind::HAMMING_WEIGHT);
+        S.sample(distances.data(), Times.data(), Times.size(),
+                 SampleKind::HAMMING_DISTANCE);
+        ValueTy P = ValueTy::unknown(S.getNumBits());
+        for (size_t i = 0; i < Times.size(); i++) {
+            const bool defined =
+                !S.empty() && Times[i] >= S.getTimeChange(0);
+            const ValueTy V = defined ? S.getValueAtTime(Times[i])
+                                      : ValueTy::unknown(S.getNumBits());
+            uint64_t v = 0;
+            for (size_t b = 0; b < std::min<size_t>(64, S.getNumBits()); b++)
+                if (V.get(b) == Logic::Ty::LOGIC_1)
+                    v |= uint64_t(1) << b;
+            EXPECT_EQ(values[i], v);
+            EXPECT_EQ(weights[i], V.countOnes());
+            EXPECT_EQ(distances[i], (V ^ (i == 0 ? V : P)).countOnes());
+            P = V;
+        }
+    };
+
+    vector<TimeTy> AllTimes;
+    for (TimeTy t = 1; t <= 200; t++)
+        AllTimes.push_back(t * 10);
+    uint32_t state = 54321;
+    const auto random = [&state]() {
+        state = state * 1103515245 + 12345;
+        return (state >> 16) & 0x7fff;
+    };
+    for (const size_t numBits : {1, 7, 64, 100})
+        for (const unsigned zxRate : {0, 3, 50}) {
+            Signal S(AllTimes, numBits);
+            // Only change on some of the times.
+            for (size_t t = 0; t < AllTimes.size(); t += 1 + random() % 3) {
+                string v;
+                for (size_t b = 0; b < numBits; b++) {
+                    const unsigned r = random();
+                    if (zxRate != 0 && r % zxRate == 0)
+                        v += (r / zxRate) % 2 ? 'X' : 'Z';
+                    else
+                        v += r % 2 ? '1' : '0';
+                }
+                S.append(t, v);
+            }
+            check(S);
+        }
+
+    // An empty Signal.
+    check(Signal(AllTimes, 3));
+}
+
 TEST(Signal, Comparisons) {
     vector<TimeTy> AllTimes;
     Signal Foo(AllTimes, 4);
@@ -964,6 +1166,85 @@ TEST(Signal, Comparisons) {
     EXPECT_EQ(Foo, Bof);
 }
 
+TEST(Signal, FirstDifference) {
+    vector<TimeTy> AllTimes;
+    for (TimeTy t = 0; t < 200; t++)
+        AllTimes.push_back(t * 10);
+
+    // Wide values, spanning several storage words.
+    const string zeros(70, '0');
+    Signal Foo(AllTimes, 70);
+    Signal Bar(AllTimes, 70);
+    for (TimeIdxTy t = 0; t < 100; t++) {
+        string v = zeros;
+        v[t % 70] = '1';
+        Foo.append(t, v);
+        Bar.append(t, v);
+    }
+    EXPECT_EQ(Foo.firstDifference(Bar), 100);
+    EXPECT_EQ(Foo.firstDifference(Foo), 100);
+
+    // Difference in number of changes.
+    Bar.append(150, zeros);
+    EXPECT_EQ(Foo.firstDifference(Bar), 100);
+    EXPECT_EQ(Bar.firstDifference(Foo), 100);
+
+    // Difference in value.
+    Signal Baz(AllTimes, 70);
+    for (TimeIdxTy t = 0; t < 100; t++) {
+        string v = zeros;
+        v[t % 70] = '1';
+        if (t == 42)
+            v[3] = '1';
+        Baz.append(t, v);
+    }
+    EXPECT_EQ(Foo.firstDifference(Baz), 42);
+    EXPECT_EQ(Baz.firstDifference(Foo), 42);
+
+    // Difference in time.
+    Signal Boo(AllTimes, 70);
+    for (TimeIdxTy t = 0; t < 100; t++) {
+        string v = zeros;
+        v[t % 70] = '1';
+        Boo.append(t < 33 ? t : t + 1, v);
+    }
+    EXPECT_EQ(Foo.firstDifference(Boo), 33);
+
+    // Z and X values, with sparse or dense markers.
+    const auto make = [&](unsigned numZX, TimeIdxTy changeAt, char c) {
+        Signal S(AllTimes, 1);
+        for (TimeIdxTy t = 0; t < 150; t++)
+            S.append(t, t == changeAt ? string(1, c)
+                                      : string(1, t < numZX ? 'x' : '0'));
+        return S;
+    };
+    for (const unsigned numZX : {0, 2, 120}) {
+        const Signal Ref = make(numZX, 140, '1');
+        EXPECT_EQ(Ref.firstDifference(make(numZX, 140, '1')), 150);
+        EXPECT_EQ(Ref.firstDifference(make(numZX, 130, 'z')), 130);
+        EXPECT_EQ(make(numZX, 130, 'z').firstDifference(Ref), 130);
+        EXPECT_EQ(Ref.firstDifference(make(numZX, 3, 'z')), 3);
+        // Mixed sparse and dense markers.
+        EXPECT_EQ(Ref.firstDifference(make(100, 140, '1')),
+                  std::min(numZX, 100u));
+    }
+
+    // Signals with different times.
+    vector<TimeTy> OtherTimes;
+    for (TimeTy t = 0; t < 400; t++)
+        OtherTimes.push_back(t * 5);
+    vector<TimeIdxTy> timeMap;
+    for (TimeIdxTy t = 0; t < 400; t++)
+        timeMap.push_back(t % 2 == 0 ? t / 2 : AllTimes.size());
+    Signal Other(OtherTimes, 70);
+    for (TimeIdxTy t = 0; t < 100; t++) {
+        string v = zeros;
+        v[t % 70] = '1';
+        Other.append(t < 60 ? 2 * t : 2 * t + 1, v);
+    }
+    EXPECT_EQ(Foo.firstDifference(Other, &timeMap), 60);
+}
+
 TEST(Signal, Iterators) {
     vector<TimeTy> AllTimes;
     Signal Clk(AllTimes, 1);
@@ -0,0 +1,185 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/utils/Stats.h"
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::ostringstream;
+using std::string;
+
+using PAF::ScopedTimer;
+using PAF::Stats;
+using PAF::TrackingAllocator;
+
+namespace {
+// Save and restore the statistics collection state.
+class StatsF : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        wasEnabled = Stats::enabled();
+        Stats::reset();
+    }
+    void TearDown() override {
+        Stats::enable(wasEnabled);
+        Stats::reset();
+    }
+
+  private:
+    bool wasEnabled = false;
+};
+} // namespace
+
+TEST_F(StatsF, counters) {
+    Stats::enable(false);
+    Stats::add(Stats::INSTRUCTIONS_REPLAYED, 10);
+    EXPECT_EQ(Stats::get(Stats::INSTRUCTIONS_REPLAYED), 0);
+
+    Stats::enable();
+    EXPECT_TRUE(Stats::enabled());
+    Stats::add(Stats::INSTRUCTIONS_REPLAYED, 10);
+    Stats::add(Stats::INDEX_LOOKUPS);
+    Stats::add(Stats::INDEX_LOOKUPS);
+
+    // Counters are aggregated over all threads.
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < 4; t++)
+        threads.emplace_back([]() {
+            for (unsigned i = 0; i < 1000; i++)
+                Stats::add(Stats::NPY_ROWS_EMITTED);
+        });
+    for (auto &thread : threads)
+        thread.join();
+
+    EXPECT_EQ(Stats::get(Stats::INSTRUCTIONS_REPLAYED), 10);
+    EXPECT_EQ(Stats::get(Stats::INDEX_LOOKUPS), 2);
+    EXPECT_EQ(Stats::get(Stats::NPY_ROWS_EMITTED), 4000);
+    EXPECT_EQ(Stats::get(Stats::BYTES_READ), 0);
+    EXPECT_EQ(Stats::get(Stats::FAULTS_PLANNED), 0);
+
+    Stats::reset();
+    EXPECT_EQ(Stats::get(Stats::NPY_ROWS_EMITTED), 0);
+
+    EXPECT_STREQ(Stats::getName(Stats::INSTRUCTIONS_REPLAYED),
+                 "instructions_replayed");
+    EXPECT_STREQ(Stats::getName(Stats::FAULTS_PLANNED), "faults_planned");
+}
+
+TEST_F(StatsF, memory) {
+    Stats::enable();
+    const uint64_t base = Stats::getAllocatedBytes();
+    Stats::allocated(1000);
+    Stats::allocated(500);
+    EXPECT_EQ(Stats::getAllocatedBytes(), base + 1500);
+    Stats::released(1500);
+    EXPECT_EQ(Stats::getAllocatedBytes(), base);
+    EXPECT_GE(Stats::getPeakAllocatedBytes(), base + 1500);
+
+    EXPECT_GT(Stats::getPeakRSS(), 0);
+#ifdef __linux__
+    EXPECT_GT(Stats::getRSS(), 0);
+#endif
+}
+
+TEST_F(StatsF, subsystems) {
+    EXPECT_STREQ(Stats::getName(Stats::MEM_PAF), "paf");
+    EXPECT_STREQ(Stats::getName(Stats::MEM_SCA), "sca");
+    EXPECT_STREQ(Stats::getName(Stats::MEM_WAN), "wan");
+    EXPECT_STREQ(Stats::getName(Stats::MEM_FI), "fi");
+
+    Stats::enable();
+    const uint64_t base = Stats::getAllocatedBytes();
+    const uint64_t baseFI = Stats::getAllocatedBytes(Stats::MEM_FI);
+    const uint64_t baseWAN = Stats::getAllocatedBytes(Stats::MEM_WAN);
+    Stats::allocated(2000, Stats::MEM_FI);
+    Stats::allocated(300, Stats::MEM_WAN);
+    EXPECT_EQ(Stats::getAllocatedBytes(), base + 2300);
+    EXPECT_EQ(Stats::getAllocatedBytes(Stats::MEM_FI), baseFI + 2000);
+    EXPECT_EQ(Stats::getAllocatedBytes(Stats::MEM_WAN), baseWAN + 300);
+    Stats::released(2000, Stats::MEM_FI);
+    EXPECT_EQ(Stats::getAllocatedBytes(Stats::MEM_FI), baseFI);
+    EXPECT_GE(Stats::getPeakAllocatedBytes(Stats::MEM_FI), baseFI + 2000);
+    Stats::released(300, Stats::MEM_WAN);
+    EXPECT_EQ(Stats::getAllocatedBytes(), base);
+
+    // The peaks restart from the current allocations on reset.
+    Stats::reset();
+    EXPECT_EQ(Stats::getPeakAllocatedBytes(Stats::MEM_FI), baseFI);
+}
+
+TEST_F(StatsF, trackingAllocator) {
+    Stats::enable();
+    const uint64_t base = Stats::getAllocatedBytes(Stats::MEM_PAF);
+    {
+        std::vector<uint32_t, TrackingAllocator<uint32_t, Stats::MEM_PAF>> v;
+        v.reserve(100);
+        EXPECT_EQ(Stats::getAllocatedBytes(Stats::MEM_PAF),
+                  base + 100 * sizeof(uint32_t));
+        for (uint32_t i = 0; i < 1000; i++)
+            v.push_back(i);
+        EXPECT_EQ(Stats::getAllocatedBytes(Stats::MEM_PAF),
+                  base + v.capacity() * sizeof(uint32_t));
+        EXPECT_GE(Stats::getPeakAllocatedBytes(Stats::MEM_PAF),
+                  base + v.capacity() * sizeof(uint32_t));
+    }
+    EXPECT_EQ(Stats::getAllocatedBytes(Stats::MEM_PAF), base);
+
+    // Allocators for the same subsystem are interchangeable.
+    EXPECT_TRUE((TrackingAllocator<uint32_t, Stats::MEM_PAF>() ==
+                 TrackingAllocator<double, Stats::MEM_PAF>()));
+}
+
+TEST_F(StatsF, timers) {
+    {
+        // Disabled timers record nothing.
+        Stats::enable(false);
+        const ScopedTimer T("disabled");
+    }
+
+    Stats::enable();
+    {
+        const ScopedTimer T("outer");
+        for (unsigned i = 0; i < 3; i++)
+            const ScopedTimer T2("inner");
+    }
+    Stats::add(Stats::FAULTS_PLANNED, 3);
+
+    ostringstream os;
+    Stats::writeJSON(os);
+    const string s = os.str();
+    EXPECT_EQ(s.find("\"disabled\""), string::npos);
+    EXPECT_NE(s.find("\"outer\": {\"count\": 1, "), string::npos);
+    EXPECT_NE(s.find("\"outer/inner\": {\"count\": 3, "), string::npos);
+    EXPECT_NE(s.find("\"counters\": {\"instructions_replayed\": 0, "
+                     "\"index_lookups\": 0, \"bytes_read\": 0, "
+                     "\"npy_rows_emitted\": 0, \"faults_planned\": 3}"),
+              string::npos);
+    EXPECT_NE(s.find("\"memory\": {\"rss_bytes\": "), string::npos);
+    EXPECT_NE(s.find("\"subsystems\": {\"paf\": {\"allocated_bytes\": "),
+              string::npos);
+    EXPECT_NE(s.find("\"fi\": {\"allocated_bytes\": "), string::npos);
+    EXPECT_EQ(s.front(), '{');
+    EXPECT_EQ(s.substr(s.size() - 2), "}\n");
+}
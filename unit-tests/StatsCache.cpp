@@ -0,0 +1,168 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/SCA.h"
+#include "PAF/SCA/StatsCache.h"
+#include "paf-unit-testing.h"
+
+#include "gtest/gtest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace testing;
+
+using std::string;
+using std::vector;
+
+using PAF::SCA::Classification;
+using PAF::SCA::CorrelAccumulator;
+using PAF::SCA::NPArray;
+using PAF::SCA::NPArrayBase;
+using PAF::SCA::StatsCache;
+using PAF::SCA::TTestAccumulator;
+
+// The first temporary file is replaced with the cache directory.
+class StatsCacheF : public TestWithTemporaryFiles {
+  public:
+    StatsCacheF() : TestWithTemporaryFiles("test-StatsCache.XXXXXX", 2) {}
+
+    const string &getDirectory() const { return getTemporaryFilename(0); }
+
+  protected:
+    void SetUp() override { std::filesystem::remove(getDirectory()); }
+    void TearDown() override {
+        std::filesystem::remove_all(getDirectory());
+        TestWithTemporaryFiles::TearDown();
+    }
+};
+
+TEST_F(StatsCacheF, key) {
+    const string &filename = getTemporaryFilename(1);
+    std::ofstream(filename) << "Some traces";
+
+    StatsCache::Key K0;
+    K0.add(string("t-test")).addFile(filename).add(uint64_t(42));
+    StatsCache::Key K1;
+    K1.add(string("t-test")).addFile(filename).add(uint64_t(42));
+    EXPECT_EQ(K0.get(), K1.get());
+    EXPECT_NE(StatsCache::Key().get(), K0.get());
+
+    StatsCache::Key K2;
+    K2.add(string("correl")).addFile(filename).add(uint64_t(42));
+    EXPECT_NE(K2.get(), K0.get());
+
+    // Modifying the file changes the key.
+    std::ofstream(filename, std::ofstream::app) << " and some more";
+    StatsCache::Key K3;
+    K3.add(string("t-test")).addFile(filename).add(uint64_t(42));
+    EXPECT_NE(K3.get(), K0.get());
+}
+
+TEST_F(StatsCacheF, TTestAccumulator) {
+    const NPArray<double> a = traces(40, 12);
+    vector<Classification> classifier(a.rows());
+    for (size_t r = 0; r < a.rows(); r++)
+        classifier[r] =
+            r % 2 == 0 ? Classification::GROUP_0 : Classification::GROUP_1;
+
+    StatsCache SC(getDirectory());
+    ASSERT_TRUE(SC.good());
+    EXPECT_EQ(SC.getDirectory(), getDirectory());
+    EXPECT_EQ(SC.getFilename(0x1234, 10, 22),
+              getDirectory() + "/0000000000001234-10-22.npy");
+
+    // Nothing is cached yet.
+    TTestAccumulator<double> acc(a.cols());
+    EXPECT_FALSE(SC.lookup(0x1234, 10, 22, acc));
+    EXPECT_EQ(acc.count(Classification::GROUP_0), 0);
+
+    // Cache the statistics of samples [10, 22(.
+    acc.add(a, classifier);
+    ASSERT_TRUE(SC.insert(0x1234, 10, 22, acc));
+
+    // The same samples, or a subset of them, are served from the cache.
+    TTestAccumulator<double> all;
+    ASSERT_TRUE(SC.lookup(0x1234, 10, 22, all));
+    EXPECT_EQ(all.samples(), 12);
+    EXPECT_EQ(all.t_test(), acc.t_test());
+
+    TTestAccumulator<double> some;
+    ASSERT_TRUE(SC.lookup(0x1234, 13, 18, some));
+    EXPECT_EQ(some.samples(), 5);
+    EXPECT_EQ(some.count(Classification::GROUP_1), 20);
+    expectNear(some.t_test(), t_test(3, 8, a, classifier));
+
+    // Samples not covered, or another key, are not served.
+    TTestAccumulator<double> miss;
+    EXPECT_FALSE(SC.lookup(0x1234, 8, 15, miss));
+    EXPECT_FALSE(SC.lookup(0x1234, 15, 23, miss));
+    EXPECT_FALSE(SC.lookup(0x4321, 13, 18, miss));
+    EXPECT_EQ(miss.samples(), 0);
+
+    // The narrowest state covering the samples is used.
+    TTestAccumulator<double> narrow(4);
+    narrow.add(a.view(0, 10, 4, 8), classifier);
+    ASSERT_TRUE(SC.insert(0x1234, 14, 18, narrow));
+    NPArrayBase::Window window;
+    EXPECT_EQ(SC.lookup(0x1234, 15, 17, window),
+              SC.getFilename(0x1234, 14, 18));
+    EXPECT_EQ(window.colBegin, 1);
+    EXPECT_EQ(window.colEnd, 3);
+    EXPECT_EQ(SC.lookup(0x1234, 12, 17, window),
+              SC.getFilename(0x1234, 10, 22));
+    EXPECT_EQ(window.colBegin, 2);
+    EXPECT_EQ(window.colEnd, 7);
+}
+
+TEST_F(StatsCacheF, CorrelAccumulator) {
+    const NPArray<double> a = traces(30, 8);
+    NPArray<double> ival(1, a.rows());
+    for (size_t r = 0; r < a.rows(); r++)
+        ival(0, r) = double((r * 7) % 11);
+
+    StatsCache SC(getDirectory());
+    ASSERT_TRUE(SC.good());
+    CorrelAccumulator<double> acc(a.cols());
+    acc.add(a, ival);
+    ASSERT_TRUE(SC.insert(42, 0, 8, acc));
+
+    CorrelAccumulator<double> some;
+    ASSERT_TRUE(SC.lookup(42, 2, 7, some));
+    EXPECT_EQ(some.samples(), 5);
+    EXPECT_EQ(some.count(), 30);
+    expectNear(some.correl(), correl(2, 7, a, ival));
+}
+
+TEST_F(StatsCacheF, errors) {
+    EXPECT_FALSE(StatsCache("").good());
+
+    // The cache directory can not be a file.
+    const string &filename = getTemporaryFilename(1);
+    std::ofstream(filename) << "Not a directory";
+    const StatsCache SC(filename);
+    EXPECT_FALSE(SC.good());
+    EXPECT_NE(SC.error(), nullptr);
+    TTestAccumulator<double> acc;
+    EXPECT_FALSE(SC.lookup(0x1234, 0, 1, acc));
+}
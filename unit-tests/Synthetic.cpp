@@ -0,0 +1,169 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/Expr.h"
+#include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/Noise.h"
+#include "PAF/SCA/SCA.h"
+#include "PAF/SCA/Synthetic.h"
+#include "PAF/Synthetic.h"
+#include "PAF/WAN/Synthetic.h"
+#include "PAF/WAN/Waveform.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace PAF::SCA;
+
+using PAF::WAN::syntheticWaveform;
+using PAF::WAN::Waveform;
+using std::string;
+using std::vector;
+
+TEST(Synthetic, Traces) {
+    SyntheticTraces ST(10, 4, 0x2b, NoiseSource::ZERO, 0.0, 1);
+    EXPECT_EQ(ST.getNumSamples(), 10);
+    EXPECT_EQ(ST.getLeakSample(), 4);
+    EXPECT_EQ(ST.getKey(), 0x2b);
+
+    // Without noise, the samples are hamming weights of bytes, and the
+    // leaking sample is the hamming weight of the SBox output.
+    const NPArray<double> traces = ST.getTraces<double>(0, 100);
+    const NPArray<uint32_t> inputs = ST.getInputs(0, 100);
+    EXPECT_EQ(traces.rows(), 100);
+    EXPECT_EQ(traces.cols(), 10);
+    EXPECT_EQ(inputs.rows(), 100);
+    EXPECT_EQ(inputs.cols(), 1);
+    for (size_t r = 0; r < traces.rows(); r++) {
+        EXPECT_EQ(inputs(r, 0), ST.getInput(r));
+        const Expr::AESSBox SBox(new Expr::Constant(
+            Expr::ValueType::UINT8, ST.getInput(r) ^ ST.getKey()));
+        EXPECT_EQ(ST.getLeakage(r),
+                  hamming_weight<uint8_t>(SBox.eval().getValue(), 0xFF));
+        EXPECT_EQ(traces(r, 4), ST.getLeakage(r));
+        for (size_t c = 0; c < traces.cols(); c++) {
+            EXPECT_GE(traces(r, c), 0.0);
+            EXPECT_LE(traces(r, c), 8.0);
+        }
+    }
+
+    // The traces can be generated in any order.
+    const vector<size_t> rows{50, 51, 52, 53, 54, 55, 56, 57, 58, 59};
+    EXPECT_EQ(ST.getTraces<double>(50, 10),
+              traces.extract(NPArray<double>::ROW, rows));
+    EXPECT_EQ(ST.getInputs(50, 10),
+              inputs.extract(NPArray<uint32_t>::ROW, rows));
+
+    // The traces only depend on the seed.
+    SyntheticTraces ST1(10, 4, 0x2b, NoiseSource::NORMAL, 1.0, 1);
+    SyntheticTraces ST2(10, 4, 0x2b, NoiseSource::NORMAL, 1.0, 1);
+    SyntheticTraces ST3(10, 4, 0x2b, NoiseSource::NORMAL, 1.0, 2);
+    const NPArray<double> traces1 = ST1.getTraces<double>(0, 100);
+    EXPECT_EQ(traces1, ST2.getTraces<double>(0, 100));
+    EXPECT_NE(traces1, ST3.getTraces<double>(0, 100));
+    EXPECT_NE(traces1, traces);
+    EXPECT_EQ(ST1.getInputs(0, 100), inputs);
+    EXPECT_NE(ST3.getInputs(0, 100), inputs);
+}
+
+TEST(Synthetic, TracesConversion) {
+    EXPECT_EQ(SyntheticTraces::convert<uint8_t>(-1.2), 0);
+    EXPECT_EQ(SyntheticTraces::convert<uint8_t>(3.4), 3);
+    EXPECT_EQ(SyntheticTraces::convert<uint8_t>(3.6), 4);
+    EXPECT_EQ(SyntheticTraces::convert<uint8_t>(300.0), 255);
+    EXPECT_EQ(SyntheticTraces::convert<int8_t>(-3.6), -4);
+    EXPECT_EQ(SyntheticTraces::convert<int8_t>(-300.0), -128);
+    EXPECT_EQ(SyntheticTraces::convert<int16_t>(1000.2), 1000);
+    EXPECT_FLOAT_EQ(SyntheticTraces::convert<float>(3.25), 3.25f);
+
+    SyntheticTraces ST(10, 4, 0x2b, NoiseSource::UNIFORM, 2.0, 1);
+    const NPArray<double> traces = ST.getTraces<double>(0, 10);
+    const NPArray<int16_t> itraces = ST.getTraces<int16_t>(0, 10);
+    for (size_t r = 0; r < traces.rows(); r++)
+        for (size_t c = 0; c < traces.cols(); c++)
+            EXPECT_EQ(itraces(r, c),
+                      SyntheticTraces::convert<int16_t>(traces(r, c)));
+}
+
+TEST(Synthetic, Waveform) {
+    const Waveform W = syntheticWaveform(10, 100, 0.5, 1);
+    EXPECT_EQ(W.getNumSignals(), 10);
+    EXPECT_EQ(W.getStartTime(), 0);
+    EXPECT_EQ(W.getEndTime(), 990);
+    EXPECT_EQ(std::distance(W.timesBegin(), W.timesEnd()), 100);
+    size_t numChanges = 0;
+    for (size_t s = 0; s < W.getNumSignals(); s++) {
+        EXPECT_EQ(W[s].getNumBits(), s % 2 == 0 ? 1 : 32);
+        numChanges += W[s].getNumChanges();
+    }
+    // About half of the signals change at each time step.
+    EXPECT_GT(numChanges, 10 + 99 * 10 * 4 / 10);
+    EXPECT_LT(numChanges, 10 + 99 * 10 * 6 / 10);
+
+    // All signals change at each time step with a full activity, and only
+    // get their initial value without activity.
+    const Waveform Full = syntheticWaveform(4, 10, 1.0);
+    const Waveform Still = syntheticWaveform(4, 10, 0.0);
+    for (size_t s = 0; s < 4; s++) {
+        EXPECT_EQ(Full[s].getNumChanges(), 10);
+        EXPECT_EQ(Still[s].getNumChanges(), 1);
+    }
+
+    // The waveform only depends on the seed.
+    EXPECT_TRUE(syntheticWaveform(10, 100, 0.5, 1)[3] == W[3]);
+    EXPECT_FALSE(syntheticWaveform(10, 100, 0.5, 2)[3] == W[3]);
+}
+
+TEST(Synthetic, Tarmac) {
+    std::ostringstream os1;
+    EXPECT_TRUE(PAF::writeSyntheticTarmac(os1, 100, 1));
+
+    // Count the instructions, executed or not.
+    std::istringstream is(os1.str());
+    size_t numExecuted = 0;
+    size_t numSkipped = 0;
+    string line;
+    vector<string> lines;
+    while (std::getline(is, line)) {
+        lines.push_back(line);
+        if (line.find(" clk IT (") != string::npos)
+            numExecuted++;
+        else if (line.find(" clk IS (") != string::npos)
+            numSkipped++;
+    }
+    EXPECT_EQ(numExecuted + numSkipped, 100);
+    EXPECT_EQ(lines[3],
+              "1 clk IT (1) 00008000 2240 T thread : MOVS     r2,#0x40");
+    EXPECT_EQ(lines[4], "1 clk R r2 00000040");
+    EXPECT_EQ(lines.back().substr(0, 8), "100 clk ");
+
+    // The trace only depends on the seed.
+    std::ostringstream os2;
+    std::ostringstream os3;
+    EXPECT_TRUE(PAF::writeSyntheticTarmac(os2, 100, 1));
+    EXPECT_TRUE(PAF::writeSyntheticTarmac(os3, 100, 2));
+    EXPECT_EQ(os1.str(), os2.str());
+    EXPECT_NE(os1.str(), os3.str());
+}
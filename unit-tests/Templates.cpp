@@ -0,0 +1,218 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/SCA/Templates.h"
+#include "PAF/SCA/NPArray.h"
+
+#include "paf-unit-testing.h"
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace PAF::SCA;
+using std::vector;
+
+// Create the test fixture for Templates.
+TEST_WITH_TEMP_FILE(TemplatesF, "test-Templates.npy.XXXXXX");
+
+namespace {
+// Generate num_traces traces of num_pois samples, in num_classes classes,
+// with a class dependent offset on some of the samples, correlated noise and
+// a large common offset.
+NPArray<double> profilingTraces(size_t num_traces, size_t num_pois,
+                                size_t num_classes, vector<uint32_t> &classes) {
+    std::mt19937 gen(1234);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    NPArray<double> traces(num_traces, num_pois);
+    classes.resize(num_traces);
+    for (size_t t = 0; t < num_traces; t++) {
+        classes[t] = uint32_t(t % num_classes);
+        double prev = 0.0;
+        for (size_t p = 0; p < num_pois; p++) {
+            const double n = noise(gen) + 0.5 * prev;
+            prev = n;
+            traces(t, p) = 1000.0 + n + (p % 3 == 0 ? double(classes[t]) : 0);
+        }
+    }
+    return traces;
+}
+} // namespace
+
+TEST_F(TemplatesF, build) {
+    // More POIs than a scatter matrix tile.
+    const size_t numTraces = 600;
+    const size_t numPOIs = 37;
+    const size_t numClasses = 4;
+    vector<uint32_t> classes;
+    const NPArray<double> traces =
+        profilingTraces(numTraces, numPOIs, numClasses, classes);
+
+    // Compute the expected means and pooled covariance naively.
+    NPArray<double> expectedMeans(numClasses, numPOIs);
+    vector<size_t> counts(numClasses, 0);
+    for (size_t c = 0; c < numClasses; c++)
+        for (size_t p = 0; p < numPOIs; p++)
+            expectedMeans(c, p) = 0.0;
+    for (size_t t = 0; t < numTraces; t++) {
+        counts[classes[t]] += 1;
+        for (size_t p = 0; p < numPOIs; p++)
+            expectedMeans(classes[t], p) += traces(t, p);
+    }
+    for (size_t c = 0; c < numClasses; c++)
+        for (size_t p = 0; p < numPOIs; p++)
+            expectedMeans(c, p) /= double(counts[c]);
+    NPArray<double> expectedCov(numPOIs, numPOIs);
+    for (size_t i = 0; i < numPOIs; i++)
+        for (size_t j = 0; j < numPOIs; j++) {
+            double s = 0.0;
+            for (size_t t = 0; t < numTraces; t++)
+                s += (traces(t, i) - expectedMeans(classes[t], i)) *
+                     (traces(t, j) - expectedMeans(classes[t], j));
+            expectedCov(i, j) = s / double(numTraces - numClasses);
+        }
+
+    TemplateBuilder<double> all(numClasses, numPOIs);
+    EXPECT_EQ(all.classes(), numClasses);
+    EXPECT_EQ(all.pois(), numPOIs);
+    all.add(traces, classes);
+    EXPECT_EQ(all.count(), numTraces);
+    EXPECT_EQ(all.count(1), numTraces / numClasses);
+    EXPECT_EQ(all.count(numClasses), 0);
+    const Templates T = all.build();
+    ASSERT_TRUE(T.good());
+    EXPECT_EQ(T.classes(), numClasses);
+    EXPECT_EQ(T.pois(), numPOIs);
+    expectNear(T.means(), expectedMeans, 1e-9);
+    expectNear(T.covariance(), expectedCov, 1e-9);
+
+    // Accumulate in separate builders, with different references, and merge
+    // them.
+    TemplateBuilder<double> b0(numClasses, numPOIs);
+    TemplateBuilder<double> b1(numClasses, numPOIs);
+    TemplateBuilder<double> empty(numClasses, numPOIs);
+    b0.add(traces.view(0, 250, 0, numPOIs), classes);
+    b1.add(traces.view(250, numTraces, 0, numPOIs), classes, 250);
+    EXPECT_TRUE(empty.merge(b0));
+    EXPECT_TRUE(empty.merge(b1));
+    EXPECT_EQ(empty.count(), numTraces);
+    const Templates M = empty.build();
+    ASSERT_TRUE(M.good());
+    expectNear(M.means(), expectedMeans, 1e-9);
+    expectNear(M.covariance(), expectedCov, 1e-9);
+    EXPECT_FALSE(b0.merge(TemplateBuilder<double>(numClasses, 3)));
+
+    // Traces with an out of range class are ignored.
+    vector<uint32_t> ignored(numTraces, numClasses);
+    all.add(traces, ignored);
+    EXPECT_EQ(all.count(), numTraces);
+}
+
+TEST_F(TemplatesF, match) {
+    // With 2 POIs, the log-likelihood can be computed explicitly.
+    const NPArray<double> means({1.0, 2.0, -1.0, 0.5, 3.0, 3.0}, 3, 2);
+    const NPArray<double> cov({2.0, 0.5, 0.5, 1.0}, 2, 2);
+    const Templates T(means, cov);
+    ASSERT_TRUE(T.good());
+
+    const NPArray<int16_t> traces({0, 0, 1, 2, -3, 4, 5, 1, 2, 2}, 5, 2);
+    const NPArray<double> scores = T.match(NPArrayView<int16_t>(traces));
+    ASSERT_EQ(scores.rows(), 5);
+    ASSERT_EQ(scores.cols(), 3);
+    const double det = 2.0 * 1.0 - 0.5 * 0.5;
+    for (size_t t = 0; t < traces.rows(); t++)
+        for (size_t c = 0; c < means.rows(); c++) {
+            const double x = traces(t, 0) - means(c, 0);
+            const double y = traces(t, 1) - means(c, 1);
+            const double d2 =
+                (1.0 * x * x - 2 * 0.5 * x * y + 2.0 * y * y) / det;
+            const double expected =
+                -0.5 * (d2 + 2.0 * std::log(2.0 * M_PI) + std::log(det));
+            EXPECT_NEAR(scores(t, c), expected, 1e-12);
+        }
+
+    // Traces generated from a class best match this class' template.
+    const size_t numClasses = 4;
+    vector<uint32_t> classes;
+    const NPArray<double> profiling =
+        profilingTraces(4000, 12, numClasses, classes);
+    TemplateBuilder<double> B(numClasses, 12);
+    B.add(profiling, classes);
+    const Templates P = B.build();
+    ASSERT_TRUE(P.good());
+    const NPArray<double> ll =
+        P.match(NPArrayView<double>(profiling, 0, 400, 0, 12));
+    size_t correct = 0;
+    for (size_t t = 0; t < ll.rows(); t++) {
+        size_t best = 0;
+        for (size_t c = 1; c < numClasses; c++)
+            if (ll(t, c) > ll(t, best))
+                best = c;
+        correct += best == classes[t] ? 1 : 0;
+    }
+    EXPECT_GT(correct, 300);
+
+    // Classes without a mean never match.
+    const NPArray<double> partial(
+        {1.0, 2.0, std::numeric_limits<double>::quiet_NaN(),
+         std::numeric_limits<double>::quiet_NaN()},
+        2, 2);
+    const Templates U(partial, cov);
+    ASSERT_TRUE(U.good());
+    const NPArray<double> u = U.match(NPArrayView<int16_t>(traces));
+    for (size_t t = 0; t < traces.rows(); t++) {
+        EXPECT_NEAR(u(t, 0), scores(t, 0), 1e-12);
+        EXPECT_EQ(u(t, 1), -std::numeric_limits<double>::infinity());
+    }
+}
+
+TEST_F(TemplatesF, saveAndErrors) {
+    const NPArray<double> means({1.0, 2.0, -1.0, 0.5, 3.0, 3.0}, 3, 2);
+    const NPArray<double> cov({2.0, 0.5, 0.5, 1.0}, 2, 2);
+    const Templates T(means, cov);
+    ASSERT_TRUE(T.save(getTemporaryFilename()));
+    const Templates R(getTemporaryFilename());
+    ASSERT_TRUE(R.good());
+    EXPECT_EQ(R.means(), means);
+    EXPECT_EQ(R.covariance(), cov);
+    const NPArray<float> traces({0.5, 1.0, 2.0, -1.0}, 2, 2);
+    EXPECT_EQ(R.match(NPArrayView<float>(traces)),
+              T.match(NPArrayView<float>(traces)));
+
+    // A covariance matrix which is not positive definite.
+    const Templates N(means, NPArray<double>({1.0, 2.0, 2.0, 1.0}, 2, 2));
+    EXPECT_FALSE(N.good());
+    EXPECT_NE(N.error(), nullptr);
+
+    // Mismatching dimensions.
+    EXPECT_FALSE(Templates(means, NPArray<double>(3, 3)).good());
+    ASSERT_TRUE(NPArray<double>(2, 2).save(getTemporaryFilename()));
+    EXPECT_FALSE(Templates(getTemporaryFilename()).good());
+    EXPECT_FALSE(Templates("non-existent.npy").good());
+
+    // Too few traces for the covariance to be defined.
+    TemplateBuilder<uint16_t> B(2, 2);
+    B.add(NPArray<uint16_t>({1, 2, 3, 4}, 2, 2), {0, 1});
+    EXPECT_FALSE(B.build().good());
+}
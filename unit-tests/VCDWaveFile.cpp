@@ -24,6 +24,7 @@
 
 #include "paf-unit-testing.h"
 
+#include <fstream>
 #include <string>
 #include <vector>
 
@@ -84,6 +85,33 @@ TEST(VCDWaveFile, Read) {
     EXPECT_EQ(W.getTimeZero(), 0);
 }
 
+TEST(VCDWaveFile, ReadTimeWindows) {
+    const Waveform Full = VCDWaveFile(VCDInput).read();
+    TimeWindows TW(10000, 30000);
+    TW.add(55000, 61000);
+    const Waveform W =
+        VCDWaveFile(VCDInput).read(Waveform::Visitor::Options(), TW);
+
+    EXPECT_EQ(W.getStartTime(), 10000);
+    EXPECT_EQ(W.getEndTime(), 61000);
+    EXPECT_EQ(W.getNumSignals(), Full.getNumSignals());
+
+    size_t numChanges = 0;
+    size_t numFullChanges = 0;
+    for (SignalIdxTy s = 0; s < W.getNumSignals(); s++) {
+        const Signal &S = W[s];
+        // The values at the windows start, and inside the windows, are known.
+        for (const TimeTy t : {10000, 15000, 25000, 55000, 60000})
+            EXPECT_EQ(S.getValueAtTime(t), Full[s].getValueAtTime(t));
+        // Nothing is loaded after the last window.
+        if (S.getNumChanges() != 0)
+            EXPECT_LT(S.getChange(S.getNumChanges() - 1).time, 61000);
+        numChanges += S.getNumChanges();
+        numFullChanges += Full[s].getNumChanges();
+    }
+    EXPECT_LT(numChanges, numFullChanges);
+}
+
 TEST(VCDWaveFile, getAllChangesTimes) {
     VCDWaveFile F(VCDInput);
     EXPECT_EQ(F.getFileFormat(), WaveFile::FileFormat::VCD);
@@ -96,6 +124,94 @@ TEST(VCDWaveFile, getAllChangesTimes) {
         EXPECT_EQ(times[i], i * 5000);
 }
 
+TEST(VCDWaveFile, getTimeRange) {
+    VCDWaveFile F(VCDInput);
+    EXPECT_EQ(F.getTimeRange(), std::make_pair(TimeTy(0), TimeTy(110000)));
+}
+
+// Create the test fixture for the VCD parsing in several chunks.
+TEST_WITH_TEMP_FILE(VCDWaveFileChunksF, "test-VCDChunks.vcd.XXXXXX");
+
+namespace {
+// Write a VCD file with numSteps time steps, a $dumpvars section around the
+// middle of its body, and an invalid value change at step errorStep (if
+// any). Returns the line number of the invalid value change.
+size_t writeChunkedVCD(const string &filename, size_t numSteps,
+                       size_t errorStep = 0) {
+    std::ofstream os(filename);
+    size_t line = 0;
+    const auto emit = [&](const string &s) {
+        os << s << '\n';
+        return ++line;
+    };
+    emit("$timescale");
+    emit("\t1ps");
+    emit("$end");
+    emit("$scope module top $end");
+    emit("$var wire 1 ! clk $end");
+    emit("$var wire 8 \" cnt [7:0] $end");
+    emit("$upscope $end");
+    emit("$enddefinitions $end");
+    size_t errorLine = 0;
+    for (size_t t = 0; t < numSteps; t++) {
+        // The $dumpvars section spans several time steps, and thus a chunk
+        // boundary.
+        if (t == numSteps * 2 / 5)
+            emit("$dumpvars");
+        emit("#" + std::to_string(t * 10));
+        emit(t % 2 == 0 ? "0!" : "1!");
+        string cnt = "b";
+        for (unsigned b = 8; b-- > 0;)
+            cnt += (t >> b) & 1 ? '1' : '0';
+        emit(cnt + " \"");
+        if (t == numSteps * 3 / 5)
+            emit("$end");
+        if (errorStep != 0 && t == errorStep)
+            errorLine = emit("1?");
+    }
+    return errorLine;
+}
+} // namespace
+
+TEST_F(VCDWaveFileChunksF, ReadInChunks) {
+    writeChunkedVCD(getTemporaryFilename(), 400);
+
+    const Waveform Single =
+        VCDWaveFile(getTemporaryFilename()).setChunking(1).read();
+    // Chunks of a few hundred bytes, rather than the default 1 MiB.
+    for (const size_t numChunks : {2, 4, 7}) {
+        const Waveform W = VCDWaveFile(getTemporaryFilename())
+                               .setChunking(numChunks, 256)
+                               .read();
+        EXPECT_EQ(W.getStartTime(), Single.getStartTime());
+        EXPECT_EQ(W.getEndTime(), Single.getEndTime());
+        ASSERT_EQ(W.getNumSignals(), Single.getNumSignals());
+        for (SignalIdxTy s = 0; s < W.getNumSignals(); s++) {
+            ASSERT_EQ(W[s].getNumChanges(), Single[s].getNumChanges());
+            for (size_t c = 0; c < W[s].getNumChanges(); c++)
+                EXPECT_EQ(W[s].getChange(c), Single[s].getChange(c));
+        }
+    }
+    EXPECT_EQ(Single.getEndTime(), 3990);
+    EXPECT_EQ(Single[1].getNumChanges(), 400);
+}
+
+TEST_F(VCDWaveFileChunksF, ReadInChunksError) {
+    // The process ThreadPool workers do not survive a plain fork.
+    GTEST_FLAG(death_test_style) = "threadsafe";
+    // The invalid value change is in the last chunk.
+    const size_t errorLine = writeChunkedVCD(getTemporaryFilename(), 400, 390);
+    const string error = "Parse error in file .* at line " +
+                         std::to_string(errorLine) +
+                         " : unknown signal referenced";
+    EXPECT_DEATH(
+        { VCDWaveFile(getTemporaryFilename()).setChunking(1).read(); },
+        error);
+    EXPECT_DEATH(
+        { VCDWaveFile(getTemporaryFilename()).setChunking(4, 256).read(); },
+        error);
+}
+
 // Create the test fixture for VCDWrite.
 TEST_WITH_TEMP_FILE(VCDWaveFileF, "test-VCDWrite.vcd.XXXXXX");
 TEST_F(VCDWaveFileF, Write) {
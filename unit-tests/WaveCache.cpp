@@ -0,0 +1,132 @@
+/*
+ * SPDX-FileCopyrightText: <text>Copyright 2024 Arm Limited and/or its
+ * affiliates <open-source-office@arm.com></text>
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of PAF, the Physical Attack Framework.
+ */
+
+#include "PAF/WAN/WaveCache.h"
+#include "PAF/WAN/VCDWaveFile.h"
+#include "PAF/WAN/WaveFile.h"
+#include "PAF/WAN/Waveform.h"
+#include "paf-unit-testing.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace PAF::WAN;
+using namespace testing;
+
+using std::string;
+
+#ifndef SAMPLES_SRC_DIR
+#error SAMPLES_SRC_DIR not defined
+#endif
+
+static const string VCDInput(SAMPLES_SRC_DIR "Counters.vcd");
+
+namespace {
+void expectEq(const Waveform &lhs, const Waveform &rhs) {
+    EXPECT_EQ(lhs.getFileName(), rhs.getFileName());
+    EXPECT_EQ(lhs.getVersion(), rhs.getVersion());
+    EXPECT_EQ(lhs.getDate(), rhs.getDate());
+    EXPECT_EQ(lhs.getComment(), rhs.getComment());
+    EXPECT_EQ(lhs.getStartTime(), rhs.getStartTime());
+    EXPECT_EQ(lhs.getEndTime(), rhs.getEndTime());
+    EXPECT_EQ(lhs.getTimeZero(), rhs.getTimeZero());
+    EXPECT_EQ(lhs.getTimeScale(), rhs.getTimeScale());
+    EXPECT_TRUE(std::equal(lhs.timesBegin(), lhs.timesEnd(), rhs.timesBegin(),
+                           rhs.timesEnd()));
+    ASSERT_EQ(lhs.getNumSignals(), rhs.getNumSignals());
+    for (SignalIdxTy s = 0; s < lhs.getNumSignals(); s++)
+        EXPECT_EQ(lhs[s], rhs[s]);
+    EXPECT_EQ(lhs.getObjectSize(), rhs.getObjectSize());
+}
+} // namespace
+
+TEST_WITH_TEMP_FILE(WaveCacheF, "test-WaveCache.XXXXXX");
+
+TEST_F(WaveCacheF, base) {
+    const Waveform Ref = VCDWaveFile(VCDInput).read();
+
+    // No cache yet.
+    WaveCache WC(getTemporaryFilename(), VCDInput);
+    EXPECT_EQ(WC.getFilename(), getTemporaryFilename());
+    Waveform W;
+    EXPECT_FALSE(WC.load(W));
+    EXPECT_TRUE(WC.good());
+
+    // Reading populates the cache, which is then used.
+    expectEq(WC.read(), Ref);
+    EXPECT_TRUE(WC.good());
+    ASSERT_TRUE(WC.load(W));
+    EXPECT_TRUE(WC.good());
+    expectEq(W, Ref);
+    EXPECT_EQ(W.findSignalIdx("tbench.DUT", "cnt [8:0]"),
+              Ref.findSignalIdx("tbench.DUT", "cnt [8:0]"));
+    EXPECT_EQ(W.findSignalIdx("tbench", "clk"),
+              Ref.findSignalIdx("tbench", "clk"));
+    const Waveform::SignalDesc *SD = W.findSignalDesc("tbench.DUT", "clk");
+    ASSERT_NE(SD, nullptr);
+    EXPECT_TRUE(SD->isWire());
+    EXPECT_TRUE(SD->isAlias());
+
+    // The cache is tied to the selection it was saved with.
+    const Waveform::Visitor::Options NoRegs(/* skipRegs: */ true);
+    const TimeWindows TW(10000, 30000);
+    EXPECT_FALSE(WC.load(W, NoRegs));
+    EXPECT_FALSE(WC.load(W, Waveform::Visitor::Options(), TW));
+    EXPECT_TRUE(WC.good());
+
+    const Waveform RefNoRegs = VCDWaveFile(VCDInput).read(NoRegs, TW);
+    ASSERT_TRUE(WC.save(RefNoRegs, NoRegs, TW));
+    EXPECT_FALSE(WC.load(W));
+    ASSERT_TRUE(WC.load(W, NoRegs, TW));
+    expectEq(W, RefNoRegs);
+    expectEq(WC.read(NoRegs, TW), RefNoRegs);
+}
+
+TEST_F(WaveCacheF, errors) {
+    const Waveform Ref = VCDWaveFile(VCDInput).read();
+    WaveCache WC(getTemporaryFilename(), VCDInput);
+    ASSERT_TRUE(WC.save(Ref));
+
+    // A truncated cache is reported as malformed, and left alone.
+    std::ifstream is(getTemporaryFilename(), std::ifstream::binary);
+    string content((std::istreambuf_iterator<char>(is)),
+                   std::istreambuf_iterator<char>());
+    is.close();
+    std::ofstream os(getTemporaryFilename(), std::ofstream::binary);
+    os.write(content.data(), content.size() - 8);
+    os.close();
+    Waveform W("untouched");
+    EXPECT_FALSE(WC.load(W));
+    EXPECT_FALSE(WC.good());
+    EXPECT_NE(WC.error(), nullptr);
+    EXPECT_EQ(W.getFileName(), "untouched");
+
+    // A cache for a missing waveform file is never valid.
+    WaveCache WC2(getTemporaryFilename(), "does-not-exist.vcd");
+    EXPECT_FALSE(WC2.load(W));
+    EXPECT_FALSE(WC2.save(Ref));
+    EXPECT_FALSE(WC2.good());
+
+    EXPECT_EQ(WaveCache::getCacheFilename("trace.vcd"), "trace.vcd.paf-wave");
+}
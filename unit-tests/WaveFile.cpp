@@ -37,7 +37,10 @@ class WaveFileTest : public WaveFile {
     WaveFileTest(const std::string &filename, WaveFile::FileFormat fmt)
         : WaveFile(filename, fmt) {}
 
-    bool read(Waveform &W) override { return true; }
+    bool read(Waveform &W, const Waveform::Visitor::Options &options,
+              const TimeWindows &windows) override {
+        return true;
+    }
     bool write(const Waveform &W) override { return true; }
 
     vector<TimeTy> getAllChangesTimes() override { return {}; }
@@ -57,6 +60,36 @@ TEST(WaveFile, Basics) {
     EXPECT_EQ(WF3.getFileFormat(), WaveFile::FileFormat::UNKNOWN);
 }
 
+TEST(WaveFile, TimeWindows) {
+    const TimeWindows Empty;
+    EXPECT_TRUE(Empty.empty());
+    EXPECT_TRUE(Empty.contains(0));
+    EXPECT_TRUE(Empty.contains(1000));
+
+    TimeWindows TW(10, 20);
+    TW.add(20, 30).add(50, 60);
+    EXPECT_FALSE(TW.empty());
+    EXPECT_EQ(TW.size(), 3);
+    EXPECT_EQ(TW.getBeginTime(), 10);
+    EXPECT_EQ(TW.getEndTime(), 60);
+
+    EXPECT_EQ(TW.find(0), 0);
+    EXPECT_EQ(TW.find(10), 0);
+    EXPECT_EQ(TW.find(19), 0);
+    EXPECT_EQ(TW.find(20), 1);
+    EXPECT_EQ(TW.find(30), 2);
+    EXPECT_EQ(TW.find(59), 2);
+    EXPECT_EQ(TW.find(60), 3);
+
+    EXPECT_FALSE(TW.contains(9));
+    EXPECT_TRUE(TW.contains(10));
+    EXPECT_TRUE(TW.contains(29));
+    EXPECT_FALSE(TW.contains(30));
+    EXPECT_FALSE(TW.contains(49));
+    EXPECT_TRUE(TW.contains(50));
+    EXPECT_FALSE(TW.contains(60));
+}
+
 TEST(WaveFile, FileFormat) {
     EXPECT_EQ(WaveFile::getFileFormat("toto.vcd"), WaveFile::FileFormat::VCD);
     EXPECT_EQ(WaveFile::getFileFormat("toto.fst"), WaveFile::FileFormat::FST);
@@ -64,6 +97,27 @@ TEST(WaveFile, FileFormat) {
               WaveFile::FileFormat::UNKNOWN);
 }
 
+TEST(WaveFile, WriteOptions) {
+    WriteOptions WO;
+    EXPECT_EQ(WO.compression, WriteOptions::Compression::FAST);
+    EXPECT_TRUE(WO.parallel);
+    EXPECT_EQ(WO.blockSize, 0);
+
+    WriteOptions::Compression c;
+    EXPECT_TRUE(WriteOptions::getCompression("small", c));
+    EXPECT_EQ(c, WriteOptions::Compression::SMALL);
+    EXPECT_TRUE(WriteOptions::getCompression("balanced", c));
+    EXPECT_EQ(c, WriteOptions::Compression::BALANCED);
+    EXPECT_TRUE(WriteOptions::getCompression("fast", c));
+    EXPECT_EQ(c, WriteOptions::Compression::FAST);
+    EXPECT_FALSE(WriteOptions::getCompression("best", c));
+
+    WaveFileTest WF("test.vcd", WaveFile::FileFormat::VCD);
+    WF.setWriteOptions(WriteOptions().setBlockSize(1000).setParallel(false));
+    EXPECT_EQ(WF.getWriteOptions().blockSize, 1000);
+    EXPECT_FALSE(WF.getWriteOptions().parallel);
+}
+
 TEST(WaveFile, readAndMerge) {
     Waveform W = readAndMerge(vector<string>());
     EXPECT_EQ(W.getNumSignals(), 0);
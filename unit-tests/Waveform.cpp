@@ -290,6 +290,9 @@ TEST(Waveform, Basics) {
     for (const auto &s : W)
         WSize += sizeof(std::unique_ptr<Signal>) + s.getObjectSize();
     EXPECT_EQ(W.getObjectSize(), WSize);
+
+    // memoryUsage() also counts the storage reserved for growth.
+    EXPECT_GE(W.memoryUsage(), W.getObjectSize());
 }
 
 TEST(Waveform, timeScale) {
@@ -612,6 +615,57 @@ TEST(Waveform, visitWiresInSpecificScope) {
     }
 }
 
+TEST(Waveform, readRegistersInSpecificScope) {
+
+    for (const auto &file : filesToTest) {
+        std::unique_ptr<WaveFile> wf = WaveFile::get(file, /* write: */ false);
+        const Waveform W = wf->read(
+            Visitor::Options(false, true, true).addScopeFilter("tbench.DUT"));
+        EXPECT_EQ(W.getNumSignals(), 1);
+        EXPECT_EQ(W.getStartTime(), 0);
+        EXPECT_EQ(W.getEndTime(), 110000);
+
+        MyVisitor WV(W, {{"tbench.DUT", "cnt [8:0]", 9,
+                          SignalDesc::Kind::REGISTER, 0, false}});
+        W.visit(WV);
+        WV.finalChecks();
+
+        const Signal &Cnt = W[0];
+        EXPECT_EQ(Cnt.getNumChanges(), 12);
+        EXPECT_EQ(Cnt.getValueAtTime(15000), ValueTy("000000001"));
+        EXPECT_EQ(Cnt.getValueAtTime(35000), ValueTy("000000011"));
+    }
+}
+
+TEST(Waveform, readWiresInSpecificScope) {
+
+    for (const auto &file : filesToTest) {
+        std::unique_ptr<WaveFile> wf = WaveFile::get(file, /* write: */ false);
+        const Waveform W = wf->read(
+            Visitor::Options(true, false, true).addScopeFilter("tbench.DUT"));
+        EXPECT_EQ(W.getNumSignals(), 3);
+        EXPECT_FALSE(W.findSignalIdx("tbench", "clk").first);
+
+        // The aliased registers in tbench are not selected, so clk and reset
+        // are no longer aliases.
+        MyVisitor WV(W, {{
+                            {"tbench.DUT", "clk", 1, SignalDesc::Kind::WIRE, 0,
+                             false},
+                            {"tbench.DUT", "reset", 1, SignalDesc::Kind::WIRE,
+                             1, false},
+                            {"tbench.DUT", "cnt1 [7:0]", 8,
+                             SignalDesc::Kind::WIRE, 2, false},
+                        }});
+        W.visit(WV);
+        WV.finalChecks();
+
+        const Signal &Reset = W[1];
+        EXPECT_EQ(Reset.getNumChanges(), 2);
+        EXPECT_EQ(Reset.getValueAtTime(5000), ValueTy("0"));
+        EXPECT_EQ(Reset.getValueAtTime(10000), ValueTy("1"));
+    }
+}
+
 TEST(Waveform, dumpMetadata) {
     Waveform W("filename", 12, 45, -3);
     ostringstream ostr;
@@ -619,3 +673,90 @@ TEST(Waveform, dumpMetadata) {
     EXPECT_EQ(ostr.str(), "Input file: filename\nStart time: 12\nEnd time: "
                           "45\nTimezero: 0\nTimescale: 1 ms\n");
 }
+
+TEST(Waveform, getTimeIdxMap) {
+    const vector<TimeTy> Times1{0, 10, 20, 30};
+    Waveform W1("W1", 0, 100, 0);
+    W1.addTimes(Times1.begin(), Times1.end());
+    Waveform W2("W2", 0, 100, 0);
+    W2.addTimes(Times1.begin(), Times1.end());
+    EXPECT_TRUE(W1.getTimeIdxMap(W2).empty());
+
+    const vector<TimeTy> Times3{0, 5, 20, 30, 40};
+    Waveform W3("W3", 0, 100, 0);
+    W3.addTimes(Times3.begin(), Times3.end());
+    using TimeIdxTy = PAF::WAN::TimeIdxTy;
+    EXPECT_EQ(W1.getTimeIdxMap(W3), vector<TimeIdxTy>({0, 4, 2, 3, 4}));
+    EXPECT_EQ(W3.getTimeIdxMap(W1), vector<TimeIdxTy>({0, 5, 2, 3}));
+}
+
+TEST(Waveform, sample) {
+    const Waveform W = VCDWaveFile(SAMPLES_SRC_DIR "Counters.vcd").read();
+    vector<SignalIdxTy> signals;
+    for (SignalIdxTy s = 0; s < W.getNumSignals(); s++)
+        signals.push_back(s);
+    vector<TimeTy> times;
+    for (TimeTy t = W.getStartTime(); t <= W.getEndTime(); t += 3)
+        times.push_back(t);
+
+    const size_t n = times.size();
+    for (const auto kind : {Signal::SampleKind::VALUE,
+                            Signal::SampleKind::HAMMING_WEIGHT,
+                            Signal::SampleKind::HAMMING_DISTANCE}) {
+        vector<uint64_t> sequential(signals.size() * n);
+        W.sample(sequential.data(), signals, times, kind, 1);
+        vector<uint64_t> parallel(signals.size() * n);
+        W.sample(parallel.data(), signals, times, kind, 4);
+        EXPECT_EQ(parallel, sequential);
+
+        // Each row holds the samples of a signal.
+        vector<uint64_t> row(n);
+        for (size_t s = 0; s < signals.size(); s++) {
+            W[signals[s]].sample(row.data(), times.data(), n, kind);
+            EXPECT_TRUE(std::equal(row.begin(), row.end(),
+                                   sequential.begin() + s * n));
+        }
+    }
+}
+
+TEST(Waveform, Statistics) {
+    const Waveform W = VCDWaveFile(SAMPLES_SRC_DIR "Counters.vcd").read();
+    size_t numChanges = 0;
+    for (const Signal &S : W)
+        numChanges += S.getNumChanges();
+
+    PAF::WAN::WaveformStatistics WS(W);
+    W.visit(WS);
+    EXPECT_EQ(WS.getNumSignals(), W.getNumSignals());
+    EXPECT_EQ(WS.getNumAliases(), 2);
+    EXPECT_GT(WS.getScopesMemSize(), 0);
+
+    const auto Stats = WS.getSignalsStatistics(1);
+    EXPECT_EQ(Stats.numChanges, numChanges);
+    EXPECT_GT(Stats.numToggles, 0);
+    EXPECT_GT(Stats.signalsMemSize, Stats.timingsMemSize);
+    const auto PStats = WS.getSignalsStatistics(4);
+    EXPECT_EQ(PStats.numChanges, Stats.numChanges);
+    EXPECT_EQ(PStats.numToggles, Stats.numToggles);
+    EXPECT_EQ(PStats.numHighZOrUnknown, Stats.numHighZOrUnknown);
+    EXPECT_EQ(PStats.timingsMemSize, Stats.timingsMemSize);
+    EXPECT_EQ(PStats.signalsMemSize, Stats.signalsMemSize);
+
+    // The fast mode does not iterate over the changes.
+    PAF::WAN::WaveformStatistics FWS(W, Visitor::Options(), /* fast: */ true);
+    W.visit(FWS);
+    const auto FStats = FWS.getSignalsStatistics();
+    EXPECT_EQ(FStats.numChanges, Stats.numChanges);
+    EXPECT_EQ(FStats.numToggles, 0);
+    EXPECT_EQ(FStats.signalsMemSize, Stats.signalsMemSize);
+
+    ostringstream os;
+    WS.dump(os);
+    EXPECT_NE(os.str().find(" - number of changes: " +
+                            std::to_string(numChanges) + '\n'),
+              string::npos);
+    EXPECT_NE(os.str().find("bit toggles"), string::npos);
+    ostringstream fos;
+    FWS.dump(fos);
+    EXPECT_EQ(fos.str().find("bit toggles"), string::npos);
+}
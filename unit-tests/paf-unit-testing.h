@@ -20,8 +20,12 @@
 
 #pragma once
 
+#include "PAF/SCA/NPArray.h"
+
 #include "gtest/gtest.h"
 
+#include <cmath>
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -82,3 +86,26 @@ class TestWithTemporaryFiles : public ::testing::Test {
       public:                                                                  \
         FIXTURENAME() : TestWithTemporaryFiles(TEMPLATE, NUM) {}               \
     }
+
+/// Build a \p num_rows x \p num_columns matrix with somewhat random values,
+/// to be used as traces.
+inline PAF::SCA::NPArray<double> traces(size_t num_rows, size_t num_columns) {
+    PAF::SCA::NPArray<double> a(num_rows, num_columns);
+    for (size_t r = 0; r < num_rows; r++)
+        for (size_t c = 0; c < num_columns; c++)
+            a(r, c) =
+                std::sin(double(r * num_columns + c)) + 0.1 * double(r % 3);
+    return a;
+}
+
+/// Check that \p a and \p b have the same shape, and that their elements are
+/// equal within \p tolerance.
+inline void expectNear(const PAF::SCA::NPArray<double> &a,
+                       const PAF::SCA::NPArray<double> &b,
+                       double tolerance = 1e-9) {
+    ASSERT_EQ(a.rows(), b.rows());
+    ASSERT_EQ(a.cols(), b.cols());
+    for (size_t r = 0; r < a.rows(); r++)
+        for (size_t c = 0; c < a.cols(); c++)
+            EXPECT_NEAR(a(r, c), b(r, c), tolerance);
+}
@@ -20,11 +20,17 @@
 
 #include "PAF/SCA/sca-apps.h"
 #include "PAF/SCA/NPArray.h"
+#include "PAF/SCA/utils.h"
 
 #include "paf-unit-testing.h"
 
 #include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <limits>
+#include <sstream>
+#include <string>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -33,6 +39,7 @@ using namespace PAF::SCA;
 
 using std::array;
 using std::numeric_limits;
+using std::string;
 using std::vector;
 
 TEST(SCAApp, defaults) {
@@ -158,6 +165,25 @@ TEST(SCAApp, decimation) {
     EXPECT_EQ(A2_1.decimationOffset(), 1);
 }
 
+TEST(SCAApp, jobs) {
+    array<const char *, 1> Args0 = {"appname"};
+    SCAApp A0(Args0[0], Args0.size(), (char **)Args0.data());
+    A0.setup();
+    EXPECT_EQ(NPArrayBase::numThreads(), 1);
+
+    array<const char *, 3> Args1 = {"appname", "--jobs", "4"};
+    SCAApp A1(Args1[0], Args1.size(), (char **)Args1.data());
+    A1.setup();
+    EXPECT_EQ(NPArrayBase::numThreads(), 4);
+
+    array<const char *, 3> Args2 = {"appname", "-j", "0"};
+    SCAApp A2(Args2[0], Args2.size(), (char **)Args2.data());
+    A2.setup();
+    EXPECT_GE(NPArrayBase::numThreads(), 1);
+
+    NPArrayBase::setNumThreads(1);
+}
+
 TEST(SCAApp, terse_output) {
     array<const char *, 3> Args0 = {"appname", "--output", "toto.txt"};
     SCAApp A0(Args0[0], Args0.size(), (char **)Args0.data());
@@ -683,6 +709,98 @@ TEST_F(SCAAppF, numpy_output) {
     EXPECT_EQ(R3, NPArray<double>({2., 6., 7., 3., -1.}, 1, v10[0].size() / 2));
 }
 
+TEST_F(SCAAppF, index_map) {
+    const vector<vector<double>> v4{{1., -3., 2., 0.5}};
+
+    // Save an index map, then use it for emitting results.
+    NPArray<uint64_t> index_map({5, 7, 12, 20, 30}, 1, 5);
+    const string map_filename = getTemporaryFilename() + ".map.npy";
+    ASSERT_TRUE(index_map.save(map_filename));
+
+    array<const char *, 6> Args0 = {"appname",
+                                    "--gnuplot",
+                                    "--index-map",
+                                    map_filename.c_str(),
+                                    "--output",
+                                    getTemporaryFilename().c_str()};
+    SCAApp A0(Args0[0], Args0.size(), (char **)Args0.data());
+    A0.setup();
+    A0.output(v4);
+    A0.closeOutput();
+    EXPECT_TRUE(checkFileContent({"5  1", "7  -3", "12  2", "20  0.5",
+                                  "# max = -3 at index 7"}));
+
+    // The index map is shifted by the first sample (-f) and decimation
+    // happens in the reduced samples.
+    array<const char *, 10> Args1 = {"appname",
+                                     "--gnuplot",
+                                     "--index-map",
+                                     map_filename.c_str(),
+                                     "-f",
+                                     "1",
+                                     "--decimate",
+                                     "2%1",
+                                     "--output",
+                                     getTemporaryFilename().c_str()};
+    SCAApp A1(Args1[0], Args1.size(), (char **)Args1.data());
+    A1.setup();
+    A1.output(v4);
+    A1.closeOutput();
+    EXPECT_TRUE(
+        checkFileContent({"12  -3", "30  0.5", "# max = -3 at index 12"}));
+
+    std::remove(map_filename.c_str());
+}
+
+TEST_F(SCAAppF, large_outputs) {
+    // Outputs large enough to be written in several blocks.
+    NPArray<double> values(2, 300000);
+    for (size_t r = 0; r < values.rows(); r++)
+        for (size_t c = 0; c < values.cols(); c++)
+            values(r, c) = std::sin(double(c)) * double(r + 1) * 1e3;
+
+    array<const char *, 6> ArgsG = {
+        "appname", "--gnuplot", "--decimate",
+        "3%1",     "--output",  getTemporaryFilename().c_str()};
+    SCAApp AG(ArgsG[0], ArgsG.size(), (char **)ArgsG.data());
+    AG.setup();
+    AG.output(values);
+    AG.closeOutput();
+    vector<string> expected;
+    for (size_t c = 1; c < values.cols(); c += 3) {
+        std::ostringstream os;
+        os << (c / 3) << "  " << values(0, c) << "  " << values(1, c);
+        expected.push_back(os.str());
+    }
+    size_t index;
+    std::ostringstream comment;
+    comment << "# max = " << find_max(values.cbegin(0), &index, 3, 1)
+            << " at index 0," << (index / 3);
+    expected.push_back(comment.str());
+    comment.str("");
+    comment << "# max = " << find_max(values.cbegin(1), &index, 3, 1)
+            << " at index 1," << (index / 3);
+    expected.push_back(comment.str());
+    EXPECT_TRUE(checkFileContent(expected));
+
+    array<const char *, 6> ArgsN = {
+        "appname", "--numpy",  "--decimate",
+        "3%2",     "--output", getTemporaryFilename().c_str()};
+    SCAApp AN(ArgsN[0], ArgsN.size(), (char **)ArgsN.data());
+    AN.setup();
+    AN.output(values);
+    AN.closeOutput();
+    NPArray<double> R(getTemporaryFilename());
+    EXPECT_TRUE(R.good());
+    EXPECT_EQ(R.rows(), values.rows());
+    EXPECT_EQ(R.cols(), values.cols() / 3);
+    bool same = true;
+    for (size_t r = 0; r < R.rows(); r++)
+        for (size_t c = 0; c < R.cols(); c++)
+            same &= R(r, c) == values(r, c * 3 + 2);
+    EXPECT_TRUE(same);
+}
+
 TEST(SCAApp, scalePowerTrace) {
     NPArray<double> result =
         convert<double, uint8_t>(
@@ -431,6 +431,49 @@ class TestMatrixF64(unittest.TestCase, NPUtils):
         self.assertEqual(self.get_num_columns(), self.npy.shape[1])
         self.assertTrue(self.check_content())
 
+# =============================================================================
+# Slicing, conversion and transposition tests.
+# =============================================================================
+class TestConvert(unittest.TestCase, NPUtils):
+
+    def setUp(self):
+        npy = np.arange(37 * 23, dtype='float64').reshape(37, 23) + 0.5
+        self.setup(npy, "Convert.npy")
+        self.output = "Convert-out.npy"
+
+    def tearDown(self):
+        self.teardown()
+        if os.path.exists(self.output):
+            os.remove(self.output)
+
+    def convert(self, *args):
+        result = subprocess.run([nputils_exe, '-o', self.output, '--chunk-size',
+                                 '5', '-j', '3', *args, self.npy_filename])
+        self.assertEqual(result.returncode, 0)
+        return np.load(self.output)
+
+    def test_copy(self):
+        npy = self.convert()
+        self.assertEqual(npy.dtype, self.npy.dtype)
+        self.assertTrue(np.array_equal(npy, self.npy))
+
+    def test_slice(self):
+        npy = self.convert('--slice-rows', '3,30', '--slice-columns', '2,20,3')
+        self.assertTrue(np.array_equal(npy, self.npy[3:30, 2:20:3]))
+
+    def test_dtype(self):
+        npy = self.convert('--dtype', 'i2')
+        self.assertEqual(npy.dtype, np.dtype('int16'))
+        self.assertTrue(np.array_equal(npy, self.npy.astype('int16')))
+
+    def test_transpose(self):
+        npy = self.convert('--transpose')
+        self.assertTrue(np.array_equal(npy, self.npy.T))
+        npy = self.convert('--transpose', '--slice-rows', '3,30',
+                           '--slice-columns', '2,20,3', '--dtype', 'f4')
+        self.assertEqual(npy.dtype, np.dtype('float32'))
+        self.assertTrue(np.array_equal(npy, self.npy[3:30, 2:20:3].T))
+
 if __name__ == '__main__':
     # Steal np-utils executable name from the command line.
     if len(sys.argv) >= 2:
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: <text>Copyright 2025 Arm Limited and/or its
+# affiliates <open-source-office@arm.com></text>
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# This file is part of PAF, the Physical Attack Framework.
+
+import numpy as np
+import os
+import sys
+import tempfile
+import unittest
+
+import paf
+
+samples_dir = None
+
+def welsh_t_test(group0, group1):
+    m0, m1 = group0.mean(axis=0), group1.mean(axis=0)
+    v0, v1 = group0.var(axis=0, ddof=1), group1.var(axis=0, ddof=1)
+    return (m0 - m1) / np.sqrt(v0 / group0.shape[0] + v1 / group1.shape[0])
+
+def pearson(traces, ival):
+    t = traces - traces.mean(axis=0)
+    h = ival - ival.mean(axis=1, keepdims=True)
+    return (h @ t) / np.outer(np.sqrt((h * h).sum(axis=1)), np.sqrt((t * t).sum(axis=0)))
+
+class TestNPArray(unittest.TestCase):
+
+    def test_buffer(self):
+        a = np.arange(12, dtype=np.float64).reshape(3, 4)
+        npa = paf.NPArrayFloat64(a)
+        self.assertEqual((npa.rows, npa.cols), (3, 4))
+        # numpy views the NPArray elements in place.
+        v = np.asarray(npa)
+        self.assertTrue(np.array_equal(v, a))
+        w = np.asarray(npa)
+        v[1, 2] = 42
+        self.assertEqual(w[1, 2], 42)
+
+    def test_file(self):
+        a = np.arange(10, dtype=np.uint16).reshape(2, 5)
+        with tempfile.TemporaryDirectory() as d:
+            filename = os.path.join(d, "a.npy")
+            paf.NPArrayUInt16(a).save(filename)
+            self.assertTrue(np.array_equal(np.load(filename), a))
+            self.assertTrue(np.array_equal(np.asarray(paf.NPArrayUInt16(filename)), a))
+            with self.assertRaises(RuntimeError):
+                paf.NPArrayUInt16(os.path.join(d, "missing.npy"))
+
+class TestKernels(unittest.TestCase):
+
+    def setUp(self):
+        rng = np.random.default_rng(1234)
+        self.traces = rng.normal(size=(200, 30))
+        self.classifier = rng.integers(0, 2, size=200)
+        self.ival = rng.normal(size=(3, 200))
+
+    def test_t_test(self):
+        g0 = self.traces[self.classifier == 0]
+        g1 = self.traces[self.classifier == 1]
+        expected = welsh_t_test(g0, g1)
+        t = paf.t_test(0, 30, self.traces, self.classifier)
+        self.assertEqual(t.shape, (1, 30))
+        self.assertTrue(np.allclose(t[0], expected))
+        self.assertTrue(np.allclose(paf.t_test_groups(0, 30, g0, g1)[0], expected))
+        self.assertTrue(np.allclose(paf.t_test(5, 10, self.traces, self.classifier)[0], expected[5:10]))
+        # Higher order t-tests.
+        self.assertEqual(paf.t_test(0, 30, self.traces, self.classifier, order=2).shape, (1, 30))
+        # Ignored traces.
+        ignored = self.classifier.copy()
+        ignored[:50] = 2
+        self.assertTrue(np.allclose(paf.t_test(0, 30, self.traces, ignored)[0],
+                                    welsh_t_test(self.traces[50:][self.classifier[50:] == 0],
+                                                 self.traces[50:][self.classifier[50:] == 1])))
+        with self.assertRaises(IndexError):
+            paf.t_test(0, 31, self.traces, self.classifier)
+
+    def test_layouts(self):
+        # Whatever their layout, the traces are viewed in place.
+        expected = paf.t_test(0, 15, np.ascontiguousarray(self.traces[:, ::2]), self.classifier)
+        self.assertTrue(np.array_equal(paf.t_test(0, 15, self.traces[:, ::2], self.classifier), expected))
+        fortran = np.asfortranarray(self.traces)
+        self.assertTrue(np.array_equal(paf.t_test(0, 30, fortran, self.classifier),
+                                       paf.t_test(0, 30, self.traces, self.classifier)))
+        # The other element types are used as they are, or converted.
+        for dtype in [np.float32, np.int16, np.uint16, np.int32]:
+            traces = (self.traces * 100 + 1000).astype(dtype)
+            self.assertTrue(np.allclose(paf.t_test(0, 30, traces, self.classifier),
+                                        paf.t_test(0, 30, traces.astype(np.float64), self.classifier)))
+
+    def test_perfect_t_test(self):
+        g0 = np.array([[1., 2., 3.], [1., 2., 4.], [1., 2., 5.]])
+        g1 = np.array([[1., 3., 3.], [1., 3., 6.], [1., 3., 9.]])
+        t = paf.perfect_t_test_groups(0, 3, g0, g1)
+        self.assertEqual(t.shape, (1, 3))
+        self.assertEqual(t[0, 0], 0.0)
+        self.assertTrue(np.isclose(t[0, 2], welsh_t_test(g0[:, 2:], g1[:, 2:])[0]))
+        self.assertTrue(np.array_equal(paf.perfect_t_test(0, 3, np.vstack((g0, g1)), np.array([0, 0, 0, 1, 1, 1])), t))
+
+    def test_correl(self):
+        c = paf.correl(0, 30, self.traces, self.ival)
+        self.assertEqual(c.shape, (3, 30))
+        self.assertTrue(np.allclose(c, pearson(self.traces, self.ival)))
+        self.assertTrue(np.allclose(paf.correl(0, 30, self.traces, self.ival[1]), c[1:2]))
+
+class TestAccumulators(unittest.TestCase):
+
+    def setUp(self):
+        rng = np.random.default_rng(4321)
+        self.traces = rng.normal(size=(300, 20)).astype(np.float32)
+        self.classifier = rng.integers(0, 2, size=300)
+        self.ival = rng.normal(size=(2, 300))
+
+    def test_t_test(self):
+        acc = paf.TTestAccumulatorFloat32(20)
+        acc.add(self.traces[:100], self.classifier[:100])
+        other = paf.TTestAccumulatorFloat32(20)
+        other.add(self.traces[100:], self.classifier, first_trace=100)
+        self.assertTrue(acc.merge(other))
+        self.assertEqual(acc.count(0) + acc.count(1), 300)
+        expected = paf.t_test(0, 20, self.traces, self.classifier)
+        self.assertTrue(np.allclose(acc.t_test(), expected))
+        with tempfile.TemporaryDirectory() as d:
+            filename = os.path.join(d, "acc.npy")
+            acc.save(filename)
+            self.assertTrue(np.allclose(paf.TTestAccumulatorFloat32(filename).t_test(), expected))
+
+    def test_correl(self):
+        acc = paf.CorrelAccumulatorFloat32(20, 2)
+        for b in range(0, 300, 64):
+            acc.add(self.traces[b:b + 64], self.ival, first_trace=b)
+        self.assertEqual(acc.count, 300)
+        self.assertTrue(np.allclose(acc.correl(), paf.correl(0, 20, self.traces, self.ival)))
+        with self.assertRaises(ValueError):
+            acc.add(self.traces[:, :10], self.ival)
+
+class TestWaveform(unittest.TestCase):
+
+    def test_sample(self):
+        W = paf.Waveform(os.path.join(samples_dir, "Counters.vcd"))
+        cnt = W.find_signal("tbench.DUT", "cnt")
+        clk = W.find_signal("tbench", "clk")
+        self.assertIsNotNone(cnt)
+        self.assertIsNone(W.find_signal("tbench", "nothing"))
+        times = W.times()
+        self.assertEqual(times[0], W.start_time)
+        values = W.sample([cnt, clk], times)
+        self.assertEqual(values.shape, (2, len(times)))
+        self.assertTrue(np.all(values[1] <= 1))
+        weights = W.sample([cnt, clk], times, paf.SampleKind.HAMMING_WEIGHT, num_threads=2)
+        self.assertTrue(np.array_equal(weights, np.vectorize(lambda v: bin(v).count('1'))(values)))
+        distances = W.sample([cnt], times, paf.SampleKind.HAMMING_DISTANCE)
+        self.assertEqual(distances[0, 0], 0)
+        with self.assertRaises(ValueError):
+            W.sample([cnt], times[::-1])
+
+if __name__ == '__main__':
+    # Steal the samples directory from the command line.
+    if len(sys.argv) >= 2:
+        samples_dir = sys.argv[1]
+        del sys.argv[1]
+    else:
+        sys.exit("Path to the samples directory required")
+
+    unittest.main()